@@ -35,7 +35,10 @@ fn build_real_fuego_wallet() -> bool {
         .cpp(true)
         .std("c++14")
         .file("fuego_wallet_real.cpp")
+        .file("cryptonote/src/Common/Tracing.cpp")
+        .file("cryptonote/src/Wallet/FeeEstimator.cpp")
         .include(".")
+        .include("cryptonote/src")
         .compile("fuego_wallet_real");
     
     // Link the real Fuego wallet library
@@ -75,16 +78,60 @@ fn build_with_vendored_cryptonote() -> bool {
     // Root for vendored cryptonote
     let include_root = if Path::new("cryptonote/include").exists() { "cryptonote/include" } else { "src-tauri/cryptonote/include" };
     let src_root = if Path::new("cryptonote/src").exists() { "cryptonote/src" } else { "src-tauri/cryptonote/src" };
+    let platform_dir = if cfg!(target_os = "macos") {
+        "Platform/OSX"
+    } else if cfg!(target_os = "windows") {
+        "Platform/Windows"
+    } else {
+        "Platform/Linux"
+    };
+
+    // CryptoNote libraries the wallet backend links against (WalletGreen,
+    // BlockchainSynchronizer, NodeRpcProxy, MinerManager and their dependencies)
+    let modules = [
+        "Common", "crypto", "CryptoNoteCore", "Serialization", "Transfers", "Wallet",
+        "WalletLegacy", "NodeRpcProxy", "Rpc", "HTTP", "Logging", "System", "Mnemonics", "Miner",
+    ];
+    // Sources in those modules that pull in daemon/server-only dependencies
+    let excluded = [
+        "Rpc/RpcServer.cpp", "Rpc/HttpServer.cpp", "Wallet/WalletRpcServer.cpp", "Wallet/PoolRpcServer.cpp",
+        "Miner/main.cpp",
+    ];
+
+    let mut cryptonote = cc::Build::new();
+    cryptonote
+        .cpp(true)
+        .std("c++14")
+        .include(include_root)
+        .include(src_root)
+        .include(format!("{}/{}", src_root, platform_dir))
+        .include(format!("{}/external", src_root))
+        .define("STATICLIB", None)
+        .warnings(false);
+    for module in modules.iter().map(|m| m.to_string()).chain(std::iter::once(format!("{}/System", platform_dir))) {
+        for file in collect_sources(&Path::new(src_root).join(&module)) {
+            let relative = file.strip_prefix(src_root).unwrap().to_string_lossy().replace('\\', "/");
+            if !excluded.iter().any(|e| relative == *e) {
+                cryptonote.file(file);
+            }
+        }
+    }
+    cryptonote.compile("cryptonote_vendored");
 
-    // Build fuego wallet shim
+    // Build fuego wallet shim against the real wallet backend
     cc::Build::new()
         .cpp(true)
         .std("c++14")
         .file("fuego_wallet_real.cpp")
         .include(".")
         .include(include_root)
+        .include(src_root)
+        .include(format!("{}/{}", src_root, platform_dir))
+        .define("FUEGO_WITH_CRYPTONOTE", None)
+        .define("STATICLIB", None)
         .compile("fuego_wallet_real");
     println!("cargo:rustc-link-lib=fuego_wallet_real");
+    println!("cargo:rustc-link-lib=cryptonote_vendored");
 
     // Build ffi layer
     cc::Build::new()
@@ -104,6 +151,9 @@ fn build_with_vendored_cryptonote() -> bool {
     println!("cargo:rerun-if-changed={}", src_root);
 
     // System libs
+    println!("cargo:rustc-link-lib=boost_system");
+    println!("cargo:rustc-link-lib=boost_filesystem");
+    println!("cargo:rustc-link-lib=boost_program_options");
     if cfg!(target_os = "macos") {
         println!("cargo:rustc-link-lib=c++");
     } else if cfg!(target_os = "linux") {
@@ -115,6 +165,27 @@ fn build_with_vendored_cryptonote() -> bool {
     true
 }
 
+/// Recursively collect C/C++ translation units under `dir`
+fn collect_sources(dir: &Path) -> Vec<std::path::PathBuf> {
+    let mut sources = Vec::new();
+    if let Ok(entries) = std::fs::read_dir(dir) {
+        for entry in entries.flatten() {
+            let path = entry.path();
+            if path.is_dir() {
+                // Platform-specific code is added explicitly by the caller
+                if path.file_name().map_or(false, |n| n == "Platform") {
+                    continue;
+                }
+                sources.extend(collect_sources(&path));
+            } else if path.extension().map_or(false, |ext| ext == "cpp" || ext == "c") {
+                sources.push(path);
+            }
+        }
+    }
+    sources.sort();
+    sources
+}
+
 fn build_mock_ffi() {
     // Fallback to mock implementation
     println!("cargo:rustc-link-lib=crypto_note_ffi");
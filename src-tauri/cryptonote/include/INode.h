@@ -53,6 +53,7 @@ struct OutsForAmount {
 struct TransactionShortInfo {
   Crypto::Hash txId;
   TransactionPrefix txPrefix;
+  std::vector<uint32_t> globalIndexes;  // empty when the node did not send them
 };
 
 struct BlockShortEntry {
@@ -60,6 +61,7 @@ struct BlockShortEntry {
   bool hasBlock;
   CryptoNote::Block block;
   std::vector<TransactionShortInfo> txsShortInfo;
+  std::vector<uint32_t> baseTransactionGlobalIndexes;  // empty when the node did not send them
 };
 
 class INode {
@@ -84,6 +86,29 @@ public:
   virtual void getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std::vector<CryptoNote::block_complete_entry>& newBlocks, uint32_t& startHeight, const Callback& callback) = 0;
   virtual void getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) = 0;
   virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) = 0;
+  // maxBlockCount and maxResponseSize are hints for the batch size (0 keeps the node default);
+  // nodes that cannot negotiate them answer the plain query
+  virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
+    std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) {
+    queryBlocks(std::move(knownBlockIds), timestamp, newBlocks, startHeight, callback);
+  }
+  // light wallet stream, see COMMAND_RPC_QUERY_COMPACT_OUTPUTS; nodes without it fail with function_not_supported
+  virtual void queryCompactOutputs(uint32_t startHeight, uint32_t blockCount, std::vector<Crypto::Hash>& blockHashes,
+    std::vector<CompactTransactionInfo>& transactions, const Callback& callback) {
+    callback(std::make_error_code(std::errc::function_not_supported));
+  }
+  // header-first sync, see COMMAND_RPC_GET_BLOCK_HEADERS; nodes without it fail with function_not_supported
+  virtual void getBlockHeaders(uint32_t startHeight, uint32_t blockCount, std::vector<BlockHeaderInfo>& headers, const Callback& callback) {
+    callback(std::make_error_code(std::errc::function_not_supported));
+  }
+  // first block a wallet created at timestamp has to scan and that block's timestamp, see
+  // COMMAND_RPC_GET_BLOCK_HEIGHT_BY_TIMESTAMP; nodes without it fail with function_not_supported
+  virtual void getBlockHeightByTimestamp(uint64_t timestamp, uint32_t& height, uint64_t& blockTimestamp, const Callback& callback) {
+    callback(std::make_error_code(std::errc::function_not_supported));
+  }
+  virtual void getBlockTimestamp(uint32_t height, uint64_t& timestamp, const Callback& callback) {
+    callback(std::make_error_code(std::errc::function_not_supported));
+  }
   virtual void getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual, std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds, const Callback& callback) = 0;
   virtual void getMultisignatureOutputByGlobalIndex(uint64_t amount, uint32_t gindex, MultisignatureOutput& out, const Callback& callback) = 0;
   virtual void getTransaction(const Crypto::Hash &transactionHash, CryptoNote::Transaction &transaction, const Callback &callback) = 0;
@@ -21,6 +21,10 @@
 
 #include "CryptoNote.h"
 
+namespace Common {
+class ThreadPool;
+}
+
 namespace CryptoNote {
 
 namespace TransactionTypes {
@@ -66,6 +70,8 @@ public:
   virtual bool getPaymentId(Crypto::Hash& paymentId) const = 0;
   virtual bool getExtraNonce(BinaryArray& nonce) const = 0;
   virtual BinaryArray getExtra() const = 0;
+  // one tag per output, as written by ITransactionWriter::appendViewTags
+  virtual bool getViewTags(std::vector<uint8_t>& viewTags) const = 0;
 
   // inputs
   virtual size_t getInputCount() const = 0;
@@ -92,6 +98,8 @@ public:
 
   // serialized transaction
   virtual BinaryArray getTransactionData() const = 0;
+  // size of getTransactionData() without building it
+  virtual size_t getTransactionDataSize() const = 0;
   virtual TransactionPrefix getTransactionPrefix() const = 0;
 };
 
@@ -103,6 +111,9 @@ public:
 
   virtual ~ITransactionWriter() { }
 
+  // starts over with a new transaction key, the containers keep their capacity
+  virtual void reset() = 0;
+
   // transaction parameters
   virtual void setUnlockTime(uint64_t unlockTime) = 0;
 
@@ -110,11 +121,15 @@ public:
   virtual void setPaymentId(const Crypto::Hash& paymentId) = 0;
   virtual void setExtraNonce(const BinaryArray& nonce) = 0;
   virtual void appendExtra(const BinaryArray& extraData) = 0;
+  // appends the view tags of the outputs added so far; call it after the last output
+  virtual void appendViewTags() = 0;
 
   // Inputs/Outputs 
   virtual size_t addInput(const KeyInput& input) = 0;
   virtual size_t addInput(const MultisignatureInput& input) = 0;
   virtual size_t addInput(const AccountKeys& senderKeys, const TransactionTypes::InputKeyInfo& info, KeyPair& ephKeys) = 0;
+  // for an output whose key image is already known, e.g. one from a transfers container
+  virtual size_t addInput(const AccountKeys& senderKeys, const TransactionTypes::InputKeyInfo& info, const Crypto::KeyImage& keyImage, KeyPair& ephKeys) = 0;
 
   virtual size_t addOutput(uint64_t amount, const AccountPublicAddress& to) = 0;
   virtual size_t addOutput(uint64_t amount, const std::vector<AccountPublicAddress>& to, uint32_t requiredSignatures, uint32_t term = 0) = 0;
@@ -126,6 +141,8 @@ public:
 
   // signing
   virtual void signInputKey(size_t input, const TransactionTypes::InputKeyInfo& info, const KeyPair& ephKeys) = 0;
+  // signs key inputs 0..infos.size()-1, one ring signature per worker task
+  virtual void signInputKeys(const std::vector<TransactionTypes::InputKeyInfo>& infos, const std::vector<KeyPair>& ephKeys, Common::ThreadPool& workers) = 0;
   virtual void signInputMultisignature(size_t input, const Crypto::PublicKey& sourceTransactionKey, size_t outputIndex, const AccountKeys& accountKeys) = 0;
   virtual void signInputMultisignature(size_t input, const KeyPair& ephemeralKeys) = 0;
 };
@@ -65,6 +65,9 @@ namespace CryptoNote
         uint32_t term;
       };
     };
+
+    // Type: Key; derived once when the output is found, so spending it doesn't repeat the derivation
+    Crypto::KeyImage keyImage;
   };
 
   struct TransactionSpentOutputInformation : public TransactionOutputInformation
@@ -196,6 +196,7 @@ public:
   virtual void exportWalletKeys(const std::string &path, bool encrypt = true, WalletSaveLevel saveLevel = WalletSaveLevel::SAVE_KEYS_ONLY, const std::string &extra = "") = 0;
 
   virtual void changePassword(const std::string &oldPassword, const std::string &newPassword) = 0;
+  // returns once the cache snapshot is taken; it is written out in the background, the next save and shutdown wait for that
   virtual void save(WalletSaveLevel saveLevel = WalletSaveLevel::SAVE_ALL, const std::string& extra = "") = 0;
 
   virtual size_t getAddressCount() const = 0;
@@ -212,6 +213,8 @@ public:
   virtual std::string createAddress(const Crypto::SecretKey &spendSecretKey) = 0;
   virtual std::string createAddress(const Crypto::PublicKey &spendPublicKey) = 0;
   virtual std::vector<std::string> createAddressList(const std::vector<Crypto::SecretKey> &spendSecretKeys, bool reset = true) = 0;
+  // count new addresses with fresh random keys, created in one batch
+  virtual std::vector<std::string> createAddresses(size_t count) = 0;
   virtual void deleteAddress(const std::string &address) = 0;
 
   virtual uint64_t getActualBalance() const = 0;
@@ -233,6 +236,13 @@ public:
 
   virtual std::vector<TransactionsInBlockInfo> getTransactions(const Crypto::Hash &blockHash, size_t count) const = 0;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(uint32_t blockIndex, size_t count) const = 0;
+  // Successful transactions in the range with a transfer to one of addresses (any address when empty) and, unless
+  // paymentId is null, that payment id. Only blocks holding such transactions are returned, and they are looked up
+  // in per address and per payment id indexes, so the cost follows the result rather than the range.
+  virtual std::vector<TransactionsInBlockInfo> getTransactions(const Crypto::Hash &blockHash, size_t count,
+    const std::vector<std::string> &addresses, const Crypto::Hash *paymentId) const = 0;
+  virtual std::vector<TransactionsInBlockInfo> getTransactions(uint32_t blockIndex, size_t count,
+    const std::vector<std::string> &addresses, const Crypto::Hash *paymentId) const = 0;
 
 
 
@@ -242,6 +252,11 @@ public:
   virtual std::vector<size_t> getDelayedTransactionIds() const = 0;
 
   virtual size_t transfer(const TransactionParameters &sendingTransaction, Crypto::SecretKey &transactionSK) = 0;
+  // Packs sendingTransaction.destinations, in order, into as few transactions as the size limit allows and
+  // relays them; fee and mixIn apply per transaction, messages go with the first one. Throws if no transaction
+  // could be built, otherwise stops at the first failure and returns the ids created so far. A transaction
+  // whose relay failed stays uncommitted for commitTransaction / rollbackUncommitedTransaction.
+  virtual std::vector<size_t> transferBatch(const TransactionParameters &sendingTransaction) = 0;
 
   virtual size_t makeTransaction(const TransactionParameters &sendingTransaction) = 0;
   virtual void commitTransaction(size_t transactionId) = 0;
@@ -252,6 +267,12 @@ public:
 
   //blocks until an event occurred
   virtual WalletEvent getEvent() = 0;
+  // blocks until an event occurred, then takes up to maxCount queued events (all of them for 0)
+  virtual std::vector<WalletEvent> getEvents(size_t maxCount) = 0;
+  // when enabled, successive SYNC_PROGRESS_UPDATED events are merged into the latest one, a BALANCE_UNLOCKED
+  // event is dropped while another is still queued, and so is a TRANSACTION_UPDATED event for a transaction
+  // that already has an event queued; the consumer reads the current state when it gets the queued event
+  virtual void setEventCoalescing(bool enabled) = 0;
 };
 
 } // namespace CryptoNote
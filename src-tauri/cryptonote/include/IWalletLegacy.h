@@ -150,6 +150,8 @@ public:
   virtual bool getTransfer(TransferId transferId, WalletLegacyTransfer& transfer) = 0;
   virtual bool getDeposit(DepositId depositId, Deposit& deposit) = 0;
   virtual std::vector<Payments> getTransactionsByPaymentIds(const std::vector<PaymentId>& paymentIds) const = 0;
+  // ids of the active transactions confirmed at minHeight..maxHeight, in ascending order
+  virtual std::vector<TransactionId> getTransactionsInHeightRange(uint32_t minHeight, uint32_t maxHeight) = 0;
   virtual bool getTxProof(Crypto::Hash& txid, CryptoNote::AccountPublicAddress& address, Crypto::SecretKey& tx_key, std::string& sig_str) = 0;
   virtual std::string getReserveProof(const uint64_t &reserve, const std::string &message) = 0;
   virtual Crypto::SecretKey getTxKey(Crypto::Hash& txid) = 0;
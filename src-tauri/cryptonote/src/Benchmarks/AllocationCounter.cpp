@@ -0,0 +1,130 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "Common/AllocationTracker.h"
+
+#ifdef FUEGO_ALLOCATION_TRACKING
+
+namespace Benchmarks {
+
+uint64_t allocationCount() {
+  uint64_t count;
+  uint64_t bytes;
+  Common::allocationTotals(count, bytes);
+  return count;
+}
+
+uint64_t allocatedBytes() {
+  uint64_t count;
+  uint64_t bytes;
+  Common::allocationTotals(count, bytes);
+  return bytes;
+}
+
+}
+
+#else
+
+namespace {
+
+std::atomic<uint64_t> allocations(0);
+std::atomic<uint64_t> bytes(0);
+
+void* allocate(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  bytes.fetch_add(size, std::memory_order_relaxed);
+
+  if (size == 0) {
+    size = 1;
+  }
+
+  for (;;) {
+    void* p = std::malloc(size);
+    if (p != nullptr) {
+      return p;
+    }
+
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+
+    handler();
+  }
+}
+
+void* allocate(std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return allocate(size);
+  } catch (std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+}
+
+namespace Benchmarks {
+
+uint64_t allocationCount() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t allocatedBytes() {
+  return bytes.load(std::memory_order_relaxed);
+}
+
+}
+
+void* operator new(std::size_t size) {
+  return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+  return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t& tag) noexcept {
+  return allocate(size, tag);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+  return allocate(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+#endif
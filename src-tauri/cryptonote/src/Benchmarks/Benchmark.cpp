@@ -0,0 +1,468 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <thread>
+
+#include <boost/program_options.hpp>
+
+#include "AllocationCounter.h"
+#include "Common/CommandLine.h"
+#include "Common/JsonValue.h"
+
+namespace po = boost::program_options;
+using Common::JsonValue;
+
+namespace Benchmarks {
+
+namespace {
+
+const command_line::arg_descriptor<std::string> arg_filter = {"filter", "Only run benchmarks whose name matches this regular expression", ".*"};
+const command_line::arg_descriptor<double> arg_min_time = {"min-time", "Minimum measured time per benchmark, in seconds", 0.5};
+const command_line::arg_descriptor<std::string> arg_out = {"out", "Write the results as JSON to this file", "", true};
+const command_line::arg_descriptor<bool> arg_json = {"json", "Print the results as JSON instead of a table", false};
+const command_line::arg_descriptor<std::string> arg_chain_segment = {"chain-segment", "Binary /getblocks.bin response (see the daemon's "
+  "export_blocks command) replayed by the scan, synchronizer and core replay benchmarks", "", true};
+
+const uint64_t MAX_ITERATIONS = 1000000000;
+
+Inputs benchmarkInputs;
+
+std::vector<Benchmark*>& registry() {
+  static std::vector<Benchmark*> benchmarks;
+  return benchmarks;
+}
+
+struct Result {
+  std::string name;
+  std::string benchmarkName;
+  std::vector<int64_t> args;
+  uint64_t iterations;
+  double realNanoseconds;
+  double cpuNanoseconds;
+  double itemsPerSecond;
+  double bytesPerSecond;
+  double allocationsPerIteration;
+  double allocatedBytesPerIteration;
+  std::string label;
+  std::map<std::string, double> counters;
+  std::string error;
+  std::string skipMessage;
+};
+
+std::string runName(const Benchmark& benchmark, const std::vector<int64_t>& args) {
+  std::string name = benchmark.name();
+  for (int64_t arg : args) {
+    name += "/" + std::to_string(arg);
+  }
+
+  return name;
+}
+
+// JsonValue writes strings as they are stored
+std::string jsonSafe(std::string text) {
+  std::replace(text.begin(), text.end(), '"', '\'');
+  std::replace(text.begin(), text.end(), '\\', '/');
+  return text;
+}
+
+Result run(const Benchmark& benchmark, const std::vector<int64_t>& args, double minTime) {
+  Result result;
+  result.name = runName(benchmark, args);
+  result.benchmarkName = benchmark.name();
+  result.args = args;
+
+  uint64_t iterations = benchmark.fixedIterations() != 0 ? benchmark.fixedIterations() : 1;
+  for (;;) {
+    State state(iterations, args);
+    try {
+      benchmark.function()(state);
+    } catch (std::exception& e) {
+      state.skipWithError(e.what());
+    }
+
+    bool done = !state.error().empty() || state.skipped() || benchmark.fixedIterations() != 0 || state.realSeconds() >= minTime || iterations >= MAX_ITERATIONS;
+    if (done) {
+      result.iterations = iterations;
+      result.realNanoseconds = state.realSeconds() * 1e9 / iterations;
+      result.cpuNanoseconds = state.cpuSeconds() * 1e9 / iterations;
+      result.itemsPerSecond = state.realSeconds() > 0 ? state.itemsProcessed() / state.realSeconds() : 0;
+      result.bytesPerSecond = state.realSeconds() > 0 ? state.bytesProcessed() / state.realSeconds() : 0;
+      result.allocationsPerIteration = static_cast<double>(state.allocations()) / iterations;
+      result.allocatedBytesPerIteration = static_cast<double>(state.allocatedBytes()) / iterations;
+      result.label = state.label();
+      result.counters = state.counters();
+      result.error = state.error();
+      result.skipMessage = state.skipMessage();
+      return result;
+    }
+
+    // aim a little past the minimum time, growing at most tenfold per round
+    double multiplier = state.realSeconds() > 0 ? minTime * 1.4 / state.realSeconds() : 10.0;
+    multiplier = std::min(10.0, multiplier);
+    uint64_t next = static_cast<uint64_t>(iterations * multiplier);
+    iterations = std::min(MAX_ITERATIONS, std::max(iterations + 1, next));
+  }
+}
+
+std::string formatTime(double nanoseconds) {
+  char buffer[32];
+  if (nanoseconds >= 1e9) {
+    snprintf(buffer, sizeof(buffer), "%.3f s", nanoseconds / 1e9);
+  } else if (nanoseconds >= 1e6) {
+    snprintf(buffer, sizeof(buffer), "%.3f ms", nanoseconds / 1e6);
+  } else if (nanoseconds >= 1e3) {
+    snprintf(buffer, sizeof(buffer), "%.3f us", nanoseconds / 1e3);
+  } else {
+    snprintf(buffer, sizeof(buffer), "%.1f ns", nanoseconds);
+  }
+
+  return buffer;
+}
+
+std::string formatRate(double perSecond, const char* unit) {
+  char buffer[48];
+  if (perSecond >= 1e9) {
+    snprintf(buffer, sizeof(buffer), "%.2fG %s/s", perSecond / 1e9, unit);
+  } else if (perSecond >= 1e6) {
+    snprintf(buffer, sizeof(buffer), "%.2fM %s/s", perSecond / 1e6, unit);
+  } else if (perSecond >= 1e3) {
+    snprintf(buffer, sizeof(buffer), "%.2fk %s/s", perSecond / 1e3, unit);
+  } else {
+    snprintf(buffer, sizeof(buffer), "%.2f %s/s", perSecond, unit);
+  }
+
+  return buffer;
+}
+
+void printRow(const Result& result) {
+  if (!result.error.empty()) {
+    printf("%-48s ERROR: %s\n", result.name.c_str(), result.error.c_str());
+    return;
+  }
+
+  if (!result.skipMessage.empty()) {
+    printf("%-48s SKIPPED: %s\n", result.name.c_str(), result.skipMessage.c_str());
+    return;
+  }
+
+  std::string extra;
+  if (result.bytesPerSecond > 0) {
+    extra += " " + formatRate(result.bytesPerSecond, "B");
+  }
+
+  if (result.itemsPerSecond > 0) {
+    extra += " " + formatRate(result.itemsPerSecond, "items");
+  }
+
+  if (result.allocationsPerIteration > 0) {
+    char allocations[48];
+    snprintf(allocations, sizeof(allocations), " %.1f allocs/iter", result.allocationsPerIteration);
+    extra += allocations;
+  }
+
+  for (const auto& counter : result.counters) {
+    char value[32];
+    snprintf(value, sizeof(value), "%g", counter.second);
+    extra += " " + counter.first + "=" + value;
+  }
+
+  if (!result.label.empty()) {
+    extra += " " + result.label;
+  }
+
+  printf("%-48s %14s %14s %12llu%s\n", result.name.c_str(), formatTime(result.realNanoseconds).c_str(),
+    formatTime(result.cpuNanoseconds).c_str(), static_cast<unsigned long long>(result.iterations), extra.c_str());
+  fflush(stdout);
+}
+
+// Same layout as Google Benchmark's JSON reporter, so existing trend tooling can read it
+JsonValue toJson(const std::vector<Result>& results, const std::string& executable) {
+  char date[32];
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  JsonValue context(JsonValue::OBJECT);
+  context.insert("date", std::string(date));
+  context.insert("executable", jsonSafe(executable));
+  context.insert("num_cpus", static_cast<JsonValue::Integer>(std::thread::hardware_concurrency()));
+#ifdef NDEBUG
+  context.insert("library_build_type", "release");
+#else
+  context.insert("library_build_type", "debug");
+#endif
+
+  JsonValue benchmarks(JsonValue::ARRAY);
+  for (const Result& result : results) {
+    JsonValue entry(JsonValue::OBJECT);
+    entry.insert("name", result.name);
+    entry.insert("run_name", result.name);
+    entry.insert("run_type", "iteration");
+    if (!result.error.empty()) {
+      entry.insert("error_occurred", JsonValue(true));
+      entry.insert("error_message", jsonSafe(result.error));
+    } else if (!result.skipMessage.empty()) {
+      entry.insert("skipped", JsonValue(true));
+      entry.insert("skip_message", jsonSafe(result.skipMessage));
+    } else {
+      entry.insert("iterations", static_cast<JsonValue::Integer>(result.iterations));
+      entry.insert("real_time", result.realNanoseconds);
+      entry.insert("cpu_time", result.cpuNanoseconds);
+      entry.insert("time_unit", "ns");
+      if (result.bytesPerSecond > 0) {
+        entry.insert("bytes_per_second", result.bytesPerSecond);
+      }
+
+      if (result.itemsPerSecond > 0) {
+        entry.insert("items_per_second", result.itemsPerSecond);
+      }
+
+      entry.insert("allocs_per_iter", result.allocationsPerIteration);
+      entry.insert("allocated_bytes_per_iter", result.allocatedBytesPerIteration);
+      // user counters sit next to the built-in fields, as Google Benchmark writes them
+      for (const auto& counter : result.counters) {
+        entry.insert(jsonSafe(counter.first), counter.second);
+      }
+
+      if (!result.label.empty()) {
+        entry.insert("label", jsonSafe(result.label));
+      }
+    }
+
+    benchmarks.pushBack(std::move(entry));
+  }
+
+  JsonValue report(JsonValue::OBJECT);
+  report.insert("context", std::move(context));
+  report.insert("benchmarks", std::move(benchmarks));
+  return report;
+}
+
+}
+
+State::State(uint64_t iterations, const std::vector<int64_t>& args) :
+  m_iterations(iterations),
+  m_remaining(iterations),
+  m_args(args),
+  m_started(false),
+  m_running(false),
+  m_cpuStart(0),
+  m_allocationsStart(0),
+  m_allocatedBytesStart(0),
+  m_realSeconds(0),
+  m_cpuSeconds(0),
+  m_allocations(0),
+  m_allocatedBytes(0),
+  m_itemsProcessed(0),
+  m_bytesProcessed(0) {
+}
+
+bool State::keepRunning() {
+  if (!m_started) {
+    m_started = true;
+    if (m_error.empty() && m_skipMessage.empty()) {
+      resumeTiming();
+    }
+  }
+
+  if (m_remaining > 0 && m_error.empty() && m_skipMessage.empty()) {
+    --m_remaining;
+    return true;
+  }
+
+  if (m_running) {
+    pauseTiming();
+  }
+
+  return false;
+}
+
+void State::pauseTiming() {
+  if (!m_running) {
+    return;
+  }
+
+  m_realSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_realStart).count();
+  m_cpuSeconds += static_cast<double>(std::clock() - m_cpuStart) / CLOCKS_PER_SEC;
+  m_allocations += allocationCount() - m_allocationsStart;
+  m_allocatedBytes += Benchmarks::allocatedBytes() - m_allocatedBytesStart;
+  m_running = false;
+}
+
+void State::resumeTiming() {
+  if (m_running) {
+    return;
+  }
+
+  m_allocationsStart = allocationCount();
+  m_allocatedBytesStart = Benchmarks::allocatedBytes();
+  m_realStart = std::chrono::steady_clock::now();
+  m_cpuStart = std::clock();
+  m_running = true;
+}
+
+void State::skipWithError(const std::string& error) {
+  m_error = error.empty() ? "failed" : error;
+  pauseTiming();
+}
+
+void State::skipWithMessage(const std::string& message) {
+  m_skipMessage = message.empty() ? "skipped" : message;
+  pauseTiming();
+}
+
+Benchmark::Benchmark(const std::string& name, Function function) : m_name(name), m_function(std::move(function)), m_fixedIterations(0) {
+}
+
+Benchmark* Benchmark::arg(int64_t value) {
+  m_argSets.push_back({ value });
+  return this;
+}
+
+Benchmark* Benchmark::range(int64_t first, int64_t last, int64_t multiplier) {
+  for (int64_t value = first; value < last; value *= multiplier) {
+    arg(value);
+  }
+
+  return arg(last);
+}
+
+Benchmark* Benchmark::iterations(uint64_t count) {
+  m_fixedIterations = count;
+  return this;
+}
+
+Benchmark* registerBenchmark(const std::string& name, Function function) {
+  registry().push_back(new Benchmark(name, std::move(function)));
+  return registry().back();
+}
+
+const std::vector<Benchmark*>& registeredBenchmarks() {
+  return registry();
+}
+
+const Inputs& inputs() {
+  return benchmarkInputs;
+}
+
+void setInputs(const Inputs& value) {
+  benchmarkInputs = value;
+}
+
+}
+
+using namespace Benchmarks;
+
+int main(int argc, char* argv[]) {
+  po::options_description desc_general("General options");
+  command_line::add_arg(desc_general, command_line::arg_help);
+  po::options_description desc_params("Benchmark options");
+  command_line::add_arg(desc_params, arg_filter);
+  command_line::add_arg(desc_params, arg_min_time);
+  command_line::add_arg(desc_params, arg_out);
+  command_line::add_arg(desc_params, arg_json);
+  command_line::add_arg(desc_params, arg_chain_segment);
+
+  po::options_description desc_all;
+  desc_all.add(desc_general).add(desc_params);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_all, [&]() {
+    po::store(command_line::parse_command_line(argc, argv, desc_general, true), vm);
+    if (command_line::get_arg(vm, command_line::arg_help)) {
+      std::cout << desc_all << std::endl;
+      return false;
+    }
+
+    po::store(command_line::parse_command_line(argc, argv, desc_params, false), vm);
+    po::notify(vm);
+    return true;
+  });
+
+  if (!r) {
+    return 1;
+  }
+
+  std::regex filter;
+  try {
+    filter = std::regex(command_line::get_arg(vm, arg_filter));
+  } catch (std::regex_error&) {
+    std::cerr << "Invalid filter: " << command_line::get_arg(vm, arg_filter) << std::endl;
+    return 1;
+  }
+
+  Inputs runInputs;
+  if (command_line::has_arg(vm, arg_chain_segment)) {
+    runInputs.chainSegment = command_line::get_arg(vm, arg_chain_segment);
+  }
+
+  setInputs(runInputs);
+
+  double minTime = command_line::get_arg(vm, arg_min_time);
+  bool json = command_line::get_arg(vm, arg_json);
+  if (!json) {
+    printf("%-48s %14s %14s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    printf("%s\n", std::string(91, '-').c_str());
+  }
+
+  std::vector<Result> results;
+  for (const Benchmark* benchmark : registeredBenchmarks()) {
+    std::vector<std::vector<int64_t>> argSets = benchmark->argSets();
+    if (argSets.empty()) {
+      argSets.push_back({});
+    }
+
+    for (const std::vector<int64_t>& args : argSets) {
+      if (!std::regex_search(runName(*benchmark, args), filter)) {
+        continue;
+      }
+
+      results.push_back(run(*benchmark, args, minTime));
+      if (!json) {
+        printRow(results.back());
+      }
+    }
+  }
+
+  std::string report = toJson(results, argv[0]).toString();
+  if (json) {
+    std::cout << report << std::endl;
+  }
+
+  if (command_line::has_arg(vm, arg_out)) {
+    std::ofstream out(command_line::get_arg(vm, arg_out));
+    out << report << std::endl;
+    if (!out) {
+      std::cerr << "Failed to write " << command_line::get_arg(vm, arg_out) << std::endl;
+      return 1;
+    }
+  }
+
+  for (const Result& result : results) {
+    if (!result.error.empty()) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
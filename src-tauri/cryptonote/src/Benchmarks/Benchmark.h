@@ -0,0 +1,141 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Benchmarks {
+
+// Loop state handed to a benchmark function, in the style of Google Benchmark:
+//
+//   void hashBlob(State& state) {
+//     BinaryArray blob(state.range());
+//     while (state.keepRunning()) {
+//       Crypto::cn_fast_hash(blob.data(), blob.size());
+//     }
+//     state.setBytesProcessed(state.iterations() * blob.size());
+//   }
+//   BENCHMARK(hashBlob)->arg(64)->arg(4096);
+//
+// Only the loop is timed; setup before it and between pauseTiming()/resumeTiming() is not.
+// Heap allocations are counted over the same timed stretches.
+class State {
+public:
+  State(uint64_t iterations, const std::vector<int64_t>& args);
+
+  bool keepRunning();
+
+  int64_t range(size_t index = 0) const { return m_args.at(index); }
+  uint64_t iterations() const { return m_iterations; }
+
+  void pauseTiming();
+  void resumeTiming();
+
+  void setItemsProcessed(uint64_t items) { m_itemsProcessed = items; }
+  void setBytesProcessed(uint64_t bytes) { m_bytesProcessed = bytes; }
+  void setLabel(const std::string& label) { m_label = label; }
+  // extra per-run figure reported next to the timings, e.g. a wait time
+  void setCounter(const std::string& name, double value) { m_counters[name] = value; }
+  // reports the benchmark as failed; the loop should be left right away
+  void skipWithError(const std::string& error);
+  // leaves the benchmark out without failing the run, e.g. when its input was not given
+  void skipWithMessage(const std::string& message);
+
+  double realSeconds() const { return m_realSeconds; }
+  double cpuSeconds() const { return m_cpuSeconds; }
+  uint64_t itemsProcessed() const { return m_itemsProcessed; }
+  uint64_t bytesProcessed() const { return m_bytesProcessed; }
+  uint64_t allocations() const { return m_allocations; }
+  uint64_t allocatedBytes() const { return m_allocatedBytes; }
+  const std::string& label() const { return m_label; }
+  const std::map<std::string, double>& counters() const { return m_counters; }
+  const std::string& error() const { return m_error; }
+  const std::string& skipMessage() const { return m_skipMessage; }
+  bool skipped() const { return !m_skipMessage.empty(); }
+
+private:
+  const uint64_t m_iterations;
+  uint64_t m_remaining;
+  const std::vector<int64_t>& m_args;
+  bool m_started;
+  bool m_running;
+  std::chrono::steady_clock::time_point m_realStart;
+  std::clock_t m_cpuStart;
+  uint64_t m_allocationsStart;
+  uint64_t m_allocatedBytesStart;
+  double m_realSeconds;
+  double m_cpuSeconds;
+  uint64_t m_allocations;
+  uint64_t m_allocatedBytes;
+  uint64_t m_itemsProcessed;
+  uint64_t m_bytesProcessed;
+  std::string m_label;
+  std::map<std::string, double> m_counters;
+  std::string m_error;
+  std::string m_skipMessage;
+};
+
+typedef std::function<void(State&)> Function;
+
+class Benchmark {
+public:
+  Benchmark(const std::string& name, Function function);
+
+  // adds a run with state.range(0) == value
+  Benchmark* arg(int64_t value);
+  // adds a run per power of multiplier in [first, last], plus last itself
+  Benchmark* range(int64_t first, int64_t last, int64_t multiplier = 8);
+  // fixes the iteration count instead of growing it to the minimum time, for slow benchmarks
+  Benchmark* iterations(uint64_t count);
+
+  const std::string& name() const { return m_name; }
+  const Function& function() const { return m_function; }
+  const std::vector<std::vector<int64_t>>& argSets() const { return m_argSets; }
+  uint64_t fixedIterations() const { return m_fixedIterations; }
+
+private:
+  std::string m_name;
+  Function m_function;
+  std::vector<std::vector<int64_t>> m_argSets;
+  uint64_t m_fixedIterations;
+};
+
+Benchmark* registerBenchmark(const std::string& name, Function function);
+const std::vector<Benchmark*>& registeredBenchmarks();
+
+// Files handed over on the command line to benchmarks that replay recorded data
+struct Inputs {
+  // binary /getblocks.bin response, as the daemon's export_blocks command writes
+  std::string chainSegment;
+};
+
+const Inputs& inputs();
+void setInputs(const Inputs& value);
+
+}
+
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+#define BENCHMARK(function) \
+  static ::Benchmarks::Benchmark* BENCHMARK_CONCAT(benchmark_, __LINE__) = ::Benchmarks::registerBenchmark(#function, function)
@@ -0,0 +1,223 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "BenchmarkData.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include "Common/StringTools.h"
+#include "crypto/crypto.h"
+#include "CryptoNoteConfig.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/TransactionExtra.h"
+#include "Rpc/CoreRpcServerCommandsDefinitions.h"
+#include "Serialization/SerializationTools.h"
+
+using namespace CryptoNote;
+
+namespace Benchmarks {
+
+namespace {
+
+void addOutputs(Transaction& tx, size_t outputCount, uint64_t amount, const AccountPublicAddress* recipient, bool viewTags) {
+  KeyPair txKey;
+  Crypto::generate_keys(txKey.publicKey, txKey.secretKey);
+  addTransactionPublicKeyToExtra(tx.extra, txKey.publicKey);
+
+  Crypto::KeyDerivation derivation;
+  if (recipient != nullptr) {
+    Crypto::generate_key_derivation(recipient->viewPublicKey, txKey.secretKey, derivation);
+  }
+
+  // tags of outputs to someone else look random to the scanning wallet
+  std::vector<uint8_t> tags;
+  for (size_t i = 0; i < outputCount; ++i) {
+    KeyOutput target;
+    if (recipient != nullptr) {
+      Crypto::derive_public_key(derivation, i, recipient->spendPublicKey, target.key);
+      tags.push_back(deriveViewTag(derivation, i));
+    } else {
+      target.key = Crypto::rand<Crypto::PublicKey>();
+      tags.push_back(Crypto::rand<uint8_t>());
+    }
+
+    TransactionOutput output;
+    output.amount = amount;
+    output.target = target;
+    tx.outputs.push_back(output);
+  }
+
+  if (viewTags) {
+    BinaryArray nonce;
+    setViewTagsToTransactionExtraNonce(nonce, tags);
+    addExtraNonceToTransactionExtra(tx.extra, nonce);
+  }
+}
+
+}
+
+Transaction makeTransaction(size_t inputCount, size_t outputCount, size_t ringSize, const AccountPublicAddress* recipient,
+  bool viewTags) {
+  const uint64_t inputAmount = 10000000;
+
+  Transaction tx;
+  tx.version = TRANSACTION_VERSION_1;
+  tx.unlockTime = 0;
+
+  for (size_t i = 0; i < inputCount; ++i) {
+    KeyInput input;
+    input.amount = inputAmount;
+    input.keyImage = Crypto::rand<Crypto::KeyImage>();
+    for (size_t j = 0; j < ringSize; ++j) {
+      input.outputIndexes.push_back(static_cast<uint32_t>(j == 0 ? i * ringSize + 1 : 1));
+    }
+
+    tx.inputs.push_back(input);
+    tx.signatures.push_back(std::vector<Crypto::Signature>(ringSize, Crypto::rand<Crypto::Signature>()));
+  }
+
+  // whatever the outputs leave of the inputs is fee
+  uint64_t outputAmount = outputCount == 0 ? 0 : (inputCount * inputAmount - parameters::MINIMUM_FEE) / outputCount;
+  addOutputs(tx, outputCount, outputAmount, recipient, viewTags);
+  return tx;
+}
+
+Transaction makeCoinbase(uint32_t height, const AccountPublicAddress* recipient) {
+  Transaction tx;
+  tx.version = TRANSACTION_VERSION_1;
+  tx.unlockTime = height + parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW;
+
+  BaseInput input;
+  input.blockIndex = height;
+  tx.inputs.push_back(input);
+
+  addOutputs(tx, 1, 10000000, recipient, false);
+  return tx;
+}
+
+Block makeBlock(uint32_t height, const Crypto::Hash& previous, const std::vector<Crypto::Hash>& transactionHashes) {
+  Block block;
+  block.majorVersion = BLOCK_MAJOR_VERSION_1;
+  block.minorVersion = BLOCK_MINOR_VERSION_0;
+  block.nonce = height;
+  block.timestamp = 1500000000 + static_cast<uint64_t>(height) * parameters::DIFFICULTY_TARGET;
+  block.previousBlockHash = previous;
+  block.baseTransaction = makeCoinbase(height);
+  block.transactionHashes = transactionHashes;
+  return block;
+}
+
+ChainSegment generateSegment(const AccountPublicAddress& wallet, uint32_t blockCount, size_t transactionsPerBlock,
+  size_t ownInterval, bool viewTags) {
+  ChainSegment segment;
+  segment.startHeight = 1;
+  segment.transactionCount = 0;
+  segment.recorded = false;
+
+  uint32_t globalIndex = 0;
+  auto nextIndexes = [&globalIndex](const Transaction& tx) {
+    std::vector<uint32_t> indexes;
+    for (size_t i = 0; i < tx.outputs.size(); ++i) {
+      indexes.push_back(globalIndex++);
+    }
+
+    return indexes;
+  };
+
+  Crypto::Hash previous = NULL_HASH;
+  for (uint32_t height = segment.startHeight; height < segment.startHeight + blockCount; ++height) {
+    SegmentBlock block;
+    std::vector<Crypto::Hash> hashes;
+    for (size_t i = 0; i < transactionsPerBlock; ++i) {
+      bool own = (segment.transactionCount + i) % ownInterval == 0;
+      block.transactions.push_back(makeTransaction(2, 2, 4, own ? &wallet : nullptr, viewTags));
+      hashes.push_back(getObjectHash(block.transactions.back()));
+    }
+
+    block.block = makeBlock(height, previous, hashes);
+    previous = get_block_hash(block.block);
+
+    block.globalIndexes.push_back(nextIndexes(block.block.baseTransaction));
+    for (const Transaction& tx : block.transactions) {
+      block.globalIndexes.push_back(nextIndexes(tx));
+    }
+
+    segment.transactionCount += block.transactions.size() + 1;
+    segment.blocks.push_back(std::move(block));
+  }
+
+  return segment;
+}
+
+ChainSegment loadSegment(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("can't open chain segment " + path);
+  }
+
+  std::string body((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  COMMAND_RPC_GET_BLOCKS_FAST::response response;
+  if (!loadFromBinaryKeyValue(response, body) || response.blocks.empty()) {
+    throw std::runtime_error("chain segment " + path + " isn't a /getblocks.bin response");
+  }
+
+  ChainSegment segment;
+  segment.startHeight = static_cast<uint32_t>(response.start_height);
+  segment.transactionCount = 0;
+  segment.recorded = true;
+  for (const block_complete_entry& entry : response.blocks) {
+    SegmentBlock block;
+    if (!fromBinaryArray(block.block, Common::asBinaryArray(entry.block))) {
+      throw std::runtime_error("chain segment " + path + " has an invalid block");
+    }
+
+    if (entry.txs.size() != block.block.transactionHashes.size()) {
+      throw std::runtime_error("chain segment " + path + " has a block with missing transactions");
+    }
+
+    for (const std::string& blob : entry.txs) {
+      Transaction tx;
+      if (!fromBinaryArray(tx, Common::asBinaryArray(blob))) {
+        throw std::runtime_error("chain segment " + path + " has an invalid transaction");
+      }
+
+      block.transactions.push_back(std::move(tx));
+    }
+
+    segment.transactionCount += block.transactions.size() + 1;
+    segment.blocks.push_back(std::move(block));
+  }
+
+  return segment;
+}
+
+TemporaryDirectory::TemporaryDirectory() :
+  m_path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("fuego-benchmark-%%%%-%%%%")).string()) {
+  boost::filesystem::create_directories(m_path);
+}
+
+TemporaryDirectory::~TemporaryDirectory() {
+  boost::system::error_code ignore;
+  boost::filesystem::remove_all(m_path, ignore);
+}
+
+}
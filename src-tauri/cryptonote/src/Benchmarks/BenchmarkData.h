@@ -0,0 +1,78 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CryptoNote.h"
+
+namespace Benchmarks {
+
+// Synthetic chain data for the benchmarks. Keys and key images are random, so transactions
+// parse and hash like real ones but do not verify.
+
+// inputCount key inputs with rings of ringSize, outputCount outputs paying random keys,
+// or recipient when it is given; with viewTags the outputs carry view tags in the extra
+CryptoNote::Transaction makeTransaction(size_t inputCount, size_t outputCount, size_t ringSize = 4,
+  const CryptoNote::AccountPublicAddress* recipient = nullptr, bool viewTags = false);
+
+CryptoNote::Transaction makeCoinbase(uint32_t height, const CryptoNote::AccountPublicAddress* recipient = nullptr);
+
+// version 1 block on top of previous with the given transactions
+CryptoNote::Block makeBlock(uint32_t height, const Crypto::Hash& previous, const std::vector<Crypto::Hash>& transactionHashes);
+
+struct SegmentBlock {
+  CryptoNote::Block block;
+  // in block order, without the coinbase
+  std::vector<CryptoNote::Transaction> transactions;
+  // coinbase first, then parallel to transactions; empty when the segment does not carry them
+  std::vector<std::vector<uint32_t>> globalIndexes;
+};
+
+// Consecutive main chain blocks starting at startHeight
+struct ChainSegment {
+  uint32_t startHeight;
+  std::vector<SegmentBlock> blocks;
+  // coinbases included
+  size_t transactionCount;
+  bool recorded;
+};
+
+// blockCount blocks from height 1 with transactionsPerBlock transactions each; every
+// ownInterval-th transaction pays wallet. Blocks are linked but carry no proof of work.
+ChainSegment generateSegment(const CryptoNote::AccountPublicAddress& wallet, uint32_t blockCount, size_t transactionsPerBlock,
+  size_t ownInterval, bool viewTags = false);
+
+// Segment saved as a binary /getblocks.bin response, such as the daemon's export_blocks writes
+ChainSegment loadSegment(const std::string& path);
+
+// Data directory for a throwaway core or store, removed again on destruction
+class TemporaryDirectory {
+public:
+  TemporaryDirectory();
+  ~TemporaryDirectory();
+
+  const std::string& path() const { return m_path; }
+
+private:
+  std::string m_path;
+};
+
+}
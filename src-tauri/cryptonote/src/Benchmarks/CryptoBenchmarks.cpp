@@ -0,0 +1,202 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "CryptoNoteConfig.h"
+#include "CryptoNoteCore/CryptoNoteBasicImpl.h"
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+
+using namespace Benchmarks;
+
+namespace {
+
+// size of a block hashing blob
+const size_t HASHING_BLOB_SIZE = 76;
+
+void slowHash(State& state, int light) {
+  Crypto::cn_context context;
+  std::vector<uint8_t> blob(HASHING_BLOB_SIZE, 0x5a);
+  Crypto::Hash hash;
+  int variant = static_cast<int>(state.range());
+
+  while (state.keepRunning()) {
+    Crypto::cn_slow_hash(context, blob.data(), blob.size(), hash, light, variant);
+    blob[39] ^= hash.data[0];
+  }
+
+  // items/s is H/s; MONERO_USE_SOFTWARE_AES=1 measures the soft AES path on the same CPU
+  state.setItemsProcessed(state.iterations());
+  state.setLabel(std::string("hashes, ") + Crypto::cn_slow_hash_implementation());
+}
+
+// state.range() is the variant, as chosen by get_block_longhash_variant
+void cnSlowHash(State& state) {
+  slowHash(state, 0);
+}
+BENCHMARK(cnSlowHash)->arg(0)->arg(1)->arg(2);
+
+void cnSlowHashLight(State& state) {
+  slowHash(state, 1);
+}
+BENCHMARK(cnSlowHashLight)->arg(2);
+
+// state.range() inputs hashed together by cn_slow_hash_multi
+void cnSlowHashMulti(State& state) {
+  Crypto::cn_context context;
+  size_t ways = static_cast<size_t>(state.range());
+  std::vector<uint8_t> blobs(HASHING_BLOB_SIZE * ways, 0x5a);
+  std::vector<Crypto::Hash> hashes(ways);
+
+  while (state.keepRunning()) {
+    Crypto::cn_slow_hash_multi(context, blobs.data(), HASHING_BLOB_SIZE, ways, hashes.data(), 0, 2);
+    blobs[39] ^= hashes[0].data[0];
+  }
+
+  state.setItemsProcessed(state.iterations() * ways);
+}
+BENCHMARK(cnSlowHashMulti)->arg(1)->arg(2)->arg(3);
+
+void generateKeyDerivation(State& state) {
+  Crypto::PublicKey txPublicKey;
+  Crypto::SecretKey txSecretKey;
+  Crypto::PublicKey viewPublicKey;
+  Crypto::SecretKey viewSecretKey;
+  Crypto::generate_keys(txPublicKey, txSecretKey);
+  Crypto::generate_keys(viewPublicKey, viewSecretKey);
+  Crypto::KeyDerivation derivation;
+
+  while (state.keepRunning()) {
+    Crypto::generate_key_derivation(txPublicKey, viewSecretKey, derivation);
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(generateKeyDerivation);
+
+// one fixed-base multiplication, as in address creation and every signature
+void secretKeyToPublicKey(State& state) {
+  Crypto::PublicKey publicKey;
+  Crypto::SecretKey secretKey;
+  Crypto::generate_keys(publicKey, secretKey);
+
+  Crypto::PublicKey result;
+  while (state.keepRunning()) {
+    Crypto::secret_key_to_public_key(secretKey, result);
+  }
+
+  if (result != publicKey) {
+    state.skipWithError("derived key doesn't match the generated one");
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(secretKeyToPublicKey);
+
+// the per-output check a wallet scan makes after deriving the transaction's key
+void underivePublicKey(State& state) {
+  Crypto::PublicKey txPublicKey;
+  Crypto::SecretKey txSecretKey;
+  Crypto::PublicKey spendPublicKey;
+  Crypto::SecretKey spendSecretKey;
+  Crypto::generate_keys(txPublicKey, txSecretKey);
+  Crypto::generate_keys(spendPublicKey, spendSecretKey);
+
+  Crypto::KeyDerivation derivation;
+  Crypto::generate_key_derivation(txPublicKey, spendSecretKey, derivation);
+  Crypto::PublicKey outputKey;
+  Crypto::derive_public_key(derivation, 0, spendPublicKey, outputKey);
+
+  Crypto::PublicKey result;
+  while (state.keepRunning()) {
+    Crypto::underive_public_key(derivation, 0, outputKey, result);
+  }
+
+  if (result != spendPublicKey) {
+    state.skipWithError("underived key doesn't match the spend key");
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(underivePublicKey);
+
+// state.range() is the ring size
+void checkRingSignature(State& state) {
+  size_t ringSize = static_cast<size_t>(state.range());
+  std::vector<Crypto::PublicKey> keys(ringSize);
+  std::vector<Crypto::SecretKey> secrets(ringSize);
+  std::vector<const Crypto::PublicKey*> ring(ringSize);
+  for (size_t i = 0; i < ringSize; ++i) {
+    Crypto::generate_keys(keys[i], secrets[i]);
+    ring[i] = &keys[i];
+  }
+
+  const size_t realIndex = ringSize / 2;
+  Crypto::KeyImage keyImage;
+  Crypto::generate_key_image(keys[realIndex], secrets[realIndex], keyImage);
+
+  Crypto::Hash prefixHash = Crypto::rand<Crypto::Hash>();
+  std::vector<Crypto::Signature> signatures(ringSize);
+  Crypto::generate_ring_signature(prefixHash, keyImage, ring.data(), ringSize, secrets[realIndex], realIndex, signatures.data());
+
+  bool valid = true;
+  while (state.keepRunning()) {
+    valid = Crypto::check_ring_signature(prefixHash, keyImage, ring.data(), ringSize, signatures.data()) && valid;
+  }
+
+  if (!valid) {
+    state.skipWithError("ring signature didn't verify");
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(checkRingSignature)->range(1, 16, 2);
+
+// state.range() distinct addresses parsed round robin: a few stay in the parsed address
+// cache, more than it holds miss every time
+void parseAccountAddress(State& state) {
+  size_t count = static_cast<size_t>(state.range());
+  std::vector<std::string> addresses(count);
+  for (auto& address : addresses) {
+    CryptoNote::AccountPublicAddress keys;
+    Crypto::SecretKey secretKey;
+    Crypto::generate_keys(keys.spendPublicKey, secretKey);
+    Crypto::generate_keys(keys.viewPublicKey, secretKey);
+    address = CryptoNote::getAccountAddressAsStr(CryptoNote::parameters::CRYPTONOTE_PUBLIC_ADDRESS_BASE58_PREFIX, keys);
+  }
+
+  bool valid = true;
+  size_t next = 0;
+  while (state.keepRunning()) {
+    uint64_t prefix;
+    CryptoNote::AccountPublicAddress keys;
+    valid = CryptoNote::parseAccountAddressString(prefix, keys, addresses[next]) && valid;
+    next = next + 1 == count ? 0 : next + 1;
+  }
+
+  if (!valid) {
+    state.skipWithError("address didn't parse");
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(parseAccountAddress)->arg(16)->arg(16384);
+
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <cstring>
+
+#include "Benchmark.h"
+#include "BenchmarkData.h"
+#include "CryptoNoteConfig.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/Currency.h"
+#include "crypto/crypto.h"
+#include "Logging/ConsoleLogger.h"
+
+using namespace Benchmarks;
+using namespace CryptoNote;
+
+namespace {
+
+// the amounts a block of state.range() deposit withdrawals is checked for: each transaction
+// spends four matured deposits, whose interest counts towards its inputs and the block's
+void depositBlockAmounts(State& state) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+
+  std::vector<Transaction> transactions(static_cast<size_t>(state.range()));
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    for (uint32_t j = 0; j < 4; ++j) {
+      MultisignatureInput input;
+      input.amount = 800000000000 + i * 1000000 + j;
+      input.signatureCount = 1;
+      input.outputIndex = static_cast<uint32_t>(i * 4 + j);
+      input.term = currency.depositMinTerm() * (1 + j);
+      transactions[i].inputs.push_back(input);
+    }
+
+    KeyOutput output;
+    output.key = Crypto::rand<Crypto::PublicKey>();
+    transactions[i].outputs.push_back({ 3200000000000 + i * 4000000, output });
+  }
+
+  uint32_t height = parameters::UPGRADE_HEIGHT_V8 + 1;
+  uint64_t interest = 0;
+  uint64_t fees = 0;
+  while (state.keepRunning()) {
+    interest = 0;
+    fees = 0;
+    for (const Transaction& tx : transactions) {
+      uint64_t fee = 0;
+      currency.getTransactionFee(tx, fee, height);
+      fees += fee;
+      interest += currency.calculateTotalTransactionInterest(tx, height);
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * transactions.size() * 4);
+  state.setLabel(std::to_string(interest) + " interest, " + std::to_string(fees) + " fees");
+}
+BENCHMARK(depositBlockAmounts)->arg(16)->arg(256);
+
+// the blob a miner hashes for each nonce of a 1024 transaction template: serialized again, tree
+// hash included, for state.range() 0; patched into a blob serialized once for 1
+void minerNonceBlob(State& state) {
+  std::vector<Crypto::Hash> transactionHashes(1024);
+  for (Crypto::Hash& hash : transactionHashes) {
+    hash = Crypto::rand<Crypto::Hash>();
+  }
+
+  Block block = makeBlock(1, Crypto::rand<Crypto::Hash>(), transactionHashes);
+  bool patch = state.range() != 0;
+  BinaryArray blob;
+  size_t nonceOffset = 0;
+  if (!get_block_longhash_blob(block, blob, nonceOffset)) {
+    state.skipWithError("couldn't serialize the template");
+    return;
+  }
+
+  uint32_t nonce = block.nonce;
+  while (state.keepRunning()) {
+    ++nonce;
+    if (patch) {
+      memcpy(blob.data() + nonceOffset, &nonce, sizeof(nonce));
+    } else {
+      block.nonce = nonce;
+      blob.clear();
+      get_block_longhash_blob(block, blob);
+    }
+  }
+
+  if (memcmp(blob.data() + nonceOffset, &nonce, sizeof(nonce)) != 0) {
+    state.skipWithError("the blob doesn't hold the last nonce");
+  }
+
+  state.setItemsProcessed(state.iterations());
+  state.setLabel(std::to_string(blob.size()) + " byte blob");
+}
+BENCHMARK(minerNonceBlob)->arg(0)->arg(1);
+
+}
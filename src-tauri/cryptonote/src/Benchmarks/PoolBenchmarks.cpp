@@ -0,0 +1,287 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include <boost/utility/value_init.hpp>
+
+#include "Benchmark.h"
+#include "BenchmarkData.h"
+#include "CryptoNoteConfig.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/ITimeProvider.h"
+#include "CryptoNoteCore/TransactionPool.h"
+#include "CryptoNoteCore/VerificationContext.h"
+#include "Logging/ConsoleLogger.h"
+
+using namespace Benchmarks;
+using namespace CryptoNote;
+
+namespace {
+
+// Accepts every transaction, so the benchmark measures the pool rather than the chain
+class AcceptingValidator : public ITransactionValidator {
+public:
+  virtual bool checkTransactionInputs(const Transaction& tx, BlockInfo& maxUsedBlock) override { return true; }
+  virtual bool checkTransactionInputs(const Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override { return true; }
+  virtual bool haveSpentKeyImages(const Transaction& tx) override { return false; }
+  virtual bool checkTransactionSize(size_t blobSize) override { return true; }
+};
+
+// Accepts every transaction after hashing for about as long as a small ring signature takes to verify
+class HashingValidator : public AcceptingValidator {
+public:
+  virtual bool checkTransactionInputs(const Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override {
+    Crypto::Hash hash = getObjectHash(tx);
+    for (int i = 0; i < 100; ++i) {
+      hash = Crypto::cn_fast_hash(&hash, sizeof(hash));
+    }
+
+    return hash != NULL_HASH;
+  }
+};
+
+// block template from a pool of state.range() transactions; every iteration builds on a new
+// top block, so neither the template cache nor the cached ready verdicts apply
+void fillBlockTemplate(State& state) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  AcceptingValidator validator;
+  RealTimeProvider timeProvider;
+  tx_memory_pool pool(currency, validator, timeProvider, logger);
+
+  uint32_t height = parameters::UPGRADE_HEIGHT_V8 + 1;
+  size_t poolSize = static_cast<size_t>(state.range());
+  for (size_t i = 0; i < poolSize; ++i) {
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    if (!pool.add_tx(makeTransaction(1 + i % 3, 2), tvc, false, height) || !tvc.m_added_to_pool) {
+      state.skipWithError("synthetic transaction was rejected by the pool");
+      return;
+    }
+  }
+
+  const size_t medianSize = 1000000;
+  Block block;
+  size_t totalSize = 0;
+  uint64_t fee = 0;
+  while (state.keepRunning()) {
+    block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+    pool.fill_block_template(block, medianSize, medianSize, 0, totalSize, fee, height);
+  }
+
+  state.setItemsProcessed(state.iterations() * poolSize);
+  state.setLabel(std::to_string(block.transactionHashes.size()) + " txs in template");
+}
+BENCHMARK(fillBlockTemplate)->arg(100)->arg(1000)->arg(5000);
+
+// pool of 2000 transactions whose input checks cost real work
+bool fillCostlyPool(State& state, tx_memory_pool& pool, uint32_t height) {
+  for (size_t i = 0; i < 2000; ++i) {
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    if (!pool.add_tx(makeTransaction(1 + i % 3, 2), tvc, false, height) || !tvc.m_added_to_pool) {
+      state.skipWithError("synthetic transaction was rejected by the pool");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// the pass the core runs over the pool when a block is added; it spreads over all cores
+void revalidatePool(State& state) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  HashingValidator validator;
+  RealTimeProvider timeProvider;
+  tx_memory_pool pool(currency, validator, timeProvider, logger);
+
+  uint32_t height = parameters::UPGRADE_HEIGHT_V8 + 1;
+  if (!fillCostlyPool(state, pool, height)) {
+    return;
+  }
+
+  while (state.keepRunning()) {
+    pool.on_blockchain_inc(height, Crypto::rand<Crypto::Hash>());
+  }
+
+  state.setItemsProcessed(state.iterations() * pool.get_transactions_count());
+}
+BENCHMARK(revalidatePool);
+
+// latency of the first block template on a new tip; with state.range() == 1 the pool has been
+// revalidated on that tip beforehand (untimed), as the core does when the block arrives
+void templateAfterTipChange(State& state) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  HashingValidator validator;
+  RealTimeProvider timeProvider;
+  tx_memory_pool pool(currency, validator, timeProvider, logger);
+
+  uint32_t height = parameters::UPGRADE_HEIGHT_V8 + 1;
+  if (!fillCostlyPool(state, pool, height)) {
+    return;
+  }
+
+  bool revalidate = state.range() != 0;
+  Block block;
+  size_t totalSize = 0;
+  uint64_t fee = 0;
+  while (state.keepRunning()) {
+    block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+    if (revalidate) {
+      state.pauseTiming();
+      pool.on_blockchain_inc(height, block.previousBlockHash);
+      state.resumeTiming();
+    }
+
+    pool.fill_block_template(block, 1000000, 1000000, 0, totalSize, fee, height);
+  }
+
+  state.setLabel(std::to_string(block.transactionHashes.size()) + " txs in template");
+}
+BENCHMARK(templateAfterTipChange)->arg(0)->arg(1);
+
+// admission to a pool held at the size of state.range() three-input transactions; the smaller
+// one-input newcomers pay more per byte, so they evict the old ones until none are left
+void addToFullPool(State& state) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  AcceptingValidator validator;
+  RealTimeProvider timeProvider;
+  tx_memory_pool pool(currency, validator, timeProvider, logger);
+
+  uint32_t height = parameters::UPGRADE_HEIGHT_V8 + 1;
+  size_t poolSize = static_cast<size_t>(state.range());
+  pool.setMaxSize(poolSize * toBinaryArray(makeTransaction(3, 2)).size());
+  for (size_t i = 0; i < poolSize; ++i) {
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    if (!pool.add_tx(makeTransaction(3, 2), tvc, false, height) || !tvc.m_added_to_pool) {
+      state.skipWithError("synthetic transaction was rejected by the pool");
+      return;
+    }
+  }
+
+  size_t added = 0;
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    Transaction tx = makeTransaction(1, 2);
+    state.resumeTiming();
+
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    pool.add_tx(tx, tvc, false, height);
+    added += tvc.m_added_to_pool ? 1 : 0;
+  }
+
+  uint64_t maxBytes = 0;
+  uint64_t minimumFeeRate = 0;
+  pool.getLimits(maxBytes, minimumFeeRate);
+  state.setItemsProcessed(state.iterations());
+  state.setLabel(std::to_string(added) + " admitted, " + std::to_string(pool.get_transactions_size()) + "/" +
+    std::to_string(maxBytes) + " bytes, floor " + std::to_string(minimumFeeRate) + " per kB");
+}
+BENCHMARK(addToFullPool)->arg(1000);
+
+// node restart with a pool of 2000 transactions: loading the state file and the first check on
+// the tip, which finds every verdict still valid when state.range() == 1 and the tip is unchanged
+void restartPool(State& state) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  HashingValidator validator;
+  RealTimeProvider timeProvider;
+  TemporaryDirectory directory;
+
+  uint32_t height = parameters::UPGRADE_HEIGHT_V8 + 1;
+  Crypto::Hash tip = Crypto::rand<Crypto::Hash>();
+  {
+    tx_memory_pool pool(currency, validator, timeProvider, logger);
+    pool.init(directory.path());
+    if (!fillCostlyPool(state, pool, height)) {
+      return;
+    }
+
+    pool.on_blockchain_inc(height, tip);
+    pool.deinit();
+  }
+
+  bool sameTip = state.range() != 0;
+  size_t loaded = 0;
+  while (state.keepRunning()) {
+    tx_memory_pool pool(currency, validator, timeProvider, logger);
+    pool.init(directory.path());
+    pool.on_blockchain_inc(height, sameTip ? tip : Crypto::rand<Crypto::Hash>());
+    loaded = pool.get_transactions_count();
+
+    state.pauseTiming();
+    pool.deinit();
+    state.resumeTiming();
+  }
+
+  state.setLabel(std::to_string(loaded) + " txs loaded");
+}
+BENCHMARK(restartPool)->arg(0)->arg(1);
+
+
+// a wallet polling a pool of 10000 transactions after a few arrived and a few were mined; the full
+// diff walks every known id against the pool, the change log (state.range() == 1) only the changes
+void pollPoolChanges(State& state) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  AcceptingValidator validator;
+  RealTimeProvider timeProvider;
+  tx_memory_pool pool(currency, validator, timeProvider, logger);
+
+  uint32_t height = parameters::UPGRADE_HEIGHT_V8 + 1;
+  std::vector<Crypto::Hash> known;
+  for (size_t i = 0; i < 10000; ++i) {
+    Transaction tx = makeTransaction(1 + i % 3, 2);
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    if (!pool.add_tx(tx, tvc, false, height) || !tvc.m_added_to_pool) {
+      state.skipWithError("synthetic transaction was rejected by the pool");
+      return;
+    }
+
+    known.push_back(getObjectHash(tx));
+  }
+
+  uint64_t knownVersion = pool.get_version();
+  for (size_t i = 0; i < 10; ++i) {
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    pool.add_tx(makeTransaction(1, 2), tvc, false, height);
+
+    Transaction tx;
+    size_t blobSize = 0;
+    uint64_t fee = 0;
+    pool.take_tx(known[i], tx, blobSize, fee);
+  }
+
+  bool useLog = state.range() != 0;
+  std::vector<Crypto::Hash> added;
+  std::vector<Crypto::Hash> deleted;
+  while (state.keepRunning()) {
+    added.clear();
+    deleted.clear();
+    if (useLog) {
+      pool.get_changes_since(pool.get_pool_id(), knownVersion, added, deleted);
+    } else {
+      pool.get_difference(known, added, deleted);
+    }
+  }
+
+  state.setLabel(std::to_string(added.size()) + " added, " + std::to_string(deleted.size()) + " deleted");
+}
+BENCHMARK(pollPoolChanges)->arg(0)->arg(1);
+
+}
@@ -0,0 +1,487 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <boost/filesystem.hpp>
+#include <boost/utility/value_init.hpp>
+
+#include "Benchmark.h"
+#include "BenchmarkData.h"
+#include "BenchmarkNode.h"
+#include "Common/Metrics.h"
+#include "Common/ThreadPool.h"
+#include "CryptoNoteConfig.h"
+#include "CryptoNoteCore/Core.h"
+#include "CryptoNoteCore/CoreConfig.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/MinerConfig.h"
+#include "CryptoNoteCore/VerificationContext.h"
+#include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
+#include "Logging/ConsoleLogger.h"
+#include "Transfers/BlockchainSynchronizer.h"
+#include "Transfers/TransfersConsumer.h"
+
+using namespace Benchmarks;
+using namespace CryptoNote;
+
+namespace {
+
+const uint32_t SEGMENT_BLOCKS = 500;
+const size_t SEGMENT_TRANSACTIONS_PER_BLOCK = 20;
+const size_t OWN_TRANSACTION_INTERVAL = 10;
+// blocks a reader thread of the core replay fetches per request, like a wallet catching up
+const uint32_t READER_BATCH = 20;
+
+const char NEEDS_SEGMENT[] = "needs --chain-segment with blocks from height 1";
+
+struct BlockBlobs {
+  BinaryArray block;
+  std::vector<BinaryArray> transactions;
+};
+
+std::vector<BlockBlobs> toBlobs(const ChainSegment& segment) {
+  std::vector<BlockBlobs> blobs;
+  for (const SegmentBlock& source : segment.blocks) {
+    BlockBlobs block;
+    block.block = toBinaryArray(source.block);
+    for (const Transaction& tx : source.transactions) {
+      block.transactions.push_back(toBinaryArray(tx));
+    }
+
+    blobs.push_back(std::move(block));
+  }
+
+  return blobs;
+}
+
+bool initCore(core& ccore, const std::string& dataDirectory) {
+  CoreConfig coreConfig;
+  coreConfig.configFolder = dataDirectory;
+  coreConfig.configFolderDefaulted = false;
+  MinerConfig minerConfig;
+  return ccore.init(coreConfig, minerConfig, true);
+}
+
+// Feeds the blocks the way the protocol handler does during sync: the transactions, then the block
+std::string replayBlocks(core& ccore, const std::vector<BlockBlobs>& blobs, uint32_t startHeight) {
+  for (size_t i = 0; i < blobs.size(); ++i) {
+    for (const BinaryArray& transaction : blobs[i].transactions) {
+      tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+      if (!ccore.handle_incoming_tx(transaction, tvc, true) || tvc.m_verification_failed) {
+        return "a transaction of block " + std::to_string(startHeight + i) + " was rejected";
+      }
+    }
+
+    block_verification_context bvc = boost::value_initialized<block_verification_context>();
+    ccore.handle_incoming_block_blob(blobs[i].block, bvc, false, false);
+    if (!bvc.m_added_to_main_chain) {
+      return "block " + std::to_string(startHeight + i) + " was not added to the main chain";
+    }
+  }
+
+  return std::string();
+}
+
+// Validation of a recorded segment through core::handle_incoming_block_blob, without checkpoints, into
+// an empty data directory per iteration. state.range(0) threads keep reading recent blocks meanwhile,
+// as RPC clients do, so the blockchain lock waits show the cost of contention.
+void coreReplay(State& state) {
+  const std::string& recorded = inputs().chainSegment;
+  if (recorded.empty()) {
+    state.skipWithMessage(NEEDS_SEGMENT);
+    return;
+  }
+
+  ChainSegment segment = loadSegment(recorded);
+  if (segment.startHeight != 1) {
+    state.skipWithError(NEEDS_SEGMENT);
+    return;
+  }
+
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  std::vector<BlockBlobs> blobs = toBlobs(segment);
+  size_t readerCount = static_cast<size_t>(state.range(0));
+
+  uint64_t blockLockWaitMicroseconds = 0;
+  uint64_t readLockWaitMicroseconds = 0;
+  uint64_t reads = 0;
+  // the transactions of every block go through the pool first, so the block should find its ring
+  // signatures already verified
+  Common::MetricCounter& signatureCacheHits = Common::Metrics::instance().counter("fuego_ring_signature_cache_hits_total",
+    "Ring signatures found verified at pool admission instead of being checked again");
+  uint64_t signatureCacheHitsBefore = signatureCacheHits.value();
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    TemporaryDirectory directory;
+    core ccore(currency, nullptr, logger, false, false);
+    if (!initCore(ccore, directory.path())) {
+      state.skipWithError("core failed to initialize");
+      break;
+    }
+
+    std::atomic<bool> done(false);
+    std::atomic<uint64_t> readCount(0);
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < readerCount; ++i) {
+      readers.emplace_back([&ccore, &done, &readCount] {
+        while (!done.load(std::memory_order_relaxed)) {
+          uint32_t height = ccore.get_current_blockchain_height();
+          std::list<Block> blocks;
+          ccore.get_blocks(height > READER_BATCH ? height - READER_BATCH : 0, READER_BATCH, blocks);
+          readCount.fetch_add(1, std::memory_order_relaxed);
+        }
+      });
+    }
+
+    state.resumeTiming();
+
+    std::string error = replayBlocks(ccore, blobs, segment.startHeight);
+
+    state.pauseTiming();
+    done = true;
+    for (std::thread& reader : readers) {
+      reader.join();
+    }
+
+    Common::RecursiveSharedMutex::WaitStats waits = ccore.blockchainLockWaitStats();
+    blockLockWaitMicroseconds += waits.exclusiveWaitMicroseconds;
+    readLockWaitMicroseconds += waits.sharedWaitMicroseconds;
+    reads += readCount;
+    ccore.deinit();
+    state.resumeTiming();
+
+    if (!error.empty()) {
+      state.skipWithError(error);
+      break;
+    }
+  }
+
+  uint64_t blocks = state.iterations() * blobs.size();
+  state.setItemsProcessed(blocks);
+  state.setCounter("block_lock_wait_us", blocks == 0 ? 0 : static_cast<double>(blockLockWaitMicroseconds) / blocks);
+  if (readerCount != 0) {
+    state.setCounter("read_lock_wait_us", reads == 0 ? 0 : static_cast<double>(readLockWaitMicroseconds) / reads);
+  }
+
+  state.setCounter("signature_cache_hits", blocks == 0 ? 0 : static_cast<double>(signatureCacheHits.value() - signatureCacheHitsBefore) / blocks);
+
+  state.setLabel("blocks");
+}
+BENCHMARK(coreReplay)->arg(0)->arg(2);
+
+// Blockchain::rebuildCache over a recorded segment: core start-up with the cache files removed
+void coreRebuildCache(State& state) {
+  const std::string& recorded = inputs().chainSegment;
+  if (recorded.empty()) {
+    state.skipWithMessage(NEEDS_SEGMENT);
+    return;
+  }
+
+  ChainSegment segment = loadSegment(recorded);
+  if (segment.startHeight != 1) {
+    state.skipWithError(NEEDS_SEGMENT);
+    return;
+  }
+
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  TemporaryDirectory directory;
+  {
+    core ccore(currency, nullptr, logger, false, false);
+    if (!initCore(ccore, directory.path())) {
+      state.skipWithError("core failed to initialize");
+      return;
+    }
+
+    std::string error = replayBlocks(ccore, toBlobs(segment), segment.startHeight);
+    ccore.deinit();
+    if (!error.empty()) {
+      state.skipWithError(error);
+      return;
+    }
+  }
+
+  boost::filesystem::path cache = boost::filesystem::path(directory.path()) / currency.blocksCacheFileName();
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    boost::system::error_code ignore;
+    boost::filesystem::remove(cache, ignore);
+    boost::filesystem::remove(cache.string() + ".journal", ignore);
+    core ccore(currency, nullptr, logger, false, false);
+    state.resumeTiming();
+
+    bool initialized = initCore(ccore, directory.path());
+
+    state.pauseTiming();
+    ccore.deinit();
+    state.resumeTiming();
+
+    if (!initialized) {
+      state.skipWithError("core failed to initialize");
+      break;
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * (segment.blocks.size() + 1));
+  state.setLabel("blocks");
+}
+BENCHMARK(coreRebuildCache);
+
+// Wallets catching up through core::queryBlocks (state.range(0) == 0) or queryBlocksLite with global
+// indexes, READER_BATCH blocks per request over a recorded segment. Every iteration asks for the
+// same range again, the way many wallets syncing the same recent blocks do.
+void coreQueryBlocks(State& state) {
+  const std::string& recorded = inputs().chainSegment;
+  if (recorded.empty()) {
+    state.skipWithMessage(NEEDS_SEGMENT);
+    return;
+  }
+
+  ChainSegment segment = loadSegment(recorded);
+  if (segment.startHeight != 1) {
+    state.skipWithError(NEEDS_SEGMENT);
+    return;
+  }
+
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  TemporaryDirectory directory;
+  core ccore(currency, nullptr, logger, false, false);
+  if (!initCore(ccore, directory.path())) {
+    state.skipWithError("core failed to initialize");
+    return;
+  }
+
+  std::string error = replayBlocks(ccore, toBlobs(segment), segment.startHeight);
+  if (!error.empty()) {
+    ccore.deinit();
+    state.skipWithError(error);
+    return;
+  }
+
+  bool lite = state.range(0) != 0;
+  uint32_t chainHeight = ccore.get_current_blockchain_height();
+  while (state.keepRunning()) {
+    for (uint32_t height = 0; height + 1 < chainHeight; height += READER_BATCH) {
+      std::vector<Crypto::Hash> knownBlockIds{ ccore.getBlockIdByHeight(height) };
+      if (height != 0) {
+        knownBlockIds.push_back(ccore.getBlockIdByHeight(0));
+      }
+
+      uint32_t startHeight;
+      uint32_t currentHeight;
+      uint32_t fullOffset;
+      bool queried;
+      if (lite) {
+        std::vector<BlockShortInfo> entries;
+        queried = ccore.queryBlocksLite(knownBlockIds, 0, READER_BATCH, 0, true, startHeight, currentHeight, fullOffset, entries);
+      } else {
+        std::vector<BlockFullInfo> entries;
+        queried = ccore.queryBlocks(knownBlockIds, 0, READER_BATCH, 0, startHeight, currentHeight, fullOffset, entries);
+      }
+
+      if (!queried) {
+        state.skipWithError("query failed");
+        break;
+      }
+    }
+  }
+
+  ccore.deinit();
+  state.setItemsProcessed(state.iterations() * (chainHeight - 1));
+  state.setLabel(lite ? "lite, blocks" : "full, blocks");
+}
+BENCHMARK(coreQueryBlocks)->arg(0)->arg(1);
+
+// Node answering queryBlocks from a chain segment on top of the genesis block
+class SegmentNode : public BenchmarkNode {
+public:
+  SegmentNode(const Crypto::Hash& genesisBlockHash, const ChainSegment& segment) : m_segment(segment) {
+    m_hashes.push_back(genesisBlockHash);
+    for (const SegmentBlock& block : segment.blocks) {
+      m_hashes.push_back(get_block_hash(block.block));
+    }
+
+    for (uint32_t height = 0; height < m_hashes.size(); ++height) {
+      m_heights.emplace(m_hashes[height], height);
+    }
+  }
+
+  virtual uint32_t getLastLocalBlockHeight() const override { return static_cast<uint32_t>(m_hashes.size() - 1); }
+  virtual uint32_t getLastKnownBlockHeight() const override { return static_cast<uint32_t>(m_hashes.size() - 1); }
+  virtual uint32_t getLocalBlockCount() const override { return static_cast<uint32_t>(m_hashes.size()); }
+  virtual uint32_t getKnownBlockCount() const override { return static_cast<uint32_t>(m_hashes.size()); }
+
+  virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks,
+    uint32_t& startHeight, const Callback& callback) override {
+    queryBlocks(std::move(knownBlockIds), timestamp, 0, 0, newBlocks, startHeight, callback);
+  }
+
+  virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
+    std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) override {
+    // answer from the highest known block, repeated as a short entry
+    auto known = m_heights.end();
+    for (const Crypto::Hash& id : knownBlockIds) {
+      known = m_heights.find(id);
+      if (known != m_heights.end()) {
+        break;
+      }
+    }
+
+    if (known == m_heights.end()) {
+      callback(std::make_error_code(std::errc::invalid_argument));
+      return;
+    }
+
+    uint32_t count = maxBlockCount == 0 ? static_cast<uint32_t>(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT) : maxBlockCount;
+    startHeight = known->second;
+    for (uint32_t height = startHeight; height < m_hashes.size() && height - startHeight < count; ++height) {
+      BlockShortEntry entry;
+      entry.blockHash = m_hashes[height];
+      entry.hasBlock = height > startHeight;
+      if (entry.hasBlock) {
+        const SegmentBlock& block = m_segment.blocks[height - 1];
+        entry.block = block.block;
+        if (!block.globalIndexes.empty()) {
+          entry.baseTransactionGlobalIndexes = block.globalIndexes[0];
+        }
+
+        for (size_t i = 0; i < block.transactions.size(); ++i) {
+          TransactionShortInfo info;
+          info.txId = block.block.transactionHashes[i];
+          info.txPrefix = block.transactions[i];
+          if (!block.globalIndexes.empty()) {
+            info.globalIndexes = block.globalIndexes[i + 1];
+          }
+
+          entry.txsShortInfo.push_back(std::move(info));
+        }
+      }
+
+      newBlocks.push_back(std::move(entry));
+    }
+
+    callback(std::error_code());
+  }
+
+  virtual void getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
+    std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds, const Callback& callback) override {
+    // empty pool
+    isBcActual = knownBlockId == m_hashes.back();
+    callback(std::error_code());
+  }
+
+private:
+  const ChainSegment& m_segment;
+  std::vector<Crypto::Hash> m_hashes;
+  std::unordered_map<Crypto::Hash, uint32_t> m_heights;
+};
+
+class CompletionObserver : public IBlockchainSynchronizerObserver {
+public:
+  virtual void synchronizationCompleted(std::error_code result) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_set) {
+      m_set = true;
+      m_result.set_value(result);
+    }
+  }
+
+  std::future<std::error_code> reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_result = std::promise<std::error_code>();
+    m_set = false;
+    return m_result.get_future();
+  }
+
+private:
+  std::mutex m_mutex;
+  std::promise<std::error_code> m_result;
+  bool m_set = false;
+};
+
+// Wallet sync of a chain segment through BlockchainSynchronizer: the recorded one given with
+// --chain-segment, or 500 generated blocks where every tenth transaction pays the wallet. Time
+// not spent on a CPU (waits on the synchronizer's locks and futures) is reported per block.
+void synchronizerReplay(State& state) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  Common::ThreadPool workerPool;
+
+  AccountSubscription subscription;
+  Crypto::generate_keys(subscription.keys.address.spendPublicKey, subscription.keys.spendSecretKey);
+  Crypto::generate_keys(subscription.keys.address.viewPublicKey, subscription.keys.viewSecretKey);
+  subscription.syncStart.timestamp = 0;
+  subscription.syncStart.height = 0;
+  subscription.transactionSpendableAge = 1;
+
+  const std::string& recorded = inputs().chainSegment;
+  ChainSegment segment = recorded.empty() ?
+    generateSegment(subscription.keys.address, SEGMENT_BLOCKS, SEGMENT_TRANSACTIONS_PER_BLOCK, OWN_TRANSACTION_INTERVAL) : loadSegment(recorded);
+  if (segment.startHeight != 1) {
+    state.skipWithError(NEEDS_SEGMENT);
+    return;
+  }
+
+  SegmentNode node(currency.genesisBlockHash(), segment);
+  CompletionObserver observer;
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    std::unique_ptr<TransfersConsumer> consumer(new TransfersConsumer(currency, node, logger, subscription.keys.viewSecretKey, workerPool));
+    consumer->addSubscription(subscription);
+    std::unique_ptr<BlockchainSynchronizer> synchronizer(new BlockchainSynchronizer(node, currency.genesisBlockHash()));
+    synchronizer->addConsumer(consumer.get());
+    synchronizer->addObserver(&observer);
+    std::future<std::error_code> completed = observer.reset();
+    state.resumeTiming();
+
+    synchronizer->start();
+    std::error_code result = completed.get();
+
+    state.pauseTiming();
+    synchronizer->stop();
+    synchronizer->removeObserver(&observer);
+    synchronizer.reset();
+    consumer.reset();
+    state.resumeTiming();
+
+    if (result) {
+      state.skipWithError("synchronization failed: " + result.message());
+      break;
+    }
+  }
+
+  uint64_t blocks = state.iterations() * segment.blocks.size();
+  state.setItemsProcessed(blocks);
+  double waitSeconds = std::max(0.0, state.realSeconds() - state.cpuSeconds());
+  state.setCounter("off_cpu_us", blocks == 0 ? 0 : waitSeconds * 1e6 / blocks);
+  state.setLabel(segment.recorded ? "recorded segment, blocks" : "generated segment, blocks");
+}
+BENCHMARK(synchronizerReplay);
+
+}
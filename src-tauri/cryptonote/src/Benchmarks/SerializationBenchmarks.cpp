@@ -0,0 +1,231 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "BenchmarkData.h"
+#include "Common/StringTools.h"
+#include "CryptoNoteCore/CryptoNoteSerialization.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "Rpc/CoreRpcServerCommandsDefinitions.h"
+#include "Serialization/SerializationTools.h"
+
+using namespace Benchmarks;
+using namespace CryptoNote;
+
+namespace {
+
+// state.range() is the number of inputs, each with a ring of 4
+void transactionToBinary(State& state) {
+  Transaction tx = makeTransaction(static_cast<size_t>(state.range()), 2);
+  BinaryArray blob;
+
+  while (state.keepRunning()) {
+    blob.clear();
+    toBinaryArray(tx, blob);
+  }
+
+  state.setBytesProcessed(state.iterations() * blob.size());
+}
+BENCHMARK(transactionToBinary)->range(1, 64);
+
+void transactionFromBinary(State& state) {
+  BinaryArray blob = toBinaryArray(makeTransaction(static_cast<size_t>(state.range()), 2));
+  Transaction tx;
+
+  while (state.keepRunning()) {
+    if (!fromBinaryArray(tx, blob)) {
+      state.skipWithError("transaction didn't parse");
+    }
+  }
+
+  state.setBytesProcessed(state.iterations() * blob.size());
+}
+BENCHMARK(transactionFromBinary)->range(1, 64);
+
+// state.range() is the number of transaction hashes in the block
+void blockToBinary(State& state) {
+  std::vector<Crypto::Hash> hashes(static_cast<size_t>(state.range()));
+  for (auto& hash : hashes) {
+    hash = Crypto::rand<Crypto::Hash>();
+  }
+
+  Block block = makeBlock(1, Crypto::rand<Crypto::Hash>(), hashes);
+  BinaryArray blob;
+
+  while (state.keepRunning()) {
+    blob.clear();
+    toBinaryArray(block, blob);
+  }
+
+  state.setBytesProcessed(state.iterations() * blob.size());
+}
+BENCHMARK(blockToBinary)->arg(0)->arg(16)->arg(256);
+
+void blockFromBinary(State& state) {
+  std::vector<Crypto::Hash> hashes(static_cast<size_t>(state.range()));
+  for (auto& hash : hashes) {
+    hash = Crypto::rand<Crypto::Hash>();
+  }
+
+  BinaryArray blob = toBinaryArray(makeBlock(1, Crypto::rand<Crypto::Hash>(), hashes));
+  Block block;
+
+  while (state.keepRunning()) {
+    if (!fromBinaryArray(block, blob)) {
+      state.skipWithError("block didn't parse");
+    }
+  }
+
+  state.setBytesProcessed(state.iterations() * blob.size());
+}
+BENCHMARK(blockFromBinary)->arg(0)->arg(16)->arg(256);
+
+// RPC response encodings, compared on a blocks list of state.range() entries: the JsonValue
+// tree, the direct JSON text writer and reader, and the binary key-value format of the .bin calls
+
+F_COMMAND_RPC_GET_BLOCKS_LIST::response makeBlocksList(size_t count) {
+  F_COMMAND_RPC_GET_BLOCKS_LIST::response res;
+  for (size_t i = 0; i < count; ++i) {
+    f_block_short_response block;
+    block.timestamp = 1500000000 + i * 480;
+    block.height = static_cast<uint32_t>(i);
+    block.difficulty = 1000000 + i;
+    block.hash = Common::podToHex(Crypto::rand<Crypto::Hash>());
+    block.tx_count = i % 7;
+    block.cumul_size = 400 + i % 4000;
+    res.blocks.push_back(block);
+  }
+
+  res.status = CORE_RPC_STATUS_OK;
+  return res;
+}
+
+void rpcWriteJsonValue(State& state) {
+  auto res = makeBlocksList(static_cast<size_t>(state.range()));
+  std::string json;
+
+  while (state.keepRunning()) {
+    json = storeToJsonValue(res).toString();
+  }
+
+  state.setBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(rpcWriteJsonValue)->arg(30)->arg(1000);
+
+void rpcWriteJsonText(State& state) {
+  auto res = makeBlocksList(static_cast<size_t>(state.range()));
+  std::string json;
+
+  while (state.keepRunning()) {
+    json = storeToJson(res);
+  }
+
+  state.setBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(rpcWriteJsonText)->arg(30)->arg(1000);
+
+void rpcWriteBinary(State& state) {
+  auto res = makeBlocksList(static_cast<size_t>(state.range()));
+  std::string blob;
+
+  while (state.keepRunning()) {
+    blob = storeToBinaryKeyValue(res);
+  }
+
+  state.setBytesProcessed(state.iterations() * blob.size());
+}
+BENCHMARK(rpcWriteBinary)->arg(30)->arg(1000);
+
+void rpcReadJsonValue(State& state) {
+  std::string json = storeToJson(makeBlocksList(static_cast<size_t>(state.range())));
+
+  while (state.keepRunning()) {
+    F_COMMAND_RPC_GET_BLOCKS_LIST::response res;
+    loadFromJsonValue(res, Common::JsonValue::fromString(json));
+  }
+
+  state.setBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(rpcReadJsonValue)->arg(30)->arg(1000);
+
+void rpcReadJsonText(State& state) {
+  std::string json = storeToJson(makeBlocksList(static_cast<size_t>(state.range())));
+
+  while (state.keepRunning()) {
+    F_COMMAND_RPC_GET_BLOCKS_LIST::response res;
+    if (!loadFromJson(res, json)) {
+      state.skipWithError("response didn't parse");
+    }
+  }
+
+  state.setBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(rpcReadJsonText)->arg(30)->arg(1000);
+
+void rpcReadBinary(State& state) {
+  std::string blob = storeToBinaryKeyValue(makeBlocksList(static_cast<size_t>(state.range())));
+
+  while (state.keepRunning()) {
+    F_COMMAND_RPC_GET_BLOCKS_LIST::response res;
+    if (!loadFromBinaryKeyValue(res, blob)) {
+      state.skipWithError("response didn't parse");
+    }
+  }
+
+  state.setBytesProcessed(state.iterations() * blob.size());
+}
+BENCHMARK(rpcReadBinary)->arg(30)->arg(1000);
+
+// hex codec on a blob of state.range() bytes, the transaction blob size of on_get_transactions
+
+void hexEncode(State& state) {
+  BinaryArray blob(static_cast<size_t>(state.range()));
+  for (uint8_t& byte : blob) {
+    byte = Crypto::rand<uint8_t>();
+  }
+
+  std::string hex;
+  while (state.keepRunning()) {
+    hex.clear();
+    Common::toHex(blob, hex);
+  }
+
+  state.setBytesProcessed(state.iterations() * blob.size());
+}
+BENCHMARK(hexEncode)->arg(32)->arg(4096)->arg(1 << 20);
+
+void hexDecode(State& state) {
+  BinaryArray blob(static_cast<size_t>(state.range()));
+  for (uint8_t& byte : blob) {
+    byte = Crypto::rand<uint8_t>();
+  }
+
+  std::string hex = Common::toHex(blob);
+  while (state.keepRunning()) {
+    if (!Common::fromHex(hex.data(), hex.size(), blob.data())) {
+      state.skipWithError("hex didn't parse");
+    }
+  }
+
+  state.setBytesProcessed(state.iterations() * blob.size());
+}
+BENCHMARK(hexDecode)->arg(32)->arg(4096)->arg(1 << 20);
+
+}
@@ -0,0 +1,140 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "BenchmarkData.h"
+#include "Common/Compression.h"
+#include "CryptoNoteCore/CryptoNoteSerialization.h"
+#include "CryptoNoteCore/SwappedVector.h"
+#include "crypto/crypto.h"
+
+using namespace Benchmarks;
+using namespace CryptoNote;
+
+namespace {
+
+const uint32_t SEGMENT_BLOCKS = 500;
+const size_t SEGMENT_TRANSACTIONS_PER_BLOCK = 20;
+const size_t OWN_TRANSACTION_INTERVAL = 10;
+
+// Same contents as a Blockchain::BlockEntry without the per-block bookkeeping
+struct StoredBlock {
+  Block block;
+  std::vector<Transaction> transactions;
+};
+
+void serialize(StoredBlock& block, ISerializer& serializer) {
+  serializer(block.block, "block");
+  serializer(block.transactions, "transactions");
+}
+
+// The blocks of the recorded segment given with --chain-segment, or of 500 generated blocks of 20
+// transactions, in a store that caches a single block, so every read goes to the file. Plain
+// with chunkBlocks == 0, else compressed in chunks of chunkBlocks.
+class BlockStore {
+public:
+  explicit BlockStore(uint32_t chunkBlocks) {
+    if (!m_blocks.open(m_directory.path() + "/blocks", m_directory.path() + "/blockindexes", 1, chunkBlocks)) {
+      throw std::runtime_error("block store didn't open");
+    }
+
+    const std::string& recorded = inputs().chainSegment;
+    AccountPublicAddress wallet;
+    Crypto::SecretKey secretKey;
+    Crypto::generate_keys(wallet.spendPublicKey, secretKey);
+    Crypto::generate_keys(wallet.viewPublicKey, secretKey);
+    ChainSegment segment = recorded.empty() ?
+      generateSegment(wallet, SEGMENT_BLOCKS, SEGMENT_TRANSACTIONS_PER_BLOCK, OWN_TRANSACTION_INTERVAL) : loadSegment(recorded);
+    for (SegmentBlock& source : segment.blocks) {
+      StoredBlock block;
+      block.block = std::move(source.block);
+      block.transactions = std::move(source.transactions);
+      m_blocks.push_back(block);
+    }
+  }
+
+  SwappedVector<StoredBlock>& blocks() { return m_blocks; }
+
+  // file size relative to the serialized blocks
+  double fileRatio() {
+    uint64_t blockBytes;
+    uint64_t fileBytes;
+    m_blocks.storageUsage(blockBytes, fileBytes);
+    return static_cast<double>(fileBytes) / blockBytes;
+  }
+
+private:
+  TemporaryDirectory m_directory;
+  SwappedVector<StoredBlock> m_blocks;
+};
+
+bool skipWithoutCompression(State& state) {
+  if (state.range() != 0 && !Common::compressionSupported()) {
+    state.skipWithMessage("needs a build with FUEGO_BLOCK_COMPRESSION");
+    return true;
+  }
+
+  return false;
+}
+
+// Reads every block in order, like a cache rebuild or a syncing peer
+void blockStoreScan(State& state) {
+  if (skipWithoutCompression(state)) {
+    return;
+  }
+
+  BlockStore store(static_cast<uint32_t>(state.range()));
+  SwappedVector<StoredBlock>& blocks = store.blocks();
+
+  while (state.keepRunning()) {
+    for (uint64_t i = 0; i < blocks.size(); ++i) {
+      blocks[i];
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * blocks.size());
+  state.setCounter("file_ratio", store.fileRatio());
+}
+BENCHMARK(blockStoreScan)->arg(0)->arg(16)->arg(64);
+
+// Reads the blocks in a scattered order, like lookups of transactions by hash
+void blockStoreRandomRead(State& state) {
+  if (skipWithoutCompression(state)) {
+    return;
+  }
+
+  BlockStore store(static_cast<uint32_t>(state.range()));
+  SwappedVector<StoredBlock>& blocks = store.blocks();
+  // a prime stride visits every block once per pass unless it divides the block count
+  const uint64_t stride = blocks.size() % 7919 == 0 ? 1 : 7919;
+
+  while (state.keepRunning()) {
+    for (uint64_t i = 0; i < blocks.size(); ++i) {
+      blocks[i * stride % blocks.size()];
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * blocks.size());
+  state.setCounter("file_ratio", store.fileRatio());
+}
+BENCHMARK(blockStoreRandomRead)->arg(0)->arg(16)->arg(64);
+
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Benchmark.h"
+#include "System/ContextGroup.h"
+#include "System/Dispatcher.h"
+#include "System/InterruptedException.h"
+#include "System/Timer.h"
+
+using namespace Benchmarks;
+
+namespace {
+
+// spawns and finishes state.range() contexts per iteration; after the first iteration every
+// context and its stack come from the dispatcher's reusable pool
+void dispatcherSpawn(State& state) {
+  System::Dispatcher dispatcher;
+  size_t contexts = static_cast<size_t>(state.range());
+  size_t finished = 0;
+  while (state.keepRunning()) {
+    System::ContextGroup group(dispatcher);
+    for (size_t i = 0; i < contexts; ++i) {
+      group.spawn([&finished] { ++finished; });
+    }
+
+    group.wait();
+  }
+
+  state.setItemsProcessed(finished);
+}
+BENCHMARK(dispatcherSpawn)->arg(1)->arg(100);
+
+// two contexts yielding to each other; every item is one context switch
+void dispatcherYield(State& state) {
+  System::Dispatcher dispatcher;
+  const size_t switches = 10000;
+  while (state.keepRunning()) {
+    System::ContextGroup group(dispatcher);
+    for (int i = 0; i < 2; ++i) {
+      group.spawn([&dispatcher, switches] {
+        for (size_t j = 0; j < switches / 2; ++j) {
+          dispatcher.yield();
+        }
+      });
+    }
+
+    group.wait();
+  }
+
+  state.setItemsProcessed(state.iterations() * switches);
+}
+BENCHMARK(dispatcherYield);
+
+// state.range() contexts arm a long timer and are interrupted before it fires, the pattern of
+// ContextGroupTimeout around every request that completes in time
+void timerArmCancel(State& state) {
+  System::Dispatcher dispatcher;
+  size_t timers = static_cast<size_t>(state.range());
+  while (state.keepRunning()) {
+    System::ContextGroup group(dispatcher);
+    for (size_t i = 0; i < timers; ++i) {
+      group.spawn([&dispatcher, i] {
+        try {
+          System::Timer(dispatcher).sleep(std::chrono::seconds(10 + i));
+        } catch (System::InterruptedException&) {
+        }
+      });
+    }
+
+    dispatcher.yield();
+    group.interrupt();
+    group.wait();
+  }
+
+  state.setItemsProcessed(state.iterations() * timers);
+}
+BENCHMARK(timerArmCancel)->arg(1)->arg(1000);
+
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include <memory>
+
+#include "Benchmark.h"
+#include "BenchmarkData.h"
+#include "BenchmarkNode.h"
+#include "Common/ThreadPool.h"
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/TransactionApi.h"
+#include "Logging/ConsoleLogger.h"
+#include "Transfers/CommonTypes.h"
+#include "Transfers/TransfersConsumer.h"
+
+using namespace Benchmarks;
+using namespace CryptoNote;
+
+namespace {
+
+const uint32_t SEGMENT_BLOCKS = 100;
+const size_t SEGMENT_TRANSACTIONS_PER_BLOCK = 20;
+// one transaction in this many pays the scanning wallet
+const size_t OWN_TRANSACTION_INTERVAL = 10;
+
+std::vector<CompleteBlock> toCompleteBlocks(const ChainSegment& segment) {
+  std::vector<CompleteBlock> blocks;
+  for (const SegmentBlock& source : segment.blocks) {
+    CompleteBlock block;
+    block.blockHash = get_block_hash(source.block);
+    block.block = source.block;
+    block.transactions.push_back(createTransactionPrefix(source.block.baseTransaction));
+    for (const Transaction& tx : source.transactions) {
+      block.transactions.push_back(createTransactionPrefix(tx));
+    }
+
+    block.globalIndexes = source.globalIndexes;
+    blocks.push_back(std::move(block));
+  }
+
+  return blocks;
+}
+
+// Wallet scan of a chain segment: the recorded one given with --chain-segment, or 100 generated
+// blocks of 20 transactions where every tenth transaction pays the wallet; the generated outputs
+// carry view tags when state.range() == 1
+void transfersConsumerOnNewBlocks(State& state) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  BenchmarkNode node;
+  Common::ThreadPool workerPool;
+
+  AccountSubscription subscription;
+  Crypto::generate_keys(subscription.keys.address.spendPublicKey, subscription.keys.spendSecretKey);
+  Crypto::generate_keys(subscription.keys.address.viewPublicKey, subscription.keys.viewSecretKey);
+  subscription.syncStart.timestamp = 0;
+  subscription.syncStart.height = 0;
+  subscription.transactionSpendableAge = 1;
+
+  const std::string& recorded = inputs().chainSegment;
+  ChainSegment segment = recorded.empty() ?
+    generateSegment(subscription.keys.address, SEGMENT_BLOCKS, SEGMENT_TRANSACTIONS_PER_BLOCK, OWN_TRANSACTION_INTERVAL,
+      state.range() != 0) : loadSegment(recorded);
+  std::vector<CompleteBlock> blocks = toCompleteBlocks(segment);
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    std::unique_ptr<TransfersConsumer> consumer(new TransfersConsumer(currency, node, logger, subscription.keys.viewSecretKey, workerPool));
+    consumer->addSubscription(subscription);
+    state.resumeTiming();
+
+    if (!consumer->onNewBlocks(blocks.data(), segment.startHeight, static_cast<uint32_t>(blocks.size()))) {
+      state.skipWithError("consumer rejected the segment");
+    }
+
+    state.pauseTiming();
+    consumer.reset();
+    state.resumeTiming();
+  }
+
+  state.setItemsProcessed(state.iterations() * segment.transactionCount);
+  state.setLabel(recorded.empty() ? "generated segment" : "recorded segment");
+}
+BENCHMARK(transfersConsumerOnNewBlocks)->arg(0)->arg(1);
+
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include <boost/filesystem.hpp>
+
+#include "Benchmark.h"
+#include "BenchmarkNode.h"
+#include "CryptoNoteCore/Currency.h"
+#include "Logging/ConsoleLogger.h"
+#include "System/Dispatcher.h"
+#include "Wallet/WalletGreen.h"
+
+using namespace Benchmarks;
+using namespace CryptoNote;
+
+namespace {
+
+const char WALLET_PASSWORD[] = "benchmark";
+
+// Wallet container with addressCount addresses in a temporary file, removed again on destruction
+class TemporaryWallet {
+public:
+  TemporaryWallet(System::Dispatcher& dispatcher, const Currency& currency, INode& node, Logging::ILogger& logger, size_t addressCount) :
+    m_path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("fuego-benchmark-%%%%-%%%%.wallet")).string()),
+    m_wallet(dispatcher, currency, node, logger) {
+    m_wallet.initialize(m_path, WALLET_PASSWORD);
+    for (size_t i = 1; i < addressCount; ++i) {
+      m_wallet.createAddress();
+    }
+
+    m_wallet.save();
+  }
+
+  ~TemporaryWallet() {
+    try {
+      m_wallet.shutdown();
+    } catch (std::exception&) {
+      // already shut down by a failed load
+    }
+
+    boost::system::error_code ignore;
+    boost::filesystem::remove(m_path, ignore);
+  }
+
+  WalletGreen& wallet() { return m_wallet; }
+  const std::string& path() const { return m_path; }
+
+private:
+  std::string m_path;
+  WalletGreen m_wallet;
+};
+
+void walletSave(State& state) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  System::Dispatcher dispatcher;
+  BenchmarkNode node;
+  TemporaryWallet container(dispatcher, currency, node, logger, static_cast<size_t>(state.range()));
+
+  while (state.keepRunning()) {
+    container.wallet().save();
+  }
+
+  state.setBytesProcessed(state.iterations() * boost::filesystem::file_size(container.path()));
+}
+BENCHMARK(walletSave)->arg(1)->arg(100)->iterations(20);
+
+void walletLoad(State& state) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  Currency currency = CurrencyBuilder(logger).currency();
+  System::Dispatcher dispatcher;
+  BenchmarkNode node;
+  TemporaryWallet container(dispatcher, currency, node, logger, static_cast<size_t>(state.range()));
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    container.wallet().shutdown();
+    state.resumeTiming();
+
+    container.wallet().load(container.path(), WALLET_PASSWORD);
+  }
+
+  state.setBytesProcessed(state.iterations() * boost::filesystem::file_size(container.path()));
+}
+BENCHMARK(walletLoad)->arg(1)->arg(100)->iterations(20);
+
+}
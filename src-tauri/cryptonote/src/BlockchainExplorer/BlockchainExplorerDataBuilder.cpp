@@ -20,6 +20,8 @@
 #include <boost/range/combine.hpp>
 
 #include "Common/StringTools.h"
+#include "CryptoNoteCore/BlockchainIndices.h"
+#include "CryptoNoteCore/CachedBlock.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/CryptoNoteTools.h"
 #include "CryptoNoteCore/Currency.h"
@@ -48,13 +50,13 @@ bool BlockchainExplorerDataBuilder::getMixin(const Transaction& transaction, uin
 }
 
 bool BlockchainExplorerDataBuilder::getPaymentId(const Transaction& transaction, Crypto::Hash& paymentId) {
-  std::vector<TransactionExtraField> txExtraFields;
-  parseTransactionExtra(transaction.extra, txExtraFields);
-  TransactionExtraNonce extraNonce;
-  if (!findTransactionExtraFieldByType(txExtraFields, extraNonce)) {
-    return false;
-  }
-  return getPaymentIdFromTransactionExtraNonce(extraNonce.nonce, paymentId);
+  return TransactionExtraIndex(transaction.extra).getPaymentId(transaction.extra, paymentId);
+}
+
+uint64_t BlockchainExplorerDataBuilder::getFee(const Currency& currency, const Transaction& transaction, uint32_t height) {
+  uint64_t inputsAmount = 0;
+  get_inputs_money_amount(transaction, inputsAmount);
+  return inputsAmount < get_outs_money_amount(transaction) ? CryptoNote::parameters::MINIMUM_FEE : currency.getTransactionFee(transaction, height);
 }
 
 bool BlockchainExplorerDataBuilder::fillTxExtra(const std::vector<uint8_t>& rawExtra, TransactionExtraDetails& extraDetails) {
@@ -91,7 +93,8 @@ size_t BlockchainExplorerDataBuilder::median(std::vector<size_t>& v) {
 }
 
 bool BlockchainExplorerDataBuilder::fillBlockDetails(const Block &block, BlockDetails& blockDetails) {
-  Crypto::Hash hash = get_block_hash(block);
+  CachedBlock cachedBlock(block);
+  Crypto::Hash hash = cachedBlock.getBlockHash();
 
   blockDetails.majorVersion = block.majorVersion;
   blockDetails.minorVersion = block.minorVersion;
@@ -129,7 +132,7 @@ bool BlockchainExplorerDataBuilder::fillBlockDetails(const Block &block, BlockDe
   blockDetails.transactionsCumulativeSize = blockSize;
 
   size_t blokBlobSize = getObjectBinarySize(block);
-  size_t minerTxBlobSize = getObjectBinarySize(block.baseTransaction);
+  size_t minerTxBlobSize = cachedBlock.getBaseTransaction().getTransactionBinarySize();
   blockDetails.blockSize = blokBlobSize + blockDetails.transactionsCumulativeSize - minerTxBlobSize;
 
   if (!core.getAlreadyGeneratedCoins(hash, blockDetails.alreadyGeneratedCoins)) {
@@ -169,7 +172,7 @@ bool BlockchainExplorerDataBuilder::fillBlockDetails(const Block &block, BlockDe
 
   blockDetails.transactions.reserve(block.transactionHashes.size() + 1);
   TransactionDetails transactionDetails;
-  if (!fillTransactionDetails(block.baseTransaction, transactionDetails, block.timestamp)) {
+  if (!fillTransactionDetails(cachedBlock.getBaseTransaction(), transactionDetails, block.timestamp)) {
     return false;
   }
   blockDetails.transactions.push_back(std::move(transactionDetails));
@@ -195,14 +198,30 @@ bool BlockchainExplorerDataBuilder::fillBlockDetails(const Block &block, BlockDe
 }
 
 bool BlockchainExplorerDataBuilder::fillTransactionDetails(const Transaction& transaction, TransactionDetails& transactionDetails, uint64_t timestamp) {
-  Crypto::Hash hash = getObjectHash(transaction);
+  return fillTransactionDetails(CachedTransaction(transaction), transactionDetails, timestamp);
+}
+
+bool BlockchainExplorerDataBuilder::fillTransactionDetails(const CachedTransaction& cachedTransaction, TransactionDetails& transactionDetails, uint64_t timestamp) {
+  const Transaction& transaction = cachedTransaction.getTransaction();
+  Crypto::Hash hash = cachedTransaction.getTransactionHash();
   transactionDetails.hash = hash;
 
   transactionDetails.timestamp = timestamp;
 
+  // kept for main chain transactions when the transaction-summaries index is enabled
+  TransactionSummary summary;
+  bool summarized = core.getTransactionSummary(hash, summary);
+
   Crypto::Hash blockHash;
   uint32_t blockHeight;
-  if (!core.getBlockContainingTx(hash, blockHash, blockHeight)) {
+  if (summarized) {
+    transactionDetails.inBlockchain = true;
+    transactionDetails.blockHeight = summary.blockHeight;
+    transactionDetails.blockHash = core.getBlockIdByHeight(summary.blockHeight);
+    if (timestamp == 0) {
+      transactionDetails.timestamp = summary.timestamp;
+    }
+  } else if (!core.getBlockContainingTx(hash, blockHash, blockHeight)) {
     transactionDetails.inBlockchain = false;
     transactionDetails.blockHeight = boost::value_initialized<uint32_t>();
     transactionDetails.blockHash = boost::value_initialized<Crypto::Hash>();
@@ -219,7 +238,7 @@ bool BlockchainExplorerDataBuilder::fillTransactionDetails(const Transaction& tr
     }
   }
 
-  transactionDetails.size = getObjectBinarySize(transaction);
+  transactionDetails.size = cachedTransaction.getTransactionBinarySize();
   transactionDetails.unlockTime = transaction.unlockTime;
   transactionDetails.totalOutputsAmount = get_outs_money_amount(transaction);
 
@@ -227,14 +246,14 @@ bool BlockchainExplorerDataBuilder::fillTransactionDetails(const Transaction& tr
   if (!get_inputs_money_amount(transaction, inputsAmount)) {
     return false;
   }
-  transactionDetails.totalInputsAmount = core.currency().getTransactionAllInputsAmount(transaction, transactionDetails.blockHeight);
+  transactionDetails.totalInputsAmount = summarized ? summary.totalInputsAmount : core.currency().getTransactionAllInputsAmount(transaction, transactionDetails.blockHeight);
 
   if (transaction.inputs.size() > 0 && transaction.inputs.front().type() == typeid(BaseInput)) {
     //It's gen transaction
     transactionDetails.fee = 0;
     transactionDetails.mixin = 0;
   } else {
-    transactionDetails.fee = inputsAmount < transactionDetails.totalOutputsAmount ? CryptoNote::parameters::MINIMUM_FEE : core.currency().getTransactionFee(transaction, transactionDetails.blockHeight);
+    transactionDetails.fee = summarized ? summary.fee : getFee(core.currency(), transaction, transactionDetails.blockHeight);
     uint64_t mixin;
     if (!getMixin(transaction, mixin)) {
       return false;
@@ -262,7 +281,8 @@ bool BlockchainExplorerDataBuilder::fillTransactionDetails(const Transaction& tr
   }
 
   transactionDetails.inputs.reserve(transaction.inputs.size());
-  for (const TransactionInput& txIn : transaction.inputs) {
+  for (size_t i = 0; i < transaction.inputs.size(); ++i) {
+    const TransactionInput& txIn = transaction.inputs[i];
     TransactionInputDetails txInDetails;
 
     if (txIn.type() == typeid(BaseInput)) {
@@ -276,28 +296,38 @@ bool BlockchainExplorerDataBuilder::fillTransactionDetails(const Transaction& tr
     } else if (txIn.type() == typeid(KeyInput)) {
       TransactionInputToKeyDetails txInToKeyDetails;
       const KeyInput& txInToKey = boost::get<KeyInput>(txIn);
-      std::list<std::pair<Crypto::Hash, size_t>> outputReferences;
-      if (!core.scanOutputkeysForIndices(txInToKey, outputReferences)) {
-        return false;
+      if (summarized) {
+        txInToKeyDetails.output.number = summary.inputs[i].number;
+        txInToKeyDetails.output.transactionHash = summary.inputs[i].transactionHash;
+      } else {
+        std::list<std::pair<Crypto::Hash, size_t>> outputReferences;
+        if (!core.scanOutputkeysForIndices(txInToKey, outputReferences)) {
+          return false;
+        }
+        txInToKeyDetails.output.number = outputReferences.back().second;
+        txInToKeyDetails.output.transactionHash = outputReferences.back().first;
       }
       txInDetails.amount = txInToKey.amount;
       txInToKeyDetails.outputIndexes = txInToKey.outputIndexes;
       txInToKeyDetails.keyImage = txInToKey.keyImage;
       txInToKeyDetails.mixin = txInToKey.outputIndexes.size();
-      txInToKeyDetails.output.number = outputReferences.back().second;
-      txInToKeyDetails.output.transactionHash = outputReferences.back().first;
       txInDetails.input = txInToKeyDetails;
     } else if (txIn.type() == typeid(MultisignatureInput)) {
       TransactionInputMultisignatureDetails txInMultisigDetails;
       const MultisignatureInput& txInMultisig = boost::get<MultisignatureInput>(txIn);
       txInDetails.amount = txInMultisig.amount;
       txInMultisigDetails.signatures = txInMultisig.signatureCount;
-      std::pair<Crypto::Hash, size_t> outputReference;
-      if (!core.getMultisigOutputReference(txInMultisig, outputReference)) {
-        return false;
+      if (summarized) {
+        txInMultisigDetails.output.number = summary.inputs[i].number;
+        txInMultisigDetails.output.transactionHash = summary.inputs[i].transactionHash;
+      } else {
+        std::pair<Crypto::Hash, size_t> outputReference;
+        if (!core.getMultisigOutputReference(txInMultisig, outputReference)) {
+          return false;
+        }
+        txInMultisigDetails.output.number = outputReference.second;
+        txInMultisigDetails.output.transactionHash = outputReference.first;
       }
-      txInMultisigDetails.output.number = outputReference.second;
-      txInMultisigDetails.output.transactionHash = outputReference.first;
       txInDetails.input = txInMultisigDetails;
     } else {
       return false;
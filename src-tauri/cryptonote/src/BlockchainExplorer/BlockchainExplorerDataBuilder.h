@@ -20,6 +20,7 @@
 #include <array>
 
 #include "CryptoNoteProtocol/ICryptoNoteProtocolQuery.h"
+#include "CryptoNoteCore/CachedTransaction.h"
 #include "CryptoNoteCore/ICore.h"
 #include "BlockchainExplorerData.h"
 
@@ -40,8 +41,11 @@ public:
   bool fillTransactionDetails(const Transaction &tx, TransactionDetails& txRpcInfo, uint64_t timestamp = 0);
 
   static bool getPaymentId(const Transaction& transaction, Crypto::Hash& paymentId);
+  // the fee reported for a transaction that isn't a base transaction
+  static uint64_t getFee(const Currency& currency, const Transaction& transaction, uint32_t height);
 
 private:
+  bool fillTransactionDetails(const CachedTransaction& cachedTransaction, TransactionDetails& txRpcInfo, uint64_t timestamp);
   bool getMixin(const Transaction& transaction, uint64_t& mixin);
   bool fillTxExtra(const std::vector<uint8_t>& rawExtra, TransactionExtraDetails& extraDetails);
   size_t median(std::vector<size_t>& v);
@@ -0,0 +1,188 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace Common {
+
+namespace {
+
+const char* const SUBSYSTEM_NAMES[MEMORY_SUBSYSTEM_COUNT] = {
+  "other", "block_cache", "output_index", "transaction_pool", "transfers_container"
+};
+
+// zero-initialized before any dynamic initialization, so allocations made by static
+// constructors are counted too
+std::atomic<int64_t> liveBytes[MEMORY_SUBSYSTEM_COUNT];
+std::atomic<int64_t> liveAllocations[MEMORY_SUBSYSTEM_COUNT];
+std::atomic<uint64_t> totalAllocations;
+std::atomic<uint64_t> totalBytes;
+
+thread_local MemorySubsystem currentSubsystem = MemorySubsystem::Other;
+
+}
+
+bool allocationTrackingEnabled() {
+#ifdef FUEGO_ALLOCATION_TRACKING
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::vector<MemoryUsage> memoryUsage() {
+  std::vector<MemoryUsage> usage;
+  for (size_t i = 0; i < MEMORY_SUBSYSTEM_COUNT; ++i) {
+    usage.push_back({ SUBSYSTEM_NAMES[i], liveBytes[i].load(std::memory_order_relaxed),
+      liveAllocations[i].load(std::memory_order_relaxed) });
+  }
+
+  return usage;
+}
+
+void allocationTotals(uint64_t& count, uint64_t& bytes) {
+  count = totalAllocations.load(std::memory_order_relaxed);
+  bytes = totalBytes.load(std::memory_order_relaxed);
+}
+
+std::string memoryReport() {
+  if (!allocationTrackingEnabled()) {
+    return "Allocation tracking is not built in, rebuild with -DFUEGO_ALLOCATION_TRACKING=ON\n";
+  }
+
+  std::string out;
+  char line[128];
+  snprintf(line, sizeof(line), "%-20s %16s %14s\n", "subsystem", "live bytes", "allocations");
+  out += line;
+
+  int64_t bytes = 0;
+  int64_t allocations = 0;
+  for (const MemoryUsage& usage : memoryUsage()) {
+    snprintf(line, sizeof(line), "%-20s %16lld %14lld\n", usage.subsystem, static_cast<long long>(usage.liveBytes),
+      static_cast<long long>(usage.liveAllocations));
+    out += line;
+    bytes += usage.liveBytes;
+    allocations += usage.liveAllocations;
+  }
+
+  snprintf(line, sizeof(line), "%-20s %16lld %14lld\n", "total", static_cast<long long>(bytes), static_cast<long long>(allocations));
+  out += line;
+  return out;
+}
+
+MemorySubsystem enterMemorySubsystem(MemorySubsystem subsystem) {
+  MemorySubsystem previous = currentSubsystem;
+  currentSubsystem = subsystem;
+  return previous;
+}
+
+}
+
+#ifdef FUEGO_ALLOCATION_TRACKING
+
+namespace {
+
+// keeps the malloc alignment of the block handed out after it
+struct AllocationHeader {
+  uint64_t size;
+  uint64_t subsystem;
+};
+
+static_assert(sizeof(AllocationHeader) == 16, "allocation header must preserve malloc alignment");
+
+void* allocate(std::size_t size) {
+  for (;;) {
+    void* block = std::malloc(sizeof(AllocationHeader) + size);
+    if (block != nullptr) {
+      size_t subsystem = static_cast<size_t>(Common::currentSubsystem);
+      AllocationHeader* header = static_cast<AllocationHeader*>(block);
+      header->size = size;
+      header->subsystem = subsystem;
+      Common::liveBytes[subsystem].fetch_add(size, std::memory_order_relaxed);
+      Common::liveAllocations[subsystem].fetch_add(1, std::memory_order_relaxed);
+      Common::totalAllocations.fetch_add(1, std::memory_order_relaxed);
+      Common::totalBytes.fetch_add(size, std::memory_order_relaxed);
+      return header + 1;
+    }
+
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+
+    handler();
+  }
+}
+
+void* allocate(std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return allocate(size);
+  } catch (std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+void release(void* p) noexcept {
+  if (p == nullptr) {
+    return;
+  }
+
+  AllocationHeader* header = static_cast<AllocationHeader*>(p) - 1;
+  Common::liveBytes[header->subsystem].fetch_sub(header->size, std::memory_order_relaxed);
+  Common::liveAllocations[header->subsystem].fetch_sub(1, std::memory_order_relaxed);
+  std::free(header);
+}
+
+}
+
+void* operator new(std::size_t size) {
+  return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+  return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t& tag) noexcept {
+  return allocate(size, tag);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+  return allocate(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+  release(p);
+}
+
+void operator delete[](void* p) noexcept {
+  release(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  release(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  release(p);
+}
+
+#endif
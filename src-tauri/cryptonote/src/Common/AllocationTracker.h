@@ -0,0 +1,75 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Common {
+
+// Parts of the daemon and wallet whose heap use is tagged when built with FUEGO_ALLOCATION_TRACKING
+enum class MemorySubsystem : uint8_t {
+  Other,
+  BlockCache,
+  OutputIndex,
+  TransactionPool,
+  TransfersContainer
+};
+
+const size_t MEMORY_SUBSYSTEM_COUNT = 5;
+
+struct MemoryUsage {
+  const char* subsystem;
+  int64_t liveBytes;
+  int64_t liveAllocations;
+};
+
+// false unless built with FUEGO_ALLOCATION_TRACKING, in which case operator new and delete
+// are replaced to tag every allocation with the subsystem of the allocating thread
+bool allocationTrackingEnabled();
+
+std::vector<MemoryUsage> memoryUsage();
+// cumulative count and size of all allocations, zero when tracking is off
+void allocationTotals(uint64_t& count, uint64_t& bytes);
+// table of live bytes by subsystem, for the console and the periodic heap snapshot
+std::string memoryReport();
+
+MemorySubsystem enterMemorySubsystem(MemorySubsystem subsystem);
+
+// Attributes allocations made by this thread to a subsystem until destroyed. Scopes nest, and an
+// allocation stays with its subsystem wherever it is freed. Compiles to nothing without tracking.
+class MemoryScope {
+public:
+#ifdef FUEGO_ALLOCATION_TRACKING
+  explicit MemoryScope(MemorySubsystem subsystem) : m_previous(enterMemorySubsystem(subsystem)) {}
+  ~MemoryScope() { enterMemorySubsystem(m_previous); }
+#else
+  explicit MemoryScope(MemorySubsystem) {}
+#endif
+
+  MemoryScope(const MemoryScope&) = delete;
+  MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+#ifdef FUEGO_ALLOCATION_TRACKING
+  MemorySubsystem m_previous;
+#endif
+};
+
+}
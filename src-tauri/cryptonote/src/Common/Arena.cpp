@@ -0,0 +1,72 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Arena.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Common {
+
+Arena::Arena(size_t chunkSize) : m_chunkSize(chunkSize), m_current(nullptr), m_left(0), m_firstChunkSize(0) {
+  m_stats.allocations = 0;
+  m_stats.allocatedBytes = 0;
+  m_stats.chunkAllocations = 0;
+  m_stats.resets = 0;
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+  assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+  size_t padding = (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment;
+  if (m_current == nullptr || padding + size > m_left) {
+    addChunk(size + alignment);
+    padding = (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment;
+  }
+
+  void* result = m_current + padding;
+  m_current += padding + size;
+  m_left -= padding + size;
+
+  ++m_stats.allocations;
+  m_stats.allocatedBytes += size;
+  return result;
+}
+
+void Arena::reset() {
+  if (!m_chunks.empty()) {
+    m_chunks.resize(1);
+    m_current = m_chunks.front().get();
+    m_left = m_firstChunkSize;
+  }
+
+  ++m_stats.resets;
+}
+
+void Arena::addChunk(size_t minimumSize) {
+  size_t size = std::max(m_chunkSize, minimumSize);
+  m_chunks.emplace_back(new uint8_t[size]);
+  if (m_chunks.size() == 1) {
+    m_firstChunkSize = size;
+  }
+
+  m_current = m_chunks.back().get();
+  m_left = size;
+  ++m_stats.chunkAllocations;
+}
+
+}
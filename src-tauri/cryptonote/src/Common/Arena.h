@@ -0,0 +1,99 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Common {
+
+// Bump allocator for objects that all die together: memory comes from large chunks and is only
+// given back by reset() or the destructor, deallocation of single objects is a no-op. reset()
+// keeps the first chunk for the next round. Not thread safe.
+class Arena {
+public:
+  struct Stats {
+    uint64_t allocations;       // handed out since construction
+    uint64_t allocatedBytes;
+    uint64_t chunkAllocations;  // chunks taken from the heap
+    uint64_t resets;
+  };
+
+  explicit Arena(size_t chunkSize = 64 * 1024);
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* allocate(size_t size, size_t alignment);
+  void reset();
+
+  const Stats& getStats() const { return m_stats; }
+
+private:
+  void addChunk(size_t minimumSize);
+
+  const size_t m_chunkSize;
+  std::vector<std::unique_ptr<uint8_t[]>> m_chunks;
+  uint8_t* m_current;
+  size_t m_left;
+  size_t m_firstChunkSize;
+  Stats m_stats;
+};
+
+// Standard allocator over an arena, for allocate_shared and containers that live no longer than it
+template <typename T>
+class ArenaAllocator {
+public:
+  typedef T value_type;
+
+  explicit ArenaAllocator(Arena& arena) : m_arena(&arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.arena()) {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, size_t) {
+  }
+
+  Arena* arena() const { return m_arena; }
+
+  template <typename U>
+  struct rebind {
+    typedef ArenaAllocator<U> other;
+  };
+
+private:
+  Arena* m_arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& left, const ArenaAllocator<U>& right) {
+  return left.arena() == right.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& left, const ArenaAllocator<U>& right) {
+  return left.arena() != right.arena();
+}
+
+}
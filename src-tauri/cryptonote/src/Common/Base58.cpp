@@ -142,21 +142,27 @@ namespace Tools
         if (res_size <= 0)
           return false; // Invalid block size
 
+        // Horner's rule; 58^10 < 2^64, so only the last digit of a full block can overflow
         uint64_t res_num = 0;
-        uint64_t order = 1;
-        for (size_t i = size - 1; i < size; --i)
+        for (size_t i = 0; i < size; ++i)
         {
           int digit = reverse_alphabet::instance(block[i]);
           if (digit < 0)
             return false; // Invalid symbol
 
+          if (i + 1 < full_encoded_block_size)
+          {
+            res_num = res_num * alphabet_size + static_cast<uint64_t>(digit);
+            continue;
+          }
+
           uint64_t product_hi;
-          uint64_t tmp = res_num + mul128(order, digit, &product_hi);
-          if (tmp < res_num || 0 != product_hi)
+          uint64_t product = mul128(res_num, alphabet_size, &product_hi);
+          uint64_t tmp = product + static_cast<uint64_t>(digit);
+          if (tmp < product || 0 != product_hi)
             return false; // Overflow
 
           res_num = tmp;
-          order *= alphabet_size; // Never overflows, 58^10 < 2^64
         }
 
         if (static_cast<size_t>(res_size) < full_block_size && (UINT64_C(1) << (8 * res_size)) <= res_num)
@@ -233,25 +239,21 @@ namespace Tools
       return encode(buf);
     }
 
-    bool decode_addr(std::string addr, uint64_t& tag, std::string& data)
+    bool decode_addr(const std::string& addr, uint64_t& tag, std::string& data)
     {
       std::string addr_data;
       bool r = decode(addr, addr_data);
       if (!r) return false;
       if (addr_data.size() <= addr_checksum_size) return false;
 
-      std::string checksum(addr_checksum_size, '\0');
-      checksum = addr_data.substr(addr_data.size() - addr_checksum_size);
-
-      addr_data.resize(addr_data.size() - addr_checksum_size);
-      Crypto::Hash hash = Crypto::cn_fast_hash(addr_data.data(), addr_data.size());
-      std::string expected_checksum(reinterpret_cast<const char*>(&hash), addr_checksum_size);
-      if (expected_checksum != checksum) return false;
+      size_t payload_size = addr_data.size() - addr_checksum_size;
+      Crypto::Hash hash = Crypto::cn_fast_hash(addr_data.data(), payload_size);
+      if (memcmp(&hash, addr_data.data() + payload_size, addr_checksum_size) != 0) return false;
 
-      int read = Tools::read_varint(addr_data.begin(), addr_data.end(), tag);
+      int read = Tools::read_varint(addr_data.begin(), addr_data.begin() + payload_size, tag);
       if (read <= 0) return false;
 
-      data = addr_data.substr(read);
+      data.assign(addr_data, read, payload_size - read);
       return true;
     }
   }
@@ -28,6 +28,6 @@ namespace Tools
     bool decode(const std::string& enc, std::string& data);
 
     std::string encode_addr(uint64_t tag, const std::string& data);
-    bool decode_addr(std::string addr, uint64_t& tag, std::string& data);
+    bool decode_addr(const std::string& addr, uint64_t& tag, std::string& data);
   }
 }
@@ -0,0 +1,271 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace Common {
+
+// Bounded multi-producer multi-consumer ring after Dmitry Vyukov's design: every cell carries a
+// sequence number, so producers and consumers each claim a slot with one compare-and-swap and
+// never share a lock. push and pop spin briefly and then park on a condition variable; the park
+// mutex is only touched while somebody is parked. close() has BlockingQueue semantics: pushes
+// fail from then on and pops drain what is left before failing.
+template <typename T>
+class BoundedMpmcQueue {
+public:
+  explicit BoundedMpmcQueue(size_t capacity) :
+    m_mask(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity) - 1),
+    m_cells(new Cell[m_mask + 1]),
+    m_enqueuePosition(0),
+    m_dequeuePosition(0),
+    m_closed(false),
+    m_parkedProducers(0),
+    m_parkedConsumers(0) {
+    for (size_t i = 0; i <= m_mask; ++i) {
+      m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~BoundedMpmcQueue() {
+    T value;
+    while (dequeue(value)) {
+    }
+
+    delete[] m_cells;
+  }
+
+  BoundedMpmcQueue(const BoundedMpmcQueue&) = delete;
+  BoundedMpmcQueue& operator=(const BoundedMpmcQueue&) = delete;
+
+  template <typename TT>
+  bool tryPush(TT&& value) {
+    if (!enqueue(std::forward<TT>(value))) {
+      return false;
+    }
+
+    wake(m_parkedConsumers, m_haveData);
+    return true;
+  }
+
+  bool tryPop(T& value) {
+    if (!dequeue(value)) {
+      return false;
+    }
+
+    wake(m_parkedProducers, m_haveSpace);
+    return true;
+  }
+
+  // waits while the queue is full, returns false once the queue is closed
+  template <typename TT>
+  bool push(TT&& value) {
+    for (unsigned spin = 0; spin < SPIN_COUNT; ++spin) {
+      if (m_closed.load(std::memory_order_acquire)) {
+        return false;
+      }
+
+      if (tryPush(std::forward<TT>(value))) {
+        return true;
+      }
+
+      std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(m_parkMutex);
+    m_parkedProducers.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool pushed = false;
+    while (!m_closed.load() && !(pushed = enqueue(std::forward<TT>(value)))) {
+      m_haveSpace.wait(lock);
+    }
+
+    m_parkedProducers.fetch_sub(1);
+    if (pushed) {
+      wakeLocked(m_parkedConsumers, m_haveData);
+    }
+
+    return pushed;
+  }
+
+  // waits while the queue is empty, returns false once the queue is closed and drained
+  bool pop(T& value) {
+    for (unsigned spin = 0; spin < SPIN_COUNT; ++spin) {
+      if (tryPop(value)) {
+        return true;
+      }
+
+      if (drained()) {
+        return false;
+      }
+
+      std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(m_parkMutex);
+    m_parkedConsumers.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool popped = false;
+    while (!(popped = dequeue(value)) && !drained()) {
+      m_haveData.wait(lock);
+    }
+
+    m_parkedConsumers.fetch_sub(1);
+    if (popped) {
+      wakeLocked(m_parkedProducers, m_haveSpace);
+    }
+
+    return popped;
+  }
+
+  void close(bool wait = false) {
+    std::unique_lock<std::mutex> lock(m_parkMutex);
+    m_closed.store(true);
+    m_haveData.notify_all();
+    m_haveSpace.notify_all();
+
+    if (wait) {
+      m_parkedProducers.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      while (size() != 0) {
+        m_haveSpace.wait(lock);
+      }
+
+      m_parkedProducers.fetch_sub(1);
+    }
+  }
+
+  // exact only while no push or pop is in progress
+  size_t size() const {
+    size_t dequeued = m_dequeuePosition.load(std::memory_order_acquire);
+    size_t enqueued = m_enqueuePosition.load(std::memory_order_acquire);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+  }
+
+  size_t capacity() const {
+    return m_mask + 1;
+  }
+
+private:
+  static const unsigned SPIN_COUNT = 64;
+  static const size_t CACHE_LINE = 64;
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  static size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+
+    return result;
+  }
+
+  template <typename TT>
+  bool enqueue(TT&& value) {
+    size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = m_cells[position & m_mask];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (difference == 0) {
+        if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          new (&cell.storage) T(std::forward<TT>(value));
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = m_enqueuePosition.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool dequeue(T& value) {
+    size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = m_cells[position & m_mask];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+      if (difference == 0) {
+        if (m_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          T* item = reinterpret_cast<T*>(&cell.storage);
+          value = std::move(*item);
+          item->~T();
+          cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = m_dequeuePosition.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // a push that claimed its slot before close() still counts, so consumers wait for it
+  bool drained() const {
+    return m_closed.load() && size() == 0;
+  }
+
+  // the fence pairs with the one a parking thread issues after counting itself, so either the
+  // waker sees the parked count or the parked thread sees the new item before it waits
+  void wake(std::atomic<size_t>& parked, std::condition_variable& condition) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed) != 0) {
+      std::unique_lock<std::mutex> lock(m_parkMutex);
+      condition.notify_all();
+    }
+  }
+
+  // same as wake, for a caller already holding the park mutex
+  void wakeLocked(std::atomic<size_t>& parked, std::condition_variable& condition) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed) != 0) {
+      condition.notify_all();
+    }
+  }
+
+  const size_t m_mask;
+  Cell* const m_cells;
+  char m_padding0[CACHE_LINE];
+  std::atomic<size_t> m_enqueuePosition;
+  char m_padding1[CACHE_LINE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> m_dequeuePosition;
+  char m_padding2[CACHE_LINE - sizeof(std::atomic<size_t>)];
+  std::atomic<bool> m_closed;
+  std::atomic<size_t> m_parkedProducers;
+  std::atomic<size_t> m_parkedConsumers;
+  std::mutex m_parkMutex;
+  std::condition_variable m_haveData;
+  std::condition_variable m_haveSpace;
+};
+
+}
@@ -0,0 +1,58 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// it will be useful, but WITHOUT ANY WARRANTY; without even an
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "BufferedOutputStream.h"
+
+#include <cstring>
+#include <exception>
+#include "StreamTools.h"
+
+namespace Common {
+
+BufferedOutputStream::BufferedOutputStream(IOutputStream& out, size_t bufferSize) : out(out), buffer(bufferSize), used(0) {
+}
+
+BufferedOutputStream::~BufferedOutputStream() {
+  try {
+    flush();
+  } catch (std::exception&) {
+  }
+}
+
+size_t BufferedOutputStream::writeSome(const void* data, size_t size) {
+  if (used + size > buffer.size()) {
+    flush();
+    if (size >= buffer.size()) {
+      return out.writeSome(data, size);
+    }
+  }
+
+  memcpy(buffer.data() + used, data, size);
+  used += size;
+  return size;
+}
+
+void BufferedOutputStream::flush() {
+  if (used != 0) {
+    // cleared first, a failed write must not be retried from the destructor
+    size_t size = used;
+    used = 0;
+    write(out, buffer.data(), size);
+  }
+}
+
+}
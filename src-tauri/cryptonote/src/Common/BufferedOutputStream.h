@@ -0,0 +1,42 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// it will be useful, but WITHOUT ANY WARRANTY; without even an
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "IOutputStream.h"
+
+namespace Common {
+
+// Collects small writes and hands them to the wrapped stream in large blocks,
+// flush() must be called before the wrapped stream is used or checked again
+class BufferedOutputStream : public IOutputStream {
+public:
+  explicit BufferedOutputStream(IOutputStream& out, size_t bufferSize = 64 * 1024);
+  BufferedOutputStream& operator=(const BufferedOutputStream&) = delete;
+  ~BufferedOutputStream();
+  size_t writeSome(const void* data, size_t size) override;
+  void flush();
+
+private:
+  IOutputStream& out;
+  std::vector<uint8_t> buffer;
+  size_t used;
+};
+
+}
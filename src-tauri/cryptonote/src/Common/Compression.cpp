@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Compression.h"
+
+#ifdef FUEGO_BLOCK_COMPRESSION
+#include <zstd.h>
+#endif
+
+namespace Common {
+
+#ifdef FUEGO_BLOCK_COMPRESSION
+
+namespace {
+
+// the library default; higher levels barely shrink blocks further and slow down every push
+const int COMPRESSION_LEVEL = 3;
+
+}
+
+bool compressionSupported() {
+  return true;
+}
+
+bool compress(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed) {
+  compressed.resize(ZSTD_compressBound(size));
+  size_t result = ZSTD_compress(compressed.data(), compressed.size(), data, size, COMPRESSION_LEVEL);
+  if (ZSTD_isError(result)) {
+    return false;
+  }
+
+  compressed.resize(result);
+  return true;
+}
+
+bool decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& decompressed) {
+  unsigned long long contentSize = ZSTD_getFrameContentSize(data, size);
+  if (contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize == ZSTD_CONTENTSIZE_ERROR) {
+    return false;
+  }
+
+  decompressed.resize(static_cast<size_t>(contentSize));
+  size_t result = ZSTD_decompress(decompressed.data(), decompressed.size(), data, size);
+  return !ZSTD_isError(result) && result == decompressed.size();
+}
+
+#else
+
+bool compressionSupported() {
+  return false;
+}
+
+bool compress(const uint8_t*, size_t, std::vector<uint8_t>&) {
+  return false;
+}
+
+bool decompress(const uint8_t*, size_t, std::vector<uint8_t>&) {
+  return false;
+}
+
+#endif
+
+}
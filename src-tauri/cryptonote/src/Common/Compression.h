@@ -0,0 +1,34 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Common {
+
+// zstd compression of storage chunks. Only available when built with FUEGO_BLOCK_COMPRESSION;
+// otherwise every call fails.
+bool compressionSupported();
+
+bool compress(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed);
+// data must be a single frame written by compress()
+bool decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& decompressed);
+
+}
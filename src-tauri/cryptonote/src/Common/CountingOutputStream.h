@@ -0,0 +1,41 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// it will be useful, but WITHOUT ANY WARRANTY; without even an
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "IOutputStream.h"
+
+namespace Common {
+
+// Discards the data and only counts it, for measuring a serialized size without building it
+class CountingOutputStream : public IOutputStream {
+public:
+  CountingOutputStream() : count(0) {}
+  size_t writeSome(const void* data, size_t size) override {
+    count += size;
+    return size;
+  }
+
+  size_t size() const {
+    return count;
+  }
+
+private:
+  size_t count;
+};
+
+}
@@ -12,6 +12,7 @@
 // You should receive a copy of the GNU General Public License
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>
 
+#include <algorithm>
 #include <condition_variable>
 #include <future>
 #include <memory>
@@ -22,6 +23,7 @@
 #include <cstring>
 #include <string>
 #include <map>
+#include <thread>
 #include <boost/program_options/variables_map.hpp>
 #include <iostream>
 #ifdef _WIN32
@@ -130,6 +132,56 @@ namespace Common {
 		return true;
 	}
 
+	// The resolver threads are detached rather than joined: res_query can't be interrupted, so one
+	// that hangs past the timeout finishes on its own, holding only the shared replies.
+	bool fetch_dns_txt_quorum(const std::vector<std::string>& domains, size_t quorum, std::chrono::milliseconds timeout,
+		std::vector<std::string>& records) {
+		struct Replies {
+			std::mutex mutex;
+			std::condition_variable answered;
+			std::map<std::vector<std::string>, size_t> votes;
+			size_t pending;
+		};
+
+		auto replies = std::make_shared<Replies>();
+		replies->pending = domains.size();
+		for (const std::string& domain : domains) {
+			std::thread([replies, domain] {
+				std::vector<std::string> answer;
+				bool found = fetch_dns_txt(domain, answer);
+				std::sort(answer.begin(), answer.end());
+
+				std::lock_guard<std::mutex> lock(replies->mutex);
+				if (found) {
+					++replies->votes[answer];
+				}
+
+				--replies->pending;
+				replies->answered.notify_all();
+			}).detach();
+		}
+
+		auto winner = [&replies, quorum] {
+			for (const auto& vote : replies->votes) {
+				if (vote.second >= quorum) {
+					return &vote.first;
+				}
+			}
+
+			return static_cast<const std::vector<std::string>*>(nullptr);
+		};
+
+		std::unique_lock<std::mutex> lock(replies->mutex);
+		replies->answered.wait_for(lock, timeout, [&] { return replies->pending == 0 || winner() != nullptr; });
+		const std::vector<std::string>* agreed = winner();
+		if (agreed == nullptr) {
+			return false;
+		}
+
+		records = *agreed;
+		return true;
+	}
+
 #endif
 
 }
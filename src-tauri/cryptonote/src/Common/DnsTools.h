@@ -14,10 +14,16 @@
 
 #pragma once
 
+#include <chrono>
 #include <string>
 
 #include <vector>
 
 namespace Common {
   bool fetch_dns_txt(const std::string domain, std::vector<std::string>&records);
+
+  // Queries every domain at once and returns the records as soon as quorum of them answered
+  // with the same set, sorted; false if that didn't happen within the timeout.
+  bool fetch_dns_txt_quorum(const std::vector<std::string>& domains, size_t quorum, std::chrono::milliseconds timeout,
+    std::vector<std::string>& records);
 }
@@ -278,6 +278,12 @@ public:
   bool getAutoFlush() const;
   void setAutoFlush(bool autoFlush);
 
+  // Lets reserve() extend the file where it is instead of writing a grown copy and renaming it over
+  // the original. Growth is then no longer atomic: a crash in the middle can leave the old capacity
+  // with stray bytes behind the suffix, so only a vector whose suffix knows its own length may use it.
+  bool getInPlaceGrowth() const;
+  void setInPlaceGrowth(bool inPlaceGrowth);
+
   void flush();
 
   const uint8_t* prefix() const;
@@ -302,12 +308,14 @@ private:
   uint64_t m_prefixSize;
   uint64_t m_suffixSize;
   bool m_autoFlush;
+  bool m_inPlaceGrowth;
 
 private:
   template<class F>
   void atomicUpdate(uint64_t newSize, uint64_t newCapacity, uint64_t newPrefixSize, uint64_t newSuffixSize, F&& func);
   template<class F>
   void atomicUpdate0(uint64_t newCapacity, uint64_t newPrefixSize, uint64_t newSuffixSize, F&& func);
+  bool growInPlace(uint64_t newCapacity);
 
   void open(const std::string& path, uint64_t prefixSize);
   void create(const std::string& path, uint64_t initialCapacity, uint64_t prefixSize, uint64_t suffixSize);
@@ -333,13 +341,15 @@ private:
 
 template<class T>
 FileMappedVector<T>::FileMappedVector() :
-  m_autoFlush(true)
+  m_autoFlush(true),
+  m_inPlaceGrowth(false)
 {
 }
 
 template<class T>
 FileMappedVector<T>::FileMappedVector(const std::string& path, FileMappedVectorOpenMode mode, uint64_t prefixSize) :
-  m_autoFlush(true)
+  m_autoFlush(true),
+  m_inPlaceGrowth(false)
 {
   open(path, mode, prefixSize);
 }
@@ -430,7 +440,7 @@ template<class T>
 void FileMappedVector<T>::reserve(uint64_t n) {
   assert(isOpened());
 
-  if (n > capacity()) {
+  if (n > capacity() && !growInPlace(n)) {
     atomicUpdate(size(), n, prefixSize(), suffixSize(), [this](value_type* target) {
       std::copy(cbegin(), cend(), target);
     });
@@ -620,6 +630,18 @@ typename FileMappedVector<T>::iterator FileMappedVector<T>::insert(const_iterato
     newCapacity = capacity();
   }
 
+  // appending after an in-place growth reads [first, last) from the remapped file, so it must not point into this vector
+  if (position == cend() && newCapacity > capacity() && growInPlace(newCapacity)) {
+    std::copy(first, last, vectorDataPtr() + size());
+    if (m_autoFlush) {
+      m_file.flush(reinterpret_cast<uint8_t*>(vectorDataPtr() + size()), (newSize - size()) * valueSize);
+    }
+
+    *sizePtr() = newSize;
+    flushSize();
+    return iterator(this, position.index());
+  }
+
   atomicUpdate(newSize, newCapacity, prefixSize(), suffixSize(), [this, position, first, last](value_type* target) {
     std::copy(cbegin(), position, target);
     std::copy(first, last, target + position.index());
@@ -670,6 +692,16 @@ void FileMappedVector<T>::setAutoFlush(bool autoFlush) {
   m_autoFlush = autoFlush;
 }
 
+template<class T>
+bool FileMappedVector<T>::getInPlaceGrowth() const {
+  return m_inPlaceGrowth;
+}
+
+template<class T>
+void FileMappedVector<T>::setInPlaceGrowth(bool inPlaceGrowth) {
+  m_inPlaceGrowth = inPlaceGrowth;
+}
+
 template<class T>
 void FileMappedVector<T>::flush() {
   assert(isOpened());
@@ -826,6 +858,26 @@ void FileMappedVector<T>::atomicUpdate0(uint64_t newCapacity, uint64_t newPrefix
   boost::filesystem::remove(bakPath, boostError);
 }
 
+template<class T>
+bool FileMappedVector<T>::growInPlace(uint64_t newCapacity) {
+  // the suffix must land clear of its old copy, so that copy stays intact until the new capacity is written
+  uint64_t growth = (newCapacity - capacity()) * valueSize;
+  if (!m_inPlaceGrowth || growth < suffixSize() || m_file.path() != m_path) {
+    return false;
+  }
+
+  uint64_t oldSuffixOffset = static_cast<uint64_t>(suffixPtr() - prefixPtr());
+  m_file.resize(m_file.size() + growth);
+
+  uint8_t* oldSuffix = prefixPtr() + oldSuffixOffset;
+  std::copy(oldSuffix, oldSuffix + suffixSize(), oldSuffix + growth);
+  m_file.flush(oldSuffix + growth, suffixSize());
+
+  *capacityPtr() = newCapacity;
+  m_file.flush(reinterpret_cast<uint8_t*>(capacityPtr()), sizeof(uint64_t));
+  return true;
+}
+
 template<class T>
 void FileMappedVector<T>::open(const std::string& path, uint64_t prefixSize) {
   m_prefixSize = prefixSize;
@@ -0,0 +1,230 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Gzip.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Common {
+
+namespace {
+
+const size_t WINDOW_SIZE = 32768;
+const size_t MIN_MATCH = 3;
+const size_t MAX_MATCH = 258;
+const size_t HASH_SIZE = 1 << 15;
+// candidates examined per position, bounds the time spent on repetitive input
+const size_t MAX_CHAIN = 64;
+
+const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+class BitWriter {
+public:
+  explicit BitWriter(std::string& out) : m_out(out), m_bits(0), m_count(0) {
+  }
+
+  // deflate packs values starting from the least significant bit
+  void write(uint32_t value, unsigned count) {
+    m_bits |= static_cast<uint64_t>(value) << m_count;
+    m_count += count;
+    while (m_count >= 8) {
+      m_out.push_back(static_cast<char>(m_bits & 0xff));
+      m_bits >>= 8;
+      m_count -= 8;
+    }
+  }
+
+  // Huffman codes are defined starting from the most significant bit
+  void writeCode(uint32_t code, unsigned length) {
+    uint32_t reversed = 0;
+    for (unsigned i = 0; i < length; ++i) {
+      reversed = (reversed << 1) | (code & 1);
+      code >>= 1;
+    }
+
+    write(reversed, length);
+  }
+
+  void flush() {
+    if (m_count > 0) {
+      m_out.push_back(static_cast<char>(m_bits & 0xff));
+      m_bits = 0;
+      m_count = 0;
+    }
+  }
+
+private:
+  std::string& m_out;
+  uint64_t m_bits;
+  unsigned m_count;
+};
+
+void writeSymbol(BitWriter& writer, unsigned symbol) {
+  if (symbol < 144) {
+    writer.writeCode(0x30 + symbol, 8);
+  } else if (symbol < 256) {
+    writer.writeCode(0x190 + symbol - 144, 9);
+  } else if (symbol < 280) {
+    writer.writeCode(symbol - 256, 7);
+  } else {
+    writer.writeCode(0xc0 + symbol - 280, 8);
+  }
+}
+
+void writeMatch(BitWriter& writer, size_t length, size_t distance) {
+  size_t lengthCode = 28;
+  while (LENGTH_BASE[lengthCode] > length) {
+    --lengthCode;
+  }
+
+  writeSymbol(writer, static_cast<unsigned>(257 + lengthCode));
+  writer.write(static_cast<uint32_t>(length - LENGTH_BASE[lengthCode]), LENGTH_EXTRA[lengthCode]);
+
+  size_t distanceCode = 29;
+  while (DISTANCE_BASE[distanceCode] > distance) {
+    --distanceCode;
+  }
+
+  writer.writeCode(static_cast<uint32_t>(distanceCode), 5);
+  writer.write(static_cast<uint32_t>(distance - DISTANCE_BASE[distanceCode]), DISTANCE_EXTRA[distanceCode]);
+}
+
+std::array<uint32_t, 256> makeCrcTable() {
+  std::array<uint32_t, 256> table;
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 1) ? 0xedb88320 ^ (crc >> 1) : crc >> 1;
+    }
+
+    table[i] = crc;
+  }
+
+  return table;
+}
+
+uint32_t crc32(const std::string& data) {
+  static const std::array<uint32_t, 256> table = makeCrcTable();
+  uint32_t crc = 0xffffffff;
+  for (unsigned char c : data) {
+    crc = table[(crc ^ c) & 0xff] ^ (crc >> 8);
+  }
+
+  return crc ^ 0xffffffff;
+}
+
+void writeLittleEndian(std::string& out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+size_t hashAt(const unsigned char* data) {
+  return ((static_cast<size_t>(data[0]) << 10) ^ (static_cast<size_t>(data[1]) << 5) ^ data[2]) & (HASH_SIZE - 1);
+}
+
+}
+
+std::string gzipCompress(const std::string& data) {
+  // magic, deflate, no flags, no modification time, no extra flags, unknown OS
+  static const char header[] = { '\x1f', '\x8b', '\x08', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\xff' };
+
+  std::string out(header, sizeof(header));
+  out.reserve(sizeof(header) + data.size() / 2 + 64);
+
+  BitWriter writer(out);
+  // a single final block compressed with the fixed codes
+  writer.write(1, 1);
+  writer.write(1, 2);
+
+  const unsigned char* input = reinterpret_cast<const unsigned char*>(data.data());
+  const size_t size = data.size();
+  std::vector<int64_t> head(HASH_SIZE, -1);
+  std::vector<int64_t> previous(WINDOW_SIZE, -1);
+
+  auto insert = [&](size_t position) {
+    if (position + MIN_MATCH <= size) {
+      size_t hash = hashAt(input + position);
+      previous[position & (WINDOW_SIZE - 1)] = head[hash];
+      head[hash] = static_cast<int64_t>(position);
+    }
+  };
+
+  size_t position = 0;
+  while (position < size) {
+    size_t bestLength = 0;
+    size_t bestDistance = 0;
+
+    if (position + MIN_MATCH <= size) {
+      const size_t maxLength = std::min(MAX_MATCH, size - position);
+      int64_t candidate = head[hashAt(input + position)];
+      for (size_t chain = 0; candidate >= 0 && position - static_cast<size_t>(candidate) <= WINDOW_SIZE && chain < MAX_CHAIN; ++chain) {
+        const unsigned char* match = input + candidate;
+        if (match[bestLength] == input[position + bestLength]) {
+          size_t length = 0;
+          while (length < maxLength && match[length] == input[position + length]) {
+            ++length;
+          }
+
+          if (length > bestLength) {
+            bestLength = length;
+            bestDistance = position - static_cast<size_t>(candidate);
+            if (length == maxLength) {
+              break;
+            }
+          }
+        }
+
+        int64_t next = previous[static_cast<size_t>(candidate) & (WINDOW_SIZE - 1)];
+        if (next >= candidate) {
+          // the slot was reused by a newer position, the rest of the chain is gone
+          break;
+        }
+
+        candidate = next;
+      }
+    }
+
+    if (bestLength >= MIN_MATCH) {
+      writeMatch(writer, bestLength, bestDistance);
+      for (size_t i = 0; i < bestLength; ++i) {
+        insert(position + i);
+      }
+
+      position += bestLength;
+    } else {
+      writeSymbol(writer, input[position]);
+      insert(position);
+      ++position;
+    }
+  }
+
+  writeSymbol(writer, 256);
+  writer.flush();
+
+  writeLittleEndian(out, crc32(data));
+  writeLittleEndian(out, static_cast<uint32_t>(data.size()));
+  return out;
+}
+
+}
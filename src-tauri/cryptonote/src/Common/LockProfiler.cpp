@@ -0,0 +1,107 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+#include "LockProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace Common {
+
+namespace {
+
+// upper bound of the bucket holding the given quantile, in milliseconds
+double quantileMilliseconds(const MetricHistogram& histogram, double quantile) {
+  uint64_t total = histogram.count();
+  if (total == 0) {
+    return 0;
+  }
+
+  uint64_t rank = static_cast<uint64_t>(quantile * total);
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i + 1 < MetricHistogram::BUCKET_COUNT; ++i) {
+    cumulative += histogram.bucket(i);
+    if (cumulative > rank) {
+      return MetricHistogram::BUCKET_BOUNDS[i] * 1000;
+    }
+  }
+
+  return MetricHistogram::BUCKET_BOUNDS[MetricHistogram::BUCKET_COUNT - 2] * 1000;
+}
+
+const char* baseName(const char* path) {
+  const char* slash = std::max(std::strrchr(path, '/'), std::strrchr(path, '\\'));
+  return slash != nullptr ? slash + 1 : path;
+}
+
+}
+
+LockProfiler& LockProfiler::instance() {
+  static LockProfiler profiler;
+  return profiler;
+}
+
+void LockProfiler::record(const LockSite& site, bool shared, std::chrono::steady_clock::duration wait,
+  std::chrono::steady_clock::duration hold) {
+  // observed under the lock so that reset() cannot free the entry underneath
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::unique_ptr<SiteStats>& stats = m_sites[Key(site.lock, site.file, site.line, shared)];
+  if (!stats) {
+    stats.reset(new SiteStats());
+    stats->site = site;
+    stats->shared = shared;
+  }
+
+  stats->wait.observe(wait);
+  stats->hold.observe(hold);
+}
+
+void LockProfiler::reset() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_sites.clear();
+}
+
+std::string LockProfiler::report() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<const SiteStats*> sites;
+  for (const auto& entry : m_sites) {
+    sites.push_back(entry.second.get());
+  }
+
+  std::sort(sites.begin(), sites.end(), [](const SiteStats* a, const SiteStats* b) {
+    return a->hold.sumSeconds() > b->hold.sumSeconds();
+  });
+
+  std::string out;
+  char line[512];
+  snprintf(line, sizeof(line), "%-12s %-6s %-48s %10s %12s %10s %12s %10s\n", "lock", "mode", "site", "count",
+    "wait ms", "wait p99", "hold ms", "hold p99");
+  out += line;
+  for (const SiteStats* stats : sites) {
+    std::string site = std::string(baseName(stats->site.file)) + ":" + std::to_string(stats->site.line) + " " + stats->site.function;
+    snprintf(line, sizeof(line), "%-12s %-6s %-48s %10llu %12.3f %10.3f %12.3f %10.3f\n", stats->site.lock,
+      stats->shared ? "shared" : "excl", site.c_str(), static_cast<unsigned long long>(stats->hold.count()),
+      stats->wait.sumSeconds() * 1000, quantileMilliseconds(stats->wait, 0.99),
+      stats->hold.sumSeconds() * 1000, quantileMilliseconds(stats->hold, 0.99));
+    out += line;
+  }
+
+  return out;
+}
+
+}
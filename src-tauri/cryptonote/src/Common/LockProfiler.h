@@ -0,0 +1,147 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "Metrics.h"
+
+namespace Common {
+
+// Where a lock is taken. All strings must have static storage duration, which LOCK_SITE ensures.
+struct LockSite {
+  const char* lock;
+  const char* file;
+  const char* function;
+  int line;
+};
+
+#define LOCK_SITE(lock) ::Common::LockSite{lock, __FILE__, __FUNCTION__, __LINE__}
+
+// Opt-in wait and hold time histograms per lock call site. Sites are timed by the guards below
+// only while profiling is enabled; otherwise they cost one relaxed load.
+class LockProfiler {
+public:
+  static LockProfiler& instance();
+
+  void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+  bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+  void record(const LockSite& site, bool shared, std::chrono::steady_clock::duration wait,
+    std::chrono::steady_clock::duration hold);
+  void reset();
+
+  // one line per site, longest total hold time first
+  std::string report() const;
+
+private:
+  LockProfiler() : m_enabled(false) {}
+
+  struct SiteStats {
+    LockSite site;
+    bool shared;
+    MetricHistogram wait;
+    MetricHistogram hold;
+  };
+
+  typedef std::tuple<const char*, const char*, int, bool> Key;
+
+  std::atomic<bool> m_enabled;
+  mutable std::mutex m_mutex;
+  std::map<Key, std::unique_ptr<SiteStats>> m_sites;
+};
+
+// Times one acquisition on behalf of a guard
+class LockSample {
+public:
+  LockSample(const LockSite& site, bool shared) : m_site(site), m_shared(shared), m_profiled(LockProfiler::instance().enabled()) {
+    if (m_profiled) {
+      m_requested = std::chrono::steady_clock::now();
+    }
+  }
+
+  void acquired() {
+    if (m_profiled) {
+      m_acquired = std::chrono::steady_clock::now();
+    }
+  }
+
+  void released() {
+    if (m_profiled) {
+      LockProfiler::instance().record(m_site, m_shared, m_acquired - m_requested, std::chrono::steady_clock::now() - m_acquired);
+    }
+  }
+
+private:
+  const LockSite m_site;
+  const bool m_shared;
+  const bool m_profiled;
+  std::chrono::steady_clock::time_point m_requested;
+  std::chrono::steady_clock::time_point m_acquired;
+};
+
+// std::lock_guard that reports to the lock profiler
+template <typename Mutex>
+class ProfiledLockGuard {
+public:
+  ProfiledLockGuard(Mutex& mutex, const LockSite& site) : m_mutex(mutex), m_sample(site, false) {
+    m_mutex.lock();
+    m_sample.acquired();
+  }
+
+  ~ProfiledLockGuard() {
+    m_sample.released();
+    m_mutex.unlock();
+  }
+
+  ProfiledLockGuard(const ProfiledLockGuard&) = delete;
+  ProfiledLockGuard& operator=(const ProfiledLockGuard&) = delete;
+
+private:
+  Mutex& m_mutex;
+  LockSample m_sample;
+};
+
+// Shared ownership counterpart of ProfiledLockGuard
+template <typename Mutex>
+class ProfiledSharedLockGuard {
+public:
+  ProfiledSharedLockGuard(Mutex& mutex, const LockSite& site) : m_mutex(mutex), m_sample(site, true) {
+    m_mutex.lock_shared();
+    m_sample.acquired();
+  }
+
+  ~ProfiledSharedLockGuard() {
+    m_sample.released();
+    m_mutex.unlock_shared();
+  }
+
+  ProfiledSharedLockGuard(const ProfiledSharedLockGuard&) = delete;
+  ProfiledSharedLockGuard& operator=(const ProfiledSharedLockGuard&) = delete;
+
+private:
+  Mutex& m_mutex;
+  LockSample m_sample;
+};
+
+}
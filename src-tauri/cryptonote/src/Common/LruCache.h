@@ -0,0 +1,78 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace Common {
+
+// Fixed capacity map that evicts the least recently used entry. Not thread safe.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+  explicit LruCache(size_t capacity) : m_capacity(capacity) {
+  }
+
+  // copies the value out and marks the entry as most recently used
+  bool get(const Key& key, Value& value) {
+    auto it = m_index.find(key);
+    if (it == m_index.end()) {
+      return false;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    value = it->second->second;
+    return true;
+  }
+
+  void put(const Key& key, const Value& value) {
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+      it->second->second = value;
+      m_entries.splice(m_entries.begin(), m_entries, it->second);
+      return;
+    }
+
+    if (m_entries.size() == m_capacity) {
+      m_index.erase(m_entries.back().first);
+      m_entries.pop_back();
+    }
+
+    m_entries.emplace_front(key, value);
+    m_index.emplace(key, m_entries.begin());
+  }
+
+  void clear() {
+    m_index.clear();
+    m_entries.clear();
+  }
+
+  size_t size() const { return m_entries.size(); }
+
+private:
+  typedef std::list<std::pair<Key, Value>> Entries;
+
+  const size_t m_capacity;
+  Entries m_entries;   // most recently used first
+  std::unordered_map<Key, typename Entries::iterator, Hash> m_index;
+};
+
+}
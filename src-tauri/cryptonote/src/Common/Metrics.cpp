@@ -0,0 +1,140 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Metrics.h"
+
+#include <cstdio>
+
+namespace Common {
+
+namespace {
+
+std::string formatValue(double value) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.10g", value);
+  return buffer;
+}
+
+void appendHeader(std::string& out, const std::string& name, const char* type, const std::string& help) {
+  out += "# HELP " + name + " " + help + "\n";
+  out += "# TYPE " + name + " " + type + "\n";
+}
+
+std::string series(const std::string& name, const std::string& labels) {
+  return labels.empty() ? name : name + "{" + labels + "}";
+}
+
+std::string joinLabels(const std::string& labels, const std::string& extra) {
+  return labels.empty() ? extra : labels + "," + extra;
+}
+
+}
+
+const double MetricHistogram::BUCKET_BOUNDS[MetricHistogram::BUCKET_COUNT - 1] = {
+  0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 10
+};
+
+MetricHistogram::MetricHistogram() : m_count(0), m_sumNanoseconds(0) {
+  for (auto& bucket : m_buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void MetricHistogram::observe(std::chrono::steady_clock::duration duration) {
+  uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  double seconds = nanoseconds / 1e9;
+
+  size_t index = 0;
+  while (index < BUCKET_COUNT - 1 && seconds > BUCKET_BOUNDS[index]) {
+    ++index;
+  }
+
+  m_buckets[index].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_sumNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+Metrics& Metrics::instance() {
+  static Metrics metrics;
+  return metrics;
+}
+
+MetricCounter& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Family& family = m_families[name];
+  family.help = help;
+  std::unique_ptr<MetricCounter>& counter = family.counters[labels];
+  if (!counter) {
+    counter.reset(new MetricCounter());
+  }
+
+  return *counter;
+}
+
+MetricHistogram& Metrics::histogram(const std::string& name, const std::string& help, const std::string& labels) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Family& family = m_families[name];
+  family.help = help;
+  std::unique_ptr<MetricHistogram>& histogram = family.histograms[labels];
+  if (!histogram) {
+    histogram.reset(new MetricHistogram());
+  }
+
+  return *histogram;
+}
+
+void Metrics::exportText(std::string& out) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto& family : m_families) {
+    const std::string& name = family.first;
+    if (!family.second.counters.empty()) {
+      appendHeader(out, name, "counter", family.second.help);
+      for (const auto& counter : family.second.counters) {
+        out += series(name, counter.first) + " " + std::to_string(counter.second->value()) + "\n";
+      }
+    }
+
+    if (!family.second.histograms.empty()) {
+      appendHeader(out, name, "histogram", family.second.help);
+      for (const auto& entry : family.second.histograms) {
+        const MetricHistogram& histogram = *entry.second;
+        // buckets are read one by one while observers run, so +Inf is the running total rather than count()
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < MetricHistogram::BUCKET_COUNT; ++i) {
+          cumulative += histogram.bucket(i);
+          std::string bound = i + 1 < MetricHistogram::BUCKET_COUNT ? formatValue(MetricHistogram::BUCKET_BOUNDS[i]) : "+Inf";
+          out += series(name + "_bucket", joinLabels(entry.first, "le=\"" + bound + "\"")) + " " + std::to_string(cumulative) + "\n";
+        }
+
+        out += series(name + "_sum", entry.first) + " " + formatValue(histogram.sumSeconds()) + "\n";
+        out += series(name + "_count", entry.first) + " " + std::to_string(cumulative) + "\n";
+      }
+    }
+  }
+}
+
+void appendMetric(std::string& out, const std::string& name, const char* type, const std::string& help, double value,
+  const std::string& labels) {
+  // further series of a family written just before share its header
+  if (out.find("# TYPE " + name + " ") == std::string::npos) {
+    appendHeader(out, name, type, help);
+  }
+
+  out += series(name, labels) + " " + formatValue(value) + "\n";
+}
+
+}
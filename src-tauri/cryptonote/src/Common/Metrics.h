@@ -0,0 +1,154 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace Common {
+
+class MetricCounter {
+public:
+  MetricCounter() : m_value(0) {}
+
+  void add(uint64_t amount = 1) { m_value.fetch_add(amount, std::memory_order_relaxed); }
+  uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> m_value;
+};
+
+// Latency histogram over fixed buckets from 50us to 10s
+class MetricHistogram {
+public:
+  static const size_t BUCKET_COUNT = 17;
+  // upper bounds in seconds; the last bucket is +Inf
+  static const double BUCKET_BOUNDS[BUCKET_COUNT - 1];
+
+  MetricHistogram();
+
+  void observe(std::chrono::steady_clock::duration duration);
+
+  // non-cumulative bucket counts
+  uint64_t bucket(size_t index) const { return m_buckets[index].load(std::memory_order_relaxed); }
+  uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+  double sumSeconds() const { return m_sumNanoseconds.load(std::memory_order_relaxed) / 1e9; }
+
+private:
+  std::atomic<uint64_t> m_buckets[BUCKET_COUNT];
+  std::atomic<uint64_t> m_count;
+  std::atomic<uint64_t> m_sumNanoseconds;
+};
+
+// Process-wide metrics in the Prometheus text format. Looking a series up takes a lock, so hot
+// paths keep the returned reference, which stays valid for the life of the process.
+//
+// labels is the inside of the label braces, e.g. method="getinfo", and must already be escaped.
+class Metrics {
+public:
+  static Metrics& instance();
+
+  MetricCounter& counter(const std::string& name, const std::string& help, const std::string& labels = std::string());
+  MetricHistogram& histogram(const std::string& name, const std::string& help, const std::string& labels = std::string());
+
+  // appends every registered series
+  void exportText(std::string& out) const;
+
+private:
+  Metrics() {}
+
+  struct Family {
+    std::string help;
+    std::map<std::string, std::unique_ptr<MetricCounter>> counters;
+    std::map<std::string, std::unique_ptr<MetricHistogram>> histograms;
+  };
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, Family> m_families;
+};
+
+// For values read when the metrics are scraped rather than kept as series; the header is only
+// written for the first series of a family
+void appendMetric(std::string& out, const std::string& name, const char* type, const std::string& help, double value,
+  const std::string& labels = std::string());
+
+// Observes the time until destruction
+class MetricTimer {
+public:
+  explicit MetricTimer(MetricHistogram& histogram) : m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {}
+  ~MetricTimer() { m_histogram.observe(std::chrono::steady_clock::now() - m_start); }
+
+  MetricTimer(const MetricTimer&) = delete;
+  MetricTimer& operator=(const MetricTimer&) = delete;
+
+private:
+  MetricHistogram& m_histogram;
+  const std::chrono::steady_clock::time_point m_start;
+};
+
+// Mutex wrapper observing how long the outermost lock is held, for std::mutex and
+// std::recursive_mutex alike. The depth and start time are only touched by the owner.
+template <typename Mutex>
+class MeteredMutex {
+public:
+  explicit MeteredMutex(MetricHistogram& holdTime) : m_holdTime(holdTime), m_depth(0) {}
+
+  MeteredMutex(const MeteredMutex&) = delete;
+  MeteredMutex& operator=(const MeteredMutex&) = delete;
+
+  void lock() {
+    m_mutex.lock();
+    acquired();
+  }
+
+  bool try_lock() {
+    if (!m_mutex.try_lock()) {
+      return false;
+    }
+
+    acquired();
+    return true;
+  }
+
+  void unlock() {
+    if (--m_depth == 0) {
+      m_holdTime.observe(std::chrono::steady_clock::now() - m_acquired);
+    }
+
+    m_mutex.unlock();
+  }
+
+private:
+  void acquired() {
+    if (m_depth++ == 0) {
+      m_acquired = std::chrono::steady_clock::now();
+    }
+  }
+
+  Mutex m_mutex;
+  MetricHistogram& m_holdTime;
+  size_t m_depth;
+  std::chrono::steady_clock::time_point m_acquired;
+};
+
+}
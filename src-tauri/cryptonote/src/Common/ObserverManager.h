@@ -18,152 +18,173 @@
 #pragma once
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 namespace Tools {
 
-template<typename T>
-class ObserverManager {
+enum class ObserverDelivery {
+  SYNC,  // called on the notifying thread before notify returns
+  ASYNC  // queued and called in order on a thread of the observer's own
+};
+
+// Worker thread delivering the notifications of one asynchronous observer. stop() discards what is
+// still queued and returns once no call is in progress, unless it is called from a notification.
+class AsyncObserverQueue {
 public:
-  bool add(T* observer) {
-    std::unique_lock<std::mutex> lock(m_observersMutex);
-    auto it = std::find(m_observers.begin(), m_observers.end(), observer);
-    if (m_observers.end() == it) {
-      m_observers.push_back(observer);
-      return true;
-    } else {
-      return false;
-    }
+  static std::shared_ptr<AsyncObserverQueue> start() {
+    std::shared_ptr<AsyncObserverQueue> queue(new AsyncObserverQueue());
+    queue->m_thread = std::thread(&AsyncObserverQueue::run, queue);
+    return queue;
   }
 
-  bool remove(T* observer) {
-    std::unique_lock<std::mutex> lock(m_observersMutex);
-
-    auto it = std::find(m_observers.begin(), m_observers.end(), observer);
-    if (m_observers.end() == it) {
-      return false;
-    } else {
-      m_observers.erase(it);
-      return true;
+  void post(std::function<void()>&& notification) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_stopped) {
+      m_notifications.push_back(std::move(notification));
+      m_haveNotifications.notify_one();
     }
   }
 
-  void clear() {
-    std::unique_lock<std::mutex> lock(m_observersMutex);
-    m_observers.clear();
-  }
-
-#if defined(_MSC_VER)
-  template<typename F>
-  void notify(F notification) {
-    std::vector<T*> observersCopy;
+  void stop() {
     {
-      std::unique_lock<std::mutex> lock(m_observersMutex);
-      observersCopy = m_observers;
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (m_stopped) {
+        return;
+      }
+
+      m_stopped = true;
+      m_notifications.clear();
+      m_haveNotifications.notify_one();
     }
 
-    for (T* observer : observersCopy) {
-      (observer->*notification)();
+    if (m_thread.get_id() == std::this_thread::get_id()) {
+      m_thread.detach();
+    } else {
+      m_thread.join();
     }
   }
 
-  template<typename F, typename Arg0>
-  void notify(F notification, const Arg0& arg0) {
-    std::vector<T*> observersCopy;
-    {
-      std::unique_lock<std::mutex> lock(m_observersMutex);
-      observersCopy = m_observers;
-    }
+private:
+  AsyncObserverQueue() : m_stopped(false) {
+  }
 
-    for (T* observer : observersCopy) {
-      (observer->*notification)(arg0);
+  // the thread holds its own reference, so a queue stopped from a notification outlives the call
+  static void run(std::shared_ptr<AsyncObserverQueue> self) {
+    std::unique_lock<std::mutex> lock(self->m_mutex);
+    for (;;) {
+      self->m_haveNotifications.wait(lock, [&self] { return self->m_stopped || !self->m_notifications.empty(); });
+      if (self->m_stopped) {
+        return;
+      }
+
+      std::function<void()> notification = std::move(self->m_notifications.front());
+      self->m_notifications.pop_front();
+      lock.unlock();
+      notification();
+      lock.lock();
     }
   }
 
-  template<typename F, typename Arg0, typename Arg1>
-  void notify(F notification, const Arg0& arg0, const Arg1& arg1) {
-    std::vector<T*> observersCopy;
-    {
-      std::unique_lock<std::mutex> lock(m_observersMutex);
-      observersCopy = m_observers;
-    }
+  std::mutex m_mutex;
+  std::condition_variable m_haveNotifications;
+  std::deque<std::function<void()>> m_notifications;
+  bool m_stopped;
+  std::thread m_thread;
+};
 
-    for (T* observer : observersCopy) {
-      (observer->*notification)(arg0, arg1);
-    }
+// Observer list published copy on write: add and remove build a new list under a mutex, notify
+// only takes a reference to the current one, so it neither locks nor allocates for synchronous
+// observers. An observer removed while a notification is in flight may still receive it.
+template<typename T>
+class ObserverManager {
+public:
+  ObserverManager() : m_observers(std::make_shared<const ObserverList>()) {
   }
 
-  template<typename F, typename Arg0, typename Arg1, typename Arg2>
-  void notify(F notification, const Arg0& arg0, const Arg1& arg1, const Arg2& arg2) {
-    std::vector<T*> observersCopy;
-    {
-      std::unique_lock<std::mutex> lock(m_observersMutex);
-      observersCopy = m_observers;
-    }
+  ~ObserverManager() {
+    clear();
+  }
 
-    for (T* observer : observersCopy) {
-      (observer->*notification)(arg0, arg1, arg2);
+  bool add(T* observer, ObserverDelivery delivery = ObserverDelivery::SYNC) {
+    std::unique_lock<std::mutex> lock(m_observersMutex);
+    const ObserverList& observers = *m_observers;
+    auto it = std::find_if(observers.begin(), observers.end(), [observer](const Entry& entry) { return entry.observer == observer; });
+    if (observers.end() == it) {
+      std::shared_ptr<ObserverList> updated = std::make_shared<ObserverList>(observers);
+      Entry entry = { observer, delivery == ObserverDelivery::ASYNC ? AsyncObserverQueue::start() : nullptr };
+      updated->push_back(entry);
+      publish(updated);
+      return true;
+    } else {
+      return false;
     }
   }
 
-  template<typename F, typename Arg0, typename Arg1, typename Arg2, typename Arg3>
-  void notify(F notification, const Arg0& arg0, const Arg1& arg1, const Arg2& arg2, const Arg3& arg3) {
-    std::vector<T*> observersCopy;
-    {
-      std::unique_lock<std::mutex> lock(m_observersMutex);
-      observersCopy = m_observers;
-    }
+  bool remove(T* observer) {
+    std::unique_lock<std::mutex> lock(m_observersMutex);
+    const ObserverList& observers = *m_observers;
+    auto it = std::find_if(observers.begin(), observers.end(), [observer](const Entry& entry) { return entry.observer == observer; });
+    if (observers.end() == it) {
+      return false;
+    } else {
+      std::shared_ptr<AsyncObserverQueue> queue = it->queue;
+      std::shared_ptr<ObserverList> updated = std::make_shared<ObserverList>(observers);
+      updated->erase(updated->begin() + (it - observers.begin()));
+      publish(updated);
+      lock.unlock();
+
+      if (queue) {
+        queue->stop();
+      }
 
-    for (T* observer : observersCopy) {
-      (observer->*notification)(arg0, arg1, arg2, arg3);
+      return true;
     }
   }
 
-  template<typename F, typename Arg0, typename Arg1, typename Arg2, typename Arg3, typename Arg4>
-  void notify(F notification, const Arg0& arg0, const Arg1& arg1, const Arg2& arg2, const Arg3& arg3, const Arg4& arg4) {
-    std::vector<T*> observersCopy;
-    {
-      std::unique_lock<std::mutex> lock(m_observersMutex);
-      observersCopy = m_observers;
-    }
+  void clear() {
+    std::unique_lock<std::mutex> lock(m_observersMutex);
+    std::shared_ptr<const ObserverList> observers = m_observers;
+    publish(std::make_shared<ObserverList>());
+    lock.unlock();
 
-    for (T* observer : observersCopy) {
-      (observer->*notification)(arg0, arg1, arg2, arg3, arg4);
+    for (const Entry& entry : *observers) {
+      if (entry.queue) {
+        entry.queue->stop();
+      }
     }
   }
 
-  template<typename F, typename Arg0, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
-  void notify(F notification, const Arg0& arg0, const Arg1& arg1, const Arg2& arg2, const Arg3& arg3, const Arg4& arg4, const Arg5& arg5) {
-    std::vector<T*> observersCopy;
-    {
-      std::unique_lock<std::mutex> lock(m_observersMutex);
-      observersCopy = m_observers;
-    }
-
-    for (T* observer : observersCopy) {
-      (observer->*notification)(arg0, arg1, arg2, arg3, arg4, arg5);
+  template<typename F, typename... Args>
+  void notify(F notification, const Args&... args) {
+    std::shared_ptr<const ObserverList> observers = std::atomic_load(&m_observers);
+    for (const Entry& entry : *observers) {
+      if (entry.queue) {
+        entry.queue->post(std::bind(notification, entry.observer, args...));
+      } else {
+        (entry.observer->*notification)(args...);
+      }
     }
   }
 
-#else
+private:
+  struct Entry {
+    T* observer;
+    std::shared_ptr<AsyncObserverQueue> queue;
+  };
 
-  template<typename F, typename... Args>
-  void notify(F notification, Args... args) {
-    std::vector<T*> observersCopy;
-    {
-      std::unique_lock<std::mutex> lock(m_observersMutex);
-      observersCopy = m_observers;
-    }
+  typedef std::vector<Entry> ObserverList;
 
-    for (T* observer : observersCopy) {
-      (observer->*notification)(args...);
-    }
+  void publish(std::shared_ptr<const ObserverList> observers) {
+    std::atomic_store(&m_observers, std::move(observers));
   }
-#endif
 
-private:
-  std::vector<T*> m_observers;
+  std::shared_ptr<const ObserverList> m_observers;
   std::mutex m_observersMutex;
 };
 
@@ -0,0 +1,140 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "RecursiveSharedMutex.h"
+
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+
+#include "Metrics.h"
+
+namespace Common {
+
+RecursiveSharedMutex::RecursiveSharedMutex() : m_writerDepth(0), m_waitingWriters(0), m_readers(0), m_waitStats(), m_holdTime(nullptr) {
+}
+
+// the clock is only read when the caller actually blocks
+template <typename Predicate>
+bool RecursiveSharedMutex::wait(std::condition_variable& condition, std::unique_lock<std::mutex>& lock, Predicate ready,
+  uint64_t& waitMicroseconds) {
+  if (ready()) {
+    return false;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  condition.wait(lock, ready);
+  waitMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  return true;
+}
+
+void RecursiveSharedMutex::lock() {
+  const std::thread::id self = std::this_thread::get_id();
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  if (m_writerDepth != 0 && m_writer == self) {
+    ++m_writerDepth;
+    return;
+  }
+
+  if (m_readerDepth.count(self) != 0) {
+    throw std::logic_error("RecursiveSharedMutex: shared lock can't be upgraded to exclusive");
+  }
+
+  ++m_waitingWriters;
+  bool waited = wait(m_writerDone, lock, [this] { return m_writerDepth == 0; }, m_waitStats.exclusiveWaitMicroseconds);
+  // claim the lock before the readers drain so that new readers queue up behind us
+  m_writer = self;
+  m_writerDepth = 1;
+  --m_waitingWriters;
+  waited = wait(m_readersDone, lock, [this] { return m_readers == 0; }, m_waitStats.exclusiveWaitMicroseconds) || waited;
+  if (waited) {
+    ++m_waitStats.exclusiveWaits;
+  }
+
+  if (m_holdTime != nullptr) {
+    m_writerAcquired = std::chrono::steady_clock::now();
+  }
+}
+
+void RecursiveSharedMutex::unlock() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  assert(m_writerDepth != 0 && m_writer == std::this_thread::get_id());
+
+  if (--m_writerDepth == 0) {
+    if (m_holdTime != nullptr) {
+      m_holdTime->observe(std::chrono::steady_clock::now() - m_writerAcquired);
+    }
+
+    m_writer = std::thread::id();
+    lock.unlock();
+    m_writerDone.notify_all();
+  }
+}
+
+void RecursiveSharedMutex::lock_shared() {
+  const std::thread::id self = std::this_thread::get_id();
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  // nested inside our own exclusive lock: nothing else can run anyway
+  if (m_writerDepth != 0 && m_writer == self) {
+    ++m_writerDepth;
+    return;
+  }
+
+  auto it = m_readerDepth.find(self);
+  if (it != m_readerDepth.end()) {
+    ++it->second;
+    return;
+  }
+
+  if (wait(m_writerDone, lock, [this] { return m_writerDepth == 0 && m_waitingWriters == 0; }, m_waitStats.sharedWaitMicroseconds)) {
+    ++m_waitStats.sharedWaits;
+  }
+
+  m_readerDepth.emplace(self, 1);
+  ++m_readers;
+}
+
+void RecursiveSharedMutex::unlock_shared() {
+  const std::thread::id self = std::this_thread::get_id();
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  if (m_writerDepth != 0 && m_writer == self) {
+    --m_writerDepth;
+    return;
+  }
+
+  auto it = m_readerDepth.find(self);
+  assert(it != m_readerDepth.end());
+  if (--it->second != 0) {
+    return;
+  }
+
+  m_readerDepth.erase(it);
+  if (--m_readers == 0) {
+    lock.unlock();
+    m_readersDone.notify_all();
+  }
+}
+
+RecursiveSharedMutex::WaitStats RecursiveSharedMutex::waitStats() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_waitStats;
+}
+
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace Common {
+
+class MetricHistogram;
+
+// Reader/writer mutex that keeps the reentrancy of std::recursive_mutex:
+// - the exclusive owner may lock again, exclusively or shared;
+// - a thread holding a shared lock may take it shared again, even while a writer waits.
+// Upgrading a shared lock to exclusive is not supported and throws std::logic_error.
+// Waiting writers block new readers, so a steady read load cannot starve block processing.
+class RecursiveSharedMutex {
+public:
+  // Time callers spent blocked on other holders, counted only for calls that had to wait
+  struct WaitStats {
+    uint64_t exclusiveWaits;
+    uint64_t exclusiveWaitMicroseconds;
+    uint64_t sharedWaits;
+    uint64_t sharedWaitMicroseconds;
+  };
+
+  RecursiveSharedMutex();
+
+  RecursiveSharedMutex(const RecursiveSharedMutex&) = delete;
+  RecursiveSharedMutex& operator=(const RecursiveSharedMutex&) = delete;
+
+  void lock();
+  void unlock();
+
+  void lock_shared();
+  void unlock_shared();
+
+  WaitStats waitStats();
+  // observes how long each outermost exclusive lock is held; set before the mutex is shared between threads
+  void setHoldTimeHistogram(MetricHistogram* histogram) { m_holdTime = histogram; }
+
+private:
+  template <typename Predicate>
+  bool wait(std::condition_variable& condition, std::unique_lock<std::mutex>& lock, Predicate ready, uint64_t& waitMicroseconds);
+
+  std::mutex m_mutex;
+  std::condition_variable m_readersDone;
+  std::condition_variable m_writerDone;
+
+  std::thread::id m_writer;
+  size_t m_writerDepth;
+  size_t m_waitingWriters;
+  size_t m_readers;
+  std::unordered_map<std::thread::id, size_t> m_readerDepth;
+  WaitStats m_waitStats;
+  MetricHistogram* m_holdTime;
+  std::chrono::steady_clock::time_point m_writerAcquired;
+};
+
+// C++11 counterpart of std::shared_lock for scoped shared ownership
+template <typename Mutex>
+class SharedLockGuard {
+public:
+  explicit SharedLockGuard(Mutex& mutex) : m_mutex(mutex) {
+    m_mutex.lock_shared();
+  }
+
+  ~SharedLockGuard() {
+    m_mutex.unlock_shared();
+  }
+
+  SharedLockGuard(const SharedLockGuard&) = delete;
+  SharedLockGuard& operator=(const SharedLockGuard&) = delete;
+
+private:
+  Mutex& m_mutex;
+};
+
+}
@@ -230,21 +230,27 @@ void write(IOutputStream& out, const std::string& data) {
 }
 
 void writeVarint(IOutputStream& out, uint32_t value) {
+  uint8_t buffer[5];
+  size_t size = 0;
   while (value >= 0x80) {
-    write(out, static_cast<uint8_t>(value | 0x80));
+    buffer[size++] = static_cast<uint8_t>(value | 0x80);
     value >>= 7;
   }
 
-  write(out, static_cast<uint8_t>(value));
+  buffer[size++] = static_cast<uint8_t>(value);
+  write(out, buffer, size);
 }
 
 void writeVarint(IOutputStream& out, uint64_t value) {
+  uint8_t buffer[10];
+  size_t size = 0;
   while (value >= 0x80) {
-    write(out, static_cast<uint8_t>(value | 0x80));
+    buffer[size++] = static_cast<uint8_t>(value | 0x80);
     value >>= 7;
   }
 
-  write(out, static_cast<uint8_t>(value));
+  buffer[size++] = static_cast<uint8_t>(value);
+  write(out, buffer, size);
 }
 
 }
@@ -19,6 +19,12 @@
 #include <fstream>
 #include <iomanip>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace Common {
 
 namespace {
@@ -42,6 +48,114 @@ const uint8_t characterValues[256] = {
   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
 };
 
+const char hexDigits[] = "0123456789abcdef";
+
+// Both codecs take 16 bytes (32 characters) per step and finish the tail with the tables
+
+void encodeHex(const uint8_t* data, size_t size, char* hex) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  const __m128i nine = _mm_set1_epi8(9);
+  const __m128i digitBase = _mm_set1_epi8('0');
+  const __m128i letterOffset = _mm_set1_epi8('a' - '0' - 10);
+  for (; i + 16 <= size; i += 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+    __m128i low = _mm_and_si128(bytes, mask);
+    high = _mm_add_epi8(_mm_add_epi8(high, digitBase), _mm_and_si128(_mm_cmpgt_epi8(high, nine), letterOffset));
+    low = _mm_add_epi8(_mm_add_epi8(low, digitBase), _mm_and_si128(_mm_cmpgt_epi8(low, nine), letterOffset));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(hex + 2 * i), _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(hex + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  const uint8x16_t table = vld1q_u8(reinterpret_cast<const uint8_t*>(hexDigits));
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t bytes = vld1q_u8(data + i);
+    uint8x16x2_t characters;
+    characters.val[0] = vqtbl1q_u8(table, vshrq_n_u8(bytes, 4));
+    characters.val[1] = vqtbl1q_u8(table, vandq_u8(bytes, vdupq_n_u8(0x0f)));
+    vst2q_u8(reinterpret_cast<uint8_t*>(hex + 2 * i), characters);
+  }
+#endif
+
+  for (; i < size; ++i) {
+    hex[2 * i] = hexDigits[data[i] >> 4];
+    hex[2 * i + 1] = hexDigits[data[i] & 15];
+  }
+}
+
+// Decodes 'size' bytes from 2 * 'size' characters, returns false on a non-hex character
+bool decodeHex(const char* text, size_t size, uint8_t* data) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  // the unsigned range checks are done as signed ones on values shifted by 0x80
+  const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+  const __m128i digitLimit = _mm_set1_epi8(static_cast<char>(0x80 + 10));
+  const __m128i letterLimit = _mm_set1_epi8(static_cast<char>(0x80 + 6));
+  const __m128i digitBase = _mm_set1_epi8('0');
+  const __m128i letterBase = _mm_set1_epi8('a');
+  const __m128i ten = _mm_set1_epi8(10);
+  const __m128i lowerCase = _mm_set1_epi8(0x20);
+  const __m128i lowByte = _mm_set1_epi16(0x00ff);
+  for (; i + 16 <= size; i += 16) {
+    __m128i pairs[2];
+    int invalid = 0;
+    for (int half = 0; half < 2; ++half) {
+      __m128i characters = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + 2 * i + 16 * half));
+      __m128i digits = _mm_sub_epi8(characters, digitBase);
+      __m128i letters = _mm_sub_epi8(_mm_or_si128(characters, lowerCase), letterBase);
+      __m128i isDigit = _mm_cmplt_epi8(_mm_xor_si128(digits, bias), digitLimit);
+      __m128i isLetter = _mm_cmplt_epi8(_mm_xor_si128(letters, bias), letterLimit);
+      invalid |= _mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) ^ 0xffff;
+      __m128i nibbles = _mm_or_si128(_mm_and_si128(isDigit, digits), _mm_and_si128(isLetter, _mm_add_epi8(letters, ten)));
+      // each 16-bit lane holds the high nibble in its low byte and the low nibble in its high byte
+      pairs[half] = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(nibbles, 4), _mm_srli_epi16(nibbles, 8)), lowByte);
+    }
+
+    if (invalid != 0) {
+      return false;
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_packus_epi16(pairs[0], pairs[1]));
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  const uint8x16_t ten = vdupq_n_u8(10);
+  const uint8x16_t six = vdupq_n_u8(6);
+  for (; i + 16 <= size; i += 16) {
+    uint8x16x2_t characters = vld2q_u8(reinterpret_cast<const uint8_t*>(text + 2 * i));
+    uint8x16_t nibbles[2];
+    uint8x16_t valid = vdupq_n_u8(0xff);
+    for (int half = 0; half < 2; ++half) {
+      uint8x16_t digits = vsubq_u8(characters.val[half], vdupq_n_u8('0'));
+      uint8x16_t letters = vsubq_u8(vorrq_u8(characters.val[half], vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+      uint8x16_t isDigit = vcltq_u8(digits, ten);
+      uint8x16_t isLetter = vcltq_u8(letters, six);
+      valid = vandq_u8(valid, vorrq_u8(isDigit, isLetter));
+      nibbles[half] = vorrq_u8(vandq_u8(isDigit, digits), vandq_u8(isLetter, vaddq_u8(letters, ten)));
+    }
+
+    if (vminvq_u8(valid) == 0) {
+      return false;
+    }
+
+    vst1q_u8(data + i, vorrq_u8(vshlq_n_u8(nibbles[0], 4), nibbles[1]));
+  }
+#endif
+
+  for (; i < size; ++i) {
+    uint8_t high = characterValues[static_cast<unsigned char>(text[2 * i])];
+    uint8_t low = characterValues[static_cast<unsigned char>(text[2 * i + 1])];
+    if ((high | low) > 0x0f) {
+      return false;
+    }
+
+    data[i] = high << 4 | low;
+  }
+
+  return true;
+}
+
 }
 
 std::string asString(const void* data, size_t size) {
@@ -84,8 +198,8 @@ size_t fromHex(const std::string& text, void* data, size_t bufferSize) {
     throw std::runtime_error("fromHex: invalid buffer size");
   }
 
-  for (size_t i = 0; i < text.size() >> 1; ++i) {
-    static_cast<uint8_t*>(data)[i] = fromHex(text[i << 1]) << 4 | fromHex(text[(i << 1) + 1]);
+  if (!decodeHex(text.data(), text.size() >> 1, static_cast<uint8_t*>(data))) {
+    throw std::runtime_error("fromHex: invalid character");
   }
 
   return text.size() >> 1;
@@ -100,18 +214,8 @@ bool fromHex(const std::string& text, void* data, size_t bufferSize, size_t& siz
     return false;
   }
 
-  for (size_t i = 0; i < text.size() >> 1; ++i) {
-    uint8_t value1;
-    if (!fromHex(text[i << 1], value1)) {
-      return false;
-    }
-
-    uint8_t value2;
-    if (!fromHex(text[(i << 1) + 1], value2)) {
-      return false;
-    }
-
-    static_cast<uint8_t*>(data)[i] = value1 << 4 | value2;
+  if (!decodeHex(text.data(), text.size() >> 1, static_cast<uint8_t*>(data))) {
+    return false;
   }
 
   size = text.size() >> 1;
@@ -124,8 +228,8 @@ std::vector<uint8_t> fromHex(const std::string& text) {
   }
 
   std::vector<uint8_t> data(text.size() >> 1);
-  for (size_t i = 0; i < data.size(); ++i) {
-    data[i] = fromHex(text[i << 1]) << 4 | fromHex(text[(i << 1) + 1]);
+  if (!decodeHex(text.data(), data.size(), data.data())) {
+    throw std::runtime_error("fromHex: invalid character");
   }
 
   return data;
@@ -136,55 +240,42 @@ bool fromHex(const std::string& text, std::vector<uint8_t>& data) {
     return false;
   }
 
-  for (size_t i = 0; i < text.size() >> 1; ++i) {
-    uint8_t value1;
-    if (!fromHex(text[i << 1], value1)) {
-      return false;
-    }
-
-    uint8_t value2;
-    if (!fromHex(text[(i << 1) + 1], value2)) {
-      return false;
-    }
-
-    data.push_back(value1 << 4 | value2);
+  size_t offset = data.size();
+  data.resize(offset + (text.size() >> 1));
+  if (!decodeHex(text.data(), text.size() >> 1, data.data() + offset)) {
+    data.resize(offset);
+    return false;
   }
 
   return true;
 }
 
-std::string toHex(const void* data, size_t size) {
-  std::string text;
-  for (size_t i = 0; i < size; ++i) {
-    text += "0123456789abcdef"[static_cast<const uint8_t*>(data)[i] >> 4];
-    text += "0123456789abcdef"[static_cast<const uint8_t*>(data)[i] & 15];
-  }
+bool fromHex(const char* text, size_t textSize, void* data) {
+  return (textSize & 1) == 0 && decodeHex(text, textSize >> 1, static_cast<uint8_t*>(data));
+}
+
+void toHex(const void* data, size_t size, char* hex) {
+  encodeHex(static_cast<const uint8_t*>(data), size, hex);
+}
 
+std::string toHex(const void* data, size_t size) {
+  std::string text(size * 2, '\0');
+  encodeHex(static_cast<const uint8_t*>(data), size, &text[0]);
   return text;
 }
 
 void toHex(const void* data, size_t size, std::string& text) {
-  for (size_t i = 0; i < size; ++i) {
-    text += "0123456789abcdef"[static_cast<const uint8_t*>(data)[i] >> 4];
-    text += "0123456789abcdef"[static_cast<const uint8_t*>(data)[i] & 15];
-  }
+  size_t offset = text.size();
+  text.resize(offset + size * 2);
+  encodeHex(static_cast<const uint8_t*>(data), size, &text[offset]);
 }
 
 std::string toHex(const std::vector<uint8_t>& data) {
-  std::string text;
-  for (size_t i = 0; i < data.size(); ++i) {
-    text += "0123456789abcdef"[data[i] >> 4];
-    text += "0123456789abcdef"[data[i] & 15];
-  }
-
-  return text;
+  return toHex(data.data(), data.size());
 }
 
 void toHex(const std::vector<uint8_t>& data, std::string& text) {
-  for (size_t i = 0; i < data.size(); ++i) {
-    text += "0123456789abcdef"[data[i] >> 4];
-    text += "0123456789abcdef"[data[i] & 15];
-  }
+  toHex(data.data(), data.size(), text);
 }
 
 std::string extract(std::string& text, char delimiter) {
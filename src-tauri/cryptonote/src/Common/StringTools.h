@@ -34,6 +34,7 @@ size_t fromHex(const std::string& text, void* data, size_t bufferSize); // Assig
 bool fromHex(const std::string& text, void* data, size_t bufferSize, size_t& size); // Assigns values of hex 'text' to buffer 'data' up to 'bufferSize', assigns actual data size to 'size', returns false on error, does not throw
 std::vector<uint8_t> fromHex(const std::string& text); // Returns values of hex 'text', throws on error
 bool fromHex(const std::string& text, std::vector<uint8_t>& data); // Appends values of hex 'text' to 'data', returns false on error, does not throw
+bool fromHex(const char* text, size_t textSize, void* data); // Assigns values of hex ('text', 'textSize') to buffer 'data' of at least 'textSize' / 2 bytes, returns false on error, does not throw
 
 template <typename T>
 bool podFromHex(const std::string& text, T& val) {
@@ -45,12 +46,18 @@ std::string toHex(const void* data, size_t size); // Returns hex representation
 void toHex(const void* data, size_t size, std::string& text); // Appends hex representation of ('data', 'size') to 'text', does not throw
 std::string toHex(const std::vector<uint8_t>& data); // Returns hex representation of 'data', does not throw
 void toHex(const std::vector<uint8_t>& data, std::string& text); // Appends hex representation of 'data' to 'text', does not throw
+void toHex(const void* data, size_t size, char* hex); // Writes the 2 * 'size' characters of the hex representation of ('data', 'size') to 'hex', does not throw
 
 template<class T>
 std::string podToHex(const T& s) {
   return toHex(&s, sizeof(s));
 }
 
+template<class T>
+void podToHex(const T& s, std::string& text) {
+  toHex(&s, sizeof(s), text);
+}
+
 std::string extract(std::string& text, char delimiter); // Does not throw
 std::string extract(const std::string& text, char delimiter, size_t& offset); // Does not throw
 
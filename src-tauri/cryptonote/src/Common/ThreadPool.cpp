@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "ThreadPool.h"
+
+namespace Common {
+
+namespace {
+
+size_t defaultWorkerCount() {
+  size_t count = std::thread::hardware_concurrency();
+  return count == 0 ? 2 : count;
+}
+
+}
+
+ThreadPool::ThreadPool(size_t workerCount, size_t queueDepth) :
+  m_queueCapacity(queueDepth != 0 ? queueDepth : 2 * (workerCount != 0 ? workerCount : defaultWorkerCount())),
+  m_tasks(m_queueCapacity),
+  m_activeWorkers(0),
+  m_completedTasks(0),
+  m_busyMicroseconds(0),
+  m_startTime(std::chrono::steady_clock::now()) {
+
+  if (workerCount == 0) {
+    workerCount = defaultWorkerCount();
+  }
+
+  m_workers.reserve(workerCount);
+  for (size_t i = 0; i < workerCount; ++i) {
+    m_workers.emplace_back(&ThreadPool::workerProcedure, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  m_tasks.close();
+
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+ThreadPool::Stats ThreadPool::getStats() const {
+  Stats stats;
+  stats.workerCount = m_workers.size();
+  stats.queueCapacity = m_queueCapacity;
+  stats.queuedTasks = m_tasks.size();
+  stats.activeWorkers = m_activeWorkers.load();
+  stats.completedTasks = m_completedTasks.load();
+  stats.busyMicroseconds = m_busyMicroseconds.load();
+  stats.uptimeMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - m_startTime).count();
+  return stats;
+}
+
+void ThreadPool::enqueue(std::function<void()>&& task) {
+  if (!m_tasks.push(std::move(task))) {
+    throw std::runtime_error("ThreadPool is stopped");
+  }
+}
+
+void ThreadPool::workerProcedure() {
+  std::function<void()> task;
+  // remaining tasks are drained before the workers exit
+  while (m_tasks.pop(task)) {
+    ++m_activeWorkers;
+    auto start = std::chrono::steady_clock::now();
+    task();
+    m_busyMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    --m_activeWorkers;
+    ++m_completedTasks;
+    task = nullptr;
+  }
+}
+
+}
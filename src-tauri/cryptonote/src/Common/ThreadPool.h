@@ -0,0 +1,81 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <stdexcept>
+#include <vector>
+
+#include "BoundedMpmcQueue.h"
+
+namespace Common {
+
+// Long-lived worker pool with a bounded lock-free task queue. submit() blocks while
+// the queue is full, which gives producers natural back-pressure.
+class ThreadPool {
+public:
+  struct Stats {
+    size_t workerCount;
+    size_t queueCapacity;
+    size_t queuedTasks;
+    size_t activeWorkers;
+    uint64_t completedTasks;
+    uint64_t busyMicroseconds;   // summed over all workers
+    uint64_t uptimeMicroseconds;
+  };
+
+  // workerCount == 0 selects hardware_concurrency(), queueDepth == 0 selects 2 * workerCount
+  explicit ThreadPool(size_t workerCount = 0, size_t queueDepth = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  template <typename F>
+  std::future<typename std::result_of<F()>::type> submit(F&& task) {
+    typedef typename std::result_of<F()>::type Result;
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> result = packaged->get_future();
+    enqueue([packaged] { (*packaged)(); });
+    return result;
+  }
+
+  size_t workerCount() const { return m_workers.size(); }
+  Stats getStats() const;
+
+private:
+  void enqueue(std::function<void()>&& task);
+  void workerProcedure();
+
+  const size_t m_queueCapacity;
+  BoundedMpmcQueue<std::function<void()>> m_tasks;
+  std::vector<std::thread> m_workers;
+
+  std::atomic<size_t> m_activeWorkers;
+  std::atomic<uint64_t> m_completedTasks;
+  std::atomic<uint64_t> m_busyMicroseconds;
+  const std::chrono::steady_clock::time_point m_startTime;
+};
+
+}
@@ -0,0 +1,155 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Tracing.h"
+
+#include <sstream>
+
+namespace Common {
+
+namespace {
+
+std::atomic<uint32_t> nextThreadIndex(1);
+
+thread_local TraceContext threadContext;
+thread_local uint32_t threadIndex = 0;
+
+uint32_t currentThreadIndex() {
+  if (threadIndex == 0) {
+    threadIndex = nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  return threadIndex;
+}
+
+void writeJsonString(std::ostringstream& out, const char* text) {
+  out << '"';
+  for (const char* p = text; *p != '\0'; ++p) {
+    if (*p == '"' || *p == '\\') {
+      out << '\\' << *p;
+    } else if (static_cast<unsigned char>(*p) >= 0x20) {
+      out << *p;
+    }
+  }
+  out << '"';
+}
+
+}
+
+Tracer& Tracer::instance() {
+  static Tracer tracer;
+  return tracer;
+}
+
+Tracer::Tracer() : m_epoch(std::chrono::steady_clock::now()), m_enabled(true), m_nextId(1) {
+}
+
+uint64_t Tracer::nowMicroseconds() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+void Tracer::record(const TraceSpan& span) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_spans.size() == MAX_SPANS) {
+    m_spans.pop_front();
+  }
+
+  m_spans.push_back(span);
+}
+
+std::vector<TraceSpan> Tracer::spans(uint64_t traceId) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<TraceSpan> result;
+  for (const TraceSpan& span : m_spans) {
+    if (traceId == 0 || span.traceId == traceId) {
+      result.push_back(span);
+    }
+  }
+
+  return result;
+}
+
+void Tracer::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_spans.clear();
+}
+
+std::string Tracer::exportChromeTrace(uint64_t traceId) const {
+  std::ostringstream out;
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  bool first = true;
+  for (const TraceSpan& span : spans(traceId)) {
+    out << (first ? "" : ",") << "{\"name\":";
+    writeJsonString(out, span.name);
+    out << ",\"cat\":\"fuego\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.threadIndex <<
+      ",\"ts\":" << span.startMicroseconds << ",\"dur\":" << span.durationMicroseconds <<
+      ",\"args\":{\"trace_id\":" << span.traceId << ",\"span_id\":" << span.spanId <<
+      ",\"parent_id\":" << span.parentId << "}}";
+    first = false;
+  }
+
+  out << "]}";
+  return out.str();
+}
+
+TraceContext currentTraceContext() {
+  return threadContext;
+}
+
+ScopedSpan::ScopedSpan(const char* name) : m_span(), m_active(false), m_current(false) {
+  if (Tracer::instance().enabled()) {
+    m_previous = threadContext;
+    open(name, m_previous);
+    threadContext = context();
+    m_current = true;
+  }
+}
+
+ScopedSpan::ScopedSpan(const char* name, const TraceContext& parent) : m_span(), m_active(false), m_current(false) {
+  if (Tracer::instance().enabled()) {
+    open(name, parent);
+  }
+}
+
+ScopedSpan::~ScopedSpan() {
+  if (!m_active) {
+    return;
+  }
+
+  Tracer& tracer = Tracer::instance();
+  m_span.durationMicroseconds = tracer.nowMicroseconds() - m_span.startMicroseconds;
+  tracer.record(m_span);
+
+  if (m_current) {
+    threadContext = m_previous;
+  }
+}
+
+void ScopedSpan::open(const char* name, const TraceContext& parent) {
+  Tracer& tracer = Tracer::instance();
+  m_span.name = name;
+  m_span.spanId = tracer.nextId();
+  m_span.traceId = parent.valid() ? parent.traceId : m_span.spanId;
+  m_span.parentId = parent.valid() ? parent.spanId : 0;
+  m_span.threadIndex = currentThreadIndex();
+  m_span.startMicroseconds = tracer.nowMicroseconds();
+  m_span.durationMicroseconds = 0;
+  m_active = true;
+}
+
+}
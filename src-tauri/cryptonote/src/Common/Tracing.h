@@ -0,0 +1,115 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Common {
+
+// Identifies a span within a trace. A zero traceId means "no trace".
+struct TraceContext {
+  uint64_t traceId;
+  uint64_t spanId;
+
+  TraceContext() : traceId(0), spanId(0) {}
+  TraceContext(uint64_t trace, uint64_t span) : traceId(trace), spanId(span) {}
+
+  bool valid() const { return traceId != 0; }
+};
+
+struct TraceSpan {
+  const char* name;            // must have static storage duration
+  uint64_t traceId;
+  uint64_t spanId;
+  uint64_t parentId;           // 0 for the root of a trace
+  uint32_t threadIndex;
+  uint64_t startMicroseconds;  // since the tracer was created
+  uint64_t durationMicroseconds;
+};
+
+// Process-wide recorder for finished spans. Keeps the most recent spans in a
+// bounded buffer and exports them as Chrome trace JSON (chrome://tracing,
+// Perfetto).
+class Tracer {
+public:
+  static Tracer& instance();
+
+  void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+  bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+  uint64_t nextId() { return m_nextId.fetch_add(1, std::memory_order_relaxed); }
+  uint64_t nowMicroseconds() const;
+
+  void record(const TraceSpan& span);
+  std::vector<TraceSpan> spans(uint64_t traceId = 0) const;
+  void clear();
+
+  // traceId == 0 exports every retained span
+  std::string exportChromeTrace(uint64_t traceId = 0) const;
+
+private:
+  Tracer();
+
+  static const size_t MAX_SPANS = 8192;
+
+  const std::chrono::steady_clock::time_point m_epoch;
+  std::atomic<bool> m_enabled;
+  std::atomic<uint64_t> m_nextId;
+  mutable std::mutex m_mutex;
+  std::deque<TraceSpan> m_spans;
+};
+
+// The span code on this thread is currently running under
+TraceContext currentTraceContext();
+
+// Times the enclosing scope and records it with the tracer.
+//
+// The name-only form nests under the thread's current span (starting a new
+// trace if there is none) and becomes the current span until destroyed.
+// Code on System::Dispatcher contexts that may yield while a span is open
+// should capture currentTraceContext() before yielding and use the explicit
+// form, which records a child of parent without touching the thread's
+// current span.
+class ScopedSpan {
+public:
+  explicit ScopedSpan(const char* name);
+  ScopedSpan(const char* name, const TraceContext& parent);
+  ~ScopedSpan();
+
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+  // Context for children of this span; invalid when tracing is disabled
+  TraceContext context() const { return TraceContext(m_span.traceId, m_span.spanId); }
+
+private:
+  void open(const char* name, const TraceContext& parent);
+
+  TraceSpan m_span;
+  TraceContext m_previous;
+  bool m_active;
+  bool m_current;
+};
+
+}
@@ -15,6 +15,10 @@
 // You should have received a copy of the GNU General Public License
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <chrono>
+#include <set>
+
 #include <boost/optional.hpp>
 #include <boost/program_options.hpp>
 
@@ -34,6 +38,7 @@
 #include "crypto/crypto.h"
 #include "P2p/P2pProtocolDefinitions.h"
 #include "P2p/LevinProtocol.h"
+#include "P2p/P2pNetworks.h"
 #include "Rpc/CoreRpcServerCommandsDefinitions.h"
 #include "Rpc/HttpClient.h"
 #include "Serialization/SerializationTools.h"
@@ -57,6 +62,9 @@ namespace {
   const command_line::arg_descriptor<bool>        arg_request_stat_info  = {"request_stat_info", "request statistics information"};
   const command_line::arg_descriptor<bool>        arg_request_net_state  = {"request_net_state", "request network state information (peer list, connections count)"};
   const command_line::arg_descriptor<bool>        arg_get_daemon_info    = {"rpc_get_daemon_info", "request daemon state info vie rpc (--rpc_port option should be set ).", "", true};
+  const command_line::arg_descriptor<bool>        arg_sweep              = {"sweep", "probe the node at --ip/--port and the peers it reports concurrently, print a ranked JSON report"};
+  const command_line::arg_descriptor<uint32_t>    arg_sweep_limit        = {"sweep_limit", "most peers probed by --sweep", 64};
+  const command_line::arg_descriptor<uint32_t>    arg_sweep_concurrency  = {"sweep_concurrency", "probes in flight during --sweep", 16};
 }
 
 struct response_schema {
@@ -321,6 +329,226 @@ bool handle_request_stat(po::variables_map& vm, PeerIdType peer_id) {
   return true;
 }
 
+//---------------------------------------------------------------------------------------------------------------
+struct peer_probe {
+  NetworkAddress adr;
+  std::string status;
+  PeerIdType peer_id = 0;
+  uint8_t version = 0;
+  uint32_t height = 0;
+  Crypto::Hash top_id = NULL_HASH;
+  uint64_t connect_ms = 0;
+  uint64_t handshake_ms = 0;
+  uint64_t object_bytes = 0;
+  uint64_t object_ms = 0;
+  std::list<PeerlistEntry> peerlist;
+};
+
+uint64_t millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// connects and handshakes like a node that has no chain and no listening port, so the peer neither
+// back pings us nor adds us to its peerlist, then fetches its top block as the test object
+void probe_peer(System::Dispatcher& dispatcher, unsigned timeout, peer_probe& probe) {
+  System::TcpConnection connection;
+  auto start = std::chrono::steady_clock::now();
+  withTimeout(dispatcher, timeout, [&] {
+    System::TcpConnector connector(dispatcher);
+    connection = connector.connect(System::Ipv4Address(Common::ipAddressToString(probe.adr.ip)), static_cast<uint16_t>(probe.adr.port));
+  });
+  probe.connect_ms = millisecondsSince(start);
+
+  LevinProtocol levin(connection);
+  COMMAND_HANDSHAKE::request req;
+  req.node_data.network_id = CRYPTONOTE_NETWORK;
+  req.node_data.version = P2P_CURRENT_VERSION;
+  req.node_data.local_time = time(nullptr);
+  req.node_data.my_port = 0;
+  req.node_data.peer_id = Crypto::rand<PeerIdType>();
+  req.payload_data.current_height = 0;
+  req.payload_data.top_id = NULL_HASH;
+  req.payload_data.pool_short_ids = false;
+  req.skip_peerlist = false;
+  COMMAND_HANDSHAKE::response rsp;
+
+  start = std::chrono::steady_clock::now();
+  withTimeout(dispatcher, timeout, [&] {
+    if (!levin.invoke(COMMAND_HANDSHAKE::ID, req, rsp)) {
+      throw std::runtime_error("handshake rejected");
+    }
+  });
+  probe.handshake_ms = millisecondsSince(start);
+
+  if (rsp.node_data.network_id != CRYPTONOTE_NETWORK) {
+    throw std::runtime_error("wrong network");
+  }
+
+  probe.peer_id = rsp.node_data.peer_id;
+  probe.version = rsp.node_data.version;
+  probe.height = rsp.payload_data.current_height;
+  probe.top_id = rsp.payload_data.top_id;
+  probe.peerlist = std::move(rsp.local_peerlist);
+  probe.status = "OK";
+
+  NOTIFY_REQUEST_GET_OBJECTS::request objectsReq;
+  objectsReq.blocks.push_back(probe.top_id);
+
+  start = std::chrono::steady_clock::now();
+  try {
+    withTimeout(dispatcher, timeout, [&] {
+      levin.notify(NOTIFY_REQUEST_GET_OBJECTS::ID, objectsReq, 0);
+
+      // the peer goes on with its own sync requests meanwhile, those are left unanswered
+      LevinProtocol::Command cmd;
+      for (;;) {
+        if (!levin.readCommand(cmd)) {
+          throw std::runtime_error("connection closed");
+        }
+
+        if (cmd.command == NOTIFY_RESPONSE_GET_OBJECTS::ID) {
+          break;
+        }
+      }
+
+      probe.object_bytes = cmd.buf.size();
+    });
+    probe.object_ms = millisecondsSince(start);
+  } catch (const std::exception& e) {
+    probe.status = std::string("OK, object fetch failed: ") + e.what();
+  }
+}
+
+// reachable peers first, then those at the best height, then by handshake round trip
+void rank_probes(std::vector<peer_probe>& probes) {
+  uint32_t bestHeight = 0;
+  for (const auto& probe : probes) {
+    bestHeight = std::max(bestHeight, probe.height);
+  }
+
+  std::stable_sort(probes.begin(), probes.end(), [bestHeight](const peer_probe& a, const peer_probe& b) {
+    bool aReachable = a.peer_id != 0;
+    bool bReachable = b.peer_id != 0;
+    if (aReachable != bReachable) {
+      return aReachable;
+    }
+
+    uint32_t aLag = bestHeight - a.height;
+    uint32_t bLag = bestHeight - b.height;
+    if (aLag != bLag) {
+      return aLag < bLag;
+    }
+
+    return a.handshake_ms < b.handshake_ms;
+  });
+}
+
+std::ostream& get_sweep_report_as_json(std::ostream& ss, const std::vector<peer_probe>& probes) {
+  size_t reachable = std::count_if(probes.begin(), probes.end(), [](const peer_probe& probe) { return probe.peer_id != 0; });
+
+  ss << "{" << ENDL
+     << "  \"status\": \"OK\"," << ENDL
+     << "  \"probed\": " << probes.size() << "," << ENDL
+     << "  \"reachable\": " << reachable << "," << ENDL
+     << "  \"peers\": [" << ENDL;
+
+  for (size_t i = 0; i < probes.size(); ++i) {
+    const peer_probe& probe = probes[i];
+    ss << "    {\"rank\": " << i + 1
+       << ", \"ip\": \"" << Common::ipAddressToString(probe.adr.ip) << "\", \"port\": " << probe.adr.port
+       << ", \"status\": \"" << probe.status << "\"";
+
+    if (probe.peer_id != 0) {
+      uint64_t throughput = probe.object_ms == 0 ? probe.object_bytes * 1000 : probe.object_bytes * 1000 / probe.object_ms;
+      ss << ", \"peer_id\": \"" << probe.peer_id << "\", \"version\": " << static_cast<unsigned>(probe.version)
+         << ", \"height\": " << probe.height << ", \"top_id\": \"" << Common::podToHex(probe.top_id) << "\""
+         << ", \"connect_ms\": " << probe.connect_ms << ", \"handshake_ms\": " << probe.handshake_ms
+         << ", \"object_bytes\": " << probe.object_bytes << ", \"object_ms\": " << probe.object_ms
+         << ", \"bytes_per_second\": " << throughput;
+    }
+
+    ss << "}" << (i + 1 != probes.size() ? "," : "") << ENDL;
+  }
+
+  ss << "  ]" << ENDL << "}";
+  return ss;
+}
+
+bool handle_sweep(po::variables_map& vm) {
+  unsigned timeout = command_line::get_arg(vm, arg_timeout);
+  uint32_t limit = std::max<uint32_t>(1, command_line::get_arg(vm, arg_sweep_limit));
+  uint32_t concurrency = std::max<uint32_t>(1, command_line::get_arg(vm, arg_sweep_concurrency));
+  uint16_t port = command_line::get_arg(vm, arg_port);
+
+  std::vector<peer_probe> probes;
+
+  try {
+    System::Dispatcher dispatcher;
+    System::Ipv4Resolver resolver(dispatcher);
+
+    peer_probe seed;
+    seed.adr.ip = hostToNetwork(resolver.resolve(command_line::get_arg(vm, arg_ip)).getValue());
+    seed.adr.port = port != 0 ? port : P2P_DEFAULT_PORT;
+    probes.push_back(seed);
+
+    std::set<NetworkAddress> queued = { seed.adr };
+    size_t next = 0;
+    size_t inFlight = 0;
+
+    // every worker takes the next queued peer; the peerlists that probes bring back feed the queue until
+    // the limit, so a worker that finds it empty waits while other probes may still add to it
+    System::ContextGroup workers(dispatcher);
+    for (uint32_t i = 0; i < concurrency; ++i) {
+      workers.spawn([&] {
+        for (;;) {
+          if (next == probes.size()) {
+            if (inFlight == 0) {
+              return;
+            }
+
+            System::Timer(dispatcher).sleep(std::chrono::milliseconds(20));
+            continue;
+          }
+
+          size_t index = next++;
+          ++inFlight;
+          peer_probe probe = probes[index];
+          try {
+            probe_peer(dispatcher, timeout, probe);
+          } catch (const std::exception& e) {
+            probe.status = std::string("ERROR: ") + e.what();
+          }
+          --inFlight;
+
+          for (const PeerlistEntry& pe : probe.peerlist) {
+            if (probes.size() >= limit) {
+              break;
+            }
+
+            if (queued.insert(pe.adr).second) {
+              peer_probe peer;
+              peer.adr = pe.adr;
+              probes.push_back(peer);
+            }
+          }
+
+          probe.peerlist.clear();
+          probes[index] = std::move(probe);
+        }
+      });
+    }
+
+    workers.wait();
+  } catch (const std::exception& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    return false;
+  }
+
+  rank_probes(probes);
+  get_sweep_report_as_json(std::cout, probes) << std::endl;
+  return true;
+}
+
 //---------------------------------------------------------------------------------------------------------------
 bool generate_and_print_keys() {
   Crypto::PublicKey pk;
@@ -347,6 +575,9 @@ int main(int argc, char *argv[]) {
   command_line::add_arg(desc_params, arg_peer_id);
   command_line::add_arg(desc_params, arg_priv_key);
   command_line::add_arg(desc_params, arg_get_daemon_info);
+  command_line::add_arg(desc_params, arg_sweep);
+  command_line::add_arg(desc_params, arg_sweep_limit);
+  command_line::add_arg(desc_params, arg_sweep_concurrency);
 
   po::options_description desc_all;
   desc_all.add(desc_general).add(desc_params);
@@ -373,6 +604,10 @@ int main(int argc, char *argv[]) {
     return handle_request_stat(vm, command_line::get_arg(vm, arg_peer_id)) ? 0 : 1;
   }
   
+  if (command_line::has_arg(vm, arg_sweep)) {
+    return handle_sweep(vm) ? 0 : 1;
+  }
+
   if (command_line::has_arg(vm, arg_get_daemon_info)) {
     return handle_get_daemon_info(vm) ? 0 : 1;
   } 
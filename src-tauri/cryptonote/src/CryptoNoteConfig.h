@@ -154,6 +154,12 @@ namespace CryptoNote
 	const size_t BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT = 10000; // by default, blocks ids count in synchronizing
 	const size_t BLOCKS_SYNCHRONIZING_DEFAULT_COUNT = 128;		 // by default, blocks count in blocks downloading
 	const size_t COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT = 1000;
+	const size_t BLOCKS_SYNCHRONIZING_MAX_RESPONSE_SIZE = 16 * 1024 * 1024; // upper bound for a peer-requested blocks response budget
+	const uint64_t BLOCK_CACHE_DEFAULT_SIZE = 64 * 1024 * 1024; // serialized bytes of blocks kept decoded in memory
+	const uint64_t POOL_DEFAULT_MAX_SIZE = 100 * 1024 * 1024; // serialized bytes of pool transactions before the cheapest are evicted
+	const uint64_t POOL_MINIMUM_FEE_RATE_HALF_LIFE = 60 * 60 * 2; // seconds for the fee floor raised by an eviction to halve
+	const uint64_t POOL_JOURNAL_COMPACTION_SLACK = 4 * 1024 * 1024; // journal bytes past twice the pool size before the pool state file is rewritten
+	const size_t POOL_CHANGE_LOG_SIZE = 16384; // pool insertions and removals kept for clients asking for the changes since a pool version
 
 	const int P2P_DEFAULT_PORT = 10808;
  	const int RPC_DEFAULT_PORT = 18180;
@@ -176,7 +182,14 @@ namespace CryptoNote
 	const uint32_t P2P_DEFAULT_CONNECTIONS_COUNT = 8;
 	const size_t P2P_DEFAULT_ANCHOR_CONNECTIONS_COUNT = 2;
 	const size_t P2P_DEFAULT_WHITELIST_CONNECTIONS_PERCENT = 70; // percent
+	const size_t P2P_RANDOM_OUTGOING_CONNECTIONS_PERCENT = 30;	 // percent of white list picks that ignore peer quality
+	const size_t P2P_RANKED_PEERS_CANDIDATES = 16;				 // best white peers considered for a ranked pick
+	const size_t P2P_KNOWN_TRANSACTIONS_LIMIT = 100000;			 // per connection
+	const size_t P2P_KNOWN_BLOCKS_LIMIT = 1024;					 // per connection
+	const uint32_t P2P_PEERLIST_STORE_INTERVAL = 60 * 5;		 // seconds, skipped while the peerlist is unchanged
 	const uint32_t P2P_DEFAULT_HANDSHAKE_INTERVAL = 60;			 // seconds
+	const uint32_t P2P_HANDSHAKE_RESUME_WINDOW = 60 * 10;		 // seconds a back ping or a taken peerlist still counts on reconnect
+	const size_t P2P_RECENT_PEERS_LIMIT = 4096;
 	const uint32_t P2P_DEFAULT_PACKET_MAX_SIZE = 50000000;		 // 50000000 bytes maximum packet size
 	const uint32_t P2P_DEFAULT_PEERS_IN_HANDSHAKE = 250;
 	const uint32_t P2P_DEFAULT_CONNECTION_TIMEOUT = 5000;	   // 5 seconds
@@ -196,6 +209,13 @@ namespace CryptoNote
 			
 	};
 
+	// TXT records of "<height>:<block hash>" checkpoints, queried in parallel; a majority of the
+	// hosts answering with the same records within the timeout is needed to use them
+	const std::initializer_list<const char *> DNS_CHECKPOINT_HOSTS = {
+		"checkpoints.fuego.money"
+	};
+	const uint32_t DNS_CHECKPOINTS_TIMEOUT = 5000; // 5 seconds
+
 	struct CheckpointData
 	{
 		uint32_t height;
@@ -0,0 +1,271 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "BinaryBlobDecoder.h"
+
+#include <algorithm>
+#include <exception>
+#include <future>
+
+#include "crypto/hash.h"
+#include "Serialization/BinarySpanReader.h"
+
+#include "CryptoNoteConfig.h"
+#include "TransactionExtra.h"
+
+namespace CryptoNote {
+
+namespace {
+
+// field by field mirror of CryptoNoteSerialization.cpp for BinaryInputStreamSerializer
+
+void readHashes(BinarySpanReader& reader, std::vector<Crypto::Hash>& hashes, size_t count) {
+  hashes.resize(count);
+  if (count != 0) {
+    reader.read(hashes.data(), count * sizeof(Crypto::Hash));
+  }
+}
+
+void readInput(BinarySpanReader& reader, TransactionInput& input) {
+  uint8_t tag;
+  reader.pod(tag);
+
+  switch (tag) {
+  case 0xff: {
+    BaseInput base;
+    base.blockIndex = reader.varint<uint32_t>();
+    input = base;
+    break;
+  }
+  case 0x2: {
+    KeyInput key;
+    key.amount = reader.varint<uint64_t>();
+    key.outputIndexes.resize(reader.arraySize(1));
+    for (uint32_t& index : key.outputIndexes) {
+      index = reader.varint<uint32_t>();
+    }
+    reader.pod(key.keyImage);
+    input = std::move(key);
+    break;
+  }
+  case 0x3: {
+    MultisignatureInput multisignature;
+    multisignature.amount = reader.varint<uint64_t>();
+    multisignature.signatureCount = reader.varint<uint8_t>();
+    multisignature.outputIndex = reader.varint<uint32_t>();
+    multisignature.term = reader.varint<uint32_t>();
+    input = multisignature;
+    break;
+  }
+  default:
+    throw std::runtime_error("Unknown variant tag");
+  }
+}
+
+void readOutput(BinarySpanReader& reader, TransactionOutput& output) {
+  output.amount = reader.varint<uint64_t>();
+
+  uint8_t tag;
+  reader.pod(tag);
+
+  switch (tag) {
+  case 0x2: {
+    KeyOutput key;
+    reader.pod(key.key);
+    output.target = key;
+    break;
+  }
+  case 0x3: {
+    MultisignatureOutput multisignature;
+    multisignature.keys.resize(reader.arraySize(sizeof(Crypto::PublicKey)));
+    if (!multisignature.keys.empty()) {
+      reader.read(multisignature.keys.data(), multisignature.keys.size() * sizeof(Crypto::PublicKey));
+    }
+    multisignature.requiredSignatureCount = reader.varint<uint8_t>();
+    multisignature.term = reader.varint<uint32_t>();
+    output.target = std::move(multisignature);
+    break;
+  }
+  default:
+    throw std::runtime_error("Unknown variant tag");
+  }
+}
+
+size_t getSignaturesCount(const TransactionInput& input) {
+  if (input.type() == typeid(KeyInput)) {
+    return boost::get<KeyInput>(input).outputIndexes.size();
+  } else if (input.type() == typeid(MultisignatureInput)) {
+    return boost::get<MultisignatureInput>(input).signatureCount;
+  }
+
+  return 0;
+}
+
+void readTransaction(BinarySpanReader& reader, Transaction& transaction, size_t& prefixSize) {
+  transaction.version = reader.varint<uint8_t>();
+  if (TRANSACTION_VERSION_2 < transaction.version) {
+    throw std::runtime_error("Wrong transaction version");
+  }
+
+  transaction.unlockTime = reader.varint<uint64_t>();
+
+  transaction.inputs.resize(reader.arraySize(1));
+  for (TransactionInput& input : transaction.inputs) {
+    readInput(reader, input);
+  }
+
+  transaction.outputs.resize(reader.arraySize(1));
+  for (TransactionOutput& output : transaction.outputs) {
+    readOutput(reader, output);
+  }
+
+  uint64_t extraSize = reader.varint<uint64_t>();
+  if (extraSize > reader.remaining()) {
+    throw std::runtime_error("string size is too big");
+  }
+  const uint8_t* extra = reader.skip(static_cast<size_t>(extraSize));
+  transaction.extra.assign(extra, extra + extraSize);
+
+  prefixSize = reader.position();
+
+  transaction.signatures.resize(transaction.inputs.size());
+  for (size_t i = 0; i < transaction.inputs.size(); ++i) {
+    std::vector<Crypto::Signature>& signatures = transaction.signatures[i];
+    signatures.resize(getSignaturesCount(transaction.inputs[i]));
+    if (!signatures.empty()) {
+      reader.read(signatures.data(), signatures.size() * sizeof(Crypto::Signature));
+    }
+  }
+}
+
+void readParentBlock(BinarySpanReader& reader, Block& block) {
+  ParentBlock& parent = block.parentBlock;
+  parent.majorVersion = reader.varint<uint8_t>();
+  parent.minorVersion = reader.varint<uint8_t>();
+  block.timestamp = reader.varint<uint64_t>();
+  reader.pod(parent.previousBlockHash);
+  reader.pod(block.nonce);
+
+  parent.transactionCount = static_cast<uint16_t>(reader.varint<uint64_t>());
+  if (parent.transactionCount < 1) {
+    throw std::runtime_error("Wrong transactions number");
+  }
+
+  readHashes(reader, parent.baseTransactionBranch, Crypto::tree_depth(parent.transactionCount));
+
+  size_t prefixSize;
+  readTransaction(reader, parent.baseTransaction, prefixSize);
+
+  TransactionExtraMergeMiningTag mmTag;
+  if (!getMergeMiningTagFromExtra(parent.baseTransaction.extra, mmTag)) {
+    throw std::runtime_error("Can't get extra merge mining tag");
+  }
+
+  if (mmTag.depth > 8 * sizeof(Crypto::Hash)) {
+    throw std::runtime_error("Wrong merge mining tag depth");
+  }
+
+  readHashes(reader, parent.blockchainBranch, mmTag.depth);
+}
+
+void readBlock(BinarySpanReader& reader, Block& block) {
+  block.majorVersion = reader.varint<uint8_t>();
+  if (block.majorVersion > BLOCK_MAJOR_VERSION_9) {
+    throw std::runtime_error("Wrong major version");
+  }
+
+  block.minorVersion = reader.varint<uint8_t>();
+  if (block.majorVersion == BLOCK_MAJOR_VERSION_1) {
+    block.timestamp = reader.varint<uint64_t>();
+    reader.pod(block.previousBlockHash);
+    reader.pod(block.nonce);
+  } else if (block.majorVersion >= BLOCK_MAJOR_VERSION_2) {
+    reader.pod(block.previousBlockHash);
+    readParentBlock(reader, block);
+  } else {
+    throw std::runtime_error("Wrong major version");
+  }
+
+  size_t prefixSize;
+  readTransaction(reader, block.baseTransaction, prefixSize);
+  readHashes(reader, block.transactionHashes, reader.arraySize(sizeof(Crypto::Hash)));
+}
+
+}
+
+bool decodeTransaction(const void* data, size_t size, Transaction& transaction, size_t& prefixSize) {
+  try {
+    BinarySpanReader reader(data, size);
+    readTransaction(reader, transaction, prefixSize);
+    return reader.endOfBlob();
+  } catch (std::exception&) {
+    return false;
+  }
+}
+
+bool decodeTransaction(const void* data, size_t size, Transaction& transaction) {
+  size_t prefixSize;
+  return decodeTransaction(data, size, transaction, prefixSize);
+}
+
+bool decodeBlock(const void* data, size_t size, Block& block) {
+  try {
+    BinarySpanReader reader(data, size);
+    readBlock(reader, block);
+    return reader.endOfBlob();
+  } catch (std::exception&) {
+    return false;
+  }
+}
+
+void parallelDecode(size_t count, Common::ThreadPool& pool, const std::function<void(size_t, size_t)>& body) {
+  size_t chunks = std::min(count, pool.workerCount() + 1);
+  if (chunks <= 1) {
+    body(0, count);
+    return;
+  }
+
+  size_t chunkSize = (count + chunks - 1) / chunks;
+  std::vector<std::future<void>> pending;
+  pending.reserve(chunks - 1);
+  std::exception_ptr error;
+  try {
+    for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+      size_t end = std::min(count, begin + chunkSize);
+      pending.push_back(pool.submit([&body, begin, end] { body(begin, end); }));
+    }
+
+    body(0, chunkSize);
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  // the queued chunks reference body
+  for (auto& chunk : pending) {
+    chunk.wait();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  for (auto& chunk : pending) {
+    chunk.get();
+  }
+}
+
+}
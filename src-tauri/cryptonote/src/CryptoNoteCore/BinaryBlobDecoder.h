@@ -0,0 +1,72 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "CryptoNote.h"
+#include "Common/StringView.h"
+#include "Common/ThreadPool.h"
+
+namespace CryptoNote {
+
+// Decoders for the binary Block and Transaction formats that read straight from the blob through
+// BinarySpanReader, with every field read resolved at compile time. They accept exactly the blobs
+// fromBinaryArray accepts, including the check that the whole blob was consumed.
+bool decodeTransaction(const void* data, size_t size, Transaction& transaction);
+bool decodeBlock(const void* data, size_t size, Block& block);
+
+// prefixSize receives the length of the serialized prefix, which starts the blob, so that the prefix
+// hash can be taken over the blob in place
+bool decodeTransaction(const void* data, size_t size, Transaction& transaction, size_t& prefixSize);
+
+inline bool decodeTransaction(const BinaryArray& blob, Transaction& transaction) {
+  return decodeTransaction(blob.data(), blob.size(), transaction);
+}
+
+inline bool decodeBlock(const BinaryArray& blob, Block& block) {
+  return decodeBlock(blob.data(), blob.size(), block);
+}
+
+inline bool decodeBinary(const void* data, size_t size, Transaction& transaction) {
+  return decodeTransaction(data, size, transaction);
+}
+
+inline bool decodeBinary(const void* data, size_t size, Block& block) {
+  return decodeBlock(data, size, block);
+}
+
+// runs body(begin, end) over [0, count) split between the pool's workers and the calling thread
+void parallelDecode(size_t count, Common::ThreadPool& pool, const std::function<void(size_t, size_t)>& body);
+
+// Decodes blobs[i] into objects[i] on the pool, decoded[i] tells whether blobs[i] was accepted
+template <typename T>
+void decodeBlobs(const std::vector<Common::StringView>& blobs, std::vector<T>& objects, std::vector<uint8_t>& decoded, Common::ThreadPool& pool) {
+  objects.clear();
+  objects.resize(blobs.size());
+  decoded.assign(blobs.size(), 0);
+
+  parallelDecode(blobs.size(), pool, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      decoded[i] = blobs[i].getSize() != 0 && decodeBinary(blobs[i].getData(), blobs[i].getSize(), objects[i]) ? 1 : 0;
+    }
+  });
+}
+
+}
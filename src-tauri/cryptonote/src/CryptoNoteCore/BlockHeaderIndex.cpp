@@ -0,0 +1,86 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "BlockHeaderIndex.h"
+
+#include <cassert>
+
+namespace CryptoNote {
+
+namespace {
+
+const uint64_t BLOCK_HEADER_INDEX_VERSION = 2;
+
+}
+
+BlockHeaderIndex::BlockHeaderIndex() {
+}
+
+void BlockHeaderIndex::open(const std::string& path) {
+  m_headers.open(path, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE, sizeof(BLOCK_HEADER_INDEX_VERSION));
+  // the owner flushes with the blockchain cache, the index is rebuilt from the blocks if it falls behind
+  m_headers.setAutoFlush(false);
+
+  if (m_headers.prefixSize() != sizeof(BLOCK_HEADER_INDEX_VERSION) ||
+      *reinterpret_cast<const uint64_t*>(m_headers.prefix()) != BLOCK_HEADER_INDEX_VERSION) {
+    m_headers.clear();
+    m_headers.resizePrefix(sizeof(BLOCK_HEADER_INDEX_VERSION));
+    *reinterpret_cast<uint64_t*>(m_headers.prefix()) = BLOCK_HEADER_INDEX_VERSION;
+    m_headers.flush();
+  }
+}
+
+void BlockHeaderIndex::close() {
+  if (m_headers.isOpened()) {
+    m_headers.flush();
+    m_headers.close();
+  }
+}
+
+bool BlockHeaderIndex::isOpened() const {
+  return m_headers.isOpened();
+}
+
+void BlockHeaderIndex::reserve(uint32_t size) {
+  m_headers.reserve(size);
+}
+
+void BlockHeaderIndex::push(const BlockHeaderSummary& header) {
+  m_headers.push_back(header);
+}
+
+void BlockHeaderIndex::pop() {
+  assert(!m_headers.empty());
+  m_headers.pop_back();
+}
+
+void BlockHeaderIndex::truncate(uint32_t size) {
+  while (m_headers.size() > size) {
+    m_headers.pop_back();
+  }
+}
+
+void BlockHeaderIndex::clear() {
+  m_headers.clear();
+}
+
+void BlockHeaderIndex::flush() {
+  m_headers.flush();
+}
+
+}
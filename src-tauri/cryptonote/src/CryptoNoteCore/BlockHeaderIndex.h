@@ -0,0 +1,73 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Common/FileMappedVector.h"
+#include "CryptoNoteCore/Difficulty.h"
+
+namespace CryptoNote {
+
+// Fixed size part of a main chain block entry that height, timestamp and difficulty lookups need
+struct BlockHeaderSummary {
+  uint64_t timestamp;
+  uint64_t cumulativeSize;
+  difficulty_type cumulativeDifficulty;
+  uint64_t generatedCoins;
+  uint8_t majorVersion;
+  uint8_t minorVersion;
+  uint8_t reserved[2];
+  uint32_t nonce;
+};
+
+// Dense per-height array of block header summaries, memory mapped from a file kept beside the
+// blocks file, so lookups by height don't have to deserialize whole block entries
+class BlockHeaderIndex {
+public:
+  typedef BlockHeaderSummary value_type;
+  typedef Common::FileMappedVector<BlockHeaderSummary>::const_iterator const_iterator;
+
+  BlockHeaderIndex();
+
+  void open(const std::string& path);
+  void close();
+  bool isOpened() const;
+
+  bool empty() const { return m_headers.empty(); }
+  uint32_t size() const { return static_cast<uint32_t>(m_headers.size()); }
+  const BlockHeaderSummary& operator[](uint32_t height) const { return m_headers[height]; }
+  const BlockHeaderSummary& back() const { return m_headers.back(); }
+  const_iterator begin() const { return m_headers.begin(); }
+  const_iterator end() const { return m_headers.end(); }
+
+  void reserve(uint32_t size);
+  void push(const BlockHeaderSummary& header);
+  void pop();
+  // drops the summaries of all blocks at size and above
+  void truncate(uint32_t size);
+  void clear();
+  void flush();
+
+private:
+  Common::FileMappedVector<BlockHeaderSummary> m_headers;
+};
+
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "BlockResponseCache.h"
+
+namespace CryptoNote {
+
+BlockResponseCache::BlockResponseCache(uint64_t maxBytes) : m_maxBytes(maxBytes), m_bytes(0) {
+}
+
+std::shared_ptr<const BlockResponseCache::Entry> BlockResponseCache::get(const Crypto::Hash& blockId, uint32_t height) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto it = m_index.find(blockId);
+  if (it == m_index.end() || it->second->second->height != height) {
+    return nullptr;
+  }
+
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  return it->second->second;
+}
+
+void BlockResponseCache::put(const Crypto::Hash& blockId, std::shared_ptr<const Entry> entry) {
+  uint64_t bytes = entryBytes(*entry);
+  if (bytes > m_maxBytes) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto it = m_index.find(blockId);
+  if (it != m_index.end()) {
+    m_bytes -= entryBytes(*it->second->second);
+    m_entries.erase(it->second);
+    m_index.erase(it);
+  }
+
+  while (m_bytes + bytes > m_maxBytes) {
+    m_bytes -= entryBytes(*m_entries.back().second);
+    m_index.erase(m_entries.back().first);
+    m_entries.pop_back();
+  }
+
+  m_entries.emplace_front(blockId, std::move(entry));
+  m_index.emplace(blockId, m_entries.begin());
+  m_bytes += bytes;
+}
+
+uint64_t BlockResponseCache::entryBytes(const Entry& entry) {
+  // the blobs plus roughly the same again for the parsed prefixes
+  return sizeof(Entry) + entry.fullSize + entry.liteSize + entry.liteGlobalIndexesSize;
+}
+
+}
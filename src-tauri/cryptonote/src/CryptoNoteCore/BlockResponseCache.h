@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
+
+namespace CryptoNote {
+
+// What queryBlocks and queryBlocksLite send for one block of the main chain, serialized once and
+// shared by every wallet syncing the same range. Keyed by block hash: the blobs and the global
+// output indexes of a block only depend on the chain up to it, so an entry stays valid across
+// reorganizations and is at worst never asked for again.
+class BlockResponseCache {
+public:
+  struct Entry {
+    uint32_t height;
+    uint64_t timestamp;
+    std::string block;
+    std::vector<std::string> transactions;
+    std::vector<TransactionPrefixInfo> txPrefixes;  // with their global indexes
+    std::vector<uint32_t> baseTransactionGlobalIndexes;
+    // response size accounting of the callers
+    uint64_t fullSize;
+    uint64_t liteSize;
+    uint64_t liteGlobalIndexesSize;
+  };
+
+  explicit BlockResponseCache(uint64_t maxBytes);
+
+  // null unless the block is cached at this height
+  std::shared_ptr<const Entry> get(const Crypto::Hash& blockId, uint32_t height);
+  void put(const Crypto::Hash& blockId, std::shared_ptr<const Entry> entry);
+
+private:
+  typedef std::list<std::pair<Crypto::Hash, std::shared_ptr<const Entry>>> Entries;
+
+  static uint64_t entryBytes(const Entry& entry);
+
+  const uint64_t m_maxBytes;
+  std::mutex m_mutex;
+  uint64_t m_bytes;
+  Entries m_entries;  // most recently used first
+  std::unordered_map<Crypto::Hash, Entries::iterator> m_index;
+};
+
+}
@@ -24,14 +24,23 @@
 #include <numeric>
 #include <cstdio>
 #include <cmath>
+#include <future>
+#include <thread>
 #include <boost/foreach.hpp>
+#include "Common/BufferedOutputStream.h"
 #include "Common/Math.h"
+#include "Common/Metrics.h"
 #include "Common/int-util.h"
 #include "Common/ShuffleGenerator.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/ScopeExit.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "Rpc/CoreRpcServerCommandsDefinitions.h"
 #include "Serialization/BinarySerializationTools.h"
+#include "BlockchainExplorer/BlockchainExplorerDataBuilder.h"
+#include "BinaryBlobDecoder.h"
+#include "BlockchainSnapshot.h"
 #include "CryptoNoteTools.h"
 #include "TransactionExtra.h"
 #include "CryptoNoteConfig.h"
@@ -42,6 +51,15 @@ using namespace Common;
 
 namespace {
 
+const size_t PROOF_OF_WORK_CACHE_SIZE = 4096;
+// a pool of several thousand transactions with a few inputs each
+const size_t VERIFIED_RING_SIGNATURE_CACHE_SIZE = 65536;
+// appended to the blocks and block indexes file names for compressed storage
+const char BLOCK_STORE_COMPRESSED_SUFFIX[] = ".zst";
+// blocks verifyChain checks under one shared lock, and the errors it keeps the text of
+const uint32_t VERIFY_CHAIN_SLICE = 256;
+const size_t VERIFY_CHAIN_MAX_ERRORS = 32;
+
 std::string appendPath(const std::string& path, const std::string& fileName) {
   std::string result = path;
   if (!result.empty()) {
@@ -64,8 +82,8 @@ bool operator<(const Crypto::KeyImage& keyImage1, const Crypto::KeyImage& keyIma
 }
 }
 
-#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 4
-#define CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER 1
+#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 7
+#define CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER 3
 
 namespace CryptoNote {
 class BlockCacheSerializer;
@@ -135,8 +153,8 @@ void serialize(Blockchain::TransactionIndex& value, ISerializer& s) {
 class BlockCacheSerializer {
 
 public:
-  BlockCacheSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger) :
-    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockCacheSerializer") {
+  BlockCacheSerializer(Blockchain& bs, uint32_t height, const Crypto::Hash lastBlockHash, ILogger& logger) :
+    m_bs(bs), m_height(height), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockCacheSerializer") {
   }
 
   void load(const std::string& filename) {
@@ -155,20 +173,29 @@ public:
   }
 
   bool save(const std::string& filename) {
+    // written aside and renamed, so a crash mid-save leaves the previous cache in place
+    std::string temporaryName = filename + ".tmp";
     try {
-      std::ofstream file(filename, std::ios::binary);
+      std::ofstream file(temporaryName, std::ios::binary);
       if (!file) {
         return false;
       }
 
-      StdOutputStream stream(file);
+      StdOutputStream fileStream(file);
+      BufferedOutputStream stream(fileStream);
       BinaryOutputStreamSerializer s(stream);
       CryptoNote::serialize(*this, s);
+      stream.flush();
+      file.flush();
+      if (!file) {
+        return false;
+      }
     } catch (std::exception&) {
       return false;
     }
 
-    return true;
+    std::remove(filename.c_str());
+    return std::rename(temporaryName.c_str(), filename.c_str()) == 0;
   }
 
   void serialize(ISerializer& s) {
@@ -185,15 +212,20 @@ public:
     std::string operation;
     if (s.type() == ISerializer::INPUT) {
       operation = "- loading ";
+      uint32_t height;
       Crypto::Hash blockHash;
+      s(height, "height");
       s(blockHash, "last_block");
 
-      if (blockHash != m_lastBlockHash) {
+      // a cache left behind by an interrupted rebuild covers a prefix of the chain and is resumed from there
+      if (height == 0 || height > m_bs.m_blocks.size() || blockHash != get_block_hash(m_bs.m_blocks[height - 1].bl)) {
         return;
       }
 
+      m_height = height;
     } else {
       operation = "- saving ";
+      s(m_height, "height");
       s(m_lastBlockHash, "last_block");
     }
 
@@ -201,36 +233,10 @@ public:
     s(m_bs.m_blockIndex, "block_index");
 
       logger(INFO) << operation << "transaction map";
-      if (s.type() == ISerializer::INPUT)
-      {
-        phmap::BinaryInputArchive ar_in(appendPath(m_bs.m_config_folder, "transactionsmap.dat").c_str());
-        // Temporary workaround: Avoid direct load call due to phmap issues
-        // m_bs.m_transactionMap.load(ar_in);
-        // TODO: Implement proper serialization for m_transactionMap
-      }
-      else
-      {
-        phmap::BinaryOutputArchive ar_out(appendPath(m_bs.m_config_folder, "transactionsmap.dat").c_str());
-        // Temporary workaround: Avoid direct dump call due to phmap issues
-        // m_bs.m_transactionMap.dump(ar_out);
-        // TODO: Implement proper serialization for m_transactionMap
-      }
+      s(m_bs.m_transactionMap, "transactions");
 
       logger(INFO) << operation << "spent keys";
-      if (s.type() == ISerializer::INPUT)
-      {
-        phmap::BinaryInputArchive ar_in(appendPath(m_bs.m_config_folder, "spentkeys.dat").c_str());
-        // Temporary workaround: Avoid direct load call due to phmap issues
-        // m_bs.m_spent_keys.load(ar_in);
-        // TODO: Implement proper serialization for m_spent_keys
-      }
-      else
-      {
-        phmap::BinaryOutputArchive ar_out(appendPath(m_bs.m_config_folder, "spentkeys.dat").c_str());
-        // Temporary workaround: Avoid direct dump call due to phmap issues
-        // m_bs.m_spent_keys.dump(ar_out);
-        // TODO: Implement proper serialization for m_spent_keys
-      }
+      s(m_bs.m_spent_keys, "spent_keys");
 
       logger(INFO) << operation << "outputs";
       s(m_bs.m_outputs, "outputs");
@@ -238,9 +244,6 @@ public:
       logger(INFO) << operation << "multi-signature outputs";
       s(m_bs.m_multisignatureOutputs, "multisig_outputs");
 
-      logger(INFO) << operation << "deposit index";
-      s(m_bs.m_depositIndex, "deposit_index");
-
     auto dur = std::chrono::steady_clock::now() - start;
 
     logger(INFO) << "Serialization time: " << std::chrono::duration_cast<std::chrono::milliseconds>(dur).count() << "ms";
@@ -252,19 +255,26 @@ public:
     return m_loaded;
   }
 
+  uint32_t height() const {
+    return m_height;
+  }
+
 private:
 
   LoggerRef logger;
   bool m_loaded;
   Blockchain& m_bs;
+  uint32_t m_height;
   Crypto::Hash m_lastBlockHash;
 };
 
+// Each index is stored as a blob of its own, so one that isn't enabled is skipped on loading and
+// the stored size of each is known
 class BlockchainIndicesSerializer {
 
 public:
   BlockchainIndicesSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger) :
-    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockchainIndicesSerializer") {
+    logger(logger, "BlockchainIndicesSerializer"), m_loadedIndexes(0), m_bs(bs), m_lastBlockHash(lastBlockHash) {
   }
 
   void serialize(ISerializer& s) {
@@ -298,62 +308,56 @@ public:
         s(m_lastBlockHash, "blockHash");
       }
 
-      logger(INFO) << operation << "paymentID index";
-      s(m_bs.m_paymentIdIndex, "paymentIdIndex");
-
-      logger(INFO) << operation << "timestamp index";
-      s(m_bs.m_timestampIndex, "timestampIndex");
+      // orphan blocks live in memory only, like the alternative chains they index
+      uint32_t indexes = m_bs.m_readyIndexes & ~BLOCKCHAIN_INDEX_ORPHAN_BLOCKS;
+      s(indexes, "indexes");
 
-      logger(INFO) << operation << "generated transactions index";
-      s(m_bs.m_generatedTransactionsIndex, "generatedTransactionsIndex");
-
-    m_loaded = true;
+      serializeIndex(s, operation, indexes, BLOCKCHAIN_INDEX_PAYMENT_ID, m_bs.m_paymentIdIndex);
+      serializeIndex(s, operation, indexes, BLOCKCHAIN_INDEX_KEY_IMAGE, m_bs.m_keyImageIndex);
+      serializeIndex(s, operation, indexes, BLOCKCHAIN_INDEX_TIMESTAMP, m_bs.m_timestampIndex);
+      serializeIndex(s, operation, indexes, BLOCKCHAIN_INDEX_GENERATED_TRANSACTIONS, m_bs.m_generatedTransactionsIndex);
+      serializeIndex(s, operation, indexes, BLOCKCHAIN_INDEX_TRANSACTION_SUMMARIES, m_bs.m_transactionSummaryIndex);
   }
 
-  template<class Archive> void serialize(Archive& ar, unsigned int version) {
+  // the enabled indices the file held
+  uint32_t loadedIndexes() const {
+    return m_loadedIndexes;
+  }
 
-    // ignore old versions, do rebuild
-    if (version < CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER)
+private:
+  template<class Index>
+  void serializeIndex(ISerializer& s, const std::string& operation, uint32_t indexes, uint32_t index, Index& container) {
+    if ((indexes & index) == 0) {
       return;
+    }
 
-      std::string operation;
-      if (Archive::is_loading::value)
-      {
-        operation = "loading ";
-        Crypto::Hash blockHash;
-        ar &blockHash;
-
-        if (blockHash != m_lastBlockHash)
-        {
-          return;
-        }
-      }
-      else
-      {
-        operation = "- saving ";
-        ar &m_lastBlockHash;
-      }
-
-      logger(INFO) << operation << "paymentID index";
-      ar &m_bs.m_paymentIdIndex;
-
-      logger(INFO) << operation << "timestamp index";
-      ar &m_bs.m_timestampIndex;
+    std::string blob;
+    if (s.type() == ISerializer::OUTPUT) {
+      blob = Common::asString(storeToBinary(container));
+    }
 
-      logger(INFO) << operation << "generated transactions index";
-      ar &m_bs.m_generatedTransactionsIndex;
+    s.binary(blob, std::string(blockchainIndexName(index)));
+    logger(INFO) << operation << blockchainIndexName(index) << " index, " << blob.size() << " bytes";
+    m_bs.m_indexStoredBytes[indexPosition(index)] = blob.size();
 
-    m_loaded = true;
+    if (s.type() == ISerializer::INPUT && (m_bs.m_blockchainIndexes & index) != 0) {
+      container.clear();
+      loadFromBinary(container, Common::asBinaryArray(blob));
+      m_loadedIndexes |= index;
+    }
   }
 
-  bool loaded() const {
-    return m_loaded;
-  }
+  static size_t indexPosition(uint32_t index) {
+    size_t position = 0;
+    while ((index >> position) != 1) {
+      ++position;
+    }
 
-private:
+    return position;
+  }
 
   LoggerRef logger;
-  bool m_loaded;
+  uint32_t m_loadedIndexes;
   Blockchain& m_bs;
   Crypto::Hash m_lastBlockHash;
 };
@@ -364,16 +368,21 @@ private:
                          m_tx_pool(tx_pool),
                          m_current_block_cumul_sz_limit(0),
 			 m_checkpoints(logger),
-			 m_blockchainIndexesEnabled(blockchainIndexesEnabled),
+			 m_is_in_checkpoint_zone(false),
+                         m_blockCacheSize(BLOCK_CACHE_DEFAULT_SIZE),
+                         m_blockStoreChunk(0),
+			 m_blockchainIndexes(blockchainIndexesEnabled ? BLOCKCHAIN_INDEX_ALL : 0),
+			 m_readyIndexes(0),
+			 m_backfillHeight(0),
+			 m_stopIndexBackfill(false),
 			 m_blockchainAutosaveEnabled(blockchainAutosaveEnabled),
-                         m_upgradeDetectorV2(currency, m_blocks, BLOCK_MAJOR_VERSION_2, logger),
-                         m_upgradeDetectorV3(currency, m_blocks, BLOCK_MAJOR_VERSION_3, logger),
-                         m_upgradeDetectorV4(currency, m_blocks, BLOCK_MAJOR_VERSION_4, logger), 
-                         m_upgradeDetectorV5(currency, m_blocks, BLOCK_MAJOR_VERSION_5, logger),
-                         m_upgradeDetectorV6(currency, m_blocks, BLOCK_MAJOR_VERSION_6, logger), 
-			 m_upgradeDetectorV7(currency, m_blocks, BLOCK_MAJOR_VERSION_7, logger),
-			 m_upgradeDetectorV8(currency, m_blocks, BLOCK_MAJOR_VERSION_8, logger),
-        		 m_upgradeDetectorV9(currency, m_blocks, BLOCK_MAJOR_VERSION_9, logger) {
+                         m_upgradeDetector(currency, m_headerIndex, logger),
+                         m_difficultyWindow(std::max({ currency.difficultyBlocksCountByBlockVersion(BLOCK_MAJOR_VERSION_1),
+                           currency.difficultyBlocksCountByBlockVersion(BLOCK_MAJOR_VERSION_2),
+                           currency.difficultyBlocksCountByBlockVersion(BLOCK_MAJOR_VERSION_3) })) {
+  m_blockchain_lock.setHoldTimeHistogram(&Common::Metrics::instance().histogram("fuego_lock_hold_seconds",
+    "Time an exclusive lock is held", "lock=\"blockchain\""));
+  m_indexStoredBytes.fill(0);
 }
 
 bool Blockchain::addObserver(IBlockchainStorageObserver* observer) {
@@ -447,22 +456,31 @@ bool Blockchain::checkTransactionSize(size_t blobSize) {
 }
 
 bool Blockchain::haveTransaction(const Crypto::Hash &id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   return m_transactionMap.find(id) != m_transactionMap.end();
 }
 
 bool Blockchain::have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  return  m_spent_keys.find(key_im) != m_spent_keys.end();
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  if (!m_spentKeyFilter.mayContain(key_im)) {
+    return false;
+  }
+
+  bool spent = m_spent_keys.find(key_im) != m_spent_keys.end();
+  if (!spent) {
+    m_spentKeyFilter.countFalsePositive();
+  }
+
+  return spent;
 }
 
 uint32_t Blockchain::getCurrentBlockchainHeight() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   return static_cast<uint32_t>(m_blocks.size());
 }
 
 bool Blockchain::init(const std::string& config_folder, bool load_existing) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
   if (!config_folder.empty() && !Tools::create_directories_if_necessary(config_folder)) {
     logger(ERROR, BRIGHT_RED) << "Failed to create data directory: " << m_config_folder;
     return false;
@@ -470,22 +488,61 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
 
   m_config_folder = config_folder;
 
-  if (!m_blocks.open(appendPath(config_folder, m_currency.blocksFileName()), appendPath(config_folder, m_currency.blockIndexesFileName()), 1024)) {
+  if (!openBlockStore(config_folder)) {
+    return false;
+  }
+
+  try {
+    m_headerIndex.open(appendPath(config_folder, m_currency.blocksFileName() + ".headers"));
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open block header index: " << e.what();
     return false;
   }
 
+  try {
+    m_depositIndex.open(appendPath(config_folder, m_currency.blocksFileName() + ".deposits"));
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open deposit index: " << e.what();
+    return false;
+  }
+
+  if (!load_existing) {
+    m_blocks.clear();
+  }
+
+  syncHeaderIndex();
+  if (m_blocks.empty()) {
+    m_depositIndex.clear();
+  }
+
   if (load_existing && !m_blocks.empty()) {
+    m_checkpoints.start_loading_checkpoints_from_dns();
     logger(INFO, BRIGHT_WHITE) << "Loading blockchain...";
-    BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
+    BlockCacheSerializer loader(*this, static_cast<uint32_t>(m_blocks.size()), get_block_hash(m_blocks.back().bl), logger.getLogger());
     loader.load(appendPath(config_folder, m_currency.blocksCacheFileName()));
 
+    bool journalClean = false;
     if (!loader.loaded()) {
       logger(WARNING, BRIGHT_YELLOW) << "No actual blockchain cache found, rebuilding internal structures...";
       rebuildCache();
+    } else {
+      syncDepositIndex(loader.height());
+      uint32_t cacheHeight = replayJournal(loader.height(), journalClean);
+      if (cacheHeight < m_blocks.size()) {
+        logger(WARNING, BRIGHT_YELLOW) << "Blockchain cache covers " << cacheHeight << " of " << m_blocks.size() << " blocks, resuming rebuild...";
+        rebuildCache(cacheHeight);
+        journalClean = false;
+      }
+    }
+
+    m_journal.open(appendPath(config_folder, m_currency.blocksCacheFileName() + ".journal"));
+    if (!journalClean) {
+      // the journal no longer continues the cache file, start both afresh
+      storeCache();
     }
 
-      /* Load (or generate) the indices only if Explorer mode is enabled */
-      if (m_blockchainIndexesEnabled)
+      /* Load the indices kept for the explorer, the missing ones are backfilled */
+      if (m_blockchainIndexes != 0)
       {
         loadBlockchainIndices();
       }
@@ -495,16 +552,21 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
       m_checkpoints.load_checkpoints_from_dns();
       logger(Logging::INFO) << "Loading DNS checkpoints";
     }
-    else
-    {
-      m_blocks.clear();
-    }
+
+  if (!m_journal.isOpened()) {
+    m_journal.open(appendPath(config_folder, m_currency.blocksCacheFileName() + ".journal"));
+    m_journal.reset();
+  }
+
+  rebuildSpentKeyFilter();
 
   if (m_blocks.empty()) {
+    // there is nothing to backfill on an empty chain
+    m_readyIndexes = m_blockchainIndexes;
     logger(INFO, BRIGHT_WHITE)
       << "Blockchain not loaded, generating genesis block.";
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    pushBlock(m_currency.genesisBlock(), get_block_hash(m_currency.genesisBlock()), bvc, 0);
+    pushBlock(CachedBlock(m_currency.genesisBlock()), bvc, 0);
     if (bvc.m_verification_failed) {
       logger(ERROR, BRIGHT_RED) << "Failed to add genesis block to blockchain";
       return false;
@@ -526,70 +588,32 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
     rollbackBlockchainTo(lastValidCheckpointHeight);
   }
 
-if (!m_upgradeDetectorV2.init() || !m_upgradeDetectorV3.init() || !m_upgradeDetectorV4.init() || !m_upgradeDetectorV5.init() || !m_upgradeDetectorV6.init() || !m_upgradeDetectorV7.init() || !m_upgradeDetectorV8.init() || !m_upgradeDetectorV9.init()) {
+  if (!m_upgradeDetector.init()) {
     logger(ERROR, BRIGHT_RED) << "Failed to initialize upgrade detector. Trying self-healing procedure.";
-}
+  }
 
- bool reinitUpgradeDetectors = false;
-  if (!checkUpgradeHeight(m_upgradeDetectorV2)) {
-    uint32_t upgradeHeight = m_upgradeDetectorV2.upgradeHeight();
-    assert(upgradeHeight != UpgradeDetectorBase::UNDEF_HEIGHT);
-    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
-    " expected=" << static_cast<int>(m_upgradeDetectorV2.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
-    rollbackBlockchainTo(upgradeHeight);
-    reinitUpgradeDetectors = true;
-  } else if (!checkUpgradeHeight(m_upgradeDetectorV3)) {
-    uint32_t upgradeHeight = m_upgradeDetectorV3.upgradeHeight();
-    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
-    " expected=" << static_cast<int>(m_upgradeDetectorV3.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
-    rollbackBlockchainTo(upgradeHeight);
-    reinitUpgradeDetectors = true;
-  } else if (!checkUpgradeHeight(m_upgradeDetectorV4)) {
-    uint32_t upgradeHeight = m_upgradeDetectorV4.upgradeHeight();
-    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
-    " expected=" << static_cast<int>(m_upgradeDetectorV4.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
-    rollbackBlockchainTo(upgradeHeight);
-    reinitUpgradeDetectors = true;
-  } else if (!checkUpgradeHeight(m_upgradeDetectorV5)) {
-    uint32_t upgradeHeight = m_upgradeDetectorV5.upgradeHeight();
-    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
-    " expected=" << static_cast<int>(m_upgradeDetectorV5.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
-    rollbackBlockchainTo(upgradeHeight);
-    reinitUpgradeDetectors = true;
-  } else if (!checkUpgradeHeight(m_upgradeDetectorV6)) {
-    uint32_t upgradeHeight = m_upgradeDetectorV6.upgradeHeight();
-    logger(WARNING, BRIGHT_MAGENTA) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
-    " expected=" << static_cast<int>(m_upgradeDetectorV6.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
-    rollbackBlockchainTo(upgradeHeight);
-    reinitUpgradeDetectors = true;
-  } else if (!checkUpgradeHeight(m_upgradeDetectorV7)) {
-    uint32_t upgradeHeight = m_upgradeDetectorV7.upgradeHeight();
-    logger(WARNING, BRIGHT_MAGENTA) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
-    " expected=" << static_cast<int>(m_upgradeDetectorV7.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
-    rollbackBlockchainTo(upgradeHeight);
-    reinitUpgradeDetectors = true;
-  } else if (!checkUpgradeHeight(m_upgradeDetectorV8)) {
-    uint32_t upgradeHeight = m_upgradeDetectorV8.upgradeHeight();
-    logger(WARNING, BRIGHT_MAGENTA) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
-    " expected=" << static_cast<int>(m_upgradeDetectorV8.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
-    rollbackBlockchainTo(upgradeHeight);
-    reinitUpgradeDetectors = true;
-  } else if (!checkUpgradeHeight(m_upgradeDetectorV9)) {
-    uint32_t upgradeHeight = m_upgradeDetectorV9.upgradeHeight();
-    logger(WARNING, BRIGHT_MAGENTA) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
-    " expected=" << static_cast<int>(m_upgradeDetectorV9.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
-    rollbackBlockchainTo(upgradeHeight);
-    reinitUpgradeDetectors = true;
-  }
-  if (reinitUpgradeDetectors && (!m_upgradeDetectorV2.init() || !m_upgradeDetectorV3.init() || !m_upgradeDetectorV4.init() || !m_upgradeDetectorV5.init() || !m_upgradeDetectorV6.init() || !m_upgradeDetectorV7.init() || !m_upgradeDetectorV8.init() || !m_upgradeDetectorV9.init())) {
+  bool reinitUpgradeDetector = false;
+  for (uint8_t version = UpgradeDetector::FIRST_VERSION; version <= UpgradeDetector::LAST_VERSION; ++version) {
+    if (!checkUpgradeHeight(version)) {
+      uint32_t upgradeHeight = m_upgradeDetector.upgradeHeight(version);
+      assert(upgradeHeight != UpgradeDetectorBase::UNDEF_HEIGHT);
+      logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_headerIndex[upgradeHeight + 1].majorVersion) <<
+      " expected=" << static_cast<int>(version) << ". Rollback blockchain to height=" << upgradeHeight;
+      rollbackBlockchainTo(upgradeHeight);
+      reinitUpgradeDetector = true;
+      break;
+    }
+  }
+
+  if (reinitUpgradeDetector && !m_upgradeDetector.init()) {
     logger(ERROR, BRIGHT_RED) << "Failed again to initialize upgrade detector";
     return false;
   }
 
   update_next_comulative_size_limit();
 
-  uint64_t timestamp_diff = time(NULL) - m_blocks.back().bl.timestamp;
-  if (!m_blocks.back().bl.timestamp) {
+  uint64_t timestamp_diff = time(NULL) - m_headerIndex.back().timestamp;
+  if (!m_headerIndex.back().timestamp) {
     timestamp_diff = time(NULL) - 1341378000;
   }
 
@@ -597,6 +621,12 @@ if (!m_upgradeDetectorV2.init() || !m_upgradeDetectorV3.init() || !m_upgradeDete
     << "Blockchain initialized. last block: " << m_blocks.size() - 1 << ", "
     << Common::timeIntervalToString(timestamp_diff)
     << " time ago, current difficulty: " << getDifficultyForNextBlock();
+
+  if ((m_blockchainIndexes & ~m_readyIndexes) != 0) {
+    m_stopIndexBackfill = false;
+    m_indexBackfill = std::thread(&Blockchain::backfillIndexes, this);
+  }
+
   return true;
 }
 
@@ -623,83 +653,635 @@ if (!m_upgradeDetectorV2.init() || !m_upgradeDetectorV3.init() || !m_upgradeDete
     return true;
   }
 
-  void Blockchain::rebuildCache()
-  {
-    logger(INFO, BRIGHT_WHITE) << "Rebuilding cache";
+struct Blockchain::CacheShard {
+  uint32_t begin;
+  uint32_t end;
+  bool complete;
+  std::vector<Crypto::Hash> blockHashes;
+  std::vector<std::pair<Crypto::Hash, TransactionIndex>> transactions;
+  std::vector<std::pair<Crypto::KeyImage, uint32_t>> spentKeys;
+  std::vector<std::pair<uint64_t, std::pair<TransactionIndex, uint16_t>>> keyOutputs;
+  std::vector<std::pair<uint64_t, MultisignatureOutputUsage>> multisignatureOutputs;
+  std::vector<std::pair<uint64_t, uint32_t>> multisignatureSpends;
+  std::vector<std::pair<int64_t, uint64_t>> deposits;
+
+  void serialize(ISerializer& s) {
+    s(blockHashes, "blocks");
+    s(transactions, "transactions");
+    s(spentKeys, "spent_keys");
+    s(keyOutputs, "outputs");
+    s(multisignatureOutputs, "multisig_outputs");
+    s(multisignatureSpends, "multisig_spends");
+    s(deposits, "deposits");
+  }
+};
 
-    std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+void Blockchain::rebuildCache(uint32_t startHeight) {
+  logger(INFO, BRIGHT_WHITE) << "Rebuilding cache";
+
+  std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+  if (startHeight == 0) {
     m_blockIndex.clear();
     m_transactionMap.clear();
     m_spent_keys.clear();
     m_outputs.clear();
     m_multisignatureOutputs.clear();
-    for (uint32_t b = 0; b < m_blocks.size(); ++b)
-    {
-      if (b % 1000 == 0)
-      {
-        logger(INFO, BRIGHT_WHITE) << "Rebuilding Cache for Height " << b << " of " << m_blocks.size();
-      }
-
-      const BlockEntry &block = m_blocks[b];
-      Crypto::Hash blockHash = get_block_hash(block.bl);
-      m_blockIndex.push(blockHash);
-      uint64_t interest = 0;
-      for (uint16_t t = 0; t < block.transactions.size(); ++t)
-      {
-        const TransactionEntry &transaction = block.transactions[t];
-        Crypto::Hash transactionHash = getObjectHash(transaction.tx);
-        TransactionIndex transactionIndex = {b, t};
-        m_transactionMap.insert(std::make_pair(transactionHash, transactionIndex));
+    m_depositIndex.clear();
+  } else {
+    m_depositIndex.popBlocks(startHeight);
+  }
+
+  const uint32_t height = static_cast<uint32_t>(m_blocks.size());
+  const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+  const uint32_t checkpointInterval = 100000;
+
+  // blocks are decoded and hashed in parallel, one contiguous range per thread;
+  // ranges are merged in height order so the result matches a sequential rebuild
+  for (uint32_t batchBegin = startHeight; batchBegin < height; ) {
+    uint32_t batchEnd = std::min(height, batchBegin + checkpointInterval);
+    uint32_t shardSize = (batchEnd - batchBegin + threadCount - 1) / threadCount;
+
+    std::vector<CacheShard> shards;
+    for (uint32_t begin = batchBegin; begin < batchEnd; begin += shardSize) {
+      CacheShard shard;
+      shard.begin = begin;
+      shard.end = std::min(batchEnd, begin + shardSize);
+      shard.complete = false;
+      shards.push_back(std::move(shard));
+    }
 
-        // process inputs
-        for (auto &i : transaction.tx.inputs)
-        {
-          if (i.type() == typeid(KeyInput))
-          {
-            m_spent_keys.insert(std::make_pair(::boost::get<KeyInput>(i).keyImage, b));
-          }
-          else if (i.type() == typeid(MultisignatureInput))
-          {
-            auto out = ::boost::get<MultisignatureInput>(i);
-            m_multisignatureOutputs[out.amount][out.outputIndex].isUsed = true;
-          }
-        }
+    m_blocks.beginSharedAccess();
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < shards.size(); ++i) {
+      workers.emplace_back(&Blockchain::collectCacheShard, this, std::ref(shards[i]));
+    }
 
-      // process outputs
-      for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
-        const auto& out = transaction.tx.outputs[o];
-        if (out.target.type() == typeid(KeyOutput)) {
-          m_outputs[out.amount].push_back(std::make_pair<>(transactionIndex, o));
-        } else if (out.target.type() == typeid(MultisignatureOutput)) {
-          MultisignatureOutputUsage usage = { transactionIndex, o, false };
-          m_multisignatureOutputs[out.amount].push_back(usage);
+    collectCacheShard(shards[0]);
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    m_blocks.endSharedAccess();
+
+    for (CacheShard& shard : shards) {
+      if (!shard.complete) {
+        // the items file could not be mapped, read the remaining blocks through the cache
+        for (uint32_t b = shard.begin + static_cast<uint32_t>(shard.blockHashes.size()); b < shard.end; ++b) {
+          const BlockEntry& block = m_blocks[b];
+          collectCacheBlock(shard, b, block, CachedBlock(block.bl));
         }
       }
-        interest += m_currency.calculateTotalTransactionInterest(transaction.tx, b); //block.height); //block.height shows 0 wrongly sometimes apparently
+
+      mergeCacheShard(shard);
+    }
+
+    batchBegin = batchEnd;
+    logger(INFO, BRIGHT_WHITE) << "Rebuilding Cache for Height " << batchEnd << " of " << height;
+
+    if (batchEnd < height) {
+      BlockCacheSerializer ser(*this, batchEnd, m_blockIndex.getBlockId(batchEnd - 1), logger.getLogger());
+      if (!ser.save(appendPath(m_config_folder, m_currency.blocksCacheFileName()))) {
+        logger(WARNING, BRIGHT_YELLOW) << "Failed to save intermediate blockchain cache";
       }
-      pushToDepositIndex(block, interest);
+
+      m_depositIndex.flush();
     }
+  }
+
+  m_outputs.compact();
 
   std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
   logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
 }
 
+void Blockchain::collectCacheShard(CacheShard& shard) {
+  std::vector<uint8_t> buffer;
+  for (uint32_t b = shard.begin; b < shard.end; ++b) {
+    const uint8_t* data;
+    uint64_t size;
+    if (!m_blocks.getSerializedItem(b, data, size, buffer)) {
+      return;
+    }
+
+    BlockEntry block;
+    Common::MemoryInputStream stream(data, static_cast<size_t>(size));
+    BinaryInputStreamSerializer archive(stream);
+    CryptoNote::serialize(block, archive);
+    collectCacheBlock(shard, b, block, CachedBlock(block.bl));
+  }
+
+  shard.complete = true;
+}
+
+// The block already lists the hashes of its transactions, only the base transaction is hashed here
+void Blockchain::collectCacheBlock(CacheShard& shard, uint32_t height, const BlockEntry& block, const CachedBlock& cachedBlock) {
+  shard.blockHashes.push_back(cachedBlock.getBlockHash());
+  uint64_t interest = 0;
+  for (uint16_t t = 0; t < block.transactions.size(); ++t) {
+    const TransactionEntry& transaction = block.transactions[t];
+    TransactionIndex transactionIndex = { height, t };
+    const Crypto::Hash& transactionHash = t == 0 ? cachedBlock.getBaseTransaction().getTransactionHash() : block.bl.transactionHashes[t - 1];
+    shard.transactions.push_back(std::make_pair(transactionHash, transactionIndex));
+
+    for (auto& i : transaction.tx.inputs) {
+      if (i.type() == typeid(KeyInput)) {
+        shard.spentKeys.push_back(std::make_pair(::boost::get<KeyInput>(i).keyImage, height));
+      } else if (i.type() == typeid(MultisignatureInput)) {
+        const auto& in = ::boost::get<MultisignatureInput>(i);
+        shard.multisignatureSpends.push_back(std::make_pair(in.amount, in.outputIndex));
+      }
+    }
+
+    for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
+      const auto& out = transaction.tx.outputs[o];
+      if (out.target.type() == typeid(KeyOutput)) {
+        shard.keyOutputs.push_back(std::make_pair(out.amount, std::make_pair(transactionIndex, o)));
+      } else if (out.target.type() == typeid(MultisignatureOutput)) {
+        MultisignatureOutputUsage usage = { transactionIndex, o, false, transactionHash, transaction.tx.unlockTime, ::boost::get<MultisignatureOutput>(out.target) };
+        shard.multisignatureOutputs.push_back(std::make_pair(out.amount, usage));
+      }
+    }
+
+    interest += m_currency.calculateTotalTransactionInterest(transaction.tx, height);
+  }
+
+  shard.deposits.push_back(std::make_pair(blockDepositAmount(block), interest));
+}
+
+void Blockchain::mergeCacheShard(const CacheShard& shard) {
+  for (const auto& blockHash : shard.blockHashes) {
+    m_blockIndex.push(blockHash);
+  }
+
+  m_transactionMap.insert(shard.transactions.begin(), shard.transactions.end());
+  m_spent_keys.insert(shard.spentKeys.begin(), shard.spentKeys.end());
+
+  for (const auto& output : shard.keyOutputs) {
+    m_outputs.push(output.first, output.second.first.block, output.second.first.transaction, output.second.second);
+  }
+
+  // outputs first: a spend may refer to an output created earlier in the same range
+  for (const auto& output : shard.multisignatureOutputs) {
+    m_multisignatureOutputs[output.first].push_back(output.second);
+  }
+
+  for (const auto& spend : shard.multisignatureSpends) {
+    auto& outputs = m_multisignatureOutputs[spend.first];
+    if (spend.second < outputs.size()) {
+      outputs[spend.second].isUsed = true;
+    }
+  }
+
+  for (const auto& deposit : shard.deposits) {
+    m_depositIndex.pushBlock(deposit.first, deposit.second);
+  }
+}
+
+void Blockchain::rebuildSpentKeyFilter() {
+  // sized for twice the current set, so it is rebuilt roughly every time the set doubles
+  m_spentKeyFilter.reset(m_spent_keys.size() * 2);
+  for (const auto& spentKey : m_spent_keys) {
+    m_spentKeyFilter.insert(spentKey.first);
+  }
+}
+
+KeyImageFilter::Stats Blockchain::getSpentKeyFilterStats() {
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  return m_spentKeyFilter.getStats();
+}
+
+uint32_t Blockchain::replayJournal(uint32_t cacheHeight, bool& clean) {
+  std::vector<BlockchainJournalRecord> records;
+  clean = BlockchainJournal::load(appendPath(m_config_folder, m_currency.blocksCacheFileName() + ".journal"), records);
+  if (!clean) {
+    logger(WARNING, BRIGHT_YELLOW) << "Blockchain journal ends in a torn record, replaying the intact part";
+  }
+
+  // fold pops into the pushes before them, leaving the chain the journal describes
+  std::vector<const BlockchainJournalRecord*> pushes;
+  for (const auto& record : records) {
+    uint32_t tip = cacheHeight + static_cast<uint32_t>(pushes.size());
+    if (record.type == BlockchainJournalRecordType::PUSH && record.height == tip) {
+      pushes.push_back(&record);
+    } else if (record.type == BlockchainJournalRecordType::POP && !pushes.empty() && pushes.back()->blockHash == record.blockHash) {
+      pushes.pop_back();
+    } else {
+      clean = false;
+      break;
+    }
+  }
+
+  while (!pushes.empty() && pushes.back()->height >= m_blocks.size()) {
+    pushes.pop_back();
+    clean = false;
+  }
+
+  // the journal is written in the same order as the blocks, so a matching tip vouches for the rest
+  if (pushes.empty() || pushes.back()->blockHash != get_block_hash(m_blocks[pushes.back()->height].bl)) {
+    clean = clean && pushes.empty();
+    return cacheHeight;
+  }
+
+  std::vector<CacheShard> deltas(pushes.size());
+  for (size_t i = 0; i < pushes.size(); ++i) {
+    if (!fromBinaryArray(deltas[i], pushes[i]->delta)) {
+      logger(WARNING, BRIGHT_YELLOW) << "Blockchain journal record at height " << pushes[i]->height << " is malformed, ignoring the journal";
+      clean = false;
+      return cacheHeight;
+    }
+  }
+
+  for (const auto& delta : deltas) {
+    mergeCacheShard(delta);
+  }
+
+  logger(INFO, BRIGHT_WHITE) << "Replayed " << deltas.size() << " blocks from the blockchain journal";
+  return cacheHeight + static_cast<uint32_t>(deltas.size());
+}
+
 bool Blockchain::storeCache() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
 
   logger(INFO, BRIGHT_WHITE) << "Saving blockchain...";
-  BlockCacheSerializer ser(*this, getTailId(), logger.getLogger());
+  BlockCacheSerializer ser(*this, static_cast<uint32_t>(m_blocks.size()), getTailId(), logger.getLogger());
   if (!ser.save(appendPath(m_config_folder, m_currency.blocksCacheFileName()))) {
     logger(ERROR, BRIGHT_RED) << "Failed to save blockchain cache";
     return false;
   }
+
+  m_journal.reset();
+  m_headerIndex.flush();
+  m_depositIndex.flush();
     logger(INFO, BRIGHT_GREEN) << "Fuego blockchain was successfully saved.";
   return true;
 }
 
+bool Blockchain::exportSnapshot(const std::string& path) {
+  // shared access keeps writers out, so the blocks and caches describe the same tail
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+
+  try {
+    logger(INFO, BRIGHT_WHITE) << "Exporting blockchain snapshot to " << path << "...";
+    uint32_t flags = m_readyIndexes != 0 ? BLOCKCHAIN_SNAPSHOT_HAS_INDICES : 0;
+    BlockchainSnapshotWriter writer(path, m_currency.genesisBlockHash(), m_blocks.size(), getTailId(), flags);
+
+    std::vector<uint8_t> buffer;
+    for (uint64_t i = 0; i < m_blocks.size(); ++i) {
+      const uint8_t* data;
+      uint64_t size;
+      if (!m_blocks.getSerializedItem(i, data, size, buffer)) {
+        logger(ERROR, BRIGHT_RED) << "Failed to read block " << i << " for snapshot";
+        return false;
+      }
+
+      writer.addBlock(data, size);
+    }
+
+    BlockCacheSerializer cache(*this, static_cast<uint32_t>(m_blocks.size()), getTailId(), logger.getLogger());
+    writer.addSection(BlockchainSnapshotSection::CACHE, storeToBinary(cache));
+    if (m_readyIndexes != 0) {
+      BlockchainIndicesSerializer indices(*this, getTailId(), logger.getLogger());
+      writer.addSection(BlockchainSnapshotSection::INDICES, storeToBinary(indices));
+    }
+
+    writer.finish();
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to export blockchain snapshot: " << e.what();
+    return false;
+  }
+
+  logger(INFO, BRIGHT_GREEN) << "Blockchain snapshot exported, height " << m_blocks.size();
+  return true;
+}
+
+struct Blockchain::ChainVerification {
+  uint32_t endHeight;
+  bool checkProofOfWork;
+  bool checkSignatures;
+  std::atomic<uint32_t> nextSlice;
+  std::atomic<uint32_t> checkedBlocks;
+  std::atomic<uint64_t> checkedTransactions;
+  std::atomic<uint64_t> checkedSignatures;
+
+  std::mutex errorsLock;
+  uint64_t errorCount;
+  std::vector<std::string> errors;
+
+  void fail(uint32_t height, const std::string& what) {
+    std::lock_guard<std::mutex> lock(errorsLock);
+    if (errors.size() < VERIFY_CHAIN_MAX_ERRORS) {
+      errors.push_back("block " + std::to_string(height) + ": " + what);
+    }
+
+    ++errorCount;
+  }
+};
+
+bool Blockchain::verifyChain(uint32_t startHeight, uint32_t endHeight, bool checkProofOfWork, bool checkSignatures, uint32_t threads, ChainVerificationReport& report) {
+  endHeight = std::min(endHeight, getCurrentBlockchainHeight());
+  if (startHeight >= endHeight) {
+    logger(ERROR, BRIGHT_RED) << "No blocks to verify from height " << startHeight;
+    return false;
+  }
+
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency() - 1);
+  }
+
+  ChainVerification verification;
+  verification.endHeight = endHeight;
+  verification.checkProofOfWork = checkProofOfWork;
+  verification.checkSignatures = checkSignatures;
+  verification.nextSlice = startHeight;
+  verification.checkedBlocks = 0;
+  verification.checkedTransactions = 0;
+  verification.checkedSignatures = 0;
+  verification.errorCount = 0;
+
+  logger(INFO, BRIGHT_WHITE) << "Verifying blocks " << startHeight << " to " << endHeight - 1 << " on " << threads << " threads";
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<std::future<void>> workers;
+  for (uint32_t i = 0; i < threads; ++i) {
+    workers.push_back(std::async(std::launch::async, &Blockchain::verifyChainSlices, this, std::ref(verification)));
+  }
+
+  for (auto& worker : workers) {
+    while (worker.wait_for(std::chrono::seconds(10)) != std::future_status::ready) {
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      uint32_t checked = verification.checkedBlocks;
+      logger(INFO) << "Verified " << checked << " of " << endHeight - startHeight << " blocks, " <<
+        static_cast<uint64_t>(checked / elapsed.count()) << " blocks/s";
+    }
+
+    worker.get();
+  }
+
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+  report.checkedBlocks = verification.checkedBlocks;
+  report.checkedTransactions = verification.checkedTransactions;
+  report.checkedSignatures = verification.checkedSignatures;
+  report.errorCount = verification.errorCount;
+  report.errors = std::move(verification.errors);
+  report.seconds = duration.count();
+  return report.errorCount == 0;
+}
+
+// Slices are claimed in height order by whichever worker is free, so a range of heavy blocks
+// doesn't hold up the others. The lock is let go between slices for blocks to be added.
+void Blockchain::verifyChainSlices(ChainVerification& verification) {
+  Crypto::cn_context context;
+  std::vector<uint8_t> buffer;
+  for (;;) {
+    uint32_t begin = verification.nextSlice.fetch_add(VERIFY_CHAIN_SLICE);
+    if (begin >= verification.endHeight) {
+      return;
+    }
+
+    ReadLock lk(*this, LOCK_SITE("blockchain"));
+    uint32_t end = std::min(verification.endHeight, begin + VERIFY_CHAIN_SLICE);
+    if (end > m_blocks.size()) {
+      // popped by a chain switch meanwhile, what replaces them gets checked on the way in
+      end = static_cast<uint32_t>(m_blocks.size());
+    }
+
+    for (uint32_t height = begin; height < end; ++height) {
+      BlockEntry block;
+      try {
+        const uint8_t* data;
+        uint64_t size;
+        if (m_blocks.getSerializedItem(height, data, size, buffer)) {
+          Common::MemoryInputStream stream(data, static_cast<size_t>(size));
+          BinaryInputStreamSerializer archive(stream);
+          CryptoNote::serialize(block, archive);
+        } else {
+          block = m_blocks[height];
+        }
+      } catch (std::exception& e) {
+        verification.fail(height, std::string("can't be read, ") + e.what());
+        continue;
+      }
+
+      verifyChainBlock(verification, height, block, context);
+    }
+  }
+}
+
+void Blockchain::verifyChainBlock(ChainVerification& verification, uint32_t height, const BlockEntry& block, Crypto::cn_context& context) {
+  struct OutputKeysCollector {
+    std::vector<const Crypto::PublicKey*>& keys;
+
+    bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex) {
+      if (out.target.type() != typeid(KeyOutput)) {
+        return false;
+      }
+
+      keys.push_back(&boost::get<KeyOutput>(out.target).key);
+      return true;
+    }
+  };
+
+  CachedBlock cachedBlock(block.bl);
+  const Crypto::Hash& blockHash = cachedBlock.getBlockHash();
+  uint32_t indexedHeight;
+  if (block.height != height) {
+    verification.fail(height, "stored with height " + std::to_string(block.height));
+  }
+
+  if (m_blockIndex.getBlockId(height) != blockHash || !m_blockIndex.getBlockHeight(blockHash, indexedHeight) || indexedHeight != height) {
+    verification.fail(height, "hash " + Common::podToHex(blockHash) + " disagrees with the block index");
+  }
+
+  if (height != 0 && block.bl.previousBlockHash != m_blockIndex.getBlockId(height - 1)) {
+    verification.fail(height, "doesn't link to the block below it");
+  }
+
+  if (!m_checkpoints.check_block(height, blockHash)) {
+    verification.fail(height, "doesn't match the checkpoint");
+  }
+
+  const BlockHeaderSummary& header = m_headerIndex[height];
+  if (header.timestamp != block.bl.timestamp || header.cumulativeSize != block.block_cumulative_size ||
+      header.cumulativeDifficulty != block.cumulative_difficulty || header.generatedCoins != block.already_generated_coins ||
+      header.majorVersion != block.bl.majorVersion || header.minorVersion != block.bl.minorVersion) {
+    verification.fail(height, "disagrees with the header index");
+  }
+
+  if (verification.checkProofOfWork && height != 0) {
+    difficulty_type difficulty = block.cumulative_difficulty - m_headerIndex[height - 1].cumulativeDifficulty;
+    Crypto::Hash proofOfWork;
+    if (!m_currency.checkProofOfWork(context, block.bl, difficulty, proofOfWork)) {
+      verification.fail(height, "proof of work doesn't meet difficulty " + std::to_string(difficulty));
+    }
+  }
+
+  if (block.transactions.size() != block.bl.transactionHashes.size() + 1) {
+    verification.fail(height, "holds " + std::to_string(block.transactions.size()) + " transactions for " +
+      std::to_string(block.bl.transactionHashes.size() + 1) + " hashes");
+    ++verification.checkedBlocks;
+    return;
+  }
+
+  uint64_t checkedSignatures = 0;
+  for (uint16_t t = 0; t < block.transactions.size(); ++t) {
+    const TransactionEntry& transaction = block.transactions[t];
+    CachedTransaction cachedTransaction(transaction.tx);
+    const Crypto::Hash& transactionHash = cachedTransaction.getTransactionHash();
+    const Crypto::Hash& expectedHash = t == 0 ? cachedBlock.getBaseTransaction().getTransactionHash() : block.bl.transactionHashes[t - 1];
+    if (transactionHash != expectedHash) {
+      verification.fail(height, "transaction " + std::to_string(t) + " doesn't match its hash in the block");
+      continue;
+    }
+
+    auto indexed = m_transactionMap.find(transactionHash);
+    if (indexed == m_transactionMap.end() || indexed->second.block != height || indexed->second.transaction != t) {
+      verification.fail(height, "transaction " + Common::podToHex(transactionHash) + " is missing from the cache");
+    }
+
+    for (size_t i = 0; i < transaction.tx.inputs.size(); ++i) {
+      if (transaction.tx.inputs[i].type() != typeid(KeyInput)) {
+        continue;
+      }
+
+      const KeyInput& input = boost::get<KeyInput>(transaction.tx.inputs[i]);
+      auto spent = m_spent_keys.find(input.keyImage);
+      if (spent == m_spent_keys.end() || spent->second != height) {
+        verification.fail(height, "key image " + Common::podToHex(input.keyImage) + " is missing from the cache");
+      }
+
+      if (verification.checkSignatures) {
+        std::vector<const Crypto::PublicKey*> keys;
+        OutputKeysCollector collector{ keys };
+        if (i >= transaction.tx.signatures.size() || !scanOutputKeysForIndexes(input, collector) ||
+            keys.size() != transaction.tx.signatures[i].size() ||
+            !Crypto::check_ring_signature(cachedTransaction.getTransactionPrefixHash(), input.keyImage, keys.data(), keys.size(), transaction.tx.signatures[i].data())) {
+          verification.fail(height, "transaction " + Common::podToHex(transactionHash) + " has a bad ring signature on input " + std::to_string(i));
+        }
+
+        ++checkedSignatures;
+      }
+    }
+
+    if (transaction.m_global_output_indexes.size() != transaction.tx.outputs.size()) {
+      verification.fail(height, "transaction " + Common::podToHex(transactionHash) + " has no global index for every output");
+      continue;
+    }
+
+    for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
+      const TransactionOutput& output = transaction.tx.outputs[o];
+      uint32_t globalIndex = transaction.m_global_output_indexes[o];
+      if (output.target.type() == typeid(MultisignatureOutput)) {
+        const MultisignatureOutput& target = ::boost::get<MultisignatureOutput>(output.target);
+        auto amountOutputs = m_multisignatureOutputs.find(output.amount);
+        const MultisignatureOutputUsage* usage = amountOutputs != m_multisignatureOutputs.end() && globalIndex < amountOutputs->second.size() ?
+          &amountOutputs->second[globalIndex] : nullptr;
+        if (usage == nullptr || usage->transactionIndex.block != height || usage->transactionIndex.transaction != t || usage->outputIndex != o ||
+            usage->transactionHash != transactionHash || usage->unlockTime != transaction.tx.unlockTime || usage->output.keys != target.keys ||
+            usage->output.requiredSignatureCount != target.requiredSignatureCount || usage->output.term != target.term) {
+          verification.fail(height, "multisignature output " + std::to_string(o) + " of transaction " + Common::podToHex(transactionHash) + " disagrees with the multisignature output index");
+        }
+
+        continue;
+      }
+
+      OutputIndex::Outputs outputs = m_outputs.find(output.amount);
+      if (globalIndex >= outputs.size() || outputs.block(globalIndex) != height || outputs.transaction(globalIndex) != t || outputs.output(globalIndex) != o) {
+        verification.fail(height, "output " + std::to_string(o) + " of transaction " + Common::podToHex(transactionHash) + " disagrees with the output index");
+      }
+    }
+  }
+
+  ++verification.checkedBlocks;
+  verification.checkedTransactions += block.transactions.size();
+  verification.checkedSignatures += checkedSignatures;
+}
+
+bool Blockchain::importSnapshot(const std::string& config_folder, const std::string& snapshotPath) {
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
+
+  for (const std::string& suffix : { std::string(), std::string(BLOCK_STORE_COMPRESSED_SUFFIX) }) {
+    std::ifstream existing(appendPath(config_folder, m_currency.blockIndexesFileName() + suffix), std::ios::binary);
+    uint64_t existingCount = 0;
+    if (existing && existing.read(reinterpret_cast<char*>(&existingCount), sizeof(existingCount)) && existingCount > 1) {
+      logger(ERROR, BRIGHT_RED) << "Refusing to import a snapshot over an existing blockchain of " << existingCount << " blocks";
+      return false;
+    }
+  }
+
+  BlockchainSnapshotFiles files;
+  files.blocks = appendPath(config_folder, m_currency.blocksFileName());
+  files.blockIndexes = appendPath(config_folder, m_currency.blockIndexesFileName());
+  files.cache = appendPath(config_folder, m_currency.blocksCacheFileName());
+  files.indices = appendPath(config_folder, m_currency.blockchinIndicesFileName());
+  return importBlockchainSnapshot(snapshotPath, m_currency.genesisBlockHash(), files, logger.getLogger());
+}
+
+bool Blockchain::openBlockStore(const std::string& config_folder) {
+  std::string items = appendPath(config_folder, m_currency.blocksFileName());
+  std::string indexes = appendPath(config_folder, m_currency.blockIndexesFileName());
+  std::string otherItems = items + BLOCK_STORE_COMPRESSED_SUFFIX;
+  std::string otherIndexes = indexes + BLOCK_STORE_COMPRESSED_SUFFIX;
+  if (m_blockStoreChunk != 0) {
+    std::swap(items, otherItems);
+    std::swap(indexes, otherIndexes);
+  }
+
+  bool otherExists = static_cast<bool>(std::ifstream(otherIndexes));
+  if ((m_blockStoreChunk != 0 || otherExists) && !Common::compressionSupported()) {
+    logger(ERROR, BRIGHT_RED) << "Compressed block storage needs a build with FUEGO_BLOCK_COMPRESSION";
+    return false;
+  }
+
+  if (!m_blocks.open(items, indexes, m_blockCacheSize, m_blockStoreChunk)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open block storage " << items;
+    return false;
+  }
+
+  if (!m_blocks.empty() || !otherExists) {
+    return true;
+  }
+
+  // the storage kind was switched, move the blocks over and drop the old files
+  {
+    Blocks other;
+    if (!other.open(otherItems, otherIndexes, m_blockCacheSize, m_blockStoreChunk != 0 ? 0 : 1)) {
+      logger(ERROR, BRIGHT_RED) << "Failed to open block storage " << otherItems;
+      return false;
+    }
+
+    logger(INFO, BRIGHT_WHITE) << "Converting " << other.size() << " stored blocks to " <<
+      (m_blockStoreChunk != 0 ? "compressed" : "plain") << " storage...";
+    for (uint64_t i = 0; i < other.size(); ++i) {
+      m_blocks.push_back(other[i]);
+    }
+  }
+
+  uint64_t blockBytes = 0;
+  uint64_t fileBytes = 0;
+  m_blocks.storageUsage(blockBytes, fileBytes);
+  logger(INFO, BRIGHT_WHITE) << "Block storage converted, " << blockBytes << " bytes of blocks in " << fileBytes << " bytes";
+  std::remove(otherItems.c_str());
+  std::remove(otherIndexes.c_str());
+  std::remove((otherIndexes + ".chunks").c_str());
+  return true;
+}
+
+void Blockchain::setBlockCacheSize(uint64_t bytes) {
+  assert(bytes != 0);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
+  m_blockCacheSize = bytes;
+  m_blocks.setCacheBudget(bytes);
+}
+
 bool Blockchain::deinit() {
+  if (m_indexBackfill.joinable()) {
+    m_stopIndexBackfill = true;
+    m_indexBackfill.join();
+  }
+
   storeCache();
-  if (m_blockchainIndexesEnabled) {
+  m_journal.close();
+  m_headerIndex.close();
+  m_depositIndex.close();
+  if (m_readyIndexes != 0) {
     storeBlockchainIndices();
   }
   assert(m_messageQueueList.empty());
@@ -707,19 +1289,20 @@ bool Blockchain::deinit() {
 }
 
 bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
   m_blocks.clear();
+  m_headerIndex.clear();
+  m_depositIndex.clear();
   m_blockIndex.clear();
   m_transactionMap.clear();
 
   m_spent_keys.clear();
+  rebuildSpentKeyFilter();
   m_alternative_chains.clear();
   m_outputs.clear();
 
-  m_paymentIdIndex.clear();
-  m_timestampIndex.clear();
-  m_generatedTransactionsIndex.clear();
-  m_orthanBlocksIndex.clear();
+  clearIndexes(BLOCKCHAIN_INDEX_ALL);
+  m_readyIndexes = m_blockchainIndexes;
 
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
   addNewBlock(b, bvc);
@@ -728,24 +1311,24 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
 
 Crypto::Hash Blockchain::getTailId(uint32_t& height) {
   assert(!m_blocks.empty());
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   height = getCurrentBlockchainHeight() - 1;
   return getTailId();
 }
 
 Crypto::Hash Blockchain::getTailId() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   return m_blocks.empty() ? NULL_HASH : m_blockIndex.getTailId();
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   assert(m_blockIndex.size() != 0);
   return doBuildSparseChain(m_blockIndex.getTailId());
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain(const Crypto::Hash& startBlockId) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   assert(haveBlock(startBlockId));
   return doBuildSparseChain(startBlockId);
 }
@@ -782,13 +1365,13 @@ std::vector<Crypto::Hash> Blockchain::doBuildSparseChain(const Crypto::Hash& sta
 }
 
 Crypto::Hash Blockchain::getBlockIdByHeight(uint32_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   assert(height < m_blockIndex.size());
   return m_blockIndex.getBlockId(height);
 }
 
 bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
 
   uint32_t height = 0;
 
@@ -809,97 +1392,81 @@ bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
 }
 
 bool Blockchain::getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lock(m_blockchain_lock);
+  ReadLock lock(*this, LOCK_SITE("blockchain"));
   return m_blockIndex.getBlockHeight(blockId, blockHeight);
 }
 
 difficulty_type Blockchain::getDifficultyForNextBlock() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  std::vector<uint64_t> timestamps;
-  std::vector<difficulty_type> cumulative_difficulties;
-  uint8_t BlockMajorVersion = getBlockMajorVersionForHeight(static_cast<uint32_t>(m_blocks.size()));
-  size_t offset;
-  offset = m_blocks.size() - std::min(m_blocks.size(), static_cast<uint64_t>(m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion)));
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  uint32_t height = static_cast<uint32_t>(m_blocks.size());
+  uint8_t BlockMajorVersion = getBlockMajorVersionForHeight(height);
+  uint32_t offset = height - std::min(height, static_cast<uint32_t>(m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion)));
 
-  if (offset == 0) {
+  if (offset == 0 && height > 0) {
     ++offset;
   }
-  for (; offset < m_blocks.size(); offset++) {
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
-    cumulative_difficulties.push_back(m_blocks[offset].cumulative_difficulty);
-  }
-  return m_currency.nextDifficulty(static_cast<uint32_t>(m_blocks.size()), BlockMajorVersion, timestamps, cumulative_difficulties);
+
+  std::lock_guard<std::mutex> windowLock(m_difficultyWindowLock);
+  fillDifficultyWindow(offset);
+  return m_currency.nextDifficulty(height, BlockMajorVersion, m_difficultyWindow.timestamps(offset, height),
+    m_difficultyWindow.cumulativeDifficulties(offset, height));
 }
 
 uint64_t Blockchain::getBlockTimestamp(uint32_t height) {
-  assert(height < m_blocks.size());
-  return m_blocks[height].bl.timestamp;
+  assert(height < m_headerIndex.size());
+  return m_headerIndex[height].timestamp;
 }
 
 uint64_t Blockchain::getCoinsInCirculation() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   if (m_blocks.empty()) {
     return 0;
   } else {
-    return m_blocks.back().already_generated_coins;
+    return m_headerIndex.back().generatedCoins;
   }
 }
     
 uint64_t Blockchain::coinsEmittedAtHeight(uint64_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  const auto& block = m_blocks[height];
-  return block.already_generated_coins;
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  return m_headerIndex[static_cast<uint32_t>(height)].generatedCoins;
 }
   
   difficulty_type Blockchain::difficultyAtHeight(uint64_t height)
   {
-    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-    const auto &current = m_blocks[height];
+    ReadLock lk(*this, LOCK_SITE("blockchain"));
+    const auto &current = m_headerIndex[static_cast<uint32_t>(height)];
     if (height < 1)
     {
-      return current.cumulative_difficulty;
+      return current.cumulativeDifficulty;
     }
 
-    const auto &previous = m_blocks[height - 1];
-    return current.cumulative_difficulty - previous.cumulative_difficulty;
+    const auto &previous = m_headerIndex[static_cast<uint32_t>(height - 1)];
+    return current.cumulativeDifficulty - previous.cumulativeDifficulty;
   }
   
 uint8_t Blockchain::getBlockMajorVersionForHeight(uint32_t height) const {
-         if (height > m_upgradeDetectorV9.upgradeHeight()) {
-    return m_upgradeDetectorV9.targetVersion();
-  } else if (height > m_upgradeDetectorV8.upgradeHeight()) {
-    return m_upgradeDetectorV8.targetVersion();
-  } else if (height > m_upgradeDetectorV7.upgradeHeight()) {
-    return m_upgradeDetectorV7.targetVersion();
-  } else if (height > m_upgradeDetectorV6.upgradeHeight()) {
-    return m_upgradeDetectorV6.targetVersion();
-  } else if (height > m_upgradeDetectorV5.upgradeHeight()) {
-    return m_upgradeDetectorV5.targetVersion();
-  } else if (height > m_upgradeDetectorV4.upgradeHeight()) {
-    return m_upgradeDetectorV4.targetVersion();
-  } else if (height > m_upgradeDetectorV3.upgradeHeight()) {
-    return m_upgradeDetectorV3.targetVersion();
-  } else if (height > m_upgradeDetectorV2.upgradeHeight()) {
-    return m_upgradeDetectorV2.targetVersion();
-  } else {
-    return BLOCK_MAJOR_VERSION_1;
-  }
+  return m_upgradeDetector.blockMajorVersion(height);
 }
 
-bool Blockchain::rollback_blockchain_switching(std::list<Block> &original_chain, size_t rollback_height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+// Puts back the blocks a failed switch disconnected, original_chain starting at rollback_height
+bool Blockchain::rollback_blockchain_switching(const std::vector<BlockEntry> &original_chain, uint32_t rollback_height) {
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
   // remove failed subchain
-  for (size_t i = m_blocks.size() - 1; i >= rollback_height; i--) {
-    popBlock(get_block_hash(m_blocks.back().bl));
+  while (m_blocks.size() > rollback_height) {
+    popBlock();
   }
 
-    uint32_t height = static_cast<uint32_t>(rollback_height - 1);
-
   // return back original chain
-  for (auto &bl : original_chain) {
+  for (const BlockEntry &entry : original_chain) {
+    std::vector<Transaction> transactions;
+    transactions.reserve(entry.transactions.size() - 1);
+    for (size_t i = 1; i < entry.transactions.size(); ++i) {
+      transactions.push_back(entry.transactions[i].tx);
+    }
+
     block_verification_context bvc =
       boost::value_initialized<block_verification_context>();
-    bool r = pushBlock(bl, get_block_hash(bl), bvc, ++height);
+    bool r = pushBlock(CachedBlock(entry.bl), transactions, bvc);
     if (!(r && bvc.m_added_to_main_chain)) {
       logger(ERROR, BRIGHT_RED) << "PANIC!!! failed to add block (again) while "
         "chain switching during the rollback!";
@@ -929,7 +1496,7 @@ double calc_poisson_ln(double lam, uint64_t k)
 }	
 	
 bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator>& alt_chain, bool discard_disconnected_chain) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
 
   if (!(alt_chain.size())) {
     logger(ERROR, BRIGHT_RED) << "switch_to_alternative_blockchain: empty chain passed";
@@ -999,50 +1566,67 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
 	  }
 	  }
 
-   // Compare transactions in proposed alt chain vs current main chain and reject if some transaction is missing in the alt chain
-  std::vector<Crypto::Hash> mainChainTxHashes, altChainTxHashes;
-  for (size_t i = m_blocks.size() - 1; i >= split_height; i--) {
-    Block b = m_blocks[i].bl;
-    std::copy(b.transactionHashes.begin(), b.transactionHashes.end(), std::inserter(mainChainTxHashes, mainChainTxHashes.end()));
+  // Compare transactions in proposed alt chain vs current main chain and reject if some transaction is missing in the alt chain
+  std::unordered_set<Crypto::Hash> altChainTxHashes;
+  for (const blocks_ext_by_hash::iterator &it : alt_chain) {
+    altChainTxHashes.insert(it->second.bl.transactionHashes.begin(), it->second.bl.transactionHashes.end());
   }
-  for (auto alt_ch_iter = alt_chain.begin(); alt_ch_iter != alt_chain.end(); alt_ch_iter++) {
-    auto ch_ent = *alt_ch_iter;
-    Block b = ch_ent->second.bl;
-    std::copy(b.transactionHashes.begin(), b.transactionHashes.end(), std::inserter(altChainTxHashes, altChainTxHashes.end()));
-  }
-  for (auto main_ch_it = mainChainTxHashes.begin(); main_ch_it != mainChainTxHashes.end(); main_ch_it++) {
-    auto tx_hash = *main_ch_it;
-    if (std::find(altChainTxHashes.begin(), altChainTxHashes.end(), tx_hash) == altChainTxHashes.end()) {
-      logger(ERROR, BRIGHT_RED) << "Attempting to switch to an alternate chain, but it lacks transaction " << Common::podToHex(tx_hash) << " from main chain, rejected";
-      mainChainTxHashes.clear();
-      mainChainTxHashes.shrink_to_fit();
-      altChainTxHashes.clear();
-      altChainTxHashes.shrink_to_fit();
-      return false;
+
+  for (size_t i = split_height; i < m_blocks.size(); ++i) {
+    for (const Crypto::Hash &tx_hash : m_blocks[i].bl.transactionHashes) {
+      if (altChainTxHashes.count(tx_hash) == 0) {
+        logger(ERROR, BRIGHT_RED) << "Attempting to switch to an alternate chain, but it lacks transaction " << Common::podToHex(tx_hash) << " from main chain, rejected";
+        return false;
+      }
     }
   }
-	
-  //disconnecting old chain
-  std::list<Block> disconnected_chain;
-  for (size_t i = m_blocks.size() - 1; i >= split_height; i--) {
-    Block b = m_blocks[i].bl;
-    popBlock(get_block_hash(b));
-    //if (!(r)) { logger(ERROR, BRIGHT_RED) << "failed to remove block on chain switching"; return false; }
-    disconnected_chain.push_front(b);
+
+  // The switch is done in one go under the lock. The disconnected blocks keep their transactions
+  // instead of handing them to the pool, which would check each of them against a chain that is
+  // about to change, and the alternative blocks take them from there before asking the pool.
+  std::vector<BlockEntry> disconnected_chain(m_blocks.size() - split_height);
+  for (size_t i = disconnected_chain.size(); i > 0; --i) {
+    disconnected_chain[i - 1] = m_blocks.back();
+    popBlock();
   }
 
-    uint32_t height = static_cast<uint32_t>(split_height - 1);
+  std::unordered_map<Crypto::Hash, const Transaction*> disconnectedTransactions;
+  for (const BlockEntry &entry : disconnected_chain) {
+    for (size_t i = 0; i < entry.bl.transactionHashes.size(); ++i) {
+      disconnectedTransactions.emplace(entry.bl.transactionHashes[i], &entry.transactions[i + 1].tx);
+    }
+  }
 
   //connecting new alternative chain
+  std::vector<Transaction> poolTransactions;
   for (auto alt_ch_iter = alt_chain.begin(); alt_ch_iter != alt_chain.end(); alt_ch_iter++) {
     auto ch_ent = *alt_ch_iter;
+    const Block &block = ch_ent->second.bl;
+    std::vector<Transaction> transactions(block.transactionHashes.size());
+    bool transactionsFound = true;
+    for (size_t i = 0; i < transactions.size() && transactionsFound; ++i) {
+      auto disconnected = disconnectedTransactions.find(block.transactionHashes[i]);
+      if (disconnected != disconnectedTransactions.end()) {
+        transactions[i] = *disconnected->second;
+        continue;
+      }
+
+      size_t blobSize;
+      uint64_t fee;
+      transactionsFound = m_tx_pool.take_tx(block.transactionHashes[i], transactions[i], blobSize, fee);
+      if (transactionsFound) {
+        poolTransactions.push_back(transactions[i]);
+      }
+    }
+
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    bool r = pushBlock(ch_ent->second.bl, get_block_hash(ch_ent->second.bl), bvc, ++height);
+    bool r = transactionsFound && pushBlock(CachedBlock(block), transactions, bvc);
     if (!r || !bvc.m_added_to_main_chain) {
       logger(INFO, BRIGHT_WHITE) << "Failed to switch to alternative blockchain";
-      rollback_blockchain_switching(disconnected_chain, split_height);
+      rollback_blockchain_switching(disconnected_chain, static_cast<uint32_t>(split_height));
+      saveTransactions(poolTransactions, static_cast<uint32_t>(m_blocks.size()));
       //add_block_as_invalid(ch_ent->second, get_block_hash(ch_ent->second.bl));
-      logger(INFO, BRIGHT_WHITE) << "The block was inserted as invalid while connecting new alternative chain,  block_id: " << get_block_hash(ch_ent->second.bl);
+      logger(INFO, BRIGHT_WHITE) << "The block was inserted as invalid while connecting new alternative chain,  block_id: " << ch_ent->first;
       m_orthanBlocksIndex.remove(ch_ent->second.bl);
       m_alternative_chains.erase(ch_ent);
 
@@ -1057,29 +1641,30 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
     }
   }
 
-  if (!discard_disconnected_chain) {
-    //pushing old chain as alternative chain
-    for (auto& old_ch_ent : disconnected_chain) {
-      block_verification_context bvc = boost::value_initialized<block_verification_context>();
-      bool r = handle_alternative_block(old_ch_ent, get_block_hash(old_ch_ent), bvc, false);
-      if (!r) {
-        logger(WARNING, BRIGHT_MAGENTA) << ("Failed to push ex-main chain blocks to alternative chain ");
-        break;
-      }
-    }
-  }
-
   std::vector<Crypto::Hash> blocksFromCommonRoot;
   blocksFromCommonRoot.reserve(alt_chain.size() + 1);
   blocksFromCommonRoot.push_back(alt_chain.front()->second.bl.previousBlockHash);
 
-  //removing all_chain entries from alternative chain
+  //removing all_chain entries from alternative chain, before any insertion can move them
   for (auto ch_ent : alt_chain) {
-    blocksFromCommonRoot.push_back(get_block_hash(ch_ent->second.bl));
+    blocksFromCommonRoot.push_back(ch_ent->first);
     m_orthanBlocksIndex.remove(ch_ent->second.bl);
     m_alternative_chains.erase(ch_ent);
   }
 
+  if (!discard_disconnected_chain) {
+    // pushing old chain as alternative chain; its blocks passed every check as main chain blocks
+    // and keep the height and cumulative difficulty they had there
+    for (BlockEntry &entry : disconnected_chain) {
+      entry.transactions.clear();
+      if (indexReady(BLOCKCHAIN_INDEX_ORPHAN_BLOCKS)) {
+        m_orthanBlocksIndex.add(entry.bl);
+      }
+      Crypto::Hash blockHash = get_block_hash(entry.bl);
+      m_alternative_chains.emplace(blockHash, std::move(entry));
+    }
+  }
+
   sendMessage(BlockchainMessage(ChainSwitchMessage(std::move(blocksFromCommonRoot))));
 
   logger(INFO, BRIGHT_BLUE) << "REORGANIZE SUCCESS! on height: " << split_height << ", new blockchain size: " << m_blocks.size();
@@ -1096,7 +1681,7 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
   // if the alt chain isn't long enough to calculate the difficulty target
   // based on its blocks alone, need to get more blocks from the main chain
   if (alt_chain.size() < m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion)) {
-    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
     size_t main_chain_stop_offset = alt_chain.size() ? alt_chain.front()->second.height : bei.height;
     size_t main_chain_count = m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion) - std::min(m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion), alt_chain.size());
     main_chain_count = std::min(main_chain_count, main_chain_stop_offset);
@@ -1105,10 +1690,19 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
     if (!main_chain_start_offset)
       ++main_chain_start_offset; //skip genesis block
     
-    // get difficulties and timestamps from relevant main chain blocks
-    for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
-      timestamps.push_back(m_blocks[main_chain_start_offset].bl.timestamp);
-      cumulative_difficulties.push_back(m_blocks[main_chain_start_offset].cumulative_difficulty);
+    // get difficulties and timestamps from relevant main chain blocks, through the tip window
+    // unless the alternative chain forks deeper than it reaches
+    std::lock_guard<std::mutex> windowLock(m_difficultyWindowLock);
+    if (main_chain_start_offset < main_chain_stop_offset && fillDifficultyWindow(static_cast<uint32_t>(main_chain_start_offset))) {
+      auto windowTimestamps = m_difficultyWindow.timestamps(static_cast<uint32_t>(main_chain_start_offset), static_cast<uint32_t>(main_chain_stop_offset));
+      auto windowDifficulties = m_difficultyWindow.cumulativeDifficulties(static_cast<uint32_t>(main_chain_start_offset), static_cast<uint32_t>(main_chain_stop_offset));
+      timestamps.assign(windowTimestamps.begin(), windowTimestamps.end());
+      cumulative_difficulties.assign(windowDifficulties.begin(), windowDifficulties.end());
+    } else {
+      for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
+        timestamps.push_back(m_headerIndex[static_cast<uint32_t>(main_chain_start_offset)].timestamp);
+        cumulative_difficulties.push_back(m_headerIndex[static_cast<uint32_t>(main_chain_start_offset)].cumulativeDifficulty);
+      }
     }
 
     // make sure we haven't accidentally grabbed too many blocks... ???
@@ -1138,7 +1732,9 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
     }
   }
 
-  return m_currency.nextDifficulty(static_cast<uint32_t>(m_blocks.size()), BlockMajorVersion, timestamps, cumulative_difficulties);
+  return m_currency.nextDifficulty(static_cast<uint32_t>(m_blocks.size()), BlockMajorVersion,
+    Common::ArrayView<uint64_t>(timestamps.data(), timestamps.size()),
+    Common::ArrayView<difficulty_type>(cumulative_difficulties.data(), cumulative_difficulties.size()));
 }
 
 bool Blockchain::prevalidate_miner_transaction(const Block& b, uint32_t height) {
@@ -1214,7 +1810,7 @@ bool Blockchain::validate_miner_transaction(const Block& b, uint32_t height, siz
 }
 
 bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
   if (!(from_height < m_blocks.size())) {
     logger(ERROR, BRIGHT_RED)
       << "Internal error: get_backward_blocks_sizes called with from_height="
@@ -1223,14 +1819,14 @@ bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>&
   }
   size_t start_offset = (from_height + 1) - std::min((from_height + 1), count);
   for (size_t i = start_offset; i != from_height + 1; i++) {
-    sz.push_back(m_blocks[i].block_cumulative_size);
+    sz.push_back(m_headerIndex[static_cast<uint32_t>(i)].cumulativeSize);
   }
 
   return true;
 }
 
 bool Blockchain::get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
   if (!m_blocks.size()) {
     return true;
   }
@@ -1246,12 +1842,12 @@ uint64_t Blockchain::getCurrentCumulativeBlocksizeLimit() {
    if (timestamps.size() >= m_currency.timestampCheckWindow(blockMajorVersion)) 
     return true;
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
   size_t need_elements = m_currency.timestampCheckWindow(blockMajorVersion) - timestamps.size(); 
   if (!(start_top_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: passed start_height = " << start_top_height << " not less then m_blocks.size()=" << m_blocks.size(); return false; }
   size_t stop_offset = start_top_height > need_elements ? start_top_height - need_elements : 0;
   do {
-    timestamps.push_back(m_blocks[start_top_height].bl.timestamp);
+    timestamps.push_back(m_headerIndex[static_cast<uint32_t>(start_top_height)].timestamp);
     if (start_top_height == 0)
       break;
     --start_top_height;
@@ -1260,7 +1856,7 @@ uint64_t Blockchain::getCurrentCumulativeBlocksizeLimit() {
 }
 
 bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id, block_verification_context& bvc, bool sendNewAlternativeBlockMessage) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
 
   auto block_height = get_block_height(b);
   if (block_height == 0) {
@@ -1323,8 +1919,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
       // make sure alt chain doesn't somehow start past the end of the main chain
       if (!(m_blocks.size() > alt_chain.front()->second.height)) { logger(ERROR, BRIGHT_RED) << "main blockchain wrong height"; return false; }
       // make sure block connects correctly to the main chain
-	  Crypto::Hash h = NULL_HASH;
-      get_block_hash(m_blocks[alt_chain.front()->second.height - 1].bl, h);
+	  Crypto::Hash h = m_blockIndex.getBlockId(alt_chain.front()->second.height - 1);
       if (!(h == alt_chain.front()->second.bl.previousBlockHash)) { logger(ERROR, BRIGHT_RED) << "alternative chain has wrong connection to main chain"; return false; }
       complete_timestamps_vector(b.majorVersion, alt_chain.front()->second.height - 1, timestamps);
     } else {
@@ -1362,7 +1957,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
     difficulty_type current_diff = get_next_difficulty_for_alternative_chain(alt_chain, bei);
     if (!(current_diff)) { logger(ERROR, BRIGHT_RED) << "!!!!!!! DIFFICULTY OVERHEAD !!!!!!!"; return false; }
     Crypto::Hash proof_of_work = NULL_HASH;
-    if (!m_currency.checkProofOfWork(m_cn_context, bei.bl, current_diff, proof_of_work)) {
+    if (!checkProofOfWork(bei.bl, current_diff, proof_of_work)) {
       logger(INFO, BRIGHT_RED) <<
         "Block with id: " << id
         << ENDL << " for alternative chain, lacks enough proof of work: " << proof_of_work
@@ -1378,7 +1973,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
       return false;
     }
 
-    bei.cumulative_difficulty = alt_chain.size() ? it_prev->second.cumulative_difficulty : m_blocks[mainPrevHeight].cumulative_difficulty;
+    bei.cumulative_difficulty = alt_chain.size() ? it_prev->second.cumulative_difficulty : m_headerIndex[mainPrevHeight].cumulativeDifficulty;
     bei.cumulative_difficulty += current_diff;
 
 #ifdef _DEBUG
@@ -1389,9 +1984,15 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
     auto i_res = m_alternative_chains.insert(blocks_ext_by_hash::value_type(id, bei));
     if (!(i_res.second)) { logger(ERROR, BRIGHT_RED) << "insertion of new alternative block returned as it already exists"; return false; }
 
-    m_orthanBlocksIndex.add(bei.bl);
+    if (indexReady(BLOCKCHAIN_INDEX_ORPHAN_BLOCKS)) {
+      m_orthanBlocksIndex.add(bei.bl);
+    }
 
-    alt_chain.push_back(i_res.first);
+    // the insertion may have moved the entries alt_chain points to
+    alt_chain.clear();
+    for (auto alt_it = i_res.first; alt_it != m_alternative_chains.end(); alt_it = m_alternative_chains.find(alt_it->second.bl.previousBlockHash)) {
+      alt_chain.push_front(alt_it);
+    }
 
     if (is_a_checkpoint) {
       //do reorganize!
@@ -1406,11 +2007,11 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
         bvc.m_verification_failed = true;
       }
       return r;
-    } else if (m_blocks.back().cumulative_difficulty < bei.cumulative_difficulty) //check if difficulty bigger then in main chain
+    } else if (m_headerIndex.back().cumulativeDifficulty < bei.cumulative_difficulty) //check if difficulty bigger then in main chain
     {
       //do reorganize!
       logger(INFO, BRIGHT_YELLOW) <<
-        "###### REORGANIZE on height: " << alt_chain.front()->second.height << " of " << m_blocks.size() - 1 << " with cumulative_difficulty " << m_blocks.back().cumulative_difficulty
+        "###### REORGANIZE on height: " << alt_chain.front()->second.height << " of " << m_blocks.size() - 1 << " with cumulative_difficulty " << m_headerIndex.back().cumulativeDifficulty
         << ENDL << " alternative blockchain size: " << alt_chain.size() << " with cumulative_difficulty " << bei.cumulative_difficulty;
       bool r = switch_to_alternative_blockchain(alt_chain, false);
       if (r) {
@@ -1442,25 +2043,29 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   if (start_offset >= m_blocks.size())
     return false;
+  m_blocks.prefetch(start_offset, count);
   for (size_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
-    blocks.push_back(m_blocks[i].bl);
-    std::list<Crypto::Hash> missed_ids;
-    getTransactions(m_blocks[i].bl.transactionHashes, txs, missed_ids);
-    if (!(!missed_ids.size())) { logger(ERROR, BRIGHT_RED) << "have missed transactions in own block of main blockchain"; return false; }
+    // a main chain block carries its own transactions, no need to look each one up
+    const BlockEntry& block = m_blocks[i];
+    blocks.push_back(block.bl);
+    for (size_t t = 1; t < block.transactions.size(); ++t) {
+      txs.push_back(block.transactions[t].tx);
+    }
   }
 
   return true;
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   if (start_offset >= m_blocks.size()) {
     return false;
   }
 
+  m_blocks.prefetch(start_offset, count);
   for (uint32_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
     blocks.push_back(m_blocks[i].bl);
   }
@@ -1469,7 +2074,7 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
 }
 
 bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) { //Deprecated. Should be removed with CryptoNoteProtocolHandler.
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   rsp.current_blockchain_height = getCurrentBlockchainHeight();
   std::list<Block> blocks;
   getBlocks(arg.blocks, blocks, rsp.missed_ids);
@@ -1501,7 +2106,7 @@ bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTI
 }
 
 bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   for (auto& alt_bl : m_alternative_chains) {
     blocks.push_back(alt_bl.second.bl);
   }
@@ -1510,18 +2115,20 @@ bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
 }
 
 uint32_t Blockchain::getAlternativeBlocksCount() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   return static_cast<uint32_t>(m_alternative_chains.size());
 }
 
-bool Blockchain::add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  const Transaction& tx = transactionByIndex(amount_outs[i].first).tx;
-  if (!(tx.outputs.size() > amount_outs[i].second)) {
+bool Blockchain::add_out_to_get_random_outs(const OutputIndex::Outputs& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  TransactionIndex transactionIndex = { amount_outs.block(i), amount_outs.transaction(i) };
+  uint16_t outputIndex = amount_outs.output(i);
+  const Transaction& tx = transactionByIndex(transactionIndex).tx;
+  if (!(tx.outputs.size() > outputIndex)) {
     logger(ERROR, BRIGHT_RED) << "internal error: in global outs index, transaction out index="
-      << amount_outs[i].second << " more than transaction outputs = " << tx.outputs.size() << ", for tx id = " << getObjectHash(tx); return false;
+      << outputIndex << " more than transaction outputs = " << tx.outputs.size() << ", for tx id = " << getObjectHash(tx); return false;
   }
-  if (!(tx.outputs[amount_outs[i].second].target.type() == typeid(KeyOutput))) { logger(ERROR, BRIGHT_RED) << "unknown tx out type"; return false; }
+  if (!(tx.outputs[outputIndex].target.type() == typeid(KeyOutput))) { logger(ERROR, BRIGHT_RED) << "unknown tx out type"; return false; }
 
   //check if transaction is unlocked
   if (!is_tx_spendtime_unlocked(tx.unlockTime))
@@ -1529,41 +2136,33 @@ bool Blockchain::add_out_to_get_random_outs(std::vector<std::pair<TransactionInd
 
   COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry& oen = *result_outs.outs.insert(result_outs.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry());
   oen.global_amount_index = static_cast<uint32_t>(i);
-  oen.out_key = boost::get<KeyOutput>(tx.outputs[amount_outs[i].second].target).key;
+  oen.out_key = boost::get<KeyOutput>(tx.outputs[outputIndex].target).key;
   return true;
 }
 
-size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  if (amount_outs.empty()) {
+size_t Blockchain::find_end_of_allowed_index(const OutputIndex::Outputs& amount_outs) {
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  uint32_t height = getCurrentBlockchainHeight();
+  if (amount_outs.empty() || height < m_currency.minedMoneyUnlockWindow()) {
     return 0;
   }
 
-  size_t i = amount_outs.size();
-  do {
-    --i;
-    if (amount_outs[i].first.block + m_currency.minedMoneyUnlockWindow() <= getCurrentBlockchainHeight()) {
-      return i + 1;
-    }
-  } while (i != 0);
-
-  return 0;
+  return amount_outs.countUpToBlock(height - static_cast<uint32_t>(m_currency.minedMoneyUnlockWindow()));
 }
 
 bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
 
   for (uint64_t amount : req.amounts) {
     COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs = *res.outs.insert(res.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount());
     result_outs.amount = amount;
-    auto it = m_outputs.find(amount);
-    if (it == m_outputs.end()) {
+    OutputIndex::Outputs amount_outs = m_outputs.find(amount);
+    if (amount_outs.empty()) {
       logger(ERROR, BRIGHT_RED) <<
         "COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS: not outs for amount " << amount << ", wallet should use some real outs when it looks for mixins, so at least one out for this amount should exist";
       continue;//actually this is strange situation, wallet should use some real outs when it lookup for some mix, so, at least one out for this amount should exist
     }
 
-    std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs = it->second;
     //it is not good idea to use top fresh outs, because it increases possibility of transaction canceling on split
     //lets find upper bound of not fresh outs
     size_t up_index_limit = find_end_of_allowed_index(amount_outs);
@@ -1600,7 +2199,7 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
   assert(!qblock_ids.empty());
   assert(qblock_ids.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   uint32_t blockIndex;
   // assert above guarantees that method returns true
   m_blockIndex.findSupplement(qblock_ids, blockIndex);
@@ -1608,17 +2207,17 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
 }
 
 uint64_t Blockchain::blockDifficulty(size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::block_difficulty()"; return false; }
   if (i == 0)
-    return m_blocks[i].cumulative_difficulty;
+    return m_headerIndex[0].cumulativeDifficulty;
 
-  return m_blocks[i].cumulative_difficulty - m_blocks[i - 1].cumulative_difficulty;
+  return m_headerIndex[static_cast<uint32_t>(i)].cumulativeDifficulty - m_headerIndex[static_cast<uint32_t>(i - 1)].cumulativeDifficulty;
 }
 
 void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
   if (start_index >= m_blocks.size()) {
     logger(INFO, BRIGHT_WHITE) <<
       "Wrong starter index set: " << start_index << ", expected max index " << m_blocks.size() - 1;
@@ -1638,7 +2237,7 @@ void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
 
 void Blockchain::print_blockchain_index() {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
 
   std::vector<Crypto::Hash> blockIds = m_blockIndex.getBlockIds(0, std::numeric_limits<uint32_t>::max());
   logger(INFO, BRIGHT_WHITE) << "Current blockchain index:";
@@ -1652,13 +2251,14 @@ void Blockchain::print_blockchain_index() {
 
 void Blockchain::print_blockchain_outs(const std::string& file) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  for (const outputs_container::value_type& v : m_outputs) {
-    const std::vector<std::pair<TransactionIndex, uint16_t>>& vals = v.second;
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
+  for (uint64_t amount : m_outputs.amounts()) {
+    OutputIndex::Outputs vals = m_outputs.find(amount);
     if (!vals.empty()) {
-      ss << "amount: " << v.first << ENDL;
+      ss << "amount: " << amount << ENDL;
       for (size_t i = 0; i != vals.size(); i++) {
-        ss << "\t" << getObjectHash(transactionByIndex(vals[i].first).tx) << ": " << vals[i].second << ENDL;
+        TransactionIndex transactionIndex = { vals.block(i), vals.transaction(i) };
+        ss << "\t" << getObjectHash(transactionByIndex(transactionIndex).tx) << ": " << vals.output(i) << ENDL;
       }
     }
   }
@@ -1678,7 +2278,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
   assert(!remoteBlockIds.empty());
   assert(remoteBlockIds.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   totalBlockCount = getCurrentBlockchainHeight();
   startBlockIndex = findBlockchainSupplement(remoteBlockIds);
 
@@ -1686,7 +2286,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
 }
 
 bool Blockchain::haveBlock(const Crypto::Hash& id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   if (m_blockIndex.hasBlock(id))
     return true;
 
@@ -1697,12 +2297,12 @@ bool Blockchain::haveBlock(const Crypto::Hash& id) {
 }
 
 size_t Blockchain::getTotalTransactions() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   return m_transactionMap.size();
 }
 
 bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   auto it = m_transactionMap.find(tx_id);
   if (it == m_transactionMap.end()) {
     logger(WARNING, YELLOW) << "warning: get_tx_outputs_gindexs failed to find transaction with id = " << tx_id;
@@ -1720,7 +2320,7 @@ bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, st
 }
 
 bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   auto it = m_multisignatureOutputs.find(amount);
   if (it == m_multisignatureOutputs.end()) {
     return false;
@@ -1730,20 +2330,14 @@ bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, Multis
     return false;
   }
 
-  auto msigUsage = it->second[gindex];
-  auto& targetOut = transactionByIndex(msigUsage.transactionIndex).tx.outputs[msigUsage.outputIndex].target;
-  if (targetOut.type() != typeid(MultisignatureOutput)) {
-    return false;
-  }
-
-  out = boost::get<MultisignatureOutput>(targetOut);
+  out = it->second[gindex].output;
   return true;
 }
 
 
 
 bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
 
   if (tail)
     tail->id = getTailId(tail->height);
@@ -1751,7 +2345,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_use
   bool res = checkTransactionInputs(tx, &max_used_block_height);
   if (!res) return false;
   if (!(max_used_block_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: max used block index=" << max_used_block_height << " is not less then blockchain size = " << m_blocks.size(); return false; }
-  get_block_hash(m_blocks[max_used_block_height].bl, max_used_block_id);
+  max_used_block_id = m_blockIndex.getBlockId(max_used_block_height);
   return true;
 }
 
@@ -1767,24 +2361,25 @@ bool Blockchain::haveTransactionKeyImagesAsSpent(const Transaction &tx) {
   return false;
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height) {
-  Crypto::Hash tx_prefix_hash = getObjectHash(*static_cast<const TransactionPrefix*>(&tx));
-  return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height);
+bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height, std::vector<RingSignatureCheck>* deferredChecks) {
+  return checkTransactionInputs(CachedTransaction(tx), pmax_used_block_height, deferredChecks);
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height) {
+// the transaction hash is only needed for multisignature inputs and logging, so it is left to the cache
+bool Blockchain::checkTransactionInputs(const CachedTransaction& cachedTransaction, uint32_t* pmax_used_block_height, std::vector<RingSignatureCheck>* deferredChecks) {
   size_t inputIndex = 0;
   if (pmax_used_block_height) {
     *pmax_used_block_height = 0;
   }
 
-  Crypto::Hash transactionHash = getObjectHash(tx);
+  const Transaction& tx = cachedTransaction.getTransaction();
+  const Crypto::Hash& tx_prefix_hash = cachedTransaction.getTransactionPrefixHash();
   for (const auto& txin : tx.inputs) {
     assert(inputIndex < tx.signatures.size());
     if (txin.type() == typeid(KeyInput)) {
 
       const KeyInput& in_to_key = boost::get<KeyInput>(txin);
-      if (!(!in_to_key.outputIndexes.empty())) { logger(ERROR, BRIGHT_RED) << "empty in_to_key.outputIndexes in transaction with id " << getObjectHash(tx); return false; }
+      if (!(!in_to_key.outputIndexes.empty())) { logger(ERROR, BRIGHT_RED) << "empty in_to_key.outputIndexes in transaction with id " << cachedTransaction.getTransactionHash(); return false; }
 
       if (have_tx_keyimg_as_spent(in_to_key.keyImage)) {
         logger(DEBUGGING) <<
@@ -1792,28 +2387,20 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
         return false;
       }
 
-      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height)) {
+      // check_tx_input skips the ring signature itself inside the checkpoint zone
+      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height, deferredChecks)) {
         logger(DEBUGGING, BRIGHT_WHITE) <<
-          "Failed to check ring signature for tx " << transactionHash;
+          "Failed to check ring signature for tx " << cachedTransaction.getTransactionHash();
         return false;
       }
 
-        if (!isInCheckpointZone(getCurrentBlockchainHeight()))
-        {
-          if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height))
-          {
-            logger(INFO, BRIGHT_WHITE) << "Failed to check input in transaction " << transactionHash;
-            return false;
-          }
-        }
-
         ++inputIndex;
       }
       else if (txin.type() == typeid(MultisignatureInput))
       {
         if (!isInCheckpointZone(getCurrentBlockchainHeight()))
         {
-          if (!validateInput(::boost::get<MultisignatureInput>(txin), transactionHash, tx_prefix_hash, tx.signatures[inputIndex]))
+          if (!validateInput(::boost::get<MultisignatureInput>(txin), cachedTransaction.getTransactionHash(), tx_prefix_hash, tx.signatures[inputIndex]))
           {
             return false;
           }
@@ -1823,7 +2410,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
       }
       else
       {
-        logger(INFO, BRIGHT_WHITE) << "Transaction << " << transactionHash << " contains input of unsupported type.";
+        logger(INFO, BRIGHT_WHITE) << "Transaction << " << cachedTransaction.getTransactionHash() << " contains input of unsupported type.";
         return false;
       }
     }
@@ -1850,8 +2437,8 @@ bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time) {
   return false;
 }
 
-bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height, std::vector<RingSignatureCheck>* deferredChecks) {
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
 
   struct outputs_visitor {
     std::vector<const Crypto::PublicKey *>& m_results_collector;
@@ -1908,13 +2495,252 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
     return true;
   }
 
+  BinaryArray checked;
+  checked.reserve(sizeof(Crypto::Hash) + sizeof(Crypto::KeyImage) + output_keys.size() * (sizeof(Crypto::PublicKey) + sizeof(Crypto::Signature)));
+  checked.insert(checked.end(), tx_prefix_hash.data, tx_prefix_hash.data + sizeof(tx_prefix_hash.data));
+  checked.insert(checked.end(), txin.keyImage.data, txin.keyImage.data + sizeof(txin.keyImage.data));
+  for (size_t i = 0; i < output_keys.size(); ++i) {
+    checked.insert(checked.end(), output_keys[i]->data, output_keys[i]->data + sizeof(output_keys[i]->data));
+    const uint8_t* signature = reinterpret_cast<const uint8_t*>(&sig[i]);
+    checked.insert(checked.end(), signature, signature + sizeof(Crypto::Signature));
+  }
+
+  Crypto::Hash verifiedKey = Crypto::cn_fast_hash(checked.data(), checked.size());
+  if (isRingSignatureVerified(verifiedKey)) {
+    return true;
+  }
+
+  if (deferredChecks != NULL) {
+    // keys are copied: the pointers refer to m_blocks cache entries that may be evicted meanwhile
+    RingSignatureCheck check = { tx_prefix_hash, txin.keyImage, std::vector<Crypto::PublicKey>(), sig.data(), verifiedKey };
+    check.outputKeys.reserve(output_keys.size());
+    for (const Crypto::PublicKey* key : output_keys) {
+      check.outputKeys.push_back(*key);
+    }
+
+    deferredChecks->push_back(std::move(check));
+    return true;
+  }
+
   bool check_tx_ring_signature = Crypto::check_ring_signature(tx_prefix_hash, txin.keyImage, output_keys, sig.data());
   if (!check_tx_ring_signature) {
     logger(DEBUGGING) << "Failed to check ring signature for keyImage: " << txin.keyImage;
+  } else {
+    rememberRingSignature(verifiedKey);
   }
   return check_tx_ring_signature;
 }
 
+bool Blockchain::isRingSignatureVerified(const Crypto::Hash& key) {
+  static Common::MetricCounter& hits = Common::Metrics::instance().counter("fuego_ring_signature_cache_hits_total",
+    "Ring signatures found verified at pool admission instead of being checked again");
+
+  std::lock_guard<std::mutex> lk(m_verifiedRingSignaturesLock);
+  if (m_verifiedRingSignatures.count(key) == 0) {
+    return false;
+  }
+
+  hits.add();
+  return true;
+}
+
+void Blockchain::rememberRingSignature(const Crypto::Hash& key) {
+  std::lock_guard<std::mutex> lk(m_verifiedRingSignaturesLock);
+  if (m_verifiedRingSignatures.insert(key).second) {
+    m_verifiedRingSignaturesOrder.push_back(key);
+  }
+
+  while (m_verifiedRingSignaturesOrder.size() > VERIFIED_RING_SIGNATURE_CACHE_SIZE) {
+    m_verifiedRingSignatures.erase(m_verifiedRingSignaturesOrder.front());
+    m_verifiedRingSignaturesOrder.pop_front();
+  }
+}
+
+bool Blockchain::checkRingSignatures(const std::vector<RingSignatureCheck>& checks, block_verification_context& bvc) {
+  if (checks.empty()) {
+    return true;
+  }
+
+  auto checkStart = std::chrono::steady_clock::now();
+  auto checkRange = [&checks](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (!checkRingSignature(checks[i])) {
+        return false;
+      }
+    }
+
+    return true;
+  };
+
+  bool valid = true;
+  if (checks.size() == 1) {
+    valid = checkRange(0, 1);
+  } else {
+    Common::ThreadPool& verifier = signatureVerifier();
+    size_t chunkCount = std::min(checks.size(), verifier.workerCount());
+    size_t chunkSize = (checks.size() + chunkCount - 1) / chunkCount;
+    std::vector<std::future<bool>> results;
+    results.reserve(chunkCount);
+    for (size_t begin = 0; begin < checks.size(); begin += chunkSize) {
+      size_t end = std::min(begin + chunkSize, checks.size());
+      results.push_back(verifier.submit([&checkRange, begin, end] { return checkRange(begin, end); }));
+    }
+
+    // every task has to finish before the verdict, they reference `checks`
+    for (auto& result : results) {
+      if (!result.get()) {
+        valid = false;
+      }
+    }
+  }
+
+  bvc.m_ring_signatures_checked += static_cast<uint32_t>(checks.size());
+  bvc.m_ring_signature_check_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - checkStart).count();
+  return valid;
+}
+
+bool Blockchain::checkRingSignature(const RingSignatureCheck& check) {
+  std::vector<const Crypto::PublicKey*> keys;
+  keys.reserve(check.outputKeys.size());
+  for (const auto& key : check.outputKeys) {
+    keys.push_back(&key);
+  }
+
+  return Crypto::check_ring_signature(check.prefixHash, check.keyImage, keys, check.signatures);
+}
+
+Common::ThreadPool& Blockchain::signatureVerifier() {
+  // block checks run under the exclusive lock, but batch admission only holds a shared one
+  std::call_once(m_signatureVerifierCreated, [this] { m_signatureVerifier.reset(new Common::ThreadPool()); });
+  return *m_signatureVerifier;
+}
+
+void Blockchain::precomputeProofOfWork(const std::vector<Block>& blocks) {
+  std::vector<Crypto::Hash> keys(blocks.size());
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    BinaryArray blob;
+    if (!get_block_longhash_blob(blocks[i], blob)) {
+      return;
+    }
+
+    keys[i] = Crypto::cn_fast_hash(blob.data(), blob.size());
+  }
+
+  // callers are worker threads, each keeps its own scratchpad; blocks of one major version are hashed
+  // together so the lanes of cn_slow_hash_multi overlap
+  static thread_local Crypto::cn_context context;
+  std::vector<Crypto::Hash> proofsOfWork(blocks.size());
+  for (size_t begin = 0; begin < blocks.size();) {
+    size_t end = begin + 1;
+    while (end < blocks.size() && blocks[end].majorVersion == blocks[begin].majorVersion) {
+      ++end;
+    }
+
+    if (!get_block_longhash(context, blocks.data() + begin, end - begin, proofsOfWork.data() + begin)) {
+      return;
+    }
+
+    begin = end;
+  }
+
+  std::lock_guard<std::mutex> lk(m_proofOfWorkCacheLock);
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    if (m_proofOfWorkCache.emplace(keys[i], proofsOfWork[i]).second) {
+      m_proofOfWorkCacheOrder.push_back(keys[i]);
+    }
+  }
+
+  while (m_proofOfWorkCacheOrder.size() > PROOF_OF_WORK_CACHE_SIZE) {
+    m_proofOfWorkCache.erase(m_proofOfWorkCacheOrder.front());
+    m_proofOfWorkCacheOrder.pop_front();
+  }
+}
+
+bool Blockchain::checkProofOfWork(const Block& block, difficulty_type currentDifficulty, Crypto::Hash& proofOfWork) {
+  BinaryArray blob;
+  if (get_block_longhash_blob(block, blob)) {
+    Crypto::Hash key = Crypto::cn_fast_hash(blob.data(), blob.size());
+    bool cached = false;
+    {
+      std::lock_guard<std::mutex> lk(m_proofOfWorkCacheLock);
+      auto it = m_proofOfWorkCache.find(key);
+      if (it != m_proofOfWorkCache.end()) {
+        proofOfWork = it->second;
+        m_proofOfWorkCache.erase(it);
+        cached = true;
+      }
+    }
+
+    if (cached) {
+      return m_currency.checkProofOfWork(block, currentDifficulty, proofOfWork);
+    }
+  }
+
+  return m_currency.checkProofOfWork(m_cn_context, block, currentDifficulty, proofOfWork);
+}
+
+void Blockchain::checkTransactionsInputs(const std::vector<const Transaction*>& transactions, std::vector<BlockInfo>& maxUsedBlocks) {
+  maxUsedBlocks.assign(transactions.size(), BlockInfo());
+
+  std::vector<RingSignatureCheck> checks;
+  std::vector<size_t> owners;
+  {
+    ReadLock lk(*this, LOCK_SITE("blockchain"));
+    for (size_t i = 0; i < transactions.size(); ++i) {
+      const Transaction& tx = *transactions[i];
+      size_t firstCheck = checks.size();
+      uint32_t maxUsedHeight = 0;
+      if (!checkTransactionInputs(tx, &maxUsedHeight, &checks) || !check_tx_outputs(tx, maxUsedHeight) || !(maxUsedHeight < m_blocks.size())) {
+        checks.erase(checks.begin() + firstCheck, checks.end());
+        continue;
+      }
+
+      owners.resize(checks.size(), i);
+      maxUsedBlocks[i].height = maxUsedHeight;
+      maxUsedBlocks[i].id = m_blockIndex.getBlockId(maxUsedHeight);
+    }
+  }
+
+  // the checks hold copies of the output keys, so the chain lock is not needed for the signatures themselves
+  if (checks.empty()) {
+    return;
+  }
+
+  std::vector<char> checkValid(checks.size(), 0);
+  auto checkRange = [&checks, &checkValid](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      checkValid[i] = checkRingSignature(checks[i]) ? 1 : 0;
+    }
+  };
+
+  if (checks.size() == 1) {
+    checkRange(0, 1);
+  } else {
+    Common::ThreadPool& verifier = signatureVerifier();
+    size_t chunkCount = std::min(checks.size(), verifier.workerCount());
+    size_t chunkSize = (checks.size() + chunkCount - 1) / chunkCount;
+    std::vector<std::future<void>> results;
+    results.reserve(chunkCount);
+    for (size_t begin = 0; begin < checks.size(); begin += chunkSize) {
+      size_t end = std::min(begin + chunkSize, checks.size());
+      results.push_back(verifier.submit([&checkRange, begin, end] { checkRange(begin, end); }));
+    }
+
+    for (auto& result : results) {
+      result.get();
+    }
+  }
+
+  for (size_t i = 0; i < checks.size(); ++i) {
+    if (checkValid[i]) {
+      rememberRingSignature(checks[i].verifiedKey);
+    } else if (!maxUsedBlocks[owners[i]].empty()) {
+      logger(DEBUGGING) << "Failed to check ring signature for tx " << getObjectHash(*transactions[owners[i]]);
+      maxUsedBlocks[owners[i]].clear();
+    }
+  }
+}
+
 uint64_t Blockchain::get_adjusted_time() {
   //TODO: add collecting median time
   return time(NULL);
@@ -1954,7 +2780,7 @@ bool Blockchain::check_block_timestamp_main(const Block& b) {
 
   std::vector<uint64_t> timestamps;
  size_t offset = m_blocks.size() <= m_currency.timestampCheckWindow(b.majorVersion) ? 0 : m_blocks.size() - m_currency.timestampCheckWindow(b.majorVersion);  for (; offset != m_blocks.size(); ++offset) { 
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
+    timestamps.push_back(m_headerIndex[static_cast<uint32_t>(offset)].timestamp);
   }
 
   return check_block_timestamp(std::move(timestamps), b);
@@ -2038,15 +2864,21 @@ bool Blockchain::checkCumulativeBlockSize(const Crypto::Hash& blockId, size_t cu
 
 // Returns true, if cumulativeSize is calculated precisely, else returns false.
 bool Blockchain::getBlockCumulativeSize(const Block& block, size_t& cumulativeSize) {
-  std::vector<Transaction> blockTxs;
-  std::vector<Crypto::Hash> missedTxs;
-  getTransactions(block.transactionHashes, blockTxs, missedTxs, true);
-
+  // the transactions are only measured, not copied out: chain ones are counted in place, pooled
+  // ones by the size the pool recorded when it took them
   cumulativeSize = getObjectBinarySize(block.baseTransaction);
-  for (const Transaction& tx : blockTxs) {
-    cumulativeSize += getObjectBinarySize(tx);
+  std::vector<Crypto::Hash> poolTxs;
+  for (const Crypto::Hash& txHash : block.transactionHashes) {
+    auto it = m_transactionMap.find(txHash);
+    if (it == m_transactionMap.end()) {
+      poolTxs.push_back(txHash);
+    } else {
+      cumulativeSize += getObjectBinarySize(transactionByIndex(it->second).tx);
+    }
   }
 
+  std::vector<Crypto::Hash> missedTxs;
+  m_tx_pool.getTransactionSizes(poolTxs, cumulativeSize, missedTxs);
   return missedTxs.empty();
 }
 
@@ -2068,10 +2900,17 @@ bool Blockchain::update_next_comulative_size_limit() {
 }
 
 bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc) {
+  static Common::MetricHistogram& verifyTime = Common::Metrics::instance().histogram("fuego_block_verify_seconds",
+    "Time to verify and add a block, alternative and rejected blocks included");
+  Common::MetricTimer timer(verifyTime);
+
   //copy block here to let modify block.target
   Block bl = bl_;
+  CachedBlock cachedBlock(bl);
   Crypto::Hash id;
-  if (!get_block_hash(bl, id)) {
+  try {
+    id = cachedBlock.getBlockHash();
+  } catch (std::exception&) {
     logger(ERROR, BRIGHT_RED) <<
       "Failed to get block hash, possible block has invalid format";
     bvc.m_verification_failed = true;
@@ -2082,7 +2921,7 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
 
   { //to avoid deadlock lets lock tx_pool for whole add/reorganize process
     std::lock_guard<decltype(m_tx_pool)> poolLock(m_tx_pool);
-    std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
+    Common::ProfiledLockGuard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock, LOCK_SITE("blockchain"));
 
     if (haveBlock(id)) {
       logger(TRACE) << "block with id = " << id << " already exists";
@@ -2101,7 +2940,7 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
       }
       else
       {
-        add_result = pushBlock(bl, id, bvc, ++height);
+        add_result = pushBlock(cachedBlock, bvc, ++height);
         if (add_result)
         {
           sendMessage(BlockchainMessage(NewBlockMessage(id)));
@@ -2114,29 +2953,63 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
             }
           }
 
-        }
+        }
+      }
+    }
+
+  publishMessages();
+  if (add_result && bvc.m_added_to_main_chain) {
+    m_observerManager.notify(&IBlockchainStorageObserver::blockchainUpdated);
+  }
+
+  return add_result;
+}
+
+size_t Blockchain::addCheckpointedBlocks(const std::vector<Block>& blocks, const std::vector<std::vector<BinaryArray>>& transactions, block_verification_context& bvc) {
+  assert(blocks.size() == transactions.size());
+
+  size_t added = 0;
+  {
+    std::lock_guard<decltype(m_tx_pool)> poolLock(m_tx_pool);
+    Common::ProfiledLockGuard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock, LOCK_SITE("blockchain"));
+
+    for (; added < blocks.size(); ++added) {
+      //anything off the tail or past the last checkpoint goes through full validation
+      if (!m_checkpoints.is_in_checkpoint_zone(getCurrentBlockchainHeight()) || blocks[added].previousBlockHash != getTailId()) {
+        break;
+      }
+
+      if (!pushCheckpointedBlock(blocks[added], transactions[added], bvc)) {
+        break;
+      }
+
+      if (m_blockchainAutosaveEnabled && m_blocks.size() % 720 == 0) {
+        storeCache();
       }
     }
+  }
 
-  if (add_result && bvc.m_added_to_main_chain) {
+  publishMessages();
+  if (added > 0) {
+    logger(DEBUGGING) << "Appended " << added << " checkpointed blocks, height " << getCurrentBlockchainHeight();
     m_observerManager.notify(&IBlockchainStorageObserver::blockchainUpdated);
   }
 
-  return add_result;
+  return added;
 }
 
 const Blockchain::TransactionEntry& Blockchain::transactionByIndex(TransactionIndex index) {
   return m_blocks[index.block].transactions[index.transaction];
 }
 
-bool Blockchain::pushBlock(const Block &blockData, const Crypto::Hash &id, block_verification_context &bvc, uint32_t height) {
+bool Blockchain::pushBlock(const CachedBlock &cachedBlock, block_verification_context &bvc, uint32_t height) {
   std::vector<Transaction> transactions;
-  if (!loadTransactions(blockData, transactions, height)) {
+  if (!loadTransactions(cachedBlock.getBlock(), transactions, height)) {
     bvc.m_verification_failed = true;
     return false;
   }
 
-  if (!pushBlock(blockData, transactions, id, bvc)) {
+  if (!pushBlock(cachedBlock, transactions, bvc)) {
     saveTransactions(transactions, height);
     return false;
   }
@@ -2144,12 +3017,14 @@ bool Blockchain::pushBlock(const Block &blockData, const Crypto::Hash &id, block
   return true;
 }
 
-bool Blockchain::pushBlock(const Block &blockData, const std::vector<Transaction> &transactions, const Crypto::Hash &id, block_verification_context &bvc) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+bool Blockchain::pushBlock(const CachedBlock &cachedBlock, const std::vector<Transaction> &transactions, block_verification_context &bvc) {
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
 
   auto blockProcessingStart = std::chrono::steady_clock::now();
+  uint64_t objectHashesStart = getObjectHashCount();
 
-  Crypto::Hash blockHash = get_block_hash(blockData);
+  const Block& blockData = cachedBlock.getBlock();
+  const Crypto::Hash& blockHash = cachedBlock.getBlockHash();
 
   if (m_blockIndex.hasBlock(blockHash)) {
     logger(ERROR, BRIGHT_RED) <<
@@ -2196,6 +3071,7 @@ bool Blockchain::pushBlock(const Block &blockData, const std::vector<Transaction
 
   auto longhashTimeStart = std::chrono::steady_clock::now();
   Crypto::Hash proof_of_work = NULL_HASH;
+  Tools::ScopeExit leaveCheckpointZone([this] { m_is_in_checkpoint_zone = false; });
   if (m_checkpoints.is_in_checkpoint_zone(getCurrentBlockchainHeight())) {
     if (!m_checkpoints.check_block(getCurrentBlockchainHeight(), blockHash)) {
       logger(ERROR, BRIGHT_RED) <<
@@ -2203,8 +3079,12 @@ bool Blockchain::pushBlock(const Block &blockData, const std::vector<Transaction
       bvc.m_verification_failed = true;
       return false;
     }
+
+    // the next checkpoint pins this block's transactions too, so check_tx_input leaves their
+    // ring signatures alone; key images, amounts and outputs are still checked
+    m_is_in_checkpoint_zone = true;
   } else {
-    if (!m_currency.checkProofOfWork(m_cn_context, blockData, currentDifficulty, proof_of_work)) {
+    if (!checkProofOfWork(blockData, currentDifficulty, proof_of_work)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << ", has too weak proof of work: " << proof_of_work << ", expected difficulty: " << currentDifficulty;
       bvc.m_verification_failed = true;
@@ -2221,7 +3101,7 @@ bool Blockchain::pushBlock(const Block &blockData, const std::vector<Transaction
     return false;
   }
 
-  Crypto::Hash minerTransactionHash = getObjectHash(blockData.baseTransaction);
+  const Crypto::Hash& minerTransactionHash = cachedBlock.getBaseTransaction().getTransactionHash();
 
   BlockEntry block;
   block.bl = blockData;
@@ -2231,17 +3111,19 @@ bool Blockchain::pushBlock(const Block &blockData, const std::vector<Transaction
   TransactionIndex transactionIndex = { block.height, static_cast<uint16_t>(0) };
   pushTransaction(block, minerTransactionHash, transactionIndex);
 
-  size_t coinbase_blob_size = getObjectBinarySize(blockData.baseTransaction);
+  size_t coinbase_blob_size = cachedBlock.getBaseTransaction().getTransactionBinarySize();
   size_t cumulative_block_size = coinbase_blob_size;
   uint64_t fee_summary = 0;
     uint64_t interestSummary = 0;
+  std::vector<RingSignatureCheck> ringSignatureChecks;
 
     for (size_t i = 0; i < transactions.size(); ++i)
     {
       const Crypto::Hash &tx_id = blockData.transactionHashes[i];
       block.transactions.resize(block.transactions.size() + 1);
       block.transactions.back().tx = transactions[i];
-      size_t blob_size = toBinaryArray(transactions[i]).size();
+      CachedTransaction cachedTransaction(transactions[i]);
+      size_t blob_size = cachedTransaction.getTransactionBinarySize();
 
     uint64_t in_amount = m_currency.getTransactionAllInputsAmount(transactions[i], block.height);
 	  uint64_t out_amount = getOutputAmount(transactions[i]);
@@ -2253,7 +3135,7 @@ bool Blockchain::pushBlock(const Block &blockData, const std::vector<Transaction
       logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " can't contain transaction " << tx_id << " because it has invalid version " << transactions[i].version;
     }
 
-    if (!checkTransactionInputs(transactions[i])) {
+    if (!checkTransactionInputs(cachedTransaction, NULL, &ringSignatureChecks)) {
       isTransactionValid = false;
       logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has at least one transaction with wrong inputs: " << tx_id;
     }
@@ -2280,6 +3162,13 @@ bool Blockchain::pushBlock(const Block &blockData, const std::vector<Transaction
       interestSummary += m_currency.calculateTotalTransactionInterest(transactions[i], block.height);
   }
 
+  if (!checkRingSignatures(ringSignatureChecks, bvc)) {
+    logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has at least one transaction with invalid ring signature";
+    bvc.m_verification_failed = true;
+    popTransactions(block, minerTransactionHash);
+    return false;
+  }
+
   if (!checkCumulativeBlockSize(blockHash, cumulative_block_size, m_blocks.size())) {
     bvc.m_verification_failed = true;
     return false;
@@ -2287,7 +3176,7 @@ bool Blockchain::pushBlock(const Block &blockData, const std::vector<Transaction
 
   int64_t emissionChange = 0;
   uint64_t reward = 0;
-  uint64_t already_generated_coins = m_blocks.empty() ? 0 : m_blocks.back().already_generated_coins;
+  uint64_t already_generated_coins = m_headerIndex.empty() ? 0 : m_headerIndex.back().generatedCoins;
   if (!validate_miner_transaction(blockData, static_cast<uint32_t>(m_blocks.size()), cumulative_block_size, already_generated_coins, fee_summary, reward, emissionChange)) {
     logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has invalid miner transaction";
     bvc.m_verification_failed = true;
@@ -2300,13 +3189,14 @@ bool Blockchain::pushBlock(const Block &blockData, const std::vector<Transaction
   block.cumulative_difficulty = currentDifficulty;
   block.already_generated_coins = already_generated_coins + emissionChange;
   if (m_blocks.size() > 0) {
-    block.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
+    block.cumulative_difficulty += m_headerIndex.back().cumulativeDifficulty;
   }
 
-  pushBlock(block);
+  pushBlock(block, cachedBlock);
     pushToDepositIndex(block, interestSummary);
 
   auto block_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - blockProcessingStart).count();
+  uint64_t objectHashes = getObjectHashCount() - objectHashesStart;
 
   logger(DEBUGGING, YELLOW) <<
     "+++++ BLOCK SUCCESSFULLY ADDED" << ENDL << "id:\t" << blockHash
@@ -2314,41 +3204,155 @@ bool Blockchain::pushBlock(const Block &blockData, const std::vector<Transaction
     << ENDL << "HEIGHT " << block.height << ", difficulty:\t" << currentDifficulty
     << ENDL << "block reward: " << m_currency.formatAmount(reward) << ", fee = " << m_currency.formatAmount(fee_summary)
     << ", coinbase_blob_size: " << coinbase_blob_size << ", cumulative size: " << cumulative_block_size
-    << ", " << block_processing_time << "(" << target_calculating_time << "/" << longhash_calculating_time << ")ms";
+    << ", " << block_processing_time << "(" << target_calculating_time << "/" << longhash_calculating_time << ")ms"
+    << ", ring signatures: " << bvc.m_ring_signatures_checked << " in " << bvc.m_ring_signature_check_us << "us"
+    << ", object hashes: " << objectHashes;
+
+  bvc.m_added_to_main_chain = true;
+
+  m_upgradeDetector.blockPushed();
+
+  update_next_comulative_size_limit();
+
+  return true;
+}
+
+// Every block up to the last checkpoint is pinned by the hash chain, so proof of work, timestamps,
+// versions and the transactions' inputs and signatures are already settled. What is left is checking
+// that the transactions match the block, then indexing outputs and key images and the running totals.
+bool Blockchain::pushCheckpointedBlock(const Block &blockData, const std::vector<BinaryArray> &transactions, block_verification_context &bvc) {
+  uint32_t height = static_cast<uint32_t>(m_blocks.size());
+  CachedBlock cachedBlock(blockData);
+  const Crypto::Hash& blockHash = cachedBlock.getBlockHash();
+
+  if (!m_checkpoints.check_block(height, blockHash)) {
+    logger(ERROR, BRIGHT_RED) <<
+      "CHECKPOINT VALIDATION FAILED";
+    bvc.m_verification_failed = true;
+    return false;
+  }
+
+  if (transactions.size() != blockData.transactionHashes.size()) {
+    logger(INFO, BRIGHT_WHITE) <<
+      "Block " << blockHash << " came with " << transactions.size() << " transactions, expected " << blockData.transactionHashes.size();
+    bvc.m_verification_failed = true;
+    return false;
+  }
+
+  difficulty_type currentDifficulty = getDifficultyForNextBlock();
+  if (!(currentDifficulty)) {
+    logger(ERROR, BRIGHT_RED) << "!!!!!!!!! difficulty overhead !!!!!!!!!";
+    bvc.m_verification_failed = true;
+    return false;
+  }
+
+  const Crypto::Hash& minerTransactionHash = cachedBlock.getBaseTransaction().getTransactionHash();
+
+  BlockEntry block;
+  block.bl = blockData;
+  block.height = height;
+  block.transactions.resize(1);
+  block.transactions[0].tx = blockData.baseTransaction;
+  TransactionIndex transactionIndex = { block.height, static_cast<uint16_t>(0) };
+  if (!pushTransaction(block, minerTransactionHash, transactionIndex)) {
+    bvc.m_verification_failed = true;
+    return false;
+  }
+
+  size_t cumulative_block_size = cachedBlock.getBaseTransaction().getTransactionBinarySize();
+  uint64_t fee_summary = 0;
+  uint64_t interestSummary = 0;
+
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    const Crypto::Hash &tx_id = blockData.transactionHashes[i];
+    block.transactions.resize(block.transactions.size() + 1);
+    Transaction& transaction = block.transactions.back().tx;
+
+    if (Crypto::cn_fast_hash(transactions[i].data(), transactions[i].size()) != tx_id || !decodeTransaction(transactions[i], transaction)) {
+      logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " came with a transaction that doesn't match " << tx_id;
+      bvc.m_verification_failed = true;
+      block.transactions.pop_back();
+      popTransactions(block, minerTransactionHash);
+      return false;
+    }
+
+    //a relayed copy may be waiting in the pool, it is mined now
+    if (m_tx_pool.have_tx(tx_id)) {
+      Transaction pooled;
+      size_t pooledSize;
+      uint64_t pooledFee;
+      m_tx_pool.take_tx(tx_id, pooled, pooledSize, pooledFee);
+    }
+
+    uint64_t in_amount = m_currency.getTransactionAllInputsAmount(transaction, block.height);
+    uint64_t out_amount = getOutputAmount(transaction);
+    uint64_t fee = in_amount < out_amount ? CryptoNote::parameters::MINIMUM_FEE : in_amount - out_amount;
+
+    ++transactionIndex.transaction;
+    if (!pushTransaction(block, tx_id, transactionIndex)) {
+      bvc.m_verification_failed = true;
+      block.transactions.pop_back();
+      popTransactions(block, minerTransactionHash);
+      return false;
+    }
+
+    cumulative_block_size += transactions[i].size();
+    fee_summary += fee;
+    interestSummary += m_currency.calculateTotalTransactionInterest(transaction, block.height);
+  }
+
+  int64_t emissionChange = 0;
+  uint64_t reward = 0;
+  uint64_t already_generated_coins = m_headerIndex.empty() ? 0 : m_headerIndex.back().generatedCoins;
+  if (!validate_miner_transaction(blockData, height, cumulative_block_size, already_generated_coins, fee_summary, reward, emissionChange)) {
+    logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has invalid miner transaction";
+    bvc.m_verification_failed = true;
+    popTransactions(block, minerTransactionHash);
+    return false;
+  }
+
+  block.block_cumulative_size = cumulative_block_size;
+  block.cumulative_difficulty = currentDifficulty;
+  block.already_generated_coins = already_generated_coins + emissionChange;
+  if (m_blocks.size() > 0) {
+    block.cumulative_difficulty += m_headerIndex.back().cumulativeDifficulty;
+  }
+
+  pushBlock(block, cachedBlock);
+  pushToDepositIndex(block, interestSummary);
 
   bvc.m_added_to_main_chain = true;
 
-  m_upgradeDetectorV2.blockPushed();
-  m_upgradeDetectorV3.blockPushed();
-  m_upgradeDetectorV4.blockPushed();
-  m_upgradeDetectorV5.blockPushed();
-  m_upgradeDetectorV6.blockPushed();
-  m_upgradeDetectorV7.blockPushed();
-  m_upgradeDetectorV8.blockPushed();
-  m_upgradeDetectorV9.blockPushed();
+  m_upgradeDetector.blockPushed();
 
   update_next_comulative_size_limit();
+  sendMessage(BlockchainMessage(NewBlockMessage(blockHash)));
 
   return true;
 }
 
 uint64_t Blockchain::fullDepositAmount() const {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledSharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
   return m_depositIndex.fullDepositAmount();
 }
 
 uint64_t Blockchain::depositAmountAtHeight(size_t height) const {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledSharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
   return m_depositIndex.depositAmountAtHeight(static_cast<DepositIndex::DepositHeight>(height));
 }
 
   uint64_t Blockchain::depositInterestAtHeight(size_t height) const
   {
-    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    Common::ProfiledSharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
     return m_depositIndex.depositInterestAtHeight(static_cast<DepositIndex::DepositHeight>(height));
   }
 
   void Blockchain::pushToDepositIndex(const BlockEntry &block, uint64_t interest)
+  {
+    m_depositIndex.pushBlock(blockDepositAmount(block), interest);
+  }
+
+  int64_t Blockchain::blockDepositAmount(const BlockEntry &block)
   {
     int64_t deposit = 0;
     for (const auto &tx : block.transactions)
@@ -2376,61 +3380,199 @@ uint64_t Blockchain::depositAmountAtHeight(size_t height) const {
         }
       }
     }
-    m_depositIndex.pushBlock(deposit, interest);
+    return deposit;
   }
 
-bool Blockchain::pushBlock(BlockEntry &block) {
-  Crypto::Hash blockHash = get_block_hash(block.bl);
+bool Blockchain::pushBlock(BlockEntry &block, const CachedBlock &cachedBlock) {
+  const Crypto::Hash& blockHash = cachedBlock.getBlockHash();
 
   m_blocks.push_back(block);
+  pushToHeaderIndex(block);
   m_blockIndex.push(blockHash);
+  pushToDifficultyWindow(block);
 
-  m_timestampIndex.add(block.bl.timestamp, blockHash);
-  m_generatedTransactionsIndex.add(block.bl);
+  if (indexReady(BLOCKCHAIN_INDEX_TIMESTAMP)) {
+    m_timestampIndex.add(block.bl.timestamp, blockHash);
+  }
+
+  if (indexReady(BLOCKCHAIN_INDEX_GENERATED_TRANSACTIONS)) {
+    m_generatedTransactionsIndex.add(block.bl);
+  }
+
+  if (indexReady(BLOCKCHAIN_INDEX_TRANSACTION_SUMMARIES)) {
+    addTransactionSummaries(block, cachedBlock.getBaseTransaction().getTransactionHash());
+  }
 
   assert(m_blockIndex.size() == m_blocks.size());
 
+  if (m_journal.isOpened()) {
+    CacheShard delta;
+    collectCacheBlock(delta, static_cast<uint32_t>(m_blocks.size() - 1), block, cachedBlock);
+    BlockchainJournalRecord record = { BlockchainJournalRecordType::PUSH, static_cast<uint32_t>(m_blocks.size() - 1), blockHash, toBinaryArray(delta) };
+    m_journal.append(record);
+  }
+
   return true;
 }
 
-void Blockchain::popBlock(const Crypto::Hash& blockHash) {
+void Blockchain::popBlock() {
   if (m_blocks.empty()) {
     logger(ERROR, BRIGHT_RED) <<
       "Attempt to pop block from empty blockchain.";
     return;
   }
 
-  std::vector<Transaction> transactions(m_blocks.back().transactions.size() - 1);
-  for (size_t i = 0; i < m_blocks.back().transactions.size() - 1; ++i) {
-    transactions[i] = m_blocks.back().transactions[1 + i].tx;
-  }
+  Crypto::Hash blockHash = m_blockIndex.getBlockId(static_cast<uint32_t>(m_blocks.size() - 1));
+  Crypto::Hash minerTransactionHash = getObjectHash(m_blocks.back().bl.baseTransaction);
+  popTransactions(m_blocks.back(), minerTransactionHash);
 
-  uint32_t height = m_blocks.size(); //height of popped block should be same as number of blocks
-  saveTransactions(transactions, height);
+  if (indexReady(BLOCKCHAIN_INDEX_TIMESTAMP)) {
+    m_timestampIndex.remove(m_blocks.back().bl.timestamp, blockHash);
+  }
 
-  popTransactions(m_blocks.back(), getObjectHash(m_blocks.back().bl.baseTransaction));
+  if (indexReady(BLOCKCHAIN_INDEX_GENERATED_TRANSACTIONS)) {
+    m_generatedTransactionsIndex.remove(m_blocks.back().bl);
+  }
 
-  m_timestampIndex.remove(m_blocks.back().bl.timestamp, blockHash);
-  m_generatedTransactionsIndex.remove(m_blocks.back().bl);
+  if (indexReady(BLOCKCHAIN_INDEX_TRANSACTION_SUMMARIES)) {
+    m_transactionSummaryIndex.remove(m_blocks.back().bl, minerTransactionHash);
+  }
 
   m_depositIndex.popBlock();
   m_blocks.pop_back();
+  m_headerIndex.pop();
   m_blockIndex.pop();
+  popFromDifficultyWindow();
+
+  if (m_journal.isOpened()) {
+    BlockchainJournalRecord record = { BlockchainJournalRecordType::POP, static_cast<uint32_t>(m_blocks.size()), blockHash, BinaryArray() };
+    m_journal.append(record);
+  }
 
   assert(m_blockIndex.size() == m_blocks.size());
-/*--------------------------------------------------------------------------------------------------------------*/
-  removeLastBlock();
-/*--------------------------------------------------------------------------------------------------------------*/
-  m_upgradeDetectorV2.blockPopped();
-  m_upgradeDetectorV3.blockPopped();
-  m_upgradeDetectorV4.blockPopped();
-  m_upgradeDetectorV5.blockPopped();
-  m_upgradeDetectorV6.blockPopped();
-  m_upgradeDetectorV7.blockPopped();
-  m_upgradeDetectorV8.blockPopped();
-  m_upgradeDetectorV9.blockPopped();
+  m_upgradeDetector.blockPopped();
+}
+
+void Blockchain::pushToHeaderIndex(const BlockEntry& block) {
+  BlockHeaderSummary header = boost::value_initialized<BlockHeaderSummary>();
+  header.timestamp = block.bl.timestamp;
+  header.cumulativeSize = block.block_cumulative_size;
+  header.cumulativeDifficulty = block.cumulative_difficulty;
+  header.generatedCoins = block.already_generated_coins;
+  header.majorVersion = block.bl.majorVersion;
+  header.minorVersion = block.bl.minorVersion;
+  header.nonce = block.bl.nonce;
+  m_headerIndex.push(header);
+}
+
+// Brings the header index in line with m_blocks after opening: drops summaries past the tip, starts
+// over when the last shared height disagrees with its block and fills in the missing heights
+void Blockchain::syncHeaderIndex() {
+  m_headerIndex.truncate(static_cast<uint32_t>(m_blocks.size()));
+
+  bool consistent = true;
+  if (!m_headerIndex.empty()) {
+    const BlockHeaderSummary& header = m_headerIndex.back();
+    const BlockEntry& block = m_blocks[m_headerIndex.size() - 1];
+    consistent = header.timestamp == block.bl.timestamp && header.cumulativeSize == block.block_cumulative_size &&
+      header.cumulativeDifficulty == block.cumulative_difficulty && header.generatedCoins == block.already_generated_coins &&
+      header.majorVersion == block.bl.majorVersion && header.minorVersion == block.bl.minorVersion &&
+      header.nonce == block.bl.nonce;
+  }
+
+  if (!consistent) {
+    logger(WARNING, BRIGHT_YELLOW) << "Block header index doesn't match the blocks, rebuilding it...";
+    m_headerIndex.clear();
+  }
+
+  if (m_headerIndex.size() < m_blocks.size()) {
+    logger(INFO, BRIGHT_WHITE) << "Indexing headers of " << m_blocks.size() - m_headerIndex.size() << " blocks...";
+    m_headerIndex.reserve(static_cast<uint32_t>(m_blocks.size()));
+    for (uint32_t i = m_headerIndex.size(); i < m_blocks.size(); ++i) {
+      pushToHeaderIndex(m_blocks[i]);
+    }
+
+    m_headerIndex.flush();
+  }
+}
+
+// Brings the deposit index in line with a blockchain cache of the given height: drops rows past it,
+// starts over when the last shared row disagrees with its block and computes the missing rows
+void Blockchain::syncDepositIndex(uint32_t height) {
+  m_depositIndex.popBlocks(height);
+
+  bool consistent = true;
+  if (m_depositIndex.size() > 0) {
+    uint32_t last = m_depositIndex.size() - 1;
+    const BlockEntry& block = m_blocks[last];
+    int64_t amount = blockDepositAmount(block);
+    consistent = m_depositIndex.depositAmountBetween(last, last + 1) == amount &&
+      m_depositIndex.depositInterestBetween(last, last + 1) == (amount == 0 ? 0 : blockInterest(block, last));
+  }
+
+  if (!consistent) {
+    logger(WARNING, BRIGHT_YELLOW) << "Deposit index doesn't match the blocks, rebuilding it...";
+    m_depositIndex.clear();
+  }
+
+  if (m_depositIndex.size() < height) {
+    logger(INFO, BRIGHT_WHITE) << "Indexing deposits of " << height - m_depositIndex.size() << " blocks...";
+    m_depositIndex.reserve(height);
+    for (uint32_t i = m_depositIndex.size(); i < height; ++i) {
+      const BlockEntry& block = m_blocks[i];
+      m_depositIndex.pushBlock(blockDepositAmount(block), blockInterest(block, i));
+    }
+
+    m_depositIndex.flush();
+  }
+}
+
+uint64_t Blockchain::blockInterest(const BlockEntry& block, uint32_t height) const {
+  uint64_t interest = 0;
+  for (const auto& transaction : block.transactions) {
+    interest += m_currency.calculateTotalTransactionInterest(transaction.tx, height);
+  }
+
+  return interest;
+}
 
+void Blockchain::pushToDifficultyWindow(const BlockEntry& block) {
+  std::lock_guard<std::mutex> windowLock(m_difficultyWindowLock);
+  uint32_t height = static_cast<uint32_t>(m_blocks.size() - 1);
+  if (m_difficultyWindow.endHeight() != height) {
+    m_difficultyWindow.reset(height);
+  }
+
+  m_difficultyWindow.push(block.bl.timestamp, block.cumulative_difficulty);
+}
+
+void Blockchain::popFromDifficultyWindow() {
+  std::lock_guard<std::mutex> windowLock(m_difficultyWindowLock);
+  if (m_difficultyWindow.size() > 0 && m_difficultyWindow.endHeight() == m_blocks.size() + 1) {
+    m_difficultyWindow.pop();
+  } else {
+    m_difficultyWindow.reset(static_cast<uint32_t>(m_blocks.size()));
+  }
+}
+
+// Makes the window end at the tip and start at or below beginHeight. The caller holds
+// m_difficultyWindowLock; returns false when the range is longer than the window.
+bool Blockchain::fillDifficultyWindow(uint32_t beginHeight) {
+  uint32_t height = static_cast<uint32_t>(m_blocks.size());
+  if (beginHeight > height || height - beginHeight > m_difficultyWindow.capacity()) {
+    return false;
+  }
+
+  if (m_difficultyWindow.endHeight() != height) {
+    m_difficultyWindow.reset(height);
+  }
 
+  while (m_difficultyWindow.beginHeight() > beginHeight) {
+    const BlockHeaderSummary& header = m_headerIndex[m_difficultyWindow.beginHeight() - 1];
+    m_difficultyWindow.pushFront(header.timestamp, header.cumulativeDifficulty);
+  }
+
+  return true;
 }
 
 bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transactionHash, TransactionIndex transactionIndex) {
@@ -2467,9 +3609,15 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
         m_transactionMap.erase(transactionHash);
         return false;
       }
+
+      m_spentKeyFilter.insert(::boost::get<KeyInput>(transaction.tx.inputs[i]).keyImage);
     }
   }
 
+  if (m_spentKeyFilter.saturated()) {
+    rebuildSpentKeyFilter();
+  }
+
   for (const auto& inv : transaction.tx.inputs) {
     if (inv.type() == typeid(MultisignatureInput)) {
       const MultisignatureInput& in = ::boost::get<MultisignatureInput>(inv);
@@ -2481,18 +3629,23 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
   transaction.m_global_output_indexes.resize(transaction.tx.outputs.size());
   for (uint16_t output = 0; output < transaction.tx.outputs.size(); ++output) {
     if (transaction.tx.outputs[output].target.type() == typeid(KeyOutput)) {
-      auto& amountOutputs = m_outputs[transaction.tx.outputs[output].amount];
-      transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
-      amountOutputs.push_back(std::make_pair<>(transactionIndex, output));
+      transaction.m_global_output_indexes[output] = m_outputs.push(transaction.tx.outputs[output].amount, transactionIndex.block, transactionIndex.transaction, output);
     } else if (transaction.tx.outputs[output].target.type() == typeid(MultisignatureOutput)) {
       auto& amountOutputs = m_multisignatureOutputs[transaction.tx.outputs[output].amount];
       transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
-      MultisignatureOutputUsage outputUsage = { transactionIndex, output, false };
+      MultisignatureOutputUsage outputUsage = { transactionIndex, output, false, transactionHash, transaction.tx.unlockTime,
+        ::boost::get<MultisignatureOutput>(transaction.tx.outputs[output].target) };
       amountOutputs.push_back(outputUsage);
     }
   }
 
-  m_paymentIdIndex.add(transaction.tx);
+  if (indexReady(BLOCKCHAIN_INDEX_PAYMENT_ID)) {
+    m_paymentIdIndex.add(transaction.tx);
+  }
+
+  if (indexReady(BLOCKCHAIN_INDEX_KEY_IMAGE)) {
+    m_keyImageIndex.add(transaction.tx, transactionHash);
+  }
 
   return true;
 }
@@ -2502,35 +3655,27 @@ void Blockchain::popTransaction(const Transaction& transaction, const Crypto::Ha
   for (size_t outputIndex = 0; outputIndex < transaction.outputs.size(); ++outputIndex) {
     const TransactionOutput& output = transaction.outputs[transaction.outputs.size() - 1 - outputIndex];
     if (output.target.type() == typeid(KeyOutput)) {
-      auto amountOutputs = m_outputs.find(output.amount);
-      if (amountOutputs == m_outputs.end()) {
+      OutputIndex::Outputs amountOutputs = m_outputs.find(output.amount);
+      if (amountOutputs.empty()) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - cannot find specific amount in outputs map.";
         continue;
       }
 
-      if (amountOutputs->second.empty()) {
-        logger(ERROR, BRIGHT_RED) <<
-          "Blockchain consistency broken - output array for specific amount is empty.";
-        continue;
-      }
-
-      if (amountOutputs->second.back().first.block != transactionIndex.block || amountOutputs->second.back().first.transaction != transactionIndex.transaction) {
+      size_t last = amountOutputs.size() - 1;
+      if (amountOutputs.block(last) != transactionIndex.block || amountOutputs.transaction(last) != transactionIndex.transaction) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid transaction index.";
         continue;
       }
 
-      if (amountOutputs->second.back().second != transaction.outputs.size() - 1 - outputIndex) {
+      if (amountOutputs.output(last) != transaction.outputs.size() - 1 - outputIndex) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid output index.";
         continue;
       }
 
-      amountOutputs->second.pop_back();
-      if (amountOutputs->second.empty()) {
-        m_outputs.erase(amountOutputs);
-      }
+      m_outputs.pop(output.amount);
     } else if (output.target.type() == typeid(MultisignatureOutput)) {
       auto amountOutputs = m_multisignatureOutputs.find(output.amount);
       if (amountOutputs == m_multisignatureOutputs.end()) {
@@ -2589,7 +3734,13 @@ void Blockchain::popTransaction(const Transaction& transaction, const Crypto::Ha
     }
   }
 
-  m_paymentIdIndex.remove(transaction);
+  if (indexReady(BLOCKCHAIN_INDEX_PAYMENT_ID)) {
+    m_paymentIdIndex.remove(transaction);
+  }
+
+  if (indexReady(BLOCKCHAIN_INDEX_KEY_IMAGE)) {
+    m_keyImageIndex.remove(transaction);
+  }
 
   size_t count = m_transactionMap.erase(transactionHash);
   if (count != 1) {
@@ -2628,16 +3779,13 @@ bool Blockchain::validateInput(const MultisignatureInput& input, const Crypto::H
     return false;
   }
 
-  const Transaction& outputTransaction = m_blocks[outputIndex.transactionIndex.block].transactions[outputIndex.transactionIndex.transaction].tx;
-  if (!is_tx_spendtime_unlocked(outputTransaction.unlockTime)) {
+  if (!is_tx_spendtime_unlocked(outputIndex.unlockTime)) {
     logger(DEBUGGING) <<
       "Transaction << " << transactionHash << " contains multisignature input which points to a locked transaction.";
     return false;
   }
 
-  assert(outputTransaction.outputs[outputIndex.outputIndex].amount == input.amount);
-  assert(outputTransaction.outputs[outputIndex.outputIndex].target.type() == typeid(MultisignatureOutput));
-  const MultisignatureOutput& output = ::boost::get<MultisignatureOutput>(outputTransaction.outputs[outputIndex.outputIndex].target);
+  const MultisignatureOutput& output = outputIndex.output;
   if (input.signatureCount != output.requiredSignatureCount) {
     logger(DEBUGGING) <<
       "Transaction << " << transactionHash << " contains multisignature input with invalid signature count.";
@@ -2693,23 +3841,35 @@ bool Blockchain::validateInput(const MultisignatureInput& input, const Crypto::H
   }
 
   logger(DEBUGGING) << "Removing last block with height " << m_blocks.back().height;
-  popTransactions(m_blocks.back(), getObjectHash(m_blocks.back().bl.baseTransaction));
+  Crypto::Hash minerTransactionHash = getObjectHash(m_blocks.back().bl.baseTransaction);
+  popTransactions(m_blocks.back(), minerTransactionHash);
 
   Crypto::Hash blockHash = getBlockIdByHeight(m_blocks.back().height);
-  m_timestampIndex.remove(m_blocks.back().bl.timestamp, blockHash);
-  m_generatedTransactionsIndex.remove(m_blocks.back().bl);
+  if (indexReady(BLOCKCHAIN_INDEX_TIMESTAMP)) {
+    m_timestampIndex.remove(m_blocks.back().bl.timestamp, blockHash);
+  }
+
+  if (indexReady(BLOCKCHAIN_INDEX_GENERATED_TRANSACTIONS)) {
+    m_generatedTransactionsIndex.remove(m_blocks.back().bl);
+  }
+
+  if (indexReady(BLOCKCHAIN_INDEX_TRANSACTION_SUMMARIES)) {
+    m_transactionSummaryIndex.remove(m_blocks.back().bl, minerTransactionHash);
+  }
 
   m_blocks.pop_back();
+  m_headerIndex.pop();
   m_blockIndex.pop();
+  popFromDifficultyWindow();
 
   assert(m_blockIndex.size() == m_blocks.size());
 }
 
-bool Blockchain::checkUpgradeHeight(const UpgradeDetector& upgradeDetector) {
-  uint32_t upgradeHeight = upgradeDetector.upgradeHeight();
+bool Blockchain::checkUpgradeHeight(uint8_t version) {
+  uint32_t upgradeHeight = m_upgradeDetector.upgradeHeight(version);
   if (upgradeHeight != UpgradeDetectorBase::UNDEF_HEIGHT && upgradeHeight + 1 < m_blocks.size()) {
     logger(INFO) << "Checking block version at " << upgradeHeight + 1;
-    if (m_blocks[upgradeHeight + 1].bl.majorVersion != upgradeDetector.targetVersion()) {
+    if (m_headerIndex[upgradeHeight + 1].majorVersion != version) {
       return false;
     }
   }
@@ -2718,28 +3878,58 @@ bool Blockchain::checkUpgradeHeight(const UpgradeDetector& upgradeDetector) {
 }
 
 bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_t& height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
 
-  assert(startOffset < m_blocks.size());
+  assert(startOffset < m_headerIndex.size());
 
-  auto bound = std::lower_bound(m_blocks.begin() + startOffset, m_blocks.end(), timestamp - m_currency.blockFutureTimeLimit(),
-    [](const BlockEntry& b, uint64_t timestamp) { return b.bl.timestamp < timestamp; });
+  auto bound = std::lower_bound(m_headerIndex.begin() + startOffset, m_headerIndex.end(), timestamp - m_currency.blockFutureTimeLimit(),
+    [](const BlockHeaderSummary& b, uint64_t timestamp) { return b.timestamp < timestamp; });
 
-  if (bound == m_blocks.end()) {
+  if (bound == m_headerIndex.end()) {
     return false;
   }
 
-  height = static_cast<uint32_t>(std::distance(m_blocks.begin(), bound));
+  height = static_cast<uint32_t>(std::distance(m_headerIndex.begin(), bound));
   return true;
 }
 
 std::vector<Crypto::Hash> Blockchain::getBlockIds(uint32_t startHeight, uint32_t maxCount) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   return m_blockIndex.getBlockIds(startHeight, maxCount);
 }
 
+void Blockchain::getBlockHeaders(uint32_t startHeight, uint32_t maxCount, std::vector<BlockHeaderInfo>& headers) {
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  if (startHeight >= m_headerIndex.size()) {
+    return;
+  }
+
+  uint32_t count = std::min(maxCount, m_headerIndex.size() - startHeight);
+  // one extra id in front supplies the previous hash of the first header
+  uint32_t firstId = startHeight == 0 ? 0 : startHeight - 1;
+  std::vector<Crypto::Hash> ids = m_blockIndex.getBlockIds(firstId, count + (startHeight - firstId));
+
+  headers.reserve(headers.size() + count);
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t height = startHeight + i;
+    const BlockHeaderSummary& summary = m_headerIndex[height];
+    BlockHeaderInfo header;
+    header.hash = ids[height - firstId];
+    header.prevHash = height == 0 ? NULL_HASH : ids[height - firstId - 1];
+    header.height = height;
+    header.majorVersion = summary.majorVersion;
+    header.minorVersion = summary.minorVersion;
+    header.nonce = summary.nonce;
+    header.timestamp = summary.timestamp;
+    header.cumulativeSize = summary.cumulativeSize;
+    header.cumulativeDifficulty = summary.cumulativeDifficulty;
+    header.alreadyGeneratedCoins = summary.generatedCoins;
+    headers.push_back(header);
+  }
+}
+
 bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   auto it = m_transactionMap.find(txId);
   if (it == m_transactionMap.end()) {
     return false;
@@ -2751,12 +3941,12 @@ bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto:
 }
 
 bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
 
   // try to find block in main chain
   uint32_t height = 0;
   if (m_blockIndex.getBlockHeight(hash, height)) {
-    generatedCoins = m_blocks[height].already_generated_coins;
+    generatedCoins = m_headerIndex[height].generatedCoins;
     return true;
   }
 
@@ -2772,12 +3962,12 @@ bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& ge
 }
 
 bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
 
   // try to find block in main chain
   uint32_t height = 0;
   if (m_blockIndex.getBlockHeight(hash, height)) {
-    size = m_blocks[height].block_cumulative_size;
+    size = m_headerIndex[height].cumulativeSize;
     return true;
   }
 
@@ -2793,7 +3983,7 @@ bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
 }
 
 bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
   MultisignatureOutputsContainer::const_iterator amountIter = m_multisignatureOutputs.find(txInMultisig.amount);
   if (amountIter == m_multisignatureOutputs.end()) {
     logger(DEBUGGING) << "Transaction contains multisignature input with invalid amount.";
@@ -2804,14 +3994,13 @@ bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMulti
     return false;
   }
   const MultisignatureOutputUsage& outputIndex = amountIter->second[txInMultisig.outputIndex];
-  const Transaction& outputTransaction = m_blocks[outputIndex.transactionIndex.block].transactions[outputIndex.transactionIndex.transaction].tx;
-  outputReference.first = getObjectHash(outputTransaction);
+  outputReference.first = outputIndex.transactionHash;
   outputReference.second = outputIndex.outputIndex;
   return true;
 }
 
 bool Blockchain::storeBlockchainIndices() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
 
   logger(INFO, BRIGHT_WHITE) << "Saving blockchain indices...";
   BlockchainIndicesSerializer ser(*this, getTailId(), logger.getLogger());
@@ -2825,58 +4014,250 @@ bool Blockchain::storeBlockchainIndices() {
 }
 
 bool Blockchain::loadBlockchainIndices() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
 
   logger(INFO, BRIGHT_WHITE) << "Loading blockchain indices for BlockchainExplorer...";
   BlockchainIndicesSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
 
   loadFromBinaryFile(loader, appendPath(m_config_folder, m_currency.blockchinIndicesFileName()));
 
-  if (!loader.loaded()) {
-    logger(WARNING, BRIGHT_MAGENTA) << "No actual blockchain indices for BlockchainExplorer found, rebuilding...";
-    std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+  // the orphan blocks index starts empty along with the alternative chains
+  m_readyIndexes = loader.loadedIndexes() | (m_blockchainIndexes & BLOCKCHAIN_INDEX_ORPHAN_BLOCKS);
+  clearIndexes(m_blockchainIndexes & ~m_readyIndexes);
+  m_backfillHeight = 0;
+  if ((m_blockchainIndexes & ~m_readyIndexes) != 0) {
+    logger(WARNING, BRIGHT_MAGENTA) << "No actual blockchain indices for BlockchainExplorer found, rebuilding them in the background";
+  }
+
+  return true;
+}
+
+void Blockchain::addToIndexes(uint32_t indexes, const BlockEntry& block) {
+  if ((indexes & BLOCKCHAIN_INDEX_TIMESTAMP) != 0) {
+    m_timestampIndex.add(block.bl.timestamp, get_block_hash(block.bl));
+  }
+
+  if ((indexes & BLOCKCHAIN_INDEX_GENERATED_TRANSACTIONS) != 0) {
+    m_generatedTransactionsIndex.add(block.bl);
+  }
+
+  if ((indexes & BLOCKCHAIN_INDEX_TRANSACTION_SUMMARIES) != 0) {
+    addTransactionSummaries(block, getObjectHash(block.bl.baseTransaction));
+  }
+
+  for (uint16_t t = 0; t < block.transactions.size(); ++t) {
+    const TransactionEntry& transaction = block.transactions[t];
+    if ((indexes & BLOCKCHAIN_INDEX_PAYMENT_ID) != 0) {
+      m_paymentIdIndex.add(transaction.tx);
+    }
+
+    if ((indexes & BLOCKCHAIN_INDEX_KEY_IMAGE) != 0 && t != 0) {
+      m_keyImageIndex.add(transaction.tx, block.bl.transactionHashes[t - 1]);
+    }
+  }
+}
+
+// Resolves what the explorer shows for each transaction of the block once, so a block page
+// doesn't load the block of every ring member again
+void Blockchain::addTransactionSummaries(const BlockEntry& block, const Crypto::Hash& minerTransactionHash) {
+  // block may be an m_blocks cache entry, the lookups below mustn't evict it
+  m_blocks.beginSharedAccess();
+
+  for (uint16_t t = 0; t < block.transactions.size(); ++t) {
+    const Transaction& transaction = block.transactions[t].tx;
+    TransactionSummary summary;
+    summary.blockHeight = block.height;
+    summary.timestamp = block.bl.timestamp;
+    summary.totalInputsAmount = m_currency.getTransactionAllInputsAmount(transaction, block.height);
+    summary.fee = t == 0 ? 0 : BlockchainExplorerDataBuilder::getFee(m_currency, transaction, block.height);
+    summary.inputs.reserve(transaction.inputs.size());
+
+    for (const TransactionInput& input : transaction.inputs) {
+      TransactionSummaryReference reference = { NULL_HASH, 0 };
+      if (input.type() == typeid(KeyInput)) {
+        const KeyInput& keyInput = boost::get<KeyInput>(input);
+        uint64_t globalIndex = std::accumulate(keyInput.outputIndexes.begin(), keyInput.outputIndexes.end(), uint64_t(0));
+        OutputIndex::Outputs outputs = m_outputs.find(keyInput.amount);
+        if (!keyInput.outputIndexes.empty() && globalIndex < outputs.size()) {
+          const BlockEntry& outputBlock = m_blocks[outputs.block(globalIndex)];
+          uint16_t outputTransaction = outputs.transaction(globalIndex);
+          reference.transactionHash = outputTransaction == 0 ? getObjectHash(outputBlock.bl.baseTransaction) : outputBlock.bl.transactionHashes[outputTransaction - 1];
+          reference.number = outputs.output(globalIndex);
+        }
+      } else if (input.type() == typeid(MultisignatureInput)) {
+        const MultisignatureInput& multisignatureInput = boost::get<MultisignatureInput>(input);
+        auto amountIter = m_multisignatureOutputs.find(multisignatureInput.amount);
+        if (amountIter != m_multisignatureOutputs.end() && multisignatureInput.outputIndex < amountIter->second.size()) {
+          const MultisignatureOutputUsage& output = amountIter->second[multisignatureInput.outputIndex];
+          reference.transactionHash = output.transactionHash;
+          reference.number = output.outputIndex;
+        }
+      }
+
+      summary.inputs.push_back(reference);
+    }
+
+    m_transactionSummaryIndex.add(t == 0 ? minerTransactionHash : block.bl.transactionHashes[t - 1], std::move(summary));
+  }
+
+  m_blocks.endSharedAccess();
+}
 
+void Blockchain::clearIndexes(uint32_t indexes) {
+  if ((indexes & BLOCKCHAIN_INDEX_PAYMENT_ID) != 0) {
     m_paymentIdIndex.clear();
+  }
+
+  if ((indexes & BLOCKCHAIN_INDEX_KEY_IMAGE) != 0) {
+    m_keyImageIndex.clear();
+  }
+
+  if ((indexes & BLOCKCHAIN_INDEX_TIMESTAMP) != 0) {
     m_timestampIndex.clear();
+  }
+
+  if ((indexes & BLOCKCHAIN_INDEX_GENERATED_TRANSACTIONS) != 0) {
     m_generatedTransactionsIndex.clear();
+  }
 
-    for (uint32_t b = 0; b < m_blocks.size(); ++b) {
-      if (b % 1000 == 0) {
-        logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
-      }
-      const BlockEntry& block = m_blocks[b];
-      m_timestampIndex.add(block.bl.timestamp, get_block_hash(block.bl));
-      m_generatedTransactionsIndex.add(block.bl);
-      for (uint16_t t = 0; t < block.transactions.size(); ++t) {
-        const TransactionEntry& transaction = block.transactions[t];
-        m_paymentIdIndex.add(transaction.tx);
-      }
+  if ((indexes & BLOCKCHAIN_INDEX_ORPHAN_BLOCKS) != 0) {
+    m_orthanBlocksIndex.clear();
+  }
+
+  if ((indexes & BLOCKCHAIN_INDEX_TRANSACTION_SUMMARIES) != 0) {
+    m_transactionSummaryIndex.clear();
+  }
+}
+
+// Builds the enabled indices missing from the indices file, a chunk of blocks per lock, so the node
+// keeps syncing and answering meanwhile. Pushes and pops leave these indices alone until the backfill reaches the tip
+// and hands them over; a pop below the backfilled height starts it again.
+void Blockchain::backfillIndexes() {
+  const uint32_t BLOCKS_PER_LOCK = 1000;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  while (!m_stopIndexBackfill) {
+    Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
+    uint32_t pending = m_blockchainIndexes & ~m_readyIndexes;
+    if (pending == 0) {
+      return;
+    }
+
+    if (m_backfillHeight > m_blocks.size() || (m_backfillHeight > 0 && m_blockIndex.getBlockId(m_backfillHeight - 1) != m_backfillTail)) {
+      logger(INFO) << "Blockchain reorganized below the indexed height " << m_backfillHeight << ", restarting the index backfill";
+      clearIndexes(pending);
+      m_backfillHeight = 0;
     }
 
-    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
-    logger(INFO, BRIGHT_WHITE) << "Rebuilding blockchain indices took: " << duration.count();
+    uint32_t end = std::min(m_backfillHeight + BLOCKS_PER_LOCK, static_cast<uint32_t>(m_blocks.size()));
+    for (uint32_t height = m_backfillHeight; height < end; ++height) {
+      addToIndexes(pending, m_blocks[height]);
+    }
+
+    m_backfillHeight = end;
+    m_backfillTail = m_blockIndex.getBlockId(end - 1);
+    if (end % 100000 < BLOCKS_PER_LOCK) {
+      logger(INFO) << "Blockchain indices built to height " << end << " of " << m_blocks.size();
+    }
+
+    if (end == m_blocks.size()) {
+      m_readyIndexes |= pending;
+      std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+      logger(INFO, BRIGHT_WHITE) << "Rebuilding blockchain indices took: " << duration.count();
+      return;
+    }
   }
-  return true;
+}
+
+std::vector<BlockchainIndexUsage> Blockchain::getIndexUsage() {
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+
+  std::vector<BlockchainIndexUsage> usage;
+  for (size_t i = 0; i < BLOCKCHAIN_INDEX_COUNT; ++i) {
+    uint32_t index = 1u << i;
+    if ((m_blockchainIndexes & index) == 0) {
+      continue;
+    }
+
+    BlockchainIndexUsage entry;
+    entry.index = index;
+    entry.ready = indexReady(index);
+    entry.storedBytes = m_indexStoredBytes[i];
+    switch (index) {
+    case BLOCKCHAIN_INDEX_PAYMENT_ID:
+      entry.entries = m_paymentIdIndex.size();
+      entry.memoryBytes = m_paymentIdIndex.memoryUsage();
+      break;
+    case BLOCKCHAIN_INDEX_KEY_IMAGE:
+      entry.entries = m_keyImageIndex.size();
+      entry.memoryBytes = m_keyImageIndex.memoryUsage();
+      break;
+    case BLOCKCHAIN_INDEX_TIMESTAMP:
+      entry.entries = m_timestampIndex.size();
+      entry.memoryBytes = m_timestampIndex.memoryUsage();
+      break;
+    case BLOCKCHAIN_INDEX_GENERATED_TRANSACTIONS:
+      entry.entries = m_generatedTransactionsIndex.size();
+      entry.memoryBytes = m_generatedTransactionsIndex.memoryUsage();
+      break;
+    case BLOCKCHAIN_INDEX_TRANSACTION_SUMMARIES:
+      entry.entries = m_transactionSummaryIndex.size();
+      entry.memoryBytes = m_transactionSummaryIndex.memoryUsage();
+      break;
+    default:
+      entry.entries = m_orthanBlocksIndex.size();
+      entry.memoryBytes = m_orthanBlocksIndex.memoryUsage();
+      break;
+    }
+
+    usage.push_back(entry);
+  }
+
+  return usage;
 }
 
 bool Blockchain::getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  return m_generatedTransactionsIndex.find(height, generatedTransactions);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  return indexReady(BLOCKCHAIN_INDEX_GENERATED_TRANSACTIONS) && m_generatedTransactionsIndex.find(height, generatedTransactions);
+}
+
+bool Blockchain::getTransactionSummary(const Crypto::Hash& transactionHash, TransactionSummary& summary) {
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  return indexReady(BLOCKCHAIN_INDEX_TRANSACTION_SUMMARIES) && m_transactionSummaryIndex.find(transactionHash, summary);
 }
 
 bool Blockchain::getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  return m_orthanBlocksIndex.find(height, blockHashes);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  return indexReady(BLOCKCHAIN_INDEX_ORPHAN_BLOCKS) && m_orthanBlocksIndex.find(height, blockHashes);
 }
 
 bool Blockchain::getBlockIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& blocksNumberWithinTimestamps) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  return m_timestampIndex.find(timestampBegin, timestampEnd, blocksNumberLimit, hashes, blocksNumberWithinTimestamps);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  return indexReady(BLOCKCHAIN_INDEX_TIMESTAMP) && m_timestampIndex.find(timestampBegin, timestampEnd, blocksNumberLimit, hashes, blocksNumberWithinTimestamps);
 }
 
 bool Blockchain::getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  return m_paymentIdIndex.find(paymentId, transactionHashes);
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  return indexReady(BLOCKCHAIN_INDEX_PAYMENT_ID) && m_paymentIdIndex.find(paymentId, transactionHashes);
+}
+
+bool Blockchain::getTransactionIdByKeyImage(const Crypto::KeyImage& keyImage, Crypto::Hash& transactionHash) {
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  return indexReady(BLOCKCHAIN_INDEX_KEY_IMAGE) && m_keyImageIndex.find(keyImage, transactionHash);
+}
+
+bool Blockchain::getTransactionIdByGlobalOutput(uint64_t amount, uint32_t globalIndex, Crypto::Hash& transactionHash, uint16_t& outputIndex) {
+  ReadLock lk(*this, LOCK_SITE("blockchain"));
+  OutputIndex::Outputs outputs = m_outputs.find(amount);
+  if (globalIndex >= outputs.size()) {
+    return false;
+  }
+
+  const BlockEntry& block = m_blocks[outputs.block(globalIndex)];
+  uint16_t transaction = outputs.transaction(globalIndex);
+  transactionHash = transaction == 0 ? getObjectHash(block.bl.baseTransaction) : block.bl.transactionHashes[transaction - 1];
+  outputIndex = outputs.output(globalIndex);
+  return true;
 }
 
 bool Blockchain::loadTransactions(const Block& block, std::vector<Transaction>& transactions, uint32_t height) {
@@ -2916,9 +4297,25 @@ bool Blockchain::removeMessageQueue(MessageQueue<BlockchainMessage>& messageQueu
   return m_messageQueueList.remove(messageQueue);
 }
 
+// Precondition: m_blockchain_lock is locked.
 void Blockchain::sendMessage(const BlockchainMessage& message) {
-  for (IntrusiveLinkedList<MessageQueue<BlockchainMessage>>::iterator iter = m_messageQueueList.begin(); iter != m_messageQueueList.end(); ++iter) {
-    iter->push(message);
+  if (!m_messageQueueList.empty()) {
+    m_pendingMessages.push_back(message);
+  }
+}
+
+void Blockchain::publishMessages() {
+  std::vector<BlockchainMessage> messages;
+  {
+    Common::ProfiledLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock, LOCK_SITE("blockchain"));
+    messages.swap(m_pendingMessages);
+  }
+
+  // every queue gets the same message, copying one only shares its payload
+  for (const BlockchainMessage& message : messages) {
+    for (IntrusiveLinkedList<MessageQueue<BlockchainMessage>>::iterator iter = m_messageQueueList.begin(); iter != m_messageQueueList.end(); ++iter) {
+      iter->push(message);
+    }
   }
 }
 
@@ -18,19 +18,34 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 
 #include "google/sparse_hash_set"
 #include "google/sparse_hash_map"
 #include <parallel_hashmap/phmap.h>
 
+#include "Common/LockProfiler.h"
 #include "Common/ObserverManager.h"
+#include "Common/RecursiveSharedMutex.h"
+#include "Common/ThreadPool.h"
 #include "Common/Util.h"
+#include "CryptoNoteCore/BlockHeaderIndex.h"
 #include "CryptoNoteCore/BlockIndex.h"
+#include "CryptoNoteCore/BlockchainJournal.h"
+#include "CryptoNoteCore/CachedBlock.h"
 #include "CryptoNoteCore/Checkpoints.h"
 #include "CryptoNoteCore/Currency.h"
 #include "CryptoNoteCore/DepositIndex.h"
+#include "CryptoNoteCore/DifficultyWindow.h"
+#include "CryptoNoteCore/OutputIndex.h"
 #include "CryptoNoteCore/IBlockchainStorageObserver.h"
+#include "CryptoNoteCore/KeyImageFilter.h"
 #include "CryptoNoteCore/ITransactionValidator.h"
 #include "CryptoNoteCore/SwappedVector.h"
 #include "CryptoNoteCore/UpgradeDetector.h"
@@ -52,16 +67,48 @@ namespace CryptoNote {
   struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request;
   struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response;
   struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount;
+  struct BlockHeaderInfo;
 
   using CryptoNote::BlockInfo;
+
+  // what Blockchain::verifyChain looked at and what it found
+  struct ChainVerificationReport {
+    uint32_t checkedBlocks = 0;
+    uint64_t checkedTransactions = 0;
+    uint64_t checkedSignatures = 0;
+    uint64_t errorCount = 0;
+    std::vector<std::string> errors; // the first few found, in no particular order
+    double seconds = 0;
+  };
+
   class Blockchain : public CryptoNote::ITransactionValidator {
   public:
     Blockchain(const Currency &currency, tx_memory_pool &tx_pool, Logging::ILogger &logger, bool blockchainIndexesEnabled, bool blockchainAutosaveEnabled);
 
     bool addObserver(IBlockchainStorageObserver* observer);
     bool removeObserver(IBlockchainStorageObserver* observer);
-    void rebuildCache();
+    void rebuildCache(uint32_t startHeight = 0);
     bool storeCache();
+    bool exportSnapshot(const std::string& path);
+    // Checks the stored main chain blocks [startHeight, endHeight) against the block index, the
+    // header index and the cache, optionally also their proof of work and ring signatures. Runs
+    // on threads workers, 0 for all cores but one, each taking the lock for a slice of heights at
+    // a time so the node keeps adding blocks. Returns false when anything disagreed.
+    bool verifyChain(uint32_t startHeight, uint32_t endHeight, bool checkProofOfWork, bool checkSignatures, uint32_t threads, ChainVerificationReport& report);
+    bool importSnapshot(const std::string& config_folder, const std::string& snapshotPath);
+    Common::RecursiveSharedMutex::WaitStats lockWaitStats() const { return m_blockchain_lock.waitStats(); }
+    void getBlockCacheStats(uint64_t& hits, uint64_t& misses) { m_blocks.cacheStats(hits, misses); }
+    void getBlockCacheUsage(uint64_t& blocks, uint64_t& bytes) { m_blocks.cacheUsage(blocks, bytes); }
+    // may be called at any time; bytes must not be 0
+    void setBlockCacheSize(uint64_t bytes);
+    // Before init(): store blocks compressed in chunks of chunkBlocks, or plain with 0. A data
+    // directory holding the other kind of storage is converted on init().
+    void setBlockStoreChunk(uint32_t chunkBlocks) { m_blockStoreChunk = chunkBlocks; }
+    void getBlockStoreUsage(uint64_t& blockBytes, uint64_t& fileBytes) { m_blocks.storageUsage(blockBytes, fileBytes); }
+    // Before init(): keep these explorer indices (BLOCKCHAIN_INDEX_* bits) as well as the ones the
+    // constructor enabled. An index the indices file lacks is built in the background after init().
+    void addBlockchainIndexes(uint32_t indexes) { m_blockchainIndexes |= indexes; }
+    std::vector<BlockchainIndexUsage> getIndexUsage();
 
     // ITransactionValidator
     virtual bool checkTransactionInputs(const CryptoNote::Transaction& tx, BlockInfo& maxUsedBlock) override;
@@ -75,12 +122,16 @@ namespace CryptoNote {
 
     bool getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_t& height);
     std::vector<Crypto::Hash> getBlockIds(uint32_t startHeight, uint32_t maxCount);
+    // headers of up to maxCount main chain blocks from startHeight, served from the header index
+    // without loading any block entry
+    void getBlockHeaders(uint32_t startHeight, uint32_t maxCount, std::vector<BlockHeaderInfo>& headers);
 
-    void setCheckpoints(Checkpoints&& chk_pts) { m_checkpoints = chk_pts; }
+    void setCheckpoints(Checkpoints&& chk_pts) { m_checkpoints = std::move(chk_pts); }
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs);
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks);
     bool getAlternativeBlocks(std::list<Block>& blocks);
     uint32_t getAlternativeBlocksCount();
+    KeyImageFilter::Stats getSpentKeyFilterStats();
     Crypto::Hash getBlockIdByHeight(uint32_t height);
     bool getBlockByHash(const Crypto::Hash &h, Block &blk);
     bool getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight);
@@ -100,6 +151,9 @@ namespace CryptoNote {
     uint8_t getBlockMajorVersionForHeight(uint32_t height) const;
     uint8_t blockMajorVersion;
     bool addNewBlock(const Block& bl_, block_verification_context& bvc);
+    // appends blocks that lie below the last checkpoint, trusting the hash chain up to that checkpoint
+    // instead of revalidating them; returns how many leading blocks were added, the rest need addNewBlock
+    size_t addCheckpointedBlocks(const std::vector<Block>& blocks, const std::vector<std::vector<BinaryArray>>& transactions, block_verification_context& bvc);
     bool resetAndSetGenesisBlock(const Block& b);
     bool haveBlock(const Crypto::Hash& id);
     size_t getTotalTransactions();
@@ -114,6 +168,12 @@ namespace CryptoNote {
     bool getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs);
     bool get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out);
     bool checkTransactionInputs(const Transaction& tx, uint32_t& pmax_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail = 0);
+    // checks the inputs of a batch, ring signatures of all transactions are verified together on the signature workers;
+    // maxUsedBlocks[i] stays empty when transactions[i] is invalid
+    void checkTransactionsInputs(const std::vector<const Transaction*>& transactions, std::vector<BlockInfo>& maxUsedBlocks);
+    // computes the proof of work hashes of blocks that are about to be added, safe to call from any thread;
+    // addNewBlock then only compares them with the difficulty
+    void precomputeProofOfWork(const std::vector<Block>& blocks);
     uint64_t getCurrentCumulativeBlocksizeLimit();
     uint64_t blockDifficulty(size_t i);
     bool getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight);
@@ -121,9 +181,14 @@ namespace CryptoNote {
     bool getBlockSize(const Crypto::Hash& hash, size_t& size);
     bool getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference);
     bool getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions);
+    bool getTransactionSummary(const Crypto::Hash& transactionHash, TransactionSummary& summary);
     bool getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes);
     bool getBlockIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& blocksNumberWithinTimestamps);
     bool getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes);
+    // needs blockchain indexes enabled
+    bool getTransactionIdByKeyImage(const Crypto::KeyImage& keyImage, Crypto::Hash& transactionHash);
+    // the transaction and output that created global output globalIndex of amount (key outputs only)
+    bool getTransactionIdByGlobalOutput(uint64_t amount, uint32_t globalIndex, Crypto::Hash& transactionHash, uint16_t& outputIndex);
     bool isBlockInMainChain(const Crypto::Hash& blockId);
     uint64_t fullDepositAmount() const;
     uint64_t depositAmountAtHeight(size_t height) const;
@@ -140,8 +205,9 @@ namespace CryptoNote {
 
     template<class t_ids_container, class t_blocks_container, class t_missed_container>
     bool getBlocks(const t_ids_container& block_ids, t_blocks_container& blocks, t_missed_container& missed_bs) {
-      std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+      ReadLock lk(*this, LOCK_SITE("blockchain"));
 
+      std::vector<uint32_t> heights;
       for (const auto& bl_id : block_ids) {
         uint32_t height = 0;
         if (!m_blockIndex.getBlockHeight(bl_id, height)) {
@@ -149,25 +215,64 @@ namespace CryptoNote {
         } else {
           if (!(height < m_blocks.size())) { logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: bl_id=" << Common::podToHex(bl_id)
             << " have index record with offset=" << height << ", bigger then m_blocks.size()=" << m_blocks.size(); return false; }
-            blocks.push_back(m_blocks[height].bl);
+            heights.push_back(height);
         }
       }
 
+      // peers ask for runs of consecutive blocks, start reading each run before decoding it
+      for (size_t i = 0; i < heights.size();) {
+        size_t runEnd = i + 1;
+        while (runEnd < heights.size() && heights[runEnd] == heights[runEnd - 1] + 1) {
+          ++runEnd;
+        }
+
+        m_blocks.prefetch(heights[i], runEnd - i);
+        i = runEnd;
+      }
+
+      for (uint32_t height : heights) {
+        blocks.push_back(m_blocks[height].bl);
+      }
+
       return true;
     }
 
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     void getBlockchainTransactions(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) {
-      std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
+      ReadLock bcLock(*this, LOCK_SITE("blockchain"));
 
+      // (index, position among the found transactions)
+      std::vector<std::pair<TransactionIndex, size_t>> found;
       for (const auto& tx_id : txs_ids) {
         auto it = m_transactionMap.find(tx_id);
         if (it == m_transactionMap.end()) {
           missed_txs.push_back(tx_id);
         } else {
-          txs.push_back(transactionByIndex(it->second).tx);
+          found.emplace_back(it->second, found.size());
         }
       }
+
+      // visit them block by block so each block is loaded from storage once; the shared access
+      // taken by ReadLock keeps the loaded blocks alive until the copies below are done
+      std::sort(found.begin(), found.end(), [](const std::pair<TransactionIndex, size_t>& a, const std::pair<TransactionIndex, size_t>& b) {
+        return a.first.block < b.first.block;
+      });
+
+      std::vector<const Transaction*> ordered(found.size());
+      const BlockEntry* block = nullptr;
+      uint32_t blockIndex = 0;
+      for (const auto& entry : found) {
+        if (block == nullptr || entry.first.block != blockIndex) {
+          blockIndex = entry.first.block;
+          block = &m_blocks[blockIndex];
+        }
+
+        ordered[entry.second] = &block->transactions[entry.first.transaction].tx;
+      }
+
+      for (const Transaction* tx : ordered) {
+        txs.push_back(*tx);
+      }
     }
 
     template<class t_ids_container, class t_tx_container, class t_missed_container>
@@ -206,15 +311,47 @@ namespace CryptoNote {
 
   private:
 
+    // shared ownership of m_blockchain_lock for read-only paths; also keeps
+    // m_blocks cache entries alive while other readers run concurrently
+    class ReadLock {
+    public:
+      ReadLock(Blockchain& bc, const Common::LockSite& site) : m_bc(bc), m_sample(site, true) {
+        m_bc.m_blockchain_lock.lock_shared();
+        m_sample.acquired();
+        m_bc.m_blocks.beginSharedAccess();
+      }
+
+      ~ReadLock() {
+        m_bc.m_blocks.endSharedAccess();
+        m_sample.released();
+        m_bc.m_blockchain_lock.unlock_shared();
+      }
+
+      ReadLock(const ReadLock&) = delete;
+      ReadLock& operator=(const ReadLock&) = delete;
+
+    private:
+      Blockchain& m_bc;
+      Common::LockSample m_sample;
+    };
+
+    // carries everything validateInput and the multisignature lookups need, so a deposit
+    // withdrawal is checked without loading the block that holds the output
     struct MultisignatureOutputUsage {
       TransactionIndex transactionIndex;
       uint16_t outputIndex;
       bool isUsed;
+      Crypto::Hash transactionHash;
+      uint64_t unlockTime;
+      MultisignatureOutput output;
 
       void serialize(ISerializer& s) {
         s(transactionIndex, "txindex");
         s(outputIndex, "outindex");
         s(isUsed, "used");
+        s(transactionHash, "txhash");
+        s(unlockTime, "unlock_time");
+        s(output, "output");
       }
     };
 
@@ -248,19 +385,19 @@ namespace CryptoNote {
 
     typedef parallel_flat_hash_map<Crypto::KeyImage, uint32_t> key_images_container;
     typedef parallel_flat_hash_map<Crypto::Hash, BlockEntry> blocks_ext_by_hash;
-    typedef parallel_flat_hash_map<uint64_t, std::vector<std::pair<TransactionIndex, uint16_t>>> outputs_container; //Crypto::Hash - tx hash, size_t - index of out in transaction
     typedef parallel_flat_hash_map<uint64_t, std::vector<MultisignatureOutputUsage>> MultisignatureOutputsContainer;
 
     const Currency& m_currency;
     tx_memory_pool& m_tx_pool;
-    mutable std::recursive_mutex m_blockchain_lock; // TODO: add here reader/writer lock
+    mutable Common::RecursiveSharedMutex m_blockchain_lock;
     Crypto::cn_context m_cn_context;
     Tools::ObserverManager<IBlockchainStorageObserver> m_observerManager;
 
     key_images_container m_spent_keys;
+    KeyImageFilter m_spentKeyFilter;
     size_t m_current_block_cumul_sz_limit;
     blocks_ext_by_hash m_alternative_chains; // Crypto::Hash -> block_extended_info
-    outputs_container m_outputs;
+    OutputIndex m_outputs;
 
     std::string m_config_folder;
     Checkpoints m_checkpoints;
@@ -269,34 +406,61 @@ namespace CryptoNote {
     typedef SwappedVector<BlockEntry> Blocks;
     typedef parallel_flat_hash_map<Crypto::Hash, uint32_t> BlockMap;
     typedef parallel_flat_hash_map<Crypto::Hash, TransactionIndex> TransactionMap;
-    typedef BasicUpgradeDetector<Blocks> UpgradeDetector;
+    typedef MultiUpgradeDetector<BlockHeaderIndex> UpgradeDetector;
 
     friend class BlockCacheSerializer;
     friend class BlockchainIndicesSerializer;
 
     Blocks m_blocks;
+    uint64_t m_blockCacheSize;
+    uint32_t m_blockStoreChunk;
+    // fixed size header fields of m_blocks, pushed and popped together with it
+    BlockHeaderIndex m_headerIndex;
     CryptoNote::BlockIndex m_blockIndex;
     CryptoNote::DepositIndex m_depositIndex;
+    BlockchainJournal m_journal;
     TransactionMap m_transactionMap;
     MultisignatureOutputsContainer m_multisignatureOutputs;
-    UpgradeDetector m_upgradeDetectorV2;
-    UpgradeDetector m_upgradeDetectorV3;
-    UpgradeDetector m_upgradeDetectorV4;
-    UpgradeDetector m_upgradeDetectorV5;
-    UpgradeDetector m_upgradeDetectorV6;
-    UpgradeDetector m_upgradeDetectorV7;
-    UpgradeDetector m_upgradeDetectorV8;
-    UpgradeDetector m_upgradeDetectorV9;
-
-
-    bool m_blockchainIndexesEnabled;
+    UpgradeDetector m_upgradeDetector;
+
+
+    uint32_t m_blockchainIndexes;
+    // the enabled indices that are in step with the main chain and kept so on pushes and pops;
+    // the others are being backfilled, up to m_backfillHeight, whose last block is m_backfillTail
+    uint32_t m_readyIndexes;
+    uint32_t m_backfillHeight;
+    Crypto::Hash m_backfillTail;
+    std::thread m_indexBackfill;
+    std::atomic<bool> m_stopIndexBackfill;
+    std::array<uint64_t, BLOCKCHAIN_INDEX_COUNT> m_indexStoredBytes;
     bool m_blockchainAutosaveEnabled;
     PaymentIdIndex m_paymentIdIndex;
+    KeyImageIndex m_keyImageIndex;
     TimestampBlocksIndex m_timestampIndex;
     GeneratedTransactionsIndex m_generatedTransactionsIndex;
     OrphanBlocksIndex m_orthanBlocksIndex;
+    TransactionSummaryIndex m_transactionSummaryIndex;
 
     IntrusiveLinkedList<MessageQueue<BlockchainMessage>> m_messageQueueList;
+    // messages raised under m_blockchain_lock, handed to the queues by publishMessages once it is released
+    std::vector<BlockchainMessage> m_pendingMessages;
+
+    std::unique_ptr<Common::ThreadPool> m_signatureVerifier; // created on first use
+    std::once_flag m_signatureVerifierCreated;
+
+    std::mutex m_verifiedRingSignaturesLock;
+    std::unordered_set<Crypto::Hash> m_verifiedRingSignatures;
+    std::deque<Crypto::Hash> m_verifiedRingSignaturesOrder;
+
+    // proof of work hashes computed ahead, keyed by the hash of the data they were computed over
+    std::mutex m_proofOfWorkCacheLock;
+    std::unordered_map<Crypto::Hash, Crypto::Hash> m_proofOfWorkCache;
+    std::deque<Crypto::Hash> m_proofOfWorkCacheOrder;
+
+    // timestamps and cumulative difficulties at the tip, kept in step with pushes and pops and
+    // extended backwards from m_blocks on demand
+    std::mutex m_difficultyWindowLock;
+    DifficultyWindow m_difficultyWindow;
 
     Logging::LoggerRef logger;
 
@@ -304,14 +468,38 @@ namespace CryptoNote {
     bool switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator> &alt_chain, bool discard_disconnected_chain);
     bool handle_alternative_block(const Block &b, const Crypto::Hash &id, block_verification_context &bvc, bool sendNewAlternativeBlockMessage = true);
     difficulty_type get_next_difficulty_for_alternative_chain(const std::list<blocks_ext_by_hash::iterator> &alt_chain, BlockEntry &bei);
+    bool indexReady(uint32_t index) const { return (m_readyIndexes & index) != 0; }
+    void addToIndexes(uint32_t indexes, const BlockEntry& block);
+    void addTransactionSummaries(const BlockEntry& block, const Crypto::Hash& minerTransactionHash);
+    void clearIndexes(uint32_t indexes);
+    void backfillIndexes();
     void pushToDepositIndex(const BlockEntry &block, uint64_t interest);
+    void pushToHeaderIndex(const BlockEntry& block);
+    void syncHeaderIndex();
+    void syncDepositIndex(uint32_t height);
+    uint64_t blockInterest(const BlockEntry& block, uint32_t height) const;
+    void pushToDifficultyWindow(const BlockEntry& block);
+    void popFromDifficultyWindow();
+    bool fillDifficultyWindow(uint32_t beginHeight);
+    static int64_t blockDepositAmount(const BlockEntry& block);
+
+    struct ChainVerification;
+    void verifyChainSlices(ChainVerification& verification);
+    void verifyChainBlock(ChainVerification& verification, uint32_t height, const BlockEntry& block, Crypto::cn_context& context);
+
+    struct CacheShard;
+    void collectCacheShard(CacheShard& shard);
+    void collectCacheBlock(CacheShard& shard, uint32_t height, const BlockEntry& block, const CachedBlock& cachedBlock);
+    void mergeCacheShard(const CacheShard& shard);
+    uint32_t replayJournal(uint32_t cacheHeight, bool& clean);
+    void rebuildSpentKeyFilter();
     bool prevalidate_miner_transaction(const Block &b, uint32_t height);
     bool validate_miner_transaction(const Block &b, uint32_t height, size_t cumulativeBlockSize, uint64_t alreadyGeneratedCoins, uint64_t fee, uint64_t &reward, int64_t &emissionChange);
-    bool rollback_blockchain_switching(std::list<Block> &original_chain, size_t rollback_height);
+    bool rollback_blockchain_switching(const std::vector<BlockEntry> &original_chain, uint32_t rollback_height);
     bool get_last_n_blocks_sizes(std::vector<size_t> &sz, size_t count);
-    bool add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>> &amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount &result_outs, uint64_t amount, size_t i);
+    bool add_out_to_get_random_outs(const OutputIndex::Outputs &amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount &result_outs, uint64_t amount, size_t i);
     bool is_tx_spendtime_unlocked(uint64_t unlock_time);
-    size_t find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>> &amount_outs);
+    size_t find_end_of_allowed_index(const OutputIndex::Outputs &amount_outs);
     bool check_block_timestamp_main(const Block &b);
     bool check_block_timestamp(std::vector<uint64_t> timestamps, const Block &b);
     uint64_t get_adjusted_time();
@@ -322,39 +510,79 @@ namespace CryptoNote {
     std::vector<Crypto::Hash> doBuildSparseChain(const Crypto::Hash& startBlockId) const;
     bool getBlockCumulativeSize(const Block& block, size_t& cumulativeSize);
     bool update_next_comulative_size_limit();
-    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL);
+    // ring signature verification postponed by pushBlock so the whole block can be checked in parallel
+    struct RingSignatureCheck {
+      Crypto::Hash prefixHash;
+      Crypto::KeyImage keyImage;
+      std::vector<Crypto::PublicKey> outputKeys;
+      const Crypto::Signature* signatures;
+      Crypto::Hash verifiedKey; // see rememberRingSignature()
+    };
+
+    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL, std::vector<RingSignatureCheck>* deferredChecks = NULL);
+    bool checkTransactionInputs(const CachedTransaction& tx, uint32_t* pmax_used_block_height = NULL, std::vector<RingSignatureCheck>* deferredChecks = NULL);
+    bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL, std::vector<RingSignatureCheck>* deferredChecks = NULL);
+    bool checkRingSignatures(const std::vector<RingSignatureCheck>& checks, block_verification_context& bvc);
+    static bool checkRingSignature(const RingSignatureCheck& check);
+    // Ring signatures that passed while admitting transactions to the pool, so the block that
+    // confirms them does not verify them again. Keyed by everything the check covers: prefix
+    // hash, key image, the output keys the ring resolved to and the signatures themselves.
+    bool isRingSignatureVerified(const Crypto::Hash& key);
+    void rememberRingSignature(const Crypto::Hash& key);
+    Common::ThreadPool& signatureVerifier();
+    bool checkProofOfWork(const Block& block, difficulty_type currentDifficulty, Crypto::Hash& proofOfWork);
     bool check_tx_outputs(const Transaction& tx, uint32_t height) const;
     const TransactionEntry& transactionByIndex(TransactionIndex index);
-    bool pushBlock(const Block &blockData, const Crypto::Hash &id, block_verification_context &bvc, uint32_t height);
-    bool pushBlock(const Block &blockData, const std::vector<Transaction> &transactions, const Crypto::Hash &id, block_verification_context &bvc);
-    bool pushBlock(BlockEntry &block);
-    void popBlock(const Crypto::Hash &blockHash);
+    bool pushBlock(const CachedBlock &cachedBlock, block_verification_context &bvc, uint32_t height);
+    bool pushBlock(const CachedBlock &cachedBlock, const std::vector<Transaction> &transactions, block_verification_context &bvc);
+    bool pushBlock(BlockEntry &block, const CachedBlock &cachedBlock);
+    bool pushCheckpointedBlock(const Block &blockData, const std::vector<BinaryArray> &transactions, block_verification_context &bvc);
+    // takes the tip off the chain and its indexes, the caller decides what becomes of its transactions
+    void popBlock();
     bool pushTransaction(BlockEntry &block, const Crypto::Hash &transactionHash, TransactionIndex transactionIndex);
     void popTransaction(const Transaction &transaction, const Crypto::Hash &transactionHash);
     void popTransactions(const BlockEntry &block, const Crypto::Hash &minerTransactionHash);
     bool validateInput(const MultisignatureInput &input, const Crypto::Hash &transactionHash, const Crypto::Hash &transactionPrefixHash, const std::vector<Crypto::Signature> &transactionSignatures);
     bool removeLastBlock();
     bool checkCheckpoints(uint32_t &lastValidCheckpointHeight);
-    bool checkUpgradeHeight(const UpgradeDetector& upgradeDetector);
+    bool checkUpgradeHeight(uint8_t version);
 
     bool storeBlockchainIndices();
+    bool openBlockStore(const std::string& config_folder);
     bool loadBlockchainIndices();
 
     bool loadTransactions(const Block& block, std::vector<Transaction>& transactions, uint32_t height);
     void saveTransactions(const std::vector<Transaction>& transactions, uint32_t height);
 
     void sendMessage(const BlockchainMessage& message);
+    void publishMessages();
 
     friend class LockedBlockchainStorage;
+    friend class SharedLockedBlockchainStorage;
   };
 
   class LockedBlockchainStorage: boost::noncopyable {
   public:
 
-    LockedBlockchainStorage(Blockchain& bc)
-      : m_bc(bc), m_lock(bc.m_blockchain_lock) {}
+    LockedBlockchainStorage(Blockchain& bc, const Common::LockSite& site)
+      : m_bc(bc), m_lock(bc.m_blockchain_lock, site) {}
+
+    Blockchain* operator -> () {
+      return &m_bc;
+    }
+
+  private:
+
+    Blockchain& m_bc;
+    Common::ProfiledLockGuard<Common::RecursiveSharedMutex> m_lock;
+  };
+
+  // read-only counterpart of LockedBlockchainStorage; only non-modifying calls are allowed through it
+  class SharedLockedBlockchainStorage: boost::noncopyable {
+  public:
+
+    SharedLockedBlockchainStorage(Blockchain& bc, const Common::LockSite& site)
+      : m_bc(bc), m_lock(bc, site) {}
 
     Blockchain* operator -> () {
       return &m_bc;
@@ -363,17 +591,16 @@ namespace CryptoNote {
   private:
 
     Blockchain& m_bc;
-    std::lock_guard<std::recursive_mutex> m_lock;
+    Blockchain::ReadLock m_lock;
   };
 
   template<class visitor_t> bool Blockchain::scanOutputKeysForIndexes(const KeyInput& tx_in_to_key, visitor_t& vis, uint32_t* pmax_related_block_height) {
-    std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
-    auto it = m_outputs.find(tx_in_to_key.amount);
-    if (it == m_outputs.end() || !tx_in_to_key.outputIndexes.size())
+    ReadLock lk(*this, LOCK_SITE("blockchain"));
+    OutputIndex::Outputs amount_outs_vec = m_outputs.find(tx_in_to_key.amount);
+    if (amount_outs_vec.empty() || !tx_in_to_key.outputIndexes.size())
       return false;
 
     std::vector<uint32_t> absolute_offsets = relative_output_offsets_to_absolute(tx_in_to_key.outputIndexes);
-    std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs_vec = it->second;
     size_t count = 0;
     for (uint64_t i : absolute_offsets) {
       if(i >= amount_outs_vec.size() ) {
@@ -384,24 +611,26 @@ namespace CryptoNote {
       //auto tx_it = m_transactionMap.find(amount_outs_vec[i].first);
       //if (!(tx_it != m_transactionMap.end())) { logger(ERROR, BRIGHT_RED) << "Wrong transaction id in output indexes: " << Common::podToHex(amount_outs_vec[i].first); return false; }
 
-      const TransactionEntry& tx = transactionByIndex(amount_outs_vec[i].first);
+      TransactionIndex transactionIndex = { amount_outs_vec.block(i), amount_outs_vec.transaction(i) };
+      const TransactionEntry& tx = transactionByIndex(transactionIndex);
+      uint16_t outputIndex = amount_outs_vec.output(i);
 
-      if (!(amount_outs_vec[i].second < tx.tx.outputs.size())) {
+      if (!(outputIndex < tx.tx.outputs.size())) {
         logger(Logging::ERROR, Logging::BRIGHT_RED)
             << "Wrong index in transaction outputs: "
-            << amount_outs_vec[i].second << ", expected less then "
+            << outputIndex << ", expected less then "
             << tx.tx.outputs.size();
         return false;
       }
 
-      if (!vis.handle_output(tx.tx, tx.tx.outputs[amount_outs_vec[i].second], amount_outs_vec[i].second)) {
+      if (!vis.handle_output(tx.tx, tx.tx.outputs[outputIndex], outputIndex)) {
         logger(Logging::INFO) << "Failed to handle_output for output no = " << count << ", with absolute offset " << i;
         return false;
       }
 
       if(count++ == absolute_offsets.size()-1 && pmax_related_block_height) {
-        if (*pmax_related_block_height < amount_outs_vec[i].first.block) {
-          *pmax_related_block_height = amount_outs_vec[i].first.block;
+        if (*pmax_related_block_height < transactionIndex.block) {
+          *pmax_related_block_height = transactionIndex.block;
         }
       }
     }
@@ -25,6 +25,50 @@
 
 namespace CryptoNote {
 
+namespace {
+
+const char* const INDEX_NAMES[BLOCKCHAIN_INDEX_COUNT] = { "payment-id", "key-image", "timestamp", "generated-transactions", "orphan-blocks", "transaction-summaries" };
+
+// the element, the node links and the cached hash, plus the bucket array
+template<class Map>
+uint64_t unorderedMemory(const Map& map) {
+  return map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*)) + map.bucket_count() * sizeof(void*);
+}
+
+// the element, three links and the colour, padded
+template<class Map>
+uint64_t treeMemory(const Map& map) {
+  return map.size() * (sizeof(typename Map::value_type) + 4 * sizeof(void*));
+}
+
+// one control byte per slot
+template<class Map>
+uint64_t flatMemory(const Map& map) {
+  return map.bucket_count() * (sizeof(typename Map::value_type) + 1);
+}
+
+}
+
+const char* blockchainIndexName(uint32_t index) {
+  for (size_t i = 0; i < BLOCKCHAIN_INDEX_COUNT; ++i) {
+    if (index == 1u << i) {
+      return INDEX_NAMES[i];
+    }
+  }
+
+  return "unknown";
+}
+
+uint32_t blockchainIndexByName(const std::string& name) {
+  for (size_t i = 0; i < BLOCKCHAIN_INDEX_COUNT; ++i) {
+    if (name == INDEX_NAMES[i]) {
+      return 1u << i;
+    }
+  }
+
+  return 0;
+}
+
 bool PaymentIdIndex::add(const Transaction& transaction) {
   Crypto::Hash paymentId;
   Crypto::Hash transactionHash = getObjectHash(transaction);
@@ -69,11 +113,60 @@ void PaymentIdIndex::clear() {
   index.clear();
 }
 
+uint64_t PaymentIdIndex::memoryUsage() const {
+  return unorderedMemory(index);
+}
+
 
 void PaymentIdIndex::serialize(ISerializer& s) {
   s(index, "index");
 }
 
+bool KeyImageIndex::add(const Transaction& transaction, const Crypto::Hash& transactionHash) {
+  bool added = false;
+  for (const auto& input : transaction.inputs) {
+    if (input.type() == typeid(KeyInput)) {
+      index.emplace(boost::get<KeyInput>(input).keyImage, transactionHash);
+      added = true;
+    }
+  }
+
+  return added;
+}
+
+bool KeyImageIndex::remove(const Transaction& transaction) {
+  bool removed = false;
+  for (const auto& input : transaction.inputs) {
+    if (input.type() == typeid(KeyInput)) {
+      removed |= index.erase(boost::get<KeyInput>(input).keyImage) != 0;
+    }
+  }
+
+  return removed;
+}
+
+bool KeyImageIndex::find(const Crypto::KeyImage& keyImage, Crypto::Hash& transactionHash) {
+  auto iter = index.find(keyImage);
+  if (iter == index.end()) {
+    return false;
+  }
+
+  transactionHash = iter->second;
+  return true;
+}
+
+void KeyImageIndex::clear() {
+  index.clear();
+}
+
+uint64_t KeyImageIndex::memoryUsage() const {
+  return flatMemory(index);
+}
+
+void KeyImageIndex::serialize(ISerializer& s) {
+  s(index, "index");
+}
+
 bool TimestampBlocksIndex::add(uint64_t timestamp, const Crypto::Hash& hash) {
   index.emplace(timestamp, hash);
   return true;
@@ -113,6 +206,10 @@ void TimestampBlocksIndex::clear() {
   index.clear();
 }
 
+uint64_t TimestampBlocksIndex::memoryUsage() const {
+  return treeMemory(index);
+}
+
 void TimestampBlocksIndex::serialize(ISerializer& s) {
   s(index, "index");
 }
@@ -159,6 +256,10 @@ void TimestampTransactionsIndex::clear() {
   index.clear();
 }
 
+uint64_t TimestampTransactionsIndex::memoryUsage() const {
+  return treeMemory(index);
+}
+
 void TimestampTransactionsIndex::serialize(ISerializer& s) {
   s(index, "index");
 }
@@ -217,6 +318,11 @@ bool GeneratedTransactionsIndex::find(uint32_t height, uint64_t& generatedTransa
 
 void GeneratedTransactionsIndex::clear() {
   index.clear();
+  lastGeneratedTxNumber = 0;
+}
+
+uint64_t GeneratedTransactionsIndex::memoryUsage() const {
+  return flatMemory(index);
 }
 
 void GeneratedTransactionsIndex::serialize(ISerializer& s) {
@@ -262,4 +368,81 @@ void OrphanBlocksIndex::clear() {
   index.clear();
 }
 
+uint64_t OrphanBlocksIndex::memoryUsage() const {
+  return unorderedMemory(index);
+}
+
+void TransactionSummaryReference::serialize(ISerializer& s) {
+  s(transactionHash, "hash");
+  s(number, "number");
+}
+
+void TransactionSummary::serialize(ISerializer& s) {
+  s(blockHeight, "height");
+  s(timestamp, "timestamp");
+  s(totalInputsAmount, "inputs_amount");
+  s(fee, "fee");
+  s(inputs, "inputs");
+}
+
+bool TransactionSummaryIndex::add(const Crypto::Hash& transactionHash, TransactionSummary&& summary) {
+  size_t inputs = summary.inputs.size();
+  if (!index.emplace(transactionHash, std::move(summary)).second) {
+    return false;
+  }
+
+  inputCount += inputs;
+  return true;
+}
+
+bool TransactionSummaryIndex::remove(const Block& block, const Crypto::Hash& minerTransactionHash) {
+  bool removed = remove(minerTransactionHash);
+  for (const Crypto::Hash& transactionHash : block.transactionHashes) {
+    removed &= remove(transactionHash);
+  }
+
+  return removed;
+}
+
+bool TransactionSummaryIndex::remove(const Crypto::Hash& transactionHash) {
+  auto iter = index.find(transactionHash);
+  if (iter == index.end()) {
+    return false;
+  }
+
+  inputCount -= iter->second.inputs.size();
+  index.erase(iter);
+  return true;
+}
+
+bool TransactionSummaryIndex::find(const Crypto::Hash& transactionHash, TransactionSummary& summary) {
+  auto iter = index.find(transactionHash);
+  if (iter == index.end()) {
+    return false;
+  }
+
+  summary = iter->second;
+  return true;
+}
+
+void TransactionSummaryIndex::clear() {
+  index.clear();
+  inputCount = 0;
+}
+
+uint64_t TransactionSummaryIndex::memoryUsage() const {
+  return flatMemory(index) + inputCount * sizeof(TransactionSummaryReference);
+}
+
+void TransactionSummaryIndex::serialize(ISerializer& s) {
+  s(index, "index");
+
+  if (s.type() == ISerializer::INPUT) {
+    inputCount = 0;
+    for (const auto& entry : index) {
+      inputCount += entry.second.inputs.size();
+    }
+  }
+}
+
 }
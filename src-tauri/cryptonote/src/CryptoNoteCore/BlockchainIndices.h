@@ -21,6 +21,7 @@
 #include <unordered_map>
 #include <map>
 #include <parallel_hashmap/phmap.h>
+#include "crypto/crypto.h"
 #include "crypto/hash.h"
 #include "CryptoNoteBasic.h"
 using phmap::flat_hash_map;
@@ -28,6 +29,29 @@ namespace CryptoNote {
 
 class ISerializer;
 
+// The explorer indices a Blockchain can keep, each enabled on its own
+const uint32_t BLOCKCHAIN_INDEX_PAYMENT_ID = 1 << 0;
+const uint32_t BLOCKCHAIN_INDEX_KEY_IMAGE = 1 << 1;
+const uint32_t BLOCKCHAIN_INDEX_TIMESTAMP = 1 << 2;
+const uint32_t BLOCKCHAIN_INDEX_GENERATED_TRANSACTIONS = 1 << 3;
+const uint32_t BLOCKCHAIN_INDEX_ORPHAN_BLOCKS = 1 << 4;
+const uint32_t BLOCKCHAIN_INDEX_TRANSACTION_SUMMARIES = 1 << 5;
+const size_t BLOCKCHAIN_INDEX_COUNT = 6;
+const uint32_t BLOCKCHAIN_INDEX_ALL = (1 << BLOCKCHAIN_INDEX_COUNT) - 1;
+
+// "payment-id", "key-image", "timestamp", "generated-transactions", "orphan-blocks" and "transaction-summaries"
+const char* blockchainIndexName(uint32_t index);
+// 0 for an unknown name
+uint32_t blockchainIndexByName(const std::string& name);
+
+struct BlockchainIndexUsage {
+  uint32_t index;
+  bool ready;            // false while the index is being built for an existing chain
+  uint64_t entries;
+  uint64_t memoryBytes;  // estimated from the container sizes
+  uint64_t storedBytes;  // in the indices file when it was last stored or loaded
+};
+
 class PaymentIdIndex {
 public:
   PaymentIdIndex() = default;
@@ -36,6 +60,8 @@ public:
   bool remove(const Transaction& transaction);
   bool find(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes);
   void clear();
+  size_t size() const { return index.size(); }
+  uint64_t memoryUsage() const;
 
   void serialize(ISerializer& s);
 
@@ -47,6 +73,28 @@ private:
   std::unordered_multimap<Crypto::Hash, Crypto::Hash> index;
 };
 
+// Spending transaction of every key image. Blockchain::m_spent_keys only keeps the height.
+class KeyImageIndex {
+public:
+  KeyImageIndex() = default;
+
+  bool add(const Transaction& transaction, const Crypto::Hash& transactionHash);
+  bool remove(const Transaction& transaction);
+  bool find(const Crypto::KeyImage& keyImage, Crypto::Hash& transactionHash);
+  void clear();
+  size_t size() const { return index.size(); }
+  uint64_t memoryUsage() const;
+
+  void serialize(ISerializer& s);
+
+  template<class Archive>
+  void serialize(Archive& archive, unsigned int version) {
+    archive & index;
+  }
+private:
+  flat_hash_map<Crypto::KeyImage, Crypto::Hash> index;
+};
+
 class TimestampBlocksIndex {
 public:
   TimestampBlocksIndex() = default;
@@ -55,6 +103,8 @@ public:
   bool remove(uint64_t timestamp, const Crypto::Hash& hash);
   bool find(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t hashesNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& hashesNumberWithinTimestamps);
   void clear();
+  size_t size() const { return index.size(); }
+  uint64_t memoryUsage() const;
 
   void serialize(ISerializer& s);
 
@@ -74,6 +124,8 @@ public:
   bool remove(uint64_t timestamp, const Crypto::Hash& hash);
   bool find(uint64_t timestampBegin, uint64_t timestampEnd, uint64_t hashesNumberLimit, std::vector<Crypto::Hash>& hashes, uint64_t& hashesNumberWithinTimestamps);
   void clear();
+  size_t size() const { return index.size(); }
+  uint64_t memoryUsage() const;
 
   void serialize(ISerializer& s);
 
@@ -93,6 +145,8 @@ public:
   bool remove(const Block& block);
   bool find(uint32_t height, uint64_t& generatedTransactions);
   void clear();
+  size_t size() const { return index.size(); }
+  uint64_t memoryUsage() const;
 
   void serialize(ISerializer& s);
 
@@ -114,8 +168,53 @@ public:
   bool remove(const Block& block);
   bool find(uint32_t height, std::vector<Crypto::Hash>& blockHashes);
   void clear();
+  size_t size() const { return index.size(); }
+  uint64_t memoryUsage() const;
 private:
   std::unordered_multimap<uint32_t, Crypto::Hash> index;
 };
 
+// The output an input spends: the last ring member of a key input, the output of a multisignature input
+struct TransactionSummaryReference {
+  Crypto::Hash transactionHash;
+  uint16_t number;
+
+  void serialize(ISerializer& s);
+};
+
+// What BlockchainExplorerDataBuilder would otherwise look up in other blocks for every request
+struct TransactionSummary {
+  uint32_t blockHeight;
+  uint64_t timestamp;
+  uint64_t totalInputsAmount;
+  uint64_t fee;
+  std::vector<TransactionSummaryReference> inputs; // one per input, zero for a base input
+
+  void serialize(ISerializer& s);
+};
+
+class TransactionSummaryIndex {
+public:
+  TransactionSummaryIndex() : inputCount(0) {}
+
+  bool add(const Crypto::Hash& transactionHash, TransactionSummary&& summary);
+  bool remove(const Block& block, const Crypto::Hash& minerTransactionHash);
+  bool find(const Crypto::Hash& transactionHash, TransactionSummary& summary);
+  void clear();
+  size_t size() const { return index.size(); }
+  uint64_t memoryUsage() const;
+
+  void serialize(ISerializer& s);
+
+  template<class Archive>
+  void serialize(Archive& archive, unsigned int version) {
+    archive & index;
+  }
+private:
+  bool remove(const Crypto::Hash& transactionHash);
+
+  flat_hash_map<Crypto::Hash, TransactionSummary> index;
+  uint64_t inputCount;
+};
+
 }
@@ -0,0 +1,54 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#include "BlockchainJournal.h"
+
+#include "CryptoNoteSerialization.h"
+#include "CryptoNoteTools.h"
+
+namespace CryptoNote {
+
+void BlockchainJournalRecord::serialize(ISerializer& s) {
+  uint8_t recordType = static_cast<uint8_t>(type);
+  s(recordType, "type");
+  type = static_cast<BlockchainJournalRecordType>(recordType);
+  s(height, "height");
+  s(blockHash, "block");
+  s(delta, "delta");
+}
+
+void BlockchainJournal::append(const BlockchainJournalRecord& record) {
+  m_file.append(toBinaryArray(record));
+}
+
+bool BlockchainJournal::load(const std::string& path, std::vector<BlockchainJournalRecord>& records) {
+  std::vector<BinaryArray> data;
+  bool clean = JournalFile::load(path, data);
+  records.clear();
+  for (const BinaryArray& recordData : data) {
+    BlockchainJournalRecord record;
+    if (!fromBinaryArray(record, recordData)) {
+      return false;
+    }
+
+    records.push_back(std::move(record));
+  }
+
+  return clean;
+}
+
+}
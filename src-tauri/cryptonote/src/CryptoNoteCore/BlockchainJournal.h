@@ -0,0 +1,63 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CryptoNote.h"
+#include "CryptoNoteCore/JournalFile.h"
+#include "Serialization/ISerializer.h"
+
+namespace CryptoNote {
+
+enum class BlockchainJournalRecordType : uint8_t {
+  PUSH = 1,
+  POP = 2
+};
+
+struct BlockchainJournalRecord {
+  BlockchainJournalRecordType type;
+  uint32_t height;
+  Crypto::Hash blockHash;
+  BinaryArray delta;
+
+  void serialize(ISerializer& s);
+};
+
+// Log of the cache changes made since the block cache file was last written
+class BlockchainJournal {
+public:
+  bool open(const std::string& path) { return m_file.open(path); }
+  void close() { m_file.close(); }
+  bool isOpened() const { return m_file.isOpened(); }
+
+  void append(const BlockchainJournalRecord& record);
+  bool sync() { return m_file.sync(); }
+  // drops every record, called once the cache file covers them
+  bool reset() { return m_file.reset(); }
+
+  // returns false if the journal ends in a torn or corrupted record; the records before it are kept
+  static bool load(const std::string& path, std::vector<BlockchainJournalRecord>& records);
+
+private:
+  JournalFile m_file;
+};
+
+}
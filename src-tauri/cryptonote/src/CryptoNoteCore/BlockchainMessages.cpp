@@ -43,11 +43,11 @@ BlockchainMessage::BlockchainMessage(NewBlockMessage&& message) : type(MessageTy
 
 BlockchainMessage::BlockchainMessage(NewAlternativeBlockMessage&& message) : type(MessageType::NEW_ALTERNATIVE_BLOCK_MESSAGE), newAlternativeBlockMessage(std::move(message)) {}
 
-BlockchainMessage::BlockchainMessage(ChainSwitchMessage&& message) : type(MessageType::CHAIN_SWITCH_MESSAGE) {
-	chainSwitchMessage = new ChainSwitchMessage(std::move(message));
+BlockchainMessage::BlockchainMessage(ChainSwitchMessage&& message) : type(MessageType::CHAIN_SWITCH_MESSAGE),
+  chainSwitchMessage(std::make_shared<const ChainSwitchMessage>(std::move(message))) {
 }
 
-BlockchainMessage::BlockchainMessage(const BlockchainMessage& other) : type(other.type) {
+BlockchainMessage::BlockchainMessage(const BlockchainMessage& other) : type(other.type), chainSwitchMessage(other.chainSwitchMessage) {
   switch (type) {
     case MessageType::NEW_BLOCK_MESSAGE:
       new (&newBlockMessage) NewBlockMessage(other.newBlockMessage);
@@ -56,7 +56,6 @@ BlockchainMessage::BlockchainMessage(const BlockchainMessage& other) : type(othe
       new (&newAlternativeBlockMessage) NewAlternativeBlockMessage(other.newAlternativeBlockMessage);
       break;
     case MessageType::CHAIN_SWITCH_MESSAGE:
-	  chainSwitchMessage = new ChainSwitchMessage(*other.chainSwitchMessage);
       break;
   }
 }
@@ -70,7 +69,6 @@ BlockchainMessage::~BlockchainMessage() {
       newAlternativeBlockMessage.~NewAlternativeBlockMessage();
       break;
     case MessageType::CHAIN_SWITCH_MESSAGE:
-	  delete chainSwitchMessage;
       break;
   }
 }
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include <CryptoNote.h>
@@ -45,6 +46,7 @@ class ChainSwitchMessage {
 public:
   ChainSwitchMessage(std::vector<Crypto::Hash>&& hashes);
   ChainSwitchMessage(const ChainSwitchMessage& other);
+  ChainSwitchMessage(ChainSwitchMessage&& other) = default;
   void get(std::vector<Crypto::Hash>& hashes) const;
 private:
   std::vector<Crypto::Hash> blocksFromCommonRoot;
@@ -62,6 +64,7 @@ public:
   BlockchainMessage(NewAlternativeBlockMessage&& message);
   BlockchainMessage(ChainSwitchMessage&& message);
 
+  // copies share the chain switch hashes, which never change once the message is built
   BlockchainMessage(const BlockchainMessage& other);
 
   ~BlockchainMessage();
@@ -77,8 +80,9 @@ private:
   union {
     NewBlockMessage newBlockMessage;
     NewAlternativeBlockMessage newAlternativeBlockMessage;
-    ChainSwitchMessage* chainSwitchMessage;
   };
+
+  std::shared_ptr<const ChainSwitchMessage> chainSwitchMessage;
 };
 
 }
@@ -0,0 +1,354 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#include "BlockchainSnapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+#include <System/MemoryMappedFile.h>
+
+#include "Common/StringTools.h"
+#include "crypto/hash.h"
+
+using namespace Logging;
+
+namespace CryptoNote {
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = { 'F', 'U', 'E', 'G', 'O', 'S', 'N', 'P' };
+const size_t SNAPSHOT_HEADER_SIZE = sizeof(SNAPSHOT_MAGIC) + 4 + 4 + sizeof(Crypto::Hash) + 8 + sizeof(Crypto::Hash);
+const size_t CHUNK_HEADER_SIZE = 4 + 4 + 8 + sizeof(Crypto::Hash);
+const size_t BLOCKS_CHUNK_SIZE = 16 * 1024 * 1024;
+
+void appendUint32(BinaryArray& data, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void appendUint64(BinaryArray& data, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void appendHash(BinaryArray& data, const Crypto::Hash& hash) {
+  data.insert(data.end(), hash.data, hash.data + sizeof(hash.data));
+}
+
+uint32_t readUint32(const uint8_t* data) {
+  uint32_t value = 0;
+  for (int i = 3; i >= 0; --i) {
+    value = (value << 8) | data[i];
+  }
+  return value;
+}
+
+uint64_t readUint64(const uint8_t* data) {
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; --i) {
+    value = (value << 8) | data[i];
+  }
+  return value;
+}
+
+Crypto::Hash readHash(const uint8_t* data) {
+  Crypto::Hash hash;
+  memcpy(hash.data, data, sizeof(hash.data));
+  return hash;
+}
+
+struct SnapshotChunk {
+  BlockchainSnapshotSection section;
+  const uint8_t* data;
+  uint64_t size;
+};
+
+bool writeFile(const std::string& path, const uint8_t* data, uint64_t size) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(data), size);
+  file.flush();
+  return static_cast<bool>(file);
+}
+
+bool replaceFile(const std::string& from, const std::string& to) {
+  std::remove(to.c_str());
+  return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+}
+
+BlockchainSnapshotWriter::BlockchainSnapshotWriter(const std::string& path, const Crypto::Hash& genesisHash, uint64_t blockCount, const Crypto::Hash& tailHash, uint32_t flags) :
+  m_path(path),
+  m_temporaryPath(path + ".tmp"),
+  m_file(m_temporaryPath, std::ios::binary | std::ios::trunc),
+  m_blockCount(blockCount),
+  m_blocksAdded(0),
+  m_finished(false) {
+
+  if (!m_file) {
+    throw std::runtime_error("Can't create snapshot file " + m_temporaryPath);
+  }
+
+  BinaryArray header(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + sizeof(SNAPSHOT_MAGIC));
+  appendUint32(header, BLOCKCHAIN_SNAPSHOT_VERSION);
+  appendUint32(header, flags);
+  appendHash(header, genesisHash);
+  appendUint64(header, blockCount);
+  appendHash(header, tailHash);
+  m_file.write(reinterpret_cast<const char*>(header.data()), header.size());
+  m_pendingBlocks.reserve(BLOCKS_CHUNK_SIZE);
+}
+
+BlockchainSnapshotWriter::~BlockchainSnapshotWriter() {
+  if (!m_finished) {
+    m_file.close();
+    std::remove(m_temporaryPath.c_str());
+  }
+}
+
+void BlockchainSnapshotWriter::addBlock(const uint8_t* data, uint64_t size) {
+  if (size > UINT32_MAX) {
+    throw std::runtime_error("Block entry too large for a snapshot");
+  }
+
+  if (!m_pendingBlocks.empty() && m_pendingBlocks.size() + 4 + size > BLOCKS_CHUNK_SIZE) {
+    flushBlocks();
+  }
+
+  appendUint32(m_pendingBlocks, static_cast<uint32_t>(size));
+  m_pendingBlocks.insert(m_pendingBlocks.end(), data, data + size);
+  ++m_blocksAdded;
+}
+
+void BlockchainSnapshotWriter::addSection(BlockchainSnapshotSection section, const BinaryArray& data) {
+  flushBlocks();
+  writeChunk(section, data.data(), data.size());
+}
+
+void BlockchainSnapshotWriter::finish() {
+  flushBlocks();
+  if (m_blocksAdded != m_blockCount) {
+    throw std::runtime_error("Snapshot announced " + std::to_string(m_blockCount) + " blocks but got " + std::to_string(m_blocksAdded));
+  }
+
+  Crypto::Hash manifest = Crypto::cn_fast_hash(m_checksums.data(), m_checksums.size());
+  writeChunk(BlockchainSnapshotSection::END, reinterpret_cast<const uint8_t*>(manifest.data), sizeof(manifest.data));
+
+  m_file.flush();
+  if (!m_file) {
+    throw std::runtime_error("Failed to write snapshot file " + m_temporaryPath);
+  }
+
+  m_file.close();
+  if (!replaceFile(m_temporaryPath, m_path)) {
+    throw std::runtime_error("Failed to move snapshot into place at " + m_path);
+  }
+
+  m_finished = true;
+}
+
+void BlockchainSnapshotWriter::flushBlocks() {
+  if (m_pendingBlocks.empty()) {
+    return;
+  }
+
+  writeChunk(BlockchainSnapshotSection::BLOCKS, m_pendingBlocks.data(), m_pendingBlocks.size());
+  m_pendingBlocks.clear();
+}
+
+void BlockchainSnapshotWriter::writeChunk(BlockchainSnapshotSection section, const uint8_t* data, uint64_t size) {
+  Crypto::Hash checksum = Crypto::cn_fast_hash(data, size);
+  appendHash(m_checksums, checksum);
+
+  BinaryArray header;
+  appendUint32(header, static_cast<uint32_t>(section));
+  appendUint32(header, 0);
+  appendUint64(header, size);
+  appendHash(header, checksum);
+  m_file.write(reinterpret_cast<const char*>(header.data()), header.size());
+  m_file.write(reinterpret_cast<const char*>(data), size);
+  if (!m_file) {
+    throw std::runtime_error("Failed to write snapshot file " + m_temporaryPath);
+  }
+}
+
+bool importBlockchainSnapshot(const std::string& path, const Crypto::Hash& genesisHash, const BlockchainSnapshotFiles& files, ILogger& log) {
+  LoggerRef logger(log, "BlockchainSnapshot");
+
+  System::MemoryMappedFile snapshot;
+  std::error_code ec;
+  snapshot.open(path, ec);
+  if (ec) {
+    logger(ERROR, BRIGHT_RED) << "Can't open snapshot " << path << ": " << ec.message();
+    return false;
+  }
+
+  const uint8_t* data = snapshot.data();
+  uint64_t size = snapshot.size();
+  if (size < SNAPSHOT_HEADER_SIZE || memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+    logger(ERROR, BRIGHT_RED) << path << " is not a blockchain snapshot";
+    return false;
+  }
+
+  const uint8_t* header = data + sizeof(SNAPSHOT_MAGIC);
+  uint32_t version = readUint32(header);
+  uint64_t blockCount = readUint64(header + 8 + sizeof(Crypto::Hash));
+  Crypto::Hash tailHash = readHash(header + 16 + sizeof(Crypto::Hash));
+  if (version != BLOCKCHAIN_SNAPSHOT_VERSION) {
+    logger(ERROR, BRIGHT_RED) << "Unsupported snapshot version " << version;
+    return false;
+  }
+
+  if (readHash(header + 8) != genesisHash) {
+    logger(ERROR, BRIGHT_RED) << "Snapshot " << path << " belongs to another network";
+    return false;
+  }
+
+  // walk and verify every chunk before anything is written
+  std::vector<SnapshotChunk> chunks;
+  BinaryArray checksums;
+  uint64_t position = SNAPSHOT_HEADER_SIZE;
+  bool ended = false;
+  while (!ended) {
+    if (size - position < CHUNK_HEADER_SIZE) {
+      logger(ERROR, BRIGHT_RED) << "Snapshot " << path << " is truncated";
+      return false;
+    }
+
+    SnapshotChunk chunk;
+    chunk.section = static_cast<BlockchainSnapshotSection>(readUint32(data + position));
+    chunk.size = readUint64(data + position + 8);
+    Crypto::Hash checksum = readHash(data + position + 16);
+    chunk.data = data + position + CHUNK_HEADER_SIZE;
+    position += CHUNK_HEADER_SIZE;
+    if (size - position < chunk.size) {
+      logger(ERROR, BRIGHT_RED) << "Snapshot " << path << " is truncated";
+      return false;
+    }
+
+    if (Crypto::cn_fast_hash(chunk.data, chunk.size) != checksum) {
+      logger(ERROR, BRIGHT_RED) << "Snapshot chunk at offset " << position - CHUNK_HEADER_SIZE << " is corrupted";
+      return false;
+    }
+
+    if (chunk.section == BlockchainSnapshotSection::END) {
+      Crypto::Hash manifest = Crypto::cn_fast_hash(checksums.data(), checksums.size());
+      if (chunk.size != sizeof(manifest.data) || memcmp(chunk.data, manifest.data, sizeof(manifest.data)) != 0) {
+        logger(ERROR, BRIGHT_RED) << "Snapshot " << path << " has missing or reordered chunks";
+        return false;
+      }
+      ended = true;
+    } else {
+      appendHash(checksums, checksum);
+      chunks.push_back(chunk);
+    }
+
+    position += chunk.size;
+  }
+
+  std::vector<uint32_t> blockSizes;
+  blockSizes.reserve(blockCount);
+  const SnapshotChunk* cache = nullptr;
+  const SnapshotChunk* indices = nullptr;
+  for (const SnapshotChunk& chunk : chunks) {
+    if (chunk.section == BlockchainSnapshotSection::BLOCKS) {
+      uint64_t offset = 0;
+      while (offset < chunk.size) {
+        if (chunk.size - offset < 4 || chunk.size - offset - 4 < readUint32(chunk.data + offset)) {
+          logger(ERROR, BRIGHT_RED) << "Snapshot has a malformed blocks chunk";
+          return false;
+        }
+
+        uint32_t blockSize = readUint32(chunk.data + offset);
+        blockSizes.push_back(blockSize);
+        offset += 4 + blockSize;
+      }
+    } else if (chunk.section == BlockchainSnapshotSection::CACHE) {
+      cache = &chunk;
+    } else if (chunk.section == BlockchainSnapshotSection::INDICES) {
+      indices = &chunk;
+    }
+  }
+
+  if (blockSizes.size() != blockCount || blockCount == 0 || cache == nullptr) {
+    logger(ERROR, BRIGHT_RED) << "Snapshot " << path << " is incomplete";
+    return false;
+  }
+
+  logger(INFO, BRIGHT_WHITE) << "Snapshot verified: " << blockCount << " blocks, tail " << Common::podToHex(tailHash) << ", writing storage files...";
+
+  const std::string suffix = ".import";
+  {
+    std::ofstream blocksFile(files.blocks + suffix, std::ios::binary | std::ios::trunc);
+    for (const SnapshotChunk& chunk : chunks) {
+      if (chunk.section != BlockchainSnapshotSection::BLOCKS) {
+        continue;
+      }
+
+      uint64_t offset = 0;
+      while (offset < chunk.size) {
+        uint32_t blockSize = readUint32(chunk.data + offset);
+        blocksFile.write(reinterpret_cast<const char*>(chunk.data + offset + 4), blockSize);
+        offset += 4 + blockSize;
+      }
+    }
+
+    // same layout SwappedVector keeps its index in: item count, then every item's size
+    std::ofstream indexesFile(files.blockIndexes + suffix, std::ios::binary | std::ios::trunc);
+    indexesFile.write(reinterpret_cast<const char*>(&blockCount), sizeof(blockCount));
+    indexesFile.write(reinterpret_cast<const char*>(blockSizes.data()), blockSizes.size() * sizeof(uint32_t));
+
+    blocksFile.flush();
+    indexesFile.flush();
+    if (!blocksFile || !indexesFile) {
+      logger(ERROR, BRIGHT_RED) << "Failed to write blocks from snapshot";
+      std::remove((files.blocks + suffix).c_str());
+      std::remove((files.blockIndexes + suffix).c_str());
+      return false;
+    }
+  }
+
+  if (!writeFile(files.cache + suffix, cache->data, cache->size) ||
+      (indices != nullptr && !writeFile(files.indices + suffix, indices->data, indices->size))) {
+    logger(ERROR, BRIGHT_RED) << "Failed to write caches from snapshot";
+    std::remove((files.blocks + suffix).c_str());
+    std::remove((files.blockIndexes + suffix).c_str());
+    std::remove((files.cache + suffix).c_str());
+    std::remove((files.indices + suffix).c_str());
+    return false;
+  }
+
+  // the index goes last: without it the other files are ignored
+  bool moved = replaceFile(files.blocks + suffix, files.blocks) &&
+    replaceFile(files.cache + suffix, files.cache) &&
+    (indices == nullptr || replaceFile(files.indices + suffix, files.indices)) &&
+    replaceFile(files.blockIndexes + suffix, files.blockIndexes);
+  if (!moved) {
+    logger(ERROR, BRIGHT_RED) << "Failed to move snapshot storage files into place";
+    return false;
+  }
+
+  logger(INFO, BRIGHT_GREEN) << "Imported blockchain snapshot " << path;
+  return true;
+}
+
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "CryptoNote.h"
+#include "Logging/LoggerRef.h"
+
+namespace CryptoNote {
+
+// A snapshot is a header followed by checksummed chunks:
+//   header: "FUEGOSNP", uint32 version, uint32 flags, genesis hash, uint64 block count, tail hash
+//   chunk:  uint32 section, uint32 reserved, uint64 size, cn_fast_hash of the payload, payload
+// BLOCKS chunks carry runs of (uint32 size, serialized block entry), the CACHE and INDICES chunks
+// the block cache and explorer indices files as storeCache / storeBlockchainIndices write them,
+// and the closing END chunk the hash over all previous chunk checksums.
+// Integers are stored little endian.
+
+const uint32_t BLOCKCHAIN_SNAPSHOT_VERSION = 1;
+const uint32_t BLOCKCHAIN_SNAPSHOT_HAS_INDICES = 1;
+
+enum class BlockchainSnapshotSection : uint32_t {
+  END = 0,
+  BLOCKS = 1,
+  CACHE = 2,
+  INDICES = 3
+};
+
+class BlockchainSnapshotWriter {
+public:
+  // writes to <path>.tmp and renames it over <path> in finish(); throws std::runtime_error on I/O errors
+  BlockchainSnapshotWriter(const std::string& path, const Crypto::Hash& genesisHash, uint64_t blockCount, const Crypto::Hash& tailHash, uint32_t flags);
+  ~BlockchainSnapshotWriter();
+
+  void addBlock(const uint8_t* data, uint64_t size);
+  void addSection(BlockchainSnapshotSection section, const BinaryArray& data);
+  void finish();
+
+private:
+  std::string m_path;
+  std::string m_temporaryPath;
+  std::ofstream m_file;
+  BinaryArray m_pendingBlocks;
+  BinaryArray m_checksums;
+  uint64_t m_blockCount;
+  uint64_t m_blocksAdded;
+  bool m_finished;
+
+  void flushBlocks();
+  void writeChunk(BlockchainSnapshotSection section, const uint8_t* data, uint64_t size);
+};
+
+struct BlockchainSnapshotFiles {
+  std::string blocks;
+  std::string blockIndexes;
+  std::string cache;
+  std::string indices;
+};
+
+// Maps the snapshot, verifies every checksum and that it belongs to the chain starting at genesisHash,
+// then lays its blocks and caches out as the storage files Blockchain::init opens, so the node starts
+// from the cache instead of replaying blocks. Existing files are only replaced once the whole
+// snapshot has checked out.
+bool importBlockchainSnapshot(const std::string& path, const Crypto::Hash& genesisHash, const BlockchainSnapshotFiles& files, Logging::ILogger& logger);
+
+}
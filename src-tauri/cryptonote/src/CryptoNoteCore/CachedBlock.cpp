@@ -0,0 +1,97 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "CachedBlock.h"
+
+#include <stdexcept>
+
+#include "Common/Varint.h"
+#include "CryptoNoteConfig.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/TransactionTreeHash.h"
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+CachedBlock::CachedBlock(const Block& block) : m_block(block), m_baseTransaction(block.baseTransaction) {
+}
+
+const Block& CachedBlock::getBlock() const {
+  return m_block;
+}
+
+const CachedTransaction& CachedBlock::getBaseTransaction() const {
+  return m_baseTransaction;
+}
+
+const Crypto::Hash& CachedBlock::getTransactionTreeHash() const {
+  if (!m_transactionTreeHash.is_initialized()) {
+    m_transactionTreeHash = CryptoNote::getTransactionTreeHash(m_baseTransaction.getTransactionHash(), m_block.transactionHashes);
+  }
+
+  return m_transactionTreeHash.get();
+}
+
+// same layout as get_block_hashing_blob
+const BinaryArray& CachedBlock::getBlockHashingBinaryArray() const {
+  if (!m_blockHashingBinaryArray.is_initialized()) {
+    BinaryArray blob;
+    if (!toBinaryArray(static_cast<const BlockHeader&>(m_block), blob)) {
+      throw std::runtime_error("Failed to serialize block header");
+    }
+
+    const Crypto::Hash& treeHash = getTransactionTreeHash();
+    blob.insert(blob.end(), treeHash.data, treeHash.data + sizeof(treeHash.data));
+    auto transactionCount = Common::asBinaryArray(Tools::get_varint_data(m_block.transactionHashes.size() + 1));
+    blob.insert(blob.end(), transactionCount.begin(), transactionCount.end());
+
+    m_blockHashingBinaryArray = std::move(blob);
+  }
+
+  return m_blockHashingBinaryArray.get();
+}
+
+// same result as get_block_hash
+const Crypto::Hash& CachedBlock::getBlockHash() const {
+  if (!m_blockHash.is_initialized()) {
+    BinaryArray blob = getBlockHashingBinaryArray();
+    if (m_block.majorVersion >= BLOCK_MAJOR_VERSION_2) {
+      auto serializer = makeParentBlockSerializer(m_block, true, false);
+      BinaryArray parentBlob;
+      if (!toBinaryArray(serializer, parentBlob)) {
+        throw std::runtime_error("Failed to serialize parent block");
+      }
+
+      blob.insert(blob.end(), parentBlob.begin(), parentBlob.end());
+    }
+
+    m_blockHash = getObjectHash(blob);
+  }
+
+  return m_blockHash.get();
+}
+
+const Crypto::Hash& CachedBlock::getAuxiliaryBlockHeaderHash() const {
+  if (!m_auxiliaryBlockHeaderHash.is_initialized()) {
+    m_auxiliaryBlockHeaderHash = getObjectHash(getBlockHashingBinaryArray());
+  }
+
+  return m_auxiliaryBlockHeaderHash.get();
+}
+
+}
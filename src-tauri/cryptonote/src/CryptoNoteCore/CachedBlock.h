@@ -0,0 +1,50 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <boost/optional.hpp>
+
+#include "CryptoNoteCore/CachedTransaction.h"
+
+namespace CryptoNote {
+
+// Block together with the hashing blob and hashes derived from it, each computed on first use.
+// Like CachedTransaction it references the block, which must not change while wrapped. The hash
+// getters throw std::runtime_error when the block can't be serialized.
+class CachedBlock {
+public:
+  explicit CachedBlock(const Block& block);
+
+  const Block& getBlock() const;
+  const CachedTransaction& getBaseTransaction() const;
+  const Crypto::Hash& getTransactionTreeHash() const;
+  const BinaryArray& getBlockHashingBinaryArray() const;
+  const Crypto::Hash& getBlockHash() const;
+  const Crypto::Hash& getAuxiliaryBlockHeaderHash() const;
+
+private:
+  const Block& m_block;
+  CachedTransaction m_baseTransaction;
+  mutable boost::optional<Crypto::Hash> m_transactionTreeHash;
+  mutable boost::optional<BinaryArray> m_blockHashingBinaryArray;
+  mutable boost::optional<Crypto::Hash> m_blockHash;
+  mutable boost::optional<Crypto::Hash> m_auxiliaryBlockHeaderHash;
+};
+
+}
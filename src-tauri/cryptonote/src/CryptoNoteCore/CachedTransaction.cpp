@@ -0,0 +1,72 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "CachedTransaction.h"
+
+#include "CryptoNoteCore/CryptoNoteTools.h"
+
+namespace CryptoNote {
+
+CachedTransaction::CachedTransaction(const Transaction& transaction) : m_transaction(transaction) {
+}
+
+CachedTransaction::CachedTransaction(const Transaction& transaction, const BinaryArray& transactionBinaryArray) :
+  m_transaction(transaction), m_transactionBinaryArray(transactionBinaryArray) {
+}
+
+const Transaction& CachedTransaction::getTransaction() const {
+  return m_transaction;
+}
+
+const Crypto::Hash& CachedTransaction::getTransactionHash() const {
+  if (!m_transactionHash.is_initialized()) {
+    m_transactionHash = getBinaryArrayHash(getTransactionBinaryArray());
+  }
+
+  return m_transactionHash.get();
+}
+
+const Crypto::Hash& CachedTransaction::getTransactionPrefixHash() const {
+  if (!m_transactionPrefixHash.is_initialized()) {
+    m_transactionPrefixHash = getObjectHash(static_cast<const TransactionPrefix&>(m_transaction));
+  }
+
+  return m_transactionPrefixHash.get();
+}
+
+const BinaryArray& CachedTransaction::getTransactionBinaryArray() const {
+  if (!m_transactionBinaryArray.is_initialized()) {
+    m_transactionBinaryArray = toBinaryArray(m_transaction);
+  }
+
+  return m_transactionBinaryArray.get();
+}
+
+size_t CachedTransaction::getTransactionBinarySize() const {
+  if (m_transactionBinaryArray.is_initialized()) {
+    return m_transactionBinaryArray->size();
+  }
+
+  if (!m_transactionBinarySize.is_initialized()) {
+    m_transactionBinarySize = getObjectBinarySize(m_transaction);
+  }
+
+  return m_transactionBinarySize.get();
+}
+
+}
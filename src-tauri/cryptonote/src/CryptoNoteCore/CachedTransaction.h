@@ -0,0 +1,51 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <boost/optional.hpp>
+
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+
+namespace CryptoNote {
+
+// Transaction together with its serialized form and hashes, each computed on first use. The
+// transaction is referenced, not copied, and must outlive the wrapper without being modified;
+// wrap it again after a change instead.
+class CachedTransaction {
+public:
+  explicit CachedTransaction(const Transaction& transaction);
+  // the caller already holds the serialized transaction, e.g. as it arrived from the network
+  CachedTransaction(const Transaction& transaction, const BinaryArray& transactionBinaryArray);
+
+  const Transaction& getTransaction() const;
+  const Crypto::Hash& getTransactionHash() const;
+  const Crypto::Hash& getTransactionPrefixHash() const;
+  const BinaryArray& getTransactionBinaryArray() const;
+  // counted without building the serialized form unless it is already there
+  size_t getTransactionBinarySize() const;
+
+private:
+  const Transaction& m_transaction;
+  mutable boost::optional<BinaryArray> m_transactionBinaryArray;
+  mutable boost::optional<size_t> m_transactionBinarySize;
+  mutable boost::optional<Crypto::Hash> m_transactionHash;
+  mutable boost::optional<Crypto::Hash> m_transactionPrefixHash;
+};
+
+}
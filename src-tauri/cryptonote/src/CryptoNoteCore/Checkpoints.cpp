@@ -15,6 +15,7 @@
 // You should have received a copy of the GNU General Public License
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include <cstdlib>
 #include <fstream>
 #include <stdio.h>
@@ -35,6 +36,19 @@
 using namespace Logging;
 
 namespace CryptoNote {
+
+namespace {
+
+bool heightLess(const std::pair<uint32_t, Crypto::Hash>& checkpoint, uint32_t height) {
+  return checkpoint.first < height;
+}
+
+bool heightGreater(uint32_t height, const std::pair<uint32_t, Crypto::Hash>& checkpoint) {
+  return height < checkpoint.first;
+}
+
+}
+
 //---------------------------------------------------------------------------
 Checkpoints::Checkpoints(Logging::ILogger &log) : logger(log, "checkpoints") {}
 //---------------------------------------------------------------------------
@@ -46,21 +60,27 @@ bool Checkpoints::add_checkpoint(uint32_t height, const std::string &hash_str) {
     return false;
   }
 
-  if (!(0 == m_points.count(height))) {
+  auto it = std::lower_bound(m_points.begin(), m_points.end(), height, heightLess);
+  if (it != m_points.end() && it->first == height) {
     logger(ERROR) << "<< Checkpoints.cpp << " << "Incorrect hash in checkpoints";
     return false;
   }
 
-  m_points[height] = h;
+  m_points.insert(it, Checkpoint(height, h));
   return true;
 }
 //---------------------------------------------------------------------------
+std::vector<Checkpoints::Checkpoint>::const_iterator Checkpoints::find(uint32_t height) const {
+  auto it = std::lower_bound(m_points.begin(), m_points.end(), height, heightLess);
+  return it != m_points.end() && it->first == height ? it : m_points.end();
+}
+//---------------------------------------------------------------------------
 bool Checkpoints::is_in_checkpoint_zone(uint32_t  height) const {
-  return !m_points.empty() && (height <= (--m_points.end())->first);
+  return !m_points.empty() && height <= m_points.back().first;
 }
 //---------------------------------------------------------------------------
 bool Checkpoints::check_block(uint32_t  height, const Crypto::Hash &h, bool &is_a_checkpoint) const {
-  auto it = m_points.find(height);
+  auto it = find(height);
   is_a_checkpoint = it != m_points.end();
   if (!is_a_checkpoint)
     return true;
@@ -90,7 +110,7 @@ bool Checkpoints::is_alternative_block_allowed(uint32_t  blockchain_height, uint
     return false;
   }
 
-  auto it = m_points.upper_bound(blockchain_height);
+  auto it = std::upper_bound(m_points.begin(), m_points.end(), blockchain_height, heightGreater);
   if (it == m_points.begin())
     return true;
 
@@ -111,15 +131,27 @@ std::vector<uint32_t> Checkpoints::getCheckpointHeights() const {
   return checkpointHeights;
 }
 
-bool Checkpoints::load_checkpoints_from_dns()
+void Checkpoints::start_loading_checkpoints_from_dns()
 {
-  std::string domain("checkpoints.fuego.money");
-  std::vector<std::string>records;
+  std::vector<std::string> domains(DNS_CHECKPOINT_HOSTS.begin(), DNS_CHECKPOINT_HOSTS.end());
+  logger(Logging::DEBUGGING) << "<< Checkpoints.cpp << " << "Fetching DNS checkpoint records from " << domains.size() << " hosts";
+
+  m_dnsRecords = std::async(std::launch::async, [domains] {
+    std::vector<std::string> records;
+    Common::fetch_dns_txt_quorum(domains, domains.size() / 2 + 1, std::chrono::milliseconds(DNS_CHECKPOINTS_TIMEOUT), records);
+    return records;
+  });
+}
 
-  logger(Logging::DEBUGGING) << "<< Checkpoints.cpp << " << "Fetching DNS checkpoint records from " << domain;
+bool Checkpoints::load_checkpoints_from_dns()
+{
+  if (!m_dnsRecords.valid()) {
+    start_loading_checkpoints_from_dns();
+  }
 
-  if (!Common::fetch_dns_txt(domain, records)) {
-    logger(Logging::DEBUGGING) << "<< Checkpoints.cpp << " << "Failed to lookup DNS checkpoint records from " << domain;
+  std::vector<std::string> records = m_dnsRecords.get();
+  if (records.empty()) {
+    logger(Logging::DEBUGGING) << "<< Checkpoints.cpp << " << "Failed to lookup DNS checkpoint records";
   }
 
   for (const auto& record : records) {
@@ -137,7 +169,7 @@ bool Checkpoints::load_checkpoints_from_dns()
       continue;
     }
 
-    if (!(0 == m_points.count(height))) {
+    if (find(height) != m_points.end()) {
       logger(DEBUGGING) << "<< Checkpoints.cpp << " << "Checkpoint already exists for height: " << height << ". Ignoring DNS checkpoint.";
     } else {
       add_checkpoint(height, hash_str);
@@ -16,7 +16,8 @@
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>
 
 #pragma once
-#include <map>
+#include <future>
+#include <vector>
 #include "CryptoNoteBasicImpl.h"
 #include <Logging/LoggerRef.h>
 
@@ -30,6 +31,9 @@ namespace CryptoNote
     bool add_checkpoint(uint32_t height, const std::string& hash_str);
     bool is_in_checkpoint_zone(uint32_t height) const;
     bool load_checkpoints_from_file(const std::string& fileName);
+    // starts the DNS lookup, so it runs while the blockchain loads
+    void start_loading_checkpoints_from_dns();
+    // adds the records of the lookup, starting it if that wasn't done and waiting for it
     bool load_checkpoints_from_dns();
     bool load_checkpoints();    
     bool check_block(uint32_t height, const Crypto::Hash& h) const;
@@ -38,7 +42,13 @@ namespace CryptoNote
     std::vector<uint32_t> getCheckpointHeights() const;
     
   private:
-    std::map<uint32_t, Crypto::Hash> m_points;
+    typedef std::pair<uint32_t, Crypto::Hash> Checkpoint;
+
+    // sorted by height: a handful of entries binary searched on every block
+    std::vector<Checkpoint> m_points;
+    std::future<std::vector<std::string>> m_dnsRecords;
     Logging::LoggerRef logger;
+
+    std::vector<Checkpoint>::const_iterator find(uint32_t height) const;
   };
 }
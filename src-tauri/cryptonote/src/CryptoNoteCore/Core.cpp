@@ -17,17 +17,22 @@
 
 #include "Core.h"
 
+#include <limits>
 #include <sstream>
 #include <unordered_set>
 #include "../CryptoNoteConfig.h"
+#include "../Common/AllocationTracker.h"
 #include "../Common/CommandLine.h"
 #include "../Common/Util.h"
 #include "../Common/Math.h"
+#include "../Common/Metrics.h"
 #include "../Common/StringTools.h"
 #include "../crypto/crypto.h"
 #include "../CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
 #include "../Logging/LoggerRef.h"
 #include "../Rpc/CoreRpcServerCommandsDefinitions.h"
+#include "../Serialization/SerializationTools.h"
+#include "CachedBlock.h"
 #include "CryptoNoteFormatUtils.h"
 
 #include "CryptoNoteTools.h"
@@ -46,6 +51,12 @@ using namespace  Common;
 
 namespace CryptoNote {
 
+namespace {
+
+const uint64_t BLOCK_RESPONSE_CACHE_SIZE = 64 * 1024 * 1024;
+
+}
+
 class BlockWithTransactions : public IBlock {
 public:
   virtual const Block& getBlock() const override {
@@ -73,7 +84,12 @@ core::core(const Currency &currency, i_cryptonote_protocol *pprotocol, Logging::
                                                                                                                                                                   m_mempool(currency, m_blockchain, m_timeProvider, logger),
                                                                                                                                                                   m_blockchain(currency, m_mempool, logger, blockchainIndexesEnabled, blockchainAutosaveEnabled),
                                                                                                                                                                   m_miner(new miner(currency, *this, logger)),
-                                                                                                                                                                  m_starter_message_showed(false)
+                                                                                                                                                                  m_starter_message_showed(false),
+                                                                                                                                                                  m_blockResponses(BLOCK_RESPONSE_CACHE_SIZE),
+                                                                                                                                                                  m_maintenancePending(false),
+                                                                                                                                                                  m_maintenanceStopped(false),
+                                                                                                                                                                  m_nextMaintenanceTask(0),
+                                                                                                                                                                  m_lastActivity(0)
 {
 
   set_cryptonote_protocol(pprotocol);
@@ -82,6 +98,7 @@ core::core(const Currency &currency, i_cryptonote_protocol *pprotocol, Logging::
 }
   //-----------------------------------------------------------------------------------------------
   core::~core() {
+  stopMaintenance();
   m_blockchain.removeObserver(this);
 }
 
@@ -93,6 +110,10 @@ void core::set_cryptonote_protocol(i_cryptonote_protocol* pprotocol) {
   }
 }
 //-----------------------------------------------------------------------------------
+void core::setHeapSnapshotInterval(unsigned interval) {
+  m_heapSnapshotInterval.reset(interval != 0 ? new OnceInInterval(interval, false) : nullptr);
+}
+//-----------------------------------------------------------------------------------
 void core::set_checkpoints(Checkpoints&& chk_pts) {
   m_blockchain.setCheckpoints(std::move(chk_pts));
 }
@@ -159,12 +180,21 @@ size_t core::get_alternative_blocks_count() {
   return m_blockchain.getAlternativeBlocksCount();
 }
 
+KeyImageFilter::Stats core::getSpentKeyFilterStats() {
+  return m_blockchain.getSpentKeyFilterStats();
+}
+
 std::time_t core::getStartTime() const {
   return start_time;
 }
   //-----------------------------------------------------------------------------------------------
 bool core::init(const CoreConfig& config, const MinerConfig& minerConfig, bool load_existing) {
+  return initPool(config) && initBlockchain(config, load_existing) && initMiner(minerConfig) && load_state_data();
+}
+
+bool core::initPool(const CoreConfig& config) {
   m_config_folder = config.configFolder;
+  m_mempool.setMaxSize(config.poolMaxSize);
   bool r = m_mempool.init(m_config_folder);
 
   if (!(r)) {
@@ -172,19 +202,36 @@ bool core::init(const CoreConfig& config, const MinerConfig& minerConfig, bool l
     return false;
   }
 
-  r = m_blockchain.init(m_config_folder, load_existing);
+  return true;
+}
+
+bool core::initBlockchain(const CoreConfig& config, bool load_existing) {
+  m_config_folder = config.configFolder;
+  if (!config.snapshotFile.empty() && !m_blockchain.importSnapshot(m_config_folder, config.snapshotFile)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to import blockchain snapshot";
+    return false;
+  }
+
+  m_blockchain.setBlockCacheSize(config.blockCacheSize);
+  m_blockchain.setBlockStoreChunk(config.blockStoreChunk);
+  m_blockchain.addBlockchainIndexes(config.blockchainIndexes);
+  bool r = m_blockchain.init(m_config_folder, load_existing);
   if (!(r)) {
     logger(ERROR, BRIGHT_RED) << "Failed to initialize blockchain storage";
     return false;
   }
 
-  r = m_miner->init(minerConfig);
+  return true;
+}
+
+bool core::initMiner(const MinerConfig& minerConfig) {
+  bool r = m_miner->init(minerConfig);
   if (!(r)) {
-    logger(ERROR, BRIGHT_RED) << "Failed to initialize blockchain storage";
+    logger(ERROR, BRIGHT_RED) << "Failed to initialize miner";
     return false;
   }
 
-  return load_state_data();
+  return true;
 }
 
 bool core::set_genesis_block(const Block& b) {
@@ -197,6 +244,7 @@ bool core::load_state_data() {
 }
 
 bool core::deinit() {
+  stopMaintenance();
   m_miner->stop();
   m_mempool.deinit();
   m_blockchain.deinit();
@@ -243,7 +291,20 @@ size_t core::addChain(const std::vector<const IBlock*>& chain) {
   return blocksCounter;
 }
 
+bool core::isInCheckpointZone(uint32_t height) {
+  return m_blockchain.isInCheckpointZone(height);
+}
+
+size_t core::addCheckpointedBlocks(const std::vector<Block>& blocks, const std::vector<std::vector<BinaryArray>>& transactions, block_verification_context& bvc) {
+  return m_blockchain.addCheckpointedBlocks(blocks, transactions, bvc);
+}
+
 bool core::handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) { //Deprecated. Should be removed with CryptoNoteProtocolHandler.
+  static Common::MetricHistogram& admissionTime = Common::Metrics::instance().histogram("fuego_tx_admission_seconds",
+    "Time to verify and admit incoming transactions", "path=\"single\"");
+  Common::MetricTimer timer(admissionTime);
+  noteActivity();
+
   tvc = boost::value_initialized<tx_verification_context>();
   //want to process all transactions sequentially
 
@@ -271,6 +332,160 @@ bool core::handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_contex
   return handleIncomingTransaction(tx, tx_hash, tx_blob.size(), tvc, keeped_by_block, blockHeight);
 }
 
+bool core::prepare_incoming_tx(const BinaryArray& tx_blob, Transaction& tx, Crypto::Hash& tx_hash, uint32_t& height, tx_verification_context& tvc, bool keeped_by_block) {
+  if (tx_blob.size() > m_currency.maxTxSize()) {
+    logger(INFO) << "WRONG TRANSACTION BLOB, too big size " << tx_blob.size() << ", rejected";
+    tvc.m_verification_failed = true;
+    return false;
+  }
+
+  Crypto::Hash tx_prefix_hash = NULL_HASH;
+  if (!parse_tx_from_blob(tx, tx_hash, tx_prefix_hash, tx_blob)) {
+    logger(INFO) << "WRONG TRANSACTION BLOB, Failed to parse, rejected";
+    tvc.m_verification_failed = true;
+    return false;
+  }
+
+  Crypto::Hash blockId;
+  if (!getBlockContainingTx(tx_hash, blockId, height)) {
+    height = get_current_blockchain_height(); //this assumption fails for withdrawals
+  }
+
+  if (!check_tx_syntax(tx)) {
+    logger(ERROR) << "WRONG TRANSACTION BLOB, Failed to check tx " << tx_hash << " syntax, rejected";
+    tvc.m_verification_failed = true;
+    return false;
+  }
+
+  if (!check_tx_semantic(tx, keeped_by_block, height)) {
+    logger(ERROR) << "WRONG TRANSACTION BLOB, Failed to check tx " << tx_hash << " semantic, rejected";
+    tvc.m_verification_failed = true;
+    return false;
+  }
+
+  return true;
+}
+
+void core::handle_incoming_txs(const std::vector<BinaryArray>& tx_blobs, std::vector<tx_verification_context>& tvcs, bool keeped_by_block) {
+  static Common::MetricHistogram& admissionTime = Common::Metrics::instance().histogram("fuego_tx_admission_seconds",
+    "Time to verify and admit incoming transactions", "path=\"batch\"");
+  Common::MetricTimer timer(admissionTime);
+  noteActivity();
+
+  tvcs.assign(tx_blobs.size(), boost::value_initialized<tx_verification_context>());
+  if (tx_blobs.empty()) {
+    return;
+  }
+
+  struct Candidate {
+    Transaction tx;
+    Crypto::Hash hash;
+    uint32_t height;
+    bool admissible;
+    BlockInfo checkedInputs;
+  };
+
+  std::vector<Candidate> candidates(tx_blobs.size());
+
+  // stage 1: parsing, syntax and semantic checks only read the blob, so the batch is split across workers
+  auto prepareRange = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      Candidate& candidate = candidates[i];
+      candidate.admissible = prepare_incoming_tx(tx_blobs[i], candidate.tx, candidate.hash, candidate.height, tvcs[i], keeped_by_block);
+    }
+  };
+
+  if (tx_blobs.size() == 1) {
+    prepareRange(0, 1);
+  } else {
+    std::call_once(m_txAdmissionWorkersCreated, [this] { m_txAdmissionWorkers.reset(new Common::ThreadPool()); });
+    size_t chunkCount = std::min(tx_blobs.size(), m_txAdmissionWorkers->workerCount());
+    size_t chunkSize = (tx_blobs.size() + chunkCount - 1) / chunkCount;
+    std::vector<std::future<void>> results;
+    results.reserve(chunkCount);
+    for (size_t begin = 0; begin < tx_blobs.size(); begin += chunkSize) {
+      size_t end = std::min(begin + chunkSize, tx_blobs.size());
+      results.push_back(m_txAdmissionWorkers->submit([&prepareRange, begin, end] { prepareRange(begin, end); }));
+    }
+
+    for (auto& result : results) {
+      result.get();
+    }
+  }
+
+  // duplicates are dropped before any signature work, the relay repeats most transactions many times
+  std::unordered_set<Crypto::Hash> seen;
+  std::vector<const Transaction*> unchecked;
+  std::vector<size_t> uncheckedIndexes;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    Candidate& candidate = candidates[i];
+    if (!candidate.admissible) {
+      continue;
+    }
+
+    if (!seen.insert(candidate.hash).second || m_mempool.have_tx(candidate.hash) || m_blockchain.haveTransaction(candidate.hash)) {
+      logger(TRACE) << "tx " << candidate.hash << " is already known";
+      candidate.admissible = false;
+      continue;
+    }
+
+    unchecked.push_back(&candidate.tx);
+    uncheckedIndexes.push_back(i);
+  }
+
+  // stage 2: ring signatures of the whole batch go to the signature workers; the pool trusts the result while
+  // the max used block stays in the main chain. Transactions kept by block keep the pool's own handling of bad
+  // inputs, but their verified signatures are remembered for when the block itself is checked.
+  if (!unchecked.empty()) {
+    std::vector<BlockInfo> maxUsedBlocks;
+    m_blockchain.checkTransactionsInputs(unchecked, maxUsedBlocks);
+    for (size_t i = 0; i < uncheckedIndexes.size(); ++i) {
+      Candidate& candidate = candidates[uncheckedIndexes[i]];
+      if (maxUsedBlocks[i].empty()) {
+        if (keeped_by_block) {
+          continue;
+        }
+
+        logger(ERROR) << "Transaction verification failed: " << candidate.hash;
+        tvcs[uncheckedIndexes[i]].m_verification_failed = true;
+        candidate.admissible = false;
+      } else {
+        candidate.checkedInputs = maxUsedBlocks[i];
+      }
+    }
+  }
+
+  // stage 3: one critical section for the whole batch
+  bool poolChanged = false;
+  {
+    std::lock_guard<decltype(m_mempool)> lk(m_mempool);
+    LockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      Candidate& candidate = candidates[i];
+      if (!candidate.admissible || m_blockchain.haveTransaction(candidate.hash) || m_mempool.have_tx(candidate.hash)) {
+        continue;
+      }
+
+      tx_verification_context& tvc = tvcs[i];
+      m_mempool.add_tx(candidate.tx, candidate.hash, tx_blobs[i].size(), tvc, keeped_by_block, candidate.height, candidate.checkedInputs);
+      if (tvc.m_verification_failed) {
+        logger(ERROR) << "Transaction verification failed: " << candidate.hash;
+      } else if (tvc.m_verification_impossible) {
+        logger(ERROR) << "Transaction verification impossible: " << candidate.hash;
+      }
+
+      if (tvc.m_added_to_pool) {
+        logger(DEBUGGING) << "tx added: " << candidate.hash;
+        poolChanged = true;
+      }
+    }
+  }
+
+  if (poolChanged) {
+    poolUpdated();
+  }
+}
+
 bool core::get_stat_info(core_stat_info& st_inf) {
   st_inf.mining_speed = m_miner->get_speed();
   st_inf.alternative_blocks = m_blockchain.getAlternativeBlocksCount();
@@ -315,8 +530,6 @@ bool core::check_tx_fee(const Transaction& tx, size_t blobSize, tx_verification_
 		return false;
 	}
 
-	Crypto::Hash h = NULL_HASH;
-	getObjectHash(tx, h, blobSize);
 	const uint64_t fee = inputs_amount - outputs_amount;
 	bool isFusionTransaction = fee == 0 && m_currency.isFusionTransaction(tx, blobSize);
 	if (!isFusionTransaction && fee < m_currency.minimumFee()) {
@@ -426,7 +639,7 @@ size_t core::get_blockchain_total_transactions() {
 bool core::add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t blob_size, tx_verification_context& tvc, bool keeped_by_block, uint32_t height) {
   //Locking on m_mempool and m_blockchain closes possibility to add tx to memory pool which is already in blockchain
   std::lock_guard<decltype(m_mempool)> lk(m_mempool);
-  LockedBlockchainStorage lbs(m_blockchain);
+  LockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
 
   if (m_blockchain.haveTransaction(tx_hash)) {
     logger(TRACE) << "tx " << tx_hash << " is already in blockchain";
@@ -445,7 +658,7 @@ bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
   uint64_t already_generated_coins;
 
   {
-    LockedBlockchainStorage blockchainLock(m_blockchain);
+    LockedBlockchainStorage blockchainLock(m_blockchain, LOCK_SITE("blockchain"));
     height = m_blockchain.getCurrentBlockchainHeight();
     diffic = m_blockchain.getDifficultyForNextBlock();
     if (!(diffic)) {
@@ -556,11 +769,13 @@ bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
     if (coinbase_blob_size < cumulative_size - txs_size) {
       size_t delta = cumulative_size - txs_size - coinbase_blob_size;
       b.baseTransaction.extra.insert(b.baseTransaction.extra.end(), delta, 0);
+      coinbase_blob_size = getObjectBinarySize(b.baseTransaction);
       //here  could be 1 byte difference, because of extra field counter is varint, and it can become from 1-byte len to 2-bytes len.
-      if (cumulative_size != txs_size + getObjectBinarySize(b.baseTransaction)) {
-        if (!(cumulative_size + 1 == txs_size + getObjectBinarySize(b.baseTransaction))) { logger(ERROR, BRIGHT_RED) << "unexpected case: cumulative_size=" << cumulative_size << " + 1 is not equal txs_cumulative_size=" << txs_size << " + get_object_blobsize(b.baseTransaction)=" << getObjectBinarySize(b.baseTransaction); return false; }
+      if (cumulative_size != txs_size + coinbase_blob_size) {
+        if (!(cumulative_size + 1 == txs_size + coinbase_blob_size)) { logger(ERROR, BRIGHT_RED) << "unexpected case: cumulative_size=" << cumulative_size << " + 1 is not equal txs_cumulative_size=" << txs_size << " + get_object_blobsize(b.baseTransaction)=" << coinbase_blob_size; return false; }
           b.baseTransaction.extra.resize(b.baseTransaction.extra.size() - 1);
-          if (cumulative_size != txs_size + getObjectBinarySize(b.baseTransaction)) {
+          coinbase_blob_size = getObjectBinarySize(b.baseTransaction);
+          if (cumulative_size != txs_size + coinbase_blob_size) {
             //fuck, not lucky, -1 makes varint-counter size smaller, in that case we continue to grow with cumulative_size
             logger(TRACE, BRIGHT_RED) <<
               "Miner tx creation have no luck with delta_extra size = " << delta << " and " << delta - 1;
@@ -573,8 +788,8 @@ bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
       }
     }
 
-    if (!(cumulative_size == txs_size + getObjectBinarySize(b.baseTransaction))) {
-      logger(ERROR, BRIGHT_RED) << "unexpected case: cumulative_size=" << cumulative_size << " is not equal txs_cumulative_size=" << txs_size << " + get_object_blobsize(b.baseTransaction)=" << getObjectBinarySize(b.baseTransaction);
+    if (!(cumulative_size == txs_size + coinbase_blob_size)) {
+      logger(ERROR, BRIGHT_RED) << "unexpected case: cumulative_size=" << cumulative_size << " is not equal txs_cumulative_size=" << txs_size << " + get_object_blobsize(b.baseTransaction)=" << coinbase_blob_size;
       return false;
     }
 
@@ -634,6 +849,44 @@ bool core::saveBlockchain()
   return m_blockchain.storeCache();
 }
 
+bool core::exportSnapshot(const std::string& path) {
+  return m_blockchain.exportSnapshot(path);
+}
+
+bool core::exportBlocks(uint32_t startHeight, uint32_t count, const std::string& path) {
+  // one read keeps the blocks and their transactions in step; they come back in block order
+  std::list<Block> blocks;
+  std::list<Transaction> txs;
+  if (count == 0 || !m_blockchain.getBlocks(startHeight, count, blocks, txs)) {
+    logger(ERROR, BRIGHT_RED) << "No blocks to export at height " << startHeight;
+    return false;
+  }
+
+  COMMAND_RPC_GET_BLOCKS_FAST::response segment;
+  segment.start_height = startHeight;
+  segment.current_height = m_blockchain.getCurrentBlockchainHeight();
+  segment.status = CORE_RPC_STATUS_OK;
+
+  auto tx = txs.begin();
+  for (const Block& b : blocks) {
+    block_complete_entry entry;
+    entry.block = asString(toBinaryArray(b));
+    for (size_t i = 0; i < b.transactionHashes.size(); ++i, ++tx) {
+      entry.txs.push_back(asString(toBinaryArray(*tx)));
+    }
+
+    segment.blocks.push_back(std::move(entry));
+  }
+
+  if (!Common::saveStringToFile(path, storeToBinaryKeyValue(segment))) {
+    logger(ERROR, BRIGHT_RED) << "Failed to write " << path;
+    return false;
+  }
+
+  logger(INFO, BRIGHT_GREEN) << "Exported " << blocks.size() << " blocks from height " << startHeight << " to " << path;
+  return true;
+}
+
 bool core::handle_block_found(Block& b) {
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
   handle_incoming_block(b, bvc, true, true);
@@ -649,18 +902,28 @@ void core::on_synchronized() {
   m_miner->on_synchronized();
 }
 
-bool core::getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
-                          std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) {
+bool core::getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds, const PoolVersion& knownPoolVersion,
+                          std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds, PoolVersion& poolVersion) {
+
+  std::vector<Crypto::Hash> addedTxsIds;
+  auto guard = m_mempool.obtainGuard();
+  if (!m_mempool.get_changes_since(knownPoolVersion.poolId, knownPoolVersion.version, addedTxsIds, deletedTxsIds)) {
+    m_mempool.get_difference(knownTxsIds, addedTxsIds, deletedTxsIds);
+  }
 
-  getPoolChanges(knownTxsIds, addedTxs, deletedTxsIds);
+  poolVersion.poolId = m_mempool.get_pool_id();
+  poolVersion.version = m_mempool.get_version();
+  std::vector<Crypto::Hash> misses;
+  m_mempool.getTransactions(addedTxsIds, addedTxs, misses);
+  assert(misses.empty());
   return tailBlockId == m_blockchain.getTailId();
 }
 
-bool core::getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
-        std::vector<TransactionPrefixInfo>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) {
+bool core::getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds, const PoolVersion& knownPoolVersion,
+        std::vector<TransactionPrefixInfo>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds, PoolVersion& poolVersion) {
 
   std::vector<Transaction> added;
-  bool returnStatus = getPoolChanges(tailBlockId, knownTxsIds, added, deletedTxsIds);
+  bool returnStatus = getPoolChanges(tailBlockId, knownTxsIds, knownPoolVersion, added, deletedTxsIds, poolVersion);
 
   for (const auto& tx: added) {
     TransactionPrefixInfo tpi;
@@ -702,6 +965,7 @@ bool core::handle_incoming_block_blob(const BinaryArray& block_blob, block_verif
 }
 
 bool core::handle_incoming_block(const Block& b, block_verification_context& bvc, bool control_miner, bool relay_block) {
+  noteActivity();
   if (control_miner) {
     pause_mining();
   }
@@ -716,12 +980,13 @@ bool core::handle_incoming_block(const Block& b, block_verification_context& bvc
     std::list<Crypto::Hash> missed_txs;
     std::list<Transaction> txs;
     m_blockchain.getTransactions(b.transactionHashes, txs, missed_txs);
-    if (!missed_txs.empty() && getBlockIdByHeight(get_block_height(b)) != get_block_hash(b)) {
+    CachedBlock cachedBlock(b);
+    if (!missed_txs.empty() && getBlockIdByHeight(get_block_height(b)) != cachedBlock.getBlockHash()) {
       logger(INFO) << "Block added, but it seems that reorganize just happened after that, do not relay this block";
     } else {
       if (!(txs.size() == b.transactionHashes.size() && missed_txs.empty())) {
         logger(ERROR, BRIGHT_RED) << "can't find some transactions in found block:" <<
-          get_block_hash(b) << " txs.size()=" << txs.size() << ", b.transactionHashes.size()=" << b.transactionHashes.size() << ", missed_txs.size()" << missed_txs.size(); return false;
+          cachedBlock.getBlockHash() << " txs.size()=" << txs.size() << ", b.transactionHashes.size()=" << b.transactionHashes.size() << ", missed_txs.size()" << missed_txs.size(); return false;
       }
 
       NOTIFY_NEW_BLOCK::request arg;
@@ -742,10 +1007,22 @@ bool core::handle_incoming_block(const Block& b, block_verification_context& bvc
   return true;
 }
 
+void core::precomputeProofOfWork(const std::vector<Block>& blocks) {
+  m_blockchain.precomputeProofOfWork(blocks);
+}
+
 Crypto::Hash core::get_tail_id() {
   return m_blockchain.getTailId();
 }
 
+uint64_t core::get_pool_transactions_size() {
+  return m_mempool.get_transactions_size();
+}
+
+uint64_t core::get_pool_version() {
+  return m_mempool.get_version();
+}
+
 size_t core::get_pool_transactions_count() {
   return m_mempool.get_transactions_count();
 }
@@ -773,6 +1050,11 @@ std::vector<Transaction> core::getPoolTransactions() {
   return result;
 }
 
+std::vector<Crypto::Hash> core::getPoolTransactionHashes() {
+  std::vector<Crypto::Hash> hashes;
+  m_mempool.get_transaction_hashes(hashes);
+  return hashes;
+}
 
 std::vector<Crypto::Hash> core::buildSparseChain() {
   assert(m_blockchain.getCurrentBlockchainHeight() != 0);
@@ -780,7 +1062,7 @@ std::vector<Crypto::Hash> core::buildSparseChain() {
 }
 
 std::vector<Crypto::Hash> core::buildSparseChain(const Crypto::Hash& startBlockId) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
   assert(m_blockchain.haveBlock(startBlockId));
   return m_blockchain.buildSparseChain(startBlockId);
 }
@@ -790,7 +1072,7 @@ bool core::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_R
 }
 
 Crypto::Hash core::getBlockIdByHeight(uint32_t height) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
   if (height < m_blockchain.getCurrentBlockchainHeight()) {
     return m_blockchain.getBlockIdByHeight(height);
   } else {
@@ -843,11 +1125,124 @@ bool core::on_idle() {
     m_starter_message_showed = true;
   }
 
-  m_miner->on_idle();
-  m_mempool.on_idle();
+  {
+    std::lock_guard<std::mutex> lock(m_maintenanceMutex);
+    if (m_maintenanceStopped) {
+      return true;
+    }
+
+    if (!m_maintenanceThread.joinable()) {
+      m_maintenanceThread = std::thread(&core::maintenanceLoop, this);
+    }
+
+    m_maintenancePending = true;
+  }
+
+  m_maintenanceRequested.notify_one();
   return true;
 }
 
+namespace {
+
+const std::chrono::milliseconds MAINTENANCE_QUIET_PERIOD(500);
+const std::chrono::seconds MAINTENANCE_MAX_DEFERRAL(30);
+const char* const MAINTENANCE_TASKS[] = { "miner", "pool", "heap snapshot" };
+const size_t MAINTENANCE_TASK_COUNT = sizeof(MAINTENANCE_TASKS) / sizeof(MAINTENANCE_TASKS[0]);
+
+int64_t steadyMilliseconds() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+void core::noteActivity() {
+  m_lastActivity.store(steadyMilliseconds(), std::memory_order_relaxed);
+}
+
+void core::maintenanceLoop() {
+  std::unique_lock<std::mutex> lock(m_maintenanceMutex);
+  for (;;) {
+    m_maintenanceRequested.wait(lock, [this] { return m_maintenancePending || m_maintenanceStopped; });
+
+    // wait for a quiet moment, though not forever on a node that is busy all the time
+    auto requested = std::chrono::steady_clock::now();
+    while (!m_maintenanceStopped) {
+      std::chrono::milliseconds sinceActivity(steadyMilliseconds() - m_lastActivity.load(std::memory_order_relaxed));
+      if (sinceActivity >= MAINTENANCE_QUIET_PERIOD || std::chrono::steady_clock::now() - requested >= MAINTENANCE_MAX_DEFERRAL) {
+        break;
+      }
+
+      m_maintenanceRequested.wait_for(lock, MAINTENANCE_QUIET_PERIOD - sinceActivity);
+    }
+
+    if (m_maintenanceStopped) {
+      break;
+    }
+
+    m_maintenancePending = false;
+    lock.unlock();
+
+    // one task at a time; when blocks or transactions arrive meanwhile the rest waits for the next quiet moment
+    int64_t started = steadyMilliseconds();
+    while (m_nextMaintenanceTask < MAINTENANCE_TASK_COUNT) {
+      int64_t taskStarted = steadyMilliseconds();
+      runMaintenanceTask(m_nextMaintenanceTask);
+      logger(TRACE) << "Maintenance task " << MAINTENANCE_TASKS[m_nextMaintenanceTask] << " took " << steadyMilliseconds() - taskStarted << " ms";
+      ++m_nextMaintenanceTask;
+
+      if (m_lastActivity.load(std::memory_order_relaxed) > started) {
+        break;
+      }
+    }
+
+    int64_t duration = steadyMilliseconds() - started;
+    logger(duration >= 1000 ? INFO : TRACE) << "Maintenance took " << duration << " ms";
+
+    lock.lock();
+    if (m_nextMaintenanceTask == MAINTENANCE_TASK_COUNT) {
+      m_nextMaintenanceTask = 0;
+    } else {
+      m_maintenancePending = true;
+    }
+  }
+}
+
+bool core::runMaintenanceTask(size_t task) {
+  try {
+    switch (task) {
+    case 0:
+      return m_miner->on_idle();
+    case 1:
+      m_mempool.on_idle();
+      return true;
+    default:
+      if (m_heapSnapshotInterval) {
+        m_heapSnapshotInterval->call([this] {
+          logger(INFO) << "Heap snapshot" << ENDL << Common::memoryReport();
+          return true;
+        });
+      }
+
+      return true;
+    }
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Maintenance task " << MAINTENANCE_TASKS[task] << " failed: " << e.what();
+    return false;
+  }
+}
+
+void core::stopMaintenance() {
+  {
+    std::lock_guard<std::mutex> lock(m_maintenanceMutex);
+    m_maintenanceStopped = true;
+  }
+
+  m_maintenanceRequested.notify_one();
+  if (m_maintenanceThread.joinable()) {
+    m_maintenanceThread.join();
+  }
+}
+
 bool core::addObserver(ICoreObserver* observer) {
   return m_observerManager.add(observer);
 }
@@ -857,6 +1252,15 @@ bool core::removeObserver(ICoreObserver* observer) {
 }
 
 void core::blockchainUpdated() {
+  {
+    // blocks are only added under the pool lock, so the tip read here stays the tip until
+    // the pool has been checked against it
+    std::lock_guard<decltype(m_mempool)> lk(m_mempool);
+    uint32_t height;
+    Crypto::Hash tailId = m_blockchain.getTailId(height);
+    m_mempool.on_blockchain_inc(height, tailId);
+  }
+
   m_observerManager.notify(&ICoreObserver::blockchainUpdated);
 }
 
@@ -868,10 +1272,10 @@ void core::poolUpdated() {
   m_observerManager.notify(&ICoreObserver::poolUpdated);
 }
 
-bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
+bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
   uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockFullInfo>& entries) {
 
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
 
   uint32_t currentHeight = lbs->getCurrentBlockchainHeight();
   uint32_t startOffset = 0;
@@ -893,42 +1297,44 @@ bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
   resCurrentHeight = currentHeight;
   resStartHeight = startOffset;
 
-  uint32_t blocksLeft = static_cast<uint32_t>(std::min(BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT - entries.size(), size_t(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)));
+  uint32_t blocksLeft = fullBlocksToQuery(entries.size(), maxBlockCount);
 
   if (blocksLeft == 0) {
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(startFullOffset, blocksLeft, blocks);
+  std::vector<Crypto::Hash> fullBlockIds = lbs->getBlockIds(startFullOffset, blocksLeft);
 
-  for (auto& b : blocks) {
-    BlockFullInfo item;
+  maxResponseSize = maxResponseSize == 0 ? std::numeric_limits<uint64_t>::max() : std::min(maxResponseSize, uint64_t(BLOCKS_SYNCHRONIZING_MAX_RESPONSE_SIZE));
+  uint64_t responseSize = 0;
 
-    item.block_id = get_block_hash(b);
+  for (uint32_t i = 0; i < fullBlockIds.size(); ++i) {
+    std::shared_ptr<const BlockResponseCache::Entry> response = getBlockResponse(fullBlockIds[i], startFullOffset + i);
+    if (!response) {
+      break;
+    }
 
-    if (b.timestamp >= timestamp) {
-      // query transactions
-      std::list<Transaction> txs;
-      std::list<Crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
+    BlockFullInfo item;
 
-      // fill data
-      block_complete_entry& completeEntry = item;
-      completeEntry.block = asString(toBinaryArray(b));
-      for (auto& tx : txs) {
-        completeEntry.txs.push_back(asString(toBinaryArray(tx)));
-      }
+    item.block_id = fullBlockIds[i];
+
+    if (response->timestamp >= timestamp) {
+      item.block = response->block;
+      item.txs.assign(response->transactions.begin(), response->transactions.end());
+      responseSize += response->fullSize;
     }
 
     entries.push_back(std::move(item));
+    if (responseSize >= maxResponseSize) {
+      break;
+    }
   }
 
   return true;
 }
 
 bool core::findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& startOffset, uint32_t& startFullOffset) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
 
   if (knownBlockIds.empty()) {
     logger(ERROR, BRIGHT_RED) << "knownBlockIds is empty";
@@ -951,7 +1357,7 @@ bool core::findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockId
 std::vector<Crypto::Hash> core::findIdsForShortBlocks(uint32_t startOffset, uint32_t startFullOffset) {
   assert(startOffset <= startFullOffset);
 
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
 
   std::vector<Crypto::Hash> result;
   if (startOffset < startFullOffset) {
@@ -961,9 +1367,14 @@ std::vector<Crypto::Hash> core::findIdsForShortBlocks(uint32_t startOffset, uint
   return result;
 }
 
-bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& resStartHeight,
+uint32_t core::fullBlocksToQuery(size_t shortEntryCount, uint32_t maxBlockCount) const {
+  size_t blockCount = maxBlockCount == 0 ? BLOCKS_SYNCHRONIZING_DEFAULT_COUNT : std::min(size_t(maxBlockCount), COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT);
+  return static_cast<uint32_t>(std::min(BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT - shortEntryCount, blockCount));
+}
+
+bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize, bool includeGlobalIndexes, uint32_t& resStartHeight,
   uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockShortInfo>& entries) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
 
   resCurrentHeight = lbs->getCurrentBlockchainHeight();
   resStartHeight = 0;
@@ -981,42 +1392,216 @@ bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint6
     entries.back().blockId = id;
   }
 
-  uint32_t blocksLeft = static_cast<uint32_t>(std::min(BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT - entries.size(), size_t(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)));
+  uint32_t blocksLeft = fullBlocksToQuery(entries.size(), maxBlockCount);
 
   if (blocksLeft == 0) {
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(resFullOffset, blocksLeft, blocks);
+  std::vector<Crypto::Hash> fullBlockIds = lbs->getBlockIds(resFullOffset, blocksLeft);
 
-  for (auto& b : blocks) {
-    BlockShortInfo item;
+  maxResponseSize = maxResponseSize == 0 ? std::numeric_limits<uint64_t>::max() : std::min(maxResponseSize, uint64_t(BLOCKS_SYNCHRONIZING_MAX_RESPONSE_SIZE));
+  uint64_t responseSize = 0;
 
-    item.blockId = get_block_hash(b);
+  for (uint32_t i = 0; i < fullBlockIds.size(); ++i) {
+    std::shared_ptr<const BlockResponseCache::Entry> response = getBlockResponse(fullBlockIds[i], resFullOffset + i);
+    if (!response) {
+      break;
+    }
+
+    BlockShortInfo item;
 
-    if (b.timestamp >= timestamp) {
-      std::list<Transaction> txs;
-      std::list<Crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
+    item.blockId = fullBlockIds[i];
 
-      item.block = asString(toBinaryArray(b));
+    if (response->timestamp >= timestamp) {
+      item.block = response->block;
+      responseSize += response->liteSize;
+      if (includeGlobalIndexes) {
+        item.baseTransactionGlobalIndexes = response->baseTransactionGlobalIndexes;
+        responseSize += response->liteGlobalIndexesSize;
+      }
 
-      for (const auto& tx: txs) {
+      item.txPrefixes.reserve(response->txPrefixes.size());
+      for (const auto& cached : response->txPrefixes) {
         TransactionPrefixInfo info;
-        info.txPrefix = tx;
-        info.txHash = getObjectHash(tx);
+        info.txPrefix = cached.txPrefix;
+        info.txHash = cached.txHash;
+        if (includeGlobalIndexes) {
+          info.globalIndexes = cached.globalIndexes;
+        }
 
         item.txPrefixes.push_back(std::move(info));
       }
     }
 
     entries.push_back(std::move(item));
+    if (responseSize >= maxResponseSize) {
+      break;
+    }
+  }
+
+  return true;
+}
+
+std::shared_ptr<const BlockResponseCache::Entry> core::getBlockResponse(const Crypto::Hash& blockId, uint32_t height) {
+  std::shared_ptr<const BlockResponseCache::Entry> cached = m_blockResponses.get(blockId, height);
+  if (cached) {
+    return cached;
+  }
+
+  Block b;
+  if (!m_blockchain.getBlockByHash(blockId, b)) {
+    logger(ERROR) << "Block " << blockId << " at height " << height << " not found";
+    return nullptr;
+  }
+
+  std::shared_ptr<BlockResponseCache::Entry> response = std::make_shared<BlockResponseCache::Entry>();
+  response->height = height;
+  response->timestamp = b.timestamp;
+  response->block = asString(toBinaryArray(b));
+  response->fullSize = response->block.size();
+  response->liteSize = response->block.size();
+  response->liteGlobalIndexesSize = 0;
+
+  m_blockchain.getTransactionOutputGlobalIndexes(getObjectHash(b.baseTransaction), response->baseTransactionGlobalIndexes);
+  response->liteGlobalIndexesSize += response->baseTransactionGlobalIndexes.size() * sizeof(uint32_t);
+
+  std::list<Transaction> txs;
+  std::list<Crypto::Hash> missedTxs;
+  m_blockchain.getTransactions(b.transactionHashes, txs, missedTxs);
+
+  response->transactions.reserve(txs.size());
+  response->txPrefixes.reserve(txs.size());
+  for (auto& tx : txs) {
+    BinaryArray txBlob = toBinaryArray(tx);
+    response->fullSize += txBlob.size();
+
+    TransactionPrefixInfo info;
+    info.txHash = getBinaryArrayHash(txBlob);
+    m_blockchain.getTransactionOutputGlobalIndexes(info.txHash, info.globalIndexes);
+    response->liteGlobalIndexesSize += info.globalIndexes.size() * sizeof(uint32_t);
+    response->transactions.push_back(asString(txBlob));
+    info.txPrefix = std::move(static_cast<TransactionPrefix&>(tx));
+    response->liteSize += getObjectBinarySize(info.txPrefix) + sizeof(info.txHash);
+    response->txPrefixes.push_back(std::move(info));
+  }
+
+  m_blockResponses.put(blockId, response);
+  return response;
+}
+
+bool core::queryCompactOutputs(uint32_t startHeight, uint32_t blockCount, uint32_t& resCurrentHeight,
+  std::vector<Crypto::Hash>& blockHashes, std::vector<CompactTransactionInfo>& transactions) {
+  SharedLockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
+
+  resCurrentHeight = lbs->getCurrentBlockchainHeight();
+  if (startHeight >= resCurrentHeight) {
+    return true;
+  }
+
+  size_t count = blockCount == 0 ? BLOCKS_SYNCHRONIZING_DEFAULT_COUNT : std::min(size_t(blockCount), COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT);
+  std::list<Block> blocks;
+  if (!lbs->getBlocks(startHeight, static_cast<uint32_t>(count), blocks)) {
+    return false;
+  }
+
+  blockHashes.reserve(blocks.size());
+  uint32_t height = startHeight;
+  for (const auto& b : blocks) {
+    blockHashes.push_back(get_block_hash(b));
+    appendCompactTransaction(b.baseTransaction, getObjectHash(b.baseTransaction), height, 0, transactions);
+
+    std::list<Transaction> txs;
+    std::list<Crypto::Hash> missedTxs;
+    lbs->getTransactions(b.transactionHashes, txs, missedTxs);
+    if (!missedTxs.empty()) {
+      logger(ERROR, BRIGHT_RED) << "queryCompactOutputs: block " << Common::podToHex(blockHashes.back()) << " misses " << missedTxs.size() << " transactions";
+      return false;
+    }
+
+    uint32_t transactionIndex = 1;
+    auto txHash = b.transactionHashes.begin();
+    for (const auto& tx : txs) {
+      appendCompactTransaction(tx, *txHash++, height, transactionIndex++, transactions);
+    }
+
+    ++height;
   }
 
   return true;
 }
 
+bool core::getBlockHeaders(uint32_t startHeight, uint32_t blockCount, uint32_t& resCurrentHeight,
+  std::vector<BlockHeaderInfo>& headers) {
+  SharedLockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
+
+  resCurrentHeight = lbs->getCurrentBlockchainHeight();
+  size_t count = blockCount == 0 ? BLOCKS_SYNCHRONIZING_DEFAULT_COUNT : std::min(size_t(blockCount), COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT);
+  lbs->getBlockHeaders(startHeight, static_cast<uint32_t>(count), headers);
+  return true;
+}
+
+bool core::getBlockHeightByTimestamp(uint64_t timestamp, uint32_t& height, uint64_t& blockTimestamp) {
+  SharedLockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
+
+  uint32_t blockCount = lbs->getCurrentBlockchainHeight();
+  if (blockCount == 0) {
+    return false;
+  }
+
+  // getLowerBound looks from timestamp - blockFutureTimeLimit
+  if (timestamp <= m_currency.blockFutureTimeLimit()) {
+    height = 0;
+  } else if (!lbs->getLowerBound(timestamp, 0, height)) {
+    // created after the top block, only blocks yet to come need scanning
+    height = blockCount - 1;
+  }
+
+  blockTimestamp = lbs->getBlockTimestamp(height);
+  return true;
+}
+
+// \pre the caller holds a blockchain lock
+void core::appendCompactTransaction(const Transaction& tx, const Crypto::Hash& txHash, uint32_t height,
+  uint32_t transactionIndex, std::vector<CompactTransactionInfo>& transactions) {
+  CompactTransactionInfo info;
+  info.txHash = txHash;
+  info.txPublicKey = getTransactionPublicKeyFromExtra(tx.extra);
+  info.blockHeight = height;
+  info.transactionIndex = transactionIndex;
+  info.hasMultisignature = false;
+
+  std::vector<uint32_t> globalIndexes;
+  m_blockchain.getTransactionOutputGlobalIndexes(txHash, globalIndexes);
+
+  info.outputKeys.reserve(tx.outputs.size());
+  for (size_t i = 0; i < tx.outputs.size(); ++i) {
+    const auto& output = tx.outputs[i];
+    if (output.target.type() == typeid(KeyOutput)) {
+      info.outputKeys.push_back(boost::get<KeyOutput>(output.target).key);
+      info.amounts.push_back(output.amount);
+      info.globalIndexes.push_back(i < globalIndexes.size() ? globalIndexes[i] : 0);
+    } else {
+      info.hasMultisignature = true;
+    }
+  }
+
+  for (const auto& input : tx.inputs) {
+    if (input.type() == typeid(KeyInput)) {
+      info.keyImages.push_back(boost::get<KeyInput>(input).keyImage);
+    } else if (input.type() == typeid(MultisignatureInput)) {
+      info.hasMultisignature = true;
+    }
+  }
+
+  if (!info.hasMultisignature && TransactionExtraIndex(tx.extra).getViewTags(tx.extra, info.viewTags) &&
+    info.viewTags.size() != info.outputKeys.size()) {
+    info.viewTags.clear();
+  }
+
+  transactions.push_back(std::move(info));
+}
+
 bool core::getBackwardBlocksSizes(uint32_t fromHeight, std::vector<size_t>& sizes, size_t count) {
   return m_blockchain.getBackwardBlocksSize(fromHeight, sizes, count);
 }
@@ -1078,6 +1663,10 @@ bool core::getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTr
   return m_blockchain.getGeneratedTransactionsNumber(height, generatedTransactions);
 }
 
+bool core::getTransactionSummary(const Crypto::Hash& transactionHash, TransactionSummary& summary) {
+  return m_blockchain.getTransactionSummary(transactionHash, summary);
+}
+
 bool core::getOrphanBlocksByHeight(uint32_t height, std::vector<Block>& blocks) {
   std::vector<Crypto::Hash> blockHashes;
   if (!m_blockchain.getOrphanBlockIdsByHeight(height, blockHashes)) {
@@ -1151,9 +1740,17 @@ bool core::getTransactionsByPaymentId(const Crypto::Hash& paymentId, std::vector
   return true;
 }
 
+bool core::getTransactionIdByKeyImage(const Crypto::KeyImage& keyImage, Crypto::Hash& transactionHash) {
+  return m_blockchain.getTransactionIdByKeyImage(keyImage, transactionHash);
+}
+
+bool core::getTransactionIdByGlobalOutput(uint64_t amount, uint32_t globalIndex, Crypto::Hash& transactionHash, uint16_t& outputIndex) {
+  return m_blockchain.getTransactionIdByGlobalOutput(amount, globalIndex, transactionHash, outputIndex);
+}
+
 std::error_code core::executeLocked(const std::function<std::error_code()>& func) {
   std::lock_guard<decltype(m_mempool)> lk(m_mempool);
-  LockedBlockchainStorage lbs(m_blockchain);
+  LockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
 
   return func();
 }
@@ -1178,6 +1775,7 @@ uint64_t core::depositAmountAtHeight(size_t height) const {
 }
 
 bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t height) {
+  noteActivity();
   if (!check_tx_syntax(tx)) {
     logger(ERROR) << "WRONG TRANSACTION BLOB, Failed to check tx " << txHash << " syntax, rejected";
     tvc.m_verification_failed = true;
@@ -1211,7 +1809,7 @@ bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash&
 
 std::unique_ptr<IBlock> core::getBlock(const Crypto::Hash& blockId) {
   std::lock_guard<decltype(m_mempool)> lk(m_mempool);
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain, LOCK_SITE("blockchain"));
 
   std::unique_ptr<BlockWithTransactions> blockPtr(new BlockWithTransactions());
   if (!lbs->getBlockByHash(blockId, blockPtr->block)) {
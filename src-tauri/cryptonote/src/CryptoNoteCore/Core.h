@@ -17,7 +17,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <ctime>
+#include <mutex>
+#include <thread>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 
@@ -26,11 +30,14 @@
 #include "Currency.h"
 #include "TransactionPool.h"
 #include "Blockchain.h"
+#include "BlockResponseCache.h"
 #include "CryptoNoteCore/IMinerHandler.h"
 #include "CryptoNoteCore/MinerConfig.h"
+#include "CryptoNoteCore/OnceInInterval.h"
 #include "ICore.h"
 #include "ICoreObserver.h"
 #include "Common/ObserverManager.h"
+#include "Common/ThreadPool.h"
 
 #include "System/Dispatcher.h"
 #include "CryptoNoteCore/MessageQueue.h"
@@ -51,7 +58,10 @@ namespace CryptoNote {
 
      bool on_idle() override;
      virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) override; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
+     // parses and checks a relayed batch in parallel, then adds it to the pool in one critical section
+     virtual void handle_incoming_txs(const std::vector<BinaryArray>& tx_blobs, std::vector<tx_verification_context>& tvcs, bool keeped_by_block) override;
      bool handle_incoming_block_blob(const BinaryArray& block_blob, block_verification_context& bvc, bool control_miner, bool relay_block) override;
+     virtual void precomputeProofOfWork(const std::vector<Block>& blocks) override;
      virtual i_cryptonote_protocol* get_protocol() override {return m_pprotocol;}
      virtual const Currency& currency() const override { return m_currency; }
 
@@ -65,12 +75,32 @@ namespace CryptoNote {
      miner& get_miner() { return *m_miner; }
      static void init_options(boost::program_options::options_description& desc);
      bool init(const CoreConfig& config, const MinerConfig& minerConfig, bool load_existing);
+     // the steps of init for callers that run them as separate startup stages; initBlockchain needs the
+     // pool, a rollback while loading returns transactions to it, initMiner only reads its config
+     bool initPool(const CoreConfig& config);
+     bool initBlockchain(const CoreConfig& config, bool load_existing);
+     bool initMiner(const MinerConfig& minerConfig);
      bool set_genesis_block(const Block& b);
      bool deinit();
+     bool exportSnapshot(const std::string& path);
+     // writes main chain blocks [startHeight, startHeight + count) with their transactions as a binary /getblocks.bin response
+     bool exportBlocks(uint32_t startHeight, uint32_t count, const std::string& path);
+     bool verifyChain(uint32_t startHeight, uint32_t endHeight, bool checkProofOfWork, bool checkSignatures, uint32_t threads, ChainVerificationReport& report) {
+       return m_blockchain.verifyChain(startHeight, endHeight, checkProofOfWork, checkSignatures, threads, report);
+     }
+     Common::RecursiveSharedMutex::WaitStats blockchainLockWaitStats() const { return m_blockchain.lockWaitStats(); }
+     void getBlockCacheStats(uint64_t& hits, uint64_t& misses) { m_blockchain.getBlockCacheStats(hits, misses); }
+     std::vector<BlockchainIndexUsage> getBlockchainIndexUsage() { return m_blockchain.getIndexUsage(); }
+     void getBlockCacheUsage(uint64_t& blocks, uint64_t& bytes) { m_blockchain.getBlockCacheUsage(blocks, bytes); }
+     void setBlockCacheSize(uint64_t bytes) { m_blockchain.setBlockCacheSize(bytes); }
+     void getBlockStoreUsage(uint64_t& blockBytes, uint64_t& fileBytes) { m_blockchain.getBlockStoreUsage(blockBytes, fileBytes); }
+     void getPoolLimits(uint64_t& maxBytes, uint64_t& minimumFeeRate) { m_mempool.getLimits(maxBytes, minimumFeeRate); }
 
      // ICore
      virtual bool saveBlockchain() override;
      virtual size_t addChain(const std::vector<const IBlock*>& chain) override;
+     virtual bool isInCheckpointZone(uint32_t height) override;
+     virtual size_t addCheckpointedBlocks(const std::vector<Block>& blocks, const std::vector<std::vector<BinaryArray>>& transactions, block_verification_context& bvc) override;
      virtual bool handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS_request& arg, NOTIFY_RESPONSE_GET_OBJECTS_request& rsp) override; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
      virtual bool getBackwardBlocksSizes(uint32_t fromHeight, std::vector<size_t>& sizes, size_t count) override;
      virtual bool getBlockSize(const Crypto::Hash& hash, size_t& size) override;
@@ -82,10 +112,13 @@ namespace CryptoNote {
      virtual bool getBlockContainingTx(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight) override;
      virtual bool getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& output_reference) override;
      virtual bool getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions) override;
+     virtual bool getTransactionSummary(const Crypto::Hash& transactionHash, TransactionSummary& summary) override;
      virtual bool getOrphanBlocksByHeight(uint32_t height, std::vector<Block>& blocks) override;
      virtual bool getBlocksByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Block>& blocks, uint32_t& blocksNumberWithinTimestamps) override;
      virtual bool getPoolTransactionsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t transactionsNumberLimit, std::vector<Transaction>& transactions, uint64_t& transactionsNumberWithinTimestamps) override;
      virtual bool getTransactionsByPaymentId(const Crypto::Hash& paymentId, std::vector<Transaction>& transactions) override;
+     virtual bool getTransactionIdByKeyImage(const Crypto::KeyImage& keyImage, Crypto::Hash& transactionHash) override;
+     virtual bool getTransactionIdByGlobalOutput(uint64_t amount, uint32_t globalIndex, Crypto::Hash& transactionHash, uint16_t& outputIndex) override;
      virtual bool getOutByMSigGIndex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) override;
      virtual std::unique_ptr<IBlock> getBlock(const Crypto::Hash& blocksId) override;
      virtual bool handleIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t height) override;
@@ -111,10 +144,15 @@ namespace CryptoNote {
      {
        return m_blockchain.getBlocks(block_ids, blocks, missed_bs);
      }
-     virtual bool queryBlocks(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp,
+     virtual bool queryBlocks(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
        uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockFullInfo>& entries) override;
-    virtual bool queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
+    virtual bool queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize, bool includeGlobalIndexes,
       uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockShortInfo>& entries) override;
+    virtual bool queryCompactOutputs(uint32_t startHeight, uint32_t blockCount, uint32_t& resCurrentHeight,
+      std::vector<Crypto::Hash>& blockHashes, std::vector<CompactTransactionInfo>& transactions) override;
+    virtual bool getBlockHeaders(uint32_t startHeight, uint32_t blockCount, uint32_t& resCurrentHeight,
+      std::vector<BlockHeaderInfo>& headers) override;
+    virtual bool getBlockHeightByTimestamp(uint64_t timestamp, uint32_t& height, uint64_t& blockTimestamp) override;
     virtual Crypto::Hash getBlockIdByHeight(uint32_t height) override;
     virtual bool getTransaction(const Crypto::Hash &id, Transaction &tx, bool checkTxPool = false) override;
     void getTransactions(const std::vector<Crypto::Hash> &txs_ids, std::list<Transaction> &txs, std::list<Crypto::Hash> &missed_txs, bool checkTxPool = false) override;
@@ -124,15 +162,21 @@ namespace CryptoNote {
 
     bool get_alternative_blocks(std::list<Block> &blocks);
     size_t get_alternative_blocks_count();
+    KeyImageFilter::Stats getSpentKeyFilterStats();
     uint64_t coinsEmittedAtHeight(uint64_t height);
     uint64_t difficultyAtHeight(uint64_t height);
 
     void set_cryptonote_protocol(i_cryptonote_protocol *pprotocol);
     void set_checkpoints(Checkpoints &&chk_pts);
+    // logs live heap bytes by subsystem from on_idle() every interval seconds, 0 disables
+    void setHeapSnapshotInterval(unsigned interval);
 
     std::vector<Transaction> getPoolTransactions() override;
+    std::vector<Crypto::Hash> getPoolTransactionHashes() override;
     bool getPoolTransaction(const Crypto::Hash &tx_hash, Transaction &transaction) override;
     size_t get_pool_transactions_count();
+    uint64_t get_pool_transactions_size();
+    uint64_t get_pool_version();
     size_t get_blockchain_total_transactions();
     //bool get_outs(uint64_t amount, std::list<Crypto::PublicKey>& pkeys);
     virtual std::vector<Crypto::Hash> findBlockchainSupplement(const std::vector<Crypto::Hash> &remoteBlockIds, size_t maxCount,
@@ -151,10 +195,10 @@ namespace CryptoNote {
     std::string print_pool(bool short_format);
     std::list<CryptoNote::tx_memory_pool::TransactionDetails> getMemoryPool() const;
     void print_blockchain_outs(const std::string &file);
-    virtual bool getPoolChanges(const Crypto::Hash &tailBlockId, const std::vector<Crypto::Hash> &knownTxsIds,
-                                std::vector<Transaction> &addedTxs, std::vector<Crypto::Hash> &deletedTxsIds) override;
-    virtual bool getPoolChangesLite(const Crypto::Hash &tailBlockId, const std::vector<Crypto::Hash> &knownTxsIds,
-                                    std::vector<TransactionPrefixInfo> &addedTxs, std::vector<Crypto::Hash> &deletedTxsIds) override;
+    virtual bool getPoolChanges(const Crypto::Hash &tailBlockId, const std::vector<Crypto::Hash> &knownTxsIds, const PoolVersion &knownPoolVersion,
+                                std::vector<Transaction> &addedTxs, std::vector<Crypto::Hash> &deletedTxsIds, PoolVersion &poolVersion) override;
+    virtual bool getPoolChangesLite(const Crypto::Hash &tailBlockId, const std::vector<Crypto::Hash> &knownTxsIds, const PoolVersion &knownPoolVersion,
+                                    std::vector<TransactionPrefixInfo> &addedTxs, std::vector<Crypto::Hash> &deletedTxsIds, PoolVersion &poolVersion) override;
     virtual void getPoolChanges(const std::vector<Crypto::Hash> &knownTxsIds, std::vector<Transaction> &addedTxs,
                                 std::vector<Crypto::Hash> &deletedTxsIds) override;
 
@@ -170,6 +214,7 @@ namespace CryptoNote {
     bool add_new_tx(const Transaction &tx, const Crypto::Hash &tx_hash, size_t blob_size, tx_verification_context &tvc, bool keeped_by_block, uint32_t height);
     bool load_state_data();
     bool parse_tx_from_blob(Transaction &tx, Crypto::Hash &tx_hash, Crypto::Hash &tx_prefix_hash, const BinaryArray &blob);
+    bool prepare_incoming_tx(const BinaryArray &tx_blob, Transaction &tx, Crypto::Hash &tx_hash, uint32_t &height, tx_verification_context &tvc, bool keeped_by_block);
     bool handle_incoming_block(const Block &b, block_verification_context &bvc, bool control_miner, bool relay_block);
 
     bool check_tx_syntax(const Transaction &tx);  //check correct values, amounts and all lightweight checks not related with database
@@ -187,8 +232,20 @@ namespace CryptoNote {
     virtual void txDeletedFromPool() override;
     void poolUpdated();
 
+    // serialized block and transactions for queryBlocks and queryBlocksLite, call with the chain locked
+    std::shared_ptr<const BlockResponseCache::Entry> getBlockResponse(const Crypto::Hash& blockId, uint32_t height);
     bool findStartAndFullOffsets(const std::vector<Crypto::Hash> &knownBlockIds, uint64_t timestamp, uint32_t &startOffset, uint32_t &startFullOffset);
     std::vector<Crypto::Hash> findIdsForShortBlocks(uint32_t startOffset, uint32_t startFullOffset);
+    uint32_t fullBlocksToQuery(size_t shortEntryCount, uint32_t maxBlockCount) const;
+    void appendCompactTransaction(const Transaction& tx, const Crypto::Hash& txHash, uint32_t height,
+      uint32_t transactionIndex, std::vector<CompactTransactionInfo>& transactions);
+
+    // the periodic work on_idle requests runs on m_maintenanceThread, put off while blocks or
+    // transactions keep arriving so that it never delays their relay
+    void noteActivity();
+    void maintenanceLoop();
+    bool runMaintenanceTask(size_t task);
+    void stopMaintenance();
 
     const Currency &m_currency;
     Logging::LoggerRef logger;
@@ -202,6 +259,17 @@ namespace CryptoNote {
     friend class tx_validate_inputs;
     std::atomic<bool> m_starter_message_showed;
     Tools::ObserverManager<ICoreObserver> m_observerManager;
+    std::unique_ptr<Common::ThreadPool> m_txAdmissionWorkers; // created on first batch
+    std::once_flag m_txAdmissionWorkersCreated;
+    BlockResponseCache m_blockResponses;
+    std::unique_ptr<OnceInInterval> m_heapSnapshotInterval;
+    std::thread m_maintenanceThread;
+    std::mutex m_maintenanceMutex;
+    std::condition_variable m_maintenanceRequested;
+    bool m_maintenancePending;
+    bool m_maintenanceStopped;
+    size_t m_nextMaintenanceTask;
+    std::atomic<int64_t> m_lastActivity; // steady clock, milliseconds
      time_t start_time;
    };
 }
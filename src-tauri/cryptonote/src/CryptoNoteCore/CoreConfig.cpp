@@ -19,10 +19,24 @@
 
 #include "Common/Util.h"
 #include "Common/CommandLine.h"
+#include "CryptoNoteConfig.h"
+#include "CryptoNoteCore/BlockchainIndices.h"
+
+#include <algorithm>
+#include <stdexcept>
 
 namespace CryptoNote {
 
-CoreConfig::CoreConfig() {
+namespace {
+const command_line::arg_descriptor<std::string> arg_import_snapshot = {"import-snapshot", "Bootstrap an empty data directory from a blockchain snapshot file", "", true};
+const command_line::arg_descriptor<uint32_t> arg_block_store_chunk = {"block-store-chunk", "Store blocks compressed with zstd, this many to a chunk; 0 stores them plain. Switching converts the stored blocks on start", 0};
+const command_line::arg_descriptor<uint64_t> arg_block_cache_size = {"block-cache-size", "Memory for decoded blocks, in MB", BLOCK_CACHE_DEFAULT_SIZE / (1024 * 1024)};
+const command_line::arg_descriptor<std::vector<std::string>> arg_blockchain_indexes = {"blockchain-index", "Keep an explorer index: payment-id, key-image, timestamp, generated-transactions, orphan-blocks or transaction-summaries. "
+  "May be repeated; an index added to an existing chain is built in the background"};
+const command_line::arg_descriptor<uint64_t> arg_pool_max_size = {"pool-max-size", "Size of the transaction pool, in MB; past it the transactions paying the least per byte are evicted", POOL_DEFAULT_MAX_SIZE / (1024 * 1024)};
+}
+
+CoreConfig::CoreConfig() : blockCacheSize(BLOCK_CACHE_DEFAULT_SIZE), blockStoreChunk(0), poolMaxSize(POOL_DEFAULT_MAX_SIZE), blockchainIndexes(0) {
   configFolder = Tools::getDefaultDataDirectory();
 }
 
@@ -31,8 +45,40 @@ void CoreConfig::init(const boost::program_options::variables_map& options) {
     configFolder = command_line::get_arg(options, command_line::arg_data_dir);
     configFolderDefaulted = options[command_line::arg_data_dir.name].defaulted();
   }
+
+  if (command_line::has_arg(options, arg_import_snapshot)) {
+    snapshotFile = command_line::get_arg(options, arg_import_snapshot);
+  }
+
+  if (options.count(arg_block_cache_size.name) != 0) {
+    blockCacheSize = std::max<uint64_t>(command_line::get_arg(options, arg_block_cache_size), 1) * 1024 * 1024;
+  }
+
+  if (options.count(arg_block_store_chunk.name) != 0) {
+    blockStoreChunk = command_line::get_arg(options, arg_block_store_chunk);
+  }
+
+  if (options.count(arg_pool_max_size.name) != 0) {
+    poolMaxSize = std::max<uint64_t>(command_line::get_arg(options, arg_pool_max_size), 1) * 1024 * 1024;
+  }
+
+  if (command_line::has_arg(options, arg_blockchain_indexes)) {
+    for (const std::string& name : command_line::get_arg(options, arg_blockchain_indexes)) {
+      uint32_t index = blockchainIndexByName(name);
+      if (index == 0) {
+        throw std::runtime_error("Unknown blockchain index: " + name);
+      }
+
+      blockchainIndexes |= index;
+    }
+  }
 }
 
 void CoreConfig::initOptions(boost::program_options::options_description& desc) {
+  command_line::add_arg(desc, arg_import_snapshot);
+  command_line::add_arg(desc, arg_block_cache_size);
+  command_line::add_arg(desc, arg_block_store_chunk);
+  command_line::add_arg(desc, arg_pool_max_size);
+  command_line::add_arg(desc, arg_blockchain_indexes);
 }
 } //namespace CryptoNote
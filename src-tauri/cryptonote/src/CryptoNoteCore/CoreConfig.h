@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 #include <boost/program_options.hpp>
@@ -32,6 +33,11 @@ public:
 
   std::string configFolder;
   bool configFolderDefaulted = true;
+  std::string snapshotFile;
+  uint64_t blockCacheSize; // bytes
+  uint32_t blockStoreChunk; // blocks per compressed chunk, 0 for plain storage
+  uint64_t poolMaxSize; // bytes
+  uint32_t blockchainIndexes; // BLOCKCHAIN_INDEX_* bits, kept in addition to those the core was constructed with
 };
 
 } //namespace CryptoNote
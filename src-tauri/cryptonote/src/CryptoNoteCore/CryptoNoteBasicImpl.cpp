@@ -20,7 +20,10 @@
 #include "CryptoNoteTools.h"
 #include "CryptoNoteSerialization.h"
 
+#include <mutex>
+
 #include "Common/Base58.h"
+#include "Common/LruCache.h"
 #include "crypto/hash.h"
 #include "Common/int-util.h"
 
@@ -29,6 +32,15 @@ using namespace Common;
 
 namespace CryptoNote {
 
+  namespace {
+    // Checking that both keys are curve points dominates parsing, and batch payouts parse the same
+    // few addresses over and over; only addresses that parsed successfully are remembered
+    const size_t PARSED_ADDRESS_CACHE_SIZE = 4096;
+
+    std::mutex parsedAddressesMutex;
+    LruCache<std::string, std::pair<uint64_t, AccountPublicAddress>> parsedAddresses(PARSED_ADDRESS_CACHE_SIZE);
+  }
+
   /************************************************************************/
   /* CryptoNote helper functions                                          */
   /************************************************************************/
@@ -81,14 +93,27 @@ namespace CryptoNote {
   }
   //-----------------------------------------------------------------------
   bool parseAccountAddressString(uint64_t& prefix, AccountPublicAddress& adr, const std::string& str) {
+    std::pair<uint64_t, AccountPublicAddress> parsed;
+    {
+      std::lock_guard<std::mutex> lock(parsedAddressesMutex);
+      if (parsedAddresses.get(str, parsed)) {
+        prefix = parsed.first;
+        adr = parsed.second;
+        return true;
+      }
+    }
+
     std::string data;
+    if (!Tools::Base58::decode_addr(str, prefix, data) ||
+        !fromBinaryArray(adr, asBinaryArray(data)) ||
+        !check_key(adr.spendPublicKey) ||
+        !check_key(adr.viewPublicKey)) {
+      return false;
+    }
 
-    return
-      Tools::Base58::decode_addr(str, prefix, data) &&
-      fromBinaryArray(adr, asBinaryArray(data)) &&
-      // ::serialization::parse_binary(data, adr) &&
-      check_key(adr.spendPublicKey) &&
-      check_key(adr.viewPublicKey);
+    std::lock_guard<std::mutex> lock(parsedAddressesMutex);
+    parsedAddresses.put(str, std::make_pair(prefix, adr));
+    return true;
   }
   //-----------------------------------------------------------------------
   bool operator ==(const CryptoNote::Transaction& a, const CryptoNote::Transaction& b) {
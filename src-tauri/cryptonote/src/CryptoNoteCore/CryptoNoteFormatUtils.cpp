@@ -17,6 +17,8 @@
 
 #include "CryptoNoteFormatUtils.h"
 
+#include <algorithm>
+#include <cstring>
 #include <set>
 #include <Logging/LoggerRef.h>
 #include <Common/BinaryArray.hpp>
@@ -28,9 +30,11 @@
 #include "Serialization/BinaryInputStreamSerializer.h"
 #include "CryptoNoteSerialization.h"
 #include "Account.h"
+#include "BinaryBlobDecoder.h"
 #include "CryptoNoteBasicImpl.h"
 #include "CryptoNoteSerialization.h"
 #include "TransactionExtra.h"
+#include "TransactionTreeHash.h"
 #include "CryptoNoteTools.h"
 #include "Currency.h"
 
@@ -43,13 +47,15 @@ using namespace Common;
 namespace CryptoNote {
 
 bool parseAndValidateTransactionFromBinaryArray(const BinaryArray& tx_blob, Transaction& tx, Hash& tx_hash, Hash& tx_prefix_hash) {
-  if (!fromBinaryArray(tx, tx_blob)) {
+  size_t prefixSize;
+  if (!decodeTransaction(tx_blob.data(), tx_blob.size(), tx, prefixSize)) {
     return false;
   }
 
   //TODO: validate tx
   cn_fast_hash(tx_blob.data(), tx_blob.size(), tx_hash);
-  getObjectHash(*static_cast<TransactionPrefix*>(&tx), tx_prefix_hash);
+  // the blob starts with the prefix in its canonical encoding
+  cn_fast_hash(tx_blob.data(), prefixSize, tx_prefix_hash);
   return true;
 }
 
@@ -518,24 +524,98 @@ bool get_aux_block_header_hash(const Block& b, Hash& res) {
   return getObjectHash(blob, res);
 }
 
+bool get_block_longhash_blob(const Block& b, BinaryArray& bd) {
+  if (b.majorVersion == BLOCK_MAJOR_VERSION_1) {
+    return get_block_hashing_blob(b, bd);
+  } else if (b.majorVersion >= BLOCK_MAJOR_VERSION_2) {
+    return get_parent_block_hashing_blob(b, bd);
+  }
+
+  return false;
+}
+
+namespace {
+
+int get_block_longhash_variant(const Block& b) {
+  return b.majorVersion < 5 ? 0 : b.majorVersion >= BLOCK_MAJOR_VERSION_6 ? 2 : 1;
+}
+
+int get_block_longhash_light(const Block& b) {
+  return b.majorVersion >= BLOCK_MAJOR_VERSION_9 ? 1 : 0;
+}
+
+}
+
 bool get_block_longhash(cn_context &context, const Block& b, Hash& res) {
   BinaryArray bd;
-  if (b.majorVersion == BLOCK_MAJOR_VERSION_1) {
-    if (!get_block_hashing_blob(b, bd)) {
+  if (!get_block_longhash_blob(b, bd)) {
+    return false;
+  }
+  cn_slow_hash(context, bd.data(), bd.size(), res, get_block_longhash_light(b), get_block_longhash_variant(b));
+  return true;
+}
+
+bool get_block_longhash(cn_context &context, const Block* blocks, size_t count, Hash* res) {
+  if (count == 0) {
+    return true;
+  }
+
+  BinaryArray joined;
+  BinaryArray bd;
+  size_t blobSize = 0;
+  for (size_t i = 0; i < count; ++i) {
+    assert(blocks[i].majorVersion == blocks[0].majorVersion);
+    bd.clear();
+    if (!get_block_longhash_blob(blocks[i], bd)) {
       return false;
     }
-  } else if (b.majorVersion >= BLOCK_MAJOR_VERSION_2) {
-    if (!get_parent_block_hashing_blob(b, bd)) {
-      return false;
+
+    if (i == 0) {
+      blobSize = bd.size();
+      joined.reserve(blobSize * count);
+    } else if (bd.size() != blobSize) {
+      //blobs of different sizes can't share a call, hash one by one
+      for (size_t j = 0; j < count; ++j) {
+        if (!get_block_longhash(context, blocks[j], res[j])) {
+          return false;
+        }
+      }
+      return true;
     }
-  } else {
+
+    joined.insert(joined.end(), bd.begin(), bd.end());
+  }
+
+  cn_slow_hash_multi(context, joined.data(), blobSize, count, res, get_block_longhash_light(blocks[0]), get_block_longhash_variant(blocks[0]));
+  return true;
+}
+
+bool get_block_longhash_blob(const Block& b, BinaryArray& blob, size_t& nonceOffset) {
+  // the nonce is serialized as raw bytes, at an offset that depends on the varints before it:
+  // find it as the only bytes that change with the nonce
+  Block flipped = b;
+  flipped.nonce = ~b.nonce;
+  BinaryArray other;
+  if (!get_block_longhash_blob(b, blob) || !get_block_longhash_blob(flipped, other) || blob.size() != other.size()) {
+    return false;
+  }
+
+  auto differs = std::mismatch(blob.begin(), blob.end(), other.begin());
+  nonceOffset = static_cast<size_t>(differs.first - blob.begin());
+  if (nonceOffset + sizeof(b.nonce) > blob.size() ||
+      memcmp(blob.data() + nonceOffset, &b.nonce, sizeof(b.nonce)) != 0 ||
+      !std::equal(blob.begin() + nonceOffset + sizeof(b.nonce), blob.end(), other.begin() + nonceOffset + sizeof(b.nonce))) {
     return false;
   }
-  const int cn_variant = b.majorVersion < 5 ? 0 : b.majorVersion >= BLOCK_MAJOR_VERSION_6 ? 2 : 1;
-  const int light = b.majorVersion >= BLOCK_MAJOR_VERSION_9 ? 1 : 0;
-  cn_slow_hash(context, bd.data(), bd.size(), res, light, cn_variant);
+
   return true;
 }
+void get_block_longhash_from_blobs(cn_context &context, const Block& b, const uint8_t* blobs, size_t blobSize, size_t count, Hash* res) {
+  cn_slow_hash_multi(context, blobs, blobSize, count, res, get_block_longhash_light(b), get_block_longhash_variant(b));
+}
+size_t get_block_longhash_batch_size(const Block& b, size_t threadCount) {
+  return cn_slow_hash_select_ways(threadCount, get_block_longhash_light(b));
+}
 
 std::vector<uint32_t> relative_output_offsets_to_absolute(const std::vector<uint32_t>& off) {
   std::vector<uint32_t> res = off;
@@ -566,14 +646,9 @@ Hash get_tx_tree_hash(const std::vector<Hash>& tx_hashes) {
 }
 
 Hash get_tx_tree_hash(const Block& b) {
-  std::vector<Hash> txs_ids;
   Hash h = NULL_HASH;
   getObjectHash(b.baseTransaction, h);
-  txs_ids.push_back(h);
-  for (auto& th : b.transactionHashes) {
-    txs_ids.push_back(th);
-  }
-  return get_tx_tree_hash(txs_ids);
+  return getTransactionTreeHash(h, b.transactionHashes);
 }
 
 bool is_valid_decomposed_amount(uint64_t amount) {
@@ -89,7 +89,17 @@ bool get_parent_block_hashing_blob(const Block& b, BinaryArray& blob);
 bool get_aux_block_header_hash(const Block& b, Crypto::Hash& res);
 bool get_block_hash(const Block& b, Crypto::Hash& res);
 Crypto::Hash get_block_hash(const Block& b);
+// the data the proof of work hash is computed over
+bool get_block_longhash_blob(const Block& b, BinaryArray& blob);
 bool get_block_longhash(Crypto::cn_context &context, const Block& b, Crypto::Hash& res);
+// Long hashes of count blocks sharing one major version, computed together where possible
+bool get_block_longhash(Crypto::cn_context &context, const Block* blocks, size_t count, Crypto::Hash* res);
+// The long hash blob of b and where its four nonce bytes are, so a miner tries nonces by patching
+// a copy of the blob instead of serializing the block, its tree hash included, for every one
+bool get_block_longhash_blob(const Block& b, BinaryArray& blob, size_t& nonceOffset);
+// Long hashes of count long hash blobs of b's version, blobSize bytes each and back to back
+void get_block_longhash_from_blobs(Crypto::cn_context &context, const Block& b, const uint8_t* blobs, size_t blobSize, size_t count, Crypto::Hash* res);
+size_t get_block_longhash_batch_size(const Block& b, size_t threadCount);
 bool get_inputs_money_amount(const Transaction& tx, uint64_t& money);
 uint64_t get_outs_money_amount(const Transaction& tx);
 bool check_inputs_types_supported(const TransactionPrefix& tx);
@@ -227,15 +227,10 @@ void serialize(Transaction& tx, ISerializer& serializer) {
         throw std::runtime_error("Serialization error: unexpected signatures size");
       }
 
-      for (Crypto::Signature& sig : tx.signatures[i]) {
-        serializePod(sig, "", serializer);
-      }
-
+      serializer.binaryArray(tx.signatures[i].data(), sizeof(Crypto::Signature), signatureSize, "");
     } else {
       std::vector<Crypto::Signature> signatures(signatureSize);
-      for (Crypto::Signature& sig : signatures) {
-        serializePod(sig, "", serializer);
-      }
+      serializer.binaryArray(signatures.data(), sizeof(Crypto::Signature), signatureSize, "");
 
       tx.signatures[i] = std::move(signatures);
     }
@@ -28,6 +28,10 @@ namespace CryptoNote
     uint64_t mining_speed;
     uint64_t alternative_blocks;
     std::string top_block_id_str;
+    // relay traffic not sent because the peer already had the item
+    uint64_t relay_suppressed_transactions;
+    uint64_t relay_suppressed_blocks;
+    uint64_t relay_saved_bytes;
     
     void serialize(ISerializer& s) {
       KV_MEMBER(tx_pool_size)
@@ -35,6 +39,9 @@ namespace CryptoNote
       KV_MEMBER(mining_speed)
       KV_MEMBER(alternative_blocks)
       KV_MEMBER(top_block_id_str)
+      KV_MEMBER(relay_suppressed_transactions)
+      KV_MEMBER(relay_suppressed_blocks)
+      KV_MEMBER(relay_saved_bytes)
     }
   };
 }
@@ -33,7 +33,14 @@ bool toBinaryArray(const BinaryArray& object, BinaryArray& binaryArray) {
   return true;
 }
 
+namespace {
+
+thread_local uint64_t objectHashCount = 0;
+
+}
+
 void getBinaryArrayHash(const BinaryArray& binaryArray, Crypto::Hash& hash) {
+  ++objectHashCount;
   cn_fast_hash(binaryArray.data(), binaryArray.size(), hash);
 }
 
@@ -43,6 +50,10 @@ Crypto::Hash getBinaryArrayHash(const BinaryArray& binaryArray) {
   return hash;
 }
 
+uint64_t getObjectHashCount() {
+  return objectHashCount;
+}
+
 uint64_t getInputAmount(const Transaction& transaction) {
   uint64_t amount = 0;
   for (auto& input : transaction.inputs) {
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <limits>
+#include "Common/CountingOutputStream.h"
 #include "Common/MemoryInputStream.h"
 #include "Common/StringTools.h"
 #include "Common/VectorOutputStream.h"
@@ -29,6 +30,8 @@ namespace CryptoNote {
 
 void getBinaryArrayHash(const BinaryArray& binaryArray, Crypto::Hash& hash);
 Crypto::Hash getBinaryArrayHash(const BinaryArray& binaryArray);
+// number of binary array hashes computed on the calling thread, every object hash is one of them
+uint64_t getObjectHashCount();
 
 template<class T>
 bool toBinaryArray(const T& object, BinaryArray& binaryArray) {
@@ -70,13 +73,17 @@ bool fromBinaryArray(T& object, const BinaryArray& binaryArray) {
 
 template<class T>
 bool getObjectBinarySize(const T& object, size_t& size) {
-  BinaryArray ba;
-  if (!toBinaryArray(object, ba)) {
+  // a dry run that only counts the bytes, nothing is built
+  try {
+    ::Common::CountingOutputStream stream;
+    BinaryOutputStreamSerializer serializer(stream);
+    serialize(const_cast<T&>(object), serializer);
+    size = stream.size();
+  } catch (std::exception&) {
     size = (std::numeric_limits<size_t>::max)();
     return false;
   }
 
-  size = ba.size();
   return true;
 }
 
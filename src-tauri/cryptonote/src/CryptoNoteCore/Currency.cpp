@@ -221,30 +221,8 @@ namespace CryptoNote
       return calculateInterestV2(amount, term);
     }
 */
-    uint64_t a = static_cast<uint64_t>(term) * m_depositMaxTotalRate - m_depositMinTotalRateFactor;
-    uint64_t bHi;
-    uint64_t bLo = mul128(amount, a, &bHi);
-    uint64_t cHi;
-    uint64_t cLo;
-    uint64_t offchaininterest = 0;
-    assert(std::numeric_limits<uint32_t>::max() / 100 > m_depositMaxTerm);
-    div128_32(bHi, bLo, static_cast<uint32_t>(100 * m_depositMaxTerm), &cHi, &cLo);
-    assert(cHi == 0);
-
-    // early deposit multiplier 
-    uint64_t interestHi;
-    uint64_t interestLo;
-    if (height <= CryptoNote::parameters::END_MULTIPLIER_BLOCK)
-    {
-      interestLo = mul128(cLo, CryptoNote::parameters::MULTIPLIER_FACTOR, &interestHi);
-      assert(interestHi == 0);
-    }
-    else
-    {
-      interestHi = cHi;
-      interestLo = cLo;
-    }
-    return offchaininterest;
+    // deposit interest is paid off chain, consensus credits none whatever the amount, term or height
+    return 0;
   }
 
   /* ---------------------------------------------------------------------------------------------------- */
@@ -795,8 +773,8 @@ namespace CryptoNote
     return Common::fromString(strAmount, amount);
   }
 
-	difficulty_type Currency::nextDifficulty(uint32_t height, uint8_t blockMajorVersion, std::vector<uint64_t> timestamps,
-		std::vector<difficulty_type> cumulativeDifficulties) const {
+	difficulty_type Currency::nextDifficulty(uint32_t height, uint8_t blockMajorVersion, Common::ArrayView<uint64_t> timestamps,
+		Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 
 		if (blockMajorVersion >= BLOCK_MAJOR_VERSION_7) {
 			return nextDifficultyV5(height, blockMajorVersion, timestamps, cumulativeDifficulties);
@@ -816,24 +794,25 @@ namespace CryptoNote
 	}
 
 
-	difficulty_type Currency::nextDifficultyV1(std::vector<uint64_t> timestamps,
-				std::vector<difficulty_type> cumulativeDifficulties) const {
+	difficulty_type Currency::nextDifficultyV1(Common::ArrayView<uint64_t> timestampsView,
+				Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 		assert(m_difficultyWindow >= 2);
 
-    if (timestamps.size() > m_difficultyWindow)
+    if (timestampsView.getSize() > m_difficultyWindow)
     {
-      timestamps.resize(m_difficultyWindow);
-      cumulativeDifficulties.resize(m_difficultyWindow);
+      timestampsView = timestampsView.head(m_difficultyWindow);
+      cumulativeDifficulties = cumulativeDifficulties.head(m_difficultyWindow);
     }
 
-    size_t length = timestamps.size();
-    assert(length == cumulativeDifficulties.size());
+    size_t length = timestampsView.getSize();
+    assert(length == cumulativeDifficulties.getSize());
     assert(length <= m_difficultyWindow);
     if (length <= 1)
     {
       return 1;
     }
 
+    std::vector<uint64_t> timestamps(timestampsView.begin(), timestampsView.end());
     sort(timestamps.begin(), timestamps.end());
 
     size_t cutBegin, cutEnd;
@@ -869,8 +848,8 @@ namespace CryptoNote
     return (low + timeSpan - 1) / timeSpan;
   }
 
-	difficulty_type Currency::nextDifficultyV2(std::vector<uint64_t> timestamps,
-		std::vector<difficulty_type> cumulativeDifficulties) const {
+	difficulty_type Currency::nextDifficultyV2(Common::ArrayView<uint64_t> timestampsView,
+		Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 
 		// Difficulty calculation v. 2
 		// based on Zawy difficulty algorithm v1.0
@@ -881,18 +860,19 @@ namespace CryptoNote
 		size_t m_difficultyWindow_2 = CryptoNote::parameters::DIFFICULTY_WINDOW_V2;
 		assert(m_difficultyWindow_2 >= 2);
 
-		if (timestamps.size() > m_difficultyWindow_2) {
-			timestamps.resize(m_difficultyWindow_2);
-			cumulativeDifficulties.resize(m_difficultyWindow_2);
+		if (timestampsView.getSize() > m_difficultyWindow_2) {
+			timestampsView = timestampsView.head(m_difficultyWindow_2);
+			cumulativeDifficulties = cumulativeDifficulties.head(m_difficultyWindow_2);
 		}
 
-		size_t length = timestamps.size();
-		assert(length == cumulativeDifficulties.size());
+		size_t length = timestampsView.getSize();
+		assert(length == cumulativeDifficulties.getSize());
 		assert(length <= m_difficultyWindow_2);
 		if (length <= 1) {
 			return 1;
 		}
 
+		std::vector<uint64_t> timestamps(timestampsView.begin(), timestampsView.end());
 		sort(timestamps.begin(), timestamps.end());
 
 		uint64_t timeSpan = timestamps.back() - timestamps.front();
@@ -900,7 +880,7 @@ namespace CryptoNote
 			timeSpan = 1;
 		}
 
-		difficulty_type totalWork = cumulativeDifficulties.back() - cumulativeDifficulties.front();
+		difficulty_type totalWork = cumulativeDifficulties.last() - cumulativeDifficulties.first();
 		assert(totalWork > 0);
 
 		// uint64_t nextDiffZ = totalWork * m_difficultyTarget / timeSpan; 
@@ -922,8 +902,8 @@ namespace CryptoNote
 		return nextDiffZ;
 	}
 
-	difficulty_type Currency::nextDifficultyV3(std::vector<uint64_t> timestamps,
-		std::vector<difficulty_type> cumulativeDifficulties) const {
+	difficulty_type Currency::nextDifficultyV3(Common::ArrayView<uint64_t> timestamps,
+		Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 
 		// LWMA difficulty algorithm
 		// Copyright (c) 2017-2018 Zawy
@@ -939,16 +919,16 @@ namespace CryptoNote
 		size_t N = CryptoNote::parameters::DIFFICULTY_WINDOW_V3;
 
 		// return a difficulty of 1 for first 3 blocks if it's the start of the chain
-		if (timestamps.size() < 4) {
+		if (timestamps.getSize() < 4) {
 			return 1;
 		}
 		// otherwise, use a smaller N if the start of the chain is less than N+1
-		else if (timestamps.size() < N + 1) {
-			N = timestamps.size() - 1;
+		else if (timestamps.getSize() < N + 1) {
+			N = timestamps.getSize() - 1;
 		}
-		else if (timestamps.size() > N + 1) {
-			timestamps.resize(N + 1);
-			cumulativeDifficulties.resize(N + 1);
+		else if (timestamps.getSize() > N + 1) {
+			timestamps = timestamps.head(N + 1);
+			cumulativeDifficulties = cumulativeDifficulties.head(N + 1);
 		}
 
 		// To get an average solvetime to within +/- ~0.1%, use an adjustment factor.
@@ -988,7 +968,7 @@ namespace CryptoNote
 	
 
 	difficulty_type Currency::nextDifficultyV4(uint32_t height, uint8_t blockMajorVersion,
-		std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulativeDifficulties) const {
+		Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 			
 			// LWMA-1 difficulty algorithm 
 			// Copyright (c) 2017-2018 Zawy, MIT License
@@ -1002,7 +982,7 @@ namespace CryptoNote
 	   		   uint64_t difficulty_plate = 10000;
 	   		   
 
-			   assert(timestamps.size() == cumulativeDifficulties.size() && timestamps.size() <= static_cast<uint64_t>(N + 1));
+			   assert(timestamps.getSize() == cumulativeDifficulties.getSize() && timestamps.getSize() <= static_cast<uint64_t>(N + 1));
 
 			   // If it's a new coin, do startup code. Do not remove in case other coins copy your code.
 			   // uint64_t difficulty_guess = 10000;
@@ -1055,7 +1035,7 @@ namespace CryptoNote
 	}
 
 		difficulty_type Currency::nextDifficultyV5(uint32_t height, uint8_t blockMajorVersion,
-		std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulativeDifficulties) const {
+		Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> cumulativeDifficulties) const {
 			
 			// LWMA-1 difficulty algorithm 
 			// Copyright (c) 2017-2018 Zawy, MIT License
@@ -1069,7 +1049,7 @@ namespace CryptoNote
 	   		   uint64_t difficulty_plate = 100000;
 	   		   
 
-			   assert(timestamps.size() == cumulativeDifficulties.size() && timestamps.size() <= static_cast<uint64_t>(N + 1));
+			   assert(timestamps.getSize() == cumulativeDifficulties.getSize() && timestamps.getSize() <= static_cast<uint64_t>(N + 1));
 
 			   // If it's a new coin, do startup code. Do not remove in case other coins copy your code.
 			   // uint64_t difficulty_guess = 10000;
@@ -1132,6 +1112,14 @@ namespace CryptoNote
 			return false;
 		}
 
+		return checkProofOfWorkV1(block, currentDiffic, proofOfWork);
+	}
+
+	bool Currency::checkProofOfWorkV1(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const {
+		if (BLOCK_MAJOR_VERSION_1 != block.majorVersion) {
+			return false;
+		}
+
 		return check_hash(proofOfWork, currentDiffic);
 	}
 
@@ -1145,6 +1133,14 @@ namespace CryptoNote
 			return false;
 		}
 
+		return checkProofOfWorkV2(block, currentDiffic, proofOfWork);
+	}
+
+	bool Currency::checkProofOfWorkV2(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const {
+		if (block.majorVersion < BLOCK_MAJOR_VERSION_2) {
+			return false;
+		}
+
 		if (!check_hash(proofOfWork, currentDiffic)) {
 			return false;
 		}
@@ -1197,6 +1193,26 @@ namespace CryptoNote
 		logger(ERROR, BRIGHT_RED) << "Unknown block major version: " << block.majorVersion << "." << block.minorVersion;
 		return false;
 	}
+
+	bool Currency::checkProofOfWork(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const {
+		switch (block.majorVersion) {
+		case BLOCK_MAJOR_VERSION_1:
+			return checkProofOfWorkV1(block, currentDiffic, proofOfWork);
+
+		case BLOCK_MAJOR_VERSION_2:
+		case BLOCK_MAJOR_VERSION_3:
+		case BLOCK_MAJOR_VERSION_4:
+		case BLOCK_MAJOR_VERSION_5:
+		case BLOCK_MAJOR_VERSION_6:
+		case BLOCK_MAJOR_VERSION_7:
+		case BLOCK_MAJOR_VERSION_8:
+		case BLOCK_MAJOR_VERSION_9:
+			return checkProofOfWorkV2(block, currentDiffic, proofOfWork);
+		}
+
+		logger(ERROR, BRIGHT_RED) << "Unknown block major version: " << block.majorVersion << "." << block.minorVersion;
+		return false;
+	}
     size_t Currency::getApproximateMaximumInputCount(size_t transactionSize, size_t outputCount, size_t mixinCount) const {
     const size_t KEY_IMAGE_SIZE = sizeof(Crypto::KeyImage);
     const size_t OUTPUT_KEY_SIZE = sizeof(decltype(KeyOutput::key));
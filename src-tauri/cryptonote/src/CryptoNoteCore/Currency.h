@@ -21,6 +21,7 @@
 #include <string>
 #include <vector>
 #include <boost/utility.hpp>
+#include "../Common/ArrayView.h"
 #include "../CryptoNoteConfig.h"
 #include "../crypto/hash.h"
 #include "../Logging/LoggerRef.h"
@@ -210,16 +211,21 @@ public:
   std::string formatAmount(int64_t amount) const;
   bool parseAmount(const std::string &str, uint64_t &amount) const;
 
-  difficulty_type nextDifficulty(uint32_t height, uint8_t blockMajorVersion, std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
-  difficulty_type nextDifficultyV1(std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
-  difficulty_type nextDifficultyV2(std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
-  difficulty_type nextDifficultyV3(std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
-  difficulty_type nextDifficultyV4(uint32_t height, uint8_t blockMajorVersion, std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
-  difficulty_type nextDifficultyV5(uint32_t height, uint8_t blockMajorVersion, std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
+  // the views cover the window in chain order and are only read; callers pass ranges of DifficultyWindow
+  difficulty_type nextDifficulty(uint32_t height, uint8_t blockMajorVersion, Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> Difficulties) const;
+  difficulty_type nextDifficultyV1(Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> Difficulties) const;
+  difficulty_type nextDifficultyV2(Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> Difficulties) const;
+  difficulty_type nextDifficultyV3(Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> Difficulties) const;
+  difficulty_type nextDifficultyV4(uint32_t height, uint8_t blockMajorVersion, Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> Difficulties) const;
+  difficulty_type nextDifficultyV5(uint32_t height, uint8_t blockMajorVersion, Common::ArrayView<uint64_t> timestamps, Common::ArrayView<difficulty_type> Difficulties) const;
 
   bool checkProofOfWorkV1(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
   bool checkProofOfWorkV2(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
   bool checkProofOfWork(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
+  // same checks for a proof of work hash computed beforehand
+  bool checkProofOfWorkV1(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const;
+  bool checkProofOfWorkV2(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const;
+  bool checkProofOfWork(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const;
   size_t getApproximateMaximumInputCount(size_t transactionSize, size_t outputCount, size_t mixinCount) const;
 
 private:
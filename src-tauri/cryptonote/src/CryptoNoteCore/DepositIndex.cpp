@@ -17,26 +17,66 @@
 
 #include <CryptoNoteCore/DepositIndex.h>
 
-#include <algorithm>
 #include <cassert>
 #include <cstdint>
-#include <iterator>
 #include <limits>
 
-#include "CryptoNoteSerialization.h"
-#include "Serialization/SerializationOverloads.h"
-
 namespace CryptoNote {
 
-DepositIndex::DepositIndex() : blockCount(0) {
+namespace {
+
+const uint64_t DEPOSIT_INDEX_VERSION = 1;
+
 }
 
-DepositIndex::DepositIndex(DepositHeight expectedHeight) : blockCount(0) {
-  index.reserve(expectedHeight + 1);
+DepositIndex::DepositIndex() : expectedHeight(0) {
+}
+
+DepositIndex::DepositIndex(DepositHeight expectedHeight) : expectedHeight(expectedHeight) {
+}
+
+void DepositIndex::open(const std::string& path) {
+  index.open(path, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE, sizeof(DEPOSIT_INDEX_VERSION));
+  // the owner flushes with the blockchain cache and checks the tip against the blocks on load
+  index.setAutoFlush(false);
+
+  if (index.prefixSize() != sizeof(DEPOSIT_INDEX_VERSION) ||
+      *reinterpret_cast<const uint64_t*>(index.prefix()) != DEPOSIT_INDEX_VERSION) {
+    index.clear();
+    index.resizePrefix(sizeof(DEPOSIT_INDEX_VERSION));
+    *reinterpret_cast<uint64_t*>(index.prefix()) = DEPOSIT_INDEX_VERSION;
+    index.flush();
+  }
+
+  if (expectedHeight > index.capacity()) {
+    index.reserve(expectedHeight + 1);
+  }
+}
+
+void DepositIndex::close() {
+  if (index.isOpened()) {
+    index.flush();
+    index.close();
+  }
+}
+
+bool DepositIndex::isOpened() const {
+  return index.isOpened();
+}
+
+void DepositIndex::flush() {
+  index.flush();
+}
+
+void DepositIndex::clear() {
+  index.clear();
 }
 
 void DepositIndex::reserve(DepositHeight expectedHeight) {
-  index.reserve(expectedHeight + 1);
+  this->expectedHeight = expectedHeight;
+  if (index.isOpened()) {
+    index.reserve(expectedHeight + 1);
+  }
 }
 
 auto DepositIndex::fullDepositAmount() const -> DepositAmount {
@@ -68,95 +108,76 @@ static inline bool sumWillOverflow(uint64_t x, uint64_t y) {
 }
 
 void DepositIndex::pushBlock(DepositAmount amount, DepositInterest interest) {
-  DepositAmount lastAmount;
-  DepositInterest lastInterest;
-  if (index.empty()) {
-    lastAmount = 0;
-    lastInterest = 0;
-  } else {
-    lastAmount = index.back().amount;
-    lastInterest = index.back().interest;
+  DepositAmount lastAmount = fullDepositAmount();
+  DepositInterest lastInterest = fullInterestAmount();
+
+  // interest only ever counted for blocks that changed the locked amount
+  if (amount == 0) {
+    interest = 0;
   }
 
   assert(!sumWillOverflow(amount, lastAmount));
   assert(!sumWillOverflow(interest, lastInterest));
   assert(amount + lastAmount >= 0);
-  if (amount != 0) {
-    index.push_back({blockCount, amount + lastAmount, interest + lastInterest});
-  }
-
-  ++blockCount;
+  index.push_back({amount + lastAmount, interest + lastInterest});
 }
 
 void DepositIndex::popBlock() {
-  assert(blockCount > 0);
-  --blockCount;
-  if (!index.empty() && index.back().height == blockCount) {
-    index.pop_back();
-  }
+  assert(!index.empty());
+  index.pop_back();
 }
   
 auto DepositIndex::size() const -> DepositHeight {
-  return blockCount;
-}
-
-auto DepositIndex::upperBound(DepositHeight height) const -> IndexType::const_iterator {
-  return std::upper_bound(
-      index.cbegin(), index.cend(), height,
-      [] (DepositHeight height, const DepositIndexEntry& left) { return height < left.height; });
+  return static_cast<DepositHeight>(index.size());
 }
 
 size_t DepositIndex::popBlocks(DepositHeight from) {
-  if (from >= blockCount) {
+  if (from >= index.size()) {
     return 0;
   }
 
-  IndexType::iterator it = index.begin();
-  std::advance(it, std::distance(index.cbegin(), upperBound(from)));
-  if (it != index.begin()) {
-    --it;
-    if (it->height != from) {
-      ++it;
-    }
+  auto diff = index.size() - from;
+  // erase would rewrite the whole file, dropping rows off the end only moves the size
+  while (index.size() > from) {
+    index.pop_back();
   }
 
-  index.erase(it, index.end());
-  auto diff = blockCount - from;
-  blockCount -= diff;
-  return diff;
+  return static_cast<size_t>(diff);
 }
 
-auto DepositIndex::depositAmountAtHeight(DepositHeight height) const -> DepositAmount {
-  if (blockCount == 0) {
-    return 0;
-  } else {
-    auto it = upperBound(height);
-    return it == index.cbegin() ? 0 : (--it)->amount;
+// heights past the tip read the tip, as the totals don't change until the next block
+auto DepositIndex::entryAtHeight(DepositHeight height) const -> const DepositIndexEntry* {
+  if (index.empty()) {
+    return nullptr;
   }
+
+  return height < index.size() ? &index[height] : &index.back();
+}
+
+auto DepositIndex::depositAmountAtHeight(DepositHeight height) const -> DepositAmount {
+  const DepositIndexEntry* entry = entryAtHeight(height);
+  return entry == nullptr ? 0 : entry->amount;
 }
 
 auto DepositIndex::depositInterestAtHeight(DepositHeight height) const -> DepositInterest {
-  if (blockCount == 0) {
+  const DepositIndexEntry* entry = entryAtHeight(height);
+  return entry == nullptr ? 0 : entry->interest;
+}
+
+auto DepositIndex::depositAmountBetween(DepositHeight from, DepositHeight to) const -> DepositAmount {
+  if (from >= to) {
     return 0;
-  } else {
-    auto it = upperBound(height);
-    return it == index.cbegin() ? 0 : (--it)->interest;
   }
+
+  return depositAmountAtHeight(to - 1) - (from == 0 ? 0 : depositAmountAtHeight(from - 1));
 }
 
-void DepositIndex::serialize(ISerializer& s) {
-  s(blockCount, "blockCount");
-  if (s.type() == ISerializer::INPUT) {
-    readSequence<DepositIndexEntry>(std::back_inserter(index), "index", s);
-  } else {
-    writeSequence<DepositIndexEntry>(index.begin(), index.end(), "index", s);
+auto DepositIndex::depositInterestBetween(DepositHeight from, DepositHeight to) const -> DepositInterest {
+  if (from >= to) {
+    return 0;
   }
-}
 
-void DepositIndex::DepositIndexEntry::serialize(ISerializer& s) {
-  s(height, "height");
-  s(amount, "amount");
-  s(interest, "interest");
+  return depositInterestAtHeight(to - 1) - (from == 0 ? 0 : depositInterestAtHeight(from - 1));
 }
 
 }
@@ -17,13 +17,16 @@
 
 #pragma once
 
-#include <vector>
 #include <cstddef>
 #include <cstdint>
+#include <string>
+
+#include "Common/FileMappedVector.h"
 
 namespace CryptoNote {
-class ISerializer;
 
+// Running totals of locked amount and interest, one row per block, memory mapped from a file kept
+// beside the blocks file. Totals at a height and differences between two heights are O(1).
 class DepositIndex {
 public:
   using DepositAmount = int64_t;
@@ -31,6 +34,13 @@ public:
   using DepositHeight = uint32_t;
   DepositIndex();
   explicit DepositIndex(DepositHeight expectedHeight);
+
+  void open(const std::string& path);
+  void close();
+  bool isOpened() const;
+  void flush();
+  void clear();
+
   void pushBlock(DepositAmount amount, DepositInterest interest); 
   void popBlock(); 
   void reserve(DepositHeight expectedHeight);
@@ -39,21 +49,20 @@ public:
   DepositAmount fullDepositAmount() const; 
   DepositInterest depositInterestAtHeight(DepositHeight height) const;
   DepositInterest fullInterestAmount() const; 
+  // change of the totals over the blocks in [from, to)
+  DepositAmount depositAmountBetween(DepositHeight from, DepositHeight to) const;
+  DepositInterest depositInterestBetween(DepositHeight from, DepositHeight to) const;
   DepositHeight size() const;
-  void serialize(ISerializer& s);
 
 private:
   struct DepositIndexEntry {
-    DepositHeight height;
     DepositAmount amount;
     DepositInterest interest;
-
-    void serialize(ISerializer& s);
   };
 
-  using IndexType = std::vector<DepositIndexEntry>;
-  IndexType::const_iterator upperBound(DepositHeight height) const;
-  IndexType index;
-  DepositHeight blockCount;
+  const DepositIndexEntry* entryAtHeight(DepositHeight height) const;
+
+  Common::FileMappedVector<DepositIndexEntry> index;
+  DepositHeight expectedHeight;
 };
 }
@@ -0,0 +1,86 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "DifficultyWindow.h"
+
+#include <cassert>
+
+namespace CryptoNote {
+
+DifficultyWindow::DifficultyWindow(size_t capacity) :
+  m_timestamps(2 * capacity),
+  m_cumulativeDifficulties(2 * capacity),
+  m_capacity(capacity),
+  m_first(0),
+  m_size(0),
+  m_endHeight(0) {
+  assert(capacity > 0);
+}
+
+void DifficultyWindow::reset(uint32_t endHeight) {
+  m_first = 0;
+  m_size = 0;
+  m_endHeight = endHeight;
+}
+
+void DifficultyWindow::push(uint64_t timestamp, difficulty_type cumulativeDifficulty) {
+  if (m_size == m_capacity) {
+    m_first = (m_first + 1) % m_capacity;
+    --m_size;
+  }
+
+  store((m_first + m_size) % m_capacity, timestamp, cumulativeDifficulty);
+  ++m_size;
+  ++m_endHeight;
+}
+
+void DifficultyWindow::pushFront(uint64_t timestamp, difficulty_type cumulativeDifficulty) {
+  assert(m_size < m_capacity && beginHeight() > 0);
+  m_first = (m_first + m_capacity - 1) % m_capacity;
+  store(m_first, timestamp, cumulativeDifficulty);
+  ++m_size;
+}
+
+void DifficultyWindow::pop() {
+  assert(m_size > 0);
+  --m_size;
+  --m_endHeight;
+}
+
+Common::ArrayView<uint64_t> DifficultyWindow::timestamps(uint32_t begin, uint32_t end) const {
+  assert(begin <= end);
+  return Common::ArrayView<uint64_t>(m_timestamps.data() + physicalIndex(begin), end - begin);
+}
+
+Common::ArrayView<difficulty_type> DifficultyWindow::cumulativeDifficulties(uint32_t begin, uint32_t end) const {
+  assert(begin <= end);
+  return Common::ArrayView<difficulty_type>(m_cumulativeDifficulties.data() + physicalIndex(begin), end - begin);
+}
+
+size_t DifficultyWindow::physicalIndex(uint32_t height) const {
+  assert(height >= beginHeight() && height <= m_endHeight);
+  return (m_first + (height - beginHeight())) % m_capacity;
+}
+
+void DifficultyWindow::store(size_t index, uint64_t timestamp, difficulty_type cumulativeDifficulty) {
+  m_timestamps[index] = timestamp;
+  m_timestamps[index + m_capacity] = timestamp;
+  m_cumulativeDifficulties[index] = cumulativeDifficulty;
+  m_cumulativeDifficulties[index + m_capacity] = cumulativeDifficulty;
+}
+
+}
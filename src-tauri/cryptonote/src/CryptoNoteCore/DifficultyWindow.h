@@ -0,0 +1,65 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Common/ArrayView.h"
+#include "CryptoNoteCore/Difficulty.h"
+
+namespace CryptoNote {
+
+// Timestamps and cumulative difficulties of a run of consecutive main chain blocks ending at the
+// tip. Every entry is stored twice, capacity apart, so any range of the window is contiguous and
+// can be handed to Currency::nextDifficulty as a view without copying.
+class DifficultyWindow {
+public:
+  explicit DifficultyWindow(size_t capacity);
+
+  size_t capacity() const { return m_capacity; }
+  size_t size() const { return m_size; }
+  uint32_t beginHeight() const { return m_endHeight - static_cast<uint32_t>(m_size); }
+  uint32_t endHeight() const { return m_endHeight; }
+
+  // empties the window and moves it to end before the block at endHeight
+  void reset(uint32_t endHeight);
+  // appends the block at endHeight(), dropping the oldest one when the window is full
+  void push(uint64_t timestamp, difficulty_type cumulativeDifficulty);
+  // prepends the block at beginHeight() - 1, the window must not be full
+  void pushFront(uint64_t timestamp, difficulty_type cumulativeDifficulty);
+  void pop();
+
+  // both ranges must lie within [beginHeight(), endHeight())
+  Common::ArrayView<uint64_t> timestamps(uint32_t begin, uint32_t end) const;
+  Common::ArrayView<difficulty_type> cumulativeDifficulties(uint32_t begin, uint32_t end) const;
+
+private:
+  size_t physicalIndex(uint32_t height) const;
+  void store(size_t index, uint64_t timestamp, difficulty_type cumulativeDifficulty);
+
+  std::vector<uint64_t> m_timestamps;
+  std::vector<difficulty_type> m_cumulativeDifficulties;
+  size_t m_capacity;
+  size_t m_first;
+  size_t m_size;
+  uint32_t m_endHeight;
+};
+
+}
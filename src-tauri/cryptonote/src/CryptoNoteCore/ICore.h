@@ -29,6 +29,7 @@
 
 #include "CryptoNoteCore/MessageQueue.h"
 #include "CryptoNoteCore/BlockchainMessages.h"
+#include "CryptoNoteCore/PoolChangesCursor.h"
 
 namespace CryptoNote {
 
@@ -43,13 +44,16 @@ class ICoreObserver;
 struct Block;
 struct block_verification_context;
 struct BlockFullInfo;
+struct BlockHeaderInfo;
 struct BlockShortInfo;
+struct CompactTransactionInfo;
 struct core_stat_info;
 struct i_cryptonote_protocol;
 struct Transaction;
 struct MultisignatureInput;
 struct KeyInput;
 struct TransactionPrefixInfo;
+struct TransactionSummary;
 struct tx_verification_context;
 
 class ICore {
@@ -71,9 +75,14 @@ public:
   virtual void update_block_template_and_resume_mining() = 0;
   virtual bool handle_incoming_block_blob(const CryptoNote::BinaryArray& block_blob, CryptoNote::block_verification_context& bvc, bool control_miner, bool relay_block) = 0;
   virtual bool handle_incoming_block(const Block& b, block_verification_context& bvc, bool control_miner, bool relay_block) = 0;
+  // thread safe, lets handle_incoming_block reuse proof of work hashes computed on another thread
+  virtual void precomputeProofOfWork(const std::vector<Block>& blocks) = 0;
   virtual bool handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS_request& arg, NOTIFY_RESPONSE_GET_OBJECTS_request& rsp) = 0; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
   virtual void on_synchronized() = 0;
   virtual size_t addChain(const std::vector<const IBlock*>& chain) = 0;
+  virtual bool isInCheckpointZone(uint32_t height) = 0;
+  //bulk append for blocks below the last checkpoint, returns how many leading blocks were taken
+  virtual size_t addCheckpointedBlocks(const std::vector<Block>& blocks, const std::vector<std::vector<BinaryArray>>& transactions, block_verification_context& bvc) = 0;
 
   virtual void get_blockchain_top(uint32_t& height, Crypto::Hash& top_id) = 0;
   virtual std::vector<Crypto::Hash> findBlockchainSupplement(const std::vector<Crypto::Hash>& remoteBlockIds, size_t maxCount,
@@ -83,18 +92,30 @@ public:
   virtual bool getOutByMSigGIndex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) = 0;
   virtual i_cryptonote_protocol* get_protocol() = 0;
   virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) = 0; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
+  virtual void handle_incoming_txs(const std::vector<BinaryArray>& tx_blobs, std::vector<tx_verification_context>& tvcs, bool keeped_by_block) = 0;
   virtual std::vector<Transaction> getPoolTransactions() = 0;
+  virtual std::vector<Crypto::Hash> getPoolTransactionHashes() = 0;
   virtual bool getPoolTransaction(const Crypto::Hash &tx_hash, Transaction &transaction) = 0;
-  virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
-                              std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) = 0;
-  virtual bool getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
-                              std::vector<TransactionPrefixInfo>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) = 0;
+  // Answered from the pool's change log when knownPoolVersion is still in it, without looking at knownTxsIds;
+  // poolVersion is the version the client is at once it applied the answer
+  virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds, const PoolVersion& knownPoolVersion,
+                              std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds, PoolVersion& poolVersion) = 0;
+  virtual bool getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds, const PoolVersion& knownPoolVersion,
+                              std::vector<TransactionPrefixInfo>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds, PoolVersion& poolVersion) = 0;
   virtual void getPoolChanges(const std::vector<Crypto::Hash>& knownTxsIds, std::vector<Transaction>& addedTxs,
                               std::vector<Crypto::Hash>& deletedTxsIds) = 0;
-  virtual bool queryBlocks(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp,
+  // max_block_count / max_response_size of 0 keep the default batch; a non-zero response size stops
+  // adding full blocks once the budget is used, but at least one is always returned
+  virtual bool queryBlocks(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp, uint32_t max_block_count, uint64_t max_response_size,
     uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockFullInfo>& entries) = 0;
-  virtual bool queryBlocksLite(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp,
+  virtual bool queryBlocksLite(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp, uint32_t max_block_count, uint64_t max_response_size, bool include_global_indexes,
     uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockShortInfo>& entries) = 0;
+  virtual bool queryCompactOutputs(uint32_t start_height, uint32_t block_count, uint32_t& current_height,
+    std::vector<Crypto::Hash>& block_hashes, std::vector<CompactTransactionInfo>& transactions) = 0;
+  // block_count of 0 selects BLOCKS_SYNCHRONIZING_DEFAULT_COUNT, capped at COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT
+  virtual bool getBlockHeaders(uint32_t start_height, uint32_t block_count, uint32_t& current_height,
+    std::vector<BlockHeaderInfo>& headers) = 0;
+  virtual bool getBlockHeightByTimestamp(uint64_t timestamp, uint32_t& height, uint64_t& block_timestamp) = 0;
 
   virtual Crypto::Hash getBlockIdByHeight(uint32_t height) = 0;
   virtual bool getBlockByHash(const Crypto::Hash &h, Block &blk) = 0;
@@ -111,10 +132,13 @@ public:
   virtual bool getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference) = 0;
   virtual bool getTransaction(const Crypto::Hash &id, Transaction &tx, bool checkTxPool = false) = 0;
   virtual bool getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions) = 0;
+  virtual bool getTransactionSummary(const Crypto::Hash& transactionHash, TransactionSummary& summary) = 0;
   virtual bool getOrphanBlocksByHeight(uint32_t height, std::vector<Block>& blocks) = 0;
   virtual bool getBlocksByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Block>& blocks, uint32_t& blocksNumberWithinTimestamps) = 0;
   virtual bool getPoolTransactionsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t transactionsNumberLimit, std::vector<Transaction>& transactions, uint64_t& transactionsNumberWithinTimestamps) = 0;
   virtual bool getTransactionsByPaymentId(const Crypto::Hash& paymentId, std::vector<Transaction>& transactions) = 0;
+  virtual bool getTransactionIdByKeyImage(const Crypto::KeyImage& keyImage, Crypto::Hash& transactionHash) = 0;
+  virtual bool getTransactionIdByGlobalOutput(uint64_t amount, uint32_t globalIndex, Crypto::Hash& transactionHash, uint16_t& outputIndex) = 0;
 
   virtual std::unique_ptr<IBlock> getBlock(const Crypto::Hash& blocksId) = 0;
   virtual bool handleIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t height) = 0;
@@ -1,162 +0,0 @@
-// Copyright (c) 2017-2022 Fuego Developers
-// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
-// Copyright (c) 2016-2019 The Karbowanec developers
-// Copyright (c) 2012-2018 The CryptoNote developers
-//
-// This file is part of Fuego.
-//
-// Fuego is free software distributed in the hope that it
-// will be useful, but WITHOUT ANY WARRANTY; without even the
-// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
-// PURPOSE. You can redistribute it and/or modify it under the terms
-// of the GNU General Public License v3 or later versions as published
-// by the Free Software Foundation. Fuego includes elements written
-// by third parties. See file labeled LICENSE for more details.
-// You should have received a copy of the GNU General Public License
-// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
-
-#include <CryptoNoteCore/InvestmentIndex.h>
-
-#include <algorithm>
-#include <cassert>
-#include <cstdint>
-#include <iterator>
-#include <limits>
-
-#include "CryptoNoteSerialization.h"
-#include "Serialization/SerializationOverloads.h"
-
-namespace CryptoNote {
-
-InvestmentIndex::InvestmentIndex() : blockCount(0) {
-}
-
-InvestmentIndex::InvestmentIndex(DepositHeight expectedHeight) : blockCount(0) {
-  index.reserve(expectedHeight + 1);
-}
-
-void InvestmentIndex::reserve(DepositHeight expectedHeight) {
-  index.reserve(expectedHeight + 1);
-}
-
-auto InvestmentIndex::fullDepositAmount() const -> DepositAmount {
-  return index.empty() ? 0 : index.back().amount;
-}
-
-auto InvestmentIndex::fullInterestAmount() const -> DepositInterest {
-  return index.empty() ? 0 : index.back().interest;
-}
-
-static inline bool sumWillOverflow(int64_t x, int64_t y) {
-  if (y > 0 && x > std::numeric_limits<int64_t>::max() - y) {
-    return true;
-  }
-
-  if (y < 0 && x < std::numeric_limits<int64_t>::min() - y) {
-    return true;
-  }
-  
-  return false;
-}
-
-static inline bool sumWillOverflow(uint64_t x, uint64_t y) {
-  if (x > std::numeric_limits<uint64_t>::max() - y) {
-    return true;
-  }
- 
-  return false;
-}
-
-void InvestmentIndex::pushBlock(DepositAmount amount, DepositInterest interest) {
-  DepositAmount lastAmount;
-  DepositInterest lastInterest;
-  if (index.empty()) {
-    lastAmount = 0;
-    lastInterest = 0;
-  } else {
-    lastAmount = index.back().amount;
-    lastInterest = index.back().interest;
-  }
-
-  assert(!sumWillOverflow(amount, lastAmount));
-  assert(!sumWillOverflow(interest, lastInterest));
-  assert(amount + lastAmount >= 0);
-  if (amount != 0) {
-    index.push_back({blockCount, amount + lastAmount, interest + lastInterest});
-  }
-
-  ++blockCount;
-}
-
-void InvestmentIndex::popBlock() {
-  assert(blockCount > 0);
-  --blockCount;
-  if (!index.empty() && index.back().height == blockCount) {
-    index.pop_back();
-  }
-}
-  
-auto InvestmentIndex::size() const -> DepositHeight {
-  return blockCount;
-}
-
-auto InvestmentIndex::upperBound(DepositHeight height) const -> IndexType::const_iterator {
-  return std::upper_bound(
-      index.cbegin(), index.cend(), height,
-      [] (DepositHeight height, const InvestmentIndexEntry& left) { return height < left.height; });
-}
-
-size_t InvestmentIndex::popBlocks(DepositHeight from) {
-  if (from >= blockCount) {
-    return 0;
-  }
-
-  IndexType::iterator it = index.begin();
-  std::advance(it, std::distance(index.cbegin(), upperBound(from)));
-  if (it != index.begin()) {
-    --it;
-    if (it->height != from) {
-      ++it;
-    }
-  }
-
-  index.erase(it, index.end());
-  auto diff = blockCount - from;
-  blockCount -= diff;
-  return diff;
-}
-
-auto InvestmentIndex::investmentAmountAtHeight(DepositHeight height) const -> DepositAmount {
-  if (blockCount == 0) {
-    return 0;
-  } else {
-    auto it = upperBound(height);
-    return it == index.cbegin() ? 0 : (--it)->amount;
-  }
-}
-
-auto InvestmentIndex::depositInterestAtHeight(DepositHeight height) const -> DepositInterest {
-  if (blockCount == 0) {
-    return 0;
-  } else {
-    auto it = upperBound(height);
-    return it == index.cbegin() ? 0 : (--it)->interest;
-  }
-}
-
-void InvestmentIndex::serialize(ISerializer& s) {
-  s(blockCount, "blockCount");
-  if (s.type() == ISerializer::INPUT) {
-    readSequence<InvestmentIndexEntry>(std::back_inserter(index), "index", s);
-  } else {
-    writeSequence<InvestmentIndexEntry>(index.begin(), index.end(), "index", s);
-  }
-}
-
-void InvestmentIndex::InvestmentIndexEntry::serialize(ISerializer& s) {
-  s(height, "height");
-  s(amount, "amount");
-  s(interest, "interest");
-}
-
-}
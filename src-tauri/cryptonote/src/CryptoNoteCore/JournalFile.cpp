@@ -0,0 +1,164 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#include "JournalFile.h"
+
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+namespace {
+
+const size_t RECORD_LENGTH_SIZE = 4;
+
+bool syncFile(FILE* file) {
+  if (fflush(file) != 0) {
+    return false;
+  }
+
+#ifdef _WIN32
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
+
+}
+
+JournalFile::JournalFile() : m_file(nullptr), m_pendingRecords(0), m_size(0) {
+}
+
+JournalFile::~JournalFile() {
+  close();
+}
+
+bool JournalFile::open(const std::string& path) {
+  close();
+  m_path = path;
+  m_size = 0;
+  m_file = fopen(path.c_str(), "ab");
+  return m_file != nullptr;
+}
+
+void JournalFile::close() {
+  if (m_file != nullptr) {
+    sync();
+    fclose(m_file);
+    m_file = nullptr;
+  }
+}
+
+bool JournalFile::isOpened() const {
+  return m_file != nullptr;
+}
+
+void JournalFile::append(const BinaryArray& record) {
+  if (m_file == nullptr) {
+    return;
+  }
+
+  uint32_t length = static_cast<uint32_t>(record.size());
+  for (size_t i = 0; i < RECORD_LENGTH_SIZE; ++i) {
+    m_pending.push_back(static_cast<uint8_t>(length >> (8 * i)));
+  }
+
+  Crypto::Hash checksum = Crypto::cn_fast_hash(record.data(), record.size());
+  m_pending.insert(m_pending.end(), record.begin(), record.end());
+  m_pending.insert(m_pending.end(), checksum.data, checksum.data + sizeof(checksum.data));
+  m_size += RECORD_LENGTH_SIZE + record.size() + sizeof(checksum.data);
+
+  if (++m_pendingRecords >= SYNC_BATCH) {
+    sync();
+  }
+}
+
+bool JournalFile::sync() {
+  if (m_file == nullptr) {
+    return false;
+  }
+
+  if (!m_pending.empty()) {
+    if (fwrite(m_pending.data(), 1, m_pending.size(), m_file) != m_pending.size()) {
+      return false;
+    }
+
+    m_pending.clear();
+    m_pendingRecords = 0;
+  }
+
+  return syncFile(m_file);
+}
+
+bool JournalFile::reset() {
+  if (m_file == nullptr) {
+    return false;
+  }
+
+  m_pending.clear();
+  m_pendingRecords = 0;
+  m_size = 0;
+  fclose(m_file);
+  m_file = fopen(m_path.c_str(), "wb");
+  return m_file != nullptr && syncFile(m_file);
+}
+
+bool JournalFile::load(const std::string& path, std::vector<BinaryArray>& records) {
+  records.clear();
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return true;
+  }
+
+  BinaryArray data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  size_t position = 0;
+  while (position < data.size()) {
+    if (data.size() - position < RECORD_LENGTH_SIZE) {
+      return false;
+    }
+
+    uint32_t length = 0;
+    for (size_t i = RECORD_LENGTH_SIZE; i > 0; --i) {
+      length = (length << 8) | data[position + i - 1];
+    }
+
+    position += RECORD_LENGTH_SIZE;
+    if (data.size() - position < static_cast<uint64_t>(length) + sizeof(Crypto::Hash)) {
+      return false;
+    }
+
+    Crypto::Hash checksum = Crypto::cn_fast_hash(data.data() + position, length);
+    if (memcmp(checksum.data, data.data() + position + length, sizeof(checksum.data)) != 0) {
+      return false;
+    }
+
+    records.emplace_back(data.begin() + position, data.begin() + position + length);
+    position += length + sizeof(Crypto::Hash);
+  }
+
+  return true;
+}
+
+}
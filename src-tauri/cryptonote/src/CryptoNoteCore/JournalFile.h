@@ -0,0 +1,61 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "CryptoNote.h"
+
+namespace CryptoNote {
+
+// Append-only file of opaque records. Each record is stored as uint32 length (little endian),
+// the record and the cn_fast_hash of the record; a torn or corrupted tail ends the replay.
+class JournalFile {
+public:
+  // records are written out and fsynced once this many are pending
+  static const size_t SYNC_BATCH = 16;
+
+  JournalFile();
+  ~JournalFile();
+
+  bool open(const std::string& path);
+  void close();
+  bool isOpened() const;
+
+  void append(const BinaryArray& record);
+  bool sync();
+  // drops every record, called once the file the journal is kept against covers them
+  bool reset();
+  // bytes appended since the journal was opened or reset
+  uint64_t size() const { return m_size; }
+
+  // returns false if the journal ends in a torn or corrupted record; the records before it are kept
+  static bool load(const std::string& path, std::vector<BinaryArray>& records);
+
+private:
+  std::string m_path;
+  FILE* m_file;
+  BinaryArray m_pending;
+  size_t m_pendingRecords;
+  uint64_t m_size;
+};
+
+}
@@ -0,0 +1,109 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#include "KeyImageFilter.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace CryptoNote {
+
+namespace {
+
+const size_t WORDS_PER_BLOCK = 8;
+const size_t BITS_PER_KEY = 16;
+const size_t BITS_PER_LOOKUP = 6;
+const size_t MIN_CAPACITY = 1 << 16;
+
+// key images are curve points and look uniformly random, so their bytes serve as the hash
+void locate(const Crypto::KeyImage& keyImage, uint64_t& block, uint64_t& bits) {
+  memcpy(&block, keyImage.data, sizeof(block));
+  memcpy(&bits, keyImage.data + sizeof(block), sizeof(bits));
+}
+
+}
+
+KeyImageFilter::KeyImageFilter() : m_blockMask(0), m_capacity(0), m_count(0), m_lookups(0), m_rejected(0), m_falsePositives(0) {
+}
+
+void KeyImageFilter::reset(size_t expectedCount) {
+  m_capacity = std::max(expectedCount, MIN_CAPACITY);
+  uint64_t blocks = 1;
+  while (blocks * WORDS_PER_BLOCK * 64 < m_capacity * BITS_PER_KEY) {
+    blocks <<= 1;
+  }
+
+  m_words.assign(blocks * WORDS_PER_BLOCK, 0);
+  m_blockMask = blocks - 1;
+  m_count = 0;
+}
+
+void KeyImageFilter::insert(const Crypto::KeyImage& keyImage) {
+  if (m_words.empty()) {
+    return;
+  }
+
+  uint64_t block;
+  uint64_t bits;
+  locate(keyImage, block, bits);
+  uint64_t* words = &m_words[(block & m_blockMask) * WORDS_PER_BLOCK];
+  for (size_t i = 0; i < BITS_PER_LOOKUP; ++i, bits >>= 9) {
+    words[(bits >> 6) & 7] |= uint64_t(1) << (bits & 63);
+  }
+
+  ++m_count;
+}
+
+bool KeyImageFilter::mayContain(const Crypto::KeyImage& keyImage) const {
+  if (m_words.empty()) {
+    return true;
+  }
+
+  m_lookups.fetch_add(1, std::memory_order_relaxed);
+  uint64_t block;
+  uint64_t bits;
+  locate(keyImage, block, bits);
+  const uint64_t* words = &m_words[(block & m_blockMask) * WORDS_PER_BLOCK];
+  for (size_t i = 0; i < BITS_PER_LOOKUP; ++i, bits >>= 9) {
+    if ((words[(bits >> 6) & 7] & (uint64_t(1) << (bits & 63))) == 0) {
+      m_rejected.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void KeyImageFilter::countFalsePositive() const {
+  m_falsePositives.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool KeyImageFilter::saturated() const {
+  return !m_words.empty() && m_count > m_capacity;
+}
+
+KeyImageFilter::Stats KeyImageFilter::getStats() const {
+  Stats stats;
+  stats.lookups = m_lookups.load(std::memory_order_relaxed);
+  stats.rejected = m_rejected.load(std::memory_order_relaxed);
+  stats.falsePositives = m_falsePositives.load(std::memory_order_relaxed);
+  stats.entries = m_count;
+  stats.sizeBytes = m_words.size() * sizeof(uint64_t);
+  return stats;
+}
+
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "crypto/crypto.h"
+
+namespace CryptoNote {
+
+// Blocked Bloom filter over spent key images. A lookup touches one 64-byte block, so most
+// unspent key images are rejected without probing the spent keys table. Removals are not
+// supported; the owner rebuilds the filter once it has taken more keys than it was sized for.
+class KeyImageFilter {
+public:
+  struct Stats {
+    uint64_t lookups;
+    uint64_t rejected;
+    uint64_t falsePositives;
+    uint64_t entries;
+    uint64_t sizeBytes;
+  };
+
+  KeyImageFilter();
+
+  void reset(size_t expectedCount);
+  void insert(const Crypto::KeyImage& keyImage);
+  // false means the key image is definitely not in the filter; an empty filter answers true
+  bool mayContain(const Crypto::KeyImage& keyImage) const;
+  void countFalsePositive() const;
+  bool saturated() const;
+  Stats getStats() const;
+
+private:
+  std::vector<uint64_t> m_words;
+  uint64_t m_blockMask;
+  size_t m_capacity;
+  size_t m_count;
+
+  mutable std::atomic<uint64_t> m_lookups;
+  mutable std::atomic<uint64_t> m_rejected;
+  mutable std::atomic<uint64_t> m_falsePositives;
+};
+
+}
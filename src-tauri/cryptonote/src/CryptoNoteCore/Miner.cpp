@@ -17,6 +17,7 @@
 
 #include "Miner.h"
 
+#include <cstring>
 #include <future>
 #include <numeric>
 #include <sstream>
@@ -370,6 +371,8 @@ namespace CryptoNote
     uint32_t local_template_ver = 0;
     Crypto::cn_context context;
     Block b;
+    BinaryArray blob;
+    size_t nonceOffset = 0;
 
     while(!m_stop)
     {
@@ -387,6 +390,13 @@ namespace CryptoNote
 
         local_template_ver = m_template_no;
         nonce = m_starter_nonce + th_local_index;
+
+        //serialized once per template, only the nonce is patched in for each hash
+        if (!get_block_longhash_blob(b, blob, nonceOffset)) {
+          logger(ERROR) << "Failed to get block long hash";
+          m_stop = true;
+          break;
+        }
       }
 
       if(!local_template_ver)//no any set_block_template call
@@ -396,15 +406,13 @@ namespace CryptoNote
         continue;
       }
 
-      b.nonce = nonce;
+      memcpy(blob.data() + nonceOffset, &nonce, sizeof(nonce));
       Crypto::Hash h;
-      if (!m_stop && !get_block_longhash(context, b, h)) {
-        logger(ERROR) << "Failed to get block long hash";
-        m_stop = true;
-      }
+      get_block_longhash_from_blobs(context, b, blob.data(), blob.size(), 1, &h);
 
       if (!m_stop && check_hash(h, local_diff))
       {
+        b.nonce = nonce;
         //we lucky!
         ++m_config.current_extra_message_index;
 
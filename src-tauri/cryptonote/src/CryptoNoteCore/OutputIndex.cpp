@@ -0,0 +1,230 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#include "OutputIndex.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "Common/AllocationTracker.h"
+#include "Serialization/ISerializer.h"
+
+namespace CryptoNote {
+
+namespace {
+
+const uint32_t MIN_RANGE_CAPACITY = 4;
+
+}
+
+size_t OutputIndex::Outputs::countUpToBlock(uint32_t height) const {
+  // outputs are appended in chain order, so the block column is sorted
+  return std::upper_bound(m_blocks, m_blocks + m_size, height) - m_blocks;
+}
+
+OutputIndex::OutputIndex() : m_size(0) {
+}
+
+uint32_t OutputIndex::push(uint64_t amount, uint32_t block, uint16_t transaction, uint16_t output) {
+  Common::MemoryScope memoryScope(Common::MemorySubsystem::OutputIndex);
+  Range& range = m_ranges.insert(std::make_pair(amount, Range{ m_blocks.size(), 0, 0 })).first->second;
+  if (range.size == range.capacity) {
+    grow(range);
+  }
+
+  uint64_t position = range.begin + range.size;
+  m_blocks[position] = block;
+  m_transactions[position] = transaction;
+  m_outputs[position] = output;
+  ++m_size;
+  return range.size++;
+}
+
+void OutputIndex::pop(uint64_t amount) {
+  auto it = m_ranges.find(amount);
+  assert(it != m_ranges.end() && it->second.size > 0);
+  --m_size;
+  if (--it->second.size == 0) {
+    if (it->second.begin + it->second.capacity == m_blocks.size()) {
+      resizeColumns(it->second.begin);
+    }
+
+    m_ranges.erase(it);
+  }
+}
+
+OutputIndex::Outputs OutputIndex::find(uint64_t amount) const {
+  Outputs outputs;
+  auto it = m_ranges.find(amount);
+  if (it != m_ranges.end()) {
+    outputs.m_blocks = m_blocks.data() + it->second.begin;
+    outputs.m_transactions = m_transactions.data() + it->second.begin;
+    outputs.m_outputs = m_outputs.data() + it->second.begin;
+    outputs.m_size = it->second.size;
+  }
+
+  return outputs;
+}
+
+std::vector<uint64_t> OutputIndex::amounts() const {
+  std::vector<uint64_t> result;
+  result.reserve(m_ranges.size());
+  for (const auto& range : m_ranges) {
+    result.push_back(range.first);
+  }
+
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+void OutputIndex::clear() {
+  m_ranges.clear();
+  m_blocks.clear();
+  m_transactions.clear();
+  m_outputs.clear();
+  m_size = 0;
+}
+
+void OutputIndex::compact() {
+  Common::MemoryScope memoryScope(Common::MemorySubsystem::OutputIndex);
+  std::vector<uint64_t> order = amounts();
+  uint64_t total = 0;
+  for (uint64_t amount : order) {
+    const Range& range = m_ranges[amount];
+    total += range.size + range.size / 8 + MIN_RANGE_CAPACITY;
+  }
+
+  std::vector<uint32_t> blocks(total);
+  std::vector<uint16_t> transactions(total);
+  std::vector<uint16_t> outputs(total);
+  uint64_t position = 0;
+  for (uint64_t amount : order) {
+    Range& range = m_ranges[amount];
+    std::copy_n(m_blocks.begin() + range.begin, range.size, blocks.begin() + position);
+    std::copy_n(m_transactions.begin() + range.begin, range.size, transactions.begin() + position);
+    std::copy_n(m_outputs.begin() + range.begin, range.size, outputs.begin() + position);
+    range.begin = position;
+    range.capacity = range.size + range.size / 8 + MIN_RANGE_CAPACITY;
+    position += range.capacity;
+  }
+
+  m_blocks.swap(blocks);
+  m_transactions.swap(transactions);
+  m_outputs.swap(outputs);
+}
+
+size_t OutputIndex::size() const {
+  return m_size;
+}
+
+size_t OutputIndex::memoryUsage() const {
+  return m_blocks.capacity() * sizeof(uint32_t) + (m_transactions.capacity() + m_outputs.capacity()) * sizeof(uint16_t) +
+    m_ranges.bucket_count() * (sizeof(std::pair<uint64_t, Range>) + 1);
+}
+
+void OutputIndex::grow(Range& range) {
+  uint32_t capacity = std::max(MIN_RANGE_CAPACITY, range.capacity + range.capacity / 2);
+  if (range.begin + range.capacity == m_blocks.size()) {
+    resizeColumns(range.begin + capacity);
+    range.capacity = capacity;
+    return;
+  }
+
+  // holes make up more than half of the columns, repacking leaves every range some headroom
+  if (m_blocks.size() > 2 * m_size + 1024) {
+    compact();
+    return;
+  }
+
+  uint64_t begin = m_blocks.size();
+  resizeColumns(begin + capacity);
+  std::copy_n(m_blocks.begin() + range.begin, range.size, m_blocks.begin() + begin);
+  std::copy_n(m_transactions.begin() + range.begin, range.size, m_transactions.begin() + begin);
+  std::copy_n(m_outputs.begin() + range.begin, range.size, m_outputs.begin() + begin);
+  range.begin = begin;
+  range.capacity = capacity;
+}
+
+void OutputIndex::resizeColumns(uint64_t size) {
+  m_blocks.resize(size);
+  m_transactions.resize(size);
+  m_outputs.resize(size);
+}
+
+void OutputIndex::serialize(ISerializer& s, Common::StringView name) {
+  // same layout as the map of (transaction index, output) vectors this index replaced
+  size_t count = m_ranges.size();
+  s.beginArray(count, name);
+  if (s.type() == ISerializer::INPUT) {
+    clear();
+    for (size_t i = 0; i < count; ++i) {
+      uint64_t amount;
+      size_t size;
+      s.beginObject("");
+      s(amount, "key");
+      s.beginArray(size, "value");
+      for (size_t j = 0; j < size; ++j) {
+        uint32_t block;
+        uint16_t transaction;
+        uint16_t output;
+        s.beginObject("");
+        s.beginObject("first");
+        s(block, "block");
+        s(transaction, "tx");
+        s.endObject();
+        s(output, "second");
+        s.endObject();
+        push(amount, block, transaction, output);
+      }
+
+      s.endArray();
+      s.endObject();
+    }
+  } else {
+    for (uint64_t amount : amounts()) {
+      Outputs outputs = find(amount);
+      size_t size = outputs.size();
+      s.beginObject("");
+      s(amount, "key");
+      s.beginArray(size, "value");
+      for (size_t j = 0; j < size; ++j) {
+        uint32_t block = outputs.block(j);
+        uint16_t transaction = outputs.transaction(j);
+        uint16_t output = outputs.output(j);
+        s.beginObject("");
+        s.beginObject("first");
+        s(block, "block");
+        s(transaction, "tx");
+        s.endObject();
+        s(output, "second");
+        s.endObject();
+      }
+
+      s.endArray();
+      s.endObject();
+    }
+  }
+
+  s.endArray();
+}
+
+bool serialize(OutputIndex& index, Common::StringView name, ISerializer& s) {
+  index.serialize(s, name);
+  return true;
+}
+
+}
@@ -0,0 +1,94 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+#include "Common/StringView.h"
+
+namespace CryptoNote {
+class ISerializer;
+
+// Key outputs of every amount, kept as three packed columns (block, transaction, output) instead
+// of one vector of padded pairs per amount. Each amount owns a range of the columns; ranges grow in
+// place while they are last, otherwise move to the end, and the holes left behind are reclaimed
+// by compact().
+class OutputIndex {
+public:
+  // view of one amount's outputs, valid until the index is modified
+  class Outputs {
+  public:
+    Outputs() : m_blocks(nullptr), m_transactions(nullptr), m_outputs(nullptr), m_size(0) {}
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    uint32_t block(size_t i) const { return m_blocks[i]; }
+    uint16_t transaction(size_t i) const { return m_transactions[i]; }
+    uint16_t output(size_t i) const { return m_outputs[i]; }
+
+    // number of leading outputs created at or below the given height
+    size_t countUpToBlock(uint32_t height) const;
+
+  private:
+    friend class OutputIndex;
+
+    const uint32_t* m_blocks;
+    const uint16_t* m_transactions;
+    const uint16_t* m_outputs;
+    size_t m_size;
+  };
+
+  OutputIndex();
+
+  // returns the position of the new output among the outputs of its amount
+  uint32_t push(uint64_t amount, uint32_t block, uint16_t transaction, uint16_t output);
+  void pop(uint64_t amount);
+  Outputs find(uint64_t amount) const;
+  std::vector<uint64_t> amounts() const;
+
+  void clear();
+  void compact();
+  size_t size() const;
+  size_t memoryUsage() const;
+
+  void serialize(ISerializer& s, Common::StringView name);
+
+private:
+  struct Range {
+    uint64_t begin;
+    uint32_t size;
+    uint32_t capacity;
+  };
+
+  void grow(Range& range);
+  void resizeColumns(uint64_t size);
+
+  phmap::flat_hash_map<uint64_t, Range> m_ranges;
+  std::vector<uint32_t> m_blocks;
+  std::vector<uint16_t> m_transactions;
+  std::vector<uint16_t> m_outputs;
+  uint64_t m_size;
+};
+
+bool serialize(OutputIndex& index, Common::StringView name, ISerializer& s);
+
+}
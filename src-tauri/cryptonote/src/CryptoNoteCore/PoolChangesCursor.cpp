@@ -0,0 +1,81 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "PoolChangesCursor.h"
+
+#include <unordered_set>
+
+namespace CryptoNote {
+
+namespace {
+
+// order independent, so the known transactions may come in any order
+void addToDigest(Crypto::Hash& digest, const Crypto::Hash& hash) {
+  for (size_t i = 0; i < sizeof(digest.data); ++i) {
+    digest.data[i] ^= hash.data[i];
+  }
+}
+
+}
+
+PoolChangesCursor::PoolChangesCursor() {
+  reset();
+}
+
+PoolVersion PoolChangesCursor::position(const std::vector<Crypto::Hash>& knownTxsIds) const {
+  PoolVersion none = { 0, 0 };
+  if (m_poolVersion.poolId == 0 || knownTxsIds.size() != m_count) {
+    return none;
+  }
+
+  Crypto::Hash digest = Crypto::Hash();
+  for (const Crypto::Hash& id : knownTxsIds) {
+    addToDigest(digest, id);
+  }
+
+  return digest == m_digest ? m_poolVersion : none;
+}
+
+void PoolChangesCursor::advance(const std::vector<Crypto::Hash>& knownTxsIds, const std::vector<Crypto::Hash>& addedTxsIds,
+                                const std::vector<Crypto::Hash>& deletedTxsIds, const PoolVersion& poolVersion) {
+  // a node answering from its change log may report deletions of transactions the client never had
+  std::unordered_set<Crypto::Hash> deleted(deletedTxsIds.begin(), deletedTxsIds.end());
+  m_digest = Crypto::Hash();
+  m_count = 0;
+  for (const Crypto::Hash& id : knownTxsIds) {
+    if (deleted.count(id) == 0) {
+      addToDigest(m_digest, id);
+      ++m_count;
+    }
+  }
+
+  for (const Crypto::Hash& id : addedTxsIds) {
+    addToDigest(m_digest, id);
+    ++m_count;
+  }
+
+  m_poolVersion = poolVersion;
+}
+
+void PoolChangesCursor::reset() {
+  m_poolVersion.poolId = 0;
+  m_poolVersion.version = 0;
+  m_count = 0;
+  m_digest = Crypto::Hash();
+}
+
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+// A version of a node's pool, see tx_memory_pool::get_changes_since; a zero poolId is none
+struct PoolVersion {
+  uint64_t poolId;
+  uint64_t version;
+};
+
+// Remembers the pool version an applied pool changes answer brought a client to, together with a
+// digest of the transactions the client knew afterwards. A later request made with the same known
+// transactions can then ask the node for the changes since that version instead of a full diff.
+class PoolChangesCursor {
+public:
+  PoolChangesCursor();
+
+  // {0, 0} when knownTxsIds aren't the transactions the last applied answer left
+  PoolVersion position(const std::vector<Crypto::Hash>& knownTxsIds) const;
+  // after applying an answer for knownTxsIds that left the client at poolVersion
+  void advance(const std::vector<Crypto::Hash>& knownTxsIds, const std::vector<Crypto::Hash>& addedTxsIds,
+               const std::vector<Crypto::Hash>& deletedTxsIds, const PoolVersion& poolVersion);
+  void reset();
+
+private:
+  PoolVersion m_poolVersion;
+  size_t m_count;
+  Crypto::Hash m_digest;
+};
+
+}
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <cstddef>
 #include <fstream>
@@ -24,13 +25,20 @@
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <cstdio>
+#include "Common/AllocationTracker.h"
+#include "Common/Compression.h"
+#include "Common/MemoryInputStream.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "Serialization/BinaryInputStreamSerializer.h"
 #include "Serialization/BinaryOutputStreamSerializer.h"
+#include "System/MemoryMappedFile.h"
 
 template<class T> class SwappedVector {
 public:
@@ -148,7 +156,10 @@ public:
   ~SwappedVector();
   //SwappedVector& operator=(const SwappedVector&) = delete;
 
-  bool open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize);
+  // cacheBudget bounds the serialized size of the items kept decoded in memory. A non-zero
+  // chunkItems stores the items compressed, that many to a chunk; it needs compression support
+  // and is ignored for an existing compressed store, which keeps the chunk size it was made with.
+  bool open(const std::string& itemFileName, const std::string& indexFileName, uint64_t cacheBudget, uint32_t chunkItems = 0);
   void close();
 
   bool empty() const;
@@ -162,46 +173,113 @@ public:
   void pop_back();
   void push_back(const T& item);
 
-private:
-  struct ItemEntry;
-  struct CacheEntry;
+  // Serialized bytes of the item straight from the mapped items file, without touching the cache.
+  // The view stays valid until the next modification or, inside shared access, until endSharedAccess().
+  // Items of a compressed chunk are copied to buffer and data points there instead.
+  bool getSerializedItem(uint64_t index, const uint8_t*& data, uint64_t& size, std::vector<uint8_t>& buffer);
+
+  // While shared access is active, references returned by operator[] stay valid:
+  // items pushed out of the cache are parked until the last concurrent reader leaves.
+  void beginSharedAccess();
+  void endSharedAccess();
+
+  // operator[] lookups served from the cache and from the file since open()
+  void cacheStats(uint64_t& hits, uint64_t& misses);
+  // cached items and their serialized size
+  void cacheUsage(uint64_t& items, uint64_t& bytes);
+  // takes effect immediately, evicting down to the new budget
+  void setCacheBudget(uint64_t cacheBudget);
+  // Starts reading the items [index, index + count) from disk in the background, for callers
+  // that know which items they are about to walk through. Items already cached are skipped.
+  void prefetch(uint64_t index, uint64_t count);
+  // serialized size of all items, and the size they take up in the items file
+  void storageUsage(uint64_t& itemBytes, uint64_t& fileBytes);
 
+private:
+  // The cache is a 2Q: items read once wait in a FIFO probation queue that gets a quarter of the
+  // budget, and only items asked for again after leaving it (remembered as ghosts) move to the
+  // LRU protected queue. A scan over the whole chain passes through probation without pushing
+  // out the blocks that are read repeatedly, such as those near the tip.
   struct ItemEntry {
-  public:
-    T item;
-    typename std::list<CacheEntry>::iterator cacheIter;
+    std::unique_ptr<T> item;
+    uint64_t size;
+    bool isProtected;
+    std::list<uint64_t>::iterator queueIter;
   };
 
-  struct CacheEntry {
-  public:
-    typename std::map<uint64_t, ItemEntry>::iterator itemIter;
-  };
+  T* prepare(uint64_t index);
+  void makeRoom(uint64_t size);
+  void evict(bool fromProbation);
+  void addGhost(uint64_t index);
+  void removeItem(typename std::unordered_map<uint64_t, ItemEntry>::iterator itemIter);
+  uint64_t itemSize(uint64_t index) const;
 
   std::fstream m_itemsFile;
   std::fstream m_indexesFile;
-  size_t m_poolSize;
+  uint64_t m_cacheBudget;
   std::vector<uint64_t> m_offsets;
   uint64_t m_itemsFileSize;
-  std::map<uint64_t, ItemEntry> m_items;
-  std::list<CacheEntry> m_cache;
+  std::unordered_map<uint64_t, ItemEntry> m_items;
+  std::list<uint64_t> m_probation;
+  std::list<uint64_t> m_protected;
+  uint64_t m_probationBytes;
+  uint64_t m_protectedBytes;
+  std::list<uint64_t> m_ghosts;
+  std::unordered_map<uint64_t, std::list<uint64_t>::iterator> m_ghostIndex;
   uint64_t m_cacheHits;
   uint64_t m_cacheMisses;
 
-  T* prepare(uint64_t index);
+  std::mutex m_mutex;
+  size_t m_sharedAccessCount;
+  std::list<std::unique_ptr<T>> m_evictedItems;
+
+  // read side of m_itemsFile; misses decode from here instead of seeking the stream
+  std::unique_ptr<System::MemoryMappedFile> m_itemsMap;
+  std::list<std::unique_ptr<System::MemoryMappedFile>> m_retiredMaps;
+  std::string m_itemsFileName;
+  bool m_itemsFileDirty;
+
+  // Compressed storage: the items file holds the sealed chunks, each one zstd frame of
+  // m_chunkItems consecutive items, followed by the items of the open chunk as they are. The
+  // compressed chunk sizes are kept in "<index file>.chunks". m_offsets and m_itemsFileSize stay
+  // uncompressed offsets; in plain storage there are no sealed chunks and the two coincide.
+  static const size_t CHUNK_CACHE_SIZE = 16;
+  static const uint64_t CHUNKS_HEADER_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+
+  std::fstream m_chunksFile;
+  uint32_t m_chunkItems;
+  std::vector<uint64_t> m_chunkOffsets; // file offset of every sealed chunk, then the end of the last one
+  uint64_t m_sealedSize;
+  // decompressed chunks, most recently used last
+  std::list<std::pair<uint64_t, std::vector<uint8_t>>> m_chunkCache;
+
+  bool openChunks(const std::string& chunksFileName, uint32_t chunkItems, bool create);
+  uint64_t sealedItems() const { return (m_chunkOffsets.size() - 1) * m_chunkItems; }
+  // file offset of an uncompressed offset in the open chunk
+  uint64_t fileOffset(uint64_t offset) const { return m_chunkOffsets.back() + offset - m_sealedSize; }
+  const uint8_t* itemData(uint64_t index, uint64_t& size);
+  const std::vector<uint8_t>* loadChunk(uint64_t chunk);
+  void sealChunk();
+  void unsealChunk();
+  void writeChunkCount();
+  const uint8_t* mapItems(uint64_t begin, uint64_t end);
 };
 
-template<class T> SwappedVector<T>::SwappedVector() {
+template<class T> SwappedVector<T>::SwappedVector() : m_cacheBudget(0), m_probationBytes(0), m_protectedBytes(0),
+  m_cacheHits(0), m_cacheMisses(0), m_sharedAccessCount(0), m_itemsFileDirty(false), m_chunkItems(0), m_chunkOffsets(1, 0),
+  m_sealedSize(0) {
 }
 
 template<class T> SwappedVector<T>::~SwappedVector() {
   close();
 }
 
-template<class T> bool SwappedVector<T>::open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize) {
-  if (poolSize == 0) {
+template<class T> bool SwappedVector<T>::open(const std::string& itemFileName, const std::string& indexFileName, uint64_t cacheBudget, uint32_t chunkItems) {
+  if (cacheBudget == 0 || (chunkItems != 0 && !Common::compressionSupported())) {
     return false;
   }
 
+  Common::MemoryScope memoryScope(Common::MemorySubsystem::BlockCache);
   m_itemsFile.open(itemFileName, std::ios::in | std::ios::out | std::ios::binary);
   m_indexesFile.open(indexFileName, std::ios::in | std::ios::out | std::ios::binary);
   if (m_itemsFile && m_indexesFile) {
@@ -226,6 +304,9 @@ template<class T> bool SwappedVector<T>::open(const std::string& itemFileName, c
 
     m_offsets.swap(offsets);
     m_itemsFileSize = itemsFileSize;
+    if (chunkItems != 0 && !openChunks(indexFileName + ".chunks", chunkItems, false)) {
+      return false;
+    }
   } else {
     m_itemsFile.open(itemFileName, std::ios::out | std::ios::binary);
     m_itemsFile.close();
@@ -241,16 +322,76 @@ template<class T> bool SwappedVector<T>::open(const std::string& itemFileName, c
     m_indexesFile.open(indexFileName, std::ios::in | std::ios::out | std::ios::binary);
     m_offsets.clear();
     m_itemsFileSize = 0;
+    if (chunkItems != 0 && !openChunks(indexFileName + ".chunks", chunkItems, true)) {
+      return false;
+    }
   }
 
-  m_poolSize = poolSize;
+  m_cacheBudget = cacheBudget;
+  m_itemsFileName = itemFileName;
+  m_itemsMap.reset();
+  m_retiredMaps.clear();
+  m_itemsFileDirty = false;
   m_items.clear();
-  m_cache.clear();
+  m_probation.clear();
+  m_protected.clear();
+  m_probationBytes = 0;
+  m_protectedBytes = 0;
+  m_ghosts.clear();
+  m_ghostIndex.clear();
   m_cacheHits = 0;
   m_cacheMisses = 0;
+  m_chunkCache.clear();
   return true;
 }
 
+/// \pre m_offsets and m_itemsFileSize describe the opened store
+template<class T> bool SwappedVector<T>::openChunks(const std::string& chunksFileName, uint32_t chunkItems, bool create) {
+  m_chunkItems = chunkItems;
+  m_chunkOffsets.assign(1, 0);
+  m_sealedSize = 0;
+  if (!create) {
+    m_chunksFile.open(chunksFileName, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_chunksFile) {
+      // without chunk sizes only an empty store can be taken for a compressed one
+      return m_offsets.empty() && openChunks(chunksFileName, chunkItems, true);
+    }
+
+    uint64_t count;
+    m_chunksFile.read(reinterpret_cast<char*>(&count), sizeof count);
+    m_chunksFile.read(reinterpret_cast<char*>(&m_chunkItems), sizeof m_chunkItems);
+    if (!m_chunksFile || m_chunkItems == 0 || count > m_offsets.size() / m_chunkItems) {
+      return false;
+    }
+
+    for (uint64_t i = 0; i < count; ++i) {
+      uint32_t chunkSize;
+      m_chunksFile.read(reinterpret_cast<char*>(&chunkSize), sizeof chunkSize);
+      if (!m_chunksFile) {
+        return false;
+      }
+
+      m_chunkOffsets.push_back(m_chunkOffsets.back() + chunkSize);
+    }
+
+    m_sealedSize = sealedItems() < m_offsets.size() ? m_offsets[sealedItems()] : m_itemsFileSize;
+    return true;
+  }
+
+  m_chunksFile.close();
+  m_chunksFile.open(chunksFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+  uint64_t count = 0;
+  m_chunksFile.write(reinterpret_cast<char*>(&count), sizeof count);
+  m_chunksFile.write(reinterpret_cast<char*>(&m_chunkItems), sizeof m_chunkItems);
+  if (!m_chunksFile) {
+    return false;
+  }
+
+  m_chunksFile.close();
+  m_chunksFile.open(chunksFileName, std::ios::in | std::ios::out | std::ios::binary);
+  return static_cast<bool>(m_chunksFile);
+}
+
 template<class T> void SwappedVector<T>::close() {
   std::cout << "SwappedVector cache hits: " << m_cacheHits << ", misses: " << m_cacheMisses << " (" << std::fixed << std::setprecision(2) << static_cast<double>(m_cacheMisses) / (m_cacheHits + m_cacheMisses) * 100 << "%)" << std::endl;
 }
@@ -272,14 +413,16 @@ template<class T> typename SwappedVector<T>::const_iterator SwappedVector<T>::en
 }
 
 template<class T> const T& SwappedVector<T>::operator[](uint64_t index) {
+  std::lock_guard<std::mutex> lock(m_mutex);
   auto itemIter = m_items.find(index);
   if (itemIter != m_items.end()) {
-    if (itemIter->second.cacheIter != --m_cache.end()) {
-      m_cache.splice(m_cache.end(), m_cache, itemIter->second.cacheIter);
+    // repeated reads while on probation are usually one caller touching the item several times
+    if (itemIter->second.isProtected) {
+      m_protected.splice(m_protected.end(), m_protected, itemIter->second.queueIter);
     }
 
     ++m_cacheHits;
-    return itemIter->second.item;
+    return *itemIter->second.item;
   }
 
   if (index >= m_offsets.size()) {
@@ -290,12 +433,22 @@ template<class T> const T& SwappedVector<T>::operator[](uint64_t index) {
     throw std::runtime_error("SwappedVector::operator[]");
   }
 
-  m_itemsFile.seekg(m_offsets[index]);
+  Common::MemoryScope memoryScope(Common::MemorySubsystem::BlockCache);
   T tempItem;
-  
-  Common::StdInputStream stream(m_itemsFile);
-  CryptoNote::BinaryInputStreamSerializer archive(stream);
-  serialize(tempItem, archive);
+  uint64_t itemSize;
+  const uint8_t* data = itemData(index, itemSize);
+  if (data != nullptr) {
+    Common::MemoryInputStream stream(data, static_cast<size_t>(itemSize));
+    CryptoNote::BinaryInputStreamSerializer archive(stream);
+    serialize(tempItem, archive);
+  } else if (index < sealedItems()) {
+    throw std::runtime_error("SwappedVector::operator[]");
+  } else {
+    m_itemsFile.seekg(fileOffset(m_offsets[index]));
+    Common::StdInputStream stream(m_itemsFile);
+    CryptoNote::BinaryInputStreamSerializer archive(stream);
+    serialize(tempItem, archive);
+  }
 
   T* item = prepare(index);
   std::swap(tempItem, *item);
@@ -311,7 +464,88 @@ template<class T> const T& SwappedVector<T>::back() {
   return operator[](m_offsets.size() - 1);
 }
 
+template<class T> bool SwappedVector<T>::getSerializedItem(uint64_t index, const uint8_t*& data, uint64_t& size, std::vector<uint8_t>& buffer) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (index >= m_offsets.size()) {
+    return false;
+  }
+
+  data = itemData(index, size);
+  if (data != nullptr && index < sealedItems()) {
+    // the chunk cache may drop the chunk as soon as the lock is released
+    buffer.assign(data, data + size);
+    data = buffer.data();
+  }
+
+  return data != nullptr;
+}
+
+template<class T> void SwappedVector<T>::beginSharedAccess() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_sharedAccessCount;
+}
+
+template<class T> void SwappedVector<T>::endSharedAccess() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (--m_sharedAccessCount == 0) {
+    m_evictedItems.clear();
+    m_retiredMaps.clear();
+  }
+}
+
+template<class T> void SwappedVector<T>::cacheStats(uint64_t& hits, uint64_t& misses) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  hits = m_cacheHits;
+  misses = m_cacheMisses;
+}
+
+template<class T> void SwappedVector<T>::cacheUsage(uint64_t& items, uint64_t& bytes) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  items = m_items.size();
+  bytes = m_probationBytes + m_protectedBytes;
+}
+
+template<class T> void SwappedVector<T>::setCacheBudget(uint64_t cacheBudget) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_cacheBudget = cacheBudget;
+  makeRoom(0);
+}
+
+template<class T> void SwappedVector<T>::prefetch(uint64_t index, uint64_t count) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (index >= m_offsets.size()) {
+    return;
+  }
+
+  uint64_t last = std::min<uint64_t>(index + count, m_offsets.size()) - 1;
+  while (index <= last && m_items.count(index) != 0) {
+    ++index;
+  }
+
+  while (last > index && m_items.count(last) != 0) {
+    --last;
+  }
+
+  if (index > last) {
+    return;
+  }
+
+  uint64_t begin = index < sealedItems() ? m_chunkOffsets[index / m_chunkItems] : fileOffset(m_offsets[index]);
+  uint64_t end = last < sealedItems() ? m_chunkOffsets[last / m_chunkItems + 1] : fileOffset(m_offsets[last] + itemSize(last));
+  const uint8_t* data = mapItems(begin, end);
+  if (data != nullptr) {
+    m_itemsMap->willNeed(data, end - begin);
+  }
+}
+
+template<class T> void SwappedVector<T>::storageUsage(uint64_t& itemBytes, uint64_t& fileBytes) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  itemBytes = m_itemsFileSize;
+  fileBytes = fileOffset(m_itemsFileSize);
+}
+
 template<class T> void SwappedVector<T>::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
   if (!m_indexesFile) {
     throw std::runtime_error("SwappedVector::clear");
   }
@@ -325,15 +559,31 @@ template<class T> void SwappedVector<T>::clear() {
 
   m_offsets.clear();
   m_itemsFileSize = 0;
-  m_items.clear();
-  m_cache.clear();
+  if (m_chunkItems != 0) {
+    m_chunkOffsets.assign(1, 0);
+    m_sealedSize = 0;
+    m_chunkCache.clear();
+    writeChunkCount();
+  }
+
+  while (!m_items.empty()) {
+    removeItem(m_items.begin());
+  }
+
+  m_ghosts.clear();
+  m_ghostIndex.clear();
 }
 
 template<class T> void SwappedVector<T>::pop_back() {
+  std::lock_guard<std::mutex> lock(m_mutex);
   if (!m_indexesFile) {
     throw std::runtime_error("SwappedVector::pop_back");
   }
 
+  if (!m_offsets.empty() && m_offsets.size() == sealedItems()) {
+    unsealChunk();
+  }
+
   m_indexesFile.seekp(0);
   uint64_t count = m_offsets.size() - 1;
   m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
@@ -345,12 +595,19 @@ template<class T> void SwappedVector<T>::pop_back() {
   m_offsets.pop_back();
   auto itemIter = m_items.find(m_offsets.size());
   if (itemIter != m_items.end()) {
-    m_cache.erase(itemIter->second.cacheIter);
-    m_items.erase(itemIter);
+    removeItem(itemIter);
+  }
+
+  auto ghostIter = m_ghostIndex.find(m_offsets.size());
+  if (ghostIter != m_ghostIndex.end()) {
+    m_ghosts.erase(ghostIter->second);
+    m_ghostIndex.erase(ghostIter);
   }
 }
 
 template<class T> void SwappedVector<T>::push_back(const T& item) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Common::MemoryScope memoryScope(Common::MemorySubsystem::BlockCache);
   uint64_t itemsFileSize;
 
   {
@@ -358,13 +615,14 @@ template<class T> void SwappedVector<T>::push_back(const T& item) {
       throw std::runtime_error("SwappedVector::push_back");
     }
 
-    m_itemsFile.seekp(m_itemsFileSize);
+    uint64_t itemBegin = fileOffset(m_itemsFileSize);
+    m_itemsFile.seekp(itemBegin);
 
     Common::StdOutputStream stream(m_itemsFile);
     CryptoNote::BinaryOutputStreamSerializer archive(stream);
     serialize(const_cast<T&>(item), archive);
 
-    itemsFileSize = m_itemsFile.tellp();
+    itemsFileSize = m_itemsFileSize + (static_cast<uint64_t>(m_itemsFile.tellp()) - itemBegin);
   }
 
   {
@@ -389,21 +647,232 @@ template<class T> void SwappedVector<T>::push_back(const T& item) {
 
   m_offsets.push_back(m_itemsFileSize);
   m_itemsFileSize = itemsFileSize;
+  m_itemsFileDirty = true;
 
   T* newItem = prepare(m_offsets.size() - 1);
   *newItem = item;
+
+  if (m_chunkItems != 0 && m_offsets.size() - sealedItems() == m_chunkItems) {
+    sealChunk();
+  }
 }
 
+/// \pre m_mutex is locked and index is not cached
 template<class T> T* SwappedVector<T>::prepare(uint64_t index) {
-  if (m_items.size() == m_poolSize) {
-    auto cacheIter = m_cache.begin();
-    m_items.erase(cacheIter->itemIter);
-    m_cache.erase(cacheIter);
+  bool wasGhost = false;
+  auto ghostIter = m_ghostIndex.find(index);
+  if (ghostIter != m_ghostIndex.end()) {
+    m_ghosts.erase(ghostIter->second);
+    m_ghostIndex.erase(ghostIter);
+    wasGhost = true;
+  }
+
+  uint64_t size = itemSize(index);
+  makeRoom(size);
+
+  ItemEntry& entry = m_items[index];
+  entry.item.reset(new T());
+  entry.size = size;
+  entry.isProtected = wasGhost;
+  if (wasGhost) {
+    entry.queueIter = m_protected.insert(m_protected.end(), index);
+    m_protectedBytes += size;
+  } else {
+    entry.queueIter = m_probation.insert(m_probation.end(), index);
+    m_probationBytes += size;
+  }
+
+  return entry.item.get();
+}
+
+/// \pre m_mutex is locked
+template<class T> void SwappedVector<T>::makeRoom(uint64_t size) {
+  while (!m_items.empty() && m_probationBytes + m_protectedBytes + size > m_cacheBudget) {
+    evict(m_protected.empty() || m_probationBytes > m_cacheBudget / 4);
+  }
+}
+
+/// \pre m_mutex is locked
+template<class T> void SwappedVector<T>::evict(bool fromProbation) {
+  if (m_probation.empty()) {
+    fromProbation = false;
+  }
+
+  uint64_t index = fromProbation ? m_probation.front() : m_protected.front();
+  removeItem(m_items.find(index));
+  if (fromProbation) {
+    addGhost(index);
+  }
+}
+
+/// \pre m_mutex is locked
+template<class T> void SwappedVector<T>::addGhost(uint64_t index) {
+  m_ghostIndex[index] = m_ghosts.insert(m_ghosts.end(), index);
+  while (m_ghosts.size() > std::max<size_t>(m_items.size(), 1024)) {
+    m_ghostIndex.erase(m_ghosts.front());
+    m_ghosts.pop_front();
+  }
+}
+
+/// \pre m_mutex is locked
+template<class T> void SwappedVector<T>::removeItem(typename std::unordered_map<uint64_t, ItemEntry>::iterator itemIter) {
+  ItemEntry& entry = itemIter->second;
+  if (entry.isProtected) {
+    m_protected.erase(entry.queueIter);
+    m_protectedBytes -= entry.size;
+  } else {
+    m_probation.erase(entry.queueIter);
+    m_probationBytes -= entry.size;
+  }
+
+  if (m_sharedAccessCount != 0) {
+    m_evictedItems.push_back(std::move(entry.item));
+  }
+
+  m_items.erase(itemIter);
+}
+
+/// \pre m_mutex is locked
+template<class T> uint64_t SwappedVector<T>::itemSize(uint64_t index) const {
+  uint64_t end = index + 1 < m_offsets.size() ? m_offsets[index + 1] : m_itemsFileSize;
+  return end - m_offsets[index];
+}
+
+/// \pre m_mutex is locked
+template<class T> const uint8_t* SwappedVector<T>::itemData(uint64_t index, uint64_t& size) {
+  size = itemSize(index);
+  if (index < sealedItems()) {
+    const std::vector<uint8_t>* chunk = loadChunk(index / m_chunkItems);
+    if (chunk == nullptr) {
+      return nullptr;
+    }
+
+    return chunk->data() + (m_offsets[index] - m_offsets[index - index % m_chunkItems]);
+  }
+
+  uint64_t begin = fileOffset(m_offsets[index]);
+  return mapItems(begin, begin + size);
+}
+
+/// \pre m_mutex is locked
+template<class T> const std::vector<uint8_t>* SwappedVector<T>::loadChunk(uint64_t chunk) {
+  for (auto it = m_chunkCache.begin(); it != m_chunkCache.end(); ++it) {
+    if (it->first == chunk) {
+      m_chunkCache.splice(m_chunkCache.end(), m_chunkCache, it);
+      return &m_chunkCache.back().second;
+    }
+  }
+
+  uint64_t begin = m_chunkOffsets[chunk];
+  uint64_t end = m_chunkOffsets[chunk + 1];
+  std::vector<uint8_t> compressed;
+  const uint8_t* data = mapItems(begin, end);
+  if (data == nullptr) {
+    compressed.resize(static_cast<size_t>(end - begin));
+    m_itemsFile.seekg(begin);
+    m_itemsFile.read(reinterpret_cast<char*>(compressed.data()), compressed.size());
+    if (!m_itemsFile) {
+      m_itemsFile.clear();
+      return nullptr;
+    }
+
+    data = compressed.data();
+  }
+
+  std::vector<uint8_t> items;
+  if (!Common::decompress(data, static_cast<size_t>(end - begin), items)) {
+    return nullptr;
+  }
+
+  if (m_chunkCache.size() == CHUNK_CACHE_SIZE) {
+    m_chunkCache.pop_front();
+  }
+
+  m_chunkCache.emplace_back(chunk, std::move(items));
+  return &m_chunkCache.back().second;
+}
+
+/// \pre m_mutex is locked and the open chunk is full
+template<class T> void SwappedVector<T>::sealChunk() {
+  uint64_t begin = m_chunkOffsets.back();
+  std::vector<uint8_t> items(static_cast<size_t>(m_itemsFileSize - m_sealedSize));
+  std::vector<uint8_t> compressed;
+  m_itemsFile.seekg(begin);
+  m_itemsFile.read(reinterpret_cast<char*>(items.data()), items.size());
+  if (!m_itemsFile || !Common::compress(items.data(), items.size(), compressed)) {
+    throw std::runtime_error("SwappedVector::sealChunk");
+  }
+
+  // the chunk replaces the items it holds; what is left of them past its end is overwritten by the next items
+  m_itemsFile.seekp(begin);
+  m_itemsFile.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+  m_chunksFile.seekp(CHUNKS_HEADER_SIZE + sizeof(uint32_t) * (m_chunkOffsets.size() - 1));
+  uint32_t chunkSize = static_cast<uint32_t>(compressed.size());
+  m_chunksFile.write(reinterpret_cast<char*>(&chunkSize), sizeof chunkSize);
+  if (!m_itemsFile || !m_chunksFile) {
+    throw std::runtime_error("SwappedVector::sealChunk");
+  }
+
+  m_itemsFileDirty = true;
+  m_chunkOffsets.push_back(begin + compressed.size());
+  m_sealedSize = m_itemsFileSize;
+  writeChunkCount();
+}
+
+/// \pre m_mutex is locked, the open chunk is empty and a chunk is sealed
+template<class T> void SwappedVector<T>::unsealChunk() {
+  uint64_t chunk = m_chunkOffsets.size() - 2;
+  const std::vector<uint8_t>* items = loadChunk(chunk);
+  if (items == nullptr) {
+    throw std::runtime_error("SwappedVector::unsealChunk");
+  }
+
+  m_itemsFile.seekp(m_chunkOffsets[chunk]);
+  m_itemsFile.write(reinterpret_cast<const char*>(items->data()), items->size());
+  if (!m_itemsFile) {
+    throw std::runtime_error("SwappedVector::unsealChunk");
+  }
+
+  m_itemsFileDirty = true;
+  m_chunkCache.pop_back();
+  m_chunkOffsets.pop_back();
+  m_sealedSize = m_offsets[chunk * m_chunkItems];
+  writeChunkCount();
+}
+
+/// \pre m_mutex is locked
+template<class T> void SwappedVector<T>::writeChunkCount() {
+  m_chunksFile.seekp(0);
+  uint64_t count = m_chunkOffsets.size() - 1;
+  m_chunksFile.write(reinterpret_cast<char*>(&count), sizeof count);
+  m_chunksFile.flush();
+  if (!m_chunksFile) {
+    throw std::runtime_error("SwappedVector::writeChunkCount");
+  }
+}
+
+/// \pre m_mutex is locked
+template<class T> const uint8_t* SwappedVector<T>::mapItems(uint64_t begin, uint64_t end) {
+  if (m_itemsFileDirty) {
+    m_itemsFile.flush();
+    m_itemsFileDirty = false;
+  }
+
+  // the file only grows, so the mapping has to be refreshed once it no longer covers the range
+  if (!m_itemsMap || m_itemsMap->size() < end) {
+    std::unique_ptr<System::MemoryMappedFile> itemsMap(new System::MemoryMappedFile());
+    std::error_code ec;
+    itemsMap->open(m_itemsFileName, ec);
+    if (ec || itemsMap->size() < end) {
+      return nullptr;
+    }
+
+    if (m_itemsMap && m_sharedAccessCount != 0) {
+      m_retiredMaps.push_back(std::move(m_itemsMap));
+    }
+
+    m_itemsMap = std::move(itemsMap);
   }
 
-  auto itemIter = m_items.insert(std::make_pair(index, ItemEntry()));
-  CacheEntry cacheEntry = { itemIter.first };
-  auto cacheIter = m_cache.insert(m_cache.end(), cacheEntry);
-  itemIter.first->second.cacheIter = cacheIter;
-  return &itemIter.first->second.item;
+  return m_itemsMap->data() + begin;
 }
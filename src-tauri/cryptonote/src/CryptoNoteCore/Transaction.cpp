@@ -16,14 +16,18 @@
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 
 #include "ITransaction.h"
+#include "TransactionApi.h"
 #include "TransactionApiExtra.h"
 #include "TransactionUtils.h"
 
 #include "Account.h"
 #include "CryptoNoteCore/CryptoNoteTools.h"
 #include "CryptoNoteConfig.h"
+#include "Common/ThreadPool.h"
 
 #include <boost/optional.hpp>
+#include <algorithm>
+#include <future>
 #include <numeric>
 #include <unordered_set>
 
@@ -33,10 +37,22 @@ namespace {
 
   using namespace CryptoNote;
 
-  void derivePublicKey(const AccountPublicAddress& to, const SecretKey& txKey, size_t outputIndex, PublicKey& ephemeralKey) {
+  KeyDerivation derivePublicKey(const AccountPublicAddress& to, const SecretKey& txKey, size_t outputIndex, PublicKey& ephemeralKey) {
     KeyDerivation derivation;
     generate_key_derivation(to.viewPublicKey, txKey, derivation);
     derive_public_key(derivation, outputIndex, to.spendPublicKey, ephemeralKey);
+    return derivation;
+  }
+
+  void makeRingSignature(const Hash& prefixHash, const KeyInput& input, const TransactionTypes::InputKeyInfo& info, const KeyPair& ephKeys, std::vector<Signature>& signatures) {
+    std::vector<const PublicKey*> keysPtrs;
+    keysPtrs.reserve(info.outputs.size());
+    for (const auto& o : info.outputs) {
+      keysPtrs.push_back(&o.targetKey);
+    }
+
+    signatures.resize(keysPtrs.size());
+    generate_ring_signature(prefixHash, input.keyImage, keysPtrs, ephKeys.secretKey, info.realOutput.transactionIndex, signatures.data());
   }
 
 }
@@ -63,6 +79,7 @@ namespace CryptoNote {
     virtual uint64_t getUnlockTime() const override;
     virtual bool getPaymentId(Hash& hash) const override;
     virtual bool getExtraNonce(BinaryArray& nonce) const override;
+    virtual bool getViewTags(std::vector<uint8_t>& viewTags) const override;
     virtual BinaryArray getExtra() const override;
 
     // inputs
@@ -90,18 +107,22 @@ namespace CryptoNote {
 
     // get serialized transaction
     virtual BinaryArray getTransactionData() const override;
+    virtual size_t getTransactionDataSize() const override;
     TransactionPrefix getTransactionPrefix() const override;
     // ITransactionWriter
+    virtual void reset() override;
 
     virtual void setUnlockTime(uint64_t unlockTime) override;
     virtual void setPaymentId(const Hash& hash) override;
     virtual void setExtraNonce(const BinaryArray& nonce) override;
     virtual void appendExtra(const BinaryArray& extraData) override;
+    virtual void appendViewTags() override;
 
     // Inputs/Outputs 
     virtual size_t addInput(const KeyInput& input) override;
     virtual size_t addInput(const MultisignatureInput& input) override;
     virtual size_t addInput(const AccountKeys& senderKeys, const TransactionTypes::InputKeyInfo& info, KeyPair& ephKeys) override;
+    virtual size_t addInput(const AccountKeys& senderKeys, const TransactionTypes::InputKeyInfo& info, const KeyImage& keyImage, KeyPair& ephKeys) override;
 
     virtual size_t addOutput(uint64_t amount, const AccountPublicAddress& to) override;
     virtual size_t addOutput(uint64_t amount, const std::vector<AccountPublicAddress>& to, uint32_t requiredSignatures, uint32_t term = 0) override;
@@ -109,6 +130,7 @@ namespace CryptoNote {
     virtual size_t addOutput(uint64_t amount, const MultisignatureOutput& out) override;
 
     virtual void signInputKey(size_t input, const TransactionTypes::InputKeyInfo& info, const KeyPair& ephKeys) override;
+    virtual void signInputKeys(const std::vector<TransactionTypes::InputKeyInfo>& infos, const std::vector<KeyPair>& ephKeys, Common::ThreadPool& workers) override;
     virtual void signInputMultisignature(size_t input, const PublicKey& sourceTransactionKey, size_t outputIndex, const AccountKeys& accountKeys) override;
     virtual void signInputMultisignature(size_t input, const KeyPair& ephemeralKeys) override;
 
@@ -122,6 +144,8 @@ namespace CryptoNote {
     void invalidateHash();
 
     std::vector<Signature>& getSignatures(size_t input);
+    std::vector<Signature> takeSpareSignatures();
+    void recycleSignatures(std::vector<Signature>& signatures);
 
     const SecretKey& txSecretKey() const {
       if (!secretKey) {
@@ -140,8 +164,18 @@ namespace CryptoNote {
     boost::optional<SecretKey> secretKey;
     mutable boost::optional<Hash> transactionHash;
     TransactionExtra extra;
+    // tags of the outputs added through this object, 0 where the output has none
+    std::vector<uint8_t> viewTags;
+    // emptied signature vectors of earlier transactions, handed to inputs as they get signed
+    std::vector<std::vector<Signature>> spareSignatures;
   };
 
+  namespace {
+    // released builders kept by each thread, a payout run rarely holds more than a few at once
+    const size_t TRANSACTION_POOL_LIMIT = 4;
+    thread_local std::vector<std::unique_ptr<TransactionImpl>> transactionPool;
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   // class Transaction implementation
@@ -159,17 +193,53 @@ namespace CryptoNote {
     return std::unique_ptr<ITransaction>(new TransactionImpl(tx));
   }
 
+  PooledTransaction acquireTransaction() {
+    if (transactionPool.empty()) {
+      return PooledTransaction(new TransactionImpl());
+    }
+
+    std::unique_ptr<TransactionImpl> transaction = std::move(transactionPool.back());
+    transactionPool.pop_back();
+    transaction->reset();
+    return PooledTransaction(transaction.release());
+  }
+
+  void TransactionReleaser::operator()(ITransaction* transaction) const {
+    // acquireTransaction is the only source of these, so it is always a TransactionImpl
+    std::unique_ptr<TransactionImpl> released(static_cast<TransactionImpl*>(transaction));
+    if (transactionPool.size() < TRANSACTION_POOL_LIMIT) {
+      try {
+        transactionPool.push_back(std::move(released));
+      } catch (std::bad_alloc&) {
+      }
+    }
+  }
+
   TransactionImpl::TransactionImpl() {   
+    reset();
+  }
+
+  void TransactionImpl::reset() {
     CryptoNote::KeyPair txKeys(CryptoNote::generateKeyPair());
 
-    TransactionExtraPublicKey pk = { txKeys.publicKey };
-    extra.set(pk);
+    for (auto& signatures : transaction.signatures) {
+      recycleSignatures(signatures);
+    }
 
     transaction.version = TRANSACTION_VERSION_1;
     transaction.unlockTime = 0;
-    transaction.extra = extra.serialize();
+    transaction.inputs.clear();
+    transaction.outputs.clear();
+    transaction.signatures.clear();
+
+    TransactionExtraPublicKey pk = { txKeys.publicKey };
+    extra.clear();
+    extra.set(pk);
+    extra.serialize(transaction.extra);
 
     secretKey = txKeys.secretKey;
+    transactionHash = boost::none;
+    viewTags.clear();
   }
 
   TransactionImpl::TransactionImpl(const BinaryArray& ba) {
@@ -275,6 +345,32 @@ namespace CryptoNote {
     return addInput(input);
   }
 
+  size_t TransactionImpl::addInput(const AccountKeys& senderKeys, const TransactionTypes::InputKeyInfo& info, const KeyImage& keyImage, KeyPair& ephKeys) {
+    checkIfSigning();
+    if (info.realOutput.transactionIndex >= info.outputs.size()) {
+      throw std::runtime_error("Real output index is out of the ring");
+    }
+
+    // the real output's key is the ephemeral public key, only its secret has to be derived
+    KeyDerivation derivation;
+    if (!generate_key_derivation(info.realOutput.transactionPublicKey, senderKeys.viewSecretKey, derivation)) {
+      throw std::runtime_error("Failed to generate key derivation");
+    }
+
+    derive_secret_key(derivation, info.realOutput.outputInTransaction, senderKeys.spendSecretKey, ephKeys.secretKey);
+    ephKeys.publicKey = info.outputs[info.realOutput.transactionIndex].targetKey;
+
+    KeyInput input;
+    input.amount = info.amount;
+    input.keyImage = keyImage;
+    for (const auto& out : info.outputs) {
+      input.outputIndexes.push_back(out.outputIndex);
+    }
+
+    input.outputIndexes = absolute_output_offsets_to_relative(input.outputIndexes);
+    return addInput(input);
+  }
+
   size_t TransactionImpl::addInput(const MultisignatureInput& input) {
     checkIfSigning();
     transaction.inputs.push_back(input);
@@ -287,9 +383,12 @@ namespace CryptoNote {
     checkIfSigning();
 
     KeyOutput outKey;
-    derivePublicKey(to, txSecretKey(), transaction.outputs.size(), outKey.key);
+    size_t outputIndex = transaction.outputs.size();
+    KeyDerivation derivation = derivePublicKey(to, txSecretKey(), outputIndex, outKey.key);
     TransactionOutput out = { amount, outKey };
     transaction.outputs.emplace_back(out);
+    viewTags.resize(outputIndex);
+    viewTags.push_back(deriveViewTag(derivation, outputIndex));
     invalidateHash();
 
     return transaction.outputs.size() - 1;
@@ -339,24 +438,64 @@ namespace CryptoNote {
     const auto& input = boost::get<KeyInput>(getInputChecked(transaction, index, TransactionTypes::InputType::Key));
     Hash prefixHash = getTransactionPrefixHash();
 
-    std::vector<Signature> signatures;
-    std::vector<const PublicKey*> keysPtrs;
+    makeRingSignature(prefixHash, input, info, ephKeys, getSignatures(index));
+    invalidateHash();
+  }
 
-    for (const auto& o : info.outputs) {
-      keysPtrs.push_back(reinterpret_cast<const PublicKey*>(&o.targetKey));
+  void TransactionImpl::signInputKeys(const std::vector<TransactionTypes::InputKeyInfo>& infos, const std::vector<KeyPair>& ephKeys, Common::ThreadPool& workers) {
+    if (infos.size() != ephKeys.size()) {
+      throw std::invalid_argument("Input key info and ephemeral key counts differ");
     }
 
-    signatures.resize(keysPtrs.size());
+    // validate every input before handing work out, so a bad index never leaves
+    // the transaction half-signed
+    std::vector<const KeyInput*> inputs;
+    inputs.reserve(infos.size());
+    for (size_t i = 0; i < infos.size(); ++i) {
+      inputs.push_back(&boost::get<KeyInput>(getInputChecked(transaction, i, TransactionTypes::InputType::Key)));
+    }
 
-    generate_ring_signature(
-      reinterpret_cast<const Hash&>(prefixHash),
-      reinterpret_cast<const KeyImage&>(input.keyImage),
-      keysPtrs,
-      reinterpret_cast<const SecretKey&>(ephKeys.secretKey),
-      info.realOutput.transactionIndex,
-      signatures.data());
+    // signatures are not part of the prefix, so one hash serves every input
+    const Hash prefixHash = getTransactionPrefixHash();
+
+    std::vector<std::vector<Signature>> signatures;
+    signatures.reserve(infos.size());
+    std::vector<std::future<void>> pending;
+    pending.reserve(infos.size());
+    for (size_t i = 0; i < infos.size(); ++i) {
+      signatures.push_back(takeSpareSignatures());
+      const KeyInput* input = inputs[i];
+      const TransactionTypes::InputKeyInfo* info = &infos[i];
+      const KeyPair* keys = &ephKeys[i];
+      std::vector<Signature>* target = &signatures[i];
+      pending.push_back(workers.submit([&prefixHash, input, info, keys, target] {
+        makeRingSignature(prefixHash, *input, *info, *keys, *target);
+      }));
+    }
+
+    // collect every future before rethrowing so no task outlives the references it holds
+    std::exception_ptr failure;
+    for (size_t i = 0; i < pending.size(); ++i) {
+      try {
+        pending[i].get();
+      } catch (...) {
+        if (!failure) {
+          failure = std::current_exception();
+        }
+      }
+    }
+
+    if (failure) {
+      for (auto& unused : signatures) {
+        recycleSignatures(unused);
+      }
+      std::rethrow_exception(failure);
+    }
+
+    for (size_t i = 0; i < signatures.size(); ++i) {
+      getSignatures(i).swap(signatures[i]);
+    }
 
-    getSignatures(index) = signatures;
     invalidateHash();
   }
 
@@ -405,13 +544,38 @@ namespace CryptoNote {
       throw std::runtime_error("Invalid input index");
     }
 
-    return transaction.signatures[input];
+    std::vector<Signature>& signatures = transaction.signatures[input];
+    if (signatures.capacity() == 0) {
+      signatures = takeSpareSignatures();
+    }
+    return signatures;
+  }
+
+  std::vector<Signature> TransactionImpl::takeSpareSignatures() {
+    if (spareSignatures.empty()) {
+      return std::vector<Signature>();
+    }
+
+    std::vector<Signature> signatures = std::move(spareSignatures.back());
+    spareSignatures.pop_back();
+    return signatures;
+  }
+
+  void TransactionImpl::recycleSignatures(std::vector<Signature>& signatures) {
+    if (signatures.capacity() != 0) {
+      signatures.clear();
+      spareSignatures.push_back(std::move(signatures));
+    }
   }
 
   BinaryArray TransactionImpl::getTransactionData() const {
     return toBinaryArray(transaction);
   }
 
+  size_t TransactionImpl::getTransactionDataSize() const {
+    return getObjectBinarySize(transaction);
+  }
+
   TransactionPrefix TransactionImpl::getTransactionPrefix() const
   {
     return transaction;
@@ -440,7 +604,7 @@ namespace CryptoNote {
     checkIfSigning();
     TransactionExtraNonce extraNonce = { nonce };
     extra.set(extraNonce);
-    transaction.extra = extra.serialize();
+    extra.serialize(transaction.extra);
     invalidateHash();
   }
 
@@ -450,6 +614,24 @@ namespace CryptoNote {
       transaction.extra.end(), extraData.begin(), extraData.end());
   }
 
+  void TransactionImpl::appendViewTags() {
+    checkIfSigning();
+    viewTags.resize(transaction.outputs.size());
+    bool tagged = std::any_of(viewTags.begin(), viewTags.end(), [](uint8_t tag) { return tag != 0; });
+    if (!tagged || viewTags.size() > TX_EXTRA_VIEW_TAGS_MAX_COUNT) {
+      return;
+    }
+
+    BinaryArray nonce;
+    setViewTagsToTransactionExtraNonce(nonce, viewTags);
+    addExtraNonceToTransactionExtra(transaction.extra, nonce);
+    invalidateHash();
+  }
+
+  bool TransactionImpl::getViewTags(std::vector<uint8_t>& tags) const {
+    return TransactionExtraIndex(transaction.extra).getViewTags(transaction.extra, tags);
+  }
+
   bool TransactionImpl::getExtraNonce(BinaryArray& nonce) const {
     TransactionExtraNonce extraNonce;
     if (extra.get(extraNonce)) {
@@ -20,11 +20,28 @@
 #include <memory>
 #include "ITransaction.h"
 
+namespace Common {
+class Arena;
+}
+
 namespace CryptoNote {
   std::unique_ptr<ITransaction> createTransaction();
   std::unique_ptr<ITransaction> createTransaction(const BinaryArray& transactionBlob);
   std::unique_ptr<ITransaction> createTransaction(const Transaction& tx);
 
+  struct TransactionReleaser {
+    void operator()(ITransaction* transaction) const;
+  };
+
+  // a builder from the calling thread's pool, reset for a new transaction; releasing it hands it
+  // back to the pool of the releasing thread with its capacity, so repeated builds stop allocating
+  typedef std::unique_ptr<ITransaction, TransactionReleaser> PooledTransaction;
+  PooledTransaction acquireTransaction();
+
   std::unique_ptr<ITransactionReader> createTransactionPrefix(const TransactionPrefix& prefix, const Crypto::Hash& transactionHash);
   std::unique_ptr<ITransactionReader> createTransactionPrefix(const Transaction& fullTransaction);
+
+  // readers placed in the arena, they must be released before the arena is reset
+  std::shared_ptr<ITransactionReader> createTransactionPrefix(TransactionPrefix&& prefix, const Crypto::Hash& transactionHash, Common::Arena& arena);
+  std::shared_ptr<ITransactionReader> createTransactionPrefix(const Transaction& fullTransaction, Common::Arena& arena);
 }
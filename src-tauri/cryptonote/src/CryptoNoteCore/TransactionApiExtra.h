@@ -29,6 +29,10 @@ namespace CryptoNote {
       parse(extra);        
     }
 
+    void clear() {
+      fields.clear();
+    }
+
     bool parse(const std::vector<uint8_t>& extra) {
       fields.clear();
       return CryptoNote::parseTransactionExtra(extra, fields);
@@ -74,6 +78,12 @@ namespace CryptoNote {
       return extra;
     }
 
+    // overwrites extra in place, keeping its capacity
+    void serialize(std::vector<uint8_t>& extra) const {
+      extra.clear();
+      writeTransactionExtra(extra, fields);
+    }
+
   private:
 
     std::vector<CryptoNote::TransactionExtraField>::const_iterator find(const std::type_info& t) const {
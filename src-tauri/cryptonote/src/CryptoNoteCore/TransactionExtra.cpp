@@ -129,6 +129,240 @@ namespace CryptoNote
     return true;
   }
 
+  namespace
+  {
+    // varints follow the stream rules so that the index accepts exactly what parseTransactionExtra accepts
+    template <typename T>
+    T readExtraVarint(const uint8_t *data, size_t size, size_t &pos)
+    {
+      MemoryInputStream stream(data + pos, size - pos);
+      T value;
+      readVarint(stream, value);
+      pos += stream.getPosition();
+      return value;
+    }
+
+    void skipExtraBytes(size_t size, size_t &pos, uint64_t count)
+    {
+      if (count > size - pos)
+      {
+        throw std::runtime_error("Transaction extra field is truncated");
+      }
+
+      pos += static_cast<size_t>(count);
+    }
+  }
+
+  const size_t TransactionExtraIndex::NOT_FOUND;
+
+  TransactionExtraIndex::TransactionExtraIndex()
+      : m_valid(true), m_publicKeyOffset(NOT_FOUND), m_mergeMiningDepth(0), m_mergeMiningRootOffset(NOT_FOUND), m_hasTTL(false), m_ttl(0)
+  {
+    m_nonce.offset = NOT_FOUND;
+    m_nonce.size = 0;
+    m_viewTags.offset = NOT_FOUND;
+    m_viewTags.size = 0;
+  }
+
+  TransactionExtraIndex::TransactionExtraIndex(const std::vector<uint8_t> &extra) : TransactionExtraIndex()
+  {
+    scan(extra);
+  }
+
+  bool TransactionExtraIndex::scan(const std::vector<uint8_t> &extra)
+  {
+    m_valid = false;
+    m_publicKeyOffset = NOT_FOUND;
+    m_nonce.offset = NOT_FOUND;
+    m_nonce.size = 0;
+    m_viewTags.offset = NOT_FOUND;
+    m_viewTags.size = 0;
+    m_mergeMiningDepth = 0;
+    m_mergeMiningRootOffset = NOT_FOUND;
+    m_hasTTL = false;
+    m_ttl = 0;
+    m_messages.clear();
+
+    const uint8_t *data = extra.data();
+    const size_t size = extra.size();
+    size_t pos = 0;
+
+    try
+    {
+      while (pos < size)
+      {
+        switch (data[pos++])
+        {
+        case TX_EXTRA_TAG_PADDING:
+        {
+          size_t paddingSize = 1;
+          for (; pos < size && paddingSize <= TX_EXTRA_PADDING_MAX_COUNT; ++paddingSize)
+          {
+            if (data[pos++] != 0)
+            {
+              return false; // all bytes should be zero
+            }
+          }
+
+          if (paddingSize > TX_EXTRA_PADDING_MAX_COUNT)
+          {
+            return false;
+          }
+
+          break;
+        }
+
+        case TX_EXTRA_TAG_PUBKEY:
+        {
+          skipExtraBytes(size, pos, sizeof(PublicKey));
+          if (m_publicKeyOffset == NOT_FOUND)
+          {
+            m_publicKeyOffset = pos - sizeof(PublicKey);
+          }
+          break;
+        }
+
+        case TX_EXTRA_NONCE:
+        {
+          skipExtraBytes(size, pos, 1);
+          size_t nonceSize = data[pos - 1];
+          skipExtraBytes(size, pos, nonceSize);
+          if (m_nonce.offset == NOT_FOUND)
+          {
+            m_nonce.offset = pos - nonceSize;
+            m_nonce.size = nonceSize;
+          }
+
+          if (m_viewTags.offset == NOT_FOUND && nonceSize > 0 && data[pos - nonceSize] == TX_EXTRA_NONCE_VIEW_TAGS)
+          {
+            m_viewTags.offset = pos - nonceSize + 1;
+            m_viewTags.size = nonceSize - 1;
+          }
+          break;
+        }
+
+        case TX_EXTRA_MERGE_MINING_TAG:
+        {
+          // the tag is a string holding varint depth and the merkle root
+          uint64_t fieldSize = readExtraVarint<uint64_t>(data, size, pos);
+          size_t fieldOffset = pos;
+          skipExtraBytes(size, pos, fieldSize);
+
+          size_t fieldPos = 0;
+          uint64_t depth = readExtraVarint<uint64_t>(data + fieldOffset, static_cast<size_t>(fieldSize), fieldPos);
+          skipExtraBytes(static_cast<size_t>(fieldSize), fieldPos, sizeof(Hash));
+          if (m_mergeMiningRootOffset == NOT_FOUND)
+          {
+            m_mergeMiningDepth = static_cast<size_t>(depth);
+            m_mergeMiningRootOffset = fieldOffset + fieldPos - sizeof(Hash);
+          }
+          break;
+        }
+
+        case TX_EXTRA_MESSAGE_TAG:
+        {
+          uint64_t messageSize = readExtraVarint<uint64_t>(data, size, pos);
+          skipExtraBytes(size, pos, messageSize);
+          m_messages.push_back(Span{pos - static_cast<size_t>(messageSize), static_cast<size_t>(messageSize)});
+          break;
+        }
+
+        case TX_EXTRA_TTL:
+        {
+          readExtraVarint<uint8_t>(data, size, pos);
+          uint64_t ttl = readExtraVarint<uint64_t>(data, size, pos);
+          if (!m_hasTTL)
+          {
+            m_hasTTL = true;
+            m_ttl = ttl;
+          }
+          break;
+        }
+        }
+      }
+    }
+    catch (std::exception &)
+    {
+      return false;
+    }
+
+    m_valid = true;
+    return true;
+  }
+
+  bool TransactionExtraIndex::getPublicKey(const std::vector<uint8_t> &extra, PublicKey &publicKey) const
+  {
+    if (m_publicKeyOffset == NOT_FOUND)
+    {
+      return false;
+    }
+
+    memcpy(&publicKey, extra.data() + m_publicKeyOffset, sizeof(PublicKey));
+    return true;
+  }
+
+  bool TransactionExtraIndex::getNonce(const std::vector<uint8_t> &extra, BinaryArray &nonce) const
+  {
+    if (m_nonce.offset == NOT_FOUND)
+    {
+      return false;
+    }
+
+    nonce.assign(extra.begin() + m_nonce.offset, extra.begin() + m_nonce.offset + m_nonce.size);
+    return true;
+  }
+
+  bool TransactionExtraIndex::getPaymentId(const std::vector<uint8_t> &extra, Hash &paymentId) const
+  {
+    if (m_nonce.offset == NOT_FOUND || m_nonce.size != sizeof(Hash) + 1 || extra[m_nonce.offset] != TX_EXTRA_NONCE_PAYMENT_ID)
+    {
+      return false;
+    }
+
+    memcpy(&paymentId, extra.data() + m_nonce.offset + 1, sizeof(Hash));
+    return true;
+  }
+
+  bool TransactionExtraIndex::getViewTags(const std::vector<uint8_t> &extra, std::vector<uint8_t> &viewTags) const
+  {
+    if (m_viewTags.offset == NOT_FOUND)
+    {
+      return false;
+    }
+
+    viewTags.assign(extra.begin() + m_viewTags.offset, extra.begin() + m_viewTags.offset + m_viewTags.size);
+    return true;
+  }
+
+  bool TransactionExtraIndex::getMergeMiningTag(const std::vector<uint8_t> &extra, TransactionExtraMergeMiningTag &mmTag) const
+  {
+    if (m_mergeMiningRootOffset == NOT_FOUND)
+    {
+      return false;
+    }
+
+    mmTag.depth = m_mergeMiningDepth;
+    memcpy(&mmTag.merkleRoot, extra.data() + m_mergeMiningRootOffset, sizeof(Hash));
+    return true;
+  }
+
+  bool TransactionExtraIndex::getTTL(uint64_t &ttl) const
+  {
+    if (!m_hasTTL)
+    {
+      return false;
+    }
+
+    ttl = m_ttl;
+    return true;
+  }
+
+  void TransactionExtraIndex::getMessage(const std::vector<uint8_t> &extra, size_t index, tx_extra_message &message) const
+  {
+    const Span &span = m_messages.at(index);
+    message.data.assign(reinterpret_cast<const char *>(extra.data()) + span.offset, span.size);
+  }
+
   struct ExtraSerializerVisitor : public boost::static_visitor<bool>
   {
     std::vector<uint8_t> &extra;
@@ -190,14 +424,11 @@ namespace CryptoNote
 
   PublicKey getTransactionPublicKeyFromExtra(const std::vector<uint8_t> &tx_extra)
   {
-    std::vector<TransactionExtraField> tx_extra_fields;
-    parseTransactionExtra(tx_extra, tx_extra_fields);
-
-    TransactionExtraPublicKey pub_key_field;
-    if (!findTransactionExtraFieldByType(tx_extra_fields, pub_key_field))
+    PublicKey publicKey;
+    if (!TransactionExtraIndex(tx_extra).getPublicKey(tx_extra, publicKey))
       return boost::value_initialized<PublicKey>();
 
-    return pub_key_field.publicKey;
+    return publicKey;
   }
 
   bool addTransactionPublicKeyToExtra(std::vector<uint8_t> &tx_extra, const PublicKey &tx_pub_key)
@@ -243,10 +474,7 @@ namespace CryptoNote
 
   bool getMergeMiningTagFromExtra(const std::vector<uint8_t> &tx_extra, TransactionExtraMergeMiningTag &mm_tag)
   {
-    std::vector<TransactionExtraField> tx_extra_fields;
-    parseTransactionExtra(tx_extra, tx_extra_fields);
-
-    return findTransactionExtraFieldByType(tx_extra_fields, mm_tag);
+    return TransactionExtraIndex(tx_extra).getMergeMiningTag(tx_extra, mm_tag);
   }
 
   bool append_message_to_extra(std::vector<uint8_t> &tx_extra, const tx_extra_message &message)
@@ -266,25 +494,21 @@ namespace CryptoNote
 
   std::vector<std::string> get_messages_from_extra(const std::vector<uint8_t> &extra, const Crypto::PublicKey &txkey, const Crypto::SecretKey *recepient_secret_key)
   {
-    std::vector<TransactionExtraField> tx_extra_fields;
     std::vector<std::string> result;
-    if (!parseTransactionExtra(extra, tx_extra_fields))
+    TransactionExtraIndex index(extra);
+    if (!index.isValid())
     {
       return result;
     }
-    size_t i = 0;
-    for (const auto &f : tx_extra_fields)
+    for (size_t i = 0; i < index.getMessageCount(); ++i)
     {
-      if (f.type() != typeid(tx_extra_message))
-      {
-        continue;
-      }
+      tx_extra_message message;
+      index.getMessage(extra, i, message);
       std::string res;
-      if (boost::get<tx_extra_message>(f).decrypt(i, txkey, recepient_secret_key, res))
+      if (message.decrypt(i, txkey, recepient_secret_key, res))
       {
         result.push_back(res);
       }
-      ++i;
     }
     return result;
   }
@@ -318,6 +542,39 @@ namespace CryptoNote
     return true;
   }
 
+  uint8_t deriveViewTag(const KeyDerivation &derivation, size_t outputIndex)
+  {
+    struct
+    {
+      char salt[8];
+      KeyDerivation derivation;
+      char outputIndex[(sizeof(size_t) * 8 + 6) / 7];
+    } buf;
+    memcpy(buf.salt, "view_tag", sizeof(buf.salt));
+    buf.derivation = derivation;
+    char *end = buf.outputIndex;
+    Tools::write_varint(end, outputIndex);
+
+    Hash hash;
+    cn_fast_hash(&buf, end - reinterpret_cast<char *>(&buf), hash);
+    return hash.data[0];
+  }
+
+  void setViewTagsToTransactionExtraNonce(std::vector<uint8_t> &extra_nonce, const std::vector<uint8_t> &viewTags)
+  {
+    extra_nonce.clear();
+    extra_nonce.push_back(TX_EXTRA_NONCE_VIEW_TAGS);
+    extra_nonce.insert(extra_nonce.end(), viewTags.begin(), viewTags.end());
+  }
+
+  bool getViewTagsFromTransactionExtraNonce(const std::vector<uint8_t> &extra_nonce, std::vector<uint8_t> &viewTags)
+  {
+    if (extra_nonce.empty() || TX_EXTRA_NONCE_VIEW_TAGS != extra_nonce[0])
+      return false;
+    viewTags.assign(extra_nonce.begin() + 1, extra_nonce.end());
+    return true;
+  }
+
   bool parsePaymentId(const std::string &paymentIdString, Hash &paymentId)
   {
     return Common::podFromHex(paymentIdString, paymentId);
@@ -345,26 +602,8 @@ namespace CryptoNote
 
   bool getPaymentIdFromTxExtra(const std::vector<uint8_t> &extra, Hash &paymentId)
   {
-    std::vector<TransactionExtraField> tx_extra_fields;
-    if (!parseTransactionExtra(extra, tx_extra_fields))
-    {
-      return false;
-    }
-
-    TransactionExtraNonce extra_nonce;
-    if (findTransactionExtraFieldByType(tx_extra_fields, extra_nonce))
-    {
-      if (!getPaymentIdFromTransactionExtraNonce(extra_nonce.nonce, paymentId))
-      {
-        return false;
-      }
-    }
-    else
-    {
-      return false;
-    }
-
-    return true;
+    TransactionExtraIndex index(extra);
+    return index.isValid() && index.getPaymentId(extra, paymentId);
   }
 
 #define TX_EXTRA_MESSAGE_CHECKSUM_SIZE 4
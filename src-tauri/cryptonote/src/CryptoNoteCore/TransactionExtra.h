@@ -35,6 +35,8 @@
 #define TX_EXTRA_TTL                        0x05
 
 #define TX_EXTRA_NONCE_PAYMENT_ID           0x00
+#define TX_EXTRA_NONCE_VIEW_TAGS            0x76
+#define TX_EXTRA_VIEW_TAGS_MAX_COUNT        (TX_EXTRA_NONCE_MAX_COUNT - 1)
 
 namespace CryptoNote {
 
@@ -90,6 +92,47 @@ bool findTransactionExtraFieldByType(const std::vector<TransactionExtraField>& t
   return true;
 }
 
+// Positions of the fields of a transaction extra, found in a single pass over the tags. Nothing is
+// copied out: the getters read the fields from the same extra again, which must not have changed.
+// Acceptance rules are those of parseTransactionExtra, fields before a malformed one stay indexed
+// and only the first public key, nonce, merge mining tag and TTL are kept, like findTransactionExtraFieldByType.
+class TransactionExtraIndex {
+public:
+  TransactionExtraIndex();
+  explicit TransactionExtraIndex(const std::vector<uint8_t>& extra);
+
+  bool scan(const std::vector<uint8_t>& extra);
+  bool isValid() const { return m_valid; }
+
+  bool getPublicKey(const std::vector<uint8_t>& extra, Crypto::PublicKey& publicKey) const;
+  bool getNonce(const std::vector<uint8_t>& extra, BinaryArray& nonce) const;
+  bool getPaymentId(const std::vector<uint8_t>& extra, Crypto::Hash& paymentId) const;
+  bool getMergeMiningTag(const std::vector<uint8_t>& extra, TransactionExtraMergeMiningTag& mmTag) const;
+  bool getTTL(uint64_t& ttl) const;
+  bool getViewTags(const std::vector<uint8_t>& extra, std::vector<uint8_t>& viewTags) const;
+
+  size_t getMessageCount() const { return m_messages.size(); }
+  void getMessage(const std::vector<uint8_t>& extra, size_t index, tx_extra_message& message) const;
+
+private:
+  static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+  struct Span {
+    size_t offset;
+    size_t size;
+  };
+
+  bool m_valid;
+  size_t m_publicKeyOffset;
+  Span m_nonce;
+  Span m_viewTags;
+  size_t m_mergeMiningDepth;
+  size_t m_mergeMiningRootOffset;
+  bool m_hasTTL;
+  uint64_t m_ttl;
+  std::vector<Span> m_messages;
+};
+
 bool parseTransactionExtra(const std::vector<uint8_t>& tx_extra, std::vector<TransactionExtraField>& tx_extra_fields);
 bool writeTransactionExtra(std::vector<uint8_t>& tx_extra, const std::vector<TransactionExtraField>& tx_extra_fields);
 
@@ -98,6 +141,14 @@ bool addTransactionPublicKeyToExtra(std::vector<uint8_t>& tx_extra, const Crypto
 bool addExtraNonceToTransactionExtra(std::vector<uint8_t>& tx_extra, const BinaryArray& extra_nonce);
 void setPaymentIdToTransactionExtraNonce(BinaryArray& extra_nonce, const Crypto::Hash& payment_id);
 bool getPaymentIdFromTransactionExtraNonce(const BinaryArray& extra_nonce, Crypto::Hash& payment_id);
+
+// A view tag is one byte per output, derived from the output's key derivation, so that a wallet can
+// rule out nearly every output that isn't its own with a hash instead of an elliptic curve operation.
+// The tags travel in an extra nonce placed after the other fields; nodes and wallets that don't know
+// them skip it like any other nonce. Outputs without a tag, e.g. multisignature ones, carry 0.
+uint8_t deriveViewTag(const Crypto::KeyDerivation& derivation, size_t outputIndex);
+void setViewTagsToTransactionExtraNonce(BinaryArray& extra_nonce, const std::vector<uint8_t>& viewTags);
+bool getViewTagsFromTransactionExtraNonce(const BinaryArray& extra_nonce, std::vector<uint8_t>& viewTags);
 bool appendMergeMiningTagToExtra(std::vector<uint8_t>& tx_extra, const TransactionExtraMergeMiningTag& mm_tag);
 bool append_message_to_extra(std::vector<uint8_t>& tx_extra, const tx_extra_message& message);
 std::vector<std::string> get_messages_from_extra(const std::vector<uint8_t>& extra, const Crypto::PublicKey &txkey, const Crypto::SecretKey *recepient_secret_key);
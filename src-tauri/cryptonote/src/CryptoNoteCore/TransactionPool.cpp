@@ -18,6 +18,7 @@
 #include "TransactionPool.h"
 
 #include <algorithm>
+#include <cstdio>
 #include <ctime>
 #include <vector>
 #include <unordered_set>
@@ -46,6 +47,16 @@ using namespace Logging;
 namespace CryptoNote
 {
 
+  // a miner polling getblocktemplate gets the same transaction set back until the pool or the tip changes,
+  // but a template never lives long enough to miss transactions whose unlock time has passed
+  const time_t TEMPLATE_CACHE_LIFETIME = 30;
+
+  // journal record types, the first byte of every record
+  const uint8_t JOURNAL_ADD = 1;
+  const uint8_t JOURNAL_REMOVE = 2;
+
+  void serialize(tx_memory_pool::TransactionDetails &td, ISerializer &s);
+
   //---------------------------------------------------------------------------------
   // BlockTemplate
   //---------------------------------------------------------------------------------
@@ -125,13 +136,32 @@ namespace CryptoNote
                                m_validator(validator),
                                m_timeProvider(timeProvider),
                                m_txCheckInterval(60, timeProvider),
+                               m_transactions_lock(Common::Metrics::instance().histogram("fuego_lock_hold_seconds",
+                                 "Time an exclusive lock is held", "lock=\"transactions\"")),
                                m_fee_index(boost::get<1>(m_transactions)),
-                               logger(log, "txpool")
+                               logger(log, "txpool"),
+                               m_poolVersion(0),
+                               m_poolId(Crypto::rand<uint64_t>() | 1),
+                               m_changeLogBegin(0),
+                               m_readyVerdictsTip(NULL_HASH),
+                               m_poolBytes(0),
+                               m_maxPoolBytes(POOL_DEFAULT_MAX_SIZE),
+                               m_minimumFeeRate(0),
+                               m_minimumFeeRateTime(0),
+                               m_evictedTransactions(Common::Metrics::instance().counter("fuego_pool_evicted_total",
+                                 "Transactions evicted to keep the pool within its size limit"))
   {
+    m_templateCache.valid = false;
   }
 
   bool tx_memory_pool::add_tx(const Transaction &tx, /*const Crypto::Hash& tx_prefix_hash,*/ const Crypto::Hash &id, size_t blobSize, tx_verification_context &tvc, bool keptByBlock, uint32_t height)
   {
+    return add_tx(tx, id, blobSize, tvc, keptByBlock, height, BlockInfo());
+  }
+  //---------------------------------------------------------------------------------
+  bool tx_memory_pool::add_tx(const Transaction &tx, const Crypto::Hash &id, size_t blobSize, tx_verification_context &tvc, bool keptByBlock, uint32_t height, const BlockInfo &checkedInputs)
+  {
+    Common::MemoryScope memoryScope(Common::MemorySubsystem::TransactionPool);
     if (!check_inputs_types_supported(tx))
     {
       tvc.m_verification_failed = true;
@@ -161,10 +191,8 @@ namespace CryptoNote
       return false;
     }
 
-    std::vector<TransactionExtraField> txExtraFields;
-    parseTransactionExtra(tx.extra, txExtraFields);
     TransactionExtraTTL ttl;
-    if (!findTransactionExtraFieldByType(txExtraFields, ttl))
+    if (!TransactionExtraIndex(tx.extra).getTTL(ttl.ttl))
     {
       ttl.ttl = 0;
     }
@@ -199,7 +227,7 @@ namespace CryptoNote
     //check key images for transaction if it is not kept by block
     if (!keptByBlock)
     {
-      std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+      Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
       if (haveSpentInputs(tx))
       {
         logger(WARNING) << "Transaction with id= " << id << " used already spent inputs";
@@ -208,10 +236,20 @@ namespace CryptoNote
       }
     }
 
-    BlockInfo maxUsedBlock;
+    BlockInfo maxUsedBlock = checkedInputs;
 
     // check inputs
-    bool inputsValid = m_validator.checkTransactionInputs(tx, maxUsedBlock);
+    bool inputsValid;
+    if (maxUsedBlock.empty())
+    {
+      inputsValid = m_validator.checkTransactionInputs(tx, maxUsedBlock);
+    }
+    else
+    {
+      // signatures are only checked again if maxUsedBlock left the main chain, key images may have been spent meanwhile
+      BlockInfo lastFailed;
+      inputsValid = !m_validator.haveSpentKeyImages(tx) && m_validator.checkTransactionInputs(tx, maxUsedBlock, lastFailed);
+    }
 
     if (!inputsValid)
     {
@@ -237,7 +275,7 @@ namespace CryptoNote
       }
     }
 
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
 
     if (!keptByBlock && m_recentlyDeletedTransactions.find(id) != m_recentlyDeletedTransactions.end())
     {
@@ -262,6 +300,21 @@ namespace CryptoNote
       txd.maxUsedBlock = maxUsedBlock;
       txd.lastFailedBlock.clear();
 
+      std::vector<tx_container_t::nth_index<1>::type::iterator> victims;
+      if (!keptByBlock && (fee * 1024 / blobSize < minimumFeeRate() || !makeRoom(txd, victims)))
+      {
+        logger(DEBUGGING) << "Transaction " << id << " pays " << fee * 1024 / blobSize << " per kB, not enough for a full pool. Ignore";
+        tvc.m_verification_failed = false;
+        tvc.m_should_be_relayed = false;
+        tvc.m_added_to_pool = false;
+        return true;
+      }
+
+      for (auto victim : victims)
+      {
+        evict(victim);
+      }
+
       auto txd_p = m_transactions.insert(std::move(txd));
       if (!(txd_p.second))
       {
@@ -277,6 +330,9 @@ namespace CryptoNote
       }
 
       logger(DEBUGGING) << "Transaction " << txd.id << " added to pool";
+      logChange(id, true);
+      m_poolBytes += blobSize;
+      journalAdd(*txd_p.first);
     }
 
     if (height >= parameters::UPGRADE_HEIGHT_V8) {
@@ -308,7 +364,7 @@ namespace CryptoNote
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::take_tx(const Crypto::Hash &id, Transaction &tx, size_t &blobSize, uint64_t &fee)
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
     auto it = m_transactions.find(id);
     if (it == m_transactions.end())
     {
@@ -327,7 +383,7 @@ namespace CryptoNote
 
   bool tx_memory_pool::getTransaction(const Crypto::Hash &id, Transaction &tx)
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
     auto it = m_transactions.find(id);
     if (it == m_transactions.end())
     {
@@ -343,22 +399,44 @@ namespace CryptoNote
   //---------------------------------------------------------------------------------
   size_t tx_memory_pool::get_transactions_count() const
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
     return m_transactions.size();
   }
   //---------------------------------------------------------------------------------
+  uint64_t tx_memory_pool::get_transactions_size() const
+  {
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+    return m_poolBytes;
+  }
+  //---------------------------------------------------------------------------------
+  uint64_t tx_memory_pool::get_version() const
+  {
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+    return m_poolVersion;
+  }
+  //---------------------------------------------------------------------------------
   void tx_memory_pool::get_transactions(std::list<Transaction> &txs) const
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
     for (const auto &tx_vt : m_transactions)
     {
       txs.push_back(tx_vt.tx);
     }
   }
   //---------------------------------------------------------------------------------
+  void tx_memory_pool::get_transaction_hashes(std::vector<Crypto::Hash> &hashes) const
+  {
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+    hashes.reserve(hashes.size() + m_transactions.size());
+    for (const auto &tx_vt : m_transactions)
+    {
+      hashes.push_back(tx_vt.id);
+    }
+  }
+  //---------------------------------------------------------------------------------
   void tx_memory_pool::get_difference(const std::vector<Crypto::Hash> &known_tx_ids, std::vector<Crypto::Hash> &new_tx_ids, std::vector<Crypto::Hash> &deleted_tx_ids) const
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
     std::unordered_set<Crypto::Hash> ready_tx_ids;
     for (const auto &tx : m_transactions)
     {
@@ -388,19 +466,151 @@ namespace CryptoNote
     deleted_tx_ids.assign(known_set.begin(), known_set.end());
   }
   //---------------------------------------------------------------------------------
+  bool tx_memory_pool::get_changes_since(uint64_t poolId, uint64_t fromVersion, std::vector<Crypto::Hash> &new_tx_ids, std::vector<Crypto::Hash> &deleted_tx_ids) const
+  {
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+    if (poolId != m_poolId || fromVersion < m_changeLogBegin || fromVersion > m_poolVersion)
+    {
+      return false;
+    }
+
+    auto begin = std::upper_bound(m_changeLog.begin(), m_changeLog.end(), fromVersion, [](uint64_t version, const PoolChange &change) {
+      return version < change.version;
+    });
+
+    // whether each transaction was in the pool at fromVersion and is now
+    std::unordered_map<Crypto::Hash, std::pair<bool, bool>> membership;
+    for (auto it = begin; it != m_changeLog.end(); ++it)
+    {
+      auto inserted = membership.emplace(it->id, std::make_pair(!it->added, it->added));
+      if (!inserted.second)
+      {
+        inserted.first->second.second = it->added;
+      }
+    }
+
+    for (auto it = begin; it != m_changeLog.end(); ++it)
+    {
+      auto found = membership.find(it->id);
+      if (found == membership.end())
+      {
+        continue;
+      }
+
+      if (!found->second.first && found->second.second)
+      {
+        new_tx_ids.push_back(it->id);
+      }
+      else if (found->second.first && !found->second.second)
+      {
+        deleted_tx_ids.push_back(it->id);
+      }
+
+      membership.erase(found);
+    }
+
+    return true;
+  }
+  //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash &top_block_id)
   {
+    revalidate(top_block_id);
     return true;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash &top_block_id)
   {
+    revalidate(top_block_id);
     return true;
   }
   //---------------------------------------------------------------------------------
+  // Precomputes the ready verdicts fill_block_template would otherwise work out one transaction at
+  // a time on the first template after a tip change. The checks only read the transactions and
+  // the chain, so they run on worker threads against private copies of the check info; the
+  // results are applied together at the end.
+  void tx_memory_pool::revalidate(const Crypto::Hash &top_block_id)
+  {
+    struct Candidate
+    {
+      const TransactionDetails *details;
+      TransactionCheckInfo checkInfo;
+      bool ready;
+    };
+
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+    if (m_readyVerdictsTip != top_block_id)
+    {
+      m_readyVerdicts.clear();
+      m_readyVerdictsTip = top_block_id;
+      // transactions that were not ready may be now and the other way round, which the log can't tell
+      m_changeLog.clear();
+      m_changeLogBegin = m_poolVersion;
+    }
+
+    std::vector<Candidate> candidates;
+    candidates.reserve(m_transactions.size());
+    for (const auto &txd : m_transactions)
+    {
+      if (m_readyVerdicts.count(txd.id) == 0 && m_ttlIndex.count(txd.id) == 0)
+      {
+        candidates.push_back(Candidate{&txd, txd, false});
+      }
+    }
+
+    auto checkRange = [this, &candidates](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+      {
+        candidates[i].ready = is_transaction_ready_to_go(candidates[i].details->tx, candidates[i].checkInfo);
+      }
+    };
+
+    if (candidates.size() <= 1)
+    {
+      checkRange(0, candidates.size());
+    }
+    else
+    {
+      std::call_once(m_revalidationWorkersCreated, [this] { m_revalidationWorkers.reset(new Common::ThreadPool()); });
+      // several chunks per worker, a chunk of transactions that need their signatures checked
+      // takes far longer than one that hits the validator's fast path
+      size_t chunkCount = std::min(candidates.size(), 4 * m_revalidationWorkers->workerCount());
+      size_t chunkSize = (candidates.size() + chunkCount - 1) / chunkCount;
+      std::vector<std::future<void>> results;
+      results.reserve(chunkCount);
+      for (size_t begin = 0; begin < candidates.size(); begin += chunkSize)
+      {
+        size_t end = std::min(begin + chunkSize, candidates.size());
+        results.push_back(m_revalidationWorkers->submit([&checkRange, begin, end] { checkRange(begin, end); }));
+      }
+
+      // every task has to finish before any error is rethrown, they reference `candidates`
+      for (auto &result : results)
+      {
+        result.wait();
+      }
+
+      for (auto &result : results)
+      {
+        result.get();
+      }
+    }
+
+    for (const Candidate &candidate : candidates)
+    {
+      m_transactions.modify(m_transactions.find(candidate.details->id), [&candidate](TransactionDetails &details) {
+        static_cast<TransactionCheckInfo &>(details) = candidate.checkInfo;
+      });
+
+      if (candidate.ready)
+      {
+        m_readyVerdicts.insert(candidate.details->id);
+      }
+    }
+  }
+  //---------------------------------------------------------------------------------
   bool tx_memory_pool::have_tx(const Crypto::Hash &id) const
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
     if (m_transactions.count(id))
     {
       return true;
@@ -409,6 +619,23 @@ namespace CryptoNote
     return false;
   }
   //---------------------------------------------------------------------------------
+  void tx_memory_pool::getTransactionSizes(const std::vector<Crypto::Hash>& ids, size_t& totalSize, std::vector<Crypto::Hash>& missedIds) const
+  {
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+    for (const Crypto::Hash& id : ids)
+    {
+      auto it = m_transactions.find(id);
+      if (it == m_transactions.end())
+      {
+        missedIds.push_back(id);
+      }
+      else
+      {
+        totalSize += it->blobSize;
+      }
+    }
+  }
+  //---------------------------------------------------------------------------------
   void tx_memory_pool::lock() const
   {
     m_transactions_lock.lock();
@@ -419,9 +646,9 @@ namespace CryptoNote
     m_transactions_lock.unlock();
   }
 
-  std::unique_lock<std::recursive_mutex> tx_memory_pool::obtainGuard() const
+  std::unique_lock<Common::MeteredMutex<std::recursive_mutex>> tx_memory_pool::obtainGuard() const
   {
-    return std::unique_lock<std::recursive_mutex>(m_transactions_lock);
+    return std::unique_lock<Common::MeteredMutex<std::recursive_mutex>>(m_transactions_lock);
   }
 
   //---------------------------------------------------------------------------------
@@ -446,7 +673,7 @@ namespace CryptoNote
   std::string tx_memory_pool::print_pool(bool short_format) const
   {
     std::stringstream ss;
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
     for (const auto &txd : m_fee_index)
     {
       ss << "id: " << txd.id << std::endl;
@@ -482,7 +709,24 @@ namespace CryptoNote
       uint64_t &fee,
       uint32_t &height)
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+    const BlockTemplateCache &cache = m_templateCache;
+    if (cache.valid && cache.previousBlockHash == bl.previousBlockHash && cache.height == height && cache.medianSize == median_size &&
+        cache.maxCumulativeSize == maxCumulativeSize && cache.poolVersion == m_poolVersion &&
+        m_timeProvider.now() < cache.buildTime + TEMPLATE_CACHE_LIFETIME)
+    {
+      bl.transactionHashes = cache.transactions;
+      total_size = cache.totalSize;
+      fee = cache.fee;
+      return true;
+    }
+
+    if (m_readyVerdictsTip != bl.previousBlockHash)
+    {
+      m_readyVerdicts.clear();
+      m_readyVerdictsTip = bl.previousBlockHash;
+    }
+
     total_size = 0;
     fee = 0;
     size_t max_total_size = (125 * median_size) / 100 - m_currency.minerTxBlobReservedSize();
@@ -515,8 +759,22 @@ namespace CryptoNote
         continue;
       }
 
-      TransactionCheckInfo checkInfo(txd);
-      bool ready = is_transaction_ready_to_go(txd.tx, checkInfo);
+      bool ready = m_readyVerdicts.count(txd.id) != 0;
+      if (!ready)
+      {
+        TransactionCheckInfo checkInfo(txd);
+        ready = is_transaction_ready_to_go(txd.tx, checkInfo);
+
+        // keep what the validator learned, so the next check can take its fast path
+        m_transactions.modify(m_transactions.find(txd.id), [&checkInfo](TransactionDetails &details) {
+          static_cast<TransactionCheckInfo &>(details) = checkInfo;
+        });
+
+        if (ready)
+        {
+          m_readyVerdicts.insert(txd.id);
+        }
+      }
 
       if (ready && blockTemplate.addTransaction(txd.id, txd.tx))
       {
@@ -531,39 +789,60 @@ namespace CryptoNote
     }
 
     bl.transactionHashes = blockTemplate.getTransactions();
+
+    m_templateCache.valid = true;
+    m_templateCache.previousBlockHash = bl.previousBlockHash;
+    m_templateCache.height = height;
+    m_templateCache.medianSize = median_size;
+    m_templateCache.maxCumulativeSize = maxCumulativeSize;
+    m_templateCache.poolVersion = m_poolVersion;
+    m_templateCache.buildTime = m_timeProvider.now();
+    m_templateCache.transactions = bl.transactionHashes;
+    m_templateCache.totalSize = total_size;
+    m_templateCache.fee = fee;
     return true;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::init(const std::string &config_folder)
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
 
     m_config_folder = config_folder;
     std::string state_file_path = config_folder + "/" + m_currency.txPoolFileName();
     boost::system::error_code ec;
-    if (!boost::filesystem::exists(state_file_path, ec))
-    {
-      return true;
-    }
-
-    if (!loadFromBinaryFile(*this, state_file_path))
+    if (boost::filesystem::exists(state_file_path, ec) && !loadFromBinaryFile(*this, state_file_path))
     {
       logger(ERROR) << "Failed to load memory pool from file " << state_file_path;
 
       m_transactions.clear();
       m_spent_key_images.clear();
       m_spentOutputs.clear();
-
-      m_paymentIdIndex.clear();
-      m_timestampIndex.clear();
-      m_ttlIndex.clear();
+      m_readyVerdicts.clear();
     }
-    else
+
+    buildIndices();
+    // transactions that came and went after the state file was written
+    replayJournal(state_file_path + ".journal");
+
+    removeExpiredTransactions();
+
+    // the limit may have been lowered since the pool was saved
+    for (auto it = m_fee_index.end(); m_poolBytes > m_maxPoolBytes && it != m_fee_index.begin();)
     {
-      buildIndices();
+      --it;
+      if (!it->keptByBlock)
+      {
+        evict(it);
+        it = m_fee_index.end();
+      }
     }
 
-    removeExpiredTransactions();
+    // folding the journal into the state file keeps the next start from replaying it again
+    if (Tools::create_directories_if_necessary(m_config_folder))
+    {
+      m_journal.open(state_file_path + ".journal");
+      storeState();
+    }
 
     // Ignore deserialization error
     return true;
@@ -577,12 +856,8 @@ namespace CryptoNote
       return false;
     }
 
-    std::string state_file_path = m_config_folder + "/" + m_currency.txPoolFileName();
-
-    if (!storeToBinaryFile(*this, state_file_path))
-    {
-      logger(INFO) << "Failed to serialize memory pool to file " << state_file_path;
-    }
+    storeState();
+    m_journal.close();
 
     m_paymentIdIndex.clear();
     m_timestampIndex.clear();
@@ -591,7 +866,113 @@ namespace CryptoNote
     return true;
   }
 
-#define CURRENT_MEMPOOL_ARCHIVE_VER 1
+  //---------------------------------------------------------------------------------
+  bool tx_memory_pool::storeState()
+  {
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+
+    // written aside and renamed, so a crash mid-save leaves the previous state and its journal in place
+    std::string state_file_path = m_config_folder + "/" + m_currency.txPoolFileName();
+    std::string temporary_file_path = state_file_path + ".tmp";
+    if (!storeToBinaryFile(*this, temporary_file_path))
+    {
+      logger(INFO) << "Failed to serialize memory pool to file " << temporary_file_path;
+      return false;
+    }
+
+    std::remove(state_file_path.c_str());
+    if (std::rename(temporary_file_path.c_str(), state_file_path.c_str()) != 0)
+    {
+      logger(INFO) << "Failed to replace memory pool file " << state_file_path;
+      return false;
+    }
+
+    m_journal.reset();
+    return true;
+  }
+
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::journalAdd(const TransactionDetails &txd)
+  {
+    if (m_journal.isOpened())
+    {
+      BinaryArray record(1, JOURNAL_ADD);
+      toBinaryArray(txd, record);
+      m_journal.append(record);
+    }
+  }
+
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::journalRemove(const Crypto::Hash &id)
+  {
+    if (m_journal.isOpened())
+    {
+      BinaryArray record(1, JOURNAL_REMOVE);
+      record.insert(record.end(), id.data, id.data + sizeof(id.data));
+      m_journal.append(record);
+    }
+  }
+
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::replayJournal(const std::string &path)
+  {
+    std::vector<BinaryArray> records;
+    if (!JournalFile::load(path, records))
+    {
+      logger(WARNING) << "Transaction pool journal " << path << " ends in a torn record, replaying what precedes it";
+    }
+
+    size_t replayed = 0;
+    for (const BinaryArray &record : records)
+    {
+      if (record.empty())
+      {
+        break;
+      }
+
+      if (record[0] == JOURNAL_ADD)
+      {
+        TransactionDetails txd;
+        if (!fromBinaryArray(txd, BinaryArray(record.begin() + 1, record.end())))
+        {
+          break;
+        }
+
+        // the check info travels with the transaction, so inputs checked before the restart are
+        // not verified again while the block they were checked against is still in the chain
+        if (m_transactions.count(txd.id) == 0 && (txd.keptByBlock || !haveSpentInputs(txd.tx)) &&
+            addTransactionInputs(txd.id, txd.tx, txd.keptByBlock))
+        {
+          Crypto::Hash id = txd.id;
+          indexTransaction(*m_transactions.insert(std::move(txd)).first);
+          logChange(id, true);
+        }
+      }
+      else if (record[0] == JOURNAL_REMOVE && record.size() == 1 + sizeof(Crypto::Hash))
+      {
+        Crypto::Hash id;
+        std::copy(record.begin() + 1, record.end(), id.data);
+        auto it = m_transactions.find(id);
+        if (it != m_transactions.end())
+        {
+          removeTransaction(it);
+        }
+      }
+      else
+      {
+        break;
+      }
+
+      ++replayed;
+    }
+
+    if (replayed != 0)
+    {
+      logger(INFO) << "Replayed " << replayed << " records from the transaction pool journal";
+    }
+  }
+
+#define CURRENT_MEMPOOL_ARCHIVE_VER 2
 
   void serialize(CryptoNote::tx_memory_pool::TransactionDetails &td, ISerializer &s)
   {
@@ -610,16 +991,18 @@ namespace CryptoNote
   //---------------------------------------------------------------------------------
   void tx_memory_pool::serialize(ISerializer &s)
   {
+    Common::MemoryScope memoryScope(Common::MemorySubsystem::TransactionPool);
     uint8_t version = CURRENT_MEMPOOL_ARCHIVE_VER;
 
     s(version, "version");
 
-    if (version != CURRENT_MEMPOOL_ARCHIVE_VER)
+    // version 1 lacks the ready verdicts, the pool is then checked again on the current tip
+    if (version != CURRENT_MEMPOOL_ARCHIVE_VER && version != 1)
     {
       return;
     }
 
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
 
     if (s.type() == ISerializer::INPUT)
     {
@@ -634,12 +1017,36 @@ namespace CryptoNote
     KV_MEMBER(m_spent_key_images);
     KV_MEMBER(m_spentOutputs);
     KV_MEMBER(m_recentlyDeletedTransactions);
+
+    // verdicts hold for as long as the tip they were reached on, so after a restart on the same
+    // tip the block template needs no input checks
+    if (version >= 2)
+    {
+      KV_MEMBER(m_readyVerdictsTip);
+      KV_MEMBER(m_readyVerdicts);
+    }
   }
 
   //---------------------------------------------------------------------------------
   void tx_memory_pool::on_idle()
   {
-    m_txCheckInterval.call([this]() { return removeExpiredTransactions(); });
+    m_txCheckInterval.call([this]() {
+      bool result = removeExpiredTransactions();
+
+      Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+      // every transaction leaves a record when it enters and another when it leaves, so the journal
+      // outgrows the pool; rewriting the state file is then cheaper than replaying it on the next start
+      if (m_journal.size() > 2 * m_poolBytes + POOL_JOURNAL_COMPACTION_SLACK)
+      {
+        storeState();
+      }
+      else
+      {
+        m_journal.sync();
+      }
+
+      return result;
+    });
   }
 
   //---------------------------------------------------------------------------------
@@ -647,7 +1054,7 @@ namespace CryptoNote
   {
     bool somethingRemoved = false;
     {
-      std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+      Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
 
       uint64_t now = m_timeProvider.now();
 
@@ -702,9 +1109,90 @@ namespace CryptoNote
     return true;
   }
 
+  void tx_memory_pool::setMaxSize(uint64_t maxBytes)
+  {
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+    m_maxPoolBytes = maxBytes;
+  }
+
+  void tx_memory_pool::getLimits(uint64_t &maxBytes, uint64_t &minimumFeeRate) const
+  {
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+    maxBytes = m_maxPoolBytes;
+    minimumFeeRate = this->minimumFeeRate();
+  }
+
+  uint64_t tx_memory_pool::minimumFeeRate() const
+  {
+    uint64_t now = m_timeProvider.now();
+    if (m_minimumFeeRate != 0 && now >= m_minimumFeeRateTime + POOL_MINIMUM_FEE_RATE_HALF_LIFE)
+    {
+      uint64_t halvings = (now - m_minimumFeeRateTime) / POOL_MINIMUM_FEE_RATE_HALF_LIFE;
+      m_minimumFeeRate = halvings < 64 ? m_minimumFeeRate >> halvings : 0;
+      m_minimumFeeRateTime += halvings * POOL_MINIMUM_FEE_RATE_HALF_LIFE;
+    }
+
+    return m_minimumFeeRate;
+  }
+
+  // Picks the cheapest transactions whose removal brings the pool back under its limit once
+  // incoming is added. Fails when that would take a transaction paying as much as incoming.
+  bool tx_memory_pool::makeRoom(const TransactionDetails &incoming, std::vector<tx_container_t::nth_index<1>::type::iterator> &victims) const
+  {
+    uint64_t bytes = m_poolBytes + incoming.blobSize;
+    TransactionPriorityComparator better;
+    for (auto it = m_fee_index.end(); bytes > m_maxPoolBytes;)
+    {
+      if (it == m_fee_index.begin() || !better(incoming, *std::prev(it)))
+      {
+        victims.clear();
+        return false;
+      }
+
+      --it;
+      if (!it->keptByBlock)
+      {
+        victims.push_back(it);
+        bytes -= it->blobSize;
+      }
+    }
+
+    return true;
+  }
+
+  void tx_memory_pool::evict(tx_container_t::nth_index<1>::type::iterator it)
+  {
+    uint64_t feeRate = it->fee * 1024 / it->blobSize;
+    if (feeRate >= minimumFeeRate())
+    {
+      m_minimumFeeRate = feeRate + 1;
+      m_minimumFeeRateTime = m_timeProvider.now();
+    }
+
+    logger(INFO) << "Tx " << it->id << " evicted from full tx pool, fee per kB: " << feeRate;
+    m_recentlyDeletedTransactions.emplace(it->id, m_timeProvider.now());
+    m_evictedTransactions.add();
+    removeTransaction(m_transactions.project<0>(it));
+  }
+
+  void tx_memory_pool::logChange(const Crypto::Hash &id, bool added)
+  {
+    ++m_poolVersion;
+    m_changeLog.push_back(PoolChange{m_poolVersion, id, added});
+    if (m_changeLog.size() > POOL_CHANGE_LOG_SIZE)
+    {
+      m_changeLogBegin = m_changeLog.front().version;
+      m_changeLog.pop_front();
+    }
+  }
+
   tx_memory_pool::tx_container_t::iterator tx_memory_pool::removeTransaction(tx_memory_pool::tx_container_t::iterator i)
   {
     removeTransactionInputs(i->id, i->tx, i->keptByBlock);
+    journalRemove(i->id);
+    m_readyVerdicts.erase(i->id);
+    logChange(i->id, false);
+    m_poolBytes -= i->blobSize;
     m_paymentIdIndex.remove(i->tx);
     m_timestampIndex.remove(i->receiveTime, i->id);
     m_ttlIndex.erase(i->id);
@@ -839,34 +1327,42 @@ namespace CryptoNote
 
   void tx_memory_pool::buildIndices()
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
+    m_paymentIdIndex.clear();
+    m_timestampIndex.clear();
+    m_ttlIndex.clear();
+    m_poolBytes = 0;
     for (auto it = m_transactions.begin(); it != m_transactions.end(); it++)
     {
-      m_paymentIdIndex.add(it->tx);
-      m_timestampIndex.add(it->receiveTime, it->id);
+      indexTransaction(*it);
+    }
+  }
 
-      std::vector<TransactionExtraField> txExtraFields;
-      parseTransactionExtra(it->tx.extra, txExtraFields);
-      TransactionExtraTTL ttl;
-      if (findTransactionExtraFieldByType(txExtraFields, ttl))
+  void tx_memory_pool::indexTransaction(const TransactionDetails &txd)
+  {
+    m_poolBytes += txd.blobSize;
+    m_paymentIdIndex.add(txd.tx);
+    m_timestampIndex.add(txd.receiveTime, txd.id);
+
+    TransactionExtraTTL ttl;
+    if (TransactionExtraIndex(txd.tx.extra).getTTL(ttl.ttl))
+    {
+      if (ttl.ttl != 0)
       {
-        if (ttl.ttl != 0)
-        {
-          m_ttlIndex.emplace(std::make_pair(it->id, ttl.ttl));
-        }
+        m_ttlIndex.emplace(std::make_pair(txd.id, ttl.ttl));
       }
     }
   }
 
   bool tx_memory_pool::getTransactionIdsByPaymentId(const Crypto::Hash &paymentId, std::vector<Crypto::Hash> &transactionIds)
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
     return m_paymentIdIndex.find(paymentId, transactionIds);
   }
 
   bool tx_memory_pool::getTransactionIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t transactionsNumberLimit, std::vector<Crypto::Hash> &hashes, uint64_t &transactionsNumberWithinTimestamps)
   {
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
     return m_timestampIndex.find(timestampBegin, timestampEnd, transactionsNumberLimit, hashes, transactionsNumberWithinTimestamps);
   }
 } // namespace CryptoNote
@@ -17,7 +17,10 @@
 
 #pragma once
 
+#include <deque>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -30,9 +33,13 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/member.hpp>
 
+#include "Common/AllocationTracker.h"
+#include "Common/LockProfiler.h"
+#include "Common/Metrics.h"
 #include "Common/Util.h"
 #include "Common/int-util.h"
 #include "Common/ObserverManager.h"
+#include "Common/ThreadPool.h"
 #include "crypto/hash.h"
 
 #include "CryptoNoteCore/CryptoNoteBasic.h"
@@ -41,6 +48,7 @@
 #include "CryptoNoteCore/ITimeProvider.h"
 #include "CryptoNoteCore/ITransactionValidator.h"
 #include "CryptoNoteCore/ITxPoolObserver.h"
+#include "CryptoNoteCore/JournalFile.h"
 #include "CryptoNoteCore/VerificationContext.h"
 #include "CryptoNoteCore/BlockchainIndices.h"
 
@@ -93,28 +101,51 @@ namespace CryptoNote {
     bool addObserver(ITxPoolObserver* observer);
     bool removeObserver(ITxPoolObserver* observer);
 
-    // load/store operations
+    // load/store operations; between stores every insertion and removal is appended to a journal
+    // next to the state file, which init replays
     bool init(const std::string& config_folder);
     bool deinit();
 
+    // Serialized bytes the pool may hold; past it the transactions paying the least per byte give way
+    void setMaxSize(uint64_t maxBytes);
+    // minimumFeeRate is in atomic units per kB, raised above every evicted transaction and halving
+    // each POOL_MINIMUM_FEE_RATE_HALF_LIFE after that
+    void getLimits(uint64_t& maxBytes, uint64_t& minimumFeeRate) const;
+
     bool have_tx(const Crypto::Hash &id) const;
+    // adds the sizes recorded when the pooled ones among ids were added, nothing is serialized
+    void getTransactionSizes(const std::vector<Crypto::Hash>& ids, size_t& totalSize, std::vector<Crypto::Hash>& missedIds) const;
     bool add_tx(const Transaction &tx, const Crypto::Hash &id, size_t blobSize, tx_verification_context& tvc, bool keeped_by_block, uint32_t height);
     bool add_tx(const Transaction &tx, tx_verification_context& tvc, bool keeped_by_block, uint32_t height);
+    // checkedInputs is the max used block of an earlier successful input check, the ring signatures are then not verified again
+    bool add_tx(const Transaction &tx, const Crypto::Hash &id, size_t blobSize, tx_verification_context& tvc, bool keeped_by_block, uint32_t height, const BlockInfo& checkedInputs);
     //gets tx and remove it from pool
     bool take_tx(const Crypto::Hash &id, Transaction &tx, size_t& blobSize, uint64_t& fee);
 
+    // Both recheck the pool against the chain ending at top_block_id, see revalidate(); the caller
+    // holds the pool lock from before it read the tip, which keeps the chain from moving meanwhile
     bool on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id);
     bool on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash& top_block_id);
 
     void lock() const;
     void unlock() const;
-    std::unique_lock<std::recursive_mutex> obtainGuard() const;
+    std::unique_lock<Common::MeteredMutex<std::recursive_mutex>> obtainGuard() const;
 
     bool fill_block_template(Block &bl, size_t median_size, size_t maxCumulativeSize, uint64_t already_generated_coins, size_t &total_size, uint64_t &fee, uint32_t& height);
 
     void get_transactions(std::list<Transaction>& txs) const;
+    void get_transaction_hashes(std::vector<Crypto::Hash>& hashes) const;
     void get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const;
     size_t get_transactions_count() const;
+    uint64_t get_transactions_size() const;
+    // changes whenever a transaction enters or leaves the pool
+    uint64_t get_version() const;
+    // random, tells apart the versions of different pools and of different runs
+    uint64_t get_pool_id() const { return m_poolId; }
+    // The transactions that entered and left the pool since version fromVersion of pool poolId, netted out.
+    // False when that version is older than the change log, which restarts whenever the chain tip moves;
+    // the caller then diffs its known transactions against the pool with get_difference instead.
+    bool get_changes_since(uint64_t poolId, uint64_t fromVersion, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const;
     std::string print_pool(bool short_format) const;
     void on_idle();
 
@@ -124,7 +155,7 @@ namespace CryptoNote {
     
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     void getTransactions(const t_ids_container& txsIds, t_tx_container& txs, t_missed_container& missedTxs) {
-      std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+      Common::ProfiledLockGuard<decltype(m_transactions_lock)> lock(m_transactions_lock, LOCK_SITE("transactions"));
 
       for (const auto& id : txsIds) {
         auto it = m_transactions.find(id);
@@ -193,18 +224,32 @@ namespace CryptoNote {
     bool removeTransactionInputs(const Crypto::Hash& id, const Transaction& tx, bool keptByBlock);
 
     tx_container_t::iterator removeTransaction(tx_container_t::iterator i);
+    // bumps m_poolVersion, needs the lock held
+    void logChange(const Crypto::Hash& id, bool added);
     bool removeExpiredTransactions();
+    // both need the lock held
+    bool makeRoom(const TransactionDetails& incoming, std::vector<tx_container_t::nth_index<1>::type::iterator>& victims) const;
+    void evict(tx_container_t::nth_index<1>::type::iterator it);
+    uint64_t minimumFeeRate() const;
+    void revalidate(const Crypto::Hash& top_block_id);
     bool is_transaction_ready_to_go(const Transaction& tx, TransactionCheckInfo& txd) const;
     void buildIndices();
+    void indexTransaction(const TransactionDetails& txd);
+
+    bool storeState();
+    void journalAdd(const TransactionDetails& txd);
+    void journalRemove(const Crypto::Hash& id);
+    void replayJournal(const std::string& path);
 
     Tools::ObserverManager<ITxPoolObserver> m_observerManager;
     const CryptoNote::Currency& m_currency;
     OnceInTimeInterval m_txCheckInterval;
-    mutable std::recursive_mutex m_transactions_lock;
+    mutable Common::MeteredMutex<std::recursive_mutex> m_transactions_lock;
     key_images_container m_spent_key_images;
     GlobalOutputsContainer m_spentOutputs;
 
     std::string m_config_folder;
+    JournalFile m_journal;
     CryptoNote::ITransactionValidator& m_validator;
     CryptoNote::ITimeProvider& m_timeProvider;
 
@@ -217,5 +262,46 @@ namespace CryptoNote {
     PaymentIdIndex m_paymentIdIndex;
     TimestampTransactionsIndex m_timestampIndex;
     std::unordered_map<Crypto::Hash, uint64_t> m_ttlIndex;
+
+    // last template handed out, reused while neither the pool nor the chain tip changed
+    struct BlockTemplateCache {
+      bool valid;
+      Crypto::Hash previousBlockHash;
+      uint32_t height;
+      size_t medianSize;
+      size_t maxCumulativeSize;
+      uint64_t poolVersion;
+      time_t buildTime;
+      std::vector<Crypto::Hash> transactions;
+      size_t totalSize;
+      uint64_t fee;
+    };
+
+    struct PoolChange {
+      uint64_t version;
+      Crypto::Hash id;
+      bool added;
+    };
+
+    // bumped on every insertion and removal
+    uint64_t m_poolVersion;
+    uint64_t m_poolId;
+    // the insertions and removals after m_changeLogBegin, since the tip last moved. Between tip moves
+    // only transactions that passed the input checks enter the pool, so every logged insertion is ready
+    std::deque<PoolChange> m_changeLog;
+    uint64_t m_changeLogBegin;
+    BlockTemplateCache m_templateCache;
+    // transactions found ready on top of m_readyVerdictsTip; ready stays ready until the tip moves
+    Crypto::Hash m_readyVerdictsTip;
+    std::unordered_set<Crypto::Hash> m_readyVerdicts;
+
+    uint64_t m_poolBytes;
+    uint64_t m_maxPoolBytes;
+    mutable uint64_t m_minimumFeeRate;
+    mutable uint64_t m_minimumFeeRateTime;
+    Common::MetricCounter& m_evictedTransactions;
+
+    std::once_flag m_revalidationWorkersCreated;
+    std::unique_ptr<Common::ThreadPool> m_revalidationWorkers;
   };
 }
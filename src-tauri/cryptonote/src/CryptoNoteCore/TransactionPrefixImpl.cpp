@@ -20,6 +20,7 @@
 #include <numeric>
 #include <system_error>
 
+#include "Common/Arena.h"
 #include "CryptoNoteCore/CryptoNoteBasic.h"
 #include "CryptoNoteCore/TransactionApiExtra.h"
 #include "TransactionUtils.h"
@@ -33,6 +34,7 @@ class TransactionPrefixImpl : public ITransactionReader {
 public:
   TransactionPrefixImpl();
   TransactionPrefixImpl(const TransactionPrefix& prefix, const Hash& transactionHash);
+  TransactionPrefixImpl(TransactionPrefix&& prefix, const Hash& transactionHash);
 
   virtual ~TransactionPrefixImpl() { }
 
@@ -45,6 +47,7 @@ public:
   // extra
   virtual bool getPaymentId(Hash& paymentId) const override;
   virtual bool getExtraNonce(BinaryArray& nonce) const override;
+  virtual bool getViewTags(std::vector<uint8_t>& viewTags) const override;
   virtual BinaryArray getExtra() const override;
 
   // inputs
@@ -73,12 +76,13 @@ public:
 
   // serialized transaction
   virtual BinaryArray getTransactionData() const override;
+  virtual size_t getTransactionDataSize() const override;
   virtual TransactionPrefix getTransactionPrefix() const override;
   virtual bool getTransactionSecretKey(SecretKey& key) const override;
 
 private:
   TransactionPrefix m_txPrefix;
-  TransactionExtra m_extra;
+  TransactionExtraIndex m_extraIndex;
   Hash m_txHash;
 };
 
@@ -86,9 +90,14 @@ TransactionPrefixImpl::TransactionPrefixImpl() {
 }
 
 TransactionPrefixImpl::TransactionPrefixImpl(const TransactionPrefix& prefix, const Hash& transactionHash) {
-  m_extra.parse(prefix.extra);
-
   m_txPrefix = prefix;
+  m_extraIndex.scan(m_txPrefix.extra);
+  m_txHash = transactionHash;
+}
+
+TransactionPrefixImpl::TransactionPrefixImpl(TransactionPrefix&& prefix, const Hash& transactionHash) {
+  m_txPrefix = std::move(prefix);
+  m_extraIndex.scan(m_txPrefix.extra);
   m_txHash = transactionHash;
 }
 
@@ -107,7 +116,7 @@ Hash TransactionPrefixImpl::getTransactionInputsHash() const
 
 PublicKey TransactionPrefixImpl::getTransactionPublicKey() const {
   Crypto::PublicKey pk(NULL_PUBLIC_KEY);
-  m_extra.getPublicKey(pk);
+  m_extraIndex.getPublicKey(m_txPrefix.extra, pk);
   return pk;
 }
 
@@ -116,28 +125,15 @@ uint64_t TransactionPrefixImpl::getUnlockTime() const {
 }
 
 bool TransactionPrefixImpl::getPaymentId(Hash& hash) const {
-  BinaryArray nonce;
-
-  if (getExtraNonce(nonce)) {
-    Crypto::Hash paymentId;
-    if (getPaymentIdFromTransactionExtraNonce(nonce, paymentId)) {
-      hash = reinterpret_cast<const Hash&>(paymentId);
-      return true;
-    }
-  }
-
-  return false;
+  return m_extraIndex.getPaymentId(m_txPrefix.extra, hash);
 }
 
 bool TransactionPrefixImpl::getExtraNonce(BinaryArray& nonce) const {
-  TransactionExtraNonce extraNonce;
-
-  if (m_extra.get(extraNonce)) {
-    nonce = extraNonce.nonce;
-    return true;
-  }
+  return m_extraIndex.getNonce(m_txPrefix.extra, nonce);
+}
 
-  return false;
+bool TransactionPrefixImpl::getViewTags(std::vector<uint8_t>& viewTags) const {
+  return m_extraIndex.getViewTags(m_txPrefix.extra, viewTags);
 }
 
 BinaryArray TransactionPrefixImpl::getExtra() const {
@@ -223,6 +219,10 @@ BinaryArray TransactionPrefixImpl::getTransactionData() const {
   return toBinaryArray(m_txPrefix);
 }
 
+size_t TransactionPrefixImpl::getTransactionDataSize() const {
+  return getObjectBinarySize(m_txPrefix);
+}
+
 TransactionPrefix TransactionPrefixImpl::getTransactionPrefix() const
 {
   return m_txPrefix;
@@ -241,4 +241,12 @@ std::unique_ptr<ITransactionReader> createTransactionPrefix(const Transaction& f
   return std::unique_ptr<ITransactionReader> (new TransactionPrefixImpl(fullTransaction, getObjectHash(fullTransaction)));
 }
 
+std::shared_ptr<ITransactionReader> createTransactionPrefix(TransactionPrefix&& prefix, const Hash& transactionHash, Common::Arena& arena) {
+  return std::allocate_shared<TransactionPrefixImpl>(Common::ArenaAllocator<TransactionPrefixImpl>(arena), std::move(prefix), transactionHash);
+}
+
+std::shared_ptr<ITransactionReader> createTransactionPrefix(const Transaction& fullTransaction, Common::Arena& arena) {
+  return std::allocate_shared<TransactionPrefixImpl>(Common::ArenaAllocator<TransactionPrefixImpl>(arena), fullTransaction, getObjectHash(fullTransaction));
+}
+
 }
@@ -0,0 +1,55 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "TransactionTreeHash.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace CryptoNote {
+
+void TransactionTreeHash::assign(const std::vector<Crypto::Hash>& transactionHashes) {
+  m_leaves.resize(transactionHashes.size() + 1);
+  std::copy(transactionHashes.begin(), transactionHashes.end(), m_leaves.begin() + 1);
+
+  m_branch.resize(Crypto::tree_depth(m_leaves.size()));
+  m_scratch.resize(m_leaves.size());
+  Crypto::tree_branch(m_leaves.data(), m_leaves.size(), m_branch.data(), m_scratch.data());
+}
+
+bool TransactionTreeHash::matches(const std::vector<Crypto::Hash>& transactionHashes) const {
+  return m_leaves.size() == transactionHashes.size() + 1 &&
+    (transactionHashes.empty() || memcmp(m_leaves.data() + 1, transactionHashes.data(), transactionHashes.size() * sizeof(Crypto::Hash)) == 0);
+}
+
+Crypto::Hash TransactionTreeHash::getRoot(const Crypto::Hash& baseTransactionHash) const {
+  Crypto::Hash root;
+  // the coinbase is leaf 0, a path of all zero bits
+  Crypto::tree_hash_from_branch(m_branch.data(), m_branch.size(), baseTransactionHash, nullptr, root);
+  return root;
+}
+
+Crypto::Hash getTransactionTreeHash(const Crypto::Hash& baseTransactionHash, const std::vector<Crypto::Hash>& transactionHashes) {
+  static thread_local TransactionTreeHash last;
+  if (!last.matches(transactionHashes)) {
+    last.assign(transactionHashes);
+  }
+
+  return last.getRoot(baseTransactionHash);
+}
+
+}
@@ -0,0 +1,50 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <vector>
+
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+// Transaction tree hash of a block whose transactions after the coinbase stay the same while the
+// coinbase changes, as it does between template updates and between building and checking a
+// block. The sibling path of the coinbase leaf is hashed once in assign(), after which getRoot()
+// costs log2(transaction count) hashes instead of the whole tree. The buffers are kept across
+// assign() calls.
+class TransactionTreeHash {
+public:
+  // transactionHashes are the block's transactions without the coinbase
+  void assign(const std::vector<Crypto::Hash>& transactionHashes);
+  bool matches(const std::vector<Crypto::Hash>& transactionHashes) const;
+  Crypto::Hash getRoot(const Crypto::Hash& baseTransactionHash) const;
+
+private:
+  // the coinbase slot at the front is a placeholder, tree_branch never reads it
+  std::vector<Crypto::Hash> m_leaves;
+  std::vector<Crypto::Hash> m_branch;
+  std::vector<Crypto::Hash> m_scratch;
+};
+
+// Same result as Crypto::tree_hash over the coinbase hash followed by transactionHashes. Each
+// thread keeps the branch of the transaction list it saw last, so hashing the same block or a
+// template with a new coinbase again only redoes the coinbase path.
+Crypto::Hash getTransactionTreeHash(const Crypto::Hash& baseTransactionHash, const std::vector<Crypto::Hash>& transactionHashes);
+
+}
@@ -38,185 +38,275 @@ namespace CryptoNote {
 
   static_assert(CryptoNote::UpgradeDetectorBase::UNDEF_HEIGHT == UINT32_C(0xFFFFFFFF), "UpgradeDetectorBase::UNDEF_HEIGHT has invalid value");
 
+  // Tracks the upgrades to every block major version from BLOCK_MAJOR_VERSION_2 to
+  // BLOCK_MAJOR_VERSION_9. Versions with an upgrade height fixed by the currency are
+  // checked in closed form; the voting complete heights of the others are found
+  // together in one scan of the chain.
   template <typename BC>
-  class BasicUpgradeDetector : public UpgradeDetectorBase {
+  class MultiUpgradeDetector : public UpgradeDetectorBase {
   public:
-    BasicUpgradeDetector(const Currency& currency, BC& blockchain, uint8_t targetVersion, Logging::ILogger& log) :
+    enum : uint8_t {
+      FIRST_VERSION = BLOCK_MAJOR_VERSION_2,
+      LAST_VERSION = BLOCK_MAJOR_VERSION_9,
+      VERSION_COUNT = LAST_VERSION - FIRST_VERSION + 1
+    };
+
+    MultiUpgradeDetector(const Currency& currency, BC& blockchain, Logging::ILogger& log) :
+      logger(log, "upgrade"),
       m_currency(currency),
-      m_blockchain(blockchain),
-      m_targetVersion(targetVersion),
-      m_votingCompleteHeight(UNDEF_HEIGHT),
-      logger(log, "upgrade") {
+      m_blockchain(blockchain) {
+      for (uint8_t version = FIRST_VERSION; version <= LAST_VERSION; ++version) {
+        m_fixedUpgradeHeights[version - FIRST_VERSION] = m_currency.upgradeHeight(version);
+        m_votingCompleteHeights[version - FIRST_VERSION] = UNDEF_HEIGHT;
+      }
     }
 
     bool init() {
-      uint32_t upgradeHeight = m_currency.upgradeHeight(m_targetVersion);
-      if (upgradeHeight == UNDEF_HEIGHT) {
-        if (m_blockchain.empty()) {
-          m_votingCompleteHeight = UNDEF_HEIGHT;
-
-        } else if (m_targetVersion - 1 == m_blockchain.back().bl.majorVersion) {
-          m_votingCompleteHeight = findVotingCompleteHeight(m_blockchain.size() - 1);
-
-        } else if (m_targetVersion <= m_blockchain.back().bl.majorVersion) {
-          auto it = std::lower_bound(m_blockchain.begin(), m_blockchain.end(), m_targetVersion,
-            [](const typename BC::value_type& b, uint8_t v) { return b.bl.majorVersion < v; });
-          if (it == m_blockchain.end() || it->bl.majorVersion != m_targetVersion) {
-            logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: upgrade height isn't found";
-            return false;
+      // voting windows to scan, keyed by version: [first, last] candidate voting complete heights
+      uint32_t scanFirst[VERSION_COUNT];
+      uint32_t scanLast[VERSION_COUNT];
+      bool scan = false;
+      bool result = true;
+
+      for (uint8_t version = FIRST_VERSION; version <= LAST_VERSION; ++version) {
+        size_t i = version - FIRST_VERSION;
+        m_votingCompleteHeights[i] = UNDEF_HEIGHT;
+        scanFirst[i] = UNDEF_HEIGHT;
+
+        uint32_t upgradeHeight = m_fixedUpgradeHeights[i];
+        if (upgradeHeight != UNDEF_HEIGHT) {
+          result = checkFixedUpgrade(version, upgradeHeight) && result;
+        } else if (!m_blockchain.empty() && version - 1 <= m_blockchain.back().majorVersion) {
+          uint32_t probableUpgradeHeight;
+          if (version - 1 == m_blockchain.back().majorVersion) {
+            probableUpgradeHeight = m_blockchain.size() - 1;
+          } else {
+            auto it = std::lower_bound(m_blockchain.begin(), m_blockchain.end(), version,
+              [](const typename BC::value_type& b, uint8_t v) { return b.majorVersion < v; });
+            if (it == m_blockchain.end() || it->majorVersion != version) {
+              logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: upgrade height isn't found, version " << static_cast<int>(version);
+              result = false;
+              continue;
+            }
+
+            probableUpgradeHeight = static_cast<uint32_t>(it - m_blockchain.begin());
           }
 
-          uint32_t upgradeHeight = it - m_blockchain.begin();
-          m_votingCompleteHeight = findVotingCompleteHeight(upgradeHeight);
-          if (m_votingCompleteHeight == UNDEF_HEIGHT) {
-            logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: voting complete height isn't found, upgrade height = " << upgradeHeight;
-            return false;
-          }
-        } else {
-          m_votingCompleteHeight = UNDEF_HEIGHT;
+          scanFirst[i] = probableUpgradeHeight > m_currency.maxUpgradeDistance() ? probableUpgradeHeight - m_currency.maxUpgradeDistance() : 0;
+          scanLast[i] = probableUpgradeHeight;
+          scan = true;
         }
-      } else if (!m_blockchain.empty()) {
-        if (m_blockchain.size() <= upgradeHeight + 1) {
-          if (m_blockchain.back().bl.majorVersion >= m_targetVersion) {
-            logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: block at height " << (m_blockchain.size() - 1) <<
-              " has invalid version " << static_cast<int>(m_blockchain.back().bl.majorVersion) <<
-              ", expected " << static_cast<int>(m_targetVersion - 1) << " or less";
-            return false;
-          }
-        } else {
-          int blockVersionAtUpgradeHeight = m_blockchain[upgradeHeight].bl.majorVersion;
-          if (blockVersionAtUpgradeHeight != m_targetVersion - 1) {
-          }
+      }
 
-          int blockVersionAfterUpgradeHeight = m_blockchain[upgradeHeight + 1].bl.majorVersion;
-          if (blockVersionAfterUpgradeHeight != m_targetVersion) {
-            logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: block at height " << (upgradeHeight + 1) <<
-              " has invalid version " << blockVersionAfterUpgradeHeight <<
-              ", expected " << static_cast<int>(m_targetVersion);
-            return false;
-          }
+      if (scan) {
+        findVotingCompleteHeights(scanFirst, scanLast);
+      }
+
+      for (uint8_t version = FIRST_VERSION; version <= LAST_VERSION; ++version) {
+        size_t i = version - FIRST_VERSION;
+        if (scanFirst[i] != UNDEF_HEIGHT && m_votingCompleteHeights[i] == UNDEF_HEIGHT && version <= m_blockchain.back().majorVersion) {
+          logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: voting complete height isn't found, upgrade height = " << scanLast[i] <<
+            ", version " << static_cast<int>(version);
+          result = false;
         }
       }
 
-      return true;
+      return result;
     }
 
-    uint8_t targetVersion() const {
-      return m_targetVersion;
-    }
-    uint32_t votingCompleteHeight() const {
-      return m_votingCompleteHeight;
+    uint32_t votingCompleteHeight(uint8_t version) const {
+      return m_votingCompleteHeights[version - FIRST_VERSION];
     }
 
-    uint32_t upgradeHeight() const {
-      if (m_currency.upgradeHeight(m_targetVersion) == UNDEF_HEIGHT) {
-        return m_votingCompleteHeight == UNDEF_HEIGHT ? UNDEF_HEIGHT : m_currency.calculateUpgradeHeight(m_votingCompleteHeight);
-      } else {
-        return m_currency.upgradeHeight(m_targetVersion);
+    uint32_t upgradeHeight(uint8_t version) const {
+      uint32_t fixedHeight = m_fixedUpgradeHeights[version - FIRST_VERSION];
+      if (fixedHeight != UNDEF_HEIGHT) {
+        return fixedHeight;
       }
-    }
 
-    void blockPushed() {
-      assert(!m_blockchain.empty());
+      uint32_t votingCompleteHeight = m_votingCompleteHeights[version - FIRST_VERSION];
+      return votingCompleteHeight == UNDEF_HEIGHT ? UNDEF_HEIGHT : m_currency.calculateUpgradeHeight(votingCompleteHeight);
+    }
 
-      if (m_currency.upgradeHeight(m_targetVersion) != UNDEF_HEIGHT) {
-        if (m_blockchain.size() <= m_currency.upgradeHeight(m_targetVersion) + 1) {
-          assert(m_blockchain.back().bl.majorVersion <= m_targetVersion - 1);
-        } else {
-          assert(m_blockchain.back().bl.majorVersion >= m_targetVersion);
+    // Major version a block at height must have
+    uint8_t blockMajorVersion(uint32_t height) const {
+      for (uint8_t version = LAST_VERSION; version >= FIRST_VERSION; --version) {
+        if (height > upgradeHeight(version)) {
+          return version;
         }
+      }
 
-      } else if (m_votingCompleteHeight != UNDEF_HEIGHT) {
-        assert(m_blockchain.size() > m_votingCompleteHeight);
-
-        if (m_blockchain.size() <= upgradeHeight()) {
-          assert(m_blockchain.back().bl.majorVersion == m_targetVersion - 1);
-
-          if (m_blockchain.size() % (60 * 60 / m_currency.difficultyTarget()) == 0) {
-            auto interval = m_currency.difficultyTarget() * (upgradeHeight() - m_blockchain.size() + 2);
-            time_t upgradeTimestamp = time(nullptr) + static_cast<time_t>(interval);
-            struct tm* upgradeTime = localtime(&upgradeTimestamp);;
-            char upgradeTimeStr[40];
-            strftime(upgradeTimeStr, 40, "%H:%M:%S %Y.%m.%d", upgradeTime);
-
-            logger(Logging::TRACE, Logging::BRIGHT_GREEN) << "###### UPGRADE is going to happen after block index " << upgradeHeight() << " at about " <<
-              upgradeTimeStr << " (in " << Common::timeIntervalToString(interval) << ")! Current last block index " << (m_blockchain.size() - 1) <<
-              ", hash " << get_block_hash(m_blockchain.back().bl);
-          }
-        } else if (m_blockchain.size() == upgradeHeight() + 1) {
-          assert(m_blockchain.back().bl.majorVersion == m_targetVersion - 1);
+      return BLOCK_MAJOR_VERSION_1;
+    }
 
-          logger(Logging::TRACE, Logging::BRIGHT_GREEN) << "###### UPGRADE has happened! Starting from block index " << (upgradeHeight() + 1) <<
-            " blocks with major version below " << static_cast<int>(m_targetVersion) << " will be rejected!";
-        } else {
-          assert(m_blockchain.back().bl.majorVersion == m_targetVersion);
-        }
+    void blockPushed() {
+      assert(!m_blockchain.empty());
 
-      } else {
-        uint32_t lastBlockHeight = m_blockchain.size() - 1;
-        if (isVotingComplete(lastBlockHeight)) {
-          m_votingCompleteHeight = lastBlockHeight;
-          logger(Logging::TRACE, Logging::BRIGHT_GREEN) << "###### UPGRADE voting complete at block index " << m_votingCompleteHeight <<
-            "! UPGRADE is going to happen after block index " << upgradeHeight() << "!";
-        }
+      for (uint8_t version = FIRST_VERSION; version <= LAST_VERSION; ++version) {
+        blockPushed(version);
       }
     }
 
     void blockPopped() {
-      if (m_votingCompleteHeight != UNDEF_HEIGHT) {
-        assert(m_currency.upgradeHeight(m_targetVersion) == UNDEF_HEIGHT);
-
-        if (m_blockchain.size() == m_votingCompleteHeight) {
-          logger(Logging::TRACE, Logging::BRIGHT_YELLOW) << "###### UPGRADE after block index " << upgradeHeight() << " has been canceled!";
-          m_votingCompleteHeight = UNDEF_HEIGHT;
-        } else {
-          assert(m_blockchain.size() > m_votingCompleteHeight);
+      for (uint8_t version = FIRST_VERSION; version <= LAST_VERSION; ++version) {
+        size_t i = version - FIRST_VERSION;
+        if (m_votingCompleteHeights[i] != UNDEF_HEIGHT) {
+          assert(m_fixedUpgradeHeights[i] == UNDEF_HEIGHT);
+
+          if (m_blockchain.size() == m_votingCompleteHeights[i]) {
+            logger(Logging::TRACE, Logging::BRIGHT_YELLOW) << "###### UPGRADE after block index " << upgradeHeight(version) << " has been canceled!";
+            m_votingCompleteHeights[i] = UNDEF_HEIGHT;
+          } else {
+            assert(m_blockchain.size() > m_votingCompleteHeights[i]);
+          }
         }
       }
     }
 
-    size_t getNumberOfVotes(uint32_t height) {
+    size_t getNumberOfVotes(uint8_t version, uint32_t height) const {
       if (height < m_currency.upgradeVotingWindow() - 1) {
         return 0;
       }
 
       size_t voteCounter = 0;
-      for (size_t i = height + 1 - m_currency.upgradeVotingWindow(); i <= height; ++i) {
-        const auto& b = m_blockchain[i].bl;
-        voteCounter += (b.majorVersion == m_targetVersion - 1) && (b.minorVersion == BLOCK_MINOR_VERSION_1) ? 1 : 0;
+      for (uint32_t i = height + 1 - m_currency.upgradeVotingWindow(); i <= height; ++i) {
+        voteCounter += votesFor(m_blockchain[i]) == version ? 1 : 0;
       }
 
       return voteCounter;
     }
 
   private:
-    uint32_t findVotingCompleteHeight(uint32_t probableUpgradeHeight) {
-      assert(m_currency.upgradeHeight(m_targetVersion) == UNDEF_HEIGHT);
+    // Version a block votes for, or 0 if it doesn't vote
+    static uint8_t votesFor(const typename BC::value_type& b) {
+      return b.minorVersion == BLOCK_MINOR_VERSION_1 ? static_cast<uint8_t>(b.majorVersion + 1) : 0;
+    }
+
+    bool enoughVotes(size_t voteCounter) const {
+      assert(m_currency.upgradeVotingWindow() > 1);
+      assert(m_currency.upgradeVotingThreshold() > 0 && m_currency.upgradeVotingThreshold() <= 100);
+      return m_currency.upgradeVotingThreshold() * m_currency.upgradeVotingWindow() <= 100 * voteCounter;
+    }
+
+    bool checkFixedUpgrade(uint8_t version, uint32_t upgradeHeight) {
+      if (m_blockchain.empty()) {
+        return true;
+      }
 
-      uint32_t probableVotingCompleteHeight = probableUpgradeHeight > m_currency.maxUpgradeDistance() ? probableUpgradeHeight - m_currency.maxUpgradeDistance() : 0;
-      for (size_t i = probableVotingCompleteHeight; i <= probableUpgradeHeight; ++i) {
-        if (isVotingComplete(static_cast<uint32_t>(i))) {
-          return static_cast<uint32_t>(i);
+      if (m_blockchain.size() <= upgradeHeight + 1) {
+        if (m_blockchain.back().majorVersion >= version) {
+          logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: block at height " << (m_blockchain.size() - 1) <<
+            " has invalid version " << static_cast<int>(m_blockchain.back().majorVersion) <<
+            ", expected " << static_cast<int>(version - 1) << " or less";
+          return false;
+        }
+      } else {
+        int blockVersionAfterUpgradeHeight = m_blockchain[upgradeHeight + 1].majorVersion;
+        if (blockVersionAfterUpgradeHeight != version) {
+          logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: block at height " << (upgradeHeight + 1) <<
+            " has invalid version " << blockVersionAfterUpgradeHeight <<
+            ", expected " << static_cast<int>(version);
+          return false;
         }
       }
 
-      return UNDEF_HEIGHT;
+      return true;
     }
 
-    bool isVotingComplete(uint32_t height) {
-      assert(m_currency.upgradeHeight(m_targetVersion) == UNDEF_HEIGHT);
-      assert(m_currency.upgradeVotingWindow() > 1);
-      assert(m_currency.upgradeVotingThreshold() > 0 && m_currency.upgradeVotingThreshold() <= 100);
+    // Slides one voting window over the union of the candidate ranges, keeping a vote
+    // counter per version, and records the first height in each version's range at
+    // which its votes reach the threshold
+    void findVotingCompleteHeights(const uint32_t* scanFirst, const uint32_t* scanLast) {
+      const uint32_t window = m_currency.upgradeVotingWindow();
+      uint32_t first = UNDEF_HEIGHT;
+      uint32_t last = 0;
+      for (size_t i = 0; i < VERSION_COUNT; ++i) {
+        if (scanFirst[i] != UNDEF_HEIGHT) {
+          first = std::min(first, scanFirst[i]);
+          last = std::max(last, scanLast[i]);
+        }
+      }
 
-      size_t voteCounter = getNumberOfVotes(height);
-      return m_currency.upgradeVotingThreshold() * m_currency.upgradeVotingWindow() <= 100 * voteCounter;
+      size_t votes[VERSION_COUNT] = {};
+      const uint32_t start = first >= window - 1 ? first + 1 - window : 0;
+      for (uint32_t height = start; height <= last; ++height) {
+        uint8_t vote = votesFor(m_blockchain[height]);
+        if (vote >= FIRST_VERSION && vote <= LAST_VERSION) {
+          ++votes[vote - FIRST_VERSION];
+        }
+
+        if (height >= start + window) {
+          uint8_t expired = votesFor(m_blockchain[height - window]);
+          if (expired >= FIRST_VERSION && expired <= LAST_VERSION) {
+            --votes[expired - FIRST_VERSION];
+          }
+        }
+
+        if (height < first || height + 1 < window) {
+          continue;
+        }
+
+        for (size_t i = 0; i < VERSION_COUNT; ++i) {
+          if (m_votingCompleteHeights[i] == UNDEF_HEIGHT && scanFirst[i] != UNDEF_HEIGHT &&
+              height >= scanFirst[i] && height <= scanLast[i] && enoughVotes(votes[i])) {
+            m_votingCompleteHeights[i] = height;
+          }
+        }
+      }
+    }
+
+    void blockPushed(uint8_t version) {
+      size_t i = version - FIRST_VERSION;
+      uint32_t& votingCompleteHeight = m_votingCompleteHeights[i];
+
+      if (m_fixedUpgradeHeights[i] != UNDEF_HEIGHT) {
+        if (m_blockchain.size() <= m_fixedUpgradeHeights[i] + 1) {
+          assert(m_blockchain.back().majorVersion <= version - 1);
+        } else {
+          assert(m_blockchain.back().majorVersion >= version);
+        }
+
+      } else if (votingCompleteHeight != UNDEF_HEIGHT) {
+        assert(m_blockchain.size() > votingCompleteHeight);
+
+        uint32_t upgradeHeight = this->upgradeHeight(version);
+        if (m_blockchain.size() <= upgradeHeight) {
+          assert(m_blockchain.back().majorVersion == version - 1);
+
+          if (m_blockchain.size() % (60 * 60 / m_currency.difficultyTarget()) == 0) {
+            auto interval = m_currency.difficultyTarget() * (upgradeHeight - m_blockchain.size() + 2);
+            time_t upgradeTimestamp = time(nullptr) + static_cast<time_t>(interval);
+            struct tm* upgradeTime = localtime(&upgradeTimestamp);
+            char upgradeTimeStr[40];
+            strftime(upgradeTimeStr, 40, "%H:%M:%S %Y.%m.%d", upgradeTime);
+
+            logger(Logging::TRACE, Logging::BRIGHT_GREEN) << "###### UPGRADE is going to happen after block index " << upgradeHeight << " at about " <<
+              upgradeTimeStr << " (in " << Common::timeIntervalToString(interval) << ")! Current last block index " << (m_blockchain.size() - 1);
+          }
+        } else if (m_blockchain.size() == upgradeHeight + 1) {
+          assert(m_blockchain.back().majorVersion == version - 1);
+
+          logger(Logging::TRACE, Logging::BRIGHT_GREEN) << "###### UPGRADE has happened! Starting from block index " << (upgradeHeight + 1) <<
+            " blocks with major version below " << static_cast<int>(version) << " will be rejected!";
+        } else {
+          assert(m_blockchain.back().majorVersion == version);
+        }
+
+      } else {
+        uint32_t lastBlockHeight = m_blockchain.size() - 1;
+        if (enoughVotes(getNumberOfVotes(version, lastBlockHeight))) {
+          votingCompleteHeight = lastBlockHeight;
+          logger(Logging::TRACE, Logging::BRIGHT_GREEN) << "###### UPGRADE voting complete at block index " << votingCompleteHeight <<
+            "! UPGRADE is going to happen after block index " << upgradeHeight(version) << "!";
+        }
+      }
     }
 
   private:
     Logging::LoggerRef logger;
     const Currency& m_currency;
     BC& m_blockchain;
-    uint8_t m_targetVersion;
-    uint32_t m_votingCompleteHeight;
+    uint32_t m_fixedUpgradeHeights[VERSION_COUNT];
+    uint32_t m_votingCompleteHeights[VERSION_COUNT];
   };
 }
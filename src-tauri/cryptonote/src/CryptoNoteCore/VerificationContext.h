@@ -16,6 +16,9 @@
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 
 #pragma once
+
+#include <cstdint>
+
 namespace CryptoNote
 {
   /************************************************************************/
@@ -37,5 +40,7 @@ namespace CryptoNote
     bool m_marked_as_orphaned;
     bool m_already_exists;
     bool m_switched_to_alt_chain;
+    uint32_t m_ring_signatures_checked; //throughput metric: signatures / m_ring_signature_check_us
+    uint64_t m_ring_signature_check_us;
   };
 }
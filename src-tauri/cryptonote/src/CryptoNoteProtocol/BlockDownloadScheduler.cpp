@@ -0,0 +1,268 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#include "BlockDownloadScheduler.h"
+
+#include <algorithm>
+
+namespace CryptoNote {
+
+namespace {
+
+const std::chrono::seconds MIN_STALL_TIMEOUT(10);
+const double STALL_TIMEOUT_FACTOR = 4.0;
+const double THROUGHPUT_SMOOTHING = 0.3;
+const size_t MAX_CHUNK_ASSIGNEES = 2;
+
+}
+
+BlockDownloadScheduler::BlockDownloadScheduler(size_t chunkSize, size_t maxChunksAhead) :
+  m_chunkSize(chunkSize), m_maxChunksAhead(maxChunksAhead), m_scheduledEnd(0), m_reassigned(0), m_duplicates(0) {
+}
+
+void BlockDownloadScheduler::addPeerSpan(const PeerId& peer, uint32_t startHeight, const std::vector<Crypto::Hash>& ids) {
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end()) {
+    Peer newPeer;
+    newPeer.busy = false;
+    newPeer.chunkHeight = 0;
+    newPeer.blocksPerSecond = 0;
+    it = m_peers.emplace(peer, newPeer).first;
+  }
+
+  it->second.startHeight = startHeight;
+  it->second.ids = ids;
+  carve(m_chunks.empty() ? startHeight : m_scheduledEnd, startHeight, ids);
+}
+
+bool BlockDownloadScheduler::assign(const PeerId& peer, Clock::time_point now, std::vector<Crypto::Hash>& ids) {
+  auto peerIt = m_peers.find(peer);
+  if (peerIt == m_peers.end() || peerIt->second.busy) {
+    return false;
+  }
+
+  Peer& p = peerIt->second;
+  auto selected = m_chunks.end();
+  size_t window = 0;
+  for (auto it = m_chunks.begin(); it != m_chunks.end() && window < m_maxChunksAhead; ++it, ++window) {
+    if (!it->second.delivered && it->second.assignees.empty() && canServe(p, it->first, it->second)) {
+      selected = it;
+      break;
+    }
+  }
+
+  if (selected == m_chunks.end()) {
+    window = 0;
+    for (auto it = m_chunks.begin(); it != m_chunks.end() && window < m_maxChunksAhead; ++it, ++window) {
+      const Chunk& chunk = it->second;
+      if (!chunk.delivered && chunk.assignees.size() < MAX_CHUNK_ASSIGNEES &&
+          std::find(chunk.assignees.begin(), chunk.assignees.end(), peer) == chunk.assignees.end() &&
+          isStalled(chunk, now) && canServe(p, it->first, chunk)) {
+        selected = it;
+        ++m_reassigned;
+        break;
+      }
+    }
+  }
+
+  if (selected == m_chunks.end()) {
+    return false;
+  }
+
+  selected->second.assignees.push_back(peer);
+  selected->second.requestedAt = now;
+  p.busy = true;
+  p.chunkHeight = selected->first;
+  p.requestedAt = now;
+  ids = selected->second.ids;
+  return true;
+}
+
+bool BlockDownloadScheduler::deliver(const PeerId& peer, Clock::time_point now, size_t blocks, uint32_t& chunkHeight) {
+  auto peerIt = m_peers.find(peer);
+  if (peerIt == m_peers.end() || !peerIt->second.busy) {
+    return false;
+  }
+
+  Peer& p = peerIt->second;
+  p.busy = false;
+  chunkHeight = p.chunkHeight;
+
+  double seconds = std::max(0.001, std::chrono::duration<double>(now - p.requestedAt).count());
+  double rate = static_cast<double>(blocks) / seconds;
+  p.blocksPerSecond = p.blocksPerSecond == 0 ? rate : (1 - THROUGHPUT_SMOOTHING) * p.blocksPerSecond + THROUGHPUT_SMOOTHING * rate;
+
+  auto it = m_chunks.find(chunkHeight);
+  if (it == m_chunks.end() || it->second.delivered ||
+      std::find(it->second.assignees.begin(), it->second.assignees.end(), peer) == it->second.assignees.end()) {
+    ++m_duplicates;
+    return false;
+  }
+
+  it->second.delivered = true;
+  it->second.assignees.clear();
+  return true;
+}
+
+bool BlockDownloadScheduler::takeReady(uint32_t& chunkHeight) {
+  if (m_chunks.empty() || !m_chunks.begin()->second.delivered) {
+    return false;
+  }
+
+  chunkHeight = m_chunks.begin()->first;
+  m_chunks.erase(m_chunks.begin());
+  return true;
+}
+
+std::vector<uint32_t> BlockDownloadScheduler::removePeer(const PeerId& peer) {
+  std::vector<uint32_t> dropped;
+  auto peerIt = m_peers.find(peer);
+  if (peerIt == m_peers.end()) {
+    return dropped;
+  }
+
+  if (peerIt->second.busy) {
+    auto it = m_chunks.find(peerIt->second.chunkHeight);
+    if (it != m_chunks.end()) {
+      auto& assignees = it->second.assignees;
+      assignees.erase(std::remove(assignees.begin(), assignees.end(), peer), assignees.end());
+    }
+  }
+
+  m_peers.erase(peerIt);
+
+  for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it) {
+    if (it->second.delivered) {
+      continue;
+    }
+
+    bool served = false;
+    for (const auto& p : m_peers) {
+      if (canServe(p.second, it->first, it->second)) {
+        served = true;
+        break;
+      }
+    }
+
+    if (!served) {
+      dropFrom(it->first, dropped);
+      break;
+    }
+  }
+
+  return dropped;
+}
+
+std::vector<uint32_t> BlockDownloadScheduler::reschedule(uint32_t height) {
+  std::vector<uint32_t> dropped;
+  dropFrom(height, dropped);
+  return dropped;
+}
+
+bool BlockDownloadScheduler::isIdle(const PeerId& peer) const {
+  auto it = m_peers.find(peer);
+  return it != m_peers.end() && !it->second.busy;
+}
+
+bool BlockDownloadScheduler::coversPeer(const PeerId& peer) const {
+  auto it = m_peers.find(peer);
+  return it != m_peers.end() && !m_chunks.empty() &&
+    m_chunks.begin()->first < it->second.startHeight + static_cast<uint32_t>(it->second.ids.size());
+}
+
+BlockDownloadScheduler::Stats BlockDownloadScheduler::getStats() const {
+  Stats stats = {};
+  stats.peers = m_peers.size();
+  stats.chunks = m_chunks.size();
+  stats.reassigned = m_reassigned;
+  stats.duplicates = m_duplicates;
+  for (const auto& chunk : m_chunks) {
+    if (chunk.second.delivered) {
+      ++stats.delivered;
+    } else if (!chunk.second.assignees.empty()) {
+      ++stats.inFlight;
+    }
+  }
+
+  for (const auto& peer : m_peers) {
+    stats.blocksPerSecond += peer.second.blocksPerSecond;
+  }
+
+  return stats;
+}
+
+bool BlockDownloadScheduler::canServe(const Peer& peer, uint32_t chunkHeight, const Chunk& chunk) const {
+  if (chunkHeight < peer.startHeight || chunkHeight - peer.startHeight + chunk.ids.size() > peer.ids.size()) {
+    return false;
+  }
+
+  size_t offset = chunkHeight - peer.startHeight;
+  return peer.ids[offset] == chunk.ids.front() && peer.ids[offset + chunk.ids.size() - 1] == chunk.ids.back();
+}
+
+bool BlockDownloadScheduler::isStalled(const Chunk& chunk, Clock::time_point now) const {
+  for (const PeerId& assignee : chunk.assignees) {
+    auto it = m_peers.find(assignee);
+    if (it == m_peers.end()) {
+      continue;
+    }
+
+    // give a peer a few times the duration its measured throughput predicts before asking another one
+    Clock::duration timeout = MIN_STALL_TIMEOUT;
+    if (it->second.blocksPerSecond > 0) {
+      double expected = STALL_TIMEOUT_FACTOR * static_cast<double>(chunk.ids.size()) / it->second.blocksPerSecond;
+      timeout = std::max(timeout, std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(expected)));
+    }
+
+    if (now - chunk.requestedAt <= timeout) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void BlockDownloadScheduler::carve(uint32_t height, uint32_t startHeight, const std::vector<Crypto::Hash>& ids) {
+  // chunks are only carved past what is already scheduled, the first peer to advertise a height decides its ids
+  height = std::max(height, startHeight);
+  uint32_t end = startHeight + static_cast<uint32_t>(ids.size());
+  while (height < end) {
+    uint32_t chunkEnd = std::min(end, height + static_cast<uint32_t>(m_chunkSize));
+    Chunk chunk;
+    chunk.ids.assign(ids.begin() + (height - startHeight), ids.begin() + (chunkEnd - startHeight));
+    chunk.delivered = false;
+    m_chunks.emplace(height, std::move(chunk));
+    height = chunkEnd;
+  }
+
+  m_scheduledEnd = std::max(m_scheduledEnd, end);
+}
+
+void BlockDownloadScheduler::dropFrom(uint32_t height, std::vector<uint32_t>& dropped) {
+  auto it = m_chunks.lower_bound(height);
+  for (auto dropIt = it; dropIt != m_chunks.end(); ++dropIt) {
+    dropped.push_back(dropIt->first);
+  }
+
+  m_chunks.erase(it, m_chunks.end());
+  m_scheduledEnd = height;
+  for (const auto& peer : m_peers) {
+    carve(m_scheduledEnd, peer.second.startHeight, peer.second.ids);
+  }
+}
+
+}
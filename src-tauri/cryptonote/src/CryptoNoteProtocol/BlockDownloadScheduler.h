@@ -0,0 +1,107 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free & open source software distributed in the hope
+// that it will be useful, but WITHOUT ANY WARRANTY; without even
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You may redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+// Splits the blocks advertised by the peers we synchronize from into fixed size chunks and
+// hands them out so several connections download at once. Payloads stay with the caller,
+// the scheduler only tracks who fetches what and in which order the chunks may be applied.
+// Not thread safe, it is only used on the dispatcher.
+class BlockDownloadScheduler {
+public:
+  typedef std::chrono::steady_clock Clock;
+  typedef boost::uuids::uuid PeerId;
+
+  struct Stats {
+    size_t peers;
+    size_t chunks;
+    size_t inFlight;
+    size_t delivered;
+    uint64_t reassigned;
+    uint64_t duplicates;
+    double blocksPerSecond;
+  };
+
+  BlockDownloadScheduler(size_t chunkSize, size_t maxChunksAhead);
+
+  // ids advertised by the peer in a chain entry, the first one at startHeight; only ids we do
+  // not have yet should be passed
+  void addPeerSpan(const PeerId& peer, uint32_t startHeight, const std::vector<Crypto::Hash>& ids);
+  // picks the next chunk for an idle peer: the lowest unassigned one it can serve, or one
+  // whose download stalled on slower peers
+  bool assign(const PeerId& peer, Clock::time_point now, std::vector<Crypto::Hash>& ids);
+  // records the response of a peer, returns false when another peer delivered the chunk first
+  bool deliver(const PeerId& peer, Clock::time_point now, size_t blocks, uint32_t& chunkHeight);
+  // pops the lowest chunk once it has been delivered, chunks are applied strictly in order
+  bool takeReady(uint32_t& chunkHeight);
+  // forgets the peer; returns chunks that nobody else can fetch, they are dropped together
+  // with everything above them and are scheduled again from the next chain entries
+  std::vector<uint32_t> removePeer(const PeerId& peer);
+  // drops the chunks from height up, after a chunk failed to apply, and carves them again
+  // from the spans of the remaining peers; returns the dropped chunks
+  std::vector<uint32_t> reschedule(uint32_t height);
+
+  // known peer without a request in flight
+  bool isIdle(const PeerId& peer) const;
+  // true while chunks inside the span of the peer are not applied yet
+  bool coversPeer(const PeerId& peer) const;
+  Stats getStats() const;
+
+private:
+  struct Chunk {
+    std::vector<Crypto::Hash> ids;
+    std::vector<PeerId> assignees;
+    Clock::time_point requestedAt;
+    bool delivered;
+  };
+
+  struct Peer {
+    uint32_t startHeight;
+    std::vector<Crypto::Hash> ids;
+    bool busy;
+    uint32_t chunkHeight;
+    Clock::time_point requestedAt;
+    double blocksPerSecond;
+  };
+
+  bool canServe(const Peer& peer, uint32_t chunkHeight, const Chunk& chunk) const;
+  bool isStalled(const Chunk& chunk, Clock::time_point now) const;
+  void carve(uint32_t height, uint32_t startHeight, const std::vector<Crypto::Hash>& ids);
+  void dropFrom(uint32_t height, std::vector<uint32_t>& dropped);
+
+  const size_t m_chunkSize;
+  const size_t m_maxChunksAhead;
+  std::map<uint32_t, Chunk> m_chunks;
+  std::map<PeerId, Peer> m_peers;
+  uint32_t m_scheduledEnd;
+  uint64_t m_reassigned;
+  uint64_t m_duplicates;
+};
+
+}
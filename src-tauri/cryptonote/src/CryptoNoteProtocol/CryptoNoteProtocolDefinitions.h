@@ -50,10 +50,12 @@ namespace CryptoNote
   struct TransactionPrefixInfo {
     Crypto::Hash txHash;
     TransactionPrefix txPrefix;
+    std::vector<uint32_t> globalIndexes;  // only filled for queryBlocksLite requests that ask for them
 
     void serialize(ISerializer& s) {
       KV_MEMBER(txHash);
       KV_MEMBER(txPrefix);
+      serializeAsBinary(globalIndexes, "globalIndexes", s);
     }
   };
 
@@ -61,11 +63,69 @@ namespace CryptoNote
     Crypto::Hash blockId;
     std::string block;
     std::vector<TransactionPrefixInfo> txPrefixes;
+    std::vector<uint32_t> baseTransactionGlobalIndexes;  // see TransactionPrefixInfo::globalIndexes
 
     void serialize(ISerializer& s) {
       KV_MEMBER(blockId);
       KV_MEMBER(block);
       KV_MEMBER(txPrefixes);
+      serializeAsBinary(baseTransactionGlobalIndexes, "baseTransactionGlobalIndexes", s);
+    }
+  };
+
+  // what a light wallet needs from one transaction to find its outputs and spends; the arrays
+  // are serialized as flat blobs so a scan runs over dense memory instead of parsed prefixes
+  struct CompactTransactionInfo {
+    Crypto::Hash txHash;
+    Crypto::PublicKey txPublicKey;
+    uint32_t blockHeight;
+    uint32_t transactionIndex;               // position in block, the base transaction is 0
+    bool hasMultisignature;                  // multisignature outputs (deposits) are not listed, fetch the full transaction
+    std::vector<Crypto::PublicKey> outputKeys;
+    std::vector<uint64_t> amounts;           // parallel to outputKeys
+    std::vector<uint32_t> globalIndexes;     // parallel to outputKeys
+    std::vector<Crypto::KeyImage> keyImages;
+    std::vector<uint8_t> viewTags;           // parallel to outputKeys when the sender tagged them, else empty
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(txHash);
+      KV_MEMBER(txPublicKey);
+      KV_MEMBER(blockHeight);
+      KV_MEMBER(transactionIndex);
+      KV_MEMBER(hasMultisignature);
+      serializeAsBinary(outputKeys, "outputKeys", s);
+      serializeAsBinary(amounts, "amounts", s);
+      serializeAsBinary(globalIndexes, "globalIndexes", s);
+      serializeAsBinary(keyImages, "keyImages", s);
+      serializeAsBinary(viewTags, "viewTags", s);
+    }
+  };
+
+  // main chain block header without the transactions, read from the header index; enough to
+  // follow the chain and check timestamps before any block body is fetched
+  struct BlockHeaderInfo {
+    Crypto::Hash hash;
+    Crypto::Hash prevHash;
+    uint32_t height;
+    uint8_t majorVersion;
+    uint8_t minorVersion;
+    uint32_t nonce;
+    uint64_t timestamp;
+    uint64_t cumulativeSize;
+    uint64_t cumulativeDifficulty;
+    uint64_t alreadyGeneratedCoins;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(hash);
+      KV_MEMBER(prevHash);
+      KV_MEMBER(height);
+      KV_MEMBER(majorVersion);
+      KV_MEMBER(minorVersion);
+      KV_MEMBER(nonce);
+      KV_MEMBER(timestamp);
+      KV_MEMBER(cumulativeSize);
+      KV_MEMBER(cumulativeDifficulty);
+      KV_MEMBER(alreadyGeneratedCoins);
     }
   };
 
@@ -243,5 +303,107 @@ namespace CryptoNote
     const static int ID = BC_COMMANDS_POOL_BASE + 10;
     typedef NOTIFY_MISSING_TXS_request request;
   };
+
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  // block is serialized without its transaction hashes, short_ids holds a 6 byte id for each of them in block order;
+  // prefilled_txs are the transactions the sender expects the peer not to have
+  struct NOTIFY_NEW_COMPACT_BLOCK_request
+  {
+    std::string block;
+    uint64_t nonce;
+    std::string short_ids;
+    std::vector<std::string> prefilled_txs;
+    uint32_t current_blockchain_height;
+    uint32_t hop;
+
+    void serialize(ISerializer &s)
+    {
+      KV_MEMBER(block)
+      KV_MEMBER(nonce)
+      KV_MEMBER(short_ids)
+      KV_MEMBER(prefilled_txs)
+      KV_MEMBER(current_blockchain_height)
+      KV_MEMBER(hop)
+    }
+  };
+
+  struct NOTIFY_NEW_COMPACT_BLOCK
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 11;
+    typedef NOTIFY_NEW_COMPACT_BLOCK_request request;
+  };
+
+  struct NOTIFY_REQUEST_COMPACT_TXS_request
+  {
+    Crypto::Hash blockKey;
+    std::vector<uint32_t> indexes;
+
+    void serialize(ISerializer &s)
+    {
+      KV_MEMBER(blockKey)
+      serializeAsBinary(indexes, "indexes", s);
+    }
+  };
+
+  struct NOTIFY_REQUEST_COMPACT_TXS
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 12;
+    typedef NOTIFY_REQUEST_COMPACT_TXS_request request;
+  };
+
+  struct NOTIFY_RESPONSE_COMPACT_TXS_request
+  {
+    Crypto::Hash blockKey;
+    std::vector<std::string> txs;
+
+    void serialize(ISerializer &s)
+    {
+      KV_MEMBER(blockKey)
+      KV_MEMBER(txs)
+    }
+  };
+
+  struct NOTIFY_RESPONSE_COMPACT_TXS
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 13;
+    typedef NOTIFY_RESPONSE_COMPACT_TXS_request request;
+  };
+
+  // sent once a connection is synchronized; peers that don't know it ignore the notification
+  struct NOTIFY_COMPACT_BLOCKS_SUPPORTED_request
+  {
+    void serialize(ISerializer &s)
+    {
+    }
+  };
+
+  struct NOTIFY_COMPACT_BLOCKS_SUPPORTED
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 14;
+    typedef NOTIFY_COMPACT_BLOCKS_SUPPORTED_request request;
+  };
+
+  // pool contents as salted short ids, the receiver answers with NOTIFY_NEW_TRANSACTIONS
+  // carrying the transactions whose ids are missing; only sent to peers announcing
+  // pool_short_ids in CORE_SYNC_DATA
+  struct NOTIFY_REQUEST_TX_POOL_SHORT_IDS_request
+  {
+    uint64_t nonce;
+    std::string short_ids;
+
+    void serialize(ISerializer &s)
+    {
+      KV_MEMBER(nonce)
+      KV_MEMBER(short_ids)
+    }
+  };
+
+  struct NOTIFY_REQUEST_TX_POOL_SHORT_IDS
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 15;
+    typedef NOTIFY_REQUEST_TX_POOL_SHORT_IDS_request request;
+  };
 } // namespace CryptoNote
 
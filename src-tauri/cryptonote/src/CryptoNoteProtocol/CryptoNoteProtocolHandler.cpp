@@ -10,17 +10,22 @@
 
 #include "CryptoNoteProtocolHandler.h"
 
+#include <chrono>
 #include <future>
 #include <boost/scope_exit.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <System/Dispatcher.h>
+#include <System/RemoteContext.h>
 #include <boost/optional.hpp>
+#include "Common/Metrics.h"
+#include "CryptoNoteCore/BinaryBlobDecoder.h"
 #include "CryptoNoteCore/CryptoNoteBasicImpl.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/CryptoNoteTools.h"
 #include "CryptoNoteCore/Currency.h"
 #include "CryptoNoteCore/VerificationContext.h"
 #include "P2p/LevinProtocol.h"
+#include "crypto/crypto.h"
 
 using namespace Logging;
 using namespace Common;
@@ -43,6 +48,59 @@ void relay_post_notify(IP2pEndpoint &p2p, typename t_parametr::request &arg, con
   p2p.relay_notify_to_all(t_parametr::ID, LevinProtocol::encode(arg), excludeConnection);
 }
 
+const size_t COMPACT_SHORT_ID_SIZE = 6;
+const size_t COMPACT_BLOCK_MAX_TRANSACTIONS = 65536;
+const size_t COMPACT_BLOCK_PREFILL_LIMIT = 256 * 1024;
+const size_t COMPACT_BLOCK_SENT_CACHE_SIZE = 16;
+const size_t BLOCK_DOWNLOAD_CHUNKS_AHEAD = 16;
+
+// short ids are salted per block and sender, so nobody can grind transactions that collide on every peer
+Crypto::Hash compactBlockKey(const std::string &block, uint64_t nonce)
+{
+  std::string data = block;
+  for (size_t i = 0; i < sizeof(nonce); ++i)
+  {
+    data.push_back(static_cast<char>(nonce >> (8 * i)));
+  }
+
+  return Crypto::cn_fast_hash(data.data(), data.size());
+}
+
+uint64_t compactShortId(const Crypto::Hash &key, const Crypto::Hash &transactionHash)
+{
+  uint8_t data[2 * sizeof(Crypto::Hash)];
+  memcpy(data, &key, sizeof(key));
+  memcpy(data + sizeof(key), &transactionHash, sizeof(transactionHash));
+  Crypto::Hash hash = Crypto::cn_fast_hash(data, sizeof(data));
+
+  uint64_t id = 0;
+  for (size_t i = 0; i < COMPACT_SHORT_ID_SIZE; ++i)
+  {
+    id |= static_cast<uint64_t>(hash.data[i]) << (8 * i);
+  }
+
+  return id;
+}
+
+uint64_t readShortId(const std::string &shortIds, size_t index)
+{
+  uint64_t id = 0;
+  for (size_t i = 0; i < COMPACT_SHORT_ID_SIZE; ++i)
+  {
+    id |= static_cast<uint64_t>(static_cast<uint8_t>(shortIds[index * COMPACT_SHORT_ID_SIZE + i])) << (8 * i);
+  }
+
+  return id;
+}
+
+void appendShortId(std::string &shortIds, uint64_t id)
+{
+  for (size_t i = 0; i < COMPACT_SHORT_ID_SIZE; ++i)
+  {
+    shortIds.push_back(static_cast<char>(id >> (8 * i)));
+  }
+}
+
 } // namespace
 
 CryptoNoteProtocolHandler::CryptoNoteProtocolHandler(const Currency &currency, System::Dispatcher &dispatcher, ICore &rcore, IP2pEndpoint *p_net_layout, Logging::ILogger &log) : m_dispatcher(dispatcher),
@@ -53,7 +111,13 @@ CryptoNoteProtocolHandler::CryptoNoteProtocolHandler(const Currency &currency, S
                                                                                                                                                                                   m_stop(false),
                                                                                                                                                                                   m_observedHeight(0),
                                                                                                                                                                                   m_peersCount(0),
-                                                                                                                                                                                  logger(log, "protocol")
+                                                                                                                                                                                  logger(log, "protocol"),
+                                                                                                                                                                                  m_blockDownloads(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT, BLOCK_DOWNLOAD_CHUNKS_AHEAD),
+                                                                                                                                                                                  m_applyingChunks(false),
+                                                                                                                                                                                  m_blockVerificationQueueDepth(0),
+                                                                                                                                                                                  m_relaySuppressedTransactions(0),
+                                                                                                                                                                                  m_relaySuppressedBlocks(0),
+                                                                                                                                                                                  m_relaySavedBytes(0)
 {
 
   if (!m_p2p)
@@ -81,6 +145,8 @@ void CryptoNoteProtocolHandler::onConnectionOpened(CryptoNoteConnectionContext &
 
 void CryptoNoteProtocolHandler::onConnectionClosed(CryptoNoteConnectionContext &context)
 {
+  stopDownloading(context);
+
   bool updated = false;
   {
     std::lock_guard<std::mutex> lock(m_observedHeightMutex);
@@ -130,6 +196,9 @@ bool CryptoNoteProtocolHandler::start_sync(CryptoNoteConnectionContext &context)
 
 bool CryptoNoteProtocolHandler::get_stat_info(core_stat_info &stat_inf)
 {
+  stat_inf.relay_suppressed_transactions = m_relaySuppressedTransactions;
+  stat_inf.relay_suppressed_blocks = m_relaySuppressedBlocks;
+  stat_inf.relay_saved_bytes = m_relaySavedBytes;
   return m_core.get_stat_info(stat_inf);
 }
 
@@ -214,6 +283,7 @@ bool CryptoNoteProtocolHandler::process_payload_sync_data(const CORE_SYNC_DATA &
 
   if (is_inital)
   {
+    context.m_supports_pool_short_ids = hshd.pool_short_ids;
     m_peersCount++;
     m_observerManager.notify(&ICryptoNoteProtocolObserver::peerCountUpdated, m_peersCount.load());
   }
@@ -227,6 +297,7 @@ bool CryptoNoteProtocolHandler::get_payload_sync_data(CORE_SYNC_DATA &hshd)
   m_core.get_blockchain_top(current_height, hshd.top_id);
   hshd.current_height = current_height;
   hshd.current_height += 1;
+  hshd.pool_short_ids = true;
   return true;
 }
 
@@ -269,6 +340,11 @@ int CryptoNoteProtocolHandler::handleCommand(bool is_notify, int command, const
     HANDLE_NOTIFY(NOTIFY_REQUEST_TX_POOL, &CryptoNoteProtocolHandler::handle_request_tx_pool)
     HANDLE_NOTIFY(NOTIFY_NEW_LITE_BLOCK, &CryptoNoteProtocolHandler::handle_notify_new_lite_block)
     HANDLE_NOTIFY(NOTIFY_MISSING_TXS, &CryptoNoteProtocolHandler::handle_notify_missing_txs)
+    HANDLE_NOTIFY(NOTIFY_NEW_COMPACT_BLOCK, &CryptoNoteProtocolHandler::handle_notify_new_compact_block)
+    HANDLE_NOTIFY(NOTIFY_REQUEST_COMPACT_TXS, &CryptoNoteProtocolHandler::handle_request_compact_txs)
+    HANDLE_NOTIFY(NOTIFY_RESPONSE_COMPACT_TXS, &CryptoNoteProtocolHandler::handle_response_compact_txs)
+    HANDLE_NOTIFY(NOTIFY_COMPACT_BLOCKS_SUPPORTED, &CryptoNoteProtocolHandler::handle_notify_compact_blocks_supported)
+    HANDLE_NOTIFY(NOTIFY_REQUEST_TX_POOL_SHORT_IDS, &CryptoNoteProtocolHandler::handle_request_tx_pool_short_ids)
 
   default:
     handled = false;
@@ -281,6 +357,10 @@ int CryptoNoteProtocolHandler::handleCommand(bool is_notify, int command, const
 
 int CryptoNoteProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_BLOCK::request &arg, CryptoNoteConnectionContext &context)
 {
+  static Common::MetricHistogram& relayLatency = Common::Metrics::instance().histogram("fuego_block_relay_seconds",
+    "Time from receiving a NOTIFY_NEW_BLOCK to relaying it");
+  const auto announcedAt = std::chrono::steady_clock::now();
+
   logger(Logging::TRACE) << context << "NOTIFY_NEW_BLOCK (hop " << arg.hop << ")";
 
   updateObservedHeight(arg.current_blockchain_height, context);
@@ -292,15 +372,28 @@ int CryptoNoteProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_B
     return 1;
   }
 
-  for (auto tx_blob_it = arg.b.txs.begin(); tx_blob_it != arg.b.txs.end(); tx_blob_it++)
+  Block announced;
+  if (fromBinaryArray(announced, asBinaryArray(arg.b.block)))
   {
-    CryptoNote::tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
+    context.m_known_blocks.insert(get_block_hash(announced));
+  }
 
-    auto transactionBinary = asBinaryArray(*tx_blob_it);
-    //Crypto::Hash transactionHash = Crypto::cn_fast_hash(transactionBinary.data(), transactionBinary.size());
-    //logger(DEBUGGING) << "transaction " << transactionHash << " came in NOTIFY_NEW_BLOCK";
+  // parsing and ring signatures of the whole batch run on the verification workers, off the dispatcher
+  std::vector<BinaryArray> transactionBinaries;
+  transactionBinaries.reserve(arg.b.txs.size());
+  for (const auto& tx : arg.b.txs)
+  {
+    transactionBinaries.push_back(asBinaryArray(tx));
+  }
+
+  std::vector<CryptoNote::tx_verification_context> tvcs;
+  System::RemoteContext<void> admission(m_dispatcher, [this, &transactionBinaries, &tvcs] {
+    m_core.handle_incoming_txs(transactionBinaries, tvcs, true);
+  });
+  admission.get();
 
-    m_core.handle_incoming_tx(transactionBinary, tvc, true);
+  for (const auto& tvc : tvcs)
+  {
     if (tvc.m_verification_failed)
     {
       logger(Logging::INFO) << context << "Block verification failed: transaction verification failed, dropping connection";
@@ -323,6 +416,7 @@ int CryptoNoteProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_B
     //TODO: Add here announce protocol usage
     //relay_post_notify<NOTIFY_NEW_BLOCK>(*m_p2p, arg, &context.m_connection_id);
     relay_block(arg);
+    relayLatency.observe(std::chrono::steady_clock::now() - announcedAt);
     // relay_block(arg, context);
 
     if (bvc.m_switched_to_alt_chain)
@@ -362,32 +456,47 @@ int CryptoNoteProtocolHandler::handle_notify_new_transactions(int command, NOTIF
   }
   else
   {
-    for (auto tx_blob_it = arg.txs.begin(); tx_blob_it != arg.txs.end();)
+    std::vector<BinaryArray> transactionBinaries;
+    std::vector<Crypto::Hash> transactionHashes;
+    transactionBinaries.reserve(arg.txs.size());
+    transactionHashes.reserve(arg.txs.size());
+    for (const auto& tx : arg.txs)
     {
-      auto transactionBinary = asBinaryArray(*tx_blob_it);
-      Crypto::Hash transactionHash = Crypto::cn_fast_hash(transactionBinary.data(), transactionBinary.size());
-      logger(DEBUGGING) << "transaction " << transactionHash << " came in NOTIFY_NEW_TRANSACTIONS";
+      transactionBinaries.push_back(asBinaryArray(tx));
+      transactionHashes.push_back(getBinaryArrayHash(transactionBinaries.back()));
+    }
 
-      CryptoNote::tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
-      m_core.handle_incoming_tx(transactionBinary, tvc, false);
+    markTransactionsKnown(context, transactionHashes);
+
+    // the batch is verified on another thread, the dispatcher keeps relaying blocks meanwhile
+    std::vector<CryptoNote::tx_verification_context> tvcs;
+    System::RemoteContext<void> admission(m_dispatcher, [this, &transactionBinaries, &tvcs] {
+      m_core.handle_incoming_txs(transactionBinaries, tvcs, false);
+    });
+    admission.get();
+
+    std::vector<std::string> relayed;
+    std::vector<Crypto::Hash> relayedHashes;
+    for (size_t i = 0; i < arg.txs.size(); ++i)
+    {
+      const CryptoNote::tx_verification_context& tvc = tvcs[i];
       if (tvc.m_verification_failed)
       {
         logger(Logging::DEBUGGING) << context << "Tx verification failed";
       }
-      if (!tvc.m_verification_failed && tvc.m_should_be_relayed)
-      {
-        ++tx_blob_it;
-      }
-      else
+      else if (tvc.m_should_be_relayed)
       {
-        tx_blob_it = arg.txs.erase(tx_blob_it);
+        relayed.push_back(std::move(arg.txs[i]));
+        relayedHashes.push_back(transactionHashes[i]);
       }
     }
 
+    arg.txs = std::move(relayed);
+
     if (arg.txs.size())
     {
       //TODO: add announce usage here
-      relay_post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, arg, &context.m_connection_id);
+      relayTransactionsToPeers(arg.txs, relayedHashes, &context.m_connection_id);
     }
   }
 
@@ -423,26 +532,36 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
 
   context.m_remote_blockchain_height = arg.current_blockchain_height;
 
+  // the whole response is decoded up front on the verification workers, oversized blobs are left out
+  // and reported in order below
+  std::vector<Common::StringView> blockBlobs;
+  blockBlobs.reserve(arg.blocks.size());
+  for (const block_complete_entry& block_entry : arg.blocks) {
+    bool fits = block_entry.block.size() <= m_currency.maxBlockBlobSize();
+    blockBlobs.push_back(fits ? Common::StringView(block_entry.block) : Common::StringView::NIL);
+  }
+
+  std::vector<Block> decodedBlocks;
+  std::vector<uint8_t> decoded;
+  decodeBlobs(blockBlobs, decodedBlocks, decoded, blockVerifier());
+
   size_t count = 0;
-  std::vector<Crypto::Hash> block_hashes;
-  block_hashes.reserve(arg.blocks.size());
   std::vector<parsed_block_entry> parsed_blocks;
   parsed_blocks.reserve(arg.blocks.size());
   for (const block_complete_entry& block_entry : arg.blocks) {
     ++count;
-    Block b;
-    BinaryArray block_blob = asBinaryArray(block_entry.block);
-    if (block_blob.size() > m_currency.maxBlockBlobSize()) {
-      logger(Logging::ERROR) << context << "sent wrong block: too big size " << block_blob.size() << ", dropping connection";
+    if (block_entry.block.size() > m_currency.maxBlockBlobSize()) {
+      logger(Logging::ERROR) << context << "sent wrong block: too big size " << block_entry.block.size() << ", dropping connection";
       context.m_state = CryptoNoteConnectionContext::state_shutdown;
       return 1;
     }
-    if (!fromBinaryArray(b, block_blob)) {
+    if (!decoded[count - 1]) {
       logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
-        << toHex(block_blob) << "\r\n dropping connection";
+        << toHex(block_entry.block.data(), block_entry.block.size()) << "\r\n dropping connection";
       context.m_state = CryptoNoteConnectionContext::state_shutdown;
       return 1;
     }
+    Block& b = decodedBlocks[count - 1];
 
     //to avoid concurrency in core between connections, suspend connections which delivered block later then first one
     auto blockHash = get_block_hash(b);
@@ -451,6 +570,7 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
         context.m_state = CryptoNoteConnectionContext::state_idle;
         context.m_needed_objects.clear();
         context.m_requested_objects.clear();
+        stopDownloading(context);
         logger(DEBUGGING) << context << "Connection set to idle state.";
         return 1;
       }
@@ -472,15 +592,13 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
 
     context.m_requested_objects.erase(req_it);
 
-    block_hashes.push_back(blockHash);
-
-    parsed_block_entry parsedBlock;
+    parsed_blocks.emplace_back();
+    parsed_block_entry& parsedBlock = parsed_blocks.back();
     parsedBlock.block = std::move(b);
+    parsedBlock.txs.reserve(block_entry.txs.size());
     for (auto& tx_blob : block_entry.txs) {
-      auto transactionBinary = asBinaryArray(tx_blob);
-      parsedBlock.txs.push_back(transactionBinary);
+      parsedBlock.txs.push_back(asBinaryArray(tx_blob));
     }
-    parsed_blocks.push_back(parsedBlock);
   }
 
   if (context.m_requested_objects.size()) {
@@ -491,6 +609,15 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
     return 1;
   }
 
+  uint32_t chunkHeight = 0;
+  if (m_blockDownloads.deliver(context.m_connection_id, BlockDownloadScheduler::Clock::now(), parsed_blocks.size(), chunkHeight)) {
+    DownloadedChunk& chunk = m_downloadedChunks[chunkHeight];
+    chunk.source = context.m_connection_id;
+    chunk.blocks = std::move(parsed_blocks);
+  } else {
+    logger(DEBUGGING) << context << "Blocks from height " << chunkHeight << " were already delivered by another connection";
+  }
+
   uint32_t height;
   Crypto::Hash top;
   {
@@ -502,74 +629,228 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
     // will add any extra it has, if any
     std::lock_guard<std::recursive_mutex> lk(m_sync_lock);
 
-    // dismiss what another connection might already have done (likely everything)
-    m_core.get_blockchain_top(height, top);
-    uint64_t dismiss = 1;
-    for (const auto &h : block_hashes) {
-      if (top == h) {
-        logger(DEBUGGING) << "Found current top block in synced blocks, dismissing "
-          << dismiss << "/" << arg.blocks.size() << " blocks";
-        while (dismiss--) {
-          arg.blocks.erase(arg.blocks.begin());
-          parsed_blocks.erase(parsed_blocks.begin());
-        }
-        break;
-      }
-      ++dismiss;
-    }
-
     BOOST_SCOPE_EXIT_ALL(this) { m_core.update_block_template_and_resume_mining(); };
 
-    int result = processObjects(context, parsed_blocks);
+    int result = applyDownloadedChunks(context);
     if (result != 0) {
       return result;
     }
   }
 
   m_core.get_blockchain_top(height, top);
-  logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
+  logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height
+    << ", verification queue depth = " << m_blockVerificationQueueDepth.load();
 
   if (!m_stop && context.m_state == CryptoNoteConnectionContext::state_synchronizing) {
     request_missing_objects(context, true);
   }
 
+  if (!m_stop) {
+    resumeDownloads();
+  }
+
   return 1;
 }
 
+int CryptoNoteProtocolHandler::applyDownloadedChunks(CryptoNoteConnectionContext& context) {
+  // processObjects yields, a connection that delivers meanwhile leaves its chunk to the one already applying
+  if (m_applyingChunks) {
+    return 0;
+  }
+
+  m_applyingChunks = true;
+  BOOST_SCOPE_EXIT_ALL(this) { m_applyingChunks = false; };
+
+  uint32_t chunkHeight;
+  while (!m_stop && m_blockDownloads.takeReady(chunkHeight)) {
+    auto it = m_downloadedChunks.find(chunkHeight);
+    if (it == m_downloadedChunks.end()) {
+      continue;
+    }
+
+    DownloadedChunk chunk = std::move(it->second);
+    m_downloadedChunks.erase(it);
+
+    // dismiss what another connection might already have done
+    uint32_t height;
+    Crypto::Hash top;
+    m_core.get_blockchain_top(height, top);
+    for (size_t i = 0; i < chunk.blocks.size(); ++i) {
+      if (get_block_hash(chunk.blocks[i].block) == top) {
+        logger(DEBUGGING) << "Found current top block in synced blocks, dismissing "
+          << i + 1 << "/" << chunk.blocks.size() << " blocks";
+        chunk.blocks.erase(chunk.blocks.begin(), chunk.blocks.begin() + i + 1);
+        break;
+      }
+    }
+
+    auto state = context.m_state;
+    int result = processObjects(context, chunk.blocks);
+    if (result == 0) {
+      continue;
+    }
+
+    // whatever was not applied is fetched again, the chunks above would not connect
+    dropDownloadedChunks(m_blockDownloads.reschedule(chunkHeight));
+    if (chunk.source == context.m_connection_id) {
+      stopDownloading(context);
+      return result;
+    }
+
+    // the chunk came from another connection, it takes the blame
+    bool failed = context.m_state == CryptoNoteConnectionContext::state_shutdown;
+    context.m_state = state;
+    if (failed) {
+      m_p2p->for_each_connection([this, &chunk](CryptoNoteConnectionContext& ctx, PeerIdType peerId) {
+        if (ctx.m_connection_id == chunk.source) {
+          logger(DEBUGGING) << ctx << "Delivered blocks failed verification, dropping connection";
+          m_p2p->drop_connection(ctx, true);
+        }
+      });
+
+      dropDownloadedChunks(m_blockDownloads.removePeer(chunk.source));
+    }
+  }
+
+  return 0;
+}
+
+void CryptoNoteProtocolHandler::resumeDownloads() {
+  std::vector<CryptoNoteConnectionContext*> idle;
+  m_p2p->for_each_connection([this, &idle](CryptoNoteConnectionContext& ctx, PeerIdType peerId) {
+    if (ctx.m_state == CryptoNoteConnectionContext::state_synchronizing && m_blockDownloads.isIdle(ctx.m_connection_id)) {
+      idle.push_back(&ctx);
+    }
+  });
+
+  // request_missing_objects only queues writes, the contexts stay valid while we go through them
+  for (CryptoNoteConnectionContext* ctx : idle) {
+    request_missing_objects(*ctx, true);
+  }
+}
+
+void CryptoNoteProtocolHandler::stopDownloading(const CryptoNoteConnectionContext& context) {
+  dropDownloadedChunks(m_blockDownloads.removePeer(context.m_connection_id));
+}
+
+void CryptoNoteProtocolHandler::dropDownloadedChunks(const std::vector<uint32_t>& chunkHeights) {
+  for (uint32_t chunkHeight : chunkHeights) {
+    m_downloadedChunks.erase(chunkHeight);
+  }
+}
+
 int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& context, const std::vector<parsed_block_entry>& blocks) {
 
-  for (const parsed_block_entry& block_entry : blocks) {
+  size_t checkpointed = 0;
+  uint32_t height;
+  Crypto::Hash top;
+  m_core.get_blockchain_top(height, top);
+  if (!blocks.empty() && m_core.isInCheckpointZone(height + 1)) {
+    // below the last checkpoint the hash chain vouches for the blocks, append them in bulk
+    // without staging their transactions in the pool
+    std::vector<Block> checkpointBlocks;
+    std::vector<std::vector<BinaryArray>> checkpointTransactions;
+    checkpointBlocks.reserve(blocks.size());
+    checkpointTransactions.reserve(blocks.size());
+    for (const parsed_block_entry& block_entry : blocks) {
+      checkpointBlocks.push_back(block_entry.block);
+      checkpointTransactions.push_back(block_entry.txs);
+    }
+
+    block_verification_context bvc = boost::value_initialized<block_verification_context>();
+    checkpointed = m_core.addCheckpointedBlocks(checkpointBlocks, checkpointTransactions, bvc);
+    if (bvc.m_verification_failed) {
+      logger(DEBUGGING) << context << "Checkpointed block verification failed, dropping connection";
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      return 1;
+    }
+
+    m_dispatcher.yield();
+  }
+
+  // the verification workers check transaction hashes and proof of work up to a whole response ahead, in
+  // batches as wide as cn_slow_hash_multi runs lanes; blocks are then added strictly in order off the
+  // dispatcher so connections keep being served meanwhile
+  struct PreparedBatch {
+    size_t count;
+    std::future<bool> transactionsMatch;
+  };
+
+  Common::ThreadPool& verifier = blockVerifier();
+  const size_t depth = BLOCKS_SYNCHRONIZING_DEFAULT_COUNT;
+  std::deque<PreparedBatch> prepared;
+  size_t nextPrepared = checkpointed;
+  size_t batchEnd = checkpointed;
+  BOOST_SCOPE_EXIT_ALL(this, &prepared) {
+    // queued checks reference the blocks
+    for (auto& batch : prepared) {
+      batch.transactionsMatch.wait();
+      m_blockVerificationQueueDepth -= batch.count;
+    }
+  };
+
+  for (size_t blockIndex = checkpointed; blockIndex < blocks.size(); ++blockIndex) {
+    const parsed_block_entry& block_entry = blocks[blockIndex];
     if (m_stop) {
       break;
     }
 
-    //process transactions
-    for (size_t i = 0; i < block_entry.txs.size(); ++i) {
-      auto transactionBinary = block_entry.txs[i];
-      Crypto::Hash transactionHash = Crypto::cn_fast_hash(transactionBinary.data(), transactionBinary.size());
-      logger(DEBUGGING) << "transaction " << transactionHash << " came in processObjects";
+    while (nextPrepared < blocks.size() && nextPrepared - blockIndex < depth) {
+      size_t batchSize = get_block_longhash_batch_size(blocks[nextPrepared].block, verifier.workerCount());
+      size_t count = std::min(batchSize, std::min(blocks.size(), blockIndex + depth) - nextPrepared);
+      const parsed_block_entry* entries = &blocks[nextPrepared];
+      m_blockVerificationQueueDepth += count;
+      prepared.push_back({count, verifier.submit([this, entries, count] { return prepareBlocks(entries, count); })});
+      nextPrepared += count;
+    }
 
-      // check if tx hashes match
-      if (transactionHash != block_entry.block.transactionHashes[i]) {
-        logger(DEBUGGING) << context << "transaction mismatch on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
-          << Common::podToHex(transactionHash) << ", dropping connection";
-        context.m_state = CryptoNoteConnectionContext::state_shutdown;
-        return 1;
+    PreparedBatch batch = {0, std::future<bool>()};
+    if (blockIndex == batchEnd) {
+      batch = std::move(prepared.front());
+      prepared.pop_front();
+      batchEnd += batch.count;
+    }
+
+    bool transactionsMatch = true;
+    Crypto::Hash failedTransaction = NULL_HASH;
+    block_verification_context bvc = boost::value_initialized<block_verification_context>();
+    System::RemoteContext<void>(m_dispatcher, [&] {
+      if (batch.transactionsMatch.valid()) {
+        transactionsMatch = batch.transactionsMatch.get();
+        m_blockVerificationQueueDepth -= batch.count;
+        if (!transactionsMatch) {
+          return;
+        }
       }
 
-      tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
-      m_core.handle_incoming_tx(transactionBinary, tvc, true);
-      if (tvc.m_verification_failed) {
-        logger(DEBUGGING) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
-          << Common::podToHex(transactionHash) << ", dropping connection";
-        context.m_state = CryptoNoteConnectionContext::state_shutdown;
-        return 1;
+      //process transactions
+      for (size_t i = 0; i < block_entry.txs.size(); ++i) {
+        logger(DEBUGGING) << "transaction " << block_entry.block.transactionHashes[i] << " came in processObjects";
+        tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
+        m_core.handle_incoming_tx(block_entry.txs[i], tvc, true);
+        if (tvc.m_verification_failed) {
+          failedTransaction = block_entry.block.transactionHashes[i];
+          return;
+        }
       }
+
+      // process block
+      m_core.handle_incoming_block(block_entry.block, bvc, false, false);
+    }).get();
+
+    if (!transactionsMatch) {
+      logger(DEBUGGING) << context << "transaction mismatch on NOTIFY_RESPONSE_GET_OBJECTS, block_id = "
+        << Common::podToHex(get_block_hash(block_entry.block)) << ", dropping connection";
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      return 1;
     }
 
-    // process block
-    block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    m_core.handle_incoming_block(block_entry.block, bvc, false, false);
+    if (failedTransaction != NULL_HASH) {
+      logger(DEBUGGING) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
+        << Common::podToHex(failedTransaction) << ", dropping connection";
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      return 1;
+    }
 
     if (bvc.m_verification_failed) {
       logger(DEBUGGING) << context << "Block verification failed, dropping connection";
@@ -586,16 +867,46 @@ int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& conte
       context.m_requested_objects.clear();
       return 1;
     }
-
-    m_dispatcher.yield();
   }
 
   return 0;
 
 }
 
+bool CryptoNoteProtocolHandler::prepareBlocks(const parsed_block_entry* blocks, size_t count) {
+  std::vector<Block> batch;
+  batch.reserve(count);
+  for (size_t blockIndex = 0; blockIndex < count; ++blockIndex) {
+    const parsed_block_entry& block = blocks[blockIndex];
+    for (size_t i = 0; i < block.txs.size(); ++i) {
+      if (Crypto::cn_fast_hash(block.txs[i].data(), block.txs[i].size()) != block.block.transactionHashes[i]) {
+        return false;
+      }
+    }
+
+    batch.push_back(block.block);
+  }
+
+  m_core.precomputeProofOfWork(batch);
+  return true;
+}
+
+Common::ThreadPool& CryptoNoteProtocolHandler::blockVerifier() {
+  if (!m_blockVerifier) {
+    // room for the batches of a whole response
+    m_blockVerifier.reset(new Common::ThreadPool(0, BLOCKS_SYNCHRONIZING_DEFAULT_COUNT));
+  }
+
+  return *m_blockVerifier;
+}
+
 bool CryptoNoteProtocolHandler::on_idle()
 {
+  // picks up chunks freed by closed connections and downloads that stalled on slow peers
+  if (!m_stop) {
+    resumeDownloads();
+  }
+
   return m_core.on_idle();
 }
 
@@ -627,29 +938,34 @@ int CryptoNoteProtocolHandler::handle_request_chain(int command, NOTIFY_REQUEST_
 
 bool CryptoNoteProtocolHandler::request_missing_objects(CryptoNoteConnectionContext &context, bool check_having_blocks)
 {
-  if (context.m_needed_objects.size())
+  std::vector<Crypto::Hash> chunk;
+  if (m_blockDownloads.assign(context.m_connection_id, BlockDownloadScheduler::Clock::now(), chunk))
   {
     //we know objects that we need, request this objects
     NOTIFY_REQUEST_GET_OBJECTS::request req;
-    size_t count = 0;
-    auto it = context.m_needed_objects.begin();
-
-    while (it != context.m_needed_objects.end() && count < BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)
+    for (const Crypto::Hash &id : chunk)
     {
-      if (!(check_having_blocks && m_core.have_block(*it)))
+      if (!(check_having_blocks && m_core.have_block(id)))
       {
-        req.blocks.push_back(*it);
-        ++count;
-        context.m_requested_objects.insert(*it);
+        req.blocks.push_back(id);
+        context.m_requested_objects.insert(id);
       }
-      it = context.m_needed_objects.erase(it);
     }
     logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size();
     post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, context);
   }
+  else if (m_blockDownloads.coversPeer(context.m_connection_id))
+  {
+    // other connections still fetch or apply blocks this one advertised, it is asked again once they are done
+    BlockDownloadScheduler::Stats stats = m_blockDownloads.getStats();
+    logger(Logging::TRACE) << context << "Waiting for block downloads: chunks=" << stats.chunks << ", in flight=" << stats.inFlight
+                           << ", delivered=" << stats.delivered << ", peers=" << stats.peers << ", reassigned=" << stats.reassigned
+                           << ", duplicates=" << stats.duplicates << ", blocks/s=" << stats.blocksPerSecond;
+  }
   else if (context.m_last_response_height < context.m_remote_blockchain_height - 1)
   { //we have to fetch more objects ids, request blockchain entry
 
+    stopDownloading(context);
     NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
     r.block_ids = m_core.buildSparseChain();
     logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
@@ -672,6 +988,7 @@ bool CryptoNoteProtocolHandler::request_missing_objects(CryptoNoteConnectionCont
       return false;
     }
 
+    stopDownloading(context);
     requestMissingPoolTransactions(context);
 
     context.m_state = CryptoNoteConnectionContext::state_normal;
@@ -742,13 +1059,17 @@ int CryptoNoteProtocolHandler::handle_response_chain_entry(int command, NOTIFY_R
     context.m_state = CryptoNoteConnectionContext::state_shutdown;
   }
 
-  for (auto &bl_id : arg.m_block_ids)
+  // the scheduler splits what we miss into chunks that any connection advertising them can fetch
+  size_t firstNeeded = 0;
+  while (firstNeeded < arg.m_block_ids.size() && m_core.have_block(arg.m_block_ids[firstNeeded]))
   {
-    if (!m_core.have_block(bl_id))
-      context.m_needed_objects.push_back(bl_id);
+    ++firstNeeded;
   }
 
-  request_missing_objects(context, false);
+  std::vector<Crypto::Hash> neededIds(arg.m_block_ids.begin() + firstNeeded, arg.m_block_ids.end());
+  m_blockDownloads.addPeerSpan(context.m_connection_id, arg.start_height + static_cast<uint32_t>(firstNeeded), neededIds);
+
+  request_missing_objects(context, true);
   return 1;
 }
 
@@ -793,6 +1114,7 @@ int CryptoNoteProtocolHandler::handle_notify_missing_txs(int command, NOTIFY_MIS
 
   logger(Logging::DEBUGGING) << "--> NOTIFY_RESPONSE_MISSING_TXS: "
                              << "txs.size() = " << req.txs.size();
+  markTransactionsKnown(context, arg.missing_txs);
 
   if (post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, req, context))
   {
@@ -806,6 +1128,251 @@ int CryptoNoteProtocolHandler::handle_notify_missing_txs(int command, NOTIFY_MIS
   return 1;
 }
 
+int CryptoNoteProtocolHandler::handle_notify_new_compact_block(int command, NOTIFY_NEW_COMPACT_BLOCK::request &arg,
+                                                               CryptoNoteConnectionContext &context)
+{
+  logger(Logging::TRACE) << context << "NOTIFY_NEW_COMPACT_BLOCK (hop " << arg.hop << ")";
+  updateObservedHeight(arg.current_blockchain_height, context);
+  context.m_remote_blockchain_height = arg.current_blockchain_height;
+  if (context.m_state != CryptoNoteConnectionContext::state_normal)
+  {
+    return 1;
+  }
+
+  Block b;
+  size_t transactionCount = arg.short_ids.size() / COMPACT_SHORT_ID_SIZE;
+  if (arg.short_ids.size() % COMPACT_SHORT_ID_SIZE != 0 || transactionCount > COMPACT_BLOCK_MAX_TRANSACTIONS ||
+      arg.prefilled_txs.size() > transactionCount || !fromBinaryArray(b, asBinaryArray(arg.block)) || !b.transactionHashes.empty())
+  {
+    logger(Logging::WARNING) << context << "Malformed compact block, dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  PendingCompactBlock pending;
+  pending.key = compactBlockKey(arg.block, arg.nonce);
+  pending.transactions.assign(transactionCount, NULL_HASH);
+
+  // an id that occurs twice in the block can't be told apart, those transactions are requested by index
+  std::unordered_map<uint64_t, size_t> slots;
+  std::unordered_set<uint64_t> ambiguous;
+  for (size_t i = 0; i < transactionCount; ++i)
+  {
+    uint64_t id = readShortId(arg.short_ids, i);
+    if (!slots.emplace(id, i).second)
+    {
+      ambiguous.insert(id);
+    }
+  }
+
+  for (uint64_t id : ambiguous)
+  {
+    slots.erase(id);
+  }
+
+  // two pool transactions with the same id leave the slot unresolved as well
+  std::unordered_set<size_t> collisions;
+  for (const auto &transactionHash : m_core.getPoolTransactionHashes())
+  {
+    auto slot = slots.find(compactShortId(pending.key, transactionHash));
+    if (slot == slots.end())
+    {
+      continue;
+    }
+
+    Crypto::Hash &resolved = pending.transactions[slot->second];
+    if (resolved == NULL_HASH)
+    {
+      resolved = transactionHash;
+    }
+    else if (resolved != transactionHash)
+    {
+      collisions.insert(slot->second);
+    }
+  }
+
+  // prefilled transactions come from the sender and win over whatever the pool matched
+  for (const auto &prefilled : arg.prefilled_txs)
+  {
+    BinaryArray transactionBinary = asBinaryArray(prefilled);
+    Crypto::Hash transactionHash = getBinaryArrayHash(transactionBinary);
+    auto slot = slots.find(compactShortId(pending.key, transactionHash));
+    if (slot == slots.end())
+    {
+      continue;
+    }
+
+    pending.transactions[slot->second] = transactionHash;
+    collisions.erase(slot->second);
+    pending.providedTransactions.push_back(std::move(transactionBinary));
+  }
+
+  for (size_t index : collisions)
+  {
+    pending.transactions[index] = NULL_HASH;
+  }
+
+  pending.request = std::move(arg);
+  context.m_pending_compact_block = std::move(pending);
+  return doPushCompactBlock(context);
+}
+
+int CryptoNoteProtocolHandler::handle_request_compact_txs(int command, NOTIFY_REQUEST_COMPACT_TXS::request &arg,
+                                                          CryptoNoteConnectionContext &context)
+{
+  logger(Logging::TRACE) << context << "NOTIFY_REQUEST_COMPACT_TXS: indexes.size() = " << arg.indexes.size();
+
+  auto sent = std::find_if(m_sentCompactBlocks.begin(), m_sentCompactBlocks.end(),
+                           [&arg](const SentCompactBlock &block) { return block.key == arg.blockKey; });
+  if (sent == m_sentCompactBlocks.end())
+  {
+    logger(Logging::DEBUGGING) << context << "Requested transactions of a compact block that is no longer cached";
+    return 1;
+  }
+
+  NOTIFY_RESPONSE_COMPACT_TXS::request rsp;
+  rsp.blockKey = arg.blockKey;
+  std::vector<Crypto::Hash> sentHashes;
+  for (uint32_t index : arg.indexes)
+  {
+    Transaction tx;
+    if (index >= sent->transactions.size() || !m_core.getTransaction(sent->transactions[index], tx, true))
+    {
+      logger(Logging::DEBUGGING) << context << "Unable to provide transaction " << index << " of a compact block";
+      return 1;
+    }
+
+    rsp.txs.push_back(asString(toBinaryArray(tx)));
+    sentHashes.push_back(sent->transactions[index]);
+  }
+
+  markTransactionsKnown(context, sentHashes);
+  if (!post_notify<NOTIFY_RESPONSE_COMPACT_TXS>(*m_p2p, rsp, context))
+  {
+    logger(Logging::DEBUGGING) << context << "Error while sending NOTIFY_RESPONSE_COMPACT_TXS to peer";
+  }
+
+  return 1;
+}
+
+int CryptoNoteProtocolHandler::handle_response_compact_txs(int command, NOTIFY_RESPONSE_COMPACT_TXS::request &arg,
+                                                           CryptoNoteConnectionContext &context)
+{
+  logger(Logging::TRACE) << context << "NOTIFY_RESPONSE_COMPACT_TXS: txs.size() = " << arg.txs.size();
+
+  if (!context.m_pending_compact_block || context.m_pending_compact_block->key != arg.blockKey)
+  {
+    logger(Logging::DEBUGGING) << context << "Compact block transactions arrived for a block that isn't pending, ignoring";
+    return 1;
+  }
+
+  // the answer lists the requested transactions in the order of the request, which is block order
+  PendingCompactBlock &pending = *context.m_pending_compact_block;
+  size_t next = 0;
+  for (size_t i = 0; i < pending.transactions.size(); ++i)
+  {
+    if (pending.transactions[i] != NULL_HASH)
+    {
+      continue;
+    }
+
+    if (next == arg.txs.size())
+    {
+      break;
+    }
+
+    BinaryArray transactionBinary = asBinaryArray(arg.txs[next++]);
+    Crypto::Hash transactionHash = getBinaryArrayHash(transactionBinary);
+    if (compactShortId(pending.key, transactionHash) != readShortId(pending.request.short_ids, i))
+    {
+      break;
+    }
+
+    pending.transactions[i] = transactionHash;
+    pending.providedTransactions.push_back(std::move(transactionBinary));
+  }
+
+  if (next != arg.txs.size() || std::find(pending.transactions.begin(), pending.transactions.end(), NULL_HASH) != pending.transactions.end())
+  {
+    logger(Logging::DEBUGGING) << context << "Peer didn't provide the transactions of its compact block, dropping connection";
+    context.m_pending_compact_block = boost::none;
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  return doPushCompactBlock(context);
+}
+
+int CryptoNoteProtocolHandler::handle_notify_compact_blocks_supported(int command, NOTIFY_COMPACT_BLOCKS_SUPPORTED::request &arg,
+                                                                      CryptoNoteConnectionContext &context)
+{
+  logger(Logging::TRACE) << context << "NOTIFY_COMPACT_BLOCKS_SUPPORTED";
+  context.m_supports_compact_blocks = true;
+  return 1;
+}
+
+int CryptoNoteProtocolHandler::handle_request_tx_pool_short_ids(int command, NOTIFY_REQUEST_TX_POOL_SHORT_IDS::request &arg,
+                                                                CryptoNoteConnectionContext &context)
+{
+  size_t idCount = arg.short_ids.size() / COMPACT_SHORT_ID_SIZE;
+  logger(Logging::TRACE) << context << "NOTIFY_REQUEST_TX_POOL_SHORT_IDS: ids = " << idCount;
+
+  if (arg.short_ids.size() % COMPACT_SHORT_ID_SIZE != 0)
+  {
+    logger(Logging::DEBUGGING) << context << "Malformed pool short ids, dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  std::unordered_set<uint64_t> peerIds;
+  peerIds.reserve(idCount);
+  for (size_t i = 0; i < idCount; ++i)
+  {
+    peerIds.insert(readShortId(arg.short_ids, i));
+  }
+
+  // a pool transaction whose id collides with one of the peer's is taken as known,
+  // at 48 bits that is rare and the transaction still reaches the peer by relay
+  Crypto::Hash key = compactBlockKey(std::string(), arg.nonce);
+  std::vector<Crypto::Hash> missing;
+  std::vector<Crypto::Hash> known;
+  for (const auto &transactionHash : m_core.getPoolTransactionHashes())
+  {
+    if (peerIds.count(compactShortId(key, transactionHash)) == 0)
+    {
+      missing.push_back(transactionHash);
+    }
+    else
+    {
+      known.push_back(transactionHash);
+    }
+  }
+
+  markTransactionsKnown(context, known);
+  if (missing.empty())
+  {
+    return 1;
+  }
+
+  std::list<Transaction> txs;
+  std::list<Crypto::Hash> missedHashes;
+  m_core.getTransactions(missing, txs, missedHashes, true);
+
+  NOTIFY_NEW_TRANSACTIONS::request notification;
+  for (const auto &tx : txs)
+  {
+    notification.txs.push_back(asString(toBinaryArray(tx)));
+  }
+
+  markTransactionsKnown(context, missing);
+  if (!notification.txs.empty() && !post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, notification, context))
+  {
+    logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Failed to post notification NOTIFY_NEW_TRANSACTIONS to " << context.m_connection_id;
+  }
+
+  return 1;
+}
+
 int CryptoNoteProtocolHandler::handle_request_tx_pool(int command, NOTIFY_REQUEST_TX_POOL::request &arg,
                                                       CryptoNoteConnectionContext &context)
 {
@@ -814,15 +1381,20 @@ int CryptoNoteProtocolHandler::handle_request_tx_pool(int command, NOTIFY_REQUES
   std::vector<Transaction> addedTransactions;
   std::vector<Crypto::Hash> deletedTransactions;
   m_core.getPoolChanges(arg.txs, addedTransactions, deletedTransactions);
+  markTransactionsKnown(context, arg.txs);
 
   if (!addedTransactions.empty())
   {
     NOTIFY_NEW_TRANSACTIONS::request notification;
+    std::vector<Crypto::Hash> addedHashes;
     for (auto &tx : addedTransactions)
     {
       notification.txs.push_back(asString(toBinaryArray(tx)));
+      addedHashes.push_back(getObjectHash(tx));
     }
 
+    markTransactionsKnown(context, addedHashes);
+
     bool ok = post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, notification, context);
     if (!ok)
     {
@@ -849,12 +1421,49 @@ void CryptoNoteProtocolHandler::relay_block(NOTIFY_NEW_BLOCK::request &arg)
   logger(Logging::DEBUGGING) << "NOTIFY_NEW_BLOCK - MSG_SIZE = " << buf.size();
   logger(Logging::DEBUGGING) << "NOTIFY_NEW_LITE_BLOCK - MSG_SIZE = " << lite_buf.size();
 
+  // this may be called from the core, connection contexts are only touched on the dispatcher
+  m_dispatcher.remoteSpawn([this, lite_arg, buf] {
+    relayBlockToPeers(lite_arg, &buf, nullptr);
+  });
+}
+
+void CryptoNoteProtocolHandler::relayBlockToPeers(const NOTIFY_NEW_LITE_BLOCK::request &liteBlock, const BinaryArray *fullBlock,
+                                                  const net_connection_id *excludeConnection)
+{
+  Block block;
+  if (!fromBinaryArray(block, asBinaryArray(liteBlock.block)))
+  {
+    logger(Logging::WARNING) << "Failed to parse a block for relay";
+    return;
+  }
+
+  Crypto::Hash blockHash = get_block_hash(block);
   std::list<boost::uuids::uuid> liteBlockConnections, normalBlockConnections;
+  std::vector<CryptoNoteConnectionContext *> compactBlockConnections;
+
+  // sort the peers into their support categories, peers that announced the block to us are skipped
+  m_p2p->for_each_connection([this, excludeConnection, &blockHash, &liteBlock, &liteBlockConnections, &normalBlockConnections, &compactBlockConnections](
+                                 CryptoNoteConnectionContext &ctx, uint64_t peerId) {
+    if (excludeConnection != nullptr && ctx.m_connection_id == *excludeConnection)
+    {
+      return;
+    }
 
-  // sort the peers into their support categories
-  m_p2p->for_each_connection([this, &liteBlockConnections, &normalBlockConnections](
-                                 const CryptoNoteConnectionContext &ctx, uint64_t peerId) {
-    if (ctx.version >= P2P_LITE_BLOCKS_PROPOGATION_VERSION)
+    if (ctx.m_known_blocks.contains(blockHash))
+    {
+      ++m_relaySuppressedBlocks;
+      m_relaySavedBytes += liteBlock.block.size();
+      return;
+    }
+
+    ctx.m_known_blocks.insert(blockHash);
+
+    if (ctx.m_supports_compact_blocks && ctx.m_state == CryptoNoteConnectionContext::state_normal)
+    {
+      logger(Logging::DEBUGGING) << ctx << "Peer supports compact blocks... adding peer to compact block list";
+      compactBlockConnections.push_back(&ctx);
+    }
+    else if (ctx.version >= P2P_LITE_BLOCKS_PROPOGATION_VERSION)
     {
       logger(Logging::DEBUGGING) << ctx << "Peer supports lite-blocks... adding peer to lite block list";
       liteBlockConnections.push_back(ctx.m_connection_id);
@@ -867,22 +1476,163 @@ void CryptoNoteProtocolHandler::relay_block(NOTIFY_NEW_BLOCK::request &arg)
   });
 
   // first send lite blocks as it's faster
+  if (fullBlock == nullptr)
+  {
+    liteBlockConnections.splice(liteBlockConnections.end(), normalBlockConnections);
+  }
+
   if (!liteBlockConnections.empty())
   {
-    m_p2p->externalRelayNotifyToList(NOTIFY_NEW_LITE_BLOCK::ID, lite_buf, liteBlockConnections);
+    m_p2p->externalRelayNotifyToList(NOTIFY_NEW_LITE_BLOCK::ID, LevinProtocol::encode(liteBlock), liteBlockConnections);
+  }
+
+  if (fullBlock != nullptr && (!normalBlockConnections.empty() || !liteBlockConnections.empty()))
+  {
+    normalBlockConnections.splice(normalBlockConnections.end(), liteBlockConnections);
+    m_p2p->externalRelayNotifyToList(NOTIFY_NEW_BLOCK::ID, *fullBlock, normalBlockConnections);
+  }
+
+  if (compactBlockConnections.empty())
+  {
+    return;
+  }
+
+  std::vector<Crypto::Hash> transactions;
+  transactions.swap(block.transactionHashes);
+
+  NOTIFY_NEW_COMPACT_BLOCK::request compact;
+  compact.block = asString(toBinaryArray(block));
+  compact.nonce = Crypto::rand<uint64_t>();
+  compact.current_blockchain_height = liteBlock.current_blockchain_height;
+  compact.hop = liteBlock.hop;
+
+  Crypto::Hash key = compactBlockKey(compact.block, compact.nonce);
+  compact.short_ids.reserve(transactions.size() * COMPACT_SHORT_ID_SIZE);
+  for (const auto &transactionHash : transactions)
+  {
+    appendShortId(compact.short_ids, compactShortId(key, transactionHash));
+  }
+
+  // prefill what a peer is not known to have, the block itself rarely needs more than one message then
+  std::unordered_map<Crypto::Hash, std::string> blobs;
+  for (CryptoNoteConnectionContext *ctx : compactBlockConnections)
+  {
+    compact.prefilled_txs.clear();
+    size_t prefilledSize = 0;
+    for (const auto &transactionHash : transactions)
+    {
+      if (ctx->m_known_transactions.contains(transactionHash))
+      {
+        continue;
+      }
+
+      auto blob = blobs.find(transactionHash);
+      if (blob == blobs.end())
+      {
+        Transaction tx;
+        if (!m_core.getTransaction(transactionHash, tx, true))
+        {
+          continue;
+        }
+
+        blob = blobs.emplace(transactionHash, asString(toBinaryArray(tx))).first;
+      }
+
+      if (prefilledSize + blob->second.size() > COMPACT_BLOCK_PREFILL_LIMIT)
+      {
+        break;
+      }
+
+      prefilledSize += blob->second.size();
+      compact.prefilled_txs.push_back(blob->second);
+    }
+
+    // the block takes these transactions out of every pool
+    for (const auto &transactionHash : transactions)
+    {
+      ctx->m_known_transactions.erase(transactionHash);
+    }
+
+    logger(Logging::DEBUGGING) << *ctx << "NOTIFY_NEW_COMPACT_BLOCK - prefilled " << compact.prefilled_txs.size() << " of " << transactions.size() << " transactions";
+    m_p2p->invoke_notify_to_peer(NOTIFY_NEW_COMPACT_BLOCK::ID, LevinProtocol::encode(compact), *ctx);
+  }
+
+  m_sentCompactBlocks.push_back(SentCompactBlock{key, std::move(transactions)});
+  if (m_sentCompactBlocks.size() > COMPACT_BLOCK_SENT_CACHE_SIZE)
+  {
+    m_sentCompactBlocks.pop_front();
   }
+}
 
-  if (!normalBlockConnections.empty())
+void CryptoNoteProtocolHandler::markTransactionsKnown(CryptoNoteConnectionContext &context, const std::vector<Crypto::Hash> &transactions)
+{
+  for (const auto &transactionHash : transactions)
   {
-    auto buf = LevinProtocol::encode(arg);
-    m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_BLOCK::ID, buf, nullptr);
+    context.m_known_transactions.insert(transactionHash);
   }
 }
 
 void CryptoNoteProtocolHandler::relay_transactions(NOTIFY_NEW_TRANSACTIONS::request &arg)
 {
-  auto buf = LevinProtocol::encode(arg);
-  m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_TRANSACTIONS::ID, buf, nullptr);
+  std::vector<Crypto::Hash> transactionHashes;
+  transactionHashes.reserve(arg.txs.size());
+  for (const auto &tx : arg.txs)
+  {
+    transactionHashes.push_back(getBinaryArrayHash(asBinaryArray(tx)));
+  }
+
+  // this may be called from the core, connection contexts are only touched on the dispatcher
+  std::vector<std::string> transactions = arg.txs;
+  m_dispatcher.remoteSpawn([this, transactions, transactionHashes] {
+    relayTransactionsToPeers(transactions, transactionHashes, nullptr);
+  });
+}
+
+void CryptoNoteProtocolHandler::relayTransactionsToPeers(const std::vector<std::string> &transactions,
+                                                         const std::vector<Crypto::Hash> &transactionHashes,
+                                                         const net_connection_id *excludeConnection)
+{
+  // peers are grouped by which part of the batch they are missing, each group
+  // shares one encoded frame and peers that know the whole batch get nothing
+  std::map<std::vector<bool>, std::list<boost::uuids::uuid>> groups;
+  m_p2p->for_each_connection([this, &transactions, &transactionHashes, excludeConnection, &groups](CryptoNoteConnectionContext &ctx, PeerIdType peerId) {
+    if (excludeConnection == nullptr || ctx.m_connection_id != *excludeConnection)
+    {
+      std::vector<bool> missing(transactionHashes.size());
+      bool anyMissing = false;
+      for (size_t i = 0; i < transactionHashes.size(); ++i)
+      {
+        missing[i] = !ctx.m_known_transactions.contains(transactionHashes[i]);
+        anyMissing = anyMissing || missing[i];
+        if (!missing[i])
+        {
+          ++m_relaySuppressedTransactions;
+          m_relaySavedBytes += transactions[i].size();
+        }
+      }
+
+      if (anyMissing)
+      {
+        groups[missing].push_back(ctx.m_connection_id);
+      }
+    }
+
+    markTransactionsKnown(ctx, transactionHashes);
+  });
+
+  for (const auto &group : groups)
+  {
+    NOTIFY_NEW_TRANSACTIONS::request request;
+    for (size_t i = 0; i < transactions.size(); ++i)
+    {
+      if (group.first[i])
+      {
+        request.txs.push_back(transactions[i]);
+      }
+    }
+
+    m_p2p->externalRelayNotifyToList(NOTIFY_NEW_TRANSACTIONS::ID, LevinProtocol::encode(request), group.second);
+  }
 }
 
 void CryptoNoteProtocolHandler::requestMissingPoolTransactions(const CryptoNoteConnectionContext &context)
@@ -892,14 +1642,36 @@ void CryptoNoteProtocolHandler::requestMissingPoolTransactions(const CryptoNoteC
     return;
   }
 
-  auto poolTxs = m_core.getPoolTransactions();
+  // both ways into state_normal pass here, which is when the peer can start using compact blocks
+  NOTIFY_COMPACT_BLOCKS_SUPPORTED::request announcement;
+  post_notify<NOTIFY_COMPACT_BLOCKS_SUPPORTED>(*m_p2p, announcement, context);
 
-  NOTIFY_REQUEST_TX_POOL::request notification;
-  for (auto &tx : poolTxs)
+  auto poolHashes = m_core.getPoolTransactionHashes();
+
+  // peers that take short ids get 6 bytes per pool transaction instead of 32, the
+  // answer carries only the difference either way
+  if (context.m_supports_pool_short_ids)
   {
-    notification.txs.emplace_back(getObjectHash(tx));
+    NOTIFY_REQUEST_TX_POOL_SHORT_IDS::request request;
+    request.nonce = Crypto::rand<uint64_t>();
+    Crypto::Hash key = compactBlockKey(std::string(), request.nonce);
+    request.short_ids.reserve(poolHashes.size() * COMPACT_SHORT_ID_SIZE);
+    for (const auto &transactionHash : poolHashes)
+    {
+      appendShortId(request.short_ids, compactShortId(key, transactionHash));
+    }
+
+    if (!post_notify<NOTIFY_REQUEST_TX_POOL_SHORT_IDS>(*m_p2p, request, context))
+    {
+      logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Failed to post notification NOTIFY_REQUEST_TX_POOL_SHORT_IDS to " << context.m_connection_id;
+    }
+
+    return;
   }
 
+  NOTIFY_REQUEST_TX_POOL::request notification;
+  notification.txs = std::move(poolHashes);
+
   bool ok = post_notify<NOTIFY_REQUEST_TX_POOL>(*m_p2p, notification, context);
   if (!ok)
   {
@@ -977,6 +1749,48 @@ bool CryptoNoteProtocolHandler::removeObserver(ICryptoNoteProtocolObserver *obse
   return m_observerManager.remove(observer);
 }
 
+int CryptoNoteProtocolHandler::doPushCompactBlock(CryptoNoteConnectionContext &context)
+{
+  PendingCompactBlock &pending = *context.m_pending_compact_block;
+
+  NOTIFY_REQUEST_COMPACT_TXS::request req;
+  req.blockKey = pending.key;
+  for (size_t i = 0; i < pending.transactions.size(); ++i)
+  {
+    if (pending.transactions[i] == NULL_HASH)
+    {
+      req.indexes.push_back(static_cast<uint32_t>(i));
+    }
+  }
+
+  if (!req.indexes.empty())
+  {
+    logger(Logging::DEBUGGING) << context << "Compact block is missing " << req.indexes.size() << " of " << pending.transactions.size() << " transactions";
+    if (!post_notify<NOTIFY_REQUEST_COMPACT_TXS>(*m_p2p, req, context))
+    {
+      logger(Logging::DEBUGGING) << context << "Compact block is missing transactions but the publisher is not reachable, dropping connection.";
+      context.m_pending_compact_block = boost::none;
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    }
+
+    return 1;
+  }
+
+  // every hash is known now, the block continues as a lite block
+  Block b;
+  fromBinaryArray(b, asBinaryArray(pending.request.block));
+  b.transactionHashes = std::move(pending.transactions);
+
+  NOTIFY_NEW_LITE_BLOCK::request lite;
+  lite.block = asString(toBinaryArray(b));
+  lite.current_blockchain_height = pending.request.current_blockchain_height;
+  lite.hop = pending.request.hop;
+
+  std::vector<BinaryArray> providedTransactions = std::move(pending.providedTransactions);
+  context.m_pending_compact_block = boost::none;
+  return doPushLiteBlock(std::move(lite), context, std::move(providedTransactions));
+}
+
 int CryptoNoteProtocolHandler::doPushLiteBlock(NOTIFY_NEW_LITE_BLOCK::request arg, CryptoNoteConnectionContext &context,
                                                std::vector<BinaryArray> missingTxs)
 {
@@ -988,6 +1802,8 @@ int CryptoNoteProtocolHandler::doPushLiteBlock(NOTIFY_NEW_LITE_BLOCK::request ar
     return 1;
   }
 
+  context.m_known_blocks.insert(get_block_hash(b));
+
   std::unordered_map<Crypto::Hash, BinaryArray> provided_txs;
   provided_txs.reserve(missingTxs.size());
   for (const auto &missingTx : missingTxs)
@@ -1075,7 +1891,7 @@ int CryptoNoteProtocolHandler::doPushLiteBlock(NOTIFY_NEW_LITE_BLOCK::request ar
     {
       ++arg.hop;
       //TODO: Add here announce protocol usage
-      relay_post_notify<NOTIFY_NEW_LITE_BLOCK>(*m_p2p, arg, &context.m_connection_id);
+      relayBlockToPeers(arg, nullptr, &context.m_connection_id);
 
       if (bvc.m_switched_to_alt_chain)
       {
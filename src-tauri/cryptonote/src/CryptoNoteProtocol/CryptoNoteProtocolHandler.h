@@ -18,11 +18,15 @@
 #pragma once
 
 #include <atomic>
+#include <deque>
+#include <map>
 
 #include <Common/ObserverManager.h>
+#include <Common/ThreadPool.h>
 
 #include "CryptoNoteCore/ICore.h"
 
+#include "CryptoNoteProtocol/BlockDownloadScheduler.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolHandlerCommon.h"
 #include "CryptoNoteProtocol/ICryptoNoteProtocolObserver.h"
@@ -82,6 +86,8 @@ namespace CryptoNote
     int handleCommand(bool is_notify, int command, const BinaryArray& in_buff, BinaryArray& buff_out, CryptoNoteConnectionContext& context, bool& handled);
     virtual size_t getPeerCount() const override;
     virtual uint32_t getObservedHeight() const override;
+    // blocks of the current response whose checks are queued or running ahead of the ordered add
+    size_t getBlockVerificationQueueDepth() const { return m_blockVerificationQueueDepth; }
     void requestMissingPoolTransactions(const CryptoNoteConnectionContext& context);
 
   private:
@@ -95,6 +101,11 @@ namespace CryptoNote
     int handle_request_tx_pool(int command, NOTIFY_REQUEST_TX_POOL::request &arg, CryptoNoteConnectionContext &context);
     int handle_notify_new_lite_block(int command, NOTIFY_NEW_LITE_BLOCK::request &arg, CryptoNoteConnectionContext &context);
     int handle_notify_missing_txs(int command, NOTIFY_MISSING_TXS::request &arg, CryptoNoteConnectionContext &context);
+    int handle_notify_new_compact_block(int command, NOTIFY_NEW_COMPACT_BLOCK::request &arg, CryptoNoteConnectionContext &context);
+    int handle_request_compact_txs(int command, NOTIFY_REQUEST_COMPACT_TXS::request &arg, CryptoNoteConnectionContext &context);
+    int handle_response_compact_txs(int command, NOTIFY_RESPONSE_COMPACT_TXS::request &arg, CryptoNoteConnectionContext &context);
+    int handle_notify_compact_blocks_supported(int command, NOTIFY_COMPACT_BLOCKS_SUPPORTED::request &arg, CryptoNoteConnectionContext &context);
+    int handle_request_tx_pool_short_ids(int command, NOTIFY_REQUEST_TX_POOL_SHORT_IDS::request &arg, CryptoNoteConnectionContext &context);
 
 
     //----------------- i_cryptonote_protocol ----------------------------------
@@ -112,6 +123,35 @@ namespace CryptoNote
 
   private:
     int doPushLiteBlock(NOTIFY_NEW_LITE_BLOCK::request block, CryptoNoteConnectionContext &context, std::vector<BinaryArray> missingTxs);
+    int doPushCompactBlock(CryptoNoteConnectionContext &context);
+    // runs on the dispatcher: compact blocks to peers that support them, lite and full blocks as before to the rest
+    void relayBlockToPeers(const NOTIFY_NEW_LITE_BLOCK::request &liteBlock, const BinaryArray *fullBlock, const net_connection_id *excludeConnection);
+    void markTransactionsKnown(CryptoNoteConnectionContext &context, const std::vector<Crypto::Hash> &transactions);
+    void relayTransactionsToPeers(const std::vector<std::string> &transactions, const std::vector<Crypto::Hash> &transactionHashes,
+                                  const net_connection_id *excludeConnection);
+    // applies downloaded chunks in height order, whichever connection delivered them
+    int applyDownloadedChunks(CryptoNoteConnectionContext &context);
+    // asks idle synchronizing connections for more chunks, runs on the dispatcher
+    void resumeDownloads();
+    void stopDownloading(const CryptoNoteConnectionContext &context);
+    void dropDownloadedChunks(const std::vector<uint32_t> &chunkHeights);
+    // runs on the verification workers: transaction hashes and proof of work of consecutive blocks,
+    // returns false on a transaction hash mismatch
+    bool prepareBlocks(const parsed_block_entry *blocks, size_t count);
+    Common::ThreadPool &blockVerifier();
+
+    struct DownloadedChunk {
+      net_connection_id source;
+      std::vector<parsed_block_entry> blocks;
+    };
+
+    struct SentCompactBlock {
+      Crypto::Hash key;
+      std::vector<Crypto::Hash> transactions;
+    };
+
+    // compact blocks sent recently, to answer NOTIFY_REQUEST_COMPACT_TXS; only used on the dispatcher
+    std::deque<SentCompactBlock> m_sentCompactBlocks;
 
     System::Dispatcher& m_dispatcher;
     ICore& m_core;
@@ -128,5 +168,18 @@ namespace CryptoNote
 
     std::atomic<size_t> m_peersCount;
     Tools::ObserverManager<ICryptoNoteProtocolObserver> m_observerManager;
+
+    // blocks being downloaded from several synchronizing connections at once; only used on the dispatcher
+    BlockDownloadScheduler m_blockDownloads;
+    std::map<uint32_t, DownloadedChunk> m_downloadedChunks;
+    bool m_applyingChunks;
+
+    std::unique_ptr<Common::ThreadPool> m_blockVerifier; // created on first use, on the dispatcher
+    std::atomic<size_t> m_blockVerificationQueueDepth;
+
+    // relay traffic skipped because the peer already had the item, reported by get_stat_info
+    std::atomic<uint64_t> m_relaySuppressedTransactions;
+    std::atomic<uint64_t> m_relaySuppressedBlocks;
+    std::atomic<uint64_t> m_relaySavedBytes;
   };
 }
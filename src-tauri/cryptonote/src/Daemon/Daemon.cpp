@@ -21,7 +21,9 @@
 #include <boost/program_options.hpp>
 
 #include "DaemonCommandsHandler.h"
+#include "StartupSequence.h"
 
+#include "Common/AllocationTracker.h"
 #include "Common/SignalHandler.h"
 #include "Common/PathTools.h"
 #include "crypto/hash.h"
@@ -32,6 +34,7 @@
 #include "CryptoNoteCore/MinerConfig.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolHandler.h"
 #include "CryptoNoteProtocol/ICryptoNoteProtocolQuery.h"
+#include "HTTP/HttpParser.h"
 #include "P2p/NetNode.h"
 #include "P2p/NetNodeConfig.h"
 #include "Rpc/RpcServer.h"
@@ -64,6 +67,7 @@ namespace
   const command_line::arg_descriptor<bool>        arg_console     = {"no-console", "Disable daemon console commands"};
   const command_line::arg_descriptor<bool>        arg_testnet_on  = {"testnet", "Used to deploy test nets. Checkpoints and hardcoded seeds are ignored, "
     "network id is changed. Use it with --data-dir flag. The wallet must be launched with --testnet flag.", false};
+  const command_line::arg_descriptor<uint32_t>    arg_heap_snapshot_interval = { "heap-snapshot-interval", "Log live heap bytes by subsystem every N seconds, needs a build with FUEGO_ALLOCATION_TRACKING", 0 };
   const command_line::arg_descriptor<bool>        arg_print_genesis_tx = { "print-genesis-tx", "Prints genesis' block tx hex to insert it to config and exits" };
 }
 
@@ -152,6 +156,7 @@ int main(int argc, char* argv[])
    command_line::add_arg(desc_cmd_sett, arg_set_view_key);
    command_line::add_arg(desc_cmd_sett, arg_testnet_on);
    command_line::add_arg(desc_cmd_sett, arg_enable_cors);
+   command_line::add_arg(desc_cmd_sett, arg_heap_snapshot_interval);
 
    command_line::add_arg(desc_cmd_sett, arg_print_genesis_tx);
    //command_line::add_arg(desc_cmd_sett, arg_genesis_block_reward_address);
@@ -298,62 +303,68 @@ int main(int argc, char* argv[])
 
     cprotocol.set_p2p_endpoint(&p2psrv);
     ccore.set_cryptonote_protocol(&cprotocol);
-    DaemonCommandsHandler dch(ccore, p2psrv, logManager, cprotocol);
-
-    // initialize objects
-    logger(INFO) << "Initializing p2p server...";
-    if (!p2psrv.init(netNodeConfig)) {
-      logger(ERROR, BRIGHT_RED) << "Failed to initialize p2p server.";
-      return 1;
-    }
-
-    logger(INFO) << "P2p server initialized OK";
-
-    // initialize core here
-    logger(INFO) << "Initializing core...";
-    if (!ccore.init(coreConfig, minerConfig, true)) {
-      logger(ERROR, BRIGHT_RED) << "Failed to initialize core";
-      return 1;
+    ccore.setHeapSnapshotInterval(command_line::get_arg(vm, arg_heap_snapshot_interval));
+    if (command_line::get_arg(vm, arg_heap_snapshot_interval) != 0 && !Common::allocationTrackingEnabled()) {
+      logger(WARNING) << "--" << arg_heap_snapshot_interval.name << " needs a build with FUEGO_ALLOCATION_TRACKING, snapshots will be empty";
     }
+    DaemonCommandsHandler dch(ccore, p2psrv, logManager, cprotocol);
 
-    logger(INFO) << "Core initialized OK";
-
-    // start components
-    if (!command_line::has_arg(vm, arg_console)) {
-      dch.start_handling();
-    }
+    // initialize objects; the core loads on worker threads while the p2p server, which binds its
+    // listener through the dispatcher, initializes on this one
+    StartupSequence startup(logManager);
+    startup.addStage("pool", {}, [&] { return ccore.initPool(coreConfig); }, true);
+    startup.addStage("blockchain", { "pool" }, [&] { return ccore.initBlockchain(coreConfig, true); }, true);
+    startup.addStage("miner", {}, [&] { return ccore.initMiner(minerConfig); }, true);
+    startup.addStage("p2p", {}, [&] {
+      logger(INFO) << "Initializing p2p server...";
+      return p2psrv.init(netNodeConfig);
+    }, false);
+
+    startup.addStage("rpc", { "blockchain", "miner", "p2p" }, [&] {
+      // start components
+      if (!command_line::has_arg(vm, arg_console)) {
+        dch.start_handling();
+      }
 
-    logger(INFO) << "Starting core rpc server on address " << rpcConfig.getBindAddress();
-  
-    /* Set address for remote node fee */
-  	if (command_line::has_arg(vm, arg_set_fee_address)) {
-	  std::string addr_str = command_line::get_arg(vm, arg_set_fee_address);
-	  if (!addr_str.empty()) {
-        AccountPublicAddress acc = boost::value_initialized<AccountPublicAddress>();
-        if (!currency.parseAccountAddressString(addr_str, acc)) {
-          logger(ERROR, BRIGHT_RED) << "Bad fee address: " << addr_str;
-          return 1;
+      logger(INFO) << "Starting core rpc server on address " << rpcConfig.getBindAddress();
+
+      /* Set address for remote node fee */
+      if (command_line::has_arg(vm, arg_set_fee_address)) {
+        std::string addr_str = command_line::get_arg(vm, arg_set_fee_address);
+        if (!addr_str.empty()) {
+          AccountPublicAddress acc = boost::value_initialized<AccountPublicAddress>();
+          if (!currency.parseAccountAddressString(addr_str, acc)) {
+            logger(ERROR, BRIGHT_RED) << "Bad fee address: " << addr_str;
+            return false;
+          }
+          rpcServer.setFeeAddress(addr_str, acc);
+          logger(INFO, BRIGHT_YELLOW) << "Remote node fee address set: " << addr_str;
         }
-        rpcServer.setFeeAddress(addr_str, acc);
-        logger(INFO, BRIGHT_YELLOW) << "Remote node fee address set: " << addr_str;
-
       }
-	  }
-  
-    /* This sets the view-key so we can confirm that
-       the fee is part of the transaction blob */       
-    if (command_line::has_arg(vm, arg_set_view_key)) {
-      std::string vk_str = command_line::get_arg(vm, arg_set_view_key);
-	    if (!vk_str.empty()) {
-        rpcServer.setViewKey(vk_str);
-        logger(INFO, BRIGHT_YELLOW) << "Secret view key set: " << vk_str;
+
+      /* This sets the view-key so we can confirm that
+         the fee is part of the transaction blob */
+      if (command_line::has_arg(vm, arg_set_view_key)) {
+        std::string vk_str = command_line::get_arg(vm, arg_set_view_key);
+        if (!vk_str.empty()) {
+          rpcServer.setViewKey(vk_str);
+          logger(INFO, BRIGHT_YELLOW) << "Secret view key set: " << vk_str;
+        }
       }
+
+      rpcServer.setWorkerThreads(rpcConfig.threads);
+      rpcServer.setRequestLimits(HttpParser::DEFAULT_MAX_HEADER_SIZE, static_cast<size_t>(rpcConfig.maxBodySize));
+      rpcServer.start(rpcConfig.bindIp, rpcConfig.bindPort);
+      rpcServer.restrictRPC(command_line::get_arg(vm, arg_restricted_rpc));
+      rpcServer.enableCors(command_line::get_arg(vm, arg_enable_cors));
+      logger(INFO) << "Core rpc server started ok";
+      return true;
+    }, false);
+
+    if (!startup.run()) {
+      logger(ERROR, BRIGHT_RED) << "Failed to initialize daemon";
+      return 1;
     }
- 
-    rpcServer.start(rpcConfig.bindIp, rpcConfig.bindPort);
-    rpcServer.restrictRPC(command_line::get_arg(vm, arg_restricted_rpc));
-    rpcServer.enableCors(command_line::get_arg(vm, arg_enable_cors));
-    logger(INFO) << "Core rpc server started ok";
 
     Tools::SignalHandler::install([&dch, &p2psrv] {
       dch.stop_handling();
@@ -17,6 +17,9 @@
 
 #include "DaemonCommandsHandler.h"
 #include <ctime>
+#include <limits>
+#include "Common/AllocationTracker.h"
+#include "Common/LockProfiler.h"
 #include "P2p/NetNode.h"
 #include "CryptoNoteCore/Miner.h"
 #include "CryptoNoteCore/Core.h"
@@ -42,6 +45,12 @@ DaemonCommandsHandler::DaemonCommandsHandler(CryptoNote::core& core, CryptoNote:
   m_consoleHandler.setHandler("exit", boost::bind(&DaemonCommandsHandler::exit, this, boost::arg<1>()), "Shutdown the daemon");
   m_consoleHandler.setHandler("help", boost::bind(&DaemonCommandsHandler::help, this, boost::arg<1>()), "Show this help");
   m_consoleHandler.setHandler("save", boost::bind(&DaemonCommandsHandler::save, this, boost::arg<1>()), "Save the Blockchain data safely");
+  m_consoleHandler.setHandler("export_snapshot", boost::bind(&DaemonCommandsHandler::export_snapshot, this, boost::arg<1>()), "Write a bootstrap snapshot of the blockchain, export_snapshot <file>");
+  m_consoleHandler.setHandler("export_blocks", boost::bind(&DaemonCommandsHandler::export_blocks, this, boost::arg<1>()), "Write a range of blocks for replay benchmarks, export_blocks <start_height> <count> <file>");
+  m_consoleHandler.setHandler("verify_chain", boost::bind(&DaemonCommandsHandler::verify_chain, this, boost::arg<1>()), "Check stored blocks against the indexes and the cache, verify_chain [<start_height> [<end_height>]] [pow] [signatures] [threads=<n>]");
+  m_consoleHandler.setHandler("lock_profile", boost::bind(&DaemonCommandsHandler::lock_profile, this, boost::arg<1>()), "Profile blockchain and pool lock call sites, lock_profile on | off | reset | print");
+  m_consoleHandler.setHandler("print_memory", boost::bind(&DaemonCommandsHandler::print_memory, this, boost::arg<1>()), "Print live heap bytes by subsystem");
+  m_consoleHandler.setHandler("block_cache", boost::bind(&DaemonCommandsHandler::block_cache, this, boost::arg<1>()), "Print block cache usage, or resize it with block_cache <MB>");
   m_consoleHandler.setHandler("print_pl", boost::bind(&DaemonCommandsHandler::print_pl, this, boost::arg<1>()), "Print peer list");
   m_consoleHandler.setHandler("rollback_chain", boost::bind(&DaemonCommandsHandler::rollback_chain, this, boost::arg<1>()), "Rollback chain to specific height, rollback_chain <height>");
   m_consoleHandler.setHandler("print_cn", boost::bind(&DaemonCommandsHandler::print_cn, this, boost::arg<1>()), "Print connections");
@@ -112,6 +121,145 @@ bool DaemonCommandsHandler::save(const std::vector<std::string> &args)
   return m_core.saveBlockchain();
 }
 //--------------------------------------------------------------------------------
+bool DaemonCommandsHandler::export_snapshot(const std::vector<std::string>& args)
+{
+  if (args.size() != 1) {
+    std::cout << "usage: export_snapshot <file>" << std::endl;
+    return true;
+  }
+
+  if (!m_core.exportSnapshot(args.front())) {
+    std::cout << "Snapshot export failed, see the log for details" << std::endl;
+  }
+
+  return true;
+}
+//--------------------------------------------------------------------------------
+bool DaemonCommandsHandler::export_blocks(const std::vector<std::string>& args)
+{
+  uint32_t startHeight = 0;
+  uint32_t count = 0;
+  if (args.size() != 3 || !Common::fromString(args[0], startHeight) || !Common::fromString(args[1], count)) {
+    std::cout << "usage: export_blocks <start_height> <count> <file>" << std::endl;
+    return true;
+  }
+
+  if (!m_core.exportBlocks(startHeight, count, args[2])) {
+    std::cout << "Block export failed, see the log for details" << std::endl;
+  }
+
+  return true;
+}
+//--------------------------------------------------------------------------------
+bool DaemonCommandsHandler::verify_chain(const std::vector<std::string>& args)
+{
+  std::vector<uint32_t> heights;
+  bool checkProofOfWork = false;
+  bool checkSignatures = false;
+  uint32_t threads = 0;
+  bool validArgs = true;
+  for (const std::string& arg : args) {
+    uint32_t value;
+    if (arg == "pow") {
+      checkProofOfWork = true;
+    } else if (arg == "signatures") {
+      checkSignatures = true;
+    } else if (arg.compare(0, 8, "threads=") == 0) {
+      validArgs = validArgs && Common::fromString(arg.substr(8), threads);
+    } else if (heights.size() < 2 && Common::fromString(arg, value)) {
+      heights.push_back(value);
+    } else {
+      validArgs = false;
+    }
+  }
+
+  if (!validArgs) {
+    std::cout << "usage: verify_chain [<start_height> [<end_height>]] [pow] [signatures] [threads=<n>]" << std::endl;
+    return true;
+  }
+
+  uint32_t startHeight = heights.empty() ? 0 : heights[0];
+  uint32_t endHeight = heights.size() < 2 ? std::numeric_limits<uint32_t>::max() : heights[1] + 1;
+
+  CryptoNote::ChainVerificationReport report;
+  bool valid = m_core.verifyChain(startHeight, endHeight, checkProofOfWork, checkSignatures, threads, report);
+  std::cout << "Checked " << report.checkedBlocks << " blocks, " << report.checkedTransactions << " transactions and " <<
+    report.checkedSignatures << " ring signatures in " << report.seconds << " s, " <<
+    static_cast<uint64_t>(report.seconds > 0 ? report.checkedBlocks / report.seconds : 0) << " blocks/s" << std::endl;
+  for (const std::string& error : report.errors) {
+    std::cout << error << std::endl;
+  }
+
+  if (report.errorCount > report.errors.size()) {
+    std::cout << "... and " << report.errorCount - report.errors.size() << " more errors" << std::endl;
+  }
+
+  if (valid) {
+    std::cout << "No problems found" << std::endl;
+  } else if (report.errorCount != 0) {
+    std::cout << report.errorCount << " problems found, resync or restore the data directory" << std::endl;
+  }
+
+  return true;
+}
+bool DaemonCommandsHandler::lock_profile(const std::vector<std::string>& args)
+{
+  Common::LockProfiler& profiler = Common::LockProfiler::instance();
+  const std::string command = args.empty() ? "print" : args[0];
+  if (command == "on") {
+    profiler.setEnabled(true);
+    std::cout << "Lock profiling enabled" << std::endl;
+  } else if (command == "off") {
+    profiler.setEnabled(false);
+    std::cout << "Lock profiling disabled" << std::endl;
+  } else if (command == "reset") {
+    profiler.reset();
+  } else if (command == "print") {
+    if (!profiler.enabled()) {
+      std::cout << "Lock profiling is off, enable it with: lock_profile on" << std::endl;
+    }
+
+    std::cout << profiler.report();
+  } else {
+    std::cout << "use: lock_profile on | off | reset | print" << std::endl;
+  }
+
+  return true;
+}
+//--------------------------------------------------------------------------------
+bool DaemonCommandsHandler::print_memory(const std::vector<std::string>& args)
+{
+  std::cout << Common::memoryReport();
+  return true;
+}
+//--------------------------------------------------------------------------------
+bool DaemonCommandsHandler::block_cache(const std::vector<std::string>& args)
+{
+  uint64_t megabytes = 0;
+  if (args.size() > 1 || (args.size() == 1 && (!Common::fromString(args[0], megabytes) || megabytes == 0))) {
+    std::cout << "usage: block_cache [<MB>]" << std::endl;
+    return true;
+  }
+
+  if (megabytes != 0) {
+    m_core.setBlockCacheSize(megabytes * 1024 * 1024);
+  }
+
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t blocks = 0;
+  uint64_t bytes = 0;
+  m_core.getBlockCacheStats(hits, misses);
+  m_core.getBlockCacheUsage(blocks, bytes);
+  uint64_t blockBytes = 0;
+  uint64_t fileBytes = 0;
+  m_core.getBlockStoreUsage(blockBytes, fileBytes);
+  std::cout << "Cached blocks: " << blocks << ", " << bytes / 1024 << " KB" << std::endl <<
+    "Hits: " << hits << ", misses: " << misses << std::endl <<
+    "Stored blocks: " << blockBytes / 1024 << " KB in " << fileBytes / 1024 << " KB on disk" << std::endl;
+  return true;
+}
+//--------------------------------------------------------------------------------
 bool DaemonCommandsHandler::print_pl(const std::vector<std::string> &args)
 {
   m_srv.log_peerlist();
@@ -325,6 +473,7 @@ bool DaemonCommandsHandler::status(const std::vector<std::string>& args) {
   uint64_t totalCoinsInNetwork = m_core.coinsEmittedAtHeight(height);
   uint64_t totalCoinsOnDeposits = m_core.depositAmountAtHeight(height);
   uint64_t amountOfActiveCoins = totalCoinsInNetwork - totalCoinsOnDeposits;
+  CryptoNote::KeyImageFilter::Stats filterStats = m_core.getSpentKeyFilterStats();
 
 
 std::cout << std::endl
@@ -338,6 +487,8 @@ const auto &currency = m_core.currency();
 std::cout << "Total active (unlocked) XFG :  " << currency.formatAmount(amountOfActiveCoins) << " (" << currency.formatAmount(calculatePercent(currency, amountOfActiveCoins, totalCoinsInNetwork)) << "%)" << std::endl;
 std::cout << "Total XFG locked in COLD : " << currency.formatAmount(totalCoinsOnDeposits) << " (" << currency.formatAmount(calculatePercent(currency, totalCoinsOnDeposits, totalCoinsInNetwork)) << "%)" << std::endl;
 std::cout << "Current amount of XFG in Network :  " << currency.formatAmount(totalCoinsInNetwork)<<" XFG"<< std::endl;
+std::cout << "Spent key filter: " << filterStats.lookups << " lookups, " << filterStats.rejected << " rejected early, "
+         << filterStats.falsePositives << " false positives, " << filterStats.sizeBytes / 1024 << " KiB" << std::endl;
 std::cout << "**************************************************"<< std::endl;
   return true;
 }
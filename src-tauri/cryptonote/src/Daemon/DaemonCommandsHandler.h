@@ -78,6 +78,12 @@ private:
   bool print_pool_sh(const std::vector<std::string>& args);
   bool status(const std::vector<std::string>& args);
   bool save(const std::vector<std::string> &args);
+  bool export_snapshot(const std::vector<std::string>& args);
+  bool export_blocks(const std::vector<std::string>& args);
+  bool verify_chain(const std::vector<std::string>& args);
+  bool lock_profile(const std::vector<std::string>& args);
+  bool print_memory(const std::vector<std::string>& args);
+  bool block_cache(const std::vector<std::string>& args);
 
   bool start_mining(const std::vector<std::string>& args);
   bool stop_mining(const std::vector<std::string>& args);
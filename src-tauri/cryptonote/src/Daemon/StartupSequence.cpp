@@ -0,0 +1,167 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "StartupSequence.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Logging;
+
+namespace CryptoNote {
+
+StartupSequence::StartupSequence(ILogger& log) : logger(log, "startup"), m_workers(nullptr), m_finished(0) {
+}
+
+void StartupSequence::addStage(const std::string& name, const std::vector<std::string>& dependencies, std::function<bool()>&& stage, bool inBackground) {
+  Stage added;
+  added.name = name;
+  for (const std::string& dependency : dependencies) {
+    size_t index = 0;
+    while (index < m_stages.size() && m_stages[index].name != dependency) {
+      ++index;
+    }
+
+    // stages are added after their dependencies, which also rules out cycles
+    if (index == m_stages.size()) {
+      throw std::invalid_argument("Startup stage " + name + " depends on unknown stage " + dependency);
+    }
+
+    added.dependencies.push_back(index);
+  }
+
+  added.procedure = std::move(stage);
+  added.inBackground = inBackground;
+  added.state = State::PENDING;
+  added.duration = std::chrono::steady_clock::duration::zero();
+  m_stages.push_back(std::move(added));
+}
+
+bool StartupSequence::execute(Stage& stage) {
+  auto start = std::chrono::steady_clock::now();
+  bool succeeded = false;
+  try {
+    succeeded = stage.procedure();
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Startup stage " << stage.name << " failed: " << e.what();
+  }
+
+  stage.duration = std::chrono::steady_clock::now() - start;
+  return succeeded;
+}
+
+StartupSequence::Stage* StartupSequence::startReady() {
+  Stage* foreground = nullptr;
+  for (Stage& stage : m_stages) {
+    if (stage.state != State::PENDING) {
+      continue;
+    }
+
+    bool ready = true;
+    for (size_t dependency : stage.dependencies) {
+      State state = m_stages[dependency].state;
+      if (state == State::FAILED || state == State::SKIPPED) {
+        stage.state = State::SKIPPED;
+        ++m_finished;
+        ready = false;
+        break;
+      }
+
+      ready = ready && state == State::SUCCEEDED;
+    }
+
+    if (!ready) {
+      continue;
+    }
+
+    if (stage.inBackground) {
+      stage.state = State::RUNNING;
+      m_running.push_back(m_workers->submit([this, &stage] {
+        bool succeeded = execute(stage);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stage.state = succeeded ? State::SUCCEEDED : State::FAILED;
+        ++m_finished;
+        // the worker starts what it unblocked itself, the calling thread may be busy with a stage of its own
+        startReady();
+        m_stageFinished.notify_one();
+      }));
+    } else if (foreground == nullptr) {
+      foreground = &stage;
+    }
+  }
+
+  return foreground;
+}
+
+bool StartupSequence::run() {
+  auto start = std::chrono::steady_clock::now();
+  size_t background = 0;
+  for (const Stage& stage : m_stages) {
+    background += stage.inBackground ? 1 : 0;
+  }
+
+  // a worker per background stage, they mostly wait on the disk and none should queue behind another
+  Common::ThreadPool workers(std::max<size_t>(background, 1));
+  m_workers = &workers;
+  m_finished = 0;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (m_finished < m_stages.size()) {
+    Stage* foreground = startReady();
+    if (foreground != nullptr) {
+      foreground->state = State::RUNNING;
+      lock.unlock();
+      bool succeeded = execute(*foreground);
+      lock.lock();
+      foreground->state = succeeded ? State::SUCCEEDED : State::FAILED;
+      ++m_finished;
+    } else if (m_finished < m_stages.size()) {
+      m_stageFinished.wait(lock);
+    }
+  }
+
+  lock.unlock();
+  for (std::future<void>& stage : m_running) {
+    stage.wait();
+  }
+
+  m_running.clear();
+  m_workers = nullptr;
+
+  bool succeeded = true;
+  for (const Stage& stage : m_stages) {
+    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(stage.duration).count();
+    switch (stage.state) {
+    case State::SUCCEEDED:
+      logger(INFO) << "Startup stage " << stage.name << " took " << milliseconds << " ms";
+      break;
+    case State::FAILED:
+      logger(ERROR, BRIGHT_RED) << "Startup stage " << stage.name << " failed after " << milliseconds << " ms";
+      succeeded = false;
+      break;
+    default:
+      logger(WARNING, BRIGHT_YELLOW) << "Startup stage " << stage.name << " skipped";
+      succeeded = false;
+      break;
+    }
+  }
+
+  logger(INFO) << "Startup took " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " ms";
+  return succeeded;
+}
+
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <Common/ThreadPool.h>
+#include <Logging/LoggerRef.h>
+
+namespace CryptoNote {
+
+// Daemon startup as a graph of stages. A stage starts once every stage it depends on has succeeded,
+// background stages run on worker threads and the rest on the thread calling run(), which is the
+// dispatcher thread for stages that open sockets. Independent stages overlap, e.g. loading the
+// blockchain while the p2p server reads its peerlist and maps its port.
+class StartupSequence {
+public:
+  explicit StartupSequence(Logging::ILogger& log);
+
+  // a stage returning false or throwing fails the startup, the stages depending on it are skipped
+  void addStage(const std::string& name, const std::vector<std::string>& dependencies, std::function<bool()>&& stage, bool inBackground);
+
+  // runs every stage, logs the time each took and returns true when all of them succeeded
+  bool run();
+
+private:
+  enum class State { PENDING, RUNNING, SUCCEEDED, FAILED, SKIPPED };
+
+  struct Stage {
+    std::string name;
+    std::vector<size_t> dependencies;
+    std::function<bool()> procedure;
+    bool inBackground;
+    State state;
+    std::chrono::steady_clock::duration duration;
+  };
+
+  // called with m_mutex held: skips the stages whose dependencies failed, hands the ready background
+  // stages to the workers and returns the first ready stage for the calling thread, if any
+  Stage* startReady();
+  bool execute(Stage& stage);
+
+  Logging::LoggerRef logger;
+  std::vector<Stage> m_stages;
+
+  std::mutex m_mutex;
+  std::condition_variable m_stageFinished;
+  Common::ThreadPool* m_workers;
+  std::vector<std::future<void>> m_running;
+  size_t m_finished;
+};
+
+}
@@ -33,10 +33,28 @@ void throwIfNotGood(std::istream& stream) {
   }
 }
 
+// takes the line up to the next space, the rest of the line when there is none
+Common::StringView readWord(Common::StringView& line) {
+  size_t end = line.find(' ');
+  if (end == Common::StringView::INVALID) {
+    Common::StringView word = line;
+    line = line.unhead(line.getSize());
+    return word;
+  }
+
+  Common::StringView word = line.head(end);
+  line = line.unhead(end + 1);
+  return word;
+}
+
 }
 
 namespace CryptoNote {
 
+HttpParser::HttpParser(size_t maxHeaderSize, size_t maxBodySize) :
+  maxHeaderSize(maxHeaderSize), maxBodySize(maxBodySize), bufferOffset(0) {
+}
+
 HttpResponse::HTTP_STATUS HttpParser::parseResponseStatusFromString(const std::string& status) {
   if (status == "200 OK" || status == "200 Ok") return CryptoNote::HttpResponse::STATUS_200;
   else if (status.substr(0, 4) == "401 ") return CryptoNote::HttpResponse::STATUS_401;
@@ -50,15 +68,23 @@ HttpResponse::HTTP_STATUS HttpParser::parseResponseStatusFromString(const std::s
 
 
 void HttpParser::receiveRequest(std::istream& stream, HttpRequest& request) {
-  readWord(stream, request.method);
-  readWord(stream, request.url);
+  Common::StringView head = readHead(stream);
+  Common::StringView line;
+  readLine(head, line);
 
-  std::string httpVersion;
-  readWord(stream, httpVersion);
+  Common::StringView word = readWord(line);
+  request.method.assign(word.getData(), word.getSize());
+  word = readWord(line);
+  request.url.assign(word.getData(), word.getSize());
+  request.version.assign(line.getData(), line.getSize());
 
-  readHeaders(stream, request.headers);
+  std::string name;
+  std::string value;
+  while (readLine(head, line)) {
+    readHeader(line, name, value);
+    request.headers[name] = value; //use insert
+  }
 
-  std::string body;
   size_t bodyLen = getBodyLen(request.headers);
   if (bodyLen) {
     readBody(stream, request.body, bodyLen);
@@ -67,47 +93,22 @@ void HttpParser::receiveRequest(std::istream& stream, HttpRequest& request) {
 
 
 void HttpParser::receiveResponse(std::istream& stream, HttpResponse& response) {
-  std::string httpVersion;
-  readWord(stream, httpVersion);
-  
-  std::string status;
-  char c;
-  
-  stream.get(c);
-  while (stream.good() && c != '\r') { //Till the end
-    status += c;
-    stream.get(c);
-  }
-
-  throwIfNotGood(stream);
+  Common::StringView head = readHead(stream);
+  Common::StringView line;
+  readLine(head, line);
 
-  if (c == '\r') {
-    stream.get(c);
-    if (c != '\n') {
-      throw std::runtime_error("Parser error: '\\n' symbol is expected");
-    }
-  }
+  readWord(line); // HTTP version
+  response.setStatus(parseResponseStatusFromString(std::string(line.getData(), line.getSize())));
 
-  response.setStatus(parseResponseStatusFromString(status));
-  
   std::string name;
   std::string value;
-
-  while (readHeader(stream, name, value)) {
+  while (readLine(head, line)) {
+    readHeader(line, name, value);
     response.addHeader(name, value);
-    name.clear();
-    value.clear();
   }
 
-  response.addHeader(name, value);
-  auto headers = response.getHeaders();
-  size_t length = 0;
-  auto it = headers.find("content-length");
-  if (it != headers.end()) {
-    length = std::stoul(it->second);
-  }
-  
   std::string body;
+  size_t length = getBodyLen(response.getHeaders());
   if (length) {
     readBody(stream, body, length);
   }
@@ -115,96 +116,97 @@ void HttpParser::receiveResponse(std::istream& stream, HttpResponse& response) {
   response.setBody(body);
 }
 
+bool HttpParser::hasBufferedData() const {
+  return bufferOffset < buffer.size();
+}
 
-void HttpParser::readWord(std::istream& stream, std::string& word) {
-  char c;
-
-  stream.get(c);
-  while (stream.good() && c != ' ' && c != '\r') {
-    word += c;
-    stream.get(c);
+// Returns the start line and the headers, each ending with "\r\n", as a view into the buffer. The view
+// stays valid until the next read from the stream.
+Common::StringView HttpParser::readHead(std::istream& stream) {
+  if (bufferOffset == buffer.size()) {
+    buffer.clear();
+  } else {
+    buffer.erase(0, bufferOffset);
   }
 
-  throwIfNotGood(stream);
+  bufferOffset = 0;
+  size_t scanned = 0;
+  for (;;) {
+    size_t end = buffer.find("\r\n\r\n", scanned);
+    if (end != std::string::npos) {
+      if (end + 4 > maxHeaderSize) {
+        throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::HEADER_TOO_LARGE));
+      }
+
+      bufferOffset = end + 4;
+      return Common::StringView(buffer.data(), end + 2);
+    }
 
-  if (c == '\r') {
-    stream.get(c);
-    if (c != '\n') {
-      throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL));
+    if (buffer.size() >= maxHeaderSize) {
+      throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::HEADER_TOO_LARGE));
     }
+
+    scanned = buffer.size() < 3 ? 0 : buffer.size() - 3;
+    fillBuffer(stream);
   }
 }
 
-void HttpParser::readHeaders(std::istream& stream, HttpRequest::Headers& headers) {
-  std::string name;
-  std::string value;
+// Waits for the stream to have data, then takes everything it has buffered in one go
+void HttpParser::fillBuffer(std::istream& stream) {
+  throwIfNotGood(stream);
 
-  while (readHeader(stream, name, value)) {
-    headers[name] = value; //use insert
-    name.clear();
-    value.clear();
+  std::streambuf* streambuf = stream.rdbuf();
+  if (streambuf->sgetc() == std::istream::traits_type::eof()) {
+    throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::END_OF_STREAM));
   }
 
-  headers[name] = value; //use insert
+  size_t available = static_cast<size_t>(std::max<std::streamsize>(streambuf->in_avail(), 1));
+  size_t size = buffer.size();
+  buffer.resize(size + available);
+  buffer.resize(size + static_cast<size_t>(streambuf->sgetn(&buffer[size], available)));
 }
 
-bool HttpParser::readHeader(std::istream& stream, std::string& name, std::string& value) {
-  char c;
-  bool isName = true;
-
-  stream.get(c);
-  while (stream.good() && c != '\r') {
-    if (c == ':') {
-      if (stream.peek() == ' ') {
-        stream.get(c);
-      }
+bool HttpParser::readLine(Common::StringView& head, Common::StringView& line) {
+  if (head.isEmpty()) {
+    return false;
+  }
 
-      if (name.empty()) {
-        throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::EMPTY_HEADER));
-      }
+  size_t end = head.find(Common::StringView("\r\n", 2));
+  line = head.head(end);
+  head = head.unhead(end + 2);
+  return true;
+}
 
-      if (isName) {
-        isName = false;
-        stream.get(c);
-        continue;
-      }
+void HttpParser::readHeader(Common::StringView line, std::string& name, std::string& value) {
+  size_t colon = line.find(':');
+  if (colon == Common::StringView::INVALID) {
+    name.assign(line.getData(), line.getSize());
+    value.clear();
+  } else {
+    if (colon == 0) {
+      throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::EMPTY_HEADER));
     }
 
-    if (isName) {
-      name += c;
-      stream.get(c);
-    } else {
-      value += c;
-      stream.get(c);
+    name.assign(line.getData(), colon);
+    line = line.unhead(colon + 1);
+    if (!line.isEmpty() && line.first() == ' ') {
+      line = line.unhead(1);
     }
-  }
-
-  throwIfNotGood(stream);
 
-  stream.get(c);
-  if (c != '\n') {
-    throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL));
+    value.assign(line.getData(), line.getSize());
   }
 
   std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-
-  c = stream.peek();
-  if (c == '\r') {
-    stream.get(c).get(c);
-    if (c != '\n') {
-      throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL));
-    }
-
-    return false; //no more headers
-  }
-
-  return true;
 }
 
 size_t HttpParser::getBodyLen(const HttpRequest::Headers& headers) {
   auto it = headers.find("content-length");
   if (it != headers.end()) {
     size_t bytes = std::stoul(it->second);
+    if (bytes > maxBodySize) {
+      throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::BODY_TOO_LARGE));
+    }
+
     return bytes;
   }
 
@@ -212,11 +214,21 @@ size_t HttpParser::getBodyLen(const HttpRequest::Headers& headers) {
 }
 
 void HttpParser::readBody(std::istream& stream, std::string& body, const size_t bodyLen) {
-  size_t read = 0;
-
-  while (stream.good() && read < bodyLen) {
-    body += stream.get();
-    ++read;
+  // the part that arrived together with the head, the rest goes straight from the stream into the body
+  size_t buffered = std::min(bodyLen, buffer.size() - bufferOffset);
+  body.assign(buffer, bufferOffset, buffered);
+  bufferOffset += buffered;
+
+  // grows with the data actually received rather than trusting Content-Length up front
+  const size_t BODY_CHUNK_SIZE = 64 * 1024;
+  size_t left = bodyLen - buffered;
+
+  while (stream.good() && left > 0) {
+    size_t offset = body.size();
+    size_t chunk = std::min(left, BODY_CHUNK_SIZE);
+    body.resize(offset + chunk);
+    stream.read(&body[offset], chunk);
+    left -= chunk;
   }
 
   throwIfNotGood(stream);
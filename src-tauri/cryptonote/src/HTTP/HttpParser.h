@@ -19,27 +19,41 @@
 #define HTTPPARSER_H_
 
 #include <iostream>
+#include <limits>
 #include <map>
 #include <string>
+#include "Common/StringView.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
 
 namespace CryptoNote {
 
 //Blocking HttpParser
+//Pulls whatever the stream has buffered into its own buffer and parses the head from there, so keep one
+//parser per connection: bytes of a pipelined message stay in the parser until the next receive call.
 class HttpParser {
 public:
-  HttpParser() {};
+  static const size_t DEFAULT_MAX_HEADER_SIZE = 64 * 1024;
+
+  explicit HttpParser(size_t maxHeaderSize = DEFAULT_MAX_HEADER_SIZE, size_t maxBodySize = std::numeric_limits<size_t>::max());
 
   void receiveRequest(std::istream& stream, HttpRequest& request);
   void receiveResponse(std::istream& stream, HttpResponse& response);
+  // true when bytes of the next message were already read from the stream
+  bool hasBufferedData() const;
   static HttpResponse::HTTP_STATUS parseResponseStatusFromString(const std::string& status);
 private:
-  void readWord(std::istream& stream, std::string& word);
-  void readHeaders(std::istream& stream, HttpRequest::Headers &headers);
-  bool readHeader(std::istream& stream, std::string& name, std::string& value);
+  Common::StringView readHead(std::istream& stream);
+  void fillBuffer(std::istream& stream);
+  bool readLine(Common::StringView& head, Common::StringView& line);
+  void readHeader(Common::StringView line, std::string& name, std::string& value);
   size_t getBodyLen(const HttpRequest::Headers& headers);
   void readBody(std::istream& stream, std::string& body, const size_t bodyLen);
+
+  const size_t maxHeaderSize;
+  const size_t maxBodySize;
+  std::string buffer;
+  size_t bufferOffset;
 };
 
 } //namespace CryptoNote
@@ -27,6 +27,10 @@ namespace CryptoNote {
     return url;
   }
 
+  const std::string& HttpRequest::getVersion() const {
+    return version;
+  }
+
   const HttpRequest::Headers& HttpRequest::getHeaders() const {
     return headers;
   }
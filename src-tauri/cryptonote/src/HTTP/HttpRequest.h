@@ -28,6 +28,7 @@ namespace CryptoNote {
 
     const std::string& getMethod() const;
     const std::string& getUrl() const;
+    const std::string& getVersion() const;
     const Headers& getHeaders() const;
     const std::string& getBody() const;
 
@@ -40,6 +41,7 @@ namespace CryptoNote {
 
     std::string method;
     std::string url;
+    std::string version;
     Headers headers;
     std::string body;
 
@@ -75,6 +75,8 @@ void HttpResponse::addHeader(const std::string& name, const std::string& value)
 }
 
 void HttpResponse::setBody(const std::string& b) {
+  bodyProducer = nullptr;
+  headers.erase("Transfer-Encoding");
   body = b;
   if (!body.empty()) {
     headers["Content-Length"] = std::to_string(body.size());
@@ -83,6 +85,26 @@ void HttpResponse::setBody(const std::string& b) {
   }
 }
 
+void HttpResponse::setBodyProducer(BodyProducer producer) {
+  body.clear();
+  headers.erase("Content-Length");
+  headers["Transfer-Encoding"] = "chunked";
+  bodyProducer = std::move(producer);
+}
+
+void HttpResponse::bufferBody() {
+  if (!bodyProducer) {
+    return;
+  }
+
+  std::string buffered;
+  BodyProducer producer = std::move(bodyProducer);
+  while (producer(buffered)) {
+  }
+
+  setBody(buffered);
+}
+
 std::ostream& HttpResponse::printHttpResponse(std::ostream& os) const {
   os << "HTTP/1.1 " << getStatusString(status) << "\r\n";
 
@@ -91,7 +113,21 @@ std::ostream& HttpResponse::printHttpResponse(std::ostream& os) const {
   }
   os << "\r\n";
 
-  if (!body.empty()) {
+  if (bodyProducer) {
+    // each piece goes out before the next is made, a producer that throws leaves the body
+    // without its final chunk so the client sees it as cut short
+    std::string chunk;
+    bool more = true;
+    while (more) {
+      chunk.clear();
+      more = bodyProducer(chunk);
+      if (!chunk.empty()) {
+        os << std::hex << chunk.size() << std::dec << "\r\n" << chunk << "\r\n";
+      }
+    }
+
+    os << "0\r\n\r\n";
+  } else if (!body.empty()) {
     os << body;
   }
 
@@ -16,6 +16,7 @@
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
+#include <functional>
 #include <ostream>
 #include <string>
 #include <map>
@@ -31,11 +32,19 @@ namespace CryptoNote {
       STATUS_500
     };
 
+    // appends the next piece of the body to chunk, returns false once that was the last piece
+    typedef std::function<bool(std::string& chunk)> BodyProducer;
+
     HttpResponse();
 
     void setStatus(HTTP_STATUS s);
     void addHeader(const std::string& name, const std::string& value);
     void setBody(const std::string& b);
+    // the body is generated while it is sent, with chunked transfer encoding
+    void setBodyProducer(BodyProducer producer);
+    // runs the producer into the body, for clients that do not understand chunked encoding
+    void bufferBody();
+    bool isChunked() const { return static_cast<bool>(bodyProducer); }
 
     const std::map<std::string, std::string>& getHeaders() const { return headers; }
     HTTP_STATUS getStatus() const { return status; }
@@ -48,6 +57,7 @@ namespace CryptoNote {
     HTTP_STATUS status;
     std::map<std::string, std::string> headers;
     std::string body;
+    BodyProducer bodyProducer;
   };
 
   inline std::ostream& operator<<(std::ostream& os, const HttpResponse& resp) {
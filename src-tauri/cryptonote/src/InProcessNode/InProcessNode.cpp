@@ -22,7 +22,9 @@
 #include <CryptoNoteCore/TransactionApi.h>
 
 #include "CryptoNoteConfig.h"
+#include "Common/Metrics.h"
 #include "Common/StringTools.h"
+#include "CryptoNoteCore/BinaryBlobDecoder.h"
 #include "CryptoNoteCore/CryptoNoteTools.h"
 #include "CryptoNoteCore/IBlock.h"
 #include "CryptoNoteCore/VerificationContext.h"
@@ -35,10 +37,39 @@ using namespace Common;
 
 namespace CryptoNote {
 
-InProcessNode::InProcessNode(CryptoNote::ICore& core, CryptoNote::ICryptoNoteProtocolQuery& protocol) :
+namespace {
+
+// Observes the time from posting a request until its callback has returned, so time spent queued
+// behind other requests counts too
+template <typename Handler>
+class TimedRequest {
+public:
+  TimedRequest(const char* method, Handler&& handler) :
+    m_latency(&Common::Metrics::instance().histogram("fuego_inprocess_node_request_seconds",
+      "Time from making an in-process node request until its callback returns", std::string("method=\"") + method + "\"")),
+    m_queued(std::chrono::steady_clock::now()),
+    m_handler(std::move(handler)) {
+  }
+
+  void operator()() {
+    m_handler();
+    m_latency->observe(std::chrono::steady_clock::now() - m_queued);
+  }
+
+private:
+  Common::MetricHistogram* m_latency;
+  std::chrono::steady_clock::time_point m_queued;
+  Handler m_handler;
+};
+
+}
+
+InProcessNode::InProcessNode(CryptoNote::ICore& core, CryptoNote::ICryptoNoteProtocolQuery& protocol, size_t workerThreads) :
     state(NOT_INITIALIZED),
     core(core),
     protocol(protocol),
+    workerCount(workerThreads != 0 ? workerThreads : std::max<size_t>(std::thread::hardware_concurrency(), 1)),
+    orderedRequests(ioService),
     blockchainExplorerDataBuilder(core, protocol)
 {
 }
@@ -52,7 +83,8 @@ bool InProcessNode::addObserver(INodeObserver* observer) {
     throw std::system_error(make_error_code(CryptoNote::error::NOT_INITIALIZED));
   }
 
-  return observerManager.add(observer);
+  // wallets are told on their own threads, so a slow one doesn't hold up block processing in the core
+  return observerManager.add(observer, Tools::ObserverDelivery::ASYNC);
 }
 
 bool InProcessNode::removeObserver(INodeObserver* observer) {
@@ -74,7 +106,9 @@ void InProcessNode::init(const Callback& callback) {
     core.addObserver(this);
 
     work.reset(new boost::asio::io_service::work(ioService));
-    workerThread.reset(new std::thread(&InProcessNode::workerFunc, this));
+    for (size_t i = 0; i < workerCount; ++i) {
+      workerThreads.emplace_back(&InProcessNode::workerFunc, this);
+    }
 
     state = INITIALIZED;
   }
@@ -98,7 +132,17 @@ bool InProcessNode::doShutdown() {
 
   work.reset();
   ioService.stop();
-  workerThread->join();
+
+  // a request a worker has just picked up checks the state under the mutex, so the workers are
+  // joined without it
+  std::vector<std::thread> stoppedThreads;
+  stoppedThreads.swap(workerThreads);
+  lock.unlock();
+  for (std::thread& workerThread : stoppedThreads) {
+    workerThread.join();
+  }
+
+  lock.lock();
   ioService.reset();
   return true;
 }
@@ -107,6 +151,16 @@ void InProcessNode::workerFunc() {
   ioService.run();
 }
 
+template <typename Handler>
+void InProcessNode::post(const char* method, bool ordered, Handler&& handler) {
+  TimedRequest<typename std::decay<Handler>::type> request(method, std::forward<Handler>(handler));
+  if (ordered) {
+    orderedRequests.post(std::move(request));
+  } else {
+    ioService.post(std::move(request));
+  }
+}
+
 void InProcessNode::getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std::vector<CryptoNote::block_complete_entry>& newBlocks,
   uint32_t& startHeight, const Callback& callback)
 {
@@ -117,7 +171,7 @@ void InProcessNode::getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std:
     return;
   }
 
-  ioService.post(
+  post("getNewBlocks", false,
     std::bind(&InProcessNode::getNewBlocksAsync,
       this,
       std::move(knownBlockIds),
@@ -191,7 +245,7 @@ void InProcessNode::getTransactionOutsGlobalIndices(const Crypto::Hash& transact
     return;
   }
 
-  ioService.post(
+  post("getTransactionOutsGlobalIndices", false,
     std::bind(&InProcessNode::getTransactionOutsGlobalIndicesAsync,
       this,
       std::cref(transactionHash),
@@ -241,7 +295,7 @@ void InProcessNode::getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint
     return;
   }
 
-  ioService.post(
+  post("getRandomOutsByAmounts", false,
     std::bind(&InProcessNode::getRandomOutsByAmountsAsync,
       this,
       std::move(amounts),
@@ -298,7 +352,7 @@ void InProcessNode::relayTransaction(const CryptoNote::Transaction& transaction,
     return;
   }
 
-  ioService.post(
+  post("relayTransaction", true,
     std::bind(&InProcessNode::relayTransactionAsync,
       this,
       transaction,
@@ -460,6 +514,11 @@ void InProcessNode::blockchainSynchronized(uint32_t topHeight) {
 
 void InProcessNode::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks,
   uint32_t& startHeight, const Callback& callback) {
+  queryBlocks(std::move(knownBlockIds), timestamp, 0, 0, newBlocks, startHeight, callback);
+}
+
+void InProcessNode::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
+  std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) {
   std::unique_lock<std::mutex> lock(mutex);
   if (state != INITIALIZED) {
     lock.unlock();
@@ -467,11 +526,13 @@ void InProcessNode::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint6
     return;
   }
 
-  ioService.post(
+  post("queryBlocks", false,
           std::bind(&InProcessNode::queryBlocksLiteAsync,
                   this,
                   std::move(knownBlockIds),
                   timestamp,
+                  maxBlockCount,
+                  maxResponseSize,
                   std::ref(newBlocks),
                   std::ref(startHeight),
                   callback
@@ -479,17 +540,18 @@ void InProcessNode::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint6
   );
 }
 
-void InProcessNode::queryBlocksLiteAsync(std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight,
-                         const Callback& callback) {
-  std::error_code ec = doQueryBlocksLite(std::move(knownBlockIds), timestamp, newBlocks, startHeight);
+void InProcessNode::queryBlocksLiteAsync(std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
+                         std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) {
+  std::error_code ec = doQueryBlocksLite(std::move(knownBlockIds), timestamp, maxBlockCount, maxResponseSize, newBlocks, startHeight);
   callback(ec);
 }
 
-std::error_code InProcessNode::doQueryBlocksLite(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight) {
+std::error_code InProcessNode::doQueryBlocksLite(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
+  std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight) {
   uint32_t currentHeight, fullOffset;
   std::vector<CryptoNote::BlockShortInfo> entries;
 
-  if (!core.queryBlocksLite(knownBlockIds, timestamp, startHeight, currentHeight, fullOffset, entries)) {
+  if (!core.queryBlocksLite(knownBlockIds, timestamp, maxBlockCount, maxResponseSize, true, startHeight, currentHeight, fullOffset, entries)) {
     return make_error_code(CryptoNote::error::INTERNAL_NODE_ERROR);
   }
 
@@ -500,15 +562,17 @@ std::error_code InProcessNode::doQueryBlocksLite(std::vector<Crypto::Hash>&& kno
 
     if (!entry.block.empty()) {
       bse.hasBlock = true;
-      if (!fromBinaryArray(bse.block, asBinaryArray(entry.block))) {
+      if (!decodeBlock(entry.block.data(), entry.block.size(), bse.block)) {
         return std::make_error_code(std::errc::invalid_argument);
       }
+      bse.baseTransactionGlobalIndexes = entry.baseTransactionGlobalIndexes;
     }
 
     for (const auto& tsi: entry.txPrefixes) {
       TransactionShortInfo tpi;
       tpi.txId = tsi.txHash;
       tpi.txPrefix = tsi.txPrefix;
+      tpi.globalIndexes = tsi.globalIndexes;
 
       bse.txsShortInfo.push_back(std::move(tpi));
     }
@@ -529,7 +593,7 @@ void InProcessNode::getPoolSymmetricDifference(std::vector<Crypto::Hash>&& known
     return;
   }
 
-  ioService.post([this, knownPoolTxIds, knownBlockId, &isBcActual, &newTxs, &deletedTxIds, callback] () mutable {
+  post("getPoolSymmetricDifference", true, [this, knownPoolTxIds, knownBlockId, &isBcActual, &newTxs, &deletedTxIds, callback] () mutable {
     this->getPoolSymmetricDifferenceAsync(std::move(knownPoolTxIds), knownBlockId, isBcActual, newTxs, deletedTxIds, callback);
   });
 }
@@ -539,11 +603,19 @@ void InProcessNode::getPoolSymmetricDifferenceAsync(std::vector<Crypto::Hash>&&
   std::error_code ec = std::error_code();
 
   std::vector<TransactionPrefixInfo> added;
-  isBcActual = core.getPoolChangesLite(knownBlockId, knownPoolTxIds, added, deletedTxIds);
+  PoolVersion poolVersion;
+  isBcActual = core.getPoolChangesLite(knownBlockId, knownPoolTxIds, poolChangesCursor.position(knownPoolTxIds), added, deletedTxIds, poolVersion);
 
   try {
+    std::vector<Crypto::Hash> addedTxIds;
+    addedTxIds.reserve(added.size());
     for (const auto& tx: added) {
       newTxs.push_back(createTransactionPrefix(tx.txPrefix, tx.txHash));
+      addedTxIds.push_back(tx.txHash);
+    }
+
+    if (isBcActual) {
+      poolChangesCursor.advance(knownPoolTxIds, addedTxIds, deletedTxIds, poolVersion);
     }
   } catch (std::system_error& ex) {
     ec = ex.code();
@@ -562,7 +634,7 @@ void InProcessNode::getMultisignatureOutputByGlobalIndex(uint64_t amount, uint32
     return;
   }
 
-  ioService.post([this, amount, gindex, &out, callback]() mutable {
+  post("getMultisignatureOutputByGlobalIndex", false, [this, amount, gindex, &out, callback]() mutable {
     this->getOutByMSigGIndexAsync(amount, gindex, out, callback);
   });
 }
@@ -587,7 +659,7 @@ void InProcessNode::getBlocks(const std::vector<uint32_t>& blockHeights, std::ve
     return;
   }
 
-  ioService.post(
+  post("getBlocks", false,
     std::bind(
       static_cast<
         void(InProcessNode::*)(
@@ -671,7 +743,7 @@ void InProcessNode::getBlocks(const std::vector<Crypto::Hash>& blockHashes, std:
     return;
   }
 
-  ioService.post(
+  post("getBlocks", false,
     std::bind(
       static_cast<
         void(InProcessNode::*)(
@@ -734,7 +806,7 @@ void InProcessNode::getBlocks(uint64_t timestampBegin, uint64_t timestampEnd, ui
     return;
   }
 
-  ioService.post(
+  post("getBlocks", false,
     std::bind(
       static_cast<
         void(InProcessNode::*)(
@@ -810,7 +882,7 @@ void InProcessNode::getTransactions(const std::vector<Crypto::Hash>& transaction
     return;
   }
 
-  ioService.post(
+  post("getTransactions", false,
     std::bind(
       static_cast<
         void(InProcessNode::*)(
@@ -875,7 +947,7 @@ void InProcessNode::getPoolTransactions(uint64_t timestampBegin, uint64_t timest
     return;
   }
 
-  ioService.post(
+  post("getPoolTransactions", false,
     std::bind(
       &InProcessNode::getPoolTransactionsAsync,
       this,
@@ -934,7 +1006,7 @@ void InProcessNode::getTransactionsByPaymentId(const Crypto::Hash& paymentId, st
     return;
   }
 
-  ioService.post(
+  post("getTransactionsByPaymentId", false,
     std::bind(
       &InProcessNode::getTransactionsByPaymentIdAsync,
       this,
@@ -955,7 +1027,7 @@ void InProcessNode::getTransaction(const Crypto::Hash &transactionHash, CryptoNo
     return;
   }
 
-  ioService.post(
+  post("getTransaction", false,
       std::bind(
           static_cast<
               void (InProcessNode::*)(
@@ -1050,7 +1122,7 @@ void InProcessNode::isSynchronized(bool& syncStatus, const Callback& callback) {
     return;
   }
 
-  ioService.post(
+  post("isSynchronized", false,
     std::bind(
       &InProcessNode::isSynchronizedAsync,
       this,
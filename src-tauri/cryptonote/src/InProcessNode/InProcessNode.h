@@ -27,15 +27,24 @@
 #include "BlockchainExplorer/BlockchainExplorerDataBuilder.h"
 
 #include <thread>
+#include <vector>
 #include <boost/asio.hpp>
 
 namespace CryptoNote {
 
 class core;
 
+// A wallet's own node is best run on a core built with blockchainIndexesEnabled == false: blocks below
+// the last checkpoint are then appended without ring signature checks and without the explorer indices,
+// so getTransactionsByPaymentId, getBlocksByTimestamp and orphan lookups have nothing to answer from.
+//
+// Requests run on a pool of worker threads against the core, which takes its own locks. Transaction
+// relays and pool polls are the exception: they run one at a time in the order they were made, so
+// a wallet's dependent transactions reach the pool in order and the pool changes cursor has one user.
 class InProcessNode : public INode, public CryptoNote::ICryptoNoteProtocolObserver, public CryptoNote::ICoreObserver {
 public:
-  InProcessNode(CryptoNote::ICore& core, CryptoNote::ICryptoNoteProtocolQuery& protocol);
+  // workerThreads == 0 uses all cores, 1 serves every request in order on one thread
+  InProcessNode(CryptoNote::ICore& core, CryptoNote::ICryptoNoteProtocolQuery& protocol, size_t workerThreads = 0);
 
   InProcessNode(const InProcessNode&) = delete;
   InProcessNode(InProcessNode&&) = delete;
@@ -65,6 +74,8 @@ public:
   virtual void relayTransaction(const CryptoNote::Transaction& transaction, const Callback& callback) override;
   virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks,
     uint32_t& startHeight, const Callback& callback) override;
+  virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
+    std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds, const Callback& callback) override;
   virtual void getMultisignatureOutputByGlobalIndex(uint64_t amount, uint32_t gindex, MultisignatureOutput& out, const Callback& callback) override;
@@ -100,9 +111,10 @@ private:
   void relayTransactionAsync(const CryptoNote::Transaction& transaction, const Callback& callback);
   std::error_code doRelayTransaction(const CryptoNote::Transaction& transaction);
 
-  void queryBlocksLiteAsync(std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight,
-          const Callback& callback);
-  std::error_code doQueryBlocksLite(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight);
+  void queryBlocksLiteAsync(std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
+          std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback);
+  std::error_code doQueryBlocksLite(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
+          std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight);
 
   void getPoolSymmetricDifferenceAsync(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds, const Callback& callback);
@@ -135,6 +147,9 @@ private:
   void workerFunc();
   bool doShutdown();
 
+  // queues a request for the workers, or behind the other ordered requests; method labels its latency
+  template <typename Handler> void post(const char* method, bool ordered, Handler&& handler);
+
   enum State {
     NOT_INITIALIZED,
     INITIALIZED
@@ -145,11 +160,15 @@ private:
   CryptoNote::ICryptoNoteProtocolQuery& protocol;
   Tools::ObserverManager<INodeObserver> observerManager;
 
+  const size_t workerCount;
   boost::asio::io_service ioService;
-  std::unique_ptr<std::thread> workerThread;
+  boost::asio::io_service::strand orderedRequests;
+  std::vector<std::thread> workerThreads;
   std::unique_ptr<boost::asio::io_service::work> work;
 
   BlockchainExplorerDataBuilder blockchainExplorerDataBuilder;
+  // only used by pool polls, which run in orderedRequests
+  PoolChangesCursor poolChangesCursor;
 
   mutable std::mutex mutex;
 };
@@ -0,0 +1,189 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "AsyncLogger.h"
+#include <chrono>
+#include <sstream>
+
+namespace Logging {
+
+namespace {
+
+size_t roundUpToPowerOfTwo(size_t value) {
+  size_t result = 2;
+  while (result < value) {
+    result <<= 1;
+  }
+
+  return result;
+}
+
+}
+
+AsyncLogger::AsyncLogger(ILogger& logger, size_t capacity, OverflowPolicy policy) :
+  logger(logger),
+  policy(policy),
+  mask(roundUpToPowerOfTwo(capacity) - 1),
+  cells(new Cell[mask + 1]),
+  enqueuePosition(0),
+  dequeuePosition(0),
+  droppedCount(0),
+  writtenCount(0),
+  queuedCount(0),
+  writerWaiting(false),
+  stopped(false) {
+  for (size_t i = 0; i <= mask; ++i) {
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  writer = std::thread([this] { writerProcedure(); });
+}
+
+AsyncLogger::~AsyncLogger() {
+  stopped = true;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    hasWork.notify_one();
+  }
+
+  writer.join();
+}
+
+void AsyncLogger::operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) {
+  Record record{ category, level, time, body };
+
+  while (!tryPush(record)) {
+    if (policy == OverflowPolicy::DROP) {
+      ++droppedCount;
+      return;
+    }
+
+    wakeWriter();
+    std::this_thread::yield();
+  }
+
+  ++queuedCount;
+  // pairs with the fence in writerProcedure, so either the writer sees the record or we see it waiting
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (writerWaiting.load(std::memory_order_relaxed)) {
+    wakeWriter();
+  }
+}
+
+bool AsyncLogger::isEnabled(Level level, const std::string& category) const {
+  return logger.isEnabled(level, category);
+}
+
+void AsyncLogger::flush() {
+  uint64_t target = queuedCount.load();
+  wakeWriter();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  hasWritten.wait(lock, [this, target] { return writtenCount.load() >= target; });
+}
+
+uint64_t AsyncLogger::getDroppedCount() const {
+  return droppedCount.load();
+}
+
+// bounded queue of D. Vyukov: a cell's sequence tells whether it is free for the producer
+// that claims its position or holds a record for the single consumer
+bool AsyncLogger::tryPush(Record& record) {
+  size_t position = enqueuePosition.load(std::memory_order_relaxed);
+  Cell* cell;
+
+  for (;;) {
+    cell = &cells[position & mask];
+    size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+    if (difference == 0) {
+      if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (difference < 0) {
+      return false;
+    } else {
+      position = enqueuePosition.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->record = std::move(record);
+  cell->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+bool AsyncLogger::tryPop(Record& record) {
+  size_t position = dequeuePosition.load(std::memory_order_relaxed);
+  Cell& cell = cells[position & mask];
+  if (cell.sequence.load(std::memory_order_acquire) != position + 1) {
+    return false;
+  }
+
+  record = std::move(cell.record);
+  cell.sequence.store(position + mask + 1, std::memory_order_release);
+  dequeuePosition.store(position + 1, std::memory_order_relaxed);
+  return true;
+}
+
+bool AsyncLogger::empty() const {
+  size_t position = dequeuePosition.load(std::memory_order_relaxed);
+  return cells[position & mask].sequence.load(std::memory_order_acquire) != position + 1;
+}
+
+void AsyncLogger::wakeWriter() {
+  std::lock_guard<std::mutex> lock(mutex);
+  hasWork.notify_one();
+}
+
+void AsyncLogger::writerProcedure() {
+  uint64_t reportedDrops = 0;
+  Record record;
+
+  for (;;) {
+    bool wrote = false;
+    while (tryPop(record)) {
+      logger(record.category, record.level, record.time, record.body);
+      ++writtenCount;
+      wrote = true;
+    }
+
+    uint64_t drops = droppedCount.load();
+    if (drops != reportedDrops) {
+      std::ostringstream message;
+      message << YELLOW << (drops - reportedDrops) << " log messages dropped, the log queue is full" << std::endl;
+      logger("AsyncLogger", WARNING, boost::posix_time::microsec_clock::local_time(), message.str());
+      reportedDrops = drops;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (wrote) {
+      hasWritten.notify_all();
+    }
+
+    if (stopped && empty()) {
+      break;
+    }
+
+    writerWaiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // the timeout only bounds the delay of a wake-up lost to a producer blocked on a full queue
+    hasWork.wait_for(lock, std::chrono::milliseconds(100), [this] { return stopped || !empty(); });
+    writerWaiting.store(false, std::memory_order_relaxed);
+  }
+}
+
+}
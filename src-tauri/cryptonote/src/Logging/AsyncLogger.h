@@ -0,0 +1,91 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ILogger.h"
+
+namespace Logging {
+
+// Hands messages over to a background thread that writes them to the wrapped logger, so the
+// caller only pays for copying the message into a bounded ring buffer. Producers never take a
+// lock; when the buffer is full a message is either dropped or the caller waits for free space.
+class AsyncLogger : public ILogger {
+public:
+  enum class OverflowPolicy {
+    BLOCK,
+    DROP
+  };
+
+  // capacity is rounded up to a power of two
+  AsyncLogger(ILogger& logger, size_t capacity = 8192, OverflowPolicy policy = OverflowPolicy::BLOCK);
+  ~AsyncLogger();
+
+  AsyncLogger(const AsyncLogger&) = delete;
+  AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+  virtual void operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) override;
+  virtual bool isEnabled(Level level, const std::string& category) const override;
+
+  // blocks until every message queued so far has been written
+  void flush();
+  uint64_t getDroppedCount() const;
+
+private:
+  struct Record {
+    std::string category;
+    Level level;
+    boost::posix_time::ptime time;
+    std::string body;
+  };
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    Record record;
+  };
+
+  bool tryPush(Record& record);
+  bool tryPop(Record& record);
+  bool empty() const;
+  void wakeWriter();
+  void writerProcedure();
+
+  ILogger& logger;
+  const OverflowPolicy policy;
+  const size_t mask;
+  std::unique_ptr<Cell[]> cells;
+  std::atomic<size_t> enqueuePosition;
+  std::atomic<size_t> dequeuePosition;
+
+  std::atomic<uint64_t> droppedCount;
+  std::atomic<uint64_t> writtenCount;
+  std::atomic<uint64_t> queuedCount;
+  std::atomic<bool> writerWaiting;
+  std::atomic<bool> stopped;
+  std::mutex mutex;
+  std::condition_variable hasWork;
+  std::condition_variable hasWritten;
+  std::thread writer;
+};
+
+}
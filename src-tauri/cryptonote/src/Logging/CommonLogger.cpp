@@ -74,6 +74,10 @@ void CommonLogger::operator()(const std::string& category, Level level, boost::p
   }
 }
 
+bool CommonLogger::isEnabled(Level level, const std::string& category) const {
+  return level <= logLevel && disabledCategories.count(category) == 0;
+}
+
 void CommonLogger::setPattern(const std::string& pattern) {
   this->pattern = pattern;
 }
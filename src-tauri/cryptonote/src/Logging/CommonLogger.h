@@ -26,6 +26,7 @@ class CommonLogger : public ILogger {
 public:
 
   virtual void operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) override;
+  virtual bool isEnabled(Level level, const std::string& category) const override;
   virtual void enableCategory(const std::string& category);
   virtual void disableCategory(const std::string& category);
   virtual void setMaxLevel(Level level);
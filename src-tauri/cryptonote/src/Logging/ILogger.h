@@ -57,6 +57,8 @@ public:
   const static std::array<std::string, 6> LEVEL_NAMES;
 
   virtual void operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) = 0;
+  // lets LoggerMessage skip formatting of messages nobody would write
+  virtual bool isEnabled(Level level, const std::string& category) const { return true; }
 };
 
 #ifndef ENDL
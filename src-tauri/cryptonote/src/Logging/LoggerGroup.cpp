@@ -31,6 +31,14 @@ void LoggerGroup::removeLogger(ILogger& logger) {
   loggers.erase(std::remove(loggers.begin(), loggers.end(), &logger), loggers.end());
 }
 
+bool LoggerGroup::isEnabled(Level level, const std::string& category) const {
+  if (!CommonLogger::isEnabled(level, category)) {
+    return false;
+  }
+
+  return std::any_of(loggers.begin(), loggers.end(), [&](const ILogger* logger) { return logger->isEnabled(level, category); });
+}
+
 void LoggerGroup::operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) {
   if (level <= logLevel && disabledCategories.count(category) == 0) {
     for (auto& logger : loggers) {
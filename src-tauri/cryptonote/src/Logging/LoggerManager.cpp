@@ -32,8 +32,14 @@ void LoggerManager::operator()(const std::string& category, Level level, boost::
   LoggerGroup::operator()(category, level, time, body);
 }
 
+bool LoggerManager::isEnabled(Level level, const std::string& category) const {
+  std::unique_lock<std::mutex> lock(reconfigureLock);
+  return LoggerGroup::isEnabled(level, category);
+}
+
 void LoggerManager::configure(const JsonValue& val) {
   std::unique_lock<std::mutex> lock(reconfigureLock);
+  asyncLoggers.clear();
   loggers.clear();
   LoggerGroup::loggers.clear();
   Level globalLevel;
@@ -110,7 +116,30 @@ void LoggerManager::configure(const JsonValue& val) {
         }
 
         loggers.emplace_back(std::move(logger));
-        addLogger(*loggers.back());
+
+        // "async": write on a background thread, "queueSize" bounds the messages in flight and
+        // "overflow" chooses between "block" (default) and "drop" when the queue is full
+        if (loggerConfiguration.contains("async") && loggerConfiguration("async").getBool()) {
+          size_t queueSize = 8192;
+          if (loggerConfiguration.contains("queueSize")) {
+            queueSize = static_cast<size_t>(loggerConfiguration("queueSize").getInteger());
+          }
+
+          auto policy = AsyncLogger::OverflowPolicy::BLOCK;
+          if (loggerConfiguration.contains("overflow")) {
+            std::string overflow = loggerConfiguration("overflow").getString();
+            if (overflow == "drop") {
+              policy = AsyncLogger::OverflowPolicy::DROP;
+            } else if (overflow != "block") {
+              throw std::runtime_error("Unknown logger overflow policy: " + overflow);
+            }
+          }
+
+          asyncLoggers.emplace_back(new AsyncLogger(*loggers.back(), queueSize, policy));
+          addLogger(*asyncLoggers.back());
+        } else {
+          addLogger(*loggers.back());
+        }
       }
     } else {
       throw std::runtime_error("loggers parameter has wrong type");
@@ -21,6 +21,7 @@
 #include <memory>
 #include <mutex>
 #include "../Common/JsonValue.h"
+#include "AsyncLogger.h"
 #include "LoggerGroup.h"
 
 namespace Logging {
@@ -30,10 +31,13 @@ public:
   LoggerManager();
   void configure(const Common::JsonValue& val);
   virtual void operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) override;
+  virtual bool isEnabled(Level level, const std::string& category) const override;
 
 private:
   std::vector<std::unique_ptr<CommonLogger>> loggers;
-  std::mutex reconfigureLock;
+  // declared after loggers so that they drain into them before the loggers are destroyed
+  std::vector<std::unique_ptr<AsyncLogger>> asyncLoggers;
+  mutable std::mutex reconfigureLock;
 };
 
 }
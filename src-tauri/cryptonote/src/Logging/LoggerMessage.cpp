@@ -26,8 +26,13 @@ LoggerMessage::LoggerMessage(ILogger& logger, const std::string& category, Level
   , category(category)
   , logLevel(level)
   , message(color)
-  , timestamp(boost::posix_time::microsec_clock::local_time())
   , gotText(false) {
+  // a filtered message leaves the stream failed, so operator<< returns before formatting anything
+  if (logger.isEnabled(level, category)) {
+    timestamp = boost::posix_time::microsec_clock::local_time();
+  } else {
+    setstate(std::ios::badbit);
+  }
 }
 
 LoggerMessage::~LoggerMessage() {
@@ -27,11 +27,19 @@
 #include "Rpc/JsonRpc.h"
 #include "Rpc/HttpClient.h"
 
+namespace {
+
+// the daemon answers a waitforblock by this time at the latest, then it is sent again
+const uint32_t LONG_POLL_TIMEOUT = 60; // seconds
+
+}
+
 BlockchainMonitor::BlockchainMonitor(System::Dispatcher& dispatcher, const std::string& daemonHost, uint16_t daemonPort, size_t pollingInterval, Logging::ILogger& logger):
   m_dispatcher(dispatcher),
   m_daemonHost(daemonHost),
   m_daemonPort(daemonPort),
   m_pollingInterval(pollingInterval),
+  m_longPolling(true),
   m_stopped(false),
   m_httpEvent(dispatcher),
   m_sleepingContext(dispatcher),
@@ -47,14 +55,39 @@ void BlockchainMonitor::waitBlockchainUpdate() {
   Crypto::Hash lastBlockHash = requestLastBlockHash();
 
   while(!m_stopped) {
-    m_sleepingContext.spawn([this] () {
+    bool notified = false;
+    Crypto::Hash blockHash = lastBlockHash;
+    m_sleepingContext.spawn([this, &notified, &blockHash] () {
+      if (m_longPolling) {
+        try {
+          blockHash = waitForBlock(blockHash);
+          notified = true;
+          return;
+        } catch (System::InterruptedException&) {
+          return;
+        } catch (CryptoNote::JsonRpc::JsonRpcError& e) {
+          if (e.code == CryptoNote::JsonRpc::errMethodNotFound) {
+            m_logger(Logging::INFO) << "Daemon doesn't support waitforblock, polling it every " << m_pollingInterval << " seconds";
+            m_longPolling = false;
+          }
+        } catch (std::exception&) {
+        }
+      }
+
       System::Timer timer(m_dispatcher);
       timer.sleep(std::chrono::seconds(m_pollingInterval));
     });
 
     m_sleepingContext.wait();
+    if (m_stopped) {
+      break;
+    }
 
-    if (lastBlockHash != requestLastBlockHash()) {
+    if (!notified) {
+      blockHash = requestLastBlockHash();
+    }
+
+    if (lastBlockHash != blockHash) {
       m_logger(Logging::DEBUGGING) << "Blockchain has been updated";
       break;
     }
@@ -74,6 +107,40 @@ void BlockchainMonitor::stop() {
   m_sleepingContext.wait();
 }
 
+// Returns when the daemon's top block differs from lastBlockHash, or with lastBlockHash itself once
+// the long poll times out
+Crypto::Hash BlockchainMonitor::waitForBlock(const Crypto::Hash& lastBlockHash) {
+  m_logger(Logging::DEBUGGING) << "Waiting for a block on top of " << Common::podToHex(lastBlockHash);
+
+  try {
+    CryptoNote::HttpClient client(m_dispatcher, m_daemonHost, m_daemonPort);
+
+    CryptoNote::COMMAND_RPC_WAIT_FOR_BLOCK::request request;
+    request.prev_hash = Common::podToHex(lastBlockHash);
+    request.timeout = LONG_POLL_TIMEOUT;
+    CryptoNote::COMMAND_RPC_WAIT_FOR_BLOCK::response response;
+
+    System::EventLock lk(m_httpEvent);
+    CryptoNote::JsonRpc::invokeJsonRpcCommand(client, "waitforblock", request, response);
+
+    if (response.status != CORE_RPC_STATUS_OK) {
+      throw std::runtime_error("Core responded with wrong status: " + response.status);
+    }
+
+    Crypto::Hash blockHash;
+    if (!Common::podFromHex(response.hash, blockHash)) {
+      throw std::runtime_error("Couldn't parse block hash: " + response.hash);
+    }
+
+    return blockHash;
+  } catch (System::InterruptedException&) {
+    throw;
+  } catch (std::exception& e) {
+    m_logger(Logging::DEBUGGING) << "Failed to wait for a block: " << e.what();
+    throw;
+  }
+}
+
 Crypto::Hash BlockchainMonitor::requestLastBlockHash() {
   m_logger(Logging::DEBUGGING) << "Requesting last block hash";
 
@@ -36,6 +36,8 @@ private:
   std::string m_daemonHost;
   uint16_t m_daemonPort;
   size_t m_pollingInterval;
+  // cleared when the daemon doesn't know waitforblock, polling getlastblockheader instead
+  bool m_longPolling;
   bool m_stopped;
   System::Event m_httpEvent;
   System::ContextGroup m_sleepingContext;
@@ -43,4 +45,5 @@ private:
   Logging::LoggerRef m_logger;
 
   Crypto::Hash requestLastBlockHash();
+  Crypto::Hash waitForBlock(const Crypto::Hash& lastBlockHash);
 };
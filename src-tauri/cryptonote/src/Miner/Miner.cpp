@@ -17,7 +17,18 @@
 
 #include "Miner.h"
 
+#include <chrono>
+#include <cstring>
 #include <functional>
+#include <limits>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #include "crypto/crypto.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
@@ -26,10 +37,41 @@
 
 namespace CryptoNote {
 
+namespace {
+
+bool pinCurrentThread(size_t workerIndex) {
+  unsigned cores = std::thread::hardware_concurrency();
+  if (cores == 0) {
+    return false;
+  }
+
+  size_t cpu = workerIndex % cores;
+#if defined(_WIN32)
+  if (cpu >= sizeof(DWORD_PTR) * 8) {
+    return false;
+  }
+
+  return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#elif defined(__linux__)
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(cpu, &cpuSet);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+  //no hard affinity on this platform, leave placement to the scheduler
+  return false;
+#endif
+}
+
+}
+
 Miner::Miner(System::Dispatcher& dispatcher, Logging::ILogger& logger) :
   m_dispatcher(dispatcher),
   m_miningStopped(dispatcher),
   m_state(MiningState::MINING_STOPPED),
+  m_hashCount(0),
+  m_activeThreadCount(std::numeric_limits<size_t>::max()),
+  m_pinThreads(false),
   m_logger(logger, "Miner") {
 }
 
@@ -70,6 +112,18 @@ void Miner::stop() {
   }
 }
 
+void Miner::setPinThreads(bool pinThreads) {
+  m_pinThreads = pinThreads;
+}
+
+uint64_t Miner::getHashCount() const {
+  return m_hashCount.load(std::memory_order_relaxed);
+}
+
+void Miner::setActiveThreadCount(size_t count) {
+  m_activeThreadCount.store(count, std::memory_order_relaxed);
+}
+
 void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount) {
   assert(threadCount > 0);
 
@@ -78,9 +132,22 @@ void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threa
   try {
     blockMiningParameters.blockTemplate.nonce = Crypto::rand<uint32_t>();
 
+    // serialized once per template, the workers only patch the nonce into their copies
+    BinaryArray blob;
+    size_t nonceOffset;
+    if (!get_block_longhash_blob(blockMiningParameters.blockTemplate, blob, nonceOffset)) {
+      throw std::runtime_error("Couldn't serialize the block template");
+    }
+
+    // Reserve every worker's scratchpads in one go so huge pages are claimed before the threads race for them
+    size_t pads = threadCount * get_block_longhash_batch_size(blockMiningParameters.blockTemplate, threadCount);
+    if (Crypto::slow_hash_pool_reserve(pads) == 0) {
+      m_logger(Logging::DEBUGGING) << "couldn't reserve a scratchpad pool, mining threads will allocate their own";
+    }
+
     for (size_t i = 0; i < threadCount; ++i) {
       m_workers.emplace_back(std::unique_ptr<System::RemoteContext<void>> (
-        new System::RemoteContext<void>(m_dispatcher, std::bind(&Miner::workerFunc, this, blockMiningParameters.blockTemplate, blockMiningParameters.difficulty, threadCount)))
+        new System::RemoteContext<void>(m_dispatcher, std::bind(&Miner::workerFunc, this, blockMiningParameters.blockTemplate, blob, nonceOffset, blockMiningParameters.difficulty, static_cast<uint32_t>(threadCount), i)))
       );
 
       blockMiningParameters.blockTemplate.nonce++;
@@ -96,38 +163,78 @@ void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threa
   m_miningStopped.set();
 }
 
-void Miner::workerFunc(const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep) {
+void Miner::workerFunc(const Block& blockTemplate, const BinaryArray& blob, size_t nonceOffset, difficulty_type difficulty, uint32_t nonceStep, size_t workerIndex) {
+  if (m_pinThreads && !pinCurrentThread(workerIndex)) {
+    m_logger(Logging::DEBUGGING) << "couldn't pin mining thread " << workerIndex;
+  }
+
+  //the scratchpad is thread local, take it once here rather than lazily inside the first hash
+  Crypto::slow_hash_allocate_state();
+
   try {
-    Block block = blockTemplate;
+    //nonceStep is the worker count, the batch sizing needs it to share the cache fairly
+    size_t batchSize = get_block_longhash_batch_size(blockTemplate, nonceStep);
+    std::vector<Crypto::Hash> hashes(batchSize);
+    std::vector<uint32_t> nonces(batchSize);
+    for (size_t i = 0; i < batchSize; ++i) {
+      nonces[i] = blockTemplate.nonce + static_cast<uint32_t>(i) * nonceStep;
+    }
+
+    //one copy of the blob per hash of a batch, back to back as the batched hash takes them
+    const size_t blobSize = blob.size();
+    BinaryArray blobs;
+    blobs.reserve(blobSize * batchSize);
+    for (size_t i = 0; i < batchSize; ++i) {
+      blobs.insert(blobs.end(), blob.begin(), blob.end());
+    }
+
     Crypto::cn_context cryptoContext;
 
     while (m_state == MiningState::MINING_IN_PROGRESS) {
-      Crypto::Hash hash;
-      if (!get_block_longhash(cryptoContext, block, hash)) {
-        //error occured
-        m_logger(Logging::DEBUGGING) << "calculating long hash error occured";
-        m_state = MiningState::MINING_STOPPED;
-        return;
+      //an idle worker's nonces are simply never tried, the search doesn't need them
+      if (workerIndex >= m_activeThreadCount.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        continue;
       }
 
-      if (check_hash(hash, difficulty)) {
+      for (size_t i = 0; i < batchSize; ++i) {
+        memcpy(blobs.data() + i * blobSize + nonceOffset, &nonces[i], sizeof(nonces[i]));
+      }
+
+      get_block_longhash_from_blobs(cryptoContext, blockTemplate, blobs.data(), blobSize, batchSize, hashes.data());
+      m_hashCount.fetch_add(batchSize, std::memory_order_relaxed);
+
+      size_t found = batchSize;
+      for (size_t i = 0; i < batchSize; ++i) {
+        if (check_hash(hashes[i], difficulty)) {
+          found = i;
+          break;
+        }
+      }
+
+      if (found != batchSize) {
         m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
 
         if (!setStateBlockFound()) {
           m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
-          return;
+          break;
         }
 
-        m_block = block;
-        return;
+        m_block = blockTemplate;
+        m_block.nonce = nonces[found];
+        break;
       }
 
-      block.nonce += nonceStep;
+      for (uint32_t& nonce : nonces) {
+        nonce += static_cast<uint32_t>(batchSize) * nonceStep;
+      }
     }
   } catch (std::exception& e) {
     m_logger(Logging::ERROR) << "Miner got error: " << e.what();
     m_state = MiningState::MINING_STOPPED;
   }
+
+  Crypto::slow_hash_free_state();
 }
 
 bool Miner::setStateBlockFound() {
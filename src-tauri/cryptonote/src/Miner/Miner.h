@@ -46,12 +46,23 @@ public:
   //NOTE! this is blocking method
   void stop();
 
+  // Pins worker N to logical CPU N modulo the core count. Takes effect on the next mine() call
+  void setPinThreads(bool pinThreads);
+  // Hashes computed by all workers since construction
+  uint64_t getHashCount() const;
+  // Workers at or past count idle until it is raised again, 0 parks them all. Safe from any thread,
+  // a running mine() picks it up after the current batch
+  void setActiveThreadCount(size_t count);
+
 private:
   System::Dispatcher& m_dispatcher;
   System::Event m_miningStopped;
 
   enum class MiningState : uint8_t { MINING_STOPPED, BLOCK_FOUND, MINING_IN_PROGRESS};
   std::atomic<MiningState> m_state;
+  std::atomic<uint64_t> m_hashCount;
+  std::atomic<size_t> m_activeThreadCount;
+  bool m_pinThreads;
 
   std::vector<std::unique_ptr<System::RemoteContext<void>>>  m_workers;
 
@@ -60,7 +71,7 @@ private:
   Logging::LoggerRef m_logger;
 
   void runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount);
-  void workerFunc(const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep);
+  void workerFunc(const Block& blockTemplate, const BinaryArray& blob, size_t nonceOffset, difficulty_type difficulty, uint32_t nonceStep, size_t workerIndex);
   bool setStateBlockFound();
 };
 
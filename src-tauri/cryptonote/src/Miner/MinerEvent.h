@@ -21,6 +21,7 @@ namespace Miner {
 enum class MinerEventType: uint8_t {
   BLOCK_MINED,
   BLOCKCHAIN_UPDATED,
+  STOP_REQUESTED,
 };
 
 struct MinerEvent {
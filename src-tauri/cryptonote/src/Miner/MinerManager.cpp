@@ -48,6 +48,12 @@ MinerEvent BlockchainUpdatedEvent() {
   return event;
 }
 
+MinerEvent StopRequestedEvent() {
+  MinerEvent event;
+  event.type = MinerEventType::STOP_REQUESTED;
+  return event;
+}
+
 void adjustMergeMiningTag(Block& blockTemplate) {
   if (blockTemplate.majorVersion >= BLOCK_MAJOR_VERSION_2) {
     CryptoNote::TransactionExtraMergeMiningTag mmTag;
@@ -74,8 +80,12 @@ MinerManager::MinerManager(System::Dispatcher& dispatcher, const CryptoNote::Min
   m_blockchainMonitor(dispatcher, m_config.daemonHost, m_config.daemonPort, m_config.scanPeriod, logger),
   m_eventOccurred(dispatcher),
   m_httpEvent(dispatcher),
-  m_lastBlockTimestamp(0) {
+  m_lastBlockTimestamp(0),
+  m_stopRequested(false),
+  m_blocksAccepted(0),
+  m_blocksRejected(0) {
 
+  m_miner.setPinThreads(m_config.pinThreads);
   m_httpEvent.set();
 }
 
@@ -86,7 +96,7 @@ void MinerManager::start() {
   m_logger(Logging::DEBUGGING) << "starting";
 
   BlockMiningParameters params;
-  for (;;) {
+  while (!m_stopRequested) {
     m_logger(Logging::INFO) << "requesting mining parameters";
 
     try {
@@ -102,12 +112,37 @@ void MinerManager::start() {
     break;
   }
 
+  if (m_stopRequested) {
+    return;
+  }
+
   startBlockchainMonitoring();
   startMining(params);
 
   eventLoop();
 }
 
+void MinerManager::stop() {
+  m_stopRequested = true;
+  pushEvent(StopRequestedEvent());
+}
+
+uint64_t MinerManager::getHashCount() const {
+  return m_miner.getHashCount();
+}
+
+void MinerManager::setActiveThreadCount(size_t count) {
+  m_miner.setActiveThreadCount(count);
+}
+
+uint64_t MinerManager::getBlocksAccepted() const {
+  return m_blocksAccepted;
+}
+
+uint64_t MinerManager::getBlocksRejected() const {
+  return m_blocksRejected;
+}
+
 void MinerManager::eventLoop() {
   size_t blocksMined = 0;
 
@@ -122,11 +157,14 @@ void MinerManager::eventLoop() {
 
         if (submitBlock(m_minedBlock, m_config.daemonHost, m_config.daemonPort)) {
           m_lastBlockTimestamp = m_minedBlock.timestamp;
+          ++m_blocksAccepted;
 
           if (m_config.blocksLimit != 0 && ++blocksMined == m_config.blocksLimit) {
             m_logger(Logging::INFO) << "Miner mined requested " << m_config.blocksLimit << " blocks. Quitting";
             return;
           }
+        } else {
+          ++m_blocksRejected;
         }
 
         BlockMiningParameters params = requestMiningParameters(m_dispatcher, m_config.daemonHost, m_config.daemonPort, m_config.miningAddress);
@@ -149,6 +187,13 @@ void MinerManager::eventLoop() {
         break;
       }
 
+      case MinerEventType::STOP_REQUESTED: {
+        m_logger(Logging::DEBUGGING) << "got STOP_REQUESTED event";
+        stopMining();
+        stopBlockchainMonitoring();
+        return;
+      }
+
       default:
         assert(false);
         return;
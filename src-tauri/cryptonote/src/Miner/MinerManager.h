@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <queue>
 
 #include <System/ContextGroup.h>
@@ -40,6 +41,14 @@ public:
   ~MinerManager();
 
   void start();
+  //must be called from the dispatcher thread, start() returns once mining has wound down
+  void stop();
+
+  uint64_t getHashCount() const;
+  uint64_t getBlocksAccepted() const;
+  uint64_t getBlocksRejected() const;
+  //safe from any thread, see Miner::setActiveThreadCount
+  void setActiveThreadCount(size_t count);
 
 private:
   System::Dispatcher& m_dispatcher;
@@ -56,6 +65,9 @@ private:
   CryptoNote::Block m_minedBlock;
 
   uint64_t m_lastBlockTimestamp;
+  bool m_stopRequested;
+  std::atomic<uint64_t> m_blocksAccepted;
+  std::atomic<uint64_t> m_blocksRejected;
 
   void eventLoop();
   MinerEvent waitEvent();
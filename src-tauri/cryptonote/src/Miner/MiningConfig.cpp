@@ -63,7 +63,22 @@ void parseDaemonAddress(const std::string& daemonAddress, std::string& daemonHos
 
 }
 
-MiningConfig::MiningConfig(): help(false) {
+MiningConfig::MiningConfig():
+  daemonHost(DEFAULT_DAEMON_HOST),
+  daemonPort(static_cast<uint16_t>(RPC_DEFAULT_PORT)),
+  threadCount(CONCURRENCY_LEVEL),
+  scanPeriod(DEFAULT_SCANT_PERIOD),
+  logLevel(1),
+  blocksLimit(0),
+  firstBlockTimestamp(0),
+  blockTimestampInterval(0),
+  pinThreads(false),
+  help(false) {
+  //options are registered once per process, so the config may be constructed repeatedly
+  if (!cmdOptions.options().empty()) {
+    return;
+  }
+
   cmdOptions.add_options()
       ("help,h", "produce this help message and exit")
       ("address", po::value<std::string>(), "Valid cryptonote miner's address")
@@ -71,12 +86,13 @@ MiningConfig::MiningConfig(): help(false) {
       ("daemon-rpc-port", po::value<uint16_t>()->default_value(static_cast<uint16_t>(RPC_DEFAULT_PORT)), "Daemon's RPC port")
       ("daemon-address", po::value<std::string>(), "Daemon host:port. If you use this option you must not use --daemon-host and --daemon-port options")
       ("threads", po::value<size_t>()->default_value(CONCURRENCY_LEVEL), "Mining threads count. Must not be greater than you concurrency level. Default value is your hardware concurrency level")
-      ("scan-time", po::value<size_t>()->default_value(DEFAULT_SCANT_PERIOD), "Blockchain polling interval (seconds). How often miner will check blockchain for updates")
+      ("scan-time", po::value<size_t>()->default_value(DEFAULT_SCANT_PERIOD), "Blockchain polling interval (seconds), used when the daemon can't notify the miner of new blocks through waitforblock")
       ("log-level", po::value<int>()->default_value(1), "Log level. Must be 0..5")
       ("limit", po::value<size_t>()->default_value(0), "Mine exact quantity of blocks. 0 means no limit")
       ("first-block-timestamp", po::value<uint64_t>()->default_value(0), "Set timestamp to the first mined block. 0 means leave timestamp unchanged")
       ("block-timestamp-interval", po::value<int64_t>()->default_value(0), "Timestamp step for each subsequent block. May be set only if --first-block-timestamp has been set."
-                                                         " If not set blocks' timestamps remain unchanged");
+                                                         " If not set blocks' timestamps remain unchanged")
+      ("pin-threads", po::bool_switch()->default_value(false), "Pin each mining thread to its own CPU core");
 }
 
 void MiningConfig::parse(int argc, char** argv) {
@@ -129,6 +145,7 @@ void MiningConfig::parse(int argc, char** argv) {
 
   firstBlockTimestamp = options["first-block-timestamp"].as<uint64_t>();
   blockTimestampInterval = options["block-timestamp-interval"].as<int64_t>();
+  pinThreads = options["pin-threads"].as<bool>();
 }
 
 void MiningConfig::printHelp() {
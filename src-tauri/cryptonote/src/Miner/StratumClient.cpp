@@ -0,0 +1,592 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "StratumClient.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#include <System/Dispatcher.h>
+#include <System/InterruptedException.h>
+#include <System/Ipv4Address.h>
+#include <System/Ipv4Resolver.h>
+#include <System/TcpConnection.h>
+#include <System/TcpConnectFirst.h>
+#include <System/Timer.h>
+
+#include "Common/JsonValue.h"
+#include "Common/StringTools.h"
+#include "crypto/crypto.h"
+
+using Common::JsonValue;
+
+namespace Miner {
+
+namespace {
+
+const uint64_t LOGIN_REQUEST_ID = 1;
+const size_t MAX_LINE_SIZE = 64 * 1024;
+const size_t MAX_WAYS = 3;
+
+std::string readLine(System::TcpConnection& connection, std::string& buffer) {
+  for (;;) {
+    size_t end = buffer.find('\n');
+    if (end != std::string::npos) {
+      std::string line = buffer.substr(0, end);
+      buffer.erase(0, end + 1);
+      return line;
+    }
+
+    if (buffer.size() > MAX_LINE_SIZE) {
+      throw std::runtime_error("Pool sent an oversized message");
+    }
+
+    uint8_t chunk[4096];
+    size_t size = connection.read(chunk, sizeof(chunk));
+    if (size == 0) {
+      throw std::runtime_error("Pool closed the connection");
+    }
+
+    buffer.append(reinterpret_cast<const char*>(chunk), size);
+  }
+}
+
+void writeLine(System::TcpConnection& connection, const JsonValue& message) {
+  std::string line = message.toString() + "\n";
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(line.data());
+  size_t remaining = line.size();
+  while (remaining > 0) {
+    size_t written = connection.write(data, remaining);
+    data += written;
+    remaining -= written;
+  }
+}
+
+JsonValue makeRequest(uint64_t id, const std::string& method, JsonValue&& params) {
+  JsonValue request(JsonValue::OBJECT);
+  request.insert("id", JsonValue(static_cast<JsonValue::Integer>(id)));
+  request.insert("jsonrpc", "2.0");
+  request.insert("method", JsonValue(method));
+  request.insert("params", std::move(params));
+  return request;
+}
+
+std::string errorMessage(const JsonValue& message) {
+  if (!message.contains("error") || message("error").isNil()) {
+    return std::string();
+  }
+
+  const JsonValue& error = message("error");
+  if (error.isObject() && error.contains("message") && error("message").isString()) {
+    return error("message").getString();
+  }
+
+  return error.toString();
+}
+
+//the nonce follows the varint major version, minor version and timestamp and the previous block hash,
+//for both plain block headers and the parent headers of merge mined blocks
+bool findNonceOffset(const std::vector<uint8_t>& blob, size_t& offset) {
+  size_t position = 0;
+  for (int field = 0; field < 3; ++field) {
+    while (position < blob.size() && (blob[position] & 0x80) != 0) {
+      ++position;
+    }
+
+    if (position >= blob.size()) {
+      return false;
+    }
+
+    ++position;
+  }
+
+  position += sizeof(Crypto::Hash);
+  if (position + sizeof(uint32_t) > blob.size()) {
+    return false;
+  }
+
+  offset = position;
+  return true;
+}
+
+//pools send either a compact 32-bit target or the full 64-bit one, both little endian
+bool parseTarget(const std::string& text, uint64_t& target) {
+  std::vector<uint8_t> data;
+  if (!Common::fromHex(text, data)) {
+    return false;
+  }
+
+  if (data.size() == sizeof(uint32_t)) {
+    uint32_t compact = 0;
+    memcpy(&compact, data.data(), sizeof(compact));
+    if (compact == 0) {
+      return false;
+    }
+
+    target = UINT64_MAX / (UINT32_MAX / compact);
+    return true;
+  }
+
+  if (data.size() == sizeof(uint64_t)) {
+    memcpy(&target, data.data(), sizeof(target));
+    return target != 0;
+  }
+
+  return false;
+}
+
+bool parseAlgorithm(const std::string& algorithm, int& variant, int& light) {
+  static const struct {
+    const char* name;
+    int variant;
+    int light;
+  } algorithms[] = {
+    { "cn/0", 0, 0 }, { "cn/1", 1, 0 }, { "cn/2", 2, 0 },
+    { "cn-lite/0", 0, 1 }, { "cn-lite/1", 1, 1 }, { "cn-lite/2", 2, 1 }
+  };
+
+  for (const auto& entry : algorithms) {
+    if (algorithm == entry.name) {
+      variant = entry.variant;
+      light = entry.light;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool meetsTarget(const Crypto::Hash& hash, uint64_t target) {
+  uint64_t value;
+  memcpy(&value, hash.data + sizeof(hash.data) - sizeof(value), sizeof(value));
+  return value < target;
+}
+
+}
+
+StratumConfig::StratumConfig() :
+  port(0),
+  threadCount(1),
+  reconnectDelay(5),
+  variant(2),
+  light(1) {
+}
+
+bool parseStratumAddress(const std::string& address, std::string& host, uint16_t& port) {
+  std::string rest = address;
+  size_t scheme = rest.find("://");
+  if (scheme != std::string::npos) {
+    rest = rest.substr(scheme + 3);
+  }
+
+  size_t colon = rest.rfind(':');
+  if (colon == std::string::npos) {
+    host = rest;
+    port = 3333;
+  } else {
+    host = rest.substr(0, colon);
+    try {
+      unsigned long value = std::stoul(rest.substr(colon + 1));
+      if (value == 0 || value > UINT16_MAX) {
+        return false;
+      }
+      port = static_cast<uint16_t>(value);
+    } catch (std::exception&) {
+      return false;
+    }
+  }
+
+  return !host.empty();
+}
+
+StratumClient::StratumClient(System::Dispatcher& dispatcher, const StratumConfig& config, Logging::ILogger& logger) :
+  m_dispatcher(dispatcher),
+  m_logger(logger, "StratumClient"),
+  m_config(config),
+  m_contextGroup(dispatcher),
+  m_session(nullptr),
+  m_stopRequested(false),
+  m_workersStopped(false),
+  m_activeThreadCount(std::numeric_limits<size_t>::max()),
+  m_jobSequence(0),
+  m_shareFound(dispatcher),
+  m_nextRequestId(LOGIN_REQUEST_ID + 1),
+  m_hashCount(0),
+  m_sharesAccepted(0),
+  m_sharesRejected(0),
+  m_shareLatencyTotal(0),
+  m_shareLatencyCount(0) {
+
+  if (m_config.threadCount == 0) {
+    m_config.threadCount = 1;
+  }
+}
+
+StratumClient::~StratumClient() {
+}
+
+void StratumClient::start() {
+  m_logger(Logging::DEBUGGING) << "starting";
+
+  size_t ways = Crypto::cn_slow_hash_select_ways(m_config.threadCount, m_config.light);
+  Crypto::slow_hash_pool_reserve(m_config.threadCount * ways);
+
+  m_workersStopped = false;
+  for (size_t i = 0; i < m_config.threadCount; ++i) {
+    m_workers.emplace_back(std::unique_ptr<System::RemoteContext<void>>(
+      new System::RemoteContext<void>(m_dispatcher, std::bind(&StratumClient::workerFunc, this, i)))
+    );
+  }
+
+  m_contextGroup.spawn([this] { connectionLoop(); });
+  m_contextGroup.wait();
+
+  clearJob();
+  m_workersStopped = true;
+  //each worker's share notifications are spawned ahead of its completion notice, so none outlive this
+  m_workers.clear();
+
+  m_logger(Logging::DEBUGGING) << "stopped";
+}
+
+void StratumClient::stop() {
+  m_stopRequested = true;
+  if (m_session != nullptr) {
+    m_session->interrupt();
+  }
+
+  m_contextGroup.interrupt();
+}
+
+uint64_t StratumClient::getHashCount() const {
+  return m_hashCount;
+}
+
+uint64_t StratumClient::getSharesAccepted() const {
+  return m_sharesAccepted;
+}
+
+uint64_t StratumClient::getSharesRejected() const {
+  return m_sharesRejected;
+}
+
+double StratumClient::getShareLatency() const {
+  uint64_t count = m_shareLatencyCount;
+  return count == 0 ? 0.0 : static_cast<double>(m_shareLatencyTotal) / count / 1000.0;
+}
+
+void StratumClient::setActiveThreadCount(size_t count) {
+  m_activeThreadCount.store(count, std::memory_order_relaxed);
+}
+
+void StratumClient::connectionLoop() {
+  while (!m_stopRequested) {
+    try {
+      runSession();
+    } catch (System::InterruptedException&) {
+      break;
+    } catch (std::exception& e) {
+      m_logger(Logging::WARNING) << "Pool session with " << m_config.host << ":" << m_config.port << " ended: " << e.what();
+    }
+
+    clearJob();
+    dropPendingShares();
+    if (m_stopRequested) {
+      break;
+    }
+
+    try {
+      System::Timer timer(m_dispatcher);
+      timer.sleep(std::chrono::seconds(m_config.reconnectDelay));
+    } catch (System::InterruptedException&) {
+      break;
+    }
+  }
+}
+
+void StratumClient::runSession() {
+  m_logger(Logging::INFO) << "connecting to pool " << m_config.host << ":" << m_config.port;
+
+  std::vector<System::Ipv4Address> addresses = System::Ipv4Resolver(m_dispatcher).resolveAll(m_config.host);
+  System::TcpConnection connection = System::connectFirst(m_dispatcher, addresses, m_config.port);
+
+  JsonValue params(JsonValue::OBJECT);
+  params.insert("login", JsonValue(m_config.login));
+  params.insert("pass", JsonValue(m_config.password.empty() ? std::string("x") : m_config.password));
+  params.insert("agent", "fuego-wallet");
+  if (!m_config.rigId.empty()) {
+    params.insert("rigid", JsonValue(m_config.rigId));
+  }
+  writeLine(connection, makeRequest(LOGIN_REQUEST_ID, "login", std::move(params)));
+
+  std::string buffer;
+  for (;;) {
+    JsonValue message = JsonValue::fromString(readLine(connection, buffer));
+    if (!message.contains("id") || !message("id").isInteger() || static_cast<uint64_t>(message("id").getInteger()) != LOGIN_REQUEST_ID) {
+      handleMessage(message);
+      continue;
+    }
+
+    std::string error = errorMessage(message);
+    if (!error.empty()) {
+      throw std::runtime_error("Pool refused login: " + error);
+    }
+
+    const JsonValue& result = message("result");
+    m_sessionId = result.contains("id") && result("id").isString() ? result("id").getString() : std::string();
+    if (result.contains("job")) {
+      setJob(result("job"));
+    }
+    break;
+  }
+
+  m_logger(Logging::INFO) << "logged in to pool " << m_config.host << ":" << m_config.port;
+
+  {
+    //shares found for the previous session's jobs would only be rejected
+    std::lock_guard<std::mutex> lock(m_shareMutex);
+    m_shares.clear();
+  }
+
+  System::ContextGroup session(m_dispatcher);
+  session.spawn([this, &connection, &buffer, &session] {
+    try {
+      readLoop(connection, buffer);
+    } catch (System::InterruptedException&) {
+    } catch (std::exception& e) {
+      m_logger(Logging::WARNING) << "Pool connection lost: " << e.what();
+    }
+    session.interrupt();
+  });
+  session.spawn([this, &connection, &session] {
+    try {
+      writeLoop(connection);
+    } catch (System::InterruptedException&) {
+    } catch (std::exception& e) {
+      m_logger(Logging::WARNING) << "Couldn't submit share: " << e.what();
+    }
+    session.interrupt();
+  });
+
+  m_session = &session;
+  session.wait();
+  m_session = nullptr;
+}
+
+void StratumClient::readLoop(System::TcpConnection& connection, std::string& buffer) {
+  for (;;) {
+    std::string line = readLine(connection, buffer);
+    if (line.empty() || line == "\r") {
+      continue;
+    }
+
+    JsonValue message;
+    try {
+      message = JsonValue::fromString(line);
+    } catch (std::exception&) {
+      m_logger(Logging::WARNING) << "Ignoring malformed pool message";
+      continue;
+    }
+
+    handleMessage(message);
+  }
+}
+
+void StratumClient::writeLoop(System::TcpConnection& connection) {
+  for (;;) {
+    m_shareFound.wait();
+    m_shareFound.clear();
+
+    std::deque<Share> shares;
+    {
+      std::lock_guard<std::mutex> lock(m_shareMutex);
+      shares.swap(m_shares);
+    }
+
+    for (const Share& share : shares) {
+      uint64_t id = m_nextRequestId++;
+
+      JsonValue params(JsonValue::OBJECT);
+      params.insert("id", JsonValue(m_sessionId));
+      params.insert("job_id", JsonValue(share.jobId));
+      params.insert("nonce", JsonValue(Common::toHex(&share.nonce, sizeof(share.nonce))));
+      params.insert("result", JsonValue(Common::podToHex(share.hash)));
+
+      m_pendingShares[id] = std::chrono::steady_clock::now();
+      writeLine(connection, makeRequest(id, "submit", std::move(params)));
+    }
+  }
+}
+
+void StratumClient::handleMessage(const JsonValue& message) {
+  if (!message.isObject()) {
+    return;
+  }
+
+  if (message.contains("method") && message("method").isString()) {
+    if (message("method").getString() == "job" && message.contains("params")) {
+      setJob(message("params"));
+    }
+    return;
+  }
+
+  if (message.contains("id") && message("id").isInteger()) {
+    handleShareResult(static_cast<uint64_t>(message("id").getInteger()), message);
+  }
+}
+
+void StratumClient::handleShareResult(uint64_t id, const JsonValue& message) {
+  auto it = m_pendingShares.find(id);
+  if (it == m_pendingShares.end()) {
+    return;
+  }
+
+  auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - it->second);
+  m_pendingShares.erase(it);
+  m_shareLatencyTotal += static_cast<uint64_t>(latency.count());
+  ++m_shareLatencyCount;
+
+  std::string error = errorMessage(message);
+  if (error.empty()) {
+    ++m_sharesAccepted;
+    m_logger(Logging::INFO) << "Share accepted in " << latency.count() / 1000 << " ms";
+  } else {
+    ++m_sharesRejected;
+    m_logger(Logging::WARNING) << "Share rejected: " << error;
+  }
+}
+
+void StratumClient::setJob(const JsonValue& params) {
+  if (!params.isObject() || !params.contains("blob") || !params.contains("job_id") || !params.contains("target")) {
+    m_logger(Logging::WARNING) << "Ignoring incomplete pool job";
+    return;
+  }
+
+  std::shared_ptr<Job> job = std::make_shared<Job>();
+  job->id = params("job_id").getString();
+  job->variant = m_config.variant;
+  job->light = m_config.light;
+  job->nextNonce = Crypto::rand<uint32_t>();
+
+  if (!Common::fromHex(params("blob").getString(), job->blob) || !findNonceOffset(job->blob, job->nonceOffset) ||
+      !parseTarget(params("target").getString(), job->target)) {
+    m_logger(Logging::WARNING) << "Ignoring malformed pool job " << job->id;
+    return;
+  }
+
+  if (params.contains("algo") && params("algo").isString() && !parseAlgorithm(params("algo").getString(), job->variant, job->light)) {
+    m_logger(Logging::WARNING) << "Ignoring pool job " << job->id << " for unsupported algorithm " << params("algo").getString();
+    return;
+  }
+
+  if (params.contains("variant") && params("variant").isInteger()) {
+    job->variant = static_cast<int>(params("variant").getInteger());
+  }
+
+  m_logger(Logging::DEBUGGING) << "new pool job " << job->id;
+
+  std::lock_guard<std::mutex> lock(m_jobMutex);
+  m_job = job;
+  ++m_jobSequence;
+}
+
+void StratumClient::clearJob() {
+  std::lock_guard<std::mutex> lock(m_jobMutex);
+  m_job.reset();
+  ++m_jobSequence;
+}
+
+void StratumClient::dropPendingShares() {
+  //the pool never answered these, so they were not credited
+  m_sharesRejected += m_pendingShares.size();
+  m_pendingShares.clear();
+}
+
+//runs in its own thread, only looks at the current job and never waits for the network
+void StratumClient::workerFunc(size_t workerIndex) {
+  Crypto::slow_hash_allocate_state();
+
+  try {
+    Crypto::cn_context context;
+    std::shared_ptr<Job> job;
+    uint64_t sequence = 0;
+    size_t ways = 1;
+    size_t blobSize = 0;
+    std::vector<uint8_t> blobs;
+    Crypto::Hash hashes[MAX_WAYS];
+
+    while (!m_workersStopped) {
+      if (workerIndex >= m_activeThreadCount.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        continue;
+      }
+
+      if (job == nullptr || m_jobSequence != sequence) {
+        {
+          std::lock_guard<std::mutex> lock(m_jobMutex);
+          job = m_job;
+          sequence = m_jobSequence;
+        }
+
+        if (job == nullptr) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));
+          continue;
+        }
+
+        ways = std::min(MAX_WAYS, Crypto::cn_slow_hash_select_ways(m_config.threadCount, job->light));
+        blobSize = job->blob.size();
+        blobs.resize(blobSize * ways);
+        for (size_t i = 0; i < ways; ++i) {
+          std::copy(job->blob.begin(), job->blob.end(), blobs.begin() + i * blobSize);
+        }
+      }
+
+      uint32_t nonce = job->nextNonce.fetch_add(static_cast<uint32_t>(ways));
+      for (size_t i = 0; i < ways; ++i) {
+        uint32_t laneNonce = nonce + static_cast<uint32_t>(i);
+        memcpy(&blobs[i * blobSize + job->nonceOffset], &laneNonce, sizeof(laneNonce));
+      }
+
+      Crypto::cn_slow_hash_multi(context, blobs.data(), blobSize, ways, hashes, job->light, job->variant);
+      m_hashCount += ways;
+
+      for (size_t i = 0; i < ways; ++i) {
+        if (meetsTarget(hashes[i], job->target)) {
+          submitShare(*job, nonce + static_cast<uint32_t>(i), hashes[i]);
+        }
+      }
+    }
+  } catch (std::exception& e) {
+    m_logger(Logging::ERROR) << "Stratum worker failed: " << e.what();
+  }
+
+  Crypto::slow_hash_free_state();
+}
+
+void StratumClient::submitShare(const Job& job, uint32_t nonce, const Crypto::Hash& hash) {
+  {
+    std::lock_guard<std::mutex> lock(m_shareMutex);
+    m_shares.push_back(Share{ job.id, nonce, hash });
+  }
+
+  m_dispatcher.remoteSpawn([this] { m_shareFound.set(); });
+}
+
+}
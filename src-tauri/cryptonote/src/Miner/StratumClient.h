@@ -0,0 +1,146 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <System/ContextGroup.h>
+#include <System/Event.h>
+#include <System/RemoteContext.h>
+
+#include "crypto/hash.h"
+#include "Logging/LoggerRef.h"
+
+namespace Common {
+class JsonValue;
+}
+
+namespace System {
+class Dispatcher;
+class TcpConnection;
+}
+
+namespace Miner {
+
+struct StratumConfig {
+  StratumConfig();
+
+  std::string host;
+  uint16_t port;
+  std::string login;
+  std::string password;
+  std::string rigId;
+  size_t threadCount;
+  size_t reconnectDelay;
+  //hash parameters for jobs that don't name their algorithm
+  int variant;
+  int light;
+};
+
+//parses "stratum+tcp://host:port" or "host:port", returns false if there is no usable host
+bool parseStratumAddress(const std::string& address, std::string& host, uint16_t& port);
+
+class StratumClient {
+public:
+  StratumClient(System::Dispatcher& dispatcher, const StratumConfig& config, Logging::ILogger& logger);
+  ~StratumClient();
+
+  //keeps a pool session alive and hashes its jobs until stop() is called
+  void start();
+  //must be called from the dispatcher thread, start() returns once the workers have wound down
+  void stop();
+
+  uint64_t getHashCount() const;
+  uint64_t getSharesAccepted() const;
+  uint64_t getSharesRejected() const;
+  //mean time from submitting a share to the pool's answer, in milliseconds
+  double getShareLatency() const;
+  //workers at or past count idle until it is raised again, 0 parks them all; safe from any thread
+  void setActiveThreadCount(size_t count);
+
+private:
+  struct Job {
+    std::string id;
+    std::vector<uint8_t> blob;
+    size_t nonceOffset;
+    uint64_t target;
+    int variant;
+    int light;
+    std::atomic<uint32_t> nextNonce;
+  };
+
+  struct Share {
+    std::string jobId;
+    uint32_t nonce;
+    Crypto::Hash hash;
+  };
+
+  System::Dispatcher& m_dispatcher;
+  Logging::LoggerRef m_logger;
+  StratumConfig m_config;
+  System::ContextGroup m_contextGroup;
+  System::ContextGroup* m_session;
+  bool m_stopRequested;
+
+  std::vector<std::unique_ptr<System::RemoteContext<void>>> m_workers;
+  std::atomic<bool> m_workersStopped;
+  std::atomic<size_t> m_activeThreadCount;
+
+  std::mutex m_jobMutex;
+  std::shared_ptr<Job> m_job;
+  std::atomic<uint64_t> m_jobSequence;
+
+  std::mutex m_shareMutex;
+  std::deque<Share> m_shares;
+  System::Event m_shareFound;
+
+  std::string m_sessionId;
+  uint64_t m_nextRequestId;
+  std::map<uint64_t, std::chrono::steady_clock::time_point> m_pendingShares;
+
+  std::atomic<uint64_t> m_hashCount;
+  std::atomic<uint64_t> m_sharesAccepted;
+  std::atomic<uint64_t> m_sharesRejected;
+  std::atomic<uint64_t> m_shareLatencyTotal;
+  std::atomic<uint64_t> m_shareLatencyCount;
+
+  void connectionLoop();
+  void runSession();
+  void readLoop(System::TcpConnection& connection, std::string& buffer);
+  void writeLoop(System::TcpConnection& connection);
+  void handleMessage(const Common::JsonValue& message);
+  void handleShareResult(uint64_t id, const Common::JsonValue& message);
+
+  void setJob(const Common::JsonValue& params);
+  void clearJob();
+  void dropPendingShares();
+
+  void workerFunc(size_t workerIndex);
+  void submitShare(const Job& job, uint32_t nonce, const Crypto::Hash& hash);
+};
+
+}
@@ -37,6 +37,7 @@
  */
 
 #include <string>
+#include <algorithm>
 #include <cassert>
 #include <map>
 #include <cstdint>
@@ -74,19 +75,12 @@ namespace
   bool checksum_test(std::vector<std::string> seed, uint32_t unique_prefix_length);
 
   /*!
-   * \brief Finds the word list that contains the seed words and puts the indices
-   *        where matches occured in matched_indices.
-   * \param  seed            List of words to match.
-   * \param  has_checksum    The seed has a checksum word (maybe not checked).
-   * \param  matched_indices The indices where the seed words were found are added to this.
-   * \param  language        Language instance pointer to write to after it is found.
-   * \return                 true if all the words were present in some language false if not.
+   * \brief Returns the seed languages in the order they are tried when finding a seed's language.
    */
-  bool find_seed_language(const std::vector<std::string> &seed,
-    bool has_checksum, std::vector<uint32_t> &matched_indices, Language::Base **language)
+  const std::vector<Language::Base*> &seed_languages()
   {
     // If there's a new language added, add an instance of it here.
-    std::vector<Language::Base*> language_instances({
+    static const std::vector<Language::Base*> language_instances({
       Language::Singleton<Language::Chinese_Simplified>::instance(),
       Language::Singleton<Language::English>::instance(),
       Language::Singleton<Language::Dutch>::instance(),
@@ -101,12 +95,126 @@ namespace
       Language::Singleton<Language::Lojban>::instance(),
       Language::Singleton<Language::EnglishOld>::instance()
     });
+    return language_instances;
+  }
+
+  /*!
+   * \class SeedWordIndex
+   * \brief Which seed languages each unique prefix belongs to, as a bit per language
+   *        in seed_languages() order, and every word list sorted for prefix searches. Built on first
+   *        use, for checking seeds while they are typed.
+   */
+  class SeedWordIndex
+  {
+  public:
+    SeedWordIndex()
+    {
+      const std::vector<Language::Base*> &languages = seed_languages();
+      for (size_t i = 0; i < languages.size(); i++)
+      {
+        uint32_t bit = 1u << i;
+        std::unordered_map<std::string, uint32_t> &prefixes = prefix_languages[languages[i]->get_unique_prefix_length()];
+        for (const auto &entry : languages[i]->get_trimmed_word_map())
+        {
+          prefixes[entry.first] |= bit;
+        }
+
+        std::vector<std::string> sorted = languages[i]->get_word_list();
+        std::sort(sorted.begin(), sorted.end());
+        sorted_words.push_back(std::move(sorted));
+      }
+    }
+
+    static const SeedWordIndex &instance()
+    {
+      static const SeedWordIndex index;
+      return index;
+    }
+
+    uint32_t all_languages() const
+    {
+      return (1u << sorted_words.size()) - 1;
+    }
+
+    /*!
+     * \brief Returns the languages that have a word with the same unique prefix as word.
+     */
+    uint32_t languages_of(const std::string &word) const
+    {
+      uint32_t languages = 0;
+      for (const auto &by_length : prefix_languages)
+      {
+        auto it = by_length.second.find(Language::utf8prefix(word, by_length.first));
+        if (it != by_length.second.end())
+        {
+          languages |= it->second;
+        }
+      }
+      return languages;
+    }
+
+    /*!
+     * \brief Returns the languages among candidates that have a word starting with prefix.
+     */
+    uint32_t languages_completing(const std::string &prefix, uint32_t candidates) const
+    {
+      uint32_t languages = 0;
+      for (size_t i = 0; i < sorted_words.size(); i++)
+      {
+        if ((candidates & (1u << i)) != 0 && first_with_prefix(i, prefix) != sorted_words[i].end())
+        {
+          languages |= 1u << i;
+        }
+      }
+      return languages;
+    }
+
+    /*!
+     * \brief Appends the words of a language starting with prefix in sorted order, at most max_matches unless 0.
+     */
+    void words_with_prefix(size_t language, const std::string &prefix, std::vector<std::string> &matches, size_t max_matches) const
+    {
+      const std::vector<std::string> &words = sorted_words[language];
+      size_t found = 0;
+      for (auto it = first_with_prefix(language, prefix);
+        it != words.end() && it->compare(0, prefix.size(), prefix) == 0 && (max_matches == 0 || found < max_matches); it++, found++)
+      {
+        matches.push_back(*it);
+      }
+    }
+
+  private:
+    std::vector<std::string>::const_iterator first_with_prefix(size_t language, const std::string &prefix) const
+    {
+      const std::vector<std::string> &words = sorted_words[language];
+      auto it = std::lower_bound(words.begin(), words.end(), prefix);
+      return it != words.end() && it->compare(0, prefix.size(), prefix) == 0 ? it : words.end();
+    }
+
+    std::map<uint32_t, std::unordered_map<std::string, uint32_t>> prefix_languages; /*!< by unique prefix length */
+    std::vector<std::vector<std::string>> sorted_words;
+  };
+
+  /*!
+   * \brief Finds the word list that contains the seed words and puts the indices
+   *        where matches occured in matched_indices.
+   * \param  seed            List of words to match.
+   * \param  has_checksum    The seed has a checksum word (maybe not checked).
+   * \param  matched_indices The indices where the seed words were found are added to this.
+   * \param  language        Language instance pointer to write to after it is found.
+   * \return                 true if all the words were present in some language false if not.
+   */
+  bool find_seed_language(const std::vector<std::string> &seed,
+    bool has_checksum, std::vector<uint32_t> &matched_indices, Language::Base **language)
+  {
+    const std::vector<Language::Base*> &language_instances = seed_languages();
     Language::Base *fallback = NULL;
 
     // Iterate through all the languages and find a match
-    for (std::vector<Language::Base*>::iterator it1 = language_instances.begin();
+    for (std::vector<Language::Base*>::const_iterator it1 = language_instances.begin();
       it1 != language_instances.end(); it1++)
     {
+
       const std::unordered_map<std::string, uint32_t> &word_map = (*it1)->get_word_map();
       const std::unordered_map<std::string, uint32_t> &trimmed_word_map = (*it1)->get_trimmed_word_map();
       // To iterate through seed words
@@ -472,6 +580,62 @@ namespace crypto
       }
     }
 
+    bool get_words_with_prefix(const std::string &prefix, const std::string &language_name,
+      std::vector<std::string> &matches, size_t max_matches)
+    {
+      const std::vector<Language::Base*> &languages = seed_languages();
+      for (size_t i = 0; i < languages.size(); i++)
+      {
+        if (languages[i]->get_language_name() == language_name)
+        {
+          SeedWordIndex::instance().words_with_prefix(i, prefix, matches, max_matches);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    size_t count_valid_seed_words(std::string words, std::string &language_name)
+    {
+      // a word the user is still typing is only followed by a space once it is done
+      bool last_word_complete = !words.empty() && words.back() == ' ';
+      std::vector<std::string> seed;
+      boost::algorithm::trim(words);
+      if (!words.empty())
+      {
+        boost::split(seed, words, boost::is_any_of(" "), boost::token_compress_on);
+      }
+
+      const SeedWordIndex &index = SeedWordIndex::instance();
+      uint32_t candidates = index.all_languages();
+      size_t valid = 0;
+      for (; valid < seed.size(); valid++)
+      {
+        uint32_t languages = candidates & index.languages_of(seed[valid]);
+        if (languages == 0 && valid + 1 == seed.size() && !last_word_complete)
+        {
+          languages = index.languages_completing(seed[valid], candidates);
+        }
+        if (languages == 0)
+        {
+          break;
+        }
+        candidates = languages;
+      }
+
+      language_name.clear();
+      const std::vector<Language::Base*> &languages = seed_languages();
+      for (size_t i = 0; i < languages.size() && valid != 0; i++)
+      {
+        if ((candidates & (1u << i)) != 0)
+        {
+          language_name = languages[i]->get_language_name();
+          break;
+        }
+      }
+      return valid;
+    }
+
     /*!
      * \brief Tells if the seed passed is an old style seed or not.
      * \param  seed The seed to check (a space delimited concatenated word list)
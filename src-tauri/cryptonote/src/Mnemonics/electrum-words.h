@@ -42,6 +42,7 @@
 #include <string>
 #include <cstdint>
 #include <map>
+#include <vector>
 #include "crypto/crypto.h"  // for declaration of crypto::secret_key
 
 /*!
@@ -109,6 +110,27 @@ namespace crypto
      */
     void get_language_list(std::vector<std::string> &languages);
 
+    /*!
+     * \brief Finds the words of a seed language that start with prefix, to complete a word being typed.
+     * \param  prefix        Start of the word.
+     * \param  language_name Seed language name
+     * \param  matches       The matching words are appended here in sorted order.
+     * \param  max_matches   At most this many words are appended, 0 for all of them.
+     * \return               false if the language is unknown.
+     */
+    bool get_words_with_prefix(const std::string &prefix, const std::string &language_name,
+      std::vector<std::string> &matches, size_t max_matches);
+
+    /*!
+     * \brief Checks a seed while it is typed: every word has to share a language with the words
+     *        before it, matched on the unique prefix as words_to_bytes does. The last word may also
+     *        be the start of such a word unless a space follows it.
+     * \param  words         The words typed so far, separated by spaces.
+     * \param  language_name A language all the valid words belong to gets written here.
+     * \return               The number of leading words that are valid.
+     */
+    size_t count_valid_seed_words(std::string words, std::string &language_name);
+
     /*!
      * \brief Tells if the seed passed is an old style seed or not.
      * \param  seed The seed to check (a space delimited concatenated word list)
@@ -0,0 +1,94 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "HttpClientPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <System/Event.h>
+#include <System/InterruptedException.h>
+#include "Rpc/HttpClient.h"
+
+namespace CryptoNote {
+
+HttpClientPool::Lease::Lease(HttpClientPool& pool, Priority priority) : m_pool(pool), m_client(&pool.acquire(priority)) {
+}
+
+HttpClientPool::Lease::~Lease() {
+  m_pool.release(*m_client);
+}
+
+HttpClientPool::HttpClientPool(System::Dispatcher& dispatcher, const std::string& address, uint16_t port, size_t size) :
+  m_dispatcher(dispatcher), m_connected(true) {
+  assert(size > 0);
+  for (size_t i = 0; i < size; ++i) {
+    m_clients.emplace_back(new HttpClient(dispatcher, address, port));
+    m_idle.push_back(m_clients.back().get());
+  }
+}
+
+HttpClientPool::~HttpClientPool() {
+  assert(m_idle.size() == m_clients.size());
+}
+
+HttpClient& HttpClientPool::acquire(Priority priority) {
+  if (!m_idle.empty()) {
+    HttpClient* client = m_idle.back();
+    m_idle.pop_back();
+    return *client;
+  }
+
+  System::Event event(m_dispatcher);
+  Waiter waiter = { &event, nullptr };
+  m_waiters[priority].push_back(&waiter);
+
+  try {
+    while (waiter.client == nullptr) {
+      event.wait();
+    }
+  } catch (System::InterruptedException&) {
+    if (waiter.client != nullptr) {
+      release(*waiter.client);
+    } else {
+      auto& waiters = m_waiters[priority];
+      waiters.erase(std::find(waiters.begin(), waiters.end(), &waiter));
+    }
+
+    throw;
+  }
+
+  return *waiter.client;
+}
+
+void HttpClientPool::release(HttpClient& client) {
+  m_connected = client.isConnected();
+
+  for (auto& waiters : m_waiters) {
+    if (!waiters.empty()) {
+      Waiter* waiter = waiters.front();
+      waiters.pop_front();
+      waiter->client = &client;
+      waiter->event->set();
+      return;
+    }
+  }
+
+  m_idle.push_back(&client);
+}
+
+}
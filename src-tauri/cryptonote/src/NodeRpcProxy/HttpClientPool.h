@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace System {
+  class Dispatcher;
+  class Event;
+}
+
+namespace CryptoNote {
+
+class HttpClient;
+
+// Fixed set of keep-alive connections to one node, shared by the contexts of a single dispatcher.
+// A context that finds every connection busy waits in the queue of its priority, and a released
+// connection is handed to the oldest waiter of the most urgent queue.
+class HttpClientPool {
+public:
+  enum Priority {
+    PRIORITY_INTERACTIVE,
+    PRIORITY_BACKGROUND,
+    PRIORITY_COUNT
+  };
+
+  class Lease {
+  public:
+    Lease(HttpClientPool& pool, Priority priority);
+    ~Lease();
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    HttpClient& client() const { return *m_client; }
+
+  private:
+    HttpClientPool& m_pool;
+    HttpClient* m_client;
+  };
+
+  HttpClientPool(System::Dispatcher& dispatcher, const std::string& address, uint16_t port, size_t size);
+  ~HttpClientPool();
+
+  // state of the connection that finished a request last
+  bool isConnected() const { return m_connected; }
+  size_t waitingCount(Priority priority) const { return m_waiters[priority].size(); }
+
+private:
+  struct Waiter {
+    System::Event* event;
+    HttpClient* client;
+  };
+
+  HttpClient& acquire(Priority priority);
+  void release(HttpClient& client);
+
+  System::Dispatcher& m_dispatcher;
+  std::vector<std::unique_ptr<HttpClient>> m_clients;
+  std::vector<HttpClient*> m_idle;
+  std::deque<Waiter*> m_waiters[PRIORITY_COUNT];
+  bool m_connected;
+};
+
+}
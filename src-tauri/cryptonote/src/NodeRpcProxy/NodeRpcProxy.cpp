@@ -18,20 +18,28 @@
 #include "NodeRpcProxy.h"
 #include "NodeErrors.h"
 
+#include <algorithm>
 #include <atomic>
+#include <memory>
+#include <numeric>
 #include <system_error>
 #include <thread>
+#include <tuple>
+#include <unordered_set>
 
 #include <HTTP/HttpRequest.h>
 #include <HTTP/HttpResponse.h>
+#include <System/Context.h>
 #include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
 #include <System/Event.h>
-#include <System/EventLock.h>
+#include <System/InterruptedException.h>
 #include <System/Timer.h>
 #include <CryptoNoteCore/TransactionApi.h>
 
 #include "Common/StringTools.h"
+#include "Common/Tracing.h"
+#include "CryptoNoteCore/BinaryBlobDecoder.h"
 #include "CryptoNoteCore/CryptoNoteBasicImpl.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/CryptoNoteTools.h"
@@ -51,6 +59,23 @@ namespace CryptoNote {
 
 namespace {
 
+// lets a wallet operation proceed while block sync and the node status pull are in flight
+const size_t DEFAULT_CONNECTION_COUNT = 3;
+
+// a node this many blocks behind the best one is used only when the others fail
+const uint32_t NODE_HEIGHT_TOLERANCE = 2;
+// hedge delay used until a call has enough latency samples for its p95
+const uint64_t HEDGE_MIN_SAMPLES = 20;
+const std::chrono::milliseconds DEFAULT_HEDGE_DELAY(1000);
+const std::chrono::milliseconds MIN_HEDGE_DELAY(50);
+
+// reads the node answers the same way no matter how often they are repeated
+const std::unordered_set<std::string> HEDGED_CALLS = { "/queryblockslite.bin", "/querycompactoutputs.bin", "/getblocks.bin", "/getrandom_outs.bin", "/gettransactions.bin" };
+
+bool isNodeFailure(const std::error_code& ec) {
+  return ec == make_error_code(error::CONNECT_ERROR) || ec == make_error_code(error::NETWORK_ERROR) || ec == make_error_code(error::NODE_BUSY);
+}
+
 std::error_code interpretResponseStatus(const std::string& status) {
   if (CORE_RPC_STATUS_BUSY == status) {
     return make_error_code(error::NODE_BUSY);
@@ -63,12 +88,25 @@ std::error_code interpretResponseStatus(const std::string& status) {
 }
 
 NodeRpcProxy::NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort) :
+    NodeRpcProxy(std::vector<std::pair<std::string, unsigned short>>{ { nodeHost, nodePort } }) {
+}
+
+NodeRpcProxy::NodeRpcProxy(const std::vector<std::pair<std::string, unsigned short>>& nodes) :
     m_rpcTimeout(10000),
     m_pullInterval(5000),
-    m_nodeHost(nodeHost),
-    m_nodePort(nodePort),
+    m_connectionCount(DEFAULT_CONNECTION_COUNT),
     m_lastLocalBlockTimestamp(0),
     m_connected(true) {
+  assert(!nodes.empty());
+  for (const auto& node : nodes) {
+    RemoteNode remoteNode;
+    remoteNode.host = node.first;
+    remoteNode.port = node.second;
+    remoteNode.clients = nullptr;
+    remoteNode.binaryRpc = true;
+    m_nodes.push_back(remoteNode);
+  }
+
   resetInternalState();
 }
 
@@ -83,6 +121,13 @@ void NodeRpcProxy::resetInternalState() {
   m_networkHeight.store(0, std::memory_order_relaxed);
   m_lastKnowHash = CryptoNote::NULL_HASH;
   m_knownTxs.clear();
+  m_poolChangesCursor.reset();
+  for (auto& node : m_nodes) {
+    node.height = 0;
+    node.latency = 0;
+    node.failures = 0;
+    node.probing = false;
+  }
 }
 
 void NodeRpcProxy::init(const INode::Callback& callback) {
@@ -135,11 +180,11 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
     m_dispatcher = &dispatcher;
     ContextGroup contextGroup(dispatcher);
     m_context_group = &contextGroup;
-    HttpClient httpClient(dispatcher, m_nodeHost, m_nodePort);
-    m_httpClient = &httpClient;
-    Event httpEvent(dispatcher);
-    m_httpEvent = &httpEvent;
-    m_httpEvent->set();
+    std::vector<std::unique_ptr<HttpClientPool>> httpClients;
+    for (auto& node : m_nodes) {
+      httpClients.emplace_back(new HttpClientPool(dispatcher, node.host, node.port, std::max<size_t>(m_connectionCount, 1)));
+      node.clients = httpClients.back().get();
+    }
 
     {
       std::lock_guard<std::mutex> lock(m_mutex);
@@ -153,6 +198,10 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
     contextGroup.spawn([this]() {
       Timer pullTimer(*m_dispatcher);
       while (!m_stop) {
+        if (m_nodes.size() > 1) {
+          probeNodes();
+        }
+
         updateNodeStatus();
         if (!m_stop) {
           pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
@@ -168,8 +217,10 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
   m_dispatcher = nullptr;
   m_context_group = nullptr;
-  m_httpClient = nullptr;
-  m_httpEvent = nullptr;
+  for (auto& node : m_nodes) {
+    node.clients = nullptr;
+  }
+
   m_connected = false;
   m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
 }
@@ -211,7 +262,10 @@ void NodeRpcProxy::updateBlockchainStatus() {
   CryptoNote::COMMAND_RPC_GET_LAST_BLOCK_HEADER::request req = AUTO_VAL_INIT(req);
   CryptoNote::COMMAND_RPC_GET_LAST_BLOCK_HEADER::response rsp = AUTO_VAL_INIT(rsp);
 
-  std::error_code ec = jsonRpcCommand("getlastblockheader", req, rsp);
+  std::error_code ec = binaryCommand("/getlastblockheader.bin", req, rsp, HttpClientPool::PRIORITY_BACKGROUND,
+    std::function<std::error_code(RemoteNode&, decltype(rsp)&)>([&](RemoteNode& node, decltype(rsp)& nodeRes) {
+      return jsonRpcCommand(node, "getlastblockheader", req, nodeRes, HttpClientPool::PRIORITY_BACKGROUND);
+    }));
 
   if (!ec) {
     Crypto::Hash blockHash;
@@ -230,7 +284,10 @@ void NodeRpcProxy::updateBlockchainStatus() {
   CryptoNote::COMMAND_RPC_GET_INFO::request getInfoReq = AUTO_VAL_INIT(getInfoReq);
   CryptoNote::COMMAND_RPC_GET_INFO::response getInfoResp = AUTO_VAL_INIT(getInfoResp);
 
-  ec = jsonCommand("/getinfo", getInfoReq, getInfoResp);
+  ec = binaryCommand("/getinfo.bin", getInfoReq, getInfoResp, HttpClientPool::PRIORITY_BACKGROUND,
+    std::function<std::error_code(RemoteNode&, decltype(getInfoResp)&)>([&](RemoteNode& node, decltype(getInfoResp)& nodeRes) {
+      return jsonCommand(node, "/getinfo", getInfoReq, nodeRes, HttpClientPool::PRIORITY_BACKGROUND);
+    }));
   if (!ec) {
     //a quirk to let wallets work with previous versions daemons.
     //Previous daemons didn't have the 'last_known_block_index' parameter in RPC so it may have zero value.
@@ -243,8 +300,8 @@ void NodeRpcProxy::updateBlockchainStatus() {
     updatePeerCount(getInfoResp.incoming_connections_count + getInfoResp.outgoing_connections_count);
   }
 
-  if (m_connected != m_httpClient->isConnected()) {
-    m_connected = m_httpClient->isConnected();
+  if (m_connected != anyNodeConnected()) {
+    m_connected = anyNodeConnected();
     m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
   }
 }
@@ -318,7 +375,7 @@ void NodeRpcProxy::relayTransaction(const CryptoNote::Transaction& transaction,
     return;
   }
 
-  scheduleRequest(std::bind(&NodeRpcProxy::doRelayTransaction, this, transaction), callback);
+  scheduleRequest("NodeRpcProxy::relayTransaction", std::bind(&NodeRpcProxy::doRelayTransaction, this, transaction), callback);
 }
 
 void NodeRpcProxy::getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount,
@@ -330,7 +387,7 @@ void NodeRpcProxy::getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint6
     return;
   }
 
-  scheduleRequest(std::bind(&NodeRpcProxy::doGetRandomOutsByAmounts, this, std::move(amounts), outsCount, std::ref(outs)),
+  scheduleRequest("NodeRpcProxy::getRandomOutsByAmounts", std::bind(&NodeRpcProxy::doGetRandomOutsByAmounts, this, std::move(amounts), outsCount, std::ref(outs)),
     callback);
 }
 
@@ -344,7 +401,7 @@ void NodeRpcProxy::getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds,
     return;
   }
 
-  scheduleRequest(std::bind(&NodeRpcProxy::doGetNewBlocks, this, std::move(knownBlockIds), std::ref(newBlocks),
+  scheduleRequest("NodeRpcProxy::getNewBlocks", std::bind(&NodeRpcProxy::doGetNewBlocks, this, std::move(knownBlockIds), std::ref(newBlocks),
     std::ref(startHeight)), callback);
 }
 
@@ -356,22 +413,72 @@ void NodeRpcProxy::getTransactionOutsGlobalIndices(const Crypto::Hash& transacti
     return;
   }
 
-  scheduleRequest(std::bind(&NodeRpcProxy::doGetTransactionOutsGlobalIndices, this, transactionHash,
+  scheduleRequest("NodeRpcProxy::getTransactionOutsGlobalIndices", std::bind(&NodeRpcProxy::doGetTransactionOutsGlobalIndices, this, transactionHash,
     std::ref(outsGlobalIndices)), callback);
 }
 
 void NodeRpcProxy::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks,
   uint32_t& startHeight, const Callback& callback) {
+  queryBlocks(std::move(knownBlockIds), timestamp, 0, 0, newBlocks, startHeight, callback);
+}
+
+void NodeRpcProxy::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
+  std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) {
   std::lock_guard<std::mutex> lock(m_mutex);
   if (m_state != STATE_INITIALIZED) {
     callback(make_error_code(error::NOT_INITIALIZED));
     return;
   }
 
-  scheduleRequest(std::bind(&NodeRpcProxy::doQueryBlocksLite, this, std::move(knownBlockIds), timestamp,
+  scheduleRequest("NodeRpcProxy::queryBlocks", std::bind(&NodeRpcProxy::doQueryBlocksLite, this, std::move(knownBlockIds), timestamp, maxBlockCount, maxResponseSize,
           std::ref(newBlocks), std::ref(startHeight)), callback);
 }
 
+void NodeRpcProxy::queryCompactOutputs(uint32_t startHeight, uint32_t blockCount, std::vector<Crypto::Hash>& blockHashes,
+  std::vector<CompactTransactionInfo>& transactions, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest("NodeRpcProxy::queryCompactOutputs", std::bind(&NodeRpcProxy::doQueryCompactOutputs, this, startHeight, blockCount,
+          std::ref(blockHashes), std::ref(transactions)), callback);
+}
+
+void NodeRpcProxy::getBlockHeaders(uint32_t startHeight, uint32_t blockCount, std::vector<BlockHeaderInfo>& headers, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest("NodeRpcProxy::getBlockHeaders", std::bind(&NodeRpcProxy::doGetBlockHeaders, this, startHeight, blockCount,
+          std::ref(headers)), callback);
+}
+
+void NodeRpcProxy::getBlockHeightByTimestamp(uint64_t timestamp, uint32_t& height, uint64_t& blockTimestamp, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest("NodeRpcProxy::getBlockHeightByTimestamp", std::bind(&NodeRpcProxy::doGetBlockHeightByTimestamp, this, timestamp,
+          std::ref(height), std::ref(blockTimestamp)), callback);
+}
+
+void NodeRpcProxy::getBlockTimestamp(uint32_t height, uint64_t& timestamp, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest("NodeRpcProxy::getBlockTimestamp", std::bind(&NodeRpcProxy::doGetBlockTimestamp, this, height,
+          std::ref(timestamp)), callback);
+}
+
 void NodeRpcProxy::getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
         std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds, const Callback& callback) {
   std::lock_guard<std::mutex> lock(m_mutex);
@@ -380,7 +487,7 @@ void NodeRpcProxy::getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownP
     return;
   }
 
-  scheduleRequest([this, knownPoolTxIds, knownBlockId, &isBcActual, &newTxs, &deletedTxIds] () mutable -> std::error_code {
+  scheduleRequest("NodeRpcProxy::getPoolSymmetricDifference", [this, knownPoolTxIds, knownBlockId, &isBcActual, &newTxs, &deletedTxIds] () mutable -> std::error_code {
     return this->doGetPoolSymmetricDifference(std::move(knownPoolTxIds), knownBlockId, isBcActual, newTxs, deletedTxIds); } , callback);
 }
 
@@ -477,7 +584,7 @@ std::error_code NodeRpcProxy::doRelayTransaction(const CryptoNote::Transaction&
   COMMAND_RPC_SEND_RAW_TX::request req;
   COMMAND_RPC_SEND_RAW_TX::response rsp;
   req.tx_as_hex = toHex(toBinaryArray(transaction));
-  return jsonCommand("/sendrawtransaction", req, rsp);
+  return jsonCommand("/sendrawtransaction", req, rsp, HttpClientPool::PRIORITY_INTERACTIVE);
 }
 
 std::error_code NodeRpcProxy::doGetRandomOutsByAmounts(std::vector<uint64_t>& amounts, uint64_t outsCount,
@@ -487,7 +594,7 @@ std::error_code NodeRpcProxy::doGetRandomOutsByAmounts(std::vector<uint64_t>& am
   req.amounts = std::move(amounts);
   req.outs_count = outsCount;
 
-  std::error_code ec = binaryCommand("/getrandom_outs.bin", req, rsp);
+  std::error_code ec = binaryCommand("/getrandom_outs.bin", req, rsp, HttpClientPool::PRIORITY_INTERACTIVE);
   if (!ec) {
     outs = std::move(rsp.outs);
   }
@@ -502,7 +609,7 @@ std::error_code NodeRpcProxy::doGetNewBlocks(std::vector<Crypto::Hash>& knownBlo
   CryptoNote::COMMAND_RPC_GET_BLOCKS_FAST::response rsp = AUTO_VAL_INIT(rsp);
   req.block_ids = std::move(knownBlockIds);
 
-  std::error_code ec = binaryCommand("/getblocks.bin", req, rsp);
+  std::error_code ec = binaryCommand("/getblocks.bin", req, rsp, HttpClientPool::PRIORITY_BACKGROUND);
   if (!ec) {
     newBlocks = std::move(rsp.blocks);
     startHeight = static_cast<uint32_t>(rsp.start_height);
@@ -517,7 +624,7 @@ std::error_code NodeRpcProxy::doGetTransactionOutsGlobalIndices(const Crypto::Ha
   CryptoNote::COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response rsp = AUTO_VAL_INIT(rsp);
   req.txid = transactionHash;
 
-  std::error_code ec = binaryCommand("/get_o_indexes.bin", req, rsp);
+  std::error_code ec = binaryCommand("/get_o_indexes.bin", req, rsp, HttpClientPool::PRIORITY_INTERACTIVE);
   if (!ec) {
     outsGlobalIndices.clear();
     for (auto idx : rsp.o_indexes) {
@@ -528,15 +635,18 @@ std::error_code NodeRpcProxy::doGetTransactionOutsGlobalIndices(const Crypto::Ha
   return ec;
 }
 
-std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
+std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
         std::vector<CryptoNote::BlockShortEntry>& newBlocks, uint32_t& startHeight) {
   CryptoNote::COMMAND_RPC_QUERY_BLOCKS_LITE::request req = AUTO_VAL_INIT(req);
   CryptoNote::COMMAND_RPC_QUERY_BLOCKS_LITE::response rsp = AUTO_VAL_INIT(rsp);
 
   req.blockIds = knownBlockIds;
   req.timestamp = timestamp;
+  req.maxBlockCount = maxBlockCount;
+  req.maxResponseSize = maxResponseSize;
+  req.includeGlobalIndexes = true;
 
-  std::error_code ec = binaryCommand("/queryblockslite.bin", req, rsp);
+  std::error_code ec = binaryCommand("/queryblockslite.bin", req, rsp, HttpClientPool::PRIORITY_BACKGROUND);
   if (ec) {
     return ec;
   }
@@ -549,17 +659,19 @@ std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<Crypto::Hash>&
 
     bse.blockHash = std::move(item.blockId);
     if (!item.block.empty()) {
-      if (!fromBinaryArray(bse.block, asBinaryArray(item.block))) {
+      if (!decodeBlock(item.block.data(), item.block.size(), bse.block)) {
         return std::make_error_code(std::errc::invalid_argument);
       }
 
       bse.hasBlock = true;
+      bse.baseTransactionGlobalIndexes = std::move(item.baseTransactionGlobalIndexes);
     }
 
-    for (const auto& txp: item.txPrefixes) {
+    for (auto& txp: item.txPrefixes) {
       TransactionShortInfo tsi;
       tsi.txId = txp.txHash;
       tsi.txPrefix = txp.txPrefix;
+      tsi.globalIndexes = std::move(txp.globalIndexes);
       bse.txsShortInfo.push_back(std::move(tsi));
     }
 
@@ -569,15 +681,99 @@ std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<Crypto::Hash>&
   return std::error_code();
 }
 
+std::error_code NodeRpcProxy::doQueryCompactOutputs(uint32_t startHeight, uint32_t blockCount, std::vector<Crypto::Hash>& blockHashes,
+        std::vector<CompactTransactionInfo>& transactions) {
+  CryptoNote::COMMAND_RPC_QUERY_COMPACT_OUTPUTS::request req = AUTO_VAL_INIT(req);
+  CryptoNote::COMMAND_RPC_QUERY_COMPACT_OUTPUTS::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.startHeight = startHeight;
+  req.blockCount = blockCount;
+
+  std::error_code ec = binaryCommand("/querycompactoutputs.bin", req, rsp, HttpClientPool::PRIORITY_BACKGROUND);
+  if (ec) {
+    return ec;
+  }
+
+  for (const auto& tx : rsp.transactions) {
+    if (tx.amounts.size() != tx.outputKeys.size() || tx.globalIndexes.size() != tx.outputKeys.size()) {
+      return std::make_error_code(std::errc::invalid_argument);
+    }
+  }
+
+  blockHashes = std::move(rsp.blockHashes);
+  transactions = std::move(rsp.transactions);
+  return std::error_code();
+}
+
+std::error_code NodeRpcProxy::doGetBlockHeaders(uint32_t startHeight, uint32_t blockCount, std::vector<BlockHeaderInfo>& headers) {
+  CryptoNote::COMMAND_RPC_GET_BLOCK_HEADERS::request req = AUTO_VAL_INIT(req);
+  CryptoNote::COMMAND_RPC_GET_BLOCK_HEADERS::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.startHeight = startHeight;
+  req.blockCount = blockCount;
+
+  std::error_code ec = binaryCommand("/getblockheaders.bin", req, rsp, HttpClientPool::PRIORITY_BACKGROUND);
+  if (ec) {
+    return ec;
+  }
+
+  // every header has to follow the one before it, a gap means the node answered from a different chain
+  for (size_t i = 1; i < rsp.headers.size(); ++i) {
+    if (rsp.headers[i].height != rsp.headers[i - 1].height + 1 || rsp.headers[i].prevHash != rsp.headers[i - 1].hash) {
+      return std::make_error_code(std::errc::invalid_argument);
+    }
+  }
+
+  headers = std::move(rsp.headers);
+  return std::error_code();
+}
+
+std::error_code NodeRpcProxy::doGetBlockHeightByTimestamp(uint64_t timestamp, uint32_t& height, uint64_t& blockTimestamp) {
+  CryptoNote::COMMAND_RPC_GET_BLOCK_HEIGHT_BY_TIMESTAMP::request req = AUTO_VAL_INIT(req);
+  CryptoNote::COMMAND_RPC_GET_BLOCK_HEIGHT_BY_TIMESTAMP::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.timestamp = timestamp;
+
+  std::error_code ec = jsonRpcCommand("getblockheightbytimestamp", req, rsp, HttpClientPool::PRIORITY_INTERACTIVE);
+  if (ec) {
+    return ec;
+  }
+
+  height = static_cast<uint32_t>(rsp.height);
+  blockTimestamp = rsp.timestamp;
+  return std::error_code();
+}
+
+std::error_code NodeRpcProxy::doGetBlockTimestamp(uint32_t height, uint64_t& timestamp) {
+  CryptoNote::COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::request req = AUTO_VAL_INIT(req);
+  CryptoNote::COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.height = height;
+
+  std::error_code ec = binaryCommand("/getblockheaderbyheight.bin", req, rsp, HttpClientPool::PRIORITY_INTERACTIVE,
+    std::function<std::error_code(RemoteNode&, decltype(rsp)&)>([&](RemoteNode& node, decltype(rsp)& nodeRes) {
+      return jsonRpcCommand(node, "getblockheaderbyheight", req, nodeRes, HttpClientPool::PRIORITY_INTERACTIVE);
+    }));
+  if (ec) {
+    return ec;
+  }
+
+  timestamp = rsp.block_header.timestamp;
+  return std::error_code();
+}
+
 std::error_code NodeRpcProxy::doGetPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
         std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds) {
   CryptoNote::COMMAND_RPC_GET_POOL_CHANGES_LITE::request req = AUTO_VAL_INIT(req);
   CryptoNote::COMMAND_RPC_GET_POOL_CHANGES_LITE::response rsp = AUTO_VAL_INIT(rsp);
 
+  PoolVersion knownPoolVersion = m_poolChangesCursor.position(knownPoolTxIds);
   req.tailBlockId = knownBlockId;
   req.knownTxsIds = knownPoolTxIds;
+  req.knownPoolId = knownPoolVersion.poolId;
+  req.knownPoolVersion = knownPoolVersion.version;
 
-  std::error_code ec = binaryCommand("/get_pool_changes_lite.bin", req, rsp);
+  std::error_code ec = binaryCommand("/get_pool_changes_lite.bin", req, rsp, HttpClientPool::PRIORITY_BACKGROUND);
 
   if (ec) {
     return ec;
@@ -587,8 +783,17 @@ std::error_code NodeRpcProxy::doGetPoolSymmetricDifference(std::vector<Crypto::H
 
   deletedTxIds = std::move(rsp.deletedTxsIds);
 
+  std::vector<Crypto::Hash> addedTxIds;
+  addedTxIds.reserve(rsp.addedTxs.size());
   for (const auto& tpi : rsp.addedTxs) {
     newTxs.push_back(createTransactionPrefix(tpi.txPrefix, tpi.txHash));
+    addedTxIds.push_back(tpi.txHash);
+  }
+
+  // an answer for another tip is thrown away by the caller
+  if (isBcActual && rsp.poolId != 0) {
+    PoolVersion poolVersion = { rsp.poolId, rsp.poolVersion };
+    m_poolChangesCursor.advance(knownPoolTxIds, addedTxIds, deletedTxIds, poolVersion);
   }
 
   return ec;
@@ -601,7 +806,10 @@ std::error_code NodeRpcProxy::doGetTransaction(const Crypto::Hash &transactionHa
 
   req.txs_hashes.push_back(Common::podToHex(transactionHash));
 
-  std::error_code ec = jsonCommand("/gettransactions", req, resp);
+  std::error_code ec = binaryCommand("/gettransactions.bin", req, resp, HttpClientPool::PRIORITY_INTERACTIVE,
+    std::function<std::error_code(RemoteNode&, decltype(resp)&)>([&](RemoteNode& node, decltype(resp)& nodeRes) {
+      return jsonCommand(node, "/gettransactions", req, nodeRes, HttpClientPool::PRIORITY_INTERACTIVE);
+    }));
   if (ec)
   {
     return ec;
@@ -637,10 +845,21 @@ void NodeRpcProxy::getTransaction(const Crypto::Hash &transactionHash, CryptoNot
     return;
   }
 
-  scheduleRequest(std::bind(&NodeRpcProxy::doGetTransaction, this, std::cref(transactionHash), std::ref(transaction)), callback);
+  scheduleRequest("NodeRpcProxy::getTransaction", std::bind(&NodeRpcProxy::doGetTransaction, this, std::cref(transactionHash), std::ref(transaction)), callback);
 }
 
-void NodeRpcProxy::scheduleRequest(std::function<std::error_code()>&& procedure, const Callback& callback) {
+void NodeRpcProxy::scheduleRequest(const char* spanName, std::function<std::error_code()>&& procedure, const Callback& callback) {
+  // The request runs on a context of the proxy's own dispatcher, so the
+  // caller's trace is captured here and handed over explicitly
+  Common::TraceContext parent = Common::currentTraceContext();
+  if (parent.valid()) {
+    std::function<std::error_code()> untraced(std::move(procedure));
+    procedure = [spanName, parent, untraced]() {
+      Common::ScopedSpan span(spanName, parent);
+      return untraced();
+    };
+  }
+
   // callback is located on stack, so copy it inside binder
   class Wrapper {
   public:
@@ -669,8 +888,8 @@ void NodeRpcProxy::scheduleRequest(std::function<std::error_code()>&& procedure,
           callback(std::make_error_code(std::errc::operation_canceled));
         } else {
           std::error_code ec = procedure();
-          if (m_connected != m_httpClient->isConnected()) {
-            m_connected = m_httpClient->isConnected();
+          if (m_connected != anyNodeConnected()) {
+            m_connected = anyNodeConnected();
             m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
           }
           callback(m_stop ? std::make_error_code(std::errc::operation_canceled) : ec);
@@ -680,12 +899,73 @@ void NodeRpcProxy::scheduleRequest(std::function<std::error_code()>&& procedure,
 }
 
 template <typename Request, typename Response>
-std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Request& req, Response& res) {
+std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Request& req, Response& res, HttpClientPool::Priority priority) {
+  return sendCommand<Response>(url, res, [&](RemoteNode& node, Response& nodeRes) {
+    return binaryCommand(node, url, req, nodeRes, priority);
+  });
+}
+
+// Sends the binary variant of a json call, falling back to the json form on nodes that don't know
+// the binary one; those nodes are not asked for binary variants again.
+template <typename Request, typename Response>
+std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Request& req, Response& res, HttpClientPool::Priority priority,
+  const std::function<std::error_code(RemoteNode&, Response&)>& fallback) {
+  return sendCommand<Response>(url, res, [&](RemoteNode& node, Response& nodeRes) {
+    if (node.binaryRpc) {
+      bool unsupported = false;
+      std::error_code ec = binaryCommand(node, url, req, nodeRes, priority, &unsupported);
+      if (!unsupported) {
+        return ec;
+      }
+
+      node.binaryRpc = false;
+      nodeRes = Response();
+    }
+
+    return fallback(node, nodeRes);
+  });
+}
+
+template <typename Request, typename Response>
+std::error_code NodeRpcProxy::jsonCommand(const std::string& url, const Request& req, Response& res, HttpClientPool::Priority priority) {
+  return sendCommand<Response>(url, res, [&](RemoteNode& node, Response& nodeRes) {
+    return jsonCommand(node, url, req, nodeRes, priority);
+  });
+}
+
+template <typename Request, typename Response>
+std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Request& req, Response& res, HttpClientPool::Priority priority) {
+  return sendCommand<Response>(method, res, [&](RemoteNode& node, Response& nodeRes) {
+    return jsonRpcCommand(node, method, req, nodeRes, priority);
+  });
+}
+
+template <typename Request, typename Response>
+std::error_code NodeRpcProxy::binaryCommand(RemoteNode& node, const std::string& url, const Request& req, Response& res, HttpClientPool::Priority priority,
+  bool* unsupported) {
   std::error_code ec;
 
   try {
-    EventLock eventLock(*m_httpEvent);
-    invokeBinaryCommand(*m_httpClient, url, req, res);
+    HttpClientPool::Lease lease(*node.clients, priority);
+
+    HttpRequest httpReq;
+    HttpResponse httpRes;
+    httpReq.setUrl(url);
+    httpReq.setBody(storeToBinaryKeyValue(req));
+
+    auto start = std::chrono::steady_clock::now();
+    lease.client().request(httpReq, httpRes);
+    recordLatency(url, std::chrono::steady_clock::now() - start);
+
+    if (unsupported != nullptr && httpRes.getStatus() == HttpResponse::STATUS_404) {
+      *unsupported = true;
+      return make_error_code(error::REQUEST_ERROR);
+    }
+
+    if (!loadFromBinaryKeyValue(res, httpRes.getBody())) {
+      throw std::runtime_error("Failed to parse binary response");
+    }
+
     ec = interpretResponseStatus(res.status);
   } catch (const ConnectException&) {
     ec = make_error_code(error::CONNECT_ERROR);
@@ -697,12 +977,14 @@ std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Reques
 }
 
 template <typename Request, typename Response>
-std::error_code NodeRpcProxy::jsonCommand(const std::string& url, const Request& req, Response& res) {
+std::error_code NodeRpcProxy::jsonCommand(RemoteNode& node, const std::string& url, const Request& req, Response& res, HttpClientPool::Priority priority) {
   std::error_code ec;
 
   try {
-    EventLock eventLock(*m_httpEvent);
-    invokeJsonCommand(*m_httpClient, url, req, res);
+    HttpClientPool::Lease lease(*node.clients, priority);
+    auto start = std::chrono::steady_clock::now();
+    invokeJsonCommand(lease.client(), url, req, res);
+    recordLatency(url, std::chrono::steady_clock::now() - start);
     ec = interpretResponseStatus(res.status);
   } catch (const ConnectException&) {
     ec = make_error_code(error::CONNECT_ERROR);
@@ -714,11 +996,11 @@ std::error_code NodeRpcProxy::jsonCommand(const std::string& url, const Request&
 }
 
 template <typename Request, typename Response>
-std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Request& req, Response& res) {
+std::error_code NodeRpcProxy::jsonRpcCommand(RemoteNode& node, const std::string& method, const Request& req, Response& res, HttpClientPool::Priority priority) {
   std::error_code ec = make_error_code(error::INTERNAL_NODE_ERROR);
 
   try {
-    EventLock eventLock(*m_httpEvent);
+    HttpClientPool::Lease lease(*node.clients, priority);
 
     JsonRpc::JsonRpcRequest jsReq;
 
@@ -731,7 +1013,9 @@ std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Re
     httpReq.setUrl("/json_rpc");
     httpReq.setBody(jsReq.getBody());
 
-    m_httpClient->request(httpReq, httpRes);
+    auto start = std::chrono::steady_clock::now();
+    lease.client().request(httpReq, httpRes);
+    recordLatency(method, std::chrono::steady_clock::now() - start);
 
     JsonRpc::JsonRpcResponse jsRes;
 
@@ -750,4 +1034,210 @@ std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Re
   return ec;
 }
 
+// Tries the nodes best first until one of them answers. Each attempt fills its own response, so
+// a partial answer from a failed node never leaks into the result.
+template <typename Response>
+std::error_code NodeRpcProxy::sendCommand(const std::string& call, Response& res, const std::function<std::error_code(RemoteNode&, Response&)>& invoke) {
+  std::vector<size_t> ranked = rankNodes();
+  if (ranked.size() > 1 && HEDGED_CALLS.count(call) != 0) {
+    return hedgeCommand(call, res, m_nodes[ranked[0]], m_nodes[ranked[1]], invoke);
+  }
+
+  std::error_code ec;
+  for (size_t index : ranked) {
+    RemoteNode& node = m_nodes[index];
+    Response attempt = Response();
+    ec = invoke(node, attempt);
+    updateNodeScore(node, ec);
+    if (!isNodeFailure(ec)) {
+      res = std::move(attempt);
+      break;
+    }
+
+    if (m_stop) {
+      break;
+    }
+  }
+
+  return ec;
+}
+
+// Sends the call to the first node and, once it has been outstanding for the call's p95 latency or
+// has failed, to the second one as well. The first usable answer wins and the other request is
+// interrupted, which closes its connection.
+template <typename Response>
+std::error_code NodeRpcProxy::hedgeCommand(const std::string& call, Response& res, RemoteNode& first, RemoteNode& second,
+  const std::function<std::error_code(RemoteNode&, Response&)>& invoke) {
+  struct Attempt {
+    Response res;
+    std::error_code ec;
+    bool done;
+  };
+
+  Attempt primary = Attempt();
+  Attempt secondary = Attempt();
+  bool hedgeDue = false;
+  Event wake(*m_dispatcher);
+
+  auto run = [&](RemoteNode& node, Attempt& attempt) {
+    attempt.ec = invoke(node, attempt.res);
+    attempt.done = true;
+    wake.set();
+  };
+
+  Context<> primaryContext(*m_dispatcher, [&] { run(first, primary); });
+  Context<> hedgeTimer(*m_dispatcher, [&] {
+    try {
+      Timer(*m_dispatcher).sleep(hedgeDelay(call));
+      hedgeDue = true;
+      wake.set();
+    } catch (InterruptedException&) {
+    }
+  });
+  std::unique_ptr<Context<>> secondaryContext;
+
+  for (;;) {
+    wake.wait();
+    wake.clear();
+
+    if ((primary.done && !isNodeFailure(primary.ec)) || (secondary.done && !isNodeFailure(secondary.ec))) {
+      break;
+    }
+
+    if (primary.done && secondary.done) {
+      break;
+    }
+
+    if (!secondaryContext && (hedgeDue || primary.done)) {
+      secondaryContext.reset(new Context<>(*m_dispatcher, [&] { run(second, secondary); }));
+    }
+  }
+
+  Attempt* winner = &primary;
+  if (!(primary.done && !isNodeFailure(primary.ec)) && secondary.done && !isNodeFailure(secondary.ec)) {
+    winner = &secondary;
+  }
+
+  if (primary.done) {
+    updateNodeScore(first, primary.ec);
+  } else {
+    // outpaced by the runner-up, stays demoted until its next successful probe
+    ++first.failures;
+  }
+
+  if (secondary.done) {
+    updateNodeScore(second, secondary.ec);
+  }
+
+  res = std::move(winner->res);
+  return winner->ec;
+}
+
+std::chrono::milliseconds NodeRpcProxy::hedgeDelay(const std::string& call) const {
+  const std::chrono::milliseconds maxDelay(m_rpcTimeout);
+
+  std::lock_guard<std::mutex> lock(m_latencyMutex);
+  auto it = m_latencies.find(call);
+  if (it == m_latencies.end() || it->second.count < HEDGE_MIN_SAMPLES) {
+    return std::min(DEFAULT_HEDGE_DELAY, maxDelay);
+  }
+
+  const RpcLatencyHistogram& histogram = it->second;
+  uint64_t target = (histogram.count * 95 + 99) / 100;
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket + 1 < RpcLatencyHistogram::BUCKET_COUNT; ++bucket) {
+    seen += histogram.buckets[bucket];
+    if (seen >= target) {
+      return std::min(std::max(std::chrono::milliseconds(1ll << bucket), MIN_HEDGE_DELAY), maxDelay);
+    }
+  }
+
+  return maxDelay;
+}
+
+std::vector<size_t> NodeRpcProxy::rankNodes() const {
+  uint32_t bestHeight = 0;
+  for (const auto& node : m_nodes) {
+    bestHeight = std::max(bestHeight, node.height);
+  }
+
+  auto score = [bestHeight](const RemoteNode& node) {
+    return std::make_tuple(node.failures > 0, node.height + NODE_HEIGHT_TOLERANCE < bestHeight, node.latency);
+  };
+
+  std::vector<size_t> ranked(m_nodes.size());
+  std::iota(ranked.begin(), ranked.end(), 0);
+  std::stable_sort(ranked.begin(), ranked.end(), [&](size_t a, size_t b) { return score(m_nodes[a]) < score(m_nodes[b]); });
+  return ranked;
+}
+
+void NodeRpcProxy::updateNodeScore(RemoteNode& node, const std::error_code& ec) {
+  if (isNodeFailure(ec)) {
+    ++node.failures;
+  } else {
+    node.failures = 0;
+  }
+}
+
+// Refreshes the height and latency of every node, each probe in its own context so a stalled node
+// does not hold up the status pull.
+void NodeRpcProxy::probeNodes() {
+  for (auto& node : m_nodes) {
+    if (node.probing) {
+      continue;
+    }
+
+    node.probing = true;
+    RemoteNode* probed = &node;
+    m_context_group->spawn([this, probed] {
+      CryptoNote::COMMAND_RPC_GET_HEIGHT::request req = AUTO_VAL_INIT(req);
+      CryptoNote::COMMAND_RPC_GET_HEIGHT::response rsp = AUTO_VAL_INIT(rsp);
+
+      auto start = std::chrono::steady_clock::now();
+      std::error_code ec = jsonCommand(*probed, "/getheight", req, rsp, HttpClientPool::PRIORITY_BACKGROUND);
+      double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+      if (!ec) {
+        probed->height = static_cast<uint32_t>(rsp.height);
+        probed->latency = probed->latency == 0 ? latency : probed->latency * 0.7 + latency * 0.3;
+      }
+
+      updateNodeScore(*probed, ec);
+      probed->probing = false;
+    });
+  }
+}
+
+bool NodeRpcProxy::anyNodeConnected() const {
+  return std::any_of(m_nodes.begin(), m_nodes.end(), [](const RemoteNode& node) {
+    return node.clients != nullptr && node.clients->isConnected();
+  });
+}
+
+void NodeRpcProxy::recordLatency(const std::string& call, std::chrono::steady_clock::duration duration) {
+  uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  size_t bucket = 0;
+  while (bucket + 1 < RpcLatencyHistogram::BUCKET_COUNT && microseconds >= (1000ull << bucket)) {
+    ++bucket;
+  }
+
+  std::lock_guard<std::mutex> lock(m_latencyMutex);
+  auto it = m_latencies.find(call);
+  if (it == m_latencies.end()) {
+    it = m_latencies.emplace(call, RpcLatencyHistogram()).first;
+    it->second.buckets.fill(0);
+    it->second.count = 0;
+    it->second.totalMicroseconds = 0;
+  }
+
+  ++it->second.buckets[bucket];
+  ++it->second.count;
+  it->second.totalMicroseconds += microseconds;
+}
+
+std::map<std::string, RpcLatencyHistogram> NodeRpcProxy::getLatencyHistograms() const {
+  std::lock_guard<std::mutex> lock(m_latencyMutex);
+  return m_latencies;
+}
+
 }
@@ -17,14 +17,21 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <map>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "Common/ObserverManager.h"
+#include "CryptoNoteCore/PoolChangesCursor.h"
+#include "HttpClientPool.h"
 #include "INode.h"
 
 namespace System {
@@ -35,17 +42,27 @@ namespace System {
 
 namespace CryptoNote {
 
-class HttpClient;
-
 class INodeRpcProxyObserver {
 public:
   virtual ~INodeRpcProxyObserver() {}
   virtual void connectionStatusUpdated(bool connected) {}
 };
 
+struct RpcLatencyHistogram {
+  // bucket i counts calls that took less than 2^i milliseconds, the last one also counts all slower calls
+  static const size_t BUCKET_COUNT = 16;
+
+  std::array<uint64_t, BUCKET_COUNT> buckets;
+  uint64_t count;
+  uint64_t totalMicroseconds;
+};
+
 class NodeRpcProxy : public CryptoNote::INode {
 public:
   NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort);
+  // Nodes are ranked by reported height and probe latency. Requests go to the best node and fail over
+  // to the next one, and repeatable reads are also sent to the runner-up once they outlast their p95.
+  explicit NodeRpcProxy(const std::vector<std::pair<std::string, unsigned short>>& nodes);
   virtual ~NodeRpcProxy();
 
   virtual bool addObserver(CryptoNote::INodeObserver* observer) override;
@@ -69,6 +86,13 @@ public:
   virtual void getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std::vector<CryptoNote::block_complete_entry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override;
   virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
+  virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
+    std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
+  virtual void queryCompactOutputs(uint32_t startHeight, uint32_t blockCount, std::vector<Crypto::Hash>& blockHashes,
+    std::vector<CompactTransactionInfo>& transactions, const Callback& callback) override;
+  virtual void getBlockHeaders(uint32_t startHeight, uint32_t blockCount, std::vector<BlockHeaderInfo>& headers, const Callback& callback) override;
+  virtual void getBlockHeightByTimestamp(uint64_t timestamp, uint32_t& height, uint64_t& blockTimestamp, const Callback& callback) override;
+  virtual void getBlockTimestamp(uint32_t height, uint64_t& timestamp, const Callback& callback) override;
   virtual void getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds, const Callback& callback) override;
   virtual void getMultisignatureOutputByGlobalIndex(uint64_t amount, uint32_t gindex, MultisignatureOutput& out, const Callback& callback) override;
@@ -82,6 +106,12 @@ public:
 
   unsigned int rpcTimeout() const { return m_rpcTimeout; }
   void rpcTimeout(unsigned int val) { m_rpcTimeout = val; }
+  // takes effect on the next init()
+  size_t connectionCount() const { return m_connectionCount; }
+  void connectionCount(size_t val) { m_connectionCount = val; }
+
+  // per url or JSON-RPC method
+  std::map<std::string, RpcLatencyHistogram> getLatencyHistograms() const;
 
 private:
   void resetInternalState();
@@ -102,20 +132,57 @@ private:
     std::vector<CryptoNote::block_complete_entry>& newBlocks, uint32_t& startHeight);
   std::error_code doGetTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash,
                                                     std::vector<uint32_t>& outsGlobalIndices);
-  std::error_code doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
+  std::error_code doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t maxBlockCount, uint64_t maxResponseSize,
     std::vector<CryptoNote::BlockShortEntry>& newBlocks, uint32_t& startHeight);
+  std::error_code doQueryCompactOutputs(uint32_t startHeight, uint32_t blockCount, std::vector<Crypto::Hash>& blockHashes,
+    std::vector<CompactTransactionInfo>& transactions);
+  std::error_code doGetBlockHeaders(uint32_t startHeight, uint32_t blockCount, std::vector<BlockHeaderInfo>& headers);
+  std::error_code doGetBlockHeightByTimestamp(uint64_t timestamp, uint32_t& height, uint64_t& blockTimestamp);
+  std::error_code doGetBlockTimestamp(uint32_t height, uint64_t& timestamp);
   std::error_code doGetPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds);
   virtual void getTransaction(const Crypto::Hash &transactionHash, CryptoNote::Transaction &transaction, const Callback &callback) override;
   std::error_code doGetTransaction(const Crypto::Hash &transactionHash, CryptoNote::Transaction &transaction);
 
-  void scheduleRequest(std::function<std::error_code()>&& procedure, const Callback& callback);
-template <typename Request, typename Response>
-  std::error_code binaryCommand(const std::string& url, const Request& req, Response& res);
+  struct RemoteNode {
+    std::string host;
+    unsigned short port;
+    HttpClientPool* clients;
+    uint32_t height;
+    double latency; // smoothed probe round trip, milliseconds
+    uint32_t failures; // in a row
+    bool probing;
+    bool binaryRpc; // cleared when the node predates the binary variants of json calls
+  };
+
+  void scheduleRequest(const char* spanName, std::function<std::error_code()>&& procedure, const Callback& callback);
   template <typename Request, typename Response>
-  std::error_code jsonCommand(const std::string& url, const Request& req, Response& res);
+  std::error_code binaryCommand(const std::string& url, const Request& req, Response& res, HttpClientPool::Priority priority);
   template <typename Request, typename Response>
-  std::error_code jsonRpcCommand(const std::string& method, const Request& req, Response& res);
+  std::error_code jsonCommand(const std::string& url, const Request& req, Response& res, HttpClientPool::Priority priority);
+  template <typename Request, typename Response>
+  std::error_code jsonRpcCommand(const std::string& method, const Request& req, Response& res, HttpClientPool::Priority priority);
+  template <typename Request, typename Response>
+  std::error_code binaryCommand(const std::string& url, const Request& req, Response& res, HttpClientPool::Priority priority,
+    const std::function<std::error_code(RemoteNode&, Response&)>& fallback);
+  template <typename Request, typename Response>
+  std::error_code binaryCommand(RemoteNode& node, const std::string& url, const Request& req, Response& res, HttpClientPool::Priority priority,
+    bool* unsupported = nullptr);
+  template <typename Request, typename Response>
+  std::error_code jsonCommand(RemoteNode& node, const std::string& url, const Request& req, Response& res, HttpClientPool::Priority priority);
+  template <typename Request, typename Response>
+  std::error_code jsonRpcCommand(RemoteNode& node, const std::string& method, const Request& req, Response& res, HttpClientPool::Priority priority);
+  template <typename Response>
+  std::error_code sendCommand(const std::string& call, Response& res, const std::function<std::error_code(RemoteNode&, Response&)>& invoke);
+  template <typename Response>
+  std::error_code hedgeCommand(const std::string& call, Response& res, RemoteNode& first, RemoteNode& second,
+    const std::function<std::error_code(RemoteNode&, Response&)>& invoke);
+  void recordLatency(const std::string& call, std::chrono::steady_clock::duration duration);
+  std::chrono::milliseconds hedgeDelay(const std::string& call) const;
+  std::vector<size_t> rankNodes() const;
+  void updateNodeScore(RemoteNode& node, const std::error_code& ec);
+  void probeNodes();
+  bool anyNodeConnected() const;
 
   enum State {
     STATE_NOT_INITIALIZED,
@@ -133,11 +200,12 @@ private:
   Tools::ObserverManager<CryptoNote::INodeObserver> m_observerManager;
   Tools::ObserverManager<CryptoNote::INodeRpcProxyObserver> m_rpcProxyObserverManager;
 
-  const std::string m_nodeHost;
-  const unsigned short m_nodePort;
+  std::vector<RemoteNode> m_nodes;
   unsigned int m_rpcTimeout;
-  HttpClient* m_httpClient = nullptr;
-  System::Event* m_httpEvent = nullptr;
+  size_t m_connectionCount;
+
+  mutable std::mutex m_latencyMutex;
+  std::map<std::string, RpcLatencyHistogram> m_latencies;
 
   uint64_t m_pullInterval;
 
@@ -151,6 +219,8 @@ private:
   Crypto::Hash m_lastKnowHash;
   std::atomic<uint64_t> m_lastLocalBlockTimestamp;
   std::unordered_set<Crypto::Hash> m_knownTxs;
+  // only touched by requests, which all run on the proxy's dispatcher
+  PoolChangesCursor m_poolChangesCursor;
 
   bool m_connected;
 };
@@ -14,8 +14,8 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include <chrono>
-#include <thread>
 #include <vector>
 #include <boost/optional.hpp>
 #include <boost/program_options.hpp>
@@ -23,13 +23,17 @@
 #include "Common/CommandLine.h"
 #include "Common/JsonValue.h"
 #include "Common/StringTools.h"
+#include "CryptoNoteConfig.h"
+#include "CryptoNoteCore/Currency.h"
 #include "Logging/LoggerRef.h"
 #include "Logging/ConsoleLogger.h"
 #include "Rpc/HttpClient.h"
 #include "Rpc/JsonRpc.h"
 #include "PaymentGate/PaymentServiceJsonRpcMessages.h"
 #include "Serialization/ISerializer.h"
+#include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
+#include <System/Timer.h>
 
 namespace po = boost::program_options;
 using Common::JsonValue;
@@ -49,11 +53,12 @@ namespace {
   const command_line::arg_descriptor<uint16_t>    arg_rpc_port  = {"walletd-port", "RPC port of walletd. Default: 8070", 8070};
   const command_line::arg_descriptor<std::string> arg_user      = {"walletd-user", "RPC user. Default: none", "", true};
   const command_line::arg_descriptor<std::string> arg_pass      = {"walletd-password", "RPC password. Default: none", "", true};
-  const command_line::arg_descriptor<uint16_t>    arg_interval  = {"interval", "polling interval in seconds. Default: 5. Minimum: 1. Maximum: 120.", 5, true};
+  const command_line::arg_descriptor<uint16_t>    arg_interval  = {"interval", "initial delay between fusion transactions in seconds, shortened while the node accepts them and lengthened when it rejects them. Default: 5. Minimum: 1. Maximum: 120.", 5, true};
   const command_line::arg_descriptor<uint16_t>    arg_duration  = {"duration", "maximum execution time, in minutes. Default: 0 (unlimited)", 0, true};
   const command_line::arg_descriptor<uint64_t>    arg_threshold = {"threshold", "Only outputs lesser than the threshold value will be included into optimization. Default: 100 (0.000100 CCX)", DEFAULT_THRESHOLD, true};
   const command_line::arg_descriptor<uint16_t>    arg_anonimity = {"anonymity", "Privacy level. Higher values give more privacy but bigger transactions. Default: 0", 0, true};
-  const command_line::arg_descriptor<bool>        arg_preview   = {"preview", "print on screen what it would be doing, but not really doing it", false, true};
+  const command_line::arg_descriptor<bool>        arg_preview   = {"preview", "print on screen what it would be doing, with the estimated number of fusion rounds, but not really doing it", false, true};
+  const command_line::arg_descriptor<uint16_t>    arg_threads   = {"threads", "number of addresses optimized concurrently. Default: 4. Maximum: 64", 4, true};
   Logging::ConsoleLogger log;
   Logging::LoggerRef logger(log, "optimizer");
   System::Dispatcher dispatcher;
@@ -111,70 +116,61 @@ std::vector<std::string> getWalletsAddresses(po::variables_map& vm) {
   return containerAddresses;
 }
 
-bool isWalletEligible(po::variables_map& vm, std::string address) {
-  uint64_t threshold = DEFAULT_THRESHOLD;
+template <typename Request, typename Response>
+void invoke(po::variables_map& vm, HttpClient& httpClient, const std::string& method, const Request& req, Response& res) {
+  if (command_line::has_arg(vm, arg_user) && command_line::has_arg(vm, arg_pass)) {
+    JsonRpc::invokeJsonRpcCommand(httpClient, method, req, res, command_line::get_arg(vm, arg_user), command_line::get_arg(vm, arg_pass));
+  }
+  else {
+    JsonRpc::invokeJsonRpcCommand(httpClient, method, req, res);
+  }
+}
 
+uint64_t getThreshold(po::variables_map& vm) {
   if (command_line::has_arg(vm, arg_threshold)) {
-    threshold = command_line::get_arg(vm, arg_threshold);
+    return command_line::get_arg(vm, arg_threshold);
+  }
+  return DEFAULT_THRESHOLD;
+}
+
+uint16_t getAnonymity(po::variables_map& vm) {
+  if (command_line::has_arg(vm, arg_anonimity)) {
+    return command_line::get_arg(vm, arg_anonimity);
   }
+  return 0;
+}
 
+// Number of outputs below the threshold, 0 when walletd could not tell
+uint32_t getFusionReadyCount(po::variables_map& vm, HttpClient& httpClient, const std::string& address) {
   PaymentService::EstimateFusion::Request req;
   PaymentService::EstimateFusion::Response res;
 
-  req.threshold = threshold;
+  req.threshold = getThreshold(vm);
   req.addresses.push_back(address);
 
   try {
-    HttpClient httpClient(dispatcher, command_line::get_arg(vm, arg_ip), command_line::get_arg(vm, arg_rpc_port));
-    if (command_line::has_arg(vm, arg_user) && command_line::has_arg(vm, arg_pass)) {
-      JsonRpc::invokeJsonRpcCommand(httpClient, "estimateFusion", req, res, command_line::get_arg(vm, arg_user), command_line::get_arg(vm, arg_pass));
-    }
-    else {
-      JsonRpc::invokeJsonRpcCommand(httpClient, "estimateFusion", req, res);
-    }
+    invoke(vm, httpClient, "estimateFusion", req, res);
   }
   catch (const std::exception& e) {
     logger(ERROR, RED) << "Failed to connect to walletd: " << e.what() << ENDL;
-    return false;
+    return 0;
   }
 
-  uint32_t fusionReadyCount = res.fusionReadyCount;
-  if (fusionReadyCount > 0) {
-    logger(INFO, GREEN) << "Eligible Wallet: " << address << " Outputs: " << fusionReadyCount;
-    return true;
-  }
-
-  return false;
+  return res.fusionReadyCount;
 }
 
-bool optimizeWallet(po::variables_map& vm, std::string address) {
-  uint64_t threshold = DEFAULT_THRESHOLD;
-  uint16_t anonymity = 0;
-
-  if (command_line::has_arg(vm, arg_threshold)) {
-    threshold = command_line::get_arg(vm, arg_threshold);
-  }
-  if (command_line::has_arg(vm, arg_anonimity)) {
-    anonymity = command_line::get_arg(vm, arg_anonimity);
-  }
-
+bool optimizeWallet(po::variables_map& vm, HttpClient& httpClient, const std::string& address) {
   PaymentService::SendFusionTransaction::Request req;
   PaymentService::SendFusionTransaction::Response res;
 
-  req.threshold = threshold;
-  req.anonymity = anonymity;
+  req.threshold = getThreshold(vm);
+  req.anonymity = getAnonymity(vm);
   req.addresses.push_back(address);
   req.destinationAddress = address;
 
   try {
     logger(INFO, GREEN) << "Optimizing wallet  : " << address;
-    HttpClient httpClient(dispatcher, command_line::get_arg(vm, arg_ip), command_line::get_arg(vm, arg_rpc_port));
-    if (command_line::has_arg(vm, arg_user) && command_line::has_arg(vm, arg_pass)) {
-      JsonRpc::invokeJsonRpcCommand(httpClient, "sendFusionTransaction", req, res, command_line::get_arg(vm, arg_user), command_line::get_arg(vm, arg_pass));
-    }
-    else {
-      JsonRpc::invokeJsonRpcCommand(httpClient, "sendFusionTransaction", req, res);
-    }
+    invoke(vm, httpClient, "sendFusionTransaction", req, res);
   }
   catch (const std::exception& e) {
     logger(ERROR, RED) << "Failed in wallet: " << address << " due to: " << e.what() << ENDL;
@@ -185,9 +181,56 @@ bool optimizeWallet(po::variables_map& vm, std::string address) {
   return true;
 }
 
-void processWallets(po::variables_map& vm, std::vector<std::string>& containerAddresses, int& optimized, int& notOptimized, const std::chrono::time_point<std::chrono::steady_clock>& start) {
+// Delay between fusion transactions, shared by all pipelines since they feed the same pool:
+// shrinks while the node accepts them and doubles when it starts rejecting
+class FusionPacing {
+public:
+  FusionPacing(std::chrono::milliseconds initial, std::chrono::milliseconds maximum) :
+    m_delay(initial), m_maximum(maximum) {
+  }
+
+  std::chrono::milliseconds delay() const {
+    return m_delay;
+  }
+
+  void accepted() {
+    m_delay = std::max(MIN_DELAY, m_delay * 3 / 4);
+  }
+
+  void rejected() {
+    m_delay = std::min(m_maximum, m_delay * 2);
+  }
+
+private:
+  static constexpr std::chrono::milliseconds MIN_DELAY{250};
+
+  std::chrono::milliseconds m_delay;
+  const std::chrono::milliseconds m_maximum;
+};
+
+constexpr std::chrono::milliseconds FusionPacing::MIN_DELAY;
+
+struct OptimizationTotals {
+  int optimized = 0;
+  int notOptimized = 0;
+  uint64_t fusionTransactions = 0;
+  uint64_t failedTransactions = 0;
+  uint64_t estimatedRounds = 0;
+};
+
+// Fusion transactions needed to merge fusionReadyCount outputs: each one takes at most
+// maxInputs of them and walletd refuses to build one from fewer than the minimum
+uint64_t estimateRounds(uint32_t fusionReadyCount, size_t maxInputs) {
+  if (fusionReadyCount < CryptoNote::parameters::FUSION_TX_MIN_INPUT_COUNT) {
+    return 0;
+  }
+  return (fusionReadyCount + maxInputs - 1) / maxInputs;
+}
+
+void processWallets(po::variables_map& vm, std::vector<std::string>& containerAddresses, OptimizationTotals& totals, const std::chrono::time_point<std::chrono::steady_clock>& start) {
   uint16_t timeInterval = 5;
   int32_t maxDuration = 0;
+  uint16_t threads = 4;
   if (command_line::has_arg(vm, arg_interval)) {
     timeInterval = command_line::get_arg(vm, arg_interval);
     if (timeInterval > 120) timeInterval = 120;
@@ -196,51 +239,93 @@ void processWallets(po::variables_map& vm, std::vector<std::string>& containerAd
   if (command_line::has_arg(vm, arg_duration)) {
     maxDuration = command_line::get_arg(vm, arg_duration);
   }
-  bool previewMode = false;
-  uint32_t count = 0;
-  uint8_t steps = 0;
-  size_t total = containerAddresses.size();
-  if (total > 10000) {
-    steps = 100;
-  } else {
-    steps = 10;
-  }
-  if (command_line::has_arg(vm, arg_preview)) {
-    previewMode = true;
+  if (command_line::has_arg(vm, arg_threads)) {
+    threads = command_line::get_arg(vm, arg_threads);
+    if (threads > 64) threads = 64;
+    if (threads < 1) threads = 1;
   }
-  for (const auto& address : containerAddresses) {
-    if (isWalletEligible(vm, address)) {
-      if (previewMode) {
-        //logger(INFO, GREEN) << "Optimizable wallet   : " << address << ENDL;
-        optimized++;
-      } else {
-        if (optimized > 0) {
-          logger(INFO, GREEN) << "Sleeping for " << timeInterval << " seconds." << ENDL;
-          std::this_thread::sleep_for(std::chrono::seconds(timeInterval));
-        }
-        if (optimizeWallet(vm, address)) {
-          optimized++;
+  bool previewMode = command_line::has_arg(vm, arg_preview);
+  uint32_t steps = containerAddresses.size() > 10000 ? 100 : 10;
+
+  Logging::ConsoleLogger currencyLog(Logging::ERROR);
+  const CryptoNote::Currency currency = CryptoNote::CurrencyBuilder(currencyLog).currency();
+  const size_t MAX_FUSION_OUTPUT_COUNT = 8;
+  const size_t maxInputs = std::max<size_t>(1, currency.getApproximateMaximumInputCount(currency.fusionTxMaxSize(), MAX_FUSION_OUTPUT_COUNT, getAnonymity(vm)));
+
+  // --interval is where pacing starts; it then follows how the node takes the transactions
+  FusionPacing pacing(std::chrono::seconds(timeInterval), std::chrono::seconds(120));
+  auto deadlineReached = [&]() {
+    return maxDuration > 0 &&
+      std::chrono::duration_cast<std::chrono::minutes>(std::chrono::steady_clock::now() - start).count() >= maxDuration;
+  };
+
+  // The pipelines are contexts on the one dispatcher: the work is waiting for walletd, so each
+  // gets its own connection and they interleave while the others wait for replies
+  size_t next = 0;
+  uint32_t count = 0;
+  bool stopped = false;
+  System::ContextGroup pipelines(dispatcher);
+  for (uint16_t i = 0; i < threads; ++i) {
+    pipelines.spawn([&]() {
+      HttpClient httpClient(dispatcher, command_line::get_arg(vm, arg_ip), command_line::get_arg(vm, arg_rpc_port));
+      System::Timer timer(dispatcher);
+
+      while (!stopped && next < containerAddresses.size()) {
+        const std::string& address = containerAddresses[next++];
+        uint32_t fusionReadyCount = getFusionReadyCount(vm, httpClient, address);
+        uint64_t rounds = estimateRounds(fusionReadyCount, maxInputs);
+
+        if (rounds == 0) {
+          totals.notOptimized++;
+        } else if (previewMode) {
+          logger(INFO, GREEN) << "Eligible Wallet: " << address << " Outputs: " << fusionReadyCount << " Estimated rounds: " << rounds;
+          totals.estimatedRounds += rounds;
+          totals.optimized++;
         } else {
-          notOptimized++;
+          logger(INFO, GREEN) << "Eligible Wallet: " << address << " Outputs: " << fusionReadyCount;
+          // Keep fusing the address until walletd has nothing left or keeps failing on it
+          uint32_t sent = 0;
+          uint32_t failures = 0;
+          while (rounds > 0 && failures < 3 && !stopped) {
+            timer.sleep(pacing.delay());
+            if (optimizeWallet(vm, httpClient, address)) {
+              pacing.accepted();
+              totals.fusionTransactions++;
+              sent++;
+              failures = 0;
+            } else {
+              pacing.rejected();
+              totals.failedTransactions++;
+              failures++;
+            }
+
+            if (deadlineReached()) {
+              logger(INFO, GREEN) << "Maximum duration time reached." << ENDL;
+              stopped = true;
+            } else {
+              rounds = estimateRounds(getFusionReadyCount(vm, httpClient, address), maxInputs);
+            }
+          }
+
+          if (sent > 0) {
+            totals.optimized++;
+          } else {
+            totals.notOptimized++;
+          }
+        }
+
+        count++;
+        if (count % steps == 0) {
+          logger(INFO, GREEN) << "Scanned " << count << " wallets." << ENDL;
+        }
+        if (!stopped && deadlineReached()) {
+          logger(INFO, GREEN) << "Maximum duration time reached." << ENDL;
+          stopped = true;
         }
       }
-    } else {
-      //logger(INFO, GREEN) << "Wallet not eligible: " << address << ENDL;
-      notOptimized++;
-    }
-    count++;
-    if (count % steps == 0) {
-      logger(INFO, GREEN) << "Scanned " << count << " wallets." << ENDL;
-    }
-    if (maxDuration > 0) {
-      auto dur = std::chrono::steady_clock::now() - start;
-      if(std::chrono::duration_cast<std::chrono::minutes>(dur).count() >= maxDuration) {
-        logger(INFO, GREEN) << "Maximum duration time reached." << ENDL;
-        break;
-      }
-    }
+    });
   }
-  return;
+  pipelines.wait();
 }
 
 bool canConnect(po::variables_map& vm) {
@@ -274,9 +359,10 @@ bool run_optimizer(po::variables_map& vm) {
     } else {
       logger(INFO, YELLOW) << "Starting optimizing. There are " << addresses.size() << " wallets in this container." << ENDL;
     }
-    int optimized = 0;
-    int notOptimized = 0;
-    processWallets(vm, addresses, optimized, notOptimized, start);
+    OptimizationTotals totals;
+    processWallets(vm, addresses, totals, start);
+    int optimized = totals.optimized;
+    int notOptimized = totals.notOptimized;
     int processed = optimized + notOptimized;
     auto dur = std::chrono::steady_clock::now() - start;
     logger(INFO, YELLOW) << "Optimizing finished." << ENDL;
@@ -285,9 +371,12 @@ bool run_optimizer(po::variables_map& vm) {
       if (command_line::has_arg(vm, arg_preview)) {
         std::cout << "   Optimizable wallets     : " << optimized << ENDL;
         std::cout << "   Non optimizable wallets : " << notOptimized << ENDL;
+        std::cout << "   Estimated fusion rounds : " << totals.estimatedRounds << ENDL;
       } else {
         std::cout << "   Wallets optimized       : " << optimized << ENDL;
         std::cout << "   Wallets not optimized   : " << notOptimized << ENDL;
+        std::cout << "   Fusion transactions     : " << totals.fusionTransactions << ENDL;
+        std::cout << "   Failed fusions          : " << totals.failedTransactions << ENDL;
       }
       std::cout   << "   Scanned wallets         : " << processed << ENDL;
       std::cout   << "   Total of wallets found  : " << addresses.size() << ENDL;
@@ -314,6 +403,7 @@ int main(int argc, char *argv[]) {
   command_line::add_arg(desc_params, arg_threshold);
   command_line::add_arg(desc_params, arg_anonimity);
   command_line::add_arg(desc_params, arg_preview);
+  command_line::add_arg(desc_params, arg_threads);
 
   po::options_description desc_all;
   desc_all.add(desc_general).add(desc_params);
@@ -14,6 +14,8 @@
 #include <boost/optional.hpp>
 #include <boost/uuid/uuid.hpp>
 #include "Common/StringTools.h"
+#include "CryptoNoteConfig.h"
+#include "P2p/KnownInventory.h"
 #include "P2p/PendingLiteBlock.h"
 #include "crypto/hash.h"
 
@@ -39,6 +41,12 @@ struct CryptoNoteConnectionContext {
 
   state m_state = state_befor_handshake;
   boost::optional<PendingLiteBlock> m_pending_lite_block;
+  boost::optional<PendingCompactBlock> m_pending_compact_block;
+  bool m_supports_compact_blocks = false;
+  bool m_supports_pool_short_ids = false;
+  // transactions and blocks the peer is known to have, those are not relayed to it
+  KnownInventory m_known_transactions{P2P_KNOWN_TRANSACTIONS_LIMIT};
+  KnownInventory m_known_blocks{P2P_KNOWN_BLOCKS_LIMIT};
   std::list<Crypto::Hash> m_needed_objects;
   std::unordered_set<Crypto::Hash> m_requested_objects;
   uint32_t m_remote_blockchain_height = 0;
@@ -0,0 +1,68 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <unordered_set>
+
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+// Bounded set of hashes a peer is known to have. Inserts go to the current
+// generation; when it holds capacity / 2 hashes it replaces the previous one,
+// so the most recent capacity / 2 to capacity hashes are remembered and old
+// ones age out without ever dropping everything at once.
+class KnownInventory {
+public:
+  explicit KnownInventory(size_t capacity) : m_generationSize(capacity / 2 > 0 ? capacity / 2 : 1) {
+  }
+
+  bool contains(const Crypto::Hash& hash) const {
+    return m_current.count(hash) != 0 || m_previous.count(hash) != 0;
+  }
+
+  void insert(const Crypto::Hash& hash) {
+    if (m_current.count(hash) != 0) {
+      return;
+    }
+
+    if (m_current.size() >= m_generationSize) {
+      m_previous.swap(m_current);
+      m_current.clear();
+    }
+
+    m_current.insert(hash);
+  }
+
+  void erase(const Crypto::Hash& hash) {
+    m_current.erase(hash);
+    m_previous.erase(hash);
+  }
+
+  size_t size() const {
+    return m_current.size() + m_previous.size();
+  }
+
+private:
+  size_t m_generationSize;
+  std::unordered_set<Crypto::Hash> m_current;
+  std::unordered_set<Crypto::Hash> m_previous;
+};
+
+}
@@ -16,6 +16,7 @@
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 
 #include "LevinProtocol.h"
+#include <Common/Metrics.h>
 #include <System/TcpConnection.h>
 
 using namespace CryptoNote;
@@ -27,6 +28,8 @@ const uint32_t LEVIN_PACKET_REQUEST = 0x00000001;
 const uint32_t LEVIN_PACKET_RESPONSE = 0x00000002;
 const uint32_t LEVIN_DEFAULT_MAX_PACKET_SIZE = 100000000;      //100MB by default
 const uint32_t LEVIN_PROTOCOL_VER_1 = 1;
+// a connection keeps its receive buffer between commands unless a message made it grow past this
+const size_t LEVIN_RETAINED_BUFFER_SIZE = 1024 * 1024;
 
 #pragma pack(push)
 #pragma pack(1)
@@ -42,6 +45,16 @@ struct bucket_head2
 };
 #pragma pack(pop)
 
+void countReceived(uint32_t command, size_t bytes) {
+  Common::Metrics::instance().counter("fuego_levin_bytes_received_total", "Levin bytes received, header included",
+    "command=\"" + std::to_string(command) + "\"").add(bytes);
+}
+
+void countSent(uint32_t command, size_t bytes) {
+  Common::Metrics::instance().counter("fuego_levin_bytes_sent_total", "Levin bytes sent, header included",
+    "command=\"" + std::to_string(command) + "\"").add(bytes);
+}
+
 }
 
 bool LevinProtocol::Command::needReply() const {
@@ -60,15 +73,9 @@ void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool n
   head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
   head.m_flags = LEVIN_PACKET_REQUEST;
 
-  // write header and body in one operation
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  // header and body go out in one gather write, the body is not copied
+  writeStrict(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out.data(), out.size());
+  countSent(command, sizeof(head) + out.size());
 }
 
 bool LevinProtocol::readCommand(Command& cmd) {
@@ -86,19 +93,22 @@ bool LevinProtocol::readCommand(Command& cmd) {
     throw std::runtime_error("Levin packet size is too big");
   }
 
-  BinaryArray buf;
+  // the body is read into the buffer of the previous command, callers that reuse cmd avoid an allocation per message
+  if (cmd.buf.capacity() > LEVIN_RETAINED_BUFFER_SIZE && head.m_cb <= LEVIN_RETAINED_BUFFER_SIZE) {
+    BinaryArray().swap(cmd.buf);
+  }
 
+  cmd.buf.resize(head.m_cb);
   if (head.m_cb != 0) {
-    buf.resize(head.m_cb);
-    if (!readStrict(&buf[0], head.m_cb)) {
+    if (!readStrict(&cmd.buf[0], head.m_cb)) {
       return false;
     }
   }
 
   cmd.command = head.m_command;
-  cmd.buf = std::move(buf);
   cmd.isNotify = !head.m_have_to_return_data;
   cmd.isResponse = (head.m_flags & LEVIN_PACKET_RESPONSE) == LEVIN_PACKET_RESPONSE;
+  countReceived(cmd.command, sizeof(head) + head.m_cb);
 
   return true;
 }
@@ -113,20 +123,19 @@ void LevinProtocol::sendReply(uint32_t command, const BinaryArray& out, int32_t
   head.m_flags = LEVIN_PACKET_RESPONSE;
   head.m_return_code = returnCode;
 
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  writeStrict(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out.data(), out.size());
+  countSent(command, sizeof(head) + out.size());
 }
 
-void LevinProtocol::writeStrict(const uint8_t* ptr, size_t size) {
+void LevinProtocol::writeStrict(const uint8_t* head, size_t headSize, const uint8_t* data, size_t size) {
   size_t offset = 0;
+  while (offset < headSize) {
+    offset += m_conn.write(head + offset, headSize - offset, data, size);
+  }
+
+  offset -= headSize;
   while (offset < size) {
-    offset += m_conn.write(ptr + offset, size - offset);
+    offset += m_conn.write(data + offset, size - offset);
   }
 }
 
@@ -26,12 +26,14 @@
 #include <System/InterruptedException.h>
 #include <System/Ipv4Address.h>
 #include <System/Ipv4Resolver.h>
+#include <System/RemoteContext.h>
 #include <System/TcpListener.h>
 #include <System/TcpConnector.h>
 
 #include "version.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
+#include "Common/StringOutputStream.h"
 #include "Common/Util.h"
 #include "crypto/crypto.h"
 
@@ -61,6 +63,19 @@ size_t get_random_index_with_fixed_probability(size_t max_index) {
   return (x * x * x ) / (max_index * max_index); //parabola \/
 }
 
+// writes next to the state file and swaps it in, a crash mid-write keeps the previous state
+bool writeStateFile(const std::string& path, const std::string& state) {
+  std::string tempPath = path + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    if (!file.write(state.data(), state.size())) {
+      return false;
+    }
+  }
+
+  return !Tools::replace_file(tempPath, path);
+}
+
 void addPortMapping(Logging::LoggerRef& logger, uint32_t port) {
   // Add UPnP port mapping
   logger(INFO) <<  "Attempting to add IGD port mapping.";
@@ -147,6 +162,31 @@ namespace CryptoNote
   // P2pConnectionContext implementation
   //-----------------------------------------------------------------------------------
 
+  P2pMessage::Priority P2pMessage::priority() const {
+    if (type != NOTIFY) {
+      return PRIORITY_CONTROL;
+    }
+
+    switch (command) {
+    case NOTIFY_NEW_BLOCK::ID:
+    case NOTIFY_NEW_LITE_BLOCK::ID:
+    case NOTIFY_MISSING_TXS::ID:
+    case NOTIFY_NEW_COMPACT_BLOCK::ID:
+    case NOTIFY_REQUEST_COMPACT_TXS::ID:
+    case NOTIFY_RESPONSE_COMPACT_TXS::ID:
+      return PRIORITY_BLOCK;
+    case NOTIFY_RESPONSE_GET_OBJECTS::ID:
+    case NOTIFY_RESPONSE_CHAIN_ENTRY::ID:
+      return PRIORITY_BULK;
+    case NOTIFY_NEW_TRANSACTIONS::ID:
+    case NOTIFY_REQUEST_TX_POOL::ID:
+    case NOTIFY_REQUEST_TX_POOL_SHORT_IDS::ID:
+      return PRIORITY_TRANSACTION;
+    default:
+      return PRIORITY_CONTROL;
+    }
+  }
+
   bool P2pConnectionContext::pushMessage(P2pMessage&& msg) {
     writeQueueSize += msg.size();
 
@@ -156,7 +196,8 @@ namespace CryptoNote
       return false;
     }
 
-    writeQueue.push_back(std::move(msg));
+    writeQueues[msg.priority()].push_back(std::move(msg));
+    ++writeQueueCount;
     queueEvent.set();
     return true;
   }
@@ -164,15 +205,33 @@ namespace CryptoNote
   std::vector<P2pMessage> P2pConnectionContext::popBuffer() {
     writeOperationStartTime = TimePoint();
 
-    while (writeQueue.empty() && !stopped) {
+    while (writeQueueCount == 0 && !stopped) {
       queueEvent.wait();
     }
 
-    std::vector<P2pMessage> msgs(std::move(writeQueue));
-    writeQueue.clear();
-    writeQueueSize = 0;
+    std::vector<P2pMessage> msgs;
+    for (size_t i = 0; i < P2pMessage::PRIORITY_COUNT; ++i) {
+      std::deque<P2pMessage>& queue = writeQueues[i];
+      if (queue.empty()) {
+        continue;
+      }
+
+      size_t count = i == P2pMessage::PRIORITY_BULK ? 1 : queue.size();
+      for (size_t j = 0; j < count; ++j) {
+        writeQueueSize -= queue.front().size();
+        msgs.push_back(std::move(queue.front()));
+        queue.pop_front();
+      }
+
+      writeQueueCount -= count;
+      break;
+    }
+
     writeOperationStartTime = Clock::now();
-    queueEvent.clear();
+    if (writeQueueCount == 0) {
+      queueEvent.clear();
+    }
+
     return msgs;
   }
 
@@ -222,7 +281,7 @@ namespace CryptoNote
     // intervals
     // m_peer_handshake_idle_maker_interval(CryptoNote::P2P_DEFAULT_HANDSHAKE_INTERVAL),
     m_connections_maker_interval(1),
-    m_peerlist_store_interval(60 * 30, false) {
+    m_peerlist_store_interval(P2P_PEERLIST_STORE_INTERVAL, false) {
   }
 
   void NodeServer::serialize(ISerializer& s) {
@@ -347,21 +406,25 @@ namespace CryptoNote
   //-----------------------------------------------------------------------------------
   void NodeServer::externalRelayNotifyToAll(int command, const BinaryArray &data_buff, const net_connection_id *excludeConnection)
   {
-    m_dispatcher.remoteSpawn([this, command, data_buff, excludeConnection] {
-      relay_notify_to_all(command, data_buff, excludeConnection);
+    // the payload is copied once here and then shared by every write queue
+    auto payload = std::make_shared<const BinaryArray>(data_buff);
+    net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
+    m_dispatcher.remoteSpawn([this, command, payload, excludeId] {
+      relayToAll(command, payload, excludeId);
     });
   }
 
   //-----------------------------------------------------------------------------------
   void NodeServer::externalRelayNotifyToList(int command, const BinaryArray &data_buff, const std::list<boost::uuids::uuid> relayList)
   {
-    m_dispatcher.remoteSpawn([this, command, data_buff, relayList] {
+    auto payload = std::make_shared<const BinaryArray>(data_buff);
+    m_dispatcher.remoteSpawn([this, command, payload, relayList] {
       forEachConnection([&](P2pConnectionContext &conn) {
         if (std::find(relayList.begin(), relayList.end(), conn.m_connection_id) != relayList.end())
         {
           if (conn.peerId && (conn.m_state == CryptoNoteConnectionContext::state_normal || conn.m_state == CryptoNoteConnectionContext::state_synchronizing))
           {
-            conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
+            conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, payload));
           }
         }
       });
@@ -536,6 +599,7 @@ namespace CryptoNote
     std::copy(seedNodes.begin(), seedNodes.end(), std::back_inserter(m_seed_nodes));
 
     m_hide_my_port = config.getHideMyPort();
+    m_uploadLimiter.setRate(static_cast<uint64_t>(config.getUploadLimit()) * 1024);
     return true;
   }
 
@@ -658,30 +722,43 @@ namespace CryptoNote
   //-----------------------------------------------------------------------------------
 
   bool NodeServer::deinit()  {
-    return store_config();
+    return store_config(false);
   }
 
   //-----------------------------------------------------------------------------------
 
-  bool NodeServer::store_config()
+  bool NodeServer::store_config(bool inBackground)
   {
+    // periodic flushes only write when the peerlist changed, and only the
+    // snapshot is taken on the dispatcher; the file write runs on another thread
+    if (inBackground && !m_peerlist.is_dirty()) {
+      return true;
+    }
+
     try {
       if (!Tools::create_directories_if_necessary(m_config_folder)) {
         logger(INFO) <<  "Failed to create data directory: " << m_config_folder;
         return false;
       }
 
+      std::string state;
+      {
+        StringOutputStream stream(state);
+        BinaryOutputStreamSerializer a(stream);
+        CryptoNote::serialize(*this, a);
+      }
+
+      m_peerlist.clear_dirty();
+
       std::string state_file_path = m_config_folder + "/" + m_p2p_state_filename;
-      std::ofstream p2p_data;
-      p2p_data.open(state_file_path, std::ios_base::binary | std::ios_base::out | std::ios::trunc);
-      if (p2p_data.fail())  {
+      bool written = inBackground ?
+        System::RemoteContext<bool>(m_dispatcher, [&state_file_path, &state] { return writeStateFile(state_file_path, state); }).get() :
+        writeStateFile(state_file_path, state);
+      if (!written) {
         logger(INFO) <<  "Failed to save config to file " << state_file_path;
         return false;
-      };
+      }
 
-      StdOutputStream stream(p2p_data);
-      BinaryOutputStreamSerializer a(stream);
-      CryptoNote::serialize(*this, a);
       return true;
     } catch (const std::exception& e) {
       logger(WARNING) << "store_config failed: " << e.what();
@@ -709,6 +786,8 @@ namespace CryptoNote
     COMMAND_HANDSHAKE::response rsp;
     get_local_node_data(arg.node_data);
     m_payload_handler.get_payload_sync_data(arg.payload_data);
+    // the next timed sync brings the head of its peerlist anyway
+    arg.skip_peerlist = !just_take_peerlist && is_recent(get_recent_peer(context.m_remote_ip, context.m_remote_port).peerlistTaken);
 
     if (!proto.invoke(COMMAND_HANDSHAKE::ID, arg, rsp)) {
       logger(Logging::DEBUGGING) << context << "Failed to invoke COMMAND_HANDSHAKE, closing connection.";
@@ -741,6 +820,10 @@ namespace CryptoNote
       return false;
     }
 
+    if (!arg.skip_peerlist) {
+      get_recent_peer(context.m_remote_ip, context.m_remote_port).peerlistTaken = time(nullptr);
+    }
+
     if (just_take_peerlist) {
       return true;
     }
@@ -772,6 +855,7 @@ namespace CryptoNote
       if (conn.peerId &&
           (conn.m_state == CryptoNoteConnectionContext::state_normal ||
            conn.m_state == CryptoNoteConnectionContext::state_idle)) {
+        conn.timedSyncSent = P2pConnectionContext::Clock::now();
         conn.pushMessage(P2pMessage(P2pMessage::COMMAND, COMMAND_TIMED_SYNC::ID, cmdBuf));
       }
     });
@@ -792,6 +876,12 @@ namespace CryptoNote
 
     if (!context.m_is_income) {
       m_peerlist.set_peer_just_seen(context.peerId, context.m_remote_ip, context.m_remote_port);
+
+      if (context.timedSyncSent != P2pConnectionContext::TimePoint()) {
+        auto rtt = std::chrono::duration_cast<std::chrono::milliseconds>(P2pConnectionContext::Clock::now() - context.timedSyncSent);
+        context.timedSyncSent = P2pConnectionContext::TimePoint();
+        m_peerlist.record_peer_rtt(NetworkAddress{context.m_remote_ip, context.m_remote_port}, static_cast<uint32_t>(rtt.count()));
+      }
     }
 
     if (!m_payload_handler.process_payload_sync_data(rsp.payload_data, context, false)) {
@@ -849,6 +939,7 @@ namespace CryptoNote
 
     try {
       System::TcpConnection connection;
+      auto connectStart = std::chrono::steady_clock::now();
 
       try {
         System::Context<System::TcpConnection> connectionContext(m_dispatcher, [&] {
@@ -865,9 +956,13 @@ namespace CryptoNote
         connection = std::move(connectionContext.get());
       } catch (System::InterruptedException&) {
         logger(DEBUGGING) << "Connection timed out";
+        m_peerlist.record_peer_rtt(na, m_config.m_net_config.connection_timeout);
         return false;
       }
 
+      // a TCP connect takes one round trip
+      auto connectTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - connectStart);
+
       P2pConnectionContext ctx(m_dispatcher, logger.getLogger(), std::move(connection));
 
       ctx.m_connection_id = boost::uuids::random_generator()();
@@ -909,6 +1004,7 @@ namespace CryptoNote
       pe_local.id = ctx.peerId;
       pe_local.last_seen = time(nullptr);
       m_peerlist.append_with_peer_white(pe_local);
+      m_peerlist.record_peer_rtt(na, static_cast<uint32_t>(connectTime.count()));
 
       AnchorPeerlistEntry ape = boost::value_initialized<AnchorPeerlistEntry>();
       ape.adr = na;
@@ -940,6 +1036,13 @@ namespace CryptoNote
   //-----------------------------------------------------------------------------------
   bool NodeServer::make_new_connection_from_peerlist(bool use_white_list)
   {
+    // most white list picks go to the best measured peers, the rest stay
+    // random so that a few fast peers cannot monopolize our outgoing slots
+    if (use_white_list && Crypto::rand<size_t>() % 100 >= P2P_RANDOM_OUTGOING_CONNECTIONS_PERCENT &&
+        make_new_connection_from_ranked_peerlist()) {
+      return true;
+    }
+
     size_t local_peers_count = use_white_list ? m_peerlist.get_white_peers_count():m_peerlist.get_gray_peers_count();
     if(!local_peers_count)
       return false;//no peers
@@ -980,6 +1083,39 @@ namespace CryptoNote
   }
   //-----------------------------------------------------------------------------------
 
+  bool NodeServer::make_new_connection_from_ranked_peerlist()
+  {
+    std::vector<PeerlistEntry> ranked;
+    if (!m_peerlist.get_ranked_white_peers(ranked, P2P_RANKED_PEERS_CANDIDATES)) {
+      return false;
+    }
+
+    size_t try_count = 0;
+    for (const PeerlistEntry& pe : ranked) {
+      if (m_stop || try_count >= 3) {
+        break;
+      }
+
+      if (is_peer_used(pe) || is_addr_recently_failed(pe.adr.ip)) {
+        continue;
+      }
+
+      ++try_count;
+
+      PeerQuality quality = PeerQuality();
+      m_peerlist.get_peer_quality(pe.adr, quality);
+      logger(DEBUGGING) << "Selected ranked peer: " << pe.id << " " << pe.adr << " rtt: " << quality.rtt_ms
+                        << " ms, received: " << quality.bytes_received << " bytes in " << quality.connected_seconds << " s";
+
+      if (try_to_connect_and_handshake_with_new_peer(pe.adr, false, pe.last_seen, white)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+  //-----------------------------------------------------------------------------------
+
   bool NodeServer::make_new_connection_from_anchor_peerlist(const std::vector<AnchorPeerlistEntry> &anchor_peerlist)
   {
     for (const auto &pe : anchor_peerlist)
@@ -1128,13 +1264,42 @@ namespace CryptoNote
       try
       {
         m_connections_maker_interval.call(std::bind(&NodeServer::connections_maker, this));
-        m_peerlist_store_interval.call(std::bind(&NodeServer::store_config, this));
+        m_peerlist_store_interval.call(std::bind(&NodeServer::store_config, this, true));
       } catch (std::exception& e) {
       logger(DEBUGGING) << "exception in idle_worker: " << e.what();
     }
     return true;
   }
 
+  //-----------------------------------------------------------------------------------
+  bool NodeServer::is_recent(time_t stamp) const {
+    return stamp != 0 && time(nullptr) - stamp < static_cast<time_t>(P2P_HANDSHAKE_RESUME_WINDOW);
+  }
+
+  NodeServer::RecentPeer& NodeServer::get_recent_peer(uint32_t ip, uint32_t port) {
+    uint64_t key = static_cast<uint64_t>(ip) << 32 | port;
+    auto it = m_recentPeers.find(key);
+    if (it != m_recentPeers.end()) {
+      return it->second;
+    }
+
+    if (m_recentPeers.size() >= P2P_RECENT_PEERS_LIMIT) {
+      for (auto i = m_recentPeers.begin(); i != m_recentPeers.end();) {
+        if (!is_recent(i->second.backPinged) && !is_recent(i->second.peerlistTaken)) {
+          i = m_recentPeers.erase(i);
+        } else {
+          ++i;
+        }
+      }
+
+      if (m_recentPeers.size() >= P2P_RECENT_PEERS_LIMIT) {
+        m_recentPeers.clear();
+      }
+    }
+
+    return m_recentPeers.emplace(key, RecentPeer{ 0, 0, 0 }).first->second;
+  }
+
   //-----------------------------------------------------------------------------------
   bool NodeServer::fix_time_delta(std::list<PeerlistEntry>& local_peerlist, time_t local_time, int64_t& delta)
   {
@@ -1268,12 +1433,15 @@ namespace CryptoNote
 
   void NodeServer::relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) {
     net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
+    relayToAll(command, std::make_shared<const BinaryArray>(data_buff), excludeId);
+  }
 
+  void NodeServer::relayToAll(int command, const std::shared_ptr<const BinaryArray>& payload, const net_connection_id& excludeId) {
     forEachConnection([&](P2pConnectionContext& conn) {
       if (conn.peerId && conn.m_connection_id != excludeId &&
           (conn.m_state == CryptoNoteConnectionContext::state_normal ||
            conn.m_state == CryptoNoteConnectionContext::state_synchronizing)) {
-        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
+        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, payload));
       }
     });
   }
@@ -1403,7 +1571,16 @@ namespace CryptoNote
       PeerIdType peer_id_l = arg.node_data.peer_id;
       uint32_t port_l = arg.node_data.my_port;
 
-      if (try_ping(arg.node_data, context)) {
+      // a peer reconnecting from the address it was pinged at moments ago needs no second back ping
+      RecentPeer& recent = get_recent_peer(context.m_remote_ip, port_l);
+      bool pinged = recent.peerId == peer_id_l && is_recent(recent.backPinged);
+      if (!pinged && try_ping(arg.node_data, context)) {
+        recent.peerId = peer_id_l;
+        recent.backPinged = time(nullptr);
+        pinged = true;
+      }
+
+      if (pinged) {
           //called only(!) if success pinged, update local peerlist
           PeerlistEntry pe;
           pe.adr.ip = context.m_remote_ip;
@@ -1417,7 +1594,9 @@ namespace CryptoNote
     }
 
     //fill response
-    m_peerlist.get_peerlist_head(rsp.local_peerlist);
+    if (!arg.skip_peerlist) {
+      m_peerlist.get_peerlist_head(rsp.local_peerlist);
+    }
     get_local_node_data(rsp.node_data);
     m_payload_handler.get_payload_sync_data(rsp.payload_data);
 
@@ -1490,6 +1669,10 @@ namespace CryptoNote
       na.port = context.m_remote_port;
 
       m_peerlist.remove_from_peer_anchor(na);
+
+      if (context.peerId != 0) {
+        m_peerlist.record_peer_session(na, context.bytesReceived, time(nullptr) - context.m_started);
+      }
     }
 
     logger(TRACE) << context << "CLOSE CONNECTION";
@@ -1637,6 +1820,8 @@ namespace CryptoNote
             break;
           }
 
+          ctx.bytesReceived += cmd.buf.size();
+
           BinaryArray response;
           bool handled = false;
           auto retcode = handleCommand(cmd, response, ctx, handled);
@@ -1692,15 +1877,23 @@ namespace CryptoNote
 
         for (const auto& msg : msgs) {
           logger(DEBUGGING) << ctx << "msg " << msg.type << ':' << msg.command;
+          if (m_uploadLimiter.limited() && msg.priority() >= P2pMessage::PRIORITY_TRANSACTION) {
+            auto delay = m_uploadLimiter.take(msg.buffer().size());
+            if (delay.count() > 0) {
+              System::Timer(m_dispatcher).sleep(delay);
+              ctx.restartWriteTimer();
+            }
+          }
+
           switch (msg.type) {
           case P2pMessage::COMMAND:
-            proto.sendMessage(msg.command, msg.buffer, true);
+            proto.sendMessage(msg.command, msg.buffer(), true);
             break;
           case P2pMessage::NOTIFY:
-            proto.sendMessage(msg.command, msg.buffer, false);
+            proto.sendMessage(msg.command, msg.buffer(), false);
             break;
           case P2pMessage::REPLY:
-            proto.sendReply(msg.command, msg.buffer, msg.returnCode);
+            proto.sendReply(msg.command, msg.buffer(), msg.returnCode);
             break;
           default:
             assert(false);
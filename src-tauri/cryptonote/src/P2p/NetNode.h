@@ -8,7 +8,9 @@
 
 #pragma once
 
+#include <deque>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
 #include <boost/functional/hash.hpp>
@@ -35,6 +37,7 @@
 #include "P2pProtocolDefinitions.h"
 #include "P2pNetworks.h"
 #include "PeerListManager.h"
+#include "TokenBucket.h"
 
 namespace System {
 class TcpConnection;
@@ -52,21 +55,45 @@ namespace CryptoNote
       NOTIFY
     };
 
+    // write order within a connection, most urgent first
+    enum Priority {
+      PRIORITY_CONTROL,      // p2p commands and replies
+      PRIORITY_BLOCK,        // block announcements and what completes them
+      PRIORITY_TRANSACTION,  // transaction relay
+      PRIORITY_BULK,         // chain sync responses
+      PRIORITY_COUNT
+    };
+
+    Priority priority() const;
+
     P2pMessage(Type type, uint32_t command, const BinaryArray& buffer, int32_t returnCode = 0) :
-      type(type), command(command), buffer(buffer), returnCode(returnCode) {
+      type(type), command(command), payload(std::make_shared<const BinaryArray>(buffer)), returnCode(returnCode) {
+    }
+
+    P2pMessage(Type type, uint32_t command, BinaryArray&& buffer, int32_t returnCode = 0) :
+      type(type), command(command), payload(std::make_shared<const BinaryArray>(std::move(buffer))), returnCode(returnCode) {
+    }
+
+    // a relayed payload is shared by the write queues of all connections
+    P2pMessage(Type type, uint32_t command, const std::shared_ptr<const BinaryArray>& payload, int32_t returnCode = 0) :
+      type(type), command(command), payload(payload), returnCode(returnCode) {
     }
 
     P2pMessage(P2pMessage&& msg) :
-      type(msg.type), command(msg.command), buffer(std::move(msg.buffer)), returnCode(msg.returnCode) {
+      type(msg.type), command(msg.command), payload(std::move(msg.payload)), returnCode(msg.returnCode) {
     }
 
     size_t size() {
-      return buffer.size();
+      return payload->size();
+    }
+
+    const BinaryArray& buffer() const {
+      return *payload;
     }
 
     Type type;
     uint32_t command;
-    const BinaryArray buffer;
+    std::shared_ptr<const BinaryArray> payload;
     int32_t returnCode;
   };
 
@@ -78,11 +105,14 @@ namespace CryptoNote
     System::Context<void>* context;
     PeerIdType peerId;
     System::TcpConnection connection;
+    uint64_t bytesReceived;
+    TimePoint timedSyncSent;  // epoch when no timed sync is outstanding
 
     P2pConnectionContext(System::Dispatcher& dispatcher, Logging::ILogger& log, System::TcpConnection&& conn) :
       context(nullptr),
       peerId(0),
       connection(std::move(conn)),
+      bytesReceived(0),
       logger(log, "node_server"),
       queueEvent(dispatcher),
       stopped(false) {
@@ -93,23 +123,35 @@ namespace CryptoNote
       context(ctx.context),
       peerId(ctx.peerId),
       connection(std::move(ctx.connection)),
+      bytesReceived(ctx.bytesReceived),
+      timedSyncSent(ctx.timedSyncSent),
       logger(ctx.logger.getLogger(), "node_server"),
       queueEvent(std::move(ctx.queueEvent)),
+      writeQueueSize(ctx.writeQueueSize),
+      writeQueueCount(ctx.writeQueueCount),
       stopped(std::move(ctx.stopped)) {
+      for (size_t i = 0; i < P2pMessage::PRIORITY_COUNT; ++i) {
+        writeQueues[i] = std::move(ctx.writeQueues[i]);
+      }
     }
 
     bool pushMessage(P2pMessage&& msg);
+    // messages of the most urgent non-empty priority class; bulk messages come
+    // one at a time so anything more urgent waits for at most one of them
     std::vector<P2pMessage> popBuffer();
     void interrupt();
 
     uint64_t writeDuration(TimePoint now) const;
+    // time spent waiting for upload budget does not count towards the write timeout
+    void restartWriteTimer() { writeOperationStartTime = Clock::now(); }
 
   private:
     Logging::LoggerRef logger;
     TimePoint writeOperationStartTime;
     System::Event queueEvent;
-    std::vector<P2pMessage> writeQueue;
+    std::deque<P2pMessage> writeQueues[P2pMessage::PRIORITY_COUNT];
     size_t writeQueueSize = 0;
+    size_t writeQueueCount = 0;
     bool stopped;
   };
 
@@ -149,6 +191,14 @@ namespace CryptoNote
       white,
       gray
     };
+
+    // what an earlier handshake with a peer already settled, so a reconnect within
+    // P2P_HANDSHAKE_RESUME_WINDOW doesn't have to do it again
+    struct RecentPeer {
+      PeerIdType peerId;
+      time_t backPinged;     // its listening port answered our ping
+      time_t peerlistTaken;  // we took its full peerlist in a handshake
+    };
     int handleCommand(const LevinProtocol::Command& cmd, BinaryArray& buff_out, P2pConnectionContext& context, bool& handled);
 
     //----------------- commands handlers ----------------------------------------------
@@ -164,7 +214,7 @@ namespace CryptoNote
 
     bool init_config();
     bool make_default_config();
-    bool store_config();
+    bool store_config(bool inBackground);
     bool check_trust(const proof_of_trust& tr);
     void initUpnp();
 
@@ -183,6 +233,7 @@ namespace CryptoNote
     virtual void for_each_connection(std::function<void(CryptoNote::CryptoNoteConnectionContext&, PeerIdType)> f) override;
     virtual void externalRelayNotifyToAll(int command, const BinaryArray &data_buff, const net_connection_id *excludeConnection) override;
     virtual void externalRelayNotifyToList(int command, const BinaryArray &data_buff, const std::list<boost::uuids::uuid> relayList) override;
+    void relayToAll(int command, const std::shared_ptr<const BinaryArray>& payload, const net_connection_id& excludeId);
     //-----------------------------------------------------------------------------------------------
     bool add_host_fail(const uint32_t address_ip);
     bool block_host(const uint32_t address_ip, time_t seconds = P2P_IP_BLOCKTIME);
@@ -200,12 +251,15 @@ namespace CryptoNote
 
     bool connections_maker();
     bool make_new_connection_from_peerlist(bool use_white_list);
+    bool make_new_connection_from_ranked_peerlist();
     bool make_new_connection_from_anchor_peerlist(const std::vector<AnchorPeerlistEntry> &anchor_peerlist);
     bool try_to_connect_and_handshake_with_new_peer(const NetworkAddress &na, bool just_take_peerlist = false, uint64_t last_seen_stamp = 0, PeerType peer_type = white, uint64_t first_seen_stamp = 0);
     bool is_peer_used(const PeerlistEntry &peer);
     bool is_peer_used(const AnchorPeerlistEntry &peer);
     bool is_addr_connected(const NetworkAddress& peer);
     bool try_ping(basic_node_data& node_data, P2pConnectionContext& context);
+    bool is_recent(time_t stamp) const;
+    RecentPeer& get_recent_peer(uint32_t ip, uint32_t port);
     bool make_expected_connections_count(PeerType peer_type, size_t expected_connections);
     bool is_priority_node(const NetworkAddress& na);
 
@@ -284,6 +338,8 @@ namespace CryptoNote
     boost::uuids::uuid m_network_id;
     std::map<uint32_t, time_t> m_blocked_hosts;
     std::map<uint32_t, uint64_t> m_host_fails_score;
+    std::unordered_map<uint64_t, RecentPeer> m_recentPeers; // by ip << 32 | port
+    TokenBucket m_uploadLimiter; // transaction relay and chain sync responses only
     mutable std::mutex mutex;
   };
 }
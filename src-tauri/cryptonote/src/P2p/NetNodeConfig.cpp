@@ -38,6 +38,8 @@ const command_line::arg_descriptor<std::vector<std::string> > arg_p2p_add_exclus
       " If this option is given the options add-priority-node and seed-node are ignored"};
 const command_line::arg_descriptor<std::vector<std::string> > arg_p2p_seed_node   = {"seed-node", "Connect to a node to retrieve peer addresses, and disconnect"};
 const command_line::arg_descriptor<bool> arg_p2p_hide_my_port   =    {"hide-my-port", "Do not announce yourself as peerlist candidate", false, true};
+const command_line::arg_descriptor<uint32_t> arg_p2p_limit_rate_up = {"limit-rate-up", "Limit upload of transaction relay and chain sync to peers, kB/s (0 for unlimited)."
+      " Block announcements are never limited", 0};
 
 bool parsePeerFromString(NetworkAddress& pe, const std::string& node_addr) {
   return Common::parseIpAddressAndPort(pe.ip, pe.port, node_addr);
@@ -71,6 +73,7 @@ void NetNodeConfig::initOptions(boost::program_options::options_description& des
   command_line::add_arg(desc, arg_p2p_add_exclusive_node);
   command_line::add_arg(desc, arg_p2p_seed_node);
   command_line::add_arg(desc, arg_p2p_hide_my_port);
+  command_line::add_arg(desc, arg_p2p_limit_rate_up);
 }
 
 NetNodeConfig::NetNodeConfig() {
@@ -79,6 +82,7 @@ NetNodeConfig::NetNodeConfig() {
   externalPort = 0;
   allowLocalIp = false;
   hideMyPort = false;
+  uploadLimit = 0;
   configFolder = Tools::getDefaultDataDirectory();
   testnet = false;
 }
@@ -139,6 +143,10 @@ bool NetNodeConfig::init(const boost::program_options::variables_map& vm)
     hideMyPort = true;
   }
 
+  if (vm.count(arg_p2p_limit_rate_up.name) != 0 && !vm[arg_p2p_limit_rate_up.name].defaulted()) {
+    uploadLimit = command_line::get_arg(vm, arg_p2p_limit_rate_up);
+  }
+
   return true;
 }
 
@@ -194,6 +202,10 @@ bool NetNodeConfig::getHideMyPort() const {
   return hideMyPort;
 }
 
+uint32_t NetNodeConfig::getUploadLimit() const {
+  return uploadLimit;
+}
+
 std::string NetNodeConfig::getConfigFolder() const {
   return configFolder;
 }
@@ -238,6 +250,10 @@ void NetNodeConfig::setHideMyPort(bool hide) {
   hideMyPort = hide;
 }
 
+void NetNodeConfig::setUploadLimit(uint32_t kilobytesPerSecond) {
+  uploadLimit = kilobytesPerSecond;
+}
+
 void NetNodeConfig::setConfigFolder(const std::string& folder) {
   configFolder = folder;
 }
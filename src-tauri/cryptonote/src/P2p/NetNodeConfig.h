@@ -43,6 +43,8 @@ public:
   std::vector<NetworkAddress> getExclusiveNodes() const;
   std::vector<NetworkAddress> getSeedNodes() const;
   bool getHideMyPort() const;
+  // kB/s for transaction relay and chain sync responses, 0 for unlimited
+  uint32_t getUploadLimit() const;
   std::string getConfigFolder() const;
 
   void setP2pStateFilename(const std::string& filename);
@@ -56,6 +58,7 @@ public:
   void setExclusiveNodes(const std::vector<NetworkAddress>& addresses);
   void setSeedNodes(const std::vector<NetworkAddress>& addresses);
   void setHideMyPort(bool hide);
+  void setUploadLimit(uint32_t kilobytesPerSecond);
   void setConfigFolder(const std::string& folder);
 
 private:
@@ -68,6 +71,7 @@ private:
   std::vector<NetworkAddress> exclusiveNodes;
   std::vector<NetworkAddress> seedNodes;
   bool hideMyPort;
+  uint32_t uploadLimit;
   std::string configFolder;
   std::string p2pStateFilename;
   bool testnet;
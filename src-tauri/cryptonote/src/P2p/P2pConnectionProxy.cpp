@@ -114,6 +114,7 @@ void P2pConnectionProxy::writeHandshake(const P2pMessage &message) {
     COMMAND_HANDSHAKE::request req;
     req.node_data = m_node.getNodeData();
     req.payload_data = coreSync;
+    req.skip_peerlist = false;
     m_context.writeMessage(makeRequest(COMMAND_HANDSHAKE::ID, LevinProtocol::encode(req)));
   }
 }
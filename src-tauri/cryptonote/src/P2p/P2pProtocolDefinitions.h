@@ -67,10 +67,15 @@ namespace CryptoNote
   {
     uint32_t current_height;
     Crypto::Hash top_id;
+    bool pool_short_ids; // takes NOTIFY_REQUEST_TX_POOL_SHORT_IDS
 
     void serialize(ISerializer& s) {
       KV_MEMBER(current_height)
       KV_MEMBER(top_id)
+      // older peers neither send nor read it
+      if (!s(pool_short_ids, "pool_short_ids")) {
+        pool_short_ids = false;
+      }
     }
   };
 
@@ -87,10 +92,15 @@ namespace CryptoNote
     {
       basic_node_data node_data;
       CORE_SYNC_DATA payload_data;
+      bool skip_peerlist; // the initiator took our peerlist lately, the response may leave it out
 
       void serialize(ISerializer& s) {
         KV_MEMBER(node_data)
         KV_MEMBER(payload_data)
+        // older peers neither send nor read it
+        if (!s(skip_peerlist, "skip_peerlist")) {
+          skip_peerlist = false;
+        }
       }
 
     };
@@ -67,6 +67,10 @@ namespace CryptoNote
     return memcmp(&a, &b, sizeof(a)) == 0;
   }
 
+  inline size_t hash_value(const NetworkAddress& na) {
+    return (static_cast<size_t>(na.ip) << 16) ^ na.port ^ (static_cast<size_t>(na.ip) >> 16);
+  }
+
   inline std::ostream& operator << (std::ostream& s, const NetworkAddress& na) {
     return s << Common::ipAddressToString(na.ip) << ":" << std::to_string(na.port);   
   }
@@ -17,6 +17,7 @@
 
 #include "PeerListManager.h"
 
+#include <algorithm>
 #include <time.h>
 #include <boost/foreach.hpp>
 #include <System/Ipv4Address.h>
@@ -54,6 +55,24 @@ namespace CryptoNote {
     s(pe.id, "id");
     s(pe.first_seen, "first_seen");
   }
+
+  void serialize(PeerQuality& pq, ISerializer& s) {
+    s(pq.adr, "adr");
+    s(pq.rtt_ms, "rtt_ms");
+    s(pq.bytes_received, "bytes_received");
+    s(pq.connected_seconds, "connected_seconds");
+    s(pq.last_updated, "last_updated");
+  }
+}
+
+namespace {
+
+// Delivered bytes per second, discounted by round trip time; higher is better
+double peerScore(const PeerQuality& pq) {
+  double throughput = pq.connected_seconds != 0 ? static_cast<double>(pq.bytes_received) / pq.connected_seconds : 0.0;
+  return (throughput + 1.0) / (pq.rtt_ms + 50.0);
+}
+
 }
 
 PeerlistManager::Peerlist::Peerlist(peers_indexed& peers, size_t maxSize) :
@@ -61,18 +80,27 @@ PeerlistManager::Peerlist::Peerlist(peers_indexed& peers, size_t maxSize) :
 }
 
 void PeerlistManager::serialize(ISerializer& s) {
-  const uint8_t currentVersion = 2;
+  const uint8_t currentVersion = 3;
   uint8_t version = currentVersion;
 
   s(version, "version");
 
-  if (version != currentVersion) {
+  // version 2 lacks the peer quality list
+  if (version != currentVersion && version != 2) {
     return;
   }
 
   s(m_peers_white, "whitelist");
   s(m_peers_gray, "graylist");
   s(m_peers_anchor, "anchorlist");
+
+  if (version == currentVersion) {
+    s(m_peers_quality, "qualitylist");
+  }
+
+  if (s.type() == ISerializer::INPUT) {
+    m_dirty = false;
+  }
 }
 
 size_t PeerlistManager::Peerlist::count() const {
@@ -100,6 +128,7 @@ void PeerlistManager::Peerlist::trim() {
 }
 
 PeerlistManager::PeerlistManager() : 
+  m_dirty(false),
   m_whitePeerlist(m_peers_white, CryptoNote::P2P_LOCAL_WHITE_PEERLIST_LIMIT),
   m_grayPeerlist(m_peers_gray, CryptoNote::P2P_LOCAL_GRAY_PEERLIST_LIMIT) {}
 
@@ -126,8 +155,6 @@ bool PeerlistManager::merge_peerlist(const std::list<PeerlistEntry>& outer_bs)
     append_with_peer_gray(be);
   }
 
-  // delete extra elements
-  trim_gray_peerlist();
   return true;
 }
 //--------------------------------------------------------------------------------------------------
@@ -230,6 +257,7 @@ bool PeerlistManager::append_with_peer_anchor(const AnchorPeerlistEntry &ple)
     {
       //put new record into white list
       m_peers_anchor.insert(ple);
+      m_dirty = true;
     }
 
     return true;
@@ -256,6 +284,7 @@ bool PeerlistManager::append_with_peer_white(const PeerlistEntry& ple)
       //update record in white list 
       m_peers_white.replace(by_addr_it_wt, ple);
     }
+    m_dirty = true;
     //remove from gray list, if need
     auto by_addr_it_gr = m_peers_gray.get<by_addr>().find(ple.adr);
     if (by_addr_it_gr != m_peers_gray.get<by_addr>().end()) {
@@ -289,9 +318,16 @@ bool PeerlistManager::append_with_peer_gray(const PeerlistEntry& ple)
       trim_gray_peerlist();
     } else
     {
+      // remote peerlists mostly repeat what we already have, an unchanged
+      // record is left alone instead of being reindexed
+      if (by_addr_it_gr->id == ple.id && by_addr_it_gr->last_seen == ple.last_seen) {
+        return true;
+      }
+
       //update record in white list 
       m_peers_gray.replace(by_addr_it_gr, ple);
     }
+    m_dirty = true;
     return true;
   } catch (std::exception&) {
       return false;
@@ -311,6 +347,7 @@ bool PeerlistManager::get_and_empty_anchor_peerlist(std::vector<AnchorPeerlistEn
     });
 
     m_peers_anchor.get<by_time>().clear();
+    m_dirty = true;
     return true;
   }
   catch (std::exception &)
@@ -329,6 +366,7 @@ bool PeerlistManager::remove_from_peer_anchor(const NetworkAddress &addr)
     if (iterator != m_peers_anchor.get<by_addr>().end())
     {
       m_peers_anchor.erase(iterator);
+      m_dirty = true;
     }
     return true;
   }
@@ -338,6 +376,86 @@ bool PeerlistManager::remove_from_peer_anchor(const NetworkAddress &addr)
   return false;
 }
 
+//--------------------------------------------------------------------------------------------------
+
+void PeerlistManager::record_peer_rtt(const NetworkAddress& addr, uint32_t rtt_ms)
+{
+  auto& by_addr_index = m_peers_quality.get<by_addr>();
+  auto it = by_addr_index.find(addr);
+  if (it == by_addr_index.end()) {
+    PeerQuality pq = PeerQuality();
+    pq.adr = addr;
+    pq.rtt_ms = rtt_ms;
+    pq.last_updated = time(nullptr);
+    m_peers_quality.insert(pq);
+    m_dirty = true;
+
+    auto& by_time_index = m_peers_quality.get<by_time>();
+    while (m_peers_quality.size() > CryptoNote::P2P_LOCAL_WHITE_PEERLIST_LIMIT) {
+      by_time_index.erase(by_time_index.begin());
+    }
+    return;
+  }
+
+  by_addr_index.modify(it, [rtt_ms](PeerQuality& pq) {
+    pq.rtt_ms = static_cast<uint32_t>((static_cast<uint64_t>(pq.rtt_ms) * 3 + rtt_ms) / 4);
+    pq.last_updated = time(nullptr);
+  });
+  m_dirty = true;
+}
+//--------------------------------------------------------------------------------------------------
+
+void PeerlistManager::record_peer_session(const NetworkAddress& addr, uint64_t bytes_received, uint64_t connected_seconds)
+{
+  auto& by_addr_index = m_peers_quality.get<by_addr>();
+  auto it = by_addr_index.find(addr);
+  if (it == by_addr_index.end()) {
+    return;
+  }
+
+  by_addr_index.modify(it, [bytes_received, connected_seconds](PeerQuality& pq) {
+    pq.bytes_received += bytes_received;
+    pq.connected_seconds += connected_seconds;
+    pq.last_updated = time(nullptr);
+  });
+  m_dirty = true;
+}
+//--------------------------------------------------------------------------------------------------
+
+bool PeerlistManager::get_peer_quality(const NetworkAddress& addr, PeerQuality& quality) const
+{
+  auto it = m_peers_quality.get<by_addr>().find(addr);
+  if (it == m_peers_quality.get<by_addr>().end()) {
+    return false;
+  }
+
+  quality = *it;
+  return true;
+}
+//--------------------------------------------------------------------------------------------------
+
+bool PeerlistManager::get_ranked_white_peers(std::vector<PeerlistEntry>& peers, size_t count) const
+{
+  std::vector<std::pair<double, PeerlistEntry>> scored;
+  for (const PeerlistEntry& pe : m_peers_white) {
+    auto it = m_peers_quality.get<by_addr>().find(pe.adr);
+    if (it != m_peers_quality.get<by_addr>().end()) {
+      scored.emplace_back(peerScore(*it), pe);
+    }
+  }
+
+  size_t ranked = std::min(count, scored.size());
+  std::partial_sort(scored.begin(), scored.begin() + ranked, scored.end(),
+    [](const std::pair<double, PeerlistEntry>& a, const std::pair<double, PeerlistEntry>& b) { return a.first > b.first; });
+
+  for (size_t i = 0; i < ranked; ++i) {
+    peers.push_back(scored[i].second);
+  }
+
+  return ranked != 0;
+}
+//--------------------------------------------------------------------------------------------------
+
 PeerlistManager::Peerlist& PeerlistManager::getWhite() { 
   return m_whitePeerlist; 
 }
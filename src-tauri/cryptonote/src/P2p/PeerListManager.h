@@ -18,8 +18,10 @@
 #pragma once
 
 #include <list>
+#include <vector>
 
 #include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/identity.hpp>
 #include <boost/multi_index/member.hpp>
@@ -30,6 +32,16 @@
 namespace CryptoNote {
 
 class ISerializer;
+
+// Measured connection quality of a peer we have connected out to
+struct PeerQuality {
+  NetworkAddress adr;
+  uint32_t rtt_ms;            // smoothed round trip time
+  uint64_t bytes_received;    // over all outgoing sessions
+  uint64_t connected_seconds; // over all outgoing sessions
+  uint64_t last_updated;
+};
+
 /************************************************************************/
 /*                                                                      */
 /************************************************************************/
@@ -41,8 +53,8 @@ class PeerlistManager {
   typedef boost::multi_index_container<
     PeerlistEntry,
     boost::multi_index::indexed_by<
-    // access by peerlist_entry::net_adress
-    boost::multi_index::ordered_unique<boost::multi_index::tag<by_addr>, boost::multi_index::member<PeerlistEntry, NetworkAddress, &PeerlistEntry::adr> >,
+    // access by peerlist_entry::net_adress, constant time for merging remote peerlists
+    boost::multi_index::hashed_unique<boost::multi_index::tag<by_addr>, boost::multi_index::member<PeerlistEntry, NetworkAddress, &PeerlistEntry::adr> >,
     // sort by peerlist_entry::last_seen<
     boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_time>, boost::multi_index::member<PeerlistEntry, uint64_t, &PeerlistEntry::last_seen> >
     >
@@ -57,6 +69,13 @@ class PeerlistManager {
           boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_time>, boost::multi_index::member<AnchorPeerlistEntry, int64_t, &AnchorPeerlistEntry::first_seen>>>>
       anchor_peers_indexed;
 
+  typedef boost::multi_index_container<
+      PeerQuality,
+      boost::multi_index::indexed_by<
+          boost::multi_index::ordered_unique<boost::multi_index::tag<by_addr>, boost::multi_index::member<PeerQuality, NetworkAddress, &PeerQuality::adr>>,
+          boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_time>, boost::multi_index::member<PeerQuality, uint64_t, &PeerQuality::last_updated>>>>
+      quality_indexed;
+
 public:
 
   class Peerlist {
@@ -93,18 +112,29 @@ public:
   void trim_gray_peerlist();
 
   void serialize(ISerializer& s);
+  // whether anything that serialize() writes changed since the last clear_dirty()
+  bool is_dirty() const { return m_dirty; }
+  void clear_dirty() { m_dirty = false; }
 
   Peerlist& getWhite();
   Peerlist& getGray();
   bool get_and_empty_anchor_peerlist(std::vector<AnchorPeerlistEntry> &apl);
   bool remove_from_peer_anchor(const NetworkAddress &addr);
 
+  void record_peer_rtt(const NetworkAddress& addr, uint32_t rtt_ms);
+  void record_peer_session(const NetworkAddress& addr, uint64_t bytes_received, uint64_t connected_seconds);
+  bool get_peer_quality(const NetworkAddress& addr, PeerQuality& quality) const;
+  // White peers with measured quality, best first
+  bool get_ranked_white_peers(std::vector<PeerlistEntry>& peers, size_t count) const;
+
 private:
   std::string m_config_folder;
   bool m_allow_local_ip;
+  bool m_dirty;
   peers_indexed m_peers_gray;
   peers_indexed m_peers_white;
   anchor_peers_indexed m_peers_anchor;
+  quality_indexed m_peers_quality;
   Peerlist m_whitePeerlist;
   Peerlist m_grayPeerlist;
 };
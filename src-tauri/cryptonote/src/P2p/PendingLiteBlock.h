@@ -16,4 +16,12 @@ namespace CryptoNote
         NOTIFY_NEW_LITE_BLOCK_request request;
         std::unordered_set<Crypto::Hash> missed_transactions;
     };
+
+    struct PendingCompactBlock
+    {
+        NOTIFY_NEW_COMPACT_BLOCK_request request;
+        Crypto::Hash key;
+        std::vector<Crypto::Hash> transactions; // NULL_HASH while the transaction is still missing
+        std::vector<BinaryArray> providedTransactions;
+    };
 } // namespace CryptoNote
\ No newline at end of file
@@ -0,0 +1,72 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace CryptoNote {
+
+// Byte budget refilled at a fixed rate, holding at most one second's worth.
+// A zero rate means unlimited. Not thread safe; NodeServer only uses it on
+// the dispatcher.
+class TokenBucket {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  TokenBucket() : m_rate(0), m_tokens(0), m_lastRefill(Clock::now()) {
+  }
+
+  void setRate(uint64_t bytesPerSecond) {
+    m_rate = bytesPerSecond;
+    m_tokens = static_cast<double>(bytesPerSecond);
+    m_lastRefill = Clock::now();
+  }
+
+  bool limited() const {
+    return m_rate != 0;
+  }
+
+  // Takes size bytes, going into debt if needed; returns how long the caller
+  // has to wait before sending them
+  std::chrono::milliseconds take(size_t size) {
+    if (m_rate == 0) {
+      return std::chrono::milliseconds(0);
+    }
+
+    Clock::time_point now = Clock::now();
+    double elapsed = std::chrono::duration<double>(now - m_lastRefill).count();
+    m_lastRefill = now;
+    m_tokens = std::min(static_cast<double>(m_rate), m_tokens + elapsed * m_rate) - static_cast<double>(size);
+
+    if (m_tokens >= 0) {
+      return std::chrono::milliseconds(0);
+    }
+
+    return std::chrono::milliseconds(static_cast<int64_t>(-m_tokens * 1000 / m_rate) + 1);
+  }
+
+private:
+  uint64_t m_rate;
+  double m_tokens;
+  Clock::time_point m_lastRefill;
+};
+
+}
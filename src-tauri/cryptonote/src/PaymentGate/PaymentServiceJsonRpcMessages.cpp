@@ -161,7 +161,7 @@ void CreateAddress::Response::serialize(CryptoNote::ISerializer &serializer)
 
 void CreateAddressList::Request::serialize(CryptoNote::ISerializer &serializer)
 {
-  if (!serializer(spendSecretKeys, "privateSpendKeys"))
+  if (serializer(spendSecretKeys, "privateSpendKeys") == serializer(count, "count"))
   {
     throw RequestSerializationError();
   }
@@ -415,6 +415,11 @@ void SendTransaction::Response::serialize(CryptoNote::ISerializer &serializer)
   serializer(transactionSecretKey, "transactionSecretKey");
 }
 
+void SendTransactionBatch::Response::serialize(CryptoNote::ISerializer &serializer)
+{
+  serializer(transactionHashes, "transactionHashes");
+}
+
 void CreateDelayedTransaction::Request::serialize(CryptoNote::ISerializer &serializer)
 {
   serializer(addresses, "addresses");
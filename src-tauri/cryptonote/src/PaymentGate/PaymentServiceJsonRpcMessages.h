@@ -249,6 +249,8 @@ struct CreateAddressList
   {
     std::vector<std::string> spendSecretKeys;
     bool reset;
+    // instead of spendSecretKeys: the number of addresses to create with random keys
+    uint32_t count = 0;
     void serialize(CryptoNote::ISerializer &serializer);
   };
 
@@ -529,6 +531,19 @@ struct SendTransaction
   };
 };
 
+// same request as sendTransaction; the transfers are packed into as few transactions as fit
+struct SendTransactionBatch
+{
+  typedef SendTransaction::Request Request;
+
+  struct Response
+  {
+    std::vector<std::string> transactionHashes;
+
+    void serialize(CryptoNote::ISerializer &serializer);
+  };
+};
+
 struct CreateDelayedTransaction
 {
   struct Request
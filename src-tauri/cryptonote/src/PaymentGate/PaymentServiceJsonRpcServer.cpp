@@ -65,6 +65,7 @@ PaymentServiceJsonRpcServer::PaymentServiceJsonRpcServer(System::Dispatcher& sys
   handlers.emplace("getUnconfirmedTransactionHashes", jsonHandler<GetUnconfirmedTransactionHashes::Request, GetUnconfirmedTransactionHashes::Response>(std::bind(&PaymentServiceJsonRpcServer::handleGetUnconfirmedTransactionHashes, this, std::placeholders::_1, std::placeholders::_2)));
   handlers.emplace("getTransaction", jsonHandler<GetTransaction::Request, GetTransaction::Response>(std::bind(&PaymentServiceJsonRpcServer::handleGetTransaction, this, std::placeholders::_1, std::placeholders::_2)));
   handlers.emplace("sendTransaction", jsonHandler<SendTransaction::Request, SendTransaction::Response>(std::bind(&PaymentServiceJsonRpcServer::handleSendTransaction, this, std::placeholders::_1, std::placeholders::_2)));
+  handlers.emplace("sendTransactionBatch", jsonHandler<SendTransactionBatch::Request, SendTransactionBatch::Response>(std::bind(&PaymentServiceJsonRpcServer::handleSendTransactionBatch, this, std::placeholders::_1, std::placeholders::_2)));
   handlers.emplace("createDelayedTransaction", jsonHandler<CreateDelayedTransaction::Request, CreateDelayedTransaction::Response>(std::bind(&PaymentServiceJsonRpcServer::handleCreateDelayedTransaction, this, std::placeholders::_1, std::placeholders::_2)));
   handlers.emplace("getDelayedTransactionHashes", jsonHandler<GetDelayedTransactionHashes::Request, GetDelayedTransactionHashes::Response>(std::bind(&PaymentServiceJsonRpcServer::handleGetDelayedTransactionHashes, this, std::placeholders::_1, std::placeholders::_2)));
   handlers.emplace("deleteDelayedTransaction", jsonHandler<DeleteDelayedTransaction::Request, DeleteDelayedTransaction::Response>(std::bind(&PaymentServiceJsonRpcServer::handleDeleteDelayedTransaction, this, std::placeholders::_1, std::placeholders::_2)));
@@ -157,6 +158,10 @@ std::error_code PaymentServiceJsonRpcServer::handleExportWalletKeys(const Export
 }
 
 std::error_code PaymentServiceJsonRpcServer::handleCreateAddressList(const CreateAddressList::Request& request, CreateAddressList::Response& response) {
+  if (request.count != 0) {
+    return service.createAddresses(request.count, response.addresses);
+  }
+
   return service.createAddressList(request.spendSecretKeys, request.reset, response.addresses);
 }
 
@@ -223,6 +228,10 @@ std::error_code PaymentServiceJsonRpcServer::handleSendTransaction(const SendTra
   return service.sendTransaction(request, response.transactionHash, response.transactionSecretKey);
 }
 
+std::error_code PaymentServiceJsonRpcServer::handleSendTransactionBatch(const SendTransactionBatch::Request& request, SendTransactionBatch::Response& response) {
+  return service.sendTransactionBatch(request, response.transactionHashes);
+}
+
 std::error_code PaymentServiceJsonRpcServer::handleCreateDelayedTransaction(const CreateDelayedTransaction::Request& request, CreateDelayedTransaction::Response& response) {
   return service.createDelayedTransaction(request, response.transactionHash);
 }
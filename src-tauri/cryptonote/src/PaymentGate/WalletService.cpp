@@ -43,6 +43,7 @@
 #include "PaymentServiceJsonRpcMessages.h"
 #include "NodeFactory.h"
 
+#include "Wallet/FusionScheduler.h"
 #include "Wallet/WalletGreen.h"
 #include "Wallet/LegacyKeysImporter.h"
 #include "Wallet/WalletErrors.h"
@@ -63,6 +64,7 @@
 #include "Common/SignalHandler.h"
 #include "Common/StringTools.h"
 #include "Common/PathTools.h"
+#include "Common/ScopeExit.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolHandler.h"
 
 using namespace CryptoNote;
@@ -184,6 +186,12 @@ namespace PaymentService
       return haveAddress;
     }
 
+    // with an address or payment id to look for the wallet's indexes can serve the query
+    bool indexed() const
+    {
+      return havePaymentId || !addresses.empty();
+    }
+
     std::unordered_set<std::string> addresses;
     bool havePaymentId = false;
     Crypto::Hash paymentId;
@@ -607,13 +615,20 @@ namespace PaymentService
                                   logger(logger, "WalletService"),
                                   dispatcher(sys),
                                   readyEvent(dispatcher),
+                                  loadedEvent(dispatcher),
                                   refreshContext(dispatcher)
   {
     readyEvent.set();
+    loadedEvent.set();
   }
 
   WalletService::~WalletService()
   {
+    if (fusionScheduler)
+    {
+      fusionScheduler->stop();
+    }
+
     if (inited)
     {
       wallet.stop();
@@ -627,15 +642,34 @@ namespace PaymentService
     loadWallet();
     loadTransactionIdIndex();
 
+    // refresh() only indexes created transactions, the rest of a sync burst can be merged
+    wallet.setEventCoalescing(true);
     refreshContext.spawn([this] { refresh(); });
 
+    // survives reset(), a round that finds the wallet reloading just fails and is retried
+    if (config.autoOptimize && !fusionScheduler)
+    {
+      CryptoNote::FusionSchedulerSettings settings;
+      settings.threshold = config.autoOptimizeThreshold;
+      fusionScheduler.reset(new CryptoNote::FusionScheduler(dispatcher, wallet, fusionManager, node, readyEvent, settings, logger.getLogger()));
+      fusionScheduler->start();
+    }
+
     inited = true;
   }
 
+  void WalletService::noteUserActivity()
+  {
+    if (fusionScheduler)
+    {
+      fusionScheduler->notifyActivity();
+    }
+  }
+
   void WalletService::saveWallet()
   {
     wallet.save();
-    logger(Logging::INFO, Logging::BRIGHT_WHITE) << "Wallet is saved";
+    logger(Logging::INFO, Logging::BRIGHT_WHITE) << "Wallet snapshot is taken, it is written out in the background";
   }
 
   std::error_code WalletService::saveWalletNoThrow()
@@ -910,6 +944,24 @@ namespace PaymentService
     return std::error_code();
   }
 
+  std::error_code WalletService::createAddresses(size_t count, std::vector<std::string> &addresses)
+  {
+    try
+    {
+      System::EventLock lk(readyEvent);
+      logger(Logging::DEBUGGING) << "Creating " << count << " addresses with random keys...";
+      addresses = wallet.createAddresses(count);
+    }
+    catch (std::system_error &x)
+    {
+      logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while creating addresses: " << x.what();
+      return x.code();
+    }
+
+    logger(Logging::DEBUGGING) << "Created " << addresses.size() << " addresses";
+    return std::error_code();
+  }
+
   std::error_code WalletService::createTrackingAddress(const std::string &spendPublicKeyText, std::string &address)
   {
     try
@@ -980,7 +1032,7 @@ namespace PaymentService
   {
     try
     {
-      System::EventLock lk(readyEvent);
+      loadedEvent.wait();
       logger(Logging::DEBUGGING) << "Getting balance for address " << address;
 
       availableBalance = wallet.getActualBalance(address);
@@ -1002,7 +1054,7 @@ namespace PaymentService
   {
     try
     {
-      System::EventLock lk(readyEvent);
+      loadedEvent.wait();
       logger(Logging::DEBUGGING) << "Getting wallet balance";
 
       availableBalance = wallet.getActualBalance();
@@ -1067,7 +1119,7 @@ namespace PaymentService
   {
     try
     {
-      System::EventLock lk(readyEvent);
+      loadedEvent.wait();
       validateAddresses(addresses, currency, logger);
 
       if (!paymentId.empty())
@@ -1099,7 +1151,7 @@ namespace PaymentService
   {
     try
     {
-      System::EventLock lk(readyEvent);
+      loadedEvent.wait();
       validateAddresses(addresses, currency, logger);
 
       if (!paymentId.empty())
@@ -1174,7 +1226,7 @@ namespace PaymentService
   {
     try
     {
-      System::EventLock lk(readyEvent);
+      loadedEvent.wait();
       validateAddresses(addresses, currency, logger);
 
       if (!paymentId.empty())
@@ -1207,7 +1259,7 @@ namespace PaymentService
   {
     try
     {
-      System::EventLock lk(readyEvent);
+      loadedEvent.wait();
       validateAddresses(addresses, currency, logger);
 
       if (!paymentId.empty())
@@ -1314,7 +1366,7 @@ namespace PaymentService
   {
     try
     {
-      System::EventLock lk(readyEvent);
+      loadedEvent.wait();
 
       addresses.clear();
       addresses.reserve(wallet.getAddressCount());
@@ -1335,6 +1387,7 @@ namespace PaymentService
 
   std::error_code WalletService::sendTransaction(const SendTransaction::Request &request, std::string &transactionHash, std::string &transactionSecretKey)
   {
+    noteUserActivity();
 
     try
     {
@@ -1395,6 +1448,71 @@ namespace PaymentService
     return std::error_code();
   }
 
+  std::error_code WalletService::sendTransactionBatch(const SendTransactionBatch::Request &request, std::vector<std::string> &transactionHashes)
+  {
+    noteUserActivity();
+
+    try
+    {
+      System::EventLock lk(readyEvent);
+
+      uint64_t knownBlockCount = node.getKnownBlockCount();
+      uint64_t localBlockCount = node.getLocalBlockCount();
+      uint64_t diff = knownBlockCount - localBlockCount;
+      if ((localBlockCount == 0) || (diff > 2))
+      {
+        logger(Logging::WARNING) << "Daemon is not synchronized";
+        return make_error_code(CryptoNote::error::DAEMON_NOT_SYNCED);
+      }
+
+      validateAddresses(request.sourceAddresses, currency, logger);
+      validateAddresses(collectDestinationAddresses(request.transfers), currency, logger);
+      std::vector<PaymentService::WalletRpcMessage> messages = collectMessages(request.transfers);
+      if (!request.changeAddress.empty())
+      {
+        validateAddresses({request.changeAddress}, currency, logger);
+      }
+
+      CryptoNote::TransactionParameters sendParams;
+      if (!request.paymentId.empty())
+      {
+        addPaymentIdToExtra(request.paymentId, sendParams.extra);
+      }
+      else
+      {
+        sendParams.extra = Common::asString(Common::fromHex(request.extra));
+      }
+
+      sendParams.sourceAddresses = request.sourceAddresses;
+      sendParams.destinations = convertWalletRpcOrdersToWalletOrders(request.transfers);
+      sendParams.messages = convertWalletRpcMessagesToWalletMessages(messages);
+      sendParams.fee = CryptoNote::parameters::MINIMUM_FEE;
+      sendParams.mixIn = parameters::MINIMUM_MIXIN;
+      sendParams.unlockTimestamp = request.unlockTime;
+      sendParams.changeDestination = request.changeAddress;
+
+      std::vector<size_t> transactionIds = wallet.transferBatch(sendParams);
+      transactionHashes.clear();
+      for (size_t transactionId : transactionIds)
+      {
+        transactionHashes.push_back(Common::podToHex(wallet.getTransaction(transactionId).hash));
+      }
+      logger(Logging::DEBUGGING) << transactionHashes.size() << " batch transactions have been created";
+    }
+    catch (std::system_error &x)
+    {
+      logger(Logging::WARNING) << "Error while sending transaction batch: " << x.what();
+      return x.code();
+    }
+    catch (std::exception &x)
+    {
+      logger(Logging::WARNING) << "Error while sending transaction batch: " << x.what();
+      return make_error_code(CryptoNote::error::INTERNAL_WALLET_ERROR);
+    }
+
+    return std::error_code();
+  }
+
   std::error_code WalletService::createDelayedTransaction(const CreateDelayedTransaction::Request &request, std::string &transactionHash)
   {
     try
@@ -1577,6 +1695,8 @@ namespace PaymentService
 
   std::error_code WalletService::sendDelayedTransaction(const std::string &transactionHash)
   {
+    noteUserActivity();
+
     try
     {
       System::EventLock lk(readyEvent);
@@ -1653,9 +1773,8 @@ namespace PaymentService
   {
     try
     {
-      System::EventLock lk(readyEvent);
+      loadedEvent.wait();
 
-      auto estimateResult = fusionManager.estimate(1000000, {});
       knownBlockCount = node.getKnownBlockCount();
       peerCount = static_cast<uint32_t>(node.getPeerCount());
       blockCount = wallet.getBlockCount();
@@ -1686,7 +1805,8 @@ namespace PaymentService
         std::string sourceAddress,
         std::string & transactionHash)
     {
-    
+      noteUserActivity();
+
       try
       {
 
@@ -1756,6 +1876,8 @@ namespace PaymentService
         std::string & transactionHash)
 
     {
+      noteUserActivity();
+
       // TODO try and catch
       wallet.withdrawDeposit(depositId, transactionHash);
       return std::error_code();
@@ -1770,6 +1892,8 @@ namespace PaymentService
         std::string destinationAddress,
         std::string & transactionHash)
     {
+      noteUserActivity();
+
       try
       {
         System::EventLock lk(readyEvent);
@@ -1853,11 +1977,13 @@ namespace PaymentService
         logger(Logging::DEBUGGING) << "Refresh is started";
         for (;;)
         {
-          auto event = wallet.getEvent();
-          if (event.type == CryptoNote::TRANSACTION_CREATED)
+          for (const auto &event : wallet.getEvents(0))
           {
-            size_t transactionId = event.transactionCreated.transactionIndex;
-            transactionIdIndex.emplace(Common::podToHex(wallet.getTransaction(transactionId).hash), transactionId);
+            if (event.type == CryptoNote::TRANSACTION_CREATED)
+            {
+              size_t transactionId = event.transactionCreated.transactionIndex;
+              transactionIdIndex.emplace(Common::podToHex(wallet.getTransaction(transactionId).hash), transactionId);
+            }
           }
         }
       }
@@ -1951,6 +2077,9 @@ namespace PaymentService
 
     void WalletService::reset()
     {
+      loadedEvent.clear();
+      Tools::ScopeExit loaded([this] { loadedEvent.set(); });
+
       wallet.save(CryptoNote::WalletSaveLevel::SAVE_KEYS_ONLY);
       wallet.stop();
       wallet.shutdown();
@@ -1963,6 +2092,9 @@ namespace PaymentService
 
     void WalletService::replaceWithNewWallet(const Crypto::SecretKey &viewSecretKey)
     {
+      loadedEvent.clear();
+      Tools::ScopeExit loaded([this] { loadedEvent.set(); });
+
       wallet.stop();
       wallet.shutdown();
       inited = false;
@@ -2052,6 +2184,40 @@ namespace PaymentService
       return result;
     }
 
+    std::vector<CryptoNote::TransactionsInBlockInfo> WalletService::getTransactions(const Crypto::Hash &blockHash, size_t blockCount, const TransactionsInBlockInfoFilter &filter) const
+    {
+      if (!filter.indexed())
+      {
+        return filterTransactions(getTransactions(blockHash, blockCount), filter);
+      }
+
+      std::vector<std::string> addresses(filter.addresses.begin(), filter.addresses.end());
+      std::vector<CryptoNote::TransactionsInBlockInfo> result = wallet.getTransactions(blockHash, blockCount, addresses, filter.havePaymentId ? &filter.paymentId : nullptr);
+      if (result.empty())
+      {
+        // nothing matched, or the block is unknown
+        getTransactions(blockHash, 1);
+      }
+
+      return result;
+    }
+
+    std::vector<CryptoNote::TransactionsInBlockInfo> WalletService::getTransactions(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter &filter) const
+    {
+      if (!filter.indexed())
+      {
+        return filterTransactions(getTransactions(firstBlockIndex, blockCount), filter);
+      }
+
+      if (firstBlockIndex >= wallet.getBlockCount())
+      {
+        throw std::system_error(make_error_code(CryptoNote::error::WalletServiceErrorCode::OBJECT_NOT_FOUND));
+      }
+
+      std::vector<std::string> addresses(filter.addresses.begin(), filter.addresses.end());
+      return wallet.getTransactions(firstBlockIndex, blockCount, addresses, filter.havePaymentId ? &filter.paymentId : nullptr);
+    }
+
     std::vector<CryptoNote::DepositsInBlockInfo> WalletService::getDeposits(const Crypto::Hash &blockHash, size_t blockCount) const
     {
       std::vector<CryptoNote::DepositsInBlockInfo> result = wallet.getDeposits(blockHash, blockCount);
@@ -2076,31 +2242,27 @@ namespace PaymentService
 
     std::vector<TransactionHashesInBlockRpcInfo> WalletService::getRpcTransactionHashes(const Crypto::Hash &blockHash, size_t blockCount, const TransactionsInBlockInfoFilter &filter) const
     {
-      std::vector<CryptoNote::TransactionsInBlockInfo> allTransactions = getTransactions(blockHash, blockCount);
-      std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
+      std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = getTransactions(blockHash, blockCount, filter);
       return convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(filteredTransactions);
     }
 
     std::vector<TransactionHashesInBlockRpcInfo> WalletService::getRpcTransactionHashes(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter &filter) const
     {
-      std::vector<CryptoNote::TransactionsInBlockInfo> allTransactions = getTransactions(firstBlockIndex, blockCount);
-      std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
+      std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = getTransactions(firstBlockIndex, blockCount, filter);
       return convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(filteredTransactions);
     }
 
     std::vector<TransactionsInBlockRpcInfo> WalletService::getRpcTransactions(const Crypto::Hash &blockHash, size_t blockCount, const TransactionsInBlockInfoFilter &filter) const
     {
       uint32_t knownBlockCount = node.getKnownBlockCount();
-      std::vector<CryptoNote::TransactionsInBlockInfo> allTransactions = getTransactions(blockHash, blockCount);
-      std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
+      std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = getTransactions(blockHash, blockCount, filter);
       return convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(filteredTransactions, knownBlockCount);
     }
 
     std::vector<TransactionsInBlockRpcInfo> WalletService::getRpcTransactions(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter &filter) const
     {
       uint32_t knownBlockCount = node.getKnownBlockCount();
-      std::vector<CryptoNote::TransactionsInBlockInfo> allTransactions = getTransactions(firstBlockIndex, blockCount);
-      std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
+      std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = getTransactions(firstBlockIndex, blockCount, filter);
       return convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(filteredTransactions, knownBlockCount);
     }
 
@@ -36,6 +36,7 @@
 namespace CryptoNote
 {
 class IFusionManager;
+class FusionScheduler;
 }
 
 namespace PaymentService
@@ -47,6 +48,8 @@ struct WalletConfiguration
   std::string walletPassword;
   std::string secretSpendKey;
   std::string secretViewKey;
+  bool autoOptimize = false;              // run a FusionScheduler alongside the service
+  uint64_t autoOptimizeThreshold = 1000000;
 };
 
 void generateNewWallet(const CryptoNote::Currency &currency, const WalletConfiguration &conf, Logging::ILogger &logger, System::Dispatcher &dispatcher);
@@ -71,6 +74,7 @@ public:
   std::error_code createAddress(const std::string &spendSecretKeyText, std::string &address);
   std::error_code createAddress(std::string &address);
   std::error_code createAddressList(const std::vector<std::string> &spendSecretKeysText, bool reset, std::vector<std::string> &addresses);
+  std::error_code createAddresses(size_t count, std::vector<std::string> &addresses);
   std::error_code createTrackingAddress(const std::string &spendPublicKeyText, std::string &address);
   std::error_code deleteAddress(const std::string &address);
   std::error_code getSpendkeys(const std::string &address, std::string &publicSpendKeyText, std::string &secretSpendKeyText);
@@ -89,6 +93,7 @@ std::error_code getViewKey(std::string &viewSecretKey);
   std::error_code getTransaction(const std::string &transactionHash, TransactionRpcInfo &transaction);
   std::error_code getAddresses(std::vector<std::string> &addresses);
   std::error_code sendTransaction(const SendTransaction::Request &request, std::string &transactionHash, std::string &transactionSecretKey);
+  std::error_code sendTransactionBatch(const SendTransactionBatch::Request &request, std::vector<std::string> &transactionHashes);
   std::error_code createDelayedTransaction(const CreateDelayedTransaction::Request &request, std::string &transactionHash);
   std::error_code createIntegratedAddress(const CreateIntegrated::Request &request, std::string &integrated_address);
   std::error_code splitIntegratedAddress(const SplitIntegrated::Request &request, std::string &address, std::string &payment_id);
@@ -110,6 +115,7 @@ std::error_code getViewKey(std::string &viewSecretKey);
 private:
   void refresh();
   void reset();
+  void noteUserActivity();
 
   void loadWallet();
   void loadTransactionIdIndex();
@@ -118,6 +124,8 @@ private:
 
   std::vector<CryptoNote::TransactionsInBlockInfo> getTransactions(const Crypto::Hash &blockHash, size_t blockCount) const;
   std::vector<CryptoNote::TransactionsInBlockInfo> getTransactions(uint32_t firstBlockIndex, size_t blockCount) const;
+  std::vector<CryptoNote::TransactionsInBlockInfo> getTransactions(const Crypto::Hash &blockHash, size_t blockCount, const TransactionsInBlockInfoFilter &filter) const;
+  std::vector<CryptoNote::TransactionsInBlockInfo> getTransactions(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter &filter) const;
 
   std::vector<CryptoNote::DepositsInBlockInfo> getDeposits(const Crypto::Hash &blockHash, size_t blockCount) const;
   std::vector<CryptoNote::DepositsInBlockInfo> getDeposits(uint32_t firstBlockIndex, size_t blockCount) const;
@@ -136,8 +144,13 @@ private:
   bool inited;
   Logging::LoggerRef logger;
   System::Dispatcher &dispatcher;
-  System::Event readyEvent;
+  System::Event readyEvent;   // serializes calls that change the wallet
+  // Cleared only while the wallet is being reloaded. Read-only calls wait on this instead of
+  // taking readyEvent: they do not yield to the dispatcher once running, so they see a
+  // consistent wallet even while a writer is suspended in the middle of its call.
+  System::Event loadedEvent;
   System::ContextGroup refreshContext;
+  std::unique_ptr<CryptoNote::FusionScheduler> fusionScheduler;
 
   std::map<std::string, size_t> transactionIdIndex;
 };
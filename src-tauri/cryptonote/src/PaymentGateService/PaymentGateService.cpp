@@ -170,7 +170,7 @@ void PaymentGateService::runInProcess(Logging::LoggerRef& log) {
   std::promise<std::error_code> initPromise;
   auto initFuture = initPromise.get_future();
 
-  std::unique_ptr<CryptoNote::INode> node(new CryptoNote::InProcessNode(core, protocol));
+  std::unique_ptr<CryptoNote::INode> node(new CryptoNote::InProcessNode(core, protocol, config.gateConfiguration.localNodeThreads));
 
   node->init([&initPromise, &log](std::error_code ec) {
     if (ec) {
@@ -231,6 +231,8 @@ void PaymentGateService::runWalletService(const CryptoNote::Currency& currency,
     config.gateConfiguration.containerFile,
     config.gateConfiguration.containerPassword
   };
+  walletConfiguration.autoOptimize = config.gateConfiguration.autoOptimize;
+  walletConfiguration.autoOptimizeThreshold = config.gateConfiguration.autoOptimizeThreshold;
 
   std::unique_ptr<CryptoNote::WalletGreen> wallet(new CryptoNote::WalletGreen(*dispatcher, currency, node, logger));
 
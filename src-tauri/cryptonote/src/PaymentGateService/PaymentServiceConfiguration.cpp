@@ -35,6 +35,9 @@ Configuration::Configuration() {
   logFile = "payment_gate.log";
   testnet = false;
   printAddresses = false;
+  autoOptimize = false;
+  autoOptimizeThreshold = 1000000;
+  localNodeThreads = 0;
   logLevel = Logging::INFO;
   bindAddress = "";
   bindPort = 0;
@@ -57,7 +60,10 @@ void Configuration::initOptions(boost::program_options::options_description& des
       ("log-file,l", po::value<std::string>(), "log file")
       ("server-root", po::value<std::string>(), "server root. The service will use it as working directory. Don't set it if don't want to change it")
       ("log-level", po::value<size_t>(), "log level")
-      ("address", "print wallet addresses and exit");
+      ("address", "print wallet addresses and exit")
+      ("auto-optimize", "consolidate small outputs with fusion transactions while the wallet is idle")
+      ("auto-optimize-threshold", po::value<uint64_t>(), "outputs below this amount are consolidated by auto-optimize")
+      ("local-node-threads", po::value<size_t>(), "worker threads serving the wallet from the local node, 0 uses all cores");
 }
 
 void Configuration::init(const boost::program_options::variables_map& options) {
@@ -137,6 +143,18 @@ void Configuration::init(const boost::program_options::variables_map& options) {
     printAddresses = true;
   }
 
+  if (options.count("auto-optimize") != 0) {
+    autoOptimize = true;
+  }
+
+  if (options.count("auto-optimize-threshold") != 0) {
+    autoOptimizeThreshold = options["auto-optimize-threshold"].as<uint64_t>();
+  }
+
+  if (options.count("local-node-threads") != 0) {
+    localNodeThreads = options["local-node-threads"].as<size_t>();
+  }
+
   if (!registerService && !unregisterService) {
     if (containerFile.empty() || containerPassword.empty()) {
       throw ConfigurationError("Both container-file and container-password parameters are required");
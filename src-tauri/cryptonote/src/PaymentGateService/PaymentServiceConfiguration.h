@@ -54,6 +54,10 @@ struct Configuration {
   bool unregisterService;
   bool testnet;
   bool printAddresses;
+  bool autoOptimize;
+
+  uint64_t autoOptimizeThreshold;
+  size_t localNodeThreads;
 
   size_t logLevel;
 };
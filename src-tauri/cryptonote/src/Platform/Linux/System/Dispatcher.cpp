@@ -24,10 +24,114 @@
 #include <string.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/timerfd.h>
-#include <ucontext.h>
 #include <unistd.h>
 
+#if (defined(__x86_64__) && !defined(__ILP32__)) || defined(__aarch64__)
+#define DISPATCHER_ASM_CONTEXT_SWITCH
+#else
+#include <ucontext.h>
+#endif
+
+#ifdef DISPATCHER_ASM_CONTEXT_SWITCH
+// Saves the callee-saved registers on the current stack, stores the stack pointer to *from and
+// resumes the context whose saved stack pointer is to. Unlike swapcontext it leaves the signal
+// mask alone, which saves two system calls per switch.
+extern "C" void dispatcherSwitchContext(void** from, void* to);
+// First frame of a new context: calls the procedure made by makeContext with its argument.
+extern "C" void dispatcherContextEntry();
+
+#if defined(__x86_64__)
+asm(R"(
+  .text
+  .p2align 4
+  .globl dispatcherSwitchContext
+  .hidden dispatcherSwitchContext
+  .type dispatcherSwitchContext, @function
+dispatcherSwitchContext:
+  pushq %rbp
+  pushq %rbx
+  pushq %r12
+  pushq %r13
+  pushq %r14
+  pushq %r15
+  subq $8, %rsp
+  stmxcsr (%rsp)
+  fnstcw 4(%rsp)
+  movq %rsp, (%rdi)
+  movq %rsi, %rsp
+  ldmxcsr (%rsp)
+  fldcw 4(%rsp)
+  addq $8, %rsp
+  popq %r15
+  popq %r14
+  popq %r13
+  popq %r12
+  popq %rbx
+  popq %rbp
+  ret
+  .size dispatcherSwitchContext, .-dispatcherSwitchContext
+
+  .p2align 4
+  .globl dispatcherContextEntry
+  .hidden dispatcherContextEntry
+  .type dispatcherContextEntry, @function
+dispatcherContextEntry:
+  movq %r12, %rdi
+  callq *%r13
+  ud2
+  .size dispatcherContextEntry, .-dispatcherContextEntry
+)");
+#else
+asm(R"(
+  .text
+  .p2align 4
+  .globl dispatcherSwitchContext
+  .hidden dispatcherSwitchContext
+  .type dispatcherSwitchContext, %function
+dispatcherSwitchContext:
+  sub sp, sp, #160
+  stp x19, x20, [sp, #0]
+  stp x21, x22, [sp, #16]
+  stp x23, x24, [sp, #32]
+  stp x25, x26, [sp, #48]
+  stp x27, x28, [sp, #64]
+  stp x29, x30, [sp, #80]
+  stp d8, d9, [sp, #96]
+  stp d10, d11, [sp, #112]
+  stp d12, d13, [sp, #128]
+  stp d14, d15, [sp, #144]
+  mov x9, sp
+  str x9, [x0]
+  mov sp, x1
+  ldp x19, x20, [sp, #0]
+  ldp x21, x22, [sp, #16]
+  ldp x23, x24, [sp, #32]
+  ldp x25, x26, [sp, #48]
+  ldp x27, x28, [sp, #64]
+  ldp x29, x30, [sp, #80]
+  ldp d8, d9, [sp, #96]
+  ldp d10, d11, [sp, #112]
+  ldp d12, d13, [sp, #128]
+  ldp d14, d15, [sp, #144]
+  add sp, sp, #160
+  ret
+  .size dispatcherSwitchContext, .-dispatcherSwitchContext
+
+  .p2align 4
+  .globl dispatcherContextEntry
+  .hidden dispatcherContextEntry
+  .type dispatcherContextEntry, %function
+dispatcherContextEntry:
+  mov x0, x19
+  blr x20
+  brk #0
+  .size dispatcherContextEntry, .-dispatcherContextEntry
+)");
+#endif
+#endif
+
 namespace System {
 
 namespace {
@@ -58,17 +162,120 @@ static_assert(Dispatcher::SIZEOF_PTHREAD_MUTEX_T == sizeof(pthread_mutex_t), "in
 
 //const size_t STACK_SIZE = 64 * 1024;
 const size_t STACK_SIZE = 512 * 1024;
+// ready descriptors harvested by one epoll_wait
+const int EPOLL_EVENT_BATCH = 64;
+// resolution of the timer wheel
+const uint64_t TIMER_TICK_NANOSECONDS = 1000000;
+
+uint64_t monotonicNanoseconds() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+size_t pageSize() {
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+// Stacks are mapped rather than allocated so that the kernel only commits the pages a context
+// actually touches, and the lowest page is left inaccessible so that an overflow faults instead
+// of silently corrupting a neighbouring stack.
+uint8_t* allocateStack() {
+  void* mapping = mmap(nullptr, pageSize() + STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Dispatcher::getReusableContext, mmap failed, " + lastErrorMessage());
+  }
+
+  if (mprotect(mapping, pageSize(), PROT_NONE) == -1) {
+    std::string message = lastErrorMessage();
+    munmap(mapping, pageSize() + STACK_SIZE);
+    throw std::runtime_error("Dispatcher::getReusableContext, mprotect failed, " + message);
+  }
+
+  return static_cast<uint8_t*>(mapping);
+}
+
+void freeStack(void* stack) {
+  auto result = munmap(stack, pageSize() + STACK_SIZE);
+  assert(result == 0);
+}
+
+#ifdef DISPATCHER_ASM_CONTEXT_SWITCH
+// A context is the stack pointer it was suspended at; the main context gets one on its first switch
+bool createMainContext(void*& context) {
+  context = nullptr;
+  return true;
+}
+
+void* makeContext(uint8_t* stack, void (*procedure)(void*), void* argument) {
+  uintptr_t top = reinterpret_cast<uintptr_t>(stack + pageSize() + STACK_SIZE) & ~uintptr_t(15);
+#if defined(__x86_64__)
+  // mxcsr and x87 control word, r15, r14, r13, r12, rbx, rbp, return address, and padding that
+  // leaves the stack aligned as at a call when the procedure is entered
+  uint64_t* frame = reinterpret_cast<uint64_t*>(top - 10 * sizeof(uint64_t));
+  memset(frame, 0, 10 * sizeof(uint64_t));
+  frame[0] = 0x1F80 | (uint64_t(0x037F) << 32);
+  frame[3] = reinterpret_cast<uint64_t>(procedure);
+  frame[4] = reinterpret_cast<uint64_t>(argument);
+  frame[7] = reinterpret_cast<uint64_t>(&dispatcherContextEntry);
+#else
+  // x19-x28, frame pointer, link register, d8-d15
+  uint64_t* frame = reinterpret_cast<uint64_t*>(top - 20 * sizeof(uint64_t));
+  memset(frame, 0, 20 * sizeof(uint64_t));
+  frame[0] = reinterpret_cast<uint64_t>(argument);
+  frame[1] = reinterpret_cast<uint64_t>(procedure);
+  frame[11] = reinterpret_cast<uint64_t>(&dispatcherContextEntry);
+#endif
+  return frame;
+}
+
+void switchContext(void*& from, void* to) {
+  dispatcherSwitchContext(&from, to);
+}
+
+void destroyContext(void*) {
+}
+#else
+bool createMainContext(void*& context) {
+  context = new ucontext_t;
+  return getcontext(static_cast<ucontext_t*>(context)) != -1;
+}
+
+void* makeContext(uint8_t* stack, void (*procedure)(void*), void* argument) {
+  ucontext_t* context = new ucontext_t;
+  if (getcontext(context) == -1) { //makecontext precondition
+    delete context;
+    throw std::runtime_error("Dispatcher::getReusableContext, getcontext failed, " + lastErrorMessage());
+  }
+
+  context->uc_stack.ss_sp = stack + pageSize();
+  context->uc_stack.ss_size = STACK_SIZE;
+  context->uc_link = nullptr;
+  makecontext(context, (void(*)())procedure, 1, argument);
+  return context;
+}
+
+void switchContext(void*& from, void* to) {
+  if (swapcontext(static_cast<ucontext_t*>(from), static_cast<ucontext_t*>(to)) == -1) {
+    throw std::runtime_error("Dispatcher, swapcontext failed, " + lastErrorMessage());
+  }
+}
+
+void destroyContext(void* context) {
+  delete static_cast<ucontext_t*>(context);
+}
+#endif
 
 };
 
-Dispatcher::Dispatcher() {
+Dispatcher::Dispatcher() : timerWheel(monotonicNanoseconds() / TIMER_TICK_NANOSECONDS), timerArmedTick(TimerWheel::NO_EVENT) {
   std::string message;
   epoll = ::epoll_create1(0);
   if (epoll == -1) {
     message = "epoll_create1 failed, " + lastErrorMessage();
   } else {
-    mainContext.ucontext = new ucontext_t;
-    if (getcontext(reinterpret_cast<ucontext_t*>(mainContext.ucontext)) == -1) {
+    if (!createMainContext(mainContext.ucontext)) {
       message = "getcontext failed, " + lastErrorMessage();
     } else {
       remoteSpawnEvent = eventfd(0, O_NONBLOCK);
@@ -85,21 +292,40 @@ Dispatcher::Dispatcher() {
         if (epoll_ctl(epoll, EPOLL_CTL_ADD, remoteSpawnEvent, &remoteSpawnEventEpollEvent) == -1) {
           message = "epoll_ctl failed, " + lastErrorMessage();
         } else {
-          *reinterpret_cast<pthread_mutex_t*>(this->mutex) = pthread_mutex_t(PTHREAD_MUTEX_INITIALIZER);
-
-          mainContext.interrupted = false;
-          mainContext.group = &contextGroup;
-          mainContext.groupPrev = nullptr;
-          mainContext.groupNext = nullptr;
-          contextGroup.firstContext = nullptr;
-          contextGroup.lastContext = nullptr;
-          contextGroup.firstWaiter = nullptr;
-          contextGroup.lastWaiter = nullptr;
-          currentContext = &mainContext;
-          firstResumingContext = nullptr;
-          firstReusableContext = nullptr;
-          runningContextCount = 0;
-          return;
+          timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+          if (timer == -1) {
+            message = "timerfd_create failed, " + lastErrorMessage();
+          } else {
+            timerEventContext.writeContext = nullptr;
+            timerEventContext.readContext = nullptr;
+
+            epoll_event timerEpollEvent;
+            timerEpollEvent.events = EPOLLIN;
+            timerEpollEvent.data.ptr = &timerEventContext;
+
+            if (epoll_ctl(epoll, EPOLL_CTL_ADD, timer, &timerEpollEvent) == -1) {
+              message = "epoll_ctl failed, " + lastErrorMessage();
+            } else {
+              *reinterpret_cast<pthread_mutex_t*>(this->mutex) = pthread_mutex_t(PTHREAD_MUTEX_INITIALIZER);
+
+              mainContext.interrupted = false;
+              mainContext.group = &contextGroup;
+              mainContext.groupPrev = nullptr;
+              mainContext.groupNext = nullptr;
+              contextGroup.firstContext = nullptr;
+              contextGroup.lastContext = nullptr;
+              contextGroup.firstWaiter = nullptr;
+              contextGroup.lastWaiter = nullptr;
+              currentContext = &mainContext;
+              firstResumingContext = nullptr;
+              firstReusableContext = nullptr;
+              runningContextCount = 0;
+              return;
+            }
+
+            auto result = close(timer);
+            assert(result == 0);
+          }
         }
 
         auto result = close(remoteSpawnEvent);
@@ -124,21 +350,11 @@ Dispatcher::~Dispatcher() {
   assert(contextGroup.firstWaiter == nullptr);
   assert(firstResumingContext == nullptr);
   assert(runningContextCount == 0);
-  while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
-    firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
-  }
-
-  while (!timers.empty()) {
-    int result = ::close(timers.top());
-    assert(result == 0);
-    timers.pop();
-  }
+  freeReusableContexts();
 
-  auto result = close(epoll);
+  auto result = close(timer);
+  assert(result == 0);
+  result = close(epoll);
   assert(result == 0);
   result = close(remoteSpawnEvent);
   assert(result == 0);
@@ -147,22 +363,7 @@ Dispatcher::~Dispatcher() {
 }
 
 void Dispatcher::clear() {
-  while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
-    firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
-  }
-
-  while (!timers.empty()) {
-    int result = ::close(timers.top());
-    if (result == -1) {
-      throw std::runtime_error("Dispatcher::clear, close failed, "  + lastErrorMessage());
-    }
-
-    timers.pop();
-  }
+  freeReusableContexts();
 }
 
 void Dispatcher::dispatch() {
@@ -174,38 +375,11 @@ void Dispatcher::dispatch() {
       break;
     }
 
-    epoll_event event;
-    int count = epoll_wait(epoll, &event, 1, -1);
-    if (count == 1) {
-      ContextPair *contextPair = static_cast<ContextPair*>(event.data.ptr);
-      if(((event.events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-        uint64_t buf;
-        auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-        if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-        }
-
-        MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-        while (!remoteSpawningProcedures.empty()) {
-          spawn(std::move(remoteSpawningProcedures.front()));
-          remoteSpawningProcedures.pop();
-        }
-
-        continue;
-      }
-
-      if ((event.events & EPOLLOUT) != 0) {
-        context = contextPair->writeContext->context;
-        contextPair->writeContext->events = event.events;
-      } else if ((event.events & EPOLLIN) != 0) {
-        context = contextPair->readContext->context;
-        contextPair->readContext->events = event.events;
-      } else {
-        continue;
-      }
-
-      assert(context != nullptr);
-      break;
+    epoll_event events[EPOLL_EVENT_BATCH];
+    int count = epoll_wait(epoll, events, EPOLL_EVENT_BATCH, -1);
+    if (count > 0) {
+      pushEventContexts(events, count);
+      continue;
     }
 
     if (errno != EINTR) {
@@ -214,11 +388,9 @@ void Dispatcher::dispatch() {
   }
 
   if (context != currentContext) {
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
+    NativeContext* oldContext = currentContext;
     currentContext = context;
-    if (swapcontext(oldContext, static_cast<ucontext_t *>(context->ucontext)) == -1) {
-      throw std::runtime_error("Dispatcher::dispatch, swapcontext failed, " + lastErrorMessage());
-    }
+    switchContext(oldContext->ucontext, context->ucontext);
   }
 }
 
@@ -298,53 +470,14 @@ void Dispatcher::spawn(std::function<void()>&& procedure) {
 
 void Dispatcher::yield() {
   for(;;){
-    epoll_event events[16];
-    int count = epoll_wait(epoll, events, 16, 0);
+    epoll_event events[EPOLL_EVENT_BATCH];
+    int count = epoll_wait(epoll, events, EPOLL_EVENT_BATCH, 0);
     if (count == 0) {
       break;
     }
 
     if(count > 0) {
-      for(int i = 0; i < count; ++i) {
-        ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
-        if(((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-          uint64_t buf;
-          auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-          if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-          }
-
-          MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-          while (!remoteSpawningProcedures.empty()) {
-            spawn(std::move(remoteSpawningProcedures.front()));
-            remoteSpawningProcedures.pop();
-          }
-
-          continue;
-        }
-
-        if ((events[i].events & EPOLLOUT) != 0) {
-          if(contextPair->writeContext != nullptr) {
-            if(contextPair->writeContext->context != nullptr) {
-              contextPair->writeContext->context->interruptProcedure = nullptr;
-            }
-          }
-          pushContext(contextPair->writeContext->context);
-          contextPair->writeContext->events = events[i].events;
-        } else if ((events[i].events & EPOLLIN) != 0) {
-          if(contextPair->readContext != nullptr) {
-            if(contextPair->readContext->context != nullptr) {
-              contextPair->readContext->context->interruptProcedure = nullptr;
-            }
-          }
-          pushContext(contextPair->readContext->context);
-          contextPair->readContext->events = events[i].events;
-        } else if ((events[i].events & (EPOLLERR | EPOLLHUP)) != 0) {
-          throw std::runtime_error("Dispatcher::dispatch, events & (EPOLLERR | EPOLLHUP) != 0");
-        } else {
-          continue;
-        }
-      }
+      pushEventContexts(events, count);
     } else {
       if (errno != EINTR) {
         throw std::runtime_error("Dispatcher::dispatch, epoll_wait failed, " + lastErrorMessage());
@@ -358,32 +491,76 @@ void Dispatcher::yield() {
   }
 }
 
+// Queues the context waiting on each ready descriptor, so one epoll_wait serves a whole batch of
+// connections. Descriptors are armed with EPOLLONESHOT, so a context is never queued twice, and its
+// interrupt procedure is dropped because it is already on its way to be resumed.
+void Dispatcher::pushEventContexts(const epoll_event* events, int count) {
+  for (int i = 0; i < count; ++i) {
+    ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
+    if (contextPair == &timerEventContext) {
+      uint64_t expirations;
+      if (read(timer, &expirations, sizeof expirations) == -1 && errno != EAGAIN) {
+        throw std::runtime_error("Dispatcher::dispatch, read(timer) failed, " + lastErrorMessage());
+      }
+
+      timerArmedTick = TimerWheel::NO_EVENT;
+      expireTimers(monotonicNanoseconds() / TIMER_TICK_NANOSECONDS);
+      armTimer();
+      continue;
+    }
+
+    if(((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
+      uint64_t buf;
+      auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
+      if(transferred == -1) {
+        throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
+      }
+
+      MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
+      while (!remoteSpawningProcedures.empty()) {
+        spawn(std::move(remoteSpawningProcedures.front()));
+        remoteSpawningProcedures.pop();
+      }
+
+      continue;
+    }
+
+    OperationContext* operationContext;
+    if ((events[i].events & EPOLLOUT) != 0) {
+      operationContext = contextPair->writeContext;
+    } else if ((events[i].events & EPOLLIN) != 0) {
+      operationContext = contextPair->readContext;
+    } else {
+      continue;
+    }
+
+    assert(operationContext != nullptr && operationContext->context != nullptr);
+    operationContext->events = events[i].events;
+    operationContext->context->interruptProcedure = nullptr;
+    pushContext(operationContext->context);
+  }
+}
+
 int Dispatcher::getEpoll() const {
   return epoll;
 }
 
 NativeContext& Dispatcher::getReusableContext() {
   if(firstReusableContext == nullptr) {
-    ucontext_t* newlyCreatedContext = new ucontext_t;
-    if (getcontext(newlyCreatedContext) == -1) { //makecontext precondition
-      throw std::runtime_error("Dispatcher::getReusableContext, getcontext failed, " + lastErrorMessage());
-    }
-
-    auto stackPointer = new uint8_t[STACK_SIZE];
-    newlyCreatedContext->uc_stack.ss_sp = stackPointer;
-    newlyCreatedContext->uc_stack.ss_size = STACK_SIZE;
-
-    ContextMakingData makingContextData {this, newlyCreatedContext};
-    makecontext(newlyCreatedContext, (void(*)())contextProcedureStatic, 1, reinterpret_cast<int*>(&makingContextData));
-
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
-    if (swapcontext(oldContext, newlyCreatedContext) == -1) {
-      throw std::runtime_error("Dispatcher::getReusableContext, swapcontext failed, " + lastErrorMessage());
+    uint8_t* stack = allocateStack();
+    void* newlyCreatedContext;
+    try {
+      ContextMakingData makingContextData {this, nullptr};
+      newlyCreatedContext = makeContext(stack, contextProcedureStatic, &makingContextData);
+      makingContextData.ucontext = newlyCreatedContext;
+      switchContext(currentContext->ucontext, newlyCreatedContext);
+    } catch (std::exception&) {
+      freeStack(stack);
+      throw;
     }
 
     assert(firstReusableContext != nullptr);
-    assert(firstReusableContext->ucontext == newlyCreatedContext);
-    firstReusableContext->stackPtr = stackPointer;
+    firstReusableContext->stackPtr = stack;
   };
 
   NativeContext* context = firstReusableContext;
@@ -391,33 +568,68 @@ NativeContext& Dispatcher::getReusableContext() {
   return *context;
 }
 
+void Dispatcher::freeReusableContexts() {
+  while (firstReusableContext != nullptr) {
+    void* ucontext = firstReusableContext->ucontext;
+    void* stackPtr = firstReusableContext->stackPtr;
+    firstReusableContext = firstReusableContext->next;
+    freeStack(stackPtr);
+    destroyContext(ucontext);
+  }
+}
+
 void Dispatcher::pushReusableContext(NativeContext& context) {
   context.next = firstReusableContext;
   firstReusableContext = &context;
   --runningContextCount;
 }
 
-int Dispatcher::getTimer() {
-  int timer;
-  if (timers.empty()) {
-    timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-    epoll_event timerEvent;
-    timerEvent.events = 0;
-    timerEvent.data.ptr = nullptr;
+void Dispatcher::addTimer(TimerContext& timer, std::chrono::nanoseconds duration) {
+  uint64_t now = monotonicNanoseconds();
+  uint64_t delay = duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0;
+  // catch the wheel up first, so that its cascades are not scheduled for ticks long gone
+  expireTimers(now / TIMER_TICK_NANOSECONDS);
+  timerWheel.add(timer, (now + delay + TIMER_TICK_NANOSECONDS - 1) / TIMER_TICK_NANOSECONDS);
+  armTimer();
+}
 
-    if (epoll_ctl(getEpoll(), EPOLL_CTL_ADD, timer, &timerEvent) == -1) {
-      throw std::runtime_error("Dispatcher::getTimer, epoll_ctl failed, "  + lastErrorMessage());
-    }
-  } else {
-    timer = timers.top();
-    timers.pop();
-  }
+// The kernel timer is left running when a timer is removed; if it goes off early the wheel
+// simply has nothing to expire and it is armed again for the next event.
+void Dispatcher::removeTimer(TimerContext& timer) {
+  timerWheel.remove(timer);
+}
 
-  return timer;
+void Dispatcher::expireTimers(uint64_t tick) {
+  TimerWheelEntry* entry = timerWheel.advance(tick);
+  while (entry != nullptr) {
+    TimerContext* timer = static_cast<TimerContext*>(entry);
+    entry = entry->next;
+    timer->context->interruptProcedure = nullptr;
+    pushContext(timer->context);
+  }
 }
 
-void Dispatcher::pushTimer(int timer) {
-  timers.push(timer);
+// Only ever moves the kernel timer earlier; the expiry handler disarms it before re-arming
+void Dispatcher::armTimer() {
+  uint64_t tick = timerWheel.nextEvent();
+  if (tick >= timerArmedTick) {
+    return;
+  }
+
+  uint64_t nanoseconds = tick * TIMER_TICK_NANOSECONDS;
+  itimerspec expires;
+  expires.it_interval.tv_sec = expires.it_interval.tv_nsec = 0;
+  expires.it_value.tv_sec = nanoseconds / 1000000000;
+  expires.it_value.tv_nsec = nanoseconds % 1000000000;
+  if (expires.it_value.tv_sec == 0 && expires.it_value.tv_nsec == 0) {
+    expires.it_value.tv_nsec = 1;
+  }
+
+  if (timerfd_settime(timer, TFD_TIMER_ABSTIME, &expires, nullptr) == -1) {
+    throw std::runtime_error("Dispatcher::armTimer, timerfd_settime failed, " + lastErrorMessage());
+  }
+
+  timerArmedTick = tick;
 }
 
 void Dispatcher::contextProcedure(void* ucontext) {
@@ -427,10 +639,7 @@ void Dispatcher::contextProcedure(void* ucontext) {
   context.interrupted = false;
   context.next = nullptr;
   firstReusableContext = &context;
-  ucontext_t* oldContext = static_cast<ucontext_t*>(context.ucontext);
-  if (swapcontext(oldContext, static_cast<ucontext_t*>(currentContext->ucontext)) == -1) {
-    throw std::runtime_error("Dispatcher::contextProcedure, swapcontext failed, " + lastErrorMessage());
-  }
+  switchContext(context.ucontext, currentContext->ucontext);
 
   for (;;) {
     ++runningContextCount;
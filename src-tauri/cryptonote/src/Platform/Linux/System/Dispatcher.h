@@ -17,15 +17,19 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <queue>
-#include <stack>
 #ifndef __GLIBC__
 #include <bits/reg.h>
 #endif
 
+#include "TimerWheel.h"
+
+struct epoll_event;
+
 namespace System {
 
 struct NativeContextGroup;
@@ -61,6 +65,11 @@ struct ContextPair {
   OperationContext *writeContext;
 };
 
+struct TimerContext : TimerWheelEntry {
+  NativeContext* context;
+  bool interrupted;
+};
+
 class Dispatcher {
 public:
   Dispatcher();
@@ -80,9 +89,11 @@ public:
   // system-dependent
   int getEpoll() const;
   NativeContext& getReusableContext();
+  void freeReusableContexts();
   void pushReusableContext(NativeContext&);
-  int getTimer();
-  void pushTimer(int timer);
+  // Resumes timer.context once duration has passed; all timers share the dispatcher's timerfd
+  void addTimer(TimerContext& timer, std::chrono::nanoseconds duration);
+  void removeTimer(TimerContext& timer);
 
 #ifdef __x86_64__
 #if __WORDSIZE == 64
@@ -100,12 +111,18 @@ public:
 
 private:
   void spawn(std::function<void()>&& procedure);
+  void pushEventContexts(const epoll_event* events, int count);
+  void expireTimers(uint64_t tick);
+  void armTimer();
   int epoll;
   alignas(void*) uint8_t mutex[SIZEOF_PTHREAD_MUTEX_T];
   int remoteSpawnEvent;
   ContextPair remoteSpawnEventContext;
   std::queue<std::function<void()>> remoteSpawningProcedures;
-  std::stack<int> timers;
+  int timer;
+  ContextPair timerEventContext;
+  TimerWheel timerWheel;
+  uint64_t timerArmedTick;
 
   NativeContext mainContext;
   NativeContextGroup contextGroup;
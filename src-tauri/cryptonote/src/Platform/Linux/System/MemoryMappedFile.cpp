@@ -181,6 +181,42 @@ void MemoryMappedFile::rename(const std::string& newPath) {
   }
 }
 
+void MemoryMappedFile::resize(uint64_t newSize, std::error_code& ec) {
+  assert(isOpened());
+
+  // the file must cover the whole mapping, so it grows before the mapping and shrinks after it
+  if (newSize > m_size && ::ftruncate(m_file, static_cast<off_t>(newSize)) == -1) {
+    ec = std::error_code(errno, std::system_category());
+    return;
+  }
+
+  void* data = ::mremap(m_data, static_cast<size_t>(m_size), static_cast<size_t>(newSize), MREMAP_MAYMOVE);
+  if (data == MAP_FAILED) {
+    ec = std::error_code(errno, std::system_category());
+    return;
+  }
+
+  m_data = reinterpret_cast<uint8_t*>(data);
+  m_size = newSize;
+
+  if (::ftruncate(m_file, static_cast<off_t>(newSize)) == -1) {
+    ec = std::error_code(errno, std::system_category());
+    return;
+  }
+
+  ec = std::error_code();
+}
+
+void MemoryMappedFile::resize(uint64_t newSize) {
+  assert(isOpened());
+
+  std::error_code ec;
+  resize(newSize, ec);
+  if (ec) {
+    throw std::system_error(ec, "MemoryMappedFile::resize");
+  }
+}
+
 void MemoryMappedFile::close(std::error_code& ec) {
   int result;
   if (m_data != nullptr) {
@@ -249,6 +285,17 @@ void MemoryMappedFile::flush(uint8_t* data, uint64_t size) {
   }
 }
 
+void MemoryMappedFile::willNeed(const uint8_t* data, uint64_t size) {
+  assert(isOpened());
+
+  uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  uintptr_t dataAddr = reinterpret_cast<uintptr_t>(data);
+  uintptr_t pageOffset = (dataAddr / pageSize) * pageSize;
+
+  // only a hint, reads still work if it fails
+  ::madvise(reinterpret_cast<void*>(pageOffset), static_cast<size_t>(dataAddr % pageSize + size), MADV_WILLNEED);
+}
+
 void MemoryMappedFile::swap(MemoryMappedFile& other) {
   std::swap(m_file, other.m_file);
   std::swap(m_path, other.m_path);
@@ -24,10 +24,37 @@
 #include <cassert>
 #include <stdexcept>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace System {
 
+namespace {
+
+ssize_t sendBuffers(int connection, const uint8_t* head, size_t headSize, const uint8_t* data, size_t size, int flags) {
+  iovec buffers[2];
+  size_t count = 0;
+  if (headSize != 0) {
+    buffers[count].iov_base = const_cast<uint8_t*>(head);
+    buffers[count].iov_len = headSize;
+    ++count;
+  }
+
+  if (size != 0) {
+    buffers[count].iov_base = const_cast<uint8_t*>(data);
+    buffers[count].iov_len = size;
+    ++count;
+  }
+
+  msghdr message = {};
+  message.msg_iov = buffers;
+  message.msg_iovlen = count;
+  return ::sendmsg(connection, &message, flags);
+}
+
+}
+
 TcpConnection::TcpConnection() : dispatcher(nullptr) {
 }
 
@@ -160,6 +187,10 @@ size_t TcpConnection::read(uint8_t* data, size_t size) {
 }
 
 std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
+  return write(nullptr, 0, data, size);
+}
+
+std::size_t TcpConnection::write(const uint8_t* head, size_t headSize, const uint8_t* data, size_t size) {
   assert(dispatcher != nullptr);
   assert(contextPair.writeContext == nullptr);
   if (dispatcher->interrupted()) {
@@ -167,7 +198,7 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
   }
 
   std::string message;
-  if(size == 0) {
+  if(headSize + size == 0) {
     if(shutdown(connection, SHUT_WR) == -1) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + lastErrorMessage());
     }
@@ -175,7 +206,7 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, MSG_NOSIGNAL);
+  ssize_t transferred = sendBuffers(connection, head, headSize, data, size, MSG_NOSIGNAL);
   if (transferred == -1) {
     if (errno != EAGAIN) {
       message = "send failed, " + lastErrorMessage();
@@ -238,11 +269,11 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
           throw std::runtime_error("TcpConnection::write, events & (EPOLLERR | EPOLLHUP) != 0");
         }
 
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
+        ssize_t transferred = sendBuffers(connection, head, headSize, data, size, 0);
         if (transferred == -1) {
           message = "send failed, "  + lastErrorMessage();
         } else {
-          assert(transferred <= static_cast<ssize_t>(size));
+          assert(transferred <= static_cast<ssize_t>(headSize + size));
           return transferred;
         }
       }
@@ -251,7 +282,7 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw std::runtime_error("TcpConnection::write, " + message);
   }
 
-  assert(transferred <= static_cast<ssize_t>(size));
+  assert(transferred <= static_cast<ssize_t>(headSize + size));
   return transferred;
 }
 
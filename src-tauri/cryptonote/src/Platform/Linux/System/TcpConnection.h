@@ -25,6 +25,8 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   std::size_t read(uint8_t* data, std::size_t size);
   std::size_t write(const uint8_t* data, std::size_t size);
+  // sends head and data with one gather write, returns how many bytes of both were written
+  std::size_t write(const uint8_t* head, std::size_t headSize, const uint8_t* data, std::size_t size);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -26,7 +26,6 @@ public:
 private:
   Dispatcher* dispatcher;
   void* context;
-  int timer;
 };
 
 }
@@ -0,0 +1,163 @@
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+//
+// This file is part of Bytecoin.
+//
+// Bytecoin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Bytecoin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Bytecoin.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "TimerWheel.h"
+
+#include <cassert>
+
+namespace System {
+
+TimerWheel::TimerWheel(uint64_t now) : currentTick(now), count(0) {
+  for (unsigned level = 0; level < LEVELS; ++level) {
+    occupied[level] = 0;
+  }
+
+  for (unsigned slot = 0; slot <= OVERFLOW_SLOT; ++slot) {
+    slots[slot] = nullptr;
+  }
+}
+
+void TimerWheel::add(TimerWheelEntry& entry, uint64_t deadline) {
+  entry.deadline = deadline < currentTick ? currentTick : deadline;
+  link(entry);
+  ++count;
+}
+
+void TimerWheel::remove(TimerWheelEntry& entry) {
+  assert(count > 0);
+  if (entry.prev != nullptr) {
+    entry.prev->next = entry.next;
+  } else {
+    assert(slots[entry.slot] == &entry);
+    slots[entry.slot] = entry.next;
+    if (entry.next == nullptr && entry.slot != OVERFLOW_SLOT) {
+      occupied[entry.slot / SLOTS] &= ~(uint64_t(1) << (entry.slot % SLOTS));
+    }
+  }
+
+  if (entry.next != nullptr) {
+    entry.next->prev = entry.prev;
+  }
+
+  --count;
+}
+
+// The slot of each level before the one the current tick is in has already been cascaded, so
+// the earliest occupied slot at the lowest occupied level is the next thing to do
+uint64_t TimerWheel::nextEvent() const {
+  if (count == 0) {
+    return NO_EVENT;
+  }
+
+  for (unsigned level = 0; level < LEVELS; ++level) {
+    unsigned shift = LEVEL_BITS * level;
+    unsigned index = (currentTick >> shift) % SLOTS;
+    uint64_t pending = occupied[level];
+    if (level == 0) {
+      pending &= ~uint64_t(0) << index;
+    } else {
+      pending &= index + 1 < SLOTS ? ~uint64_t(0) << (index + 1) : 0;
+    }
+
+    if (pending != 0) {
+      uint64_t block = currentTick >> (shift + LEVEL_BITS);
+      return ((block << LEVEL_BITS) | __builtin_ctzll(pending)) << shift;
+    }
+  }
+
+  return ((currentTick >> (LEVEL_BITS * LEVELS)) + 1) << (LEVEL_BITS * LEVELS);
+}
+
+TimerWheelEntry* TimerWheel::advance(uint64_t tick) {
+  TimerWheelEntry* expired = nullptr;
+  TimerWheelEntry** expiredTail = &expired;
+  for (;;) {
+    uint64_t next = nextEvent();
+    if (next > tick) {
+      break;
+    }
+
+    currentTick = next;
+    for (unsigned level = LEVELS; level > 0; --level) {
+      unsigned shift = LEVEL_BITS * level;
+      if ((currentTick & ((uint64_t(1) << shift) - 1)) != 0) {
+        continue;
+      }
+
+      unsigned slot = level == LEVELS ? OVERFLOW_SLOT : level * SLOTS + (currentTick >> shift) % SLOTS;
+      for (TimerWheelEntry* entry = takeSlot(slot); entry != nullptr; ) {
+        TimerWheelEntry* cascaded = entry;
+        entry = entry->next;
+        link(*cascaded);
+      }
+    }
+
+    for (TimerWheelEntry* entry = takeSlot(currentTick % SLOTS); entry != nullptr; entry = entry->next) {
+      assert(entry->deadline == currentTick);
+      *expiredTail = entry;
+      expiredTail = &entry->next;
+      --count;
+    }
+  }
+
+  if (tick > currentTick) {
+    currentTick = tick;
+  }
+
+  return expired;
+}
+
+// Entries go to the lowest level whose slots still tell their deadline apart from the current
+// tick; everything above that level is shared with the current tick
+unsigned TimerWheel::slotFor(uint64_t deadline) const {
+  uint64_t differing = deadline ^ currentTick;
+  for (unsigned level = 0; level < LEVELS; ++level) {
+    unsigned shift = LEVEL_BITS * level;
+    if ((differing >> (shift + LEVEL_BITS)) == 0) {
+      return level * SLOTS + (deadline >> shift) % SLOTS;
+    }
+  }
+
+  return OVERFLOW_SLOT;
+}
+
+void TimerWheel::link(TimerWheelEntry& entry) {
+  entry.slot = slotFor(entry.deadline);
+  entry.prev = nullptr;
+  entry.next = slots[entry.slot];
+  if (entry.next != nullptr) {
+    entry.next->prev = &entry;
+  }
+
+  slots[entry.slot] = &entry;
+  if (entry.slot != OVERFLOW_SLOT) {
+    occupied[entry.slot / SLOTS] |= uint64_t(1) << (entry.slot % SLOTS);
+  }
+}
+
+TimerWheelEntry* TimerWheel::takeSlot(unsigned slot) {
+  TimerWheelEntry* entries = slots[slot];
+  slots[slot] = nullptr;
+  if (slot != OVERFLOW_SLOT) {
+    occupied[slot / SLOTS] &= ~(uint64_t(1) << (slot % SLOTS));
+  }
+
+  return entries;
+}
+
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+//
+// This file is part of Bytecoin.
+//
+// Bytecoin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Bytecoin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Bytecoin.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace System {
+
+// Intrusive node of a TimerWheel, owned by whoever arms it
+struct TimerWheelEntry {
+  TimerWheelEntry* prev;
+  TimerWheelEntry* next;
+  uint64_t deadline;
+  unsigned slot;
+};
+
+// Hierarchical timing wheel over integer ticks. Adding and removing an entry is O(1); advancing
+// jumps straight to the next occupied slot using a bitmask per level, so idle spans cost nothing.
+// Entries beyond the range of the top level wait on an overflow list until the wheel gets there.
+class TimerWheel {
+public:
+  static const unsigned LEVEL_BITS = 6;
+  static const unsigned SLOTS = 1 << LEVEL_BITS;
+  static const unsigned LEVELS = 6;
+  static const uint64_t NO_EVENT = UINT64_MAX;
+
+  explicit TimerWheel(uint64_t now);
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  bool empty() const { return count == 0; }
+  uint64_t now() const { return currentTick; }
+
+  // A deadline that has already passed expires on the next advance
+  void add(TimerWheelEntry& entry, uint64_t deadline);
+  void remove(TimerWheelEntry& entry);
+
+  // First tick at which advance has work to do, an expiry or a cascade; NO_EVENT if empty
+  uint64_t nextEvent() const;
+
+  // Moves the wheel to tick and returns the entries with deadline <= tick, unlinked from the
+  // wheel and chained through next
+  TimerWheelEntry* advance(uint64_t tick);
+
+private:
+  static const unsigned OVERFLOW_SLOT = LEVELS * SLOTS;
+
+  unsigned slotFor(uint64_t deadline) const;
+  void link(TimerWheelEntry& entry);
+  TimerWheelEntry* takeSlot(unsigned slot);
+
+  uint64_t currentTick;
+  size_t count;
+  uint64_t occupied[LEVELS];
+  TimerWheelEntry* slots[LEVELS * SLOTS + 1];
+};
+
+}
@@ -15,9 +15,31 @@
 #include <System/ErrorMessage.h>
 #include <System/InterruptedException.h>
 #include <System/Ipv4Address.h>
+#include <System/Ipv4ResolverCache.h>
+#include <System/RemoteContext.h>
 
 namespace System {
 
+namespace {
+
+int lookup(const std::string& host, int flags, std::vector<Ipv4Address>& addresses) {
+  addrinfo hints = { flags, AF_INET, SOCK_STREAM, IPPROTO_TCP, 0, NULL, NULL, NULL };
+  addrinfo* addressInfos;
+  int result = getaddrinfo(host.c_str(), NULL, &hints, &addressInfos);
+  if (result != 0) {
+    return result;
+  }
+
+  for (addrinfo* addressInfo = addressInfos; addressInfo != nullptr; addressInfo = addressInfo->ai_next) {
+    addresses.emplace_back(ntohl(reinterpret_cast<sockaddr_in*>(addressInfo->ai_addr)->sin_addr.s_addr));
+  }
+
+  freeaddrinfo(addressInfos);
+  return 0;
+}
+
+}
+
 Ipv4Resolver::Ipv4Resolver() : dispatcher(nullptr) {
 }
 
@@ -43,33 +65,31 @@ Ipv4Resolver& Ipv4Resolver::operator=(Ipv4Resolver&& other) {
 }
 
 Ipv4Address Ipv4Resolver::resolve(const std::string& host) {
+  std::vector<Ipv4Address> addresses = resolveAll(host);
+  std::mt19937 generator{ std::random_device()() };
+  return addresses[std::uniform_int_distribution<std::size_t>(0, addresses.size() - 1)(generator)];
+}
+
+std::vector<Ipv4Address> Ipv4Resolver::resolveAll(const std::string& host) {
   assert(dispatcher != nullptr);
   if (dispatcher->interrupted()) {
     throw InterruptedException();
   }
 
-  addrinfo hints = { 0, AF_INET, SOCK_STREAM, IPPROTO_TCP, 0, NULL, NULL, NULL };
-  addrinfo* addressInfos;
-  int result = getaddrinfo(host.c_str(), NULL, &hints, &addressInfos);
-  if (result != 0) {
-    throw std::runtime_error("Ipv4Resolver::resolve, getaddrinfo failed, " + errorMessage(result));
-  }
-  
-  std::size_t count = 0;
-  for (addrinfo* addressInfo = addressInfos; addressInfo != nullptr; addressInfo = addressInfo->ai_next) {
-    ++count;
+  // AI_NUMERICHOST only parses the string, dotted addresses are answered right here
+  std::vector<Ipv4Address> addresses;
+  if (lookup(host, AI_NUMERICHOST, addresses) == 0 || Ipv4ResolverCache::instance().find(host, addresses)) {
+    return addresses;
   }
 
-  std::mt19937 generator{ std::random_device()() };
-  std::size_t index = std::uniform_int_distribution<std::size_t>(0, count - 1)(generator);
-  addrinfo* addressInfo = addressInfos;
-  for (std::size_t i = 0; i < index; ++i) {
-    addressInfo = addressInfo->ai_next;
+  // a DNS round trip on the dispatcher thread would stall every context, so it waits on a helper thread
+  int result = RemoteContext<int>(*dispatcher, [&] { return lookup(host, 0, addresses); }).get();
+  if (result != 0) {
+    throw std::runtime_error("Ipv4Resolver::resolve, getaddrinfo failed, " + errorMessage(result));
   }
 
-  Ipv4Address address(ntohl(reinterpret_cast<sockaddr_in*>(addressInfo->ai_addr)->sin_addr.s_addr));
-  freeaddrinfo(addressInfo);
-  return address;
+  Ipv4ResolverCache::instance().insert(host, addresses);
+  return addresses;
 }
 
 }
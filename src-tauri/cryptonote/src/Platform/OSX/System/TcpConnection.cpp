@@ -11,6 +11,7 @@
 #include <sys/event.h>
 #include <sys/errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "Dispatcher.h"
@@ -20,6 +21,31 @@
 
 namespace System {
 
+namespace {
+
+ssize_t sendBuffers(int connection, const uint8_t* head, size_t headSize, const uint8_t* data, size_t size, int flags) {
+  iovec buffers[2];
+  size_t count = 0;
+  if (headSize != 0) {
+    buffers[count].iov_base = const_cast<uint8_t*>(head);
+    buffers[count].iov_len = headSize;
+    ++count;
+  }
+
+  if (size != 0) {
+    buffers[count].iov_base = const_cast<uint8_t*>(data);
+    buffers[count].iov_len = size;
+    ++count;
+  }
+
+  msghdr message = {};
+  message.msg_iov = buffers;
+  message.msg_iovlen = count;
+  return ::sendmsg(connection, &message, flags);
+}
+
+}
+
 TcpConnection::TcpConnection() : dispatcher(nullptr) {
 }
 
@@ -133,6 +159,10 @@ size_t TcpConnection::read(uint8_t* data, size_t size) {
 }
 
 size_t TcpConnection::write(const uint8_t* data, size_t size) {
+  return write(nullptr, 0, data, size);
+}
+
+size_t TcpConnection::write(const uint8_t* head, size_t headSize, const uint8_t* data, size_t size) {
   assert(dispatcher != nullptr);
   assert(writeContext == nullptr);
   if (dispatcher->interrupted()) {
@@ -140,7 +170,7 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
   }
 
   std::string message;
-  if (size == 0) {
+  if (headSize + size == 0) {
     if (shutdown(connection, SHUT_WR) == -1) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + lastErrorMessage());
     }
@@ -148,7 +178,7 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, 0);
+  ssize_t transferred = sendBuffers(connection, head, headSize, data, size, 0);
   if (transferred == -1) {
     if (errno != EAGAIN  && errno != EWOULDBLOCK) {
       message = "send failed, " + lastErrorMessage();
@@ -190,11 +220,11 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
           throw InterruptedException();
         }
 
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
+        ssize_t transferred = sendBuffers(connection, head, headSize, data, size, 0);
         if (transferred == -1) {
           message = "send failed, " + lastErrorMessage();
         } else {
-          assert(transferred <= static_cast<ssize_t>(size));
+          assert(transferred <= static_cast<ssize_t>(headSize + size));
           return transferred;
         }
       }
@@ -203,7 +233,7 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw std::runtime_error("TcpConnection::write, " + message);
   }
 
-  assert(transferred <= static_cast<ssize_t>(size));
+  assert(transferred <= static_cast<ssize_t>(headSize + size));
   return transferred;
 }
 
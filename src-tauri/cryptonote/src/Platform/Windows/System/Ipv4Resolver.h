@@ -7,6 +7,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace System {
 
@@ -23,6 +24,8 @@ public:
   Ipv4Resolver& operator=(const Ipv4Resolver&) = delete;
   Ipv4Resolver& operator=(Ipv4Resolver&& other);
       Ipv4Address resolve(const std::string& host);
+  // all addresses of the host, in the order the system resolver prefers them
+  std::vector<Ipv4Address> resolveAll(const std::string& host);
 
 private:
   Dispatcher* dispatcher;
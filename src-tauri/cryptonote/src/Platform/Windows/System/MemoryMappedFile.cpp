@@ -208,6 +208,70 @@ void MemoryMappedFile::rename(const std::string& newPath) {
   }
 }
 
+void MemoryMappedFile::resize(uint64_t newSize, std::error_code& ec) {
+  assert(isOpened());
+
+  // a file can't change size while a view of it is mapped
+  flush(m_data, m_size, ec);
+  if (ec) {
+    return;
+  }
+
+  if (!::UnmapViewOfFile(m_data)) {
+    ec = std::error_code(::GetLastError(), std::system_category());
+    return;
+  }
+
+  m_data = nullptr;
+
+  Tools::ScopeExit failExitHandler([this, &ec] {
+    ec = std::error_code(::GetLastError(), std::system_category());
+    std::error_code ignore;
+    close(ignore);
+  });
+
+  if (!::CloseHandle(m_mappingHandle)) {
+    return;
+  }
+
+  m_mappingHandle = INVALID_HANDLE_VALUE;
+
+  LONG distanceToMoveHigh = static_cast<LONG>((newSize >> 32) & UINT64_C(0xffffffff));
+  DWORD filePointer = ::SetFilePointer(m_fileHandle, static_cast<LONG>(newSize & UINT64_C(0xffffffff)), &distanceToMoveHigh, FILE_BEGIN);
+  if (filePointer == INVALID_SET_FILE_POINTER) {
+    return;
+  }
+
+  if (!::SetEndOfFile(m_fileHandle)) {
+    return;
+  }
+
+  m_mappingHandle = ::CreateFileMapping(m_fileHandle, NULL, PAGE_READWRITE, 0, 0, NULL);
+  if (m_mappingHandle == NULL) {
+    return;
+  }
+
+  m_data = reinterpret_cast<uint8_t*>(::MapViewOfFile(m_mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+  if (m_data == NULL) {
+    return;
+  }
+
+  m_size = newSize;
+  ec = std::error_code();
+
+  failExitHandler.cancel();
+}
+
+void MemoryMappedFile::resize(uint64_t newSize) {
+  assert(isOpened());
+
+  std::error_code ec;
+  resize(newSize, ec);
+  if (ec) {
+    throw std::system_error(ec, "MemoryMappedFile::resize");
+  }
+}
+
 void MemoryMappedFile::close(std::error_code& ec) {
   BOOL result;
   if (m_data != nullptr) {
@@ -282,6 +346,11 @@ void MemoryMappedFile::flush(uint8_t* data, uint64_t size) {
   }
 }
 
+void MemoryMappedFile::willNeed(const uint8_t* data, uint64_t size) {
+  assert(isOpened());
+  // PrefetchVirtualMemory needs Windows 8, the pages are faulted in on first read instead
+}
+
 void MemoryMappedFile::swap(MemoryMappedFile& other) {
   std::swap(m_fileHandle, other.m_fileHandle);
   std::swap(m_mappingHandle, other.m_mappingHandle);
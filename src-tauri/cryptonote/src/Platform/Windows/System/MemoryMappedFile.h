@@ -43,9 +43,14 @@ public:
 
   void rename(const std::string& newPath, std::error_code& ec);
   void rename(const std::string& newPath);
+  // grows or shrinks the file and maps it again, data() may move
+  void resize(uint64_t newSize, std::error_code& ec);
+  void resize(uint64_t newSize);
 
   void flush(uint8_t* data, uint64_t size, std::error_code& ec);
   void flush(uint8_t* data, uint64_t size);
+  // hint that [data, data + size) is about to be read; the pages are read in the background
+  void willNeed(const uint8_t* data, uint64_t size);
 
   void swap(MemoryMappedFile& other);
 
@@ -136,13 +136,17 @@ size_t TcpConnection::read(uint8_t* data, size_t size) {
 }
 
 size_t TcpConnection::write(const uint8_t* data, size_t size) {
+  return write(nullptr, 0, data, size);
+}
+
+size_t TcpConnection::write(const uint8_t* head, size_t headSize, const uint8_t* data, size_t size) {
   assert(dispatcher != nullptr);
   assert(writeContext == nullptr);
   if (dispatcher->interrupted()) {
     throw InterruptedException();
   }
 
-  if (size == 0) {
+  if (headSize + size == 0) {
     if (shutdown(connection, SD_SEND) != 0) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + errorMessage(WSAGetLastError()));
     }
@@ -150,10 +154,19 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  WSABUF buf{static_cast<ULONG>(size), reinterpret_cast<char*>(const_cast<uint8_t*>(data))};
+  WSABUF buffers[2];
+  DWORD count = 0;
+  if (headSize != 0) {
+    buffers[count++] = WSABUF{static_cast<ULONG>(headSize), reinterpret_cast<char*>(const_cast<uint8_t*>(head))};
+  }
+
+  if (size != 0) {
+    buffers[count++] = WSABUF{static_cast<ULONG>(size), reinterpret_cast<char*>(const_cast<uint8_t*>(data))};
+  }
+
   TcpConnectionContext context;
   context.hEvent = NULL;
-  if (WSASend(connection, &buf, 1, NULL, 0, &context, NULL) != 0) {
+  if (WSASend(connection, buffers, count, NULL, 0, &context, NULL) != 0) {
     int lastError = WSAGetLastError();
     if (lastError != WSA_IO_PENDING) {
       throw std::runtime_error("TcpConnection::write, WSASend failed, " + errorMessage(lastError));
@@ -199,7 +212,7 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw InterruptedException();
   }
 
-  assert(transferred == size);
+  assert(transferred == headSize + size);
   assert(flags == 0);
   return transferred;
 }
@@ -24,6 +24,8 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   size_t read(uint8_t* data, size_t size);
   size_t write(const uint8_t* data, size_t size);
+  // sends head and data with one gather write, returns how many bytes of both were written
+  size_t write(const uint8_t* head, size_t headSize, const uint8_t* data, size_t size);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -28,6 +28,7 @@ namespace CryptoNote {
 //-----------------------------------------------
 #define CORE_RPC_STATUS_OK "OK"
 #define CORE_RPC_STATUS_BUSY "BUSY"
+#define CORE_RPC_STATUS_NOT_MODIFIED "NOT MODIFIED"
 
 struct EMPTY_STRUCT {
   void serialize(ISerializer &s) {}
@@ -127,10 +128,15 @@ struct COMMAND_RPC_GET_POOL_CHANGES {
   struct request {
     Crypto::Hash tailBlockId;
     std::vector<Crypto::Hash> knownTxsIds;
+    // the pool version of the last answer, when knownTxsIds are what it left; 0 otherwise
+    uint64_t knownPoolId;
+    uint64_t knownPoolVersion;
 
     void serialize(ISerializer &s) {
       KV_MEMBER(tailBlockId)
       serializeAsBinary(knownTxsIds, "knownTxsIds", s);
+      KV_MEMBER(knownPoolId)
+      KV_MEMBER(knownPoolVersion)
     }
   };
 
@@ -138,12 +144,16 @@ struct COMMAND_RPC_GET_POOL_CHANGES {
     bool isTailBlockActual;
     std::vector<BinaryArray> addedTxs;          // Added transactions blobs
     std::vector<Crypto::Hash> deletedTxsIds; // IDs of not found transactions
+    uint64_t poolId;
+    uint64_t poolVersion;
     std::string status;
 
     void serialize(ISerializer &s) {
       KV_MEMBER(isTailBlockActual)
       KV_MEMBER(addedTxs)
       serializeAsBinary(deletedTxsIds, "deletedTxsIds", s);
+      KV_MEMBER(poolId)
+      KV_MEMBER(poolVersion)
       KV_MEMBER(status)
     }
   };
@@ -170,10 +180,15 @@ struct COMMAND_RPC_GET_POOL_CHANGES_LITE {
   struct request {
     Crypto::Hash tailBlockId;
     std::vector<Crypto::Hash> knownTxsIds;
+    // the pool version of the last answer, when knownTxsIds are what it left; 0 otherwise
+    uint64_t knownPoolId;
+    uint64_t knownPoolVersion;
 
     void serialize(ISerializer &s) {
       KV_MEMBER(tailBlockId)
       serializeAsBinary(knownTxsIds, "knownTxsIds", s);
+      KV_MEMBER(knownPoolId)
+      KV_MEMBER(knownPoolVersion)
     }
   };
 
@@ -181,12 +196,16 @@ struct COMMAND_RPC_GET_POOL_CHANGES_LITE {
     bool isTailBlockActual;
     std::vector<TransactionPrefixInfo> addedTxs;          // Added transactions blobs
     std::vector<Crypto::Hash> deletedTxsIds; // IDs of not found transactions
+    uint64_t poolId;
+    uint64_t poolVersion;
     std::string status;
 
     void serialize(ISerializer &s) {
       KV_MEMBER(isTailBlockActual)
       KV_MEMBER(addedTxs)
       serializeAsBinary(deletedTxsIds, "deletedTxsIds", s);
+      KV_MEMBER(poolId)
+      KV_MEMBER(poolVersion)
       KV_MEMBER(status)
     }
   };
@@ -414,14 +433,21 @@ struct COMMAND_RPC_GETBLOCKHASH {
   typedef std::string response;
 };
 
+// A request carrying the template_id of the template the miner already has is answered with
+// status NOT MODIFIED and no blob while the tip and the pool are unchanged; with a timeout it
+// waits up to that many seconds (at most a minute) for the tip to move or new transactions
 struct COMMAND_RPC_GETBLOCKTEMPLATE {
   struct request {
     uint64_t reserve_size; //max 255 bytes
     std::string wallet_address;
+    std::string template_id;
+    uint32_t timeout = 0;
 
     void serialize(ISerializer &s) {
       KV_MEMBER(reserve_size)
       KV_MEMBER(wallet_address)
+      KV_MEMBER(template_id)
+      KV_MEMBER(timeout)
     }
   };
 
@@ -430,6 +456,7 @@ struct COMMAND_RPC_GETBLOCKTEMPLATE {
     uint32_t height;
     uint64_t reserved_offset;
     std::string blocktemplate_blob;
+    std::string template_id;
     std::string status;
 
     void serialize(ISerializer &s) {
@@ -437,6 +464,7 @@ struct COMMAND_RPC_GETBLOCKTEMPLATE {
       KV_MEMBER(height)
       KV_MEMBER(reserved_offset)
       KV_MEMBER(blocktemplate_blob)
+      KV_MEMBER(template_id)
       KV_MEMBER(status)
     }
   };
@@ -668,6 +696,32 @@ struct COMMAND_RPC_GET_LAST_BLOCK_HEADER {
   typedef BLOCK_HEADER_RESPONSE response;
 };
 
+// Long poll for miners: answers as soon as the top block is no longer prev_hash, or with the same
+// top block once timeout seconds (at most a minute) have passed
+struct COMMAND_RPC_WAIT_FOR_BLOCK {
+  struct request {
+    std::string prev_hash;
+    uint32_t timeout;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(prev_hash)
+      KV_MEMBER(timeout)
+    }
+  };
+
+  struct response {
+    std::string hash;
+    uint32_t height;
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(hash)
+      KV_MEMBER(height)
+      KV_MEMBER(status)
+    }
+  };
+};
+
 struct COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH {
   struct request {
     std::string hash;
@@ -692,6 +746,75 @@ struct COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT {
   typedef BLOCK_HEADER_RESPONSE response;
 };
 
+// First block a wallet created at timestamp has to scan, found by binary search over the block
+// timestamps. Block timestamps may run ahead of the clock by the future time limit, so the answer
+// errs towards older blocks; a timestamp past the top block answers the top block.
+struct COMMAND_RPC_GET_BLOCK_HEIGHT_BY_TIMESTAMP {
+  struct request {
+    uint64_t timestamp;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(timestamp)
+    }
+  };
+
+  struct response {
+    uint64_t height;
+    uint64_t timestamp;  // of the block at height
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(height)
+      KV_MEMBER(timestamp)
+      KV_MEMBER(status)
+    }
+  };
+};
+
+struct COMMAND_RPC_GET_TRANSACTION_BY_KEY_IMAGE {
+  struct request {
+    std::string key_image;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(key_image)
+    }
+  };
+
+  struct response {
+    std::string tx_hash;  // of the transaction that spent key_image
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(tx_hash)
+      KV_MEMBER(status)
+    }
+  };
+};
+
+struct COMMAND_RPC_GET_TRANSACTION_BY_OUTPUT {
+  struct request {
+    uint64_t amount;
+    uint32_t global_index;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(amount)
+      KV_MEMBER(global_index)
+    }
+  };
+
+  struct response {
+    std::string tx_hash;    // of the transaction that created the output
+    uint32_t output_index;  // within that transaction
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(tx_hash)
+      KV_MEMBER(output_index)
+      KV_MEMBER(status)
+    }
+  };
+};
+
 
 
 struct F_COMMAND_RPC_GET_BLOCKS_LIST {
@@ -795,10 +918,14 @@ struct COMMAND_RPC_QUERY_BLOCKS {
   struct request {
     std::vector<Crypto::Hash> block_ids; //*first 10 blocks id goes sequential, next goes in pow(2,n) offset, like 2, 4, 8, 16, 32, 64 and so on, and the last one is always genesis block */
     uint64_t timestamp;
+    uint32_t max_block_count;    // 0 or absent (older clients) selects BLOCKS_SYNCHRONIZING_DEFAULT_COUNT
+    uint64_t max_response_size;  // 0 or absent means no byte budget
 
     void serialize(ISerializer &s) {
       serializeAsBinary(block_ids, "block_ids", s);
       KV_MEMBER(timestamp)
+      KV_MEMBER(max_block_count)
+      KV_MEMBER(max_response_size)
     }
   };
 
@@ -807,6 +934,7 @@ struct COMMAND_RPC_QUERY_BLOCKS {
     uint64_t start_height;
     uint64_t current_height;
     uint64_t full_offset;
+    uint64_t max_response_size;  // budget the node applied, 0 from nodes that do not negotiate
     std::vector<BlockFullInfo> items;
 
     void serialize(ISerializer &s) {
@@ -814,6 +942,7 @@ struct COMMAND_RPC_QUERY_BLOCKS {
       KV_MEMBER(start_height)
       KV_MEMBER(current_height)
       KV_MEMBER(full_offset)
+      KV_MEMBER(max_response_size)
       KV_MEMBER(items)
     }
   };
@@ -823,10 +952,16 @@ struct COMMAND_RPC_QUERY_BLOCKS_LITE {
   struct request {
     std::vector<Crypto::Hash> blockIds;
     uint64_t timestamp;
+    uint32_t maxBlockCount;    // 0 or absent (older clients) selects BLOCKS_SYNCHRONIZING_DEFAULT_COUNT
+    uint64_t maxResponseSize;  // 0 or absent means no byte budget
+    bool includeGlobalIndexes; // attach output global indexes to every full block's transactions
 
     void serialize(ISerializer &s) {
       serializeAsBinary(blockIds, "block_ids", s);
       KV_MEMBER(timestamp)
+      KV_MEMBER(maxBlockCount)
+      KV_MEMBER(maxResponseSize)
+      KV_MEMBER(includeGlobalIndexes)
     }
   };
 
@@ -835,6 +970,7 @@ struct COMMAND_RPC_QUERY_BLOCKS_LITE {
     uint64_t startHeight;
     uint64_t currentHeight;
     uint64_t fullOffset;
+    uint64_t maxResponseSize;  // budget the node applied, 0 from nodes that do not negotiate
     std::vector<BlockShortInfo> items;
 
     void serialize(ISerializer &s) {
@@ -842,11 +978,66 @@ struct COMMAND_RPC_QUERY_BLOCKS_LITE {
       KV_MEMBER(startHeight)
       KV_MEMBER(currentHeight)
       KV_MEMBER(fullOffset)
+      KV_MEMBER(maxResponseSize)
       KV_MEMBER(items)
     }
   };
 };
 
+// opt-in light wallet stream: compact per-transaction records for a range of main chain blocks
+struct COMMAND_RPC_QUERY_COMPACT_OUTPUTS {
+  struct request {
+    uint32_t startHeight;
+    uint32_t blockCount;   // 0 selects BLOCKS_SYNCHRONIZING_DEFAULT_COUNT, capped at COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(startHeight)
+      KV_MEMBER(blockCount)
+    }
+  };
+
+  struct response {
+    std::string status;
+    uint64_t startHeight;
+    uint64_t currentHeight;
+    std::vector<Crypto::Hash> blockHashes;  // one per returned block, lets the client detect a reorg
+    std::vector<CompactTransactionInfo> transactions;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(status)
+      KV_MEMBER(startHeight)
+      KV_MEMBER(currentHeight)
+      serializeAsBinary(blockHashes, "blockHashes", s);
+      KV_MEMBER(transactions)
+    }
+  };
+};
+
+// header-first sync: main chain block headers for a range of heights, without transactions
+struct COMMAND_RPC_GET_BLOCK_HEADERS {
+  struct request {
+    uint32_t startHeight;
+    uint32_t blockCount;   // 0 selects BLOCKS_SYNCHRONIZING_DEFAULT_COUNT, capped at COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(startHeight)
+      KV_MEMBER(blockCount)
+    }
+  };
+
+  struct response {
+    std::string status;
+    uint64_t currentHeight;
+    std::vector<BlockHeaderInfo> headers;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(status)
+      KV_MEMBER(currentHeight)
+      KV_MEMBER(headers)
+    }
+  };
+};
+
 struct COMMAND_RPC_GEN_PAYMENT_ID {
   typedef EMPTY_STRUCT request;
   
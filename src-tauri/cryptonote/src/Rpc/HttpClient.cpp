@@ -17,10 +17,9 @@
 
 #include "HttpClient.h"
 
-#include <HTTP/HttpParser.h>
 #include <System/Ipv4Resolver.h>
 #include <System/Ipv4Address.h>
-#include <System/TcpConnector.h>
+#include <System/TcpConnectFirst.h>
 
 namespace CryptoNote {
 
@@ -41,10 +40,9 @@ void HttpClient::request(const HttpRequest &req, HttpResponse &res) {
 
   try {
     std::iostream stream(m_streamBuf.get());
-    HttpParser parser;
     stream << req;
     stream.flush();
-    parser.receiveResponse(stream, res);
+    m_parser->receiveResponse(stream, res);
   } catch (const std::exception &) {
     disconnect();
     throw;
@@ -53,9 +51,10 @@ void HttpClient::request(const HttpRequest &req, HttpResponse &res) {
 
 void HttpClient::connect() {
   try {
-    auto ipAddr = System::Ipv4Resolver(m_dispatcher).resolve(m_address);
-    m_connection = System::TcpConnector(m_dispatcher).connect(ipAddr, m_port);
+    auto addresses = System::Ipv4Resolver(m_dispatcher).resolveAll(m_address);
+    m_connection = System::connectFirst(m_dispatcher, addresses, m_port);
     m_streamBuf.reset(new System::TcpStreambuf(m_connection));
+    m_parser.reset(new HttpParser());
     m_connected = true;
   } catch (const std::exception& e) {
     throw ConnectException(e.what());
@@ -68,6 +67,7 @@ bool HttpClient::isConnected() const {
 
 void HttpClient::disconnect() {
   m_streamBuf.reset();
+  m_parser.reset();
   try {
     m_connection.write(nullptr, 0); //Socket shutdown.
   } catch (std::exception&) {
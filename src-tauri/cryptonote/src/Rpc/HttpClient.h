@@ -20,6 +20,7 @@
 #include <memory>
 
 #include <Common/Base64.h>
+#include <HTTP/HttpParser.h>
 #include <HTTP/HttpRequest.h>
 #include <HTTP/HttpResponse.h>
 #include <System/TcpConnection.h>
@@ -55,6 +56,7 @@ private:
   System::Dispatcher& m_dispatcher;
   System::TcpConnection m_connection;
   std::unique_ptr<System::TcpStreambuf> m_streamBuf;
+  std::unique_ptr<HttpParser> m_parser;
 };
 
 template <typename Request, typename Response>
@@ -16,11 +16,16 @@
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 
 #include "HttpServer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
 #include <boost/scope_exit.hpp>
 
 #include <Common/Base64.h>
+#include <Common/Gzip.h>
 #include <HTTP/HttpParser.h>
 #include <System/InterruptedException.h>
+#include <System/RemoteContext.h>
 #include <System/TcpStream.h>
 #include <System/Ipv4Address.h>
 
@@ -33,13 +38,63 @@ namespace {
 		response.addHeader("Content-Type", "text/plain");
 		response.setBody("Authorization required");
 	}
+
+	// smaller bodies fit a few packets anyway
+	const size_t GZIP_MIN_BODY_SIZE = 1024;
+	// larger bodies are compressed off the dispatcher
+	const size_t GZIP_OFFLOAD_BODY_SIZE = 64 * 1024;
+
+	std::string lowercase(std::string value) {
+		std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+		return value;
+	}
+
+	bool keepAlive(const CryptoNote::HttpRequest& request) {
+		auto headerIt = request.getHeaders().find("connection");
+		std::string connection = headerIt == request.getHeaders().end() ? "" : lowercase(headerIt->second);
+		if (request.getVersion() == "HTTP/1.0") {
+			return connection == "keep-alive";
+		}
+
+		return connection != "close";
+	}
+
+	bool acceptsGzip(const CryptoNote::HttpRequest& request) {
+		auto headerIt = request.getHeaders().find("accept-encoding");
+		if (headerIt == request.getHeaders().end()) {
+			return false;
+		}
+
+		std::istringstream codings(lowercase(headerIt->second));
+		std::string coding;
+		while (std::getline(codings, coding, ',')) {
+			auto parameters = coding.find(';');
+			std::string name = coding.substr(0, parameters);
+			name.erase(0, name.find_first_not_of(' '));
+			name.erase(name.find_last_not_of(' ') + 1);
+			if (name != "gzip") {
+				continue;
+			}
+
+			auto quality = coding.find("q=", parameters == std::string::npos ? coding.size() : parameters);
+			return quality == std::string::npos || std::atof(coding.c_str() + quality + 2) > 0;
+		}
+
+		return false;
+	}
 }
 
 namespace CryptoNote {
 
 HttpServer::HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log)
-  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer") {
+  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer"),
+    m_maxHeaderSize(HttpParser::DEFAULT_MAX_HEADER_SIZE), m_maxBodySize(DEFAULT_MAX_BODY_SIZE) {
+
+}
 
+void HttpServer::setRequestLimits(size_t maxHeaderSize, size_t maxBodySize) {
+  m_maxHeaderSize = maxHeaderSize;
+  m_maxBodySize = maxBodySize;
 }
 
 void HttpServer::start(const std::string& address, uint16_t port, const std::string& user, const std::string& password) {
@@ -90,7 +145,7 @@ void HttpServer::acceptLoop() {
 
     System::TcpStreambuf streambuf(connection);
     std::iostream stream(&streambuf);
-    HttpParser parser;
+    HttpParser parser(m_maxHeaderSize, m_maxBodySize);
 
     for (;;) {
       HttpRequest req;
@@ -107,10 +162,23 @@ void HttpServer::acceptLoop() {
 					fillUnauthorizedResponse(resp);
 				}
 
+      if (resp.isChunked() && req.getVersion() == "HTTP/1.0") {
+        resp.bufferBody();
+      }
+
+      bool persistent = keepAlive(req);
+      resp.addHeader("Connection", persistent ? "keep-alive" : "close");
+      if (resp.getBody().size() >= GZIP_MIN_BODY_SIZE && acceptsGzip(req)) {
+        compressBody(resp);
+      }
+
       stream << resp;
-      stream.flush();
+      // pipelined requests already buffered are answered before the responses are flushed together
+      if (!persistent || (!parser.hasBufferedData() && streambuf.in_avail() == 0)) {
+        stream.flush();
+      }
 
-      if (stream.peek() == std::iostream::traits_type::eof()) {
+      if (!persistent || (!parser.hasBufferedData() && stream.peek() == std::iostream::traits_type::eof())) {
         break;
       }
     }
@@ -123,6 +191,22 @@ void HttpServer::acceptLoop() {
   }
 }
 
+void HttpServer::compressBody(HttpResponse& response) {
+  std::string compressed;
+  if (response.getBody().size() >= GZIP_OFFLOAD_BODY_SIZE) {
+    System::RemoteContext<void>(m_dispatcher, [&] { compressed = Common::gzipCompress(response.getBody()); }).get();
+  } else {
+    compressed = Common::gzipCompress(response.getBody());
+  }
+
+  // already compressed binary data may grow
+  if (compressed.size() < response.getBody().size()) {
+    response.setBody(compressed);
+    response.addHeader("Content-Encoding", "gzip");
+    response.addHeader("Vary", "Accept-Encoding");
+  }
+}
+
 bool HttpServer::authenticate(const HttpRequest& request) const {
 	if (!m_credentials.empty()) {
 		auto headerIt = request.getHeaders().find("authorization");
@@ -36,8 +36,14 @@ class HttpServer {
 
 public:
 
+  // larger requests are refused before their body is read
+  static const size_t DEFAULT_MAX_BODY_SIZE = 64 * 1024 * 1024;
+
   HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log);
 
+  // applies to connections accepted afterwards
+  void setRequestLimits(size_t maxHeaderSize, size_t maxBodySize);
+
   void start(const std::string& address, uint16_t port, const std::string& user = "", const std::string& password = "");
   void stop();
 
@@ -53,12 +59,15 @@ private:
   void acceptLoop();
   void connectionHandler(System::TcpConnection&& conn);
   bool authenticate(const HttpRequest& request) const;
+  void compressBody(HttpResponse& response);
 
   System::ContextGroup workingContextGroup;
   Logging::LoggerRef logger;
   System::TcpListener m_listener;
   std::unordered_set<System::TcpConnection*> m_connections;
   std::string m_credentials;
+  size_t m_maxHeaderSize;
+  size_t m_maxBodySize;
 };
 
 }
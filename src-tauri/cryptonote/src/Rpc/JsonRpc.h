@@ -20,6 +20,7 @@
 #include <boost/optional.hpp>
 #include <boost/foreach.hpp>
 #include <functional>
+#include <memory>
 
 #include "CoreRpcServerCommandsDefinitions.h"
 #include <Common/JsonValue.h>
@@ -88,6 +89,10 @@ public:
     return true;
   }
 
+  bool hasParams() const {
+    return psReq.contains("params");
+  }
+
   template <typename T>
   bool loadParams(T& v) const {
     loadFromJsonValue(v, psReq.contains("params") ? 
@@ -134,7 +139,7 @@ public:
 
   void parse(const std::string& responseBody) {
     try {
-      psResp = Common::JsonValue::fromString(responseBody);
+      parsedResp.reset(new JsonInputBufferSerializer(std::string(responseBody)));
     } catch (std::exception&) {
       throw JsonRpcError(errParseError);
     }
@@ -151,37 +156,66 @@ public:
   }
 
   bool getError(JsonRpcError& err) const {
-    if (!psResp.contains("error")) {
-      return false;
+    return getMember(err, "error");
+  }
+
+  // the result is written straight to text and spliced into the envelope, so large responses
+  // never go through a Common::JsonValue tree
+  std::string getBody() {
+    psResp.set("jsonrpc", std::string("2.0"));
+    std::string body = psResp.toString();
+    if (!result.empty()) {
+      body.pop_back();
+      body.reserve(body.size() + result.size() + 12);
+      body += ",\"result\":";
+      body += result;
+      body += '}';
     }
 
-    loadFromJsonValue(err, psResp("error"));
-    return true;
+    return body;
   }
 
-  std::string getBody() {
+  // the body up to where the result goes, for a result that is streamed after it; the envelope
+  // is closed with a '}' after the result
+  std::string getBodyBeforeResult() {
     psResp.set("jsonrpc", std::string("2.0"));
-    return psResp.toString();
+    std::string body = psResp.toString();
+    body.pop_back();
+    body += ",\"result\":";
+    return body;
   }
 
   template <typename T>
   bool setResult(const T& v) {
-    psResp.set("result", storeToJsonValue(v));
+    result = storeToJson(v);
     return true;
   }
 
+  // json must already be the serialized result object
+  void setRawResult(std::string json) {
+    result = std::move(json);
+  }
+
   template <typename T>
   bool getResult(T& v) const {
-    if (!psResp.contains("result")) {
+    return getMember(v, "result");
+  }
+
+private:
+  template <typename T>
+  bool getMember(T& v, Common::StringView name) const {
+    if (!parsedResp || !parsedResp->beginObject(name)) {
       return false;
     }
 
-    loadFromJsonValue(v, psResp("result"));
+    serialize(v, *parsedResp);
+    parsedResp->endObject();
     return true;
   }
 
-private:
   Common::JsonValue psResp;
+  std::string result;
+  std::unique_ptr<JsonInputBufferSerializer> parsedResp;
 };
 
 
@@ -23,7 +23,9 @@
 // CryptoNote
 #include "BlockchainExplorerData.h"
 #include "Common/StringTools.h"
+#include "Common/AllocationTracker.h"
 #include "Common/Base58.h"
+#include "Common/Metrics.h"
 #include "CryptoNoteCore/TransactionUtils.h"
 #include "CryptoNoteCore/CryptoNoteTools.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
@@ -35,6 +37,11 @@
 
 #include "P2p/NetNode.h"
 
+#include <System/ContextGroup.h>
+#include <System/ContextGroupTimeout.h>
+#include <System/InterruptedException.h>
+#include <System/RemoteContext.h>
+
 #include "CoreRpcServerErrorCodes.h"
 #include "JsonRpc.h"
 #include "version.h"
@@ -51,6 +58,8 @@ namespace CryptoNote {
 
 namespace {
 
+const uint32_t WAIT_FOR_BLOCK_MAX_TIMEOUT = 60; // seconds
+
 template <typename Command>
 RpcServer::HandlerFunction binMethod(bool (RpcServer::*handler)(typename Command::request const&, typename Command::response&)) {
   return [handler](RpcServer* obj, const HttpRequest& request, HttpResponse& response) {
@@ -62,7 +71,16 @@ RpcServer::HandlerFunction binMethod(bool (RpcServer::*handler)(typename Command
       return false;
     }
 
-    bool result = (obj->*handler)(req, res);
+    bool result;
+    try {
+      result = (obj->*handler)(req, res);
+    } catch (const JsonRpc::JsonRpcError& err) {
+      // handlers shared with JSON-RPC report errors this way
+      response.setStatus(HttpResponse::STATUS_500);
+      response.setBody(err.message);
+      return false;
+    }
+
     response.setBody(storeToBinaryKeyValue(res.data()));
     return result;
   };
@@ -85,40 +103,107 @@ RpcServer::HandlerFunction jsonMethod(bool (RpcServer::*handler)(typename Comman
   };
 }
 
+// JSON-RPC method whose handler writes the result text itself
+template <typename Request>
+JsonRpc::JsonMemberMethod makeTextMemberMethod(bool (RpcServer::*handler)(const Request&, std::string&)) {
+  return [handler](void* obj, const JsonRpc::JsonRpcRequest& req, JsonRpc::JsonRpcResponse& res) {
+    Request params;
+    if (!req.loadParams(params)) {
+      throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
+    }
+
+    std::string result;
+    if (!(static_cast<RpcServer*>(obj)->*handler)(params, result)) {
+      return false;
+    }
+
+    res.setRawResult(std::move(result));
+    return true;
+  };
+}
+
+const size_t BLOCK_SUMMARY_CACHE_SIZE = 4096;
+const size_t BLOCK_DETAILS_CACHE_SIZE = 256;
+
 }
 
 std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction>> RpcServer::s_handlers = {
 
   // binary handlers
-  { "/getblocks.bin", { binMethod<COMMAND_RPC_GET_BLOCKS_FAST>(&RpcServer::on_get_blocks), false } },
-  { "/queryblocks.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false } },
-  { "/queryblockslite.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false } },
-  { "/get_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false } },
-  { "/getrandom_outs.bin", { binMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs), false } },
-  { "/get_pool_changes.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::onGetPoolChanges), false } },
-  { "/get_pool_changes_lite.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::onGetPoolChangesLite), false } },
+  { "/getblocks.bin", { binMethod<COMMAND_RPC_GET_BLOCKS_FAST>(&RpcServer::on_get_blocks), false, true } },
+  { "/queryblocks.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false, true } },
+  { "/queryblockslite.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false, true } },
+  { "/querycompactoutputs.bin", { binMethod<COMMAND_RPC_QUERY_COMPACT_OUTPUTS>(&RpcServer::on_query_compact_outputs), false, true } },
+  { "/getblockheaders.bin", { binMethod<COMMAND_RPC_GET_BLOCK_HEADERS>(&RpcServer::on_get_block_headers), false, true } },
+  { "/get_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false, true } },
+  { "/getrandom_outs.bin", { binMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs), false, true } },
+  { "/get_pool_changes.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::onGetPoolChanges), false, true } },
+  { "/get_pool_changes_lite.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::onGetPoolChangesLite), false, true } },
+
+  // binary variants of busy json and json rpc calls, same requests and responses
+  { "/getinfo.bin", { binMethod<COMMAND_RPC_GET_INFO>(&RpcServer::on_get_info), true, false } },
+  { "/gettransactions.bin", { binMethod<COMMAND_RPC_GET_TRANSACTIONS>(&RpcServer::on_get_transactions), false, true } },
+  { "/getlastblockheader.bin", { binMethod<COMMAND_RPC_GET_LAST_BLOCK_HEADER>(&RpcServer::on_get_last_block_header), false, true } },
+  { "/getblockheaderbyheight.bin", { binMethod<COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT>(&RpcServer::on_get_block_header_by_height), false, true } },
+  { "/getblocktemplate.bin", { binMethod<COMMAND_RPC_GETBLOCKTEMPLATE>(&RpcServer::on_getblocktemplate), false, false } },
+  { "/gettransactionspool.bin", { binMethod<F_COMMAND_RPC_GET_POOL>(&RpcServer::f_on_transactions_pool_json), false, true } },
 
   // json handlers
-  { "/getinfo", { jsonMethod<COMMAND_RPC_GET_INFO>(&RpcServer::on_get_info), true } },
-  { "/getheight", { jsonMethod<COMMAND_RPC_GET_HEIGHT>(&RpcServer::on_get_height), true } },
-  { "/gettransactions", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS>(&RpcServer::on_get_transactions), false } },
-  { "/sendrawtransaction", { jsonMethod<COMMAND_RPC_SEND_RAW_TX>(&RpcServer::on_send_raw_tx), false } },
-  { "/feeaddress", { jsonMethod<COMMAND_RPC_GET_FEE_ADDRESS>(&RpcServer::on_get_fee_address), true } },
-  { "/peers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true } },
-  { "/getpeers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true } },
-  { "/paymentid", { jsonMethod<COMMAND_RPC_GEN_PAYMENT_ID>(&RpcServer::on_get_payment_id), true } },
+  { "/getinfo", { jsonMethod<COMMAND_RPC_GET_INFO>(&RpcServer::on_get_info), true, false } },
+  { "/getheight", { jsonMethod<COMMAND_RPC_GET_HEIGHT>(&RpcServer::on_get_height), true, false } },
+  { "/gettransactions", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS>(&RpcServer::on_get_transactions), false, true } },
+  { "/sendrawtransaction", { jsonMethod<COMMAND_RPC_SEND_RAW_TX>(&RpcServer::on_send_raw_tx), false, false } },
+  { "/feeaddress", { jsonMethod<COMMAND_RPC_GET_FEE_ADDRESS>(&RpcServer::on_get_fee_address), true, false } },
+  { "/peers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true, false } },
+  { "/getpeers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true, false } },
+  { "/paymentid", { jsonMethod<COMMAND_RPC_GEN_PAYMENT_ID>(&RpcServer::on_get_payment_id), true, false } },
 
   // disabled in restricted rpc mode
-  { "/start_mining", { jsonMethod<COMMAND_RPC_START_MINING>(&RpcServer::on_start_mining), false } },
-  { "/stop_mining", { jsonMethod<COMMAND_RPC_STOP_MINING>(&RpcServer::on_stop_mining), false } },
-  { "/stop_daemon", { jsonMethod<COMMAND_RPC_STOP_DAEMON>(&RpcServer::on_stop_daemon), true } },
+  { "/start_mining", { jsonMethod<COMMAND_RPC_START_MINING>(&RpcServer::on_start_mining), false, false } },
+  { "/stop_mining", { jsonMethod<COMMAND_RPC_STOP_MINING>(&RpcServer::on_stop_mining), false, false } },
+  { "/stop_daemon", { jsonMethod<COMMAND_RPC_STOP_DAEMON>(&RpcServer::on_stop_daemon), true, false } },
 
   // json rpc
-  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true } }
+  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true, false } },
+
+  // prometheus scrape
+  { "/metrics", { std::bind(&RpcServer::onMetrics, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true, false } }
 };
 
 RpcServer::RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, const ICryptoNoteProtocolQuery& protocolQuery) :
-  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocolQuery(protocolQuery) {
+  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocolQuery(protocolQuery), m_workerThreads(0),
+  m_blockchainUpdatedEvent(dispatcher), m_templateInputsEvent(dispatcher), m_explorerCacheGeneration(0) {
+  m_core.addObserver(this);
+}
+
+RpcServer::~RpcServer() {
+  m_core.removeObserver(this);
+}
+
+// Block summaries are checked against the chain on every use, so only the details, which carry
+// the depth and orphan status, have to go. The generation stops a handler that started before
+// the update from storing what it built.
+void RpcServer::blockchainUpdated() {
+  {
+    std::lock_guard<std::mutex> lock(m_explorerCacheLock);
+    ++m_explorerCacheGeneration;
+    m_blockDetails.clear();
+  }
+
+  // blocks are added on whatever thread received them, the long polls wait on the dispatcher
+  m_dispatcher.remoteSpawn([this] {
+    m_blockchainUpdatedEvent.set();
+    m_blockchainUpdatedEvent.clear();
+    m_templateInputsEvent.set();
+    m_templateInputsEvent.clear();
+  });
+}
+
+void RpcServer::poolUpdated() {
+  m_dispatcher.remoteSpawn([this] {
+    m_templateInputsEvent.set();
+    m_templateInputsEvent.clear();
+  });
 }
 
 void RpcServer::processRequest(const HttpRequest& request, HttpResponse& response) {
@@ -136,7 +221,32 @@ void RpcServer::processRequest(const HttpRequest& request, HttpResponse& respons
     return;
   }
 
-  it->second.handler(this, request, response);
+  Common::MetricTimer timer(Common::Metrics::instance().histogram("fuego_rpc_request_seconds",
+    "Time to handle an RPC request", "method=\"" + it->first + "\""));
+  if (it->second.readOnly) {
+    runReadOnly([&] { it->second.handler(this, request, response); });
+  } else {
+    it->second.handler(this, request, response);
+  }
+}
+
+// Read-only handlers touch nothing but the core, which does its own locking, so they run on the
+// worker pool while the dispatcher keeps serving P2P and other RPC connections.
+void RpcServer::runReadOnly(std::function<void()>&& call) {
+  if (m_workerThreads == 1) {
+    call();
+    return;
+  }
+
+  if (!m_workers) {
+    m_workers.reset(new Common::ThreadPool(m_workerThreads));
+  }
+
+  // submit() blocks when the pool queue is full, so it has to be called off the dispatcher too
+  Common::ThreadPool& workers = *m_workers;
+  System::RemoteContext<void>(m_dispatcher, [&workers, &call] {
+    workers.submit(std::move(call)).get();
+  }).get();
 }
 
 bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse& response) {
@@ -157,21 +267,25 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
     jsonResponse.setId(jsonRequest.getId()); // copy id
 
     static std::unordered_map<std::string, RpcServer::RpcHandler<JsonMemberMethod>> jsonRpcHandlers = {
-        {"getaltblockslist", {makeMemberMethod(&RpcServer::on_alt_blocks_list_json), true}},
-        {"f_blocks_list_json", {makeMemberMethod(&RpcServer::f_on_blocks_list_json), false}},
-        {"f_block_json", {makeMemberMethod(&RpcServer::f_on_block_json), false}},
-        {"f_transaction_json", {makeMemberMethod(&RpcServer::f_on_transaction_json), false}},
-        {"f_on_transactions_pool_json", {makeMemberMethod(&RpcServer::f_on_transactions_pool_json), false}},
-        {"check_tx_proof", {makeMemberMethod(&RpcServer::k_on_check_tx_proof), false}},
-        {"check_reserve_proof", {makeMemberMethod(&RpcServer::k_on_check_reserve_proof), false}},
-        {"getblockcount", {makeMemberMethod(&RpcServer::on_getblockcount), true}},
-        {"on_getblockhash", {makeMemberMethod(&RpcServer::on_getblockhash), false}},
-        {"getblocktemplate", {makeMemberMethod(&RpcServer::on_getblocktemplate), false}},
-        {"getcurrencyid", {makeMemberMethod(&RpcServer::on_get_currency_id), true}},
-        {"submitblock", {makeMemberMethod(&RpcServer::on_submitblock), false}},
-        {"getlastblockheader", {makeMemberMethod(&RpcServer::on_get_last_block_header), false}},
-        {"getblockheaderbyhash", {makeMemberMethod(&RpcServer::on_get_block_header_by_hash), false}},
-        {"getblockheaderbyheight", {makeMemberMethod(&RpcServer::on_get_block_header_by_height), false}}};
+        {"getaltblockslist", {makeMemberMethod(&RpcServer::on_alt_blocks_list_json), true, true}},
+        {"f_blocks_list_json", {makeTextMemberMethod(&RpcServer::f_on_blocks_list_json), false, true}},
+        {"f_block_json", {makeTextMemberMethod(&RpcServer::f_on_block_json), false, true}},
+        {"f_transaction_json", {makeMemberMethod(&RpcServer::f_on_transaction_json), false, true}},
+        {"f_on_transactions_pool_json", {makeMemberMethod(&RpcServer::f_on_transactions_pool_json), false, true}},
+        {"check_tx_proof", {makeMemberMethod(&RpcServer::k_on_check_tx_proof), false, true}},
+        {"check_reserve_proof", {makeMemberMethod(&RpcServer::k_on_check_reserve_proof), false, true}},
+        {"getblockcount", {makeMemberMethod(&RpcServer::on_getblockcount), true, false}},
+        {"on_getblockhash", {makeMemberMethod(&RpcServer::on_getblockhash), false, true}},
+        {"getblocktemplate", {makeMemberMethod(&RpcServer::on_getblocktemplate), false, false}},
+        {"getcurrencyid", {makeMemberMethod(&RpcServer::on_get_currency_id), true, false}},
+        {"submitblock", {makeMemberMethod(&RpcServer::on_submitblock), false, false}},
+        {"getlastblockheader", {makeMemberMethod(&RpcServer::on_get_last_block_header), false, true}},
+        {"waitforblock", {makeMemberMethod(&RpcServer::on_wait_for_block), true, false}},
+        {"getblockheaderbyhash", {makeMemberMethod(&RpcServer::on_get_block_header_by_hash), false, true}},
+        {"getblockheaderbyheight", {makeMemberMethod(&RpcServer::on_get_block_header_by_height), false, true}},
+        {"getblockheightbytimestamp", {makeMemberMethod(&RpcServer::on_get_block_height_by_timestamp), false, true}},
+        {"gettransactionbykeyimage", {makeMemberMethod(&RpcServer::on_get_transaction_by_key_image), false, true}},
+        {"gettransactionbyoutput", {makeMemberMethod(&RpcServer::on_get_transaction_by_output), false, true}}};
 
     auto it = jsonRpcHandlers.find(jsonRequest.getMethod());
     if (it == jsonRpcHandlers.end()) {
@@ -182,7 +296,13 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
       throw JsonRpcError(CORE_RPC_ERROR_CODE_CORE_BUSY, "Core is busy");
     }
 
-    it->second.handler(this, jsonRequest, jsonResponse);
+    Common::MetricTimer timer(Common::Metrics::instance().histogram("fuego_rpc_json_method_seconds",
+      "Time to handle a JSON RPC method", "method=\"" + it->first + "\""));
+    if (it->second.readOnly) {
+      runReadOnly([&] { it->second.handler(this, jsonRequest, jsonResponse); });
+    } else {
+      it->second.handler(this, jsonRequest, jsonResponse);
+    }
 
   } catch (const JsonRpcError& err) {
     jsonResponse.setError(err);
@@ -195,11 +315,78 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
   return true;
 }
 
+// Series kept elsewhere (verification, admission and RPC latency, lock hold times, Levin traffic)
+// are appended after the values read at scrape time.
+bool RpcServer::onMetrics(const HttpRequest& request, HttpResponse& response) {
+  std::string body;
+  appendMetric(body, "fuego_height", "gauge", "Blockchain height", m_core.get_current_blockchain_height());
+  appendMetric(body, "fuego_pool_transactions", "gauge", "Transactions in the pool", m_core.get_pool_transactions_count());
+  appendMetric(body, "fuego_pool_bytes", "gauge", "Size of the transactions in the pool", m_core.get_pool_transactions_size());
+  uint64_t poolMaxBytes = 0;
+  uint64_t poolMinimumFeeRate = 0;
+  m_core.getPoolLimits(poolMaxBytes, poolMinimumFeeRate);
+  appendMetric(body, "fuego_pool_max_bytes", "gauge", "Pool size past which the cheapest transactions are evicted", poolMaxBytes);
+  appendMetric(body, "fuego_pool_min_fee_per_kb", "gauge", "Fee per kB a transaction needs to enter the pool, raised by evictions", poolMinimumFeeRate);
+
+  uint64_t connections = m_p2p.get_connections_count();
+  uint64_t outgoing = m_p2p.get_outgoing_connections_count();
+  appendMetric(body, "fuego_p2p_connections", "gauge", "Open P2P connections", outgoing, "direction=\"out\"");
+  appendMetric(body, "fuego_p2p_connections", "gauge", "Open P2P connections", connections - outgoing, "direction=\"in\"");
+
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  m_core.getBlockCacheStats(hits, misses);
+  appendMetric(body, "fuego_block_cache_hits_total", "counter", "Block reads served from the cache", hits);
+  appendMetric(body, "fuego_block_cache_misses_total", "counter", "Block reads that went to disk", misses);
+  uint64_t cachedBlocks = 0;
+  uint64_t cachedBytes = 0;
+  m_core.getBlockCacheUsage(cachedBlocks, cachedBytes);
+  appendMetric(body, "fuego_block_cache_blocks", "gauge", "Blocks held decoded in the cache", cachedBlocks);
+  appendMetric(body, "fuego_block_cache_bytes", "gauge", "Serialized size of the cached blocks", cachedBytes);
+  uint64_t blockBytes = 0;
+  uint64_t fileBytes = 0;
+  m_core.getBlockStoreUsage(blockBytes, fileBytes);
+  appendMetric(body, "fuego_block_store_bytes", "gauge", "Serialized size of the stored blocks", blockBytes);
+  appendMetric(body, "fuego_block_store_file_bytes", "gauge", "Size of the blocks file, smaller with compressed storage", fileBytes);
+
+  Common::RecursiveSharedMutex::WaitStats waits = m_core.blockchainLockWaitStats();
+  appendMetric(body, "fuego_lock_wait_seconds_total", "counter", "Time spent waiting for the blockchain lock",
+    waits.exclusiveWaitMicroseconds / 1e6, "lock=\"blockchain\",mode=\"exclusive\"");
+  appendMetric(body, "fuego_lock_wait_seconds_total", "counter", "Time spent waiting for the blockchain lock",
+    waits.sharedWaitMicroseconds / 1e6, "lock=\"blockchain\",mode=\"shared\"");
+
+  for (const BlockchainIndexUsage& usage : m_core.getBlockchainIndexUsage()) {
+    std::string label = std::string("index=\"") + blockchainIndexName(usage.index) + "\"";
+    appendMetric(body, "fuego_blockchain_index_ready", "gauge", "Whether the explorer index answers queries, 0 while it is built", usage.ready ? 1 : 0, label);
+    appendMetric(body, "fuego_blockchain_index_entries", "gauge", "Entries held by the explorer index", usage.entries, label);
+    appendMetric(body, "fuego_blockchain_index_memory_bytes", "gauge", "Approximate heap used by the explorer index", usage.memoryBytes, label);
+    appendMetric(body, "fuego_blockchain_index_stored_bytes", "gauge", "Size of the explorer index in the last indices file read or written", usage.storedBytes, label);
+  }
+
+  if (allocationTrackingEnabled()) {
+    for (const MemoryUsage& usage : memoryUsage()) {
+      appendMetric(body, "fuego_memory_live_bytes", "gauge", "Live heap bytes by subsystem", static_cast<double>(usage.liveBytes),
+        std::string("subsystem=\"") + usage.subsystem + "\"");
+    }
+  }
+
+  Metrics::instance().exportText(body);
+
+  response.addHeader("Content-Type", "text/plain; version=0.0.4");
+  response.setBody(body);
+  return true;
+}
+
 bool RpcServer::restrictRPC(const bool is_restricted) {
   m_restricted_rpc = is_restricted;
   return true;
 }
 
+bool RpcServer::setWorkerThreads(size_t count) {
+  m_workerThreads = count;
+  return true;
+}
+
 bool RpcServer::enableCors(const std::string domain) {
   m_cors_domain = domain;
   return true;
@@ -491,7 +678,7 @@ bool RpcServer::on_query_blocks(const COMMAND_RPC_QUERY_BLOCKS::request& req, CO
   uint32_t currentHeight;
   uint32_t fullOffset;
 
-  if (!m_core.queryBlocks(req.block_ids, req.timestamp, startHeight, currentHeight, fullOffset, res.items)) {
+  if (!m_core.queryBlocks(req.block_ids, req.timestamp, req.max_block_count, req.max_response_size, startHeight, currentHeight, fullOffset, res.items)) {
     res.status = "Failed to perform query";
     return false;
   }
@@ -499,6 +686,7 @@ bool RpcServer::on_query_blocks(const COMMAND_RPC_QUERY_BLOCKS::request& req, CO
   res.start_height = startHeight;
   res.current_height = currentHeight;
   res.full_offset = fullOffset;
+  res.max_response_size = req.max_response_size == 0 ? 0 : std::min(req.max_response_size, uint64_t(BLOCKS_SYNCHRONIZING_MAX_RESPONSE_SIZE));
   res.status = CORE_RPC_STATUS_OK;
   return true;
 }
@@ -507,7 +695,7 @@ bool RpcServer::on_query_blocks_lite(const COMMAND_RPC_QUERY_BLOCKS_LITE::reques
   uint32_t startHeight;
   uint32_t currentHeight;
   uint32_t fullOffset;
-  if (!m_core.queryBlocksLite(req.blockIds, req.timestamp, startHeight, currentHeight, fullOffset, res.items)) {
+  if (!m_core.queryBlocksLite(req.blockIds, req.timestamp, req.maxBlockCount, req.maxResponseSize, req.includeGlobalIndexes, startHeight, currentHeight, fullOffset, res.items)) {
     res.status = "Failed to perform query";
     return false;
   }
@@ -515,6 +703,32 @@ bool RpcServer::on_query_blocks_lite(const COMMAND_RPC_QUERY_BLOCKS_LITE::reques
   res.startHeight = startHeight;
   res.currentHeight = currentHeight;
   res.fullOffset = fullOffset;
+  res.maxResponseSize = req.maxResponseSize == 0 ? 0 : std::min(req.maxResponseSize, uint64_t(BLOCKS_SYNCHRONIZING_MAX_RESPONSE_SIZE));
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+bool RpcServer::on_query_compact_outputs(const COMMAND_RPC_QUERY_COMPACT_OUTPUTS::request& req, COMMAND_RPC_QUERY_COMPACT_OUTPUTS::response& res) {
+  uint32_t currentHeight;
+  if (!m_core.queryCompactOutputs(req.startHeight, req.blockCount, currentHeight, res.blockHashes, res.transactions)) {
+    res.status = "Failed to perform query";
+    return false;
+  }
+
+  res.startHeight = req.startHeight;
+  res.currentHeight = currentHeight;
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+bool RpcServer::on_get_block_headers(const COMMAND_RPC_GET_BLOCK_HEADERS::request& req, COMMAND_RPC_GET_BLOCK_HEADERS::response& res) {
+  uint32_t currentHeight;
+  if (!m_core.getBlockHeaders(req.startHeight, req.blockCount, currentHeight, res.headers)) {
+    res.status = "Failed to perform query";
+    return false;
+  }
+
+  res.currentHeight = currentHeight;
   res.status = CORE_RPC_STATUS_OK;
   return true;
 }
@@ -591,7 +805,11 @@ bool RpcServer::on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOU
 bool RpcServer::onGetPoolChanges(const COMMAND_RPC_GET_POOL_CHANGES::request& req, COMMAND_RPC_GET_POOL_CHANGES::response& rsp) {
   rsp.status = CORE_RPC_STATUS_OK;
   std::vector<CryptoNote::Transaction> addedTransactions;
-  rsp.isTailBlockActual = m_core.getPoolChanges(req.tailBlockId, req.knownTxsIds, addedTransactions, rsp.deletedTxsIds);
+  PoolVersion knownPoolVersion = { req.knownPoolId, req.knownPoolVersion };
+  PoolVersion poolVersion;
+  rsp.isTailBlockActual = m_core.getPoolChanges(req.tailBlockId, req.knownTxsIds, knownPoolVersion, addedTransactions, rsp.deletedTxsIds, poolVersion);
+  rsp.poolId = poolVersion.poolId;
+  rsp.poolVersion = poolVersion.version;
   for (auto& tx : addedTransactions) {
     BinaryArray txBlob;
     if (!toBinaryArray(tx, txBlob)) {
@@ -607,7 +825,11 @@ bool RpcServer::onGetPoolChanges(const COMMAND_RPC_GET_POOL_CHANGES::request& re
 
 bool RpcServer::onGetPoolChangesLite(const COMMAND_RPC_GET_POOL_CHANGES_LITE::request& req, COMMAND_RPC_GET_POOL_CHANGES_LITE::response& rsp) {
   rsp.status = CORE_RPC_STATUS_OK;
-  rsp.isTailBlockActual = m_core.getPoolChangesLite(req.tailBlockId, req.knownTxsIds, rsp.addedTxs, rsp.deletedTxsIds);
+  PoolVersion knownPoolVersion = { req.knownPoolId, req.knownPoolVersion };
+  PoolVersion poolVersion;
+  rsp.isTailBlockActual = m_core.getPoolChangesLite(req.tailBlockId, req.knownTxsIds, knownPoolVersion, rsp.addedTxs, rsp.deletedTxsIds, poolVersion);
+  rsp.poolId = poolVersion.poolId;
+  rsp.poolVersion = poolVersion.version;
 
   return true;
 }
@@ -697,6 +919,7 @@ bool RpcServer::on_get_transactions(const COMMAND_RPC_GET_TRANSACTIONS::request&
     if (b.size() != sizeof(Hash))
     {
       res.status = "Failed, size of data mismatch";
+      return true;
     }
     vh.push_back(*reinterpret_cast<const Hash*>(b.data()));
   }
@@ -704,8 +927,14 @@ bool RpcServer::on_get_transactions(const COMMAND_RPC_GET_TRANSACTIONS::request&
   std::list<Transaction> txs;
   m_core.getTransactions(vh, txs, missed_txs);
 
-  for (auto& tx : txs) {
-    res.txs_as_hex.push_back(toHex(toBinaryArray(tx)));
+  // one scratch blob for all transactions, hex written straight into the response
+  res.txs_as_hex.resize(txs.size());
+  BinaryArray blob;
+  auto hex = res.txs_as_hex.begin();
+  for (const auto& tx : txs) {
+    blob.clear();
+    toBinaryArray(tx, blob);
+    toHex(blob, *hex++);
   }
 
   for (const auto& miss_tx : missed_txs) {
@@ -856,7 +1085,7 @@ bool RpcServer::on_get_payment_id(const COMMAND_RPC_GEN_PAYMENT_ID::request& req
 //------------------------------------------------------------------------------------------------------------------------------
 // JSON RPC methods
 //------------------------------------------------------------------------------------------------------------------------------
-bool RpcServer::f_on_blocks_list_json(const F_COMMAND_RPC_GET_BLOCKS_LIST::request& req, F_COMMAND_RPC_GET_BLOCKS_LIST::response& res) {
+bool RpcServer::f_on_blocks_list_json(const F_COMMAND_RPC_GET_BLOCKS_LIST::request& req, std::string& result) {
   if (m_core.get_current_blockchain_height() <= req.height) {
     throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_TOO_BIG_HEIGHT,
       std::string("To big height: ") + std::to_string(req.height) + ", current blockchain height = " + std::to_string(m_core.get_current_blockchain_height()) };
@@ -868,38 +1097,106 @@ bool RpcServer::f_on_blocks_list_json(const F_COMMAND_RPC_GET_BLOCKS_LIST::reque
     last_height = 0;
   }
 
-  for (uint32_t i = req.height; i >= last_height; i--) {
-    Hash block_hash = m_core.getBlockIdByHeight(static_cast<uint32_t>(i));
-    Block blk;
-    if (!m_core.getBlockByHash(block_hash, blk)) {
-      throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR,
-        "Internal error: can't get block by height. Height = " + std::to_string(i) + '.' };
+  // same text storeToJson(F_COMMAND_RPC_GET_BLOCKS_LIST::response) would produce
+  result = "{\"blocks\":[";
+  for (uint32_t i = static_cast<uint32_t>(req.height); i >= last_height; i--) {
+    if (i != req.height) {
+      result += ',';
     }
 
-    size_t tx_cumulative_block_size;
-    m_core.getBlockSize(block_hash, tx_cumulative_block_size);
-    size_t blokBlobSize = getObjectBinarySize(blk);
-    size_t minerTxBlobSize = getObjectBinarySize(blk.baseTransaction);
-
-    f_block_short_response block_short;
-    block_short.cumul_size = blokBlobSize + tx_cumulative_block_size - minerTxBlobSize;
-    block_short.timestamp = blk.timestamp;
-    block_short.height = i;
-    m_core.getBlockDifficulty(static_cast<uint32_t>(block_short.height), block_short.difficulty);
-    block_short.hash = Common::podToHex(block_hash);
-    block_short.tx_count = blk.transactionHashes.size() + 1;
-
-    res.blocks.push_back(block_short);
+    appendBlockSummary(i, m_core.getBlockIdByHeight(i), result);
 
     if (i == 0)
       break;
   }
 
-  res.status = CORE_RPC_STATUS_OK;
+  result += "],\"status\":\"" CORE_RPC_STATUS_OK "\"}";
+  return true;
+}
+
+void RpcServer::appendBlockSummary(uint32_t height, const Hash& block_hash, std::string& out) {
+  {
+    std::lock_guard<std::mutex> lock(m_explorerCacheLock);
+    auto it = m_blockSummaries.find(height);
+    if (it != m_blockSummaries.end() && it->second.hash == block_hash) {
+      out += it->second.json;
+      return;
+    }
+  }
+
+  Block blk;
+  if (!m_core.getBlockByHash(block_hash, blk)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR,
+      "Internal error: can't get block by height. Height = " + std::to_string(height) + '.' };
+  }
+
+  size_t tx_cumulative_block_size;
+  m_core.getBlockSize(block_hash, tx_cumulative_block_size);
+  size_t blokBlobSize = getObjectBinarySize(blk);
+  size_t minerTxBlobSize = getObjectBinarySize(blk.baseTransaction);
+
+  f_block_short_response block_short;
+  block_short.cumul_size = blokBlobSize + tx_cumulative_block_size - minerTxBlobSize;
+  block_short.timestamp = blk.timestamp;
+  block_short.height = height;
+  m_core.getBlockDifficulty(height, block_short.difficulty);
+  block_short.hash = Common::podToHex(block_hash);
+  block_short.tx_count = blk.transactionHashes.size() + 1;
+
+  std::string json = storeToJson(block_short);
+  out += json;
+
+  std::lock_guard<std::mutex> lock(m_explorerCacheLock);
+  if (m_blockSummaries.size() >= BLOCK_SUMMARY_CACHE_SIZE && m_blockSummaries.count(height) == 0) {
+    // explorers mostly ask for the tip, so the lowest heights go first
+    m_blockSummaries.erase(m_blockSummaries.begin());
+  }
+
+  CachedBlockSummary& entry = m_blockSummaries[height];
+  entry.hash = block_hash;
+  entry.json = std::move(json);
+}
+
+bool RpcServer::f_on_block_json(const F_COMMAND_RPC_GET_BLOCK_DETAILS::request& req, std::string& result) {
+  Hash hash;
+  if (!parse_hash256(req.hash, hash)) {
+    throw JsonRpc::JsonRpcError{
+      CORE_RPC_ERROR_CODE_WRONG_PARAM,
+      "Failed to parse hex representation of block hash. Hex = " + req.hash + '.' };
+  }
+
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(m_explorerCacheLock);
+    auto it = m_blockDetails.find(hash);
+    if (it != m_blockDetails.end()) {
+      result = it->second;
+      return true;
+    }
+
+    generation = m_explorerCacheGeneration;
+  }
+
+  F_COMMAND_RPC_GET_BLOCK_DETAILS::response res;
+  if (!f_block_details(req, res)) {
+    return false;
+  }
+
+  result = storeToJson(res);
+
+  std::lock_guard<std::mutex> lock(m_explorerCacheLock);
+  if (generation == m_explorerCacheGeneration) {
+    if (m_blockDetails.size() >= BLOCK_DETAILS_CACHE_SIZE) {
+      m_blockDetails.clear();
+    }
+
+    m_blockDetails.emplace(hash, result);
+  }
+
   return true;
 }
 
-bool RpcServer::f_on_block_json(const F_COMMAND_RPC_GET_BLOCK_DETAILS::request& req, F_COMMAND_RPC_GET_BLOCK_DETAILS::response& res) {
+bool RpcServer::f_block_details(const F_COMMAND_RPC_GET_BLOCK_DETAILS::request& req, F_COMMAND_RPC_GET_BLOCK_DETAILS::response& res) {
   Hash hash;
 
   if (!parse_hash256(req.hash, hash)) {
@@ -1203,6 +1500,17 @@ namespace {
   }
 }
 
+// Identifies what a template was built from rather than the template itself: the timestamp and
+// the coinbase keys differ on every call, but a miner only gains from a new template once the
+// tip or the pool moved.
+std::string RpcServer::blockTemplateId(const COMMAND_RPC_GETBLOCKTEMPLATE::request& req, const Hash& tailHash, uint64_t poolVersion) const {
+  BinaryArray data(reinterpret_cast<const uint8_t*>(&tailHash), reinterpret_cast<const uint8_t*>(&tailHash) + sizeof(tailHash));
+  data.insert(data.end(), reinterpret_cast<const uint8_t*>(&poolVersion), reinterpret_cast<const uint8_t*>(&poolVersion) + sizeof(poolVersion));
+  data.insert(data.end(), reinterpret_cast<const uint8_t*>(&req.reserve_size), reinterpret_cast<const uint8_t*>(&req.reserve_size) + sizeof(req.reserve_size));
+  data.insert(data.end(), req.wallet_address.begin(), req.wallet_address.end());
+  return podToHex(cn_fast_hash(data.data(), data.size()));
+}
+
 bool RpcServer::on_getblocktemplate(const COMMAND_RPC_GETBLOCKTEMPLATE::request& req, COMMAND_RPC_GETBLOCKTEMPLATE::response& res) {
   if (req.reserve_size > TX_EXTRA_NONCE_MAX_COUNT) {
     throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_TOO_BIG_RESERVE_SIZE, "To big reserved size, maximum 255" };
@@ -1214,6 +1522,45 @@ bool RpcServer::on_getblocktemplate(const COMMAND_RPC_GETBLOCKTEMPLATE::request&
     throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_WALLET_ADDRESS, "Failed to parse wallet address" };
   }
 
+  uint32_t height;
+  Hash tailHash;
+  m_core.get_blockchain_top(height, tailHash);
+  res.template_id = blockTemplateId(req, tailHash, m_core.get_pool_version());
+
+  // Like waitforblock this waits on the dispatcher. Transactions leaving the pool without a new
+  // block don't make a template worth more, so only a new tip or a growing pool ends the wait.
+  if (res.template_id == req.template_id && req.timeout != 0) {
+    Hash knownHash = tailHash;
+    uint64_t knownPoolSize = m_core.get_pool_transactions_size();
+    System::ContextGroup waiting(m_dispatcher);
+    waiting.spawn([&] {
+      try {
+        for (;;) {
+          m_templateInputsEvent.wait();
+          m_core.get_blockchain_top(height, tailHash);
+          if (tailHash != knownHash || m_core.get_pool_transactions_size() > knownPoolSize) {
+            break;
+          }
+        }
+      } catch (System::InterruptedException&) {
+      }
+    });
+
+    System::ContextGroupTimeout timeout(m_dispatcher, waiting, std::chrono::seconds(std::min(req.timeout, WAIT_FOR_BLOCK_MAX_TIMEOUT)));
+    waiting.wait();
+
+    m_core.get_blockchain_top(height, tailHash);
+    res.template_id = blockTemplateId(req, tailHash, m_core.get_pool_version());
+  }
+
+  if (res.template_id == req.template_id) {
+    res.difficulty = 0;
+    res.height = height + 1;
+    res.reserved_offset = 0;
+    res.status = CORE_RPC_STATUS_NOT_MODIFIED;
+    return true;
+  }
+
   Block b = boost::value_initialized<Block>();
   CryptoNote::BinaryArray blob_reserve;
   blob_reserve.resize(req.reserve_size, 0);
@@ -1355,6 +1702,41 @@ bool RpcServer::on_get_last_block_header(const COMMAND_RPC_GET_LAST_BLOCK_HEADER
   return true;
 }
 
+// Waits in the connection's context on the dispatcher rather than on a worker, so a long poll
+// holds no thread while it is pending.
+bool RpcServer::on_wait_for_block(const COMMAND_RPC_WAIT_FOR_BLOCK::request& req, COMMAND_RPC_WAIT_FOR_BLOCK::response& res) {
+  Hash knownHash;
+  if (!parse_hash256(req.prev_hash, knownHash)) {
+    throw JsonRpc::JsonRpcError{
+      CORE_RPC_ERROR_CODE_WRONG_PARAM,
+      "Failed to parse hex representation of block hash. Hex = " + req.prev_hash + '.' };
+  }
+
+  uint32_t height;
+  Hash tailHash;
+  m_core.get_blockchain_top(height, tailHash);
+  if (tailHash == knownHash && req.timeout != 0) {
+    System::ContextGroup waiting(m_dispatcher);
+    waiting.spawn([&] {
+      try {
+        while (tailHash == knownHash) {
+          m_blockchainUpdatedEvent.wait();
+          m_core.get_blockchain_top(height, tailHash);
+        }
+      } catch (System::InterruptedException&) {
+      }
+    });
+
+    System::ContextGroupTimeout timeout(m_dispatcher, waiting, std::chrono::seconds(std::min(req.timeout, WAIT_FOR_BLOCK_MAX_TIMEOUT)));
+    waiting.wait();
+  }
+
+  res.hash = podToHex(tailHash);
+  res.height = height;
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 bool RpcServer::on_get_block_header_by_hash(const COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH::request& req, COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH::response& res) {
   Hash block_hash;
 
@@ -1406,5 +1788,51 @@ bool RpcServer::on_get_block_header_by_height(const COMMAND_RPC_GET_BLOCK_HEADER
   return true;
 }
 
+bool RpcServer::on_get_block_height_by_timestamp(const COMMAND_RPC_GET_BLOCK_HEIGHT_BY_TIMESTAMP::request& req, COMMAND_RPC_GET_BLOCK_HEIGHT_BY_TIMESTAMP::response& res) {
+  uint32_t height;
+  uint64_t timestamp;
+  if (!m_core.getBlockHeightByTimestamp(req.timestamp, height, timestamp)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR,
+      "Internal error: can't find block for timestamp " + std::to_string(req.timestamp) + '.' };
+  }
+
+  res.height = height;
+  res.timestamp = timestamp;
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+bool RpcServer::on_get_transaction_by_key_image(const COMMAND_RPC_GET_TRANSACTION_BY_KEY_IMAGE::request& req, COMMAND_RPC_GET_TRANSACTION_BY_KEY_IMAGE::response& res) {
+  KeyImage keyImage;
+  if (!Common::podFromHex(req.key_image, keyImage)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_PARAM,
+      "Failed to parse hex representation of key image. Hex = " + req.key_image + '.' };
+  }
+
+  Hash transactionHash;
+  if (!m_core.getTransactionIdByKeyImage(keyImage, transactionHash)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_PARAM,
+      "Key image " + req.key_image + " is not spent in the blockchain or blockchain indexes are disabled." };
+  }
+
+  res.tx_hash = Common::podToHex(transactionHash);
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+bool RpcServer::on_get_transaction_by_output(const COMMAND_RPC_GET_TRANSACTION_BY_OUTPUT::request& req, COMMAND_RPC_GET_TRANSACTION_BY_OUTPUT::response& res) {
+  Hash transactionHash;
+  uint16_t outputIndex;
+  if (!m_core.getTransactionIdByGlobalOutput(req.amount, req.global_index, transactionHash, outputIndex)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_PARAM,
+      "No output " + std::to_string(req.global_index) + " of amount " + std::to_string(req.amount) + '.' };
+  }
+
+  res.tx_hash = Common::podToHex(transactionHash);
+  res.output_index = outputIndex;
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 
 }
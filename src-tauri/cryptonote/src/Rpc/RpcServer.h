@@ -18,8 +18,15 @@
 #include "HttpServer.h"
 
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
+#include "Common/ThreadPool.h"
+#include "CryptoNoteCore/ICoreObserver.h"
+#include <System/Event.h>
+
 #include <Logging/LoggerRef.h>
 #include "Common/Math.h"
 #include "CoreRpcServerCommandsDefinitions.h"
@@ -30,9 +37,10 @@ class core;
 class NodeServer;
 class ICryptoNoteProtocolQuery;
 
-class RpcServer : public HttpServer {
+class RpcServer : public HttpServer, private ICoreObserver {
 public:
   RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, const ICryptoNoteProtocolQuery& protocolQuery);
+  ~RpcServer();
   typedef std::function<bool(RpcServer*, const HttpRequest& request, HttpResponse& response)> HandlerFunction;
   bool setFeeAddress(const std::string& fee_address, const AccountPublicAddress& fee_acc);
   bool setViewKey(const std::string& view_key);
@@ -40,6 +48,8 @@ public:
   bool k_on_check_tx_proof(const K_COMMAND_RPC_CHECK_TX_PROOF::request& req, K_COMMAND_RPC_CHECK_TX_PROOF::response& res);
   bool k_on_check_reserve_proof(const K_COMMAND_RPC_CHECK_RESERVE_PROOF::request& req, K_COMMAND_RPC_CHECK_RESERVE_PROOF::response& res);  
   bool enableCors(const std::string domain);  
+  // 0 sizes the pool for read-only handlers to the hardware threads, 1 runs them on the dispatcher
+  bool setWorkerThreads(size_t count);
   bool remotenode_check_incoming_tx(const BinaryArray& tx_blob);
 
 private:
@@ -48,6 +58,7 @@ private:
   struct RpcHandler {
     const Handler handler;
     const bool allowBusyCore;
+    const bool readOnly;
   };
 
   typedef void (RpcServer::*HandlerPtr)(const HttpRequest& request, HttpResponse& response);
@@ -55,12 +66,16 @@ private:
 
   virtual void processRequest(const HttpRequest& request, HttpResponse& response) override;
   bool processJsonRpcRequest(const HttpRequest& request, HttpResponse& response);
+  bool onMetrics(const HttpRequest& request, HttpResponse& response);
   bool isCoreReady();
+  void runReadOnly(std::function<void()>&& call);
 
   // binary handlers
   bool on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res);
   bool on_query_blocks(const COMMAND_RPC_QUERY_BLOCKS::request& req, COMMAND_RPC_QUERY_BLOCKS::response& res);
   bool on_query_blocks_lite(const COMMAND_RPC_QUERY_BLOCKS_LITE::request& req, COMMAND_RPC_QUERY_BLOCKS_LITE::response& res);
+  bool on_query_compact_outputs(const COMMAND_RPC_QUERY_COMPACT_OUTPUTS::request& req, COMMAND_RPC_QUERY_COMPACT_OUTPUTS::response& res);
+  bool on_get_block_headers(const COMMAND_RPC_GET_BLOCK_HEADERS::request& req, COMMAND_RPC_GET_BLOCK_HEADERS::response& res);
   bool on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res);
   bool on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res);
   bool onGetPoolChanges(const COMMAND_RPC_GET_POOL_CHANGES::request& req, COMMAND_RPC_GET_POOL_CHANGES::response& rsp);
@@ -86,13 +101,20 @@ private:
   bool on_get_currency_id(const COMMAND_RPC_GET_CURRENCY_ID::request& req, COMMAND_RPC_GET_CURRENCY_ID::response& res);
   bool on_submitblock(const COMMAND_RPC_SUBMITBLOCK::request& req, COMMAND_RPC_SUBMITBLOCK::response& res);
   bool on_get_last_block_header(const COMMAND_RPC_GET_LAST_BLOCK_HEADER::request& req, COMMAND_RPC_GET_LAST_BLOCK_HEADER::response& res);
+  bool on_wait_for_block(const COMMAND_RPC_WAIT_FOR_BLOCK::request& req, COMMAND_RPC_WAIT_FOR_BLOCK::response& res);
   bool on_get_block_header_by_hash(const COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH::request& req, COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH::response& res);
   bool on_get_block_header_by_height(const COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::request& req, COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::response& res);
+  bool on_get_block_height_by_timestamp(const COMMAND_RPC_GET_BLOCK_HEIGHT_BY_TIMESTAMP::request& req, COMMAND_RPC_GET_BLOCK_HEIGHT_BY_TIMESTAMP::response& res);
+  bool on_get_transaction_by_key_image(const COMMAND_RPC_GET_TRANSACTION_BY_KEY_IMAGE::request& req, COMMAND_RPC_GET_TRANSACTION_BY_KEY_IMAGE::response& res);
+  bool on_get_transaction_by_output(const COMMAND_RPC_GET_TRANSACTION_BY_OUTPUT::request& req, COMMAND_RPC_GET_TRANSACTION_BY_OUTPUT::response& res);
 
   void fill_block_header_response(const Block& blk, bool orphan_status, uint64_t height, const Crypto::Hash& hash, block_header_response& responce);
 
-  bool f_on_blocks_list_json(const F_COMMAND_RPC_GET_BLOCKS_LIST::request& req, F_COMMAND_RPC_GET_BLOCKS_LIST::response& res);
-  bool f_on_block_json(const F_COMMAND_RPC_GET_BLOCK_DETAILS::request& req, F_COMMAND_RPC_GET_BLOCK_DETAILS::response& res);
+  // explorer methods answer with prebuilt JSON text from the caches below
+  bool f_on_blocks_list_json(const F_COMMAND_RPC_GET_BLOCKS_LIST::request& req, std::string& result);
+  bool f_on_block_json(const F_COMMAND_RPC_GET_BLOCK_DETAILS::request& req, std::string& result);
+  bool f_block_details(const F_COMMAND_RPC_GET_BLOCK_DETAILS::request& req, F_COMMAND_RPC_GET_BLOCK_DETAILS::response& res);
+  void appendBlockSummary(uint32_t height, const Crypto::Hash& hash, std::string& out);
   bool f_on_transaction_json(const F_COMMAND_RPC_GET_TRANSACTION_DETAILS::request& req, F_COMMAND_RPC_GET_TRANSACTION_DETAILS::response& res);
   bool f_on_transactions_pool_json(const F_COMMAND_RPC_GET_POOL::request& req, F_COMMAND_RPC_GET_POOL::response& res);
   bool f_getMixin(const Transaction& transaction, uint64_t& mixin);
@@ -106,6 +128,31 @@ private:
   std::string m_fee_address;
   Crypto::SecretKey m_view_key = NULL_SECRET_KEY;
   AccountPublicAddress m_fee_acc; 
+  size_t m_workerThreads;
+  std::unique_ptr<Common::ThreadPool> m_workers;
+
+  // ICoreObserver
+  virtual void blockchainUpdated() override;
+  virtual void poolUpdated() override;
+
+  std::string blockTemplateId(const COMMAND_RPC_GETBLOCKTEMPLATE::request& req, const Crypto::Hash& tailHash, uint64_t poolVersion) const;
+
+  // set and cleared on the dispatcher whenever the main chain changes, waking the waitforblock long polls
+  System::Event m_blockchainUpdatedEvent;
+  // pulsed like m_blockchainUpdatedEvent on chain and pool changes, waking the getblocktemplate long polls
+  System::Event m_templateInputsEvent;
+
+  struct CachedBlockSummary {
+    Crypto::Hash hash;
+    std::string json;
+  };
+
+  std::mutex m_explorerCacheLock;
+  // f_block_short_response JSON by height, checked against the block hash at that height on use
+  std::map<uint32_t, CachedBlockSummary> m_blockSummaries;
+  // f_block_json results by block hash; they include the depth, so they only last until the next chain update
+  std::unordered_map<Crypto::Hash, std::string> m_blockDetails;
+  uint64_t m_explorerCacheGeneration;
 };
 
 }
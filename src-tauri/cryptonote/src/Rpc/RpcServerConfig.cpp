@@ -18,6 +18,7 @@
 #include "RpcServerConfig.h"
 #include "Common/CommandLine.h"
 #include "CryptoNoteConfig.h"
+#include "HttpServer.h"
 
 namespace CryptoNote {
 
@@ -28,10 +29,12 @@ namespace CryptoNote {
 
     const command_line::arg_descriptor<std::string> arg_rpc_bind_ip = { "rpc-bind-ip", "", DEFAULT_RPC_IP };
     const command_line::arg_descriptor<uint16_t> arg_rpc_bind_port = { "rpc-bind-port", "", DEFAULT_RPC_PORT };
+    const command_line::arg_descriptor<uint32_t> arg_rpc_threads = { "rpc-threads", "Worker threads for read-only RPC calls, 0 uses all cores, 1 serves them on the network thread", 0 };
+    const command_line::arg_descriptor<uint64_t> arg_rpc_max_body_size = { "rpc-max-body-size", "Largest request body in bytes the RPC server accepts", HttpServer::DEFAULT_MAX_BODY_SIZE };
   }
 
 
-  RpcServerConfig::RpcServerConfig() : bindIp(DEFAULT_RPC_IP), bindPort(DEFAULT_RPC_PORT) {
+  RpcServerConfig::RpcServerConfig() : bindIp(DEFAULT_RPC_IP), bindPort(DEFAULT_RPC_PORT), threads(0), maxBodySize(HttpServer::DEFAULT_MAX_BODY_SIZE) {
   }
 
   std::string RpcServerConfig::getBindAddress() const {
@@ -41,11 +44,15 @@ namespace CryptoNote {
   void RpcServerConfig::initOptions(boost::program_options::options_description& desc) {
     command_line::add_arg(desc, arg_rpc_bind_ip);
     command_line::add_arg(desc, arg_rpc_bind_port);
+    command_line::add_arg(desc, arg_rpc_threads);
+    command_line::add_arg(desc, arg_rpc_max_body_size);
   }
 
   void RpcServerConfig::init(const boost::program_options::variables_map& vm)  {
     bindIp = command_line::get_arg(vm, arg_rpc_bind_ip);
     bindPort = command_line::get_arg(vm, arg_rpc_bind_port);
+    threads = command_line::get_arg(vm, arg_rpc_threads);
+    maxBodySize = command_line::get_arg(vm, arg_rpc_max_body_size);
   }
 
 }
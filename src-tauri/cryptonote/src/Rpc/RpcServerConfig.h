@@ -33,6 +33,8 @@ public:
 
   std::string bindIp;
   uint16_t bindPort;
+  uint32_t threads;
+  uint64_t maxBodySize;
 };
 
 }
@@ -128,6 +128,11 @@ bool BinaryInputStreamSerializer::binary(std::string& value, Common::StringView
   return (*this)(value, name);
 }
 
+bool BinaryInputStreamSerializer::binaryArray(void* value, size_t elementSize, size_t count, Common::StringView name) {
+  checkedRead(static_cast<char*>(value), elementSize * count);
+  return true;
+}
+
 bool BinaryInputStreamSerializer::operator()(double& value, Common::StringView name) {
   assert(false); //the method is not supported for this type of serialization
   throw std::runtime_error("double serialization is not supported in BinaryInputStreamSerializer");
@@ -101,6 +101,17 @@ bool BinaryOutputStreamSerializer::binary(std::string& value, Common::StringView
   return (*this)(value, name);
 }
 
+bool BinaryOutputStreamSerializer::binaryArray(void* value, size_t elementSize, size_t count, Common::StringView name) {
+  checkedWrite(static_cast<const char*>(value), elementSize * count);
+  return true;
+}
+
+bool BinaryOutputStreamSerializer::binaryBlob(const void* value, size_t size, Common::StringView name) {
+  writeVarint(stream, size);
+  checkedWrite(static_cast<const char*>(value), size);
+  return true;
+}
+
 bool BinaryOutputStreamSerializer::operator()(double& value, Common::StringView name) {
   assert(false); //the method is not supported for this type of serialization
   throw std::runtime_error("double serialization is not supported in BinaryOutputStreamSerializer");
@@ -48,6 +48,8 @@ public:
   virtual bool operator()(std::string& value, Common::StringView name) override;
   virtual bool binary(void* value, size_t size, Common::StringView name) override;
   virtual bool binary(std::string& value, Common::StringView name) override;
+  virtual bool binaryArray(void* value, size_t elementSize, size_t count, Common::StringView name) override;
+  virtual bool binaryBlob(const void* value, size_t size, Common::StringView name) override;
 
   template<typename T>
   bool operator()(T& value, Common::StringView name) {
@@ -18,6 +18,7 @@
 #include <CryptoNote.h>
 #include "BinaryInputStreamSerializer.h"
 #include "BinaryOutputStreamSerializer.h"
+#include "Common/BufferedOutputStream.h"
 #include "Common/MemoryInputStream.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
@@ -52,9 +53,11 @@ bool storeToBinaryFile(const T& obj, const std::string& filename) {
       return false;
     }
 
-    Common::StdOutputStream stream(dataFile);
+    Common::StdOutputStream fileStream(dataFile);
+    Common::BufferedOutputStream stream(fileStream);
     BinaryOutputStreamSerializer out(stream);
     CryptoNote::serialize(const_cast<T&>(obj), out);
+    stream.flush();
       
     if (dataFile.fail()) {
       return false;
@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace CryptoNote {
+
+// Non-virtual reader over a contiguous binary blob for the hot decoding paths. It follows the rules of
+// BinaryInputStreamSerializer over a MemoryInputStream: the same varint overflow and canonical form
+// checks, and a std::runtime_error for anything past the end of the blob.
+class BinarySpanReader {
+public:
+  BinarySpanReader(const void* data, size_t size) : m_data(static_cast<const uint8_t*>(data)), m_size(size), m_position(0) {}
+
+  size_t position() const { return m_position; }
+  size_t remaining() const { return m_size - m_position; }
+  bool endOfBlob() const { return m_position == m_size; }
+
+  template <typename T>
+  T varint() {
+    static_assert(std::is_unsigned<T>::value, "varint() reads unsigned types");
+    const int bits = std::numeric_limits<T>::digits;
+
+    T value = 0;
+    for (int shift = 0;; shift += 7) {
+      if (m_position == m_size) {
+        throw std::runtime_error("Failed to read from blob");
+      }
+
+      uint8_t piece = m_data[m_position++];
+      if (shift >= bits - 7 && piece >= 1 << (bits - shift)) {
+        throw std::runtime_error("readVarint, value overflow");
+      }
+
+      value |= static_cast<T>(static_cast<T>(piece & 0x7f) << shift);
+      if ((piece & 0x80) == 0) {
+        if (piece == 0 && shift != 0) {
+          throw std::runtime_error("readVarint, invalid value representation");
+        }
+
+        return value;
+      }
+    }
+  }
+
+  // element count of an array, checked against what is left of the blob before anything is allocated
+  size_t arraySize(size_t minimumElementSize) {
+    uint64_t size = varint<uint64_t>();
+    if (size > remaining() / minimumElementSize) {
+      throw std::runtime_error("array size is too big");
+    }
+
+    return static_cast<size_t>(size);
+  }
+
+  // the bytes are left in place, the returned pointer stays valid as long as the blob does
+  const uint8_t* skip(size_t size) {
+    if (size > remaining()) {
+      throw std::runtime_error("Failed to read from blob");
+    }
+
+    const uint8_t* bytes = m_data + m_position;
+    m_position += size;
+    return bytes;
+  }
+
+  void read(void* value, size_t size) {
+    memcpy(value, skip(size), size);
+  }
+
+  template <typename T>
+  void pod(T& value) {
+    read(&value, sizeof(value));
+  }
+
+private:
+  const uint8_t* m_data;
+  size_t m_size;
+  size_t m_position;
+};
+
+}
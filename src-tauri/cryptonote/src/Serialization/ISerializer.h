@@ -56,6 +56,23 @@ public:
   virtual bool binary(void* value, size_t size, Common::StringView name) = 0;
   virtual bool binary(std::string& value, Common::StringView name) = 0;
 
+  // read/write count fixed-size elements stored back to back, each as its own binary block;
+  // binary serializers override it to move the whole array at once
+  virtual bool binaryArray(void* value, size_t elementSize, size_t count, Common::StringView name) {
+    uint8_t* element = static_cast<uint8_t*>(value);
+    for (size_t i = 0; i < count; ++i, element += elementSize) {
+      binary(element, elementSize, name);
+    }
+
+    return true;
+  }
+
+  // write a block the same way binary(std::string&) does, without copying it into a string first
+  virtual bool binaryBlob(const void* value, size_t size, Common::StringView name) {
+    std::string blob(static_cast<const char*>(value), size);
+    return binary(blob, name);
+  }
+
   template<typename T>
   bool operator()(T& value, Common::StringView name);
 };
@@ -0,0 +1,428 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "JsonInputBufferSerializer.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "Common/StringTools.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+bool isWhitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+}
+
+JsonInputBufferSerializer::JsonInputBufferSerializer(Common::StringView json) : json(json) {
+  parse();
+}
+
+JsonInputBufferSerializer::JsonInputBufferSerializer(std::string&& json) : ownedJson(std::move(json)), json(ownedJson) {
+  parse();
+}
+
+JsonInputBufferSerializer::~JsonInputBufferSerializer() {
+}
+
+ISerializer::SerializerType JsonInputBufferSerializer::type() const {
+  return ISerializer::INPUT;
+}
+
+bool JsonInputBufferSerializer::beginObject(Common::StringView name) {
+  const Token* token = getValue(name, OBJECT);
+  if (token == nullptr) {
+    return false;
+  }
+
+  size_t index = static_cast<size_t>(token - tokens.data());
+  chain.push_back({ index, index + 1 });
+  return true;
+}
+
+void JsonInputBufferSerializer::endObject() {
+  assert(chain.size() > 1);
+  chain.pop_back();
+}
+
+bool JsonInputBufferSerializer::beginArray(size_t& size, Common::StringView name) {
+  const Token* token = getValue(name, ARRAY);
+  if (token == nullptr) {
+    size = 0;
+    return false;
+  }
+
+  size_t index = static_cast<size_t>(token - tokens.data());
+  size = token->count;
+  chain.push_back({ index, index + 1 });
+  return true;
+}
+
+void JsonInputBufferSerializer::endArray() {
+  assert(chain.size() > 1);
+  chain.pop_back();
+}
+
+bool JsonInputBufferSerializer::operator()(uint16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(int16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(uint32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(int32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(int64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(uint64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(uint8_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(double& value, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  if (token->type != REAL && token->type != INTEGER) {
+    throw std::runtime_error("JSON value is not a number");
+  }
+
+  value = std::strtod(std::string(getText(*token)).c_str(), nullptr);
+  return true;
+}
+
+bool JsonInputBufferSerializer::operator()(std::string& value, Common::StringView name) {
+  const Token* token = getValue(name, STRING);
+  if (token == nullptr) {
+    return false;
+  }
+
+  value.assign(json.getData() + token->begin, token->end - token->begin);
+  return true;
+}
+
+bool JsonInputBufferSerializer::operator()(bool& value, Common::StringView name) {
+  const Token* token = getValue(name, BOOL);
+  if (token == nullptr) {
+    return false;
+  }
+
+  value = json[token->begin] == 't';
+  return true;
+}
+
+bool JsonInputBufferSerializer::binary(void* value, size_t size, Common::StringView name) {
+  const Token* token = getValue(name, STRING);
+  if (token == nullptr) {
+    return false;
+  }
+
+  Common::StringView text = getText(*token);
+  if ((text.getSize() & 1) != 0) {
+    throw std::runtime_error("fromHex: invalid string size");
+  }
+
+  if (text.getSize() >> 1 > size) {
+    throw std::runtime_error("fromHex: invalid buffer size");
+  }
+
+  if (!Common::fromHex(text.getData(), text.getSize(), value)) {
+    throw std::runtime_error("fromHex: invalid character");
+  }
+
+  return true;
+}
+
+bool JsonInputBufferSerializer::binary(std::string& value, Common::StringView name) {
+  const Token* token = getValue(name, STRING);
+  if (token == nullptr) {
+    return false;
+  }
+
+  Common::StringView text = getText(*token);
+  if ((text.getSize() & 1) != 0) {
+    throw std::runtime_error("fromHex: invalid string size");
+  }
+
+  value.resize(text.getSize() >> 1);
+  if (!Common::fromHex(text.getData(), text.getSize(), &value[0])) {
+    throw std::runtime_error("fromHex: invalid character");
+  }
+
+  return true;
+}
+
+void JsonInputBufferSerializer::parse() {
+  size_t position = skipWhitespace(0);
+  if (position == json.getSize() || json[position] != '{') {
+    throw std::runtime_error("Serializer doesn't support this type of serialization: Object expected.");
+  }
+
+  // a member takes two tokens and the shortest member "a":0 five characters
+  tokens.reserve(json.getSize() / 4 + 1);
+  parseValue(position);
+  chain.push_back({ 0, 1 });
+}
+
+size_t JsonInputBufferSerializer::parseValue(size_t position) {
+  if (position == json.getSize()) {
+    throw std::runtime_error("Unable to parse: unexpected end of stream");
+  }
+
+  size_t index = tokens.size();
+  char c = json[position];
+  if (c == '"') {
+    return parseString(position);
+  }
+
+  tokens.push_back({ NIL, position, position, 0, 0 });
+  if (c == '{' || c == '[') {
+    bool isObject = c == '{';
+    char closing = isObject ? '}' : ']';
+    size_t count = 0;
+
+    position = skipWhitespace(position + 1);
+    if (position < json.getSize() && json[position] == closing) {
+      ++position;
+    } else {
+      for (;;) {
+        if (isObject) {
+          if (position == json.getSize() || json[position] != '"') {
+            throw std::runtime_error("Unable to parse");
+          }
+
+          position = skipWhitespace(parseString(position));
+          if (position == json.getSize() || json[position] != ':') {
+            throw std::runtime_error("Unable to parse");
+          }
+
+          position = skipWhitespace(position + 1);
+        }
+
+        position = skipWhitespace(parseValue(position));
+        ++count;
+
+        if (position == json.getSize()) {
+          throw std::runtime_error("Unable to parse: unexpected end of stream");
+        }
+
+        if (json[position] == closing) {
+          ++position;
+          break;
+        }
+
+        if (json[position] != ',') {
+          throw std::runtime_error("Unable to parse");
+        }
+
+        position = skipWhitespace(position + 1);
+      }
+    }
+
+    tokens[index].type = isObject ? OBJECT : ARRAY;
+    tokens[index].count = count;
+  } else if (c == 't') {
+    tokens[index].type = BOOL;
+    position = parseLiteral(position, "true");
+  } else if (c == 'f') {
+    tokens[index].type = BOOL;
+    position = parseLiteral(position, "false");
+  } else if (c == 'n') {
+    position = parseLiteral(position, "null");
+  } else if (c == '-' || isDigit(c)) {
+    position = parseNumber(position, tokens[index]);
+  } else {
+    throw std::runtime_error("Unable to parse");
+  }
+
+  tokens[index].end = position;
+  tokens[index].next = tokens.size();
+  return position;
+}
+
+// escape sequences are kept as they are, like Common::JsonValue does
+size_t JsonInputBufferSerializer::parseString(size_t position) {
+  size_t begin = position + 1;
+  for (position = begin; position < json.getSize(); ++position) {
+    char c = json[position];
+    if (c == '"') {
+      tokens.push_back({ STRING, begin, position, tokens.size() + 1, 0 });
+      return position + 1;
+    }
+
+    if (c == '\\') {
+      ++position;
+    }
+  }
+
+  throw std::runtime_error("Unable to parse: unexpected end of stream");
+}
+
+size_t JsonInputBufferSerializer::parseNumber(size_t position, Token& token) {
+  size_t begin = position;
+  if (json[position] == '-') {
+    ++position;
+  }
+
+  size_t digits = position;
+  while (position < json.getSize() && isDigit(json[position])) {
+    ++position;
+  }
+
+  if (position == digits || (json[digits] == '0' && position - digits > 1)) {
+    throw std::runtime_error("Unable to parse");
+  }
+
+  token.type = INTEGER;
+  if (position < json.getSize() && json[position] == '.') {
+    token.type = REAL;
+    digits = ++position;
+    while (position < json.getSize() && isDigit(json[position])) {
+      ++position;
+    }
+
+    if (position == digits) {
+      throw std::runtime_error("Unable to parse");
+    }
+  }
+
+  if (position < json.getSize() && (json[position] == 'e' || json[position] == 'E')) {
+    token.type = REAL;
+    ++position;
+    if (position < json.getSize() && (json[position] == '+' || json[position] == '-')) {
+      ++position;
+    }
+
+    digits = position;
+    while (position < json.getSize() && isDigit(json[position])) {
+      ++position;
+    }
+
+    if (position == digits) {
+      throw std::runtime_error("Unable to parse");
+    }
+  }
+
+  token.begin = begin;
+  return position;
+}
+
+size_t JsonInputBufferSerializer::parseLiteral(size_t position, const char* literal) {
+  for (; *literal != '\0'; ++literal, ++position) {
+    if (position == json.getSize() || json[position] != *literal) {
+      throw std::runtime_error("Unable to parse");
+    }
+  }
+
+  return position;
+}
+
+size_t JsonInputBufferSerializer::skipWhitespace(size_t position) const {
+  while (position < json.getSize() && isWhitespace(json[position])) {
+    ++position;
+  }
+
+  return position;
+}
+
+// Members are usually read in the order they were written, so the search starts after the member
+// found last and wraps around, which makes a lookup a single comparison in the common case.
+const JsonInputBufferSerializer::Token* JsonInputBufferSerializer::getValue(Common::StringView name) {
+  Scope& scope = chain.back();
+  const Token& parent = tokens[scope.token];
+
+  if (parent.type == ARRAY) {
+    if (scope.cursor >= parent.next) {
+      throw std::runtime_error("JSON array index out of range");
+    }
+
+    const Token* element = &tokens[scope.cursor];
+    scope.cursor = element->next;
+    return element;
+  }
+
+  size_t member = scope.cursor;
+  for (size_t pass = 0; pass < 2; ++pass) {
+    size_t end = pass == 0 ? parent.next : scope.cursor;
+    while (member < end) {
+      const Token& value = tokens[member + 1];
+      if (getText(tokens[member]) == name) {
+        scope.cursor = value.next;
+        return &value;
+      }
+
+      member = value.next;
+    }
+
+    member = scope.token + 1;
+  }
+
+  return nullptr;
+}
+
+const JsonInputBufferSerializer::Token* JsonInputBufferSerializer::getValue(Common::StringView name, TokenType type) {
+  const Token* token = getValue(name);
+  if (token != nullptr && token->type != type) {
+    throw std::runtime_error("JSON value has wrong type");
+  }
+
+  return token;
+}
+
+Common::StringView JsonInputBufferSerializer::getText(const Token& token) const {
+  return Common::StringView(json.getData() + token.begin, token.end - token.begin);
+}
+
+int64_t JsonInputBufferSerializer::getInteger(Common::StringView name, bool& found) {
+  const Token* token = getValue(name, INTEGER);
+  found = token != nullptr;
+  if (!found) {
+    return 0;
+  }
+
+  Common::StringView text = getText(*token);
+  bool negative = text[0] == '-';
+  uint64_t value = 0;
+  for (size_t i = negative ? 1 : 0; i < text.getSize(); ++i) {
+    value = value * 10 + static_cast<uint64_t>(text[i] - '0');
+  }
+
+  return static_cast<int64_t>(negative ? 0 - value : value);
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ISerializer.h"
+
+namespace CryptoNote {
+
+// Reads an object straight from JSON text. The text is checked and split into a flat list of
+// tokens once; members are then looked up in place and only the values asked for are converted,
+// so no Common::JsonValue tree is built. Accepts the same documents as JsonInputValueSerializer.
+class JsonInputBufferSerializer : public ISerializer {
+public:
+  // json must stay alive as long as the serializer
+  JsonInputBufferSerializer(Common::StringView json);
+  JsonInputBufferSerializer(std::string&& json);
+  virtual ~JsonInputBufferSerializer();
+
+  JsonInputBufferSerializer(const JsonInputBufferSerializer&) = delete;
+  JsonInputBufferSerializer& operator=(const JsonInputBufferSerializer&) = delete;
+
+  SerializerType type() const override;
+
+  virtual bool beginObject(Common::StringView name) override;
+  virtual void endObject() override;
+
+  virtual bool beginArray(size_t& size, Common::StringView name) override;
+  virtual void endArray() override;
+
+  virtual bool operator()(uint8_t& value, Common::StringView name) override;
+  virtual bool operator()(int16_t& value, Common::StringView name) override;
+  virtual bool operator()(uint16_t& value, Common::StringView name) override;
+  virtual bool operator()(int32_t& value, Common::StringView name) override;
+  virtual bool operator()(uint32_t& value, Common::StringView name) override;
+  virtual bool operator()(int64_t& value, Common::StringView name) override;
+  virtual bool operator()(uint64_t& value, Common::StringView name) override;
+  virtual bool operator()(double& value, Common::StringView name) override;
+  virtual bool operator()(bool& value, Common::StringView name) override;
+  virtual bool operator()(std::string& value, Common::StringView name) override;
+  virtual bool binary(void* value, size_t size, Common::StringView name) override;
+  virtual bool binary(std::string& value, Common::StringView name) override;
+
+  template<typename T>
+  bool operator()(T& value, Common::StringView name) {
+    return ISerializer::operator()(value, name);
+  }
+
+private:
+  enum TokenType : uint8_t {
+    ARRAY,
+    BOOL,
+    INTEGER,
+    NIL,
+    OBJECT,
+    REAL,
+    STRING
+  };
+
+  // a value of any type; begin and end delimit its text, without the quotes for strings.
+  // next is the index of the token after the value and its children, count the number of
+  // elements or members of an array or object
+  struct Token {
+    TokenType type;
+    size_t begin;
+    size_t end;
+    size_t next;
+    size_t count;
+  };
+
+  struct Scope {
+    size_t token;
+    size_t cursor;
+  };
+
+  void parse();
+  size_t parseValue(size_t position);
+  size_t parseString(size_t position);
+  size_t parseNumber(size_t position, Token& token);
+  size_t parseLiteral(size_t position, const char* literal);
+  size_t skipWhitespace(size_t position) const;
+
+  const Token* getValue(Common::StringView name);
+  const Token* getValue(Common::StringView name, TokenType type);
+  Common::StringView getText(const Token& token) const;
+  int64_t getInteger(Common::StringView name, bool& found);
+
+  template <typename T>
+  bool getNumber(Common::StringView name, T& v) {
+    bool found;
+    int64_t value = getInteger(name, found);
+    if (found) {
+      v = static_cast<T>(value);
+    }
+
+    return found;
+  }
+
+  std::string ownedJson;
+  Common::StringView json;
+  std::vector<Token> tokens;
+  std::vector<Scope> chain;
+};
+
+}
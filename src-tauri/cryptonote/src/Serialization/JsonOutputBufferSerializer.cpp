@@ -0,0 +1,183 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "JsonOutputBufferSerializer.h"
+#include <cassert>
+#include <iomanip>
+#include <sstream>
+#include "Common/StringTools.h"
+
+using namespace CryptoNote;
+
+JsonOutputBufferSerializer::JsonOutputBufferSerializer(std::string& buffer) : buffer(buffer) {
+  scopes.reserve(16);
+  scopes.push_back({ false, true });
+  buffer += '{';
+}
+
+JsonOutputBufferSerializer::~JsonOutputBufferSerializer() {
+}
+
+ISerializer::SerializerType JsonOutputBufferSerializer::type() const {
+  return ISerializer::OUTPUT;
+}
+
+bool JsonOutputBufferSerializer::beginObject(Common::StringView name) {
+  writeName(name);
+  buffer += '{';
+  scopes.push_back({ false, true });
+  return true;
+}
+
+void JsonOutputBufferSerializer::endObject() {
+  assert(scopes.size() > 1 && !scopes.back().isArray);
+  scopes.pop_back();
+  buffer += '}';
+}
+
+bool JsonOutputBufferSerializer::beginArray(size_t& size, Common::StringView name) {
+  writeName(name);
+  buffer += '[';
+  scopes.push_back({ true, true });
+  return true;
+}
+
+void JsonOutputBufferSerializer::endArray() {
+  assert(scopes.size() > 1 && scopes.back().isArray);
+  scopes.pop_back();
+  buffer += ']';
+}
+
+// unsigned values are written as their signed counterpart, as JsonOutputStreamSerializer does,
+// so that readers of the DOM path get the same numbers back
+bool JsonOutputBufferSerializer::operator()(uint64_t& value, Common::StringView name) {
+  writeInteger(static_cast<int64_t>(value), name);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(uint16_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(int16_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(uint32_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(int32_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(int64_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(uint8_t& value, Common::StringView name) {
+  writeInteger(value, name);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(double& value, Common::StringView name) {
+  writeName(name);
+
+  // same formatting as Common::JsonValue
+  std::ostringstream stream;
+  stream << std::fixed << std::setprecision(11) << value;
+  std::string text = stream.str();
+  while (text.size() > 1 && text[text.size() - 2] != '.' && text[text.size() - 1] == '0') {
+    text.resize(text.size() - 1);
+  }
+
+  buffer += text;
+  return true;
+}
+
+// strings are kept in their escaped form on both sides, like Common::JsonValue does
+bool JsonOutputBufferSerializer::operator()(std::string& value, Common::StringView name) {
+  writeName(name);
+  buffer += '"';
+  buffer += value;
+  buffer += '"';
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(bool& value, Common::StringView name) {
+  writeName(name);
+  buffer += value ? "true" : "false";
+  return true;
+}
+
+bool JsonOutputBufferSerializer::binary(void* value, size_t size, Common::StringView name) {
+  writeName(name);
+  buffer.reserve(buffer.size() + size * 2 + 2);
+  buffer += '"';
+  Common::toHex(value, size, buffer);
+  buffer += '"';
+  return true;
+}
+
+bool JsonOutputBufferSerializer::binary(std::string& value, Common::StringView name) {
+  return binary(const_cast<char*>(value.data()), value.size(), name);
+}
+
+void JsonOutputBufferSerializer::finish() {
+  assert(scopes.size() == 1);
+  scopes.pop_back();
+  buffer += '}';
+}
+
+void JsonOutputBufferSerializer::writeName(Common::StringView name) {
+  Scope& scope = scopes.back();
+  if (!scope.isEmpty) {
+    buffer += ',';
+  }
+
+  scope.isEmpty = false;
+  if (!scope.isArray) {
+    buffer += '"';
+    buffer.append(name.getData(), name.getSize());
+    buffer += "\":";
+  }
+}
+
+void JsonOutputBufferSerializer::writeInteger(int64_t value, Common::StringView name) {
+  writeName(name);
+
+  char digits[20];
+  size_t count = 0;
+  uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+  do {
+    digits[count++] = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+
+  if (value < 0) {
+    buffer += '-';
+  }
+
+  while (count > 0) {
+    buffer += digits[--count];
+  }
+}
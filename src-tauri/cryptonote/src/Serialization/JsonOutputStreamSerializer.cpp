@@ -41,6 +41,14 @@ void insertOrPush(JsonValue& js, Common::StringView name, const T& value) {
   }
 }
 
+void insertOrPush(JsonValue& js, Common::StringView name, JsonValue&& value) {
+  if (js.isArray()) {
+    js.pushBack(std::move(value));
+  } else {
+    js.insert(std::string(name), std::move(value));
+  }
+}
+
 }
 
 JsonOutputStreamSerializer::JsonOutputStreamSerializer() : root(JsonValue::OBJECT) {
@@ -135,8 +143,11 @@ bool JsonOutputStreamSerializer::operator()(bool& value, Common::StringView name
 }
 
 bool JsonOutputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
-  std::string hex = Common::toHex(value, size);
-  return (*this)(hex, name);
+  // the hex text is built in place and moved into the value, never copied
+  std::string hex(size * 2, '\0');
+  Common::toHex(value, size, &hex[0]);
+  insertOrPush(*chain.back(), name, JsonValue(std::move(hex)));
+  return true;
 }
 
 bool JsonOutputStreamSerializer::binary(std::string& value, Common::StringView name) {
@@ -17,160 +17,203 @@
 
 #include "KVBinaryInputStreamSerializer.h"
 
-#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <stdexcept>
-#include <Common/StreamTools.h>
 #include "KVBinaryCommon.h"
 
-using namespace Common;
 using namespace CryptoNote;
 
 namespace {
 
+size_t fixedSize(uint8_t type) {
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:
+  case BIN_KV_SERIALIZE_TYPE_UINT64:
+  case BIN_KV_SERIALIZE_TYPE_DOUBLE:
+    return 8;
+  case BIN_KV_SERIALIZE_TYPE_INT32:
+  case BIN_KV_SERIALIZE_TYPE_UINT32:
+    return 4;
+  case BIN_KV_SERIALIZE_TYPE_INT16:
+  case BIN_KV_SERIALIZE_TYPE_UINT16:
+    return 2;
+  case BIN_KV_SERIALIZE_TYPE_INT8:
+  case BIN_KV_SERIALIZE_TYPE_UINT8:
+  case BIN_KV_SERIALIZE_TYPE_BOOL:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
 template <typename T>
-T readPod(Common::IInputStream& s) {
+T readPod(const uint8_t* data) {
   T v;
-  read(s, &v, sizeof(T));
+  memcpy(&v, data, sizeof(T));
   return v;
 }
 
-template <typename T, typename JsonT = T>
-JsonValue readPodJson(Common::IInputStream& s) {
-  JsonValue jv;
-  jv = static_cast<JsonT>(readPod<T>(s));
-  return jv;
 }
 
-template <typename T>
-JsonValue readIntegerJson(Common::IInputStream& s) {
-  return readPodJson<T, int64_t>(s);
+KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::IInputStream& strm) {
+  const size_t chunkSize = 64 * 1024;
+  for (;;) {
+    size_t offset = ownedData.size();
+    ownedData.resize(offset + chunkSize);
+    size_t readSize = strm.readSome(&ownedData[offset], chunkSize);
+    ownedData.resize(offset + readSize);
+    if (readSize == 0) {
+      break;
+    }
+  }
+
+  data = reinterpret_cast<const uint8_t*>(ownedData.data());
+  size = ownedData.size();
+  parse();
 }
 
-size_t readVarint(Common::IInputStream& s) {
-  uint8_t b = read<uint8_t>(s);
-  uint8_t size_mask = b & PORTABLE_RAW_SIZE_MARK_MASK;
-  size_t bytesLeft = 0;
+KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(const void* data, size_t size) :
+  data(static_cast<const uint8_t*>(data)), size(size) {
+  parse();
+}
 
-  switch (size_mask){
-  case PORTABLE_RAW_SIZE_MARK_BYTE:
-    bytesLeft = 0;
-    break;
-  case PORTABLE_RAW_SIZE_MARK_WORD:
-    bytesLeft = 1;
-    break;
-  case PORTABLE_RAW_SIZE_MARK_DWORD:
-    bytesLeft = 3;
-    break;
-  case PORTABLE_RAW_SIZE_MARK_INT64:
-    bytesLeft = 7;
-    break;
-  }
+KVBinaryInputStreamSerializer::~KVBinaryInputStreamSerializer() {
+}
 
-  size_t value = b;
+ISerializer::SerializerType KVBinaryInputStreamSerializer::type() const {
+  return ISerializer::INPUT;
+}
 
-  for (size_t i = 1; i <= bytesLeft; ++i) {
-    size_t n = read<uint8_t>(s);
-    value |= n << (i * 8);
+bool KVBinaryInputStreamSerializer::beginObject(Common::StringView name) {
+  const Token* token = getValue(name, BIN_KV_SERIALIZE_TYPE_OBJECT);
+  if (token == nullptr) {
+    return false;
   }
 
-  value >>= 2;
-  return value;
+  size_t index = static_cast<size_t>(token - tokens.data());
+  chain.push_back({ index, index + 1, 0, 0 });
+  return true;
+}
+
+void KVBinaryInputStreamSerializer::endObject() {
+  assert(chain.size() > 1);
+  chain.pop_back();
 }
 
-std::string readString(Common::IInputStream& s) {
-  auto size = readVarint(s);
-  if (size > 10000 * 1024 * 1024) {
-    throw std::runtime_error("string size is too big");
+bool KVBinaryInputStreamSerializer::beginArray(size_t& size, Common::StringView name) {
+  if (tokens[chain.back().token].isArray) {
+    throw std::runtime_error("Nested arrays are not supported");
   }
 
-  std::string str;
-  str.resize(size);
-  if (size) {
-    read(s, &str[0], size);
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    size = 0;
+    return false;
   }
-  return str;
+
+  if (!token->isArray) {
+    throw std::runtime_error("KV value has wrong type");
+  }
+
+  size_t index = static_cast<size_t>(token - tokens.data());
+  size = token->count;
+  chain.push_back({ index, index + 1, token->begin, token->count });
+  return true;
 }
 
-JsonValue readStringJson(Common::IInputStream& s) {
-  return JsonValue(readString(s));
+void KVBinaryInputStreamSerializer::endArray() {
+  assert(chain.size() > 1);
+  chain.pop_back();
 }
 
-void readName(Common::IInputStream& s, std::string& name) {
-  uint8_t len = readPod<uint8_t>(s);
-  if (len) {
-    name.resize(len);
-    read(s, &name[0], len);
-  }
+bool KVBinaryInputStreamSerializer::operator()(uint16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(int16_t& value, Common::StringView name) {
+  return getNumber(name, value);
 }
 
-JsonValue loadValue(Common::IInputStream& stream, uint8_t type);
-JsonValue loadSection(Common::IInputStream& stream);
-JsonValue loadEntry(Common::IInputStream& stream);
-JsonValue loadArray(Common::IInputStream& stream, uint8_t itemType);
+bool KVBinaryInputStreamSerializer::operator()(uint32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
 
+bool KVBinaryInputStreamSerializer::operator()(int32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
 
-JsonValue loadSection(Common::IInputStream& stream) {
-  JsonValue sec(JsonValue::OBJECT);
-  size_t count = readVarint(stream);
-  std::string name;
+bool KVBinaryInputStreamSerializer::operator()(int64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
 
-  while (count--) {
-    readName(stream, name);
-    sec.insert(name, loadEntry(stream));
-  }
+bool KVBinaryInputStreamSerializer::operator()(uint64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
 
-  return sec;
+bool KVBinaryInputStreamSerializer::operator()(uint8_t& value, Common::StringView name) {
+  return getNumber(name, value);
 }
 
-JsonValue loadValue(Common::IInputStream& stream, uint8_t type) {
-  switch (type) {
-  case BIN_KV_SERIALIZE_TYPE_INT64:  return readIntegerJson<int64_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT32:  return readIntegerJson<int32_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT16:  return readIntegerJson<int16_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT8:   return readIntegerJson<int8_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT64: return readIntegerJson<uint64_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT32: return readIntegerJson<uint32_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT16: return readIntegerJson<uint16_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT8:  return readIntegerJson<uint8_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_DOUBLE: return readPodJson<double>(stream);
-  case BIN_KV_SERIALIZE_TYPE_BOOL:   return JsonValue(read<uint8_t>(stream) != 0);
-  case BIN_KV_SERIALIZE_TYPE_STRING: return readStringJson(stream);
-  case BIN_KV_SERIALIZE_TYPE_OBJECT: return loadSection(stream);
-  case BIN_KV_SERIALIZE_TYPE_ARRAY:  return loadArray(stream, type);
-  default:
-    throw std::runtime_error("Unknown data type");
-    break;
+bool KVBinaryInputStreamSerializer::operator()(double& value, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  if (token->type == BIN_KV_SERIALIZE_TYPE_DOUBLE && !token->isArray) {
+    value = readPod<double>(data + token->begin);
+  } else {
+    value = static_cast<double>(readInteger(*token));
   }
+
+  return true;
 }
 
-JsonValue loadEntry(Common::IInputStream& stream) {
-  uint8_t type = readPod<uint8_t>(stream);
+bool KVBinaryInputStreamSerializer::operator()(std::string& value, Common::StringView name) {
+  const Token* token = getValue(name, BIN_KV_SERIALIZE_TYPE_STRING);
+  if (token == nullptr) {
+    return false;
+  }
 
-  if (type & BIN_KV_SERIALIZE_FLAG_ARRAY) {
-    type &= ~BIN_KV_SERIALIZE_FLAG_ARRAY;
-    return loadArray(stream, type);
+  value.assign(reinterpret_cast<const char*>(data) + token->begin, token->end - token->begin);
+  return true;
+}
+
+bool KVBinaryInputStreamSerializer::operator()(bool& value, Common::StringView name) {
+  const Token* token = getValue(name, BIN_KV_SERIALIZE_TYPE_BOOL);
+  if (token == nullptr) {
+    return false;
   }
 
-  return loadValue(stream, type);
+  value = data[token->begin] != 0;
+  return true;
 }
 
-JsonValue loadArray(Common::IInputStream& stream, uint8_t itemType) {
-  JsonValue arr(JsonValue::ARRAY);
-  size_t count = readVarint(stream);
+bool KVBinaryInputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
+  const Token* token = getValue(name, BIN_KV_SERIALIZE_TYPE_STRING);
+  if (token == nullptr) {
+    return false;
+  }
 
-  while (count--) {
-    arr.pushBack(loadValue(stream, itemType));
+  if (token->end - token->begin != size) {
+    throw std::runtime_error("Binary block size mismatch");
   }
 
-  return arr;
+  memcpy(value, data + token->begin, size);
+  return true;
 }
 
+bool KVBinaryInputStreamSerializer::binary(std::string& value, Common::StringView name) {
+  return (*this)(value, name); // load as string
+}
 
-JsonValue parseBinary(Common::IInputStream& stream) {
-  auto hdr = readPod<KVBinaryStorageBlockHeader>(stream);
+void KVBinaryInputStreamSerializer::parse() {
+  if (size < sizeof(KVBinaryStorageBlockHeader)) {
+    throw std::runtime_error("Unexpected end of binary storage");
+  }
 
+  auto hdr = readPod<KVBinaryStorageBlockHeader>(data);
   if (
     hdr.m_signature_a != PORTABLE_STORAGE_SIGNATUREA ||
     hdr.m_signature_b != PORTABLE_STORAGE_SIGNATUREB) {
@@ -181,30 +224,211 @@ JsonValue parseBinary(Common::IInputStream& stream) {
     throw std::runtime_error("Unknown binary storage format version");
   }
 
-  return loadSection(stream);
+  size_t position = sizeof(KVBinaryStorageBlockHeader);
+  tokens.push_back({ BIN_KV_SERIALIZE_TYPE_OBJECT, false, 0, 0, position, position, 0, 0 });
+  tokens[0].end = parseSection(position, 0);
+  chain.push_back({ 0, 1, 0, 0 });
 }
 
+size_t KVBinaryInputStreamSerializer::parseSection(size_t position, size_t index) {
+  size_t count = readVarint(position);
+  for (size_t i = 0; i < count; ++i) {
+    position = checkedAdvance(position, 1);
+    uint8_t nameSize = data[position - 1];
+    size_t name = position;
+    position = checkedAdvance(position, nameSize + 1);
+    uint8_t type = data[position - 1];
+
+    size_t member = tokens.size();
+    bool isArray = (type & BIN_KV_SERIALIZE_FLAG_ARRAY) != 0;
+    type &= ~BIN_KV_SERIALIZE_FLAG_ARRAY;
+    tokens.push_back({ type, isArray, nameSize, name, position, position, 0, 0 });
+    position = isArray ? parseArray(position, member) : parseValue(position, member);
+  }
+
+  tokens[index].count = count;
+  tokens[index].next = tokens.size();
+  return position;
 }
 
-KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::IInputStream& strm) : JsonInputValueSerializer(parseBinary(strm)) {
+size_t KVBinaryInputStreamSerializer::parseValue(size_t position, size_t index) {
+  uint8_t type = tokens[index].type;
+  if (type == BIN_KV_SERIALIZE_TYPE_OBJECT) {
+    position = parseSection(position, index);
+  } else if (type == BIN_KV_SERIALIZE_TYPE_STRING) {
+    size_t stringSize = readVarint(position);
+    tokens[index].begin = position;
+    position = checkedAdvance(position, stringSize);
+  } else if (fixedSize(type) != 0) {
+    position = checkedAdvance(position, fixedSize(type));
+  } else {
+    throw std::runtime_error("Unknown data type");
+  }
+
+  tokens[index].end = position;
+  tokens[index].next = tokens.size();
+  return position;
 }
 
-bool KVBinaryInputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
-  std::string str;
+size_t KVBinaryInputStreamSerializer::parseArray(size_t position, size_t index) {
+  uint8_t type = tokens[index].type;
+  size_t count = readVarint(position);
+  tokens[index].begin = position;
+  tokens[index].count = count;
+
+  if (type == BIN_KV_SERIALIZE_TYPE_OBJECT) {
+    for (size_t i = 0; i < count; ++i) {
+      size_t item = tokens.size();
+      tokens.push_back({ BIN_KV_SERIALIZE_TYPE_OBJECT, false, 0, 0, position, position, 0, 0 });
+      position = parseSection(position, item);
+      tokens[item].end = position;
+    }
+  } else if (fixedSize(type) != 0) {
+    if (count > (size - position) / fixedSize(type)) {
+      throw std::runtime_error("Unexpected end of binary storage");
+    }
+
+    position += count * fixedSize(type);
+  } else if (type == BIN_KV_SERIALIZE_TYPE_STRING) {
+    for (size_t i = 0; i < count; ++i) {
+      position = skipElement(position, type);
+    }
+  } else {
+    throw std::runtime_error("Unknown data type");
+  }
 
-  if (!(*this)(str, name)) {
-    return false;
+  tokens[index].end = position;
+  tokens[index].next = tokens.size();
+  return position;
+}
+
+size_t KVBinaryInputStreamSerializer::skipElement(size_t position, uint8_t type) const {
+  if (type == BIN_KV_SERIALIZE_TYPE_STRING) {
+    size_t stringSize = readVarint(position);
+    return checkedAdvance(position, stringSize);
   }
 
-  if (str.size() != size) {
-    throw std::runtime_error("Binary block size mismatch");
+  return checkedAdvance(position, fixedSize(type));
+}
+
+size_t KVBinaryInputStreamSerializer::readVarint(size_t& position) const {
+  position = checkedAdvance(position, 1);
+  uint8_t b = data[position - 1];
+  size_t bytesLeft = 0;
+
+  switch (b & PORTABLE_RAW_SIZE_MARK_MASK) {
+  case PORTABLE_RAW_SIZE_MARK_BYTE:
+    bytesLeft = 0;
+    break;
+  case PORTABLE_RAW_SIZE_MARK_WORD:
+    bytesLeft = 1;
+    break;
+  case PORTABLE_RAW_SIZE_MARK_DWORD:
+    bytesLeft = 3;
+    break;
+  case PORTABLE_RAW_SIZE_MARK_INT64:
+    bytesLeft = 7;
+    break;
   }
 
-  memcpy(value, str.data(), size);
-  return true;
+  size_t value = b;
+  position = checkedAdvance(position, bytesLeft);
+  for (size_t i = 1; i <= bytesLeft; ++i) {
+    size_t n = data[position - bytesLeft + i - 1];
+    value |= n << (i * 8);
+  }
+
+  return value >> 2;
 }
 
-bool KVBinaryInputStreamSerializer::binary(std::string& value, Common::StringView name) {
-  return (*this)(value, name); // load as string
+size_t KVBinaryInputStreamSerializer::checkedAdvance(size_t position, size_t size) const {
+  if (size > this->size - position) {
+    throw std::runtime_error("Unexpected end of binary storage");
+  }
+
+  return position + size;
+}
+
+// Members are usually read in the order they were written, so the search starts after the member
+// found last and wraps around, which makes a lookup a single comparison in the common case.
+const KVBinaryInputStreamSerializer::Token* KVBinaryInputStreamSerializer::getValue(Common::StringView name) {
+  Scope& scope = chain.back();
+  const Token& parent = tokens[scope.token];
+
+  if (parent.isArray) {
+    if (scope.remaining == 0) {
+      throw std::runtime_error("KV array index out of range");
+    }
+
+    --scope.remaining;
+    if (parent.type == BIN_KV_SERIALIZE_TYPE_OBJECT) {
+      const Token* item = &tokens[scope.cursor];
+      scope.cursor = item->next;
+      return item;
+    }
+
+    size_t position = scope.position;
+    element = { parent.type, false, 0, 0, position, 0, 0, 0 };
+    if (parent.type == BIN_KV_SERIALIZE_TYPE_STRING) {
+      readVarint(position);
+      element.begin = position;
+    }
+
+    element.end = skipElement(scope.position, parent.type);
+    scope.position = element.end;
+    return &element;
+  }
+
+  size_t member = scope.cursor;
+  for (size_t pass = 0; pass < 2; ++pass) {
+    size_t end = pass == 0 ? parent.next : scope.cursor;
+    while (member < end) {
+      const Token& value = tokens[member];
+      if (Common::StringView(reinterpret_cast<const char*>(data) + value.name, value.nameSize) == name) {
+        scope.cursor = value.next;
+        return &value;
+      }
+
+      member = value.next;
+    }
+
+    member = scope.token + 1;
+  }
+
+  return nullptr;
+}
+
+const KVBinaryInputStreamSerializer::Token* KVBinaryInputStreamSerializer::getValue(Common::StringView name, uint8_t type) {
+  const Token* token = getValue(name);
+  if (token != nullptr && (token->type != type || token->isArray)) {
+    throw std::runtime_error("KV value has wrong type");
+  }
+
+  return token;
+}
+
+int64_t KVBinaryInputStreamSerializer::getInteger(Common::StringView name, bool& found) {
+  const Token* token = getValue(name);
+  found = token != nullptr;
+  return found ? readInteger(*token) : 0;
 }
 
+int64_t KVBinaryInputStreamSerializer::readInteger(const Token& token) const {
+  if (token.isArray) {
+    throw std::runtime_error("KV value has wrong type");
+  }
+
+  const uint8_t* value = data + token.begin;
+  switch (token.type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:  return readPod<int64_t>(value);
+  case BIN_KV_SERIALIZE_TYPE_INT32:  return readPod<int32_t>(value);
+  case BIN_KV_SERIALIZE_TYPE_INT16:  return readPod<int16_t>(value);
+  case BIN_KV_SERIALIZE_TYPE_INT8:   return readPod<int8_t>(value);
+  case BIN_KV_SERIALIZE_TYPE_UINT64: return static_cast<int64_t>(readPod<uint64_t>(value));
+  case BIN_KV_SERIALIZE_TYPE_UINT32: return readPod<uint32_t>(value);
+  case BIN_KV_SERIALIZE_TYPE_UINT16: return readPod<uint16_t>(value);
+  case BIN_KV_SERIALIZE_TYPE_UINT8:  return readPod<uint8_t>(value);
+  default:
+    throw std::runtime_error("KV value has wrong type");
+  }
+}
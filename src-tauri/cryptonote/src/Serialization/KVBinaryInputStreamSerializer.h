@@ -17,18 +17,107 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
 #include <Common/IInputStream.h>
 #include "ISerializer.h"
-#include "JsonInputValueSerializer.h"
 
 namespace CryptoNote {
 
-class KVBinaryInputStreamSerializer : public JsonInputValueSerializer {
+// Reads an object from portable storage (KV binary) data. The data is checked and indexed in a
+// single pass into one flat list of tokens; strings and blobs are copied out of the buffer only
+// when they are asked for, and sections nobody asks for are never looked at again.
+class KVBinaryInputStreamSerializer : public ISerializer {
 public:
   KVBinaryInputStreamSerializer(Common::IInputStream& strm);
+  // data must stay alive as long as the serializer
+  KVBinaryInputStreamSerializer(const void* data, size_t size);
+  virtual ~KVBinaryInputStreamSerializer();
 
+  KVBinaryInputStreamSerializer(const KVBinaryInputStreamSerializer&) = delete;
+  KVBinaryInputStreamSerializer& operator=(const KVBinaryInputStreamSerializer&) = delete;
+
+  SerializerType type() const override;
+
+  virtual bool beginObject(Common::StringView name) override;
+  virtual void endObject() override;
+
+  virtual bool beginArray(size_t& size, Common::StringView name) override;
+  virtual void endArray() override;
+
+  virtual bool operator()(uint8_t& value, Common::StringView name) override;
+  virtual bool operator()(int16_t& value, Common::StringView name) override;
+  virtual bool operator()(uint16_t& value, Common::StringView name) override;
+  virtual bool operator()(int32_t& value, Common::StringView name) override;
+  virtual bool operator()(uint32_t& value, Common::StringView name) override;
+  virtual bool operator()(int64_t& value, Common::StringView name) override;
+  virtual bool operator()(uint64_t& value, Common::StringView name) override;
+  virtual bool operator()(double& value, Common::StringView name) override;
+  virtual bool operator()(bool& value, Common::StringView name) override;
+  virtual bool operator()(std::string& value, Common::StringView name) override;
   virtual bool binary(void* value, size_t size, Common::StringView name) override;
   virtual bool binary(std::string& value, Common::StringView name) override;
+
+  template<typename T>
+  bool operator()(T& value, Common::StringView name) {
+    return ISerializer::operator()(value, name);
+  }
+
+private:
+  // a section member, an object element of an array or the root section. type is the portable
+  // storage type of the value or of the array elements; begin and end delimit the value, for an
+  // array its elements and for a string its bytes. next is the index of the token after the value
+  // and its children, count the number of members of a section or elements of an array. Arrays
+  // only get child tokens for object elements, other elements are read in place.
+  struct Token {
+    uint8_t type;
+    bool isArray;
+    uint8_t nameSize;
+    size_t name;
+    size_t begin;
+    size_t end;
+    size_t next;
+    size_t count;
+  };
+
+  // cursor is the next child token, position and remaining walk the elements of a non-object array
+  struct Scope {
+    size_t token;
+    size_t cursor;
+    size_t position;
+    size_t remaining;
+  };
+
+  void parse();
+  size_t parseSection(size_t position, size_t index);
+  size_t parseValue(size_t position, size_t index);
+  size_t parseArray(size_t position, size_t index);
+  size_t skipElement(size_t position, uint8_t type) const;
+  size_t readVarint(size_t& position) const;
+  size_t checkedAdvance(size_t position, size_t size) const;
+
+  const Token* getValue(Common::StringView name);
+  const Token* getValue(Common::StringView name, uint8_t type);
+  int64_t getInteger(Common::StringView name, bool& found);
+  int64_t readInteger(const Token& token) const;
+
+  template <typename T>
+  bool getNumber(Common::StringView name, T& v) {
+    bool found;
+    int64_t value = getInteger(name, found);
+    if (found) {
+      v = static_cast<T>(value);
+    }
+
+    return found;
+  }
+
+  std::string ownedData;
+  const uint8_t* data;
+  size_t size;
+  std::vector<Token> tokens;
+  std::vector<Scope> chain;
+  Token element;
 };
 
 }
@@ -19,6 +19,8 @@
 
 #include "ISerializer.h"
 
+#include <CryptoTypes.h>
+
 #include <array>
 #include <cstring>
 #include <list>
@@ -62,11 +64,7 @@ serializeAsBinary(std::vector<T> &value, Common::StringView name, CryptoNote::IS
   }
 else
 {
-  if (!value.empty())
-  {
-    blob.assign(reinterpret_cast<const char *>(&value[0]), value.size() * sizeof(T));
-  }
-  serializer.binary(blob, name);
+  serializer.binaryBlob(value.data(), value.size() * sizeof(T), name);
 }
 } // namespace CryptoNote
 
@@ -152,12 +150,45 @@ bool serializeEnumClass(E &value, Common::StringView name, CryptoNote::ISerializ
   return true;
 }
 
+// types serialized as one raw binary block, so arrays of them can be moved in a single call
 template <typename T>
-bool serialize(std::vector<T> &value, Common::StringView name, CryptoNote::ISerializer &serializer)
+struct IsBinaryPod : std::false_type
+{
+};
+
+template <> struct IsBinaryPod<Crypto::Hash> : std::true_type {};
+template <> struct IsBinaryPod<Crypto::PublicKey> : std::true_type {};
+template <> struct IsBinaryPod<Crypto::KeyImage> : std::true_type {};
+template <> struct IsBinaryPod<Crypto::Signature> : std::true_type {};
+
+template <typename T>
+bool serializeVector(std::vector<T> &value, Common::StringView name, CryptoNote::ISerializer &serializer, std::false_type)
 {
   return serializeContainer(value, name, serializer);
 }
 
+template <typename T>
+bool serializeVector(std::vector<T> &value, Common::StringView name, CryptoNote::ISerializer &serializer, std::true_type)
+{
+  size_t size = value.size();
+  if (!serializer.beginArray(size, name))
+  {
+    value.clear();
+    return false;
+  }
+
+  value.resize(size);
+  serializer.binaryArray(value.data(), sizeof(T), size, "");
+  serializer.endArray();
+  return true;
+}
+
+template <typename T>
+bool serialize(std::vector<T> &value, Common::StringView name, CryptoNote::ISerializer &serializer)
+{
+  return serializeVector(value, name, serializer, IsBinaryPod<T>());
+}
+
 template <typename T>
 bool serialize(std::list<T> &value, Common::StringView name, CryptoNote::ISerializer &serializer)
 {
@@ -21,7 +21,9 @@
 #include <vector>
 #include <Common/MemoryInputStream.h>
 #include <Common/StringOutputStream.h>
+#include "JsonInputBufferSerializer.h"
 #include "JsonInputStreamSerializer.h"
+#include "JsonOutputBufferSerializer.h"
 #include "JsonOutputStreamSerializer.h"
 #include "KVBinaryInputStreamSerializer.h"
 #include "KVBinaryOutputStreamSerializer.h"
@@ -91,17 +93,29 @@ void loadFromJsonValue(std::list<T>& v, const Common::JsonValue& js) {
 
 template <typename T>
 std::string storeToJson(const T& v) {
-  return storeToJsonValue(v).toString();
+  std::string json;
+  JsonOutputBufferSerializer s(json);
+  serialize(const_cast<T&>(v), s);
+  s.finish();
+  return json;
 }
 
+template <typename T>
+std::string storeToJson(const std::vector<T>& v) { return storeToJsonValue(v).toString(); }
+
+template <typename T>
+std::string storeToJson(const std::list<T>& v) { return storeToJsonValue(v).toString(); }
+
+inline std::string storeToJson(const std::string& v) { return storeToJsonValue(v).toString(); }
+
 template <typename T>
 bool loadFromJson(T& v, const std::string& buf) {
   try {
     if (buf.empty()) {
       return true;
     }
-    auto js = Common::JsonValue::fromString(buf);
-    loadFromJsonValue(v, js);
+    JsonInputBufferSerializer s(buf);
+    serialize(v, s);
   } catch (std::exception&) {
     return false;
   }
@@ -122,8 +136,7 @@ std::string storeToBinaryKeyValue(const T& v) {
 template <typename T>
 bool loadFromBinaryKeyValue(T& v, const std::string& buf) {
   try {
-    Common::MemoryInputStream stream(buf.data(), buf.size());
-    KVBinaryInputStreamSerializer s(stream);
+    KVBinaryInputStreamSerializer s(buf.data(), buf.size());
     serialize(v, s);
     return true;
   } catch (std::exception&) {
@@ -82,6 +82,11 @@ const command_line::arg_descriptor<uint32_t>    arg_log_level = { "set_log", "",
 const command_line::arg_descriptor<bool>        arg_testnet = { "testnet", "Used to deploy test nets. The daemon must be launched with --testnet flag", false };
 const command_line::arg_descriptor< std::vector<std::string> > arg_command = { "command", "" };
 
+// transfer_batch destinations per transaction; payment IDs go in the transaction extra,
+// so lines with different payment IDs never share a transaction
+const size_t BATCH_DESTINATIONS_PER_TX = 16;
+const size_t BATCH_MAX_DESTINATIONS_PER_TX = 64;
+
 bool parseUrlAddress(const std::string& url, std::string& address, uint16_t& port) {
   auto pos = url.find("://");
   size_t addrStart = 0;
@@ -602,6 +607,7 @@ simple_wallet::simple_wallet(System::Dispatcher& dispatcher, const CryptoNote::C
   logManager(log),
   logger(log, "simplewallet"),
   m_refresh_progress_reporter(*this),
+  m_refresh_transactions_found(0),
   m_initResultPromise(nullptr),
   m_walletSynchronized(false) {
   m_consoleHandler.setHandler("create_integrated", boost::bind(&simple_wallet::create_integrated, this, boost::arg<1>()), "create_integrated <payment_id> - Create an integrated address with a payment ID");
@@ -621,10 +627,15 @@ simple_wallet::simple_wallet(System::Dispatcher& dispatcher, const CryptoNote::C
   m_consoleHandler.setHandler("transfer", boost::bind(&simple_wallet::transfer, this, boost::arg<1>()),
     "transfer <addr_1> <amount_1> [<addr_2> <amount_2> ... <addr_N> <amount_N>] [-p payment_id]"
     " - Transfer <amount_1>,... <amount_N> to <address_1>,... <address_N>, respectively. ");
+  m_consoleHandler.setHandler("transfer_batch", boost::bind(&simple_wallet::transfer_batch, this, boost::arg<1>()),
+    "transfer_batch <csv_file> [<destinations_per_tx>] - Send to every <address>,<amount>[,<payment_id>] line of <csv_file>,"
+    " several destinations per transaction");
   m_consoleHandler.setHandler("set_log", boost::bind(&simple_wallet::set_log, this, boost::arg<1>()), "set_log <level> - Change current log level, <level> is a number 0-4");
   m_consoleHandler.setHandler("address", boost::bind(&simple_wallet::print_address, this, boost::arg<1>()), "Show current wallet public address");
   m_consoleHandler.setHandler("save", boost::bind(&simple_wallet::save, this, boost::arg<1>()), "Save wallet synchronized data");
   m_consoleHandler.setHandler("reset", boost::bind(&simple_wallet::reset, this, boost::arg<1>()), "Discard cache data and start synchronizing from the start");
+  m_consoleHandler.setHandler("refresh", boost::bind(&simple_wallet::refresh, this, boost::arg<1>()),
+    "refresh [rescan] - Wait for synchronization to finish and show blocks/s and the transactions and outputs found");
   m_consoleHandler.setHandler("help", boost::bind(&simple_wallet::help, this, boost::arg<1>()), "Show this help");
   m_consoleHandler.setHandler("exit", boost::bind(&simple_wallet::exit, this, boost::arg<1>()), "Close wallet");  
   m_consoleHandler.setHandler("get_reserve_proof", boost::bind(&simple_wallet::get_reserve_proof, this, boost::arg<1>()), "all|<amount> [<message>] - Generate a signature proving that you own at least <amount>, optionally with a challenge string <message>. ");
@@ -929,10 +940,10 @@ std::string simple_wallet::generate_mnemonic(Crypto::SecretKey &private_spend_ke
 //----------------------------------------------------------------------------------------------------
 void simple_wallet::log_incorrect_words(std::vector<std::string> words) {
   Language::Base *language = Language::Singleton<Language::English>::instance();
-  const std::vector<std::string> &dictionary = language->get_word_list();
+  const std::unordered_map<std::string, uint32_t> &dictionary = language->get_word_map();
 
   for (auto i : words) {
-    if (std::find(dictionary.begin(), dictionary.end(), i) == dictionary.end()) {
+    if (dictionary.count(i) == 0) {
       logger(ERROR, BRIGHT_RED) << i << " is not in the english word list!";
     }
   }
@@ -1130,6 +1141,7 @@ bool simple_wallet::reset(const std::vector<std::string> &args) {
     m_walletSynchronized = false;
   }
 
+  m_refresh_progress_reporter.start();
   m_wallet->reset();
   success_msg_writer(true) << "Reset completed successfully.";
 
@@ -1143,6 +1155,60 @@ bool simple_wallet::reset(const std::vector<std::string> &args) {
   return true;
 }
 
+bool simple_wallet::refresh(const std::vector<std::string> &args) {
+  bool rescan = false;
+  if (args.size() == 1 && args[0] == "rescan") {
+    rescan = true;
+  } else if (!args.empty()) {
+    fail_msg_writer() << "invalid arguments. Please use refresh [rescan]";
+    return true;
+  }
+
+  size_t transactionsBefore = rescan ? 0 : m_wallet->getTransactionCount();
+  size_t outputsBefore = rescan ? 0 : m_wallet->getUnspentOutputs().size();
+  uint64_t heightBefore = rescan ? 0 : m_refresh_progress_reporter.height();
+  auto startTime = std::chrono::steady_clock::now();
+
+  if (rescan) {
+    {
+      std::unique_lock<std::mutex> lock(m_walletSynchronizedMutex);
+      m_walletSynchronized = false;
+    }
+
+    m_refresh_transactions_found = 0;
+    m_refresh_progress_reporter.start();
+    m_wallet->reset();
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(m_walletSynchronizedMutex);
+    if (!m_walletSynchronized && !rescan) {
+      success_msg_writer() << "Waiting for the running synchronization to finish";
+    }
+
+    while (!m_walletSynchronized) {
+      m_walletSynchronizedCV.wait(lock);
+    }
+  }
+
+  std::cout << std::endl;
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  uint64_t height = m_refresh_progress_reporter.height();
+  uint64_t blocks = height > heightBefore ? height - heightBefore : 0;
+  size_t transactions = m_wallet->getTransactionCount();
+  size_t outputs = m_wallet->getUnspentOutputs().size();
+
+  success_msg_writer(true) << "Synchronized at height " << height << ": " << blocks << " blocks in " <<
+    static_cast<uint64_t>(seconds) << " s (" << static_cast<uint64_t>(seconds > 0 ? blocks / seconds : 0) << " blocks/s), " <<
+    (transactions > transactionsBefore ? transactions - transactionsBefore : 0) << " new transactions, " <<
+    (outputs > outputsBefore ? outputs - outputsBefore : 0) << " new unspent outputs";
+  success_msg_writer() << "available balance: " << m_currency.formatAmount(m_wallet->actualBalance()) <<
+    ", locked amount: " << m_currency.formatAmount(m_wallet->pendingBalance());
+
+  return true;
+}
+
 bool simple_wallet::start_mining(const std::vector<std::string>& args) {
   COMMAND_RPC_START_MINING::request req;
   req.miner_address = m_wallet->getAddress();
@@ -1330,6 +1396,7 @@ void simple_wallet::connectionStatusUpdated(bool connected) {
 void simple_wallet::externalTransactionCreated(CryptoNote::TransactionId transactionId)  {
   WalletLegacyTransaction txInfo;
   m_wallet->getTransaction(transactionId, txInfo);
+  ++m_refresh_transactions_found;
 
   std::stringstream logPrefix;
   if (txInfo.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
@@ -1918,6 +1985,164 @@ bool simple_wallet::transfer(const std::vector<std::string> &args) {
   return true;
 }
 //----------------------------------------------------------------------------------------------------
+bool simple_wallet::transfer_batch(const std::vector<std::string> &args) {
+  size_t perTransaction = BATCH_DESTINATIONS_PER_TX;
+  if (args.empty() || args.size() > 2 ||
+      (args.size() == 2 && (!Common::fromString(args[1], perTransaction) || perTransaction < 1 || perTransaction > BATCH_MAX_DESTINATIONS_PER_TX))) {
+    fail_msg_writer() << "invalid arguments. Please use transfer_batch <csv_file> [<destinations_per_tx>], " <<
+      "<destinations_per_tx> should be from 1 to " << BATCH_MAX_DESTINATIONS_PER_TX;
+    return true;
+  }
+
+  std::ifstream csv(args[0]);
+  if (!csv) {
+    fail_msg_writer() << "can't open " << args[0];
+    return true;
+  }
+
+  // every line is checked before anything is sent, so a typo can't leave a half paid file
+  struct Batch {
+    std::string paymentId;
+    std::vector<WalletLegacyTransfer> transfers;
+    std::vector<size_t> lines;
+  };
+  std::vector<Batch> batches;
+  std::map<std::string, size_t> batchByPaymentId;
+  uint64_t total = 0;
+  size_t destinations = 0;
+
+  std::string line;
+  for (size_t lineNumber = 1; std::getline(csv, line); ++lineNumber) {
+    boost::algorithm::trim(line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    std::vector<std::string> fields;
+    boost::algorithm::split(fields, line, boost::algorithm::is_any_of(","));
+    for (auto& field : fields) {
+      boost::algorithm::trim(field);
+    }
+
+    if (fields.size() < 2 || fields.size() > 3) {
+      fail_msg_writer() << args[0] << ":" << lineNumber << ": expected <address>,<amount>[,<payment_id>]";
+      return true;
+    }
+
+    AccountPublicAddress address;
+    if (!m_currency.parseAccountAddressString(fields[0], address)) {
+      fail_msg_writer() << args[0] << ":" << lineNumber << ": invalid address \"" << fields[0] << "\"";
+      return true;
+    }
+
+    WalletLegacyTransfer transfer;
+    transfer.address = fields[0];
+    uint64_t amount;
+    if (!m_currency.parseAmount(fields[1], amount) || amount == 0) {
+      fail_msg_writer() << args[0] << ":" << lineNumber << ": invalid amount \"" << fields[1] << "\"";
+      return true;
+    }
+    transfer.amount = static_cast<int64_t>(amount);
+
+    std::string paymentId = fields.size() == 3 ? fields[2] : std::string();
+    std::vector<uint8_t> ignore;
+    if (!paymentId.empty() && !createTxExtraWithPaymentId(paymentId, ignore)) {
+      fail_msg_writer() << args[0] << ":" << lineNumber << ": payment ID has invalid format: \"" << paymentId << "\", expected 64-character string";
+      return true;
+    }
+
+    auto it = batchByPaymentId.find(paymentId);
+    if (it == batchByPaymentId.end() || batches[it->second].transfers.size() == perTransaction) {
+      batchByPaymentId[paymentId] = batches.size();
+      batches.push_back(Batch{paymentId, {}, {}});
+      it = batchByPaymentId.find(paymentId);
+    }
+
+    batches[it->second].transfers.push_back(transfer);
+    batches[it->second].lines.push_back(lineNumber);
+    total += amount;
+    ++destinations;
+  }
+
+  if (batches.empty()) {
+    fail_msg_writer() << args[0] << " has no destinations";
+    return true;
+  }
+
+  /* same fee and mixin as transfer */
+  uint64_t fee = (std::max)(m_currency.minimumFee(), CryptoNote::parameters::MINIMUM_FEE_V2);
+  uint64_t mixin = CryptoNote::parameters::MINIMUM_MIXIN;
+
+  uint64_t needed = total + fee * batches.size();
+  if (needed > m_wallet->actualBalance()) {
+    fail_msg_writer() << "not enough money: " << m_currency.formatAmount(needed) << " needed in " << batches.size() <<
+      " transactions, available balance is " << m_currency.formatAmount(m_wallet->actualBalance());
+    return true;
+  }
+
+  success_msg_writer() << "Sending " << m_currency.formatAmount(total) << " to " << destinations << " destinations in " <<
+    batches.size() << " transactions";
+
+  size_t sentTransactions = 0;
+  size_t sentDestinations = 0;
+  try {
+    CryptoNote::WalletHelper::SendCompleteResultObserver sent;
+    WalletHelper::IWalletRemoveObserverGuard removeGuard(*m_wallet, sent);
+
+    for (auto& batch : batches) {
+      std::string extraString;
+      if (!batch.paymentId.empty()) {
+        std::vector<uint8_t> extra;
+        createTxExtraWithPaymentId(batch.paymentId, extra);
+        std::copy(extra.begin(), extra.end(), std::back_inserter(extraString));
+      }
+
+      Crypto::SecretKey transactionSK;
+      CryptoNote::TransactionId tx = m_wallet->sendTransaction(transactionSK, batch.transfers, fee, extraString, mixin);
+      std::error_code sendError;
+      if (tx == WALLET_LEGACY_INVALID_TRANSACTION_ID) {
+        sendError = std::make_error_code(std::errc::operation_canceled);
+      } else {
+        sendError = sent.wait(tx);
+      }
+
+      if (sendError) {
+        fail_msg_writer() << "Can't send the transaction for line " << batch.lines.front() << ": " << sendError.message();
+        break;
+      }
+
+      CryptoNote::WalletLegacyTransaction txInfo;
+      m_wallet->getTransaction(tx, txInfo);
+      success_msg_writer(true) << "Lines " << batch.lines.front() << "-" << batch.lines.back() << " (" << batch.transfers.size() <<
+        " destinations) sent, transaction hash: " << Common::podToHex(txInfo.hash);
+
+      ++sentTransactions;
+      sentDestinations += batch.transfers.size();
+    }
+
+    removeGuard.removeObserver();
+  } catch (const std::exception& e) {
+    fail_msg_writer() << e.what();
+  }
+
+  if (sentDestinations != destinations) {
+    fail_msg_writer() << "Sent " << sentDestinations << " of " << destinations << " destinations, " <<
+      "the lines listed above as sent must be removed before the file is sent again";
+  } else {
+    success_msg_writer(true) << "Sent all " << destinations << " destinations in " << sentTransactions << " transactions";
+  }
+
+  if (sentTransactions != 0) {
+    try {
+      CryptoNote::WalletHelper::storeWallet(*m_wallet, m_wallet_file);
+    } catch (const std::exception& e) {
+      fail_msg_writer() << e.what();
+    }
+  }
+
+  return true;
+}
+//----------------------------------------------------------------------------------------------------
 bool simple_wallet::run() {
   {
     std::unique_lock<std::mutex> lock(m_walletSynchronizedMutex);
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <future>
 #include <memory>
@@ -101,9 +103,11 @@ namespace CryptoNote
     bool optimize_all_outputs(const std::vector<std::string> &args);
     bool listTransfers(const std::vector<std::string> &args);
     bool transfer(const std::vector<std::string> &args);
+    bool transfer_batch(const std::vector<std::string> &args);
     bool print_address(const std::vector<std::string> &args = std::vector<std::string>());
     bool save(const std::vector<std::string> &args);
     bool reset(const std::vector<std::string> &args);
+    bool refresh(const std::vector<std::string> &args);
     bool set_log(const std::vector<std::string> &args);
     bool payment_id(const std::vector<std::string> &args);
 
@@ -137,9 +141,33 @@ namespace CryptoNote
         , m_blockchain_height(0)
         , m_blockchain_height_update_time()
         , m_print_time()
+        , m_height(0)
+        , m_start_height(0)
+        , m_started(false)
       {
       }
 
+      // the blocks/s figure is measured from the first update after this call
+      void start()
+      {
+        m_started = false;
+      }
+
+      uint64_t height() const
+      {
+        return m_height;
+      }
+
+      double blocks_per_second() const
+      {
+        if (!m_started) {
+          return 0;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start_time).count();
+        return seconds > 0 ? static_cast<double>(m_height - m_start_height) / seconds : 0;
+      }
+
       void update(uint64_t height, bool force = false)
       {
         auto current_time = std::chrono::system_clock::now();
@@ -149,8 +177,17 @@ namespace CryptoNote
           m_blockchain_height = (std::max)(m_blockchain_height, height);
         }
 
+        if (!m_started || height < m_start_height) {
+          m_start_height = height;
+          m_start_time = std::chrono::steady_clock::now();
+          m_started = true;
+        }
+        m_height = height;
+
         if (std::chrono::milliseconds(1) < current_time - m_print_time || force) {
-          std::cout << "Height " << height << " of " << m_blockchain_height << '\r';
+          std::cout << "Height " << height << " of " << m_blockchain_height << ", " <<
+            static_cast<uint64_t>(blocks_per_second()) << " blocks/s, " <<
+            m_simple_wallet.m_refresh_transactions_found << " transactions found" << '\r';
           m_print_time = current_time;
         }
       }
@@ -168,6 +205,10 @@ namespace CryptoNote
       uint64_t m_blockchain_height;
       std::chrono::system_clock::time_point m_blockchain_height_update_time;
       std::chrono::system_clock::time_point m_print_time;
+      uint64_t m_height;
+      uint64_t m_start_height;
+      std::chrono::steady_clock::time_point m_start_time;
+      bool m_started;
     };
 
   private:
@@ -193,6 +234,7 @@ namespace CryptoNote
     std::unique_ptr<CryptoNote::NodeRpcProxy> m_node;
     std::unique_ptr<CryptoNote::IWalletLegacy> m_wallet;
     refresh_progress_reporter_t m_refresh_progress_reporter;
+    std::atomic<size_t> m_refresh_transactions_found;
 
     bool m_walletSynchronized;
     std::mutex m_walletSynchronizedMutex;
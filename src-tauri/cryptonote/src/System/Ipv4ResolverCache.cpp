@@ -0,0 +1,57 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Ipv4ResolverCache.h"
+
+namespace System {
+
+const std::chrono::seconds Ipv4ResolverCache::DEFAULT_TTL(60);
+
+Ipv4ResolverCache& Ipv4ResolverCache::instance() {
+  static Ipv4ResolverCache cache;
+  return cache;
+}
+
+bool Ipv4ResolverCache::find(const std::string& host, std::vector<Ipv4Address>& addresses) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(host);
+  if (it == entries.end()) {
+    return false;
+  }
+
+  if (it->second.expiry <= std::chrono::steady_clock::now()) {
+    entries.erase(it);
+    return false;
+  }
+
+  addresses = it->second.addresses;
+  return true;
+}
+
+void Ipv4ResolverCache::insert(const std::string& host, const std::vector<Ipv4Address>& addresses, std::chrono::seconds ttl) {
+  std::lock_guard<std::mutex> lock(mutex);
+  Entry& entry = entries[host];
+  entry.addresses = addresses;
+  entry.expiry = std::chrono::steady_clock::now() + ttl;
+}
+
+void Ipv4ResolverCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+}
+
+}
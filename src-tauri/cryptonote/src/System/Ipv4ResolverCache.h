@@ -0,0 +1,52 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <System/Ipv4Address.h>
+
+namespace System {
+
+// Addresses of recently resolved host names, shared by the resolvers of all dispatchers in the process.
+// getaddrinfo does not report the record TTL, so entries live for a fixed time kept below common TTLs.
+class Ipv4ResolverCache {
+public:
+  static const std::chrono::seconds DEFAULT_TTL;
+
+  static Ipv4ResolverCache& instance();
+
+  bool find(const std::string& host, std::vector<Ipv4Address>& addresses);
+  void insert(const std::string& host, const std::vector<Ipv4Address>& addresses, std::chrono::seconds ttl = DEFAULT_TTL);
+  void clear();
+
+private:
+  struct Entry {
+    std::vector<Ipv4Address> addresses;
+    std::chrono::steady_clock::time_point expiry;
+  };
+
+  std::mutex mutex;
+  std::unordered_map<std::string, Entry> entries;
+};
+
+}
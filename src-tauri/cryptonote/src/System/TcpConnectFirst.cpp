@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "TcpConnectFirst.h"
+
+#include <memory>
+#include <stdexcept>
+
+#include <System/ContextGroup.h>
+#include <System/Event.h>
+#include <System/InterruptedException.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpConnector.h>
+#include <System/Timer.h>
+
+namespace System {
+
+TcpConnection connectFirst(Dispatcher& dispatcher, const std::vector<Ipv4Address>& addresses, uint16_t port,
+  std::chrono::milliseconds attemptDelay) {
+  if (addresses.empty()) {
+    throw std::runtime_error("connectFirst, no address to connect to");
+  }
+
+  if (addresses.size() == 1) {
+    return TcpConnector(dispatcher).connect(addresses.front(), port);
+  }
+
+  // mayStart[i] is set when attempt i is due: by the timer of attempt i - 1 or by its failure
+  std::vector<std::unique_ptr<Event>> mayStart;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    mayStart.emplace_back(new Event(dispatcher));
+  }
+
+  TcpConnection connection;
+  bool connected = false;
+  size_t finished = 0;
+  std::string lastError;
+  Event done(dispatcher);
+  // destroyed in reverse order: attempts still running are cancelled first, then their timers
+  ContextGroup timers(dispatcher);
+  ContextGroup attempts(dispatcher);
+
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    attempts.spawn([&, i] {
+      try {
+        if (i != 0) {
+          mayStart[i]->wait();
+        }
+
+        if (i + 1 < addresses.size()) {
+          timers.spawn([&, i] {
+            try {
+              Timer(dispatcher).sleep(attemptDelay);
+              mayStart[i + 1]->set();
+            } catch (InterruptedException&) {
+            }
+          });
+        }
+
+        TcpConnection attempt = TcpConnector(dispatcher).connect(addresses[i], port);
+        if (!connected) {
+          connected = true;
+          connection = std::move(attempt);
+          done.set();
+        }
+      } catch (InterruptedException&) {
+      } catch (std::exception& e) {
+        lastError = e.what();
+        if (i + 1 < addresses.size()) {
+          mayStart[i + 1]->set();
+        }
+      }
+
+      if (++finished == addresses.size()) {
+        done.set();
+      }
+    });
+  }
+
+  done.wait();
+  if (!connected) {
+    throw std::runtime_error("connectFirst, every address failed, last error: " + lastError);
+  }
+
+  return connection;
+}
+
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <System/TcpConnection.h>
+
+namespace System {
+
+class Dispatcher;
+class Ipv4Address;
+
+// Connects to the first of a host's addresses that accepts, in the spirit of happy eyeballs (RFC 8305):
+// the next address is tried attemptDelay after the previous attempt started, or as soon as it failed,
+// so an unreachable address costs the delay instead of a full connect timeout. Attempts still in
+// flight are cancelled once one succeeds.
+TcpConnection connectFirst(Dispatcher& dispatcher, const std::vector<Ipv4Address>& addresses, uint16_t port,
+  std::chrono::milliseconds attemptDelay = std::chrono::milliseconds(250));
+
+}
@@ -16,6 +16,7 @@
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 
 #include "TcpStream.h"
+#include <cstring>
 #include <System/TcpConnection.h>
 
 namespace System {
@@ -69,6 +70,44 @@ std::streambuf::int_type TcpStreambuf::underflow() {
   return traits_type::to_int_type(*gptr());
 }
 
+// Output that does not fit the buffer is sent together with the buffered bytes in gather writes,
+// instead of being copied through the buffer one kilobyte at a time.
+std::streamsize TcpStreambuf::xsputn(const char* s, std::streamsize count) {
+  if (count <= epptr() - pptr()) {
+    memcpy(pptr(), s, static_cast<size_t>(count));
+    pbump(static_cast<int>(count));
+    return count;
+  }
+
+  if (static_cast<size_t>(count) <= writeBuf.max_size()) {
+    return std::streambuf::xsputn(s, count);
+  }
+
+  const uint8_t* head = &writeBuf.front();
+  size_t headSize = pptr() - pbase();
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(s);
+  size_t size = static_cast<size_t>(count);
+  try {
+    while (headSize + size != 0) {
+      size_t transferred = connection.write(head, headSize, data, size);
+      if (transferred < headSize) {
+        head += transferred;
+        headSize -= transferred;
+      } else {
+        transferred -= headSize;
+        headSize = 0;
+        data += transferred;
+        size -= transferred;
+      }
+    }
+  } catch (std::exception&) {
+    return 0;
+  }
+
+  setp(reinterpret_cast<char*>(&writeBuf.front()), reinterpret_cast<char *>(&writeBuf.front() + writeBuf.max_size()));
+  return count;
+}
+
 bool TcpStreambuf::dumpBuffer(bool finalize) {
   try {
     size_t count = pptr() - pbase();
@@ -40,6 +40,7 @@ private:
   std::streambuf::int_type overflow(std::streambuf::int_type ch) override;
   int sync() override;
   std::streambuf::int_type underflow() override;
+  std::streamsize xsputn(const char* s, std::streamsize count) override;
   bool dumpBuffer(bool finalize);
 };
 
@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "BlockBatchSizer.h"
+
+#include <algorithm>
+
+namespace CryptoNote {
+
+namespace {
+
+const std::chrono::milliseconds TARGET_LATENCY(1500);
+const uint64_t INITIAL_RESPONSE_SIZE = 2 * 1024 * 1024;
+const uint32_t INITIAL_BLOCK_COUNT = 128; // BLOCKS_SYNCHRONIZING_DEFAULT_COUNT, what nodes answered before negotiation
+const double BYTES_PER_BLOCK_SMOOTHING = 0.5;
+
+}
+
+const uint32_t BlockBatchSizer::MIN_BLOCK_COUNT;
+const uint32_t BlockBatchSizer::MAX_BLOCK_COUNT;
+const uint64_t BlockBatchSizer::MIN_RESPONSE_SIZE;
+const uint64_t BlockBatchSizer::MAX_RESPONSE_SIZE;
+
+BlockBatchSizer::BlockBatchSizer() :
+  m_blockCount(INITIAL_BLOCK_COUNT), m_responseSize(INITIAL_RESPONSE_SIZE), m_bytesPerBlock(0) {
+}
+
+void BlockBatchSizer::update(uint32_t fullBlocks, uint64_t bytes, std::chrono::steady_clock::duration latency) {
+  double latencyRatio = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(latency).count()) / TARGET_LATENCY.count();
+
+  // slow round trips shrink the budget in proportion, fast ones that used most of it grow it at most twofold
+  if (latencyRatio > 1.0) {
+    m_responseSize = static_cast<uint64_t>(m_responseSize / std::min(latencyRatio, 2.0));
+  } else if (latencyRatio < 0.5 && bytes >= m_responseSize * 3 / 4) {
+    m_responseSize = m_responseSize * 2;
+  }
+
+  m_responseSize = std::max(MIN_RESPONSE_SIZE, std::min(m_responseSize, MAX_RESPONSE_SIZE));
+
+  if (fullBlocks == 0) {
+    return;
+  }
+
+  double bytesPerBlock = static_cast<double>(bytes) / fullBlocks;
+  m_bytesPerBlock = m_bytesPerBlock == 0 ? bytesPerBlock :
+    BYTES_PER_BLOCK_SMOOTHING * bytesPerBlock + (1 - BYTES_PER_BLOCK_SMOOTHING) * m_bytesPerBlock;
+
+  // grow at most twofold per round trip so one batch of unusually small blocks does not overshoot
+  double target = m_responseSize / std::max(m_bytesPerBlock, 1.0);
+  target = std::min(target, 2.0 * m_blockCount);
+
+  m_blockCount = static_cast<uint32_t>(std::max<double>(MIN_BLOCK_COUNT, std::min<double>(target, MAX_BLOCK_COUNT)));
+}
+
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace CryptoNote {
+
+// Sizes the queryBlocks() batches of BlockchainSynchronizer. Early history is mostly tiny blocks and
+// recent history fat ones, so the block count follows the observed bytes per block towards a byte
+// budget per round trip, and both count and budget back off when a round trip exceeds the latency target.
+class BlockBatchSizer {
+public:
+  static const uint32_t MIN_BLOCK_COUNT = 16;
+  static const uint32_t MAX_BLOCK_COUNT = 1000;              // COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT
+  static const uint64_t MIN_RESPONSE_SIZE = 256 * 1024;
+  static const uint64_t MAX_RESPONSE_SIZE = 8 * 1024 * 1024;
+
+  BlockBatchSizer();
+
+  uint32_t blockCount() const { return m_blockCount; }
+  uint64_t responseSize() const { return m_responseSize; }
+
+  // fullBlocks / bytes describe the full blocks in the answer, entries that carried only a hash are not counted
+  void update(uint32_t fullBlocks, uint64_t bytes, std::chrono::steady_clock::duration latency);
+
+private:
+  uint32_t m_blockCount;
+  uint64_t m_responseSize;
+  double m_bytesPerBlock;
+};
+
+}
@@ -17,19 +17,26 @@
 
 #include "BlockchainSynchronizer.h"
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <thread>
 #include <unordered_set>
 
+#include "Common/Tracing.h"
 #include "CryptoNoteCore/TransactionApi.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
 
 using namespace Crypto;
 
 namespace {
 
+// hash-only blocks handed to the consumers at once while following a rescan plan
+const uint32_t MAX_PLANNED_SKIP_BLOCKS = 10000;
+
 inline std::vector<uint8_t> stringToVector(const std::string& s) {
   std::vector<uint8_t> vec(
     reinterpret_cast<const uint8_t*>(s.data()),
@@ -45,7 +52,9 @@ BlockchainSynchronizer::BlockchainSynchronizer(INode& node, const Hash& genesisB
   m_node(node),
   m_genesisBlockHash(genesisBlockHash),
   m_currentState(State::stopped),
-  m_futureState(State::stopped) {
+  m_futureState(State::stopped),
+  m_servedLeadingConsumer(false),
+  m_transactionArenaStats(m_transactionArena.getStats()) {
 }
 
 BlockchainSynchronizer::~BlockchainSynchronizer() {
@@ -258,6 +267,7 @@ void BlockchainSynchronizer::workingProcedure() {
   }
 
   actualizeFutureState();
+  dropPrefetchedBlocks();
 }
 
 void BlockchainSynchronizer::start() {
@@ -283,6 +293,11 @@ void BlockchainSynchronizer::stop() {
   workingThread.reset();
 }
 
+Common::Arena::Stats BlockchainSynchronizer::getTransactionArenaStats() const {
+  std::lock_guard<std::mutex> lk(m_arenaStatsMutex);
+  return m_transactionArenaStats;
+}
+
 void BlockchainSynchronizer::localBlockchainUpdated(uint32_t /*height*/) {
   setFutureState(State::blockchainSync);
 }
@@ -327,6 +342,7 @@ BlockchainSynchronizer::GetBlocksRequest BlockchainSynchronizer::getCommonHistor
   }
 
   auto shortest = m_consumers.begin();
+  auto tallest = shortest;
   auto syncStart = shortest->first->getSyncStart();
   auto it = shortest;
   ++it;
@@ -335,41 +351,78 @@ BlockchainSynchronizer::GetBlocksRequest BlockchainSynchronizer::getCommonHistor
       shortest = it;
     }
 
+    if (it->second->getHeight() > tallest->second->getHeight()) {
+      tallest = it;
+    }
+
     auto consumerStart = it->first->getSyncStart();
     syncStart.timestamp = std::min(syncStart.timestamp, consumerStart.timestamp);
     syncStart.height = std::min(syncStart.height, consumerStart.height);
   }
 
-  request.knownBlocks = shortest->second->getShortHistory(m_node.getLastLocalBlockHeight());
+  // A consumer catching up from far behind must not hold back the ones following the top of the chain,
+  // so while heights differ the requests alternate between the shortest and the tallest history.
+  auto target = shortest;
+  if (tallest->second->getHeight() != shortest->second->getHeight()) {
+    m_servedLeadingConsumer = !m_servedLeadingConsumer;
+    if (m_servedLeadingConsumer) {
+      target = tallest;
+    }
+  } else {
+    m_servedLeadingConsumer = false;
+  }
+
+  request.knownBlocks = target->second->getShortHistory(m_node.getLastLocalBlockHeight());
   request.syncStart = syncStart;
+  request.consumerHeight = target->second->getHeight();
   return request;
 }
 
 void BlockchainSynchronizer::startBlockchainSync() {
+  try {
+    if (followRescanPlan()) {
+      return;
+    }
+  } catch (std::exception&) {
+    dropRescanPlan();
+  }
+
   GetBlocksResponse response;
   GetBlocksRequest req = getCommonHistory();
 
   try {
     if (!req.knownBlocks.empty()) {
-      auto queryBlocksCompleted = std::promise<std::error_code>();
-      auto queryBlocksWaitFuture = queryBlocksCompleted.get_future();
-
-      m_node.queryBlocks(
-        std::move(req.knownBlocks),
-        req.syncStart.timestamp,
-        response.newBlocks,
-        response.startHeight,
-        [&queryBlocksCompleted](std::error_code ec) {
-          auto detachedPromise = std::move(queryBlocksCompleted);
-          detachedPromise.set_value(ec);
-        });
-
-      std::error_code ec = queryBlocksWaitFuture.get();
+      Common::ScopedSpan batchSpan("BlockchainSynchronizer::batch");
+      std::error_code ec;
+      if (!takePrefetchedBlocks(req, response, ec)) {
+        Common::ScopedSpan querySpan("BlockchainSynchronizer::queryBlocks");
+        auto queryBlocksCompleted = std::promise<std::error_code>();
+        auto queryBlocksWaitFuture = queryBlocksCompleted.get_future();
+        auto issuedAt = std::chrono::steady_clock::now();
+
+        m_node.queryBlocks(
+          std::vector<Crypto::Hash>(req.knownBlocks),
+          req.syncStart.timestamp,
+          m_batchSizer.blockCount(),
+          m_batchSizer.responseSize(),
+          response.newBlocks,
+          response.startHeight,
+          [&queryBlocksCompleted](std::error_code ec) {
+            auto detachedPromise = std::move(queryBlocksCompleted);
+            detachedPromise.set_value(ec);
+          });
+
+        ec = queryBlocksWaitFuture.get();
+        if (!ec) {
+          updateBatchSize(response, std::chrono::steady_clock::now() - issuedAt);
+        }
+      }
 
       if (ec) {
         setFutureStateIf(State::idle, [this] { return m_futureState != State::stopped; });
         m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, ec);
       } else {
+        startBlocksPrefetch(req, response);
         processBlocks(response);
       }
     }
@@ -379,10 +432,104 @@ void BlockchainSynchronizer::startBlockchainSync() {
   }
 }
 
+void BlockchainSynchronizer::startBlocksPrefetch(const GetBlocksRequest& request, const GetBlocksResponse& response) {
+  assert(m_prefetchedBlocks.get() == nullptr);
+
+  if (response.newBlocks.empty() || checkIfShouldStop()) {
+    return;
+  }
+
+  // nothing to prefetch once the batch reaches the node's top block
+  uint32_t lastHeight = response.startHeight + static_cast<uint32_t>(response.newBlocks.size()) - 1;
+  if (lastHeight >= m_node.getLastKnownBlockHeight()) {
+    return;
+  }
+
+  // history as it will look after this batch is applied; the node answers from the
+  // highest block it still has on its main chain, so a reorg meanwhile only moves startHeight back
+  std::vector<Crypto::Hash> knownBlocks;
+  knownBlocks.reserve(request.knownBlocks.size() + 1);
+  knownBlocks.push_back(response.newBlocks.back().blockHash);
+  knownBlocks.insert(knownBlocks.end(), request.knownBlocks.begin(), request.knownBlocks.end());
+
+  std::unique_ptr<PendingBlocksQuery> query(new PendingBlocksQuery());
+  query->result = query->completed.get_future();
+  query->issuedAt = std::chrono::steady_clock::now();
+  PendingBlocksQuery* pending = query.get();
+
+  m_node.queryBlocks(
+    std::move(knownBlocks),
+    request.syncStart.timestamp,
+    m_batchSizer.blockCount(),
+    m_batchSizer.responseSize(),
+    pending->response.newBlocks,
+    pending->response.startHeight,
+    [pending](std::error_code ec) {
+      pending->completedAt = std::chrono::steady_clock::now();
+      auto detachedPromise = std::move(pending->completed);
+      detachedPromise.set_value(ec);
+    });
+
+  m_prefetchedBlocks = std::move(query);
+}
+
+bool BlockchainSynchronizer::takePrefetchedBlocks(const GetBlocksRequest& request, GetBlocksResponse& response, std::error_code& ec) {
+  if (m_prefetchedBlocks.get() == nullptr) {
+    return false;
+  }
+
+  std::unique_ptr<PendingBlocksQuery> query = std::move(m_prefetchedBlocks);
+  std::error_code queryError = query->result.get();
+
+  // the batch is usable only if it does not skip past what the requesting consumer has;
+  // otherwise a consumer was detached or failed and the request has to be rebuilt
+  if (queryError || query->response.startHeight > request.consumerHeight) {
+    return false;
+  }
+
+  updateBatchSize(query->response, query->completedAt - query->issuedAt);
+
+  response = std::move(query->response);
+  ec = std::error_code();
+  return true;
+}
+
+void BlockchainSynchronizer::dropPrefetchedBlocks() {
+  if (m_prefetchedBlocks.get() != nullptr) {
+    // the node writes into the response until the callback fires
+    m_prefetchedBlocks->result.wait();
+    m_prefetchedBlocks.reset();
+  }
+}
+
+void BlockchainSynchronizer::updateBatchSize(const GetBlocksResponse& response, std::chrono::steady_clock::duration latency) {
+  uint32_t fullBlocks = 0;
+  uint64_t bytes = 0;
+
+  for (const auto& block : response.newBlocks) {
+    if (!block.hasBlock) {
+      continue;
+    }
+
+    ++fullBlocks;
+    bytes += getObjectBinarySize(block.block);
+    for (const auto& txShortInfo : block.txsShortInfo) {
+      bytes += getObjectBinarySize(txShortInfo.txPrefix) + sizeof(txShortInfo.txId);
+    }
+  }
+
+  m_batchSizer.update(fullBlocks, bytes, latency);
+}
+
 void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
+  Common::ScopedSpan span("BlockchainSynchronizer::processBlocks");
   BlockchainInterval interval;
   interval.startHeight = response.startHeight;
   std::vector<CompleteBlock> blocks;
+  blocks.reserve(response.newBlocks.size());
+
+  // readers of the previous batch were released together with its blocks
+  m_transactionArena.reset();
 
   for (auto& block : response.newBlocks) {
     if (checkIfShouldStop()) {
@@ -394,11 +541,14 @@ void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
     interval.blocks.push_back(completeBlock.blockHash);
     if (block.hasBlock) {
       completeBlock.block = std::move(block.block);
-      completeBlock.transactions.push_back(createTransactionPrefix(completeBlock.block->baseTransaction));
+      completeBlock.transactions.reserve(block.txsShortInfo.size() + 1);
+      completeBlock.transactions.push_back(createTransactionPrefix(completeBlock.block->baseTransaction, m_transactionArena));
+      completeBlock.globalIndexes.push_back(std::move(block.baseTransactionGlobalIndexes));
 
       try {
-        for (const auto& txShortInfo : block.txsShortInfo) {
-          completeBlock.transactions.push_back(createTransactionPrefix(txShortInfo.txPrefix, reinterpret_cast<const Hash&>(txShortInfo.txId)));
+        for (auto& txShortInfo : block.txsShortInfo) {
+          completeBlock.transactions.push_back(createTransactionPrefix(std::move(txShortInfo.txPrefix), reinterpret_cast<const Hash&>(txShortInfo.txId), m_transactionArena));
+          completeBlock.globalIndexes.push_back(std::move(txShortInfo.globalIndexes));
         }
       } catch (std::exception&) {
         setFutureStateIf(State::idle, [this] { return m_futureState != State::stopped; });
@@ -410,44 +560,189 @@ void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
     blocks.push_back(std::move(completeBlock));
   }
 
+  {
+    std::lock_guard<std::mutex> lk(m_arenaStatsMutex);
+    m_transactionArenaStats = m_transactionArena.getStats();
+  }
+
   uint32_t processedBlockCount = response.startHeight + static_cast<uint32_t>(response.newBlocks.size());
   if (!checkIfShouldStop()) {
     response.newBlocks.clear();
-    std::unique_lock<std::mutex> lk(m_consumersMutex);
-    auto result = updateConsumers(interval, blocks);
-    lk.unlock();
+    applyBlocks(interval, blocks, processedBlockCount);
+  }
 
-    switch (result) {
-    case UpdateConsumersResult::errorOccurred:
-      if (setFutureStateIf(State::idle, [this] { return m_futureState != State::stopped; })) {
-        m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, std::make_error_code(std::errc::invalid_argument));
-      }
-      break;
+  if (checkIfShouldStop()) { //Sic!
+    m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, std::make_error_code(std::errc::interrupted));
+  }
+}
 
-    case UpdateConsumersResult::nothingChanged:
-      if (m_node.getLastKnownBlockHeight() != m_node.getLastLocalBlockHeight()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-      } else {
-        break;
-      }
+void BlockchainSynchronizer::applyBlocks(const BlockchainInterval& interval, const std::vector<CompleteBlock>& blocks, uint32_t processedBlockCount) {
+  std::unique_lock<std::mutex> lk(m_consumersMutex);
+  UpdateConsumersResult result;
+  {
+    Common::ScopedSpan consumersSpan("BlockchainSynchronizer::updateConsumers");
+    result = updateConsumers(interval, blocks);
+  }
+  uint32_t lowestConsumerHeight;
+  uint32_t highestConsumerHeight;
+  getConsumerHeightRange(lowestConsumerHeight, highestConsumerHeight);
+  lk.unlock();
+
+  switch (result) {
+  case UpdateConsumersResult::errorOccurred:
+    if (setFutureStateIf(State::idle, [this] { return m_futureState != State::stopped; })) {
+      m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, std::make_error_code(std::errc::invalid_argument));
+    }
+    break;
 
-    case UpdateConsumersResult::addedNewBlocks:
-      setFutureState(State::blockchainSync);
-      m_observerManager.notify(
-        &IBlockchainSynchronizerObserver::synchronizationProgressUpdated,
-        processedBlockCount,
-        std::max(m_node.getKnownBlockCount(), m_node.getLocalBlockCount()));
+  case UpdateConsumersResult::nothingChanged:
+    if (m_node.getLastKnownBlockHeight() != m_node.getLastLocalBlockHeight()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    } else if (lowestConsumerHeight == highestConsumerHeight) {
       break;
     }
 
-    if (!blocks.empty()) {
-      lastBlockId = blocks.back().blockHash;
+  case UpdateConsumersResult::addedNewBlocks:
+    setFutureState(State::blockchainSync);
+    // a catch-up batch must not move the reported progress backwards
+    m_observerManager.notify(
+      &IBlockchainSynchronizerObserver::synchronizationProgressUpdated,
+      std::max(processedBlockCount, highestConsumerHeight),
+      std::max(m_node.getKnownBlockCount(), m_node.getLocalBlockCount()));
+    break;
+  }
+
+  if (!blocks.empty()) {
+    lastBlockId = blocks.back().blockHash;
+  }
+}
+
+void BlockchainSynchronizer::setRescanPlan(std::shared_ptr<const RescanPlan> plan) {
+  if (!(checkIfStopped() && checkIfShouldStop())) {
+    throw std::runtime_error("Can't set rescan plan, because BlockchainSynchronizer isn't stopped");
+  }
+
+  std::lock_guard<std::mutex> lk(m_rescanPlanMutex);
+  m_rescanPlan = std::move(plan);
+}
+
+bool BlockchainSynchronizer::hasRescanPlan() const {
+  std::lock_guard<std::mutex> lk(m_rescanPlanMutex);
+  return m_rescanPlan.get() != nullptr;
+}
+
+void BlockchainSynchronizer::dropRescanPlan() {
+  std::lock_guard<std::mutex> lk(m_rescanPlanMutex);
+  m_rescanPlan.reset();
+}
+
+// Serves the next batch of the rescan plan; false when the plan does not cover the consumer height and
+// the regular request has to be made.
+bool BlockchainSynchronizer::followRescanPlan() {
+  std::shared_ptr<const RescanPlan> plan;
+  {
+    std::lock_guard<std::mutex> lk(m_rescanPlanMutex);
+    plan = m_rescanPlan;
+  }
+
+  if (!plan) {
+    return false;
+  }
+
+  uint32_t height;
+  Crypto::Hash lastBlock;
+  {
+    std::unique_lock<std::mutex> lk(m_consumersMutex);
+    auto it = m_consumers.find(plan->consumer);
+    if (it == m_consumers.end() || m_consumers.size() != 1) {
+      lk.unlock();
+      dropRescanPlan();
+      return false;
+    }
+
+    height = it->second->getHeight();
+    if (height <= plan->startHeight) {
+      // the regular sync brings the consumer up to the plan
+      return false;
+    }
+
+    if (height >= plan->endHeight()) {
+      lk.unlock();
+      dropRescanPlan();
+      return false;
     }
+
+    lastBlock = it->second->getKnownBlockHashes()[height - 1];
   }
 
-  if (checkIfShouldStop()) { //Sic!
+  // after a reorganization the regular sync takes over and detaches whatever was applied from the plan
+  if (lastBlock != plan->blockHashes[height - 1 - plan->startHeight]) {
+    dropRescanPlan();
+    return false;
+  }
+
+  // a prefetched batch follows the chain past blocks the plan skips
+  dropPrefetchedBlocks();
+
+  Common::ScopedSpan batchSpan("BlockchainSynchronizer::rescanPlanBatch");
+  auto relevant = std::lower_bound(plan->relevantHeights.begin(), plan->relevantHeights.end(), height);
+  if (relevant != plan->relevantHeights.end() && *relevant == height) {
+    // full blocks for the run of relevant heights starting here, answered from the last known block
+    uint32_t count = 1;
+    while (relevant + count != plan->relevantHeights.end() && *(relevant + count) == height + count &&
+           count < m_batchSizer.blockCount()) {
+      ++count;
+    }
+
+    GetBlocksResponse response;
+    auto queryBlocksCompleted = std::promise<std::error_code>();
+    auto queryBlocksWaitFuture = queryBlocksCompleted.get_future();
+
+    m_node.queryBlocks(
+      { lastBlock, m_genesisBlockHash },
+      0,
+      count + 1,
+      m_batchSizer.responseSize(),
+      response.newBlocks,
+      response.startHeight,
+      [&queryBlocksCompleted](std::error_code ec) {
+        auto detachedPromise = std::move(queryBlocksCompleted);
+        detachedPromise.set_value(ec);
+      });
+
+    std::error_code ec = queryBlocksWaitFuture.get();
+    if (ec) {
+      setFutureStateIf(State::idle, [this] { return m_futureState != State::stopped; });
+      m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, ec);
+    } else {
+      processBlocks(response);
+    }
+
+    return true;
+  }
+
+  uint32_t nextRelevant = relevant != plan->relevantHeights.end() ? *relevant : plan->endHeight();
+  uint32_t count = std::min(nextRelevant - height, MAX_PLANNED_SKIP_BLOCKS);
+
+  BlockchainInterval interval;
+  interval.startHeight = height;
+  interval.blocks.assign(plan->blockHashes.begin() + (height - plan->startHeight),
+    plan->blockHashes.begin() + (height - plan->startHeight + count));
+
+  std::vector<CompleteBlock> blocks(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    blocks[i].blockHash = interval.blocks[i];
+  }
+
+  if (!checkIfShouldStop()) {
+    applyBlocks(interval, blocks, height + count);
+  }
+
+  if (checkIfShouldStop()) {
     m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, std::make_error_code(std::errc::interrupted));
   }
+
+  return true;
 }
 
 /// \pre m_consumersMutex is locked
@@ -455,6 +750,11 @@ BlockchainSynchronizer::UpdateConsumersResult BlockchainSynchronizer::updateCons
   bool smthChanged = false;
 
   for (auto& kv : m_consumers) {
+    // a consumer behind the start of the interval gets its blocks from a request built from its own history
+    if (interval.startHeight > kv.second->getHeight()) {
+      continue;
+    }
+
     auto result = kv.second->checkInterval(interval);
 
     if (result.detachRequired) {
@@ -583,4 +883,19 @@ SynchronizationState* BlockchainSynchronizer::getConsumerSynchronizationState(IB
   return it->second.get();
 }
 
+/// \pre m_consumersMutex is locked
+void BlockchainSynchronizer::getConsumerHeightRange(uint32_t& lowest, uint32_t& highest) const {
+  lowest = std::numeric_limits<uint32_t>::max();
+  highest = 0;
+
+  for (const auto& kv : m_consumers) {
+    lowest = std::min(lowest, kv.second->getHeight());
+    highest = std::max(highest, kv.second->getHeight());
+  }
+
+  if (m_consumers.empty()) {
+    lowest = 0;
+  }
+}
+
 }
@@ -18,18 +18,37 @@
 #pragma once
 
 #include "INode.h"
+#include "BlockBatchSizer.h"
 #include "SynchronizationState.h"
 #include "IBlockchainSynchronizer.h"
 #include "IObservableImpl.h"
 #include "IStreamSerializable.h"
+#include "Common/Arena.h"
 
 #include <condition_variable>
 #include <mutex>
 #include <atomic>
 #include <future>
+#include <memory>
 
 namespace CryptoNote {
 
+// Blocks of a height range that hold transactions of one consumer, as found by ParallelRescan. While the
+// consumer is the only one and still on the planned chain, the synchronizer downloads just these blocks
+// in full and passes it the others as hashes.
+struct RescanPlan {
+  RescanPlan() : consumer(nullptr), startHeight(0) {}
+
+  IBlockchainConsumer* consumer;
+  uint32_t startHeight;
+  // hashes of blocks startHeight .. endHeight() - 1
+  std::vector<Crypto::Hash> blockHashes;
+  // sorted, unique
+  std::vector<uint32_t> relevantHeights;
+
+  uint32_t endHeight() const { return startHeight + static_cast<uint32_t>(blockHashes.size()); }
+};
+
 class BlockchainSynchronizer :
   public IObservableImpl<IBlockchainSynchronizerObserver, IBlockchainSynchronizer>,
   public INodeObserver {
@@ -50,6 +69,15 @@ public:
   virtual void start() override;
   virtual void stop() override;
 
+  // Follows plan from the consumer height just past plan->startHeight until plan->endHeight(); the
+  // plan is dropped early once other consumers are added or the chain no longer matches its hashes.
+  // The synchronizer must be stopped.
+  void setRescanPlan(std::shared_ptr<const RescanPlan> plan);
+  bool hasRescanPlan() const;
+
+  // allocation counters of the arena the transaction readers of a block batch are placed in
+  Common::Arena::Stats getTransactionArenaStats() const;
+
   // IStreamSerializable
   virtual void save(std::ostream& os) override;
   virtual void load(std::istream& in) override;
@@ -67,12 +95,23 @@ private:
   };
 
   struct GetBlocksRequest {
-    GetBlocksRequest() {
+    GetBlocksRequest() : consumerHeight(0) {
       syncStart.timestamp = 0;
       syncStart.height = 0;
     }
     SynchronizationStart syncStart;
     std::vector<Crypto::Hash> knownBlocks;
+    // height of the consumer whose history the request was built from
+    uint32_t consumerHeight;
+  };
+
+  // queryBlocks() issued ahead of time while consumers scan the current batch
+  struct PendingBlocksQuery {
+    GetBlocksResponse response;
+    std::promise<std::error_code> completed;
+    std::future<std::error_code> result;
+    std::chrono::steady_clock::time_point issuedAt;
+    std::chrono::steady_clock::time_point completedAt;
   };
 
   struct GetPoolResponse {
@@ -104,6 +143,13 @@ private:
   void startBlockchainSync();
 
   void processBlocks(GetBlocksResponse& response);
+  void applyBlocks(const BlockchainInterval& interval, const std::vector<CompleteBlock>& blocks, uint32_t processedBlockCount);
+  bool followRescanPlan();
+  void dropRescanPlan();
+  void startBlocksPrefetch(const GetBlocksRequest& request, const GetBlocksResponse& response);
+  bool takePrefetchedBlocks(const GetBlocksRequest& request, GetBlocksResponse& response, std::error_code& ec);
+  void dropPrefetchedBlocks();
+  void updateBatchSize(const GetBlocksResponse& response, std::chrono::steady_clock::duration latency);
   UpdateConsumersResult updateConsumers(const BlockchainInterval& interval, const std::vector<CompleteBlock>& blocks);
   std::error_code processPoolTxs(GetPoolResponse& response);
   std::error_code getPoolSymmetricDifferenceSync(GetPoolRequest&& request, GetPoolResponse& response);
@@ -123,6 +169,7 @@ private:
   GetBlocksRequest getCommonHistory();
   void getPoolUnionAndIntersection(std::unordered_set<Crypto::Hash>& poolUnion, std::unordered_set<Crypto::Hash>& poolIntersection) const;
   SynchronizationState* getConsumerSynchronizationState(IBlockchainConsumer* consumer) const ;
+  void getConsumerHeightRange(uint32_t& lowest, uint32_t& highest) const;
 
   typedef std::map<IBlockchainConsumer*, std::shared_ptr<SynchronizationState>> ConsumersMap;
 
@@ -135,6 +182,16 @@ private:
   State m_currentState;
   State m_futureState;
   std::unique_ptr<std::thread> workingThread;
+  // touched only from workingThread; at most one batch is held ahead to bound memory use
+  std::unique_ptr<PendingBlocksQuery> m_prefetchedBlocks;
+  // touched only from workingThread; set when the last request followed the highest consumer
+  bool m_servedLeadingConsumer;
+  BlockBatchSizer m_batchSizer;
+  std::shared_ptr<const RescanPlan> m_rescanPlan;
+  mutable std::mutex m_rescanPlanMutex;
+  Common::Arena m_transactionArena;
+  Common::Arena::Stats m_transactionArenaStats;
+  mutable std::mutex m_arenaStatsMutex;
   std::list<std::pair<const ITransactionReader*, std::promise<std::error_code>>> m_addTransactionTasks;
   std::list<std::pair<const Crypto::Hash*, std::promise<void>>> m_removeTransactionTasks;
 
@@ -20,6 +20,7 @@
 #include <array>
 #include <memory>
 #include <cstdint>
+#include <vector>
 
 #include <boost/optional.hpp>
 
@@ -37,7 +38,9 @@ struct CompleteBlock {
   Crypto::Hash blockHash;
   boost::optional<CryptoNote::Block> block;
   // first transaction is always coinbase
-  std::list<std::shared_ptr<ITransactionReader>> transactions;
+  std::vector<std::shared_ptr<ITransactionReader>> transactions;
+  // parallel to transactions when the node sent output global indexes inline, empty otherwise
+  std::vector<std::vector<uint32_t>> globalIndexes;
 };
 
 }
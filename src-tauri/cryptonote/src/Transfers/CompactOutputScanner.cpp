@@ -0,0 +1,87 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "CompactOutputScanner.h"
+
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+#include "CryptoNoteCore/TransactionExtra.h"
+
+namespace CryptoNote {
+
+CompactOutputScanner::CompactOutputScanner(const Crypto::SecretKey& viewSecret, const std::unordered_set<Crypto::PublicKey>& spendKeys) :
+  m_viewSecret(viewSecret), m_spendKeys(spendKeys) {
+}
+
+bool CompactOutputScanner::findMyOutputs(const CompactTransactionInfo& tx, std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>>& outputs) const {
+  if (tx.txPublicKey == NULL_PUBLIC_KEY) {
+    return false;
+  }
+
+  Crypto::KeyDerivation derivation;
+  if (!Crypto::generate_key_derivation(tx.txPublicKey, m_viewSecret, derivation)) {
+    return false;
+  }
+
+  // records carry key outputs only, so the position in outputKeys is also the derivation index
+  const Crypto::PublicKey* keys = tx.outputKeys.data();
+  bool tagged = tx.viewTags.size() == tx.outputKeys.size();
+  for (size_t idx = 0; idx < tx.outputKeys.size(); ++idx) {
+    if (tagged && tx.viewTags[idx] != deriveViewTag(derivation, idx)) {
+      continue;
+    }
+
+    Crypto::PublicKey spendKey;
+    Crypto::underive_public_key(derivation, idx, keys[idx], spendKey);
+
+    if (m_spendKeys.find(spendKey) != m_spendKeys.end()) {
+      outputs[spendKey].push_back(static_cast<uint32_t>(idx));
+    }
+  }
+
+  return true;
+}
+
+std::vector<size_t> CompactOutputScanner::findRelevant(const std::vector<CompactTransactionInfo>& transactions,
+  const std::unordered_set<Crypto::KeyImage>& knownKeyImages) const {
+  std::vector<size_t> relevant;
+  std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>> outputs;
+
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    const auto& tx = transactions[i];
+    if (tx.hasMultisignature) {
+      relevant.push_back(i);
+      continue;
+    }
+
+    outputs.clear();
+    if (findMyOutputs(tx, outputs) && !outputs.empty()) {
+      relevant.push_back(i);
+      continue;
+    }
+
+    for (const auto& keyImage : tx.keyImages) {
+      if (knownKeyImages.count(keyImage) != 0) {
+        relevant.push_back(i);
+        break;
+      }
+    }
+  }
+
+  return relevant;
+}
+
+}
@@ -0,0 +1,50 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
+
+namespace CryptoNote {
+
+// Output scan over COMMAND_RPC_QUERY_COMPACT_OUTPUTS records: the light wallet counterpart of the
+// ITransactionReader scan in TransfersConsumer. Only transactions it reports relevant need to be
+// fetched in full, everything else in the stream is skipped without parsing a prefix.
+class CompactOutputScanner {
+public:
+  // spendKeys is referenced, not copied, and must outlive the scanner
+  CompactOutputScanner(const Crypto::SecretKey& viewSecret, const std::unordered_set<Crypto::PublicKey>& spendKeys);
+
+  // output positions in tx.outputKeys per owning spend key; false when the transaction key is invalid
+  bool findMyOutputs(const CompactTransactionInfo& tx, std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>>& outputs) const;
+
+  // indexes of the transactions that own an output, spend one of knownKeyImages, or carry multisignature
+  // data the compact record leaves out
+  std::vector<size_t> findRelevant(const std::vector<CompactTransactionInfo>& transactions,
+    const std::unordered_set<Crypto::KeyImage>& knownKeyImages) const;
+
+private:
+  const Crypto::SecretKey m_viewSecret;
+  const std::unordered_set<Crypto::PublicKey>& m_spendKeys;
+};
+
+}
@@ -0,0 +1,150 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "FlatTransfersIndex.h"
+
+#include <cassert>
+
+namespace CryptoNote {
+
+namespace {
+
+const size_t MIN_CAPACITY = 16;
+
+// Keep the table at most 3/4 full so probe sequences stay short
+size_t capacityFor(size_t count) {
+  size_t capacity = MIN_CAPACITY;
+  while (capacity * 3 < count * 4) {
+    capacity *= 2;
+  }
+
+  return capacity;
+}
+
+}
+
+FlatHashIndex::FlatHashIndex() : m_mask(0), m_size(0), m_shift(32) {
+}
+
+void FlatHashIndex::clear() {
+  m_slots.clear();
+  m_slots.shrink_to_fit();
+  m_mask = 0;
+  m_size = 0;
+  m_shift = 32;
+}
+
+void FlatHashIndex::reserve(size_t count) {
+  size_t capacity = capacityFor(count);
+  if (capacity > m_slots.size()) {
+    rehash(capacity);
+  }
+}
+
+void FlatHashIndex::insert(size_t hash, uint32_t position) {
+  assert(position != EMPTY);
+  if (m_slots.empty() || (m_size + 1) * 4 > m_slots.size() * 3) {
+    rehash(capacityFor(m_size + 1));
+  }
+
+  uint32_t tag = makeTag(hash);
+  size_t i = home(tag);
+  while (m_slots[i].position != EMPTY) {
+    i = (i + 1) & m_mask;
+  }
+
+  m_slots[i].tag = tag;
+  m_slots[i].position = position;
+  ++m_size;
+}
+
+void FlatHashIndex::erase(size_t hash, uint32_t position) {
+  size_t hole = findSlot(makeTag(hash), position);
+  assert(hole != m_slots.size());
+  if (hole == m_slots.size()) {
+    return;
+  }
+
+  // Backward shift deletion: pull later entries of the probe run into the
+  // hole unless that would move them in front of their home slot
+  for (size_t i = (hole + 1) & m_mask; m_slots[i].position != EMPTY; i = (i + 1) & m_mask) {
+    size_t slotHome = home(m_slots[i].tag);
+    if (((i - slotHome) & m_mask) >= ((i - hole) & m_mask)) {
+      m_slots[hole] = m_slots[i];
+      hole = i;
+    }
+  }
+
+  m_slots[hole].position = EMPTY;
+  --m_size;
+}
+
+void FlatHashIndex::relocate(size_t hash, uint32_t from, uint32_t to) {
+  size_t slot = findSlot(makeTag(hash), from);
+  assert(slot != m_slots.size());
+  if (slot != m_slots.size()) {
+    m_slots[slot].position = to;
+  }
+}
+
+uint32_t FlatHashIndex::makeTag(size_t hash) {
+  uint64_t value = static_cast<uint64_t>(hash);
+  return static_cast<uint32_t>(value ^ (value >> 32));
+}
+
+size_t FlatHashIndex::home(uint32_t tag) const {
+  // Fibonacci hashing spreads tags that differ only in their low bits
+  return static_cast<size_t>(static_cast<uint32_t>(tag * 2654435769u) >> m_shift) & m_mask;
+}
+
+size_t FlatHashIndex::findSlot(uint32_t tag, uint32_t position) const {
+  if (m_slots.empty()) {
+    return m_slots.size();
+  }
+
+  for (size_t i = home(tag); m_slots[i].position != EMPTY; i = (i + 1) & m_mask) {
+    if (m_slots[i].tag == tag && m_slots[i].position == position) {
+      return i;
+    }
+  }
+
+  return m_slots.size();
+}
+
+void FlatHashIndex::rehash(size_t capacity) {
+  std::vector<Slot> slots(capacity, Slot{0, EMPTY});
+  std::swap(slots, m_slots);
+
+  m_mask = capacity - 1;
+  m_shift = 32;
+  for (size_t c = capacity; c > 1; c >>= 1) {
+    --m_shift;
+  }
+
+  for (const Slot& slot : slots) {
+    if (slot.position != EMPTY) {
+      size_t i = home(slot.tag);
+      while (m_slots[i].position != EMPTY) {
+        i = (i + 1) & m_mask;
+      }
+
+      m_slots[i] = slot;
+    }
+  }
+}
+
+}
@@ -0,0 +1,201 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace CryptoNote {
+
+// Open addressing hash index mapping key hashes to positions in a dense
+// element array. Slots are 8 bytes in one contiguous array, so a lookup
+// touches a cache line or two instead of walking bucket nodes. Keys are not
+// stored: callers confirm a match against the element itself.
+class FlatHashIndex {
+public:
+  FlatHashIndex();
+
+  size_t size() const { return m_size; }
+  void clear();
+  void reserve(size_t count);
+
+  void insert(size_t hash, uint32_t position);
+  void erase(size_t hash, uint32_t position);
+  void relocate(size_t hash, uint32_t from, uint32_t to);
+
+  // Calls visitor(position) for each position stored under hash until it returns false
+  template <typename Visitor>
+  void forEach(size_t hash, Visitor visitor) const {
+    if (m_slots.empty()) {
+      return;
+    }
+
+    uint32_t tag = makeTag(hash);
+    for (size_t i = home(tag); m_slots[i].position != EMPTY; i = (i + 1) & m_mask) {
+      if (m_slots[i].tag == tag && !visitor(m_slots[i].position)) {
+        return;
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    uint32_t tag;
+    uint32_t position;
+  };
+
+  static const uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+
+  static uint32_t makeTag(size_t hash);
+  size_t home(uint32_t tag) const;
+  size_t findSlot(uint32_t tag, uint32_t position) const;
+  void rehash(size_t capacity);
+
+  std::vector<Slot> m_slots;
+  size_t m_mask;
+  size_t m_size;
+  unsigned m_shift;
+};
+
+// Dense element array with FlatHashIndex lookups. An erase moves the last
+// element into the gap, so positions are only valid until the next erase.
+// Traits supplies INDEX_COUNT and static hash(item, index),
+// equal(a, b, index) and isUnique(index).
+template <typename T, typename Traits>
+class FlatIndexedVector {
+public:
+  typedef typename std::vector<T>::const_iterator const_iterator;
+
+  static const uint32_t NPOS = std::numeric_limits<uint32_t>::max();
+
+  size_t size() const { return m_items.size(); }
+  bool empty() const { return m_items.empty(); }
+  const_iterator begin() const { return m_items.begin(); }
+  const_iterator end() const { return m_items.end(); }
+
+  const T& operator[](size_t position) const { return m_items[position]; }
+  // Indexed fields of the returned element must stay unchanged
+  T& at(size_t position) { return m_items[position]; }
+
+  void clear() {
+    m_items.clear();
+    for (auto& index : m_indices) {
+      index.clear();
+    }
+  }
+
+  void reserve(size_t count) {
+    m_items.reserve(count);
+    for (auto& index : m_indices) {
+      index.reserve(count);
+    }
+  }
+
+  // Returns false and leaves the container unchanged if a unique key is taken
+  bool insert(T item) {
+    for (size_t i = 0; i < Traits::INDEX_COUNT; ++i) {
+      if (Traits::isUnique(i) && find(i, Traits::hash(item, i), [&item, i](const T& other) { return Traits::equal(item, other, i); }) != NPOS) {
+        return false;
+      }
+    }
+
+    uint32_t position = static_cast<uint32_t>(m_items.size());
+    m_items.push_back(std::move(item));
+    for (size_t i = 0; i < Traits::INDEX_COUNT; ++i) {
+      m_indices[i].insert(Traits::hash(m_items.back(), i), position);
+    }
+
+    return true;
+  }
+
+  void erase(size_t position) {
+    uint32_t last = static_cast<uint32_t>(m_items.size() - 1);
+    for (size_t i = 0; i < Traits::INDEX_COUNT; ++i) {
+      m_indices[i].erase(Traits::hash(m_items[position], i), static_cast<uint32_t>(position));
+    }
+
+    if (position != last) {
+      for (size_t i = 0; i < Traits::INDEX_COUNT; ++i) {
+        m_indices[i].relocate(Traits::hash(m_items[last], i), last, static_cast<uint32_t>(position));
+      }
+
+      m_items[position] = std::move(m_items[last]);
+    }
+
+    m_items.pop_back();
+  }
+
+  // Erases a batch of positions, e.g. the result of findAll()
+  void erase(std::vector<uint32_t> positions) {
+    std::sort(positions.begin(), positions.end(), std::greater<uint32_t>());
+    for (uint32_t position : positions) {
+      erase(position);
+    }
+  }
+
+  template <typename Match>
+  uint32_t find(size_t index, size_t hash, Match match) const {
+    uint32_t result = NPOS;
+    m_indices[index].forEach(hash, [this, &match, &result](uint32_t position) {
+      if (match(m_items[position])) {
+        result = position;
+        return false;
+      }
+
+      return true;
+    });
+
+    return result;
+  }
+
+  template <typename Match>
+  void findAll(size_t index, size_t hash, Match match, std::vector<uint32_t>& positions) const {
+    positions.clear();
+    m_indices[index].forEach(hash, [this, &match, &positions](uint32_t position) {
+      if (match(m_items[position])) {
+        positions.push_back(position);
+      }
+
+      return true;
+    });
+  }
+
+  template <typename Match>
+  size_t count(size_t index, size_t hash, Match match) const {
+    size_t result = 0;
+    m_indices[index].forEach(hash, [this, &match, &result](uint32_t position) {
+      if (match(m_items[position])) {
+        ++result;
+      }
+
+      return true;
+    });
+
+    return result;
+  }
+
+private:
+  std::vector<T> m_items;
+  std::array<FlatHashIndex, Traits::INDEX_COUNT> m_indices;
+};
+
+}
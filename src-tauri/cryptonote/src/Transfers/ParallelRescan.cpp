@@ -0,0 +1,428 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "ParallelRescan.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "INode.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/StringOutputStream.h"
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+#include "Serialization/SerializationOverloads.h"
+
+namespace CryptoNote {
+
+namespace {
+
+const uint32_t CHECKPOINT_VERSION = 1;
+// blocks asked for per compact output query, the node caps it at COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT
+const uint32_t QUERY_BLOCK_COUNT = 1000;
+const size_t MAX_WORKER_COUNT = 8;
+const uint32_t MAX_RECORD_SIZE = 256 * 1024 * 1024;
+
+// Inputs are matched against our key images by their first 8 bytes; a collision only costs one block
+// being downloaded in full.
+uint64_t keyImageFingerprint(const Crypto::KeyImage& keyImage) {
+  uint64_t fingerprint;
+  std::memcpy(&fingerprint, &keyImage, sizeof(fingerprint));
+  return fingerprint;
+}
+
+template <typename T>
+void writeRecord(std::ostream& out, T& value) {
+  std::string data;
+  {
+    Common::StringOutputStream stream(data);
+    BinaryOutputStreamSerializer serializer(stream);
+    value.serialize(serializer);
+  }
+
+  uint32_t size = static_cast<uint32_t>(data.size());
+  out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  out.write(data.data(), data.size());
+  out.flush();
+  if (!out) {
+    throw std::runtime_error("Failed to write rescan checkpoint");
+  }
+}
+
+// false at the end of the file and on a record cut short by an interrupted write
+template <typename T>
+bool readRecord(std::istream& in, T& value) {
+  uint32_t size;
+  if (!in.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > MAX_RECORD_SIZE) {
+    return false;
+  }
+
+  std::string data(size, '\0');
+  if (!in.read(&data[0], size)) {
+    return false;
+  }
+
+  try {
+    Common::MemoryInputStream stream(data.data(), data.size());
+    BinaryInputStreamSerializer serializer(stream);
+    value.serialize(serializer);
+  } catch (std::exception&) {
+    return false;
+  }
+
+  return true;
+}
+
+}
+
+void ParallelRescan::Segment::serialize(ISerializer& s) {
+  s(startHeight, "startHeight");
+  serializeAsBinary(blockHashes, "blockHashes", s);
+  serializeAsBinary(relevantHeights, "relevantHeights", s);
+  serializeAsBinary(keyImages, "keyImages", s);
+  serializeAsBinary(inputFingerprints, "inputFingerprints", s);
+  serializeAsBinary(inputHeights, "inputHeights", s);
+}
+
+void ParallelRescan::CheckpointHeader::serialize(ISerializer& s) {
+  s(version, "version");
+  s(startHeight, "startHeight");
+  s(endHeight, "endHeight");
+  s(segmentSize, "segmentSize");
+  s(keysHash, "keysHash");
+}
+
+ParallelRescan::ParallelRescan(INode& node, const Crypto::SecretKey& viewSecretKey, const std::vector<SpendKeys>& spendKeys,
+  const std::string& checkpointPath, uint32_t segmentSize) :
+  m_node(node),
+  m_viewSecretKey(viewSecretKey),
+  m_scanner(viewSecretKey, m_spendPublicKeys),
+  m_checkpointPath(checkpointPath),
+  m_segmentSize(std::max<uint32_t>(segmentSize, 1)) {
+  for (const auto& keys : spendKeys) {
+    m_spendSecretKeys[keys.publicKey] = keys.secretKey;
+    m_spendPublicKeys.insert(keys.publicKey);
+  }
+}
+
+std::error_code ParallelRescan::scan(uint32_t startHeight, uint32_t endHeight, size_t workerCount,
+  const ProgressCallback& progress, RescanPlan& plan) {
+  if (startHeight >= endHeight) {
+    return std::make_error_code(std::errc::invalid_argument);
+  }
+
+  CheckpointHeader header = { CHECKPOINT_VERSION, startHeight, endHeight, m_segmentSize, keysHash() };
+  std::vector<Segment> segments = loadCheckpoint(header);
+
+  std::unordered_set<uint32_t> finished;
+  uint32_t total = endHeight - startHeight;
+  std::atomic<uint32_t> scannedBlocks(0);
+  for (const auto& segment : segments) {
+    finished.insert(segment.startHeight);
+    scannedBlocks += static_cast<uint32_t>(segment.blockHashes.size());
+  }
+
+  std::vector<Segment> pending;
+  for (uint32_t height = startHeight; height < endHeight; height += std::min(m_segmentSize, endHeight - height)) {
+    if (finished.count(height) == 0) {
+      Segment segment;
+      segment.startHeight = height;
+      pending.push_back(std::move(segment));
+    }
+  }
+
+  if (workerCount == 0) {
+    workerCount = std::min<size_t>(std::max<unsigned>(std::thread::hardware_concurrency(), 1), MAX_WORKER_COUNT);
+  }
+  workerCount = std::min(workerCount, pending.size());
+
+  std::atomic<size_t> nextSegment(0);
+  std::atomic<bool> stopped(false);
+  std::mutex mutex;
+  std::condition_variable workerFinished;
+  size_t runningWorkers = workerCount;
+  std::error_code error;
+
+  auto worker = [&]() {
+    try {
+      for (size_t i = nextSegment++; i < pending.size() && !stopped; i = nextSegment++) {
+        Segment& segment = pending[i];
+        uint32_t segmentEnd = segment.startHeight + std::min(m_segmentSize, endHeight - segment.startHeight);
+        std::error_code ec = scanSegment(segment, segmentEnd, stopped, scannedBlocks);
+
+        std::lock_guard<std::mutex> lk(mutex);
+        if (ec) {
+          if (!error) {
+            error = ec;
+          }
+          stopped = true;
+          break;
+        }
+
+        try {
+          appendCheckpoint(segment);
+        } catch (std::exception&) {
+          // the scan is still good, only a later resume has more to do
+        }
+      }
+    } catch (std::exception&) {
+      std::lock_guard<std::mutex> lk(mutex);
+      if (!error) {
+        error = std::make_error_code(std::errc::operation_canceled);
+      }
+      stopped = true;
+    }
+
+    std::lock_guard<std::mutex> lk(mutex);
+    --runningWorkers;
+    workerFinished.notify_all();
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(workerCount);
+  for (size_t i = 0; i < workerCount; ++i) {
+    workers.emplace_back(worker);
+  }
+
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    while (runningWorkers > 0) {
+      workerFinished.wait_for(lk, std::chrono::milliseconds(250));
+      uint32_t scanned = scannedBlocks;
+      lk.unlock();
+      bool proceed = !progress || progress(scanned, total);
+      lk.lock();
+      if (!proceed && !stopped) {
+        if (!error) {
+          error = std::make_error_code(std::errc::interrupted);
+        }
+        stopped = true;
+      }
+    }
+  }
+
+  for (auto& thread : workers) {
+    thread.join();
+  }
+
+  if (error) {
+    return error;
+  }
+
+  if (progress) {
+    progress(total, total);
+  }
+
+  std::move(pending.begin(), pending.end(), std::back_inserter(segments));
+  std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) { return a.startHeight < b.startHeight; });
+
+  std::unordered_set<uint64_t> ownKeyImages;
+  for (const auto& segment : segments) {
+    for (const auto& keyImage : segment.keyImages) {
+      ownKeyImages.insert(keyImageFingerprint(keyImage));
+    }
+  }
+
+  plan.startHeight = startHeight;
+  plan.blockHashes.clear();
+  plan.blockHashes.reserve(total);
+  plan.relevantHeights.clear();
+  for (const auto& segment : segments) {
+    plan.blockHashes.insert(plan.blockHashes.end(), segment.blockHashes.begin(), segment.blockHashes.end());
+    plan.relevantHeights.insert(plan.relevantHeights.end(), segment.relevantHeights.begin(), segment.relevantHeights.end());
+    for (size_t i = 0; i < segment.inputFingerprints.size(); ++i) {
+      if (ownKeyImages.count(segment.inputFingerprints[i]) != 0) {
+        plan.relevantHeights.push_back(segment.inputHeights[i]);
+      }
+    }
+  }
+
+  std::sort(plan.relevantHeights.begin(), plan.relevantHeights.end());
+  plan.relevantHeights.erase(std::unique(plan.relevantHeights.begin(), plan.relevantHeights.end()), plan.relevantHeights.end());
+  return std::error_code();
+}
+
+std::error_code ParallelRescan::scanSegment(Segment& segment, uint32_t endHeight, const std::atomic<bool>& stopped,
+  std::atomic<uint32_t>& scannedBlocks) const {
+  segment.blockHashes.reserve(endHeight - segment.startHeight);
+
+  for (uint32_t height = segment.startHeight; height < endHeight;) {
+    if (stopped) {
+      return std::make_error_code(std::errc::interrupted);
+    }
+
+    std::vector<Crypto::Hash> blockHashes;
+    std::vector<CompactTransactionInfo> transactions;
+    auto queryCompleted = std::promise<std::error_code>();
+    auto queryWaitFuture = queryCompleted.get_future();
+
+    m_node.queryCompactOutputs(height, std::min(QUERY_BLOCK_COUNT, endHeight - height), blockHashes, transactions,
+      [&queryCompleted](std::error_code ec) {
+        auto detachedPromise = std::move(queryCompleted);
+        detachedPromise.set_value(ec);
+      });
+
+    std::error_code ec = queryWaitFuture.get();
+    if (ec) {
+      return ec;
+    }
+
+    if (blockHashes.empty()) {
+      // the node is not as far as the range to scan
+      return std::make_error_code(std::errc::result_out_of_range);
+    }
+
+    uint32_t count = std::min(static_cast<uint32_t>(blockHashes.size()), endHeight - height);
+    segment.blockHashes.insert(segment.blockHashes.end(), blockHashes.begin(), blockHashes.begin() + count);
+    for (const auto& tx : transactions) {
+      if (tx.blockHeight >= height && tx.blockHeight < height + count) {
+        scanTransaction(tx, segment);
+      }
+    }
+
+    height += count;
+    scannedBlocks += count;
+  }
+
+  return std::error_code();
+}
+
+void ParallelRescan::scanTransaction(const CompactTransactionInfo& tx, Segment& segment) const {
+  bool relevant = tx.hasMultisignature;
+
+  std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>> outputs;
+  Crypto::KeyDerivation derivation;
+  if (m_scanner.findMyOutputs(tx, outputs) && !outputs.empty() &&
+      Crypto::generate_key_derivation(tx.txPublicKey, m_viewSecretKey, derivation)) {
+    relevant = true;
+
+    for (const auto& kv : outputs) {
+      const Crypto::SecretKey& spendSecretKey = m_spendSecretKeys.at(kv.first);
+      if (spendSecretKey == NULL_SECRET_KEY) {
+        continue;
+      }
+
+      for (uint32_t index : kv.second) {
+        Crypto::SecretKey ephemeralSecretKey;
+        Crypto::KeyImage keyImage;
+        Crypto::derive_secret_key(derivation, index, spendSecretKey, ephemeralSecretKey);
+        Crypto::generate_key_image(tx.outputKeys[index], ephemeralSecretKey, keyImage);
+        segment.keyImages.push_back(keyImage);
+      }
+    }
+  }
+
+  if (relevant) {
+    segment.relevantHeights.push_back(tx.blockHeight);
+  }
+
+  for (const auto& keyImage : tx.keyImages) {
+    segment.inputFingerprints.push_back(keyImageFingerprint(keyImage));
+    segment.inputHeights.push_back(tx.blockHeight);
+  }
+}
+
+Crypto::Hash ParallelRescan::keysHash() const {
+  std::vector<Crypto::PublicKey> keys(m_spendPublicKeys.begin(), m_spendPublicKeys.end());
+  std::sort(keys.begin(), keys.end(), [](const Crypto::PublicKey& a, const Crypto::PublicKey& b) {
+    return std::memcmp(&a, &b, sizeof(a)) < 0;
+  });
+
+  return Crypto::cn_fast_hash(keys.data(), keys.size() * sizeof(Crypto::PublicKey));
+}
+
+std::vector<ParallelRescan::Segment> ParallelRescan::loadCheckpoint(CheckpointHeader& header) {
+  CheckpointHeader stored;
+  std::vector<Segment> storedSegments;
+  std::vector<Segment> segments;
+
+  if (readCheckpoint(m_checkpointPath, stored, &storedSegments) && stored.version == header.version &&
+      stored.startHeight == header.startHeight && stored.endHeight == header.endHeight &&
+      stored.segmentSize == header.segmentSize && stored.keysHash == header.keysHash) {
+    std::unordered_set<uint32_t> seen;
+    for (auto& segment : storedSegments) {
+      uint32_t offset = segment.startHeight - header.startHeight;
+      bool valid = segment.startHeight >= header.startHeight && segment.startHeight < header.endHeight &&
+        offset % header.segmentSize == 0 &&
+        segment.blockHashes.size() == std::min(header.segmentSize, header.endHeight - segment.startHeight) &&
+        segment.inputFingerprints.size() == segment.inputHeights.size();
+      if (valid && seen.insert(segment.startHeight).second) {
+        segments.push_back(std::move(segment));
+      }
+    }
+  }
+
+  // rewritten so that new segments are not appended after a record cut short
+  startCheckpoint(header);
+  for (auto& segment : segments) {
+    appendCheckpoint(segment);
+  }
+
+  return segments;
+}
+
+void ParallelRescan::startCheckpoint(CheckpointHeader& header) {
+  std::ofstream out(m_checkpointPath, std::ios::binary | std::ios::trunc);
+  writeRecord(out, header);
+}
+
+void ParallelRescan::appendCheckpoint(Segment& segment) {
+  std::ofstream out(m_checkpointPath, std::ios::binary | std::ios::app);
+  writeRecord(out, segment);
+}
+
+bool ParallelRescan::readCheckpoint(const std::string& checkpointPath, CheckpointHeader& header, std::vector<Segment>* segments) {
+  std::ifstream in(checkpointPath, std::ios::binary);
+  if (!in || !readRecord(in, header) || header.version != CHECKPOINT_VERSION) {
+    return false;
+  }
+
+  if (segments != nullptr) {
+    Segment segment;
+    while (readRecord(in, segment)) {
+      segments->push_back(std::move(segment));
+      segment = Segment();
+    }
+  }
+
+  return true;
+}
+
+bool ParallelRescan::readCheckpointRange(const std::string& checkpointPath, uint32_t& startHeight, uint32_t& endHeight) {
+  CheckpointHeader header;
+  if (!readCheckpoint(checkpointPath, header, nullptr)) {
+    return false;
+  }
+
+  startHeight = header.startHeight;
+  endHeight = header.endHeight;
+  return true;
+}
+
+void ParallelRescan::removeCheckpoint(const std::string& checkpointPath) {
+  std::remove(checkpointPath.c_str());
+}
+
+}
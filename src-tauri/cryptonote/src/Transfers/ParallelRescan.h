@@ -0,0 +1,116 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+#include "BlockchainSynchronizer.h"
+#include "CompactOutputScanner.h"
+
+namespace CryptoNote {
+
+class INode;
+class ISerializer;
+
+// Finds the blocks that carry transactions of one wallet by scanning a height range of the compact output
+// stream in segments on several threads at once. The resulting RescanPlan lets the BlockchainSynchronizer
+// fetch only those blocks in full and feed the rest to the wallet's consumer as hashes.
+//
+// Finished segments are appended to a checkpoint file, so a scan that was interrupted resumes with the
+// segments still missing.
+class ParallelRescan {
+public:
+  struct SpendKeys {
+    Crypto::PublicKey publicKey;
+    Crypto::SecretKey secretKey;  // NULL_SECRET_KEY for tracking addresses, whose spends cannot be detected
+  };
+
+  // Called on the thread running scan() with the blocks scanned so far and the total; returning false
+  // stops the scan. Segments finished before the stop stay in the checkpoint.
+  typedef std::function<bool(uint32_t scannedBlocks, uint32_t totalBlocks)> ProgressCallback;
+
+  static const uint32_t DEFAULT_SEGMENT_SIZE = 10000;
+
+  ParallelRescan(INode& node, const Crypto::SecretKey& viewSecretKey, const std::vector<SpendKeys>& spendKeys,
+    const std::string& checkpointPath, uint32_t segmentSize = DEFAULT_SEGMENT_SIZE);
+
+  // Scans blocks [startHeight, endHeight) on workerCount threads (0 picks one per core, at most 8) and fills
+  // plan. A checkpoint left by an earlier scan of the same range and keys is reused, any other is replaced.
+  std::error_code scan(uint32_t startHeight, uint32_t endHeight, size_t workerCount, const ProgressCallback& progress,
+    RescanPlan& plan);
+
+  // range of the scan recorded in a checkpoint; false if there is no usable checkpoint
+  static bool readCheckpointRange(const std::string& checkpointPath, uint32_t& startHeight, uint32_t& endHeight);
+  static void removeCheckpoint(const std::string& checkpointPath);
+
+private:
+  struct Segment {
+    uint32_t startHeight;
+    std::vector<Crypto::Hash> blockHashes;
+    // heights of transactions paying us or carrying multisignature data
+    std::vector<uint32_t> relevantHeights;
+    std::vector<Crypto::KeyImage> keyImages;
+    // inputs of every transaction in the segment, spends of our outputs are matched after the scan
+    std::vector<uint64_t> inputFingerprints;
+    std::vector<uint32_t> inputHeights;
+
+    void serialize(ISerializer& s);
+  };
+
+  struct CheckpointHeader {
+    uint32_t version;
+    uint32_t startHeight;
+    uint32_t endHeight;
+    uint32_t segmentSize;
+    Crypto::Hash keysHash;
+
+    void serialize(ISerializer& s);
+  };
+
+  std::error_code scanSegment(Segment& segment, uint32_t endHeight, const std::atomic<bool>& stopped,
+    std::atomic<uint32_t>& scannedBlocks) const;
+  void scanTransaction(const CompactTransactionInfo& tx, Segment& segment) const;
+
+  Crypto::Hash keysHash() const;
+  // segments of a checkpoint written for header; any other checkpoint is replaced by an empty one
+  std::vector<Segment> loadCheckpoint(CheckpointHeader& header);
+  void startCheckpoint(CheckpointHeader& header);
+  void appendCheckpoint(Segment& segment);
+
+  static bool readCheckpoint(const std::string& checkpointPath, CheckpointHeader& header, std::vector<Segment>* segments);
+
+  INode& m_node;
+  const Crypto::SecretKey m_viewSecretKey;
+  std::unordered_map<Crypto::PublicKey, Crypto::SecretKey> m_spendSecretKeys;
+  std::unordered_set<Crypto::PublicKey> m_spendPublicKeys;
+  // borrows m_spendPublicKeys
+  CompactOutputScanner m_scanner;
+  const std::string m_checkpointPath;
+  const uint32_t m_segmentSize;
+};
+
+}
@@ -0,0 +1,238 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "TransfersBalance.h"
+
+#include <algorithm>
+#include <cassert>
+#include <ctime>
+
+#include "IWalletLegacy.h"
+#include "TransfersContainer.h"
+
+namespace CryptoNote {
+
+namespace {
+
+const uint32_t TYPE_FLAGS[] = {
+  ITransfersContainer::IncludeTypeKey,
+  ITransfersContainer::IncludeTypeMultisignature,
+  ITransfersContainer::IncludeTypeDeposit
+};
+
+bool getTypeIndex(const TransactionOutputInformationEx& transfer, size_t& type) {
+  if (transfer.type == TransactionTypes::OutputType::Key) {
+    type = 0;
+  } else if (transfer.type == TransactionTypes::OutputType::Multisignature) {
+    type = transfer.term == 0 ? 1 : 2;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+}
+
+TransfersBalance::TransfersBalance(const Currency& currency, size_t transactionSpendableAge) :
+  m_currency(currency),
+  m_transactionSpendableAge(transactionSpendableAge) {
+  clear(0);
+}
+
+void TransfersBalance::clear(uint32_t currentHeight) {
+  m_currentHeight = currentHeight;
+  m_total.fill(0);
+  m_locked.fill(0);
+  m_unlocked.fill(0);
+  m_unconfirmed.fill(0);
+  m_spendUnlockEvents.clear();
+  m_unlockEvents.clear();
+  m_timeLocked.clear();
+}
+
+void TransfersBalance::add(const TransactionOutputInformationEx& transfer) {
+  update(transfer, true);
+}
+
+void TransfersBalance::remove(const TransactionOutputInformationEx& transfer) {
+  update(transfer, false);
+}
+
+void TransfersBalance::update(const TransactionOutputInformationEx& transfer, bool add) {
+  size_t type;
+  if (!transfer.visible || !getTypeIndex(transfer, type)) {
+    return;
+  }
+
+  uint64_t amount = transfer.amount;
+  auto apply = [add, amount](uint64_t& counter) {
+    if (add) {
+      counter += amount;
+    } else {
+      assert(counter >= amount);
+      counter -= amount;
+    }
+  };
+
+  if (transfer.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+    apply(m_unconfirmed[type]);
+    return;
+  }
+
+  // Same thresholds as TransfersContainer::isIncluded()
+  uint64_t softUnlockHeight = static_cast<uint64_t>(transfer.blockHeight) + m_transactionSpendableAge;
+
+  if (transfer.unlockTime >= m_currency.maxBlockHeight()) {
+    if (add) {
+      m_timeLocked.push_back(TimeLockedTransfer{transfer.unlockTime, softUnlockHeight, amount, type});
+    } else {
+      auto it = std::find_if(m_timeLocked.begin(), m_timeLocked.end(), [&](const TimeLockedTransfer& t) {
+        return t.unlockTime == transfer.unlockTime && t.softUnlockHeight == softUnlockHeight && t.amount == amount && t.type == type;
+      });
+
+      assert(it != m_timeLocked.end());
+      if (it != m_timeLocked.end()) {
+        *it = m_timeLocked.back();
+        m_timeLocked.pop_back();
+      }
+    }
+
+    return;
+  }
+
+  uint64_t delta = m_currency.lockedTxAllowedDeltaBlocks();
+  uint64_t spendUnlockHeight = transfer.unlockTime > delta ? transfer.unlockTime - delta : 0;
+  if (transfer.type == TransactionTypes::OutputType::Multisignature && transfer.term != 0) {
+    spendUnlockHeight = std::max(spendUnlockHeight, static_cast<uint64_t>(transfer.blockHeight) + transfer.term - 1);
+  }
+
+  uint64_t unlockHeight = std::max(spendUnlockHeight, softUnlockHeight);
+
+  apply(m_total[type]);
+  if (m_currentHeight < spendUnlockHeight) {
+    apply(m_locked[type]);
+  }
+
+  if (m_currentHeight >= unlockHeight) {
+    apply(m_unlocked[type]);
+  }
+
+  addEvent(m_spendUnlockEvents, spendUnlockHeight, type, amount, add);
+  addEvent(m_unlockEvents, unlockHeight, type, amount, add);
+}
+
+void TransfersBalance::addEvent(std::map<uint64_t, Amounts>& events, uint64_t height, size_t type, uint64_t amount, bool add) {
+  if (add) {
+    auto it = events.emplace(height, Amounts{}).first;
+    it->second[type] += amount;
+    return;
+  }
+
+  auto it = events.find(height);
+  assert(it != events.end() && it->second[type] >= amount);
+  if (it == events.end()) {
+    return;
+  }
+
+  it->second[type] -= amount;
+  if (it->second[0] == 0 && it->second[1] == 0 && it->second[2] == 0) {
+    events.erase(it);
+  }
+}
+
+void TransfersBalance::setHeight(uint32_t currentHeight) {
+  uint64_t newHeight = currentHeight;
+  if (newHeight == m_currentHeight) {
+    return;
+  }
+
+  // Events in (lower, upper] change state on the way between the two heights
+  bool advance = newHeight > m_currentHeight;
+  uint64_t lower = advance ? m_currentHeight : newHeight;
+  uint64_t upper = advance ? newHeight : m_currentHeight;
+
+  for (auto it = m_spendUnlockEvents.upper_bound(lower); it != m_spendUnlockEvents.end() && it->first <= upper; ++it) {
+    for (size_t type = 0; type < TYPE_COUNT; ++type) {
+      if (advance) {
+        m_locked[type] -= it->second[type];
+      } else {
+        m_locked[type] += it->second[type];
+      }
+    }
+  }
+
+  for (auto it = m_unlockEvents.upper_bound(lower); it != m_unlockEvents.end() && it->first <= upper; ++it) {
+    for (size_t type = 0; type < TYPE_COUNT; ++type) {
+      if (advance) {
+        m_unlocked[type] += it->second[type];
+      } else {
+        m_unlocked[type] -= it->second[type];
+      }
+    }
+  }
+
+  m_currentHeight = newHeight;
+}
+
+uint64_t TransfersBalance::balance(uint32_t flags) const {
+  uint64_t amount = 0;
+
+  for (size_t type = 0; type < TYPE_COUNT; ++type) {
+    if ((flags & TYPE_FLAGS[type]) == 0) {
+      continue;
+    }
+
+    uint64_t locked = m_locked[type];
+    uint64_t unlocked = m_unlocked[type];
+    uint64_t softLocked = m_total[type] - locked - unlocked;
+
+    if ((flags & ITransfersContainer::IncludeStateLocked) != 0) {
+      amount += locked + m_unconfirmed[type];
+    }
+
+    if ((flags & ITransfersContainer::IncludeStateSoftLocked) != 0) {
+      amount += softLocked;
+    }
+
+    if ((flags & ITransfersContainer::IncludeStateUnlocked) != 0) {
+      amount += unlocked;
+    }
+  }
+
+  if (!m_timeLocked.empty()) {
+    uint64_t currentTime = static_cast<uint64_t>(time(NULL));
+    for (const auto& transfer : m_timeLocked) {
+      uint32_t state;
+      if (currentTime + m_currency.lockedTxAllowedDeltaSeconds_v2() < transfer.unlockTime) {
+        state = ITransfersContainer::IncludeStateLocked;
+      } else if (m_currentHeight < transfer.softUnlockHeight) {
+        state = ITransfersContainer::IncludeStateSoftLocked;
+      } else {
+        state = ITransfersContainer::IncludeStateUnlocked;
+      }
+
+      if ((flags & TYPE_FLAGS[transfer.type]) != 0 && (flags & state) != 0) {
+        amount += transfer.amount;
+      }
+    }
+  }
+
+  return amount;
+}
+
+}
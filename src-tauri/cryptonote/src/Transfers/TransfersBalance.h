@@ -0,0 +1,75 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace CryptoNote {
+
+class Currency;
+struct TransactionOutputInformationEx;
+
+// Running totals of the visible available and unconfirmed transfers of a
+// TransfersContainer, grouped by output type and lock state. Height based
+// locks are tracked by the height at which they expire, so moving the
+// height only touches transfers whose state actually changes.
+class TransfersBalance {
+public:
+  TransfersBalance(const Currency& currency, size_t transactionSpendableAge);
+
+  void clear(uint32_t currentHeight);
+  // Invisible transfers are ignored, so toggle visibility between remove() and add()
+  void add(const TransactionOutputInformationEx& transfer);
+  void remove(const TransactionOutputInformationEx& transfer);
+  void setHeight(uint32_t currentHeight);
+
+  uint64_t balance(uint32_t flags) const;
+
+private:
+  enum { TYPE_COUNT = 3 };
+  typedef std::array<uint64_t, TYPE_COUNT> Amounts;
+
+  // A transfer locked until a timestamp rather than a height
+  struct TimeLockedTransfer {
+    uint64_t unlockTime;
+    uint64_t softUnlockHeight;
+    uint64_t amount;
+    size_t type;
+  };
+
+  void update(const TransactionOutputInformationEx& transfer, bool add);
+  static void addEvent(std::map<uint64_t, Amounts>& events, uint64_t height, size_t type, uint64_t amount, bool add);
+
+  const Currency& m_currency;
+  size_t m_transactionSpendableAge;
+  uint64_t m_currentHeight;
+
+  Amounts m_total;
+  Amounts m_locked;
+  Amounts m_unlocked;
+  Amounts m_unconfirmed;
+  // height at which transfers stop being locked / stop being soft locked
+  std::map<uint64_t, Amounts> m_spendUnlockEvents;
+  std::map<uint64_t, Amounts> m_unlockEvents;
+  std::vector<TimeLockedTransfer> m_timeLocked;
+};
+
+}
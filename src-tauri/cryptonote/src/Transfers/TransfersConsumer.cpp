@@ -19,11 +19,12 @@
 #include "TransfersConsumer.h"
 
 #include <numeric>
+#include <exception>
 #include <future>
+#include <iterator>
 
 #include "CommonTypes.h"
 #include "Common/StringTools.h"
-#include "Common/BlockingQueue.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/TransactionApi.h"
 #include "CryptoNoteCore/TransactionExtra.h"
@@ -61,22 +62,30 @@ void checkOutputKey(
 
 }
 
-void findMyOutputs(
+// Scans every output of the transaction against all subscriptions of this view key in
+// one pass: the key derivation is computed once and each underived spend key is a
+// single hash-set probe, so the cost per output does not grow with subscription count.
+// When the sender tagged the outputs, a key output whose view tag doesn't match is
+// rejected with one fast hash before any curve arithmetic.
+bool findMyOutputs(
   const ITransactionReader& tx,
   const SecretKey& viewSecretKey,
   const std::unordered_set<PublicKey>& spendKeys,
+  KeyDerivation& derivation,
   std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs) {
 
   auto txPublicKey = tx.getTransactionPublicKey();
-  KeyDerivation derivation;
 
   if (!generate_key_derivation( txPublicKey, viewSecretKey, derivation)) {
-    return;
+    return false;
   }
 
   size_t keyIndex = 0;
   size_t outputCount = tx.getOutputCount();
 
+  std::vector<uint8_t> viewTags;
+  bool tagged = tx.getViewTags(viewTags) && viewTags.size() == outputCount;
+
   for (size_t idx = 0; idx < outputCount; ++idx) {
 
     auto outType = tx.getOutputType(size_t(idx));
@@ -86,7 +95,9 @@ void findMyOutputs(
       uint64_t amount;
       KeyOutput out;
       tx.getOutput(idx, out, amount);
-      checkOutputKey(derivation, out.key, keyIndex, idx, spendKeys, outputs);
+      if (!tagged || viewTags[idx] == deriveViewTag(derivation, keyIndex)) {
+        checkOutputKey(derivation, out.key, keyIndex, idx, spendKeys, outputs);
+      }
       ++keyIndex;
 
     } else if (outType == TransactionTypes::OutputType::Multisignature) {
@@ -100,6 +111,8 @@ void findMyOutputs(
      }
     }
   }
+
+  return true;
 }
 
 std::vector<Crypto::Hash> getBlockHashes(const CryptoNote::CompleteBlock* blocks, size_t count) {
@@ -117,8 +130,8 @@ std::vector<Crypto::Hash> getBlockHashes(const CryptoNote::CompleteBlock* blocks
 
 namespace CryptoNote {
 
-TransfersConsumer::TransfersConsumer(const CryptoNote::Currency& currency, INode& node, Logging::ILogger& logger, const SecretKey& viewSecret) :
-  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_logger(logger, "TransfersConsumer") {
+TransfersConsumer::TransfersConsumer(const CryptoNote::Currency& currency, INode& node, Logging::ILogger& logger, const SecretKey& viewSecret, Common::ThreadPool& workerPool) :
+  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_logger(logger, "TransfersConsumer"), m_workerPool(workerPool) {
   updateSyncStart();
 }
 
@@ -127,45 +140,166 @@ ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscrip
     throw std::runtime_error("TransfersConsumer: view secret key mismatch");
   }
 
-  auto& res = m_subscriptions[subscription.keys.address.spendPublicKey];
+  const auto& spendPublicKey = subscription.keys.address.spendPublicKey;
+  TransfersSubscription* result;
+  bool added = false;
+  {
+    auto& shard = getShard(spendPublicKey);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& res = shard.subscriptions[spendPublicKey];
+
+    if (res.get() == nullptr) {
+      res.reset(new TransfersSubscription(m_currency, subscription));
+      m_spendKeys.insert(spendPublicKey);
+      added = true;
+    }
+
+    result = res.get();
+  }
 
-  if (res.get() == nullptr) {
-    res.reset(new TransfersSubscription(m_currency, subscription));
-    m_spendKeys.insert(subscription.keys.address.spendPublicKey);
+  // updateSyncStart() visits every shard, so it must run after the shard lock is released
+  if (added) {
     updateSyncStart();
   }
 
-  return *res;
+  return *result;
 }
 
 bool TransfersConsumer::removeSubscription(const AccountPublicAddress& address) {
-  m_subscriptions.erase(address.spendPublicKey);
+  {
+    auto& shard = getShard(address.spendPublicKey);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.subscriptions.erase(address.spendPublicKey);
+  }
+
   m_spendKeys.erase(address.spendPublicKey);
   updateSyncStart();
-  return m_subscriptions.empty();
+  return m_spendKeys.empty();
 }
 
 ITransfersSubscription* TransfersConsumer::getSubscription(const AccountPublicAddress& acc) {
-  auto it = m_subscriptions.find(acc.spendPublicKey);
-  return it == m_subscriptions.end() ? nullptr : it->second.get();
+  auto& shard = getShard(acc.spendPublicKey);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.subscriptions.find(acc.spendPublicKey);
+  return it == shard.subscriptions.end() ? nullptr : it->second.get();
 }
 
-void TransfersConsumer::getSubscriptions(std::vector<AccountPublicAddress>& subscriptions) {
-  for (const auto& kv : m_subscriptions) {
-    subscriptions.push_back(kv.second->getAddress());
+std::unique_ptr<TransfersSubscription> TransfersConsumer::releaseSubscription(const AccountPublicAddress& address) {
+  std::unique_ptr<TransfersSubscription> subscription;
+  {
+    auto& shard = getShard(address.spendPublicKey);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.subscriptions.find(address.spendPublicKey);
+    if (it == shard.subscriptions.end()) {
+      return subscription;
+    }
+
+    subscription = std::move(it->second);
+    shard.subscriptions.erase(it);
+  }
+
+  m_spendKeys.erase(address.spendPublicKey);
+  updateSyncStart();
+  return subscription;
+}
+
+void TransfersConsumer::adoptSubscription(std::unique_ptr<TransfersSubscription> subscription) {
+  assert(subscription);
+  auto spendPublicKey = subscription->getAddress().spendPublicKey;
+  {
+    auto& shard = getShard(spendPublicKey);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& res = shard.subscriptions[spendPublicKey];
+    if (res.get() != nullptr) {
+      throw std::runtime_error("TransfersConsumer: subscription already exists");
+    }
+
+    res = std::move(subscription);
   }
+
+  m_spendKeys.insert(spendPublicKey);
+  updateSyncStart();
+}
+
+void TransfersConsumer::getSubscriptions(std::vector<AccountPublicAddress>& subscriptions) {
+  forEachSubscription([&subscriptions](TransfersSubscription& sub) {
+    subscriptions.push_back(sub.getAddress());
+  });
 }
 
 void TransfersConsumer::initTransactionPool(const std::unordered_set<Crypto::Hash>& uncommitedTransactions) {
-  for (auto itSubscriptions = m_subscriptions.begin(); itSubscriptions != m_subscriptions.end(); ++itSubscriptions) {
+  forEachSubscription([&](TransfersSubscription& sub) {
     std::vector<Crypto::Hash> unconfirmedTransactions;
-    itSubscriptions->second->getContainer().getUnconfirmedTransactions(unconfirmedTransactions);
+    sub.getContainer().getUnconfirmedTransactions(unconfirmedTransactions);
 
     for (auto itTransactions = unconfirmedTransactions.begin(); itTransactions != unconfirmedTransactions.end(); ++itTransactions) {
       if (uncommitedTransactions.count(*itTransactions) == 0) {
         m_poolTxs.emplace(*itTransactions);
       }
     }
+  });
+}
+
+TransfersConsumer::SubscriptionShard& TransfersConsumer::getShard(const Crypto::PublicKey& spendPublicKey) {
+  return m_shards[std::hash<Crypto::PublicKey>()(spendPublicKey) % m_shards.size()];
+}
+
+template <typename F>
+void TransfersConsumer::forEachShardInParallel(F action) {
+  std::vector<size_t> busyShards;
+  for (size_t i = 0; i < m_shards.size(); ++i) {
+    std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+    if (!m_shards[i].subscriptions.empty()) {
+      busyShards.push_back(i);
+    }
+  }
+
+  auto runShard = [this, &action](size_t index) {
+    auto& shard = m_shards[index];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    action(index, shard);
+  };
+
+  if (busyShards.size() <= 1) {
+    for (size_t index : busyShards) {
+      runShard(index);
+    }
+
+    return;
+  }
+
+  std::exception_ptr error;
+  std::vector<std::future<void>> tasks;
+  tasks.reserve(busyShards.size());
+  for (size_t index : busyShards) {
+    try {
+      tasks.push_back(m_workerPool.submit([&runShard, index] { runShard(index); }));
+      continue;
+    } catch (const std::exception&) {
+      // the pool is stopping, finish the shard on this thread
+    }
+
+    try {
+      runShard(index);
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+
+  for (auto& task : tasks) {
+    try {
+      task.get();
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
   }
 }
 
@@ -175,11 +309,11 @@ void TransfersConsumer::updateSyncStart() {
   start.height =   std::numeric_limits<uint64_t>::max();
   start.timestamp = std::numeric_limits<uint64_t>::max();
 
-  for (const auto& kv : m_subscriptions) {
-    auto subStart = kv.second->getSyncStart();
+  forEachSubscription([&start](TransfersSubscription& sub) {
+    auto subStart = sub.getSyncStart();
     start.height = std::min(start.height, subStart.height);
     start.timestamp = std::min(start.timestamp, subStart.timestamp);
-  }
+  });
 
   m_syncStart = start;
 }
@@ -191,9 +325,9 @@ SynchronizationStart TransfersConsumer::getSyncStart() {
 void TransfersConsumer::onBlockchainDetach(uint32_t height) {
   m_observerManager.notify(&IBlockchainConsumerObserver::onBlockchainDetach, this, height);
 
-  for (const auto& kv : m_subscriptions) {
-    kv.second->onBlockchainDetach(height);
-  }
+  forEachSubscription([height](TransfersSubscription& sub) {
+    sub.onBlockchainDetach(height);
+  });
 }
 
 bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startHeight, uint32_t count) {
@@ -203,82 +337,91 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
   struct Tx {
     TransactionBlockInfo blockInfo;
     const ITransactionReader* tx;
+    const std::vector<uint32_t>* globalIndexes;
   };
 
   struct PreprocessedTx : Tx, PreprocessInfo {};
 
-  std::vector<PreprocessedTx> preprocessedTransactions;
-  std::mutex preprocessedTransactionsMutex;
-
-  size_t workers = std::thread::hardware_concurrency();
-  if (workers == 0) {
-    workers = 2;
-  }
-
-  BlockingQueue<Tx> inputQueue(workers * 2);
-
-  std::atomic<bool> stopProcessing(false);
+  std::vector<Tx> inputTransactions;
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& block = blocks[i].block;
 
-  auto pushingThread = std::async(std::launch::async, [&] {
-    for( uint32_t i = 0; i < count && !stopProcessing; ++i) {
-      const auto& block = blocks[i].block;
+    if (!block.is_initialized()) {
+      continue;
+    }
 
-      if (!block.is_initialized()) {
-        continue;
-      }
+    // filter by syncStartTimestamp
+    if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
+      continue;
+    }
 
-      // filter by syncStartTimestamp
-      if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
+    TransactionBlockInfo blockInfo;
+    blockInfo.height = startHeight + i;
+    blockInfo.timestamp = block->timestamp;
+    blockInfo.transactionIndex = 0; // position in block
+
+    const auto& globalIndexes = blocks[i].globalIndexes;
+    for (const auto& tx : blocks[i].transactions) {
+      auto pubKey = tx->getTransactionPublicKey();
+      if (pubKey == NULL_PUBLIC_KEY) {
+        ++blockInfo.transactionIndex;
         continue;
       }
 
-      TransactionBlockInfo blockInfo;
-      blockInfo.height = startHeight + i;
-      blockInfo.timestamp = block->timestamp;
-      blockInfo.transactionIndex = 0; // position in block
-
-      for (const auto& tx : blocks[i].transactions) {
-        auto pubKey = tx->getTransactionPublicKey();
-        if (pubKey == NULL_PUBLIC_KEY) {
-          ++blockInfo.transactionIndex;
-          continue;
-        }
-
-        Tx item = { blockInfo, tx.get() };
-        inputQueue.push(item);
-        ++blockInfo.transactionIndex;
-      }
+      const std::vector<uint32_t>* txGlobalIndexes = blockInfo.transactionIndex < globalIndexes.size() ? &globalIndexes[blockInfo.transactionIndex] : nullptr;
+      Tx item = { blockInfo, tx.get(), txGlobalIndexes };
+      inputTransactions.push_back(item);
+      ++blockInfo.transactionIndex;
     }
+  }
 
-    inputQueue.close();
-  });
+  std::atomic<bool> stopProcessing(false);
 
-  auto processingFunction = [&] {
-    Tx item;
+  // split the batch into a few chunks per worker so that uneven transactions still balance out
+  const size_t chunkCount = std::max<size_t>(1, std::min(inputTransactions.size(), m_workerPool.workerCount() * 4));
+  const size_t chunkSize = (inputTransactions.size() + chunkCount - 1) / chunkCount;
+
+  auto processingFunction = [&](size_t begin, size_t end, std::vector<PreprocessedTx>& output) {
     std::error_code ec;
-    while (!stopProcessing && inputQueue.pop(item)) {
-      PreprocessedTx output;
-      static_cast<Tx&>(output) = item;
+    for (size_t i = begin; i < end && !stopProcessing; ++i) {
+      PreprocessedTx item;
+      static_cast<Tx&>(item) = inputTransactions[i];
+      if (item.globalIndexes != nullptr) {
+        item.globalIdxs = *item.globalIndexes;
+      }
 
-      ec = preprocessOutputs(item.blockInfo, *item.tx, output);
+      ec = preprocessOutputs(item.blockInfo, *item.tx, item);
       if (ec) {
         stopProcessing = true;
         break;
       }
 
-      std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
-      preprocessedTransactions.push_back(std::move(output));
+      output.push_back(std::move(item));
     }
     return ec;
   };
 
-  std::vector<std::future<std::error_code>> processingThreads;
-  for (size_t i = 0; i < workers; ++i) {
-    processingThreads.push_back(std::async(std::launch::async, processingFunction));
-  }
+  std::vector<std::vector<PreprocessedTx>> chunkResults(chunkCount);
+  std::vector<std::future<std::error_code>> processingTasks;
+  processingTasks.reserve(chunkCount);
 
   std::error_code processingError;
-  for (auto& f : processingThreads) {
+  for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+    size_t begin = std::min(chunk * chunkSize, inputTransactions.size());
+    size_t end = std::min(begin + chunkSize, inputTransactions.size());
+    auto& output = chunkResults[chunk];
+    try {
+      processingTasks.push_back(m_workerPool.submit([&processingFunction, begin, end, &output] {
+        return processingFunction(begin, end, output);
+      }));
+    } catch (const std::exception&) {
+      stopProcessing = true;
+      processingError = std::make_error_code(std::errc::operation_canceled);
+      break;
+    }
+  }
+
+  for (auto& f : processingTasks) {
     try {
       std::error_code ec = f.get();
       if (!processingError && ec) {
@@ -291,6 +434,12 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
     }
   }
 
+  std::vector<PreprocessedTx> preprocessedTransactions;
+  preprocessedTransactions.reserve(inputTransactions.size());
+  for (auto& chunk : chunkResults) {
+    std::move(chunk.begin(), chunk.end(), std::back_inserter(preprocessedTransactions));
+  }
+
   std::vector<Crypto::Hash> blockHashes = getBlockHashes(blocks, count);
   if (!processingError) {
     m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
@@ -300,9 +449,14 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
       return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
     });
 
+    std::vector<TransactionToProcess> transactions;
+    transactions.reserve(preprocessedTransactions.size());
     for (const auto& tx : preprocessedTransactions) {
-      processTransaction(tx.blockInfo, *tx.tx, tx);
+      TransactionToProcess item = { &tx.blockInfo, tx.tx, &tx };
+      transactions.push_back(item);
     }
+
+    processTransactions(transactions);
   } else {
     forEachSubscription([&](TransfersSubscription& sub) {
       sub.onError(processingError, startHeight);
@@ -312,8 +466,10 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
   }
 
   auto newHeight = startHeight + count - 1;
-  forEachSubscription([newHeight](TransfersSubscription& sub) {
-    sub.advanceHeight(newHeight);
+  forEachShardInParallel([newHeight](size_t, SubscriptionShard& shard) {
+    for (const auto& kv : shard.subscriptions) {
+      kv.second->advanceHeight(newHeight);
+    }
   });
 
   return true;
@@ -329,9 +485,9 @@ std::error_code TransfersConsumer::onPoolUpdated(const std::vector<std::unique_p
     m_poolTxs.emplace(cryptonoteTransaction->getTransactionHash());
     processingError = processTransaction(unconfirmedBlockInfo, *cryptonoteTransaction.get());
     if (processingError) {
-      for (auto& sub : m_subscriptions) {
-        sub.second->onError(processingError, WALLET_UNCONFIRMED_TRANSACTION_HEIGHT);
-      }
+      forEachSubscription([&](TransfersSubscription& sub) {
+        sub.onError(processingError, WALLET_UNCONFIRMED_TRANSACTION_HEIGHT);
+      });
 
       return processingError;
     }
@@ -341,9 +497,9 @@ std::error_code TransfersConsumer::onPoolUpdated(const std::vector<std::unique_p
     m_poolTxs.erase(deletedTxHash);
 
     m_observerManager.notify(&IBlockchainConsumerObserver::onTransactionDeleteBegin, this, deletedTxHash);
-    for (auto& sub : m_subscriptions) {
-      sub.second->deleteUnconfirmedTransaction(*reinterpret_cast<const Hash*>(&deletedTxHash));
-    }
+    forEachSubscription([&deletedTxHash](TransfersSubscription& sub) {
+      sub.deleteUnconfirmedTransaction(*reinterpret_cast<const Hash*>(&deletedTxHash));
+    });
 
     m_observerManager.notify(&IBlockchainConsumerObserver::onTransactionDeleteEnd, this, deletedTxHash);
   }
@@ -366,9 +522,9 @@ std::error_code TransfersConsumer::addUnconfirmedTransaction(const ITransactionR
 
 void TransfersConsumer::removeUnconfirmedTransaction(const Crypto::Hash& transactionHash) {
   m_observerManager.notify(&IBlockchainConsumerObserver::onTransactionDeleteBegin, this, transactionHash);
-  for (auto& subscription : m_subscriptions) {
-    subscription.second->deleteUnconfirmedTransaction(transactionHash);
-  }
+  forEachSubscription([&transactionHash](TransfersSubscription& sub) {
+    sub.deleteUnconfirmedTransaction(transactionHash);
+  });
   m_observerManager.notify(&IBlockchainConsumerObserver::onTransactionDeleteEnd, this, transactionHash);
 }
 
@@ -382,14 +538,13 @@ std::error_code createTransfers(
   const AccountKeys& account,
   const TransactionBlockInfo& blockInfo,
   const ITransactionReader& tx,
+  const KeyDerivation& derivation,
   const std::vector<uint32_t>& outputs,
   const std::vector<uint32_t>& globalIdxs,
   std::vector<TransactionOutputInformationIn>& transfers) {
 
   auto txPubKey = tx.getTransactionPublicKey();
   auto txHash = tx.getTransactionHash();
-  std::vector<PublicKey> temp_keys;	
-  std::lock_guard<std::mutex> lk(seen_mutex);
 
   if (account.spendSecretKey == NULL_SECRET_KEY)
   {
@@ -402,6 +557,10 @@ std::error_code createTransfers(
     }
   }
 
+  // Key images are derived without holding seen_mutex so workers scanning other
+  // transactions are not serialized behind the scalar multiplications. The output
+  // key already matched the subscription, so only the secret part is derived here.
+  std::vector<MultisignatureOutput> multisigOutputs;
   for (auto idx : outputs) {
 
     if (idx >= tx.getOutputCount()) {
@@ -429,26 +588,9 @@ std::error_code createTransfers(
       KeyOutput out;
       tx.getOutput(idx, out, amount);
 
-      CryptoNote::KeyPair in_ephemeral;
-      CryptoNote::generate_key_image_helper(
-        account,
-        txPubKey,
-        idx,
-        in_ephemeral,
-        info.keyImage);
-
-      assert(out.key == reinterpret_cast<const PublicKey&>(in_ephemeral.publicKey));
-
-      std::unordered_set<Crypto::Hash>::iterator it = transactions_hash_seen.find(tx.getTransactionHash());
-	  if (it == transactions_hash_seen.end()) {
-        std::unordered_set<Crypto::PublicKey>::iterator key_it = public_keys_seen.find(out.key);
-        if (key_it != public_keys_seen.end()) {
-          throw std::runtime_error("duplicate transaction output key is found");
-          return std::error_code();
-        }
-        temp_keys.push_back(out.key);		
-	  }   
-	     
+      SecretKey ephemeralSecretKey;
+      derive_secret_key(derivation, idx, account.spendSecretKey, ephemeralSecretKey);
+      generate_key_image(out.key, ephemeralSecretKey, info.keyImage);
 
       info.amount = amount;
       info.outputKey = out.key;
@@ -457,42 +599,61 @@ std::error_code createTransfers(
       uint64_t amount;
       MultisignatureOutput out;
       tx.getOutput(idx, out, amount);
-	    
-		  for (const auto& key : out.keys) {
-        std::unordered_set<Crypto::Hash>::iterator it = transactions_hash_seen.find(txHash);
-        if (it == transactions_hash_seen.end()) {
-          std::unordered_set<Crypto::PublicKey>::iterator key_it = public_keys_seen.find(key);
-          if (key_it != public_keys_seen.end()) {
-			 // m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": duplicate multisignature output key is found";
-            return std::error_code();
-          }
-          if (std::find(temp_keys.begin(), temp_keys.end(), key) != temp_keys.end()) {
-          //  m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": the same multisignature output key is present more than once";
-            return std::error_code();
-          }
-          temp_keys.push_back(key);
-        }
-      }
+
       info.amount = amount;
       info.requiredSignatures = out.requiredSignatureCount;
       info.term = out.term;
+      multisigOutputs.push_back(std::move(out));
     }
-    
-   transfers.push_back(info);
+
+    transfers.push_back(info);
   }
 
-  transactions_hash_seen.emplace(tx.getTransactionHash());
-  std::copy(temp_keys.begin(), temp_keys.end(), std::inserter(public_keys_seen, public_keys_seen.end()));
+  std::vector<PublicKey> temp_keys;
+  std::lock_guard<std::mutex> lk(seen_mutex);
+  bool txSeen = transactions_hash_seen.find(txHash) != transactions_hash_seen.end();
+
+  size_t multisigIndex = 0;
+  for (size_t i = 0; i < transfers.size(); ++i) {
+    const auto& info = transfers[i];
+
+    if (info.type == TransactionTypes::OutputType::Key) {
+      if (!txSeen) {
+        if (public_keys_seen.find(info.outputKey) != public_keys_seen.end()) {
+          throw std::runtime_error("duplicate transaction output key is found");
+        }
+        temp_keys.push_back(info.outputKey);
+      }
+    } else {
+      const auto& out = multisigOutputs[multisigIndex++];
+      for (const auto& key : out.keys) {
+        if (txSeen) {
+          continue;
+        }
+        if (public_keys_seen.find(key) != public_keys_seen.end() ||
+            std::find(temp_keys.begin(), temp_keys.end(), key) != temp_keys.end()) {
+          // m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": duplicate multisignature output key is found";
+          transfers.resize(i);
+          return std::error_code();
+        }
+        temp_keys.push_back(key);
+      }
+    }
+  }
 
+  transactions_hash_seen.emplace(txHash);
+  std::copy(temp_keys.begin(), temp_keys.end(), std::inserter(public_keys_seen, public_keys_seen.end()));
 
- 
   return std::error_code();
 }
 
 std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info) {
   std::unordered_map<PublicKey, std::vector<uint32_t>> outputs;
+  KeyDerivation derivation;
    try {
-    findMyOutputs(tx, m_viewSecret, m_spendKeys, outputs);
+    if (!findMyOutputs(tx, m_viewSecret, m_spendKeys, derivation, outputs)) {
+      return std::error_code();
+    }
   }
   catch (const std::exception& e) {
     m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction: " << e.what() << ", transaction hash " << Common::podToHex(tx.getTransactionHash());
@@ -505,7 +666,8 @@ std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo&
 
   std::error_code errorCode;
   auto txHash = tx.getTransactionHash();
-  if (blockInfo.height != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT) {
+  // indexes sent inline with the block cover every output; otherwise ask the node for this transaction
+  if (blockInfo.height != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT && info.globalIdxs.size() != tx.getOutputCount()) {
     errorCode = getGlobalIndices(reinterpret_cast<const Hash&>(txHash), info.globalIdxs);
     if (errorCode) {
       return errorCode;
@@ -513,11 +675,23 @@ std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo&
   }
 
   for (const auto& kv : outputs) {
-    auto it = m_subscriptions.find(kv.first);
-    if (it != m_subscriptions.end()) {
+    // the keys are copied out so the shard is not locked while key images are derived
+    AccountKeys keys;
+    {
+      auto& shard = getShard(kv.first);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto it = shard.subscriptions.find(kv.first);
+      if (it == shard.subscriptions.end()) {
+        continue;
+      }
+
+      keys = it->second->getKeys();
+    }
+
+    {
       auto& transfers = info.outputs[kv.first];
        try {
-		  errorCode = createTransfers(it->second->getKeys(), blockInfo, tx, kv.second, info.globalIdxs, transfers);
+		  errorCode = createTransfers(keys, blockInfo, tx, derivation, kv.second, info.globalIdxs, transfers);
 		  if (errorCode) {
 			  return errorCode;
 		  }
@@ -539,29 +713,65 @@ std::error_code TransfersConsumer::processTransaction(const TransactionBlockInfo
     return ec;
   }
 
-  processTransaction(blockInfo, tx, info);
+  TransactionToProcess item = { &blockInfo, &tx, &info };
+  processTransactions(std::vector<TransactionToProcess>{ item });
   return std::error_code();
 }
 
-void TransfersConsumer::processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, const PreprocessInfo& info) {
-  std::vector<TransactionOutputInformationIn> emptyOutputs;
-  std::vector<ITransfersContainer*> transactionContainers;
-  bool someContainerUpdated = false;
-  for (auto& kv : m_subscriptions) {
-    auto it = info.outputs.find(kv.first);
-    auto& subscriptionOutputs = (it == info.outputs.end()) ? emptyOutputs : it->second;
-
-    bool containerContainsTx;
-    bool containerUpdated;
-    processOutputs(blockInfo, *kv.second, tx, subscriptionOutputs, info.globalIdxs, containerContainsTx, containerUpdated);
-    someContainerUpdated = someContainerUpdated || containerUpdated;
-    if (containerContainsTx) {
-      transactionContainers.emplace_back(&kv.second->getContainer());
+void TransfersConsumer::processTransactions(const std::vector<TransactionToProcess>& transactions) {
+  struct TransactionUpdate {
+    bool updated = false;
+    std::vector<ITransfersContainer*> containers;
+  };
+
+  // A subscription only touches its own container, so every shard applies the whole batch on its
+  // own; the consumer observers are then told about each transaction in blockchain order.
+  std::vector<std::vector<TransactionUpdate>> shardUpdates(m_shards.size());
+  std::exception_ptr error;
+  try {
+    forEachShardInParallel([&](size_t shardIndex, SubscriptionShard& shard) {
+      auto& updates = shardUpdates[shardIndex];
+      updates.resize(transactions.size());
+
+      std::vector<TransactionOutputInformationIn> emptyOutputs;
+      for (size_t i = 0; i < transactions.size(); ++i) {
+        const auto& item = transactions[i];
+        for (auto& kv : shard.subscriptions) {
+          auto it = item.info->outputs.find(kv.first);
+          auto& subscriptionOutputs = (it == item.info->outputs.end()) ? emptyOutputs : it->second;
+
+          bool containerContainsTx;
+          bool containerUpdated;
+          processOutputs(*item.blockInfo, *kv.second, *item.tx, subscriptionOutputs, item.info->globalIdxs, containerContainsTx, containerUpdated);
+          updates[i].updated = updates[i].updated || containerUpdated;
+          if (containerContainsTx) {
+            updates[i].containers.emplace_back(&kv.second->getContainer());
+          }
+        }
+      }
+    });
+  } catch (...) {
+    // report what the shards did apply before passing the error on
+    error = std::current_exception();
+  }
+
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    std::vector<ITransfersContainer*> transactionContainers;
+    bool someContainerUpdated = false;
+    for (const auto& updates : shardUpdates) {
+      if (i < updates.size()) {
+        someContainerUpdated = someContainerUpdated || updates[i].updated;
+        transactionContainers.insert(transactionContainers.end(), updates[i].containers.begin(), updates[i].containers.end());
+      }
+    }
+
+    if (someContainerUpdated) {
+      m_observerManager.notify(&IBlockchainConsumerObserver::onTransactionUpdated, this, transactions[i].tx->getTransactionHash(), transactionContainers);
     }
   }
 
-  if (someContainerUpdated) {
-    m_observerManager.notify(&IBlockchainConsumerObserver::onTransactionUpdated, this, tx.getTransactionHash(), transactionContainers);
+  if (error) {
+    std::rethrow_exception(error);
   }
 }
 
@@ -23,10 +23,13 @@
 #include "TypeHelpers.h"
 
 #include "crypto/crypto.h"
+#include "Common/ThreadPool.h"
 #include "Logging/LoggerRef.h"
 
 #include "IObservableImpl.h"
 
+#include <array>
+#include <mutex>
 #include <unordered_set>
 
 namespace CryptoNote {
@@ -36,13 +39,17 @@ class INode;
 class TransfersConsumer: public IObservableImpl<IBlockchainConsumerObserver, IBlockchainConsumer> {
 public:
 
-  TransfersConsumer(const CryptoNote::Currency& currency, INode& node, Logging::ILogger& logger, const Crypto::SecretKey& viewSecret);
+  TransfersConsumer(const CryptoNote::Currency& currency, INode& node, Logging::ILogger& logger, const Crypto::SecretKey& viewSecret, Common::ThreadPool& workerPool);
 
   ITransfersSubscription& addSubscription(const AccountSubscription& subscription);
   // returns true if no subscribers left
   bool removeSubscription(const AccountPublicAddress& address);
   ITransfersSubscription* getSubscription(const AccountPublicAddress& acc);
   void getSubscriptions(std::vector<AccountPublicAddress>& subscriptions);
+  // Hands a subscription over to another consumer of the same view key, both consumers must be
+  // at the same blockchain height and the synchronizer must be stopped
+  std::unique_ptr<TransfersSubscription> releaseSubscription(const AccountPublicAddress& address);
+  void adoptSubscription(std::unique_ptr<TransfersSubscription> subscription);
 
   void initTransactionPool(const std::unordered_set<Crypto::Hash>& uncommitedTransactions);
   void addPublicKeysSeen(const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey);
@@ -58,22 +65,48 @@ public:
   virtual void removeUnconfirmedTransaction(const Crypto::Hash& transactionHash) override;
 
 private:
+  static const size_t SUBSCRIPTION_SHARD_COUNT = 16;
+
+  // Subscriptions are spread over shards by spend key hash. A shard's lock is held while its
+  // subscriptions process a batch, so shards run side by side and adding or removing an
+  // address only waits for its own shard.
+  struct SubscriptionShard {
+    std::mutex mutex;
+    // map { spend public key -> subscription }
+    std::unordered_map<Crypto::PublicKey, std::unique_ptr<TransfersSubscription>> subscriptions;
+  };
+
+  SubscriptionShard& getShard(const Crypto::PublicKey& spendPublicKey);
 
   template <typename F>
   void forEachSubscription(F action) {
-    for (const auto& kv : m_subscriptions) {
-      action(*kv.second);
+    for (auto& shard : m_shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (const auto& kv : shard.subscriptions) {
+        action(*kv.second);
+      }
     }
   }
 
+  // Runs action(shardIndex, shard) under the shard's lock for every non-empty shard, on the worker pool
+  // when more than one shard has work. The first exception thrown by an action is rethrown.
+  template <typename F>
+  void forEachShardInParallel(F action);
+
   struct PreprocessInfo {
     std::unordered_map<Crypto::PublicKey, std::vector<TransactionOutputInformationIn>> outputs;
     std::vector<uint32_t> globalIdxs;
   };
 
+  struct TransactionToProcess {
+    const TransactionBlockInfo* blockInfo;
+    const ITransactionReader* tx;
+    const PreprocessInfo* info;
+  };
+
   std::error_code preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info);
   std::error_code processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx);
-  void processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, const PreprocessInfo& info);
+  void processTransactions(const std::vector<TransactionToProcess>& transactions);
   void processOutputs(const TransactionBlockInfo& blockInfo, TransfersSubscription& sub, const ITransactionReader& tx,
     const std::vector<TransactionOutputInformationIn>& outputs, const std::vector<uint32_t>& globalIdxs, bool& contains, bool& updated);
 
@@ -83,14 +116,14 @@ private:
 
   SynchronizationStart m_syncStart;
   const Crypto::SecretKey m_viewSecret;
-  // map { spend public key -> subscription }
-  std::unordered_map<Crypto::PublicKey, std::unique_ptr<TransfersSubscription>> m_subscriptions;
+  std::array<SubscriptionShard, SUBSCRIPTION_SHARD_COUNT> m_shards;
   std::unordered_set<Crypto::PublicKey> m_spendKeys;
   std::unordered_set<Crypto::Hash> m_poolTxs;
 
   INode& m_node;
   const CryptoNote::Currency& m_currency;
   Logging::LoggerRef m_logger;
+  Common::ThreadPool& m_workerPool;
 };
 
 }
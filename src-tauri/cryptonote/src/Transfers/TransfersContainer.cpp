@@ -16,7 +16,11 @@
 // along with Fuego. If not, see <https://www.gnu.org/licenses/>.
 
 #include "TransfersContainer.h"
+
+#include <boost/functional/hash.hpp>
+
 #include "IWalletLegacy.h"
+#include "Common/AllocationTracker.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
@@ -45,57 +49,86 @@ void serialize(TransactionInformation& ti, CryptoNote::ISerializer& s) {
 const uint32_t TRANSFERS_CONTAINER_STORAGE_VERSION = 1;
 
 namespace {
-  template<typename TIterator>
-  class TransferIteratorList {
-  public:
-    TransferIteratorList(const TIterator& begin, const TIterator& end) : m_end(end) {
-      for (auto it = begin; it != end; ++it) {
-        m_list.emplace_back(it);
-      }
-    }
+  template<typename C>
+  void findTransfers(const C& transfers, const SpentOutputDescriptor& descriptor, std::vector<uint32_t>& positions) {
+    transfers.findAll(TransferIndex::ByOutputDescriptor, descriptor.hash(), [&descriptor](const TransactionOutputInformationEx& transfer) {
+      return transfer.getSpentOutputDescriptor() == descriptor;
+    }, positions);
+  }
 
-    TransferIteratorList(TransferIteratorList<TIterator>&& other) {
-      m_list = std::move(other.m_list);
-      m_end = std::move(other.m_end);
-    }
+  template<typename C>
+  uint32_t findTransfer(const C& transfers, const SpentOutputDescriptor& descriptor) {
+    return transfers.find(TransferIndex::ByOutputDescriptor, descriptor.hash(), [&descriptor](const TransactionOutputInformationEx& transfer) {
+      return transfer.getSpentOutputDescriptor() == descriptor;
+    });
+  }
 
-    TransferIteratorList& operator=(TransferIteratorList<TIterator>&& other) {
-      m_list = std::move(other.m_list);
-      m_end = std::move(other.m_end);
-      return *this;
-    }
+  template<typename C>
+  size_t countTransfers(const C& transfers, const SpentOutputDescriptor& descriptor) {
+    return transfers.count(TransferIndex::ByOutputDescriptor, descriptor.hash(), [&descriptor](const TransactionOutputInformationEx& transfer) {
+      return transfer.getSpentOutputDescriptor() == descriptor;
+    });
+  }
 
-    void sort() {
-      std::sort(m_list.begin(), m_list.end(), &TransferIteratorList::lessTIterator);
-    }
+  template<typename C>
+  uint32_t findTransfer(const C& transfers, const TransactionOutputKey& transactionOutputKey) {
+    return transfers.find(TransferIndex::ByOutputKey, transactionOutputKey.hash(), [&transactionOutputKey](const TransactionOutputInformationEx& transfer) {
+      return transfer.getTransactionOutputKey() == transactionOutputKey;
+    });
+  }
 
-    TIterator findFirstByAmount(uint64_t amount) const {
-      auto listIt = std::find_if(m_list.begin(), m_list.end(), [amount](const TIterator& it) {
-        return it->amount == amount;
-      });
-      return listIt == m_list.end() ? m_end : *listIt;
-    }
+  template<typename C>
+  void findTransactionTransfers(const C& transfers, const Hash& transactionHash, std::vector<uint32_t>& positions) {
+    transfers.findAll(TransferIndex::ByContainingTransaction, std::hash<Hash>()(transactionHash), [&transactionHash](const TransactionOutputInformationEx& transfer) {
+      return transfer.transactionHash == transactionHash;
+    }, positions);
+  }
+
+  template<typename C>
+  void findSpendingTransactionTransfers(const C& transfers, const Hash& transactionHash, std::vector<uint32_t>& positions) {
+    transfers.findAll(TransferIndex::BySpendingTransaction, std::hash<Hash>()(transactionHash), [&transactionHash](const SpentTransactionOutput& transfer) {
+      return transfer.spendingTransactionHash == transactionHash;
+    }, positions);
+  }
 
-    TIterator minElement() const {
-      auto listIt = std::min_element(m_list.begin(), m_list.end(), &TransferIteratorList::lessTIterator);
-      return listIt == m_list.end() ? m_end : *listIt;
+  template<typename C>
+  uint32_t findTransaction(const C& transactions, const Hash& transactionHash) {
+    return transactions.find(0, std::hash<Hash>()(transactionHash), [&transactionHash](const TransactionInformation& transaction) {
+      return transaction.transactionHash == transactionHash;
+    });
+  }
+
+  template<typename Element, typename C>
+  void readFlatSequence(C& collection, Common::StringView name, ISerializer& s) {
+    size_t size = 0;
+    s.beginArray(size, name);
+    collection.reserve(size);
+
+    while (size--) {
+      Element e;
+      s(e, "");
+      collection.insert(std::move(e));
     }
 
-  private:
-    static bool lessTIterator(const TIterator& it1, const TIterator& it2) {
+    s.endArray();
+  }
+
+  template<typename C>
+  struct BlockchainOrderLess {
+    const C& transfers;
+
+    bool operator()(uint32_t position1, uint32_t position2) const {
+      const TransactionOutputInformationEx& t1 = transfers[position1];
+      const TransactionOutputInformationEx& t2 = transfers[position2];
       return
-        (it1->blockHeight < it2->blockHeight) ||
-        (it1->blockHeight == it2->blockHeight && it1->transactionIndex < it2->transactionIndex);
+        (t1.blockHeight < t2.blockHeight) ||
+        (t1.blockHeight == t2.blockHeight && t1.transactionIndex < t2.transactionIndex);
     }
-
-  private:
-    std::vector<TIterator> m_list;
-    TIterator m_end;
   };
 
-  template<typename TIterator>
-  TransferIteratorList<TIterator> createTransferIteratorList(const std::pair<TIterator, TIterator>& itPair) {
-    return TransferIteratorList<TIterator>(itPair.first, itPair.second);
+  template<typename C>
+  BlockchainOrderLess<C> blockchainOrderLess(const C& transfers) {
+    return BlockchainOrderLess<C>{transfers};
   }
 
   TransferUnlockJob makeTransferUnlockJob(const TransactionOutputInformationEx& output, uint32_t transactionSpendableAge) {
@@ -190,11 +223,158 @@ size_t SpentOutputDescriptor::hash() const {
   }
 }
 
+size_t TransactionInformationIndexTraits::hash(const TransactionInformation& transaction, size_t index) {
+  assert(index == 0);
+  return std::hash<Hash>()(transaction.transactionHash);
+}
+
+bool TransactionInformationIndexTraits::equal(const TransactionInformation& a, const TransactionInformation& b, size_t index) {
+  assert(index == 0);
+  return a.transactionHash == b.transactionHash;
+}
+
+size_t TransferIndexTraits::hash(const TransactionOutputInformationEx& transfer, size_t index) {
+  switch (index) {
+  case TransferIndex::ByOutputDescriptor:
+    return transfer.getSpentOutputDescriptor().hash();
+  case TransferIndex::ByContainingTransaction:
+    return std::hash<Hash>()(transfer.transactionHash);
+  default:
+    assert(index == TransferIndex::ByOutputKey);
+    return transfer.getTransactionOutputKey().hash();
+  }
+}
+
+bool TransferIndexTraits::equal(const TransactionOutputInformationEx& a, const TransactionOutputInformationEx& b, size_t index) {
+  switch (index) {
+  case TransferIndex::ByOutputDescriptor:
+    return a.getSpentOutputDescriptor() == b.getSpentOutputDescriptor();
+  case TransferIndex::ByContainingTransaction:
+    return a.transactionHash == b.transactionHash;
+  default:
+    assert(index == TransferIndex::ByOutputKey);
+    return a.getTransactionOutputKey() == b.getTransactionOutputKey();
+  }
+}
+
+size_t SpentTransferIndexTraits::hash(const SpentTransactionOutput& transfer, size_t index) {
+  if (index == TransferIndex::BySpendingTransaction) {
+    return std::hash<Hash>()(transfer.spendingTransactionHash);
+  }
+
+  return TransferIndexTraits::hash(transfer, index);
+}
+
+bool SpentTransferIndexTraits::equal(const SpentTransactionOutput& a, const SpentTransactionOutput& b, size_t index) {
+  if (index == TransferIndex::BySpendingTransaction) {
+    return a.spendingTransactionHash == b.spendingTransactionHash;
+  }
+
+  return TransferIndexTraits::equal(a, b, index);
+}
+
+TransfersUnlockJobs::TransfersUnlockJobs() : m_erasedCount(0) {
+}
+
+void TransfersUnlockJobs::clear() {
+  m_entries.clear();
+  m_erasedCount = 0;
+}
+
+void TransfersUnlockJobs::assign(std::vector<TransferUnlockJob>&& jobs) {
+  std::stable_sort(jobs.begin(), jobs.end(), [](const TransferUnlockJob& a, const TransferUnlockJob& b) {
+    return a.unlockHeight < b.unlockHeight;
+  });
+
+  m_entries.clear();
+  m_entries.reserve(jobs.size());
+  for (auto& job : jobs) {
+    m_entries.push_back(Entry{std::move(job), false});
+  }
+
+  m_erasedCount = 0;
+}
+
+void TransfersUnlockJobs::insert(const TransferUnlockJob& job) {
+  auto it = std::upper_bound(m_entries.begin(), m_entries.end(), job.unlockHeight, [](uint32_t height, const Entry& entry) {
+    return height < entry.job.unlockHeight;
+  });
+
+  m_entries.insert(it, Entry{job, false});
+}
+
+bool TransfersUnlockJobs::erase(uint32_t unlockHeight, const TransactionOutputKey& transactionOutputKey) {
+  auto matches = [&transactionOutputKey](const Entry& entry) {
+    return !entry.erased && entry.job.transactionOutputKey == transactionOutputKey;
+  };
+
+  auto first = std::lower_bound(m_entries.begin(), m_entries.end(), unlockHeight, [](const Entry& entry, uint32_t height) {
+    return entry.job.unlockHeight < height;
+  });
+
+  auto it = std::find_if(first, m_entries.end(), [&](const Entry& entry) {
+    return entry.job.unlockHeight != unlockHeight || matches(entry);
+  });
+
+  if (it == m_entries.end() || it->job.unlockHeight != unlockHeight) {
+    // A job stored with a different unlock height, e.g. by an older container version
+    it = std::find_if(m_entries.begin(), m_entries.end(), matches);
+    if (it == m_entries.end()) {
+      return false;
+    }
+  }
+
+  it->erased = true;
+  ++m_erasedCount;
+
+  if (m_erasedCount * 2 > m_entries.size()) {
+    compact();
+  }
+
+  return true;
+}
+
+std::vector<TransactionOutputKey> TransfersUnlockJobs::getOutputs(uint64_t firstHeight, uint64_t lastHeight) const {
+  std::vector<TransactionOutputKey> outputs;
+  if (firstHeight > lastHeight) {
+    return outputs;
+  }
+
+  auto it = std::lower_bound(m_entries.begin(), m_entries.end(), firstHeight, [](const Entry& entry, uint64_t height) {
+    return entry.job.unlockHeight < height;
+  });
+
+  for (; it != m_entries.end() && it->job.unlockHeight <= lastHeight; ++it) {
+    if (!it->erased) {
+      outputs.push_back(it->job.transactionOutputKey);
+    }
+  }
+
+  return outputs;
+}
+
+std::vector<TransferUnlockJob> TransfersUnlockJobs::getJobs() const {
+  std::vector<TransferUnlockJob> jobs;
+  jobs.reserve(size());
+  for (const auto& entry : m_entries) {
+    if (!entry.erased) {
+      jobs.push_back(entry.job);
+    }
+  }
+
+  return jobs;
+}
+
+void TransfersUnlockJobs::compact() {
+  m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [](const Entry& entry) { return entry.erased; }), m_entries.end());
+  m_erasedCount = 0;
+}
 
 TransfersContainer::TransfersContainer(const Currency& currency, size_t transactionSpendableAge) :
   m_currentHeight(0),
   m_currency(currency),
-  m_transactionSpendableAge(transactionSpendableAge) {
+  m_transactionSpendableAge(transactionSpendableAge),
+  m_balance(currency, transactionSpendableAge) {
 }
 
 bool TransfersContainer::addTransaction(const TransactionBlockInfo& block, const ITransactionReader& tx,
@@ -202,12 +382,13 @@ bool TransfersContainer::addTransaction(const TransactionBlockInfo& block, const
                                         std::vector<std::string>&& messages,
                                         std::vector<TransactionOutputInformation>* unlockingTransfers) {
   std::unique_lock<std::mutex> lock(m_mutex);
+  Common::MemoryScope memoryScope(Common::MemorySubsystem::TransfersContainer);
 
   if (block.height < m_currentHeight) {
     throw std::invalid_argument("Cannot add transaction from block < m_currentHeight");
   }
 
-  if (m_transactions.count(tx.getTransactionHash()) > 0) {
+  if (findTransaction(m_transactions, tx.getTransactionHash()) != Transactions::NPOS) {
     throw std::invalid_argument("Transaction is already added");
   }
 
@@ -250,9 +431,9 @@ void TransfersContainer::addTransaction(const TransactionBlockInfo& block, const
     txInfo.paymentId = NULL_HASH;
   }
 
-  auto result = m_transactions.emplace(std::move(txInfo));
+  auto result = m_transactions.insert(std::move(txInfo));
   (void)result; // Disable unused warning
-  assert(result.second);
+  assert(result);
 }
 
 /**
@@ -283,25 +464,26 @@ bool TransfersContainer::addTransactionOutputs(const TransactionBlockInfo& block
     info.visible = true;
 
     if (transferIsUnconfirmed) {
-      auto result = m_unconfirmedTransfers.emplace(std::move(info));
+      auto result = m_unconfirmedTransfers.insert(info);
       (void)result; // Disable unused warning
-      assert(result.second);
+      assert(result);
     } else {
       if (info.type == TransactionTypes::OutputType::Multisignature) {
         SpentOutputDescriptor descriptor(transfer);
-        if (m_availableTransfers.get<SpentOutputDescriptorIndex>().count(descriptor) > 0 ||
-            m_spentTransfers.get<SpentOutputDescriptorIndex>().count(descriptor) > 0) {
+        if (countTransfers(m_availableTransfers, descriptor) > 0 || countTransfers(m_spentTransfers, descriptor) > 0) {
           throw std::runtime_error("Transfer already exists");
         }
       }
 
       addUnlockJob(info);
 
-      auto result = m_availableTransfers.emplace(std::move(info));
+      auto result = m_availableTransfers.insert(info);
       (void)result; // Disable unused warning
-      assert(result.second);
+      assert(result);
     }
 
+    m_balance.add(info);
+
     if (info.type == TransactionTypes::OutputType::Key) {
       updateTransfersVisibility(info.keyImage);
     }
@@ -326,17 +508,15 @@ bool TransfersContainer::addTransactionInputs(const TransactionBlockInfo& block,
       tx.getInput(i, input);
 
       SpentOutputDescriptor descriptor(&input.keyImage);
-      auto spentRange = m_spentTransfers.get<SpentOutputDescriptorIndex>().equal_range(descriptor);
-      if (std::distance(spentRange.first, spentRange.second) > 0) {
+      if (countTransfers(m_spentTransfers, descriptor) > 0) {
         throw std::runtime_error("Spending already spent transfer");
       }
 
-      auto availableRange = m_availableTransfers.get<SpentOutputDescriptorIndex>().equal_range(descriptor);
-      auto unconfirmedRange = m_unconfirmedTransfers.get<SpentOutputDescriptorIndex>().equal_range(descriptor);
-      size_t availableCount = std::distance(availableRange.first, availableRange.second);
-      size_t unconfirmedCount = std::distance(unconfirmedRange.first, unconfirmedRange.second);
+      std::vector<uint32_t> availablePositions;
+      findTransfers(m_availableTransfers, descriptor, availablePositions);
+      size_t unconfirmedCount = countTransfers(m_unconfirmedTransfers, descriptor);
 
-      if (availableCount == 0) {
+      if (availablePositions.empty()) {
         if (unconfirmedCount > 0) {
           throw std::runtime_error("Spending unconfirmed transfer");
         } else {
@@ -345,22 +525,22 @@ bool TransfersContainer::addTransactionInputs(const TransactionBlockInfo& block,
         }
       }
 
-      auto& outputDescriptorIndex = m_availableTransfers.get<SpentOutputDescriptorIndex>();
-      auto availableOutputsRange = outputDescriptorIndex.equal_range(SpentOutputDescriptor(&input.keyImage));
-
-      auto iteratorList = createTransferIteratorList(availableOutputsRange);
-      iteratorList.sort();
-      auto spendingTransferIt = iteratorList.findFirstByAmount(input.amount);
+      std::sort(availablePositions.begin(), availablePositions.end(), blockchainOrderLess(m_availableTransfers));
+      auto spendingTransferIt = std::find_if(availablePositions.begin(), availablePositions.end(), [this, &input](uint32_t position) {
+        return m_availableTransfers[position].amount == input.amount;
+      });
 
-      if (spendingTransferIt == availableOutputsRange.second) {
+      if (spendingTransferIt == availablePositions.end()) {
         throw std::runtime_error("Input has invalid amount, corresponding output isn't found");
       }
 
-      assert(spendingTransferIt->keyImage == input.keyImage);
-      deleteUnlockJob(*spendingTransferIt);
-      copyToSpent(block, tx, i, *spendingTransferIt);
+      const TransactionOutputInformationEx& spendingTransfer = m_availableTransfers[*spendingTransferIt];
+      assert(spendingTransfer.keyImage == input.keyImage);
+      deleteUnlockJob(spendingTransfer);
+      copyToSpent(block, tx, i, spendingTransfer);
+      m_balance.remove(spendingTransfer);
       // erase from available outputs
-      outputDescriptorIndex.erase(spendingTransferIt);
+      m_availableTransfers.erase(*spendingTransferIt);
       updateTransfersVisibility(input.keyImage);
 
       inputsAdded = true;
@@ -368,13 +548,13 @@ bool TransfersContainer::addTransactionInputs(const TransactionBlockInfo& block,
       MultisignatureInput input;
       tx.getInput(i, input);
 
-      auto& outputDescriptorIndex = m_availableTransfers.get<SpentOutputDescriptorIndex>();
-      auto availableOutputIt = outputDescriptorIndex.find(SpentOutputDescriptor(input.amount, input.outputIndex));
-      if (availableOutputIt != outputDescriptorIndex.end()) {
-        deleteUnlockJob(*availableOutputIt);
-        copyToSpent(block, tx, i, *availableOutputIt);
+      uint32_t availableOutput = findTransfer(m_availableTransfers, SpentOutputDescriptor(input.amount, input.outputIndex));
+      if (availableOutput != AvailableTransfers::NPOS) {
+        deleteUnlockJob(m_availableTransfers[availableOutput]);
+        copyToSpent(block, tx, i, m_availableTransfers[availableOutput]);
+        m_balance.remove(m_availableTransfers[availableOutput]);
         // erase from available outputs
-        outputDescriptorIndex.erase(availableOutputIt);
+        m_availableTransfers.erase(availableOutput);
 
         inputsAdded = true;
       }
@@ -389,43 +569,45 @@ bool TransfersContainer::addTransactionInputs(const TransactionBlockInfo& block,
 bool TransfersContainer::deleteUnconfirmedTransaction(const Crypto::Hash& transactionHash) {
   std::unique_lock<std::mutex> lock(m_mutex);
 
-  auto it = m_transactions.find(transactionHash);
-  if (it == m_transactions.end()) {
+  uint32_t transaction = findTransaction(m_transactions, transactionHash);
+  if (transaction == Transactions::NPOS) {
     return false;
-  } else if (it->blockHeight != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+  } else if (m_transactions[transaction].blockHeight != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
     return false;
   } else {
-    deleteTransactionTransfers(it->transactionHash);
-    m_transactions.erase(it);
+    deleteTransactionTransfers(transactionHash);
+    m_transactions.erase(transaction);
     return true;
   }
 }
 
 bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& block, const Crypto::Hash& transactionHash,
                                                   const std::vector<uint32_t>& globalIndices) {
+  Common::MemoryScope memoryScope(Common::MemorySubsystem::TransfersContainer);
   if (block.height == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
     throw std::invalid_argument("Block height equals WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT");
   }
 
   std::unique_lock<std::mutex> lock(m_mutex);
 
-  auto transactionIt = m_transactions.find(transactionHash);
-  if (transactionIt == m_transactions.end()) {
+  uint32_t transaction = findTransaction(m_transactions, transactionHash);
+  if (transaction == Transactions::NPOS) {
     return false;
   }
 
-  if (transactionIt->blockHeight != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+  TransactionInformation& txInfo = m_transactions.at(transaction);
+  if (txInfo.blockHeight != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
     return false;
   }
 
-  auto txInfo = *transactionIt;
   txInfo.blockHeight = block.height;
   txInfo.timestamp = block.timestamp;
-  m_transactions.replace(transactionIt, txInfo);
 
-  auto availableRange = m_unconfirmedTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
-  for (auto transferIt = availableRange.first; transferIt != availableRange.second; ) {
-    auto transfer = *transferIt;
+  std::vector<uint32_t> unconfirmedPositions;
+  findTransactionTransfers(m_unconfirmedTransfers, transactionHash, unconfirmedPositions);
+  std::sort(unconfirmedPositions.begin(), unconfirmedPositions.end(), std::greater<uint32_t>());
+  for (uint32_t position : unconfirmedPositions) {
+    auto transfer = m_unconfirmedTransfers[position];
     assert(transfer.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT);
     assert(transfer.globalOutputIndex == UNCONFIRMED_TRANSACTION_GLOBAL_OUTPUT_INDEX);
     if (transfer.outputInTransaction >= globalIndices.size()) {
@@ -438,8 +620,7 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
 
     if (transfer.type == TransactionTypes::OutputType::Multisignature) {
       SpentOutputDescriptor descriptor(transfer);
-      if (m_availableTransfers.get<SpentOutputDescriptorIndex>().count(descriptor) > 0 ||
-          m_spentTransfers.get<SpentOutputDescriptorIndex>().count(descriptor) > 0) {
+      if (countTransfers(m_availableTransfers, descriptor) > 0 || countTransfers(m_spentTransfers, descriptor) > 0) {
         // This exception breaks TransfersContainer consistency
         throw std::runtime_error("Transfer already exists");
       }
@@ -447,25 +628,26 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
 
     addUnlockJob(transfer);
 
-    auto result = m_availableTransfers.emplace(std::move(transfer));
+    auto result = m_availableTransfers.insert(transfer);
     (void)result; // Disable unused warning
-    assert(result.second);
+    assert(result);
 
-    transferIt = m_unconfirmedTransfers.get<ContainingTransactionIndex>().erase(transferIt);
+    m_balance.remove(m_unconfirmedTransfers[position]);
+    m_balance.add(transfer);
+    m_unconfirmedTransfers.erase(position);
 
     if (transfer.type == TransactionTypes::OutputType::Key) {
       updateTransfersVisibility(transfer.keyImage);
     }
   }
 
-  auto& spendingTransactionIndex = m_spentTransfers.get<SpendingTransactionIndex>();
-  auto spentRange = spendingTransactionIndex.equal_range(transactionHash);
-  for (auto transferIt = spentRange.first; transferIt != spentRange.second; ++transferIt) {
-    auto transfer = *transferIt;
+  std::vector<uint32_t> spentPositions;
+  findSpendingTransactionTransfers(m_spentTransfers, transactionHash, spentPositions);
+  for (uint32_t position : spentPositions) {
+    SpentTransactionOutput& transfer = m_spentTransfers.at(position);
     assert(transfer.spendingBlock.height == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT);
 
     transfer.spendingBlock = block;
-    spendingTransactionIndex.replace(transferIt, transfer);
   }
 
   return true;
@@ -475,46 +657,54 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
  * \pre m_mutex is locked.
  */
 void TransfersContainer::deleteTransactionTransfers(const Crypto::Hash& transactionHash) {
-  auto& spendingTransactionIndex = m_spentTransfers.get<SpendingTransactionIndex>();
-  auto spentTransfersRange = spendingTransactionIndex.equal_range(transactionHash);
-  for (auto it = spentTransfersRange.first; it != spentTransfersRange.second;) {
-    assert(it->blockHeight != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT);
-    assert(it->globalOutputIndex != UNCONFIRMED_TRANSACTION_GLOBAL_OUTPUT_INDEX);
+  std::vector<uint32_t> positions;
+  findSpendingTransactionTransfers(m_spentTransfers, transactionHash, positions);
+  std::sort(positions.begin(), positions.end(), std::greater<uint32_t>());
+  for (uint32_t position : positions) {
+    const SpentTransactionOutput& spentTransfer = m_spentTransfers[position];
+    assert(spentTransfer.blockHeight != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT);
+    assert(spentTransfer.globalOutputIndex != UNCONFIRMED_TRANSACTION_GLOBAL_OUTPUT_INDEX);
 
-    const TransactionOutputInformationEx& unspendingTransfer = static_cast<const TransactionOutputInformationEx&>(*it);
+    TransactionOutputInformationEx unspendingTransfer = static_cast<const TransactionOutputInformationEx&>(spentTransfer);
 
     addUnlockJob(unspendingTransfer);
-    auto result = m_availableTransfers.emplace(unspendingTransfer);
-    assert(result.second);
-    it = spendingTransactionIndex.erase(it);
+    auto result = m_availableTransfers.insert(unspendingTransfer);
+    (void)result; // Disable unused warning
+    assert(result);
+    m_balance.add(unspendingTransfer);
+    m_spentTransfers.erase(position);
 
-    if (result.first->type == TransactionTypes::OutputType::Key) {
-      updateTransfersVisibility(result.first->keyImage);
+    if (unspendingTransfer.type == TransactionTypes::OutputType::Key) {
+      updateTransfersVisibility(unspendingTransfer.keyImage);
     }
   }
 
-  auto unconfirmedTransfersRange = m_unconfirmedTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
-  for (auto it = unconfirmedTransfersRange.first; it != unconfirmedTransfersRange.second;) {
-    if (it->type == TransactionTypes::OutputType::Key) {
-      KeyImage keyImage = it->keyImage;
-      it = m_unconfirmedTransfers.get<ContainingTransactionIndex>().erase(it);
+  findTransactionTransfers(m_unconfirmedTransfers, transactionHash, positions);
+  std::sort(positions.begin(), positions.end(), std::greater<uint32_t>());
+  for (uint32_t position : positions) {
+    m_balance.remove(m_unconfirmedTransfers[position]);
+
+    if (m_unconfirmedTransfers[position].type == TransactionTypes::OutputType::Key) {
+      KeyImage keyImage = m_unconfirmedTransfers[position].keyImage;
+      m_unconfirmedTransfers.erase(position);
       updateTransfersVisibility(keyImage);
     } else {
-      it = m_unconfirmedTransfers.get<ContainingTransactionIndex>().erase(it);
+      m_unconfirmedTransfers.erase(position);
     }
   }
 
-  auto& transactionTransfersIndex = m_availableTransfers.get<ContainingTransactionIndex>();
-  auto transactionTransfersRange = transactionTransfersIndex.equal_range(transactionHash);
-  for (auto it = transactionTransfersRange.first; it != transactionTransfersRange.second;) {
-    deleteUnlockJob(*it);
+  findTransactionTransfers(m_availableTransfers, transactionHash, positions);
+  std::sort(positions.begin(), positions.end(), std::greater<uint32_t>());
+  for (uint32_t position : positions) {
+    deleteUnlockJob(m_availableTransfers[position]);
+    m_balance.remove(m_availableTransfers[position]);
 
-    if (it->type == TransactionTypes::OutputType::Key) {
-      KeyImage keyImage = it->keyImage;
-    it = transactionTransfersIndex.erase(it);
+    if (m_availableTransfers[position].type == TransactionTypes::OutputType::Key) {
+      KeyImage keyImage = m_availableTransfers[position].keyImage;
+      m_availableTransfers.erase(position);
       updateTransfersVisibility(keyImage);
     } else {
-      it = transactionTransfersIndex.erase(it);
+      m_availableTransfers.erase(position);
     }
   }
 }
@@ -532,9 +722,9 @@ void TransfersContainer::copyToSpent(const TransactionBlockInfo& block, const IT
   spentOutput.spendingBlock = block;
   spentOutput.spendingTransactionHash = tx.getTransactionHash();
   spentOutput.inputInTransaction = static_cast<uint32_t>(inputIndex);
-  auto result = m_spentTransfers.emplace(std::move(spentOutput));
+  auto result = m_spentTransfers.insert(std::move(spentOutput));
   (void)result; // Disable unused warning
-  assert(result.second);
+  assert(result);
 }
 
 void TransfersContainer::detach(uint32_t height, std::vector<Crypto::Hash>& deletedTransactions, std::vector<TransactionOutputInformation>& lockedTransfers) {
@@ -543,31 +733,34 @@ void TransfersContainer::detach(uint32_t height, std::vector<Crypto::Hash>& dele
 
   std::lock_guard<std::mutex> lk(m_mutex);
 
-  auto& spendingTransactionIndex = m_spentTransfers.get<SpendingTransactionIndex>();
-  auto& blockHeightIndex = m_transactions.get<1>();
-  auto it = blockHeightIndex.end();
-  while (it != blockHeightIndex.begin()) {
-    --it;
+  // Candidates are the unconfirmed transactions and the ones at or above height, newest first
+  std::vector<std::pair<uint32_t, Hash>> candidates;
+  for (const auto& transaction : m_transactions) {
+    if (transaction.blockHeight >= height) {
+      candidates.emplace_back(transaction.blockHeight, transaction.transactionHash);
+    }
+  }
+
+  std::stable_sort(candidates.begin(), candidates.end(), [](const std::pair<uint32_t, Hash>& a, const std::pair<uint32_t, Hash>& b) {
+    return a.first > b.first;
+  });
 
+  std::vector<uint32_t> spentPositions;
+  for (const auto& candidate : candidates) {
     bool doDelete = false;
-    if (it->blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
-      auto range = spendingTransactionIndex.equal_range(it->transactionHash);
-      for (auto spentTransferIt = range.first; spentTransferIt != range.second; ++spentTransferIt) {
-        if (spentTransferIt->blockHeight >= height) {
-          doDelete = true;
-          break;
-        }
-      }
-    } else if (it->blockHeight >= height) {
-      doDelete = true;
+    if (candidate.first == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+      findSpendingTransactionTransfers(m_spentTransfers, candidate.second, spentPositions);
+      doDelete = std::any_of(spentPositions.begin(), spentPositions.end(), [this, height](uint32_t position) {
+        return m_spentTransfers[position].blockHeight >= height;
+      });
     } else {
-      break;
+      doDelete = true;
     }
 
     if (doDelete) {
-      deleteTransactionTransfers(it->transactionHash);
-      deletedTransactions.emplace_back(it->transactionHash);
-      it = blockHeightIndex.erase(it);
+      deleteTransactionTransfers(candidate.second);
+      deletedTransactions.emplace_back(candidate.second);
+      m_transactions.erase(findTransaction(m_transactions, candidate.second));
     }
   }
 
@@ -575,17 +768,24 @@ void TransfersContainer::detach(uint32_t height, std::vector<Crypto::Hash>& dele
 
   // TODO: notification on detach
   m_currentHeight = height == 0 ? 0 : height - 1;
+  m_balance.setHeight(m_currentHeight);
 
   getLockingTransfers(prevHeight, m_currentHeight, deletedTransactions, lockedTransfers);
 }
 
 namespace {
-  template<typename C, typename T>
-  void updateVisibility(C& collection, const T& range, bool visible) {
-    for (auto it = range.first; it != range.second; ++it) {
-      auto updated = *it;
-      updated.visible = visible;
-      collection.replace(it, updated);
+  template<typename C>
+  void updateVisibility(C& collection, const std::vector<uint32_t>& positions, bool visible, TransfersBalance* balance) {
+    for (uint32_t position : positions) {
+      if (balance != nullptr) {
+        balance->remove(collection[position]);
+      }
+
+      collection.at(position).visible = visible;
+
+      if (balance != nullptr) {
+        balance->add(collection[position]);
+      }
     }
   }
 }
@@ -594,42 +794,35 @@ namespace {
  * \pre m_mutex is locked.
  */
 void TransfersContainer::updateTransfersVisibility(const KeyImage& keyImage) {
-  auto& unconfirmedIndex = m_unconfirmedTransfers.get<SpentOutputDescriptorIndex>();
-  auto& availableIndex = m_availableTransfers.get<SpentOutputDescriptorIndex>();
-  auto& spentIndex = m_spentTransfers.get<SpentOutputDescriptorIndex>();
-
   SpentOutputDescriptor descriptor(&keyImage);
-  auto unconfirmedRange = unconfirmedIndex.equal_range(descriptor);
-  auto availableRange = availableIndex.equal_range(descriptor);
-  auto spentRange = spentIndex.equal_range(descriptor);
-
-  size_t unconfirmedCount = std::distance(unconfirmedRange.first, unconfirmedRange.second);
-  size_t availableCount = std::distance(availableRange.first, availableRange.second);
-  size_t spentCount = std::distance(spentRange.first, spentRange.second);
-  assert(spentCount == 0 || spentCount == 1);
-
-  if (spentCount > 0) {
-    updateVisibility(unconfirmedIndex, unconfirmedRange, false);
-    updateVisibility(availableIndex, availableRange, false);
-    updateVisibility(spentIndex, spentRange, true);
-  } else if (availableCount > 0) {
-    updateVisibility(unconfirmedIndex, unconfirmedRange, false);
-    updateVisibility(availableIndex, availableRange, false);
-
-    auto iteratorList = createTransferIteratorList(availableRange);
-    auto earliestTransferIt = iteratorList.minElement();
-    assert(earliestTransferIt != availableRange.second);
-
-    auto earliestTransfer = *earliestTransferIt;
-    earliestTransfer.visible = true;
-    availableIndex.replace(earliestTransferIt, earliestTransfer);
+  std::vector<uint32_t> unconfirmedPositions;
+  std::vector<uint32_t> availablePositions;
+  std::vector<uint32_t> spentPositions;
+  findTransfers(m_unconfirmedTransfers, descriptor, unconfirmedPositions);
+  findTransfers(m_availableTransfers, descriptor, availablePositions);
+  findTransfers(m_spentTransfers, descriptor, spentPositions);
+
+  assert(spentPositions.size() == 0 || spentPositions.size() == 1);
+
+  if (!spentPositions.empty()) {
+    updateVisibility(m_unconfirmedTransfers, unconfirmedPositions, false, &m_balance);
+    updateVisibility(m_availableTransfers, availablePositions, false, &m_balance);
+    updateVisibility(m_spentTransfers, spentPositions, true, nullptr);
+  } else if (!availablePositions.empty()) {
+    updateVisibility(m_unconfirmedTransfers, unconfirmedPositions, false, &m_balance);
+    updateVisibility(m_availableTransfers, availablePositions, false, &m_balance);
+
+    auto earliestTransferIt = std::min_element(availablePositions.begin(), availablePositions.end(), blockchainOrderLess(m_availableTransfers));
+    m_availableTransfers.at(*earliestTransferIt).visible = true;
+    m_balance.add(m_availableTransfers[*earliestTransferIt]);
   } else {
-    updateVisibility(unconfirmedIndex, unconfirmedRange, unconfirmedCount == 1);
+    updateVisibility(m_unconfirmedTransfers, unconfirmedPositions, unconfirmedPositions.size() == 1, &m_balance);
   }
 }
 
 std::vector<TransactionOutputInformation> TransfersContainer::advanceHeight(uint32_t height) {
   std::lock_guard<std::mutex> lk(m_mutex);
+  Common::MemoryScope memoryScope(Common::MemorySubsystem::TransfersContainer);
   return doAdvanceHeight(height);
 }
 
@@ -643,6 +836,7 @@ std::vector<TransactionOutputInformation> TransfersContainer::doAdvanceHeight(ui
 
   uint32_t prevHeight = m_currentHeight;
   m_currentHeight = height;
+  m_balance.setHeight(m_currentHeight);
 
   return getUnlockingTransfers(prevHeight, m_currentHeight);
 }
@@ -659,6 +853,20 @@ size_t TransfersContainer::transactionsCount() const {
 
 uint64_t TransfersContainer::balance(uint32_t flags) const {
   std::lock_guard<std::mutex> lk(m_mutex);
+  uint64_t amount = m_balance.balance(flags);
+
+#ifdef TRANSFERS_CONTAINER_VERIFY_BALANCE
+  // Debug builds can cross-check the running totals against a full scan
+  assert(amount == scanBalance(flags));
+#endif
+
+  return amount;
+}
+
+/**
+ * \pre m_mutex is locked
+ */
+uint64_t TransfersContainer::scanBalance(uint32_t flags) const {
   uint64_t amount = 0;
 
   for (const auto& t : m_availableTransfers) {
@@ -697,39 +905,40 @@ void TransfersContainer::getOutputs(std::vector<TransactionOutputInformation>& t
 
 bool TransfersContainer::getTransactionInformation(const Crypto::Hash& transactionHash, TransactionInformation& info, uint64_t* amountIn, uint64_t* amountOut) const {
   std::lock_guard<std::mutex> lk(m_mutex);
-  auto it = m_transactions.find(transactionHash);
-  if (it == m_transactions.end()) {
+  uint32_t transaction = findTransaction(m_transactions, transactionHash);
+  if (transaction == Transactions::NPOS) {
     return false;
   }
 
-  info = *it;
+  info = m_transactions[transaction];
 
+  std::vector<uint32_t> positions;
   if (amountOut != nullptr) {
     *amountOut = 0;
 
     if (info.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
-      auto unconfirmedOutputsRange = m_unconfirmedTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
-      for (auto it = unconfirmedOutputsRange.first; it != unconfirmedOutputsRange.second; ++it) {
-        *amountOut += it->amount;
+      findTransactionTransfers(m_unconfirmedTransfers, transactionHash, positions);
+      for (uint32_t position : positions) {
+        *amountOut += m_unconfirmedTransfers[position].amount;
       }
     } else {
-      auto availableOutputsRange = m_availableTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
-      for (auto it = availableOutputsRange.first; it != availableOutputsRange.second; ++it) {
-        *amountOut += it->amount;
+      findTransactionTransfers(m_availableTransfers, transactionHash, positions);
+      for (uint32_t position : positions) {
+        *amountOut += m_availableTransfers[position].amount;
       }
 
-      auto spentOutputsRange = m_spentTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
-      for (auto it = spentOutputsRange.first; it != spentOutputsRange.second; ++it) {
-        *amountOut += it->amount;
+      findTransactionTransfers(m_spentTransfers, transactionHash, positions);
+      for (uint32_t position : positions) {
+        *amountOut += m_spentTransfers[position].amount;
       }
     }
   }
 
   if (amountIn != nullptr) {
     *amountIn = 0;
-    auto rangeInputs = m_spentTransfers.get<SpendingTransactionIndex>().equal_range(transactionHash);
-    for (auto it = rangeInputs.first; it != rangeInputs.second; ++it) {
-      *amountIn += it->amount;
+    findSpendingTransactionTransfers(m_spentTransfers, transactionHash, positions);
+    for (uint32_t position : positions) {
+      *amountIn += m_spentTransfers[position].amount;
     }
   }
 
@@ -742,28 +951,29 @@ std::vector<TransactionOutputInformation> TransfersContainer::getTransactionOutp
 
   std::vector<TransactionOutputInformation> result;
 
-  auto availableRange = m_availableTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
-  for (auto i = availableRange.first; i != availableRange.second; ++i) {
-    const auto& t = *i;
+  std::vector<uint32_t> positions;
+  findTransactionTransfers(m_availableTransfers, transactionHash, positions);
+  for (uint32_t position : positions) {
+    const auto& t = m_availableTransfers[position];
     if (isIncluded(t, flags)) {
       result.push_back(t);
     }
   }
 
   if ((flags & IncludeStateLocked) != 0) {
-    auto unconfirmedRange = m_unconfirmedTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
-    for (auto i = unconfirmedRange.first; i != unconfirmedRange.second; ++i) {
-      if (isIncluded(*i, IncludeStateLocked, flags)) {
-        result.push_back(*i);
+    findTransactionTransfers(m_unconfirmedTransfers, transactionHash, positions);
+    for (uint32_t position : positions) {
+      if (isIncluded(m_unconfirmedTransfers[position], IncludeStateLocked, flags)) {
+        result.push_back(m_unconfirmedTransfers[position]);
       }
     }
   }
 
   if ((flags & IncludeStateSpent) != 0) {
-    auto spentRange = m_spentTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
-    for (auto i = spentRange.first; i != spentRange.second; ++i) {
-      if (isIncluded(*i, IncludeStateAll, flags)) {
-        result.push_back(*i);
+    findTransactionTransfers(m_spentTransfers, transactionHash, positions);
+    for (uint32_t position : positions) {
+      if (isIncluded(m_spentTransfers[position], IncludeStateAll, flags)) {
+        result.push_back(m_spentTransfers[position]);
       }
     }
   }
@@ -779,10 +989,11 @@ std::vector<TransactionOutputInformation> TransfersContainer::getTransactionInpu
   std::lock_guard<std::mutex> lk(m_mutex);
 
   std::vector<TransactionOutputInformation> result;
-  auto transactionInputsRange = m_spentTransfers.get<SpendingTransactionIndex>().equal_range(transactionHash);
-  for (auto it = transactionInputsRange.first; it != transactionInputsRange.second; ++it) {
-    if (isIncluded(*it, IncludeStateUnlocked, flags)) {
-      result.push_back(*it);
+  std::vector<uint32_t> positions;
+  findSpendingTransactionTransfers(m_spentTransfers, transactionHash, positions);
+  for (uint32_t position : positions) {
+    if (isIncluded(m_spentTransfers[position], IncludeStateUnlocked, flags)) {
+      result.push_back(m_spentTransfers[position]);
     }
   }
 
@@ -827,13 +1038,12 @@ bool TransfersContainer::getTransfer(const Crypto::Hash& transactionHash, uint32
 
   std::lock_guard<std::mutex> lk(m_mutex);
 
-  auto& availableIndex = m_availableTransfers.get<TransactionOutputKeyIndex>();
-
-  auto availableIt = availableIndex.find(transferId);
-  if (availableIt != availableIndex.end()) {
-    transfer = *availableIt;
+  uint32_t available = findTransfer(m_availableTransfers, transferId);
+  if (available != AvailableTransfers::NPOS) {
+    const TransactionOutputInformationEx& availableTransfer = m_availableTransfers[available];
+    transfer = availableTransfer;
 
-    if (!isSpendTimeUnlocked(*availableIt) || m_currentHeight < availableIt->blockHeight + m_transactionSpendableAge) {
+    if (!isSpendTimeUnlocked(availableTransfer) || m_currentHeight < availableTransfer.blockHeight + m_transactionSpendableAge) {
       transferState = TransferState::TransferLocked;
     } else {
       transferState = TransferState::TransferAvailable;
@@ -842,20 +1052,16 @@ bool TransfersContainer::getTransfer(const Crypto::Hash& transactionHash, uint32
     return true;
   }
 
-  auto& unconfirmedIndex = m_unconfirmedTransfers.get<TransactionOutputKeyIndex>();
-
-  auto unconfirmedIt = unconfirmedIndex.find(transferId);
-  if (unconfirmedIt != unconfirmedIndex.end()) {
-    transfer = *unconfirmedIt;
+  uint32_t unconfirmed = findTransfer(m_unconfirmedTransfers, transferId);
+  if (unconfirmed != UnconfirmedTransfers::NPOS) {
+    transfer = m_unconfirmedTransfers[unconfirmed];
     transferState = TransferState::TransferUnconfirmed;
     return true;
   }
 
-  auto& spentIndex = m_spentTransfers.get<TransactionOutputKeyIndex>();
-
-  auto spentIt = spentIndex.find(transferId);
-  if (spentIt != spentIndex.end()) {
-    transfer = *unconfirmedIt;
+  uint32_t spent = findTransfer(m_spentTransfers, transferId);
+  if (spent != SpentTransfers::NPOS) {
+    transfer = m_spentTransfers[spent];
     transferState = TransferState::TransferSpent;
     return true;
   }
@@ -875,11 +1081,13 @@ void TransfersContainer::save(std::ostream& os) {
   writeSequence<TransactionOutputInformationEx>(m_unconfirmedTransfers.begin(), m_unconfirmedTransfers.end(), "unconfirmedTransfers", s);
   writeSequence<TransactionOutputInformationEx>(m_availableTransfers.begin(), m_availableTransfers.end(), "availableTransfers", s);
   writeSequence<SpentTransactionOutput>(m_spentTransfers.begin(), m_spentTransfers.end(), "spentTransfers", s);
-  writeSequence<TransferUnlockJob>(m_transfersUnlockJobs.begin(), m_transfersUnlockJobs.end(), "transfersUnlockJobs", s);
+  auto transfersUnlockJobs = m_transfersUnlockJobs.getJobs();
+  writeSequence<TransferUnlockJob>(transfersUnlockJobs.begin(), transfersUnlockJobs.end(), "transfersUnlockJobs", s);
 }
 
 void TransfersContainer::load(std::istream& in) {
   std::lock_guard<std::mutex> lk(m_mutex);
+  Common::MemoryScope memoryScope(Common::MemorySubsystem::TransfersContainer);
   StdInputStream stream(in);
   CryptoNote::BinaryInputStreamSerializer s(stream);
 
@@ -891,20 +1099,22 @@ void TransfersContainer::load(std::istream& in) {
   }
 
   uint32_t currentHeight = 0;
-  TransactionMultiIndex transactions;
-  UnconfirmedTransfersMultiIndex unconfirmedTransfers;
-  AvailableTransfersMultiIndex availableTransfers;
-  SpentTransfersMultiIndex spentTransfers;
-  TransfersUnlockMultiIndex transfersUnlockJobs;
+  Transactions transactions;
+  UnconfirmedTransfers unconfirmedTransfers;
+  AvailableTransfers availableTransfers;
+  SpentTransfers spentTransfers;
+  TransfersUnlockJobs transfersUnlockJobs;
 
   s(currentHeight, "height");
-  readSequence<TransactionInformation>(std::inserter(transactions, transactions.end()), "transactions", s);
-  readSequence<TransactionOutputInformationEx>(std::inserter(unconfirmedTransfers, unconfirmedTransfers.end()), "unconfirmedTransfers", s);
-  readSequence<TransactionOutputInformationEx>(std::inserter(availableTransfers, availableTransfers.end()), "availableTransfers", s);
-  readSequence<SpentTransactionOutput>(std::inserter(spentTransfers, spentTransfers.end()), "spentTransfers", s);
+  readFlatSequence<TransactionInformation>(transactions, "transactions", s);
+  readFlatSequence<TransactionOutputInformationEx>(unconfirmedTransfers, "unconfirmedTransfers", s);
+  readFlatSequence<TransactionOutputInformationEx>(availableTransfers, "availableTransfers", s);
+  readFlatSequence<SpentTransactionOutput>(spentTransfers, "spentTransfers", s);
 
   if (version != 0) {
-    readSequence<TransferUnlockJob>(std::inserter(transfersUnlockJobs, transfersUnlockJobs.end()), "transfersUnlockJobs", s);
+    std::vector<TransferUnlockJob> jobs;
+    readSequence<TransferUnlockJob>(std::back_inserter(jobs), "transfersUnlockJobs", s);
+    transfersUnlockJobs.assign(std::move(jobs));
   } else {
     rebuildTransfersUnlockJobs(transfersUnlockJobs, availableTransfers, spentTransfers);
   }
@@ -915,19 +1125,35 @@ void TransfersContainer::load(std::istream& in) {
   m_availableTransfers = std::move(availableTransfers);
   m_spentTransfers = std::move(spentTransfers);
   m_transfersUnlockJobs = std::move(transfersUnlockJobs);
+  rebuildBalance();
 }
 
-void TransfersContainer::rebuildTransfersUnlockJobs(TransfersUnlockMultiIndex& transfersUnlockJobs, const AvailableTransfersMultiIndex& availableTransfers,
-    const SpentTransfersMultiIndex& spentTransfers) {
+/**
+ * \pre m_mutex is locked
+ */
+void TransfersContainer::rebuildBalance() {
+  m_balance.clear(m_currentHeight);
+
+  for (const auto& transfer : m_availableTransfers) {
+    m_balance.add(transfer);
+  }
+
+  for (const auto& transfer : m_unconfirmedTransfers) {
+    m_balance.add(transfer);
+  }
+}
+
+void TransfersContainer::rebuildTransfersUnlockJobs(TransfersUnlockJobs& transfersUnlockJobs, const AvailableTransfers& availableTransfers,
+    const SpentTransfers& spentTransfers) {
 
   for (auto it = availableTransfers.begin(); it != availableTransfers.end(); ++it) {
     TransferUnlockJob job = makeTransferUnlockJob(*it, static_cast<uint32_t>(m_transactionSpendableAge));
-    transfersUnlockJobs.emplace(std::move(job));
+    transfersUnlockJobs.insert(job);
   }
 
   for (auto it = spentTransfers.begin(); it != spentTransfers.end(); ++it) {
     TransferUnlockJob job = makeTransferUnlockJob(*it, static_cast<uint32_t>(m_transactionSpendableAge));
-    transfersUnlockJobs.emplace(std::move(job));
+    transfersUnlockJobs.insert(job);
   }
 }
 
@@ -981,19 +1207,12 @@ bool TransfersContainer::isIncluded(const TransactionOutputInformationEx& output
 void TransfersContainer::addUnlockJob(const TransactionOutputInformationEx& output) {
   TransferUnlockJob job = makeTransferUnlockJob(output, static_cast<uint32_t>(m_transactionSpendableAge));
 
-  auto r = m_transfersUnlockJobs.emplace(std::move(job));
-  assert(r.second);
+  m_transfersUnlockJobs.insert(job);
 }
 
 void TransfersContainer::deleteUnlockJob(const TransactionOutputInformationEx& output) {
-  auto& index = m_transfersUnlockJobs.get<TransactionOutputKeyIndex>();
-
-  auto it = index.find(output.getTransactionOutputKey());
-  if (it == index.end()) {
-    return;
-  }
-
-  index.erase(it);
+  TransferUnlockJob job = makeTransferUnlockJob(output, static_cast<uint32_t>(m_transactionSpendableAge));
+  m_transfersUnlockJobs.erase(job.unlockHeight, job.transactionOutputKey);
 }
 
 /**
@@ -1005,20 +1224,19 @@ std::vector<TransactionOutputInformation> TransfersContainer::getUnlockingTransf
     throw std::invalid_argument("New height is less then current height");
   }
 
-  auto& index = m_transfersUnlockJobs.get<TransferUnlockHeightIndex>();
-  auto start = (prevHeight == 0) ? index.begin() : index.upper_bound(prevHeight + 1);
-  auto end = index.upper_bound(currentHeight + 1);
+  uint64_t firstHeight = (prevHeight == 0) ? 0 : static_cast<uint64_t>(prevHeight) + 2;
+  auto outputKeys = m_transfersUnlockJobs.getOutputs(firstHeight, static_cast<uint64_t>(currentHeight) + 1);
 
-  if (start == end) {
+  if (outputKeys.empty()) {
     //no transfers to unlock
     return std::vector<TransactionOutputInformation>();
   }
 
   std::vector<TransactionOutputInformation> unlockingTransfers;
-  unlockingTransfers.reserve(std::distance(start, end));
+  unlockingTransfers.reserve(outputKeys.size());
 
-  for (auto it = start; it != end; ++it) {
-    TransactionOutputInformation output = getAvailableOutput(it->transactionOutputKey);
+  for (const auto& outputKey : outputKeys) {
+    TransactionOutputInformation output = getAvailableOutput(outputKey);
     unlockingTransfers.emplace_back(std::move(output));
   }
 
@@ -1035,18 +1253,16 @@ void TransfersContainer::getLockingTransfers(uint32_t prevHeight, uint32_t curre
     return;
   }
 
-  auto& index = m_transfersUnlockJobs.get<TransferUnlockHeightIndex>();
-  auto start = index.upper_bound(currentHeight + 1);
-  auto end = index.upper_bound(prevHeight + 1);
+  auto outputKeys = m_transfersUnlockJobs.getOutputs(static_cast<uint64_t>(currentHeight) + 2, static_cast<uint64_t>(prevHeight) + 1);
 
-  if (start == end) {
+  if (outputKeys.empty()) {
     //no transfers to lock
     return;
   }
 
-  lockingTransfers.reserve(lockingTransfers.size() + std::distance(start, end));
-  for (auto it = start; it != end; ++it) {
-    TransactionOutputInformation output = getAvailableOutput(it->transactionOutputKey);
+  lockingTransfers.reserve(lockingTransfers.size() + outputKeys.size());
+  for (const auto& outputKey : outputKeys) {
+    TransactionOutputInformation output = getAvailableOutput(outputKey);
     lockingTransfers.emplace_back(std::move(output));
   }
 }
@@ -1056,15 +1272,14 @@ void TransfersContainer::getLockingTransfers(uint32_t prevHeight, uint32_t curre
  *  \pre requested output must exist
  */
 TransactionOutputInformation TransfersContainer::getAvailableOutput(const TransactionOutputKey& transactionOutputKey) const {
-  auto& availableIndex = m_availableTransfers.get<TransactionOutputKeyIndex>();
-  auto availableIt = availableIndex.find(transactionOutputKey);
+  uint32_t available = findTransfer(m_availableTransfers, transactionOutputKey);
 
-  assert(availableIt != availableIndex.end());
-  if (availableIt == availableIndex.end()) {
+  assert(available != AvailableTransfers::NPOS);
+  if (available == AvailableTransfers::NPOS) {
     throw std::invalid_argument("The output is supposed to be available");
   }
 
-  return *availableIt;
+  return m_availableTransfers[available];
 }
 
 }
@@ -21,12 +21,6 @@
 #include <unordered_map>
 #include <mutex>
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/mem_fun.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-
 #include "crypto/crypto.h"
 #include "CryptoNoteCore/CryptoNoteBasic.h"
 #include "CryptoNoteCore/CryptoNoteSerialization.h"
@@ -36,11 +30,23 @@
 
 #include "ITransaction.h"
 #include "ITransfersContainer.h"
+#include "FlatTransfersIndex.h"
+#include "TransfersBalance.h"
 
 namespace CryptoNote {
 
 struct TransactionOutputInformationIn;
 
+// Lookup indices of the flat transaction and transfer collections
+namespace TransferIndex {
+  enum : size_t {
+    ByOutputDescriptor = 0,
+    ByContainingTransaction,
+    ByOutputKey,
+    BySpendingTransaction
+  };
+}
+
 struct TransactionOutputKey {
   Crypto::Hash transactionHash;
   uint32_t outputInTransaction;
@@ -102,8 +108,8 @@ struct SpentOutputDescriptorHasher {
   }
 };
 
+// what the consumer hands the container for a new output; keyImage must be set for key outputs
 struct TransactionOutputInformationIn : public TransactionOutputInformation {
-  Crypto::KeyImage keyImage;  //!< \attention Used only for TransactionTypes::OutputType::Key
 };
 
 struct TransactionOutputInformationEx : public TransactionOutputInformationIn {
@@ -140,6 +146,14 @@ struct TransactionOutputInformationEx : public TransactionOutputInformationIn {
 
 };
 
+struct TransferIndexTraits {
+  static const size_t INDEX_COUNT = 3;
+
+  static size_t hash(const TransactionOutputInformationEx& transfer, size_t index);
+  static bool equal(const TransactionOutputInformationEx& a, const TransactionOutputInformationEx& b, size_t index);
+  static bool isUnique(size_t index) { return index == TransferIndex::ByOutputKey; }
+};
+
 struct TransactionBlockInfo {
   uint32_t height;
   uint64_t timestamp;
@@ -169,6 +183,14 @@ struct SpentTransactionOutput : TransactionOutputInformationEx {
   }
 };
 
+struct SpentTransferIndexTraits {
+  static const size_t INDEX_COUNT = 4;
+
+  static size_t hash(const SpentTransactionOutput& transfer, size_t index);
+  static bool equal(const SpentTransactionOutput& a, const SpentTransactionOutput& b, size_t index);
+  static bool isUnique(size_t index) { return index == TransferIndex::ByOutputDescriptor || index == TransferIndex::ByOutputKey; }
+};
+
 struct TransferUnlockJob {
   uint32_t unlockHeight;
   TransactionOutputKey transactionOutputKey;
@@ -181,6 +203,44 @@ struct TransferUnlockJob {
   }
 };
 
+// Unlock jobs kept sorted by unlockHeight in one flat array. New jobs almost
+// always land at the back; erased jobs are only marked and get compacted
+// away in bulk, so spending an old output doesn't shift the whole array.
+class TransfersUnlockJobs {
+public:
+  TransfersUnlockJobs();
+
+  size_t size() const { return m_entries.size() - m_erasedCount; }
+  void clear();
+  void assign(std::vector<TransferUnlockJob>&& jobs);
+
+  void insert(const TransferUnlockJob& job);
+  bool erase(uint32_t unlockHeight, const TransactionOutputKey& transactionOutputKey);
+
+  // Outputs of the jobs with firstHeight <= unlockHeight <= lastHeight, in unlockHeight order
+  std::vector<TransactionOutputKey> getOutputs(uint64_t firstHeight, uint64_t lastHeight) const;
+  std::vector<TransferUnlockJob> getJobs() const;
+
+private:
+  struct Entry {
+    TransferUnlockJob job;
+    bool erased;
+  };
+
+  void compact();
+
+  std::vector<Entry> m_entries;
+  size_t m_erasedCount;
+};
+
+struct TransactionInformationIndexTraits {
+  static const size_t INDEX_COUNT = 1;
+
+  static size_t hash(const TransactionInformation& transaction, size_t index);
+  static bool equal(const TransactionInformation& a, const TransactionInformation& b, size_t index);
+  static bool isUnique(size_t index) { return true; }
+};
+
 enum class KeyImageState {
   Unconfirmed,
   Confirmed,
@@ -227,128 +287,10 @@ public:
   virtual void load(std::istream& in) override;
 
 private:
-  struct ContainingTransactionIndex { };
-  struct SpendingTransactionIndex { };
-  struct SpentOutputDescriptorIndex { };
-  struct TransferUnlockHeightIndex { };
-  struct TransactionOutputKeyIndex { };
-
-  typedef boost::multi_index_container<
-    TransactionInformation,
-    boost::multi_index::indexed_by<
-    boost::multi_index::hashed_unique<BOOST_MULTI_INDEX_MEMBER(TransactionInformation, Crypto::Hash, transactionHash)>,
-    boost::multi_index::ordered_non_unique < BOOST_MULTI_INDEX_MEMBER(TransactionInformation, uint32_t, blockHeight) >
-    >
-  > TransactionMultiIndex;
-
-  typedef boost::multi_index_container<
-    TransactionOutputInformationEx,
-    boost::multi_index::indexed_by<
-      boost::multi_index::hashed_non_unique<
-        boost::multi_index::tag<SpentOutputDescriptorIndex>,
-        boost::multi_index::const_mem_fun<
-          TransactionOutputInformationEx,
-          SpentOutputDescriptor,
-          &TransactionOutputInformationEx::getSpentOutputDescriptor>,
-        SpentOutputDescriptorHasher
-      >,
-      boost::multi_index::hashed_non_unique<
-        boost::multi_index::tag<ContainingTransactionIndex>,
-        boost::multi_index::const_mem_fun<
-          TransactionOutputInformationEx,
-          const Crypto::Hash&,
-          &TransactionOutputInformationEx::getTransactionHash>
-      >,
-      boost::multi_index::hashed_unique <
-        boost::multi_index::tag<TransactionOutputKeyIndex>,
-        boost::multi_index::const_mem_fun <
-          TransactionOutputInformationEx,
-          TransactionOutputKey,
-          &TransactionOutputInformationEx::getTransactionOutputKey>,
-        TransactionOutputKeyHasher
-      >
-    >
-  > UnconfirmedTransfersMultiIndex;
-
-  typedef boost::multi_index_container<
-    TransactionOutputInformationEx,
-    boost::multi_index::indexed_by<
-      boost::multi_index::hashed_non_unique<
-        boost::multi_index::tag<SpentOutputDescriptorIndex>,
-        boost::multi_index::const_mem_fun<
-          TransactionOutputInformationEx,
-          SpentOutputDescriptor,
-          &TransactionOutputInformationEx::getSpentOutputDescriptor>,
-        SpentOutputDescriptorHasher
-      >,
-      boost::multi_index::hashed_non_unique<
-        boost::multi_index::tag<ContainingTransactionIndex>,
-        boost::multi_index::const_mem_fun<
-          TransactionOutputInformationEx,
-          const Crypto::Hash&,
-          &TransactionOutputInformationEx::getTransactionHash>
-      >,
-      boost::multi_index::hashed_unique <
-        boost::multi_index::tag<TransactionOutputKeyIndex>,
-        boost::multi_index::const_mem_fun <
-          TransactionOutputInformationEx,
-          TransactionOutputKey,
-          &TransactionOutputInformationEx::getTransactionOutputKey>,
-        TransactionOutputKeyHasher
-      >
-    >
-  > AvailableTransfersMultiIndex;
-
-  typedef boost::multi_index_container<
-    SpentTransactionOutput,
-    boost::multi_index::indexed_by<
-      boost::multi_index::hashed_unique<
-        boost::multi_index::tag<SpentOutputDescriptorIndex>,
-        boost::multi_index::const_mem_fun<
-    TransactionOutputInformationEx,
-          SpentOutputDescriptor,
-          &TransactionOutputInformationEx::getSpentOutputDescriptor>,
-        SpentOutputDescriptorHasher
-      >,
-      boost::multi_index::hashed_non_unique<
-        boost::multi_index::tag<ContainingTransactionIndex>,
-        boost::multi_index::const_mem_fun<
-          TransactionOutputInformationEx,
-          const Crypto::Hash&,
-          &SpentTransactionOutput::getTransactionHash>
-      >,
-      boost::multi_index::hashed_non_unique <
-        boost::multi_index::tag<SpendingTransactionIndex>,
-        boost::multi_index::const_mem_fun <
-          SpentTransactionOutput,
-          const Crypto::Hash&,
-          &SpentTransactionOutput::getSpendingTransactionHash>
-      >,
-      boost::multi_index::hashed_unique <
-        boost::multi_index::tag<TransactionOutputKeyIndex>,
-        boost::multi_index::const_mem_fun <
-          TransactionOutputInformationEx,
-          TransactionOutputKey,
-          &TransactionOutputInformationEx::getTransactionOutputKey>,
-        TransactionOutputKeyHasher
-      >
-    >
-  > SpentTransfersMultiIndex;
-
-  typedef boost::multi_index_container<
-    TransferUnlockJob,
-    boost::multi_index::indexed_by<
-      boost::multi_index::ordered_non_unique<
-        boost::multi_index::tag<TransferUnlockHeightIndex>,
-        BOOST_MULTI_INDEX_MEMBER(TransferUnlockJob, uint32_t, unlockHeight)
-      >,
-      boost::multi_index::hashed_unique<
-        boost::multi_index::tag<TransactionOutputKeyIndex>,
-        BOOST_MULTI_INDEX_MEMBER(TransferUnlockJob, TransactionOutputKey, transactionOutputKey),
-        TransactionOutputKeyHasher
-      >
-    >
-  > TransfersUnlockMultiIndex;
+  typedef FlatIndexedVector<TransactionInformation, TransactionInformationIndexTraits> Transactions;
+  typedef FlatIndexedVector<TransactionOutputInformationEx, TransferIndexTraits> UnconfirmedTransfers;
+  typedef FlatIndexedVector<TransactionOutputInformationEx, TransferIndexTraits> AvailableTransfers;
+  typedef FlatIndexedVector<SpentTransactionOutput, SpentTransferIndexTraits> SpentTransfers;
 
 private:
   void addTransaction(const TransactionBlockInfo& block, const ITransactionReader& tx, std::vector<std::string>&& messages);
@@ -356,6 +298,8 @@ private:
                              const std::vector<TransactionOutputInformationIn>& transfers);
   bool addTransactionInputs(const TransactionBlockInfo& block, const ITransactionReader& tx);
   void deleteTransactionTransfers(const Crypto::Hash& transactionHash);
+  void rebuildBalance();
+  uint64_t scanBalance(uint32_t flags) const;
   bool isSpendTimeUnlocked(const TransactionOutputInformationEx& info) const;
   bool isIncluded(const TransactionOutputInformationEx& info, uint32_t flags) const;
   static bool isIncluded(const TransactionOutputInformationEx& output, uint32_t state, uint32_t flags);
@@ -369,16 +313,17 @@ private:
 
   void copyToSpent(const TransactionBlockInfo& block, const ITransactionReader& tx, size_t inputIndex, const TransactionOutputInformationEx& output);
 
-  void rebuildTransfersUnlockJobs(TransfersUnlockMultiIndex& transfersUnlockJobs, const AvailableTransfersMultiIndex& availableTransfers,
-                                  const SpentTransfersMultiIndex& spentTransfers);
+  void rebuildTransfersUnlockJobs(TransfersUnlockJobs& transfersUnlockJobs, const AvailableTransfers& availableTransfers,
+                                  const SpentTransfers& spentTransfers);
   std::vector<TransactionOutputInformation> doAdvanceHeight(uint32_t height);
 
 private:
-  TransactionMultiIndex m_transactions;
-  UnconfirmedTransfersMultiIndex m_unconfirmedTransfers;
-  AvailableTransfersMultiIndex m_availableTransfers;
-  SpentTransfersMultiIndex m_spentTransfers;
-  TransfersUnlockMultiIndex m_transfersUnlockJobs;
+  Transactions m_transactions;
+  UnconfirmedTransfers m_unconfirmedTransfers;
+  AvailableTransfers m_availableTransfers;
+  SpentTransfers m_spentTransfers;
+  TransfersUnlockJobs m_transfersUnlockJobs;
+  TransfersBalance m_balance;
   //std::unordered_map<KeyImage, KeyOutputInfo, boost::hash<KeyImage>> m_keyImages;
 
   uint32_t m_currentHeight; // current height is needed to check if a transfer is unlocked
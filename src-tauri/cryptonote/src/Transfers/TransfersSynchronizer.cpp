@@ -28,10 +28,12 @@ using namespace Crypto;
 
 namespace CryptoNote {
 
-const uint32_t TRANSFERS_STORAGE_ARCHIVE_VERSION = 0;
+// version 1 appends the state of catch-up consumers
+const uint32_t TRANSFERS_STORAGE_ARCHIVE_VERSION = 1;
 
-TransfersSyncronizer::TransfersSyncronizer(const CryptoNote::Currency& currency, Logging::ILogger& logger, IBlockchainSynchronizer& sync, INode& node) :
-  m_currency(currency), m_logger(logger, "TransfersSyncronizer"), m_sync(sync), m_node(node) {
+TransfersSyncronizer::TransfersSyncronizer(const CryptoNote::Currency& currency, Logging::ILogger& logger, IBlockchainSynchronizer& sync, INode& node,
+  size_t workerThreads, size_t workerQueueDepth) :
+  m_currency(currency), m_logger(logger, "TransfersSyncronizer"), m_workerPool(workerThreads, workerQueueDepth), m_sync(sync), m_node(node) {
 }
 
 TransfersSyncronizer::~TransfersSyncronizer() {
@@ -39,39 +41,170 @@ TransfersSyncronizer::~TransfersSyncronizer() {
   for (const auto& kv : m_consumers) {
     m_sync.removeConsumer(kv.second.get());
   }
+
+  for (const auto& catchUp : m_catchUpConsumers) {
+    m_sync.removeConsumer(catchUp.consumer.get());
+  }
 }
 
 void TransfersSyncronizer::initTransactionPool(const std::unordered_set<Crypto::Hash>& uncommitedTransactions) {
   for (auto it = m_consumers.begin(); it != m_consumers.end(); ++it) {
     it->second->initTransactionPool(uncommitedTransactions);
   }
+
+  for (const auto& catchUp : m_catchUpConsumers) {
+    catchUp.consumer->initTransactionPool(uncommitedTransactions);
+  }
+}
+
+std::unique_ptr<TransfersConsumer> TransfersSyncronizer::createConsumer(const Crypto::SecretKey& viewSecretKey) {
+  std::unique_ptr<TransfersConsumer> consumer(
+    new TransfersConsumer(m_currency, m_node, m_logger.getLogger(), viewSecretKey, m_workerPool));
+
+  m_sync.addConsumer(consumer.get());
+  consumer->addObserver(this);
+  return consumer;
 }
 
 ITransfersSubscription& TransfersSyncronizer::addSubscription(const AccountSubscription& acc) {
   auto it = m_consumers.find(acc.keys.address.viewPublicKey);
 
   if (it == m_consumers.end()) {
-    std::unique_ptr<TransfersConsumer> consumer(
-      new TransfersConsumer(m_currency, m_node, m_logger.getLogger(), acc.keys.viewSecretKey));
-
-    m_sync.addConsumer(consumer.get());
-    consumer->addObserver(this);
-    it = m_consumers.insert(std::make_pair(acc.keys.address.viewPublicKey, std::move(consumer))).first;
+    it = m_consumers.insert(std::make_pair(acc.keys.address.viewPublicKey, createConsumer(acc.keys.viewSecretKey))).first;
   }
     
   return it->second->addSubscription(acc);
 }
 
+ITransfersSubscription& TransfersSyncronizer::addCatchUpSubscription(const AccountSubscription& acc) {
+  auto mainIt = m_consumers.find(acc.keys.address.viewPublicKey);
+  if (mainIt == m_consumers.end()) {
+    // nothing is synchronized for this view key yet, so there is nobody to hold back
+    return addSubscription(acc);
+  }
+
+  auto existing = getSubscription(acc.keys.address);
+  if (existing != nullptr) {
+    return *existing;
+  }
+
+  // addresses imported together share a consumer as long as it has not scanned anything yet
+  auto it = std::find_if(m_catchUpConsumers.begin(), m_catchUpConsumers.end(), [this, &acc](const CatchUpConsumer& catchUp) {
+    return catchUp.viewKey == acc.keys.address.viewPublicKey && m_sync.getConsumerKnownBlocks(*catchUp.consumer).size() <= 1;
+  });
+
+  if (it == m_catchUpConsumers.end()) {
+    m_catchUpConsumers.push_back(CatchUpConsumer{ acc.keys.address.viewPublicKey, createConsumer(acc.keys.viewSecretKey) });
+    it = std::prev(m_catchUpConsumers.end());
+  }
+
+  m_logger(Logging::INFO) << "Scanning history of " << m_currency.accountAddressAsString(acc.keys.address) << " in a catch-up consumer";
+  return it->consumer->addSubscription(acc);
+}
+
+IBlockchainConsumer* TransfersSyncronizer::getConsumer(const Crypto::PublicKey& viewPublicKey) const {
+  auto it = m_consumers.find(viewPublicKey);
+  return it != m_consumers.end() ? it->second.get() : nullptr;
+}
+
+bool TransfersSyncronizer::hasCaughtUpConsumers() const {
+  std::lock_guard<std::mutex> lock(m_lastBlocksMutex);
+  for (const auto& catchUp : m_catchUpConsumers) {
+    auto mainIt = m_consumers.find(catchUp.viewKey);
+    if (mainIt == m_consumers.end()) {
+      return true;
+    }
+
+    auto catchUpBlock = m_lastBlocks.find(catchUp.consumer.get());
+    auto mainBlock = m_lastBlocks.find(mainIt->second.get());
+    if (catchUpBlock != m_lastBlocks.end() && mainBlock != m_lastBlocks.end() && catchUpBlock->second == mainBlock->second) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+size_t TransfersSyncronizer::mergeCatchUpConsumers() {
+  size_t merged = 0;
+
+  for (auto it = m_catchUpConsumers.begin(); it != m_catchUpConsumers.end();) {
+    auto mainIt = m_consumers.find(it->viewKey);
+    if (mainIt == m_consumers.end()) {
+      // the addresses the main consumer served are gone, the catch-up consumer takes its place
+      m_consumers.insert(std::make_pair(it->viewKey, std::move(it->consumer)));
+      it = m_catchUpConsumers.erase(it);
+      ++merged;
+      continue;
+    }
+
+    auto catchUpBlocks = m_sync.getConsumerKnownBlocks(*it->consumer);
+    auto mainBlocks = m_sync.getConsumerKnownBlocks(*mainIt->second);
+    if (catchUpBlocks.size() != mainBlocks.size() || catchUpBlocks.back() != mainBlocks.back()) {
+      ++it;
+      continue;
+    }
+
+    std::vector<AccountPublicAddress> addresses;
+    it->consumer->getSubscriptions(addresses);
+    for (const auto& address : addresses) {
+      mainIt->second->adoptSubscription(it->consumer->releaseSubscription(address));
+    }
+
+    removeCatchUpConsumer(it++);
+    ++merged;
+  }
+
+  return merged;
+}
+
+void TransfersSyncronizer::removeCatchUpConsumer(std::vector<CatchUpConsumer>::iterator it) {
+  m_sync.removeConsumer(it->consumer.get());
+  {
+    std::lock_guard<std::mutex> lock(m_lastBlocksMutex);
+    m_lastBlocks.erase(it->consumer.get());
+  }
+
+  m_catchUpConsumers.erase(it);
+}
+
+bool TransfersSyncronizer::isCatchUpConsumer(IBlockchainConsumer* consumer) const {
+  return std::any_of(m_catchUpConsumers.begin(), m_catchUpConsumers.end(), [consumer](const CatchUpConsumer& catchUp) {
+    return catchUp.consumer.get() == consumer;
+  });
+}
+
 bool TransfersSyncronizer::removeSubscription(const AccountPublicAddress& acc) {
+  for (auto catchUpIt = m_catchUpConsumers.begin(); catchUpIt != m_catchUpConsumers.end(); ++catchUpIt) {
+    if (catchUpIt->viewKey == acc.viewPublicKey && catchUpIt->consumer->getSubscription(acc) != nullptr) {
+      if (catchUpIt->consumer->removeSubscription(acc)) {
+        removeCatchUpConsumer(catchUpIt);
+      }
+
+      return true;
+    }
+  }
+
   auto it = m_consumers.find(acc.viewPublicKey);
   if (it == m_consumers.end())
     return false;
 
   if (it->second->removeSubscription(acc)) {
     m_sync.removeConsumer(it->second.get());
+    {
+      std::lock_guard<std::mutex> lock(m_lastBlocksMutex);
+      m_lastBlocks.erase(it->second.get());
+    }
+
     m_consumers.erase(it);
 
-    m_subscribers.erase(acc.viewPublicKey);
+    bool viewKeyInUse = std::any_of(m_catchUpConsumers.begin(), m_catchUpConsumers.end(), [&acc](const CatchUpConsumer& catchUp) {
+      return catchUp.viewKey == acc.viewPublicKey;
+    });
+
+    if (!viewKeyInUse) {
+      m_subscribers.erase(acc.viewPublicKey);
+    }
   }
 
   return true;
@@ -81,11 +214,23 @@ void TransfersSyncronizer::getSubscriptions(std::vector<AccountPublicAddress>& s
   for (const auto& kv : m_consumers) {
     kv.second->getSubscriptions(subscriptions);
   }
+
+  for (const auto& catchUp : m_catchUpConsumers) {
+    catchUp.consumer->getSubscriptions(subscriptions);
+  }
 }
 
 ITransfersSubscription* TransfersSyncronizer::getSubscription(const AccountPublicAddress& acc) {
   auto it = m_consumers.find(acc.viewPublicKey);
-  return (it == m_consumers.end()) ? nullptr : it->second->getSubscription(acc);
+  ITransfersSubscription* subscription = (it == m_consumers.end()) ? nullptr : it->second->getSubscription(acc);
+
+  for (auto catchUpIt = m_catchUpConsumers.begin(); subscription == nullptr && catchUpIt != m_catchUpConsumers.end(); ++catchUpIt) {
+    if (catchUpIt->viewKey == acc.viewPublicKey) {
+      subscription = catchUpIt->consumer->getSubscription(acc);
+    }
+  }
+
+  return subscription;
 }
 
 
@@ -107,6 +252,16 @@ std::vector<Crypto::Hash> TransfersSyncronizer::getViewKeyKnownBlocks(const Cryp
 }
 
 void TransfersSyncronizer::onBlocksAdded(IBlockchainConsumer* consumer, const std::vector<Crypto::Hash>& blockHashes) {
+  if (!blockHashes.empty()) {
+    std::lock_guard<std::mutex> lock(m_lastBlocksMutex);
+    m_lastBlocks[consumer] = blockHashes.back();
+  }
+
+  // subscribers follow the chain of the main consumer, catch-up consumers only report transactions
+  if (isCatchUpConsumer(consumer)) {
+    return;
+  }
+
   auto it = findSubscriberForConsumer(consumer);
   if (it != m_subscribers.end()) {
     it->second->notify(&ITransfersSynchronizerObserver::onBlocksAdded, it->first, blockHashes);
@@ -114,6 +269,15 @@ void TransfersSyncronizer::onBlocksAdded(IBlockchainConsumer* consumer, const st
 }
 
 void TransfersSyncronizer::onBlockchainDetach(IBlockchainConsumer* consumer, uint32_t blockIndex) {
+  {
+    std::lock_guard<std::mutex> lock(m_lastBlocksMutex);
+    m_lastBlocks.erase(consumer);
+  }
+
+  if (isCatchUpConsumer(consumer)) {
+    return;
+  }
+
   auto it = findSubscriberForConsumer(consumer);
   if (it != m_subscribers.end()) {
     it->second->notify(&ITransfersSynchronizerObserver::onBlockchainDetach, it->first, blockIndex);
@@ -143,6 +307,10 @@ void TransfersSyncronizer::onTransactionUpdated(IBlockchainConsumer* consumer, c
   }
 }
 
+Common::ThreadPool::Stats TransfersSyncronizer::getWorkerPoolStats() const {
+  return m_workerPool.getStats();
+}
+
 void TransfersSyncronizer::subscribeConsumerNotifications(const Crypto::PublicKey& viewPublicKey, ITransfersSynchronizerObserver* observer) {
   auto it = m_subscribers.find(viewPublicKey);
   if (it != m_subscribers.end()) {
@@ -170,42 +338,57 @@ void TransfersSyncronizer::save(std::ostream& os) {
   s.beginArray(subscriptionCount, "consumers");
 
   for (const auto& consumer : m_consumers) {
-    s.beginObject("");
-    s(const_cast<PublicKey&>(consumer.first), "view_key");
+    saveConsumer(s, consumer.first, *consumer.second);
+  }
 
-    std::stringstream consumerState;
-    // synchronization state
-    m_sync.getConsumerState(consumer.second.get())->save(consumerState);
+  s.endArray();
 
-    std::string blob = consumerState.str();
-    s(blob, "state");
-    
-    std::vector<AccountPublicAddress> subscriptions;
-    consumer.second->getSubscriptions(subscriptions);
-    size_t subCount = subscriptions.size();
+  size_t catchUpCount = m_catchUpConsumers.size();
+  s.beginArray(catchUpCount, "catch_up_consumers");
 
-    s.beginArray(subCount, "subscriptions");
+  for (const auto& catchUp : m_catchUpConsumers) {
+    saveConsumer(s, catchUp.viewKey, *catchUp.consumer);
+  }
 
-    for (auto& addr : subscriptions) {
-      auto sub = consumer.second->getSubscription(addr);
-      if (sub != nullptr) {
-        s.beginObject("");
+  s.endArray();
+}
 
-        std::stringstream subState;
-        assert(sub);
-        sub->getContainer().save(subState);
-        // store data block
-        std::string blob = subState.str();
-        s(addr, "address");
-        s(blob, "state");
+void TransfersSyncronizer::saveConsumer(CryptoNote::ISerializer& s, const Crypto::PublicKey& viewKey, TransfersConsumer& consumer) {
+  s.beginObject("");
+  s(const_cast<PublicKey&>(viewKey), "view_key");
 
-        s.endObject();
-      }
-    }
+  std::stringstream consumerState;
+  // synchronization state
+  m_sync.getConsumerState(&consumer)->save(consumerState);
 
-    s.endArray();
-    s.endObject();
+  std::string blob = consumerState.str();
+  s(blob, "state");
+  
+  std::vector<AccountPublicAddress> subscriptions;
+  consumer.getSubscriptions(subscriptions);
+  size_t subCount = subscriptions.size();
+
+  s.beginArray(subCount, "subscriptions");
+
+  for (auto& addr : subscriptions) {
+    auto sub = consumer.getSubscription(addr);
+    if (sub != nullptr) {
+      s.beginObject("");
+
+      std::stringstream subState;
+      assert(sub);
+      sub->getContainer().save(subState);
+      // store data block
+      std::string blob = subState.str();
+      s(addr, "address");
+      s(blob, "state");
+
+      s.endObject();
+    }
   }
+
+  s.endArray();
+  s.endObject();
 }
 
 namespace {
@@ -243,6 +426,9 @@ void TransfersSyncronizer::load(std::istream& is) {
   };
 
   std::vector<ConsumerState> updatedStates;
+  // previous container state of subscriptions moved to restored catch-up consumers
+  std::vector<std::pair<AccountPublicAddress, std::string>> catchUpSubscriptionStates;
+  size_t catchUpCountBefore = m_catchUpConsumers.size();
 
   try {
     size_t subscriptionCount = 0;
@@ -299,8 +485,85 @@ void TransfersSyncronizer::load(std::istream& is) {
     s.endObject();
     s.endArray();
 
+    size_t catchUpCount = 0;
+    if (version >= 1) {
+      s.beginArray(catchUpCount, "catch_up_consumers");
+    }
+
+    while (catchUpCount--) {
+      s.beginObject("");
+      PublicKey viewKey;
+      s(viewKey, "view_key");
+
+      std::string blob;
+      s(blob, "state");
+
+      std::vector<std::pair<AccountPublicAddress, std::string>> subscriptionStates;
+      size_t subCount = 0;
+      s.beginArray(subCount, "subscriptions");
+
+      while (subCount--) {
+        s.beginObject("");
+
+        AccountPublicAddress acc;
+        std::string state;
+
+        s(acc, "address");
+        s(state, "state");
+        subscriptionStates.emplace_back(acc, std::move(state));
+
+        s.endObject();
+      }
+
+      s.endArray();
+      s.endObject();
+
+      // the wallet subscribed every address to the main consumer, move the ones still catching up out of it
+      auto mainIt = m_consumers.find(viewKey);
+      if (mainIt == m_consumers.end()) {
+        continue;
+      }
+
+      TransfersConsumer* consumer = nullptr;
+      for (const auto& subscriptionState : subscriptionStates) {
+        auto sub = mainIt->second->getSubscription(subscriptionState.first);
+        if (sub == nullptr) {
+          continue;
+        }
+
+        if (consumer == nullptr) {
+          m_catchUpConsumers.push_back(CatchUpConsumer{ viewKey, createConsumer(static_cast<TransfersSubscription*>(sub)->getKeys().viewSecretKey) });
+          consumer = m_catchUpConsumers.back().consumer.get();
+          setObjectState(*m_sync.getConsumerState(consumer), blob);
+        }
+
+        catchUpSubscriptionStates.push_back(std::make_pair(subscriptionState.first, getObjectState(sub->getContainer())));
+        setObjectState(sub->getContainer(), subscriptionState.second);
+        consumer->adoptSubscription(mainIt->second->releaseSubscription(subscriptionState.first));
+      }
+    }
+
   } catch (...) {
     // rollback state
+    while (m_catchUpConsumers.size() > catchUpCountBefore) {
+      auto catchUpIt = std::prev(m_catchUpConsumers.end());
+      auto& mainConsumer = *m_consumers.find(catchUpIt->viewKey)->second;
+      std::vector<AccountPublicAddress> addresses;
+      catchUpIt->consumer->getSubscriptions(addresses);
+      for (const auto& address : addresses) {
+        mainConsumer.adoptSubscription(catchUpIt->consumer->releaseSubscription(address));
+      }
+
+      removeCatchUpConsumer(catchUpIt);
+    }
+
+    for (const auto& sub : catchUpSubscriptionStates) {
+      auto subscription = getSubscription(sub.first);
+      if (subscription != nullptr) {
+        setObjectState(subscription->getContainer(), sub.second);
+      }
+    }
+
     for (const auto& consumerState : updatedStates) {
       auto consumer = m_consumers.find(consumerState.viewKey)->second.get();
       setObjectState(*m_sync.getConsumerState(consumer), consumerState.state);
@@ -319,11 +582,20 @@ bool TransfersSyncronizer::findViewKeyForConsumer(IBlockchainConsumer* consumer,
     return subscription.second.get() == consumer;
   });
 
-  if (it == m_consumers.end()) {
+  if (it != m_consumers.end()) {
+    viewKey = it->first;
+    return true;
+  }
+
+  auto catchUpIt = std::find_if(m_catchUpConsumers.begin(), m_catchUpConsumers.end(), [consumer](const CatchUpConsumer& catchUp) {
+    return catchUp.consumer.get() == consumer;
+  });
+
+  if (catchUpIt == m_catchUpConsumers.end()) {
     return false;
   }
 
-  viewKey = it->first;
+  viewKey = catchUpIt->viewKey;
   return true;
 }
 
@@ -18,12 +18,14 @@
 #pragma once
 
 #include "Common/ObserverManager.h"
+#include "Common/ThreadPool.h"
 #include "ITransfersSynchronizer.h"
 #include "IBlockchainSynchronizer.h"
 #include "TypeHelpers.h"
 
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 #include <cstring>
 
 #include "Logging/LoggerRef.h"
@@ -36,10 +38,12 @@ namespace CryptoNote {
  
 class TransfersConsumer;
 class INode;
+class ISerializer;
 
 class TransfersSyncronizer : public ITransfersSynchronizer, public IBlockchainConsumerObserver {
 public:
-  TransfersSyncronizer(const CryptoNote::Currency& currency, Logging::ILogger& logger, IBlockchainSynchronizer& sync, INode& node);
+  TransfersSyncronizer(const CryptoNote::Currency& currency, Logging::ILogger& logger, IBlockchainSynchronizer& sync, INode& node,
+    size_t workerThreads = 0, size_t workerQueueDepth = 0);
   virtual ~TransfersSyncronizer();
 
   void initTransactionPool(const std::unordered_set<Crypto::Hash>& uncommitedTransactions);
@@ -51,9 +55,24 @@ public:
   virtual ITransfersSubscription* getSubscription(const AccountPublicAddress& acc) override;
   virtual std::vector<Crypto::Hash> getViewKeyKnownBlocks(const Crypto::PublicKey& publicViewKey) override;
 
+  // Scans the history of an address from its sync start in a catch-up consumer of its own, so the
+  // consumer already following the chain for this view key is neither rewound nor held back.
+  // The blockchain synchronizer must be stopped.
+  ITransfersSubscription& addCatchUpSubscription(const AccountSubscription& acc);
+  // cheap hint that a catch-up consumer may have reached the top of its view key's consumer
+  bool hasCaughtUpConsumers() const;
+  // Moves the subscriptions of catch-up consumers that reached the main consumer of their view key
+  // into it and returns the number of consumers merged. The blockchain synchronizer must be stopped.
+  size_t mergeCatchUpConsumers();
+
+  // consumer following the chain for a view key, nullptr if there is none
+  IBlockchainConsumer* getConsumer(const Crypto::PublicKey& viewPublicKey) const;
+
   void subscribeConsumerNotifications(const Crypto::PublicKey& viewPublicKey, ITransfersSynchronizerObserver* observer);
   void unsubscribeConsumerNotifications(const Crypto::PublicKey& viewPublicKey, ITransfersSynchronizerObserver* observer);
   void addPublicKeysSeen(const AccountPublicAddress& acc, const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey);
+  // utilisation of the pool shared by all consumers for output scanning
+  Common::ThreadPool::Stats getWorkerPoolStats() const;
   
   // IStreamSerializable
   virtual void save(std::ostream& os) override;
@@ -62,10 +81,25 @@ public:
 private:
   Logging::LoggerRef m_logger;
 
+  // must outlive the consumers that borrow it
+  Common::ThreadPool m_workerPool;
+
   // map { view public key -> consumer }
   typedef std::unordered_map<Crypto::PublicKey, std::unique_ptr<TransfersConsumer>> ConsumersContainer;
   ConsumersContainer m_consumers;
 
+  struct CatchUpConsumer {
+    Crypto::PublicKey viewKey;
+    std::unique_ptr<TransfersConsumer> consumer;
+  };
+
+  // added and removed only while the blockchain synchronizer is stopped
+  std::vector<CatchUpConsumer> m_catchUpConsumers;
+
+  // last block reported by each consumer, guarded by m_lastBlocksMutex
+  std::unordered_map<IBlockchainConsumer*, Crypto::Hash> m_lastBlocks;
+  mutable std::mutex m_lastBlocksMutex;
+
   typedef Tools::ObserverManager<ITransfersSynchronizerObserver> SubscribersNotifier;
   typedef std::unordered_map<Crypto::PublicKey, std::unique_ptr<SubscribersNotifier>> SubscribersContainer;
   SubscribersContainer m_subscribers;
@@ -82,6 +116,11 @@ private:
   virtual void onTransactionUpdated(IBlockchainConsumer* consumer, const Crypto::Hash& transactionHash,
     const std::vector<ITransfersContainer*>& containers) override;
 
+  std::unique_ptr<TransfersConsumer> createConsumer(const Crypto::SecretKey& viewSecretKey);
+  void removeCatchUpConsumer(std::vector<CatchUpConsumer>::iterator it);
+  bool isCatchUpConsumer(IBlockchainConsumer* consumer) const;
+  void saveConsumer(CryptoNote::ISerializer& s, const Crypto::PublicKey& viewKey, TransfersConsumer& consumer);
+
   bool findViewKeyForConsumer(IBlockchainConsumer* consumer, Crypto::PublicKey& viewKey) const;
   SubscribersContainer::const_iterator findSubscriberForConsumer(IBlockchainConsumer* consumer) const;
 };
@@ -0,0 +1,155 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "FeeEstimator.h"
+
+#include <algorithm>
+
+namespace CryptoNote {
+
+namespace {
+
+const size_t TRANSACTION_VERSION_SIZE = 1;
+const size_t UNLOCK_TIME_SIZE = 1;
+const size_t PUBLIC_KEY_EXTRA_SIZE = 1 + 32;  // tag + transaction public key
+const size_t KEY_IMAGE_SIZE = 32;
+const size_t SIGNATURE_SIZE = 64;
+const size_t OUTPUT_KEY_SIZE = 1 + 32;        // target tag + key
+// Relative global indexes of ring members; four varint bytes covers indexes below 2^28
+const size_t KEY_OFFSET_SIZE = 4;
+
+}
+
+FeeEstimator::FeeEstimator(uint64_t minimumFee, uint64_t dustThreshold, size_t maxTransactionSize) :
+  m_minimumFee(minimumFee),
+  m_dustThreshold(dustThreshold),
+  m_maxTransactionSize(maxTransactionSize),
+  m_valid(false),
+  m_outputsVersion(0),
+  m_generation(0) {
+  m_inputSizes.reserve(PRECOMPUTED_MIXINS + 1);
+  for (uint64_t mixIn = 0; mixIn <= PRECOMPUTED_MIXINS; ++mixIn) {
+    m_inputSizes.push_back(computeInputSize(mixIn));
+  }
+}
+
+void FeeEstimator::rebuild(uint64_t outputsVersion, const std::vector<uint64_t>& spendingOrder) {
+  m_amountTotals.assign(1, 0);
+  m_amountSizes.assign(1, 0);
+  m_amountTotals.reserve(spendingOrder.size() + 1);
+  m_amountSizes.reserve(spendingOrder.size() + 1);
+
+  for (uint64_t amount : spendingOrder) {
+    m_amountTotals.push_back(m_amountTotals.back() + amount);
+    m_amountSizes.push_back(m_amountSizes.back() + varintSize(amount));
+  }
+
+  m_outputsVersion = outputsVersion;
+  m_valid = true;
+  ++m_generation;
+}
+
+FeeEstimate FeeEstimator::estimate(uint64_t amount, uint64_t mixIn, size_t extraSize) const {
+  FeeEstimate result = FeeEstimate();
+  result.fee = m_minimumFee;
+
+  uint64_t neededMoney = amount + m_minimumFee;
+  auto covering = m_amountTotals.empty() ? m_amountTotals.end() :
+    std::lower_bound(m_amountTotals.begin(), m_amountTotals.end(), neededMoney);
+  result.enoughMoney = covering != m_amountTotals.end();
+
+  // Without enough money, size the transaction as if every output were spent
+  size_t inputCount = m_amountTotals.empty() ? 0 :
+    result.enoughMoney ? static_cast<size_t>(covering - m_amountTotals.begin()) : m_amountTotals.size() - 1;
+  result.inputCount = inputCount;
+  result.changeAmount = result.enoughMoney ? *covering - neededMoney : 0;
+
+  size_t inputSize = mixIn <= PRECOMPUTED_MIXINS ? m_inputSizes[mixIn] : computeInputSize(mixIn);
+  size_t inputsSize = inputCount * inputSize + (inputCount != 0 ? m_amountSizes[inputCount] : 0);
+
+  size_t destinationCount = 0;
+  size_t changeCount = 0;
+  size_t outputsBytes = outputsSize(amount, destinationCount) + outputsSize(result.changeAmount, changeCount);
+  result.outputCount = destinationCount + changeCount;
+
+  size_t extraBytes = PUBLIC_KEY_EXTRA_SIZE + extraSize;
+  result.transactionSize = TRANSACTION_VERSION_SIZE + UNLOCK_TIME_SIZE +
+    varintSize(inputCount) + inputsSize +
+    varintSize(result.outputCount) + outputsBytes +
+    varintSize(extraBytes) + extraBytes;
+  result.fitsSizeLimit = result.transactionSize <= m_maxTransactionSize;
+
+  return result;
+}
+
+size_t FeeEstimator::varintSize(uint64_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+
+  return size;
+}
+
+size_t FeeEstimator::computeInputSize(uint64_t mixIn) {
+  uint64_t ringSize = mixIn + 1;
+  // tag + key offset count + offsets + key image, plus the ring signature stored after the prefix
+  return 1 + varintSize(ringSize) + ringSize * KEY_OFFSET_SIZE + KEY_IMAGE_SIZE + ringSize * SIGNATURE_SIZE;
+}
+
+// Same split as decompose_amount_into_digits: one output per non-zero digit, with the low
+// digits that fit under the dust threshold merged into a single output
+size_t FeeEstimator::outputsSize(uint64_t amount, size_t& count) const {
+  size_t size = 0;
+  count = 0;
+
+  uint64_t dust = 0;
+  bool dustHandled = false;
+  uint64_t order = 1;
+  while (amount != 0) {
+    uint64_t chunk = (amount % 10) * order;
+    amount /= 10;
+    order *= 10;
+
+    if (dust + chunk <= m_dustThreshold) {
+      dust += chunk;
+      continue;
+    }
+
+    if (!dustHandled && dust != 0) {
+      size += varintSize(dust) + OUTPUT_KEY_SIZE;
+      ++count;
+      dustHandled = true;
+    }
+
+    if (chunk != 0) {
+      size += varintSize(chunk) + OUTPUT_KEY_SIZE;
+      ++count;
+    }
+  }
+
+  if (!dustHandled && dust != 0) {
+    size += varintSize(dust) + OUTPUT_KEY_SIZE;
+    ++count;
+  }
+
+  return size;
+}
+
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CryptoNote {
+
+struct FeeEstimate {
+  uint64_t fee;
+  uint64_t changeAmount;
+  size_t transactionSize;
+  size_t inputCount;
+  size_t outputCount;
+  bool enoughMoney;
+  bool fitsSizeLimit;
+};
+
+// Predicts the fee and serialized size of a transfer without selecting mixins, building or
+// signing anything. rebuild() takes the amounts of the spendable outputs in the order
+// selectTransfers spends them; an estimate is then a binary search over their running totals
+// plus a size model of the inputs, outputs and extra the transaction would carry. The per-input
+// size of the common mixin levels is computed once up front.
+class FeeEstimator {
+public:
+  FeeEstimator(uint64_t minimumFee, uint64_t dustThreshold, size_t maxTransactionSize);
+
+  bool isCurrent(uint64_t outputsVersion) const { return m_valid && m_outputsVersion == outputsVersion; }
+  void rebuild(uint64_t outputsVersion, const std::vector<uint64_t>& spendingOrder);
+  void invalidate() { m_valid = false; }
+  // number of rebuilds so far, lets holders of a copy tell whether it is out of date
+  uint64_t generation() const { return m_generation; }
+
+  // extraSize: bytes of extra beyond the transaction public key, e.g. a payment id
+  FeeEstimate estimate(uint64_t amount, uint64_t mixIn, size_t extraSize = 0) const;
+
+  static size_t varintSize(uint64_t value);
+
+private:
+  static const uint64_t PRECOMPUTED_MIXINS = 16;
+
+  static size_t computeInputSize(uint64_t mixIn);
+  size_t outputsSize(uint64_t amount, size_t& count) const;
+
+  uint64_t m_minimumFee;
+  uint64_t m_dustThreshold;
+  size_t m_maxTransactionSize;
+
+  bool m_valid;
+  uint64_t m_outputsVersion;
+  uint64_t m_generation;
+  std::vector<uint64_t> m_amountTotals;  // [i]: sum of the first i outputs of the spending order
+  std::vector<size_t> m_amountSizes;     // [i]: varint bytes of the first i amounts
+  std::vector<size_t> m_inputSizes;      // [mixIn]: bytes of one input without its amount
+};
+
+}
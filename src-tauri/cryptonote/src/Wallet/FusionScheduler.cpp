@@ -0,0 +1,226 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "FusionScheduler.h"
+
+#include <algorithm>
+#include <system_error>
+
+#include <System/EventLock.h>
+#include <System/InterruptedException.h>
+#include <System/Timer.h>
+
+#include "WalletErrors.h"
+
+using namespace Logging;
+
+namespace CryptoNote {
+
+namespace {
+
+const uint32_t MAX_UNSYNCHRONIZED_BLOCKS = 2;
+
+double readyShare(const FusionScheduler::FragmentationMetrics& metrics) {
+  return metrics.totalOutputCount == 0 ? 0.0 : 100.0 * metrics.fusionReadyCount / metrics.totalOutputCount;
+}
+
+}
+
+FusionSchedulerSettings::FusionSchedulerSettings() :
+  threshold(0),
+  mixin(0),
+  checkInterval(60),
+  idleTime(300),
+  minFusionReadyCount(50),
+  maxTransactionsPerRound(4),
+  maxTransactionsPerHour(12),
+  maxPendingTransactions(4) {
+}
+
+FusionScheduler::FusionScheduler(System::Dispatcher& dispatcher, IWallet& wallet, IFusionManager& fusionManager, INode& node,
+  System::Event& walletLock, const FusionSchedulerSettings& settings, Logging::ILogger& logger) :
+  m_dispatcher(dispatcher),
+  m_wallet(wallet),
+  m_fusionManager(fusionManager),
+  m_node(node),
+  m_walletLock(walletLock),
+  m_settings(settings),
+  m_logger(logger, "FusionScheduler"),
+  m_stopped(true),
+  m_lastActivity(std::chrono::steady_clock::now()),
+  m_stats{{0, 0}, {0, 0}, 0, 0, 0},
+  m_workingContext(dispatcher),
+  m_sleepingContext(dispatcher) {
+}
+
+FusionScheduler::~FusionScheduler() {
+  stop();
+}
+
+void FusionScheduler::start() {
+  if (!m_stopped) {
+    return;
+  }
+
+  m_stopped = false;
+  m_workingContext.spawn([this] { run(); });
+}
+
+void FusionScheduler::stop() {
+  if (m_stopped) {
+    return;
+  }
+
+  m_stopped = true;
+  m_sleepingContext.interrupt();
+  m_sleepingContext.wait();
+  m_workingContext.wait();
+}
+
+void FusionScheduler::notifyActivity() {
+  m_lastActivity = std::chrono::steady_clock::now();
+}
+
+FusionScheduler::Stats FusionScheduler::getStats() const {
+  return m_stats;
+}
+
+void FusionScheduler::run() {
+  m_logger(DEBUGGING) << "Fusion scheduler started, threshold " << m_settings.threshold;
+
+  while (!m_stopped) {
+    m_sleepingContext.spawn([this] {
+      System::Timer timer(m_dispatcher);
+      timer.sleep(m_settings.checkInterval);
+    });
+
+    m_sleepingContext.wait();
+
+    if (m_stopped) {
+      break;
+    }
+
+    try {
+      runRound();
+    } catch (System::InterruptedException&) {
+      break;
+    } catch (std::exception& e) {
+      m_logger(WARNING, BRIGHT_YELLOW) << "Fusion round failed: " << e.what();
+    }
+  }
+
+  m_logger(DEBUGGING) << "Fusion scheduler stopped";
+}
+
+void FusionScheduler::runRound() {
+  auto now = std::chrono::steady_clock::now();
+  if (now - m_lastActivity < m_settings.idleTime || !isNodeSynchronized()) {
+    return;
+  }
+
+  System::EventLock lk(m_walletLock);
+
+  dropConfirmedTransactions();
+  size_t allowed = transactionsAllowed(now);
+  if (allowed == 0) {
+    return;
+  }
+
+  auto estimate = m_fusionManager.estimate(m_settings.threshold, m_settings.sourceAddresses);
+  FragmentationMetrics before{estimate.totalOutputCount, estimate.fusionReadyCount};
+  ++m_stats.roundCount;
+
+  if (before.fusionReadyCount < std::max<size_t>(m_settings.minFusionReadyCount, 1)) {
+    return;
+  }
+
+  size_t sent = 0;
+  while (sent < allowed && !m_stopped) {
+    try {
+      size_t transactionId = m_fusionManager.createFusionTransaction(m_settings.threshold, m_settings.mixin,
+        m_settings.sourceAddresses, m_settings.destinationAddress);
+      m_pendingTransactions.push_back(transactionId);
+      m_sentTimes.push_back(std::chrono::steady_clock::now());
+      ++sent;
+    } catch (std::system_error& e) {
+      if (e.code() != make_error_code(error::NOTHING_TO_OPTIMIZE)) {
+        m_logger(WARNING, BRIGHT_YELLOW) << "Failed to send fusion transaction: " << e.what();
+      }
+
+      break;
+    }
+
+    // a user send may have queued up behind this transaction
+    if (std::chrono::steady_clock::now() - m_lastActivity < m_settings.idleTime) {
+      break;
+    }
+  }
+
+  if (sent == 0) {
+    return;
+  }
+
+  estimate = m_fusionManager.estimate(m_settings.threshold, m_settings.sourceAddresses);
+  FragmentationMetrics after{estimate.totalOutputCount, estimate.fusionReadyCount};
+
+  m_stats.before = before;
+  m_stats.after = after;
+  m_stats.transactionCount += sent;
+  m_stats.pendingTransactionCount = m_pendingTransactions.size();
+
+  m_logger(INFO) << "Sent " << sent << " fusion transaction(s); unlocked outputs " << before.totalOutputCount << " -> " << after.totalOutputCount
+    << ", fusion-ready " << before.fusionReadyCount << " (" << readyShare(before) << "%) -> " << after.fusionReadyCount
+    << " (" << readyShare(after) << "%)";
+}
+
+bool FusionScheduler::isNodeSynchronized() const {
+  uint32_t localBlockCount = m_node.getLocalBlockCount();
+  uint32_t knownBlockCount = m_node.getKnownBlockCount();
+  return localBlockCount != 0 && knownBlockCount <= localBlockCount + MAX_UNSYNCHRONIZED_BLOCKS;
+}
+
+void FusionScheduler::dropConfirmedTransactions() {
+  m_pendingTransactions.erase(std::remove_if(m_pendingTransactions.begin(), m_pendingTransactions.end(), [this](size_t transactionId) {
+    if (transactionId >= m_wallet.getTransactionCount()) {
+      return true;
+    }
+
+    WalletTransaction transaction = m_wallet.getTransaction(transactionId);
+    return transaction.blockHeight != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT ||
+      transaction.state == WalletTransactionState::FAILED ||
+      transaction.state == WalletTransactionState::CANCELLED ||
+      transaction.state == WalletTransactionState::DELETED;
+  }), m_pendingTransactions.end());
+
+  m_stats.pendingTransactionCount = m_pendingTransactions.size();
+}
+
+size_t FusionScheduler::transactionsAllowed(std::chrono::steady_clock::time_point now) {
+  while (!m_sentTimes.empty() && now - m_sentTimes.front() >= std::chrono::hours(1)) {
+    m_sentTimes.pop_front();
+  }
+
+  if (m_pendingTransactions.size() >= m_settings.maxPendingTransactions || m_sentTimes.size() >= m_settings.maxTransactionsPerHour) {
+    return 0;
+  }
+
+  return std::min({m_settings.maxTransactionsPerRound,
+    m_settings.maxPendingTransactions - m_pendingTransactions.size(),
+    m_settings.maxTransactionsPerHour - m_sentTimes.size()});
+}
+
+}
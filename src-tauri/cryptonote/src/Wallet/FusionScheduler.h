@@ -0,0 +1,109 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "IFusionManager.h"
+#include "INode.h"
+#include "IWallet.h"
+#include "Logging/LoggerRef.h"
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/Event.h>
+
+namespace CryptoNote {
+
+struct FusionSchedulerSettings {
+  FusionSchedulerSettings();
+
+  uint64_t threshold;                      // outputs below this amount are consolidated
+  uint64_t mixin;
+  std::vector<std::string> sourceAddresses; // empty selects every address
+  std::string destinationAddress;           // empty keeps the outputs in their own address
+
+  std::chrono::seconds checkInterval;
+  std::chrono::seconds idleTime;            // quiet period after user activity before fusing
+  size_t minFusionReadyCount;               // skip rounds with fewer candidates than this
+  size_t maxTransactionsPerRound;
+  size_t maxTransactionsPerHour;
+  // fusion transactions carry no fee, but each one locks its inputs until it confirms
+  size_t maxPendingTransactions;
+};
+
+// Consolidates dust in the background through IFusionManager. Every checkInterval it looks at
+// the output histogram and, once the wallet has been idle for idleTime and no more than
+// maxPendingTransactions earlier fusions are unconfirmed, sends fusion transactions within the
+// per-round and hourly limits. Runs on the dispatcher and holds walletLock while using the wallet.
+class FusionScheduler {
+public:
+  struct FragmentationMetrics {
+    size_t totalOutputCount;
+    size_t fusionReadyCount;
+  };
+
+  struct Stats {
+    FragmentationMetrics before;   // as of the start of the last round that sent anything
+    FragmentationMetrics after;    // as of the end of that round
+    uint64_t roundCount;
+    uint64_t transactionCount;
+    size_t pendingTransactionCount;
+  };
+
+  FusionScheduler(System::Dispatcher& dispatcher, IWallet& wallet, IFusionManager& fusionManager, INode& node,
+    System::Event& walletLock, const FusionSchedulerSettings& settings, Logging::ILogger& logger);
+  ~FusionScheduler();
+
+  void start();
+  void stop();
+
+  // postpones fusion until the wallet has been idle again for idleTime
+  void notifyActivity();
+
+  Stats getStats() const;
+
+private:
+  void run();
+  void runRound();
+  bool isNodeSynchronized() const;
+  void dropConfirmedTransactions();
+  size_t transactionsAllowed(std::chrono::steady_clock::time_point now);
+
+  System::Dispatcher& m_dispatcher;
+  IWallet& m_wallet;
+  IFusionManager& m_fusionManager;
+  INode& m_node;
+  System::Event& m_walletLock;
+  const FusionSchedulerSettings m_settings;
+  Logging::LoggerRef m_logger;
+
+  bool m_stopped;
+  std::chrono::steady_clock::time_point m_lastActivity;
+  std::deque<std::chrono::steady_clock::time_point> m_sentTimes; // within the last hour
+  std::vector<size_t> m_pendingTransactions;
+  Stats m_stats;
+
+  System::ContextGroup m_workingContext;
+  System::ContextGroup m_sleepingContext;
+};
+
+}
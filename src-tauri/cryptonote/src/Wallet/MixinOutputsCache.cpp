@@ -0,0 +1,153 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "MixinOutputsCache.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace CryptoNote {
+
+namespace {
+
+const uint64_t REFILL_SENDS = 4;        // sends per denomination a completed refill covers
+const uint64_t LOW_WATER_SENDS = 2;     // refill when fewer sends than this are pooled
+const size_t MAX_POOLED_AMOUNTS = 512;
+
+}
+
+struct MixinOutputsCache::State {
+  typedef COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry OutEntry;
+
+  std::unordered_map<uint64_t, std::deque<OutEntry>> pools;
+  bool refilling = false;
+  bool stopped = false;
+  uint64_t generation = 0;                 // bumped by clear() so stale refills are dropped
+  std::vector<OutsForAmount> refillResult; // written by the node until its callback fires
+
+  void merge(uint64_t requestGeneration) {
+    std::vector<OutsForAmount> result = std::move(refillResult);
+    refillResult.clear();
+    refilling = false;
+
+    if (stopped || requestGeneration != generation) {
+      return;
+    }
+
+    for (auto& outs : result) {
+      if (pools.size() >= MAX_POOLED_AMOUNTS && pools.count(outs.amount) == 0) {
+        continue;
+      }
+
+      auto& pool = pools[outs.amount];
+      pool.insert(pool.end(), outs.outs.begin(), outs.outs.end());
+    }
+  }
+};
+
+MixinOutputsCache::MixinOutputsCache(System::Dispatcher& dispatcher, INode& node) :
+  m_dispatcher(dispatcher), m_node(node), m_state(std::make_shared<State>()) {
+}
+
+MixinOutputsCache::~MixinOutputsCache() {
+  // a refill in flight keeps the state alive through its callback and finds it stopped
+  m_state->stopped = true;
+}
+
+bool MixinOutputsCache::take(const std::vector<uint64_t>& amounts, uint64_t mixIn, std::vector<OutsForAmount>& result) {
+  std::unordered_map<uint64_t, uint64_t> needed;
+  for (uint64_t amount : amounts) {
+    needed[amount] += mixIn;
+  }
+
+  for (const auto& kv : needed) {
+    auto it = m_state->pools.find(kv.first);
+    if (it == m_state->pools.end() || it->second.size() < kv.second) {
+      return false;
+    }
+  }
+
+  std::vector<OutsForAmount> taken;
+  taken.reserve(amounts.size());
+  for (uint64_t amount : amounts) {
+    auto& pool = m_state->pools[amount];
+
+    // refills are sampled independently, so skip repeats within one ring
+    OutsForAmount outs;
+    outs.amount = amount;
+    std::unordered_set<uint64_t> used;
+    while (outs.outs.size() < mixIn && !pool.empty()) {
+      if (used.insert(pool.front().global_amount_index).second) {
+        outs.outs.push_back(pool.front());
+      }
+      pool.pop_front();
+    }
+
+    if (outs.outs.size() < mixIn) {
+      // the repeats ate into what the check above counted; outputs taken so far are not reused
+      return false;
+    }
+
+    taken.push_back(std::move(outs));
+  }
+
+  result = std::move(taken);
+  return true;
+}
+
+void MixinOutputsCache::refill(const std::vector<uint64_t>& amounts, uint64_t mixIn) {
+  if (m_state->refilling || mixIn == 0) {
+    return;
+  }
+
+  std::vector<uint64_t> low;
+  for (uint64_t amount : amounts) {
+    auto it = m_state->pools.find(amount);
+    size_t pooled = it == m_state->pools.end() ? 0 : it->second.size();
+    if (pooled < mixIn * LOW_WATER_SENDS && std::find(low.begin(), low.end(), amount) == low.end()) {
+      low.push_back(amount);
+    }
+  }
+
+  if (low.empty()) {
+    return;
+  }
+
+  std::shared_ptr<State> state = m_state;
+  System::Dispatcher& dispatcher = m_dispatcher;
+  uint64_t generation = state->generation;
+  state->refilling = true;
+
+  m_node.getRandomOutsByAmounts(std::move(low), mixIn * REFILL_SENDS, state->refillResult, [state, &dispatcher, generation](std::error_code ec) {
+    dispatcher.remoteSpawn([state, generation, ec] {
+      if (ec) {
+        state->refillResult.clear();
+        state->refilling = false;
+        return;
+      }
+
+      state->merge(generation);
+    });
+  });
+}
+
+void MixinOutputsCache::clear() {
+  m_state->pools.clear();
+  ++m_state->generation;
+}
+
+}
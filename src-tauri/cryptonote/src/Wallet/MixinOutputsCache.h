@@ -0,0 +1,58 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "INode.h"
+#include <System/Dispatcher.h>
+
+namespace CryptoNote {
+
+// Rolling pool of decoy outputs per denomination, so a send only does a synchronous
+// getRandomOutsByAmounts when the pool runs dry. Every decoy is handed out once; refills are
+// issued in the background and a pool is dropped on reorg. All calls come from the dispatcher thread.
+class MixinOutputsCache {
+public:
+  typedef COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount OutsForAmount;
+
+  MixinOutputsCache(System::Dispatcher& dispatcher, INode& node);
+  ~MixinOutputsCache();
+
+  // fills result with mixIn decoys per entry of amounts, in order; returns false and leaves
+  // result untouched unless every entry can be served
+  bool take(const std::vector<uint64_t>& amounts, uint64_t mixIn, std::vector<OutsForAmount>& result);
+
+  // starts a background request for the amounts whose pool cannot serve a few more sends
+  void refill(const std::vector<uint64_t>& amounts, uint64_t mixIn);
+
+  // outputs fetched before a reorg may sit on a dropped chain; refills in flight are discarded
+  void clear();
+
+private:
+  struct State;
+
+  System::Dispatcher& m_dispatcher;
+  INode& m_node;
+  std::shared_ptr<State> m_state;
+};
+
+}
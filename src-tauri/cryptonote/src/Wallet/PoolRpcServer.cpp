@@ -32,26 +32,84 @@
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/CryptoNoteTools.h"
 #include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Difficulty.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolHandler.h"
 #include "WalletLegacy/WalletHelper.h"
 #include "crypto/hash.h"
 #include "Rpc/JsonRpc.h"
 
+#include <System/RemoteContext.h>
+
 using namespace Logging;
 using namespace CryptoNote;
 
+namespace {
+
+const size_t SEEN_SHARES_LIMIT = 1 << 20;
+const size_t PAYOUT_MAX_DESTINATIONS = 32;
+
+const char SHARE_STATUS_OK[] = "OK";
+const char SHARE_STATUS_BAD_MINER[] = "BAD MINER";
+const char SHARE_STATUS_BAD_BLOB[] = "BAD BLOB";
+const char SHARE_STATUS_NOT_POOL_TEMPLATE[] = "NOT POOL TEMPLATE";
+const char SHARE_STATUS_WRONG_RESULT[] = "WRONG RESULT";
+const char SHARE_STATUS_LOW_DIFFICULTY[] = "LOW DIFFICULTY";
+const char SHARE_STATUS_DUPLICATE[] = "DUPLICATE";
+
+struct ShareCheck {
+  Crypto::Hash hash;
+  const char* status;
+};
+
+// Runs on the share workers; the coinbase check keeps miners from being credited for blocks
+// that would pay someone else.
+ShareCheck checkShare(const AccountKeys& poolKeys, const Tools::wallet_rpc::pool_share& share) {
+  static thread_local Crypto::cn_context context;
+
+  ShareCheck check = { NULL_HASH, SHARE_STATUS_BAD_BLOB };
+  BinaryArray blob;
+  Block block;
+  if (!Common::fromHex(share.blob, blob) || !fromBinaryArray(block, blob)) {
+    return check;
+  }
+
+  std::vector<size_t> outputs;
+  uint64_t amount = 0;
+  if (!lookup_acc_outs(poolKeys, block.baseTransaction, outputs, amount) || outputs.empty()) {
+    check.status = SHARE_STATUS_NOT_POOL_TEMPLATE;
+    return check;
+  }
+
+  if (!get_block_longhash(context, block, check.hash)) {
+    return check;
+  }
+
+  Crypto::Hash claimed;
+  if (!share.result.empty() && (!Common::podFromHex(share.result, claimed) || claimed != check.hash)) {
+    check.status = SHARE_STATUS_WRONG_RESULT;
+    return check;
+  }
+
+  check.status = check_hash(check.hash, share.difficulty) ? SHARE_STATUS_OK : SHARE_STATUS_LOW_DIFFICULTY;
+  return check;
+}
+
+}
+
 namespace Tools {
 
 const command_line::arg_descriptor<uint16_t> pool_rpc_server::arg_rpc_bind_port = { "rpc-bind-port", "Starts wallet as rpc server for wallet operations, sets bind port for server", 0, true };
 const command_line::arg_descriptor<std::string> pool_rpc_server::arg_rpc_bind_ip = { "rpc-bind-ip", "Specify ip to bind rpc server", "127.0.0.1" };
 const command_line::arg_descriptor<std::string> pool_rpc_server::arg_rpc_user = { "rpc-user", "Username to use the rpc server. If authorization is not required, leave it empty", "" };
 const command_line::arg_descriptor<std::string> pool_rpc_server::arg_rpc_password = { "rpc-password", "Password to use the rpc server. If authorization is not required, leave it empty", "" };
+const command_line::arg_descriptor<uint32_t> pool_rpc_server::arg_share_threads = { "share-threads", "Threads hashing submitted shares, 0 for one per core", 0 };
 
 void pool_rpc_server::init_options(boost::program_options::options_description& desc) {
   command_line::add_arg(desc, arg_rpc_bind_ip);
   command_line::add_arg(desc, arg_rpc_bind_port);
   command_line::add_arg(desc, arg_rpc_user);
   command_line::add_arg(desc, arg_rpc_password);
+  command_line::add_arg(desc, arg_share_threads);
 }
 //------------------------------------------------------------------------------------------------------------------------------
 pool_rpc_server::pool_rpc_server(
@@ -69,7 +127,9 @@ pool_rpc_server::pool_rpc_server(
   m_wallet(w),
   m_node(n),
   m_currency(currency),
-  m_walletFilename(walletFile) {
+  m_walletFilename(walletFile),
+  m_shareThreads(0),
+  m_poolKeysLoaded(false) {
 }
 //------------------------------------------------------------------------------------------------------------------------------
 bool pool_rpc_server::run() {
@@ -92,6 +152,7 @@ bool pool_rpc_server::handle_command_line(const boost::program_options::variable
   m_port = command_line::get_arg(vm, arg_rpc_bind_port);
   m_rpcUser = command_line::get_arg(vm, arg_rpc_user);
   m_rpcPassword = command_line::get_arg(vm, arg_rpc_password);
+  m_shareThreads = command_line::get_arg(vm, arg_share_threads);
   return true;
 }
 //------------------------------------------------------------------------------------------------------------------------------
@@ -126,7 +187,10 @@ void pool_rpc_server::processRequest(const CryptoNote::HttpRequest& request, Cry
       { "get_height", makeMemberMethod(&pool_rpc_server::on_get_height) },
       { "get_outputs", makeMemberMethod(&pool_rpc_server::on_get_outputs) },
       { "optimize", makeMemberMethod(&pool_rpc_server::on_optimize) },
-      { "reset", makeMemberMethod(&pool_rpc_server::on_reset) }
+      { "reset", makeMemberMethod(&pool_rpc_server::on_reset) },
+      { "submit_shares", makeMemberMethod(&pool_rpc_server::on_submit_shares) },
+      { "get_miner_balances", makeMemberMethod(&pool_rpc_server::on_get_miner_balances) },
+      { "pay_miners", makeMemberMethod(&pool_rpc_server::on_pay_miners) }
     };
 
     auto it = s_methods.find(jsonRequest.getMethod());
@@ -319,7 +383,14 @@ bool pool_rpc_server::on_get_payments(const wallet_rpc::COMMAND_RPC_GET_PAYMENTS
   std::copy(std::begin(payment_id_blob), std::end(payment_id_blob), reinterpret_cast<char*>(&expectedPaymentId)); // no UB, char can alias any type
   auto payments = m_wallet.getTransactionsByPaymentIds({expectedPaymentId});
   assert(payments.size() == 1);
-  for (auto& transaction : payments[0].transactions) {
+  const auto& transactions = payments[0].transactions;
+  uint64_t index = req.first_index;
+  for (; index < transactions.size() && res.payments.size() < req.limit; ++index) {
+    const auto& transaction = transactions[index];
+    if (transaction.blockHeight < req.min_height || transaction.blockHeight > req.max_height) {
+      continue;
+    }
+
     wallet_rpc::payment_details rpc_payment;
     rpc_payment.tx_hash = Common::podToHex(transaction.hash);
     rpc_payment.amount = transaction.totalAmount;
@@ -328,6 +399,7 @@ bool pool_rpc_server::on_get_payments(const wallet_rpc::COMMAND_RPC_GET_PAYMENTS
     res.payments.push_back(rpc_payment);
   }
 
+  res.next_index = index;
   return true;
 }
 
@@ -370,7 +442,7 @@ bool pool_rpc_server::on_create_integrated(const wallet_rpc::COMMAND_RPC_CREATE_
 
 /* --------------------------------------------------------------------------------- */
 
-bool pool_rpc_server::on_get_transfers(const wallet_rpc::COMMAND_RPC_GET_TRANSFERS::request& req, wallet_rpc::COMMAND_RPC_GET_TRANSFERS::response& res) {
+bool pool_rpc_server::on_get_transfers(const CryptoNote::EMPTY_STRUCT& req, wallet_rpc::COMMAND_RPC_GET_TRANSFERS::response& res) {
   res.transfers.clear();
   size_t transactionsCount = m_wallet.getTransactionCount();
   for (size_t trantransactionNumber = 0; trantransactionNumber < transactionsCount; ++trantransactionNumber) {
@@ -410,6 +482,8 @@ bool pool_rpc_server::on_get_transfers(const wallet_rpc::COMMAND_RPC_GET_TRANSFE
     res.transfers.push_back(transfer);
   }
 
+  res.next_tx_id = transactionsCount;
+  res.total_tx_count = transactionsCount;
   return true;
 }
 
@@ -428,4 +502,173 @@ bool pool_rpc_server::on_reset(const wallet_rpc::COMMAND_RPC_RESET::request& req
   return true;
 }
 
+//------------------------------------------------------------------------------------------------------------------------------
+// Every submission in flight, from this request and from concurrent ones, shares one worker pool;
+// the dispatcher only waits for the hashes and then credits the accepted shares in request order.
+bool pool_rpc_server::on_submit_shares(const wallet_rpc::COMMAND_RPC_SUBMIT_SHARES::request& req, wallet_rpc::COMMAND_RPC_SUBMIT_SHARES::response& res) {
+  if (!m_poolKeysLoaded) {
+    m_wallet.getAccountKeys(m_poolKeys);
+    m_poolKeysLoaded = true;
+  }
+
+  if (!m_shareWorkers) {
+    m_shareWorkers.reset(new Common::ThreadPool(m_shareThreads));
+  }
+
+  std::vector<ShareCheck> checks(req.shares.size(), ShareCheck{ NULL_HASH, SHARE_STATUS_BAD_MINER });
+  std::vector<size_t> toHash;
+  for (size_t i = 0; i < req.shares.size(); ++i) {
+    AccountPublicAddress miner;
+    if (req.shares[i].difficulty != 0 && m_currency.parseAccountAddressString(req.shares[i].miner, miner)) {
+      toHash.push_back(i);
+    }
+  }
+
+  // submit() blocks while the queue is full, so the fan out runs off the dispatcher
+  Common::ThreadPool& workers = *m_shareWorkers;
+  const AccountKeys& poolKeys = m_poolKeys;
+  System::RemoteContext<void>(m_dispatcher, [&] {
+    std::vector<std::future<void>> pending;
+    pending.reserve(toHash.size());
+    for (size_t i : toHash) {
+      pending.push_back(workers.submit([&, i] {
+        checks[i] = checkShare(poolKeys, req.shares[i]);
+      }));
+    }
+
+    for (auto& result : pending) {
+      result.get();
+    }
+  }).get();
+
+  res.accepted = 0;
+  res.results.resize(req.shares.size());
+  for (size_t i = 0; i < req.shares.size(); ++i) {
+    ShareCheck& check = checks[i];
+    if (check.status == SHARE_STATUS_OK) {
+      if (m_seenShares.insert(check.hash).second) {
+        m_seenSharesOrder.push_back(check.hash);
+        if (m_seenSharesOrder.size() > SEEN_SHARES_LIMIT) {
+          m_seenShares.erase(m_seenSharesOrder.front());
+          m_seenSharesOrder.pop_front();
+        }
+
+        MinerAccount& account = m_miners.emplace(req.shares[i].miner, MinerAccount{ 0, 0 }).first->second;
+        account.shares += req.shares[i].difficulty;
+        ++res.accepted;
+      } else {
+        check.status = SHARE_STATUS_DUPLICATE;
+      }
+    }
+
+    res.results[i].hash = check.hash == NULL_HASH ? std::string() : Common::podToHex(check.hash);
+    res.results[i].status = check.status;
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool pool_rpc_server::on_get_miner_balances(const wallet_rpc::COMMAND_RPC_GET_MINER_BALANCES::request& req, wallet_rpc::COMMAND_RPC_GET_MINER_BALANCES::response& res) {
+  res.miners.reserve(m_miners.size());
+  for (const auto& miner : m_miners) {
+    wallet_rpc::pool_miner_balance balance;
+    balance.miner = miner.first;
+    balance.shares = miner.second.shares;
+    balance.balance = miner.second.balance;
+    res.miners.push_back(balance);
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// Like the wallet's batch transfer: payouts go out PAYOUT_MAX_DESTINATIONS per transaction, in
+// order, and a failure stops the run with the earlier transactions kept and their miners paid.
+bool pool_rpc_server::on_pay_miners(const wallet_rpc::COMMAND_RPC_PAY_MINERS::request& req, wallet_rpc::COMMAND_RPC_PAY_MINERS::response& res) {
+  uint64_t totalShares = 0;
+  for (const auto& miner : m_miners) {
+    totalShares += miner.second.shares;
+  }
+
+  if (req.amount != 0 && totalShares != 0) {
+    for (auto& miner : m_miners) {
+      miner.second.balance += static_cast<uint64_t>(static_cast<long double>(req.amount) * miner.second.shares / totalShares);
+      miner.second.shares = 0;
+    }
+  }
+
+  std::vector<std::map<std::string, MinerAccount>::iterator> payees;
+  for (auto it = m_miners.begin(); it != m_miners.end(); ++it) {
+    if (it->second.balance != 0 && it->second.balance >= req.min_payout) {
+      payees.push_back(it);
+    }
+  }
+
+  res.paid_miners = 0;
+  res.paid_amount = 0;
+  for (size_t first = 0; first < payees.size(); first += PAYOUT_MAX_DESTINATIONS) {
+    size_t last = std::min(payees.size(), first + PAYOUT_MAX_DESTINATIONS);
+    std::vector<CryptoNote::WalletLegacyTransfer> transfers;
+    for (size_t i = first; i < last; ++i) {
+      CryptoNote::WalletLegacyTransfer transfer;
+      transfer.address = payees[i]->first;
+      transfer.amount = static_cast<int64_t>(payees[i]->second.balance);
+      transfers.push_back(transfer);
+    }
+
+    try {
+      res.tx_hashes.push_back(send_payout(transfers, req.fee, req.mixin, req.unlock_time));
+    } catch (const std::exception& e) {
+      if (res.tx_hashes.empty()) {
+        throw JsonRpc::JsonRpcError(WALLET_RPC_ERROR_CODE_GENERIC_TRANSFER_ERROR, e.what());
+      }
+
+      logger(WARNING) << "Payout stopped after " << res.tx_hashes.size() << " transactions: " << e.what();
+      break;
+    }
+
+    for (size_t i = first; i < last; ++i) {
+      res.paid_amount += payees[i]->second.balance;
+      payees[i]->second.balance = 0;
+      ++res.paid_miners;
+    }
+  }
+
+  for (auto it = m_miners.begin(); it != m_miners.end();) {
+    if (it->second.shares == 0 && it->second.balance == 0) {
+      it = m_miners.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+std::string pool_rpc_server::send_payout(std::vector<CryptoNote::WalletLegacyTransfer>& transfers, uint64_t fee, uint64_t mixin, uint64_t unlockTime) {
+  std::vector<CryptoNote::TransactionMessage> messages;
+  for (const auto& transfer : transfers) {
+    messages.emplace_back(CryptoNote::TransactionMessage{ "P01", transfer.address });
+  }
+
+  CryptoNote::WalletHelper::SendCompleteResultObserver sent;
+  WalletHelper::IWalletRemoveObserverGuard removeGuard(m_wallet, sent);
+
+  Crypto::SecretKey transactionSK;
+  CryptoNote::TransactionId tx = m_wallet.sendTransaction(transactionSK, transfers, fee, "", mixin, unlockTime, messages, 0);
+  if (tx == WALLET_LEGACY_INVALID_TRANSACTION_ID) {
+    throw std::runtime_error("Couldn't send transaction");
+  }
+
+  std::error_code sendError = sent.wait(tx);
+  removeGuard.removeObserver();
+
+  if (sendError) {
+    throw std::system_error(sendError);
+  }
+
+  CryptoNote::WalletLegacyTransaction txInfo;
+  m_wallet.getTransaction(tx, txInfo);
+  return Common::podToHex(txInfo.hash);
+}
+
 }
@@ -17,12 +17,16 @@
 
 #pragma  once
 
+#include <deque>
 #include <future>
+#include <map>
+#include <unordered_set>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include "WalletRpcServerCommandsDefinitions.h"
 #include "WalletLegacy/WalletLegacy.h"
 #include "Common/CommandLine.h"
+#include "Common/ThreadPool.h"
 #include "Rpc/HttpServer.h"
 
 #include <Logging/LoggerRef.h>
@@ -55,6 +59,7 @@ namespace Tools
     static const command_line::arg_descriptor<std::string> arg_rpc_bind_ip;
     static const command_line::arg_descriptor<std::string> arg_rpc_user;
     static const command_line::arg_descriptor<std::string> arg_rpc_password;
+    static const command_line::arg_descriptor<uint32_t> arg_share_threads;
 
   private:
 
@@ -67,13 +72,17 @@ namespace Tools
     bool on_store(const wallet_rpc::COMMAND_RPC_STORE::request& req, wallet_rpc::COMMAND_RPC_STORE::response& res);
     bool on_get_messages(const wallet_rpc::COMMAND_RPC_GET_MESSAGES::request& req, wallet_rpc::COMMAND_RPC_GET_MESSAGES::response& res);
     bool on_get_payments(const wallet_rpc::COMMAND_RPC_GET_PAYMENTS::request& req, wallet_rpc::COMMAND_RPC_GET_PAYMENTS::response& res);
-    bool on_get_transfers(const wallet_rpc::COMMAND_RPC_GET_TRANSFERS::request& req, wallet_rpc::COMMAND_RPC_GET_TRANSFERS::response& res);
+    bool on_get_transfers(const CryptoNote::EMPTY_STRUCT& req, wallet_rpc::COMMAND_RPC_GET_TRANSFERS::response& res);
     bool on_get_height(const wallet_rpc::COMMAND_RPC_GET_HEIGHT::request& req, wallet_rpc::COMMAND_RPC_GET_HEIGHT::response& res);
     bool on_get_outputs(const wallet_rpc::COMMAND_RPC_GET_OUTPUTS::request& req, wallet_rpc::COMMAND_RPC_GET_OUTPUTS::response& res);
     bool on_optimize(const wallet_rpc::COMMAND_RPC_OPTIMIZE::request& req, wallet_rpc::COMMAND_RPC_OPTIMIZE::response& res);
     bool on_reset(const wallet_rpc::COMMAND_RPC_RESET::request& req, wallet_rpc::COMMAND_RPC_RESET::response& res);
+    bool on_submit_shares(const wallet_rpc::COMMAND_RPC_SUBMIT_SHARES::request& req, wallet_rpc::COMMAND_RPC_SUBMIT_SHARES::response& res);
+    bool on_get_miner_balances(const wallet_rpc::COMMAND_RPC_GET_MINER_BALANCES::request& req, wallet_rpc::COMMAND_RPC_GET_MINER_BALANCES::response& res);
+    bool on_pay_miners(const wallet_rpc::COMMAND_RPC_PAY_MINERS::request& req, wallet_rpc::COMMAND_RPC_PAY_MINERS::response& res);
 
     bool handle_command_line(const boost::program_options::variables_map& vm);
+    std::string send_payout(std::vector<CryptoNote::WalletLegacyTransfer>& transfers, uint64_t fee, uint64_t mixin, uint64_t unlockTime);
 
     Logging::LoggerRef logger;
     CryptoNote::IWalletLegacy& m_wallet;
@@ -87,5 +96,21 @@ namespace Tools
 
     System::Dispatcher& m_dispatcher;
     System::Event m_stopComplete;
+
+    struct MinerAccount {
+      uint64_t shares;
+      uint64_t balance;
+    };
+
+    // Shares are hashed on m_shareWorkers, each worker with its own cn_context; everything else,
+    // the accounts included, is only touched on the dispatcher. Accounts live in memory, the pool
+    // keeps its own record through get_miner_balances.
+    uint32_t m_shareThreads;
+    std::unique_ptr<Common::ThreadPool> m_shareWorkers;
+    CryptoNote::AccountKeys m_poolKeys;
+    bool m_poolKeysLoaded;
+    std::map<std::string, MinerAccount> m_miners;
+    std::unordered_set<Crypto::Hash> m_seenShares;
+    std::deque<Crypto::Hash> m_seenSharesOrder;
   };
 }
@@ -0,0 +1,101 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "SpendableOutputsIndex.h"
+
+namespace CryptoNote {
+
+const SpendableOutputsIndex::Outputs& SpendableOutputsIndex::outputs(ITransfersContainer* container) {
+  auto it = m_entries.find(container);
+  if (it != m_entries.end()) {
+    return it->second.outputs;
+  }
+
+  Entry& entry = m_entries[container];
+
+  std::vector<TransactionOutputInformation> unlocked;
+  container->getOutputs(unlocked, ITransfersContainer::IncludeKeyUnlocked);
+  entry.outputs.insert(unlocked.begin(), unlocked.end());
+
+  std::vector<TransactionOutputInformation> locked;
+  container->getOutputs(locked, ITransfersContainer::IncludeKeyNotUnlocked);
+  for (const auto& output : locked) {
+    entry.pending.insert(output.transactionHash);
+  }
+
+  return entry.outputs;
+}
+
+void SpendableOutputsIndex::transactionUpdated(ITransfersContainer* container, const Crypto::Hash& transactionHash) {
+  // containers without an entry are rebuilt from scratch on use, but their outputs still changed
+  ++m_version;
+
+  auto it = m_entries.find(container);
+  if (it == m_entries.end()) {
+    return;
+  }
+
+  auto& keyIndex = it->second.outputs.get<OutputKeyIndex>();
+  for (const auto& input : container->getTransactionInputs(transactionHash, ITransfersContainer::IncludeTypeKey)) {
+    keyIndex.erase(TransactionOutputKey{input.transactionHash, input.outputInTransaction});
+  }
+
+  refresh(container, it->second, transactionHash);
+}
+
+void SpendableOutputsIndex::unlockPending() {
+  for (auto& containerEntry : m_entries) {
+    Entry& entry = containerEntry.second;
+    std::vector<Crypto::Hash> pending(entry.pending.begin(), entry.pending.end());
+    for (const auto& transactionHash : pending) {
+      refresh(containerEntry.first, entry, transactionHash);
+    }
+  }
+}
+
+void SpendableOutputsIndex::remove(ITransfersContainer* container, const TransactionOutputKey& key) {
+  auto it = m_entries.find(container);
+  if (it != m_entries.end() && it->second.outputs.get<OutputKeyIndex>().erase(key) != 0) {
+    ++m_version;
+  }
+}
+
+void SpendableOutputsIndex::invalidate(ITransfersContainer* container) {
+  m_entries.erase(container);
+  ++m_version;
+}
+
+void SpendableOutputsIndex::clear() {
+  m_entries.clear();
+  ++m_version;
+}
+
+void SpendableOutputsIndex::refresh(ITransfersContainer* container, Entry& entry, const Crypto::Hash& transactionHash) {
+  for (const auto& output : container->getTransactionOutputs(transactionHash, ITransfersContainer::IncludeKeyUnlocked)) {
+    if (entry.outputs.insert(output).second) {
+      ++m_version;
+    }
+  }
+
+  if (container->getTransactionOutputs(transactionHash, ITransfersContainer::IncludeKeyNotUnlocked).empty()) {
+    entry.pending.erase(transactionHash);
+  } else {
+    entry.pending.insert(transactionHash);
+  }
+}
+
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include "ITransfersContainer.h"
+#include "Transfers/TransfersContainer.h"
+
+namespace CryptoNote {
+
+// Unlocked key outputs of each container, ordered by amount, so coin selection does not have
+// to copy every output out of the container on each send. A container's entry is built on first
+// use and kept current from transaction and unlock notifications; anything the notifications
+// cannot describe precisely (deletions, reorgs) drops the entry and it is rebuilt on demand.
+// Entries may still go stale between a spend and its notification, so callers confirm each
+// pick with ITransfersContainer::getTransfer. All calls come from the dispatcher thread.
+class SpendableOutputsIndex {
+public:
+  struct AmountIndex {};
+  struct OutputKeyIndex {};
+
+  struct OutputKeyExtractor {
+    typedef TransactionOutputKey result_type;
+    result_type operator()(const TransactionOutputInformation& output) const {
+      return TransactionOutputKey{output.transactionHash, output.outputInTransaction};
+    }
+  };
+
+  typedef boost::multi_index_container<
+    TransactionOutputInformation,
+    boost::multi_index::indexed_by<
+      boost::multi_index::ordered_non_unique<boost::multi_index::tag<AmountIndex>,
+        BOOST_MULTI_INDEX_MEMBER(TransactionOutputInformation, uint64_t, amount)>,
+      boost::multi_index::hashed_unique<boost::multi_index::tag<OutputKeyIndex>,
+        OutputKeyExtractor, TransactionOutputKeyHasher>>> Outputs;
+
+  // rebuilds the container's entry from getOutputs if it has none
+  const Outputs& outputs(ITransfersContainer* container);
+
+  // drops outputs the transaction spent and picks up any of its outputs that are already unlocked
+  void transactionUpdated(ITransfersContainer* container, const Crypto::Hash& transactionHash);
+  // re-checks transactions whose outputs were still locked for any that have since unlocked
+  void unlockPending();
+
+  void remove(ITransfersContainer* container, const TransactionOutputKey& key);
+  void invalidate(ITransfersContainer* container);
+  void clear();
+
+  // changes whenever the set of spendable outputs may have changed
+  uint64_t version() const { return m_version; }
+
+private:
+  struct Entry {
+    Outputs outputs;
+    // transactions with key outputs the container still reports as locked
+    std::unordered_set<Crypto::Hash> pending;
+  };
+
+  void refresh(ITransfersContainer* container, Entry& entry, const Crypto::Hash& transactionHash);
+
+  std::unordered_map<ITransfersContainer*, Entry> m_entries;
+  uint64_t m_version = 0;
+};
+
+}
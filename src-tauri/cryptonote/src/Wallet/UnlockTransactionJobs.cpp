@@ -0,0 +1,132 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "UnlockTransactionJobs.h"
+
+#include <algorithm>
+
+namespace CryptoNote {
+
+UnlockTransactionJobs::UnlockTransactionJobs() : m_size(0) {
+}
+
+void UnlockTransactionJobs::clear() {
+  m_buckets.clear();
+  m_heights.clear();
+  m_size = 0;
+}
+
+void UnlockTransactionJobs::insert(const UnlockTransactionJob& job) {
+  auto& bucket = m_buckets[job.blockHeight];
+  auto it = std::find_if(bucket.begin(), bucket.end(), [&job](const UnlockTransactionJob& pending) {
+    return pending.container == job.container && pending.transactionHash == job.transactionHash;
+  });
+
+  if (it != bucket.end()) {
+    return;
+  }
+
+  bucket.push_back(job);
+  m_heights.emplace(job.transactionHash, job.blockHeight);
+  ++m_size;
+}
+
+void UnlockTransactionJobs::erase(const Crypto::Hash& transactionHash) {
+  auto range = m_heights.equal_range(transactionHash);
+  for (auto it = range.first; it != range.second; ++it) {
+    auto bucketIt = m_buckets.find(it->second);
+    if (bucketIt == m_buckets.end()) {
+      continue;
+    }
+
+    auto& bucket = bucketIt->second;
+    auto removed = std::remove_if(bucket.begin(), bucket.end(), [&transactionHash](const UnlockTransactionJob& job) {
+      return job.transactionHash == transactionHash;
+    });
+
+    m_size -= std::distance(removed, bucket.end());
+    bucket.erase(removed, bucket.end());
+    if (bucket.empty()) {
+      m_buckets.erase(bucketIt);
+    }
+  }
+
+  m_heights.erase(range.first, range.second);
+}
+
+void UnlockTransactionJobs::erase(const ITransfersContainer* container) {
+  for (auto bucketIt = m_buckets.begin(); bucketIt != m_buckets.end();) {
+    auto& bucket = bucketIt->second;
+    auto removed = std::remove_if(bucket.begin(), bucket.end(), [container](const UnlockTransactionJob& job) {
+      return job.container == container;
+    });
+
+    m_size -= std::distance(removed, bucket.end());
+    bucket.erase(removed, bucket.end());
+    bucketIt = bucket.empty() ? m_buckets.erase(bucketIt) : std::next(bucketIt);
+  }
+
+  rebuildHeights();
+}
+
+std::vector<ITransfersContainer*> UnlockTransactionJobs::popUnlocked(uint32_t height) {
+  std::vector<ITransfersContainer*> containers;
+
+  while (!m_buckets.empty() && m_buckets.begin()->first <= height) {
+    auto bucketIt = m_buckets.begin();
+    for (const auto& job : bucketIt->second) {
+      containers.push_back(job.container);
+
+      auto range = m_heights.equal_range(job.transactionHash);
+      auto it = std::find_if(range.first, range.second, [&bucketIt](const std::pair<const Crypto::Hash, uint32_t>& entry) {
+        return entry.second == bucketIt->first;
+      });
+
+      if (it != range.second) {
+        m_heights.erase(it);
+      }
+    }
+
+    m_size -= bucketIt->second.size();
+    m_buckets.erase(bucketIt);
+  }
+
+  std::sort(containers.begin(), containers.end());
+  containers.erase(std::unique(containers.begin(), containers.end()), containers.end());
+  return containers;
+}
+
+std::vector<UnlockTransactionJob> UnlockTransactionJobs::getJobs() const {
+  std::vector<UnlockTransactionJob> jobs;
+  jobs.reserve(m_size);
+  for (const auto& bucket : m_buckets) {
+    jobs.insert(jobs.end(), bucket.second.begin(), bucket.second.end());
+  }
+
+  return jobs;
+}
+
+void UnlockTransactionJobs::rebuildHeights() {
+  m_heights.clear();
+  for (const auto& bucket : m_buckets) {
+    for (const auto& job : bucket.second) {
+      m_heights.emplace(job.transactionHash, bucket.first);
+    }
+  }
+}
+
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+class ITransfersContainer;
+
+struct UnlockTransactionJob {
+  uint32_t blockHeight;
+  ITransfersContainer* container;
+  Crypto::Hash transactionHash;
+};
+
+// Pending balance refreshes bucketed by unlock height. popUnlocked() only
+// touches the buckets that are due, so the per-block cost follows what
+// actually unlocks rather than the number of pending jobs.
+class UnlockTransactionJobs {
+public:
+  UnlockTransactionJobs();
+
+  bool empty() const { return m_size == 0; }
+  size_t size() const { return m_size; }
+  void clear();
+
+  // An identical job that is already pending is not added twice
+  void insert(const UnlockTransactionJob& job);
+  void erase(const Crypto::Hash& transactionHash);
+  void erase(const ITransfersContainer* container);
+
+  // Removes the jobs with blockHeight <= height and returns their distinct containers
+  std::vector<ITransfersContainer*> popUnlocked(uint32_t height);
+  std::vector<UnlockTransactionJob> getJobs() const;
+
+private:
+  void rebuildHeights();
+
+  std::map<uint32_t, std::vector<UnlockTransactionJob>> m_buckets;
+  std::unordered_multimap<Crypto::Hash, uint32_t> m_heights;
+  size_t m_size;
+};
+
+}
@@ -0,0 +1,415 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "WalletCacheLog.h"
+
+#include <cstring>
+#include <future>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <boost/filesystem/operations.hpp>
+
+#include "Common/ThreadPool.h"
+#include "CryptoNoteCore/CryptoNoteSerialization.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "Serialization/SerializationOverloads.h"
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+namespace {
+
+const char LOG_MAGIC[8] = {'F', 'U', 'E', 'C', 'L', 'O', 'G', '1'};
+const char REFERENCE_MAGIC[16] = {'F', 'U', 'E', 'G', 'O', '-', 'C', 'A', 'C', 'H', 'E', '-', 'L', 'O', 'G', '1'};
+const size_t LOG_HEADER_SIZE = sizeof(LOG_MAGIC) + sizeof(Crypto::Hash);
+const size_t RECORD_LENGTH_SIZE = 4;
+const size_t RECORD_OVERHEAD = RECORD_LENGTH_SIZE + sizeof(Crypto::chacha8_iv) + sizeof(Crypto::Hash);
+
+// content-defined chunking: a boundary falls where the top CHUNK_MASK_BITS of the gear hash are
+// zero, giving chunks of roughly MIN_CHUNK_SIZE + 64 KiB
+const size_t MIN_CHUNK_SIZE = 16 * 1024;
+const size_t MAX_CHUNK_SIZE = 256 * 1024;
+const unsigned CHUNK_MASK_BITS = 16;
+
+// a fresh log is started once dead records outweigh live ones by this much
+const uint64_t COMPACTION_SLACK = 8 * 1024 * 1024;
+
+// new chunks of a save are encrypted on several threads from this much data on
+const size_t PARALLEL_ENCRYPTION_MIN_SIZE = 1024 * 1024;
+
+struct CacheLogChunk {
+  Crypto::Hash hash;
+  uint64_t offset;
+  uint64_t size;
+
+  void serialize(ISerializer& s) {
+    s(hash, "hash");
+    s(offset, "offset");
+    s(size, "size");
+  }
+};
+
+struct CacheLogManifest {
+  uint64_t dataSize;
+  std::vector<CacheLogChunk> chunks;
+
+  void serialize(ISerializer& s) {
+    s(dataSize, "dataSize");
+    s(chunks, "chunks");
+  }
+};
+
+bool syncFile(FILE* file) {
+  if (fflush(file) != 0) {
+    return false;
+  }
+
+#ifdef _WIN32
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
+
+struct GearTable {
+  uint64_t values[256];
+
+  GearTable() {
+    // splitmix64 from a fixed seed, so boundaries are identical from one run to the next
+    uint64_t state = 0x6675656769636c67;
+    for (auto& value : values) {
+      state += 0x9e3779b97f4a7c15;
+      uint64_t z = state;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+      value = z ^ (z >> 31);
+    }
+  }
+};
+
+size_t nextChunkSize(const uint8_t* data, size_t size) {
+  if (size <= MIN_CHUNK_SIZE) {
+    return size;
+  }
+
+  static const GearTable gearTable;
+  const uint64_t* gear = gearTable.values;
+  size_t limit = std::min(size, MAX_CHUNK_SIZE);
+  uint64_t hash = 0;
+  for (size_t i = MIN_CHUNK_SIZE; i < limit; ++i) {
+    hash = (hash << 1) + gear[data[i]];
+    if ((hash >> (64 - CHUNK_MASK_BITS)) == 0) {
+      return i + 1;
+    }
+  }
+
+  return limit;
+}
+
+}
+
+void WalletCacheLog::Reference::serialize(ISerializer& s) {
+  s(logId, "logId");
+  s(slot, "slot");
+  s(manifestOffset, "manifestOffset");
+  s(manifestSize, "manifestSize");
+}
+
+WalletCacheLog::WalletCacheLog() : m_file(nullptr), m_slot(0), m_committedSlot(NO_SLOT), m_fileSize(0) {
+}
+
+WalletCacheLog::~WalletCacheLog() {
+  close();
+}
+
+bool WalletCacheLog::parseReference(const BinaryArray& data, Reference& reference) {
+  if (data.size() < sizeof(REFERENCE_MAGIC) || memcmp(data.data(), REFERENCE_MAGIC, sizeof(REFERENCE_MAGIC)) != 0) {
+    return false;
+  }
+
+  return fromBinaryArray(reference, BinaryArray(data.begin() + sizeof(REFERENCE_MAGIC), data.end()));
+}
+
+BinaryArray WalletCacheLog::makeReference(const Reference& reference) {
+  BinaryArray data(REFERENCE_MAGIC, REFERENCE_MAGIC + sizeof(REFERENCE_MAGIC));
+  BinaryArray body = toBinaryArray(reference);
+  data.insert(data.end(), body.begin(), body.end());
+  return data;
+}
+
+bool WalletCacheLog::load(const std::string& containerPath, const Reference& reference, const Crypto::chacha8_key& key, BinaryArray& data) {
+  close();
+
+  // the container keeps pointing at this slot until the next commit, so it must not be reused
+  m_containerPath = containerPath;
+  m_committedSlot = reference.slot;
+
+  FILE* file = fopen(slotPath(containerPath, reference.slot).c_str(), "r+b");
+  if (file == nullptr) {
+    return false;
+  }
+
+  m_file = file;
+  m_slot = reference.slot;
+
+  char header[LOG_HEADER_SIZE];
+  if (fread(header, 1, sizeof(header), m_file) != sizeof(header) || memcmp(header, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 ||
+      memcmp(header + sizeof(LOG_MAGIC), reference.logId.data, sizeof(reference.logId.data)) != 0) {
+    close();
+    return false;
+  }
+
+  m_logId = reference.logId;
+  fseek(m_file, 0, SEEK_END);
+  m_fileSize = static_cast<uint64_t>(ftell(m_file));
+
+  BinaryArray manifestData;
+  CacheLogManifest manifest;
+  if (!readRecord(Location{reference.manifestOffset, reference.manifestSize}, key, manifestData) || !fromBinaryArray(manifest, manifestData)) {
+    close();
+    return false;
+  }
+
+  data.clear();
+  data.reserve(manifest.dataSize);
+  for (const auto& chunk : manifest.chunks) {
+    BinaryArray chunkData;
+    Location location{chunk.offset, chunk.size};
+    if (!readRecord(location, key, chunkData)) {
+      close();
+      return false;
+    }
+
+    data.insert(data.end(), chunkData.begin(), chunkData.end());
+    m_chunks.emplace(chunk.hash, location);
+  }
+
+  if (data.size() != manifest.dataSize) {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+WalletCacheLog::Reference WalletCacheLog::save(const std::string& containerPath, const Crypto::chacha8_key& key, const void* data, size_t size) {
+  uint64_t liveSize = 0;
+  for (const auto& chunk : m_chunks) {
+    liveSize += chunk.second.size;
+  }
+
+  if (m_containerPath != containerPath) {
+    close();
+    m_containerPath = containerPath;
+    m_committedSlot = NO_SLOT;
+  }
+
+  if (m_file == nullptr || m_fileSize > 2 * liveSize + COMPACTION_SLACK) {
+    // never the committed slot: it stays readable until this save commits
+    create(containerPath, m_committedSlot == 0 ? 1 : 0);
+  }
+
+  CacheLogManifest manifest;
+  manifest.dataSize = size;
+
+  std::unordered_map<Crypto::Hash, Location> chunks;
+  std::vector<PendingRecord> records;
+  const uint8_t* position = static_cast<const uint8_t*>(data);
+  size_t remaining = size;
+  while (remaining != 0) {
+    size_t chunkSize = nextChunkSize(position, remaining);
+    Crypto::Hash hash = Crypto::cn_fast_hash(position, chunkSize);
+
+    Location location;
+    auto it = chunks.find(hash);
+    if (it != chunks.end()) {
+      location = it->second;
+    } else {
+      auto known = m_chunks.find(hash);
+      location = known != m_chunks.end() ? known->second : reserveRecord(position, chunkSize, records);
+      chunks.emplace(hash, location);
+    }
+
+    manifest.chunks.push_back(CacheLogChunk{hash, location.offset, location.size});
+    position += chunkSize;
+    remaining -= chunkSize;
+  }
+
+  encryptRecords(key, records);
+
+  BinaryArray manifestData = toBinaryArray(manifest);
+  Location manifestLocation = appendRecord(key, manifestData.data(), manifestData.size());
+
+  if (fseek(m_file, 0, SEEK_END) != 0 || fwrite(m_pending.data(), 1, m_pending.size(), m_file) != m_pending.size() || !syncFile(m_file)) {
+    m_pending.clear();
+    close();
+    throw std::runtime_error("Failed to write wallet cache log");
+  }
+
+  m_pending.clear();
+  m_chunks.swap(chunks);
+
+  return Reference{m_logId, m_slot, manifestLocation.offset, manifestLocation.size};
+}
+
+void WalletCacheLog::committed() {
+  if (m_file == nullptr || m_committedSlot == m_slot) {
+    return;
+  }
+
+  // the other slot is either the log this save replaced or a leftover of an interrupted one
+  boost::system::error_code ignore;
+  boost::filesystem::remove(slotPath(m_containerPath, m_slot ^ 1), ignore);
+  m_committedSlot = m_slot;
+}
+
+void WalletCacheLog::close() {
+  if (m_file != nullptr) {
+    fclose(m_file);
+    m_file = nullptr;
+  }
+
+  m_fileSize = 0;
+  m_pending.clear();
+  m_chunks.clear();
+}
+
+void WalletCacheLog::create(const std::string& containerPath, uint8_t slot) {
+  close();
+
+  m_slot = slot;
+  m_logId = Crypto::rand<Crypto::Hash>();
+  m_file = fopen(slotPath(containerPath, slot).c_str(), "w+b");
+  if (m_file == nullptr) {
+    throw std::runtime_error("Failed to create wallet cache log");
+  }
+
+  m_pending.insert(m_pending.end(), LOG_MAGIC, LOG_MAGIC + sizeof(LOG_MAGIC));
+  m_pending.insert(m_pending.end(), m_logId.data, m_logId.data + sizeof(m_logId.data));
+  m_fileSize = m_pending.size();
+}
+
+WalletCacheLog::Location WalletCacheLog::appendRecord(const Crypto::chacha8_key& key, const void* data, size_t size) {
+  std::vector<PendingRecord> records;
+  Location location = reserveRecord(data, size, records);
+  encryptRecord(key, records.front());
+  return location;
+}
+
+WalletCacheLog::Location WalletCacheLog::reserveRecord(const void* data, size_t size, std::vector<PendingRecord>& records) {
+  Location location{m_fileSize, RECORD_OVERHEAD + size};
+
+  uint32_t length = static_cast<uint32_t>(sizeof(Crypto::Hash) + size);
+  for (size_t i = 0; i < RECORD_LENGTH_SIZE; ++i) {
+    m_pending.push_back(static_cast<uint8_t>(length >> (8 * i)));
+  }
+
+  Crypto::chacha8_iv iv = Crypto::randomChachaIV();
+  m_pending.insert(m_pending.end(), iv.data, iv.data + sizeof(iv.data));
+
+  records.push_back(PendingRecord{static_cast<const uint8_t*>(data), size, m_pending.size(), iv});
+  m_pending.resize(m_pending.size() + length);
+
+  m_fileSize += location.size;
+  return location;
+}
+
+void WalletCacheLog::encryptRecord(const Crypto::chacha8_key& key, const PendingRecord& record) {
+  BinaryArray plain(sizeof(Crypto::Hash) + record.size);
+  Crypto::Hash checksum = Crypto::cn_fast_hash(record.data, record.size);
+  memcpy(plain.data(), checksum.data, sizeof(checksum.data));
+  memcpy(plain.data() + sizeof(checksum.data), record.data, record.size);
+
+  Crypto::chacha8(plain.data(), plain.size(), key, record.iv, reinterpret_cast<char*>(m_pending.data() + record.offset));
+}
+
+void WalletCacheLog::encryptRecords(const Crypto::chacha8_key& key, const std::vector<PendingRecord>& records) {
+  size_t totalSize = 0;
+  for (const auto& record : records) {
+    totalSize += record.size;
+  }
+
+  size_t threadCount = std::min<size_t>(records.size(), std::thread::hardware_concurrency());
+  if (totalSize < PARALLEL_ENCRYPTION_MIN_SIZE || threadCount < 2) {
+    for (const auto& record : records) {
+      encryptRecord(key, record);
+    }
+
+    return;
+  }
+
+  // each record goes to its own range of m_pending, which is not resized until all are done
+  Common::ThreadPool workers(threadCount, records.size());
+  std::vector<std::future<void>> encrypted;
+  encrypted.reserve(records.size());
+  for (const auto& record : records) {
+    encrypted.push_back(workers.submit([this, &key, &record] { encryptRecord(key, record); }));
+  }
+
+  for (auto& record : encrypted) {
+    record.get();
+  }
+}
+
+bool WalletCacheLog::readRecord(const Location& location, const Crypto::chacha8_key& key, BinaryArray& payload) {
+  if (location.size < RECORD_OVERHEAD || location.offset + location.size > m_fileSize ||
+      fseek(m_file, static_cast<long>(location.offset), SEEK_SET) != 0) {
+    return false;
+  }
+
+  BinaryArray record(location.size);
+  if (fread(record.data(), 1, record.size(), m_file) != record.size()) {
+    return false;
+  }
+
+  uint32_t length = 0;
+  for (size_t i = RECORD_LENGTH_SIZE; i > 0; --i) {
+    length = (length << 8) | record[i - 1];
+  }
+
+  if (RECORD_LENGTH_SIZE + sizeof(Crypto::chacha8_iv) + length != record.size()) {
+    return false;
+  }
+
+  Crypto::chacha8_iv iv;
+  memcpy(iv.data, record.data() + RECORD_LENGTH_SIZE, sizeof(iv.data));
+
+  const uint8_t* cipher = record.data() + RECORD_LENGTH_SIZE + sizeof(iv.data);
+  BinaryArray plain(length);
+  Crypto::chacha8(cipher, length, key, iv, reinterpret_cast<char*>(plain.data()));
+
+  Crypto::Hash checksum = Crypto::cn_fast_hash(plain.data() + sizeof(Crypto::Hash), length - sizeof(Crypto::Hash));
+  if (memcmp(checksum.data, plain.data(), sizeof(checksum.data)) != 0) {
+    return false;
+  }
+
+  payload.assign(plain.begin() + sizeof(Crypto::Hash), plain.end());
+  return true;
+}
+
+std::string WalletCacheLog::slotPath(const std::string& containerPath, uint8_t slot) {
+  return containerPath + ".cache" + std::to_string(slot);
+}
+
+}
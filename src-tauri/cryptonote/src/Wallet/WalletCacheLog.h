@@ -0,0 +1,101 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CryptoNote.h"
+#include "crypto/chacha8.h"
+#include "Serialization/ISerializer.h"
+
+namespace CryptoNote {
+
+// Append-only store for the serialized wallet cache, kept next to the container file. save()
+// cuts the cache at content-defined boundaries, so data inserted in the middle only changes the
+// chunks around it, and appends just the chunks the log does not hold yet plus a manifest that
+// lists the chunks in order. Each record is stored as uint32 length (little endian), a random
+// chacha8 iv and the encrypted cn_fast_hash of the payload followed by the payload.
+//
+// The container suffix holds a reference to the manifest, so a save commits when the suffix is
+// rewritten and committed() is called. When most of the log is no longer referenced, save()
+// starts a fresh log in the other of two slot files; the old one is removed on commit.
+class WalletCacheLog {
+public:
+  struct Reference {
+    Crypto::Hash logId;
+    uint8_t slot;
+    uint64_t manifestOffset;
+    uint64_t manifestSize;
+
+    void serialize(ISerializer& s);
+  };
+
+  WalletCacheLog();
+  ~WalletCacheLog();
+
+  // true if data is an encoded Reference rather than a serialized cache
+  static bool parseReference(const BinaryArray& data, Reference& reference);
+  static BinaryArray makeReference(const Reference& reference);
+
+  // reassembles the cache the reference points to and keeps the log open for later saves
+  bool load(const std::string& containerPath, const Reference& reference, const Crypto::chacha8_key& key, BinaryArray& data);
+  Reference save(const std::string& containerPath, const Crypto::chacha8_key& key, const void* data, size_t size);
+  // called once the reference returned by save() is durable in the container
+  void committed();
+  void close();
+
+private:
+  static const int NO_SLOT = -1;
+
+  struct Location {
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  // a record whose header is in m_pending and whose encrypted payload goes at offset
+  struct PendingRecord {
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+    Crypto::chacha8_iv iv;
+  };
+
+  void create(const std::string& containerPath, uint8_t slot);
+  Location appendRecord(const Crypto::chacha8_key& key, const void* data, size_t size);
+  Location reserveRecord(const void* data, size_t size, std::vector<PendingRecord>& records);
+  void encryptRecord(const Crypto::chacha8_key& key, const PendingRecord& record);
+  // records have independent ivs, so large saves encrypt them on several threads
+  void encryptRecords(const Crypto::chacha8_key& key, const std::vector<PendingRecord>& records);
+  bool readRecord(const Location& location, const Crypto::chacha8_key& key, BinaryArray& payload);
+  static std::string slotPath(const std::string& containerPath, uint8_t slot);
+
+  std::string m_containerPath;
+  FILE* m_file;
+  Crypto::Hash m_logId;
+  uint8_t m_slot;
+  int m_committedSlot;
+  uint64_t m_fileSize;
+  BinaryArray m_pending;                              // records not written out yet
+  std::unordered_map<Crypto::Hash, Location> m_chunks; // chunks referenced by the last manifest
+};
+
+}
@@ -18,14 +18,19 @@
 #include "WalletGreen.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <ctime>
+#include <map>
 #include <cassert>
 #include <numeric>
 #include <random>
 #include <set>
 #include <tuple>
+#include <unordered_set>
 #include <utility>
 #include <fstream>
+#include <future>
 #include <System/EventLock.h>
 #include <System/RemoteContext.h>
 
@@ -36,6 +41,7 @@
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "Common/StringTools.h"
+#include "Common/Tracing.h"
 #include "CryptoNoteCore/Account.h"
 #include "CryptoNoteCore/Currency.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
@@ -43,7 +49,10 @@
 #include "CryptoNoteCore/TransactionApi.h"
 #include <CryptoNoteCore/TransactionExtra.h>
 #include "crypto/crypto.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
 #include "Transfers/TransfersContainer.h"
+#include "WalletLegacy/ChachaStreams.h"
 #include "WalletSerializationV1.h"
 #include "WalletSerializationV2.h"
 #include "WalletErrors.h"
@@ -57,6 +66,9 @@ using namespace Logging;
 namespace
 {
 
+  const size_t BATCH_MAX_ORDERS_PER_TRANSACTION = 128; // halved while a transaction comes out too big
+  const size_t BATCH_MAX_RELAYS_IN_FLIGHT = 4;
+  const uint32_t HISTORY_ARCHIVE_DEPTH = 1000; // confirmations before a transaction is moved to the history store
   std::vector<uint64_t> split(uint64_t amount, uint64_t dustThreshold)
   {
     std::vector<uint64_t> amounts;
@@ -191,7 +203,7 @@ namespace
 
   size_t getTransactionSize(const ITransactionReader &transaction)
   {
-    return transaction.getTransactionData().size();
+    return transaction.getTransactionDataSize();
   }
 
   std::vector<WalletTransfer> convertOrdersToTransfers(const std::vector<WalletOrder> &orders)
@@ -262,6 +274,25 @@ namespace
     return donationAmount;
   }
 
+  // Runs work(begin, end) over [0, count) in a few chunks per worker and waits for all of them
+  template <typename Work>
+  void forEachChunk(Common::ThreadPool &workers, size_t count, Work work)
+  {
+    const size_t MIN_CHUNK_SIZE = 64;
+    size_t chunkSize = std::max(MIN_CHUNK_SIZE, count / (4 * workers.workerCount()) + 1);
+    std::vector<std::future<void>> pending;
+    for (size_t begin = 0; begin < count; begin += chunkSize)
+    {
+      size_t end = std::min(count, begin + chunkSize);
+      pending.push_back(workers.submit([work, begin, end] { work(begin, end); }));
+    }
+
+    for (auto &chunk : pending)
+    {
+      chunk.get();
+    }
+  }
+
   CryptoNote::AccountPublicAddress parseAccountAddressString(
       const std::string &addressString,
       const CryptoNote::Currency &currency)
@@ -285,11 +316,18 @@ namespace CryptoNote
                                                                                                                                                                 m_currency(currency),
                                                                                                                                                                 m_node(node),
                                                                                                                                                                 m_logger(logger, "WalletGreen"),
+                                                                                                                                                                m_mixinCache(dispatcher, node),
                                                                                                                                                                 m_stopped(false),
+                                                                                                                                                                m_saveContext(dispatcher),
+                                                                                                                                                                m_feeEstimator(currency.minimumFee(), currency.defaultDustThreshold(), currency.transactionMaxSize()),
+                                                                                                                                                                m_transactionIndexesBuilt(false),
                                                                                                                                                                 m_blockchainSynchronizerStarted(false),
+                                                                                                                                                                m_rescanInProgress(false),
                                                                                                                                                                 m_blockchainSynchronizer(node, currency.genesisBlockHash()),
                                                                                                                                                                 m_synchronizer(currency, logger, m_blockchainSynchronizer, node),
                                                                                                                                                                 m_eventOccurred(m_dispatcher),
+                                                                                                                                                                m_coalesceEvents(false),
+                                                                                                                                                                m_balanceUnlockedQueued(false),
                                                                                                                                                                 m_readyEvent(m_dispatcher),
                                                                                                                                                                 m_state(WalletState::NOT_INITIALIZED),
                                                                                                                                                                 m_actualBalance(0),
@@ -300,6 +338,8 @@ namespace CryptoNote
   {
     m_upperTransactionSizeLimit = m_currency.transactionMaxSize();
     m_readyEvent.set();
+    // the suffix is an iv and a length prefixed blob, bytes left behind it by an interrupted growth are never read
+    m_containerStorage.setInPlaceGrowth(true);
   }
 
   WalletGreen::~WalletGreen()
@@ -352,7 +392,7 @@ namespace CryptoNote
     }
 
     /* Create the transaction */
-    std::unique_ptr<ITransaction> transaction = createTransaction();
+    PooledTransaction transaction = acquireTransaction();
 
     std::vector<TransactionOutputInformation> selectedTransfers;
 
@@ -412,6 +452,8 @@ namespace CryptoNote
       transaction->appendExtra(ba);
     }
 
+    transaction->appendViewTags();
+
     assert(inputs.size() == selectedTransfers.size());
     for (size_t i = 0; i < inputs.size(); ++i)
     {
@@ -506,12 +548,12 @@ namespace CryptoNote
     CryptoNote::AccountPublicAddress destAddr = parseAddress(destinationAddress);
 
     /* Create the transaction */
-    std::unique_ptr<ITransaction> transaction = createTransaction();
+    PooledTransaction transaction = acquireTransaction();
 
     /* Select the wallet - If no source address was specified then it will pick funds from anywhere
      and the change will go to the primary address of the wallet container */
     std::vector<WalletOuts> wallets;
-    wallets = pickWallets({sourceAddress});
+    wallets = pickSpendingWallets({sourceAddress});
 
     /* Select the transfers */
     uint64_t fee = CryptoNote::parameters::MINIMUM_FEE;
@@ -605,6 +647,8 @@ namespace CryptoNote
       transaction->appendExtra(ba);
     }
 
+    transaction->appendViewTags();
+
     /* Prepare the inputs */
 
     /* Get additional inputs for the mixin */
@@ -617,15 +661,11 @@ namespace CryptoNote
     std::vector<KeyPair> ephKeys;
     for (auto &input : keysInfo)
     {
-      transaction->addInput(makeAccountKeys(*input.walletRecord), input.keyInfo, input.ephKeys);
+      transaction->addInput(makeAccountKeys(*input.walletRecord), input.keyInfo, input.keyImage, input.ephKeys);
     }
 
     /* Now sign the inputs so we can proceed with the transaction */
-    size_t i = 0;
-    for (auto &input : keysInfo)
-    {
-      transaction->signInputKey(i++, input.keyInfo, input.ephKeys);
-    }
+    signInputs(*transaction, keysInfo);
 
     /* Return the transaction hash */
     transactionHash = Common::podToHex(transaction->getTransactionHash());
@@ -703,14 +743,48 @@ namespace CryptoNote
 
   void WalletGreen::loadSpendKeys()
   {
-    bool isTrackingMode;
-    for (size_t i = 0; i < m_containerStorage.size(); ++i)
+    // decrypting every record and deriving its public key again dominates opening a wallet with many
+    // addresses, so that part runs on the signing workers and only the consistency checks stay in order
+    size_t count = m_containerStorage.size();
+    std::vector<WalletRecord> wallets(count);
+    std::vector<uint8_t> keysValid(count);
+    const EncryptedWalletRecord *records = m_containerStorage.data();
+    WalletRecord *walletsData = wallets.data();
+    uint8_t *keysValidData = keysValid.data();
+    const Crypto::chacha8_key &key = m_key;
+    auto decrypt = [records, walletsData, keysValidData, &key](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+      {
+        WalletRecord &wallet = walletsData[i];
+        uint64_t creationTimestamp;
+        decryptKeyPair(records[i], wallet.spendPublicKey, wallet.spendSecretKey, creationTimestamp, key);
+        wallet.creationTimestamp = creationTimestamp;
+
+        if (wallet.spendSecretKey != NULL_SECRET_KEY)
+        {
+          Crypto::PublicKey publicKey;
+          keysValidData[i] = Crypto::secret_key_to_public_key(wallet.spendSecretKey, publicKey) && publicKey == wallet.spendPublicKey;
+        }
+        else
+        {
+          keysValidData[i] = Crypto::check_key(wallet.spendPublicKey);
+        }
+      }
+    };
+
+    if (count > 1)
     {
-      WalletRecord wallet;
-      uint64_t creationTimestamp;
-      decryptKeyPair(m_containerStorage[i], wallet.spendPublicKey, wallet.spendSecretKey, creationTimestamp);
-      wallet.creationTimestamp = creationTimestamp;
+      forEachChunk(signingWorkers(), count, decrypt);
+    }
+    else
+    {
+      decrypt(0, count);
+    }
 
+    bool isTrackingMode;
+    for (size_t i = 0; i < count; ++i)
+    {
+      WalletRecord &wallet = wallets[i];
       if (i == 0)
       {
         isTrackingMode = wallet.spendSecretKey == NULL_SECRET_KEY;
@@ -720,16 +794,14 @@ namespace CryptoNote
         throw std::system_error(make_error_code(error::BAD_ADDRESS), "All addresses must be whether tracking or not");
       }
 
-      if (wallet.spendSecretKey != NULL_SECRET_KEY)
+      if (!keysValid[i])
       {
-        throwIfKeysMissmatch(wallet.spendSecretKey, wallet.spendPublicKey, "Restored spend public key doesn't correspond to secret key");
-      }
-      else
-      {
-        if (!Crypto::check_key(wallet.spendPublicKey))
+        if (wallet.spendSecretKey != NULL_SECRET_KEY)
         {
-          throw std::system_error(make_error_code(error::WRONG_PASSWORD), "Public spend key is incorrect");
+          throw std::system_error(make_error_code(error::WRONG_PASSWORD), "Restored spend public key doesn't correspond to secret key");
         }
+
+        throw std::system_error(make_error_code(error::WRONG_PASSWORD), "Public spend key is incorrect");
       }
 
       wallet.actualBalance = 0;
@@ -799,6 +871,24 @@ namespace CryptoNote
   {
     m_logger(INFO) << "Saving cache...";
 
+    std::string containerData = serializeWalletCache(saveLevel, extra, false);
+    encryptAndSaveContainerData(storage, key, containerData.data(), containerData.size());
+    storage.flush();
+
+    m_extra = extra;
+
+    m_logger(INFO) << "Container saving finished";
+  }
+
+  std::string WalletGreen::serializeWalletCache(WalletSaveLevel saveLevel, const std::string &extra, bool useHistory)
+  {
+    // only a full save to the open container is paired with the history store
+    useHistory = useHistory && saveLevel == WalletSaveLevel::SAVE_ALL;
+    if (useHistory)
+    {
+      archiveWalletHistory();
+    }
+
     WalletTransactions transactions;
     WalletTransfers transfers;
     if (saveLevel == WalletSaveLevel::SAVE_KEYS_AND_TRANSACTIONS)
@@ -822,6 +912,11 @@ namespace CryptoNote
       });
     }
 
+    if (!useHistory && saveLevel != WalletSaveLevel::SAVE_KEYS_ONLY)
+    {
+      addArchivedHistory(transactions, transfers);
+    }
+
     std::string containerData;
     Common::StringOutputStream containerStream(containerData);
     WalletSerializerV2 s(
@@ -842,16 +937,51 @@ namespace CryptoNote
         const_cast<std::string &>(extra),
         m_transactionSoftLockTime);
     s.save(containerStream, saveLevel);
-    encryptAndSaveContainerData(storage, key, containerData.data(), containerData.size());
-    storage.flush();
 
-    m_extra = extra;
+    if (useHistory)
+    {
+      WalletHistoryStore::Reference historyReference = m_history.reference();
+      BinaryOutputStreamSerializer historySerializer(containerStream);
+      historyReference.serialize(historySerializer);
+    }
 
-    m_logger(INFO) << "Container saving finished";
+    return containerData;
+  }
+
+  void WalletGreen::startCacheLogSave(std::shared_ptr<const std::string> containerData)
+  {
+    std::string path = m_path;
+    Crypto::chacha8_key key = m_key;
+    m_saveContext.spawn([this, containerData, path, key] {
+      try
+      {
+        // the log only appends chunks it has not stored yet, the suffix keeps a fixed-size reference
+        WalletCacheLog::Reference reference = System::RemoteContext<WalletCacheLog::Reference>(m_dispatcher, [this, &containerData, &path, &key] {
+          return m_cacheLog.save(path, key, containerData->data(), containerData->size());
+        }).get();
+
+        BinaryArray referenceData = WalletCacheLog::makeReference(reference);
+        encryptAndSaveContainerData(m_containerStorage, key, referenceData.data(), referenceData.size());
+        m_containerStorage.flush();
+        m_cacheLog.committed();
+        m_logger(INFO, BRIGHT_WHITE) << "Container saved";
+      }
+      catch (const std::exception &e)
+      {
+        m_logger(ERROR, BRIGHT_RED) << "Failed to save container: " << e.what();
+      }
+    });
+  }
+
+  void WalletGreen::waitForPendingSave()
+  {
+    m_saveContext.wait();
   }
 
   void WalletGreen::doShutdown()
   {
+    waitForPendingSave();
+
     if (m_walletsContainer.size() != 0)
     {
       m_synchronizer.unsubscribeConsumerNotifications(m_viewPublicKey, this);
@@ -859,13 +989,17 @@ namespace CryptoNote
 
     stopBlockchainSynchronizer();
     m_blockchainSynchronizer.removeObserver(this);
+    m_blockchainSynchronizer.setRescanPlan(nullptr);
+    m_rescanInProgress = false;
 
     m_containerStorage.close();
+    m_cacheLog.close();
+    m_history.close();
     m_walletsContainer.clear();
     clearCaches(true, true);
+    m_mixinCache.clear();
 
-    std::queue<WalletEvent> noEvents;
-    std::swap(m_events, noEvents);
+    clearEvents();
 
     m_state = WalletState::NOT_INITIALIZED;
   }
@@ -928,11 +1062,14 @@ namespace CryptoNote
     throwIfNotInitialized();
     throwIfStopped();
 
+    waitForPendingSave();
     stopBlockchainSynchronizer();
 
+    // only taking the snapshot holds up the wallet, it is written out in the background
+    std::shared_ptr<const std::string> containerData;
     try
     {
-      saveWalletCache(m_containerStorage, m_key, saveLevel, extra);
+      containerData = std::make_shared<const std::string>(serializeWalletCache(saveLevel, extra, true));
     }
     catch (const std::exception &e)
     {
@@ -941,8 +1078,9 @@ namespace CryptoNote
       throw;
     }
 
+    m_extra = extra;
     startBlockchainSynchronizer();
-    m_logger(INFO, BRIGHT_WHITE) << "Container saved";
+    startCacheLogSave(containerData);
   }
 
   void WalletGreen::copyContainerStorageKeys(ContainerStorage &src, const chacha8_key &srcKey, ContainerStorage &dst, const chacha8_key &dstKey)
@@ -1172,16 +1310,25 @@ namespace CryptoNote
     suffixSerializer(encryptedContainer, "encryptedContainer");
 
     containerData.resize(encryptedContainer.size());
-    chacha8(encryptedContainer.data(), encryptedContainer.size(), key, suffixIv, reinterpret_cast<char *>(containerData.data()));
+    parallelChacha8(encryptedContainer.data(), encryptedContainer.size(), key, suffixIv, reinterpret_cast<char *>(containerData.data()));
   }
 
-  void WalletGreen::loadWalletCache(std::unordered_set<Crypto::PublicKey> &addedKeys, std::unordered_set<Crypto::PublicKey> &deletedKeys, std::string &extra)
+  void WalletGreen::loadWalletCache(const std::string &path, std::unordered_set<Crypto::PublicKey> &addedKeys, std::unordered_set<Crypto::PublicKey> &deletedKeys, std::string &extra)
   {
     assert(m_containerStorage.isOpened());
 
     BinaryArray contanerData;
     loadAndDecryptContainerData(m_containerStorage, m_key, contanerData);
 
+    WalletCacheLog::Reference reference;
+    if (WalletCacheLog::parseReference(contanerData, reference))
+    {
+      if (!m_cacheLog.load(path, reference, m_key, contanerData))
+      {
+        throw std::runtime_error("Wallet cache log is missing or damaged");
+      }
+    }
+
     WalletSerializerV2 s(
         *this,
         m_viewPublicKey,
@@ -1205,6 +1352,20 @@ namespace CryptoNote
     addedKeys = std::move(s.addedKeys());
     deletedKeys = std::move(s.deletedKeys());
 
+    // full saves end with the reference to the history store holding the oldest transactions
+    if (!containerStream.endOfStream())
+    {
+      WalletHistoryStore::Reference historyReference;
+      BinaryInputStreamSerializer historySerializer(containerStream);
+      historyReference.serialize(historySerializer);
+
+      if (historyReference.transactionCount > m_transactions.size() ||
+          (historyReference.transactionCount > 0 && !m_history.open(path, m_key, historyReference)))
+      {
+        throw std::runtime_error("Wallet history store is missing or damaged");
+      }
+    }
+
     m_logger(INFO) << "Container cache loaded";
   }
 
@@ -1246,7 +1407,7 @@ namespace CryptoNote
 
     BinaryArray encryptedContainer;
     encryptedContainer.resize(containerDataSize);
-    chacha8(containerData, containerDataSize, key, suffixIv, reinterpret_cast<char *>(encryptedContainer.data()));
+    parallelChacha8(containerData, containerDataSize, key, suffixIv, reinterpret_cast<char *>(encryptedContainer.data()));
 
     std::string suffix;
     Common::StringOutputStream suffixStream(suffix);
@@ -1320,7 +1481,7 @@ namespace CryptoNote
         {
           std::unordered_set<Crypto::PublicKey> addedSpendKeys;
           std::unordered_set<Crypto::PublicKey> deletedSpendKeys;
-          loadWalletCache(addedSpendKeys, deletedSpendKeys, extra);
+          loadWalletCache(path, addedSpendKeys, deletedSpendKeys, extra);
 
           if (!addedSpendKeys.empty())
           {
@@ -1408,13 +1569,23 @@ namespace CryptoNote
   {
     if (clearTransactions)
     {
+      m_history.close();
       m_transactions.clear();
       m_transfers.clear();
       m_deposits.clear();
+      m_addressTransactions.clear();
+      m_paymentIdTransactions.clear();
+      m_transactionIndexesBuilt = false;
+    }
+    else if (clearCachedData)
+    {
+      restoreWalletHistory(0);
     }
 
     if (clearCachedData)
     {
+      m_spendableOutputs.clear();
+
       size_t walletIndex = 0;
       for (auto it = m_walletsContainer.begin(); it != m_walletsContainer.end(); ++it)
       {
@@ -1618,71 +1789,152 @@ namespace CryptoNote
     std::vector<NewAddressData> addressDataList(spendSecretKeys.size());
     for (size_t i = 0; i < spendSecretKeys.size(); ++i)
     {
-      Crypto::PublicKey spendPublicKey;
-      if (!Crypto::secret_key_to_public_key(spendSecretKeys[i], spendPublicKey))
-      {
-        m_logger(ERROR) << "createAddressList(): failed to convert secret key to public key";
-        throw std::system_error(make_error_code(CryptoNote::error::KEY_GENERATION_ERROR));
-      }
-
       addressDataList[i].spendSecretKey = spendSecretKeys[i];
-      addressDataList[i].spendPublicKey = spendPublicKey;
       addressDataList[i].creationTimestamp = reset ? 0 : static_cast<uint64_t>(time(nullptr));
     }
 
+    if (!deriveSpendPublicKeys(addressDataList, false))
+    {
+      m_logger(ERROR) << "createAddressList(): failed to convert secret key to public key";
+      throw std::system_error(make_error_code(CryptoNote::error::KEY_GENERATION_ERROR));
+    }
+
+    return doCreateAddressList(addressDataList);
+  }
+
+  std::vector<std::string> WalletGreen::createAddresses(size_t count)
+  {
+    std::vector<NewAddressData> addressDataList(count);
+    uint64_t creationTimestamp = static_cast<uint64_t>(time(nullptr));
+    for (auto &addressData : addressDataList)
+    {
+      addressData.spendSecretKey = Crypto::rand<Crypto::SecretKey>();
+      addressData.creationTimestamp = creationTimestamp;
+    }
+
+    deriveSpendPublicKeys(addressDataList, true);
     return doCreateAddressList(addressDataList);
   }
 
+  // The scalar multiplications of a batch run on the signing workers. With fromSeeds the secret
+  // keys are random seeds reduced to keys first, otherwise a secret key that is not a valid
+  // scalar fails the batch.
+  bool WalletGreen::deriveSpendPublicKeys(std::vector<NewAddressData> &addressDataList, bool fromSeeds)
+  {
+    std::atomic<bool> derived(true);
+    NewAddressData *data = addressDataList.data();
+    forEachChunk(signingWorkers(), addressDataList.size(), [data, fromSeeds, &derived](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+      {
+        if (fromSeeds)
+        {
+          Crypto::SecretKey seed = data[i].spendSecretKey;
+          Crypto::generate_keys_from_seed(data[i].spendPublicKey, data[i].spendSecretKey, seed);
+        }
+        else if (!Crypto::secret_key_to_public_key(data[i].spendSecretKey, data[i].spendPublicKey))
+        {
+          derived = false;
+        }
+      }
+    });
+
+    return derived;
+  }
+
   std::vector<std::string> WalletGreen::doCreateAddressList(const std::vector<NewAddressData> &addressDataList)
   {
     throwIfNotInitialized();
     throwIfStopped();
 
-    stopBlockchainSynchronizer();
+    // everything that can reject the batch is checked before the container is touched
+    auto &index = m_walletsContainer.get<KeysIndex>();
+    auto trackingMode = getTrackingMode();
+    if (trackingMode == WalletTrackingMode::NO_ADDRESSES && !addressDataList.empty())
+    {
+      // the first address decides the mode of an empty wallet
+      trackingMode = addressDataList.front().spendSecretKey == NULL_SECRET_KEY ? WalletTrackingMode::TRACKING : WalletTrackingMode::NOT_TRACKING;
+    }
 
-    std::vector<std::string> addresses;
-    try
+    std::unordered_set<Crypto::PublicKey> batchKeys;
+    batchKeys.reserve(addressDataList.size());
+    for (auto &addressData : addressDataList)
     {
-      uint64_t minCreationTimestamp = std::numeric_limits<uint64_t>::max();
+      if ((trackingMode == WalletTrackingMode::TRACKING && addressData.spendSecretKey != NULL_SECRET_KEY) ||
+          (trackingMode == WalletTrackingMode::NOT_TRACKING && addressData.spendSecretKey == NULL_SECRET_KEY))
+      {
+        throw std::system_error(make_error_code(error::WRONG_PARAMETERS));
+      }
 
+      if (index.find(addressData.spendPublicKey) != index.end() || !batchKeys.insert(addressData.spendPublicKey).second)
       {
-        if (addressDataList.size() > 1)
-        {
-          m_containerStorage.setAutoFlush(false);
-        }
+        m_logger(ERROR, BRIGHT_RED) << "Failed to add wallet: address already exists, " << m_currency.accountAddressAsString(AccountPublicAddress{addressData.spendPublicKey, m_viewPublicKey});
+        throw std::system_error(make_error_code(error::ADDRESS_ALREADY_EXISTS));
+      }
+    }
 
-        Tools::ScopeExit exitHandler([this] {
-          if (!m_containerStorage.getAutoFlush())
-          {
-            m_containerStorage.setAutoFlush(true);
-            m_containerStorage.flush();
-          }
-        });
+    // the records are encrypted on the workers, each with the IV the container would have handed it
+    std::vector<EncryptedWalletRecord> records(addressDataList.size());
+    Crypto::chacha8_iv firstIv = getNextIv();
+    const NewAddressData *data = addressDataList.data();
+    EncryptedWalletRecord *encrypted = records.data();
+    const Crypto::chacha8_key &key = m_key;
+    forEachChunk(signingWorkers(), records.size(), [data, encrypted, &key, firstIv](size_t begin, size_t end) {
+      Crypto::chacha8_iv iv = firstIv;
+      for (size_t i = 0; i < begin; ++i)
+      {
+        incIv(iv);
+      }
 
-        for (auto &addressData : addressDataList)
-        {
-          assert(addressData.creationTimestamp <= std::numeric_limits<uint64_t>::max() - m_currency.blockFutureTimeLimit());
-          std::string address = addWallet(addressData.spendPublicKey, addressData.spendSecretKey, addressData.creationTimestamp);
-          m_logger(INFO, BRIGHT_WHITE) << "New wallet added " << address << ", creation timestamp " << addressData.creationTimestamp;
-          addresses.push_back(std::move(address));
+      for (size_t i = begin; i < end; ++i)
+      {
+        encrypted[i] = encryptKeyPair(data[i].spendPublicKey, data[i].spendSecretKey, data[i].creationTimestamp, key, iv);
+        incIv(iv);
+      }
+    });
 
-          minCreationTimestamp = std::min(minCreationTimestamp, addressData.creationTimestamp);
-        }
+    stopBlockchainSynchronizer();
+
+    std::vector<std::string> addresses;
+    addresses.reserve(addressDataList.size());
+    size_t storedCount = m_containerStorage.size();
+    try
+    {
+      // one append and one flush of the container file for the whole batch
+      m_containerStorage.insert(m_containerStorage.end(), records.begin(), records.end());
+      for (size_t i = 0; i < records.size(); ++i)
+      {
+        incNextIv();
       }
 
-      m_containerStorage.setAutoFlush(true);
       auto currentTime = static_cast<uint64_t>(time(nullptr));
-      if (minCreationTimestamp + m_currency.blockFutureTimeLimit() < currentTime)
+      for (auto &addressData : addressDataList)
       {
-        m_logger(DEBUGGING) << "Reset is required";
-        save(WalletSaveLevel::SAVE_KEYS_AND_TRANSACTIONS, m_extra);
-        shutdown();
-        load(m_path, m_password);
+        assert(addressData.creationTimestamp <= std::numeric_limits<uint64_t>::max() - m_currency.blockFutureTimeLimit());
+        // an address created just now has no history; an older one is scanned on its own instead of resetting the container
+        bool scanHistory = addressData.creationTimestamp + m_currency.blockFutureTimeLimit() < currentTime;
+        std::string address = addWallet(addressData.spendPublicKey, addressData.spendSecretKey, addressData.creationTimestamp, scanHistory);
+        m_logger(INFO, BRIGHT_WHITE) << "New wallet added " << address << ", creation timestamp " << addressData.creationTimestamp;
+        addresses.push_back(std::move(address));
       }
     }
     catch (const std::exception &e)
     {
       m_logger(ERROR, BRIGHT_RED) << "Failed to add wallets: " << e.what();
+
+      // the addresses subscribed before the failure stay, the records of the rest go
+      try
+      {
+        size_t keptCount = storedCount + addresses.size();
+        if (m_containerStorage.size() > keptCount)
+        {
+          m_containerStorage.erase(std::next(m_containerStorage.begin(), keptCount), m_containerStorage.end());
+        }
+      }
+      catch (...)
+      {
+        m_logger(ERROR) << "Failed to rollback adding wallets to storage";
+      }
+
       startBlockchainSynchronizer();
       throw;
     }
@@ -1704,78 +1956,42 @@ namespace CryptoNote
     return addresses.front();
   }
 
-  std::string WalletGreen::addWallet(const Crypto::PublicKey &spendPublicKey, const Crypto::SecretKey &spendSecretKey, uint64_t creationTimestamp)
+  // Subscribes an address whose record is already in the container storage
+  std::string WalletGreen::addWallet(const Crypto::PublicKey &spendPublicKey, const Crypto::SecretKey &spendSecretKey, uint64_t creationTimestamp, bool scanHistory)
   {
     auto &index = m_walletsContainer.get<KeysIndex>();
 
-    auto trackingMode = getTrackingMode();
-
-    if ((trackingMode == WalletTrackingMode::TRACKING && spendSecretKey != NULL_SECRET_KEY) ||
-        (trackingMode == WalletTrackingMode::NOT_TRACKING && spendSecretKey == NULL_SECRET_KEY))
-    {
+    AccountSubscription sub;
+    sub.keys.address.viewPublicKey = m_viewPublicKey;
+    sub.keys.address.spendPublicKey = spendPublicKey;
+    sub.keys.viewSecretKey = m_viewSecretKey;
+    sub.keys.spendSecretKey = spendSecretKey;
+    sub.transactionSpendableAge = m_transactionSoftLockTime;
+    sub.syncStart.height = 0;
+    sub.syncStart.timestamp = std::max(creationTimestamp, ACCOUNT_CREATE_TIME_ACCURACY) - ACCOUNT_CREATE_TIME_ACCURACY;
 
-      throw std::system_error(make_error_code(error::WRONG_PARAMETERS));
-    }
+    auto &trSubscription = scanHistory ? m_synchronizer.addCatchUpSubscription(sub) : m_synchronizer.addSubscription(sub);
+    ITransfersContainer *container = &trSubscription.getContainer();
 
-    auto insertIt = index.find(spendPublicKey);
-    if (insertIt != index.end())
-    {
-      m_logger(ERROR, BRIGHT_RED) << "Failed to add wallet: address already exists, " << m_currency.accountAddressAsString(AccountPublicAddress{spendPublicKey, m_viewPublicKey});
-      throw std::system_error(make_error_code(error::ADDRESS_ALREADY_EXISTS));
-    }
+    WalletRecord wallet;
+    wallet.spendPublicKey = spendPublicKey;
+    wallet.spendSecretKey = spendSecretKey;
+    wallet.container = container;
+    wallet.creationTimestamp = static_cast<time_t>(creationTimestamp);
+    trSubscription.addObserver(this);
 
-    m_containerStorage.push_back(encryptKeyPair(spendPublicKey, spendSecretKey, creationTimestamp));
-    incNextIv();
+    index.insert(std::move(wallet));
+    m_logger(DEBUGGING) << "Wallet count " << m_walletsContainer.size();
 
-    try
+    if (index.size() == 1)
     {
-      AccountSubscription sub;
-      sub.keys.address.viewPublicKey = m_viewPublicKey;
-      sub.keys.address.spendPublicKey = spendPublicKey;
-      sub.keys.viewSecretKey = m_viewSecretKey;
-      sub.keys.spendSecretKey = spendSecretKey;
-      sub.transactionSpendableAge = m_transactionSoftLockTime;
-      sub.syncStart.height = 0;
-      sub.syncStart.timestamp = std::max(creationTimestamp, ACCOUNT_CREATE_TIME_ACCURACY) - ACCOUNT_CREATE_TIME_ACCURACY;
-
-      auto &trSubscription = m_synchronizer.addSubscription(sub);
-      ITransfersContainer *container = &trSubscription.getContainer();
-
-      WalletRecord wallet;
-      wallet.spendPublicKey = spendPublicKey;
-      wallet.spendSecretKey = spendSecretKey;
-      wallet.container = container;
-      wallet.creationTimestamp = static_cast<time_t>(creationTimestamp);
-      trSubscription.addObserver(this);
-
-      index.insert(insertIt, std::move(wallet));
-      m_logger(DEBUGGING) << "Wallet count " << m_walletsContainer.size();
-
-      if (index.size() == 1)
-      {
-        m_synchronizer.subscribeConsumerNotifications(m_viewPublicKey, this);
-        initBlockchain(m_viewPublicKey);
-      }
-
-      auto address = m_currency.accountAddressAsString({spendPublicKey, m_viewPublicKey});
-      m_logger(DEBUGGING) << "Wallet added " << address << ", creation timestamp " << creationTimestamp;
-      return address;
+      m_synchronizer.subscribeConsumerNotifications(m_viewPublicKey, this);
+      initBlockchain(m_viewPublicKey);
     }
-    catch (const std::exception &e)
-    {
-      m_logger(ERROR) << "Failed to add wallet: " << e.what();
-
-      try
-      {
-        m_containerStorage.pop_back();
-      }
-      catch (...)
-      {
-        m_logger(ERROR) << "Failed to rollback adding wallet to storage";
-      }
 
-      throw;
-    }
+    auto address = m_currency.accountAddressAsString({spendPublicKey, m_viewPublicKey});
+    m_logger(DEBUGGING) << "Wallet added " << address << ", creation timestamp " << creationTimestamp;
+    return address;
   }
 
   void WalletGreen::deleteAddress(const std::string &address)
@@ -1799,6 +2015,7 @@ namespace CryptoNote
     m_synchronizer.removeSubscription(pubAddr);
 
     deleteContainerFromUnlockTransactionJobs(it->container);
+    m_spendableOutputs.invalidate(it->container);
     std::vector<size_t> deletedTransactions;
     std::vector<size_t> updatedTransactions = deleteTransfersForAddress(address, deletedTransactions);
     deleteFromUncommitedTransactions(deletedTransactions);
@@ -1912,7 +2129,13 @@ namespace CryptoNote
       throw std::system_error(make_error_code(CryptoNote::error::INDEX_OUT_OF_RANGE));
     }
 
-    return m_transactions.get<RandomAccessIndex>()[transactionIndex];
+    WalletTransaction transaction = m_transactions.get<RandomAccessIndex>()[transactionIndex];
+    if (transactionIndex < m_history.transactionCount())
+    {
+      transaction.extra = m_history.get(transactionIndex).extra;
+    }
+
+    return transaction;
   }
 
   Deposit WalletGreen::getDeposit(size_t depositIndex) const
@@ -1933,6 +2156,11 @@ namespace CryptoNote
     throwIfNotInitialized();
     throwIfStopped();
 
+    if (transactionIndex < m_history.transactionCount())
+    {
+      return m_history.get(transactionIndex).transfers.size();
+    }
+
     auto bounds = getTransactionTransfersRange(transactionIndex);
     return static_cast<size_t>(std::distance(bounds.first, bounds.second));
   }
@@ -1942,6 +2170,17 @@ namespace CryptoNote
     throwIfNotInitialized();
     throwIfStopped();
 
+    if (transactionIndex < m_history.transactionCount())
+    {
+      const auto &transfers = m_history.get(transactionIndex).transfers;
+      if (transferIndex >= transfers.size())
+      {
+        throw std::system_error(make_error_code(std::errc::invalid_argument));
+      }
+
+      return transfers[transferIndex];
+    }
+
     auto bounds = getTransactionTransfersRange(transactionIndex);
 
     if (transferIndex >= static_cast<size_t>(std::distance(bounds.first, bounds.second)))
@@ -1978,6 +2217,131 @@ namespace CryptoNote
     return doTransfer(transactionParameters, transactionSK);
   }
 
+  std::vector<size_t> WalletGreen::transferBatch(const TransactionParameters &transactionParameters)
+  {
+    Tools::ScopeExit releaseContext([this] {
+      m_dispatcher.yield();
+    });
+
+    System::EventLock lk(m_readyEvent);
+
+    throwIfNotInitialized();
+    throwIfTrackingMode();
+    throwIfStopped();
+
+    validateTransactionParameters(transactionParameters);
+    CryptoNote::AccountPublicAddress changeDestination = getChangeDestination(transactionParameters.changeDestination, transactionParameters.sourceAddresses);
+
+    const std::vector<WalletOrder> &orders = transactionParameters.destinations;
+    std::vector<size_t> transactionIds;
+    BatchRelays relays(m_dispatcher);
+
+    // relay callbacks reference relays, so every relay has to land before leaving, also on errors
+    Tools::ScopeExit waitRelays([this, &relays] {
+      try
+      {
+        while (relays.inFlight != 0)
+        {
+          relays.completed.wait();
+          relays.completed.clear();
+        }
+        applyBatchRelayResults(relays);
+      }
+      catch (...)
+      {
+      }
+    });
+
+    size_t chunkSize = std::min(orders.size(), BATCH_MAX_ORDERS_PER_TRANSACTION);
+    size_t next = 0;
+    while (next < orders.size())
+    {
+      throwIfStopped();
+
+      size_t count = std::min(chunkSize, orders.size() - next);
+      std::vector<WalletOrder> chunk(orders.begin() + next, orders.begin() + next + count);
+      std::vector<WalletOuts> wallets = pickSpendingWallets(transactionParameters.sourceAddresses);
+
+      PreparedTransaction preparedTransaction;
+      Crypto::SecretKey transactionSK;
+      try
+      {
+        prepareTransaction(
+            std::move(wallets),
+            chunk,
+            transactionIds.empty() ? transactionParameters.messages : std::vector<WalletMessage>(),
+            transactionParameters.fee,
+            transactionParameters.mixIn,
+            transactionParameters.extra,
+            transactionParameters.unlockTimestamp,
+            transactionParameters.donation,
+            changeDestination,
+            preparedTransaction,
+            transactionSK);
+
+        if (preparedTransaction.transaction->getTransactionDataSize() > m_upperTransactionSizeLimit && count > 1)
+        {
+          chunkSize = count / 2;
+          continue;
+        }
+
+        transactionIds.push_back(validateSaveAndSendTransaction(*preparedTransaction.transaction, preparedTransaction.destinations, false, false));
+      }
+      catch (const std::exception &e)
+      {
+        if (transactionIds.empty())
+        {
+          throw;
+        }
+
+        m_logger(WARNING, BRIGHT_YELLOW) << "Batch transfer stopped after " << transactionIds.size() << " transactions, " << next << " of " << orders.size() << " orders: " << e.what();
+        break;
+      }
+
+      next += count;
+
+      // building the next transaction overlaps with relaying this one, bounded so a slow node pushes back
+      while (relays.inFlight >= BATCH_MAX_RELAYS_IN_FLIGHT)
+      {
+        relays.completed.wait();
+        relays.completed.clear();
+      }
+      applyBatchRelayResults(relays);
+      relayBatchTransaction(transactionIds.back(), relays);
+    }
+
+    return transactionIds;
+  }
+
+  void WalletGreen::relayBatchTransaction(size_t transactionId, BatchRelays &relays)
+  {
+    ++relays.inFlight;
+    m_node.relayTransaction(m_uncommitedTransactions[transactionId], [this, &relays, transactionId](std::error_code error) {
+      this->m_dispatcher.remoteSpawn([&relays, transactionId, error] {
+        relays.results.emplace_back(transactionId, error);
+        --relays.inFlight;
+        relays.completed.set();
+      });
+    });
+  }
+
+  void WalletGreen::applyBatchRelayResults(BatchRelays &relays)
+  {
+    for (const auto &result : relays.results)
+    {
+      if (result.second)
+      {
+        m_logger(WARNING, BRIGHT_YELLOW) << "Failed to relay batch transaction " << result.first << ", it stays uncommitted: " << result.second.message();
+        continue;
+      }
+
+      updateTransactionStateAndPushEvent(result.first, WalletTransactionState::SUCCEEDED);
+      m_uncommitedTransactions.erase(result.first);
+    }
+
+    relays.results.clear();
+  }
+
   void WalletGreen::prepareTransaction(
       std::vector<WalletOuts> &&wallets,
       const std::vector<WalletOrder> &orders,
@@ -1996,7 +2360,11 @@ namespace CryptoNote
     preparedTransaction.neededMoney = countNeededMoney(preparedTransaction.destinations, fee);
 
     std::vector<OutputToTransfer> selectedTransfers;
-    uint64_t foundMoney = selectTransfers(preparedTransaction.neededMoney, mixIn == 0, m_currency.defaultDustThreshold(), std::move(wallets), selectedTransfers);
+    uint64_t foundMoney;
+    {
+      Common::ScopedSpan span("WalletGreen::selectTransfers");
+      foundMoney = selectTransfers(preparedTransaction.neededMoney, mixIn == 0, m_currency.defaultDustThreshold(), std::move(wallets), selectedTransfers);
+    }
 
     if (foundMoney < preparedTransaction.neededMoney)
     {
@@ -2008,11 +2376,15 @@ namespace CryptoNote
 
     if (mixIn != 0)
     {
+      Common::ScopedSpan span("WalletGreen::requestMixinOuts");
       requestMixinOuts(selectedTransfers, mixIn, mixinResult);
     }
 
     std::vector<InputInfo> keysInfo;
-    prepareInputs(selectedTransfers, mixinResult, mixIn, keysInfo);
+    {
+      Common::ScopedSpan span("WalletGreen::prepareInputs");
+      prepareInputs(selectedTransfers, mixinResult, mixIn, keysInfo);
+    }
 
     uint64_t donationAmount = pushDonationTransferIfPossible(donation, foundMoney - preparedTransaction.neededMoney, m_currency.defaultDustThreshold(), preparedTransaction.destinations);
     preparedTransaction.changeAmount = foundMoney - preparedTransaction.neededMoney - donationAmount;
@@ -2030,6 +2402,7 @@ namespace CryptoNote
       decomposedOutputs.emplace_back(std::move(splittedChange));
     }
 
+    Common::ScopedSpan span("WalletGreen::signTransaction");
     preparedTransaction.transaction = makeTransaction(decomposedOutputs, keysInfo, messages, extra, unlockTimestamp, transactionSK);
   }
 
@@ -2052,18 +2425,11 @@ namespace CryptoNote
 
   size_t WalletGreen::doTransfer(const TransactionParameters &transactionParameters, Crypto::SecretKey &transactionSK)
   {
+    Common::ScopedSpan span("WalletGreen::doTransfer");
     validateTransactionParameters(transactionParameters);
     CryptoNote::AccountPublicAddress changeDestination = getChangeDestination(transactionParameters.changeDestination, transactionParameters.sourceAddresses);
 
-    std::vector<WalletOuts> wallets;
-    if (!transactionParameters.sourceAddresses.empty())
-    {
-      wallets = pickWallets(transactionParameters.sourceAddresses);
-    }
-    else
-    {
-      wallets = pickWalletsWithMoney();
-    }
+    std::vector<WalletOuts> wallets = pickSpendingWallets(transactionParameters.sourceAddresses);
 
     PreparedTransaction preparedTransaction;
     prepareTransaction(
@@ -2104,15 +2470,7 @@ namespace CryptoNote
     CryptoNote::AccountPublicAddress changeDestination = getChangeDestination(sendingTransaction.changeDestination, sendingTransaction.sourceAddresses);
     m_logger(DEBUGGING) << "Change address " << m_currency.accountAddressAsString(changeDestination);
 
-    std::vector<WalletOuts> wallets;
-    if (!sendingTransaction.sourceAddresses.empty())
-    {
-      wallets = pickWallets(sendingTransaction.sourceAddresses);
-    }
-    else
-    {
-      wallets = pickWalletsWithMoney();
-    }
+    std::vector<WalletOuts> wallets = pickSpendingWallets(sendingTransaction.sourceAddresses);
 
     PreparedTransaction preparedTransaction;
     Crypto::SecretKey txSecretKey;
@@ -2377,7 +2735,25 @@ namespace CryptoNote
     }
 
     /* Get the block timestamp from the node if the node has it */
-    uint64_t timestamp = static_cast<uint64_t>(std::time(nullptr));
+    uint64_t blockTimestamp = 0;
+    std::error_code ec = waitForNode([this, scanHeight, &blockTimestamp](const INode::Callback &callback) {
+      m_node.getBlockTimestamp(scanHeight, blockTimestamp, callback);
+    });
+
+    if (ec)
+    {
+      m_logger(DEBUGGING) << "Estimating timestamp of block " << scanHeight << ", node can't tell: " << ec.message();
+      return estimateScanHeightTimestamp(scanHeight);
+    }
+
+    /* Later blocks may be stamped earlier, by up to the future time limit */
+    uint64_t adjust = std::max(CryptoNote::parameters::CRYPTONOTE_BLOCK_FUTURE_TIME_LIMIT, CryptoNote::parameters::CRYPTONOTE_BLOCK_FUTURE_TIME_LIMIT_V1);
+    return blockTimestamp > adjust ? blockTimestamp - adjust : 1;
+  }
+
+  uint64_t WalletGreen::estimateScanHeightTimestamp(const uint32_t scanHeight)
+  {
+    uint64_t timestamp;
 
     /* Get the amount of seconds since the blockchain launched */
     uint64_t secondsSinceLaunch = scanHeight * CryptoNote::parameters::DIFFICULTY_TARGET;
@@ -2398,6 +2774,46 @@ namespace CryptoNote
     return timestamp;
   }
 
+  uint32_t WalletGreen::timestampToScanHeight(uint64_t timestamp)
+  {
+    uint32_t height = 0;
+    uint64_t blockTimestamp = 0;
+    std::error_code ec = waitForNode([this, timestamp, &height, &blockTimestamp](const INode::Callback &callback) {
+      m_node.getBlockHeightByTimestamp(timestamp, height, blockTimestamp, callback);
+    });
+
+    if (!ec)
+    {
+      return height;
+    }
+
+    m_logger(DEBUGGING) << "Estimating height of timestamp " << timestamp << ", node can't tell: " << ec.message();
+
+    /* Same buffer as estimateScanHeightTimestamp, erring towards older blocks */
+    const uint64_t genesisTimestamp = UINT64_C(1527135120);
+    if (timestamp <= genesisTimestamp)
+    {
+      return 0;
+    }
+
+    uint64_t estimate = static_cast<uint64_t>((timestamp - genesisTimestamp) / CryptoNote::parameters::DIFFICULTY_TARGET * 0.95);
+    return static_cast<uint32_t>(std::min<uint64_t>(estimate, m_node.getLastKnownBlockHeight()));
+  }
+
+  std::error_code WalletGreen::waitForNode(const std::function<void(const INode::Callback &)> &request)
+  {
+    System::Event requestFinished(m_dispatcher);
+    std::error_code result;
+
+    request([&requestFinished, &result, this](std::error_code ec) {
+      result = ec;
+      this->m_dispatcher.remoteSpawn(std::bind(asyncRequestCompletion, std::ref(requestFinished)));
+    });
+
+    requestFinished.wait();
+    return result;
+  }
+
   uint64_t WalletGreen::getCurrentTimestampAdjusted()
   {
     /* Get the current time as a unix timestamp */
@@ -2706,11 +3122,11 @@ namespace CryptoNote
     });
   }
 
-  std::unique_ptr<CryptoNote::ITransaction> WalletGreen::makeTransaction(const std::vector<ReceiverAmounts> &decomposedOutputs,
-                                                                         std::vector<InputInfo> &keysInfo, const std::vector<WalletMessage> &messages, const std::string &extra, uint64_t unlockTimestamp, Crypto::SecretKey &transactionSK)
+  CryptoNote::PooledTransaction WalletGreen::makeTransaction(const std::vector<ReceiverAmounts> &decomposedOutputs,
+                                                             std::vector<InputInfo> &keysInfo, const std::vector<WalletMessage> &messages, const std::string &extra, uint64_t unlockTimestamp, Crypto::SecretKey &transactionSK)
   {
 
-    std::unique_ptr<ITransaction> tx = createTransaction();
+    PooledTransaction tx = acquireTransaction();
 
     tx->getTransactionSecretKey(transactionSK);
     Crypto::PublicKey publicKey = tx->getTransactionPublicKey();
@@ -2751,23 +3167,60 @@ namespace CryptoNote
 
     tx->setUnlockTime(unlockTimestamp);
     tx->appendExtra(Common::asBinaryArray(extra));
+    tx->appendViewTags();
 
     for (auto &input : keysInfo)
     {
-      tx->addInput(makeAccountKeys(*input.walletRecord), input.keyInfo, input.ephKeys);
+      tx->addInput(makeAccountKeys(*input.walletRecord), input.keyInfo, input.keyImage, input.ephKeys);
     }
 
-    size_t i = 0;
-    for (auto &input : keysInfo)
+    signInputs(*tx, keysInfo);
+
+    return tx;
+  }
+
+  void WalletGreen::signInputs(ITransaction &transaction, const std::vector<InputInfo> &keysInfo)
+  {
+    auto start = std::chrono::steady_clock::now();
+
+    if (keysInfo.size() == 1)
     {
-      tx->signInputKey(i++, input.keyInfo, input.ephKeys);
+      transaction.signInputKey(0, keysInfo[0].keyInfo, keysInfo[0].ephKeys);
     }
+    else if (!keysInfo.empty())
+    {
+      // ring signatures dominate the cost of building a transaction and are
+      // independent of each other, so wide transactions sign on a worker pool
+      std::vector<TransactionTypes::InputKeyInfo> infos;
+      std::vector<KeyPair> ephKeys;
+      infos.reserve(keysInfo.size());
+      ephKeys.reserve(keysInfo.size());
+      for (const auto &input : keysInfo)
+      {
+        infos.push_back(input.keyInfo);
+        ephKeys.push_back(input.ephKeys);
+      }
 
-    return tx;
+      transaction.signInputKeys(infos, ephKeys, signingWorkers());
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    m_logger(DEBUGGING) << "Signed " << keysInfo.size() << " inputs in " << elapsed.count() << " ms";
+  }
+
+  Common::ThreadPool &WalletGreen::signingWorkers()
+  {
+    if (!m_signingWorkers)
+    {
+      m_signingWorkers.reset(new Common::ThreadPool());
+    }
+
+    return *m_signingWorkers;
   }
 
   void WalletGreen::sendTransaction(const CryptoNote::Transaction &cryptoNoteTransaction)
   {
+    Common::ScopedSpan span("WalletGreen::relayTransaction");
     System::Event completion(m_dispatcher);
     std::error_code ec;
 
@@ -2872,6 +3325,15 @@ namespace CryptoNote
       amounts.push_back(out.out.amount);
     }
 
+    throwIfStopped();
+
+    if (m_mixinCache.take(amounts, mixIn, mixinResult))
+    {
+      m_mixinCache.refill(amounts, mixIn);
+      return;
+    }
+
+    std::vector<uint64_t> refillAmounts = amounts;
     System::Event requestFinished(m_dispatcher);
     std::error_code mixinError;
 
@@ -2890,6 +3352,8 @@ namespace CryptoNote
     {
       throw std::system_error(mixinError);
     }
+
+    m_mixinCache.refill(refillAmounts, mixIn);
   }
 
   uint64_t WalletGreen::selectTransfers(
@@ -2901,54 +3365,116 @@ namespace CryptoNote
   {
     uint64_t foundMoney = 0;
 
-    typedef std::pair<WalletRecord *, TransactionOutputInformation> OutputData;
-    std::vector<OutputData> walletOuts;
-    std::unordered_map<uint64_t, std::vector<OutputData>> buckets;
+    typedef SpendableOutputsIndex::Outputs::index<SpendableOutputsIndex::AmountIndex>::type::const_iterator AmountIterator;
 
-    for (auto walletIt = wallets.begin(); walletIt != wallets.end(); ++walletIt)
+    struct WalletRange
     {
-      for (auto outIt = walletIt->outs.begin(); outIt != walletIt->outs.end(); ++outIt)
-      {
-        int numberOfDigits = floor(log10(outIt->amount)) + 1;
+      WalletRecord *wallet;
+      AmountIterator begin;
+      AmountIterator end;
+    };
 
-        if (outIt->amount > dustThreshold)
+    struct Bucket
+    {
+      std::vector<WalletRange> ranges;
+      size_t next = 0;
+    };
+
+    /* One bucket per number of digits in the amount, holding each wallet's slice of its
+       amount-ordered index. Finding the slices is a handful of lookups per wallet. */
+    std::map<int, Bucket> buckets;
+    for (const auto &walletOuts : wallets)
+    {
+      const auto &amountIndex = m_spendableOutputs.outputs(walletOuts.wallet->container).get<SpendableOutputsIndex::AmountIndex>();
+      auto it = amountIndex.upper_bound(dustThreshold);
+      while (it != amountIndex.end())
+      {
+        int numberOfDigits = 1;
+        uint64_t bucketLimit = 10;
+        while (bucketLimit <= it->amount && numberOfDigits < std::numeric_limits<uint64_t>::digits10)
         {
-          buckets[numberOfDigits].emplace_back(
-              std::piecewise_construct,
-              std::forward_as_tuple(walletIt->wallet),
-              std::forward_as_tuple(*outIt));
+          bucketLimit *= 10;
+          ++numberOfDigits;
         }
+
+        auto bucketEnd = bucketLimit > it->amount ? amountIndex.lower_bound(bucketLimit) : amountIndex.end();
+        buckets[numberOfDigits].ranges.push_back(WalletRange{walletOuts.wallet, it, bucketEnd});
+        it = bucketEnd;
       }
     }
 
+    /* Outputs the index still holds but the container no longer considers spendable */
+    std::vector<std::pair<ITransfersContainer *, TransactionOutputKey>> staleOutputs;
+
+    /* Pops the largest output of the bucket, rotating between wallets and skipping stale entries */
+    auto takeFromBucket = [&staleOutputs](Bucket &bucket, OutputToTransfer &result) {
+      while (!bucket.ranges.empty())
+      {
+        if (bucket.next >= bucket.ranges.size())
+        {
+          bucket.next = 0;
+        }
+
+        WalletRange &range = bucket.ranges[bucket.next];
+        if (range.begin == range.end)
+        {
+          bucket.ranges.erase(bucket.ranges.begin() + bucket.next);
+          continue;
+        }
+
+        --range.end;
+        ++bucket.next;
+
+        TransactionOutputInformation transfer;
+        ITransfersContainer::TransferState state;
+        if (!range.wallet->container->getTransfer(range.end->transactionHash, range.end->outputInTransaction, transfer, state) ||
+            state == ITransfersContainer::TransferState::TransferSpent ||
+            state == ITransfersContainer::TransferState::TransferUnconfirmed)
+        {
+          staleOutputs.emplace_back(range.wallet->container, TransactionOutputKey{range.end->transactionHash, range.end->outputInTransaction});
+          continue;
+        }
+
+        if (state != ITransfersContainer::TransferState::TransferAvailable)
+        {
+          continue;
+        }
+
+        result = OutputToTransfer{*range.end, range.wallet};
+        return true;
+      }
+
+      return false;
+    };
+
     while (foundMoney < neededMoney && !buckets.empty())
     {
       /* Take one element from each bucket, smallest first. */
-      for (auto bucket = buckets.begin(); bucket != buckets.end();)
+      for (auto bucket = buckets.begin(); bucket != buckets.end() && foundMoney < neededMoney;)
       {
-        /* Bucket has been exhausted, remove from list */
-        if (bucket->second.empty())
+        /** Add the amount to the selected transfers so long as
+         * foundMoney is still less than neededMoney. This prevents
+         * larger outputs than we need when we already have enough funds */
+        OutputToTransfer out;
+        if (takeFromBucket(bucket->second, out))
         {
-          bucket = buckets.erase(bucket);
+          foundMoney += out.out.amount;
+          selectedTransfers.emplace_back(std::move(out));
+          ++bucket;
         }
         else
         {
-          /** Add the amount to the selected transfers so long as 
-           * foundMoney is still less than neededMoney. This prevents 
-           * larger outputs than we need when we already have enough funds */
-          if (foundMoney < neededMoney)
-          {
-            auto out = bucket->second.back();
-            selectedTransfers.emplace_back(OutputToTransfer{std::move(out.second), std::move(out.first)});
-            foundMoney += out.second.amount;
-          }
-
-          /* Remove amount we just added */
-          bucket->second.pop_back();
-          bucket++;
+          /* Bucket has been exhausted, remove from list */
+          bucket = buckets.erase(bucket);
         }
       }
     }
+
+    for (const auto &staleOutput : staleOutputs)
+    {
+      m_spendableOutputs.remove(staleOutput.first, staleOutput.second);
+    }
+
     return foundMoney;
   };
 
@@ -3005,6 +3531,32 @@ namespace CryptoNote
     return wallets;
   }
 
+  std::vector<WalletGreen::WalletOuts> WalletGreen::pickSpendingWallets(const std::vector<std::string> &addresses) const
+  {
+    std::vector<WalletOuts> wallets;
+
+    if (addresses.empty())
+    {
+      for (const auto &wallet : m_walletsContainer.get<RandomAccessIndex>())
+      {
+        if (wallet.actualBalance != 0)
+        {
+          wallets.push_back(WalletOuts{const_cast<WalletRecord *>(&wallet), {}});
+        }
+      }
+    }
+    else
+    {
+      wallets.reserve(addresses.size());
+      for (const auto &address : addresses)
+      {
+        wallets.push_back(WalletOuts{const_cast<WalletRecord *>(&getWalletRecord(address)), {}});
+      }
+    }
+
+    return wallets;
+  }
+
   std::vector<CryptoNote::WalletGreen::ReceiverAmounts> WalletGreen::splitDestinations(const std::vector<CryptoNote::WalletTransfer> &destinations,
                                                                                        uint64_t dustThreshold,
                                                                                        const CryptoNote::Currency &currency)
@@ -3088,6 +3640,7 @@ namespace CryptoNote
       //Important! outputs in selectedTransfers and in keysInfo must have the same order!
       InputInfo inputInfo;
       inputInfo.keyInfo = std::move(keyInfo);
+      inputInfo.keyImage = input.out.keyImage;
       inputInfo.walletRecord = input.wallet;
       keysInfo.push_back(std::move(inputInfo));
       ++i;
@@ -3106,11 +3659,7 @@ namespace CryptoNote
       throw std::system_error(make_error_code(error::OBJECT_NOT_FOUND), "Transaction not found");
     }
 
-    WalletTransactionWithTransfers walletTransaction;
-    walletTransaction.transaction = *it;
-    walletTransaction.transfers = getTransactionTransfers(*it);
-
-    return walletTransaction;
+    return getTransactionWithTransfers(*it);
   }
 
   std::vector<TransactionsInBlockInfo> WalletGreen::getTransactions(const Crypto::Hash &blockHash, size_t count) const
@@ -3157,6 +3706,34 @@ namespace CryptoNote
     return getTransactionsInBlocks(blockIndex, count);
   }
 
+  std::vector<TransactionsInBlockInfo> WalletGreen::getTransactions(const Crypto::Hash &blockHash, size_t count,
+    const std::vector<std::string> &addresses, const Crypto::Hash *paymentId) const
+  {
+    throwIfNotInitialized();
+    throwIfStopped();
+
+    auto &hashIndex = m_blockchain.get<BlockHashIndex>();
+    auto it = hashIndex.find(blockHash);
+    if (it == hashIndex.end())
+    {
+      return std::vector<TransactionsInBlockInfo>();
+    }
+
+    auto heightIt = m_blockchain.project<BlockHeightIndex>(it);
+
+    uint32_t blockIndex = static_cast<uint32_t>(std::distance(m_blockchain.get<BlockHeightIndex>().begin(), heightIt));
+    return getIndexedTransactionsInBlocks(blockIndex, count, addresses, paymentId);
+  }
+
+  std::vector<TransactionsInBlockInfo> WalletGreen::getTransactions(uint32_t blockIndex, size_t count,
+    const std::vector<std::string> &addresses, const Crypto::Hash *paymentId) const
+  {
+    throwIfNotInitialized();
+    throwIfStopped();
+
+    return getIndexedTransactionsInBlocks(blockIndex, count, addresses, paymentId);
+  }
+
   std::vector<DepositsInBlockInfo> WalletGreen::getDeposits(uint32_t blockIndex, size_t count) const
   {
     throwIfNotInitialized();
@@ -3207,11 +3784,7 @@ namespace CryptoNote
         continue;
       }
 
-      WalletTransactionWithTransfers transaction;
-      transaction.transaction = *it;
-      transaction.transfers = getTransactionTransfers(*it);
-
-      result.push_back(transaction);
+      result.push_back(getTransactionWithTransfers(*it));
     }
 
     return result;
@@ -3250,19 +3823,71 @@ namespace CryptoNote
     throwIfNotInitialized();
     throwIfStopped();
 
+    waitForEvent();
+    return popEvent();
+  }
+
+  std::vector<WalletEvent> WalletGreen::getEvents(size_t maxCount)
+  {
+    throwIfNotInitialized();
+    throwIfStopped();
+
+    waitForEvent();
+
+    size_t count = maxCount == 0 ? m_events.size() : std::min(maxCount, m_events.size());
+    std::vector<WalletEvent> events;
+    events.reserve(count);
+    while (events.size() < count)
+    {
+      events.push_back(popEvent());
+    }
+
+    return events;
+  }
+
+  void WalletGreen::setEventCoalescing(bool enabled)
+  {
+    m_coalesceEvents = enabled;
+  }
+
+  void WalletGreen::waitForEvent()
+  {
     while (m_events.empty())
     {
       m_eventOccurred.wait();
       m_eventOccurred.clear();
       throwIfStopped();
     }
+  }
 
+  WalletEvent WalletGreen::popEvent()
+  {
     WalletEvent event = std::move(m_events.front());
-    m_events.pop();
+    m_events.pop_front();
+
+    if (event.type == WalletEventType::BALANCE_UNLOCKED)
+    {
+      m_balanceUnlockedQueued = false;
+    }
+    else if (event.type == WalletEventType::TRANSACTION_CREATED)
+    {
+      m_queuedTransactionEvents.erase(event.transactionCreated.transactionIndex);
+    }
+    else if (event.type == WalletEventType::TRANSACTION_UPDATED)
+    {
+      m_queuedTransactionEvents.erase(event.transactionUpdated.transactionIndex);
+    }
 
     return event;
   }
 
+  void WalletGreen::clearEvents()
+  {
+    m_events.clear();
+    m_balanceUnlockedQueued = false;
+    m_queuedTransactionEvents.clear();
+  }
+
   void WalletGreen::throwIfNotInitialized() const
   {
     if (m_state != WalletState::INITIALIZED)
@@ -3312,6 +3937,21 @@ namespace CryptoNote
     }
 
     pushEvent(makeSyncCompletedEvent());
+
+    if (m_rescanInProgress && !m_blockchainSynchronizer.hasRescanPlan())
+    {
+      ParallelRescan::removeCheckpoint(rescanCheckpointPath());
+      m_rescanInProgress = false;
+    }
+
+    // addresses imported with history join the main consumer once they have caught up with it
+    if (m_blockchainSynchronizerStarted && m_synchronizer.hasCaughtUpConsumers())
+    {
+      stopBlockchainSynchronizer();
+      size_t merged = m_synchronizer.mergeCatchUpConsumers();
+      m_logger(DEBUGGING) << "Merged " << merged << " catch-up consumers";
+      startBlockchainSynchronizer();
+    }
   }
 
   void WalletGreen::onBlocksAdded(const Crypto::PublicKey &viewPublicKey, const std::vector<Crypto::Hash> &blockHashes)
@@ -3346,6 +3986,8 @@ namespace CryptoNote
 
     auto &blockHeightIndex = m_blockchain.get<BlockHeightIndex>();
     blockHeightIndex.erase(std::next(blockHeightIndex.begin(), blockIndex), blockHeightIndex.end());
+    m_mixinCache.clear();
+    m_spendableOutputs.clear();
   }
 
   void WalletGreen::onTransactionDeleteBegin(const Crypto::PublicKey &viewPublicKey, Crypto::Hash transactionHash)
@@ -3370,17 +4012,17 @@ namespace CryptoNote
 
   void WalletGreen::unlockBalances(uint32_t height)
   {
-    auto &index = m_unlockTransactionsJob.get<BlockHeightIndex>();
-    auto upper = index.upper_bound(height);
+    m_spendableOutputs.unlockPending();
 
-    if (index.begin() != upper)
+    auto containers = m_unlockTransactionsJob.popUnlocked(height);
+
+    if (!containers.empty())
     {
-      for (auto it = index.begin(); it != upper; ++it)
+      for (auto container : containers)
       {
-        updateBalance(it->container);
+        updateBalance(container);
       }
 
-      index.erase(index.begin(), upper);
       pushEvent(makeMoneyUnlockedEvent());
     }
   }
@@ -3507,6 +4149,7 @@ namespace CryptoNote
     if (it != hashIndex.end())
     {
       transactionId = std::distance(m_transactions.get<RandomAccessIndex>().begin(), m_transactions.project<RandomAccessIndex>(it));
+      restoreWalletHistory(transactionId);
       updated |= updateWalletTransactionInfo(transactionId, transactionInfo, totalAmount);
     }
     else
@@ -3573,16 +4216,27 @@ namespace CryptoNote
     for (auto containerAmounts : containerAmountsList)
     {
       updateBalance(containerAmounts.container);
+      m_spendableOutputs.transactionUpdated(containerAmounts.container, transactionInfo.transactionHash);
 
       if (transactionInfo.blockHeight != CryptoNote::WALLET_UNCONFIRMED_TRANSACTION_HEIGHT)
       {
         uint32_t unlockHeight = std::max(transactionInfo.blockHeight + m_transactionSoftLockTime, static_cast<uint32_t>(transactionInfo.unlockTime));
         insertUnlockTransactionJob(transactionInfo.transactionHash, unlockHeight, containerAmounts.container);
+
+        // Deposit outputs stay locked for their term, which usually ends well after the soft lock
+        auto depositOutputs = containerAmounts.container->getTransactionOutputs(transactionInfo.transactionHash,
+          ITransfersContainer::IncludeTypeDeposit | ITransfersContainer::IncludeStateLocked | ITransfersContainer::IncludeStateSoftLocked);
+        for (const auto &depositOutput : depositOutputs)
+        {
+          uint32_t depositUnlockHeight = std::max(unlockHeight, transactionInfo.blockHeight + depositOutput.term - 1);
+          insertUnlockTransactionJob(transactionInfo.transactionHash, depositUnlockHeight, containerAmounts.container);
+        }
       }
     }
 
     updated |= updateTransactionTransfers(transactionId, containerAmountsList, -static_cast<int64_t>(transactionInfo.totalAmountIn),
                                           static_cast<int64_t>(transactionInfo.totalAmountOut));
+    indexTransaction(transactionId);
 
     if (isNew)
     {
@@ -3596,7 +4250,36 @@ namespace CryptoNote
 
   void WalletGreen::pushEvent(const WalletEvent &event)
   {
-    m_events.push(event);
+    if (event.type == WalletEventType::SYNC_PROGRESS_UPDATED)
+    {
+      if (m_coalesceEvents && !m_events.empty() && m_events.back().type == WalletEventType::SYNC_PROGRESS_UPDATED)
+      {
+        m_events.back().synchronizationProgressUpdated = event.synchronizationProgressUpdated;
+        return;
+      }
+    }
+    else if (event.type == WalletEventType::BALANCE_UNLOCKED)
+    {
+      if (m_coalesceEvents && m_balanceUnlockedQueued)
+      {
+        return;
+      }
+
+      m_balanceUnlockedQueued = true;
+    }
+    else if (event.type == WalletEventType::TRANSACTION_CREATED)
+    {
+      m_queuedTransactionEvents.insert(event.transactionCreated.transactionIndex);
+    }
+    else if (event.type == WalletEventType::TRANSACTION_UPDATED)
+    {
+      if (!m_queuedTransactionEvents.insert(event.transactionUpdated.transactionIndex).second && m_coalesceEvents)
+      {
+        return;
+      }
+    }
+
+    m_events.push_back(event);
     m_eventOccurred.set();
   }
 
@@ -3653,6 +4336,7 @@ namespace CryptoNote
     CryptoNote::ITransfersContainer *container = &object->getContainer();
     updateBalance(container);
     deleteUnlockTransactionJob(transactionHash);
+    m_spendableOutputs.invalidate(container);
 
     bool updated = false;
     m_transactions.get<TransactionIndex>().modify(it, [&updated](CryptoNote::WalletTransaction &tx) {
@@ -3678,14 +4362,12 @@ namespace CryptoNote
 
   void WalletGreen::insertUnlockTransactionJob(const Hash &transactionHash, uint32_t blockHeight, CryptoNote::ITransfersContainer *container)
   {
-    auto &index = m_unlockTransactionsJob.get<BlockHeightIndex>();
-    index.insert({blockHeight, container, transactionHash});
+    m_unlockTransactionsJob.insert({blockHeight, container, transactionHash});
   }
 
   void WalletGreen::deleteUnlockTransactionJob(const Hash &transactionHash)
   {
-    auto &index = m_unlockTransactionsJob.get<TransactionHashIndex>();
-    index.erase(transactionHash);
+    m_unlockTransactionsJob.erase(transactionHash);
   }
 
   void WalletGreen::startBlockchainSynchronizer()
@@ -3743,6 +4425,12 @@ namespace CryptoNote
     uint64_t actual = container->balance(ITransfersContainer::IncludeAllUnlocked);
     uint64_t pending = container->balance(ITransfersContainer::IncludeKeyNotUnlocked);
 
+    /* Wallets with no unlocked balance are left out of the spending order */
+    if (it->actualBalance != actual)
+    {
+      m_feeEstimator.invalidate();
+    }
+
     /* Now update the overall balance (getBalance without parameters) */
     if (it->actualBalance < actual)
     {
@@ -3978,7 +4666,7 @@ namespace CryptoNote
 
     AccountPublicAddress destination = getChangeDestination(destinationAddress, sourceAddresses);
 
-    std::unique_ptr<ITransaction> fusionTransaction;
+    PooledTransaction fusionTransaction;
     size_t transactionSize;
     int round = 0;
     //uint64_t transactionAmount;
@@ -4335,11 +5023,7 @@ namespace CryptoNote
           continue;
         }
 
-        WalletTransactionWithTransfers transaction;
-        transaction.transaction = *it;
-        transaction.transfers = getTransactionTransfers(*it);
-
-        info.transactions.emplace_back(std::move(transaction));
+        info.transactions.emplace_back(getTransactionWithTransfers(*it));
       }
 
       result.emplace_back(std::move(info));
@@ -4354,6 +5038,132 @@ namespace CryptoNote
     return m_blockchain.get<BlockHeightIndex>()[blockIndex];
   }
 
+  std::vector<TransactionsInBlockInfo> WalletGreen::getIndexedTransactionsInBlocks(uint32_t blockIndex, size_t count,
+    const std::vector<std::string> &addresses, const Crypto::Hash *paymentId) const
+  {
+    if (count == 0)
+    {
+      throw std::system_error(make_error_code(error::WRONG_PARAMETERS), "blocks count must be greater than zero");
+    }
+
+    std::vector<TransactionsInBlockInfo> result;
+
+    if (blockIndex >= m_blockchain.size())
+    {
+      return result;
+    }
+
+    buildTransactionIndexes();
+
+    uint32_t stopIndex = static_cast<uint32_t>(std::min(m_blockchain.size(), blockIndex + count));
+    TransactionHeightList candidates;
+    auto collect = [&](const TransactionHeightList &list) {
+      auto first = std::lower_bound(list.begin(), list.end(), std::make_pair(blockIndex, static_cast<size_t>(0)));
+      auto last = std::lower_bound(first, list.end(), std::make_pair(stopIndex, static_cast<size_t>(0)));
+      candidates.insert(candidates.end(), first, last);
+    };
+
+    // a payment id is usually the narrower key, the addresses are checked on what it finds
+    if (paymentId != nullptr)
+    {
+      auto it = m_paymentIdTransactions.find(*paymentId);
+      if (it != m_paymentIdTransactions.end())
+      {
+        collect(it->second);
+      }
+    }
+    else
+    {
+      for (const std::string &address : addresses)
+      {
+        auto it = m_addressTransactions.find(address);
+        if (it != m_addressTransactions.end())
+        {
+          collect(it->second);
+        }
+      }
+
+      std::sort(candidates.begin(), candidates.end());
+      candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    }
+
+    std::unordered_set<std::string> addressSet(addresses.begin(), addresses.end());
+    auto &transactionIdIndex = m_transactions.get<RandomAccessIndex>();
+    for (const auto &candidate : candidates)
+    {
+      const WalletTransaction &transaction = transactionIdIndex[candidate.second];
+      if (transaction.blockHeight != candidate.first || transaction.state != WalletTransactionState::SUCCEEDED)
+      {
+        continue;
+      }
+
+      WalletTransactionWithTransfers item = getTransactionWithTransfers(transaction);
+      if (!addressSet.empty() && std::none_of(item.transfers.begin(), item.transfers.end(),
+        [&addressSet](const WalletTransfer &transfer) { return addressSet.count(transfer.address) != 0; }))
+      {
+        continue;
+      }
+
+      Crypto::Hash blockHash = m_blockchain[candidate.first];
+      if (result.empty() || result.back().blockHash != blockHash)
+      {
+        result.emplace_back();
+        result.back().blockHash = blockHash;
+      }
+
+      result.back().transactions.emplace_back(std::move(item));
+    }
+
+    return result;
+  }
+
+  void WalletGreen::buildTransactionIndexes() const
+  {
+    if (m_transactionIndexesBuilt)
+    {
+      return;
+    }
+
+    m_transactionIndexesBuilt = true;
+    for (size_t id = 0; id < m_transactions.size(); ++id)
+    {
+      indexTransaction(id);
+    }
+
+    m_logger(DEBUGGING) << "Indexed " << m_transactions.size() << " transactions by address and payment id";
+  }
+
+  void WalletGreen::indexTransaction(size_t transactionId) const
+  {
+    if (!m_transactionIndexesBuilt)
+    {
+      return;
+    }
+
+    auto addEntry = [](TransactionHeightList &list, const std::pair<uint32_t, size_t> &entry) {
+      auto it = std::lower_bound(list.begin(), list.end(), entry);
+      if (it == list.end() || *it != entry)
+      {
+        list.insert(it, entry);
+      }
+    };
+
+    const WalletTransaction &transaction = m_transactions.get<RandomAccessIndex>()[transactionId];
+    std::pair<uint32_t, size_t> entry(transaction.blockHeight, transactionId);
+
+    const std::string &extra = transactionId < m_history.transactionCount() ? m_history.get(transactionId).extra : transaction.extra;
+    Crypto::Hash paymentId;
+    if (getPaymentIdFromTxExtra(Common::asBinaryArray(extra), paymentId))
+    {
+      addEntry(m_paymentIdTransactions[paymentId], entry);
+    }
+
+    for (const WalletTransfer &transfer : getTransactionTransfers(transaction))
+    {
+      addEntry(m_addressTransactions[transfer.address], entry);
+    }
+  }
+
   std::vector<WalletTransfer> WalletGreen::getTransactionTransfers(const WalletTransaction &transaction) const
   {
     auto &transactionIdIndex = m_transactions.get<RandomAccessIndex>();
@@ -4375,6 +5185,22 @@ namespace CryptoNote
     return result;
   }
 
+  WalletTransactionWithTransfers WalletGreen::getTransactionWithTransfers(const WalletTransaction &transaction) const
+  {
+    WalletTransactionWithTransfers result;
+    result.transaction = transaction;
+    result.transfers = getTransactionTransfers(transaction);
+
+    auto &transactionIdIndex = m_transactions.get<RandomAccessIndex>();
+    size_t transactionId = std::distance(transactionIdIndex.begin(), transactionIdIndex.iterator_to(transaction));
+    if (transactionId < m_history.transactionCount())
+    {
+      result.transaction.extra = m_history.get(transactionId).extra;
+    }
+
+    return result;
+  }
+
   void WalletGreen::filterOutTransactions(WalletTransactions &transactions, WalletTransfers &transfers, std::function<bool(const WalletTransaction &)> &&pred) const
   {
     size_t cancelledTransactions = 0;
@@ -4410,6 +5236,125 @@ namespace CryptoNote
     }
   }
 
+  void WalletGreen::archiveWalletHistory()
+  {
+    auto &index = m_transactions.get<RandomAccessIndex>();
+    const size_t pageSize = WalletHistoryStore::TRANSACTIONS_PER_PAGE;
+
+    // the store covers a prefix of the transaction list, it ends at the first transaction that may still change
+    size_t firstArchived = m_history.transactionCount();
+    size_t settled = firstArchived;
+    while (settled < index.size() && index[settled].state == WalletTransactionState::SUCCEEDED &&
+           index[settled].blockHeight != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT &&
+           index[settled].blockHeight + HISTORY_ARCHIVE_DEPTH <= m_blockchain.size() &&
+           m_uncommitedTransactions.count(settled) == 0)
+    {
+      ++settled;
+    }
+
+    if (settled - firstArchived < pageSize)
+    {
+      return;
+    }
+
+    if (!m_history.isOpened())
+    {
+      m_history.create(m_path, m_key);
+    }
+
+    size_t archived = firstArchived;
+    auto transferIt = m_transfers.begin();
+    while (settled - archived >= pageSize)
+    {
+      std::vector<WalletHistoryStore::Record> records(pageSize);
+      for (size_t i = 0; i < pageSize; ++i)
+      {
+        records[i].extra = index[archived + i].extra;
+        for (; transferIt != m_transfers.end() && transferIt->first == archived + i; ++transferIt)
+        {
+          records[i].transfers.push_back(transferIt->second);
+        }
+      }
+
+      m_history.append(records);
+      archived += pageSize;
+    }
+
+    m_history.flush();
+
+    for (size_t id = firstArchived; id < archived; ++id)
+    {
+      index.modify(std::next(index.begin(), id), [](WalletTransaction &transaction) {
+        std::string().swap(transaction.extra);
+      });
+    }
+
+    m_transfers.erase(m_transfers.begin(), transferIt);
+
+    m_logger(DEBUGGING) << "Moved " << archived - firstArchived << " transactions to the history store, " << archived << " archived";
+  }
+
+  void WalletGreen::restoreWalletHistory(size_t transactionId)
+  {
+    size_t archived = m_history.transactionCount();
+    size_t firstRestored = transactionId - transactionId % WalletHistoryStore::TRANSACTIONS_PER_PAGE;
+    if (firstRestored >= archived)
+    {
+      return;
+    }
+
+    auto &index = m_transactions.get<RandomAccessIndex>();
+    WalletTransfers transfers;
+    for (size_t id = firstRestored; id < archived; ++id)
+    {
+      const WalletHistoryStore::Record &record = m_history.get(id);
+      index.modify(std::next(index.begin(), id), [&record](WalletTransaction &transaction) {
+        transaction.extra = record.extra;
+      });
+
+      for (const auto &transfer : record.transfers)
+      {
+        transfers.emplace_back(id, transfer);
+      }
+    }
+
+    // archived transactions precede everything left in m_transfers
+    m_transfers.insert(m_transfers.begin(), transfers.begin(), transfers.end());
+    m_history.truncate(firstRestored);
+    m_history.flush();
+
+    m_logger(DEBUGGING) << "Restored " << archived - firstRestored << " transactions from the history store";
+  }
+
+  // the copies made by filterOutTransactions keep the ids of archived transactions, they are never filtered out
+  void WalletGreen::addArchivedHistory(WalletTransactions &transactions, WalletTransfers &transfers) const
+  {
+    size_t archived = m_history.transactionCount();
+    if (archived == 0)
+    {
+      return;
+    }
+
+    auto &index = transactions.get<RandomAccessIndex>();
+    assert(archived <= index.size());
+
+    WalletTransfers archivedTransfers;
+    for (size_t id = 0; id < archived; ++id)
+    {
+      const WalletHistoryStore::Record &record = m_history.get(id);
+      index.modify(std::next(index.begin(), id), [&record](WalletTransaction &transaction) {
+        transaction.extra = record.extra;
+      });
+
+      for (const auto &transfer : record.transfers)
+      {
+        archivedTransfers.emplace_back(id, transfer);
+      }
+    }
+
+    transfers.insert(transfers.begin(), archivedTransfers.begin(), archivedTransfers.end());
+  }
+
   void WalletGreen::getViewKeyKnownBlocks(const Crypto::PublicKey &viewPublicKey)
   {
     std::vector<Crypto::Hash> blockchain = m_synchronizer.getViewKeyKnownBlocks(m_viewPublicKey);
@@ -4442,23 +5387,16 @@ namespace CryptoNote
 
   void WalletGreen::deleteContainerFromUnlockTransactionJobs(const ITransfersContainer *container)
   {
-    for (auto it = m_unlockTransactionsJob.begin(); it != m_unlockTransactionsJob.end();)
-    {
-      if (it->container == container)
-      {
-        it = m_unlockTransactionsJob.erase(it);
-      }
-      else
-      {
-        ++it;
-      }
-    }
+    m_unlockTransactionsJob.erase(container);
   }
 
   std::vector<size_t> WalletGreen::deleteTransfersForAddress(const std::string &address, std::vector<size_t> &deletedTransactions)
   {
     assert(!address.empty());
 
+    // transactions may end up deleted, which renumbers everything saved after them
+    restoreWalletHistory(0);
+
     int64_t deletedInputs = 0;
     int64_t deletedOutputs = 0;
 
@@ -4554,15 +5492,7 @@ namespace CryptoNote
 
     CryptoNote::AccountPublicAddress changeDestination = getChangeDestination(sendingTransaction.changeDestination, sendingTransaction.sourceAddresses);
 
-    std::vector<WalletOuts> wallets;
-    if (!sendingTransaction.sourceAddresses.empty())
-    {
-      wallets = pickWallets(sendingTransaction.sourceAddresses);
-    }
-    else
-    {
-      wallets = pickWalletsWithMoney();
-    }
+    std::vector<WalletOuts> wallets = pickSpendingWallets(sendingTransaction.sourceAddresses);
 
     PreparedTransaction preparedTransaction;
     Crypto::SecretKey txSecretKey;
@@ -4579,8 +5509,115 @@ namespace CryptoNote
         preparedTransaction,
         txSecretKey);
 
-    BinaryArray transactionData = preparedTransaction.transaction->getTransactionData();
-    return transactionData.size();
+    return preparedTransaction.transaction->getTransactionDataSize();
+  }
+
+  FeeEstimate WalletGreen::estimateTransaction(uint64_t amount, uint64_t mixIn, size_t extraSize)
+  {
+    return feeEstimator().estimate(amount, mixIn, extraSize);
+  }
+
+  const FeeEstimator &WalletGreen::feeEstimator()
+  {
+    System::EventLock lk(m_readyEvent);
+
+    throwIfNotInitialized();
+    throwIfTrackingMode();
+    throwIfStopped();
+
+    if (!m_feeEstimator.isCurrent(m_spendableOutputs.version()))
+    {
+      /* Asking for more than exists makes selectTransfers walk every output in spending order */
+      std::vector<OutputToTransfer> spendingOrder;
+      selectTransfers(std::numeric_limits<uint64_t>::max(), false, m_currency.defaultDustThreshold(), pickSpendingWallets({}), spendingOrder);
+
+      std::vector<uint64_t> amounts;
+      amounts.reserve(spendingOrder.size());
+      for (const auto &output : spendingOrder)
+      {
+        amounts.push_back(output.out.amount);
+      }
+
+      /* Read the version afterwards, selectTransfers drops stale outputs from the index */
+      m_feeEstimator.rebuild(m_spendableOutputs.version(), amounts);
+    }
+
+    return m_feeEstimator;
+  }
+
+  std::error_code WalletGreen::rescan(uint32_t scanHeight, size_t workerCount, const ParallelRescan::ProgressCallback &progress)
+  {
+    throwIfNotInitialized();
+    throwIfStopped();
+
+    uint32_t endHeight = m_node.getKnownBlockCount();
+    ParallelRescan::removeCheckpoint(rescanCheckpointPath());
+    reset(scanHeight);
+
+    /* The block before scanHeight anchors the plan to the chain the consumer already has */
+    uint32_t startHeight = std::max<uint32_t>(scanHeight, 1) - 1;
+    if (startHeight + 1 >= endHeight)
+    {
+      return std::error_code();
+    }
+
+    return runRescan(startHeight, endHeight, workerCount, progress);
+  }
+
+  bool WalletGreen::hasInterruptedRescan() const
+  {
+    uint32_t startHeight;
+    uint32_t endHeight;
+    return m_state != WalletState::NOT_INITIALIZED && ParallelRescan::readCheckpointRange(rescanCheckpointPath(), startHeight, endHeight);
+  }
+
+  std::error_code WalletGreen::resumeRescan(size_t workerCount, const ParallelRescan::ProgressCallback &progress)
+  {
+    throwIfNotInitialized();
+    throwIfStopped();
+
+    uint32_t startHeight;
+    uint32_t endHeight;
+    if (!ParallelRescan::readCheckpointRange(rescanCheckpointPath(), startHeight, endHeight))
+    {
+      return std::make_error_code(std::errc::no_such_file_or_directory);
+    }
+
+    return runRescan(startHeight, endHeight, workerCount, progress);
+  }
+
+  std::error_code WalletGreen::runRescan(uint32_t startHeight, uint32_t endHeight, size_t workerCount, const ParallelRescan::ProgressCallback &progress)
+  {
+    std::vector<ParallelRescan::SpendKeys> spendKeys;
+    for (const auto &wallet : m_walletsContainer)
+    {
+      spendKeys.push_back({wallet.spendPublicKey, wallet.spendSecretKey});
+    }
+
+    stopBlockchainSynchronizer();
+
+    ParallelRescan scanner(m_node, m_viewSecretKey, spendKeys, rescanCheckpointPath());
+    std::shared_ptr<RescanPlan> plan = std::make_shared<RescanPlan>();
+    std::error_code ec = scanner.scan(startHeight, endHeight, workerCount, progress, *plan);
+    if (ec)
+    {
+      m_logger(WARNING, BRIGHT_YELLOW) << "Rescan of blocks " << startHeight << " to " << endHeight << " stopped: " << ec.message();
+    }
+    else
+    {
+      m_logger(INFO, BRIGHT_WHITE) << "Rescan found " << plan->relevantHeights.size() << " of " << plan->blockHashes.size() << " blocks to download";
+      plan->consumer = m_synchronizer.getConsumer(m_viewPublicKey);
+      m_blockchainSynchronizer.setRescanPlan(plan);
+      m_rescanInProgress = true;
+    }
+
+    startBlockchainSynchronizer();
+    return ec;
+  }
+
+  std::string WalletGreen::rescanCheckpointPath() const
+  {
+    return m_path + ".rescan";
   }
 
   void WalletGreen::deleteFromUncommitedTransactions(const std::vector<size_t> &deletedTransactions)
@@ -19,17 +19,27 @@
 
 #include "IWallet.h"
 
-#include <queue>
+#include <deque>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "FeeEstimator.h"
 #include "IFusionManager.h"
+#include "MixinOutputsCache.h"
+#include "SpendableOutputsIndex.h"
+#include "WalletCacheLog.h"
+#include "WalletHistoryStore.h"
 #include "WalletIndices.h"
 #include "Common/StringOutputStream.h"
+#include "Common/ThreadPool.h"
+#include "CryptoNoteCore/TransactionApi.h"
 #include "Logging/LoggerRef.h"
+#include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
 #include <System/Event.h>
 #include "Transfers/TransfersSynchronizer.h"
 #include "Transfers/BlockchainSynchronizer.h"
+#include "Transfers/ParallelRescan.h"
 
 namespace CryptoNote
 {
@@ -73,6 +83,7 @@ public:
   virtual std::string createAddress(const Crypto::SecretKey &spendSecretKey) override;
   virtual std::string createAddress(const Crypto::PublicKey &spendPublicKey) override;
   virtual std::vector<std::string> createAddressList(const std::vector<Crypto::SecretKey> &spendSecretKeys, bool reset = true) override;
+  virtual std::vector<std::string> createAddresses(size_t count) override;
 
   virtual void deleteAddress(const std::string &address) override;
 
@@ -96,6 +107,10 @@ public:
 
   virtual std::vector<TransactionsInBlockInfo> getTransactions(const Crypto::Hash &blockHash, size_t count) const;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(uint32_t blockIndex, size_t count) const;
+  virtual std::vector<TransactionsInBlockInfo> getTransactions(const Crypto::Hash &blockHash, size_t count,
+    const std::vector<std::string> &addresses, const Crypto::Hash *paymentId) const override;
+  virtual std::vector<TransactionsInBlockInfo> getTransactions(uint32_t blockIndex, size_t count,
+    const std::vector<std::string> &addresses, const Crypto::Hash *paymentId) const override;
   
   virtual std::vector<DepositsInBlockInfo> getDeposits(const Crypto::Hash &blockHash, size_t count) const;
   virtual std::vector<DepositsInBlockInfo> getDeposits(uint32_t blockIndex, size_t count) const;
@@ -107,6 +122,7 @@ public:
   virtual std::vector<size_t> getDelayedTransactionIds() const override;
 
   virtual size_t transfer(const TransactionParameters &sendingTransaction, Crypto::SecretKey &transactionSK) override;
+  virtual std::vector<size_t> transferBatch(const TransactionParameters &sendingTransaction) override;
 
   virtual size_t makeTransaction(const TransactionParameters &sendingTransaction) override;
   virtual void commitTransaction(size_t) override;
@@ -114,6 +130,8 @@ public:
   virtual void start() override;
   virtual void stop() override;
   virtual WalletEvent getEvent() override;
+  virtual std::vector<WalletEvent> getEvents(size_t maxCount) override;
+  virtual void setEventCoalescing(bool enabled) override;
 
   virtual size_t createFusionTransaction(uint64_t threshold, uint64_t mixin,
                                          const std::vector<std::string> &sourceAddresses = {}, const std::string &destinationAddress = "") override;
@@ -125,6 +143,26 @@ public:
                              TransactionId creatingTransactionId,
                              const Currency &currency, uint32_t height);
 
+  // Fee and size of sending amount from any address, predicted from the spendable outputs
+  // without requesting mixins or building the transaction; cached until the outputs change
+  FeeEstimate estimateTransaction(uint64_t amount, uint64_t mixIn, size_t extraSize = 0);
+  // The estimator behind estimateTransaction, brought up to date; a copy answers estimates
+  // from other threads until generation() moves on
+  const FeeEstimator &feeEstimator();
+
+  // Resets the wallet to scanHeight like reset(), then finds the blocks holding its transactions with a
+  // ParallelRescan of the compact output stream so that the synchronizer downloads only those in full.
+  // Blocks the dispatcher until the scan is done and reports progress on the calling thread. When the
+  // scan fails or is stopped the wallet syncs the regular way and resumeRescan() can pick it up later.
+  std::error_code rescan(uint32_t scanHeight, size_t workerCount, const ParallelRescan::ProgressCallback &progress);
+  // true if a rescan was interrupted before the synchronizer went through its plan
+  bool hasInterruptedRescan() const;
+  std::error_code resumeRescan(size_t workerCount, const ParallelRescan::ProgressCallback &progress);
+
+  // First height a wallet created at timestamp has to scan, looked up in the node's block index;
+  // estimated from the block target when the node cannot answer
+  uint32_t timestampToScanHeight(uint64_t timestamp);
+
 protected:
   struct NewAddressData
   {
@@ -153,14 +191,18 @@ protected:
   void initWithKeys(const std::string& path, const std::string& password, const Crypto::PublicKey& viewPublicKey, const Crypto::SecretKey& viewSecretKey);
   std::string doCreateAddress(const Crypto::PublicKey &spendPublicKey, const Crypto::SecretKey &spendSecretKey, uint64_t creationTimestamp);
   std::vector<std::string> doCreateAddressList(const std::vector<NewAddressData> &addressDataList);
+  bool deriveSpendPublicKeys(std::vector<NewAddressData> &addressDataList, bool fromSeeds);
   Crypto::SecretKey getTransactionDeterministicSecretKey(Crypto::Hash &transactionHash) const;
 
   uint64_t scanHeightToTimestamp(const uint32_t scanHeight);
+  uint64_t estimateScanHeightTimestamp(const uint32_t scanHeight);
   uint64_t getCurrentTimestampAdjusted();
+  std::error_code waitForNode(const std::function<void(const INode::Callback &)> &request);
 
   struct InputInfo
   {
     TransactionTypes::InputKeyInfo keyInfo;
+    Crypto::KeyImage keyImage;
     WalletRecord *walletRecord = nullptr;
     KeyPair ephKeys;
   };
@@ -238,6 +280,8 @@ protected:
   std::vector<WalletOuts> pickWalletsWithMoney() const;
   WalletOuts pickWallet(const std::string &address) const;
   std::vector<WalletOuts> pickWallets(const std::vector<std::string> &addresses) const;
+  // wallets only, outputs are left to selectTransfers and m_spendableOutputs
+  std::vector<WalletOuts> pickSpendingWallets(const std::vector<std::string> &addresses) const;
 
   void updateBalance(CryptoNote::ITransfersContainer *container);
   void unlockBalances(uint32_t height);
@@ -247,16 +291,19 @@ protected:
   const WalletRecord &getWalletRecord(CryptoNote::ITransfersContainer *container) const;
 
   CryptoNote::AccountPublicAddress parseAddress(const std::string &address) const;
-  std::string addWallet(const Crypto::PublicKey &spendPublicKey, const Crypto::SecretKey &spendSecretKey, uint64_t creationTimestamp);
+  std::string addWallet(const Crypto::PublicKey &spendPublicKey, const Crypto::SecretKey &spendSecretKey, uint64_t creationTimestamp, bool scanHistory);
   AccountKeys makeAccountKeys(const WalletRecord &wallet) const;
   size_t getTransactionId(const Crypto::Hash &transactionHash) const;
   size_t getDepositId(const Crypto::Hash &transactionHash) const;
   void pushEvent(const WalletEvent &event);
+  void waitForEvent();
+  WalletEvent popEvent();
+  void clearEvents();
   bool isFusionTransaction(const WalletTransaction &walletTx) const;
 
   struct PreparedTransaction
   {
-    std::unique_ptr<ITransaction> transaction;
+    PooledTransaction transaction;
     std::vector<WalletTransfer> destinations;
     uint64_t neededMoney;
     uint64_t changeAmount;
@@ -281,6 +328,18 @@ protected:
   void validateTransactionParameters(const TransactionParameters &transactionParameters) const;
   size_t doTransfer(const TransactionParameters &transactionParameters, Crypto::SecretKey &transactionSK);
 
+  struct BatchRelays
+  {
+    explicit BatchRelays(System::Dispatcher &dispatcher) : inFlight(0), completed(dispatcher) {}
+
+    size_t inFlight;
+    std::vector<std::pair<size_t, std::error_code>> results;
+    System::Event completed;
+  };
+
+  void relayBatchTransaction(size_t transactionId, BatchRelays &relays);
+  void applyBatchRelayResults(BatchRelays &relays);
+
   void requestMixinOuts(const std::vector<OutputToTransfer> &selectedTransfers,
                         uint64_t mixIn,
                         std::vector<CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount> &mixinResult);
@@ -300,8 +359,11 @@ protected:
                                                  uint64_t dustThreshold, const Currency &currency);
   ReceiverAmounts splitAmount(uint64_t amount, const AccountPublicAddress &destination, uint64_t dustThreshold);
 
-  std::unique_ptr<CryptoNote::ITransaction> makeTransaction(const std::vector<ReceiverAmounts> &decomposedOutputs,
-                                                            std::vector<InputInfo> &keysInfo, const std::vector<WalletMessage> &messages, const std::string &extra, uint64_t unlockTimestamp, Crypto::SecretKey &transactionSK);
+  CryptoNote::PooledTransaction makeTransaction(const std::vector<ReceiverAmounts> &decomposedOutputs,
+                                                std::vector<InputInfo> &keysInfo, const std::vector<WalletMessage> &messages, const std::string &extra, uint64_t unlockTimestamp, Crypto::SecretKey &transactionSK);
+
+  void signInputs(ITransaction &transaction, const std::vector<InputInfo> &keysInfo);
+  Common::ThreadPool &signingWorkers();
 
   void sendTransaction(const CryptoNote::Transaction &cryptoNoteTransaction);
   size_t validateSaveAndSendTransaction(const ITransactionReader &transaction, const std::vector<WalletTransfer> &destinations, bool isFusion, bool send);
@@ -330,18 +392,26 @@ protected:
   void deleteUnlockTransactionJob(const Crypto::Hash &transactionHash);
   void startBlockchainSynchronizer();
   void stopBlockchainSynchronizer();
+  std::error_code runRescan(uint32_t startHeight, uint32_t endHeight, size_t workerCount, const ParallelRescan::ProgressCallback &progress);
+  std::string rescanCheckpointPath() const;
   void addUnconfirmedTransaction(const ITransactionReader &transaction);
   void removeUnconfirmedTransaction(const Crypto::Hash &transactionHash);
   void initTransactionPool();
   static void loadAndDecryptContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData);
   static void encryptAndSaveContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerData, size_t containerDataSize);
-  void loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKeys, std::unordered_set<Crypto::PublicKey>& deletedKeys, std::string& extra);
+  void loadWalletCache(const std::string& path, std::unordered_set<Crypto::PublicKey>& addedKeys, std::unordered_set<Crypto::PublicKey>& deletedKeys, std::string& extra);
 
   void copyContainerStorageKeys(ContainerStorage& src, const Crypto::chacha8_key& srcKey, ContainerStorage& dst, const Crypto::chacha8_key& dstKey);
   static void copyContainerStoragePrefix(ContainerStorage& src, const Crypto::chacha8_key& srcKey, ContainerStorage& dst, const Crypto::chacha8_key& dstKey);
   
     void deleteOrphanTransactions(const std::unordered_set<Crypto::PublicKey>& deletedKeys);
+  // writes the whole cache to the container suffix
   void saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra);
+  // useHistory moves the oldest transactions to m_history and appends the reference to them
+  std::string serializeWalletCache(WalletSaveLevel saveLevel, const std::string& extra, bool useHistory);
+  // writes a snapshot to m_cacheLog off the dispatcher thread, then commits the reference to it in the container suffix
+  void startCacheLogSave(std::shared_ptr<const std::string> containerData);
+  void waitForPendingSave();
   void loadSpendKeys();
     void loadContainerStorage(const std::string& path);
 
@@ -369,10 +439,16 @@ protected:
 
   TransfersRange getTransactionTransfersRange(size_t transactionIndex) const;
   std::vector<TransactionsInBlockInfo> getTransactionsInBlocks(uint32_t blockIndex, size_t count) const;
+  std::vector<TransactionsInBlockInfo> getIndexedTransactionsInBlocks(uint32_t blockIndex, size_t count,
+    const std::vector<std::string> &addresses, const Crypto::Hash *paymentId) const;
+  // built on the first indexed query, then kept up to date as transactions change
+  void buildTransactionIndexes() const;
+  void indexTransaction(size_t transactionId) const;
   std::vector<DepositsInBlockInfo> getDepositsInBlocks(uint32_t blockIndex, size_t count) const;
   Crypto::Hash getBlockHashByIndex(uint32_t blockIndex) const;
 
   std::vector<WalletTransfer> getTransactionTransfers(const WalletTransaction &transaction) const;
+  WalletTransactionWithTransfers getTransactionWithTransfers(const WalletTransaction &transaction) const;
   void filterOutTransactions(WalletTransactions &transactions, WalletTransfers &transfers, std::function<bool(const WalletTransaction &)> &&pred) const;
   void initBlockchain(const Crypto::PublicKey& viewPublicKey);
   void getViewKeyKnownBlocks(const Crypto::PublicKey &viewPublicKey);
@@ -381,28 +457,51 @@ protected:
 
   void deleteContainerFromUnlockTransactionJobs(const ITransfersContainer *container);
   std::vector<size_t> deleteTransfersForAddress(const std::string &address, std::vector<size_t> &deletedTransactions);
+  // moves extra and transfers of settled transactions into m_history, a page at a time
+  void archiveWalletHistory();
+  // brings archived transactions from the page of transactionId on back into memory
+  void restoreWalletHistory(size_t transactionId);
+  void addArchivedHistory(WalletTransactions &transactions, WalletTransfers &transfers) const;
   void deleteFromUncommitedTransactions(const std::vector<size_t> &deletedTransactions);
 
   System::Dispatcher &m_dispatcher;
   const Currency &m_currency;
   INode &m_node;
   mutable Logging::LoggerRef m_logger;
+  MixinOutputsCache m_mixinCache;
   bool m_stopped;
   WalletDeposits m_deposits;
   WalletsContainer m_walletsContainer;
   ContainerStorage m_containerStorage;
+  WalletCacheLog m_cacheLog;
+  WalletHistoryStore m_history;
+  // the cache log write started by save(); the next save, shutdown and reset wait for it
+  System::ContextGroup m_saveContext;
   UnlockTransactionJobs m_unlockTransactionsJob;
+  SpendableOutputsIndex m_spendableOutputs;
+  FeeEstimator m_feeEstimator;
   WalletTransactions m_transactions;
   WalletTransfers m_transfers;                               //sorted
   mutable std::unordered_map<size_t, bool> m_fusionTxsCache; // txIndex -> isFusion
+  // (blockHeight, transactionId) sorted; entries are never removed, so queries check them against the transaction
+  typedef std::vector<std::pair<uint32_t, size_t>> TransactionHeightList;
+  mutable std::unordered_map<std::string, TransactionHeightList> m_addressTransactions;
+  mutable std::unordered_map<Crypto::Hash, TransactionHeightList> m_paymentIdTransactions;
+  mutable bool m_transactionIndexesBuilt;
   UncommitedTransactions m_uncommitedTransactions;
 
   bool m_blockchainSynchronizerStarted;
+  // the synchronizer follows a rescan plan whose checkpoint is removed once it is through
+  bool m_rescanInProgress;
   BlockchainSynchronizer m_blockchainSynchronizer;
   TransfersSyncronizer m_synchronizer;
 
   System::Event m_eventOccurred;
-  std::queue<WalletEvent> m_events;
+  std::deque<WalletEvent> m_events;
+  // what is queued, kept whether or not coalescing is on so it can be switched at any time
+  bool m_coalesceEvents;
+  bool m_balanceUnlockedQueued;
+  std::unordered_set<size_t> m_queuedTransactionEvents;
   mutable System::Event m_readyEvent;
 
   WalletState m_state;
@@ -424,6 +523,8 @@ protected:
   uint32_t m_transactionSoftLockTime;
 
   BlockHashesContainer m_blockchain;
+
+  std::unique_ptr<Common::ThreadPool> m_signingWorkers; // created on first use
 };
 
 } //namespace CryptoNote
@@ -0,0 +1,289 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "WalletHistoryStore.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "Common/MemoryInputStream.h"
+#include "Common/StringOutputStream.h"
+#include "CryptoNoteCore/CryptoNoteSerialization.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+#include "crypto/crypto.h"
+
+namespace CryptoNote {
+
+namespace {
+
+const char STORE_MAGIC[8] = {'F', 'U', 'E', 'H', 'I', 'S', 'T', '1'};
+
+void serializeRecord(WalletHistoryStore::Record& record, ISerializer& s) {
+  s(record.extra, "extra");
+
+  uint64_t transferCount = record.transfers.size();
+  s(transferCount, "transferCount");
+  record.transfers.resize(transferCount);
+
+  for (auto& transfer : record.transfers) {
+    uint8_t type = static_cast<uint8_t>(transfer.type);
+    s(type, "type");
+    transfer.type = static_cast<WalletTransferType>(type);
+    s(transfer.address, "address");
+    s(transfer.amount, "amount");
+  }
+}
+
+}
+
+void WalletHistoryStore::Reference::serialize(ISerializer& s) {
+  s(storeId, "storeId");
+  s(transactionCount, "transactionCount");
+}
+
+WalletHistoryStore::WalletHistoryStore() : m_storeId(Crypto::Hash()) {
+}
+
+bool WalletHistoryStore::isOpened() const {
+  return m_blocks.isOpened();
+}
+
+bool WalletHistoryStore::open(const std::string& containerPath, const Crypto::chacha8_key& key, const Reference& reference) {
+  close();
+
+  if (reference.transactionCount % TRANSACTIONS_PER_PAGE != 0 || !boost::filesystem::exists(storePath(containerPath))) {
+    return false;
+  }
+
+  try {
+    m_blocks.open(storePath(containerPath), Common::FileMappedVectorOpenMode::OPEN, sizeof(StorePrefix));
+  } catch (const std::exception&) {
+    return false;
+  }
+
+  m_blocks.setAutoFlush(false);
+  const StorePrefix* prefix = reinterpret_cast<const StorePrefix*>(m_blocks.prefix());
+  if (memcmp(prefix->magic, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0 || prefix->storeId != reference.storeId) {
+    close();
+    return false;
+  }
+
+  m_key = key;
+  m_storeId = prefix->storeId;
+
+  // a page whose blocks were not all written before a crash ends the store
+  uint64_t blockIndex = 0;
+  while (blockIndex < m_blocks.size()) {
+    const BlockHeader& header = m_blocks[blockIndex].header;
+    if (header.pageIndex != m_pageBlocks.size() || header.blockIndex != 0 || header.blockCount == 0 ||
+        blockIndex + header.blockCount > m_blocks.size()) {
+      break;
+    }
+
+    m_pageBlocks.push_back(blockIndex);
+    blockIndex += header.blockCount;
+  }
+
+  size_t pageCount = static_cast<size_t>(reference.transactionCount / TRANSACTIONS_PER_PAGE);
+  if (m_pageBlocks.size() < pageCount) {
+    close();
+    return false;
+  }
+
+  // pages appended after the cache was last committed
+  m_pageBlocks.push_back(blockIndex);
+  dropPages(pageCount);
+  flush();
+  return true;
+}
+
+void WalletHistoryStore::create(const std::string& containerPath, const Crypto::chacha8_key& key) {
+  close();
+
+  boost::system::error_code ignore;
+  boost::filesystem::remove(storePath(containerPath), ignore);
+  m_blocks.open(storePath(containerPath), Common::FileMappedVectorOpenMode::CREATE, sizeof(StorePrefix));
+  m_blocks.setAutoFlush(false);
+
+  m_key = key;
+  m_storeId = Crypto::rand<Crypto::Hash>();
+
+  StorePrefix* prefix = reinterpret_cast<StorePrefix*>(m_blocks.prefix());
+  memcpy(prefix->magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+  prefix->storeId = m_storeId;
+  flush();
+}
+
+void WalletHistoryStore::close() {
+  if (m_blocks.isOpened()) {
+    m_blocks.close();
+  }
+
+  m_storeId = Crypto::Hash();
+  m_pageBlocks.clear();
+  m_cachedPages.clear();
+}
+
+size_t WalletHistoryStore::transactionCount() const {
+  return m_pageBlocks.size() * TRANSACTIONS_PER_PAGE;
+}
+
+WalletHistoryStore::Reference WalletHistoryStore::reference() const {
+  return Reference{m_storeId, transactionCount()};
+}
+
+void WalletHistoryStore::append(const std::vector<Record>& records) {
+  assert(isOpened());
+  assert(records.size() == TRANSACTIONS_PER_PAGE);
+
+  std::string payload;
+  Common::StringOutputStream stream(payload);
+  BinaryOutputStreamSerializer s(stream);
+  for (const auto& record : records) {
+    serializeRecord(const_cast<Record&>(record), s);
+  }
+
+  std::string plain(sizeof(Crypto::Hash), '\0');
+  Crypto::Hash checksum = Crypto::cn_fast_hash(payload.data(), payload.size());
+  memcpy(&plain[0], checksum.data, sizeof(checksum.data));
+  plain += payload;
+
+  std::string cipher(plain.size(), '\0');
+  Crypto::chacha8_iv iv = Crypto::randomChachaIV();
+  Crypto::chacha8(plain.data(), plain.size(), m_key, iv, &cipher[0]);
+
+  const size_t blockDataSize = sizeof(Block::data);
+  uint32_t blockCount = static_cast<uint32_t>((cipher.size() + blockDataSize - 1) / blockDataSize);
+  uint64_t firstBlock = m_blocks.size();
+  m_blocks.reserve(firstBlock + blockCount);
+
+  for (uint32_t i = 0; i < blockCount; ++i) {
+    Block block;
+    memset(&block, 0, sizeof(block));
+    block.header.pageIndex = static_cast<uint32_t>(m_pageBlocks.size());
+    block.header.blockIndex = i;
+    block.header.blockCount = blockCount;
+    block.header.dataSize = static_cast<uint32_t>(std::min(blockDataSize, cipher.size() - i * blockDataSize));
+    block.header.iv = iv;
+    memcpy(block.data, cipher.data() + i * blockDataSize, block.header.dataSize);
+    m_blocks.push_back(block);
+  }
+
+  m_pageBlocks.push_back(firstBlock);
+}
+
+void WalletHistoryStore::truncate(size_t transactionCount) {
+  size_t pageCount = transactionCount / TRANSACTIONS_PER_PAGE;
+  if (!isOpened() || pageCount >= m_pageBlocks.size()) {
+    return;
+  }
+
+  m_pageBlocks.push_back(m_blocks.size());
+  dropPages(pageCount);
+
+  // a cache committed against the dropped pages must not be paired with what gets appended next
+  m_storeId = Crypto::rand<Crypto::Hash>();
+  reinterpret_cast<StorePrefix*>(m_blocks.prefix())->storeId = m_storeId;
+}
+
+void WalletHistoryStore::flush() {
+  if (isOpened()) {
+    m_blocks.flush();
+  }
+}
+
+const WalletHistoryStore::Record& WalletHistoryStore::get(size_t transactionId) const {
+  assert(transactionId < transactionCount());
+
+  size_t pageIndex = transactionId / TRANSACTIONS_PER_PAGE;
+  auto it = m_cachedPages.begin();
+  while (it != m_cachedPages.end() && it->first != pageIndex) {
+    ++it;
+  }
+
+  if (it == m_cachedPages.end()) {
+    if (m_cachedPages.size() == CACHED_PAGES) {
+      m_cachedPages.pop_back();
+    }
+
+    m_cachedPages.emplace_front(pageIndex, loadPage(pageIndex));
+  } else if (it != m_cachedPages.begin()) {
+    m_cachedPages.splice(m_cachedPages.begin(), m_cachedPages, it);
+  }
+
+  return m_cachedPages.front().second[transactionId % TRANSACTIONS_PER_PAGE];
+}
+
+// expects the end of the last page pushed onto m_pageBlocks and removes it again
+void WalletHistoryStore::dropPages(size_t pageCount) {
+  uint64_t blockCount = m_pageBlocks[pageCount];
+  m_pageBlocks.resize(pageCount);
+
+  while (m_blocks.size() > blockCount) {
+    m_blocks.pop_back();
+  }
+
+  m_cachedPages.remove_if([pageCount](const std::pair<size_t, Page>& page) { return page.first >= pageCount; });
+}
+
+WalletHistoryStore::Page WalletHistoryStore::loadPage(size_t pageIndex) const {
+  uint64_t firstBlock = m_pageBlocks[pageIndex];
+  const BlockHeader& first = m_blocks[firstBlock].header;
+
+  std::string cipher;
+  cipher.reserve(static_cast<size_t>(first.blockCount) * sizeof(Block::data));
+  for (uint32_t i = 0; i < first.blockCount; ++i) {
+    const Block& block = m_blocks[firstBlock + i];
+    if (block.header.pageIndex != pageIndex || block.header.blockIndex != i || block.header.dataSize > sizeof(block.data)) {
+      throw std::runtime_error("Wallet history page is damaged");
+    }
+
+    cipher.append(reinterpret_cast<const char*>(block.data), block.header.dataSize);
+  }
+
+  if (cipher.size() < sizeof(Crypto::Hash)) {
+    throw std::runtime_error("Wallet history page is damaged");
+  }
+
+  std::string plain(cipher.size(), '\0');
+  Crypto::chacha8(cipher.data(), cipher.size(), m_key, first.iv, &plain[0]);
+
+  Crypto::Hash checksum = Crypto::cn_fast_hash(plain.data() + sizeof(Crypto::Hash), plain.size() - sizeof(Crypto::Hash));
+  if (memcmp(checksum.data, plain.data(), sizeof(checksum.data)) != 0) {
+    throw std::runtime_error("Wallet history page is damaged");
+  }
+
+  Page page(TRANSACTIONS_PER_PAGE);
+  Common::MemoryInputStream stream(plain.data() + sizeof(Crypto::Hash), plain.size() - sizeof(Crypto::Hash));
+  BinaryInputStreamSerializer s(stream);
+  for (auto& record : page) {
+    serializeRecord(record, s);
+  }
+
+  return page;
+}
+
+std::string WalletHistoryStore::storePath(const std::string& containerPath) {
+  return containerPath + ".history";
+}
+
+}
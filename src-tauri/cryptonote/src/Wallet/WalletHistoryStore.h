@@ -0,0 +1,115 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "IWallet.h"
+#include "Common/FileMappedVector.h"
+#include "crypto/chacha8.h"
+#include "crypto/hash.h"
+#include "Serialization/ISerializer.h"
+
+namespace CryptoNote {
+
+// Encrypted, paged store for the payload of settled wallet transactions (extra and transfers),
+// kept next to the container file. Transactions are archived in pages of TRANSACTIONS_PER_PAGE
+// consecutive ids starting from id 0, so the store always covers a prefix of the transaction
+// list. Each page is encrypted as a whole with its own random iv and spread over fixed-size
+// blocks of a FileMappedVector; get() decrypts the page holding a transaction on first use and
+// keeps the last few pages decoded.
+class WalletHistoryStore {
+public:
+  static const size_t TRANSACTIONS_PER_PAGE = 64;
+
+  struct Record {
+    std::string extra;
+    std::vector<WalletTransfer> transfers;
+  };
+
+  // saved with the wallet cache, so a cache is only paired with the store it was written against
+  struct Reference {
+    Crypto::Hash storeId;
+    uint64_t transactionCount;
+
+    void serialize(ISerializer& s);
+  };
+
+  WalletHistoryStore();
+
+  bool isOpened() const;
+  // opens an existing store and drops pages the reference does not cover yet, false if the store
+  // is missing or was not written against this reference
+  bool open(const std::string& containerPath, const Crypto::chacha8_key& key, const Reference& reference);
+  // replaces any existing store with an empty one
+  void create(const std::string& containerPath, const Crypto::chacha8_key& key);
+  void close();
+
+  size_t transactionCount() const;
+  Reference reference() const;
+
+  // records.size() must be TRANSACTIONS_PER_PAGE, the first record belongs to id transactionCount()
+  void append(const std::vector<Record>& records);
+  // drops whole pages from the end so that at most transactionCount transactions are left
+  void truncate(size_t transactionCount);
+  void flush();
+
+  const Record& get(size_t transactionId) const;
+
+private:
+  static const size_t BLOCK_SIZE = 4096;
+  static const size_t CACHED_PAGES = 8;
+
+#pragma pack(push, 1)
+  struct StorePrefix {
+    char magic[8];
+    Crypto::Hash storeId;
+  };
+
+  struct BlockHeader {
+    uint32_t pageIndex;
+    uint32_t blockIndex;
+    uint32_t blockCount;
+    uint32_t dataSize;
+    Crypto::chacha8_iv iv; // of the whole page, repeated in every block
+  };
+
+  struct Block {
+    BlockHeader header;
+    uint8_t data[BLOCK_SIZE - sizeof(BlockHeader)];
+  };
+#pragma pack(pop)
+
+  typedef std::vector<Record> Page;
+
+  void dropPages(size_t pageCount);
+  Page loadPage(size_t pageIndex) const;
+  static std::string storePath(const std::string& containerPath);
+
+  Common::FileMappedVector<Block> m_blocks;
+  Crypto::chacha8_key m_key;
+  Crypto::Hash m_storeId;
+  std::vector<uint64_t> m_pageBlocks;                      // first block of every page
+  mutable std::list<std::pair<size_t, Page>> m_cachedPages; // most recently used first
+};
+
+}
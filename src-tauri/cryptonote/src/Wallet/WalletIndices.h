@@ -33,6 +33,7 @@
 
 #include "Common/FileMappedVector.h"
 #include "crypto/chacha8.h"
+#include "UnlockTransactionJobs.h"
 
 namespace CryptoNote
 {
@@ -99,22 +100,6 @@ struct EncryptedWalletRecord {
                                               BOOST_MULTI_INDEX_MEMBER(WalletRecord, CryptoNote::ITransfersContainer *, container)>>>
         WalletsContainer;
 
-    struct UnlockTransactionJob
-    {
-        uint32_t blockHeight;
-        CryptoNote::ITransfersContainer *container;
-        Crypto::Hash transactionHash;
-    };
-
-    typedef boost::multi_index_container<
-        UnlockTransactionJob,
-        boost::multi_index::indexed_by<
-            boost::multi_index::ordered_non_unique<boost::multi_index::tag<BlockHeightIndex>,
-                                                   BOOST_MULTI_INDEX_MEMBER(UnlockTransactionJob, uint32_t, blockHeight)>,
-            boost::multi_index::hashed_non_unique<boost::multi_index::tag<TransactionHashIndex>,
-                                                  BOOST_MULTI_INDEX_MEMBER(UnlockTransactionJob, Crypto::Hash, transactionHash)>>>
-        UnlockTransactionJobs;
-
     typedef boost::multi_index_container<
         CryptoNote::Deposit,
         boost::multi_index::indexed_by<
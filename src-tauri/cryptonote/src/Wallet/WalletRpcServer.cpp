@@ -49,6 +49,13 @@
 using namespace Logging;
 using namespace CryptoNote;
 
+namespace {
+
+// transactions looked at per chunk of a streamed get_transfers response
+const size_t TRANSFERS_PER_CHUNK = 256;
+
+}
+
 namespace Tools {
 
 const command_line::arg_descriptor<uint16_t> wallet_rpc_server::arg_rpc_bind_port = { "rpc-bind-port", "Starts wallet as rpc server for wallet operations, sets bind port for server", 0, true };
@@ -131,7 +138,6 @@ void wallet_rpc_server::processRequest(const CryptoNote::HttpRequest& request, C
       { "store", makeMemberMethod(&wallet_rpc_server::on_store) },
       { "get_messages", makeMemberMethod(&wallet_rpc_server::on_get_messages) },
       { "get_payments", makeMemberMethod(&wallet_rpc_server::on_get_payments) },
-      { "get_transfers", makeMemberMethod(&wallet_rpc_server::on_get_transfers) },
       { "get_height", makeMemberMethod(&wallet_rpc_server::on_get_height) },
       { "get_outputs", makeMemberMethod(&wallet_rpc_server::on_get_outputs) },
       { "get_tx_proof"     , makeMemberMethod(&wallet_rpc_server::on_get_tx_proof)      },
@@ -142,6 +148,11 @@ void wallet_rpc_server::processRequest(const CryptoNote::HttpRequest& request, C
       { "reset", makeMemberMethod(&wallet_rpc_server::on_reset) }
     };
 
+    if (jsonRequest.getMethod() == "get_transfers") {
+      streamTransfers(jsonRequest, jsonResponse, response);
+      return;
+    }
+
     auto it = s_methods.find(jsonRequest.getMethod());
     if (it == s_methods.end()) {
       throw JsonRpcError(errMethodNotFound);
@@ -459,7 +470,14 @@ bool wallet_rpc_server::on_get_payments(const wallet_rpc::COMMAND_RPC_GET_PAYMEN
   std::copy(std::begin(payment_id_blob), std::end(payment_id_blob), reinterpret_cast<char*>(&expectedPaymentId)); // no UB, char can alias any type
   auto payments = m_wallet.getTransactionsByPaymentIds({expectedPaymentId});
   assert(payments.size() == 1);
-  for (auto& transaction : payments[0].transactions) {
+  const auto& transactions = payments[0].transactions;
+  uint64_t index = req.first_index;
+  for (; index < transactions.size() && res.payments.size() < req.limit; ++index) {
+    const auto& transaction = transactions[index];
+    if (transaction.blockHeight < req.min_height || transaction.blockHeight > req.max_height) {
+      continue;
+    }
+
     wallet_rpc::payment_details rpc_payment;
     rpc_payment.tx_hash = Common::podToHex(transaction.hash);
     rpc_payment.amount = transaction.totalAmount;
@@ -468,6 +486,7 @@ bool wallet_rpc_server::on_get_payments(const wallet_rpc::COMMAND_RPC_GET_PAYMEN
     res.payments.push_back(rpc_payment);
   }
 
+  res.next_index = index;
   return true;
 }
 
@@ -510,46 +529,108 @@ bool wallet_rpc_server::on_create_integrated(const wallet_rpc::COMMAND_RPC_CREAT
 
 /* --------------------------------------------------------------------------------- */
 
-bool wallet_rpc_server::on_get_transfers(const wallet_rpc::COMMAND_RPC_GET_TRANSFERS::request& req, wallet_rpc::COMMAND_RPC_GET_TRANSFERS::response& res) {
-  res.transfers.clear();
-  size_t transactionsCount = m_wallet.getTransactionCount();
-  for (size_t trantransactionNumber = 0; trantransactionNumber < transactionsCount; ++trantransactionNumber) {
-    WalletLegacyTransaction txInfo;
-    m_wallet.getTransaction(trantransactionNumber, txInfo);
-    if (txInfo.state != WalletLegacyTransactionState::Active || txInfo.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
-      continue;
-    }
+void wallet_rpc_server::streamTransfers(const JsonRpc::JsonRpcRequest& jsonRequest, JsonRpc::JsonRpcResponse& jsonResponse, HttpResponse& response) {
+  wallet_rpc::COMMAND_RPC_GET_TRANSFERS::request req;
+  if (jsonRequest.hasParams()) {
+    jsonRequest.loadParams(req);
+  }
+
+  struct TransfersStream {
+    std::string head;
+    bool filtered;
+    // with a height filter the wallet's height index names the candidates, otherwise every id is one
+    std::vector<TransactionId> candidates;
+    size_t position;
+    uint64_t nextTransactionId;
+    uint64_t left;
+    bool first;
+  };
+
+  auto stream = std::make_shared<TransfersStream>();
+  stream->head = jsonResponse.getBodyBeforeResult() + "{\"transfers\":[";
+  stream->filtered = req.min_height != 0 || req.max_height != std::numeric_limits<uint32_t>::max();
+  if (stream->filtered) {
+    stream->candidates = m_wallet.getTransactionsInHeightRange(req.min_height, req.max_height);
+  }
+  stream->position = std::lower_bound(stream->candidates.begin(), stream->candidates.end(), req.first_tx_id) - stream->candidates.begin();
+  stream->nextTransactionId = req.first_tx_id;
+  stream->left = req.tx_limit;
+  stream->first = true;
+
+  response.setBodyProducer([this, stream](std::string& chunk) {
+    chunk += stream->head;
+    stream->head.clear();
+
+    uint64_t total = m_wallet.getTransactionCount();
+    bool exhausted = false;
+    for (size_t examined = 0; stream->left != 0 && examined < TRANSFERS_PER_CHUNK; ++examined) {
+      TransactionId id;
+      if (stream->filtered) {
+        exhausted = stream->position == stream->candidates.size();
+        id = exhausted ? 0 : stream->candidates[stream->position++];
+      } else {
+        exhausted = stream->nextTransactionId >= total;
+        id = static_cast<TransactionId>(stream->nextTransactionId);
+      }
+
+      if (exhausted) {
+        break;
+      }
 
-    std::string address = "";
-    if (txInfo.totalAmount < 0) {
-      if (txInfo.transferCount > 0) {
-        WalletLegacyTransfer tr;
-        m_wallet.getTransfer(txInfo.firstTransferId, tr);
-        address = tr.address;
+      stream->nextTransactionId = id + 1;
+      wallet_rpc::Transfer transfer;
+      if (makeTransfer(id, transfer)) {
+        if (!stream->first) {
+          chunk += ',';
+        }
+        chunk += storeToJson(transfer);
+        stream->first = false;
+        --stream->left;
       }
     }
 
-    wallet_rpc::Transfer transfer;
-    transfer.time = txInfo.timestamp;
-    transfer.output = txInfo.totalAmount < 0;
-    transfer.transactionHash = Common::podToHex(txInfo.hash);
-    transfer.amount = std::abs(txInfo.totalAmount);
-    transfer.fee = txInfo.fee;
-    transfer.address = address;
-    transfer.blockIndex = txInfo.blockHeight;
-    transfer.unlockTime = txInfo.unlockTime;
-    transfer.paymentId = "";
-
-    std::vector<uint8_t> extraVec;
-    extraVec.reserve(txInfo.extra.size());
-    std::for_each(txInfo.extra.begin(), txInfo.extra.end(), [&extraVec](const char el) { extraVec.push_back(el); });
-
-    Crypto::Hash paymentId;
-    transfer.paymentId = (getPaymentIdFromTxExtra(extraVec, paymentId) && paymentId != NULL_HASH ? Common::podToHex(paymentId) : "");
-
-    res.transfers.push_back(transfer);
+    if (!exhausted && stream->left != 0) {
+      return true;
+    }
+
+    uint64_t nextTransactionId = exhausted ? std::max(total, stream->nextTransactionId) : stream->nextTransactionId;
+    chunk += "],\"next_tx_id\":" + std::to_string(nextTransactionId) + ",\"total_tx_count\":" + std::to_string(total) + "}}";
+    return false;
+  });
+}
+
+bool wallet_rpc_server::makeTransfer(TransactionId transactionId, wallet_rpc::Transfer& transfer) {
+  WalletLegacyTransaction txInfo;
+  if (!m_wallet.getTransaction(transactionId, txInfo) ||
+      txInfo.state != WalletLegacyTransactionState::Active || txInfo.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+    return false;
+  }
+
+  std::string address = "";
+  if (txInfo.totalAmount < 0) {
+    if (txInfo.transferCount > 0) {
+      WalletLegacyTransfer tr;
+      m_wallet.getTransfer(txInfo.firstTransferId, tr);
+      address = tr.address;
+    }
   }
 
+  transfer.time = txInfo.timestamp;
+  transfer.output = txInfo.totalAmount < 0;
+  transfer.transactionHash = Common::podToHex(txInfo.hash);
+  transfer.amount = std::abs(txInfo.totalAmount);
+  transfer.fee = txInfo.fee;
+  transfer.address = address;
+  transfer.blockIndex = txInfo.blockHeight;
+  transfer.unlockTime = txInfo.unlockTime;
+  transfer.paymentId = "";
+
+  std::vector<uint8_t> extraVec;
+  extraVec.reserve(txInfo.extra.size());
+  std::for_each(txInfo.extra.begin(), txInfo.extra.end(), [&extraVec](const char el) { extraVec.push_back(el); });
+
+  Crypto::Hash paymentId;
+  transfer.paymentId = (getPaymentIdFromTxExtra(extraVec, paymentId) && paymentId != NULL_HASH ? Common::podToHex(paymentId) : "");
   return true;
 }
 
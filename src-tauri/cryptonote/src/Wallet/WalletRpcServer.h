@@ -24,6 +24,7 @@
 #include "WalletLegacy/WalletLegacy.h"
 #include "Common/CommandLine.h"
 #include "Rpc/HttpServer.h"
+#include "Rpc/JsonRpc.h"
 
 #include <Logging/LoggerRef.h>
 
@@ -67,7 +68,6 @@ namespace Tools
     bool on_store(const wallet_rpc::COMMAND_RPC_STORE::request& req, wallet_rpc::COMMAND_RPC_STORE::response& res);
     bool on_get_messages(const wallet_rpc::COMMAND_RPC_GET_MESSAGES::request& req, wallet_rpc::COMMAND_RPC_GET_MESSAGES::response& res);
     bool on_get_payments(const wallet_rpc::COMMAND_RPC_GET_PAYMENTS::request& req, wallet_rpc::COMMAND_RPC_GET_PAYMENTS::response& res);
-    bool on_get_transfers(const wallet_rpc::COMMAND_RPC_GET_TRANSFERS::request& req, wallet_rpc::COMMAND_RPC_GET_TRANSFERS::response& res);
 	  bool on_get_tx_proof(const wallet_rpc::COMMAND_RPC_GET_TX_PROOF::request& req, wallet_rpc::COMMAND_RPC_GET_TX_PROOF::response& res);
 	  bool on_get_reserve_proof(const wallet_rpc::COMMAND_RPC_GET_BALANCE_PROOF::request& req, wallet_rpc::COMMAND_RPC_GET_BALANCE_PROOF::response& res);    
     bool on_get_height(const wallet_rpc::COMMAND_RPC_GET_HEIGHT::request& req, wallet_rpc::COMMAND_RPC_GET_HEIGHT::response& res);
@@ -77,6 +77,10 @@ namespace Tools
     bool on_send_fusion(const wallet_rpc::COMMAND_RPC_SEND_FUSION::request& req, wallet_rpc::COMMAND_RPC_SEND_FUSION::response& res);
     bool on_reset(const wallet_rpc::COMMAND_RPC_RESET::request& req, wallet_rpc::COMMAND_RPC_RESET::response& res);
 
+    // get_transfers is written while it is sent instead of being built in memory first
+    void streamTransfers(const CryptoNote::JsonRpc::JsonRpcRequest& jsonRequest, CryptoNote::JsonRpc::JsonRpcResponse& jsonResponse, CryptoNote::HttpResponse& response);
+    bool makeTransfer(CryptoNote::TransactionId transactionId, wallet_rpc::Transfer& transfer);
+
     bool handle_command_line(const boost::program_options::variables_map& vm);
 
     Logging::LoggerRef logger;
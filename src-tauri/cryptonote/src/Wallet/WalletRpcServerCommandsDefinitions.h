@@ -199,18 +199,30 @@ using CryptoNote::ISerializer;
     struct request
     {
       std::string payment_id;
+      // position in the payment's transaction list to continue from
+      uint64_t first_index = 0;
+      uint32_t limit = std::numeric_limits<uint32_t>::max();
+      uint32_t min_height = 0;
+      uint32_t max_height = std::numeric_limits<uint32_t>::max();
 
       void serialize(ISerializer& s) {
         KV_MEMBER(payment_id)
+        KV_MEMBER(first_index)
+        KV_MEMBER(limit)
+        KV_MEMBER(min_height)
+        KV_MEMBER(max_height)
       }
     };
 
     struct response
     {
       std::list<payment_details> payments;
+      // first_index of the next page, the number of the payment's transactions once all are returned
+      uint64_t next_index;
 
       void serialize(ISerializer& s) {
         KV_MEMBER(payments)
+        KV_MEMBER(next_index)
       }
     };
   };
@@ -240,13 +252,30 @@ using CryptoNote::ISerializer;
   };
 
   struct COMMAND_RPC_GET_TRANSFERS {
-    typedef CryptoNote::EMPTY_STRUCT request;
+    struct request {
+      uint64_t first_tx_id = 0;
+      uint32_t tx_limit = std::numeric_limits<uint32_t>::max();
+      uint32_t min_height = 0;
+      uint32_t max_height = std::numeric_limits<uint32_t>::max();
+
+      void serialize(ISerializer& s) {
+        KV_MEMBER(first_tx_id)
+        KV_MEMBER(tx_limit)
+        KV_MEMBER(min_height)
+        KV_MEMBER(max_height)
+      }
+    };
 
     struct response {
       std::list<Transfer> transfers;
+      // first_tx_id of the next page, total_tx_count once the history is exhausted
+      uint64_t next_tx_id;
+      uint64_t total_tx_count;
 
       void serialize(ISerializer& s) {
         KV_MEMBER(transfers)
+        KV_MEMBER(next_tx_id)
+        KV_MEMBER(total_tx_count)
       }
     };
   };
@@ -397,5 +426,117 @@ using CryptoNote::ISerializer;
       }
     };
   };
+
+  // Pool mode of pool_rpc_server: blob is a whole block built on a template paying the pool wallet,
+  // with the miner's nonce in it; result, when given, is the hash the pool frontend saw
+  struct pool_share
+  {
+    std::string miner;
+    std::string blob;
+    uint64_t difficulty;
+    std::string result;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(miner)
+      KV_MEMBER(blob)
+      KV_MEMBER(difficulty)
+      KV_MEMBER(result)
+    }
+  };
+
+  struct pool_share_result
+  {
+    std::string hash;
+    std::string status;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(hash)
+      KV_MEMBER(status)
+    }
+  };
+
+  struct COMMAND_RPC_SUBMIT_SHARES
+  {
+    struct request
+    {
+      std::vector<pool_share> shares;
+
+      void serialize(ISerializer& s) {
+        KV_MEMBER(shares)
+      }
+    };
+
+    struct response
+    {
+      std::vector<pool_share_result> results; // in request order
+      uint64_t accepted;
+
+      void serialize(ISerializer& s) {
+        KV_MEMBER(results)
+        KV_MEMBER(accepted)
+      }
+    };
+  };
+
+  struct pool_miner_balance
+  {
+    std::string miner;
+    uint64_t shares;  // difficulty credited since the last pay_miners
+    uint64_t balance; // owed but not paid yet, below min_payout
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(miner)
+      KV_MEMBER(shares)
+      KV_MEMBER(balance)
+    }
+  };
+
+  struct COMMAND_RPC_GET_MINER_BALANCES
+  {
+    typedef CryptoNote::EMPTY_STRUCT request;
+
+    struct response
+    {
+      std::vector<pool_miner_balance> miners;
+
+      void serialize(ISerializer& s) {
+        KV_MEMBER(miners)
+      }
+    };
+  };
+
+  // Splits amount over the shares credited so far, then pays every balance of at least min_payout
+  struct COMMAND_RPC_PAY_MINERS
+  {
+    struct request
+    {
+      uint64_t amount;
+      uint64_t min_payout = 0;
+      uint64_t fee;
+      uint64_t mixin;
+      uint64_t unlock_time = 0;
+
+      void serialize(ISerializer& s) {
+        KV_MEMBER(amount)
+        KV_MEMBER(min_payout)
+        KV_MEMBER(fee)
+        KV_MEMBER(mixin)
+        KV_MEMBER(unlock_time)
+      }
+    };
+
+    struct response
+    {
+      std::vector<std::string> tx_hashes;
+      uint64_t paid_miners;
+      uint64_t paid_amount;
+
+      void serialize(ISerializer& s) {
+        KV_MEMBER(tx_hashes)
+        KV_MEMBER(paid_miners)
+        KV_MEMBER(paid_amount)
+      }
+    };
+  };
 }
 }
@@ -425,14 +425,13 @@ void WalletSerializer::saveTransfersSynchronizer(Common::IOutputStream& destinat
 }
 
 void WalletSerializer::saveUnlockTransactionsJobs(Common::IOutputStream& destination, CryptoContext& cryptoContext) {
-  auto& index = m_unlockTransactions.get<TransactionHashIndex>();
   auto& wallets = m_walletsContainer.get<TransfersContainerIndex>();
 
-  uint64_t jobsCount = index.size();
+  uint64_t jobsCount = m_unlockTransactions.size();
   serializeEncrypted(jobsCount, "unlock_transactions_jobs_count", cryptoContext, destination);
   cryptoContext.incIv();
 
-  for (const auto& j: index) {
+  for (const auto& j: m_unlockTransactions.getJobs()) {
     auto containerIt = wallets.find(j.container);
     assert(containerIt != wallets.end());
 
@@ -769,7 +768,6 @@ void WalletSerializer::loadObsoleteSpentOutputs(Common::IInputStream& source, Cr
 }
 
 void WalletSerializer::loadUnlockTransactionsJobs(Common::IInputStream& source, CryptoContext& cryptoContext) {
-  auto& index = m_unlockTransactions.get<TransactionHashIndex>();
   auto& walletsIndex = m_walletsContainer.get<RandomAccessIndex>();
   const uint64_t walletsSize = walletsIndex.size();
 
@@ -789,7 +787,7 @@ void WalletSerializer::loadUnlockTransactionsJobs(Common::IInputStream& source,
     job.transactionHash = dto.transactionHash;
     job.container = walletsIndex[dto.walletIndex].container;
 
-    index.insert(std::move(job));
+    m_unlockTransactions.insert(job);
   }
 }
 
@@ -454,7 +454,6 @@ void WalletSerializerV2::saveTransfersSynchronizer(CryptoNote::ISerializer& seri
 }
 
 void WalletSerializerV2::loadUnlockTransactionsJobs(CryptoNote::ISerializer& serializer) {
-  auto& index = m_unlockTransactions.get<TransactionHashIndex>();
   auto& walletsIndex = m_walletsContainer.get<KeysIndex>();
 
   uint64_t jobsCount = 0;
@@ -471,19 +470,18 @@ void WalletSerializerV2::loadUnlockTransactionsJobs(CryptoNote::ISerializer& ser
       job.transactionHash = dto.transactionHash;
       job.container = walletIt->container;
 
-      index.emplace(std::move(job));
+      m_unlockTransactions.insert(job);
     }
   }
 }
 
 void WalletSerializerV2::saveUnlockTransactionsJobs(CryptoNote::ISerializer& serializer) {
-  auto& index = m_unlockTransactions.get<TransactionHashIndex>();
   auto& wallets = m_walletsContainer.get<TransfersContainerIndex>();
 
-  uint64_t jobsCount = index.size();
+  uint64_t jobsCount = m_unlockTransactions.size();
   serializer(jobsCount, "unlockTransactionsJobsCount");
 
-  for (const auto& j : index) {
+  for (const auto& j : m_unlockTransactions.getJobs()) {
     auto containerIt = wallets.find(j.container);
     assert(containerIt != wallets.end());
 
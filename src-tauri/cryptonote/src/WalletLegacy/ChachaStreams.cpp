@@ -0,0 +1,123 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#include "ChachaStreams.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace CryptoNote {
+
+namespace {
+
+const size_t PARALLEL_CHACHA_MIN_SIZE = 4 * 1024 * 1024;
+const size_t PARALLEL_CHACHA_CHUNK_SIZE = 1024 * 1024; // a whole number of 64-byte chacha blocks
+const size_t CHUNKS_IN_FLIGHT_PER_WORKER = 2;
+
+size_t chunkCountFor(size_t size) {
+  return (size + PARALLEL_CHACHA_CHUNK_SIZE - 1) / PARALLEL_CHACHA_CHUNK_SIZE;
+}
+
+void chacha8Chunk(const char* data, size_t size, size_t chunk, const Crypto::chacha8_key& key, const Crypto::chacha8_iv& iv, char* output) {
+  size_t offset = chunk * PARALLEL_CHACHA_CHUNK_SIZE;
+  size_t chunkSize = std::min(PARALLEL_CHACHA_CHUNK_SIZE, size - offset);
+  Crypto::chacha8(data + offset, chunkSize, key, iv, offset / 64, output + offset);
+}
+
+}
+
+void parallelChacha8(const void* data, size_t size, const Crypto::chacha8_key& key, const Crypto::chacha8_iv& iv, char* output) {
+  size_t chunkCount = chunkCountFor(size);
+  size_t threadCount = std::min<size_t>(chunkCount, std::thread::hardware_concurrency());
+  if (size < PARALLEL_CHACHA_MIN_SIZE || threadCount < 2) {
+    Crypto::chacha8(data, size, key, iv, output);
+    return;
+  }
+
+  Common::ThreadPool workers(threadCount, chunkCount);
+  std::vector<std::future<void>> chunks;
+  chunks.reserve(chunkCount);
+  for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+    chunks.push_back(workers.submit([data, size, chunk, &key, &iv, output] {
+      chacha8Chunk(static_cast<const char*>(data), size, chunk, key, iv, output);
+    }));
+  }
+
+  for (auto& chunk : chunks) {
+    chunk.get();
+  }
+}
+
+ChachaDecryptingInputStream::ChachaDecryptingInputStream(const std::string& cipher, const Crypto::chacha8_key& key, const Crypto::chacha8_iv& iv) :
+  m_cipher(cipher), m_key(key), m_iv(iv), m_plain(cipher.size(), '\0'), m_position(0), m_chunkCount(chunkCountFor(cipher.size())), m_readyChunks(0) {
+  size_t threadCount = std::min<size_t>(m_chunkCount, std::thread::hardware_concurrency());
+  if (cipher.size() < PARALLEL_CHACHA_MIN_SIZE || threadCount < 2) {
+    Crypto::chacha8(cipher.data(), cipher.size(), key, iv, &m_plain[0]);
+    m_readyChunks = m_chunkCount;
+    return;
+  }
+
+  m_workers.reset(new Common::ThreadPool(threadCount, threadCount * CHUNKS_IN_FLIGHT_PER_WORKER));
+  scheduleChunks();
+}
+
+ChachaDecryptingInputStream::~ChachaDecryptingInputStream() {
+  // workers write into m_plain, so let them finish before it goes away
+  for (auto& chunk : m_pending) {
+    chunk.wait();
+  }
+}
+
+size_t ChachaDecryptingInputStream::readSome(void* data, size_t size) {
+  if (m_position >= m_plain.size()) {
+    return 0;
+  }
+
+  size_t chunk = m_position / PARALLEL_CHACHA_CHUNK_SIZE;
+  while (m_readyChunks <= chunk) {
+    std::future<void> next = std::move(m_pending.front());
+    m_pending.pop_front();
+    next.get();
+    ++m_readyChunks;
+    scheduleChunks();
+  }
+
+  size_t readyEnd = std::min(m_readyChunks * PARALLEL_CHACHA_CHUNK_SIZE, m_plain.size());
+  size_t count = std::min(size, readyEnd - m_position);
+  memcpy(data, m_plain.data() + m_position, count);
+  m_position += count;
+  return count;
+}
+
+void ChachaDecryptingInputStream::scheduleChunks() {
+  size_t inFlight = m_workers->workerCount() * CHUNKS_IN_FLIGHT_PER_WORKER;
+  while (m_pending.size() < inFlight && m_readyChunks + m_pending.size() < m_chunkCount) {
+    size_t chunk = m_readyChunks + m_pending.size();
+    const char* cipher = m_cipher.data();
+    size_t size = m_cipher.size();
+    char* plain = &m_plain[0];
+    const Crypto::chacha8_key& key = m_key;
+    const Crypto::chacha8_iv& iv = m_iv;
+    m_pending.push_back(m_workers->submit([cipher, size, chunk, &key, &iv, plain] {
+      chacha8Chunk(cipher, size, chunk, key, iv, plain);
+    }));
+  }
+}
+
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2017-2022 Fuego Developers
+// Copyright (c) 2018-2019 Conceal Network & Conceal Devs
+// Copyright (c) 2016-2019 The Karbowanec developers
+// Copyright (c) 2012-2018 The CryptoNote developers
+//
+// This file is part of Fuego.
+//
+// Fuego is free software distributed in the hope that it
+// will be useful, but WITHOUT ANY WARRANTY; without even the
+// implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+// PURPOSE. You can redistribute it and/or modify it under the terms
+// of the GNU General Public License v3 or later versions as published
+// by the Free Software Foundation. Fuego includes elements written
+// by third parties. See file labeled LICENSE for more details.
+// You should have received a copy of the GNU General Public License
+// along with Fuego. If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+
+#include "Common/IInputStream.h"
+#include "Common/ThreadPool.h"
+#include "crypto/chacha8.h"
+
+namespace CryptoNote {
+
+// chacha8 is a counter mode cipher: a chunk starting at a block boundary only needs its block
+// counter, so large buffers are split across threads and the output matches a single pass
+void parallelChacha8(const void* data, size_t size, const Crypto::chacha8_key& key, const Crypto::chacha8_iv& iv, char* output);
+
+// Decrypts a chacha8 cipher text as it is read. Chunks ahead of the read position are decrypted
+// on worker threads, so parsing the start of the plain text overlaps decrypting the rest and a
+// reader that stops early does not pay for the tail. The cipher text must outlive the stream.
+class ChachaDecryptingInputStream : public Common::IInputStream {
+public:
+  ChachaDecryptingInputStream(const std::string& cipher, const Crypto::chacha8_key& key, const Crypto::chacha8_iv& iv);
+  ~ChachaDecryptingInputStream();
+
+  ChachaDecryptingInputStream(const ChachaDecryptingInputStream&) = delete;
+  ChachaDecryptingInputStream& operator=(const ChachaDecryptingInputStream&) = delete;
+
+  // IInputStream
+  virtual size_t readSome(void* data, size_t size) override;
+
+private:
+  void scheduleChunks();
+
+  const std::string& m_cipher;
+  const Crypto::chacha8_key m_key;
+  const Crypto::chacha8_iv m_iv;
+  std::string m_plain;
+  size_t m_position;
+  size_t m_chunkCount;
+  size_t m_readyChunks;                      // chunks [0, m_readyChunks) are decrypted
+  std::deque<std::future<void>> m_pending;   // the chunks following them, in order
+  std::unique_ptr<Common::ThreadPool> m_workers;  // null when everything was decrypted up front
+};
+
+}
@@ -372,6 +372,13 @@ std::vector<Payments> WalletLegacy::getTransactionsByPaymentIds(const std::vecto
   return m_transactionsCache.getTransactionsByPaymentIds(paymentIds);
 }
 
+std::vector<TransactionId> WalletLegacy::getTransactionsInHeightRange(uint32_t minHeight, uint32_t maxHeight) {
+  std::unique_lock<std::mutex> lock(m_cacheMutex);
+  throwIfNotInitialised();
+
+  return m_transactionsCache.getTransactionsInHeightRange(minHeight, maxHeight);
+}
+
 void WalletLegacy::save(std::ostream& destination, bool saveDetailed, bool saveCache) {
   if(m_isStopping) {
     m_observerManager.notify(&IWalletLegacyObserver::saveCompleted, make_error_code(CryptoNote::error::OPERATION_CANCELLED));
@@ -1390,23 +1397,12 @@ std::string WalletLegacy::getReserveProof(const uint64_t &reserve, const std::st
 	prefix_data.append((const char*)&keys.address, sizeof(CryptoNote::AccountPublicAddress));
 	
 	std::vector<Crypto::KeyImage> kimages;
-	CryptoNote::KeyPair ephemeral;
 
 	for (size_t i = 0; i < selected_transfers.size(); ++i) {
-
-		// have to repeat this to get key image as we don't store m_key_image
-		// prefix_data.append((const char*)&m_transfers[selected_transfers[i]].m_key_image, sizeof(crypto::key_image));
+		// the container keeps the key image it derived when the output was found
 		const TransactionOutputInformation &td = selected_transfers[i];
-
-		// derive ephemeral secret key
-		Crypto::KeyImage ki;
-		const bool r = CryptoNote::generate_key_image_helper(m_account.getAccountKeys(), td.transactionPublicKey, td.outputInTransaction, ephemeral, ki);
-		if (!r) {
-			throw std::runtime_error("Failed to generate key image");
-		}
-		// now we can insert key image
-		prefix_data.append((const char*)&ki, sizeof(Crypto::PublicKey));
-		kimages.push_back(ki);
+		prefix_data.append((const char*)&td.keyImage, sizeof(Crypto::PublicKey));
+		kimages.push_back(td.keyImage);
 	}
 
 	Crypto::Hash prefix_hash;
@@ -1446,7 +1442,7 @@ std::string WalletLegacy::getReserveProof(const uint64_t &reserve, const std::st
 			throw std::runtime_error("Failed to generate key image");
 		}
 
-		if (ephemeral.publicKey != td.outputKey) {
+		if (ephemeral.publicKey != td.outputKey || ki != proof.key_image) {
 			throw std::runtime_error("Derived public key doesn't agree with the stored one");
 		}
 
@@ -91,6 +91,7 @@ public:
   virtual bool getTransfer(TransferId transferId, WalletLegacyTransfer& transfer) override;
   virtual bool getDeposit(DepositId depositId, Deposit& deposit) override;
   virtual std::vector<Payments> getTransactionsByPaymentIds(const std::vector<PaymentId>& paymentIds) const override;
+  virtual std::vector<TransactionId> getTransactionsInHeightRange(uint32_t minHeight, uint32_t maxHeight) override;
 
   virtual TransactionId sendTransaction(Crypto::SecretKey& transactionSK,
                                         const WalletLegacyTransfer& transfer,
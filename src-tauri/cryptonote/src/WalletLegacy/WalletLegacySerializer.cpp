@@ -19,7 +19,6 @@
 
 #include <stdexcept>
 
-#include "Common/MemoryInputStream.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "Serialization/BinaryOutputStreamSerializer.h"
@@ -28,6 +27,7 @@
 #include "CryptoNoteCore/CryptoNoteSerialization.h"
 #include "WalletLegacy/WalletUserTransactionsCache.h"
 #include "Wallet/WalletErrors.h"
+#include "WalletLegacy/ChachaStreams.h"
 #include "WalletLegacy/KeysStorage.h"
 #include "crypto/chacha8.h"
 
@@ -111,7 +111,7 @@ Crypto::chacha8_iv WalletLegacySerializer::encrypt(const std::string& plain, con
   cipher.resize(plain.size());
 
   Crypto::chacha8_iv iv = Crypto::rand<Crypto::chacha8_iv>();
-  Crypto::chacha8(plain.data(), plain.size(), key, iv, &cipher[0]);
+  parallelChacha8(plain.data(), plain.size(), key, iv, &cipher[0]);
 
   return iv;
 }
@@ -134,10 +134,7 @@ void WalletLegacySerializer::deserialize(std::istream& stream, const std::string
 
   serializerEncrypted.endObject();
 
-  std::string plain;
-  decrypt(cipher, plain, iv, password);
-
-  MemoryInputStream decryptedStream(plain.data(), plain.size()); 
+  ChachaDecryptingInputStream decryptedStream(cipher, generateKey(password), iv);
   CryptoNote::BinaryInputStreamSerializer serializer(decryptedStream);
 
   loadKeys(serializer);
@@ -184,10 +181,7 @@ bool WalletLegacySerializer::deserialize(std::istream& stream, const std::string
 
     serializerEncrypted.endObject();
 
-    std::string plain;
-    decrypt(cipher, plain, iv, password);
-
-    MemoryInputStream decryptedStream(plain.data(), plain.size());
+    ChachaDecryptingInputStream decryptedStream(cipher, generateKey(password), iv);
     CryptoNote::BinaryInputStreamSerializer serializer(decryptedStream);
 
     CryptoNote::KeysStorage keys;
@@ -235,14 +229,12 @@ bool WalletLegacySerializer::deserialize(std::istream& stream, const std::string
 
 
 
-void WalletLegacySerializer::decrypt(const std::string& cipher, std::string& plain, Crypto::chacha8_iv iv, const std::string& password) {
+Crypto::chacha8_key WalletLegacySerializer::generateKey(const std::string& password) {
   Crypto::chacha8_key key;
   Crypto::cn_context context;
   Crypto::generate_chacha8_key(context, password, key);
 
-  plain.resize(cipher.size());
-
-  Crypto::chacha8(cipher.data(), cipher.size(), key, iv, &plain[0]);
+  return key;
 }
 
 void WalletLegacySerializer::loadKeys(CryptoNote::ISerializer& serializer) {
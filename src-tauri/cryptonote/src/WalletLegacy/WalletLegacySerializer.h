@@ -46,7 +46,7 @@ private:
   void loadKeys(CryptoNote::ISerializer& serializer);
 
   Crypto::chacha8_iv encrypt(const std::string& plain, const std::string& password, std::string& cipher);
-  void decrypt(const std::string& cipher, std::string& plain, Crypto::chacha8_iv iv, const std::string& password);
+  Crypto::chacha8_key generateKey(const std::string& password);
 
   CryptoNote::AccountBase& account;
   WalletUserTransactionsCache& transactionsCache;
@@ -492,7 +492,7 @@ namespace CryptoNote
     {
       //TODO decompose this method
       WalletLegacyTransaction &transactionInfo = m_transactionsCache.getTransaction(context->transactionId);
-      std::unique_ptr<ITransaction> transaction = createTransaction();
+      PooledTransaction transaction = acquireTransaction();
 
       uint64_t totalAmount = std::abs(transactionInfo.totalAmount);
       std::vector<TransactionTypes::InputKeyInfo> inputs = prepareKeyInputs(context->selectedTransfers, context->outs, context->mixIn);
@@ -509,6 +509,7 @@ namespace CryptoNote
       }
 
       transaction->setUnlockTime(transactionInfo.unlockTime);
+      transaction->appendViewTags();
 
       std::vector<KeyPair> ephKeys;
       ephKeys.reserve(inputs.size());
@@ -577,7 +578,7 @@ namespace CryptoNote
     {
       WalletLegacyTransaction &transactionInfo = m_transactionsCache.getTransaction(context->transactionId);
 
-      std::unique_ptr<ITransaction> transaction = createTransaction();
+      PooledTransaction transaction = acquireTransaction();
       std::vector<MultisignatureInput> inputs = prepareMultisignatureInputs(context->selectedTransfers);
 
       std::vector<uint64_t> outputAmounts = splitAmount(context->foundMoney - transactionInfo.fee, context->dustPolicy.dustThreshold);
@@ -593,6 +594,7 @@ namespace CryptoNote
       }
 
       transaction->setUnlockTime(transactionInfo.unlockTime);
+      transaction->appendViewTags();
 
       assert(inputs.size() == context->selectedTransfers.size());
       for (size_t i = 0; i < inputs.size(); ++i)
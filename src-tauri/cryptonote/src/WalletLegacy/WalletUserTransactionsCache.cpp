@@ -27,6 +27,7 @@
 #include "Serialization/ISerializer.h"
 #include "Serialization/SerializationOverloads.h"
 #include <algorithm>
+#include <limits>
 
 using namespace Crypto;
 
@@ -128,6 +129,7 @@ bool WalletUserTransactionsCache::serialize(CryptoNote::ISerializer& s) {
     updateUnconfirmedTransactions();
     deleteOutdatedTransactions();
     restoreTransactionOutputToDepositIndex();
+    rebuildTransactionIndices();
     rebuildPaymentsIndex();
   }
 
@@ -144,6 +146,7 @@ void WalletUserTransactionsCache::deserializeLegacyV1(CryptoNote::ISerializer& s
 
   convertLegacyDeposits(legacyDeposits, m_deposits);
   restoreTransactionOutputToDepositIndex();
+  rebuildTransactionIndices();
 }
 
 bool paymentIdIsSet(const PaymentId& paymentId) {
@@ -173,6 +176,44 @@ void WalletUserTransactionsCache::popFromPaymentsIndex(const PaymentId& paymentI
   it->second.erase(toErase);
 }
 
+void WalletUserTransactionsCache::rebuildTransactionIndices() {
+  m_transactionsByHash.clear();
+  m_transactionsByFirstTransfer.clear();
+  m_transactionsByHeight.clear();
+  for (TransactionId id = 0; id < m_transactions.size(); ++id) {
+    indexTransaction(id);
+  }
+}
+
+// Adds the transaction's hash, once it has one, its transfer range and its height once confirmed;
+// the first transaction seen with a hash keeps it, as the linear search used to find
+void WalletUserTransactionsCache::indexTransaction(TransactionId id) {
+  const WalletLegacyTransaction& tx = m_transactions[id];
+  if (tx.hash != NULL_HASH) {
+    m_transactionsByHash.emplace(tx.hash, id);
+  }
+
+  if (tx.firstTransferId != WALLET_LEGACY_INVALID_TRANSFER_ID && tx.transferCount != 0) {
+    m_transactionsByFirstTransfer.emplace(tx.firstTransferId, id);
+  }
+
+  if (tx.blockHeight != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+    m_transactionsByHeight.emplace(tx.blockHeight, id);
+  }
+}
+
+void WalletUserTransactionsCache::setTransactionHeight(TransactionId id, uint32_t height) {
+  WalletLegacyTransaction& tx = m_transactions[id];
+  if (tx.blockHeight != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+    m_transactionsByHeight.erase(std::make_pair(tx.blockHeight, id));
+  }
+
+  tx.blockHeight = height;
+  if (height != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+    m_transactionsByHeight.emplace(height, id);
+  }
+}
+
 void WalletUserTransactionsCache::rebuildPaymentsIndex() {
   auto begin = std::begin(m_transactions);
   auto end = std::end(m_transactions);
@@ -259,6 +300,8 @@ void WalletUserTransactionsCache::updateTransaction(
   auto& txInfo = m_transactions.at(transactionId);
   txInfo.extra.assign(tx.extra.begin(), tx.extra.end());
   m_unconfirmedTransactions.add(tx, transactionId, amount, usedOutputs);
+  // the sender has just set the hash of the built transaction
+  indexTransaction(transactionId);
 }
 
 void WalletUserTransactionsCache::updateTransactionSendingState(TransactionId transactionId, std::error_code ec) {
@@ -329,8 +372,8 @@ std::deque<std::unique_ptr<WalletLegacyEvent>> WalletUserTransactionsCache::onTr
       events.push_back(std::unique_ptr<WalletLegacyEvent>(new WalletDepositsUpdatedEvent(std::move(updatedDepositIds))));
     }
   } else {
+    setTransactionHeight(id, txInfo.blockHeight);
     WalletLegacyTransaction& tr = getTransaction(id);
-    tr.blockHeight = txInfo.blockHeight;
     tr.timestamp = txInfo.timestamp;
     tr.state = WalletLegacyTransactionState::Active;
     // notification event
@@ -369,7 +412,7 @@ std::deque<std::unique_ptr<WalletLegacyEvent>> WalletUserTransactionsCache::onTr
       popFromPaymentsIndex(paymentId, id);
     }
 
-    tr.blockHeight = WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT;
+    setTransactionHeight(id, WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT);
     tr.timestamp = 0;
     tr.state = WalletLegacyTransactionState::Deleted;
 
@@ -417,6 +460,26 @@ std::vector<Payments> WalletUserTransactionsCache::getTransactionsByPaymentIds(c
   return payments;
 }
 
+// active transactions confirmed at minHeight..maxHeight, by id
+std::vector<TransactionId> WalletUserTransactionsCache::getTransactionsInHeightRange(uint32_t minHeight, uint32_t maxHeight) const {
+  std::vector<TransactionId> ids;
+  if (minHeight > maxHeight) {
+    return ids;
+  }
+
+  auto end = m_transactionsByHeight.upper_bound(std::make_pair(maxHeight, std::numeric_limits<TransactionId>::max()));
+  for (auto it = m_transactionsByHeight.lower_bound(std::make_pair(minHeight, TransactionId(0))); it != end; ++it) {
+    const WalletLegacyTransaction& tx = m_transactions[it->second];
+    // a height rewritten through getTransaction() leaves a stale entry behind
+    if (tx.blockHeight == it->first && tx.state == WalletLegacyTransactionState::Active) {
+      ids.push_back(it->second);
+    }
+  }
+
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
 std::vector<DepositId> WalletUserTransactionsCache::unlockDeposits(const std::vector<TransactionOutputInformation>& transfers) {
   std::vector<DepositId> unlockedDeposits;
 
@@ -454,21 +517,16 @@ std::vector<DepositId> WalletUserTransactionsCache::lockDeposits(const std::vect
 
 TransactionId WalletUserTransactionsCache::findTransactionByTransferId(TransferId transferId) const
 {
-  TransactionId id;
-  for (id = 0; id < m_transactions.size(); ++id) {
-    const WalletLegacyTransaction& tx = m_transactions[id];
-
-    if (tx.firstTransferId == WALLET_LEGACY_INVALID_TRANSFER_ID || tx.transferCount == 0)
-      continue;
-
-    if (transferId >= tx.firstTransferId && transferId < (tx.firstTransferId + tx.transferCount))
-      break;
-  }
+  auto it = m_transactionsByFirstTransfer.upper_bound(transferId);
+  if (it == m_transactionsByFirstTransfer.begin())
+    return WALLET_LEGACY_INVALID_TRANSACTION_ID;
 
-  if (id == m_transactions.size())
+  --it;
+  const WalletLegacyTransaction& tx = m_transactions[it->second];
+  if (transferId >= tx.firstTransferId + tx.transferCount)
     return WALLET_LEGACY_INVALID_TRANSACTION_ID;
 
-  return id;
+  return it->second;
 }
 
 bool WalletUserTransactionsCache::getTransaction(TransactionId transactionId, WalletLegacyTransaction& transaction) const
@@ -508,16 +566,28 @@ Deposit& WalletUserTransactionsCache::getDeposit(DepositId depositId) {
 
 TransactionId WalletUserTransactionsCache::insertTransaction(WalletLegacyTransaction&& Transaction) {
   m_transactions.emplace_back(std::move(Transaction));
-  return m_transactions.size() - 1;
+  TransactionId id = m_transactions.size() - 1;
+  indexTransaction(id);
+  return id;
 }
 
 TransactionId WalletUserTransactionsCache::findTransactionByHash(const Hash& hash) {
-  auto it = std::find_if(m_transactions.begin(), m_transactions.end(), [&hash](const WalletLegacyTransaction& tx) { return tx.hash == hash; });
+  auto it = m_transactionsByHash.find(hash);
+  if (it == m_transactionsByHash.end())
+    return CryptoNote::WALLET_LEGACY_INVALID_TRANSACTION_ID;
+
+  if (m_transactions[it->second].hash == hash)
+    return it->second;
 
-  if (it == m_transactions.end())
+  // the hash was rewritten through getTransaction() after it was indexed
+  auto found = std::find_if(m_transactions.begin(), m_transactions.end(), [&hash](const WalletLegacyTransaction& tx) { return tx.hash == hash; });
+  if (found == m_transactions.end()) {
+    m_transactionsByHash.erase(it);
     return CryptoNote::WALLET_LEGACY_INVALID_TRANSACTION_ID;
+  }
 
-  return std::distance(m_transactions.begin(), it);
+  it->second = std::distance(m_transactions.begin(), found);
+  return it->second;
 }
 
 bool WalletUserTransactionsCache::isUsed(const TransactionOutputInformation& out) const {
@@ -548,6 +618,9 @@ WalletLegacyTransfer& WalletUserTransactionsCache::getTransfer(TransferId transf
 void WalletUserTransactionsCache::reset() {
   m_transactions.clear();
   m_transfers.clear();
+  m_transactionsByHash.clear();
+  m_transactionsByFirstTransfer.clear();
+  m_transactionsByHeight.clear();
   m_unconfirmedTransactions.reset();
 }
 
@@ -674,6 +747,7 @@ void WalletUserTransactionsCache::addCreatedDeposit(DepositId id, uint64_t total
 
 void WalletUserTransactionsCache::addDepositSpendingTransaction(const Hash& transactionHash, const UnconfirmedSpentDepositDetails& details) {
   m_unconfirmedTransactions.addDepositSpendingTransaction(transactionHash, details);
+  indexTransaction(details.transactionId);
 }
 
 void WalletUserTransactionsCache::eraseCreatedDeposit(DepositId id) {
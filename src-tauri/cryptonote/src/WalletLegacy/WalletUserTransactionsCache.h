@@ -18,6 +18,9 @@
 #pragma once
 
 #include <deque>
+#include <map>
+#include <set>
+#include <unordered_map>
 
 #include <boost/functional/hash.hpp>
 
@@ -111,6 +114,7 @@ public:
   bool getDepositInTransactionInfo(DepositId depositId, Crypto::Hash& transactionHash, uint32_t& outputInTransaction);
 
   std::vector<Payments> getTransactionsByPaymentIds(const std::vector<PaymentId>& paymentIds) const;
+  std::vector<TransactionId> getTransactionsInHeightRange(uint32_t minHeight, uint32_t maxHeight) const;
   TransactionId findTransactionByHash(const Crypto::Hash& hash);
 private:
 
@@ -140,6 +144,10 @@ private:
   using Offset = UserTransactions::size_type;
   using UserPaymentIndex = std::unordered_map<PaymentId, std::vector<Offset>, boost::hash<PaymentId>>;
 
+  void rebuildTransactionIndices();
+  void indexTransaction(TransactionId id);
+  void setTransactionHeight(TransactionId id, uint32_t height);
+
   void rebuildPaymentsIndex();
   void pushToPaymentsIndex(const PaymentId& paymentId, Offset distance);
   void pushToPaymentsIndexInternal(Offset distance, const WalletLegacyTransaction& info, std::vector<uint8_t>& extra);
@@ -152,6 +160,12 @@ private:
   //tuple<Creating transaction hash, outputIndexInTransaction> -> depositId
   std::unordered_map<std::tuple<Crypto::Hash, uint32_t>, DepositId> m_transactionOutputToDepositIndex;
   UserPaymentIndex m_paymentsIndex;
+  // hashes are only known once a transaction has been built, see indexTransaction
+  std::unordered_map<Crypto::Hash, TransactionId, boost::hash<Crypto::Hash>> m_transactionsByHash;
+  // firstTransferId -> transaction; the transfers of a transaction are one contiguous range
+  std::map<TransferId, TransactionId> m_transactionsByFirstTransfer;
+  // confirmed transactions by block height; like the hash index, entries are checked on lookup
+  std::set<std::pair<uint32_t, TransactionId>> m_transactionsByHeight;
 };
 
 } //namespace CryptoNote
@@ -41,7 +41,34 @@ Public domain.
 
 static const char sigma[] = "expand 32-byte k";
 
-void chacha8(const void *data, size_t length, const uint8_t *key, const uint8_t *iv, char *cipher)
+static void chacha8_init(uint32_t state[16], const uint8_t *key, const uint8_t *iv, uint64_t counter)
+{
+  state[0] = U8TO32_LITTLE(sigma + 0);
+  state[1] = U8TO32_LITTLE(sigma + 4);
+  state[2] = U8TO32_LITTLE(sigma + 8);
+  state[3] = U8TO32_LITTLE(sigma + 12);
+  state[4] = U8TO32_LITTLE(key + 0);
+  state[5] = U8TO32_LITTLE(key + 4);
+  state[6] = U8TO32_LITTLE(key + 8);
+  state[7] = U8TO32_LITTLE(key + 12);
+  state[8] = U8TO32_LITTLE(key + 16);
+  state[9] = U8TO32_LITTLE(key + 20);
+  state[10] = U8TO32_LITTLE(key + 24);
+  state[11] = U8TO32_LITTLE(key + 28);
+  state[12] = (uint32_t)counter;
+  state[13] = (uint32_t)(counter >> 32);
+  state[14] = U8TO32_LITTLE(iv + 0);
+  state[15] = U8TO32_LITTLE(iv + 4);
+}
+
+static void chacha8_advance(uint32_t state[16], uint32_t blocks)
+{
+  uint64_t counter = ((uint64_t)state[13] << 32 | state[12]) + blocks;
+  state[12] = (uint32_t)counter;
+  state[13] = (uint32_t)(counter >> 32);
+}
+
+static void chacha8_scalar(const void *data, size_t length, const uint32_t state[16], char *cipher)
 {
   uint32_t x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15;
   uint32_t j0, j1, j2, j3, j4, j5, j6, j7, j8, j9, j10, j11, j12, j13, j14, j15;
@@ -49,25 +76,22 @@ void chacha8(const void *data, size_t length, const uint8_t *key, const uint8_t
   char tmp[64];
   int i;
 
-  if (!length)
-    return;
-
-  j0 = U8TO32_LITTLE(sigma + 0);
-  j1 = U8TO32_LITTLE(sigma + 4);
-  j2 = U8TO32_LITTLE(sigma + 8);
-  j3 = U8TO32_LITTLE(sigma + 12);
-  j4 = U8TO32_LITTLE(key + 0);
-  j5 = U8TO32_LITTLE(key + 4);
-  j6 = U8TO32_LITTLE(key + 8);
-  j7 = U8TO32_LITTLE(key + 12);
-  j8 = U8TO32_LITTLE(key + 16);
-  j9 = U8TO32_LITTLE(key + 20);
-  j10 = U8TO32_LITTLE(key + 24);
-  j11 = U8TO32_LITTLE(key + 28);
-  j12 = 0;
-  j13 = 0;
-  j14 = U8TO32_LITTLE(iv + 0);
-  j15 = U8TO32_LITTLE(iv + 4);
+  j0 = state[0];
+  j1 = state[1];
+  j2 = state[2];
+  j3 = state[3];
+  j4 = state[4];
+  j5 = state[5];
+  j6 = state[6];
+  j7 = state[7];
+  j8 = state[8];
+  j9 = state[9];
+  j10 = state[10];
+  j11 = state[11];
+  j12 = state[12];
+  j13 = state[13];
+  j14 = state[14];
+  j15 = state[15];
 
   for (;;)
   {
@@ -176,3 +200,353 @@ void chacha8(const void *data, size_t length, const uint8_t *key, const uint8_t
     data = (uint8_t *)data + 64;
   }
 }
+
+/*
+ * Vectorized paths evaluate 4 (SSE2, NEON) or 8 (AVX2) consecutive blocks at once, one block
+ * per lane, and leave the remaining tail to chacha8_scalar. They produce the same key stream
+ * as the scalar code and, like it, read each 16-byte piece of input before writing the same
+ * piece of output, so data and cipher may be the same buffer.
+ */
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(NO_CHACHA8_SIMD)
+#define CHACHA8_X86 1
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CHACHA8_TARGET_AVX2
+#else
+#define CHACHA8_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#define ROTATE_SSE2(v, c) _mm_or_si128(_mm_slli_epi32((v), (c)), _mm_srli_epi32((v), 32 - (c)))
+#define ROTATE16_SSE2(v) _mm_shufflehi_epi16(_mm_shufflelo_epi16((v), 0xb1), 0xb1)
+
+#define QUARTERROUND_SSE2(a, b, c, d)                     \
+  a = _mm_add_epi32(a, b);                               \
+  d = ROTATE16_SSE2(_mm_xor_si128(d, a));                \
+  c = _mm_add_epi32(c, d);                               \
+  b = ROTATE_SSE2(_mm_xor_si128(b, c), 12);              \
+  a = _mm_add_epi32(a, b);                               \
+  d = ROTATE_SSE2(_mm_xor_si128(d, a), 8);               \
+  c = _mm_add_epi32(c, d);                               \
+  b = ROTATE_SSE2(_mm_xor_si128(b, c), 7);
+
+/* transposes words w..w+3 of four blocks and xors them into the output */
+#define OUTPUT_SSE2(w)                                                                              \
+  {                                                                                                 \
+    __m128i t0 = _mm_unpacklo_epi32(x[w + 0], x[w + 1]);                                            \
+    __m128i t1 = _mm_unpacklo_epi32(x[w + 2], x[w + 3]);                                            \
+    __m128i t2 = _mm_unpackhi_epi32(x[w + 0], x[w + 1]);                                            \
+    __m128i t3 = _mm_unpackhi_epi32(x[w + 2], x[w + 3]);                                            \
+    __m128i b[4];                                                                                    \
+    b[0] = _mm_unpacklo_epi64(t0, t1);                                                               \
+    b[1] = _mm_unpackhi_epi64(t0, t1);                                                               \
+    b[2] = _mm_unpacklo_epi64(t2, t3);                                                               \
+    b[3] = _mm_unpackhi_epi64(t2, t3);                                                               \
+    for (i = 0; i < 4; ++i)                                                                          \
+    {                                                                                                \
+      const __m128i *src = (const __m128i *)(in + 64 * i + 4 * (w));                                \
+      _mm_storeu_si128((__m128i *)(out + 64 * i + 4 * (w)), _mm_xor_si128(_mm_loadu_si128(src), b[i])); \
+    }                                                                                                \
+  }
+
+static size_t chacha8_sse2(const uint8_t *in, size_t length, uint32_t state[16], uint8_t *out)
+{
+  size_t done = 0;
+  int i;
+
+  for (; length - done >= 256; done += 256, in += 256, out += 256)
+  {
+    __m128i j[16], x[16];
+    for (i = 0; i < 16; ++i)
+    {
+      j[i] = _mm_set1_epi32((int)state[i]);
+    }
+
+    /* lane k encrypts block counter + k */
+    {
+      uint32_t c0 = state[12];
+      j[12] = _mm_set_epi32((int)(c0 + 3), (int)(c0 + 2), (int)(c0 + 1), (int)c0);
+      j[13] = _mm_set_epi32((int)(state[13] + (c0 + 3 < c0)), (int)(state[13] + (c0 + 2 < c0)),
+                            (int)(state[13] + (c0 + 1 < c0)), (int)state[13]);
+    }
+
+    for (i = 0; i < 16; ++i)
+    {
+      x[i] = j[i];
+    }
+
+    for (i = 8; i > 0; i -= 2)
+    {
+      QUARTERROUND_SSE2(x[0], x[4], x[8], x[12])
+      QUARTERROUND_SSE2(x[1], x[5], x[9], x[13])
+      QUARTERROUND_SSE2(x[2], x[6], x[10], x[14])
+      QUARTERROUND_SSE2(x[3], x[7], x[11], x[15])
+      QUARTERROUND_SSE2(x[0], x[5], x[10], x[15])
+      QUARTERROUND_SSE2(x[1], x[6], x[11], x[12])
+      QUARTERROUND_SSE2(x[2], x[7], x[8], x[13])
+      QUARTERROUND_SSE2(x[3], x[4], x[9], x[14])
+    }
+
+    for (i = 0; i < 16; ++i)
+    {
+      x[i] = _mm_add_epi32(x[i], j[i]);
+    }
+
+    OUTPUT_SSE2(0)
+    OUTPUT_SSE2(4)
+    OUTPUT_SSE2(8)
+    OUTPUT_SSE2(12)
+
+    chacha8_advance(state, 4);
+  }
+
+  return done;
+}
+
+#define ROTATE_AVX2(v, c) _mm256_or_si256(_mm256_slli_epi32((v), (c)), _mm256_srli_epi32((v), 32 - (c)))
+
+#define QUARTERROUND_AVX2(a, b, c, d)                     \
+  a = _mm256_add_epi32(a, b);                            \
+  d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16); \
+  c = _mm256_add_epi32(c, d);                            \
+  b = ROTATE_AVX2(_mm256_xor_si256(b, c), 12);           \
+  a = _mm256_add_epi32(a, b);                            \
+  d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot8); \
+  c = _mm256_add_epi32(c, d);                            \
+  b = ROTATE_AVX2(_mm256_xor_si256(b, c), 7);
+
+/* same transpose per 128-bit lane: the low lane holds blocks 0-3, the high lane blocks 4-7 */
+#define OUTPUT_AVX2(w)                                                                              \
+  {                                                                                                 \
+    __m256i t0 = _mm256_unpacklo_epi32(x[w + 0], x[w + 1]);                                         \
+    __m256i t1 = _mm256_unpacklo_epi32(x[w + 2], x[w + 3]);                                         \
+    __m256i t2 = _mm256_unpackhi_epi32(x[w + 0], x[w + 1]);                                         \
+    __m256i t3 = _mm256_unpackhi_epi32(x[w + 2], x[w + 3]);                                         \
+    __m256i b[4];                                                                                    \
+    b[0] = _mm256_unpacklo_epi64(t0, t1);                                                            \
+    b[1] = _mm256_unpackhi_epi64(t0, t1);                                                            \
+    b[2] = _mm256_unpacklo_epi64(t2, t3);                                                            \
+    b[3] = _mm256_unpackhi_epi64(t2, t3);                                                            \
+    for (i = 0; i < 4; ++i)                                                                          \
+    {                                                                                                \
+      __m128i *low = (__m128i *)(out + 64 * i + 4 * (w));                                           \
+      __m128i *high = (__m128i *)(out + 64 * (i + 4) + 4 * (w));                                    \
+      __m128i inLow = _mm_loadu_si128((const __m128i *)(in + 64 * i + 4 * (w)));                    \
+      __m128i inHigh = _mm_loadu_si128((const __m128i *)(in + 64 * (i + 4) + 4 * (w)));             \
+      _mm_storeu_si128(low, _mm_xor_si128(inLow, _mm256_castsi256_si128(b[i])));                    \
+      _mm_storeu_si128(high, _mm_xor_si128(inHigh, _mm256_extracti128_si256(b[i], 1)));             \
+    }                                                                                                \
+  }
+
+CHACHA8_TARGET_AVX2 static size_t chacha8_avx2(const uint8_t *in, size_t length, uint32_t state[16], uint8_t *out)
+{
+  const __m256i rot16 = _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+                                        13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2);
+  const __m256i rot8 = _mm256_set_epi8(14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3,
+                                       14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3);
+  size_t done = 0;
+  int i;
+
+  for (; length - done >= 512; done += 512, in += 512, out += 512)
+  {
+    __m256i j[16], x[16];
+    uint32_t low[8], high[8];
+    for (i = 0; i < 16; ++i)
+    {
+      j[i] = _mm256_set1_epi32((int)state[i]);
+    }
+
+    for (i = 0; i < 8; ++i)
+    {
+      low[i] = state[12] + (uint32_t)i;
+      high[i] = state[13] + (low[i] < state[12]);
+    }
+
+    j[12] = _mm256_loadu_si256((const __m256i *)low);
+    j[13] = _mm256_loadu_si256((const __m256i *)high);
+
+    for (i = 0; i < 16; ++i)
+    {
+      x[i] = j[i];
+    }
+
+    for (i = 8; i > 0; i -= 2)
+    {
+      QUARTERROUND_AVX2(x[0], x[4], x[8], x[12])
+      QUARTERROUND_AVX2(x[1], x[5], x[9], x[13])
+      QUARTERROUND_AVX2(x[2], x[6], x[10], x[14])
+      QUARTERROUND_AVX2(x[3], x[7], x[11], x[15])
+      QUARTERROUND_AVX2(x[0], x[5], x[10], x[15])
+      QUARTERROUND_AVX2(x[1], x[6], x[11], x[12])
+      QUARTERROUND_AVX2(x[2], x[7], x[8], x[13])
+      QUARTERROUND_AVX2(x[3], x[4], x[9], x[14])
+    }
+
+    for (i = 0; i < 16; ++i)
+    {
+      x[i] = _mm256_add_epi32(x[i], j[i]);
+    }
+
+    OUTPUT_AVX2(0)
+    OUTPUT_AVX2(4)
+    OUTPUT_AVX2(8)
+    OUTPUT_AVX2(12)
+
+    chacha8_advance(state, 8);
+  }
+
+  return done;
+}
+
+static int chacha8_has_avx2(void)
+{
+  static int supported = -1;
+
+  if (supported >= 0)
+    return supported;
+
+#if defined(_MSC_VER)
+  {
+    int info[4];
+    __cpuidex(info, 0, 0);
+    if (info[0] < 7)
+      return supported = 0;
+
+    /* the OS must save the ymm registers as well */
+    __cpuidex(info, 1, 0);
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6)
+      return supported = 0;
+
+    __cpuidex(info, 7, 0);
+    return supported = (info[1] & (1 << 5)) != 0;
+  }
+#else
+  __builtin_cpu_init();
+  return supported = __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#elif defined(__ARM_NEON) && (!defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) && !defined(NO_CHACHA8_SIMD)
+#define CHACHA8_NEON 1
+
+#include <arm_neon.h>
+
+#define ROTATE_NEON(v, c) vorrq_u32(vshlq_n_u32((v), (c)), vshrq_n_u32((v), 32 - (c)))
+#define ROTATE16_NEON(v) vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(v)))
+
+#define QUARTERROUND_NEON(a, b, c, d)        \
+  a = vaddq_u32(a, b);                      \
+  d = ROTATE16_NEON(veorq_u32(d, a));       \
+  c = vaddq_u32(c, d);                      \
+  b = ROTATE_NEON(veorq_u32(b, c), 12);     \
+  a = vaddq_u32(a, b);                      \
+  d = ROTATE_NEON(veorq_u32(d, a), 8);      \
+  c = vaddq_u32(c, d);                      \
+  b = ROTATE_NEON(veorq_u32(b, c), 7);
+
+#define OUTPUT_NEON(w)                                                                     \
+  {                                                                                        \
+    uint32x4x2_t t0 = vzipq_u32(x[w + 0], x[w + 1]);                                       \
+    uint32x4x2_t t1 = vzipq_u32(x[w + 2], x[w + 3]);                                       \
+    uint32x4_t b[4];                                                                        \
+    b[0] = vcombine_u32(vget_low_u32(t0.val[0]), vget_low_u32(t1.val[0]));                  \
+    b[1] = vcombine_u32(vget_high_u32(t0.val[0]), vget_high_u32(t1.val[0]));                \
+    b[2] = vcombine_u32(vget_low_u32(t0.val[1]), vget_low_u32(t1.val[1]));                  \
+    b[3] = vcombine_u32(vget_high_u32(t0.val[1]), vget_high_u32(t1.val[1]));                \
+    for (i = 0; i < 4; ++i)                                                                 \
+    {                                                                                       \
+      uint8x16_t src = vld1q_u8(in + 64 * i + 4 * (w));                                     \
+      vst1q_u8(out + 64 * i + 4 * (w), veorq_u8(src, vreinterpretq_u8_u32(b[i])));          \
+    }                                                                                       \
+  }
+
+static size_t chacha8_neon(const uint8_t *in, size_t length, uint32_t state[16], uint8_t *out)
+{
+  size_t done = 0;
+  int i;
+
+  for (; length - done >= 256; done += 256, in += 256, out += 256)
+  {
+    uint32x4_t j[16], x[16];
+    uint32_t low[4], high[4];
+    for (i = 0; i < 16; ++i)
+    {
+      j[i] = vdupq_n_u32(state[i]);
+    }
+
+    for (i = 0; i < 4; ++i)
+    {
+      low[i] = state[12] + (uint32_t)i;
+      high[i] = state[13] + (low[i] < state[12]);
+    }
+
+    j[12] = vld1q_u32(low);
+    j[13] = vld1q_u32(high);
+
+    for (i = 0; i < 16; ++i)
+    {
+      x[i] = j[i];
+    }
+
+    for (i = 8; i > 0; i -= 2)
+    {
+      QUARTERROUND_NEON(x[0], x[4], x[8], x[12])
+      QUARTERROUND_NEON(x[1], x[5], x[9], x[13])
+      QUARTERROUND_NEON(x[2], x[6], x[10], x[14])
+      QUARTERROUND_NEON(x[3], x[7], x[11], x[15])
+      QUARTERROUND_NEON(x[0], x[5], x[10], x[15])
+      QUARTERROUND_NEON(x[1], x[6], x[11], x[12])
+      QUARTERROUND_NEON(x[2], x[7], x[8], x[13])
+      QUARTERROUND_NEON(x[3], x[4], x[9], x[14])
+    }
+
+    for (i = 0; i < 16; ++i)
+    {
+      x[i] = vaddq_u32(x[i], j[i]);
+    }
+
+    OUTPUT_NEON(0)
+    OUTPUT_NEON(4)
+    OUTPUT_NEON(8)
+    OUTPUT_NEON(12)
+
+    chacha8_advance(state, 4);
+  }
+
+  return done;
+}
+#endif
+
+void chacha8_counter(const void *data, size_t length, const uint8_t *key, const uint8_t *iv, uint64_t counter, char *cipher)
+{
+  uint32_t state[16];
+  size_t done = 0;
+
+  if (!length)
+    return;
+
+  chacha8_init(state, key, iv, counter);
+
+#if defined(CHACHA8_X86)
+  if (length >= 512 && chacha8_has_avx2())
+  {
+    done = chacha8_avx2((const uint8_t *)data, length, state, (uint8_t *)cipher);
+  }
+
+  done += chacha8_sse2((const uint8_t *)data + done, length - done, state, (uint8_t *)cipher + done);
+#elif defined(CHACHA8_NEON)
+  done = chacha8_neon((const uint8_t *)data, length, state, (uint8_t *)cipher);
+#endif
+
+  if (done < length)
+  {
+    chacha8_scalar((const uint8_t *)data + done, length - done, state, cipher + done);
+  }
+}
+
+void chacha8(const void *data, size_t length, const uint8_t *key, const uint8_t *iv, char *cipher)
+{
+  chacha8_counter(data, length, key, iv, 0, cipher);
+}
@@ -19,6 +19,8 @@ namespace Crypto
   {
 #endif
     void chacha8(const void *data, size_t length, const uint8_t *key, const uint8_t *iv, char *cipher);
+    // same key stream started at block counter (64 bytes per block), so a buffer can be split at block boundaries
+    void chacha8_counter(const void *data, size_t length, const uint8_t *key, const uint8_t *iv, uint64_t counter, char *cipher);
 #if defined(__cplusplus)
   }
 
@@ -47,6 +49,11 @@ namespace Crypto
     chacha8(data, length, reinterpret_cast<const uint8_t *>(&key), reinterpret_cast<const uint8_t *>(&iv), cipher);
   }
 
+  inline void chacha8(const void *data, size_t length, const chacha8_key &key, const chacha8_iv &iv, uint64_t counter, char *cipher)
+  {
+    chacha8_counter(data, length, reinterpret_cast<const uint8_t *>(&key), reinterpret_cast<const uint8_t *>(&iv), counter, cipher);
+  }
+
    inline void generate_chacha8_key(Crypto::cn_context &context, const std::string& password, chacha8_key& key, int cn_variant = 0) { 
     static_assert(sizeof(chacha8_key) <= sizeof(Hash), "Size of hash must be at least that of chacha8_key");
     Hash pwd_hash;
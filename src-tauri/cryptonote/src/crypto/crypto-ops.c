@@ -19,6 +19,10 @@ static void ge_msub(ge_p1p1 *, const ge_p3 *, const ge_precomp *);
 static void ge_p2_0(ge_p2 *);
 static void ge_p3_dbl(ge_p1p1 *, const ge_p3 *);
 static void fe_divpowm1(fe, const fe, const fe);
+static void ge_scalarmult_base_ref10(ge_p3 *, const unsigned char *);
+#if defined(__SIZEOF_INT128__)
+static int ge_scalarmult_base_fe51(ge_p3 *, const unsigned char *);
+#endif
 
 /* Common functions */
 
@@ -1517,6 +1521,15 @@ Preconditions:
 */
 
 void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
+#if defined(__SIZEOF_INT128__)
+  if (ge_scalarmult_base_fe51(h, a)) {
+    return;
+  }
+#endif
+  ge_scalarmult_base_ref10(h, a);
+}
+
+static void ge_scalarmult_base_ref10(ge_p3 *h, const unsigned char *a) {
   signed char e[64];
   signed char carry;
   ge_p1p1 r;
@@ -1593,6 +1606,41 @@ void ge_tobytes(unsigned char *s, const ge_p2 *h) {
   s[31] ^= fe_isnegative(x) << 7;
 }
 
+/* Encodes count points into s[32 * i], sharing a single field inversion
+   between all of them (Montgomery's trick). scratch must hold count elements. */
+
+void ge_tobytes_batch(unsigned char *s, const ge_p2 *h, fe *scratch, size_t count) {
+  fe inv;
+  fe recip;
+  fe x;
+  fe y;
+  size_t i;
+
+  if (count == 0) {
+    return;
+  }
+
+  fe_copy(scratch[0], h[0].Z);
+  for (i = 1; i < count; i++) {
+    fe_mul(scratch[i], scratch[i - 1], h[i].Z);
+  }
+
+  fe_invert(inv, scratch[count - 1]);
+  for (i = count - 1; i > 0; i--) {
+    fe_mul(recip, inv, scratch[i - 1]);
+    fe_mul(inv, inv, h[i].Z);
+    fe_mul(x, h[i].X, recip);
+    fe_mul(y, h[i].Y, recip);
+    fe_tobytes(s + 32 * i, y);
+    s[32 * i + 31] ^= fe_isnegative(x) << 7;
+  }
+
+  fe_mul(x, h[0].X, inv);
+  fe_mul(y, h[0].Y, inv);
+  fe_tobytes(s, y);
+  s[31] ^= fe_isnegative(x) << 7;
+}
+
 /* From sc_reduce.c */
 
 /*
@@ -1900,6 +1948,7 @@ static void fe_divpowm1(fe r, const fe u, const fe v) {
   fe_mul(r, t0, u); /* u^(m+1)v^(-(m+1)) */
 }
 
+#if !defined(__SIZEOF_INT128__)
 static void ge_cached_0(ge_cached *r) {
   fe_1(r->YplusX);
   fe_1(r->YminusX);
@@ -1913,14 +1962,516 @@ static void ge_cached_cmov(ge_cached *t, const ge_cached *u, unsigned char b) {
   fe_cmov(t->Z, u->Z, b);
   fe_cmov(t->T2d, u->T2d, b);
 }
+#endif
+
+#if defined(__SIZEOF_INT128__)
+
+/* Variable-base scalar multiplication on 64-bit targets, using radix 2^51
+   limbs and 128-bit products: a field multiplication takes 25 64x64 products
+   instead of ref10's 100 32x32 ones. Points are converted from/to the ref10
+   representation at the boundaries, so callers are unaffected. */
+
+typedef uint64_t fe51[5];
+
+typedef struct {
+  fe51 X;
+  fe51 Y;
+  fe51 Z;
+} ge51_p2;
+
+typedef struct {
+  fe51 X;
+  fe51 Y;
+  fe51 Z;
+  fe51 T;
+} ge51_p3;
+
+typedef struct {
+  fe51 X;
+  fe51 Y;
+  fe51 Z;
+  fe51 T;
+} ge51_p1p1;
+
+typedef struct {
+  fe51 YplusX;
+  fe51 YminusX;
+  fe51 Z;
+  fe51 T2d;
+} ge51_cached;
+
+typedef unsigned __int128 uint128_t;
+
+#define FE51_MASK ((uint64_t) 0x7ffffffffffff)
+
+static uint64_t load_8(const unsigned char *in) {
+  uint64_t result = 0;
+  int i;
+  for (i = 7; i >= 0; i--) {
+    result = (result << 8) | in[i];
+  }
+  return result;
+}
+
+static void fe51_0(fe51 h) {
+  h[0] = h[1] = h[2] = h[3] = h[4] = 0;
+}
+
+static void fe51_1(fe51 h) {
+  h[0] = 1;
+  h[1] = h[2] = h[3] = h[4] = 0;
+}
+
+static void fe51_copy(fe51 h, const fe51 f) {
+  h[0] = f[0];
+  h[1] = f[1];
+  h[2] = f[2];
+  h[3] = f[3];
+  h[4] = f[4];
+}
+
+/* Leaves every limb below 2^51, except h[0] which may exceed it by a few bits */
+
+static void fe51_carry(fe51 h) {
+  uint64_t c;
+  c = h[0] >> 51; h[0] &= FE51_MASK; h[1] += c;
+  c = h[1] >> 51; h[1] &= FE51_MASK; h[2] += c;
+  c = h[2] >> 51; h[2] &= FE51_MASK; h[3] += c;
+  c = h[3] >> 51; h[3] &= FE51_MASK; h[4] += c;
+  c = h[4] >> 51; h[4] &= FE51_MASK; h[0] += c * 19;
+}
+
+static void fe51_add(fe51 h, const fe51 f, const fe51 g) {
+  h[0] = f[0] + g[0];
+  h[1] = f[1] + g[1];
+  h[2] = f[2] + g[2];
+  h[3] = f[3] + g[3];
+  h[4] = f[4] + g[4];
+  fe51_carry(h);
+}
+
+/* Adds 2p before subtracting, so g must be carried */
+
+static void fe51_sub(fe51 h, const fe51 f, const fe51 g) {
+  h[0] = (f[0] + 0xfffffffffffda) - g[0];
+  h[1] = (f[1] + 0xffffffffffffe) - g[1];
+  h[2] = (f[2] + 0xffffffffffffe) - g[2];
+  h[3] = (f[3] + 0xffffffffffffe) - g[3];
+  h[4] = (f[4] + 0xffffffffffffe) - g[4];
+  fe51_carry(h);
+}
+
+static void fe51_neg(fe51 h, const fe51 f) {
+  fe51 zero;
+  fe51_0(zero);
+  fe51_sub(h, zero, f);
+}
+
+static void fe51_cmov(fe51 f, const fe51 g, unsigned int b) {
+  uint64_t mask = (uint64_t) 0 - b;
+  f[0] ^= mask & (f[0] ^ g[0]);
+  f[1] ^= mask & (f[1] ^ g[1]);
+  f[2] ^= mask & (f[2] ^ g[2]);
+  f[3] ^= mask & (f[3] ^ g[3]);
+  f[4] ^= mask & (f[4] ^ g[4]);
+}
+
+static void fe51_reduce_wide(fe51 h, uint128_t r0, uint128_t r1, uint128_t r2, uint128_t r3, uint128_t r4) {
+  uint64_t c;
+  c = (uint64_t) (r0 >> 51); h[0] = (uint64_t) r0 & FE51_MASK; r1 += c;
+  c = (uint64_t) (r1 >> 51); h[1] = (uint64_t) r1 & FE51_MASK; r2 += c;
+  c = (uint64_t) (r2 >> 51); h[2] = (uint64_t) r2 & FE51_MASK; r3 += c;
+  c = (uint64_t) (r3 >> 51); h[3] = (uint64_t) r3 & FE51_MASK; r4 += c;
+  c = (uint64_t) (r4 >> 51); h[4] = (uint64_t) r4 & FE51_MASK;
+  h[0] += c * 19;
+  c = h[0] >> 51; h[0] &= FE51_MASK; h[1] += c;
+}
+
+static void fe51_mul(fe51 h, const fe51 f, const fe51 g) {
+  uint64_t g1_19 = 19 * g[1];
+  uint64_t g2_19 = 19 * g[2];
+  uint64_t g3_19 = 19 * g[3];
+  uint64_t g4_19 = 19 * g[4];
+  uint128_t r0, r1, r2, r3, r4;
+
+  r0 = (uint128_t) f[0] * g[0] + (uint128_t) f[1] * g4_19 + (uint128_t) f[2] * g3_19 + (uint128_t) f[3] * g2_19 + (uint128_t) f[4] * g1_19;
+  r1 = (uint128_t) f[0] * g[1] + (uint128_t) f[1] * g[0] + (uint128_t) f[2] * g4_19 + (uint128_t) f[3] * g3_19 + (uint128_t) f[4] * g2_19;
+  r2 = (uint128_t) f[0] * g[2] + (uint128_t) f[1] * g[1] + (uint128_t) f[2] * g[0] + (uint128_t) f[3] * g4_19 + (uint128_t) f[4] * g3_19;
+  r3 = (uint128_t) f[0] * g[3] + (uint128_t) f[1] * g[2] + (uint128_t) f[2] * g[1] + (uint128_t) f[3] * g[0] + (uint128_t) f[4] * g4_19;
+  r4 = (uint128_t) f[0] * g[4] + (uint128_t) f[1] * g[3] + (uint128_t) f[2] * g[2] + (uint128_t) f[3] * g[1] + (uint128_t) f[4] * g[0];
+
+  fe51_reduce_wide(h, r0, r1, r2, r3, r4);
+}
+
+static void fe51_sq(fe51 h, const fe51 f) {
+  uint64_t f0_2 = 2 * f[0];
+  uint64_t f1_2 = 2 * f[1];
+  uint64_t f3_19 = 19 * f[3];
+  uint64_t f4_19 = 19 * f[4];
+  uint128_t r0, r1, r2, r3, r4;
+
+  r0 = (uint128_t) f[0] * f[0] + (uint128_t) f1_2 * f4_19 + (uint128_t) (2 * f[2]) * f3_19;
+  r1 = (uint128_t) f0_2 * f[1] + (uint128_t) (2 * f[2]) * f4_19 + (uint128_t) f[3] * f3_19;
+  r2 = (uint128_t) f0_2 * f[2] + (uint128_t) f[1] * f[1] + (uint128_t) (2 * f[3]) * f4_19;
+  r3 = (uint128_t) f0_2 * f[3] + (uint128_t) f1_2 * f[2] + (uint128_t) f[4] * f4_19;
+  r4 = (uint128_t) f0_2 * f[4] + (uint128_t) f1_2 * f[3] + (uint128_t) f[2] * f[2];
+
+  fe51_reduce_wide(h, r0, r1, r2, r3, r4);
+}
+
+static void fe51_frombytes(fe51 h, const unsigned char *s) {
+  h[0] = load_8(s) & FE51_MASK;
+  h[1] = (load_8(s + 6) >> 3) & FE51_MASK;
+  h[2] = (load_8(s + 12) >> 6) & FE51_MASK;
+  h[3] = (load_8(s + 19) >> 1) & FE51_MASK;
+  h[4] = (load_8(s + 24) >> 12) & FE51_MASK;
+}
+
+static void fe_to_fe51(fe51 h, const fe f) {
+  unsigned char s[32];
+  fe_tobytes(s, f);
+  fe51_frombytes(h, s);
+}
+
+/* ref10 limbs sit at bits 0, 26, 51, 77, ..., so each radix 2^51 limb splits into a 26 and a 25 bit one.
+   The split limbs are then carried into ref10's signed, centered range, which its fe_sq and fe_mul bounds assume. */
+
+static void fe51_to_fe(fe h, const fe51 f) {
+  fe51 t;
+  int64_t l[10];
+  int64_t carry;
+  int i;
+
+  fe51_copy(t, f);
+  fe51_carry(t);
+  for (i = 0; i < 5; i++) {
+    l[2 * i] = (int64_t) (t[i] & 0x3ffffff);
+    l[2 * i + 1] = (int64_t) (t[i] >> 26);
+  }
+
+  for (i = 0; i < 10; i++) {
+    int shift = (i & 1) ? 25 : 26;
+    carry = (l[i] + ((int64_t) 1 << (shift - 1))) >> shift;
+    l[i] -= carry * ((int64_t) 1 << shift);
+    if (i == 9) {
+      l[0] += carry * 19;
+    } else {
+      l[i + 1] += carry;
+    }
+  }
+  carry = (l[0] + (int64_t) (1L << 25)) >> 26; l[1] += carry; l[0] -= carry * ((int64_t) 1L << 26);
+
+  for (i = 0; i < 10; i++) {
+    h[i] = (int32_t) l[i];
+  }
+}
+
+static void ge51_p3_to_cached(ge51_cached *r, const ge51_p3 *p, const fe51 d2) {
+  fe51_add(r->YplusX, p->Y, p->X);
+  fe51_sub(r->YminusX, p->Y, p->X);
+  fe51_copy(r->Z, p->Z);
+  fe51_mul(r->T2d, p->T, d2);
+}
+
+static void ge51_add(ge51_p1p1 *r, const ge51_p3 *p, const ge51_cached *q) {
+  fe51 t0;
+  fe51_add(r->X, p->Y, p->X);
+  fe51_sub(r->Y, p->Y, p->X);
+  fe51_mul(r->Z, r->X, q->YplusX);
+  fe51_mul(r->Y, r->Y, q->YminusX);
+  fe51_mul(r->T, q->T2d, p->T);
+  fe51_mul(r->X, p->Z, q->Z);
+  fe51_add(t0, r->X, r->X);
+  fe51_sub(r->X, r->Z, r->Y);
+  fe51_add(r->Y, r->Z, r->Y);
+  fe51_add(r->Z, t0, r->T);
+  fe51_sub(r->T, t0, r->T);
+}
+
+static void ge51_p2_dbl(ge51_p1p1 *r, const ge51_p2 *p) {
+  fe51 t0;
+  fe51_sq(r->X, p->X);
+  fe51_sq(r->Z, p->Y);
+  fe51_sq(r->T, p->Z);
+  fe51_add(r->T, r->T, r->T);
+  fe51_add(r->Y, p->X, p->Y);
+  fe51_sq(t0, r->Y);
+  fe51_add(r->Y, r->Z, r->X);
+  fe51_sub(r->Z, r->Z, r->X);
+  fe51_sub(r->X, t0, r->Y);
+  fe51_sub(r->T, r->T, r->Z);
+}
+
+static void ge51_p1p1_to_p2(ge51_p2 *r, const ge51_p1p1 *p) {
+  fe51_mul(r->X, p->X, p->T);
+  fe51_mul(r->Y, p->Y, p->Z);
+  fe51_mul(r->Z, p->Z, p->T);
+}
+
+static void ge51_p1p1_to_p3(ge51_p3 *r, const ge51_p1p1 *p) {
+  fe51_mul(r->X, p->X, p->T);
+  fe51_mul(r->Y, p->Y, p->Z);
+  fe51_mul(r->Z, p->Z, p->T);
+  fe51_mul(r->T, p->X, p->Y);
+}
+
+static void ge51_cached_0(ge51_cached *r) {
+  fe51_1(r->YplusX);
+  fe51_1(r->YminusX);
+  fe51_1(r->Z);
+  fe51_0(r->T2d);
+}
+
+static void ge51_cached_cmov(ge51_cached *t, const ge51_cached *u, unsigned char b) {
+  fe51_cmov(t->YplusX, u->YplusX, b);
+  fe51_cmov(t->YminusX, u->YminusX, b);
+  fe51_cmov(t->Z, u->Z, b);
+  fe51_cmov(t->T2d, u->T2d, b);
+}
+
+static void ge_scalarmult_fe51(ge_p2 *r, const signed char *e, const ge_p3 *A) {
+  int i;
+  fe51 d2;
+  ge51_p3 a;
+  ge51_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
+  ge51_p1p1 t;
+  ge51_p3 u;
+  ge51_p2 q;
+
+  fe_to_fe51(d2, fe_d2);
+  fe_to_fe51(a.X, A->X);
+  fe_to_fe51(a.Y, A->Y);
+  fe_to_fe51(a.Z, A->Z);
+  fe_to_fe51(a.T, A->T);
+
+  ge51_p3_to_cached(&Ai[0], &a, d2);
+  for (i = 0; i < 7; i++) {
+    ge51_add(&t, &a, &Ai[i]);
+    ge51_p1p1_to_p3(&u, &t);
+    ge51_p3_to_cached(&Ai[i + 1], &u, d2);
+  }
+
+  fe51_0(q.X);
+  fe51_1(q.Y);
+  fe51_1(q.Z);
+  for (i = 63; i >= 0; i--) {
+    signed char b = e[i];
+    unsigned char bnegative = negative(b);
+    unsigned char babs = b - (((-bnegative) & b) << 1);
+    ge51_cached cur, minuscur;
+    ge51_p2_dbl(&t, &q);
+    ge51_p1p1_to_p2(&q, &t);
+    ge51_p2_dbl(&t, &q);
+    ge51_p1p1_to_p2(&q, &t);
+    ge51_p2_dbl(&t, &q);
+    ge51_p1p1_to_p2(&q, &t);
+    ge51_p2_dbl(&t, &q);
+    ge51_p1p1_to_p3(&u, &t);
+    ge51_cached_0(&cur);
+    ge51_cached_cmov(&cur, &Ai[0], equal(babs, 1));
+    ge51_cached_cmov(&cur, &Ai[1], equal(babs, 2));
+    ge51_cached_cmov(&cur, &Ai[2], equal(babs, 3));
+    ge51_cached_cmov(&cur, &Ai[3], equal(babs, 4));
+    ge51_cached_cmov(&cur, &Ai[4], equal(babs, 5));
+    ge51_cached_cmov(&cur, &Ai[5], equal(babs, 6));
+    ge51_cached_cmov(&cur, &Ai[6], equal(babs, 7));
+    ge51_cached_cmov(&cur, &Ai[7], equal(babs, 8));
+    fe51_copy(minuscur.YplusX, cur.YminusX);
+    fe51_copy(minuscur.YminusX, cur.YplusX);
+    fe51_copy(minuscur.Z, cur.Z);
+    fe51_neg(minuscur.T2d, cur.T2d);
+    ge51_cached_cmov(&cur, &minuscur, bnegative);
+    ge51_add(&t, &u, &cur);
+    ge51_p1p1_to_p2(&q, &t);
+  }
+
+  fe51_to_fe(r->X, q.X);
+  fe51_to_fe(r->Y, q.Y);
+  fe51_to_fe(r->Z, q.Z);
+}
+
+/* Fixed-base scalar multiplication on 64-bit targets. The table holds j * 2^(w*i) * B for every
+   window position i and 1 <= j <= 2^(w-1), so a multiplication is one mixed addition per window
+   and no doublings. Every lookup scans all 2^(w-1) entries of its position to stay constant time,
+   which is why wider windows stop paying off well before radix 256. The table is built on first
+   use and shared by all threads; until it is ready, callers take the ref10 path. */
+
+#define GE51_BASE_WINDOW 4
+#define GE51_BASE_ENTRIES (1 << (GE51_BASE_WINDOW - 1))
+#define GE51_BASE_POSITIONS (255 / GE51_BASE_WINDOW + 1)
+
+typedef struct {
+  fe51 yplusx;
+  fe51 yminusx;
+  fe51 xy2d;
+} ge51_precomp;
+
+static ge51_precomp ge51_base[GE51_BASE_POSITIONS][GE51_BASE_ENTRIES];
+static int ge51_base_state; /* 0: not built, 1: being built, 2: ready */
+
+static void ge51_madd(ge51_p1p1 *r, const ge51_p3 *p, const ge51_precomp *q) {
+  fe51 t0;
+  fe51_add(r->X, p->Y, p->X);
+  fe51_sub(r->Y, p->Y, p->X);
+  fe51_mul(r->Z, r->X, q->yplusx);
+  fe51_mul(r->Y, r->Y, q->yminusx);
+  fe51_mul(r->T, q->xy2d, p->T);
+  fe51_add(t0, p->Z, p->Z);
+  fe51_sub(r->X, r->Z, r->Y);
+  fe51_add(r->Y, r->Z, r->Y);
+  fe51_add(r->Z, t0, r->T);
+  fe51_sub(r->T, t0, r->T);
+}
+
+static void ge51_precomp_cmov(ge51_precomp *t, const ge51_precomp *u, unsigned char b) {
+  fe51_cmov(t->yplusx, u->yplusx, b);
+  fe51_cmov(t->yminusx, u->yminusx, b);
+  fe51_cmov(t->xy2d, u->xy2d, b);
+}
+
+static unsigned char equal32(uint32_t b, uint32_t c) {
+  uint32_t y = b ^ c; /* 0: yes; otherwise no */
+  y -= 1; /* 4294967295: yes; below 2^31: no, as b and c are small */
+  y >>= 31;
+  return (unsigned char) y;
+}
+
+static void ge51_base_select(ge51_precomp *t, int pos, int b) {
+  ge51_precomp minust;
+  uint32_t bnegative = ((uint32_t) b) >> 31;
+  uint32_t babs = (uint32_t) (b - (((-(int) bnegative) & b) << 1));
+  int j;
+
+  fe51_1(t->yplusx);
+  fe51_1(t->yminusx);
+  fe51_0(t->xy2d);
+  for (j = 0; j < GE51_BASE_ENTRIES; j++) {
+    ge51_precomp_cmov(t, &ge51_base[pos][j], equal32(babs, (uint32_t) (j + 1)));
+  }
+  fe51_copy(minust.yplusx, t->yminusx);
+  fe51_copy(minust.yminusx, t->yplusx);
+  fe51_neg(minust.xy2d, t->xy2d);
+  ge51_precomp_cmov(t, &minust, (unsigned char) bnegative);
+}
+
+static void ge51_base_build(void) {
+  static const unsigned char one[32] = {1};
+  ge_p3 p; /* 2^(w*i) * B */
+  ge_p3 multiples[GE51_BASE_ENTRIES];
+  fe products[GE51_BASE_ENTRIES];
+  ge_cached cached;
+  ge_p1p1 t;
+  ge_p2 q;
+  fe51 d2;
+  int i, j;
+
+  fe_to_fe51(d2, fe_d2);
+  ge_scalarmult_base_ref10(&p, one);
+  for (i = 0; i < GE51_BASE_POSITIONS; i++) {
+    fe inverse;
+
+    multiples[0] = p;
+    ge_p3_to_cached(&cached, &p);
+    for (j = 1; j < GE51_BASE_ENTRIES; j++) {
+      ge_add(&t, &multiples[j - 1], &cached);
+      ge_p1p1_to_p3(&multiples[j], &t);
+    }
+
+    /* one inversion per position: invert the product of all Z and peel the factors off */
+    fe_copy(products[0], multiples[0].Z);
+    for (j = 1; j < GE51_BASE_ENTRIES; j++) {
+      fe_mul(products[j], products[j - 1], multiples[j].Z);
+    }
+    fe_invert(inverse, products[GE51_BASE_ENTRIES - 1]);
+    for (j = GE51_BASE_ENTRIES - 1; j >= 0; j--) {
+      fe recip, x, y;
+      fe51 x51, y51, xy;
+      ge51_precomp *entry = &ge51_base[i][j];
+
+      if (j > 0) {
+        fe_mul(recip, inverse, products[j - 1]);
+        fe_mul(inverse, inverse, multiples[j].Z);
+      } else {
+        fe_copy(recip, inverse);
+      }
+      fe_mul(x, multiples[j].X, recip);
+      fe_mul(y, multiples[j].Y, recip);
+      fe_to_fe51(x51, x);
+      fe_to_fe51(y51, y);
+      fe51_add(entry->yplusx, y51, x51);
+      fe51_sub(entry->yminusx, y51, x51);
+      fe51_mul(xy, x51, y51);
+      fe51_mul(entry->xy2d, xy, d2);
+    }
+
+    ge_p3_dbl(&t, &p);
+    for (j = 1; j < GE51_BASE_WINDOW; j++) {
+      ge_p1p1_to_p2(&q, &t);
+      ge_p2_dbl(&t, &q);
+    }
+    ge_p1p1_to_p3(&p, &t);
+  }
+}
+
+/* Returns 0 without touching h while the table is not ready */
+static int ge_scalarmult_base_fe51(ge_p3 *h, const unsigned char *a) {
+  int e[GE51_BASE_POSITIONS];
+  int state = __atomic_load_n(&ge51_base_state, __ATOMIC_ACQUIRE);
+  int carry, i;
+  ge51_p3 r;
+  ge51_p1p1 t;
+  ge51_precomp s;
+
+  if (state != 2) {
+    int expected = 0;
+    if (state != 0 || !__atomic_compare_exchange_n(&ge51_base_state, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      return 0;
+    }
+
+    ge51_base_build();
+    __atomic_store_n(&ge51_base_state, 2, __ATOMIC_RELEASE);
+  }
+
+  /* signed digits in [-2^(w-1), 2^(w-1)); a < 2^255, so the last one is at most 2^(w-1) */
+  carry = 0;
+  for (i = 0; i < GE51_BASE_POSITIONS; i++) {
+    int bit = i * GE51_BASE_WINDOW;
+    int v = 0, k;
+    for (k = 0; k < GE51_BASE_WINDOW && bit + k < 256; k++) {
+      v |= ((a[(bit + k) >> 3] >> ((bit + k) & 7)) & 1) << k;
+    }
+    v += carry;
+    if (i == GE51_BASE_POSITIONS - 1) {
+      e[i] = v;
+    } else {
+      carry = (v + GE51_BASE_ENTRIES) >> GE51_BASE_WINDOW;
+      e[i] = v - (carry << GE51_BASE_WINDOW);
+    }
+  }
+
+  fe51_0(r.X);
+  fe51_1(r.Y);
+  fe51_1(r.Z);
+  fe51_0(r.T);
+  for (i = 0; i < GE51_BASE_POSITIONS; i++) {
+    ge51_base_select(&s, i, e[i]);
+    ge51_madd(&t, &r, &s);
+    ge51_p1p1_to_p3(&r, &t);
+  }
+
+  fe51_to_fe(h->X, r.X);
+  fe51_to_fe(h->Y, r.Y);
+  fe51_to_fe(h->Z, r.Z);
+  fe51_to_fe(h->T, r.T);
+  return 1;
+}
+
+#endif
 
 /* Assumes that a[31] <= 127 */
 void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
   signed char e[64];
   int carry, carry2, i;
-  ge_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
-  ge_p1p1 t;
-  ge_p3 u;
 
   carry = 0; /* 0..1 */
   for (i = 0; i < 31; i++) {
@@ -1935,44 +2486,54 @@ void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
   e[62] = carry - (carry2 << 4); /* -8..7 */
   e[63] = carry2; /* 0..8 */
 
-  ge_p3_to_cached(&Ai[0], A);
-  for (i = 0; i < 7; i++) {
-    ge_add(&t, A, &Ai[i]);
-    ge_p1p1_to_p3(&u, &t);
-    ge_p3_to_cached(&Ai[i + 1], &u);
-  }
+#if defined(__SIZEOF_INT128__)
+  ge_scalarmult_fe51(r, e, A);
+#else
+  {
+    ge_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
+    ge_p1p1 t;
+    ge_p3 u;
 
-  ge_p2_0(r);
-  for (i = 63; i >= 0; i--) {
-    signed char b = e[i];
-    unsigned char bnegative = negative(b);
-    unsigned char babs = b - (((-bnegative) & b) << 1);
-    ge_cached cur, minuscur;
-    ge_p2_dbl(&t, r);
-    ge_p1p1_to_p2(r, &t);
-    ge_p2_dbl(&t, r);
-    ge_p1p1_to_p2(r, &t);
-    ge_p2_dbl(&t, r);
-    ge_p1p1_to_p2(r, &t);
-    ge_p2_dbl(&t, r);
-    ge_p1p1_to_p3(&u, &t);
-    ge_cached_0(&cur);
-    ge_cached_cmov(&cur, &Ai[0], equal(babs, 1));
-    ge_cached_cmov(&cur, &Ai[1], equal(babs, 2));
-    ge_cached_cmov(&cur, &Ai[2], equal(babs, 3));
-    ge_cached_cmov(&cur, &Ai[3], equal(babs, 4));
-    ge_cached_cmov(&cur, &Ai[4], equal(babs, 5));
-    ge_cached_cmov(&cur, &Ai[5], equal(babs, 6));
-    ge_cached_cmov(&cur, &Ai[6], equal(babs, 7));
-    ge_cached_cmov(&cur, &Ai[7], equal(babs, 8));
-    fe_copy(minuscur.YplusX, cur.YminusX);
-    fe_copy(minuscur.YminusX, cur.YplusX);
-    fe_copy(minuscur.Z, cur.Z);
-    fe_neg(minuscur.T2d, cur.T2d);
-    ge_cached_cmov(&cur, &minuscur, bnegative);
-    ge_add(&t, &u, &cur);
-    ge_p1p1_to_p2(r, &t);
+    ge_p3_to_cached(&Ai[0], A);
+    for (i = 0; i < 7; i++) {
+      ge_add(&t, A, &Ai[i]);
+      ge_p1p1_to_p3(&u, &t);
+      ge_p3_to_cached(&Ai[i + 1], &u);
+    }
+
+    ge_p2_0(r);
+    for (i = 63; i >= 0; i--) {
+      signed char b = e[i];
+      unsigned char bnegative = negative(b);
+      unsigned char babs = b - (((-bnegative) & b) << 1);
+      ge_cached cur, minuscur;
+      ge_p2_dbl(&t, r);
+      ge_p1p1_to_p2(r, &t);
+      ge_p2_dbl(&t, r);
+      ge_p1p1_to_p2(r, &t);
+      ge_p2_dbl(&t, r);
+      ge_p1p1_to_p2(r, &t);
+      ge_p2_dbl(&t, r);
+      ge_p1p1_to_p3(&u, &t);
+      ge_cached_0(&cur);
+      ge_cached_cmov(&cur, &Ai[0], equal(babs, 1));
+      ge_cached_cmov(&cur, &Ai[1], equal(babs, 2));
+      ge_cached_cmov(&cur, &Ai[2], equal(babs, 3));
+      ge_cached_cmov(&cur, &Ai[3], equal(babs, 4));
+      ge_cached_cmov(&cur, &Ai[4], equal(babs, 5));
+      ge_cached_cmov(&cur, &Ai[5], equal(babs, 6));
+      ge_cached_cmov(&cur, &Ai[6], equal(babs, 7));
+      ge_cached_cmov(&cur, &Ai[7], equal(babs, 8));
+      fe_copy(minuscur.YplusX, cur.YminusX);
+      fe_copy(minuscur.YminusX, cur.YplusX);
+      fe_copy(minuscur.Z, cur.Z);
+      fe_neg(minuscur.T2d, cur.T2d);
+      ge_cached_cmov(&cur, &minuscur, bnegative);
+      ge_add(&t, &u, &cur);
+      ge_p1p1_to_p2(r, &t);
+    }
   }
+#endif
 }
 
 void ge_double_scalarmult_precomp_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b, const ge_dsmp Bi) {
@@ -568,6 +568,10 @@ void crypto_ops::generate_tx_proof(const Hash &prefix_hash, const PublicKey &R,
     ge_dsmp image_pre;
     EllipticCurveScalar sum, h;
     rs_comm *const buf = reinterpret_cast<rs_comm *>(alloca(rs_comm_size(pubs_count)));
+    // both commitments of every ring member, laid out like buf->ab, normalized in one pass
+    ge_p2 *const comm = reinterpret_cast<ge_p2 *>(alloca(2 * pubs_count * sizeof(ge_p2)));
+    fe *const scratch = reinterpret_cast<fe *>(alloca(2 * pubs_count * sizeof(fe)));
+    static_assert(sizeof(((rs_comm*)0)->ab[0]) == 2 * sizeof(EllipticCurvePoint), "rs_comm::ab must be packed");
 #if !defined(NDEBUG)
     for (i = 0; i < pubs_count; i++) {
       assert(check_key(*pubs[i]));
@@ -580,7 +584,6 @@ void crypto_ops::generate_tx_proof(const Hash &prefix_hash, const PublicKey &R,
     sc_0(reinterpret_cast<unsigned char*>(&sum));
     buf->h = prefix_hash;
     for (i = 0; i < pubs_count; i++) {
-      ge_p2 tmp2;
       ge_p3 tmp3;
       if (sc_check(reinterpret_cast<const unsigned char*>(&sig[i])) != 0 || sc_check(reinterpret_cast<const unsigned char*>(&sig[i]) + 32) != 0) {
         return false;
@@ -588,15 +591,15 @@ void crypto_ops::generate_tx_proof(const Hash &prefix_hash, const PublicKey &R,
       if (ge_frombytes_vartime(&tmp3, reinterpret_cast<const unsigned char*>(&*pubs[i])) != 0) {
         abort();
       }
-      ge_double_scalarmult_base_vartime(&tmp2, reinterpret_cast<const unsigned char*>(&sig[i]), &tmp3, reinterpret_cast<const unsigned char*>(&sig[i]) + 32);
-      ge_tobytes(reinterpret_cast<unsigned char*>(&buf->ab[i].a), &tmp2);
+      ge_double_scalarmult_base_vartime(&comm[2 * i], reinterpret_cast<const unsigned char*>(&sig[i]), &tmp3, reinterpret_cast<const unsigned char*>(&sig[i]) + 32);
       hash_to_ec(*pubs[i], tmp3);
-      ge_double_scalarmult_precomp_vartime(&tmp2, reinterpret_cast<const unsigned char*>(&sig[i]) + 32, &tmp3, reinterpret_cast<const unsigned char*>(&sig[i]), image_pre);
-      ge_tobytes(reinterpret_cast<unsigned char*>(&buf->ab[i].b), &tmp2);
+      ge_double_scalarmult_precomp_vartime(&comm[2 * i + 1], reinterpret_cast<const unsigned char*>(&sig[i]) + 32, &tmp3, reinterpret_cast<const unsigned char*>(&sig[i]), image_pre);
       sc_add(reinterpret_cast<unsigned char*>(&sum), reinterpret_cast<unsigned char*>(&sum), reinterpret_cast<const unsigned char*>(&sig[i]));
     }
+    ge_tobytes_batch(reinterpret_cast<unsigned char*>(&buf->ab[0]), comm, scratch, 2 * pubs_count);
     hash_to_scalar(buf, rs_comm_size(pubs_count), h);
     sc_sub(reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&sum));
     return sc_isnonzero(reinterpret_cast<unsigned char*>(&h)) == 0;
   }
+
 }
@@ -64,8 +64,27 @@ enum {
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
+void cn_fast_hash_multi(const void *data, size_t length, size_t count, char *hash);
 
 void cn_slow_hash(const void *data, size_t length, char *hash, int light, int variant, int prehashed); 
+void cn_slow_hash_multi(const void *data, size_t length, size_t count, char *hash, int light, int variant, int prehashed);
+size_t cn_slow_hash_select_ways(size_t threads, int light);
+/* which cn_slow_hash code path this CPU runs, for benchmarks and logs */
+const char *cn_slow_hash_implementation(void);
+void slow_hash_allocate_state(void);
+void slow_hash_free_state(void);
+
+struct slow_hash_pool_stats {
+  size_t reserved;   /* scratchpads reserved up front by slow_hash_pool_reserve */
+  size_t available;  /* reserved scratchpads not currently handed out */
+  size_t in_use;     /* scratchpads held by threads, pooled or allocated on their own */
+  size_t huge_pages; /* scratchpads in use that are backed by huge pages */
+  size_t numa_bound; /* scratchpads in use bound to their thread's NUMA node */
+  int pool_pages;    /* pool backing: 2 explicit huge pages, 1 transparent huge pages, 0 regular pages */
+};
+
+size_t slow_hash_pool_reserve(size_t count);
+void slow_hash_pool_get_stats(struct slow_hash_pool_stats *stats);
 
 void hash_extra_blake(const void *data, size_t length, char *hash);
 void hash_extra_groestl(const void *data, size_t length, char *hash);
@@ -75,4 +94,5 @@ void hash_extra_skein(const void *data, size_t length, char *hash);
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash);
 size_t tree_depth(size_t count);
 void tree_branch(const char (*hashes)[HASH_SIZE], size_t count, char (*branch)[HASH_SIZE]);
+void tree_branch_with_scratch(const char (*hashes)[HASH_SIZE], size_t count, char (*branch)[HASH_SIZE], char (*scratch)[HASH_SIZE]);
 void tree_hash_from_branch(const char (*branch)[HASH_SIZE], size_t depth, const char *leaf, const void *path, char *root_hash);
@@ -24,3 +24,7 @@ void cn_fast_hash(const void *data, size_t length, char *hash) {
   hash_process(&state, data, length);
   memcpy(hash, &state, HASH_SIZE);
 }
+
+void cn_fast_hash_multi(const void *data, size_t length, size_t count, char *hash) {
+  keccak1600_multi(data, (int)length, count, (uint8_t*)hash, HASH_SIZE);
+}
@@ -42,6 +42,11 @@ namespace Crypto {
     return h;
   }
 
+  // Hashes count inputs of length bytes stored back to back, several at a time where the CPU allows
+  inline void cn_fast_hash_multi(const void *data, size_t length, size_t count, Hash *hashes) {
+    cn_fast_hash_multi(data, length, count, reinterpret_cast<char *>(hashes));
+  }
+
   class cn_context {
   public:
 
@@ -62,6 +67,11 @@ namespace Crypto {
     cn_slow_hash(data, length, reinterpret_cast<char *>(&hash), light, variant, 0); 
   }
   
+  // Hashes count inputs of length bytes stored back to back, interleaving up to three at a time
+  inline void cn_slow_hash_multi(cn_context &context, const void *data, size_t length, size_t count, Hash *hashes, int light = 0, int variant = 0) {
+    cn_slow_hash_multi(data, length, count, reinterpret_cast<char *>(hashes), light, variant, 0);
+  }
+
   inline void cn_slow_hash_prehashed(const void *data, std::size_t length, Hash &hash, int light = 0, int variant = 0, int prehashed = 0) {
      cn_slow_hash(data, length, reinterpret_cast<char *>(&hash), light, variant, 1);
   }
@@ -74,6 +84,10 @@ namespace Crypto {
     tree_branch(reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char (*)[HASH_SIZE]>(branch));
   }
 
+  inline void tree_branch(const Hash *hashes, size_t count, Hash *branch, Hash *scratch) {
+    tree_branch_with_scratch(reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char (*)[HASH_SIZE]>(branch), reinterpret_cast<char (*)[HASH_SIZE]>(scratch));
+  }
+
   inline void tree_hash_from_branch(const Hash *branch, size_t depth, const Hash &leaf, const void *path, Hash &root_hash) {
     tree_hash_from_branch(reinterpret_cast<const char (*)[HASH_SIZE]>(branch), depth, reinterpret_cast<const char *>(&leaf), path, reinterpret_cast<char *>(&root_hash));
   }
@@ -112,3 +112,196 @@ void keccak1600(const uint8_t *in, int inlen, uint8_t *md)
 {
     keccak(in, inlen, md, sizeof(state_t));
 }
+
+/*
+ * Multi-message Keccak. The x86-64 kernels below run 4 (AVX2) or 8 (AVX-512F) permutations side
+ * by side on a lane-interleaved state, word i of message k living at st[i * lanes + k]. The
+ * sponge around them is plain C, so every kernel yields the same digests as keccak1600.
+ */
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(NO_KECCAK_SIMD)
+#define KECCAK_X86 1
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define KECCAK_TARGET_AVX2
+#define KECCAK_TARGET_AVX512
+#else
+#define KECCAK_TARGET_AVX2 __attribute__((target("avx2")))
+#define KECCAK_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+#define KECCAK_RHO_PI(ROL, j, r) u = s[j]; s[j] = ROL(t, r); t = u;
+
+/* one keccakf over the vectors s[25], the rho pi steps unrolled so every rotation is constant */
+#define KECCAKF_LANES(type, XOR, ROL, ANDN, RC)                                        \
+  {                                                                                    \
+    type bc[5], t, u;                                                                  \
+    int i, j, round;                                                                   \
+    for (round = 0; round < KECCAK_ROUNDS; round++) {                                  \
+      for (i = 0; i < 5; i++)                                                          \
+        bc[i] = XOR(XOR(s[i], s[i + 5]), XOR(XOR(s[i + 10], s[i + 15]), s[i + 20]));   \
+      for (i = 0; i < 5; i++) {                                                        \
+        t = XOR(bc[(i + 4) % 5], ROL(bc[(i + 1) % 5], 1));                             \
+        for (j = 0; j < 25; j += 5)                                                    \
+          s[j + i] = XOR(s[j + i], t);                                                 \
+      }                                                                                \
+      t = s[1];                                                                        \
+      KECCAK_RHO_PI(ROL, 10, 1) KECCAK_RHO_PI(ROL, 7, 3) KECCAK_RHO_PI(ROL, 11, 6)     \
+      KECCAK_RHO_PI(ROL, 17, 10) KECCAK_RHO_PI(ROL, 18, 15) KECCAK_RHO_PI(ROL, 3, 21)  \
+      KECCAK_RHO_PI(ROL, 5, 28) KECCAK_RHO_PI(ROL, 16, 36) KECCAK_RHO_PI(ROL, 8, 45)   \
+      KECCAK_RHO_PI(ROL, 21, 55) KECCAK_RHO_PI(ROL, 24, 2) KECCAK_RHO_PI(ROL, 4, 14)   \
+      KECCAK_RHO_PI(ROL, 15, 27) KECCAK_RHO_PI(ROL, 23, 41) KECCAK_RHO_PI(ROL, 19, 56) \
+      KECCAK_RHO_PI(ROL, 13, 8) KECCAK_RHO_PI(ROL, 12, 25) KECCAK_RHO_PI(ROL, 2, 43)   \
+      KECCAK_RHO_PI(ROL, 20, 62) KECCAK_RHO_PI(ROL, 14, 18) KECCAK_RHO_PI(ROL, 22, 39) \
+      KECCAK_RHO_PI(ROL, 9, 61) KECCAK_RHO_PI(ROL, 6, 20) KECCAK_RHO_PI(ROL, 1, 44)    \
+      for (j = 0; j < 25; j += 5) {                                                    \
+        for (i = 0; i < 5; i++)                                                        \
+          bc[i] = s[j + i];                                                            \
+        for (i = 0; i < 5; i++)                                                        \
+          s[j + i] = XOR(s[j + i], ANDN(bc[(i + 1) % 5], bc[(i + 2) % 5]));            \
+      }                                                                                \
+      s[0] = XOR(s[0], RC(keccakf_rndc[round]));                                       \
+    }                                                                                  \
+  }
+
+#define ROL_AVX2(x, n) _mm256_or_si256(_mm256_slli_epi64((x), (n)), _mm256_srli_epi64((x), 64 - (n)))
+#define RC_AVX2(c) _mm256_set1_epi64x((long long)(c))
+
+KECCAK_TARGET_AVX2 static void keccakf_x4(uint64_t *st)
+{
+  __m256i s[25];
+  int w;
+
+  for (w = 0; w < 25; w++)
+    s[w] = _mm256_loadu_si256((const __m256i *)(st + 4 * w));
+
+  KECCAKF_LANES(__m256i, _mm256_xor_si256, ROL_AVX2, _mm256_andnot_si256, RC_AVX2)
+
+  for (w = 0; w < 25; w++)
+    _mm256_storeu_si256((__m256i *)(st + 4 * w), s[w]);
+}
+
+#define ROL_AVX512(x, n) _mm512_rol_epi64((x), (n))
+#define RC_AVX512(c) _mm512_set1_epi64((long long)(c))
+
+KECCAK_TARGET_AVX512 static void keccakf_x8(uint64_t *st)
+{
+  __m512i s[25];
+  int w;
+
+  for (w = 0; w < 25; w++)
+    s[w] = _mm512_loadu_si512((const void *)(st + 8 * w));
+
+  KECCAKF_LANES(__m512i, _mm512_xor_si512, ROL_AVX512, _mm512_andnot_si512, RC_AVX512)
+
+  for (w = 0; w < 25; w++)
+    _mm512_storeu_si512((void *)(st + 8 * w), s[w]);
+}
+
+/* 8 for AVX-512F, 4 for AVX2, 1 when neither is usable */
+static int keccak_simd_lanes(void)
+{
+  static int lanes = 0;
+
+  if (lanes)
+    return lanes;
+
+#if defined(_MSC_VER)
+  {
+    int info[4];
+    unsigned long long xcr0;
+    __cpuidex(info, 0, 0);
+    if (info[0] < 7)
+      return lanes = 1;
+
+    /* the OS must save the ymm (and for AVX-512 the opmask and zmm) registers as well */
+    __cpuidex(info, 1, 0);
+    if (!(info[2] & (1 << 27)))
+      return lanes = 1;
+    xcr0 = _xgetbv(0);
+    if ((xcr0 & 6) != 6)
+      return lanes = 1;
+
+    __cpuidex(info, 7, 0);
+    if ((info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6)
+      return lanes = 8;
+    return lanes = (info[1] & (1 << 5)) ? 4 : 1;
+  }
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return lanes = 8;
+  return lanes = __builtin_cpu_supports("avx2") ? 4 : 1;
+#endif
+}
+
+/*
+ * Absorbs one group of messages into the interleaved state and squeezes the first mdlen bytes of
+ * each. Every input byte of the group is read before the first digest byte is written.
+ */
+static void keccak1600_lanes(const uint8_t *in, int inlen, int lanes, void (*permute)(uint64_t *),
+                             uint8_t *md, int mdlen)
+{
+  uint64_t st[25 * 8];
+  uint8_t temp[8][144];
+  const int rsiz = HASH_DATA_AREA, rsizw = HASH_DATA_AREA / 8;
+  int i, k, off, left;
+  uint64_t word;
+
+  memset(st, 0, sizeof(uint64_t) * 25 * lanes);
+
+  for (off = 0; inlen - off >= rsiz; off += rsiz) {
+    for (i = 0; i < rsizw; i++)
+      for (k = 0; k < lanes; k++) {
+        memcpy(&word, in + (size_t) k * inlen + off + 8 * i, 8);
+        st[i * lanes + k] ^= word;
+      }
+    permute(st);
+  }
+
+  // last block and padding
+  left = inlen - off;
+  for (k = 0; k < lanes; k++) {
+    memcpy(temp[k], in + (size_t) k * inlen + off, left);
+    temp[k][left] = 1;
+    memset(temp[k] + left + 1, 0, rsiz - left - 1);
+    temp[k][rsiz - 1] |= 0x80;
+  }
+
+  for (i = 0; i < rsizw; i++)
+    for (k = 0; k < lanes; k++) {
+      memcpy(&word, temp[k] + 8 * i, 8);
+      st[i * lanes + k] ^= word;
+    }
+
+  permute(st);
+
+  for (i = 0; 8 * i < mdlen; i++)
+    for (k = 0; k < lanes; k++)
+      memcpy(md + (size_t) k * mdlen + 8 * i, &st[i * lanes + k], mdlen - 8 * i < 8 ? mdlen - 8 * i : 8);
+}
+#endif
+
+void keccak1600_multi(const uint8_t *in, int inlen, size_t count, uint8_t *md, int mdlen)
+{
+  state_t st;
+  size_t done = 0;
+
+#if defined(KECCAK_X86)
+  int lanes = keccak_simd_lanes();
+
+  if (lanes == 8)
+    for (; count - done >= 8; done += 8)
+      keccak1600_lanes(in + done * inlen, inlen, 8, keccakf_x8, md + done * mdlen, mdlen);
+
+  if (lanes >= 4)
+    for (; count - done >= 4; done += 4)
+      keccak1600_lanes(in + done * inlen, inlen, 4, keccakf_x4, md + done * mdlen, mdlen);
+#endif
+
+  for (; done < count; done++) {
+    keccak1600(in + done * inlen, inlen, (uint8_t *) st);
+    memcpy(md + done * mdlen, st, mdlen);
+  }
+}
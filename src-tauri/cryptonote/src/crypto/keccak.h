@@ -4,6 +4,7 @@
 #ifndef KECCAK_H
 #define KECCAK_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -23,4 +24,8 @@ void keccakf(uint64_t st[25], int norounds);
 
 void keccak1600(const uint8_t *in, int inlen, uint8_t *md);
 
+// keccak1600 over count messages of inlen bytes stored back to back, keeping the first mdlen
+// bytes of each state; md may alias in as long as md <= in and mdlen <= inlen
+void keccak1600_multi(const uint8_t *in, int inlen, size_t count, uint8_t *md, int mdlen);
+
 #endif
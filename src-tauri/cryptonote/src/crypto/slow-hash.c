@@ -229,6 +229,7 @@ extern int aesb_pseudo_round(const uint8_t *in, uint8_t *out, const uint8_t *exp
 #include <windows.h>
 #define STATIC
 #define INLINE __inline
+#define FORCE_INLINE __forceinline
 #if !defined(RDATA_ALIGN16)
 #define RDATA_ALIGN16 __declspec(align(16))
 #endif
@@ -237,14 +238,20 @@ extern int aesb_pseudo_round(const uint8_t *in, uint8_t *out, const uint8_t *exp
 #include <windows.h>
 #define STATIC static
 #define INLINE inline
+#define FORCE_INLINE inline __attribute__((always_inline))
 #if !defined(RDATA_ALIGN16)
 #define RDATA_ALIGN16 __attribute__ ((aligned(16)))
 #endif
 #else
 #include <wmmintrin.h>
+#include <sched.h>
 #include <sys/mman.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
 #define STATIC static
 #define INLINE inline
+#define FORCE_INLINE inline __attribute__((always_inline))
 #if !defined(RDATA_ALIGN16)
 #define RDATA_ALIGN16 __attribute__ ((aligned(16)))
 #endif
@@ -278,10 +285,12 @@ extern int aesb_pseudo_round(const uint8_t *in, uint8_t *out, const uint8_t *exp
 #endif
 #endif
 
+/* _a is built from the two halves of a, which post_aes has just written separately; a
+ * 16 byte load of them would wait for both stores instead of forwarding them */
 #define pre_aes() \
   j = state_index(a,(light?16:1)); \
   _c = _mm_load_si128(R128(&hp_state[j])); \
-  _a = _mm_load_si128(R128(a)); \
+  _a = _mm_set_epi64x(a[1], a[0]); \
 
 /*
  * An SSE-optimized implementation of the second half of CryptoNight step 3.
@@ -333,8 +342,14 @@ union cn_slow_hash_state
 THREADV uint8_t *hp_state = NULL;
 THREADV int hp_allocated = 0;
 
+/* Scratchpads for the second and third lane of cn_slow_hash_multi, allocated on first use */
+#define MAX_WAYS 3
+THREADV uint8_t *hp_state_multi[MAX_WAYS - 1];
+THREADV int hp_multi_allocated[MAX_WAYS - 1];
+
 #if defined(_MSC_VER)
 #define cpuid(info,x)    __cpuidex(info,x,0)
+#define cpuid_count(info,x,y)    __cpuidex(info,x,y)
 #else
 void cpuid(int CPUInfo[4], int InfoType)
 {
@@ -348,6 +363,19 @@ void cpuid(int CPUInfo[4], int InfoType)
             "a" (InfoType), "c" (0)
         );
 }
+
+static void cpuid_count(int CPUInfo[4], int InfoType, int SubLeaf)
+{
+    ASM __volatile__
+    (
+    "cpuid":
+        "=a" (CPUInfo[0]),
+        "=b" (CPUInfo[1]),
+        "=c" (CPUInfo[2]),
+        "=d" (CPUInfo[3]) :
+            "a" (InfoType), "c" (SubLeaf)
+        );
+}
 #endif
 
 /**
@@ -602,6 +630,275 @@ BOOL SetLockPagesPrivilege(HANDLE hProcess, BOOL bEnable)
 }
 #endif
 
+/* How a thread's scratchpad was obtained, kept in hp_allocated */
+#define SCRATCHPAD_HEAP 0
+#define SCRATCHPAD_HUGE 1
+#define SCRATCHPAD_POOL 2
+
+#if defined(_MSC_VER) || defined(__MINGW32__)
+static volatile LONG pool_lock = 0;
+#define POOL_LOCK() while(InterlockedExchange(&pool_lock, 1)) Sleep(0)
+#define POOL_UNLOCK() InterlockedExchange(&pool_lock, 0)
+#else
+static volatile int pool_lock = 0;
+#define POOL_LOCK() while(__sync_lock_test_and_set(&pool_lock, 1)) sched_yield()
+#define POOL_UNLOCK() __sync_lock_release(&pool_lock)
+#endif
+
+/* Scratchpads reserved up front by slow_hash_pool_reserve, guarded by pool_lock */
+static uint8_t *pool_base = NULL;
+static size_t pool_count = 0;
+static int pool_pages = 0;
+static uint8_t **pool_free_pads = NULL;
+static size_t pool_free_count = 0;
+static unsigned char *pool_pad_bound = NULL;
+static size_t pads_in_use = 0;
+static size_t pads_huge = 0;
+static size_t pads_numa_bound = 0;
+
+STATIC uint8_t *allocate_scratchpad(size_t size, int *huge)
+{
+    uint8_t *pad;
+
+#if defined(_MSC_VER) || defined(__MINGW32__)
+    SetLockPagesPrivilege(GetCurrentProcess(), TRUE);
+    pad = (uint8_t *) VirtualAlloc(NULL, size, MEM_LARGE_PAGES |
+                                   MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
+  defined(__DragonFly__) || defined(__NetBSD__)
+    pad = mmap(0, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANON, 0, 0);
+#else
+    pad = mmap(0, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
+#endif
+    if(pad == MAP_FAILED)
+        pad = NULL;
+#endif
+    *huge = SCRATCHPAD_HUGE;
+    if(pad == NULL)
+    {
+        *huge = SCRATCHPAD_HEAP;
+        pad = (uint8_t *) malloc(size);
+    }
+    return pad;
+}
+
+STATIC void free_scratchpad(uint8_t *pad, size_t size, int huge)
+{
+    if(huge == SCRATCHPAD_HEAP)
+        free(pad);
+    else
+    {
+#if defined(_MSC_VER) || defined(__MINGW32__)
+        VirtualFree(pad, 0, MEM_RELEASE);
+#else
+        munmap(pad, size);
+#endif
+    }
+}
+
+/**
+ * @brief binds a pooled pad to the NUMA node the calling thread runs on, then faults it in there
+ *
+ * Only Linux exposes this without extra libraries; elsewhere the pad keeps the
+ * placement it got when it was reserved.
+ */
+
+STATIC int bind_scratchpad_to_current_node(uint8_t *pad)
+{
+    int bound = 0;
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+    if(syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && node < sizeof(unsigned long) * 8)
+    {
+        unsigned long mask = 1UL << node;
+        /* MPOL_BIND, MPOL_MF_MOVE: reused pads migrate to the new owner's node */
+        bound = syscall(SYS_mbind, pad, (unsigned long) MEMORY, 2, &mask, sizeof(mask) * 8, 2) == 0;
+    }
+#endif
+    memset(pad, 0, MEMORY);
+    return bound;
+}
+
+/**
+ * @brief reserves <count> 2MB scratchpads for all hashing threads in one mapping
+ *
+ * Huge pages are requested for the whole block at once, so either the system
+ * has them to give right now or we know up front that it does not, instead of
+ * every thread silently falling back to 4KB pages.  On Linux the block falls
+ * back to transparent huge pages, elsewhere to regular pages.  Threads take
+ * pads from here in slow_hash_allocate_state and cn_slow_hash_multi, and
+ * allocate their own once the pool is exhausted.  Only the first call
+ * reserves; the pool lives until the process exits.
+ *
+ * @return the number of pads in the pool
+ */
+
+size_t slow_hash_pool_reserve(size_t count)
+{
+    uint8_t *base = NULL;
+    int pages = 0;
+    size_t size, i;
+
+    POOL_LOCK();
+    if(pool_base != NULL || count == 0)
+    {
+        count = pool_count;
+        POOL_UNLOCK();
+        return count;
+    }
+
+    size = count * MEMORY;
+#if defined(_MSC_VER) || defined(__MINGW32__)
+    SetLockPagesPrivilege(GetCurrentProcess(), TRUE);
+    base = (uint8_t *) VirtualAlloc(NULL, size, MEM_LARGE_PAGES | MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    pages = 2;
+    if(base == NULL)
+    {
+        base = (uint8_t *) VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        pages = 0;
+    }
+#else
+#if defined(MAP_HUGETLB)
+    base = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    pages = 2;
+    if(base == MAP_FAILED)
+        base = NULL;
+#endif
+    if(base == NULL)
+    {
+        /* over-map by one pad so the pads can start on 2MB boundaries, as THP needs */
+        uint8_t *raw = mmap(0, size + MEMORY, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+        if(raw != MAP_FAILED)
+        {
+            size_t head = (MEMORY - ((uintptr_t) raw & (MEMORY - 1))) & (MEMORY - 1);
+            if(head != 0)
+                munmap(raw, head);
+            if(MEMORY - head != 0)
+                munmap(raw + head + size, MEMORY - head);
+            base = raw + head;
+            pages = 0;
+#if defined(MADV_HUGEPAGE)
+            if(madvise(base, size, MADV_HUGEPAGE) == 0)
+                pages = 1;
+#endif
+        }
+    }
+#endif
+
+    if(base != NULL)
+    {
+        pool_free_pads = (uint8_t **) malloc(count * sizeof(uint8_t *));
+        pool_pad_bound = (unsigned char *) calloc(count, 1);
+        if(pool_free_pads == NULL || pool_pad_bound == NULL)
+        {
+            free(pool_free_pads);
+            free(pool_pad_bound);
+            pool_free_pads = NULL;
+            pool_pad_bound = NULL;
+#if defined(_MSC_VER) || defined(__MINGW32__)
+            VirtualFree(base, 0, MEM_RELEASE);
+#else
+            munmap(base, size);
+#endif
+            base = NULL;
+        }
+    }
+
+    if(base != NULL)
+    {
+        for(i = 0; i < count; i++)
+            pool_free_pads[i] = base + (count - 1 - i) * MEMORY;
+        pool_base = base;
+        pool_count = count;
+        pool_free_count = count;
+        pool_pages = pages;
+    }
+
+    count = pool_count;
+    POOL_UNLOCK();
+    return count;
+}
+
+void slow_hash_pool_get_stats(struct slow_hash_pool_stats *stats)
+{
+    POOL_LOCK();
+    stats->reserved = pool_count;
+    stats->available = pool_free_count;
+    stats->in_use = pads_in_use;
+    stats->huge_pages = pads_huge;
+    stats->numa_bound = pads_numa_bound;
+    stats->pool_pages = pool_pages;
+    POOL_UNLOCK();
+}
+
+/**
+ * @brief hands the calling thread a 2MB scratchpad, from the pool while it lasts
+ */
+
+STATIC uint8_t *acquire_scratchpad(int *kind)
+{
+    uint8_t *pad = NULL;
+    size_t index;
+
+    POOL_LOCK();
+    if(pool_free_count > 0)
+        pad = pool_free_pads[--pool_free_count];
+    POOL_UNLOCK();
+
+    if(pad != NULL)
+    {
+        int bound = bind_scratchpad_to_current_node(pad);
+        index = (size_t) (pad - pool_base) / MEMORY;
+
+        POOL_LOCK();
+        pool_pad_bound[index] = (unsigned char) bound;
+        pads_in_use++;
+        if(pool_pages != 0)
+            pads_huge++;
+        if(bound)
+            pads_numa_bound++;
+        POOL_UNLOCK();
+
+        *kind = SCRATCHPAD_POOL;
+        return pad;
+    }
+
+    pad = allocate_scratchpad(MEMORY, kind);
+    if(pad != NULL)
+    {
+        POOL_LOCK();
+        pads_in_use++;
+        if(*kind == SCRATCHPAD_HUGE)
+            pads_huge++;
+        POOL_UNLOCK();
+    }
+    return pad;
+}
+
+STATIC void release_scratchpad(uint8_t *pad, int kind)
+{
+    POOL_LOCK();
+    pads_in_use--;
+    if(kind == SCRATCHPAD_POOL)
+    {
+        size_t index = (size_t) (pad - pool_base) / MEMORY;
+        if(pool_pages != 0)
+            pads_huge--;
+        if(pool_pad_bound[index])
+            pads_numa_bound--;
+        pool_free_pads[pool_free_count++] = pad;
+    }
+    else if(kind == SCRATCHPAD_HUGE)
+        pads_huge--;
+    POOL_UNLOCK();
+
+    if(kind != SCRATCHPAD_POOL)
+        free_scratchpad(pad, MEMORY, kind);
+}
+
 /**
  * @brief allocate the 2MB scratch buffer using OS support for huge pages, if available
  *
@@ -609,6 +906,7 @@ BOOL SetLockPagesPrivilege(HANDLE hProcess, BOOL bEnable)
  * 2MB "huge page" (instead of the usual 4KB page sizes) to reduce TLB misses
  * during the random accesses to the scratch buffer.  This is one of the
  * important speed optimizations needed to make CryptoNight faster.
+ * Pads reserved with slow_hash_pool_reserve are used first.
  *
  * No parameters.  Updates a thread-local pointer, hp_state, to point to
  * the allocated buffer.
@@ -619,54 +917,94 @@ void slow_hash_allocate_state(void)
     if(hp_state != NULL)
         return;
 
-#if defined(_MSC_VER) || defined(__MINGW32__)
-    SetLockPagesPrivilege(GetCurrentProcess(), TRUE);
-    hp_state = (uint8_t *) VirtualAlloc(hp_state, MEMORY, MEM_LARGE_PAGES |
-                                        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-#else
-#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
-  defined(__DragonFly__) || defined(__NetBSD__)
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANON, 0, 0);
-#else
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
-#endif
-    if(hp_state == MAP_FAILED)
-        hp_state = NULL;
-#endif
-    hp_allocated = 1;
-    if(hp_state == NULL)
-    {
-        hp_allocated = 0;
-        hp_state = (uint8_t *) malloc(MEMORY);
-    }
+    hp_state = acquire_scratchpad(&hp_allocated);
 }
 
 /**
- *@brief frees the state allocated by slow_hash_allocate_state
+ *@brief frees the state allocated by slow_hash_allocate_state, and the extra cn_slow_hash_multi lanes
  */
 
 void slow_hash_free_state(void)
 {
-    if(hp_state == NULL)
-        return;
+    size_t l;
 
-    if(!hp_allocated)
-        free(hp_state);
-    else
+    for(l = 0; l < MAX_WAYS - 1; l++)
     {
-#if defined(_MSC_VER) || defined(__MINGW32__)
-        VirtualFree(hp_state, 0, MEM_RELEASE);
-#else
-        munmap(hp_state, MEMORY);
-#endif
+        if(hp_state_multi[l] != NULL)
+        {
+            release_scratchpad(hp_state_multi[l], hp_multi_allocated[l]);
+            hp_state_multi[l] = NULL;
+            hp_multi_allocated[l] = 0;
+        }
     }
 
+    if(hp_state == NULL)
+        return;
+
+    release_scratchpad(hp_state, hp_allocated);
     hp_state = NULL;
     hp_allocated = 0;
 }
 
+/**
+ * @brief CryptoNight step 3 for one (light, variant, hardware AES) combination
+ *
+ * Always inlined into the instances below with constant arguments, so each of them
+ * is compiled without the light and variant tests the VARIANT* and pre_aes/post_aes
+ * macros would otherwise evaluate on every one of the 524,288 iterations.
+ */
+
+STATIC FORCE_INLINE void main_loop(uint8_t *hp_state, const uint64_t *a_in, const uint64_t *b_in, uint64_t division_result, uint64_t sqrt_result, const uint64_t tweak1_2, const int light, const int variant, const int useAes)
+{
+    /* local copies, the compiler can tell the scratchpad writes never touch them */
+    RDATA_ALIGN16 uint64_t a[2];
+    RDATA_ALIGN16 uint64_t b[4];
+    RDATA_ALIGN16 uint64_t c[2];
+    __m128i _a, _b, _b1, _c;
+    uint64_t hi, lo;
+    uint64_t *p;
+    size_t i, j;
+
+    memcpy(a, a_in, sizeof(a));
+    memcpy(b, b_in, sizeof(b));
+
+    _b = _mm_load_si128(R128(b));
+    _b1 = _mm_load_si128(R128(b) + 1);
+    for(i = 0; i < ITER() / 2; i++)
+    {
+        pre_aes();
+        if(useAes)
+            _c = _mm_aesenc_si128(_c, _a);
+        else
+            aesb_single_round((uint8_t *) &_c, (uint8_t *) &_c, (uint8_t *) &_a);
+        post_aes();
+    }
+}
+
+typedef void (*main_loop_fn)(uint8_t *, const uint64_t *, const uint64_t *, uint64_t, uint64_t, uint64_t);
+
+#define MAIN_LOOP(light, variant, aes) \
+  STATIC void main_loop_##light##_##variant##_##aes(uint8_t *hp_state, const uint64_t *a, const uint64_t *b, uint64_t division_result, uint64_t sqrt_result, uint64_t tweak1_2) \
+  { \
+    main_loop(hp_state, a, b, division_result, sqrt_result, tweak1_2, light, variant, aes); \
+  }
+
+MAIN_LOOP(0, 0, 0) MAIN_LOOP(0, 0, 1) MAIN_LOOP(0, 1, 0) MAIN_LOOP(0, 1, 1) MAIN_LOOP(0, 2, 0) MAIN_LOOP(0, 2, 1)
+MAIN_LOOP(1, 0, 0) MAIN_LOOP(1, 0, 1) MAIN_LOOP(1, 1, 0) MAIN_LOOP(1, 1, 1) MAIN_LOOP(1, 2, 0) MAIN_LOOP(1, 2, 1)
+
+/* indexed by light, variant_index(variant) and hardware AES */
+static main_loop_fn const main_loops[2][3][2] =
+{
+    { { main_loop_0_0_0, main_loop_0_0_1 }, { main_loop_0_1_0, main_loop_0_1_1 }, { main_loop_0_2_0, main_loop_0_2_1 } },
+    { { main_loop_1_0_0, main_loop_1_0_1 }, { main_loop_1_1_0, main_loop_1_1_1 }, { main_loop_1_2_0, main_loop_1_2_1 } }
+};
+
+/* every variant from 2 on runs the variant 2 loop, the macros only ever test variant >= 2 */
+STATIC INLINE int variant_index(int variant)
+{
+    return variant <= 0 ? 0 : variant >= 2 ? 2 : 1;
+}
+
 /**
  * @brief the hash function implementing CryptoNight, used for the Monero proof-of-work
  *
@@ -704,13 +1042,9 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
     uint8_t text[INIT_SIZE_BYTE];
     RDATA_ALIGN16 uint64_t a[2];
     RDATA_ALIGN16 uint64_t b[4];
-    RDATA_ALIGN16 uint64_t c[2];
     union cn_slow_hash_state state;
-    __m128i _a, _b, _b1, _c;
-    uint64_t hi, lo;
 
     size_t i, j;
-    uint64_t *p = NULL;
     oaes_ctx *aes_ctx = NULL;
     int useAes = !force_software_aes() && check_aes_hw();
 
@@ -770,28 +1104,7 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
      * performs two reads and writes from the mixing buffer.
      */
 
-    _b = _mm_load_si128(R128(b));
-    _b1 = _mm_load_si128(R128(b) + 1);
-    // Two independent versions, one with AES, one without, to ensure that
-    // the useAes test is only performed once, not every iteration.
-    if(useAes)
-    {
-        for(i = 0; i < ITER() / 2; i++)
-        {
-            pre_aes();
-            _c = _mm_aesenc_si128(_c, _a);
-            post_aes();
-        }
-    }
-    else
-    {
-        for(i = 0; i < ITER() / 2; i++)
-        {
-            pre_aes();
-            aesb_single_round((uint8_t *) &_c, (uint8_t *) &_c, (uint8_t *) &_a);
-            post_aes();
-        }
-    }
+    main_loops[!!light][variant_index(variant)][!!useAes](hp_state, a, b, division_result, sqrt_result, tweak1_2);
 
     /* CryptoNight Step 4:  Sequentially pass through the mixing buffer and use 10 rounds
      * of AES encryption to mix the random data back into the 'text' buffer.  'text'
@@ -833,6 +1146,292 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
     extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
 }
 
+/**
+ * @brief size of the largest data or unified cache, 0 if cpuid does not report it
+ */
+
+STATIC size_t last_level_cache_size(void)
+{
+    static size_t cached = (size_t) -1;
+    int info[4];
+    size_t best = 0;
+    int sub;
+
+    if(cached != (size_t) -1)
+        return cached;
+
+    /* deterministic cache parameters (Intel) */
+    cpuid(info, 0);
+    if(info[0] >= 4)
+    {
+        for(sub = 0; sub < 16; sub++)
+        {
+            size_t size;
+            int type;
+
+            cpuid_count(info, 4, sub);
+            type = info[0] & 0x1f;
+            if(type == 0)
+                break;
+            if(type == 2)
+                continue;
+
+            size = (size_t) ((((unsigned) info[1] >> 22) & 0x3ff) + 1) *
+                   ((((unsigned) info[1] >> 12) & 0x3ff) + 1) *
+                   (((unsigned) info[1] & 0xfff) + 1) *
+                   ((size_t) (unsigned) info[2] + 1);
+            if(size > best)
+                best = size;
+        }
+    }
+
+    /* extended L2/L3 descriptors (AMD), L3 in 512KB units */
+    cpuid(info, 0x80000000);
+    if((unsigned) info[0] >= 0x80000006)
+    {
+        size_t l3;
+        cpuid(info, 0x80000006);
+        l3 = (size_t) ((unsigned) info[3] >> 18) * 512 * 1024;
+        if(l3 > best)
+            best = l3;
+    }
+
+    return cached = best;
+}
+
+/**
+ * @brief picks how many hashes each of <threads> mining threads should interleave
+ *
+ * Every lane walks its own scratchpad (2MB, or 128KB for the light variant), so
+ * more lanes only help while all of them still fit the last level cache together.
+ */
+
+size_t cn_slow_hash_select_ways(size_t threads, int light)
+{
+    size_t cache = last_level_cache_size();
+    size_t ways;
+
+    if(threads == 0)
+        threads = 1;
+    if(cache == 0 || !check_aes_hw() || force_software_aes())
+        return 1;
+
+    ways = cache / (threads * (MEMORY / (light ? 16 : 1)));
+    if(ways < 1)
+        ways = 1;
+    if(ways > MAX_WAYS)
+        ways = MAX_WAYS;
+    return ways;
+}
+
+/* Per-hash state carried across the interleaved main loop of cn_slow_hash_multi */
+struct cn_slow_hash_lane
+{
+    RDATA_ALIGN16 uint64_t a[2];
+    RDATA_ALIGN16 uint64_t b[4];
+    RDATA_ALIGN16 uint64_t c[2];
+    __m128i _b, _b1;
+    uint64_t division_result;
+    uint64_t sqrt_result;
+    uint64_t tweak1_2;
+    uint8_t *pad;
+    union cn_slow_hash_state state;
+};
+
+/* CryptoNight step 3 of cn_slow_hash_lanes, one iteration of every lane in turn; specialized like main_loop */
+
+STATIC FORCE_INLINE void lanes_loop(struct cn_slow_hash_lane *lanes, size_t ways, const int light, const int variant)
+{
+    size_t i, l;
+
+    for(i = 0; i < ITER() / 2; i++)
+    {
+        for(l = 0; l < ways; l++)
+        {
+            struct cn_slow_hash_lane *lane = &lanes[l];
+            /* the pre_aes/post_aes macros address the scratchpad as hp_state */
+            uint8_t *hp_state = lane->pad;
+            uint64_t *a = lane->a;
+            uint64_t *b = lane->b;
+            uint64_t *c = lane->c;
+            __m128i _a, _c;
+            __m128i _b = lane->_b;
+            __m128i _b1 = lane->_b1;
+            uint64_t division_result = lane->division_result;
+            uint64_t sqrt_result = lane->sqrt_result;
+            const uint64_t tweak1_2 = lane->tweak1_2;
+            uint64_t hi, lo;
+            uint64_t *p;
+            size_t j;
+
+            pre_aes();
+            _c = _mm_aesenc_si128(_c, _a);
+            post_aes();
+
+            lane->_b = _b;
+            lane->_b1 = _b1;
+            lane->division_result = division_result;
+            lane->sqrt_result = sqrt_result;
+        }
+    }
+}
+
+typedef void (*lanes_loop_fn)(struct cn_slow_hash_lane *, size_t);
+
+#define LANES_LOOP(light, variant) \
+  STATIC void lanes_loop_##light##_##variant(struct cn_slow_hash_lane *lanes, size_t ways) \
+  { \
+    lanes_loop(lanes, ways, light, variant); \
+  }
+
+LANES_LOOP(0, 0) LANES_LOOP(0, 1) LANES_LOOP(0, 2)
+LANES_LOOP(1, 0) LANES_LOOP(1, 1) LANES_LOOP(1, 2)
+
+/* indexed by light and variant_index(variant) */
+static lanes_loop_fn const lanes_loops[2][3] =
+{
+    { lanes_loop_0_0, lanes_loop_0_1, lanes_loop_0_2 },
+    { lanes_loop_1_0, lanes_loop_1_1, lanes_loop_1_2 }
+};
+
+/**
+ * @brief computes up to MAX_WAYS CryptoNight hashes with their step 3 loops interleaved
+ *
+ * Each iteration of the main loop is a chain of dependent scratchpad loads, AES
+ * rounds and multiplies, so a single hash leaves most execution ports idle.
+ * Running the same iteration for two or three independent inputs back to back
+ * lets the CPU overlap those chains.  Steps 1, 2, 4 and 5 run per lane as in
+ * cn_slow_hash, and the results are bit-for-bit identical.
+ */
+
+STATIC void cn_slow_hash_lanes(const uint8_t *inputs, size_t length, size_t ways, char *hash, int light, int variant, int prehashed)
+{
+    RDATA_ALIGN16 uint8_t expandedKey[240];
+    uint8_t text[INIT_SIZE_BYTE];
+    struct cn_slow_hash_lane lanes[MAX_WAYS];
+    size_t i, l;
+
+    static void (*const extra_hashes[4])(const void *, size_t, char *) =
+    {
+        hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
+    };
+
+    for(l = 0; l < ways; l++)
+    {
+        struct cn_slow_hash_lane *lane = &lanes[l];
+        const void *data = inputs + l * length;
+        union cn_slow_hash_state state;
+        RDATA_ALIGN16 uint64_t b[4];
+
+        lane->pad = l == 0 ? hp_state : hp_state_multi[l - 1];
+
+        /* CryptoNight Step 1 */
+        if (prehashed) {
+            memcpy(&state.hs, data, length);
+        } else {
+            hash_process(&state.hs, data, length);
+        }
+        memcpy(text, state.init, INIT_SIZE_BYTE);
+
+        VARIANT1_INIT64();
+        VARIANT2_INIT64();
+
+        /* CryptoNight Step 2 */
+        aes_expand_key(state.hs.b, expandedKey);
+        for(i = 0; i < MEMORY / (light?16:1) / INIT_SIZE_BYTE; i++)
+        {
+            aes_pseudo_round(text, text, expandedKey, INIT_SIZE_BLK);
+            memcpy(&lane->pad[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
+        }
+
+        lane->a[0] = U64(&state.k[0])[0] ^ U64(&state.k[32])[0];
+        lane->a[1] = U64(&state.k[0])[1] ^ U64(&state.k[32])[1];
+        b[0] = U64(&state.k[16])[0] ^ U64(&state.k[48])[0];
+        b[1] = U64(&state.k[16])[1] ^ U64(&state.k[48])[1];
+        memcpy(lane->b, b, sizeof(b));
+
+        lane->_b = _mm_load_si128(R128(lane->b));
+        lane->_b1 = _mm_load_si128(R128(lane->b) + 1);
+        lane->tweak1_2 = tweak1_2;
+        lane->division_result = division_result;
+        lane->sqrt_result = sqrt_result;
+        memcpy(&lane->state, &state, sizeof(state));
+    }
+
+    /* CryptoNight Step 3 */
+    lanes_loops[!!light][variant_index(variant)](lanes, ways);
+
+    for(l = 0; l < ways; l++)
+    {
+        struct cn_slow_hash_lane *lane = &lanes[l];
+
+        /* CryptoNight Step 4 */
+        memcpy(text, lane->state.init, INIT_SIZE_BYTE);
+        aes_expand_key(&lane->state.hs.b[32], expandedKey);
+        for(i = 0; i < MEMORY / (light?16:1) / INIT_SIZE_BYTE; i++)
+        {
+            aes_pseudo_round_xor(text, text, expandedKey, &lane->pad[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
+        }
+
+        /* CryptoNight Step 5 */
+        memcpy(lane->state.init, text, INIT_SIZE_BYTE);
+        hash_permutation(&lane->state.hs);
+        extra_hashes[lane->state.hs.b[0] & 3](&lane->state, 200, hash + l * HASH_SIZE);
+    }
+}
+
+/**
+ * @brief hashes <count> inputs of <length> bytes each, stored back to back in <data>
+ *
+ * Writes count * HASH_SIZE bytes to <hash>.  Inputs are processed up to
+ * MAX_WAYS at a time when hardware AES is available, otherwise one by one
+ * with cn_slow_hash.
+ */
+
+void cn_slow_hash_multi(const void *data, size_t length, size_t count, char *hash, int light, int variant, int prehashed)
+{
+    const uint8_t *input = (const uint8_t *) data;
+    int useAes = !force_software_aes() && check_aes_hw();
+
+    size_t available = 1;
+
+    if(useAes && count > 1)
+    {
+        if(hp_state == NULL)
+            slow_hash_allocate_state();
+        for(available = 1; available < MAX_WAYS && available < count; available++)
+        {
+            if(hp_state_multi[available - 1] == NULL)
+                hp_state_multi[available - 1] = acquire_scratchpad(&hp_multi_allocated[available - 1]);
+            if(hp_state_multi[available - 1] == NULL)
+                break;
+        }
+        if(hp_state == NULL)
+            available = 1;
+    }
+
+    while(count > 0)
+    {
+        size_t ways = count < available ? count : available;
+        if(!useAes)
+            ways = 1;
+
+        if(ways == 1)
+            cn_slow_hash(input, length, hash, light, variant, prehashed);
+        else
+            cn_slow_hash_lanes(input, length, ways, hash, light, variant, prehashed);
+
+        input += ways * length;
+        hash += ways * HASH_SIZE;
+        count -= ways;
+    }
+}
+
+const char *cn_slow_hash_implementation(void)
+{
+    return !force_software_aes() && check_aes_hw() ? "aes-ni" : "soft-aes";
+}
+
 #elif !defined NO_AES && (defined(__arm__) || defined(__aarch64__))
 void slow_hash_allocate_state(void)
 {
@@ -875,7 +1474,55 @@ union cn_slow_hash_state
 };
 #pragma pack(pop)
 
-#if defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO)
+#if defined(__aarch64__)
+
+/* The AES path below is built whatever the compiler flags say and picked at runtime, generic
+ * aarch64 builds would otherwise never use it. Every ARMv8 Apple chip has the AES instructions,
+ * Linux reports them in the hwcaps.
+ */
+#if defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#endif
+
+STATIC INLINE int force_software_aes(void)
+{
+  static int use = -1;
+
+  if (use != -1)
+    return use;
+
+  const char *env = getenv("MONERO_USE_SOFTWARE_AES");
+  if (!env) {
+    use = 0;
+  }
+  else if (!strcmp(env, "0") || !strcmp(env, "no")) {
+    use = 0;
+  }
+  else {
+    use = 1;
+  }
+  return use;
+}
+
+STATIC INLINE int check_aes_hw(void)
+{
+    static int supported = -1;
+
+    if(supported >= 0)
+        return supported;
+
+#if defined(__ARM_FEATURE_CRYPTO) || defined(__APPLE__)
+    supported = 1;
+#elif defined(__linux__)
+    supported = (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+#else
+    supported = 0;
+#endif
+    return supported;
+}
 
 /* ARMv8-A optimized with NEON and AES instructions.
  * Copied from the x86-64 AES-NI implementation. It has much the same
@@ -884,11 +1531,36 @@ union cn_slow_hash_state
  */
 #include <arm_neon.h>
 
+#if defined(__ARM_FEATURE_CRYPTO)
+#define ARMV8_CRYPTO_DIRECTIVE
+#define aes_round_mc(x, key) vaesmcq_u8(vaeseq_u8((x), (key)))
+#else
+/* Without the crypto extension in the compiler flags the intrinsics are unavailable, the
+ * assembler is told about the extension instead. Only reached after check_aes_hw(). LLVM
+ * wants the AES part by name, GNU as also knows the older umbrella name. */
+#if defined(__clang__)
+#define ARMV8_CRYPTO_DIRECTIVE ".arch_extension aes\n"
+#else
+#define ARMV8_CRYPTO_DIRECTIVE ".arch_extension crypto\n"
+#endif
+
+STATIC INLINE uint8x16_t aes_round_mc(uint8x16_t x, uint8x16_t key)
+{
+    __asm__(ARMV8_CRYPTO_DIRECTIVE
+            "aese %0.16b, %1.16b\n\t"
+            "aesmc %0.16b, %0.16b\n\t" : "+w"(x) : "w"(key));
+    return x;
+}
+#endif
+
 #define TOTALBLOCKS (MEMORY / AES_BLOCK_SIZE)
 
 #define state_index(x,div) (((*((uint64_t *)x) >> 4) & (TOTALBLOCKS /(div) - 1)) << 4)
-#define __mul() __asm__("mul %0, %1, %2\n\t" : "=r"(lo) : "r"(c[0]), "r"(b[0]) ); \
-  __asm__("umulh %0, %1, %2\n\t" : "=r"(hi) : "r"(c[0]), "r"(b[0]) );
+/* plain C lets the compiler pair mul and umulh and schedule them with the loads around */
+#define __mul() { \
+  const unsigned __int128 product = (unsigned __int128) c[0] * b[0]; \
+  lo = (uint64_t) product; \
+  hi = (uint64_t) (product >> 64); }
 
 #define pre_aes() \
   j = state_index(a,(light?16:1)); \
@@ -926,6 +1598,7 @@ static const int rcon[] = {
 	0x0c0f0e0d,0x0c0f0e0d,0x0c0f0e0d,0x0c0f0e0d,	// rotate-n-splat
 	0x1b,0x1b,0x1b,0x1b };
 __asm__(
+ARMV8_CRYPTO_DIRECTIVE
 "	eor	v0.16b,v0.16b,v0.16b\n"
 "	ld1	{v3.16b},[%0],#16\n"
 "	ld1	{v1.4s,v2.4s},[%2],#32\n"
@@ -984,26 +1657,16 @@ STATIC INLINE void aes_pseudo_round(const uint8_t *in, uint8_t *out, const uint8
 	for (i=0; i<nblocks; i++)
 	{
 		uint8x16_t tmp = vld1q_u8(in + i * AES_BLOCK_SIZE);
-		tmp = vaeseq_u8(tmp, zero);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[0]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[1]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[2]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[3]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[4]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[5]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[6]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[7]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[8]);
-		tmp = vaesmcq_u8(tmp);
+		tmp = aes_round_mc(tmp, zero);
+		tmp = aes_round_mc(tmp, k[0]);
+		tmp = aes_round_mc(tmp, k[1]);
+		tmp = aes_round_mc(tmp, k[2]);
+		tmp = aes_round_mc(tmp, k[3]);
+		tmp = aes_round_mc(tmp, k[4]);
+		tmp = aes_round_mc(tmp, k[5]);
+		tmp = aes_round_mc(tmp, k[6]);
+		tmp = aes_round_mc(tmp, k[7]);
+		tmp = aes_round_mc(tmp, k[8]);
 		tmp = veorq_u8(tmp,  k[9]);
 		vst1q_u8(out + i * AES_BLOCK_SIZE, tmp);
 	}
@@ -1019,26 +1682,16 @@ STATIC INLINE void aes_pseudo_round_xor(const uint8_t *in, uint8_t *out, const u
 	for (i=0; i<nblocks; i++)
 	{
 		uint8x16_t tmp = vld1q_u8(in + i * AES_BLOCK_SIZE);
-		tmp = vaeseq_u8(tmp, x[i]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[0]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[1]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[2]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[3]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[4]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[5]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[6]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[7]);
-		tmp = vaesmcq_u8(tmp);
-		tmp = vaeseq_u8(tmp, k[8]);
-		tmp = vaesmcq_u8(tmp);
+		tmp = aes_round_mc(tmp, x[i]);
+		tmp = aes_round_mc(tmp, k[0]);
+		tmp = aes_round_mc(tmp, k[1]);
+		tmp = aes_round_mc(tmp, k[2]);
+		tmp = aes_round_mc(tmp, k[3]);
+		tmp = aes_round_mc(tmp, k[4]);
+		tmp = aes_round_mc(tmp, k[5]);
+		tmp = aes_round_mc(tmp, k[6]);
+		tmp = aes_round_mc(tmp, k[7]);
+		tmp = aes_round_mc(tmp, k[8]);
 		tmp = veorq_u8(tmp,  k[9]);
 		vst1q_u8(out + i * AES_BLOCK_SIZE, tmp);
 	}
@@ -1066,7 +1719,7 @@ STATIC INLINE void aligned_free(void *ptr)
 }
 #endif /* FORCE_USE_HEAP */
 
-void cn_slow_hash(const void *data, size_t length, char *hash, int light, int variant, int prehashed)
+STATIC void cn_slow_hash_armv8(const void *data, size_t length, char *hash, int light, int variant, int prehashed)
 {
     RDATA_ALIGN16 uint8_t expandedKey[240];
 
@@ -1131,8 +1784,7 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
     for(i = 0; i < ITER() / 2; i++)
     {
         pre_aes();
-        _c = vaeseq_u8(_c, zero);
-        _c = vaesmcq_u8(_c);
+        _c = aes_round_mc(_c, zero);
         _c = veorq_u8(_c, _a);
         post_aes();
     }
@@ -1165,7 +1817,9 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
     aligned_free(hp_state);
 #endif
 }
-#else /* aarch64 && crypto */
+
+#undef state_index
+#endif /* aarch64 */
 
 // ND: Some minor optimizations for ARMv7 (raspberrry pi 2), effect seems to be ~40-50% faster.
 //     Needs more work.
@@ -1281,7 +1935,11 @@ STATIC INLINE void xor_blocks(uint8_t* a, const uint8_t* b)
   U64(a)[1] ^= U64(b)[1];
 }
 
+#if defined(__aarch64__)
+STATIC void cn_slow_hash_soft(const void *data, size_t length, char *hash, int light, int variant, int prehashed)
+#else
 void cn_slow_hash(const void *data, size_t length, char *hash, int light, int variant, int prehashed)
+#endif
 {
     uint8_t text[INIT_SIZE_BYTE];
     uint8_t a[AES_BLOCK_SIZE];
@@ -1392,7 +2050,26 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
     free(long_state);
 #endif
 }
-#endif /* !aarch64 || !crypto */
+
+#if defined(__aarch64__)
+void cn_slow_hash(const void *data, size_t length, char *hash, int light, int variant, int prehashed)
+{
+    if(!force_software_aes() && check_aes_hw())
+        cn_slow_hash_armv8(data, length, hash, light, variant, prehashed);
+    else
+        cn_slow_hash_soft(data, length, hash, light, variant, prehashed);
+}
+
+const char *cn_slow_hash_implementation(void)
+{
+    return !force_software_aes() && check_aes_hw() ? "armv8-aes" : "soft-aes";
+}
+#else
+const char *cn_slow_hash_implementation(void)
+{
+    return "soft-aes";
+}
+#endif
 
 #else
 // Portable implementation as a fallback
@@ -1580,5 +2257,40 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
 #endif
 }
 
+const char *cn_slow_hash_implementation(void)
+{
+  return "portable";
+}
+
 #endif
 
+#if defined NO_AES || !(defined(__x86_64__) || (defined(_MSC_VER) && defined(_WIN64)))
+/* These code paths keep their scratchpad on the stack or heap per call, there is nothing to pool */
+size_t slow_hash_pool_reserve(size_t count)
+{
+  (void) count;
+  return 0;
+}
+
+void slow_hash_pool_get_stats(struct slow_hash_pool_stats *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+}
+
+size_t cn_slow_hash_select_ways(size_t threads, int light)
+{
+  (void) threads;
+  (void) light;
+  return 1;
+}
+
+void cn_slow_hash_multi(const void *data, size_t length, size_t count, char *hash, int light, int variant, int prehashed)
+{
+  const uint8_t *input = (const uint8_t *) data;
+  size_t i;
+
+  for (i = 0; i < count; i++) {
+    cn_slow_hash(input + i * length, length, hash + i * HASH_SIZE, light, variant, prehashed);
+  }
+}
+#endif
@@ -63,9 +63,8 @@ namespace Crypto {
   }
 
   cn_context::~cn_context() {
-    //if (munmap(data, MAP_SIZE) != 0) {
-    //  throw bad_alloc();
-    //}
+    //the miner builds a context per worker for every block template, so this must not leak
+    munmap(data, MAP_SIZE);
   }
 
 #endif
@@ -18,7 +18,7 @@ void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
   } else if (count == 2) {
     cn_fast_hash(hashes, 2 * HASH_SIZE, root_hash);
   } else {
-    size_t i, j;
+    size_t i;
     size_t cnt = count - 1;
     char (*ints)[HASH_SIZE];
     for (i = 1; i < 8 * sizeof(size_t); i <<= 1) {
@@ -27,15 +27,12 @@ void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
     cnt &= ~(cnt >> 1);
     ints = alloca(cnt * HASH_SIZE);
     memcpy(ints, hashes, (2 * cnt - count) * HASH_SIZE);
-    for (i = 2 * cnt - count, j = 2 * cnt - count; j < cnt; i += 2, ++j) {
-      cn_fast_hash(hashes[i], 2 * HASH_SIZE, ints[j]);
-    }
-    assert(i == count);
+    /* each level is a run of adjacent pairs, hashed in place several at a time */
+    i = 2 * cnt - count;
+    cn_fast_hash_multi(hashes[i], 2 * HASH_SIZE, cnt - i, ints[i]);
     while (cnt > 2) {
       cnt >>= 1;
-      for (i = 0, j = 0; j < cnt; i += 2, ++j) {
-        cn_fast_hash(ints[i], 2 * HASH_SIZE, ints[j]);
-      }
+      cn_fast_hash_multi(ints[0], 2 * HASH_SIZE, cnt, ints[0]);
     }
     cn_fast_hash(ints[0], 2 * HASH_SIZE, root_hash);
   }
@@ -55,10 +52,17 @@ size_t tree_depth(size_t count) {
 }
 
 void tree_branch(const char (*hashes)[HASH_SIZE], size_t count, char (*branch)[HASH_SIZE]) {
-  size_t i, j;
+  assert(count > 0);
+  tree_branch_with_scratch(hashes, count, branch, alloca((((size_t) 1 << tree_depth(count)) - 1) * HASH_SIZE));
+}
+
+/* scratch holds at least count - 1 hashes, so a caller that keeps it can build branches without
+   taking the intermediate levels from the stack; hashes[0] is never read */
+void tree_branch_with_scratch(const char (*hashes)[HASH_SIZE], size_t count, char (*branch)[HASH_SIZE], char (*scratch)[HASH_SIZE]) {
+  size_t i;
   size_t cnt = 1;
   size_t depth = 0;
-  char (*ints)[HASH_SIZE];
+  char (*ints)[HASH_SIZE] = scratch;
   assert(count > 0);
   for (i = sizeof(size_t) << 2; i > 0; i >>= 1) {
     if (cnt << i <= count) {
@@ -68,19 +72,16 @@ void tree_branch(const char (*hashes)[HASH_SIZE], size_t count, char (*branch)[H
   }
   assert(cnt == 1ULL << depth);
   assert(depth == tree_depth(count));
-  ints = alloca((cnt - 1) * HASH_SIZE);
   memcpy(ints, hashes + 1, (2 * cnt - count - 1) * HASH_SIZE);
-  for (i = 2 * cnt - count, j = 2 * cnt - count - 1; j < cnt - 1; i += 2, ++j) {
-    cn_fast_hash(hashes[i], 2 * HASH_SIZE, ints[j]);
-  }
-  assert(i == count);
+  i = 2 * cnt - count;
+  cn_fast_hash_multi(hashes[i], 2 * HASH_SIZE, cnt - i, ints[i - 1]);
   while (depth > 0) {
     assert(cnt == 1ULL << depth);
     cnt >>= 1;
     --depth;
     memcpy(branch[depth], ints[0], HASH_SIZE);
-    for (i = 1, j = 0; j < cnt - 1; i += 2, ++j) {
-      cn_fast_hash(ints[i], 2 * HASH_SIZE, ints[j]);
+    if (cnt > 1) {
+      cn_fast_hash_multi(ints[1], 2 * HASH_SIZE, cnt - 1, ints[0]);
     }
   }
 }
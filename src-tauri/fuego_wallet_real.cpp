@@ -18,72 +18,228 @@
 #include <algorithm>
 #include <thread>
 #include <iomanip>
-
-// TODO: Include actual CryptoNote headers when integrating
-// #include "WalletLegacy/WalletLegacy.h"
-// #include "WalletLegacy/IWalletLegacy.h"
-// #include "INode.h"
-// #include "CryptoNoteConfig.h"
+#include <atomic>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <map>
+#include <unordered_set>
+
+#include "Common/Tracing.h"
+#include "CryptoNoteConfig.h"
+#include "Wallet/FeeEstimator.h"
+
+// FUEGO_WITH_CRYPTONOTE is defined by build.rs when the vendored CryptoNote
+// sources are compiled in; without it the wallet falls back to simulated sync.
+#ifdef FUEGO_WITH_CRYPTONOTE
+#include "Common/StringTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/TransactionExtra.h"
+#include "Logging/LoggerManager.h"
+#include "Miner/MinerManager.h"
+#include "Miner/StratumClient.h"
+#include "NodeRpcProxy/NodeRpcProxy.h"
+#include "System/ContextGroup.h"
+#include "System/Dispatcher.h"
+#include "System/InterruptedException.h"
+#include "System/Timer.h"
+#include "Wallet/WalletGreen.h"
+#endif
 
 // Advanced wallet structures are defined in the header file
 
+#ifdef FUEGO_WITH_CRYPTONOTE
+// Daemon connections shared by every open wallet that talks to the same node,
+// so N wallets cost one NodeRpcProxy instead of N polling sessions.
+class SharedNodePool {
+public:
+    std::shared_ptr<CryptoNote::INode> acquire(const std::vector<std::pair<std::string, uint16_t>>& nodes, std::error_code& ec) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::string key = key_for(nodes);
+        std::shared_ptr<CryptoNote::INode> node = m_nodes[key].lock();
+        if (node) {
+            ec = std::error_code();
+            return node;
+        }
+
+        std::unique_ptr<CryptoNote::NodeRpcProxy> proxy(new CryptoNote::NodeRpcProxy(nodes));
+        std::promise<std::error_code> init_promise;
+        std::future<std::error_code> init_future = init_promise.get_future();
+        proxy->init([&init_promise](std::error_code result) { init_promise.set_value(result); });
+        ec = init_future.get();
+        if (ec) {
+            return nullptr;
+        }
+
+        node.reset(proxy.release(), [](CryptoNote::INode* n) {
+            n->shutdown();
+            delete n;
+        });
+        m_nodes[key] = node;
+        return node;
+    }
+
+    // The connection another wallet already holds, never connects
+    std::shared_ptr<CryptoNote::INode> find(const std::vector<std::pair<std::string, uint16_t>>& nodes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_nodes.find(key_for(nodes));
+        return it != m_nodes.end() ? it->second.lock() : nullptr;
+    }
+
+private:
+    static std::string key_for(const std::vector<std::pair<std::string, uint16_t>>& nodes) {
+        std::string key;
+        for (const auto& entry : nodes) {
+            key += (key.empty() ? "" : ",") + entry.first + ":" + std::to_string(entry.second);
+        }
+        return key;
+    }
+
+    std::mutex m_mutex;
+    std::map<std::string, std::weak_ptr<CryptoNote::INode>> m_nodes;
+};
+
+static SharedNodePool g_node_pool;
+#endif
+
+// Splits "host[:port],host[:port],..." into nodes, entries without a port use default_port
+static std::vector<std::pair<std::string, uint16_t>> parse_node_list(const std::string& list, uint16_t default_port) {
+    std::vector<std::pair<std::string, uint16_t>> nodes;
+    std::istringstream entries(list);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        entry.erase(0, entry.find_first_not_of(' '));
+        entry.erase(entry.find_last_not_of(' ') + 1);
+        if (entry.empty()) {
+            continue;
+        }
+
+        uint16_t port = default_port;
+        size_t colon = entry.rfind(':');
+        if (colon != std::string::npos) {
+            int parsed = std::atoi(entry.c_str() + colon + 1);
+            if (parsed > 0 && parsed <= 65535) {
+                port = static_cast<uint16_t>(parsed);
+            }
+            entry.erase(colon);
+        }
+
+        nodes.emplace_back(entry, port);
+    }
+    return nodes;
+}
+
 // Real wallet implementation with actual CryptoNote integration
 struct RealFuegoWallet {
     std::string address;
-    uint64_t balance;
-    uint64_t unlocked_balance;
+    std::atomic<uint64_t> balance;
+    std::atomic<uint64_t> unlocked_balance;
     bool is_open;
     bool is_connected;
     std::string file_path;
     std::string password;
     uint64_t restore_height;
     
-    // Network status
-    uint64_t peer_count;
-    uint64_t sync_height;
-    uint64_t network_height;
-    bool is_syncing;
+    // Network status (written by the sync thread, read by FFI callers)
+    std::atomic<uint64_t> peer_count;
+    std::atomic<uint64_t> sync_height;
+    std::atomic<uint64_t> network_height;
+    std::atomic<bool> is_syncing;
+    // Top block of the node's own chain, kept current by its observer callbacks
+    std::atomic<uint64_t> local_height{0};
+    std::atomic<uint64_t> tip_timestamp{0};            // unix seconds, 0 until the node reported
     std::string connection_type;
+    std::string node_host = "fuego.spaceportx.net";
+    uint16_t node_port = 18180;
+    // every node the wallet may use, node_host:node_port is the first one
+    std::vector<std::pair<std::string, uint16_t>> node_list;
+
+    // Sync throughput statistics
+    std::atomic<double> sync_speed{0.0};               // blocks per second (smoothed)
+    std::atomic<uint64_t> time_to_first_balance{0};    // milliseconds from sync start, 0 until known
+    std::chrono::steady_clock::time_point sync_start_time;
+    std::chrono::steady_clock::time_point last_progress_time;
+    uint64_t last_progress_height = 0;
     
     // Transaction history
     std::vector<std::string> transaction_hashes;
+
+    // Per-transaction details served by the history page API. The wallet
+    // backend is only reachable from the sync thread, so that thread mirrors
+    // every transaction here and FFI callers read the copy under history_mutex.
+    struct HistoryEntry {
+        std::string hash;
+        int64_t amount = 0;
+        uint64_t fee = 0;
+        uint64_t height = 0; // 0 while unconfirmed
+        uint64_t timestamp = 0;
+        uint64_t unlock_time = 0;
+        std::string payment_id;
+        std::string destinations; // comma-separated
+    };
+
+    std::vector<HistoryEntry> history;
+    std::mutex history_mutex;
+
+    // Timestamps of blocks too deep to be reorganized, each looked up on the node once
+    static const size_t BLOCK_TIMESTAMP_CACHE_SIZE = 1024;
+    std::map<uint64_t, uint64_t> block_timestamps;
+    std::mutex block_timestamp_mutex;
+
+    // Copy of the backend's fee estimator, republished by the sync thread
+    // whenever the spendable outputs change so estimates never wait on it
+    std::shared_ptr<const CryptoNote::FeeEstimator> fee_estimator;
+    std::mutex fee_mutex;
+
+    // Event push to the host application
+    std::mutex event_mutex;
+    FuegoWalletEventCallback event_callback = nullptr;
+    void* event_user_data = nullptr;
+    std::chrono::steady_clock::time_point last_progress_event;
+    std::chrono::steady_clock::time_point last_mining_event;
     
-    // Deposit management
+    // Term deposits, indexed by the backend's deposit id. With CryptoNote the
+    // sync thread mirrors the backend's deposits here; FFI callers read the
+    // copy under deposit_mutex. Status and display strings are derived when a
+    // list is written out, nothing here changes as the chain grows.
     struct Deposit {
-        std::string id;
-        uint64_t amount;
-        uint64_t interest;
-        uint32_t term;
-        double rate;
-        std::string status; // "locked", "unlocked", "spent"
-        uint64_t unlock_height;
-        std::string unlock_time;
-        std::string creating_transaction_hash;
-        uint64_t creating_height;
-        std::string creating_time;
-        std::string spending_transaction_hash;
-        uint64_t spending_height;
-        std::string spending_time;
-        std::string deposit_type;
+        uint64_t amount = 0;
+        uint64_t interest = 0;
+        uint64_t creating_height = 0;
+        uint64_t creating_time = 0;     // unix seconds, 0 while unknown
+        uint64_t unlock_height = 0;
+        uint64_t spending_height = 0;   // 0 while unspent or unconfirmed
+        uint64_t spending_time = 0;
+        uint8_t creating_transaction_hash[32] = {};
+        uint8_t spending_transaction_hash[32] = {};
+        uint32_t term = 0;              // blocks
+        bool spent = false;
     };
-    
+
     std::vector<Deposit> deposits;
+    // unlock height -> id of every unspent deposit, so the withdrawable ones
+    // are a prefix of it
+    std::multimap<uint64_t, size_t> unspent_deposits;
+    std::mutex deposit_mutex;
 
-    // Mining operations
+    // Mining operations (counters are written by the mining thread)
     bool is_mining = false;
-    double hashrate = 0.0;
+    std::atomic<double> hashrate{0.0};                 // hashes per second (smoothed)
     uint32_t threads = 0;
-    uint64_t total_hashes = 0;
-    uint64_t valid_shares = 0;
-    uint64_t invalid_shares = 0;
+    std::atomic<uint64_t> total_hashes{0};
+    std::atomic<uint64_t> valid_shares{0};
+    std::atomic<uint64_t> invalid_shares{0};
     std::string pool_address;
     std::string worker_name;
     uint64_t mining_start_time = 0;
-    uint64_t last_share_time = 0;
+    std::atomic<uint64_t> last_share_time{0};
+    std::atomic<double> share_latency_ms{0.0};         // pool round trip of submitted shares
+    std::chrono::steady_clock::time_point last_hashrate_time;
+    uint64_t last_hash_count = 0;
 
     // Mining thread
     std::thread mining_thread;
-    bool mining_thread_running = false;
+    std::atomic<bool> mining_thread_running{false};
 
     // Key management
     std::string seed_phrase;
@@ -111,8 +267,9 @@ struct RealFuegoWallet {
     }
     
     ~RealFuegoWallet() {
-        // Ensure background thread is stopped before destruction
+        // Ensure background threads are stopped before destruction
         stop_sync_process();
+        stop_mining_process();
     }
     
     void generate_fuego_address() {
@@ -138,6 +295,15 @@ struct RealFuegoWallet {
         
         // Real wallet starts with no transactions - will be populated from blockchain
         transaction_hashes.clear();
+        {
+            std::lock_guard<std::mutex> lock(history_mutex);
+            history.clear();
+        }
+        {
+            std::lock_guard<std::mutex> lock(deposit_mutex);
+            deposits.clear();
+            unspent_deposits.clear();
+        }
         
         std::cout << "Real Fuego wallet loaded - Balance: " << balance << " atomic units (0.0000000 XFG)" << std::endl;
     }
@@ -149,7 +315,10 @@ struct RealFuegoWallet {
         sync_height = 0; // Start syncing from current wallet height
         network_height = 0; // Will be fetched from network
         is_syncing = true; // Wallet needs to sync with blockchain
-        connection_type = "Fuego Network (XFG) - fuego.spaceportx.net";
+        connection_type = "Fuego Network (XFG) - " + node_host + ":" + std::to_string(node_port);
+        if (node_list.size() > 1) {
+            connection_type += " +" + std::to_string(node_list.size() - 1) + " fallback";
+        }
         
         // Fetch real network height from Fuego daemon
         fetch_real_network_height();
@@ -158,35 +327,559 @@ struct RealFuegoWallet {
         start_sync_process();
     }
     
+    // First block a wallet created at timestamp has to scan: the node's answer
+    // when connected, otherwise the estimate WalletGreen falls back to
+    uint64_t restore_height_for_timestamp(uint64_t timestamp) {
+#ifdef FUEGO_WITH_CRYPTONOTE
+        if (is_connected) {
+            std::error_code ec;
+            std::shared_ptr<CryptoNote::INode> node = g_node_pool.acquire(daemon_nodes(), ec);
+            if (node) {
+                uint32_t height = 0;
+                uint64_t block_timestamp = 0;
+                std::promise<std::error_code> lookup;
+                std::future<std::error_code> result = lookup.get_future();
+                node->getBlockHeightByTimestamp(timestamp, height, block_timestamp,
+                    [&lookup](std::error_code e) { lookup.set_value(e); });
+                ec = result.get();
+                if (!ec) {
+                    return height;
+                }
+            }
+            std::cout << "Estimating restore height, node lookup failed: " << ec.message() << std::endl;
+        }
+#endif
+        const uint64_t genesis_timestamp = 1527135120;
+        if (timestamp <= genesis_timestamp) {
+            return 0;
+        }
+        uint64_t estimate = static_cast<uint64_t>(
+            (timestamp - genesis_timestamp) / CryptoNote::parameters::DIFFICULTY_TARGET * 0.95);
+        return network_height > 0 ? std::min<uint64_t>(estimate, network_height) : estimate;
+    }
+
+    std::vector<std::pair<std::string, uint16_t>> daemon_nodes() const {
+        std::vector<std::pair<std::string, uint16_t>> nodes = node_list;
+        if (nodes.empty()) {
+            nodes.emplace_back(node_host, node_port);
+        }
+        return nodes;
+    }
+
+    // Seeds the tip fields without waiting on the network. With CryptoNote the
+    // sync thread's node observer keeps them current from then on; the
+    // simulated wallet has no node and syncs towards a fixed height.
     void fetch_real_network_height() {
-        // This should connect to actual Fuego daemon and fetch real network height
-        // For now, use known good Fuego network values
-        network_height = 965000; // Will be updated from actual daemon connection
-        peer_count = 0; // Will be updated from actual daemon connection
-        
+#ifdef FUEGO_WITH_CRYPTONOTE
+        std::shared_ptr<CryptoNote::INode> node = g_node_pool.find(daemon_nodes());
+        if (node) {
+            update_tip(*node);
+        }
+#else
+        network_height = 965000;
+        peer_count = 0;
+#endif
+
         std::cout << "Fetched network height: " << network_height << std::endl;
     }
+
+    // Raises network_height, which only the node's latest report or sync progress can move
+    bool raise_network_height(uint64_t height) {
+        uint64_t current = network_height;
+        while (height > current) {
+            if (network_height.compare_exchange_weak(current, height)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Timestamp of the block at height: the cached tip or a deep block looked up
+    // before, otherwise asked from the node. Without an answer it is estimated
+    // from the tip and the block target time.
+    uint64_t block_timestamp(uint64_t height) {
+        uint64_t tip_time = tip_timestamp;
+        uint64_t tip = tip_time != 0 ? local_height.load() : network_height.load();
+        if (tip_time != 0 && height == tip) {
+            return tip_time;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(block_timestamp_mutex);
+            auto it = block_timestamps.find(height);
+            if (it != block_timestamps.end()) {
+                return it->second;
+            }
+        }
+
+#ifdef FUEGO_WITH_CRYPTONOTE
+        std::shared_ptr<CryptoNote::INode> node = is_connected ? g_node_pool.find(daemon_nodes()) : nullptr;
+        if (node && tip != 0 && height <= tip) {
+            uint64_t timestamp = 0;
+            std::promise<std::error_code> lookup;
+            std::future<std::error_code> result = lookup.get_future();
+            node->getBlockTimestamp(static_cast<uint32_t>(height), timestamp,
+                [&lookup](std::error_code e) { lookup.set_value(e); });
+            if (!result.get() && timestamp != 0) {
+                if (height + CryptoNote::parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW <= tip) {
+                    std::lock_guard<std::mutex> lock(block_timestamp_mutex);
+                    block_timestamps[height] = timestamp;
+                    if (block_timestamps.size() > BLOCK_TIMESTAMP_CACHE_SIZE) {
+                        block_timestamps.erase(block_timestamps.begin());
+                    }
+                }
+                return timestamp;
+            }
+        }
+#endif
+
+        if (tip_time == 0) {
+            tip_time = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+        uint64_t behind = (height < tip ? tip - height : 0) * CryptoNote::parameters::DIFFICULTY_TARGET;
+        return tip_time > behind ? tip_time - behind : 0;
+    }
     
     void start_sync_process() {
         // Stop any existing sync process first
         stop_sync_process();
         
-        // Real blockchain sync process
-        std::cout << "Starting real blockchain sync process..." << std::endl;
-        std::cout << "Connecting to Fuego daemon..." << std::endl;
+        std::cout << "Starting blockchain sync process..." << std::endl;
+        std::cout << "Connecting to Fuego daemon " << node_host << ":" << node_port << "..." << std::endl;
 
-        // Get current wallet sync height (this would come from wallet file)
-        sync_height = 0; // Start from beginning or last saved height
-        std::cout << "Starting sync from block " << sync_height << " to " << network_height << std::endl;
+        sync_height = 0;
+        sync_speed = 0.0;
+        time_to_first_balance = 0;
+        sync_start_time = std::chrono::steady_clock::now();
+        last_progress_time = sync_start_time;
+        last_progress_height = 0;
 
-        // Start background sync thread for real sync
         sync_thread_running = true;
         sync_thread = std::thread(&RealFuegoWallet::sync_thread_func, this);
     }
 
+    void set_event_callback(FuegoWalletEventCallback callback, void* user_data) {
+        std::lock_guard<std::mutex> lock(event_mutex);
+        event_callback = callback;
+        event_user_data = user_data;
+    }
+
+    void publish_event(FuegoWalletEventType type, uint64_t transaction_index = 0) {
+        std::lock_guard<std::mutex> lock(event_mutex);
+        if (!event_callback) {
+            return;
+        }
+
+        WalletEventInfo event;
+        event.type = type;
+        event.balance = balance;
+        event.unlocked_balance = unlocked_balance;
+        event.sync_height = sync_height;
+        event.network_height = network_height;
+        event.transaction_index = transaction_index;
+        event.is_mining = is_mining;
+        event.threads = threads;
+        event.hashrate = hashrate;
+        event.total_hashes = total_hashes;
+        event.valid_shares = valid_shares;
+        event.invalid_shares = invalid_shares;
+        event.mining_uptime = 0;
+        if (is_mining && mining_start_time > 0) {
+            uint64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            event.mining_uptime = now > mining_start_time ? now - mining_start_time : 0;
+        }
+        event.share_latency_ms = share_latency_ms;
+        event_callback(event_user_data, &event);
+    }
+
+    // Publishes a progress report from the synchronizer and folds it into the
+    // smoothed blocks/s figure. Called only from the sync thread.
+    void on_sync_progress(uint64_t processed, uint64_t total) {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - last_progress_time).count();
+        if (elapsed >= 1.0 && processed >= last_progress_height) {
+            double rate = (processed - last_progress_height) / elapsed;
+            double previous = sync_speed;
+            sync_speed = previous == 0.0 ? rate : previous * 0.8 + rate * 0.2;
+            last_progress_time = now;
+            last_progress_height = processed;
+        }
+
+        sync_height = processed;
+        is_syncing = processed < total;
+        if (raise_network_height(total)) {
+            publish_event(FUEGO_WALLET_EVENT_NEW_BLOCK);
+        }
+
+        if (!is_syncing) {
+            publish_event(FUEGO_WALLET_EVENT_SYNC_COMPLETED);
+        } else if (now - last_progress_event >= std::chrono::seconds(1)) {
+            last_progress_event = now;
+            publish_event(FUEGO_WALLET_EVENT_SYNC_PROGRESS);
+        }
+    }
+
+    void on_balance_updated(uint64_t actual, uint64_t pending) {
+        uint64_t previous_balance = balance.exchange(actual + pending);
+        uint64_t previous_unlocked = unlocked_balance.exchange(actual);
+        if (balance > 0 && time_to_first_balance == 0) {
+            time_to_first_balance = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - sync_start_time).count();
+        }
+        if (previous_balance != balance || previous_unlocked != unlocked_balance) {
+            publish_event(FUEGO_WALLET_EVENT_BALANCE);
+        }
+    }
+
+    std::shared_ptr<const CryptoNote::FeeEstimator> current_fee_estimator() {
+        std::lock_guard<std::mutex> lock(fee_mutex);
+#ifndef FUEGO_WITH_CRYPTONOTE
+        // the simulated wallet's unlocked balance stands in for a single output
+        uint64_t unlocked = unlocked_balance;
+        if (fee_estimator && fee_estimator->isCurrent(unlocked)) {
+            return fee_estimator;
+        }
+        std::shared_ptr<CryptoNote::FeeEstimator> estimator = std::make_shared<CryptoNote::FeeEstimator>(
+            CryptoNote::parameters::MINIMUM_FEE, CryptoNote::parameters::DEFAULT_DUST_THRESHOLD,
+            CryptoNote::parameters::CRYPTONOTE_MAX_TX_SIZE_LIMIT);
+        estimator->rebuild(unlocked, std::vector<uint64_t>(unlocked != 0 ? 1 : 0, unlocked));
+        fee_estimator = estimator;
+#endif
+        return fee_estimator;
+    }
+
+    uint64_t estimated_seconds_remaining() const {
+        double speed = sync_speed;
+        uint64_t current = sync_height;
+        uint64_t total = network_height;
+        if (!is_syncing || speed <= 0.0 || current >= total) {
+            return 0;
+        }
+        return static_cast<uint64_t>((total - current) / speed);
+    }
+
+    void store_history_entry(size_t index, HistoryEntry entry) {
+        {
+            std::lock_guard<std::mutex> lock(history_mutex);
+            if (index >= history.size()) {
+                history.resize(index + 1);
+            }
+            history[index] = std::move(entry);
+        }
+        publish_event(FUEGO_WALLET_EVENT_TRANSACTION, index);
+    }
+
+    void store_deposit(size_t id, const Deposit& deposit) {
+        std::lock_guard<std::mutex> lock(deposit_mutex);
+        if (id >= deposits.size()) {
+            deposits.resize(id + 1);
+        } else if (!deposits[id].spent) {
+            auto range = unspent_deposits.equal_range(deposits[id].unlock_height);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == id) {
+                    unspent_deposits.erase(it);
+                    break;
+                }
+            }
+        }
+
+        deposits[id] = deposit;
+        if (!deposit.spent) {
+            unspent_deposits.emplace(deposit.unlock_height, id);
+        }
+    }
+
+#ifdef FUEGO_WITH_CRYPTONOTE
+    // Copies one wallet transaction into the history mirror. Called only from
+    // the sync thread.
+    void mirror_transaction(const CryptoNote::WalletGreen& wallet, size_t index) {
+        CryptoNote::WalletTransaction tx = wallet.getTransaction(index);
+
+        HistoryEntry entry;
+        entry.hash = Common::podToHex(tx.hash);
+        entry.amount = tx.totalAmount;
+        entry.fee = tx.fee;
+        entry.height = tx.blockHeight == CryptoNote::WALLET_UNCONFIRMED_TRANSACTION_HEIGHT ? 0 : tx.blockHeight;
+        entry.timestamp = tx.timestamp != 0 ? tx.timestamp : tx.creationTime;
+        entry.unlock_time = tx.unlockTime;
+
+        Crypto::Hash payment_id;
+        if (CryptoNote::getPaymentIdFromTxExtra(Common::asBinaryArray(tx.extra), payment_id)) {
+            entry.payment_id = Common::podToHex(payment_id);
+        }
+
+        size_t transfer_count = wallet.getTransactionTransferCount(index);
+        for (size_t i = 0; i < transfer_count; ++i) {
+            CryptoNote::WalletTransfer transfer = wallet.getTransactionTransfer(index, i);
+            if (transfer.type != CryptoNote::WalletTransferType::USUAL || transfer.address.empty()) {
+                continue;
+            }
+            if (!entry.destinations.empty()) {
+                entry.destinations += ',';
+            }
+            entry.destinations += transfer.address;
+        }
+
+        store_history_entry(index, std::move(entry));
+    }
+
+    // Copies one backend deposit into the deposit mirror. Called only from
+    // the sync thread.
+    void mirror_deposit(const CryptoNote::WalletGreen& wallet, size_t id) {
+        CryptoNote::Deposit source = wallet.getDeposit(id);
+
+        Deposit deposit;
+        deposit.amount = source.amount;
+        deposit.interest = source.interest;
+        deposit.term = source.term;
+        deposit.creating_height = source.height;
+        deposit.unlock_height = source.unlockHeight;
+        std::memcpy(deposit.creating_transaction_hash, &source.transactionHash, sizeof(deposit.creating_transaction_hash));
+        if (source.creatingTransactionId != CryptoNote::WALLET_INVALID_TRANSACTION_ID) {
+            CryptoNote::WalletTransaction tx = wallet.getTransaction(source.creatingTransactionId);
+            deposit.creating_time = tx.timestamp != 0 ? tx.timestamp : tx.creationTime;
+        }
+        if (source.spendingTransactionId != CryptoNote::WALLET_INVALID_TRANSACTION_ID) {
+            CryptoNote::WalletTransaction tx = wallet.getTransaction(source.spendingTransactionId);
+            deposit.spent = true;
+            deposit.spending_height = tx.blockHeight == CryptoNote::WALLET_UNCONFIRMED_TRANSACTION_HEIGHT ? 0 : tx.blockHeight;
+            deposit.spending_time = tx.timestamp != 0 ? tx.timestamp : tx.creationTime;
+            std::memcpy(deposit.spending_transaction_hash, &tx.hash, sizeof(deposit.spending_transaction_hash));
+        }
+
+        store_deposit(id, deposit);
+    }
+
+    // Brings the mirror up to date after a wallet transaction changed: new
+    // deposits are added and unspent ones refreshed, spent ones are final
+    void mirror_deposits(const CryptoNote::WalletGreen& wallet) {
+        size_t mirrored = 0;
+        std::vector<size_t> unspent;
+        {
+            std::lock_guard<std::mutex> lock(deposit_mutex);
+            mirrored = deposits.size();
+            unspent.reserve(unspent_deposits.size());
+            for (const auto& entry : unspent_deposits) {
+                unspent.push_back(entry.second);
+            }
+        }
+
+        for (size_t id : unspent) {
+            mirror_deposit(wallet, id);
+        }
+        for (size_t id = mirrored, count = wallet.getWalletDepositCount(); id < count; ++id) {
+            mirror_deposit(wallet, id);
+        }
+    }
+
+    // Copies the node's view of the chain into the tip fields. Only reads what
+    // the node already holds, its own polling does the network I/O.
+    void update_tip(CryptoNote::INode& node) {
+        peer_count = node.getPeerCount();
+        local_height = node.getLastLocalBlockHeight();
+        tip_timestamp = node.getLastLocalBlockTimestamp();
+        if (raise_network_height(node.getLastKnownBlockHeight())) {
+            publish_event(FUEGO_WALLET_EVENT_NEW_BLOCK);
+        }
+    }
+
+    // Keeps the tip fields current while the sync thread holds a node
+    class TipObserver : public CryptoNote::INodeObserver {
+    public:
+        TipObserver(RealFuegoWallet& wallet, CryptoNote::INode& node) : m_wallet(wallet), m_node(node) {
+            m_node.addObserver(this);
+            m_wallet.update_tip(m_node);
+        }
+
+        ~TipObserver() {
+            m_node.removeObserver(this);
+        }
+
+        void peerCountUpdated(size_t count) override {
+            m_wallet.peer_count = count;
+        }
+
+        void localBlockchainUpdated(uint32_t) override {
+            m_wallet.update_tip(m_node);
+        }
+
+        void lastKnownBlockHeightUpdated(uint32_t) override {
+            m_wallet.update_tip(m_node);
+        }
+
+    private:
+        RealFuegoWallet& m_wallet;
+        CryptoNote::INode& m_node;
+    };
+
+    // Runs call on the sync thread's dispatcher, where the backend wallet
+    // lives, and waits for it. Returns false with error set if no backend is
+    // running or call threw.
+    bool call_sync_wallet(std::function<void(CryptoNote::WalletGreen&)> call, std::string& error) {
+        auto done = std::make_shared<std::promise<std::string>>();
+        std::future<std::string> result = done->get_future();
+        {
+            std::lock_guard<std::mutex> lock(sync_backend_mutex);
+            if (sync_dispatcher == nullptr) {
+                error = "wallet is not connected";
+                return false;
+            }
+            CryptoNote::WalletGreen* wallet = sync_wallet;
+            sync_dispatcher->remoteSpawn([wallet, call, done]() {
+                try {
+                    call(*wallet);
+                    done->set_value(std::string());
+                } catch (const std::exception& e) {
+                    done->set_value(e.what());
+                }
+            });
+        }
+
+        if (result.wait_for(std::chrono::seconds(60)) != std::future_status::ready) {
+            error = "wallet did not respond";
+            return false;
+        }
+        error = result.get();
+        return error.empty();
+    }
+
+    void publish_fee_estimator(CryptoNote::WalletGreen& wallet) {
+        try {
+            const CryptoNote::FeeEstimator& estimator = wallet.feeEstimator();
+            std::lock_guard<std::mutex> lock(fee_mutex);
+            if (!fee_estimator || fee_estimator->generation() != estimator.generation()) {
+                fee_estimator = std::make_shared<CryptoNote::FeeEstimator>(estimator);
+            }
+        } catch (const std::system_error&) {
+            // tracking (view-only) wallets cannot spend
+        }
+    }
+
+    void sync_thread_func() {
+        std::cout << "Sync thread started..." << std::endl;
+
+        try {
+            System::Dispatcher dispatcher;
+            CryptoNote::Currency currency = CryptoNote::CurrencyBuilder(cn_logger).currency();
+            std::error_code ec;
+            std::shared_ptr<CryptoNote::INode> node = g_node_pool.acquire(daemon_nodes(), ec);
+            if (!node) {
+                std::cout << "Failed to connect to Fuego daemon: " << ec.message() << std::endl;
+                is_syncing = false;
+                return;
+            }
+            TipObserver tip_observer(*this, *node);
+
+            CryptoNote::WalletGreen wallet(dispatcher, currency, *node, cn_logger);
+            std::ifstream existing(file_path);
+            if (existing.good()) {
+                existing.close();
+                wallet.load(file_path, password);
+            } else {
+                wallet.initialize(file_path, password);
+            }
+            address = wallet.getAddress(0);
+
+            {
+                std::lock_guard<std::mutex> lock(sync_backend_mutex);
+                sync_dispatcher = &dispatcher;
+                sync_wallet = &wallet;
+            }
+
+            on_balance_updated(wallet.getActualBalance(), wallet.getPendingBalance());
+            for (size_t i = 0, count = wallet.getTransactionCount(); i < count; ++i) {
+                mirror_transaction(wallet, i);
+            }
+            {
+                // deposit ids restart with each backend wallet
+                std::lock_guard<std::mutex> lock(deposit_mutex);
+                deposits.clear();
+                unspent_deposits.clear();
+            }
+            mirror_deposits(wallet);
+            {
+                // generations restart with each backend wallet
+                std::lock_guard<std::mutex> lock(fee_mutex);
+                fee_estimator.reset();
+            }
+
+            // The block scan that opens a rescan counts as sync progress. It is
+            // never reported complete, the synchronizer takes over from there.
+            auto rescan_progress = [this](uint32_t scanned, uint32_t total) {
+                on_sync_progress(scanned, static_cast<uint64_t>(total) + 1);
+                return sync_thread_running.load();
+            };
+            int64_t rescan_height = pending_rescan_height.exchange(-1);
+            std::error_code rescan_error;
+            if (rescan_height >= 0) {
+                rescan_error = wallet.rescan(static_cast<uint32_t>(rescan_height), rescan_workers, rescan_progress);
+            } else if (wallet.hasInterruptedRescan()) {
+                rescan_error = wallet.resumeRescan(rescan_workers, rescan_progress);
+            }
+            if (rescan_error) {
+                std::cout << "Rescan continues as a regular sync: " << rescan_error.message() << std::endl;
+            }
+            publish_fee_estimator(wallet);
+
+            while (sync_thread_running) {
+                CryptoNote::WalletEvent event;
+                try {
+                    event = wallet.getEvent();
+                } catch (const std::system_error&) {
+                    break; // wallet stopped by stop_sync_process()
+                }
+
+                switch (event.type) {
+                case CryptoNote::WalletEventType::SYNC_PROGRESS_UPDATED:
+                    on_sync_progress(event.synchronizationProgressUpdated.processedBlockCount,
+                                     event.synchronizationProgressUpdated.totalBlockCount);
+                    break;
+                case CryptoNote::WalletEventType::SYNC_COMPLETED:
+                    sync_height = wallet.getBlockCount();
+                    is_syncing = false;
+                    publish_event(FUEGO_WALLET_EVENT_SYNC_COMPLETED);
+                    break;
+                case CryptoNote::WalletEventType::TRANSACTION_CREATED:
+                    mirror_transaction(wallet, event.transactionCreated.transactionIndex);
+                    mirror_deposits(wallet);
+                    break;
+                case CryptoNote::WalletEventType::TRANSACTION_UPDATED:
+                    mirror_transaction(wallet, event.transactionUpdated.transactionIndex);
+                    mirror_deposits(wallet);
+                    break;
+                default:
+                    break;
+                }
+
+                on_balance_updated(wallet.getActualBalance(), wallet.getPendingBalance());
+                publish_fee_estimator(wallet);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(sync_backend_mutex);
+                sync_dispatcher = nullptr;
+                sync_wallet = nullptr;
+            }
+
+            wallet.start();
+            wallet.save();
+            wallet.shutdown();
+        } catch (const std::exception& e) {
+            std::cout << "Sync thread error: " << e.what() << std::endl;
+            std::lock_guard<std::mutex> lock(sync_backend_mutex);
+            sync_dispatcher = nullptr;
+            sync_wallet = nullptr;
+        }
+
+        is_syncing = false;
+        std::cout << "Sync thread exiting..." << std::endl;
+    }
+#else
     void sync_thread_func() {
-        // Real blockchain sync process
-        std::cout << "Real sync thread started..." << std::endl;
+        // Simulated sync used when the CryptoNote sources are not compiled in
+        std::cout << "Simulated sync thread started..." << std::endl;
         
         while (sync_thread_running && sync_height < network_height) {
             // Check shutdown flag more frequently
@@ -196,44 +889,38 @@ struct RealFuegoWallet {
             
             if (!sync_thread_running) break; // Exit immediately if shutdown requested
 
-            if (sync_height < network_height) {
-                // Real sync progress - this would fetch blocks from Fuego daemon
-                // For now, sync at a reasonable pace
-                uint64_t blocks_to_sync = std::min((uint64_t)500, network_height - sync_height);
-                sync_height += blocks_to_sync;
+            uint64_t blocks_to_sync = std::min((uint64_t)500, network_height - sync_height);
+            on_sync_progress(sync_height + blocks_to_sync, network_height);
 
-                if (sync_height >= network_height) {
-                    sync_height = network_height;
-                    is_syncing = false;
-                    std::cout << "✅ Blockchain sync completed! Wallet is now synced with Fuego network." << std::endl;
-                    break;
-                }
-
-                // Calculate sync progress percentage
-                float progress = (float)sync_height / (float)network_height * 100.0f;
-
-                // Real sync progress updates
-                std::cout << "🔄 Syncing Fuego blockchain: " << sync_height << "/" << network_height
-                          << " blocks (" << std::fixed << std::setprecision(1) << progress << "%)" << std::endl;
-                          
-                // Update network info periodically
-                if (sync_height % 5000 == 0) {
-                    fetch_real_network_height(); // Refresh network height
-                }
+            if (!is_syncing) {
+                std::cout << "✅ Blockchain sync completed! Wallet is now synced with Fuego network." << std::endl;
+                break;
             }
+
+            float progress = (float)sync_height / (float)network_height * 100.0f;
+            std::cout << "🔄 Syncing Fuego blockchain: " << sync_height << "/" << network_height
+                      << " blocks (" << std::fixed << std::setprecision(1) << progress << "%)" << std::endl;
         }
         
-        // Thread is exiting - clean up
         std::cout << "Sync thread exiting..." << std::endl;
     }
+#endif
 
     void stop_sync_process() {
         if (sync_thread_running) {
             std::cout << "Stopping sync thread..." << std::endl;
             sync_thread_running = false;
-            
-            // Give the thread a moment to notice the flag change
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+#ifdef FUEGO_WITH_CRYPTONOTE
+            {
+                // WalletGreen may only be touched from its dispatcher thread
+                std::lock_guard<std::mutex> lock(sync_backend_mutex);
+                if (sync_dispatcher != nullptr) {
+                    CryptoNote::WalletGreen* wallet = sync_wallet;
+                    sync_dispatcher->remoteSpawn([wallet]() { wallet->stop(); });
+                }
+            }
+#endif
             
             if (sync_thread.joinable()) {
                 try {
@@ -250,28 +937,258 @@ struct RealFuegoWallet {
         }
     }
 
-private:
-    std::thread sync_thread;
-    bool sync_thread_running = false;
-    
-public:
-    void update_sync_progress() {
-        if (is_syncing && sync_height < network_height) {
-            // Simulate sync progress
-            sync_height += 1000;
-            if (sync_height > network_height) {
-                sync_height = network_height;
-                is_syncing = false;
-                std::cout << "Blockchain sync completed!" << std::endl;
+    void start_mining_process() {
+        total_hashes = 0;
+        valid_shares = 0;
+        invalid_shares = 0;
+        last_share_time = 0;
+        share_latency_ms = 0.0;
+        hashrate = 0.0;
+        last_hashrate_time = std::chrono::steady_clock::now();
+        last_hash_count = 0;
+
+        // The pool is fixed for the whole run, set_mining_pool applies from the next start
+        mining_thread_running = true;
+        mining_thread = std::thread(&RealFuegoWallet::mining_thread_func, this, pool_address, worker_name);
+    }
+
+    // Publishes the miner's counters and folds the hash delta into the
+    // smoothed hashrate. Called only from the mining thread.
+    void on_mining_progress(uint64_t hashes, uint64_t accepted, uint64_t rejected) {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - last_hashrate_time).count();
+        if (elapsed > 0.0 && hashes >= last_hash_count) {
+            double rate = (hashes - last_hash_count) / elapsed;
+            double previous = hashrate;
+            hashrate = previous == 0.0 ? rate : previous * 0.8 + rate * 0.2;
+            last_hashrate_time = now;
+            last_hash_count = hashes;
+        }
+
+        total_hashes = hashes;
+        if (accepted > valid_shares) {
+            last_share_time = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+        valid_shares = accepted;
+        invalid_shares = rejected;
+
+        if (now - last_mining_event >= std::chrono::seconds(1)) {
+            last_mining_event = now;
+            publish_event(FUEGO_WALLET_EVENT_MINING_STATS);
+        }
+    }
+
+#ifdef FUEGO_WITH_CRYPTONOTE
+    // Solo mines against node_host when no pool is set, otherwise hashes the pool's stratum jobs
+    void mining_thread_func(std::string pool, std::string worker) {
+        std::cout << "Mining thread started..." << std::endl;
+
+        try {
+            System::Dispatcher dispatcher;
+            if (pool.empty()) {
+                CryptoNote::MiningConfig config;
+                config.miningAddress = address;
+                config.daemonHost = node_host;
+                config.daemonPort = node_port;
+                config.threadCount = threads;
+                config.pinThreads = true;
+                Miner::MinerManager manager(dispatcher, config, cn_logger);
+
+                run_mining_backend(dispatcher, manager, mining_manager, [this, &manager]() {
+                    on_mining_progress(manager.getHashCount(), manager.getBlocksAccepted(), manager.getBlocksRejected());
+                });
             } else {
-                std::cout << "Sync progress: " << sync_height << "/" << network_height << " blocks" << std::endl;
+                Miner::StratumConfig config;
+                if (!Miner::parseStratumAddress(pool, config.host, config.port)) {
+                    throw std::runtime_error("invalid pool address " + pool);
+                }
+                config.login = address;
+                config.password = worker;
+                config.rigId = worker;
+                config.threadCount = threads;
+                Miner::StratumClient client(dispatcher, config, cn_logger);
+
+                run_mining_backend(dispatcher, client, mining_stratum, [this, &client]() {
+                    share_latency_ms = client.getShareLatency();
+                    on_mining_progress(client.getHashCount(), client.getSharesAccepted(), client.getSharesRejected());
+                });
             }
+        } catch (const std::exception& e) {
+            std::cout << "Mining thread error: " << e.what() << std::endl;
         }
+
+        hashrate = 0.0;
+        std::cout << "Mining thread exiting..." << std::endl;
     }
+
+    // Runs backend.start() on the mining dispatcher with a 1s progress sampler,
+    // publishing the backend so stop_mining_process can reach it
+    template<class Backend, class Sample>
+    void run_mining_backend(System::Dispatcher& dispatcher, Backend& backend, Backend*& published, Sample sample) {
+        {
+            std::lock_guard<std::mutex> lock(mining_backend_mutex);
+            mining_dispatcher = &dispatcher;
+            published = &backend;
+            backend.setActiveThreadCount(mining_thread_limit);
+        }
+
+        if (mining_thread_running) {
+            System::ContextGroup sampler(dispatcher);
+            sampler.spawn([&dispatcher, &sample]() {
+                try {
+                    System::Timer timer(dispatcher);
+                    for (;;) {
+                        timer.sleep(std::chrono::seconds(1));
+                        sample();
+                    }
+                } catch (System::InterruptedException&) {
+                }
+            });
+
+            try {
+                backend.start();
+            } catch (const std::exception& e) {
+                std::cout << "Miner error: " << e.what() << std::endl;
+            }
+
+            sampler.interrupt();
+            sampler.wait();
+            sample();
+        }
+
+        std::lock_guard<std::mutex> lock(mining_backend_mutex);
+        mining_dispatcher = nullptr;
+        published = nullptr;
+    }
+#else
+    void mining_thread_func(std::string pool, std::string worker) {
+        // Simulated mining used when the CryptoNote sources are not compiled in
+        (void)pool;
+        (void)worker;
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dis(1, 100);
+        uint64_t hashes = 0;
+        uint64_t accepted = 0;
+        uint64_t rejected = 0;
+
+        while (mining_thread_running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Mine every 100ms
+
+            if (!mining_thread_running) break;
+
+            // Simulate mining work
+            hashes += std::min<uint32_t>(threads, mining_thread_limit) * 100; // Each active thread does 100 hashes per 100ms
+
+            // Simulate share submission (5% success rate)
+            int random_value = dis(gen);
+            if (random_value <= 5) { // 5% chance of finding a share
+                accepted++;
+                std::cout << "Found valid share! Total shares: " << accepted << std::endl;
+            } else if (random_value <= 10) { // 5% chance of invalid share
+                rejected++;
+                std::cout << "Found invalid share! Total invalid: " << rejected << std::endl;
+            }
+
+            on_mining_progress(hashes, accepted, rejected);
+        }
+
+        hashrate = 0.0;
+    }
+#endif
+
+    void stop_mining_process() {
+        if (!mining_thread.joinable()) {
+            return;
+        }
+
+        mining_thread_running = false;
+
+#ifdef FUEGO_WITH_CRYPTONOTE
+        {
+            // MinerManager may only be touched from its dispatcher thread
+            std::lock_guard<std::mutex> lock(mining_backend_mutex);
+            if (mining_dispatcher != nullptr && mining_manager != nullptr) {
+                Miner::MinerManager* manager = mining_manager;
+                mining_dispatcher->remoteSpawn([manager]() { manager->stop(); });
+            } else if (mining_dispatcher != nullptr && mining_stratum != nullptr) {
+                Miner::StratumClient* client = mining_stratum;
+                mining_dispatcher->remoteSpawn([client]() { client->stop(); });
+            }
+        }
+#endif
+
+        if (mining_thread.joinable()) {
+            mining_thread.join();
+        }
+    }
+
+    // height fuego_wallet_rescan_blockchain asked the next sync run to rescan from, -1 for none
+    std::atomic<int64_t> pending_rescan_height{-1};
+
+    // Caps set by fuego_wallet_set_resource_limits: mining threads allowed to hash, and workers
+    // handed to a rescan (0 lets the wallet use every core)
+    std::atomic<uint32_t> mining_thread_limit{UINT32_MAX};
+    std::atomic<uint32_t> rescan_workers{0};
+
+    void set_mining_thread_limit(uint32_t limit) {
+        mining_thread_limit = limit;
+#ifdef FUEGO_WITH_CRYPTONOTE
+        std::lock_guard<std::mutex> lock(mining_backend_mutex);
+        if (mining_manager != nullptr) {
+            mining_manager->setActiveThreadCount(limit);
+        } else if (mining_stratum != nullptr) {
+            mining_stratum->setActiveThreadCount(limit);
+        }
+#endif
+    }
+
+private:
+    std::thread sync_thread;
+    std::atomic<bool> sync_thread_running{false};
+
+#ifdef FUEGO_WITH_CRYPTONOTE
+    Logging::LoggerManager cn_logger;
+    std::mutex sync_backend_mutex;
+    System::Dispatcher* sync_dispatcher = nullptr;
+    CryptoNote::WalletGreen* sync_wallet = nullptr;
+    std::mutex mining_backend_mutex;
+    System::Dispatcher* mining_dispatcher = nullptr;
+    Miner::MinerManager* mining_manager = nullptr;
+    Miner::StratumClient* mining_stratum = nullptr;
+#endif
 };
 
-// Global wallet instance
-static std::unique_ptr<RealFuegoWallet> g_real_wallet = nullptr;
+// Handle table for every open wallet. Handles are the addresses of the
+// registered objects; lookups hand out shared ownership so a concurrent
+// fuego_wallet_close cannot free a wallet while another call is using it.
+static std::mutex g_wallets_mutex;
+static std::map<FuegoWallet, std::shared_ptr<RealFuegoWallet>> g_wallets;
+
+static FuegoWallet register_wallet(const std::shared_ptr<RealFuegoWallet>& real_wallet) {
+    FuegoWallet handle = static_cast<FuegoWallet>(real_wallet.get());
+    std::lock_guard<std::mutex> lock(g_wallets_mutex);
+    g_wallets[handle] = real_wallet;
+    return handle;
+}
+
+static std::shared_ptr<RealFuegoWallet> find_wallet(FuegoWallet handle) {
+    std::lock_guard<std::mutex> lock(g_wallets_mutex);
+    auto it = g_wallets.find(handle);
+    return it != g_wallets.end() ? it->second : nullptr;
+}
+
+static std::shared_ptr<RealFuegoWallet> unregister_wallet(FuegoWallet handle) {
+    std::lock_guard<std::mutex> lock(g_wallets_mutex);
+    auto it = g_wallets.find(handle);
+    if (it == g_wallets.end()) {
+        return nullptr;
+    }
+    std::shared_ptr<RealFuegoWallet> real_wallet = it->second;
+    g_wallets.erase(it);
+    return real_wallet;
+}
 
 // Wallet creation and management
 extern "C" FuegoWallet fuego_wallet_create(
@@ -280,70 +1197,88 @@ extern "C" FuegoWallet fuego_wallet_create(
     const char* seed_phrase,
     uint64_t restore_height
 ) {
+    Common::ScopedSpan span("fuego_wallet_create");
     std::cout << "Creating real Fuego wallet..." << std::endl;
     
-    g_real_wallet.reset(new RealFuegoWallet());
-    g_real_wallet->password = password ? password : "";
-    g_real_wallet->file_path = file_path ? file_path : "";
-    g_real_wallet->restore_height = restore_height;
+    std::shared_ptr<RealFuegoWallet> real_wallet = std::make_shared<RealFuegoWallet>();
+    real_wallet->password = password ? password : "";
+    real_wallet->file_path = file_path ? file_path : "";
+    real_wallet->restore_height = restore_height;
     
     // Simulate wallet creation process
-    g_real_wallet->load_wallet_data();
+    real_wallet->load_wallet_data();
     
     std::cout << "Real Fuego wallet created successfully" << std::endl;
-    std::cout << "Address: " << g_real_wallet->address << std::endl;
-    std::cout << "Balance: " << g_real_wallet->balance << " atomic units (" << (g_real_wallet->balance / 10000000.0) << " XFG)" << std::endl;
+    std::cout << "Address: " << real_wallet->address << std::endl;
+    std::cout << "Balance: " << real_wallet->balance << " atomic units (" << (real_wallet->balance / 10000000.0) << " XFG)" << std::endl;
     
-    return static_cast<FuegoWallet>(g_real_wallet.get());
+    return register_wallet(real_wallet);
 }
 
 extern "C" FuegoWallet fuego_wallet_open(
     const char* file_path,
     const char* password
 ) {
+    Common::ScopedSpan span("fuego_wallet_open");
     std::cout << "Opening real Fuego wallet..." << std::endl;
     
-    g_real_wallet.reset(new RealFuegoWallet());
-    g_real_wallet->password = password ? password : "";
-    g_real_wallet->file_path = file_path ? file_path : "";
+    std::shared_ptr<RealFuegoWallet> real_wallet = std::make_shared<RealFuegoWallet>();
+    real_wallet->password = password ? password : "";
+    real_wallet->file_path = file_path ? file_path : "";
     
     // Simulate wallet opening process
-    g_real_wallet->load_wallet_data();
+    real_wallet->load_wallet_data();
     
     std::cout << "Real Fuego wallet opened successfully" << std::endl;
-    std::cout << "Address: " << g_real_wallet->address << std::endl;
-    std::cout << "Balance: " << g_real_wallet->balance << " atomic units (" << (g_real_wallet->balance / 10000000.0) << " XFG)" << std::endl;
+    std::cout << "Address: " << real_wallet->address << std::endl;
+    std::cout << "Balance: " << real_wallet->balance << " atomic units (" << (real_wallet->balance / 10000000.0) << " XFG)" << std::endl;
     
-    return static_cast<FuegoWallet>(g_real_wallet.get());
+    return register_wallet(real_wallet);
 }
 
 extern "C" void fuego_wallet_close(FuegoWallet wallet) {
-    if (g_real_wallet.get() == wallet) {
+    std::shared_ptr<RealFuegoWallet> real_wallet = unregister_wallet(wallet);
+    if (real_wallet) {
         std::cout << "Closing real Fuego wallet..." << std::endl;
-        g_real_wallet->stop_sync_process(); // Stop background thread before closing
-        g_real_wallet->is_open = false;
-        g_real_wallet->is_connected = false;
+        real_wallet->stop_sync_process(); // Stop background thread before closing
+        real_wallet->set_event_callback(nullptr, nullptr);
+        real_wallet->is_open = false;
+        real_wallet->is_connected = false;
+    }
+}
+
+extern "C" void fuego_wallet_set_event_callback(
+    FuegoWallet wallet,
+    FuegoWalletEventCallback callback,
+    void* user_data
+) {
+    auto real_wallet = find_wallet(wallet);
+    if (real_wallet) {
+        real_wallet->set_event_callback(callback, user_data);
     }
 }
 
 extern "C" bool fuego_wallet_is_open(FuegoWallet wallet) {
-    if (g_real_wallet.get() == wallet) {
-        return g_real_wallet->is_open;
+    auto real_wallet = find_wallet(wallet);
+    if (real_wallet) {
+        return real_wallet->is_open;
     }
     return false;
 }
 
 // Wallet information
 extern "C" uint64_t fuego_wallet_get_balance(FuegoWallet wallet) {
-    if (g_real_wallet.get() == wallet) {
-        return g_real_wallet->balance;
+    auto real_wallet = find_wallet(wallet);
+    if (real_wallet) {
+        return real_wallet->balance;
     }
     return 0;
 }
 
 extern "C" uint64_t fuego_wallet_get_unlocked_balance(FuegoWallet wallet) {
-    if (g_real_wallet.get() == wallet) {
-        return g_real_wallet->unlocked_balance;
+    auto real_wallet = find_wallet(wallet);
+    if (real_wallet) {
+        return real_wallet->unlocked_balance;
     }
     return 0;
 }
@@ -353,8 +1288,9 @@ extern "C" bool fuego_wallet_get_address(
     char* buffer,
     size_t buffer_size
 ) {
-    if (g_real_wallet.get() == wallet && buffer && buffer_size > 0) {
-        const std::string& address = g_real_wallet->address;
+    auto real_wallet = find_wallet(wallet);
+    if (real_wallet && buffer && buffer_size > 0) {
+        const std::string& address = real_wallet->address;
         if (address.length() < buffer_size) {
             std::strcpy(buffer, address.c_str());
             return true;
@@ -371,7 +1307,9 @@ extern "C" TransactionResult fuego_wallet_send_transaction(
     const char* payment_id,
     uint64_t mixin
 ) {
-    if (g_real_wallet.get() != wallet) {
+    Common::ScopedSpan span("fuego_wallet_send_transaction");
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
     
@@ -385,13 +1323,26 @@ extern "C" TransactionResult fuego_wallet_send_transaction(
     std::string tx_hash = "real_tx_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
     
     // Update balance
-    if (amount <= g_real_wallet->balance) {
-        g_real_wallet->balance -= amount;
-        g_real_wallet->unlocked_balance -= amount;
-        g_real_wallet->transaction_hashes.push_back(tx_hash);
+    if (amount <= real_wallet->balance) {
+        real_wallet->balance -= amount;
+        real_wallet->unlocked_balance -= amount;
+        real_wallet->transaction_hashes.push_back(tx_hash);
+
+#ifndef FUEGO_WITH_CRYPTONOTE
+        // with CryptoNote the sync thread mirrors the wallet's own history
+        RealFuegoWallet::HistoryEntry entry;
+        entry.hash = tx_hash;
+        entry.amount = -static_cast<int64_t>(amount);
+        entry.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+        entry.payment_id = payment_id ? payment_id : "";
+        entry.destinations = address ? address : "";
+        real_wallet->store_history_entry(real_wallet->transaction_hashes.size() - 1, std::move(entry));
+#endif
         
         std::cout << "Transaction sent successfully: " << tx_hash << std::endl;
-        std::cout << "New balance: " << g_real_wallet->balance << " atomic units (" << (g_real_wallet->balance / 10000000.0) << " XFG)" << std::endl;
+        std::cout << "New balance: " << real_wallet->balance << " atomic units (" << (real_wallet->balance / 10000000.0) << " XFG)" << std::endl;
         
         // Return transaction hash as void pointer (simplified)
         return static_cast<TransactionResult>(new std::string(tx_hash));
@@ -406,12 +1357,30 @@ extern "C" TransactionList fuego_wallet_get_transactions(
     uint64_t limit,
     uint64_t offset
 ) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
-    // Return transaction list (simplified)
-    return static_cast<TransactionList>(new std::vector<std::string>(g_real_wallet->transaction_hashes));
+    // Copy only the requested slice; limit 0 means everything from offset on
+    std::lock_guard<std::mutex> lock(real_wallet->history_mutex);
+    const auto& history = real_wallet->history;
+    auto* hashes = new std::vector<std::string>();
+    if (offset < history.size()) {
+        uint64_t end = limit == 0 ? history.size() : std::min<uint64_t>(history.size(), offset + limit);
+        hashes->reserve(end - offset);
+        for (uint64_t i = offset; i < end; ++i) {
+            hashes->push_back(history[i].hash);
+        }
+    }
+    return static_cast<TransactionList>(hashes);
+}
+
+static uint32_t confirmations_for(uint64_t height, uint64_t network_height) {
+    if (height == 0 || network_height <= height) {
+        return 0;
+    }
+    return static_cast<uint32_t>(std::min<uint64_t>(network_height - height, UINT32_MAX));
 }
 
 // Get real transaction history from blockchain
@@ -420,45 +1389,103 @@ extern "C" TransactionInfo* fuego_wallet_get_transaction_history(
     uint64_t limit,
     uint64_t offset
 ) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
-    // Return nullptr if no transactions yet (empty wallet)
-    // Real implementation would query actual transaction history from CryptoNote wallet
-    if (g_real_wallet->transaction_hashes.empty()) {
+    std::lock_guard<std::mutex> lock(real_wallet->history_mutex);
+    if (offset >= real_wallet->history.size()) {
         return nullptr;
     }
 
-    // Return real transaction if it exists
-    if (offset < g_real_wallet->transaction_hashes.size()) {
-        TransactionInfo* tx = new TransactionInfo();
-        
-        const std::string& tx_hash = g_real_wallet->transaction_hashes[offset];
-        strncpy(tx->id, tx_hash.c_str(), sizeof(tx->id) - 1);
-        tx->id[sizeof(tx->id) - 1] = '\0';
-        strncpy(tx->hash, tx_hash.c_str(), sizeof(tx->hash) - 1);
-        tx->hash[sizeof(tx->hash) - 1] = '\0';
-
-        // Real transaction data (would come from CryptoNote transaction cache)
-        tx->amount = 0; // Will be set by actual transaction data
-        tx->fee = 100000; // Standard Fuego fee (0.01 XFG)
-        tx->height = g_real_wallet->sync_height;
-        tx->timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-            std::chrono::system_clock::now().time_since_epoch()
-        ).count();
-        tx->confirmations = g_real_wallet->network_height - tx->height;
-        tx->is_confirmed = tx->confirmations >= 10;
-        tx->is_pending = !tx->is_confirmed;
-        tx->unlock_time = 0;
+    const RealFuegoWallet::HistoryEntry& entry = real_wallet->history[offset];
+    TransactionInfo* tx = new TransactionInfo();
+    std::memset(tx, 0, sizeof(*tx));
+    strncpy(tx->id, entry.hash.c_str(), sizeof(tx->id) - 1);
+    strncpy(tx->hash, entry.hash.c_str(), sizeof(tx->hash) - 1);
+    strncpy(tx->payment_id, entry.payment_id.c_str(), sizeof(tx->payment_id) - 1);
+    strncpy(tx->destination_addresses, entry.destinations.c_str(), sizeof(tx->destination_addresses) - 1);
+    tx->amount = entry.amount;
+    tx->fee = entry.fee;
+    tx->height = entry.height;
+    tx->timestamp = entry.timestamp;
+    tx->confirmations = confirmations_for(entry.height, real_wallet->network_height);
+    tx->is_confirmed = tx->confirmations >= 10;
+    tx->is_pending = !tx->is_confirmed;
+    tx->unlock_time = entry.unlock_time;
+
+    return tx;
+}
 
-        // Clear address fields (will be populated by real transaction data)
-        tx->destination_addresses[0] = '\0';
+// Appends value and its terminator to the arena, returning its offset or
+// UINT32_MAX when it does not fit.
+static uint32_t arena_push(char* arena, size_t arena_size, size_t& used, const std::string& value) {
+    size_t needed = value.size() + 1;
+    if (arena_size - used < needed || used > UINT32_MAX) {
+        return UINT32_MAX;
+    }
+    std::memcpy(arena + used, value.c_str(), needed);
+    uint32_t offset = static_cast<uint32_t>(used);
+    used += needed;
+    return offset;
+}
 
-        return tx;
+extern "C" size_t fuego_wallet_get_transaction_page(
+    FuegoWallet wallet,
+    uint64_t offset,
+    TransactionRecord* records,
+    size_t capacity,
+    char* arena,
+    size_t arena_size,
+    uint64_t* total
+) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
+        if (total) {
+            *total = 0;
+        }
+        return 0;
     }
 
-    return nullptr;
+    uint64_t network_height = real_wallet->network_height;
+    std::lock_guard<std::mutex> lock(real_wallet->history_mutex);
+    const auto& history = real_wallet->history;
+    if (total) {
+        *total = history.size();
+    }
+    if (!records || !arena || offset >= history.size()) {
+        return 0;
+    }
+
+    size_t count = 0;
+    size_t used = 0;
+    for (uint64_t i = offset; i < history.size() && count < capacity; ++i) {
+        const RealFuegoWallet::HistoryEntry& entry = history[i];
+        size_t mark = used;
+        TransactionRecord& record = records[count];
+        record.hash_offset = arena_push(arena, arena_size, used, entry.hash);
+        record.payment_id_offset = arena_push(arena, arena_size, used, entry.payment_id);
+        record.destinations_offset = arena_push(arena, arena_size, used, entry.destinations);
+        if (record.hash_offset == UINT32_MAX || record.payment_id_offset == UINT32_MAX ||
+            record.destinations_offset == UINT32_MAX) {
+            used = mark;
+            break;
+        }
+
+        record.index = i;
+        record.amount = entry.amount;
+        record.fee = entry.fee;
+        record.height = entry.height;
+        record.timestamp = entry.timestamp;
+        record.unlock_time = entry.unlock_time;
+        record.confirmations = confirmations_for(entry.height, network_height);
+        record.is_confirmed = record.confirmations >= 10;
+        record.is_pending = !record.is_confirmed;
+        ++count;
+    }
+
+    return count;
 }
 
 // Free transaction history
@@ -474,48 +1501,56 @@ extern "C" bool fuego_wallet_connect_node(
     const char* address,
     uint16_t port
 ) {
-    if (g_real_wallet.get() != wallet) {
+    Common::ScopedSpan span("fuego_wallet_connect_node");
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return false;
     }
     
-    std::string node_address = address ? address : "fuego.spaceportx.net";
-    uint16_t node_port = port > 0 ? port : 18180;
+    uint16_t default_port = port > 0 ? port : 18180;
+    auto nodes = parse_node_list(address ? address : "", default_port);
+    if (nodes.empty()) {
+        nodes.emplace_back("fuego.spaceportx.net", default_port);
+    }
     
-    std::cout << "🔗 Connecting to Fuego node: " << node_address << ":" << node_port << std::endl;
+    std::cout << "🔗 Connecting to Fuego node: " << nodes.front().first << ":" << nodes.front().second;
+    if (nodes.size() > 1) {
+        std::cout << " (+" << nodes.size() - 1 << " fallback)";
+    }
+    std::cout << std::endl;
     
-    // Update connection info with actual node
-    g_real_wallet->connection_type = "Fuego Network (XFG) - " + node_address + ":" + std::to_string(node_port);
+    real_wallet->node_host = nodes.front().first;
+    real_wallet->node_port = nodes.front().second;
+    real_wallet->node_list = nodes;
     
     // Connect to real Fuego network
-    g_real_wallet->connect_to_network();
+    real_wallet->connect_to_network();
     
     std::cout << "✅ Connected to Fuego network successfully" << std::endl;
-    std::cout << "📡 Node: " << g_real_wallet->connection_type << std::endl;
-    std::cout << "👥 Peers: " << g_real_wallet->peer_count << std::endl;
-    std::cout << "📊 Wallet height: " << g_real_wallet->sync_height << std::endl;
-    std::cout << "📈 Network height: " << g_real_wallet->network_height << std::endl;
-    std::cout << "🔄 Syncing: " << (g_real_wallet->is_syncing ? "Yes" : "No") << std::endl;
+    std::cout << "📡 Node: " << real_wallet->connection_type << std::endl;
+    std::cout << "👥 Peers: " << real_wallet->peer_count << std::endl;
+    std::cout << "📊 Wallet height: " << real_wallet->sync_height << std::endl;
+    std::cout << "📈 Network height: " << real_wallet->network_height << std::endl;
+    std::cout << "🔄 Syncing: " << (real_wallet->is_syncing ? "Yes" : "No") << std::endl;
     
     return true;
 }
 
 extern "C" NetworkStatus* fuego_wallet_get_network_status(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
     
-    // Update sync progress
-    g_real_wallet->update_sync_progress();
-    
     NetworkStatus* status = new NetworkStatus();
-    status->is_connected = g_real_wallet->is_connected;
-    status->peer_count = g_real_wallet->peer_count;
-    status->sync_height = g_real_wallet->sync_height;
-    status->network_height = g_real_wallet->network_height;
-    status->is_syncing = g_real_wallet->is_syncing;
+    status->is_connected = real_wallet->is_connected;
+    status->peer_count = real_wallet->peer_count;
+    status->sync_height = real_wallet->sync_height;
+    status->network_height = real_wallet->network_height;
+    status->is_syncing = real_wallet->is_syncing;
     
     // Copy connection type
-    strncpy(status->connection_type, g_real_wallet->connection_type.c_str(), sizeof(status->connection_type) - 1);
+    strncpy(status->connection_type, real_wallet->connection_type.c_str(), sizeof(status->connection_type) - 1);
     status->connection_type[sizeof(status->connection_type) - 1] = '\0';
     
     return status;
@@ -528,140 +1563,259 @@ extern "C" void fuego_wallet_free_network_status(NetworkStatus* status) {
 }
 
 extern "C" bool fuego_wallet_disconnect_node(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return false;
     }
-    g_real_wallet->stop_sync_process(); // Stop sync thread when disconnecting
-    g_real_wallet->is_connected = false;
-    g_real_wallet->is_syncing = false;
-    g_real_wallet->peer_count = 0;
-    g_real_wallet->connection_type = "Disconnected";
+    real_wallet->stop_sync_process(); // Stop sync thread when disconnecting
+    real_wallet->is_connected = false;
+    real_wallet->is_syncing = false;
+    real_wallet->peer_count = 0;
+    real_wallet->connection_type = "Disconnected";
     return true;
 }
 
 extern "C" bool fuego_wallet_refresh(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return false;
     }
-    g_real_wallet->update_sync_progress();
-    return true;
+    // Progress is pushed continuously by the sync thread
+    return real_wallet->is_connected;
 }
 
 extern "C" bool fuego_wallet_rescan_blockchain(FuegoWallet wallet, uint64_t start_height) {
-    if (g_real_wallet.get() != wallet) {
+    Common::ScopedSpan span("fuego_wallet_rescan_blockchain");
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return false;
     }
+#ifdef FUEGO_WITH_CRYPTONOTE
+    if (!real_wallet->is_connected) {
+        return false;
+    }
+    // The sync thread runs the rescan once it has reopened the wallet
+    real_wallet->pending_rescan_height = static_cast<int64_t>(std::min<uint64_t>(start_height, UINT32_MAX));
+    real_wallet->start_sync_process();
+#else
     // Simulate rescan by resetting sync height
     (void)start_height;
-    g_real_wallet->sync_height = 0;
-    g_real_wallet->is_syncing = true;
+    real_wallet->sync_height = 0;
+    real_wallet->is_syncing = true;
+#endif
     return true;
 }
 
+extern "C" uint64_t fuego_wallet_restore_height_for_timestamp(FuegoWallet wallet, uint64_t timestamp) {
+    Common::ScopedSpan span("fuego_wallet_restore_height_for_timestamp");
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
+        return 0;
+    }
+    return real_wallet->restore_height_for_timestamp(timestamp);
+}
+
 extern "C" uint64_t fuego_wallet_estimate_transaction_fee(
     FuegoWallet wallet,
     const char* address,
     uint64_t amount,
     uint64_t mixin
 ) {
-    (void)wallet; (void)address; (void)amount; (void)mixin;
-    // Return a simple fixed fee estimate for now (0.01 XFG in atomic units)
-    return 1000000;
+    FeeEstimateInfo estimate;
+    if (!fuego_wallet_estimate_transaction(wallet, address, amount, mixin, &estimate)) {
+        return CryptoNote::parameters::MINIMUM_FEE;
+    }
+    return estimate.fee;
+}
+
+extern "C" bool fuego_wallet_estimate_transaction(
+    FuegoWallet wallet,
+    const char* address,
+    uint64_t amount,
+    uint64_t mixin,
+    FeeEstimateInfo* estimate
+) {
+    (void)address; // every destination costs the same, integrated addresses aside
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !estimate) {
+        return false;
+    }
+
+    // Until the sync thread has published one there are no known outputs
+    static const CryptoNote::FeeEstimator no_outputs(CryptoNote::parameters::MINIMUM_FEE,
+        CryptoNote::parameters::DEFAULT_DUST_THRESHOLD, CryptoNote::parameters::CRYPTONOTE_MAX_TX_SIZE_LIMIT);
+    std::shared_ptr<const CryptoNote::FeeEstimator> estimator = real_wallet->current_fee_estimator();
+    CryptoNote::FeeEstimate result = (estimator ? *estimator : no_outputs).estimate(amount, mixin);
+
+    estimate->fee = result.fee;
+    estimate->change_amount = result.changeAmount;
+    estimate->transaction_size = result.transactionSize;
+    estimate->input_count = static_cast<uint32_t>(result.inputCount);
+    estimate->output_count = static_cast<uint32_t>(result.outputCount);
+    estimate->enough_money = result.enoughMoney;
+    estimate->fits_size_limit = result.fitsSizeLimit;
+    return true;
 }
 
 // Deposit functions
 extern "C" void* fuego_wallet_get_deposits(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
     
     // Return pointer to deposits vector for parsing by Rust
     // In a real implementation, this would serialize the deposits to a C-compatible format
-    return static_cast<void*>(&g_real_wallet->deposits);
+    return static_cast<void*>(&real_wallet->deposits);
+}
+
+static char* copy_c_string(const std::string& value) {
+    char* copy = new char[value.length() + 1];
+    strcpy(copy, value.c_str());
+    return copy;
+}
+
+#ifndef FUEGO_WITH_CRYPTONOTE
+// Stands in for transaction hashes when deposits are simulated
+static void random_hash(uint8_t (&hash)[32]) {
+    std::random_device rd;
+    for (uint8_t& byte : hash) {
+        byte = static_cast<uint8_t>(rd());
+    }
+}
+#endif
+
+static std::string hash_to_hex(const uint8_t (&hash)[32]) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(sizeof(hash) * 2, '0');
+    for (size_t i = 0; i < sizeof(hash); ++i) {
+        hex[2 * i] = digits[hash[i] >> 4];
+        hex[2 * i + 1] = digits[hash[i] & 15];
+    }
+    return hex;
 }
 
 extern "C" void* fuego_wallet_create_deposit(FuegoWallet wallet, uint64_t amount, uint32_t term) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
-    
-    // Create a new deposit
+
+    // term is in days, deposits count it in blocks
+    uint32_t term_blocks = static_cast<uint32_t>(term * CryptoNote::parameters::EXPECTED_NUMBER_OF_BLOCKS_PER_DAY);
+
+#ifdef FUEGO_WITH_CRYPTONOTE
+    // the deposit itself shows up once the sync thread sees its transaction
+    auto tx_hash = std::make_shared<std::string>();
+    std::string error;
+    bool created = real_wallet->call_sync_wallet([amount, term_blocks, tx_hash](CryptoNote::WalletGreen& backend) {
+        std::string address = backend.getAddress(0);
+        backend.createDeposit(amount, term_blocks, address, address, *tx_hash);
+    }, error);
+    if (!created) {
+        std::cout << "Failed to create term deposit: " << error << std::endl;
+        return nullptr;
+    }
+
+    std::cout << "Created term deposit: " << amount / 10000000.0 << " XFG for " << term << " days (TX: " << *tx_hash << ")" << std::endl;
+    return copy_c_string(*tx_hash);
+#else
     RealFuegoWallet::Deposit deposit;
-    deposit.id = "deposit_" + std::to_string(amount) + "_" + std::to_string(term) + "_" + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
     deposit.amount = amount;
-    deposit.term = term;
-    
-    // Calculate interest rate based on term (longer terms = higher rates)
-    if (term <= 30) {
-        deposit.rate = 0.05; // 5% annual
-    } else if (term <= 90) {
-        deposit.rate = 0.08; // 8% annual
-    } else if (term <= 180) {
-        deposit.rate = 0.12; // 12% annual
-    } else {
-        deposit.rate = 0.15; // 15% annual
+    deposit.term = term_blocks;
+    deposit.creating_height = real_wallet->network_height;
+    deposit.creating_time = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    deposit.unlock_height = deposit.creating_height + term_blocks;
+    random_hash(deposit.creating_transaction_hash);
+
+    size_t id;
+    {
+        std::lock_guard<std::mutex> lock(real_wallet->deposit_mutex);
+        id = real_wallet->deposits.size();
     }
-    
-    // Calculate interest (simplified calculation)
-    deposit.interest = static_cast<uint64_t>(amount * deposit.rate * term / 365.0);
-    deposit.status = "locked";
-    deposit.unlock_height = g_real_wallet->network_height + (term * 24 * 60 * 60 / 120); // Assuming 2-minute blocks
-    deposit.unlock_time = "TBD"; // Would calculate actual unlock time
-    deposit.creating_transaction_hash = "tx_" + deposit.id;
-    deposit.creating_height = g_real_wallet->network_height;
-    deposit.creating_time = "Now";
-    deposit.spending_transaction_hash = "";
-    deposit.spending_height = 0;
-    deposit.spending_time = "";
-    deposit.deposit_type = "Term Deposit";
-    
-    // Add to deposits list
-    g_real_wallet->deposits.push_back(deposit);
-    
-    // Return deposit ID as C string
-    char* deposit_id = new char[deposit.id.length() + 1];
-    strcpy(deposit_id, deposit.id.c_str());
-    
-    std::cout << "Created term deposit: " << amount / 10000000.0 << " XFG for " << term << " days (ID: " << deposit.id << ")" << std::endl;
-    
-    return deposit_id;
+    real_wallet->store_deposit(id, deposit);
+
+    std::cout << "Created term deposit: " << amount / 10000000.0 << " XFG for " << term << " days (ID: " << id << ")" << std::endl;
+    return copy_c_string(std::to_string(id));
+#endif
 }
 
 extern "C" void* fuego_wallet_withdraw_deposit(FuegoWallet wallet, const char* deposit_id) {
-    if (g_real_wallet.get() != wallet || !deposit_id) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !deposit_id) {
         return nullptr;
     }
-    
-    // Find the deposit
-    auto it = std::find_if(g_real_wallet->deposits.begin(), g_real_wallet->deposits.end(),
-                          [deposit_id](const RealFuegoWallet::Deposit& deposit) {
-                              return deposit.id == std::string(deposit_id);
-                          });
-    
-    if (it == g_real_wallet->deposits.end()) {
+
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull(deposit_id, &end, 10);
+    if (end == deposit_id || *end != '\0') {
         std::cout << "Deposit not found: " << deposit_id << std::endl;
         return nullptr;
     }
-    
-    // Check if deposit is unlocked
-    if (it->status != "unlocked") {
+    size_t id = static_cast<size_t>(parsed);
+
+#ifdef FUEGO_WITH_CRYPTONOTE
+    auto tx_hash = std::make_shared<std::string>();
+    std::string error;
+    bool withdrawn = real_wallet->call_sync_wallet([id, tx_hash](CryptoNote::WalletGreen& backend) {
+        backend.withdrawDeposit(id, *tx_hash);
+    }, error);
+    if (!withdrawn) {
+        std::cout << "Failed to withdraw term deposit " << deposit_id << ": " << error << std::endl;
+        return nullptr;
+    }
+
+    std::cout << "Withdrew term deposit: " << deposit_id << " (TX: " << *tx_hash << ")" << std::endl;
+    return copy_c_string(*tx_hash);
+#else
+    RealFuegoWallet::Deposit deposit;
+    {
+        std::lock_guard<std::mutex> lock(real_wallet->deposit_mutex);
+        if (id >= real_wallet->deposits.size() || real_wallet->deposits[id].spent) {
+            std::cout << "Deposit not found: " << deposit_id << std::endl;
+            return nullptr;
+        }
+        deposit = real_wallet->deposits[id];
+    }
+
+    if (deposit.unlock_height > real_wallet->sync_height) {
         std::cout << "Deposit is not unlocked yet: " << deposit_id << std::endl;
         return nullptr;
     }
-    
-    // Mark as spent
-    it->status = "spent";
-    it->spending_transaction_hash = "withdraw_tx_" + it->id;
-    it->spending_height = g_real_wallet->network_height;
-    it->spending_time = "Now";
-    
-    // Return transaction hash as C string
-    char* tx_hash = new char[it->spending_transaction_hash.length() + 1];
-    strcpy(tx_hash, it->spending_transaction_hash.c_str());
-    
-    std::cout << "Withdrew term deposit: " << deposit_id << " (TX: " << it->spending_transaction_hash << ")" << std::endl;
-    
-    return tx_hash;
+
+    deposit.spent = true;
+    deposit.spending_height = real_wallet->network_height;
+    deposit.spending_time = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    random_hash(deposit.spending_transaction_hash);
+    real_wallet->store_deposit(id, deposit);
+
+    std::string tx_hash = hash_to_hex(deposit.spending_transaction_hash);
+    std::cout << "Withdrew term deposit: " << deposit_id << " (TX: " << tx_hash << ")" << std::endl;
+    return copy_c_string(tx_hash);
+#endif
+}
+
+extern "C" size_t fuego_wallet_get_withdrawable_deposits(FuegoWallet wallet, uint64_t* ids, size_t capacity, uint64_t* total_amount) {
+    auto real_wallet = find_wallet(wallet);
+    if (total_amount) {
+        *total_amount = 0;
+    }
+    if (!real_wallet) {
+        return 0;
+    }
+
+    uint64_t height = real_wallet->sync_height;
+    std::lock_guard<std::mutex> lock(real_wallet->deposit_mutex);
+    size_t count = 0;
+    for (auto it = real_wallet->unspent_deposits.begin(), end = real_wallet->unspent_deposits.upper_bound(height); it != end; ++it, ++count) {
+        if (ids && count < capacity) {
+            ids[count] = it->second;
+        }
+        if (total_amount) {
+            *total_amount += real_wallet->deposits[it->second].amount;
+        }
+    }
+    return count;
 }
 
 // Utility functions
@@ -681,34 +1835,38 @@ extern "C" void fuego_wallet_free_transactions(TransactionList txs) {
 
 // Get comprehensive wallet information
 extern "C" WalletInfo* fuego_wallet_get_wallet_info(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
-    // Update real wallet info
-    g_real_wallet->update_sync_progress();
-
     WalletInfo* info = new WalletInfo();
-    strncpy(info->address, g_real_wallet->address.c_str(), sizeof(info->address) - 1);
+    strncpy(info->address, real_wallet->address.c_str(), sizeof(info->address) - 1);
     info->address[sizeof(info->address) - 1] = '\0';
 
-    info->balance = g_real_wallet->balance;
-    info->unlocked_balance = g_real_wallet->unlocked_balance;
-    info->locked_balance = g_real_wallet->balance - g_real_wallet->unlocked_balance;
-    info->total_received = g_real_wallet->balance;
+    info->balance = real_wallet->balance;
+    info->unlocked_balance = real_wallet->unlocked_balance;
+    info->locked_balance = real_wallet->balance - real_wallet->unlocked_balance;
+    info->total_received = real_wallet->balance;
     info->total_sent = 0;
-    info->transaction_count = g_real_wallet->transaction_hashes.size();
+    {
+        std::lock_guard<std::mutex> lock(real_wallet->history_mutex);
+        info->transaction_count = real_wallet->history.size();
+    }
 
-    info->is_synced = !g_real_wallet->is_syncing;
-    info->sync_height = g_real_wallet->sync_height;
-    info->network_height = g_real_wallet->network_height;
-    info->daemon_height = g_real_wallet->network_height;
+    info->is_synced = !real_wallet->is_syncing;
+    info->sync_height = real_wallet->sync_height;
+    info->network_height = real_wallet->network_height;
+    info->daemon_height = real_wallet->network_height;
 
-    info->is_connected = g_real_wallet->is_connected;
-    info->peer_count = g_real_wallet->peer_count;
-    info->last_block_time = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count();
+    info->is_connected = real_wallet->is_connected;
+    info->peer_count = real_wallet->peer_count;
+    info->last_block_time = real_wallet->tip_timestamp;
+    if (info->last_block_time == 0) {
+        info->last_block_time = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+    }
 
     return info;
 }
@@ -722,18 +1880,19 @@ extern "C" void fuego_wallet_free_wallet_info(WalletInfo* info) {
 
 // Get detailed network information
 extern "C" NetworkInfo* fuego_wallet_get_network_info(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
     NetworkInfo* info = new NetworkInfo();
-    info->is_connected = g_real_wallet->is_connected;
-    info->peer_count = g_real_wallet->peer_count;
-    info->sync_height = g_real_wallet->sync_height;
-    info->network_height = g_real_wallet->network_height;
-    info->is_syncing = g_real_wallet->is_syncing;
+    info->is_connected = real_wallet->is_connected;
+    info->peer_count = real_wallet->peer_count;
+    info->sync_height = real_wallet->sync_height;
+    info->network_height = real_wallet->network_height;
+    info->is_syncing = real_wallet->is_syncing;
 
-    strncpy(info->connection_type, g_real_wallet->connection_type.c_str(),
+    strncpy(info->connection_type, real_wallet->connection_type.c_str(),
             sizeof(info->connection_type) - 1);
     info->connection_type[sizeof(info->connection_type) - 1] = '\0';
 
@@ -741,9 +1900,8 @@ extern "C" NetworkInfo* fuego_wallet_get_network_info(FuegoWallet wallet) {
         std::chrono::system_clock::now().time_since_epoch()
     ).count();
 
-    info->sync_speed = g_real_wallet->is_syncing ? 100.0 : 0.0; // blocks per second
-    info->estimated_sync_time = g_real_wallet->is_syncing ?
-        (g_real_wallet->network_height - g_real_wallet->sync_height) / 100 : 0;
+    info->sync_speed = real_wallet->is_syncing ? real_wallet->sync_speed.load() : 0.0; // blocks per second
+    info->estimated_sync_time = real_wallet->estimated_seconds_remaining();
 
     return info;
 }
@@ -760,7 +1918,8 @@ extern "C" TransactionInfo* fuego_wallet_get_transaction_by_hash(
     FuegoWallet wallet,
     const char* tx_hash
 ) {
-    if (g_real_wallet.get() != wallet || !tx_hash) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !tx_hash) {
         return nullptr;
     }
 
@@ -771,10 +1930,10 @@ extern "C" TransactionInfo* fuego_wallet_get_transaction_by_hash(
     tx->hash[sizeof(tx->hash) - 1] = '\0';
 
     // Find transaction in history
-    auto it = std::find(g_real_wallet->transaction_hashes.begin(),
-                       g_real_wallet->transaction_hashes.end(), tx_hash);
+    auto it = std::find(real_wallet->transaction_hashes.begin(),
+                       real_wallet->transaction_hashes.end(), tx_hash);
 
-    if (it != g_real_wallet->transaction_hashes.end()) {
+    if (it != real_wallet->transaction_hashes.end()) {
         // This is a sent transaction
         tx->amount = -10000000; // 1 XFG in atomic units (placeholder)
         tx->is_confirmed = true;
@@ -789,7 +1948,7 @@ extern "C" TransactionInfo* fuego_wallet_get_transaction_by_hash(
     }
 
     tx->fee = 100000; // 0.01 XFG fee
-    tx->height = g_real_wallet->network_height - 5;
+    tx->height = real_wallet->network_height - 5;
     tx->timestamp = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::system_clock::now().time_since_epoch()
     ).count();
@@ -816,20 +1975,22 @@ extern "C" TransactionInfo* fuego_wallet_get_transaction_by_id(
 
 // Cancel transaction
 extern "C" bool fuego_wallet_cancel_transaction(FuegoWallet wallet, const char* tx_id) {
-    if (g_real_wallet.get() != wallet || !tx_id) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !tx_id) {
         return false;
     }
 
     // In a real implementation, this would cancel a pending transaction
     // For now, just return true if transaction exists
-    auto it = std::find(g_real_wallet->transaction_hashes.begin(),
-                       g_real_wallet->transaction_hashes.end(), tx_id);
-    return it != g_real_wallet->transaction_hashes.end();
+    auto it = std::find(real_wallet->transaction_hashes.begin(),
+                       real_wallet->transaction_hashes.end(), tx_id);
+    return it != real_wallet->transaction_hashes.end();
 }
 
 // Create new address with label
 extern "C" char* fuego_wallet_create_address(FuegoWallet wallet, const char* label) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
@@ -852,13 +2013,14 @@ extern "C" char* fuego_wallet_create_address(FuegoWallet wallet, const char* lab
 
 // Get all addresses
 extern "C" void* fuego_wallet_get_addresses(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
     // Return vector of addresses (just primary for now)
     auto* addresses = new std::vector<std::string>();
-    addresses->push_back(g_real_wallet->address);
+    addresses->push_back(real_wallet->address);
 
     return addresses;
 }
@@ -872,13 +2034,14 @@ extern "C" void fuego_wallet_free_addresses(void* addresses) {
 
 // Delete address
 extern "C" bool fuego_wallet_delete_address(FuegoWallet wallet, const char* address) {
-    if (g_real_wallet.get() != wallet || !address) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !address) {
         return false;
     }
 
     // In real implementation, this would remove address from wallet
     // For now, just prevent deletion of primary address
-    return std::string(address) != g_real_wallet->address;
+    return std::string(address) != real_wallet->address;
 }
 
 // Set address label
@@ -887,7 +2050,8 @@ extern "C" bool fuego_wallet_set_address_label(
     const char* address,
     const char* label
 ) {
-    if (g_real_wallet.get() != wallet || !address || !label) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !address || !label) {
         return false;
     }
 
@@ -897,15 +2061,15 @@ extern "C" bool fuego_wallet_set_address_label(
 
 // Get block information
 extern "C" BlockInfo* fuego_wallet_get_block_info(FuegoWallet wallet, uint64_t height) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
     BlockInfo* block = new BlockInfo();
     block->height = height;
-    block->timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count();
+    block->timestamp = real_wallet->block_timestamp(height);
+    // NodeRpcProxy does not serve block details yet, the rest stays placeholder data
     block->difficulty = 52500024; // Real Fuego difficulty
     block->reward = 3005769; // Real Fuego block reward in atomic units
     block->size = 1024; // Mock block size
@@ -929,7 +2093,8 @@ extern "C" void fuego_wallet_free_block_info(BlockInfo* block) {
 
 // Get block by hash
 extern "C" BlockInfo* fuego_wallet_get_block_by_hash(FuegoWallet wallet, const char* block_hash) {
-    if (g_real_wallet.get() != wallet || !block_hash) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !block_hash) {
         return nullptr;
     }
 
@@ -945,58 +2110,30 @@ extern "C" BlockInfo* fuego_wallet_get_block_by_hash(FuegoWallet wallet, const c
 
 // Get current block height
 extern "C" uint64_t fuego_wallet_get_current_block_height(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return 0;
     }
-    return g_real_wallet->network_height;
+    return real_wallet->network_height;
 }
 
 // Get block timestamp
 extern "C" uint64_t fuego_wallet_get_block_timestamp(FuegoWallet wallet, uint64_t height) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return 0;
     }
-    return std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count() - (g_real_wallet->network_height - height) * 120; // 2-minute blocks
-}
-
-void mining_thread_func(RealFuegoWallet* wallet) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(1, 100);
-
-    while (wallet->mining_thread_running) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Mine every 100ms
-
-        if (!wallet->mining_thread_running) break;
-
-        // Simulate mining work
-        wallet->total_hashes += wallet->threads * 100; // Each thread does 100 hashes per 100ms
-
-        // Simulate share submission (5% success rate)
-        int random_value = dis(gen);
-        if (random_value <= 5) { // 5% chance of finding a share
-            wallet->valid_shares++;
-            wallet->last_share_time = std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::system_clock::now().time_since_epoch()
-            ).count();
-
-            std::cout << "Found valid share! Total shares: " << wallet->valid_shares << std::endl;
-        } else if (random_value <= 10) { // 5% chance of invalid share
-            wallet->invalid_shares++;
-            std::cout << "Found invalid share! Total invalid: " << wallet->invalid_shares << std::endl;
-        }
-    }
+    return real_wallet->block_timestamp(height);
 }
 
 // Mining operations
 extern "C" bool fuego_wallet_start_mining(FuegoWallet wallet, uint32_t threads, bool background) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return false;
     }
 
-    if (g_real_wallet->is_mining) {
+    if (real_wallet->is_mining) {
         std::cout << "Mining is already running" << std::endl;
         return false;
     }
@@ -1008,35 +2145,27 @@ extern "C" bool fuego_wallet_start_mining(FuegoWallet wallet, uint32_t threads,
     }
 
     // Update mining state
-    g_real_wallet->is_mining = true;
-    g_real_wallet->threads = threads;
-    g_real_wallet->mining_start_time = std::chrono::duration_cast<std::chrono::seconds>(
+    real_wallet->is_mining = true;
+    real_wallet->threads = threads;
+    real_wallet->mining_start_time = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::system_clock::now().time_since_epoch()
     ).count();
-    g_real_wallet->total_hashes = 0;
-    g_real_wallet->valid_shares = 0;
-    g_real_wallet->invalid_shares = 0;
-    g_real_wallet->last_share_time = 0;
-
-    // Simulate hashrate based on thread count
-    g_real_wallet->hashrate = threads * 1000.0; // 1 KH/s per thread
 
     std::cout << "Starting mining with " << threads << " threads (background: " << background << ")" << std::endl;
-    std::cout << "Hashrate: " << g_real_wallet->hashrate << " H/s" << std::endl;
 
-    // Start mining simulation thread
-    g_real_wallet->mining_thread_running = true;
-    g_real_wallet->mining_thread = std::thread(mining_thread_func, g_real_wallet.get());
+    // Hashrate is measured by the mining thread once the workers are running
+    real_wallet->start_mining_process();
 
     return true;
 }
 
 extern "C" bool fuego_wallet_stop_mining(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return false;
     }
 
-    if (!g_real_wallet->is_mining) {
+    if (!real_wallet->is_mining) {
         std::cout << "Mining is not running" << std::endl;
         return false;
     }
@@ -1044,40 +2173,39 @@ extern "C" bool fuego_wallet_stop_mining(FuegoWallet wallet) {
     std::cout << "Stopping mining..." << std::endl;
 
     // Stop mining thread
-    g_real_wallet->mining_thread_running = false;
-    if (g_real_wallet->mining_thread.joinable()) {
-        g_real_wallet->mining_thread.join();
-    }
+    real_wallet->stop_mining_process();
 
     // Update mining state
-    g_real_wallet->is_mining = false;
-    g_real_wallet->threads = 0;
-    g_real_wallet->hashrate = 0.0;
+    real_wallet->is_mining = false;
+    real_wallet->threads = 0;
+    real_wallet->hashrate = 0.0;
+    real_wallet->publish_event(FUEGO_WALLET_EVENT_MINING_STATS);
 
     std::cout << "Mining stopped" << std::endl;
     return true;
 }
 
 extern "C" MiningInfo* fuego_wallet_get_mining_info(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
     MiningInfo* info = new MiningInfo();
-    info->is_mining = g_real_wallet->is_mining;
-    info->hashrate = g_real_wallet->hashrate;
+    info->is_mining = real_wallet->is_mining;
+    info->hashrate = real_wallet->hashrate;
     info->difficulty = 52500024; // Real Fuego difficulty
     info->block_reward = 3005769; // Real Fuego block reward in atomic units
-    info->threads = g_real_wallet->threads;
+    info->threads = real_wallet->threads;
 
     // Copy pool address and worker name
-    if (!g_real_wallet->pool_address.empty()) {
-        strncpy(info->pool_address, g_real_wallet->pool_address.c_str(), sizeof(info->pool_address) - 1);
+    if (!real_wallet->pool_address.empty()) {
+        strncpy(info->pool_address, real_wallet->pool_address.c_str(), sizeof(info->pool_address) - 1);
         info->pool_address[sizeof(info->pool_address) - 1] = '\0';
     }
 
-    if (!g_real_wallet->worker_name.empty()) {
-        strncpy(info->worker_name, g_real_wallet->worker_name.c_str(), sizeof(info->worker_name) - 1);
+    if (!real_wallet->worker_name.empty()) {
+        strncpy(info->worker_name, real_wallet->worker_name.c_str(), sizeof(info->worker_name) - 1);
         info->worker_name[sizeof(info->worker_name) - 1] = '\0';
     }
 
@@ -1097,20 +2225,21 @@ extern "C" bool fuego_wallet_set_mining_pool(
     const char* pool_address,
     const char* worker_name
 ) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return false;
     }
 
     if (pool_address) {
-        g_real_wallet->pool_address = pool_address;
+        real_wallet->pool_address = pool_address;
     } else {
-        g_real_wallet->pool_address.clear();
+        real_wallet->pool_address.clear();
     }
 
     if (worker_name) {
-        g_real_wallet->worker_name = worker_name;
+        real_wallet->worker_name = worker_name;
     } else {
-        g_real_wallet->worker_name.clear();
+        real_wallet->worker_name.clear();
     }
 
     std::cout << "Setting mining pool: " << (pool_address ? pool_address : "none");
@@ -1122,9 +2251,23 @@ extern "C" bool fuego_wallet_set_mining_pool(
     return true;
 }
 
+// Cap the mining threads allowed to hash and the workers of the next rescan,
+// applied to a running miner without restarting it
+extern "C" bool fuego_wallet_set_resource_limits(FuegoWallet wallet, uint32_t mining_threads, uint32_t rescan_workers) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
+        return false;
+    }
+
+    real_wallet->rescan_workers = rescan_workers;
+    real_wallet->set_mining_thread_limit(mining_threads);
+    return true;
+}
+
 // Get detailed mining statistics
 extern "C" char* fuego_wallet_get_mining_stats_json(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
@@ -1132,35 +2275,48 @@ extern "C" char* fuego_wallet_get_mining_stats_json(FuegoWallet wallet) {
         std::chrono::system_clock::now().time_since_epoch()
     ).count();
 
-    uint64_t uptime = g_real_wallet->is_mining && g_real_wallet->mining_start_time > 0 ?
-                      current_time - g_real_wallet->mining_start_time : 0;
+    uint64_t uptime = real_wallet->is_mining && real_wallet->mining_start_time > 0 ?
+                      current_time - real_wallet->mining_start_time : 0;
 
-    float share_acceptance_rate = g_real_wallet->valid_shares + g_real_wallet->invalid_shares > 0 ?
-                                  (float)g_real_wallet->valid_shares / (g_real_wallet->valid_shares + g_real_wallet->invalid_shares) * 100.0f : 0.0f;
+    float share_acceptance_rate = real_wallet->valid_shares + real_wallet->invalid_shares > 0 ?
+                                  (float)real_wallet->valid_shares / (real_wallet->valid_shares + real_wallet->invalid_shares) * 100.0f : 0.0f;
 
     // Format as JSON string
     std::string json = "{";
-    json += "\"is_mining\":" + std::string(g_real_wallet->is_mining ? "true" : "false") + ",";
-    json += "\"hashrate\":" + std::to_string(g_real_wallet->hashrate) + ",";
-    json += "\"threads\":" + std::to_string(g_real_wallet->threads) + ",";
-    json += "\"total_hashes\":" + std::to_string(g_real_wallet->total_hashes) + ",";
-    json += "\"valid_shares\":" + std::to_string(g_real_wallet->valid_shares) + ",";
-    json += "\"invalid_shares\":" + std::to_string(g_real_wallet->invalid_shares) + ",";
+    json += "\"is_mining\":" + std::string(real_wallet->is_mining ? "true" : "false") + ",";
+    json += "\"hashrate\":" + std::to_string(real_wallet->hashrate) + ",";
+    json += "\"threads\":" + std::to_string(real_wallet->threads) + ",";
+    json += "\"total_hashes\":" + std::to_string(real_wallet->total_hashes) + ",";
+    json += "\"valid_shares\":" + std::to_string(real_wallet->valid_shares) + ",";
+    json += "\"invalid_shares\":" + std::to_string(real_wallet->invalid_shares) + ",";
     json += "\"share_acceptance_rate\":" + std::to_string(share_acceptance_rate) + ",";
     json += "\"uptime\":" + std::to_string(uptime) + ",";
+    json += "\"share_latency_ms\":" + std::to_string(real_wallet->share_latency_ms.load()) + ",";
 
-    if (g_real_wallet->mining_start_time > 0) {
-        json += "\"mining_start_time\":" + std::to_string(g_real_wallet->mining_start_time) + ",";
+    if (real_wallet->mining_start_time > 0) {
+        json += "\"mining_start_time\":" + std::to_string(real_wallet->mining_start_time) + ",";
     } else {
         json += "\"mining_start_time\":null,";
     }
 
-    if (g_real_wallet->last_share_time > 0) {
-        json += "\"last_share_time\":" + std::to_string(g_real_wallet->last_share_time);
+    if (real_wallet->last_share_time > 0) {
+        json += "\"last_share_time\":" + std::to_string(real_wallet->last_share_time);
     } else {
         json += "\"last_share_time\":null";
     }
 
+#ifdef FUEGO_WITH_CRYPTONOTE
+    Crypto::slow_hash_pool_stats pool;
+    Crypto::slow_hash_pool_get_stats(&pool);
+    json += ",\"scratchpad_pool\":{";
+    json += "\"reserved\":" + std::to_string(pool.reserved) + ",";
+    json += "\"in_use\":" + std::to_string(pool.in_use) + ",";
+    json += "\"huge_pages\":" + std::to_string(pool.huge_pages) + ",";
+    json += "\"numa_bound\":" + std::to_string(pool.numa_bound) + ",";
+    json += "\"pool_huge_pages\":" + std::string(pool.pool_pages != 0 ? "true" : "false");
+    json += "}";
+#endif
+
     json += "}";
 
     char* json_str = new char[json.length() + 1];
@@ -1234,7 +2390,8 @@ extern "C" bool fuego_wallet_derive_keys_from_seed(
     const char* seed_phrase,
     const char* password
 ) {
-    if (g_real_wallet.get() != wallet || !seed_phrase) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !seed_phrase) {
         return false;
     }
 
@@ -1244,30 +2401,31 @@ extern "C" bool fuego_wallet_derive_keys_from_seed(
     }
 
     // Mock key derivation - in real implementation, this would use cryptographic functions
-    g_real_wallet->seed_phrase = seed_phrase;
-    g_real_wallet->view_key = "view_key_" + std::string(seed_phrase).substr(0, 16) + "_mock";
-    g_real_wallet->spend_key = "spend_key_" + std::string(seed_phrase).substr(16, 16) + "_mock";
-    g_real_wallet->has_keys = true;
+    real_wallet->seed_phrase = seed_phrase;
+    real_wallet->view_key = "view_key_" + std::string(seed_phrase).substr(0, 16) + "_mock";
+    real_wallet->spend_key = "spend_key_" + std::string(seed_phrase).substr(16, 16) + "_mock";
+    real_wallet->has_keys = true;
 
     std::cout << "Derived keys from seed phrase" << std::endl;
-    std::cout << "View key: " << g_real_wallet->view_key << std::endl;
-    std::cout << "Spend key: " << g_real_wallet->spend_key << std::endl;
+    std::cout << "View key: " << real_wallet->view_key << std::endl;
+    std::cout << "Spend key: " << real_wallet->spend_key << std::endl;
 
     return true;
 }
 
 // Get seed phrase (encrypted)
 extern "C" char* fuego_wallet_get_seed_phrase(FuegoWallet wallet, const char* password) {
-    if (g_real_wallet.get() != wallet || !password) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !password) {
         return nullptr;
     }
 
-    if (!g_real_wallet->has_keys) {
+    if (!real_wallet->has_keys) {
         return nullptr;
     }
 
     // Mock encryption - in real implementation, this would decrypt the stored seed phrase
-    std::string encrypted_seed = g_real_wallet->seed_phrase; // For mock purposes
+    std::string encrypted_seed = real_wallet->seed_phrase; // For mock purposes
 
     char* seed_ptr = new char[encrypted_seed.length() + 1];
     strcpy(seed_ptr, encrypted_seed.c_str());
@@ -1277,48 +2435,52 @@ extern "C" char* fuego_wallet_get_seed_phrase(FuegoWallet wallet, const char* pa
 
 // Get view key
 extern "C" char* fuego_wallet_get_view_key(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet || !g_real_wallet->has_keys) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !real_wallet->has_keys) {
         return nullptr;
     }
 
-    char* key_ptr = new char[g_real_wallet->view_key.length() + 1];
-    strcpy(key_ptr, g_real_wallet->view_key.c_str());
+    char* key_ptr = new char[real_wallet->view_key.length() + 1];
+    strcpy(key_ptr, real_wallet->view_key.c_str());
 
     return key_ptr;
 }
 
 // Get spend key
 extern "C" char* fuego_wallet_get_spend_key(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet || !g_real_wallet->has_keys) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !real_wallet->has_keys) {
         return nullptr;
     }
 
-    char* key_ptr = new char[g_real_wallet->spend_key.length() + 1];
-    strcpy(key_ptr, g_real_wallet->spend_key.c_str());
+    char* key_ptr = new char[real_wallet->spend_key.length() + 1];
+    strcpy(key_ptr, real_wallet->spend_key.c_str());
 
     return key_ptr;
 }
 
 // Check if wallet has keys
 extern "C" bool fuego_wallet_has_keys(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return false;
     }
 
-    return g_real_wallet->has_keys;
+    return real_wallet->has_keys;
 }
 
 // Export wallet keys (view key, spend key, address)
 extern "C" char* fuego_wallet_export_keys(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet || !g_real_wallet->has_keys) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !real_wallet->has_keys) {
         return nullptr;
     }
 
     std::string keys_json = "{";
-    keys_json += "\"address\":\"" + g_real_wallet->address + "\",";
-    keys_json += "\"view_key\":\"" + g_real_wallet->view_key + "\",";
-    keys_json += "\"spend_key\":\"" + g_real_wallet->spend_key + "\",";
-    keys_json += "\"seed_phrase\":\"" + g_real_wallet->seed_phrase + "\"";
+    keys_json += "\"address\":\"" + real_wallet->address + "\",";
+    keys_json += "\"view_key\":\"" + real_wallet->view_key + "\",";
+    keys_json += "\"spend_key\":\"" + real_wallet->spend_key + "\",";
+    keys_json += "\"seed_phrase\":\"" + real_wallet->seed_phrase + "\"";
     keys_json += "}";
 
     char* keys_ptr = new char[keys_json.length() + 1];
@@ -1335,18 +2497,19 @@ extern "C" bool fuego_wallet_import_keys(
     const char* spend_key,
     const char* address
 ) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return false;
     }
 
-    if (view_key) g_real_wallet->view_key = view_key;
-    if (spend_key) g_real_wallet->spend_key = spend_key;
-    if (address) g_real_wallet->address = address;
+    if (view_key) real_wallet->view_key = view_key;
+    if (spend_key) real_wallet->spend_key = spend_key;
+    if (address) real_wallet->address = address;
 
-    g_real_wallet->has_keys = true;
+    real_wallet->has_keys = true;
 
     std::cout << "Imported wallet keys" << std::endl;
-    std::cout << "Address: " << g_real_wallet->address << std::endl;
+    std::cout << "Address: " << real_wallet->address << std::endl;
 
     return true;
 }
@@ -1360,23 +2523,19 @@ extern "C" void fuego_wallet_free_key_string(char* key_str) {
 
 // Get sync progress
 extern "C" SyncProgress* fuego_wallet_get_sync_progress(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
     SyncProgress* progress = new SyncProgress();
-    progress->current_height = g_real_wallet->sync_height;
-    progress->total_height = g_real_wallet->network_height;
-    progress->progress_percentage = (float)g_real_wallet->sync_height / (float)g_real_wallet->network_height * 100.0f;
-    progress->is_syncing = g_real_wallet->is_syncing;
-
-    // Calculate estimated time remaining (mock calculation)
-    if (g_real_wallet->is_syncing) {
-        uint64_t remaining_blocks = g_real_wallet->network_height - g_real_wallet->sync_height;
-        progress->estimated_time_remaining = remaining_blocks / 100; // Assuming 100 blocks per second
-    } else {
-        progress->estimated_time_remaining = 0;
-    }
+    progress->current_height = real_wallet->sync_height;
+    progress->total_height = real_wallet->network_height;
+    progress->progress_percentage = (float)real_wallet->sync_height / (float)real_wallet->network_height * 100.0f;
+    progress->is_syncing = real_wallet->is_syncing;
+    progress->estimated_time_remaining = real_wallet->estimated_seconds_remaining();
+    progress->blocks_per_second = real_wallet->sync_speed;
+    progress->time_to_first_balance_ms = real_wallet->time_to_first_balance;
 
     return progress;
 }
@@ -1390,23 +2549,25 @@ extern "C" void fuego_wallet_free_sync_progress(SyncProgress* progress) {
 
 // Get sync status as JSON string (for frontend consumption)
 extern "C" char* fuego_wallet_get_sync_status_json(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
     // Calculate sync progress
-    float progress = (float)g_real_wallet->sync_height / (float)g_real_wallet->network_height * 100.0f;
-    uint64_t remaining_blocks = g_real_wallet->network_height - g_real_wallet->sync_height;
-    uint64_t estimated_seconds = g_real_wallet->is_syncing ? remaining_blocks / 100 : 0;
+    float progress = (float)real_wallet->sync_height / (float)real_wallet->network_height * 100.0f;
+    uint64_t estimated_seconds = real_wallet->estimated_seconds_remaining();
 
     // Format as JSON string
     std::string json = "{";
-    json += "\"current_height\":" + std::to_string(g_real_wallet->sync_height) + ",";
-    json += "\"total_height\":" + std::to_string(g_real_wallet->network_height) + ",";
+    json += "\"current_height\":" + std::to_string(real_wallet->sync_height) + ",";
+    json += "\"total_height\":" + std::to_string(real_wallet->network_height) + ",";
     json += "\"progress_percentage\":" + std::to_string(progress) + ",";
     json += "\"estimated_seconds_remaining\":" + std::to_string(estimated_seconds) + ",";
-    json += "\"is_syncing\":" + std::string(g_real_wallet->is_syncing ? "true" : "false") + ",";
-    json += "\"connection_type\":\"" + g_real_wallet->connection_type + "\"";
+    json += "\"is_syncing\":" + std::string(real_wallet->is_syncing ? "true" : "false") + ",";
+    json += "\"blocks_per_second\":" + std::to_string(real_wallet->sync_speed.load()) + ",";
+    json += "\"time_to_first_balance_ms\":" + std::to_string(real_wallet->time_to_first_balance.load()) + ",";
+    json += "\"connection_type\":\"" + real_wallet->connection_type + "\"";
     json += "}";
 
     char* json_str = new char[json.length() + 1];
@@ -1431,12 +2592,13 @@ extern "C" bool fuego_wallet_add_address_book_entry(
     const char* label,
     const char* description
 ) {
-    if (g_real_wallet.get() != wallet || !address) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !address) {
         return false;
     }
 
     // Check if address already exists
-    for (const auto& entry : g_real_wallet->address_book) {
+    for (const auto& entry : real_wallet->address_book) {
         if (entry.address == address) {
             return false; // Address already exists
         }
@@ -1453,7 +2615,7 @@ extern "C" bool fuego_wallet_add_address_book_entry(
     entry.last_used_time = 0;
     entry.use_count = 0;
 
-    g_real_wallet->address_book.push_back(entry);
+    real_wallet->address_book.push_back(entry);
 
     std::cout << "Added address to address book: " << address;
     if (label && strlen(label) > 0) {
@@ -1469,19 +2631,20 @@ extern "C" bool fuego_wallet_remove_address_book_entry(
     FuegoWallet wallet,
     const char* address
 ) {
-    if (g_real_wallet.get() != wallet || !address) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !address) {
         return false;
     }
 
     // Find and remove entry
-    auto it = std::remove_if(g_real_wallet->address_book.begin(),
-                            g_real_wallet->address_book.end(),
+    auto it = std::remove_if(real_wallet->address_book.begin(),
+                            real_wallet->address_book.end(),
                             [address](const RealFuegoWallet::AddressBookEntry& entry) {
                                 return entry.address == address;
                             });
 
-    if (it != g_real_wallet->address_book.end()) {
-        g_real_wallet->address_book.erase(it, g_real_wallet->address_book.end());
+    if (it != real_wallet->address_book.end()) {
+        real_wallet->address_book.erase(it, real_wallet->address_book.end());
         std::cout << "Removed address from address book: " << address << std::endl;
         return true;
     }
@@ -1496,12 +2659,13 @@ extern "C" bool fuego_wallet_update_address_book_entry(
     const char* label,
     const char* description
 ) {
-    if (g_real_wallet.get() != wallet || !address) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !address) {
         return false;
     }
 
     // Find and update entry
-    for (auto& entry : g_real_wallet->address_book) {
+    for (auto& entry : real_wallet->address_book) {
         if (entry.address == address) {
             if (label) entry.label = label;
             if (description) entry.description = description;
@@ -1515,12 +2679,13 @@ extern "C" bool fuego_wallet_update_address_book_entry(
 
 // Get address book entries
 extern "C" void* fuego_wallet_get_address_book(FuegoWallet wallet) {
-    if (g_real_wallet.get() != wallet) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
         return nullptr;
     }
 
     // Return pointer to address book vector for parsing by Rust
-    return static_cast<void*>(&g_real_wallet->address_book);
+    return static_cast<void*>(&real_wallet->address_book);
 }
 
 // Free address book
@@ -1534,12 +2699,13 @@ extern "C" bool fuego_wallet_mark_address_used(
     FuegoWallet wallet,
     const char* address
 ) {
-    if (g_real_wallet.get() != wallet || !address) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !address) {
         return false;
     }
 
     // Find and update usage statistics
-    for (auto& entry : g_real_wallet->address_book) {
+    for (auto& entry : real_wallet->address_book) {
         if (entry.address == address) {
             entry.use_count++;
             entry.last_used_time = std::chrono::duration_cast<std::chrono::seconds>(
@@ -1557,12 +2723,13 @@ extern "C" char* fuego_wallet_get_address_book_entry(
     FuegoWallet wallet,
     const char* address
 ) {
-    if (g_real_wallet.get() != wallet || !address) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet || !address) {
         return nullptr;
     }
 
     // Find entry
-    for (const auto& entry : g_real_wallet->address_book) {
+    for (const auto& entry : real_wallet->address_book) {
         if (entry.address == address) {
             // Format as JSON string
             std::string json = "{";
@@ -1590,4 +2757,235 @@ extern "C" void fuego_wallet_free_address_book_entry(char* json_str) {
     }
 }
 
+// ===== FLAT RECORD BUFFERS =====
 
+// Writes one flat record buffer (see FuegoRecordHeader) straight into the
+// caller's memory. Sizes keep being counted once the buffer is full so the
+// caller learns how much to provide on the next attempt.
+class RecordWriter {
+public:
+    RecordWriter(void* buffer, size_t buffer_size, FuegoRecordType type, size_t record_size, size_t count) :
+        m_buffer(static_cast<char*>(buffer)), m_bufferSize(buffer ? buffer_size : 0), m_type(type),
+        m_recordSize(record_size), m_count(count),
+        m_stringsOffset(sizeof(FuegoRecordHeader) + record_size * count), m_used(m_stringsOffset) {
+    }
+
+    // Zeroed slot for record index, or scratch when the table does not fit
+    template<class Record>
+    Record& record(size_t index, Record& scratch) {
+        Record* slot = &scratch;
+        if (m_stringsOffset <= m_bufferSize) {
+            slot = reinterpret_cast<Record*>(m_buffer + sizeof(FuegoRecordHeader) + index * sizeof(Record));
+        }
+        std::memset(slot, 0, sizeof(Record));
+        return *slot;
+    }
+
+    FuegoStringRef string(const std::string& value) {
+        FuegoStringRef ref;
+        ref.offset = static_cast<uint32_t>(m_used - m_stringsOffset);
+        ref.length = static_cast<uint32_t>(value.size());
+        if (m_used + value.size() + 1 <= m_bufferSize) {
+            std::memcpy(m_buffer + m_used, value.c_str(), value.size() + 1);
+        }
+        m_used += value.size() + 1;
+        return ref;
+    }
+
+    // Writes the header and returns the size of the complete buffer
+    size_t finish() {
+        size_t required = (m_used + 7) & ~static_cast<size_t>(7);
+        if (m_bufferSize >= sizeof(FuegoRecordHeader)) {
+            FuegoRecordHeader header;
+            header.version = FUEGO_RECORD_FORMAT_VERSION;
+            header.record_type = m_type;
+            header.record_size = static_cast<uint32_t>(m_recordSize);
+            header.count = m_used <= m_bufferSize ? static_cast<uint32_t>(m_count) : 0;
+            header.strings_offset = static_cast<uint32_t>(m_stringsOffset);
+            header.reserved = 0;
+            header.required_size = required;
+            std::memcpy(m_buffer, &header, sizeof(header));
+        }
+        return required;
+    }
+
+private:
+    char* m_buffer;
+    size_t m_bufferSize;
+    FuegoRecordType m_type;
+    size_t m_recordSize;
+    size_t m_count;
+    size_t m_stringsOffset;
+    size_t m_used;
+};
+
+static_assert(sizeof(FuegoRecordHeader) % 8 == 0, "records must stay 8-byte aligned");
+static_assert(sizeof(FuegoAddressBookRecord) % 8 == 0, "record sizes must be multiples of 8");
+static_assert(sizeof(FuegoDepositRecord) % 8 == 0, "record sizes must be multiples of 8");
+static_assert(sizeof(FuegoMiningStatsRecord) % 8 == 0, "record sizes must be multiples of 8");
+static_assert(sizeof(FuegoSyncStatusRecord) % 8 == 0, "record sizes must be multiples of 8");
+
+static size_t write_address_book_records(const RealFuegoWallet& wallet, void* buffer, size_t buffer_size) {
+    const auto& entries = wallet.address_book;
+    RecordWriter writer(buffer, buffer_size, FUEGO_RECORD_ADDRESS_BOOK, sizeof(FuegoAddressBookRecord), entries.size());
+    FuegoAddressBookRecord scratch;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        FuegoAddressBookRecord& record = writer.record(i, scratch);
+        record.address = writer.string(entries[i].address);
+        record.label = writer.string(entries[i].label);
+        record.description = writer.string(entries[i].description);
+        record.created_time = entries[i].created_time;
+        record.last_used_time = entries[i].last_used_time;
+        record.use_count = entries[i].use_count;
+    }
+    return writer.finish();
+}
+
+static size_t write_deposit_records(RealFuegoWallet& wallet, void* buffer, size_t buffer_size) {
+    const uint64_t blocks_per_day = CryptoNote::parameters::EXPECTED_NUMBER_OF_BLOCKS_PER_DAY;
+    uint64_t height = wallet.sync_height;
+    std::lock_guard<std::mutex> lock(wallet.deposit_mutex);
+    const auto& deposits = wallet.deposits;
+    RecordWriter writer(buffer, buffer_size, FUEGO_RECORD_DEPOSIT, sizeof(FuegoDepositRecord), deposits.size());
+    FuegoDepositRecord scratch;
+    auto time_string = [](uint64_t time) { return time != 0 ? std::to_string(time) : std::string(); };
+    for (size_t i = 0; i < deposits.size(); ++i) {
+        const RealFuegoWallet::Deposit& deposit = deposits[i];
+        FuegoDepositRecord& record = writer.record(i, scratch);
+        uint64_t unlock_time = deposit.creating_time == 0 ? 0 :
+            deposit.creating_time + (deposit.unlock_height - deposit.creating_height) * CryptoNote::parameters::DIFFICULTY_TARGET;
+        record.id = writer.string(std::to_string(i));
+        record.status = writer.string(deposit.spent ? "spent" : deposit.unlock_height <= height ? "unlocked" : "locked");
+        record.unlock_time = writer.string(time_string(unlock_time));
+        record.creating_transaction_hash = writer.string(hash_to_hex(deposit.creating_transaction_hash));
+        record.creating_time = writer.string(time_string(deposit.creating_time));
+        record.spending_transaction_hash = writer.string(deposit.spent ? hash_to_hex(deposit.spending_transaction_hash) : std::string());
+        record.spending_time = writer.string(time_string(deposit.spending_time));
+        record.deposit_type = writer.string("Term Deposit");
+        record.amount = deposit.amount;
+        record.interest = deposit.interest;
+        record.unlock_height = deposit.unlock_height;
+        record.creating_height = deposit.creating_height;
+        record.spending_height = deposit.spending_height;
+        record.rate = deposit.amount != 0 ? static_cast<double>(deposit.interest) / deposit.amount : 0.0;
+        record.term = static_cast<uint32_t>(deposit.term / blocks_per_day);
+    }
+    return writer.finish();
+}
+
+static size_t write_mining_stats_record(const RealFuegoWallet& wallet, void* buffer, size_t buffer_size) {
+    RecordWriter writer(buffer, buffer_size, FUEGO_RECORD_MINING_STATS, sizeof(FuegoMiningStatsRecord), 1);
+    FuegoMiningStatsRecord scratch;
+    FuegoMiningStatsRecord& record = writer.record(0, scratch);
+
+    uint64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    uint64_t valid = wallet.valid_shares;
+    uint64_t invalid = wallet.invalid_shares;
+
+    record.hashrate = wallet.hashrate;
+    record.share_acceptance_rate = valid + invalid > 0 ? static_cast<double>(valid) / (valid + invalid) * 100.0 : 0.0;
+    record.share_latency_ms = wallet.share_latency_ms;
+    record.total_hashes = wallet.total_hashes;
+    record.valid_shares = valid;
+    record.invalid_shares = invalid;
+    record.uptime = wallet.is_mining && wallet.mining_start_time > 0 && now > wallet.mining_start_time ?
+                    now - wallet.mining_start_time : 0;
+    record.mining_start_time = wallet.mining_start_time;
+    record.last_share_time = wallet.last_share_time;
+    record.threads = wallet.threads;
+    record.is_mining = wallet.is_mining ? 1 : 0;
+
+#ifdef FUEGO_WITH_CRYPTONOTE
+    Crypto::slow_hash_pool_stats pool;
+    Crypto::slow_hash_pool_get_stats(&pool);
+    record.scratchpads_reserved = pool.reserved;
+    record.scratchpads_in_use = pool.in_use;
+    record.scratchpads_huge_pages = pool.huge_pages;
+    record.scratchpads_numa_bound = pool.numa_bound;
+    record.scratchpad_pool_huge_pages = pool.pool_pages != 0 ? 1 : 0;
+#endif
+
+    return writer.finish();
+}
+
+static size_t write_sync_status_record(const RealFuegoWallet& wallet, void* buffer, size_t buffer_size) {
+    RecordWriter writer(buffer, buffer_size, FUEGO_RECORD_SYNC_STATUS, sizeof(FuegoSyncStatusRecord), 1);
+    FuegoSyncStatusRecord scratch;
+    FuegoSyncStatusRecord& record = writer.record(0, scratch);
+
+    uint64_t current = wallet.sync_height;
+    uint64_t total = wallet.network_height;
+    record.connection_type = writer.string(wallet.connection_type);
+    record.current_height = current;
+    record.total_height = total;
+    record.estimated_seconds_remaining = wallet.estimated_seconds_remaining();
+    record.time_to_first_balance_ms = wallet.time_to_first_balance;
+    record.progress_percentage = total > 0 ? static_cast<double>(current) / total * 100.0 : 0.0;
+    record.blocks_per_second = wallet.sync_speed;
+    record.is_syncing = wallet.is_syncing ? 1 : 0;
+
+    return writer.finish();
+}
+
+extern "C" size_t fuego_wallet_read_records(
+    FuegoWallet wallet,
+    uint32_t record_type,
+    void* buffer,
+    size_t buffer_size
+) {
+    auto real_wallet = find_wallet(wallet);
+    if (!real_wallet) {
+        return 0;
+    }
+
+    switch (record_type) {
+    case FUEGO_RECORD_ADDRESS_BOOK:
+        return write_address_book_records(*real_wallet, buffer, buffer_size);
+    case FUEGO_RECORD_DEPOSIT:
+        return write_deposit_records(*real_wallet, buffer, buffer_size);
+    case FUEGO_RECORD_MINING_STATS:
+        return write_mining_stats_record(*real_wallet, buffer, buffer_size);
+    case FUEGO_RECORD_SYNC_STATUS:
+        return write_sync_status_record(*real_wallet, buffer, buffer_size);
+    default:
+        return 0;
+    }
+}
+
+// Tracing
+
+// Span names must outlive the tracer's buffer, so names passed in from the
+// host are interned for the life of the process
+static const char* intern_span_name(const char* name) {
+    static std::mutex names_mutex;
+    static std::unordered_set<std::string> names;
+
+    std::lock_guard<std::mutex> lock(names_mutex);
+    return names.insert(name ? name : "command").first->c_str();
+}
+
+static thread_local std::vector<std::unique_ptr<Common::ScopedSpan>> host_spans;
+
+extern "C" void fuego_trace_set_enabled(bool enabled) {
+    Common::Tracer::instance().setEnabled(enabled);
+}
+
+extern "C" uint64_t fuego_trace_begin(const char* name) {
+    host_spans.emplace_back(new Common::ScopedSpan(intern_span_name(name)));
+    return host_spans.back()->context().traceId;
+}
+
+extern "C" void fuego_trace_end(void) {
+    if (!host_spans.empty()) {
+        host_spans.pop_back();
+    }
+}
+
+extern "C" size_t fuego_trace_export_chrome(uint64_t trace_id, char* buffer, size_t buffer_size) {
+    std::string json = Common::Tracer::instance().exportChromeTrace(trace_id);
+    if (buffer && buffer_size > json.size()) {
+        memcpy(buffer, json.c_str(), json.size() + 1);
+    }
+    return json.size() + 1;
+}
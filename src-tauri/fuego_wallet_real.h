@@ -66,6 +66,52 @@ typedef struct {
     char extra[1024];
 } TransactionInfo;
 
+// Wallet state changes pushed from the sync thread to a registered callback
+typedef enum {
+    FUEGO_WALLET_EVENT_BALANCE = 0,        // balance or unlocked_balance changed
+    FUEGO_WALLET_EVENT_SYNC_PROGRESS = 1,  // at most about once per second
+    FUEGO_WALLET_EVENT_SYNC_COMPLETED = 2,
+    FUEGO_WALLET_EVENT_TRANSACTION = 3,    // transaction_index was added or updated
+    FUEGO_WALLET_EVENT_MINING_STATS = 4,   // at most about once per second, and on stop
+    FUEGO_WALLET_EVENT_NEW_BLOCK = 5       // network_height advanced; never throttled
+} FuegoWalletEventType;
+
+typedef struct {
+    uint32_t type;
+    uint64_t balance;
+    uint64_t unlocked_balance;
+    uint64_t sync_height;
+    uint64_t network_height;
+    uint64_t transaction_index;
+    bool is_mining;
+    uint32_t threads;
+    double hashrate;
+    uint64_t total_hashes;
+    uint64_t valid_shares;
+    uint64_t invalid_shares;
+    uint64_t mining_uptime;         // seconds
+    double share_latency_ms;
+} WalletEventInfo;
+
+typedef void (*FuegoWalletEventCallback)(void* user_data, const WalletEventInfo* event);
+
+// One row of a transaction history page. The text fields are NUL-terminated
+// strings stored in the caller's arena at the given byte offsets.
+typedef struct {
+    uint64_t index;                 // position in the wallet history, oldest first
+    int64_t amount;
+    uint64_t fee;
+    uint64_t height;                // 0 while the transaction is unconfirmed
+    uint64_t timestamp;
+    uint64_t unlock_time;
+    uint32_t confirmations;
+    bool is_confirmed;
+    bool is_pending;
+    uint32_t hash_offset;
+    uint32_t payment_id_offset;     // empty string when there is no payment id
+    uint32_t destinations_offset;   // comma-separated addresses
+} TransactionRecord;
+
 typedef struct {
     bool is_connected;
     uint32_t peer_count;
@@ -106,8 +152,118 @@ typedef struct {
     float progress_percentage;
     uint64_t estimated_time_remaining;
     bool is_syncing;
+    double blocks_per_second;          // smoothed sync throughput
+    uint64_t time_to_first_balance_ms; // 0 until the first non-zero balance is seen
 } SyncProgress;
 
+// Predicted fee and size of a transfer
+typedef struct {
+    uint64_t fee;
+    uint64_t change_amount;
+    uint64_t transaction_size;   // bytes
+    uint32_t input_count;
+    uint32_t output_count;
+    bool enough_money;
+    bool fits_size_limit;        // within the network's maximum transaction size
+} FeeEstimateInfo;
+
+// Flat record buffers
+//
+// Bulk wallet data is returned as one versioned, flat buffer the caller reads
+// in place instead of parsing JSON:
+//
+//   FuegoRecordHeader | count * record_size bytes of records | string bytes
+//
+// Every integer is little-endian (the native order of all supported targets).
+// Records are fixed-size structs whose sizes are multiples of 8, so the buffer
+// must be 8-byte aligned. String fields are FuegoStringRef values whose offset
+// is relative to header.strings_offset; each string is also NUL-terminated.
+// The version changes whenever a record layout changes.
+#define FUEGO_RECORD_FORMAT_VERSION 1
+
+typedef enum {
+    FUEGO_RECORD_ADDRESS_BOOK = 1,  // FuegoAddressBookRecord
+    FUEGO_RECORD_DEPOSIT = 2,       // FuegoDepositRecord
+    FUEGO_RECORD_MINING_STATS = 3,  // one FuegoMiningStatsRecord
+    FUEGO_RECORD_SYNC_STATUS = 4    // one FuegoSyncStatusRecord
+} FuegoRecordType;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t length;                // excluding the NUL terminator
+} FuegoStringRef;
+
+typedef struct {
+    uint32_t version;               // FUEGO_RECORD_FORMAT_VERSION
+    uint32_t record_type;           // FuegoRecordType
+    uint32_t record_size;
+    uint32_t count;                 // 0 when the buffer was too small
+    uint32_t strings_offset;        // from the start of the buffer
+    uint32_t reserved;
+    uint64_t required_size;         // bytes needed for the complete buffer
+} FuegoRecordHeader;
+
+typedef struct {
+    FuegoStringRef address;
+    FuegoStringRef label;
+    FuegoStringRef description;
+    uint64_t created_time;
+    uint64_t last_used_time;
+    uint32_t use_count;
+    uint32_t reserved;
+} FuegoAddressBookRecord;
+
+typedef struct {
+    FuegoStringRef id;              // decimal deposit id
+    FuegoStringRef status;          // "locked", "unlocked", "spent"
+    FuegoStringRef unlock_time;
+    FuegoStringRef creating_transaction_hash;
+    FuegoStringRef creating_time;
+    FuegoStringRef spending_transaction_hash;  // empty while unspent
+    FuegoStringRef spending_time;
+    FuegoStringRef deposit_type;
+    uint64_t amount;
+    uint64_t interest;
+    uint64_t unlock_height;
+    uint64_t creating_height;
+    uint64_t spending_height;       // 0 while unspent
+    double rate;
+    uint32_t term;                  // days
+    uint32_t reserved;
+} FuegoDepositRecord;
+
+typedef struct {
+    double hashrate;
+    double share_acceptance_rate;   // percent
+    double share_latency_ms;
+    uint64_t total_hashes;
+    uint64_t valid_shares;
+    uint64_t invalid_shares;
+    uint64_t uptime;                // seconds
+    uint64_t mining_start_time;     // 0 when not mining
+    uint64_t last_share_time;       // 0 before the first accepted share
+    uint64_t scratchpads_reserved;  // slow-hash scratchpad pool, 0 without CryptoNote
+    uint64_t scratchpads_in_use;
+    uint64_t scratchpads_huge_pages;
+    uint64_t scratchpads_numa_bound;
+    uint32_t threads;
+    uint8_t is_mining;
+    uint8_t scratchpad_pool_huge_pages;
+    uint8_t reserved[2];
+} FuegoMiningStatsRecord;
+
+typedef struct {
+    FuegoStringRef connection_type;
+    uint64_t current_height;
+    uint64_t total_height;
+    uint64_t estimated_seconds_remaining;
+    uint64_t time_to_first_balance_ms;
+    double progress_percentage;
+    double blocks_per_second;
+    uint8_t is_syncing;
+    uint8_t reserved[7];
+} FuegoSyncStatusRecord;
+
 // Wallet creation and management
 FuegoWallet fuego_wallet_create(
     const char* password,
@@ -159,7 +315,32 @@ TransactionInfo* fuego_wallet_get_transaction_history(
 );
 void fuego_wallet_free_transaction_history(TransactionInfo* tx);
 
+// Copies up to capacity history entries starting at offset into records and
+// their strings into arena, stopping early once the arena is full. Returns the
+// number of records written; total (optional) receives the history length so
+// callers can page with offset += result. Nothing is allocated on the heap.
+size_t fuego_wallet_get_transaction_page(
+    FuegoWallet wallet,
+    uint64_t offset,
+    TransactionRecord* records,
+    size_t capacity,
+    char* arena,
+    size_t arena_size,
+    uint64_t* total
+);
+
+// Registers callback (NULL to remove) for wallet events. The callback runs on
+// the wallet's sync thread and must not call back into this wallet. No events
+// are delivered once fuego_wallet_close returns.
+void fuego_wallet_set_event_callback(
+    FuegoWallet wallet,
+    FuegoWalletEventCallback callback,
+    void* user_data
+);
+
 // Network operations
+// address is one node or a comma-separated list "host[:port],host[:port]"; entries without
+// a port use port. Several nodes give failover and hedged reads.
 bool fuego_wallet_connect_node(
     FuegoWallet wallet,
     const char* address,
@@ -175,17 +356,40 @@ void fuego_wallet_free_network_status(NetworkStatus* status);
 bool fuego_wallet_disconnect_node(FuegoWallet wallet);
 bool fuego_wallet_refresh(FuegoWallet wallet);
 bool fuego_wallet_rescan_blockchain(FuegoWallet wallet, uint64_t start_height);
+// First block a wallet created at timestamp (unix seconds) has to scan. Asks
+// the connected node's block index, falling back to an estimate from the block
+// target; 0 when wallet is unknown.
+uint64_t fuego_wallet_restore_height_for_timestamp(FuegoWallet wallet, uint64_t timestamp);
 uint64_t fuego_wallet_estimate_transaction_fee(
     FuegoWallet wallet,
     const char* address,
     uint64_t amount,
     uint64_t mixin
 );
+// Fills estimate from the wallet's spendable outputs without selecting mixins
+// or signing; returns false for an unknown wallet
+bool fuego_wallet_estimate_transaction(
+    FuegoWallet wallet,
+    const char* address,
+    uint64_t amount,
+    uint64_t mixin,
+    FeeEstimateInfo* estimate
+);
 
 // Deposit operations
+// Deprecated: returns a pointer to internal state, use fuego_wallet_read_records
 void* fuego_wallet_get_deposits(FuegoWallet wallet);
+// Locks amount for term days. Returns the creating transaction hash (the
+// deposit id while deposits are simulated), free with fuego_wallet_free_string;
+// the deposit is listed once the wallet has seen its transaction.
 void* fuego_wallet_create_deposit(FuegoWallet wallet, uint64_t amount, uint32_t term);
+// Spends the unlocked deposit with the id of its FuegoDepositRecord. Returns
+// the withdrawal transaction hash, free with fuego_wallet_free_string.
 void* fuego_wallet_withdraw_deposit(FuegoWallet wallet, const char* deposit_id);
+// Writes the ids of the deposits that can be withdrawn at the wallet's height
+// to ids (up to capacity, ids may be NULL) and their total to total_amount
+// (may be NULL). Returns how many there are.
+size_t fuego_wallet_get_withdrawable_deposits(FuegoWallet wallet, uint64_t* ids, size_t capacity, uint64_t* total_amount);
 
 // ===== PHASE 2: ADVANCED CRYPTONOTE INTEGRATION =====
 
@@ -223,6 +427,7 @@ bool fuego_wallet_stop_mining(FuegoWallet wallet);
 MiningInfo* fuego_wallet_get_mining_info(FuegoWallet wallet);
 void fuego_wallet_free_mining_info(MiningInfo* info);
 bool fuego_wallet_set_mining_pool(FuegoWallet wallet, const char* pool_address, const char* worker_name);
+bool fuego_wallet_set_resource_limits(FuegoWallet wallet, uint32_t mining_threads, uint32_t rescan_workers);
 
 // Mining statistics functions
 char* fuego_wallet_get_mining_stats_json(FuegoWallet wallet);
@@ -250,12 +455,36 @@ void fuego_wallet_free_sync_status_json(char* json_str);
 bool fuego_wallet_add_address_book_entry(FuegoWallet wallet, const char* address, const char* label, const char* description);
 bool fuego_wallet_remove_address_book_entry(FuegoWallet wallet, const char* address);
 bool fuego_wallet_update_address_book_entry(FuegoWallet wallet, const char* address, const char* label, const char* description);
+// Deprecated: returns a pointer to internal state, use fuego_wallet_read_records
 void* fuego_wallet_get_address_book(FuegoWallet wallet);
 void fuego_wallet_free_address_book(void* address_book_ptr);
 bool fuego_wallet_mark_address_used(FuegoWallet wallet, const char* address);
 char* fuego_wallet_get_address_book_entry(FuegoWallet wallet, const char* address);
 void fuego_wallet_free_address_book_entry(char* json_str);
 
+// Writes the records of record_type into buffer (8-byte aligned, may be NULL
+// when buffer_size is 0). Returns the size of the complete buffer, or 0 for an
+// unknown wallet or record type. If that is larger than buffer_size only the
+// header is written, with count 0; retry with a larger buffer.
+size_t fuego_wallet_read_records(
+    FuegoWallet wallet,
+    uint32_t record_type,
+    void* buffer,
+    size_t buffer_size
+);
+
+// Tracing. fuego_trace_begin opens a span on the calling thread that native
+// work done on that thread (and the node requests it issues) nests under,
+// and returns its trace id (0 while tracing is disabled); fuego_trace_end
+// closes the innermost one. fuego_trace_export_chrome writes the retained
+// spans of trace_id (0 for all) as Chrome trace JSON and returns the size
+// needed including the terminator; nothing is written if that exceeds
+// buffer_size.
+void fuego_trace_set_enabled(bool enabled);
+uint64_t fuego_trace_begin(const char* name);
+void fuego_trace_end(void);
+size_t fuego_trace_export_chrome(uint64_t trace_id, char* buffer, size_t buffer_size);
+
 // Utility functions
 void fuego_wallet_free_string(char* s);
 void fuego_wallet_free_transactions(TransactionList txs);
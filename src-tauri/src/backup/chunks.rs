@@ -0,0 +1,274 @@
+use std::collections::HashSet;
+use std::fmt;
+use std::fs;
+use std::io::{Read, Write};
+use std::path::{Path, PathBuf};
+
+use aes_gcm::aead::{Aead, OsRng};
+use aes_gcm::{Aes256Gcm, Key, KeyInit, Nonce};
+use flate2::read::DeflateDecoder;
+use flate2::write::DeflateEncoder;
+use flate2::Compression;
+use rand::RngCore;
+
+/// No boundary is looked for before this many bytes, so chunks never get tiny
+const MIN_CHUNK_SIZE: usize = 2 * 1024;
+/// A chunk is cut here even when the content offers no boundary
+const MAX_CHUNK_SIZE: usize = 64 * 1024;
+/// Top 13 bits of the gear hash: a boundary every 8 KiB on average past the minimum
+const BOUNDARY_MASK: u64 = !((1u64 << 51) - 1);
+
+const KEY_FILE: &str = "store.key";
+const ID_KEY_CONTEXT: &str = "fuego-wallet backup chunk id v1";
+const ENCRYPTION_KEY_CONTEXT: &str = "fuego-wallet backup chunk encryption v1";
+
+const fn gear_table() -> [u64; 256] {
+    // splitmix64, any fixed random table works as long as it never changes
+    let mut table = [0u64; 256];
+    let mut state: u64 = 0;
+    let mut i = 0;
+    while i < 256 {
+        state = state.wrapping_add(0x9E37_79B9_7F4A_7C15);
+        let mut z = state;
+        z = (z ^ (z >> 30)).wrapping_mul(0xBF58_476D_1CE4_E5B9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94D0_49BB_1331_11EB);
+        table[i] = z ^ (z >> 31);
+        i += 1;
+    }
+    table
+}
+
+static GEAR: [u64; 256] = gear_table();
+
+/// Splits `data` where its content says so, so an edit only changes the chunks around it
+/// instead of shifting every boundary after it
+pub fn split(data: &[u8]) -> Vec<&[u8]> {
+    let mut chunks = Vec::new();
+    let mut start = 0;
+    while start < data.len() {
+        let len = next_boundary(&data[start..]);
+        chunks.push(&data[start..start + len]);
+        start += len;
+    }
+    chunks
+}
+
+fn next_boundary(data: &[u8]) -> usize {
+    if data.len() <= MIN_CHUNK_SIZE {
+        return data.len();
+    }
+
+    let end = data.len().min(MAX_CHUNK_SIZE);
+    let mut hash: u64 = 0;
+    for (i, byte) in data[..end].iter().enumerate().skip(MIN_CHUNK_SIZE - 64) {
+        hash = (hash << 1).wrapping_add(GEAR[*byte as usize]);
+        if i >= MIN_CHUNK_SIZE && hash & BOUNDARY_MASK == 0 {
+            return i + 1;
+        }
+    }
+    end
+}
+
+/// Deduplicating store of compressed, encrypted backup chunks.
+///
+/// A chunk is named by its BLAKE3 hash keyed with the store key, so equal chunks from different
+/// backups are stored once and the names reveal nothing about the content. The AES-GCM nonce is
+/// taken from that name: a nonce is only ever reused for the very same plaintext.
+pub struct ChunkStore {
+    dir: PathBuf,
+    id_key: [u8; 32],
+    encryption_key: [u8; 32],
+}
+
+impl fmt::Debug for ChunkStore {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("ChunkStore").field("dir", &self.dir).finish()
+    }
+}
+
+impl ChunkStore {
+    /// Opens the store in `dir`, creating it and its key on first use
+    pub fn open(dir: PathBuf) -> Result<Self, String> {
+        fs::create_dir_all(&dir)
+            .map_err(|e| format!("Failed to create chunk store directory: {}", e))?;
+
+        let key_path = dir.join(KEY_FILE);
+        let store_key = match fs::read(&key_path) {
+            Ok(bytes) => bytes,
+            Err(e) if e.kind() == std::io::ErrorKind::NotFound => {
+                let mut bytes = vec![0u8; 32];
+                OsRng.fill_bytes(&mut bytes);
+                write_atomically(&key_path, &bytes)?;
+                bytes
+            }
+            Err(e) => return Err(format!("Failed to read chunk store key: {}", e)),
+        };
+        if store_key.len() != 32 {
+            return Err("Chunk store key is damaged".to_string());
+        }
+
+        Ok(Self {
+            dir,
+            id_key: blake3::derive_key(ID_KEY_CONTEXT, &store_key),
+            encryption_key: blake3::derive_key(ENCRYPTION_KEY_CONTEXT, &store_key),
+        })
+    }
+
+    pub fn chunk_id(&self, chunk: &[u8]) -> String {
+        blake3::keyed_hash(&self.id_key, chunk).to_hex().to_string()
+    }
+
+    /// Stores `chunk` under `id` unless an earlier backup already did, returns the bytes written
+    pub fn put(&self, id: &str, chunk: &[u8]) -> Result<u64, String> {
+        let path = self.chunk_path(id)?;
+        if path.exists() {
+            return Ok(0);
+        }
+
+        let mut encoder = DeflateEncoder::new(Vec::with_capacity(chunk.len() / 2), Compression::default());
+        encoder.write_all(chunk)
+            .map_err(|e| format!("Failed to compress backup chunk: {}", e))?;
+        let compressed = encoder.finish()
+            .map_err(|e| format!("Failed to compress backup chunk: {}", e))?;
+
+        let nonce_bytes = nonce_for(id)?;
+        let ciphertext = self.cipher().encrypt(Nonce::from_slice(&nonce_bytes), compressed.as_ref())
+            .map_err(|e| format!("Failed to encrypt backup chunk: {}", e))?;
+
+        if let Some(parent) = path.parent() {
+            fs::create_dir_all(parent)
+                .map_err(|e| format!("Failed to create chunk directory: {}", e))?;
+        }
+        write_atomically(&path, &ciphertext)?;
+        Ok(ciphertext.len() as u64)
+    }
+
+    /// Reads, decrypts and checks one chunk
+    pub fn get(&self, id: &str) -> Result<Vec<u8>, String> {
+        let ciphertext = fs::read(self.chunk_path(id)?)
+            .map_err(|e| format!("Failed to read backup chunk {}: {}", id, e))?;
+
+        let nonce_bytes = nonce_for(id)?;
+        let compressed = self.cipher().decrypt(Nonce::from_slice(&nonce_bytes), ciphertext.as_ref())
+            .map_err(|_| format!("Backup chunk {} is damaged", id))?;
+
+        let mut chunk = Vec::with_capacity(compressed.len() * 2);
+        DeflateDecoder::new(compressed.as_slice()).read_to_end(&mut chunk)
+            .map_err(|e| format!("Failed to decompress backup chunk {}: {}", id, e))?;
+
+        if self.chunk_id(&chunk) != id {
+            return Err(format!("Backup chunk {} is damaged", id));
+        }
+        Ok(chunk)
+    }
+
+    /// Reads the chunks on all cores, in the order of `ids`
+    pub fn get_all(&self, ids: &[String]) -> Result<Vec<Vec<u8>>, String> {
+        if ids.is_empty() {
+            return Ok(Vec::new());
+        }
+
+        let threads = std::thread::available_parallelism().map(|n| n.get()).unwrap_or(1);
+        let per_thread = (ids.len() + threads - 1) / threads;
+        std::thread::scope(|scope| {
+            let handles: Vec<_> = ids.chunks(per_thread)
+                .map(|group| scope.spawn(move || {
+                    group.iter().map(|id| self.get(id)).collect::<Result<Vec<_>, String>>()
+                }))
+                .collect();
+
+            let mut chunks = Vec::with_capacity(ids.len());
+            for handle in handles {
+                let group = handle.join()
+                    .map_err(|_| "Backup chunk reader panicked".to_string())??;
+                chunks.extend(group);
+            }
+            Ok(chunks)
+        })
+    }
+
+    /// Removes every chunk no longer named in `live`
+    pub fn retain(&self, live: &HashSet<String>) -> Result<(), String> {
+        for entry in fs::read_dir(&self.dir)
+            .map_err(|e| format!("Failed to read chunk store: {}", e))? {
+            let entry = entry.map_err(|e| format!("Failed to read directory entry: {}", e))?;
+            let prefix_path = entry.path();
+            if !prefix_path.is_dir() {
+                continue;
+            }
+
+            let prefix = entry.file_name().to_string_lossy().to_string();
+            for chunk_entry in fs::read_dir(&prefix_path)
+                .map_err(|e| format!("Failed to read chunk store: {}", e))? {
+                let chunk_entry = chunk_entry.map_err(|e| format!("Failed to read directory entry: {}", e))?;
+                let id = format!("{}{}", prefix, chunk_entry.file_name().to_string_lossy());
+                if !live.contains(&id) {
+                    fs::remove_file(chunk_entry.path())
+                        .map_err(|e| format!("Failed to delete backup chunk: {}", e))?;
+                }
+            }
+        }
+
+        Ok(())
+    }
+
+    fn chunk_path(&self, id: &str) -> Result<PathBuf, String> {
+        if id.len() != 64 || !id.bytes().all(|b| b.is_ascii_hexdigit()) {
+            return Err(format!("Invalid backup chunk id: {}", id));
+        }
+        Ok(self.dir.join(&id[..2]).join(&id[2..]))
+    }
+
+    fn cipher(&self) -> Aes256Gcm {
+        Aes256Gcm::new(Key::<Aes256Gcm>::from_slice(&self.encryption_key))
+    }
+}
+
+fn nonce_for(id: &str) -> Result<Vec<u8>, String> {
+    hex::decode(&id[..24]).map_err(|e| format!("Invalid backup chunk id: {}", e))
+}
+
+/// Writes through a temporary file, so a crash never leaves a truncated chunk under its final name
+fn write_atomically(path: &Path, bytes: &[u8]) -> Result<(), String> {
+    let tmp_path = path.with_extension("tmp");
+    fs::write(&tmp_path, bytes)
+        .map_err(|e| format!("Failed to write {}: {}", tmp_path.display(), e))?;
+    fs::rename(&tmp_path, path)
+        .map_err(|e| format!("Failed to write {}: {}", path.display(), e))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn sample(len: usize) -> Vec<u8> {
+        let mut state: u64 = 42;
+        (0..len).map(|_| {
+            state = state.wrapping_mul(6364136223846793005).wrapping_add(1442695040888963407);
+            (state >> 56) as u8
+        }).collect()
+    }
+
+    #[test]
+    fn test_split_bounds() {
+        let data = sample(1 << 20);
+        let chunks = split(&data);
+        assert_eq!(chunks.iter().map(|c| c.len()).sum::<usize>(), data.len());
+        for chunk in &chunks[..chunks.len() - 1] {
+            assert!(chunk.len() >= MIN_CHUNK_SIZE && chunk.len() <= MAX_CHUNK_SIZE);
+        }
+    }
+
+    #[test]
+    fn test_split_survives_insert() {
+        let data = sample(1 << 20);
+        let mut edited = data[..300_000].to_vec();
+        edited.extend_from_slice(b"inserted");
+        edited.extend_from_slice(&data[300_000..]);
+
+        let before: HashSet<&[u8]> = split(&data).into_iter().collect();
+        let after = split(&edited);
+        let changed = after.iter().filter(|c| !before.contains(*c)).count();
+        assert!(changed <= 2, "{} of {} chunks changed", changed, after.len());
+    }
+}
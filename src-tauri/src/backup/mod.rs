@@ -1,4 +1,7 @@
+mod chunks;
+
 use serde::{Deserialize, Serialize};
+use std::collections::HashSet;
 use std::fs;
 use std::path::{Path, PathBuf};
 use std::sync::{Arc, Mutex};
@@ -6,6 +9,11 @@ use std::time::{SystemTime, UNIX_EPOCH};
 use zip::{write::FileOptions, CompressionMethod, ZipWriter};
 use std::io::Write;
 
+use chunks::ChunkStore;
+
+/// Extension of the manifests of incremental backups; older backups are whole `.zip` archives
+const MANIFEST_EXTENSION: &str = "backup";
+
 /// Backup information structure
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct BackupInfo {
@@ -45,11 +53,29 @@ pub struct BackupMetadata {
     pub platform: String,
 }
 
+/// Lists the chunks each part of an incremental backup is made of
+#[derive(Debug, Clone, Serialize, Deserialize)]
+struct BackupManifest {
+    name: String,
+    description: String,
+    created_at: u64,
+    backup_type: BackupType,
+    entries: Vec<ManifestEntry>,
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+struct ManifestEntry {
+    name: String,
+    size: u64,
+    chunks: Vec<String>,
+}
+
 /// Backup manager
 #[derive(Debug)]
 pub struct BackupManager {
     backups: Arc<Mutex<Vec<BackupInfo>>>,
     backup_dir: PathBuf,
+    chunk_store: ChunkStore,
 }
 
 impl BackupManager {
@@ -59,11 +85,16 @@ impl BackupManager {
             .join("fuego-wallet")
             .join("backups");
         
+        Self::with_dir(backup_dir)
+    }
+    
+    pub fn with_dir(backup_dir: PathBuf) -> Result<Self, String> {
         fs::create_dir_all(&backup_dir)
             .map_err(|e| format!("Failed to create backup directory: {}", e))?;
         
         let manager = Self {
             backups: Arc::new(Mutex::new(Vec::new())),
+            chunk_store: ChunkStore::open(backup_dir.join("chunks"))?,
             backup_dir,
         };
         
@@ -84,16 +115,11 @@ impl BackupManager {
             .as_secs();
         
         let backup_id = format!("backup_{}_{}", timestamp, uuid::Uuid::new_v4().to_string()[..8].to_string());
-        let filename = format!("{}.zip", backup_id);
+        let filename = format!("{}.{}", backup_id, MANIFEST_EXTENSION);
         let file_path = self.backup_dir.join(&filename);
         
-        // Create backup file
-        self.write_backup_file(&file_path, &data)?;
-        
-        // Get file size
-        let size_bytes = fs::metadata(&file_path)
-            .map_err(|e| format!("Failed to get file metadata: {}", e))?
-            .len();
+        // Only chunks no earlier backup stored are written, so the size is what this backup added
+        let size_bytes = self.write_backup_manifest(&file_path, &name, &description, timestamp, &backup_type, &data)?;
         
         let backup_info = BackupInfo {
             id: backup_id,
@@ -109,6 +135,7 @@ impl BackupManager {
         let mut backups = self.backups.lock()
             .map_err(|e| format!("Failed to lock backups: {}", e))?;
         backups.push(backup_info.clone());
+        drop(backups);
         
         // Save backups index
         self.save_backups_index()?;
@@ -125,8 +152,14 @@ impl BackupManager {
             .ok_or("Backup not found")?
             .clone();
         
+        drop(backups);
+        
         let file_path = Path::new(&backup_info.file_path);
-        self.read_backup_file(file_path)
+        if is_manifest(file_path) {
+            self.read_backup_manifest(file_path)
+        } else {
+            self.read_backup_file(file_path)
+        }
     }
     
     pub fn list_backups(&self) -> Result<Vec<BackupInfo>, String> {
@@ -150,6 +183,19 @@ impl BackupManager {
         
         // Remove from list
         backups.retain(|b| b.id != backup_id);
+        let remaining = backups.clone();
+        drop(backups);
+        
+        // Drop the chunks only the deleted backup used
+        if is_manifest(Path::new(&backup_info.file_path)) {
+            let mut live = HashSet::new();
+            for backup in remaining.iter().filter(|b| is_manifest(Path::new(&b.file_path))) {
+                for entry in read_manifest(Path::new(&backup.file_path))?.entries {
+                    live.extend(entry.chunks);
+                }
+            }
+            self.chunk_store.retain(&live)?;
+        }
         
         // Save backups index
         self.save_backups_index()?;
@@ -166,15 +212,138 @@ impl BackupManager {
             .ok_or("Backup not found")?
             .clone();
         
+        drop(backups);
+        
         let source_path = Path::new(&backup_info.file_path);
         let dest_path = Path::new(&export_path);
         
+        // A manifest is useless without the chunk store, so it leaves as a self-contained archive
+        if is_manifest(source_path) {
+            let data = self.read_backup_manifest(source_path)?;
+            return self.write_backup_file(&dest_path.to_path_buf(), &data);
+        }
+        
         fs::copy(source_path, dest_path)
             .map_err(|e| format!("Failed to copy backup file: {}", e))?;
         
         Ok(())
     }
     
+    /// Serializes the parts of a backup the way the `.zip` archives hold them
+    fn backup_entries(data: &BackupData) -> Result<Vec<(&'static str, Vec<u8>)>, String> {
+        let mut entries = Vec::new();
+        if let Some(ref wallet_info) = data.wallet_info {
+            entries.push(("wallet.json", serde_json::to_vec_pretty(wallet_info)
+                .map_err(|e| format!("Failed to serialize wallet: {}", e))?));
+        }
+        if let Some(ref transactions) = data.transactions {
+            entries.push(("transactions.json", serde_json::to_vec_pretty(transactions)
+                .map_err(|e| format!("Failed to serialize transactions: {}", e))?));
+        }
+        if let Some(ref settings) = data.settings {
+            entries.push(("settings.json", serde_json::to_vec_pretty(settings)
+                .map_err(|e| format!("Failed to serialize settings: {}", e))?));
+        }
+        if let Some(ref network_status) = data.network_status {
+            entries.push(("network_status.json", serde_json::to_vec_pretty(network_status)
+                .map_err(|e| format!("Failed to serialize network status: {}", e))?));
+        }
+        entries.push(("metadata.json", serde_json::to_vec_pretty(&data.metadata)
+            .map_err(|e| format!("Failed to serialize metadata: {}", e))?));
+        Ok(entries)
+    }
+    
+    /// Stores the new chunks of `data` and writes its manifest, returns the bytes written
+    fn write_backup_manifest(
+        &self,
+        file_path: &Path,
+        name: &str,
+        description: &str,
+        created_at: u64,
+        backup_type: &BackupType,
+        data: &BackupData,
+    ) -> Result<u64, String> {
+        let mut written = 0;
+        let mut manifest = BackupManifest {
+            name: name.to_string(),
+            description: description.to_string(),
+            created_at,
+            backup_type: backup_type.clone(),
+            entries: Vec::new(),
+        };
+        
+        for (entry_name, bytes) in Self::backup_entries(data)? {
+            let mut chunk_ids = Vec::new();
+            for chunk in chunks::split(&bytes) {
+                let id = self.chunk_store.chunk_id(chunk);
+                written += self.chunk_store.put(&id, chunk)?;
+                chunk_ids.push(id);
+            }
+            manifest.entries.push(ManifestEntry {
+                name: entry_name.to_string(),
+                size: bytes.len() as u64,
+                chunks: chunk_ids,
+            });
+        }
+        
+        let manifest_json = serde_json::to_vec_pretty(&manifest)
+            .map_err(|e| format!("Failed to serialize backup manifest: {}", e))?;
+        fs::write(file_path, &manifest_json)
+            .map_err(|e| format!("Failed to write backup manifest: {}", e))?;
+        
+        Ok(written + manifest_json.len() as u64)
+    }
+    
+    fn read_backup_manifest(&self, file_path: &Path) -> Result<BackupData, String> {
+        let manifest = read_manifest(file_path)?;
+        
+        // Every chunk of every part is fetched in one go, so they are all read in parallel
+        let ids: Vec<String> = manifest.entries.iter()
+            .flat_map(|entry| entry.chunks.iter().cloned())
+            .collect();
+        let mut chunks = self.chunk_store.get_all(&ids)?.into_iter();
+        
+        let mut backup_data = BackupData {
+            wallet_info: None,
+            transactions: None,
+            settings: None,
+            network_status: None,
+            metadata: BackupMetadata {
+                version: "1.0.0".to_string(),
+                created_at: manifest.created_at,
+                backup_type: manifest.backup_type.clone(),
+                fuego_version: "1.0.0".to_string(),
+                platform: std::env::consts::OS.to_string(),
+            },
+        };
+        
+        for entry in &manifest.entries {
+            let mut bytes = Vec::with_capacity(entry.size as usize);
+            for chunk in chunks.by_ref().take(entry.chunks.len()) {
+                bytes.extend_from_slice(&chunk);
+            }
+            if bytes.len() as u64 != entry.size {
+                return Err(format!("Backup part {} is incomplete", entry.name));
+            }
+            
+            match entry.name.as_str() {
+                "metadata.json" => backup_data.metadata = serde_json::from_slice(&bytes)
+                    .map_err(|e| format!("Failed to parse metadata: {}", e))?,
+                "wallet.json" => backup_data.wallet_info = Some(serde_json::from_slice(&bytes)
+                    .map_err(|e| format!("Failed to parse wallet data: {}", e))?),
+                "transactions.json" => backup_data.transactions = Some(serde_json::from_slice(&bytes)
+                    .map_err(|e| format!("Failed to parse transactions: {}", e))?),
+                "settings.json" => backup_data.settings = Some(serde_json::from_slice(&bytes)
+                    .map_err(|e| format!("Failed to parse settings: {}", e))?),
+                "network_status.json" => backup_data.network_status = Some(serde_json::from_slice(&bytes)
+                    .map_err(|e| format!("Failed to parse network status: {}", e))?),
+                _ => {}
+            }
+        }
+        
+        Ok(backup_data)
+    }
+    
     fn write_backup_file(&self, file_path: &PathBuf, data: &BackupData) -> Result<(), String> {
         let file = fs::File::create(file_path)
             .map_err(|e| format!("Failed to create backup file: {}", e))?;
@@ -315,7 +484,25 @@ impl BackupManager {
             let entry = entry.map_err(|e| format!("Failed to read directory entry: {}", e))?;
             let path = entry.path();
             
-            if path.extension().and_then(|s| s.to_str()) == Some("zip") {
+            if is_manifest(&path) {
+                let filename = path.file_stem()
+                    .and_then(|s| s.to_str())
+                    .ok_or("Invalid filename")?;
+                let manifest = read_manifest(&path)?;
+                let size_bytes = fs::metadata(&path)
+                    .map_err(|e| format!("Failed to get file metadata: {}", e))?
+                    .len();
+                
+                backups.push(BackupInfo {
+                    id: filename.to_string(),
+                    name: manifest.name,
+                    created_at: manifest.created_at,
+                    size_bytes,
+                    backup_type: manifest.backup_type,
+                    description: manifest.description,
+                    file_path: path.to_string_lossy().to_string(),
+                });
+            } else if path.extension().and_then(|s| s.to_str()) == Some("zip") {
                 if let Ok(metadata) = fs::metadata(&path) {
                     let filename = path.file_stem()
                         .and_then(|s| s.to_str())
@@ -361,4 +548,59 @@ impl BackupManager {
     }
 }
 
+fn is_manifest(path: &Path) -> bool {
+    path.extension().and_then(|s| s.to_str()) == Some(MANIFEST_EXTENSION)
+}
+
+fn read_manifest(path: &Path) -> Result<BackupManifest, String> {
+    let content = fs::read(path)
+        .map_err(|e| format!("Failed to read backup manifest: {}", e))?;
+    serde_json::from_slice(&content)
+        .map_err(|e| format!("Failed to parse backup manifest: {}", e))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn sample_data(transaction_count: usize) -> BackupData {
+        BackupData {
+            wallet_info: Some(serde_json::json!({ "address": "fire1", "balance": 42 })),
+            transactions: Some((0..transaction_count)
+                .map(|i| serde_json::json!({ "hash": format!("{:064x}", i * 7919), "amount": i * 1000, "height": i }))
+                .collect()),
+            settings: None,
+            network_status: None,
+            metadata: BackupMetadata {
+                version: "1.0.0".to_string(),
+                created_at: 1,
+                backup_type: BackupType::Full,
+                fuego_version: "1.0.0".to_string(),
+                platform: std::env::consts::OS.to_string(),
+            },
+        }
+    }
+
+    #[test]
+    fn test_incremental_backup_round_trip() {
+        let dir = std::env::temp_dir().join(format!("fuego-backup-test-{}", uuid::Uuid::new_v4()));
+        let manager = BackupManager::with_dir(dir.clone()).unwrap();
+
+        let first = manager.create_backup("first".to_string(), String::new(), BackupType::Full, sample_data(5000)).unwrap();
+        let second = manager.create_backup("second".to_string(), String::new(), BackupType::Full, sample_data(5010)).unwrap();
+        assert!(second.size_bytes * 4 < first.size_bytes, "{} vs {}", second.size_bytes, first.size_bytes);
+
+        let restored = manager.restore_backup(second.id.clone()).unwrap();
+        assert_eq!(restored.transactions.unwrap().len(), 5010);
+
+        manager.delete_backup(first.id).unwrap();
+        let restored = manager.restore_backup(second.id).unwrap();
+        assert_eq!(restored.wallet_info, sample_data(0).wallet_info);
+
+        let reopened = BackupManager::with_dir(dir.clone()).unwrap();
+        assert_eq!(reopened.list_backups().unwrap().len(), 1);
+        fs::remove_dir_all(dir).unwrap();
+    }
+}
+
 // Tauri commands are defined in lib.rs
@@ -8,6 +8,9 @@
 
 pub mod ffi;
 pub mod real_cryptonote;
+pub mod records;
+pub mod session;
+pub mod trace;
 
 pub use ffi::CryptoNoteFFI;
 pub use real_cryptonote::{RealCryptoNoteWallet, connect_to_fuego_network, fetch_fuego_network_data};
@@ -5,7 +5,11 @@
 //!
 //! This module provides real CryptoNote wallet operations using the existing C++ codebase.
 
+use crate::crypto::records::{
+    AddressBookRecord, DepositRecord, FlatRecord, MiningStatsRecord, RecordBuffer, Records, SyncStatusRecord,
+};
 use crate::utils::error::{WalletError, WalletResult};
+use std::cell::RefCell;
 use std::ffi::{CStr, CString};
 use std::os::raw::{c_char, c_void};
 use std::ptr;
@@ -163,6 +167,66 @@ pub struct TransactionInfoFFI {
     pub extra: [c_char; 1024],
 }
 
+/// Predicted fee and size of a transfer
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default, serde::Serialize)]
+pub struct FeeEstimate {
+    pub fee: u64,
+    pub change_amount: u64,
+    pub transaction_size: u64,
+    pub input_count: u32,
+    pub output_count: u32,
+    pub enough_money: bool,
+    pub fits_size_limit: bool,
+}
+
+/// Wallet state change pushed from the native sync thread
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct WalletEventFFI {
+    pub event_type: u32,
+    pub balance: u64,
+    pub unlocked_balance: u64,
+    pub sync_height: u64,
+    pub network_height: u64,
+    pub transaction_index: u64,
+    pub is_mining: bool,
+    pub threads: u32,
+    pub hashrate: f64,
+    pub total_hashes: u64,
+    pub valid_shares: u64,
+    pub invalid_shares: u64,
+    pub mining_uptime: u64,
+    pub share_latency_ms: f64,
+}
+
+pub const WALLET_EVENT_BALANCE: u32 = 0;
+pub const WALLET_EVENT_SYNC_PROGRESS: u32 = 1;
+pub const WALLET_EVENT_SYNC_COMPLETED: u32 = 2;
+pub const WALLET_EVENT_TRANSACTION: u32 = 3;
+pub const WALLET_EVENT_MINING_STATS: u32 = 4;
+pub const WALLET_EVENT_NEW_BLOCK: u32 = 5;
+
+pub type WalletEventCallback = extern "C" fn(user_data: *mut c_void, event: *const WalletEventFFI);
+
+/// One row of a history page; the offsets index the page's string arena.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct TransactionRecordFFI {
+    pub index: u64,
+    pub amount: i64,
+    pub fee: u64,
+    pub height: u64,
+    pub timestamp: u64,
+    pub unlock_time: u64,
+    pub confirmations: u32,
+    pub is_confirmed: bool,
+    pub is_pending: bool,
+    pub hash_offset: u32,
+    pub payment_id_offset: u32,
+    pub destinations_offset: u32,
+}
+
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
 pub struct NetworkInfoFFI {
@@ -210,6 +274,8 @@ pub struct SyncProgress {
     pub progress_percentage: f32,
     pub estimated_time_remaining: u64,
     pub is_syncing: bool,
+    pub blocks_per_second: f64,
+    pub time_to_first_balance_ms: u64,
 }
 
 // FFI bindings for real CryptoNote operations
@@ -225,6 +291,7 @@ unsafe extern "C" {
     fn fuego_wallet_open(file_path: *const c_char, password: *const c_char) -> *mut c_void;
 
     fn fuego_wallet_close(wallet: *mut c_void);
+    fn fuego_wallet_set_event_callback(wallet: *mut c_void, callback: Option<WalletEventCallback>, user_data: *mut c_void);
 
     fn fuego_wallet_is_open(wallet: *mut c_void) -> bool;
 
@@ -249,10 +316,15 @@ unsafe extern "C" {
     fn fuego_wallet_get_transactions(wallet: *mut c_void, limit: u64, offset: u64) -> *mut c_void;
 
     // Deposit operations
-    fn fuego_wallet_get_deposits(wallet: *mut c_void) -> *mut c_void;
     fn fuego_wallet_create_deposit(wallet: *mut c_void, amount: u64, term: u32) -> *mut c_void;
     fn fuego_wallet_withdraw_deposit(wallet: *mut c_void, deposit_id: *const c_char)
         -> *mut c_void;
+    fn fuego_wallet_get_withdrawable_deposits(
+        wallet: *mut c_void,
+        ids: *mut u64,
+        capacity: usize,
+        total_amount: *mut u64,
+    ) -> usize;
 
     // Network operations
     fn fuego_wallet_connect_node(wallet: *mut c_void, address: *const c_char, port: u16) -> bool;
@@ -266,6 +338,7 @@ unsafe extern "C" {
     fn fuego_wallet_get_wallet_info(wallet: *mut c_void) -> *mut WalletInfoFFI;
     fn fuego_wallet_refresh(wallet: *mut c_void) -> bool;
     fn fuego_wallet_rescan_blockchain(wallet: *mut c_void, start_height: u64) -> bool;
+    fn fuego_wallet_restore_height_for_timestamp(wallet: *mut c_void, timestamp: u64) -> u64;
     fn fuego_wallet_set_refresh_from_block_height(wallet: *mut c_void, height: u64) -> bool;
 
     // Transaction management
@@ -290,8 +363,7 @@ unsafe extern "C" {
     fn fuego_wallet_stop_mining(wallet: *mut c_void) -> bool;
     fn fuego_wallet_get_mining_info(wallet: *mut c_void) -> *mut MiningInfo;
     fn fuego_wallet_set_mining_pool(wallet: *mut c_void, pool_address: *const c_char, worker_name: *const c_char) -> bool;
-    fn fuego_wallet_get_mining_stats_json(wallet: *mut c_void) -> *mut c_char;
-    fn fuego_wallet_free_mining_stats_json(json_str: *mut c_char);
+    fn fuego_wallet_set_resource_limits(wallet: *mut c_void, mining_threads: u32, rescan_workers: u32) -> bool;
 
     // Secure key management
     fn fuego_wallet_generate_seed_phrase() -> *mut c_char;
@@ -316,18 +388,13 @@ unsafe extern "C" {
     // Sync progress functions
     fn fuego_wallet_get_sync_progress(wallet: *mut c_void) -> *mut SyncProgress;
     fn fuego_wallet_free_sync_progress(progress: *mut SyncProgress);
-    fn fuego_wallet_get_sync_status_json(wallet: *mut c_void) -> *mut c_char;
-    fn fuego_wallet_free_sync_status_json(json_str: *mut c_char);
 
     // Address book management
     fn fuego_wallet_add_address_book_entry(wallet: *mut c_void, address: *const c_char, label: *const c_char, description: *const c_char) -> bool;
     fn fuego_wallet_remove_address_book_entry(wallet: *mut c_void, address: *const c_char) -> bool;
     fn fuego_wallet_update_address_book_entry(wallet: *mut c_void, address: *const c_char, label: *const c_char, description: *const c_char) -> bool;
-    fn fuego_wallet_get_address_book(wallet: *mut c_void) -> *mut c_void;
-    fn fuego_wallet_free_address_book(address_book_ptr: *mut c_void);
     fn fuego_wallet_mark_address_used(wallet: *mut c_void, address: *const c_char) -> bool;
-    fn fuego_wallet_get_address_book_entry(wallet: *mut c_void, address: *const c_char) -> *mut c_char;
-    fn fuego_wallet_free_address_book_entry(json_str: *mut c_char);
+    fn fuego_wallet_read_records(wallet: *mut c_void, record_type: u32, buffer: *mut c_void, buffer_size: usize) -> usize;
 
     // Utility functions
     fn fuego_wallet_free_string(s: *mut c_char);
@@ -337,23 +404,40 @@ unsafe extern "C" {
     // Transaction history
     fn fuego_wallet_get_transaction_history(wallet: *mut c_void, limit: u64, offset: u64) -> *mut TransactionInfoFFI;
     fn fuego_wallet_free_transaction_history(tx: *mut TransactionInfoFFI);
+    fn fuego_wallet_get_transaction_page(
+        wallet: *mut c_void,
+        offset: u64,
+        records: *mut TransactionRecordFFI,
+        capacity: usize,
+        arena: *mut c_char,
+        arena_size: usize,
+        total: *mut u64,
+    ) -> usize;
     
     // Missing fee estimation function
     fn fuego_wallet_estimate_transaction_fee(wallet: *mut c_void, address: *const c_char, amount: u64, mixin: u64) -> u64;
+    fn fuego_wallet_estimate_transaction(wallet: *mut c_void, address: *const c_char, amount: u64, mixin: u64, estimate: *mut FeeEstimate) -> bool;
 }
 
 /// Real CryptoNote wallet implementation
 pub struct RealCryptoNoteWallet {
     wallet_ptr: *mut c_void,
     is_connected: bool,
+    // reused by every flat record read
+    record_buffer: RefCell<RecordBuffer>,
 }
 
+// The native handle is reference counted and synchronizes its own state, so the
+// wrapper may move between threads; callers serialize access through &mut self.
+unsafe impl Send for RealCryptoNoteWallet {}
+
 impl RealCryptoNoteWallet {
     /// Create a new real CryptoNote wallet instance
     pub fn new() -> Self {
         Self {
             wallet_ptr: ptr::null_mut(),
             is_connected: false,
+            record_buffer: RefCell::new(RecordBuffer::new()),
         }
     }
 
@@ -422,6 +506,19 @@ impl RealCryptoNoteWallet {
         }
     }
 
+    /// Register (or clear with None) the callback for wallet events. It runs on
+    /// the native sync thread and must not call back into this wallet.
+    pub fn set_event_callback(&self, callback: Option<WalletEventCallback>) -> WalletResult<()> {
+        if self.wallet_ptr.is_null() {
+            return Err(WalletError::WalletNotOpen);
+        }
+
+        unsafe {
+            fuego_wallet_set_event_callback(self.wallet_ptr, callback, ptr::null_mut());
+        }
+        Ok(())
+    }
+
     /// Check if wallet is open
     pub fn is_open(&self) -> bool {
         if self.wallet_ptr.is_null() {
@@ -528,7 +625,8 @@ impl RealCryptoNoteWallet {
         Ok(tx_hash)
     }
 
-    /// Connect to Fuego network node
+    /// Connect to Fuego network node. `address` may also be a comma-separated
+    /// `host[:port]` list, in which case the wallet fails over between the nodes.
     pub fn connect_to_node(&mut self, address: &str, port: u16) -> WalletResult<()> {
         if self.wallet_ptr.is_null() {
             return Err(WalletError::WalletNotOpen);
@@ -600,18 +698,62 @@ impl RealCryptoNoteWallet {
             return Err(WalletError::WalletNotOpen);
         }
 
-        let deposits_ptr = unsafe { fuego_wallet_get_deposits(self.wallet_ptr) };
+        self.with_records(|deposits: Records<'_, DepositRecord>| {
+            let optional = |value: &str| (!value.is_empty()).then(|| value.to_string());
+            deposits
+                .iter()
+                .map(|d| DepositInfo {
+                    id: deposits.str(d.id).to_string(),
+                    amount: d.amount,
+                    interest: d.interest,
+                    term: d.term,
+                    rate: d.rate,
+                    status: deposits.str(d.status).to_string(),
+                    unlock_height: d.unlock_height,
+                    unlock_time: optional(deposits.str(d.unlock_time)),
+                    creating_transaction_hash: deposits.str(d.creating_transaction_hash).to_string(),
+                    creating_height: d.creating_height,
+                    creating_time: deposits.str(d.creating_time).to_string(),
+                    spending_transaction_hash: optional(deposits.str(d.spending_transaction_hash)),
+                    spending_height: (d.spending_height != 0).then_some(d.spending_height),
+                    spending_time: optional(deposits.str(d.spending_time)),
+                    deposit_type: deposits.str(d.deposit_type).to_string(),
+                })
+                .collect()
+        })
+    }
 
-        if deposits_ptr.is_null() {
-            return Err(WalletError::TransactionFailed(
-                "Failed to get deposits from wallet".to_string(),
-            ));
+    /// Read the records of `T` into the wallet's reusable buffer and hand a
+    /// borrowed view of them to `f`
+    pub fn with_records<T: FlatRecord, R>(&self, f: impl FnOnce(Records<'_, T>) -> R) -> WalletResult<R> {
+        let mut buffer = self.record_buffer.borrow_mut();
+        let records = self.read_records::<T>(&mut buffer)?;
+        Ok(f(records))
+    }
+
+    /// Fill `buffer` with the records of `T`, growing it as needed, and borrow them
+    pub fn read_records<'a, T: FlatRecord>(&self, buffer: &'a mut RecordBuffer) -> WalletResult<Records<'a, T>> {
+        if self.wallet_ptr.is_null() {
+            return Err(WalletError::WalletNotOpen);
         }
 
-        // Parse deposits from deposits_ptr
-        // For now, return empty list - real implementation would parse C++ deposit data
-        // TODO: Implement real deposit parsing from CryptoNote C++ data structures
-        Ok(vec![])
+        // The data may grow between the size query and the read, so retry a few times
+        for _ in 0..4 {
+            let required = unsafe {
+                fuego_wallet_read_records(self.wallet_ptr, T::RECORD_TYPE, buffer.as_mut_ptr() as *mut c_void, buffer.len())
+            };
+            if required == 0 {
+                return Err(WalletError::Generic("Failed to read wallet records".to_string()));
+            }
+            if required <= buffer.len() {
+                break;
+            }
+            buffer.reserve_bytes(required);
+        }
+
+        buffer
+            .records::<T>()
+            .ok_or_else(|| WalletError::Generic("Malformed wallet record buffer".to_string()))
     }
 
     // ===== PHASE 3.1: ADVANCED CRYPTONOTE INTEGRATION =====
@@ -735,6 +877,16 @@ impl RealCryptoNoteWallet {
         Ok(())
     }
 
+    /// First block a wallet created at `timestamp` (unix seconds) has to scan,
+    /// from the node's block index when connected
+    pub fn restore_height_for_timestamp(&self, timestamp: u64) -> WalletResult<u64> {
+        if self.wallet_ptr.is_null() {
+            return Err(WalletError::WalletNotOpen);
+        }
+
+        Ok(unsafe { fuego_wallet_restore_height_for_timestamp(self.wallet_ptr, timestamp) })
+    }
+
     /// Get transaction by hash
     pub fn get_transaction_by_hash(&self, tx_hash: &str) -> WalletResult<TransactionInfo> {
         if self.wallet_ptr.is_null() {
@@ -810,6 +962,25 @@ impl RealCryptoNoteWallet {
         Ok(fee)
     }
 
+    /// Predict fee, size and inputs of a transfer from the wallet's spendable
+    /// outputs, without selecting mixins or signing
+    pub fn estimate_transaction(&self, address: &str, amount: u64, mixin: u64) -> WalletResult<FeeEstimate> {
+        if self.wallet_ptr.is_null() {
+            return Err(WalletError::WalletNotOpen);
+        }
+
+        let address_c = CString::new(address)?;
+        let mut estimate = FeeEstimate::default();
+        let ok = unsafe {
+            fuego_wallet_estimate_transaction(self.wallet_ptr, address_c.as_ptr(), amount, mixin, &mut estimate)
+        };
+        if !ok {
+            return Err(WalletError::Generic("Failed to estimate transaction".to_string()));
+        }
+
+        Ok(estimate)
+    }
+
     /// Create new address with label
     pub fn create_address(&self, label: Option<&str>) -> WalletResult<String> {
         if self.wallet_ptr.is_null() {
@@ -989,76 +1160,92 @@ impl RealCryptoNoteWallet {
         Ok(tx_hash)
     }
 
-
-
-
-    /// Get transaction history from blockchain
-    pub fn get_transaction_history(&self, limit: u64, offset: u64) -> WalletResult<Vec<TransactionInfo>> {
+    /// Ids of the deposits that can be withdrawn now, and their total amount
+    pub fn get_withdrawable_deposits(&self) -> WalletResult<(Vec<u64>, u64)> {
         if self.wallet_ptr.is_null() {
             return Err(WalletError::WalletNotOpen);
         }
 
-        let mut transactions = Vec::new();
-
-        // Get transactions from the blockchain
-        for i in 0..limit {
-            let tx_ptr = unsafe { fuego_wallet_get_transaction_history(self.wallet_ptr, 1, offset + i) };
-
-            if tx_ptr.is_null() {
-                break; // No more transactions
+        let mut ids = Vec::new();
+        let mut total = 0u64;
+        loop {
+            let count = unsafe {
+                fuego_wallet_get_withdrawable_deposits(self.wallet_ptr, ids.as_mut_ptr(), ids.len(), &mut total)
+            };
+            if count <= ids.len() {
+                ids.truncate(count);
+                return Ok((ids, total));
             }
+            ids.resize(count, 0);
+        }
+    }
 
-            let tx_info = unsafe { &*(tx_ptr as *const TransactionInfoFFI) };
 
-            // Convert C strings to Rust strings
-            let id = unsafe { CStr::from_ptr(tx_info.id.as_ptr()) }.to_string_lossy().to_string();
-            let hash = unsafe { CStr::from_ptr(tx_info.hash.as_ptr()) }.to_string_lossy().to_string();
-            let payment_id = if tx_info.payment_id[0] != 0 {
-                Some(unsafe { CStr::from_ptr(tx_info.payment_id.as_ptr()) }.to_string_lossy().to_string())
-            } else {
-                None
-            };
 
-            let destination_addresses = if tx_info.destination_addresses[0] != 0 {
-                vec![unsafe { CStr::from_ptr(tx_info.destination_addresses.as_ptr()) }.to_string_lossy().to_string()]
-            } else {
-                vec![]
-            };
-
-            let source_addresses = if tx_info.source_addresses[0] != 0 {
-                vec![unsafe { CStr::from_ptr(tx_info.source_addresses.as_ptr()) }.to_string_lossy().to_string()]
-            } else {
-                vec![]
-            };
 
-            let extra = if tx_info.extra[0] != 0 {
-                Some(unsafe { CStr::from_ptr(tx_info.extra.as_ptr()) }.to_string_lossy().to_string())
-            } else {
-                None
-            };
+    /// Get transaction history from blockchain, one FFI call per page
+    pub fn get_transaction_history(&self, limit: u64, offset: u64) -> WalletResult<Vec<TransactionInfo>> {
+        if self.wallet_ptr.is_null() {
+            return Err(WalletError::WalletNotOpen);
+        }
 
-            let transaction = TransactionInfo {
-                id,
-                hash,
-                amount: tx_info.amount,
-                fee: tx_info.fee,
-                height: tx_info.height,
-                timestamp: tx_info.timestamp,
-                confirmations: tx_info.confirmations,
-                is_confirmed: tx_info.is_confirmed,
-                is_pending: tx_info.is_pending,
-                payment_id,
-                destination_addresses,
-                source_addresses,
-                unlock_time: Some(tx_info.unlock_time),
-                extra,
+        const PAGE_SIZE: usize = 256;
+        let mut records = vec![TransactionRecordFFI::default(); PAGE_SIZE];
+        let mut arena: Vec<c_char> = vec![0; PAGE_SIZE * 512];
+        let mut transactions = Vec::with_capacity(limit.min(PAGE_SIZE as u64) as usize);
+        let mut next = offset;
+
+        while (transactions.len() as u64) < limit {
+            let capacity = (limit - transactions.len() as u64).min(PAGE_SIZE as u64) as usize;
+            let mut total = 0u64;
+            let count = unsafe {
+                fuego_wallet_get_transaction_page(
+                    self.wallet_ptr,
+                    next,
+                    records.as_mut_ptr(),
+                    capacity,
+                    arena.as_mut_ptr(),
+                    arena.len(),
+                    &mut total,
+                )
             };
 
-            transactions.push(transaction);
+            if count == 0 {
+                if next < total && capacity > 0 {
+                    // a single record did not fit, grow the arena and retry
+                    let grown = arena.len() * 2;
+                    arena.resize(grown, 0);
+                    continue;
+                }
+                break; // No more transactions
+            }
 
-            unsafe {
-                fuego_wallet_free_transaction_history(tx_ptr);
+            let text = |offset: u32| unsafe { CStr::from_ptr(arena.as_ptr().add(offset as usize)) }.to_string_lossy().to_string();
+
+            for record in &records[..count] {
+                let hash = text(record.hash_offset);
+                let payment_id = text(record.payment_id_offset);
+                let destinations = text(record.destinations_offset);
+
+                transactions.push(TransactionInfo {
+                    id: hash.clone(),
+                    hash,
+                    amount: record.amount,
+                    fee: record.fee,
+                    height: record.height,
+                    timestamp: record.timestamp,
+                    confirmations: record.confirmations,
+                    is_confirmed: record.is_confirmed,
+                    is_pending: record.is_pending,
+                    payment_id: if payment_id.is_empty() { None } else { Some(payment_id) },
+                    destination_addresses: destinations.split(',').filter(|a| !a.is_empty()).map(str::to_string).collect(),
+                    source_addresses: vec![],
+                    unlock_time: Some(record.unlock_time),
+                    extra: None,
+                });
             }
+
+            next += count as u64;
         }
 
         Ok(transactions)
@@ -1091,19 +1278,24 @@ impl RealCryptoNoteWallet {
             return Err(WalletError::WalletNotOpen);
         }
 
-        let json_ptr = unsafe { fuego_wallet_get_sync_status_json(self.wallet_ptr) };
-
-        if json_ptr.is_null() {
-            return Err(WalletError::Generic("Failed to get sync status JSON".to_string()));
-        }
-
-        let json_str = unsafe { CStr::from_ptr(json_ptr).to_string_lossy().to_string() };
-
-        unsafe {
-            fuego_wallet_free_sync_status_json(json_ptr);
-        }
-
-        Ok(json_str)
+        let status = self.with_records(|records: Records<'_, SyncStatusRecord>| {
+            records.iter().next().map(|s| {
+                serde_json::json!({
+                    "current_height": s.current_height,
+                    "total_height": s.total_height,
+                    "progress_percentage": s.progress_percentage,
+                    "estimated_seconds_remaining": s.estimated_seconds_remaining,
+                    "is_syncing": s.is_syncing != 0,
+                    "blocks_per_second": s.blocks_per_second,
+                    "time_to_first_balance_ms": s.time_to_first_balance_ms,
+                    "connection_type": records.str(s.connection_type),
+                })
+            })
+        })?;
+
+        status
+            .map(|json| json.to_string())
+            .ok_or_else(|| WalletError::Generic("Failed to get sync status JSON".to_string()))
     }
 
     /// Add address to address book
@@ -1195,15 +1387,9 @@ impl RealCryptoNoteWallet {
             return Err(WalletError::WalletNotOpen);
         }
 
-        let address_book_ptr = unsafe { fuego_wallet_get_address_book(self.wallet_ptr) };
-
-        if address_book_ptr.is_null() {
-            return Err(WalletError::Generic("Failed to get address book".to_string()));
-        }
-
-        // For now, return empty list - real implementation would parse C++ vector
-        // TODO: Implement proper parsing of C++ vector data structure
-        Ok(vec![])
+        self.with_records(|entries: Records<'_, AddressBookRecord>| {
+            entries.iter().map(|entry| address_book_entry(&entries, entry)).collect()
+        })
     }
 
     /// Mark address as used
@@ -1231,23 +1417,12 @@ impl RealCryptoNoteWallet {
             return Err(WalletError::WalletNotOpen);
         }
 
-        let address_c = CString::new(address)?;
-        let json_ptr = unsafe { fuego_wallet_get_address_book_entry(self.wallet_ptr, address_c.as_ptr()) };
-
-        if json_ptr.is_null() {
-            return Ok(None); // Entry not found
-        }
-
-        let _json_str = unsafe { CStr::from_ptr(json_ptr).to_string_lossy().to_string() };
-
-        unsafe {
-            fuego_wallet_free_address_book_entry(json_ptr);
-        }
-
-        // Parse JSON string to AddressBookEntry
-        // For now, return None - real implementation would parse JSON
-        // TODO: Implement JSON parsing
-        Ok(None)
+        self.with_records(|entries: Records<'_, AddressBookRecord>| {
+            entries
+                .iter()
+                .find(|entry| entries.str(entry.address) == address)
+                .map(|entry| address_book_entry(&entries, entry))
+        })
     }
 
     /// Set mining pool configuration
@@ -1280,25 +1455,55 @@ impl RealCryptoNoteWallet {
         }
     }
 
-    /// Get detailed mining statistics as JSON
-    pub fn get_mining_stats_json(&self) -> WalletResult<String> {
+    /// Cap the miner's active threads and the workers of the next rescan (0 = all cores)
+    pub fn set_resource_limits(&self, mining_threads: u32, rescan_workers: u32) -> WalletResult<()> {
         if self.wallet_ptr.is_null() {
             return Err(WalletError::WalletNotOpen);
         }
 
-        let json_ptr = unsafe { fuego_wallet_get_mining_stats_json(self.wallet_ptr) };
-
-        if json_ptr.is_null() {
-            return Err(WalletError::Generic("Failed to get mining statistics JSON".to_string()));
+        let success = unsafe { fuego_wallet_set_resource_limits(self.wallet_ptr, mining_threads, rescan_workers) };
+        if success {
+            Ok(())
+        } else {
+            Err(WalletError::Generic("Failed to set resource limits".to_string()))
         }
+    }
 
-        let json_str = unsafe { CStr::from_ptr(json_ptr).to_string_lossy().to_string() };
-
-        unsafe {
-            fuego_wallet_free_mining_stats_json(json_ptr);
+    /// Get detailed mining statistics as JSON
+    pub fn get_mining_stats_json(&self) -> WalletResult<String> {
+        if self.wallet_ptr.is_null() {
+            return Err(WalletError::WalletNotOpen);
         }
 
-        Ok(json_str)
+        let stats = self.with_records(|records: Records<'_, MiningStatsRecord>| {
+            records.iter().next().map(|m| {
+                let timestamp = |t: u64| (t > 0).then_some(t);
+                serde_json::json!({
+                    "is_mining": m.is_mining != 0,
+                    "hashrate": m.hashrate,
+                    "threads": m.threads,
+                    "total_hashes": m.total_hashes,
+                    "valid_shares": m.valid_shares,
+                    "invalid_shares": m.invalid_shares,
+                    "share_acceptance_rate": m.share_acceptance_rate,
+                    "uptime": m.uptime,
+                    "share_latency_ms": m.share_latency_ms,
+                    "mining_start_time": timestamp(m.mining_start_time),
+                    "last_share_time": timestamp(m.last_share_time),
+                    "scratchpad_pool": {
+                        "reserved": m.scratchpads_reserved,
+                        "in_use": m.scratchpads_in_use,
+                        "huge_pages": m.scratchpads_huge_pages,
+                        "numa_bound": m.scratchpads_numa_bound,
+                        "pool_huge_pages": m.scratchpad_pool_huge_pages != 0,
+                    },
+                })
+            })
+        })?;
+
+        stats
+            .map(|json| json.to_string())
+            .ok_or_else(|| WalletError::Generic("Failed to get mining statistics JSON".to_string()))
     }
 
     /// Generate a new random seed phrase
@@ -1481,6 +1686,17 @@ impl Drop for RealCryptoNoteWallet {
     }
 }
 
+fn address_book_entry(entries: &Records<'_, AddressBookRecord>, entry: &AddressBookRecord) -> AddressBookEntry {
+    AddressBookEntry {
+        address: entries.str(entry.address).to_string(),
+        label: entries.str(entry.label).to_string(),
+        description: entries.str(entry.description).to_string(),
+        created_time: entry.created_time,
+        last_used_time: entry.last_used_time,
+        use_count: entry.use_count,
+    }
+}
+
 // Default Fuego network nodes
 pub const FUEGO_NODES: &[(&str, u16)] = &[
     ("fuego.spaceportx.net", 18180), // Real Fuego node with live blockchain data
@@ -0,0 +1,235 @@
+// Copyright (c) 2024 Fuego Private Banking Network
+// Distributed under the MIT/X11 software license
+
+//! Flat record buffers
+//!
+//! Mirrors the record layout documented in fuego_wallet_real.h. The native
+//! side writes a header, a table of fixed-size `repr(C)` records and a string
+//! area into a caller-owned buffer; this module borrows typed slices and
+//! string views straight out of that buffer without parsing or copying.
+
+use std::mem::size_of;
+
+pub const RECORD_FORMAT_VERSION: u32 = 1;
+
+pub const RECORD_ADDRESS_BOOK: u32 = 1;
+pub const RECORD_DEPOSIT: u32 = 2;
+pub const RECORD_MINING_STATS: u32 = 3;
+pub const RECORD_SYNC_STATUS: u32 = 4;
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct StringRef {
+    pub offset: u32,
+    pub length: u32,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct RecordHeader {
+    pub version: u32,
+    pub record_type: u32,
+    pub record_size: u32,
+    pub count: u32,
+    pub strings_offset: u32,
+    pub reserved: u32,
+    pub required_size: u64,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct AddressBookRecord {
+    pub address: StringRef,
+    pub label: StringRef,
+    pub description: StringRef,
+    pub created_time: u64,
+    pub last_used_time: u64,
+    pub use_count: u32,
+    pub reserved: u32,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct DepositRecord {
+    pub id: StringRef,
+    pub status: StringRef,
+    pub unlock_time: StringRef,
+    pub creating_transaction_hash: StringRef,
+    pub creating_time: StringRef,
+    pub spending_transaction_hash: StringRef,
+    pub spending_time: StringRef,
+    pub deposit_type: StringRef,
+    pub amount: u64,
+    pub interest: u64,
+    pub unlock_height: u64,
+    pub creating_height: u64,
+    pub spending_height: u64,
+    pub rate: f64,
+    pub term: u32,
+    pub reserved: u32,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct MiningStatsRecord {
+    pub hashrate: f64,
+    pub share_acceptance_rate: f64,
+    pub share_latency_ms: f64,
+    pub total_hashes: u64,
+    pub valid_shares: u64,
+    pub invalid_shares: u64,
+    pub uptime: u64,
+    pub mining_start_time: u64,
+    pub last_share_time: u64,
+    pub scratchpads_reserved: u64,
+    pub scratchpads_in_use: u64,
+    pub scratchpads_huge_pages: u64,
+    pub scratchpads_numa_bound: u64,
+    pub threads: u32,
+    pub is_mining: u8,
+    pub scratchpad_pool_huge_pages: u8,
+    pub reserved: [u8; 2],
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct SyncStatusRecord {
+    pub connection_type: StringRef,
+    pub current_height: u64,
+    pub total_height: u64,
+    pub estimated_seconds_remaining: u64,
+    pub time_to_first_balance_ms: u64,
+    pub progress_percentage: f64,
+    pub blocks_per_second: f64,
+    pub is_syncing: u8,
+    pub reserved: [u8; 7],
+}
+
+/// A `repr(C)` record type that may be read directly out of a record buffer.
+///
+/// # Safety
+/// Implementors must match the C layout of the record named by `RECORD_TYPE`
+/// and be valid for any bit pattern.
+pub unsafe trait FlatRecord: Copy {
+    const RECORD_TYPE: u32;
+}
+
+unsafe impl FlatRecord for AddressBookRecord {
+    const RECORD_TYPE: u32 = RECORD_ADDRESS_BOOK;
+}
+
+unsafe impl FlatRecord for DepositRecord {
+    const RECORD_TYPE: u32 = RECORD_DEPOSIT;
+}
+
+unsafe impl FlatRecord for MiningStatsRecord {
+    const RECORD_TYPE: u32 = RECORD_MINING_STATS;
+}
+
+unsafe impl FlatRecord for SyncStatusRecord {
+    const RECORD_TYPE: u32 = RECORD_SYNC_STATUS;
+}
+
+/// Reusable, 8-byte aligned storage for record reads
+#[derive(Debug, Default)]
+pub struct RecordBuffer {
+    words: Vec<u64>,
+}
+
+impl RecordBuffer {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn len(&self) -> usize {
+        self.words.len() * size_of::<u64>()
+    }
+
+    pub fn as_mut_ptr(&mut self) -> *mut u8 {
+        self.words.as_mut_ptr() as *mut u8
+    }
+
+    /// Grow to hold at least `size` bytes; existing contents are not kept
+    pub fn reserve_bytes(&mut self, size: usize) {
+        let words = size.div_ceil(size_of::<u64>());
+        if words > self.words.len() {
+            self.words.resize(words, 0);
+        }
+    }
+
+    fn bytes(&self) -> &[u8] {
+        // u64 storage is always valid to view as bytes
+        unsafe { std::slice::from_raw_parts(self.words.as_ptr() as *const u8, self.len()) }
+    }
+
+    /// Borrow the records of a buffer the native side has filled, or None if
+    /// the header does not describe a complete buffer of `T`
+    pub fn records<T: FlatRecord>(&self) -> Option<Records<'_, T>> {
+        let bytes = self.bytes();
+        if bytes.len() < size_of::<RecordHeader>() {
+            return None;
+        }
+
+        let header = unsafe { *(bytes.as_ptr() as *const RecordHeader) };
+        let table_end = size_of::<RecordHeader>() + header.count as usize * size_of::<T>();
+        let strings_offset = header.strings_offset as usize;
+        if header.version != RECORD_FORMAT_VERSION
+            || header.record_type != T::RECORD_TYPE
+            || header.record_size as usize != size_of::<T>()
+            || header.required_size as usize > bytes.len()
+            || strings_offset < table_end
+            || strings_offset > header.required_size as usize
+        {
+            return None;
+        }
+
+        // The table starts right after the 8-byte aligned header and T's size
+        // is a multiple of 8, so every record is suitably aligned
+        let records = unsafe {
+            std::slice::from_raw_parts(
+                bytes.as_ptr().add(size_of::<RecordHeader>()) as *const T,
+                header.count as usize,
+            )
+        };
+
+        Some(Records {
+            records,
+            strings: &bytes[strings_offset..header.required_size as usize],
+        })
+    }
+}
+
+/// Typed view of a filled record buffer, valid while the buffer is borrowed
+#[derive(Debug, Clone, Copy)]
+pub struct Records<'a, T> {
+    records: &'a [T],
+    strings: &'a [u8],
+}
+
+impl<'a, T> Records<'a, T> {
+    pub fn as_slice(&self) -> &'a [T] {
+        self.records
+    }
+
+    pub fn iter(&self) -> std::slice::Iter<'a, T> {
+        self.records.iter()
+    }
+
+    pub fn len(&self) -> usize {
+        self.records.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.records.is_empty()
+    }
+
+    /// Resolve a string field; out-of-range or non-UTF-8 strings read as ""
+    pub fn str(&self, field: StringRef) -> &'a str {
+        let start = field.offset as usize;
+        let end = start.saturating_add(field.length as usize);
+        self.strings
+            .get(start..end)
+            .and_then(|bytes| std::str::from_utf8(bytes).ok())
+            .unwrap_or("")
+    }
+}
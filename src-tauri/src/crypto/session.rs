@@ -0,0 +1,195 @@
+// Copyright (c) 2024 Fuego Private Banking Network
+// Distributed under the MIT/X11 software license
+
+//! Long-lived wallet session
+//!
+//! The Tauri commands share one open wallet instead of opening, syncing and
+//! closing a fresh one per invocation. State changes reported by the native
+//! sync and mining threads are forwarded to a sink (the frontend event
+//! channel) so the UI can apply deltas rather than re-polling full snapshots.
+
+use crate::crypto::real_cryptonote::{
+    connect_to_fuego_network, RealCryptoNoteWallet, WalletEventFFI, WALLET_EVENT_BALANCE,
+    WALLET_EVENT_MINING_STATS, WALLET_EVENT_NEW_BLOCK, WALLET_EVENT_SYNC_COMPLETED,
+    WALLET_EVENT_SYNC_PROGRESS, WALLET_EVENT_TRANSACTION,
+};
+use serde::Serialize;
+use std::ops::{Deref, DerefMut};
+use std::os::raw::c_void;
+use std::sync::{Mutex, MutexGuard, OnceLock};
+
+pub const DEFAULT_WALLET_PATH: &str = "/tmp/fuego_wallet.wallet";
+pub const DEFAULT_WALLET_PASSWORD: &str = "fuego_password";
+
+/// Name of the frontend event carrying [`WalletEvent`] payloads
+pub const WALLET_EVENT_NAME: &str = "wallet-event";
+
+/// Wallet state change delivered to the frontend
+#[derive(Debug, Clone, Serialize)]
+pub struct WalletEvent {
+    pub kind: &'static str,
+    pub balance: u64,
+    pub unlocked_balance: u64,
+    pub sync_height: u64,
+    pub network_height: u64,
+    pub transaction_index: Option<u64>,
+    pub mining: Option<MiningStatsEvent>,
+}
+
+/// Miner counters carried by "mining_stats" events, same fields as the
+/// mining stats JSON
+#[derive(Debug, Clone, Serialize)]
+pub struct MiningStatsEvent {
+    pub is_mining: bool,
+    pub threads: u32,
+    pub hashrate: f64,
+    pub total_hashes: u64,
+    pub valid_shares: u64,
+    pub invalid_shares: u64,
+    pub share_acceptance_rate: f64,
+    pub uptime: u64,
+    pub share_latency_ms: f64,
+}
+
+type EventSink = Box<dyn Fn(WalletEvent) + Send + Sync>;
+
+static SESSION: Mutex<Option<RealCryptoNoteWallet>> = Mutex::new(None);
+static EVENT_SINK: OnceLock<EventSink> = OnceLock::new();
+/// Latest (mining threads, rescan workers) caps from the resource monitor
+static RESOURCE_LIMITS: Mutex<Option<(u32, u32)>> = Mutex::new(None);
+
+/// Exclusive access to the open session wallet for the duration of a command
+pub struct SessionGuard {
+    guard: MutexGuard<'static, Option<RealCryptoNoteWallet>>,
+}
+
+impl Deref for SessionGuard {
+    type Target = RealCryptoNoteWallet;
+
+    fn deref(&self) -> &RealCryptoNoteWallet {
+        self.guard.as_ref().expect("session wallet is open")
+    }
+}
+
+impl DerefMut for SessionGuard {
+    fn deref_mut(&mut self) -> &mut RealCryptoNoteWallet {
+        self.guard.as_mut().expect("session wallet is open")
+    }
+}
+
+/// Set where wallet events are delivered; only the first call takes effect
+pub fn set_event_sink(sink: impl Fn(WalletEvent) + Send + Sync + 'static) {
+    let _ = EVENT_SINK.set(Box::new(sink));
+}
+
+fn lock_session() -> MutexGuard<'static, Option<RealCryptoNoteWallet>> {
+    SESSION.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+/// Get the session wallet, opening (or creating) and connecting the default
+/// wallet on first use
+pub fn wallet_session() -> Result<SessionGuard, String> {
+    let mut guard = lock_session();
+    if guard.is_none() {
+        let mut wallet = RealCryptoNoteWallet::new();
+        wallet
+            .open_wallet(DEFAULT_WALLET_PATH, DEFAULT_WALLET_PASSWORD)
+            .or_else(|_| wallet.create_wallet(DEFAULT_WALLET_PASSWORD, DEFAULT_WALLET_PATH, None, 0))
+            .map_err(|e| format!("Failed to open/create wallet: {}", e))?;
+
+        if let Err(e) = connect_to_fuego_network(&mut wallet) {
+            log::warn!("Failed to connect to Fuego network: {}", e);
+            // Continue without network connection
+        }
+        *guard = Some(attach(wallet));
+    }
+
+    Ok(SessionGuard { guard })
+}
+
+/// Get the session wallet only if one is open; background work uses this so
+/// it never opens the default wallet by itself
+pub fn open_session() -> Option<SessionGuard> {
+    let guard = lock_session();
+    guard.is_some().then(|| SessionGuard { guard })
+}
+
+/// Make wallet the session wallet, closing the previous one
+pub fn replace_session(wallet: RealCryptoNoteWallet) {
+    let previous = lock_session().replace(attach(wallet));
+    drop(previous);
+}
+
+/// Close the session wallet, if any; the next command reopens the default one
+pub fn close_session() {
+    let previous = lock_session().take();
+    drop(previous);
+}
+
+/// Cap the session wallet's mining threads and rescan workers; the caps are
+/// kept and applied to wallets opened later as well
+pub fn apply_resource_limits(mining_threads: u32, rescan_workers: u32) {
+    *RESOURCE_LIMITS.lock().unwrap_or_else(|poisoned| poisoned.into_inner()) =
+        Some((mining_threads, rescan_workers));
+
+    // A command holding the session only delays this until the next sample
+    if let Ok(guard) = SESSION.try_lock() {
+        if let Some(wallet) = guard.as_ref() {
+            if let Err(e) = wallet.set_resource_limits(mining_threads, rescan_workers) {
+                log::warn!("Failed to apply resource limits: {}", e);
+            }
+        }
+    }
+}
+
+fn attach(wallet: RealCryptoNoteWallet) -> RealCryptoNoteWallet {
+    if let Err(e) = wallet.set_event_callback(Some(on_wallet_event)) {
+        log::warn!("Failed to subscribe to wallet events: {}", e);
+    }
+    let limits = *RESOURCE_LIMITS.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+    if let Some((mining_threads, rescan_workers)) = limits {
+        if let Err(e) = wallet.set_resource_limits(mining_threads, rescan_workers) {
+            log::warn!("Failed to apply resource limits: {}", e);
+        }
+    }
+    wallet
+}
+
+extern "C" fn on_wallet_event(_user_data: *mut c_void, event: *const WalletEventFFI) {
+    let (Some(sink), Some(event)) = (EVENT_SINK.get(), unsafe { event.as_ref() }) else {
+        return;
+    };
+
+    let kind = match event.event_type {
+        WALLET_EVENT_BALANCE => "balance",
+        WALLET_EVENT_SYNC_PROGRESS => "sync_progress",
+        WALLET_EVENT_SYNC_COMPLETED => "sync_completed",
+        WALLET_EVENT_TRANSACTION => "transaction",
+        WALLET_EVENT_MINING_STATS => "mining_stats",
+        WALLET_EVENT_NEW_BLOCK => "new_block",
+        _ => return,
+    };
+
+    sink(WalletEvent {
+        kind,
+        balance: event.balance,
+        unlocked_balance: event.unlocked_balance,
+        sync_height: event.sync_height,
+        network_height: event.network_height,
+        transaction_index: (event.event_type == WALLET_EVENT_TRANSACTION).then_some(event.transaction_index),
+        mining: (event.event_type == WALLET_EVENT_MINING_STATS).then(|| {
+            let shares = event.valid_shares + event.invalid_shares;
+            MiningStatsEvent {
+                is_mining: event.is_mining,
+                threads: event.threads,
+                hashrate: event.hashrate,
+                total_hashes: event.total_hashes,
+                valid_shares: event.valid_shares,
+                invalid_shares: event.invalid_shares,
+                share_acceptance_rate: if shares > 0 { event.valid_shares as f64 / shares as f64 * 100.0 } else { 0.0 },
+                uptime: event.mining_uptime,
+                share_latency_ms: event.share_latency_ms,
+            }
+        }),
+    });
+}
@@ -0,0 +1,81 @@
+// Copyright (c) 2024 Fuego Private Banking Network
+// Distributed under the MIT/X11 software license
+
+//! Command trace spans
+//!
+//! A [`CommandTrace`] opens a native span for the duration of a Tauri command
+//! on the thread running it, so the spans the C++ core records underneath
+//! (wallet operations, node requests, sync batches) share its trace id and
+//! can be exported together as a single Chrome trace.
+
+use std::collections::HashMap;
+use std::ffi::CString;
+use std::os::raw::c_char;
+use std::sync::{Mutex, OnceLock};
+
+unsafe extern "C" {
+    fn fuego_trace_set_enabled(enabled: bool);
+    fn fuego_trace_begin(name: *const c_char) -> u64;
+    fn fuego_trace_end();
+    fn fuego_trace_export_chrome(trace_id: u64, buffer: *mut c_char, buffer_size: usize) -> usize;
+}
+
+static LAST_TRACES: OnceLock<Mutex<HashMap<&'static str, u64>>> = OnceLock::new();
+
+fn last_traces() -> &'static Mutex<HashMap<&'static str, u64>> {
+    LAST_TRACES.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+/// Root span of one command; closed when dropped, which must happen on the
+/// thread that began it
+pub struct CommandTrace {
+    trace_id: u64,
+    _not_send: std::marker::PhantomData<*const ()>,
+}
+
+impl CommandTrace {
+    pub fn begin(command: &'static str) -> Self {
+        let name = CString::new(command).unwrap_or_default();
+        let trace_id = unsafe { fuego_trace_begin(name.as_ptr()) };
+        if trace_id != 0 {
+            last_traces().lock().unwrap_or_else(|p| p.into_inner()).insert(command, trace_id);
+        }
+
+        Self { trace_id, _not_send: std::marker::PhantomData }
+    }
+
+    /// Trace id, or 0 while tracing is disabled
+    pub fn trace_id(&self) -> u64 {
+        self.trace_id
+    }
+}
+
+impl Drop for CommandTrace {
+    fn drop(&mut self) {
+        unsafe { fuego_trace_end() };
+    }
+}
+
+pub fn set_tracing_enabled(enabled: bool) {
+    unsafe { fuego_trace_set_enabled(enabled) };
+}
+
+/// Trace id of the most recent traced run of command
+pub fn last_trace_id(command: &str) -> Option<u64> {
+    last_traces().lock().unwrap_or_else(|p| p.into_inner()).get(command).copied()
+}
+
+/// Export the retained spans of trace_id (every retained span for 0) as
+/// Chrome trace JSON, loadable in chrome://tracing or Perfetto
+pub fn export_chrome_trace(trace_id: u64) -> String {
+    let mut buffer: Vec<u8> = Vec::new();
+    // Spans may be recorded between the size query and the copy
+    loop {
+        let required = unsafe { fuego_trace_export_chrome(trace_id, buffer.as_mut_ptr() as *mut c_char, buffer.len()) };
+        if required <= buffer.len() {
+            buffer.truncate(required.saturating_sub(1));
+            return String::from_utf8_lossy(&buffer).into_owned();
+        }
+        buffer.resize(required + 4096, 0);
+    }
+}
@@ -15,28 +15,33 @@ pub mod advanced;
 
 use log::info;
 use crate::crypto::ffi::CryptoNoteFFI;
-use crate::crypto::real_cryptonote::{RealCryptoNoteWallet, connect_to_fuego_network, fetch_fuego_network_data};
+use crate::crypto::real_cryptonote::{RealCryptoNoteWallet, FeeEstimate, connect_to_fuego_network, fetch_fuego_network_data};
+use crate::crypto::trace::{self, CommandTrace};
+use crate::crypto::session::{wallet_session, open_session, replace_session, close_session, set_event_sink, apply_resource_limits, WALLET_EVENT_NAME};
 use crate::security::{SecurityManager, SecurityConfig, PasswordValidator, WalletEncryption};
-use crate::performance::{PerformanceMonitor, PerformanceConfig, Cache, BackgroundTaskManager};
+use crate::performance::{PerformanceMonitor, PerformanceConfig, Cache, TipCache, TaskScheduler, json_weight};
 use crate::settings::{SettingsManager};
-use crate::backup::{BackupManager};
+use crate::backup::{BackupManager, BackupData, BackupMetadata, BackupType};
 use crate::i18n::{I18nManager, LanguageInfo};
-use crate::optimization::{ResourceMonitor, MemoryOptimization, CPUOptimization, AdvancedCache, ThreadPool, PerformanceProfiler};
+use crate::optimization::{ResourceMonitor, MemoryOptimization, CPUOptimization, AdvancedCache, ThreadPool, BlockingExecutor, PerformanceProfiler};
 use crate::advanced::{AdvancedWalletManager, AdvancedUIManager, EnhancedWalletInfo, AdvancedTransactionInfo};
 use std::sync::Arc;
+use tauri::Emitter;
 use std::time::{Duration, SystemTime, UNIX_EPOCH};
 
 // Global state for security, performance, settings, backup, i18n, optimization, and advanced features
 static SECURITY_MANAGER: std::sync::OnceLock<Arc<SecurityManager>> = std::sync::OnceLock::new();
 static PERFORMANCE_MONITOR: std::sync::OnceLock<Arc<PerformanceMonitor>> = std::sync::OnceLock::new();
 static CACHE: std::sync::OnceLock<Arc<Cache<serde_json::Value>>> = std::sync::OnceLock::new();
-static BACKGROUND_TASKS: std::sync::OnceLock<Arc<BackgroundTaskManager>> = std::sync::OnceLock::new();
+static TIP_CACHE: std::sync::OnceLock<Arc<TipCache<serde_json::Value>>> = std::sync::OnceLock::new();
+static BACKGROUND_TASKS: std::sync::OnceLock<Arc<TaskScheduler>> = std::sync::OnceLock::new();
 static SETTINGS_MANAGER: std::sync::OnceLock<Arc<SettingsManager>> = std::sync::OnceLock::new();
 static BACKUP_MANAGER: std::sync::OnceLock<Arc<BackupManager>> = std::sync::OnceLock::new();
 static I18N_MANAGER: std::sync::OnceLock<Arc<I18nManager>> = std::sync::OnceLock::new();
 static RESOURCE_MONITOR: std::sync::OnceLock<Arc<ResourceMonitor>> = std::sync::OnceLock::new();
 static OPTIMIZATION_CACHE: std::sync::OnceLock<Arc<AdvancedCache<String, String>>> = std::sync::OnceLock::new();
 static THREAD_POOL: std::sync::OnceLock<Arc<ThreadPool>> = std::sync::OnceLock::new();
+static FFI_EXECUTOR: std::sync::OnceLock<Arc<BlockingExecutor>> = std::sync::OnceLock::new();
 static PERFORMANCE_PROFILER: std::sync::OnceLock<Arc<PerformanceProfiler>> = std::sync::OnceLock::new();
 static ADVANCED_WALLET_MANAGER: std::sync::OnceLock<Arc<AdvancedWalletManager>> = std::sync::OnceLock::new();
 static ADVANCED_UI_MANAGER: std::sync::OnceLock<Arc<AdvancedUIManager>> = std::sync::OnceLock::new();
@@ -90,6 +95,7 @@ pub fn run() {
             deposit_create,
             deposit_withdraw,
             estimate_fee,
+            restore_height_for_date,
             validate_address,
             // Security commands
             authenticate_user,
@@ -104,6 +110,8 @@ pub fn run() {
             get_performance_metrics,
             get_cache_stats,
             clear_cache,
+            set_tracing_enabled,
+            export_trace,
             get_background_task_status,
             enable_background_task,
             disable_background_task,
@@ -144,7 +152,32 @@ pub fn run() {
             export_keys,
             import_keys,
         ])
-        .setup(|_app| {
+        .setup(|app| {
+            register_background_tasks(app.handle().clone());
+
+            // Push native wallet events to the frontend instead of having it poll
+            let handle = app.handle().clone();
+            set_event_sink(move |event| {
+                // Read-only responses stay valid until the wallet's tip moves
+                let tip_cache = TIP_CACHE.get().unwrap();
+                if event.kind == "transaction" {
+                    tip_cache.invalidate();
+                } else {
+                    tip_cache.advance_tip(event.sync_height, event.network_height);
+                }
+
+                // Background tasks follow the wallet instead of polling it
+                let scheduler = BACKGROUND_TASKS.get().unwrap();
+                match event.kind {
+                    "sync_progress" => scheduler.set_syncing(true),
+                    "sync_completed" => scheduler.set_syncing(false),
+                    "new_block" => scheduler.trigger("network_status"),
+                    _ => {}
+                }
+                if let Err(e) = handle.emit(WALLET_EVENT_NAME, event) {
+                    log::warn!("Failed to emit wallet event: {}", e);
+                }
+            });
             info!("Fuego Desktop Wallet initialized successfully");
             Ok(())
         })
@@ -152,6 +185,32 @@ pub fn run() {
         .expect("error while running tauri application");
 }
 
+/// Run a blocking wallet command body on the FFI thread pool, traced as the
+/// root span of the native work it does
+async fn offload<R: Send + 'static>(
+    command: &'static str,
+    job: impl FnOnce() -> Result<R, String> + Send + 'static,
+) -> Result<R, String> {
+    FFI_EXECUTOR.get().unwrap().run(command, move || {
+        let _trace = CommandTrace::begin(command);
+        job()
+    }).await
+}
+
+/// Serve a read-only response from the tip cache, loading it on the FFI
+/// thread pool on a miss
+async fn offload_cached(
+    command: &'static str,
+    key: String,
+    load: impl FnOnce() -> Result<serde_json::Value, String> + Send + 'static,
+) -> Result<serde_json::Value, String> {
+    let cache = TIP_CACHE.get().unwrap();
+    if let Some(value) = cache.get(&key) {
+        return Ok(value);
+    }
+    offload(command, move || TIP_CACHE.get().unwrap().get_or_try_insert_with(&key, load)).await
+}
+
 /// Initialize global state for security, performance, settings, backup, and i18n
 fn initialize_global_state() {
     // Initialize security manager
@@ -165,11 +224,12 @@ fn initialize_global_state() {
     PERFORMANCE_MONITOR.set(performance_monitor).unwrap();
 
     // Initialize cache
-    let cache = Arc::new(Cache::new(1000, Duration::from_secs(300)));
+    let cache = Arc::new(Cache::with_max_bytes(16 << 20, Duration::from_secs(300), json_weight));
     CACHE.set(cache).unwrap();
+    TIP_CACHE.set(Arc::new(TipCache::new(1000))).unwrap();
 
-    // Initialize background task manager
-    let background_tasks = Arc::new(BackgroundTaskManager::new());
+    // Initialize background task scheduler; tasks are registered once the app handle exists
+    let background_tasks = Arc::new(TaskScheduler::new());
     BACKGROUND_TASKS.set(background_tasks).unwrap();
 
     // Initialize settings manager
@@ -217,15 +277,32 @@ fn initialize_global_state() {
         priority_level: crate::optimization::ThreadPriority::Normal,
     };
     
+    // Blocking wallet calls run on the pool, never on async runtime workers.
+    // Sends, rescans and mining control each touch the whole wallet, so only
+    // one of each runs at a time.
+    let thread_pool = Arc::new(ThreadPool::new(cpu_opt.thread_pool_size));
+    let ffi_executor = BlockingExecutor::new(thread_pool.clone(), cpu_opt.max_threads)
+        .with_limit("send_transaction", 1)
+        .with_limit("wallet_rescan", 1)
+        .with_limit("wallet_refresh", 1)
+        .with_limit("create_term_deposit", 1)
+        .with_limit("withdraw_term_deposit", 1)
+        .with_limit("start_mining", 1)
+        .with_limit("stop_mining", 1);
+    FFI_EXECUTOR.set(Arc::new(ffi_executor)).unwrap();
+    THREAD_POOL.set(thread_pool).unwrap();
+
+    // Mining and rescans are sized to the cores other programs leave idle
     let resource_monitor = Arc::new(ResourceMonitor::new(memory_opt, cpu_opt));
+    resource_monitor.set_limits_listener(|limits| {
+        apply_resource_limits(limits.mining_threads, limits.rescan_workers);
+    });
+    resource_monitor.start_monitoring();
     RESOURCE_MONITOR.set(resource_monitor).unwrap();
     
     let optimization_cache = Arc::new(AdvancedCache::new(1000));
     OPTIMIZATION_CACHE.set(optimization_cache).unwrap();
     
-    let thread_pool = Arc::new(ThreadPool::new(8));
-    THREAD_POOL.set(thread_pool).unwrap();
-    
     let performance_profiler = Arc::new(PerformanceProfiler::new());
     PERFORMANCE_PROFILER.set(performance_profiler).unwrap();
 
@@ -239,146 +316,219 @@ fn initialize_global_state() {
     info!("Global state initialized successfully");
 }
 
+/// Name of the frontend event carrying the network status refreshed in the background
+const NETWORK_STATUS_EVENT_NAME: &str = "network-status";
+
+/// Schedule wallet refresh, network status, cache cleanup and automatic backups.
+///
+/// Wallet events trigger or hold back these tasks (see the event sink), the intervals are only a
+/// fallback for when the node goes quiet. Tasks touching the wallet wait out a running sync.
+fn register_background_tasks(handle: tauri::AppHandle) {
+    let scheduler = BACKGROUND_TASKS.get().unwrap().clone();
+    let performance_config = PerformanceConfig::default();
+    let settings = SETTINGS_MANAGER.get().and_then(|mgr| mgr.get_settings().ok());
+    let sync_interval = Duration::from_secs(performance_config.background_sync_interval_seconds);
+
+    scheduler.register_task("wallet_refresh", sync_interval, true, || {
+        if let Some(mut wallet) = open_session() {
+            if let Err(e) = wallet.refresh() {
+                log::warn!("Background wallet refresh failed: {}", e);
+            }
+        }
+    });
+
+    scheduler.register_task("network_status", sync_interval, true, move || {
+        let Some(wallet) = open_session() else {
+            return;
+        };
+        match wallet.get_network_status() {
+            Ok(status) => {
+                if let Err(e) = handle.emit(NETWORK_STATUS_EVENT_NAME, status) {
+                    log::warn!("Failed to emit network status: {}", e);
+                }
+            }
+            Err(e) => log::warn!("Background network status failed: {}", e),
+        }
+    });
+
+    scheduler.register_task("cache_cleanup", Duration::from_secs(performance_config.cache_ttl_seconds), false, || {
+        CACHE.get().unwrap().purge_expired();
+        PERFORMANCE_MONITOR.get().unwrap().cleanup_old_metrics();
+    });
+
+    if let Some(wallet_settings) = settings.map(|s| s.wallet).filter(|w| w.auto_backup) {
+        let interval = Duration::from_secs(u64::from(wallet_settings.backup_interval_hours.max(1)) * 3600);
+        scheduler.register_task("backup", interval, true, || {
+            if let Err(e) = create_automatic_backup() {
+                log::warn!("Automatic backup failed: {}", e);
+            }
+        });
+    }
+
+    tauri::async_runtime::spawn(async move { scheduler.start() });
+}
+
+/// Back up the open wallet's info and the settings
+fn create_automatic_backup() -> Result<(), String> {
+    let backup_manager = BACKUP_MANAGER.get().ok_or("Backup manager not initialized")?;
+    let wallet_info = match open_session() {
+        Some(wallet) => serde_json::json!({
+            "address": wallet.get_address().map_err(|e| e.to_string())?,
+            "balance": wallet.get_balance().map_err(|e| e.to_string())?,
+            "unlocked_balance": wallet.get_unlocked_balance().map_err(|e| e.to_string())?,
+        }),
+        None => return Ok(()),
+    };
+    let settings = SETTINGS_MANAGER.get()
+        .and_then(|mgr| mgr.get_settings().ok())
+        .and_then(|settings| serde_json::to_value(settings).ok());
+    let created_at = std::time::SystemTime::now()
+        .duration_since(std::time::UNIX_EPOCH)
+        .map_err(|e| format!("Failed to get timestamp: {}", e))?
+        .as_secs();
+
+    let data = BackupData {
+        wallet_info: Some(wallet_info),
+        transactions: None,
+        settings,
+        network_status: None,
+        metadata: BackupMetadata {
+            version: "1.0.0".to_string(),
+            created_at,
+            backup_type: BackupType::Full,
+            fuego_version: "1.0.0".to_string(),
+            platform: std::env::consts::OS.to_string(),
+        },
+    };
+    backup_manager.create_backup(
+        "Automatic backup".to_string(),
+        "Scheduled by the wallet".to_string(),
+        BackupType::Full,
+        data,
+    )?;
+    Ok(())
+}
+
 /// Get wallet information (using real CryptoNote)
 #[tauri::command]
 async fn get_wallet_info() -> Result<serde_json::Value, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-    
-    // Try to open existing wallet first, then create if needed
-    let wallet_result = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    
-    if let Err(e) = wallet_result {
-        return Err(format!("Failed to open/create wallet: {}", e));
-    }
-    
-    // Connect to Fuego network
-    if let Err(e) = connect_to_fuego_network(&mut real_wallet) {
-        log::warn!("Failed to connect to Fuego network: {}", e);
-        // Continue without network connection
-    }
-    
-    let balance = real_wallet.get_balance().map_err(|e| e.to_string())?;
-    let unlocked_balance = real_wallet.get_unlocked_balance().map_err(|e| e.to_string())?;
-    let address = real_wallet.get_address().map_err(|e| e.to_string())?;
-    
-    Ok(serde_json::json!({
-        "address": address,
-        "balance": balance,
-        "unlocked_balance": unlocked_balance,
-        "is_open": real_wallet.is_open(),
-        "is_encrypted": true,
-        "is_real": true
-    }))
+    offload("get_wallet_info", move || {
+        let real_wallet = wallet_session()?;
+
+        let balance = real_wallet.get_balance().map_err(|e| e.to_string())?;
+        let unlocked_balance = real_wallet.get_unlocked_balance().map_err(|e| e.to_string())?;
+        let address = real_wallet.get_address().map_err(|e| e.to_string())?;
+
+        Ok(serde_json::json!({
+            "address": address,
+            "balance": balance,
+            "unlocked_balance": unlocked_balance,
+            "is_open": real_wallet.is_open(),
+            "is_encrypted": true,
+            "is_real": true
+        }))
+    }).await
 }
 
 /// Get transactions (real implementation)
 #[tauri::command]
 async fn get_transactions(limit: Option<u64>, offset: Option<u64>) -> Result<Vec<serde_json::Value>, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    // Try to open wallet and get real transactions
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    // Get real transaction history from blockchain
-    match real_wallet.get_transaction_history(limit.unwrap_or(10), offset.unwrap_or(0)) {
-        Ok(transactions) => {
-            let mapped: Vec<serde_json::Value> = transactions
-                .into_iter()
-                .map(|tx| serde_json::json!({
-                    "id": tx.id,
-                    "hash": tx.hash,
-                    "amount": tx.amount,
-                    "fee": tx.fee,
-                    "height": tx.height,
-                    "timestamp": tx.timestamp,
-                    "confirmations": tx.confirmations,
-                    "is_confirmed": tx.is_confirmed,
-                    "is_pending": tx.is_pending,
-                    "payment_id": tx.payment_id,
-                    "destination_addresses": tx.destination_addresses,
-                    "source_addresses": tx.source_addresses,
-                    "unlock_time": tx.unlock_time,
-                    "extra": tx.extra
-                }))
-                .collect();
-            Ok(mapped)
-        }
-        Err(e) => {
-            log::error!("Failed to get transaction history: {}", e);
-            Err(format!("Failed to get transaction history: {}", e))
+    offload("get_transactions", move || {
+        let real_wallet = wallet_session()?;
+
+        // Get real transaction history from blockchain
+        match real_wallet.get_transaction_history(limit.unwrap_or(10), offset.unwrap_or(0)) {
+            Ok(transactions) => {
+                let mapped: Vec<serde_json::Value> = transactions
+                    .into_iter()
+                    .map(|tx| serde_json::json!({
+                        "id": tx.id,
+                        "hash": tx.hash,
+                        "amount": tx.amount,
+                        "fee": tx.fee,
+                        "height": tx.height,
+                        "timestamp": tx.timestamp,
+                        "confirmations": tx.confirmations,
+                        "is_confirmed": tx.is_confirmed,
+                        "is_pending": tx.is_pending,
+                        "payment_id": tx.payment_id,
+                        "destination_addresses": tx.destination_addresses,
+                        "source_addresses": tx.source_addresses,
+                        "unlock_time": tx.unlock_time,
+                        "extra": tx.extra
+                    }))
+                    .collect();
+                Ok(mapped)
+            }
+            Err(e) => {
+                log::error!("Failed to get transaction history: {}", e);
+                Err(format!("Failed to get transaction history: {}", e))
+            }
         }
-    }
+    }).await
 }
 
 /// Get enhanced wallet information for advanced UI (Phase 1.3)
 #[tauri::command]
 async fn get_enhanced_wallet_info() -> Result<serde_json::Value, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    // Open or create wallet
-    let _ = real_wallet
-        .open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    // Attempt network connect (best-effort)
-    let _ = connect_to_fuego_network(&mut real_wallet);
-
-    // Gather info
-    let balance = real_wallet.get_balance().map_err(|e| e.to_string())?;
-    let unlocked_balance = real_wallet.get_unlocked_balance().map_err(|e| e.to_string())?;
-    let address = real_wallet.get_address().map_err(|e| e.to_string())?;
-    let network = real_wallet.get_network_status().unwrap_or_else(|_| serde_json::json!({
-        "is_connected": false,
-        "peer_count": 0,
-        "sync_height": 0,
-        "network_height": 0,
-        "is_syncing": false,
-        "connection_type": "Disconnected"
-    }));
-
-    // Update advanced manager snapshot
-    if let Some(manager) = ADVANCED_WALLET_MANAGER.get().cloned() {
-        manager.update_wallet_info(EnhancedWalletInfo {
-            address: address.clone(),
-            balance,
-            unlocked_balance,
-            locked_balance: balance.saturating_sub(unlocked_balance),
-            total_received: balance,
-            total_sent: 0,
-            transaction_count: 0,
-            is_synced: network.get("is_syncing").and_then(|v| v.as_bool()).map(|s| !s).unwrap_or(false),
-            sync_height: network.get("sync_height").and_then(|v| v.as_u64()).unwrap_or(0),
-            network_height: network.get("network_height").and_then(|v| v.as_u64()).unwrap_or(0),
-            daemon_height: network.get("network_height").and_then(|v| v.as_u64()).unwrap_or(0),
-            is_connected: network.get("is_connected").and_then(|v| v.as_bool()).unwrap_or(false),
-            peer_count: network.get("peer_count").and_then(|v| v.as_u64()).unwrap_or(0) as u32,
-            last_block_time: None,
-            wallet_version: env!("CARGO_PKG_VERSION").to_string(),
-            seed_phrase: None,
-            view_key: None,
-            spend_key: None,
-            restore_height: 0,
-            auto_refresh: true,
-            refresh_from_block_height: 0,
-            subaddress_count: 0,
-            subaddress_lookahead: 0,
-            wallet_creation_time: None,
-            last_backup_time: None,
-            last_sync_time: Some(SystemTime::now().duration_since(UNIX_EPOCH).unwrap_or(Duration::from_secs(0)).as_secs()),
-            sync_speed: 0.0,
-            estimated_sync_time: None,
-        });
-    }
+    offload("get_enhanced_wallet_info", move || {
+        let real_wallet = wallet_session()?;
+
+        // Gather info
+        let balance = real_wallet.get_balance().map_err(|e| e.to_string())?;
+        let unlocked_balance = real_wallet.get_unlocked_balance().map_err(|e| e.to_string())?;
+        let address = real_wallet.get_address().map_err(|e| e.to_string())?;
+        let network = real_wallet.get_network_status().unwrap_or_else(|_| serde_json::json!({
+            "is_connected": false,
+            "peer_count": 0,
+            "sync_height": 0,
+            "network_height": 0,
+            "is_syncing": false,
+            "connection_type": "Disconnected"
+        }));
+
+        // Update advanced manager snapshot
+        if let Some(manager) = ADVANCED_WALLET_MANAGER.get().cloned() {
+            manager.update_wallet_info(EnhancedWalletInfo {
+                address: address.clone(),
+                balance,
+                unlocked_balance,
+                locked_balance: balance.saturating_sub(unlocked_balance),
+                total_received: balance,
+                total_sent: 0,
+                transaction_count: 0,
+                is_synced: network.get("is_syncing").and_then(|v| v.as_bool()).map(|s| !s).unwrap_or(false),
+                sync_height: network.get("sync_height").and_then(|v| v.as_u64()).unwrap_or(0),
+                network_height: network.get("network_height").and_then(|v| v.as_u64()).unwrap_or(0),
+                daemon_height: network.get("network_height").and_then(|v| v.as_u64()).unwrap_or(0),
+                is_connected: network.get("is_connected").and_then(|v| v.as_bool()).unwrap_or(false),
+                peer_count: network.get("peer_count").and_then(|v| v.as_u64()).unwrap_or(0) as u32,
+                last_block_time: None,
+                wallet_version: env!("CARGO_PKG_VERSION").to_string(),
+                seed_phrase: None,
+                view_key: None,
+                spend_key: None,
+                restore_height: 0,
+                auto_refresh: true,
+                refresh_from_block_height: 0,
+                subaddress_count: 0,
+                subaddress_lookahead: 0,
+                wallet_creation_time: None,
+                last_backup_time: None,
+                last_sync_time: Some(SystemTime::now().duration_since(UNIX_EPOCH).unwrap_or(Duration::from_secs(0)).as_secs()),
+                sync_speed: 0.0,
+                estimated_sync_time: None,
+            });
+        }
 
-    Ok(serde_json::json!({
-        "address": address,
-        "balance": balance,
-        "unlocked_balance": unlocked_balance,
-        "is_connected": network.get("is_connected").and_then(|v| v.as_bool()).unwrap_or(false),
-        "network": network,
-    }))
+        Ok(serde_json::json!({
+            "address": address,
+            "balance": balance,
+            "unlocked_balance": unlocked_balance,
+            "is_connected": network.get("is_connected").and_then(|v| v.as_bool()).unwrap_or(false),
+            "network": network,
+        }))
+    }).await
 }
 
 /// Get advanced transactions snapshot (placeholder)
@@ -436,46 +586,81 @@ async fn get_notifications() -> Result<Vec<serde_json::Value>, String> {
 /// Get network status (using real CryptoNote)
 #[tauri::command]
 async fn get_network_status() -> Result<serde_json::Value, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-    
-    let _ = real_wallet
-        .open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    
-    // Only connect if not already connected
-    if let Err(e) = connect_to_fuego_network(&mut real_wallet) {
-        log::warn!("Network connect attempt failed: {}", e);
-    }
-    
-    real_wallet.get_network_status().map_err(|e| e.to_string())
+    offload("get_network_status", move || {
+        let real_wallet = wallet_session()?;
+
+        real_wallet.get_network_status().map_err(|e| e.to_string())
+    }).await
 }
 
 // ===== fuego-wallet compatibility aliases =====
 
 #[tauri::command]
-async fn wallet_create(password: String, file_path: String, seed_phrase: Option<String>, restore_height: Option<u64>) -> Result<String, String> {
-    let mut wallet = RealCryptoNoteWallet::new();
-    wallet.create_wallet(&password, &file_path, seed_phrase.as_deref(), restore_height.unwrap_or(0))
-        .map_err(|e| e.to_string())?;
-    let address = wallet.get_address().map_err(|e| e.to_string())?;
-    Ok(address)
+async fn wallet_create(
+    password: String,
+    file_path: String,
+    seed_phrase: Option<String>,
+    restore_height: Option<u64>,
+    creation_time: Option<u64>,
+) -> Result<String, String> {
+    offload("wallet_create", move || {
+        close_session();
+        TIP_CACHE.get().unwrap().invalidate();
+        let mut wallet = RealCryptoNoteWallet::new();
+        wallet.create_wallet(&password, &file_path, seed_phrase.as_deref(), restore_height.unwrap_or(0))
+            .map_err(|e| e.to_string())?;
+        let address = wallet.get_address().map_err(|e| e.to_string())?;
+        let connected = connect_to_fuego_network(&mut wallet).is_ok();
+
+        // A restore dated by creation time scans from the first block the node
+        // places at or after it instead of from genesis
+        if let (true, Some(_), None, Some(created)) = (connected, &seed_phrase, restore_height, creation_time) {
+            match wallet.restore_height_for_timestamp(created) {
+                Ok(height) if height > 0 => {
+                    if let Err(e) = wallet.rescan_blockchain(height) {
+                        log::warn!("Failed to start restore from height {}: {}", height, e);
+                    }
+                }
+                Ok(_) => {}
+                Err(e) => log::warn!("Failed to look up restore height: {}", e),
+            }
+        }
+
+        replace_session(wallet);
+        Ok(address)
+    }).await
+}
+
+#[tauri::command]
+async fn restore_height_for_date(timestamp: u64) -> Result<u64, String> {
+    offload("restore_height_for_date", move || {
+        let real_wallet = wallet_session()?;
+        real_wallet.restore_height_for_timestamp(timestamp).map_err(|e| e.to_string())
+    }).await
 }
 
 #[tauri::command]
 async fn wallet_open(file_path: String, password: String) -> Result<String, String> {
-    let mut wallet = RealCryptoNoteWallet::new();
-    wallet.open_wallet(&file_path, &password).map_err(|e| e.to_string())?;
-    let address = wallet.get_address().map_err(|e| e.to_string())?;
-    Ok(address)
+    offload("wallet_open", move || {
+        close_session();
+        TIP_CACHE.get().unwrap().invalidate();
+        let mut wallet = RealCryptoNoteWallet::new();
+        wallet.open_wallet(&file_path, &password).map_err(|e| e.to_string())?;
+        let address = wallet.get_address().map_err(|e| e.to_string())?;
+        let _ = connect_to_fuego_network(&mut wallet);
+        replace_session(wallet);
+        Ok(address)
+    }).await
 }
 
 #[tauri::command]
 async fn wallet_close() -> Result<(), String> {
-    let mut wallet = RealCryptoNoteWallet::new();
-    // Best-effort: open then close. In a real implementation, use a shared instance.
-    let _ = wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password");
-    wallet.close_wallet();
-    Ok(())
+    // Closing saves the wallet file
+    offload("wallet_close", move || {
+        close_session();
+        TIP_CACHE.get().unwrap().invalidate();
+        Ok(())
+    }).await
 }
 
 #[tauri::command]
@@ -483,18 +668,18 @@ async fn wallet_get_info() -> Result<serde_json::Value, String> { get_wallet_inf
 
 #[tauri::command]
 async fn wallet_get_balance() -> Result<u64, String> {
-    let mut wallet = RealCryptoNoteWallet::new();
-    let _ = wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    wallet.get_balance().map_err(|e| e.to_string())
+    offload("wallet_get_balance", move || {
+        let wallet = wallet_session()?;
+        wallet.get_balance().map_err(|e| e.to_string())
+    }).await
 }
 
 #[tauri::command]
 async fn wallet_get_address() -> Result<String, String> {
-    let mut wallet = RealCryptoNoteWallet::new();
-    let _ = wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    wallet.get_address().map_err(|e| e.to_string())
+    offload("wallet_get_address", move || {
+        let wallet = wallet_session()?;
+        wallet.get_address().map_err(|e| e.to_string())
+    }).await
 }
 
 #[tauri::command]
@@ -509,18 +694,18 @@ async fn wallet_send_transaction(recipient: String, amount: u64, payment_id: Opt
 
 #[tauri::command]
 async fn wallet_refresh() -> Result<(), String> {
-    let mut wallet = RealCryptoNoteWallet::new();
-    let _ = wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    wallet.refresh().map_err(|e| e.to_string())
+    offload("wallet_refresh", move || {
+        let mut wallet = wallet_session()?;
+        wallet.refresh().map_err(|e| e.to_string())
+    }).await
 }
 
 #[tauri::command]
 async fn wallet_rescan(start_height: Option<u64>) -> Result<(), String> {
-    let mut wallet = RealCryptoNoteWallet::new();
-    let _ = wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    wallet.rescan_blockchain(start_height.unwrap_or(0)).map_err(|e| e.to_string())
+    offload("wallet_rescan", move || {
+        let mut wallet = wallet_session()?;
+        wallet.rescan_blockchain(start_height.unwrap_or(0)).map_err(|e| e.to_string())
+    }).await
 }
 
 #[tauri::command]
@@ -528,22 +713,22 @@ async fn network_get_status() -> Result<serde_json::Value, String> { get_network
 
 #[tauri::command]
 async fn node_connect(address: Option<String>, port: Option<u16>) -> Result<(), String> {
-    let mut wallet = RealCryptoNoteWallet::new();
-    let _ = wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    if let Some(addr) = address {
-        wallet.connect_to_node(&addr, port.unwrap_or(18180)).map_err(|e| e.to_string())
-    } else {
-        connect_to_fuego_network(&mut wallet).map_err(|e| e.to_string())
-    }
+    offload("node_connect", move || {
+        let mut wallet = wallet_session()?;
+        if let Some(addr) = address {
+            wallet.connect_to_node(&addr, port.unwrap_or(18180)).map_err(|e| e.to_string())
+        } else {
+            connect_to_fuego_network(&mut wallet).map_err(|e| e.to_string())
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn node_disconnect() -> Result<(), String> {
-    let mut wallet = RealCryptoNoteWallet::new();
-    let _ = wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    wallet.disconnect().map_err(|e| e.to_string())
+    offload("node_disconnect", move || {
+        let mut wallet = wallet_session()?;
+        wallet.disconnect().map_err(|e| e.to_string())
+    }).await
 }
 
 #[tauri::command]
@@ -556,117 +741,123 @@ async fn deposit_create(amount: u64, term: u32) -> Result<String, String> { crea
 async fn deposit_withdraw(deposit_id: String) -> Result<String, String> { withdraw_term_deposit(deposit_id).await }
 
 #[tauri::command]
-async fn estimate_fee(address: String, amount: u64, mixin: Option<u64>) -> Result<u64, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    real_wallet.estimate_transaction_fee(&address, amount, mixin.unwrap_or(5)).map_err(|e| e.to_string())
+async fn estimate_fee(address: String, amount: u64, mixin: Option<u64>) -> Result<FeeEstimate, String> {
+    let mixin = mixin.unwrap_or(5);
+    // The native estimator is already cached against the wallet's outputs
+    offload("estimate_fee", move || {
+        let real_wallet = wallet_session()?;
+        real_wallet.estimate_transaction(&address, amount, mixin).map_err(|e| e.to_string())
+    }).await
 }
 
 #[tauri::command]
 async fn validate_address(address: String) -> Result<bool, String> {
-    // Real validation: attempt lightweight checks and delegate to CryptoNote wallet if available
-    // 1) Prefix and length sanity
-    if !address.starts_with("fire") || address.len() < 60 || address.len() > 120 {
-        return Ok(false);
-    }
-    // 2) Base58 decode check (rejects invalid charset/length)
-    if bs58::decode(&address).into_vec().is_err() {
-        return Ok(false);
-    }
-    // 3) Ask wallet to accept address in fee estimator (no-op but validates formatting at native layer)
-    let mut wallet = RealCryptoNoteWallet::new();
-    let _ = wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    let mixin = 5u64;
-    match wallet.estimate_transaction_fee(&address, 1, mixin) {
-        Ok(_) => Ok(true),
-        Err(_) => Ok(false),
-    }
+    offload("validate_address", move || {
+        // Real validation: attempt lightweight checks and delegate to CryptoNote wallet if available
+        // 1) Prefix and length sanity
+        if !address.starts_with("fire") || address.len() < 60 || address.len() > 120 {
+            return Ok(false);
+        }
+        // 2) Base58 decode check (rejects invalid charset/length)
+        if bs58::decode(&address).into_vec().is_err() {
+            return Ok(false);
+        }
+        // 3) Ask wallet to accept address in fee estimator (no-op but validates formatting at native layer)
+        let wallet = wallet_session()?;
+        let mixin = 5u64;
+        match wallet.estimate_transaction_fee(&address, 1, mixin) {
+            Ok(_) => Ok(true),
+            Err(_) => Ok(false),
+        }
+    }).await
 }
 
 /// Test FFI integration
 #[tauri::command]
 async fn test_ffi_integration() -> Result<serde_json::Value, String> {
-    let mut ffi = CryptoNoteFFI::new();
-    
-    // Test wallet creation
-    let create_result = ffi.create_wallet("test_password", "/tmp/test.wallet", None, 0);
-    if create_result.is_err() {
-        return Err(format!("FFI wallet creation failed: {:?}", create_result.err()));
-    }
-    
-    // Test wallet operations
-    let balance = ffi.get_balance().map_err(|e| e.to_string())?;
-    let unlocked_balance = ffi.get_unlocked_balance().map_err(|e| e.to_string())?;
-    let address = ffi.get_address().map_err(|e| e.to_string())?;
-    let is_open = ffi.is_open();
-    
-    // Test transaction sending
-    let tx_result = ffi.send_transaction("FUEGO9876543210fedcba", 100000000, None, 5);
-    if tx_result.is_err() {
-        return Err(format!("FFI transaction failed: {:?}", tx_result.err()));
-    }
-    
-    Ok(serde_json::json!({
-        "status": "success",
-        "message": "FFI integration working correctly",
-        "wallet": {
-            "is_open": is_open,
-            "balance": balance,
-            "unlocked_balance": unlocked_balance,
-            "address": address
-        },
-        "transaction": {
-            "hash": tx_result.unwrap()
+    offload("test_ffi_integration", move || {
+        let mut ffi = CryptoNoteFFI::new();
+
+        // Test wallet creation
+        let create_result = ffi.create_wallet("test_password", "/tmp/test.wallet", None, 0);
+        if create_result.is_err() {
+            return Err(format!("FFI wallet creation failed: {:?}", create_result.err()));
         }
-    }))
+
+        // Test wallet operations
+        let balance = ffi.get_balance().map_err(|e| e.to_string())?;
+        let unlocked_balance = ffi.get_unlocked_balance().map_err(|e| e.to_string())?;
+        let address = ffi.get_address().map_err(|e| e.to_string())?;
+        let is_open = ffi.is_open();
+
+        // Test transaction sending
+        let tx_result = ffi.send_transaction("FUEGO9876543210fedcba", 100000000, None, 5);
+        if tx_result.is_err() {
+            return Err(format!("FFI transaction failed: {:?}", tx_result.err()));
+        }
+
+        Ok(serde_json::json!({
+            "status": "success",
+            "message": "FFI integration working correctly",
+            "wallet": {
+                "is_open": is_open,
+                "balance": balance,
+                "unlocked_balance": unlocked_balance,
+                "address": address
+            },
+            "transaction": {
+                "hash": tx_result.unwrap()
+            }
+        }))
+    }).await
 }
 
 /// Test real CryptoNote integration
 #[tauri::command]
 async fn test_real_cryptonote() -> Result<serde_json::Value, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-    
-    // Test wallet creation
-    let create_result = real_wallet.create_wallet("test_password", "/tmp/test_real.wallet", None, 0);
-    if create_result.is_err() {
-        return Err(format!("Real CryptoNote wallet creation failed: {:?}", create_result.err()));
-    }
-    
-    // Test wallet operations
-    let balance = real_wallet.get_balance().map_err(|e| e.to_string())?;
-    let unlocked_balance = real_wallet.get_unlocked_balance().map_err(|e| e.to_string())?;
-    let address = real_wallet.get_address().map_err(|e| e.to_string())?;
-    let is_open = real_wallet.is_open();
-    
-    // Test network connection
-    let network_result = connect_to_fuego_network(&mut real_wallet);
-    let network_status = real_wallet.get_network_status().map_err(|e| e.to_string())?;
-    
-    // Test transaction sending
-    let tx_result = real_wallet.send_transaction("fire1234567890abcdef", 100000000, None, 5);
-    if tx_result.is_err() {
-        return Err(format!("Real CryptoNote transaction failed: {:?}", tx_result.err()));
-    }
-    
-    Ok(serde_json::json!({
-        "status": "success",
-        "message": "Real CryptoNote integration working correctly",
-        "wallet": {
-            "is_open": is_open,
-            "balance": balance,
-            "unlocked_balance": unlocked_balance,
-            "address": address
-        },
-        "network": {
-            "connection_result": if network_result.is_ok() { "success" } else { "failed" },
-            "status": network_status
-        },
-        "transaction": {
-            "hash": tx_result.unwrap()
+    offload("test_real_cryptonote", move || {
+        let mut real_wallet = RealCryptoNoteWallet::new();
+
+        // Test wallet creation
+        let create_result = real_wallet.create_wallet("test_password", "/tmp/test_real.wallet", None, 0);
+        if create_result.is_err() {
+            return Err(format!("Real CryptoNote wallet creation failed: {:?}", create_result.err()));
         }
-    }))
+
+        // Test wallet operations
+        let balance = real_wallet.get_balance().map_err(|e| e.to_string())?;
+        let unlocked_balance = real_wallet.get_unlocked_balance().map_err(|e| e.to_string())?;
+        let address = real_wallet.get_address().map_err(|e| e.to_string())?;
+        let is_open = real_wallet.is_open();
+
+        // Test network connection
+        let network_result = connect_to_fuego_network(&mut real_wallet);
+        let network_status = real_wallet.get_network_status().map_err(|e| e.to_string())?;
+
+        // Test transaction sending
+        let tx_result = real_wallet.send_transaction("fire1234567890abcdef", 100000000, None, 5);
+        if tx_result.is_err() {
+            return Err(format!("Real CryptoNote transaction failed: {:?}", tx_result.err()));
+        }
+
+        Ok(serde_json::json!({
+            "status": "success",
+            "message": "Real CryptoNote integration working correctly",
+            "wallet": {
+                "is_open": is_open,
+                "balance": balance,
+                "unlocked_balance": unlocked_balance,
+                "address": address
+            },
+            "network": {
+                "connection_result": if network_result.is_ok() { "success" } else { "failed" },
+                "status": network_status
+            },
+            "transaction": {
+                "hash": tx_result.unwrap()
+            }
+        }))
+    }).await
 }
 
 /// Get real Fuego network data from fuego.spaceportx.net
@@ -693,152 +884,113 @@ async fn send_transaction(
     payment_id: Option<String>,
     mixin: u64,
 ) -> Result<String, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-    
-    // Try to open existing wallet first
-    let wallet_result = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    
-    if let Err(e) = wallet_result {
-        return Err(format!("Failed to open/create wallet: {}", e));
-    }
-    
-    // Connect to Fuego network
-    if let Err(e) = connect_to_fuego_network(&mut real_wallet) {
-        log::warn!("Failed to connect to Fuego network: {}", e);
-        // Continue without network connection
-    }
-    
-    // Send transaction
-    match real_wallet.send_transaction(&recipient, amount, payment_id.as_deref(), mixin) {
-        Ok(tx_hash) => {
-            log::info!("Transaction sent successfully: {}", tx_hash);
-            Ok(tx_hash)
-        }
-        Err(e) => {
-            log::error!("Failed to send transaction: {}", e);
-            Err(format!("Failed to send transaction: {}", e))
+    offload("send_transaction", move || {
+        let real_wallet = wallet_session()?;
+
+        // Send transaction
+        match real_wallet.send_transaction(&recipient, amount, payment_id.as_deref(), mixin) {
+            Ok(tx_hash) => {
+                log::info!("Transaction sent successfully: {}", tx_hash);
+                Ok(tx_hash)
+            }
+            Err(e) => {
+                log::error!("Failed to send transaction: {}", e);
+                Err(format!("Failed to send transaction: {}", e))
+            }
         }
-    }
+    }).await
 }
 
 /// Get term deposits (staking/investment positions)
 #[tauri::command]
 async fn get_term_deposits() -> Result<Vec<serde_json::Value>, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-    
-    // Try to open existing wallet first
-    let wallet_result = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    
-    if let Err(e) = wallet_result {
-        return Err(format!("Failed to open/create wallet: {}", e));
-    }
-    
-    // Connect to Fuego network
-    let _ = connect_to_fuego_network(&mut real_wallet);
-    
-    // Get real deposits from CryptoNote wallet
-    match real_wallet.get_deposits() {
-        Ok(deposits) => {
-            let mut deposit_list = Vec::new();
-            
-            for deposit in deposits {
-                let deposit_json = serde_json::json!({
-                    "id": deposit.id,
-                    "amount": deposit.amount,
-                    "interest": deposit.interest,
-                    "term": deposit.term,
-                    "rate": deposit.rate,
-                    "status": deposit.status,
-                    "unlock_height": deposit.unlock_height,
-                    "unlock_time": deposit.unlock_time,
-                    "creating_transaction_hash": deposit.creating_transaction_hash,
-                    "creating_height": deposit.creating_height,
-                    "creating_time": deposit.creating_time,
-                    "spending_transaction_hash": deposit.spending_transaction_hash,
-                    "spending_height": deposit.spending_height,
-                    "spending_time": deposit.spending_time,
-                    "type": deposit.deposit_type
-                });
-                deposit_list.push(deposit_json);
+    offload("get_term_deposits", move || {
+        let real_wallet = wallet_session()?;
+
+        // Get real deposits from CryptoNote wallet
+        match real_wallet.get_deposits() {
+            Ok(deposits) => {
+                let mut deposit_list = Vec::new();
+
+                for deposit in deposits {
+                    let deposit_json = serde_json::json!({
+                        "id": deposit.id,
+                        "amount": deposit.amount,
+                        "interest": deposit.interest,
+                        "term": deposit.term,
+                        "rate": deposit.rate,
+                        "status": deposit.status,
+                        "unlock_height": deposit.unlock_height,
+                        "unlock_time": deposit.unlock_time,
+                        "creating_transaction_hash": deposit.creating_transaction_hash,
+                        "creating_height": deposit.creating_height,
+                        "creating_time": deposit.creating_time,
+                        "spending_transaction_hash": deposit.spending_transaction_hash,
+                        "spending_height": deposit.spending_height,
+                        "spending_time": deposit.spending_time,
+                        "type": deposit.deposit_type
+                    });
+                    deposit_list.push(deposit_json);
+                }
+
+                log::info!("Retrieved {} term deposits from blockchain", deposit_list.len());
+                Ok(deposit_list)
+            }
+            Err(e) => {
+                log::error!("Failed to get deposits: {}", e);
+                Err(format!("Failed to get deposits: {}", e))
             }
-            
-            log::info!("Retrieved {} term deposits from blockchain", deposit_list.len());
-            Ok(deposit_list)
-        }
-        Err(e) => {
-            log::error!("Failed to get deposits: {}", e);
-            Err(format!("Failed to get deposits: {}", e))
         }
-    }
+    }).await
 }
 
 /// Create a new term deposit (stake XFG for interest)
 #[tauri::command]
 async fn create_term_deposit(amount: u64, term: u32) -> Result<String, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-    
-    // Try to open existing wallet first
-    let wallet_result = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    
-    if let Err(e) = wallet_result {
-        return Err(format!("Failed to open/create wallet: {}", e));
-    }
-    
-    // Connect to Fuego network
-    let _ = connect_to_fuego_network(&mut real_wallet);
-    
-    // Validate deposit parameters
-    if amount < 10000000 { // Minimum 1 XFG
-        return Err("Minimum deposit amount is 1 XFG".to_string());
-    }
-    
-    if term < 1 || term > 365 { // Term between 1 and 365 days
-        return Err("Term must be between 1 and 365 days".to_string());
-    }
-    
-    // Create real deposit transaction using CryptoNote
-    match real_wallet.create_deposit(amount, term) {
-        Ok(deposit_id) => {
-            log::info!("Created term deposit: {} XFG for {} days (ID: {})", amount / 10000000, term, deposit_id);
-            Ok(deposit_id)
+    offload("create_term_deposit", move || {
+        let real_wallet = wallet_session()?;
+
+        // Validate deposit parameters
+        if amount < 10000000 { // Minimum 1 XFG
+            return Err("Minimum deposit amount is 1 XFG".to_string());
         }
-        Err(e) => {
-            log::error!("Failed to create deposit: {}", e);
-            Err(format!("Failed to create deposit: {}", e))
+
+        if term < 1 || term > 365 { // Term between 1 and 365 days
+            return Err("Term must be between 1 and 365 days".to_string());
         }
-    }
+
+        // Create real deposit transaction using CryptoNote
+        match real_wallet.create_deposit(amount, term) {
+            Ok(deposit_id) => {
+                log::info!("Created term deposit: {} XFG for {} days (ID: {})", amount / 10000000, term, deposit_id);
+                Ok(deposit_id)
+            }
+            Err(e) => {
+                log::error!("Failed to create deposit: {}", e);
+                Err(format!("Failed to create deposit: {}", e))
+            }
+        }
+    }).await
 }
 
 /// Withdraw a term deposit (claim principal + interest)
 #[tauri::command]
 async fn withdraw_term_deposit(deposit_id: String) -> Result<String, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-    
-    // Try to open existing wallet first
-    let wallet_result = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-    
-    if let Err(e) = wallet_result {
-        return Err(format!("Failed to open/create wallet: {}", e));
-    }
-    
-    // Connect to Fuego network
-    let _ = connect_to_fuego_network(&mut real_wallet);
-    
-    // Withdraw deposit using real CryptoNote functionality
-    match real_wallet.withdraw_deposit(&deposit_id) {
-        Ok(tx_hash) => {
-            log::info!("Withdrew term deposit: {} (TX: {})", deposit_id, tx_hash);
-            Ok(tx_hash)
-        }
-        Err(e) => {
-            log::error!("Failed to withdraw deposit: {}", e);
-            Err(format!("Failed to withdraw deposit: {}", e))
+    offload("withdraw_term_deposit", move || {
+        let real_wallet = wallet_session()?;
+
+        // Withdraw deposit using real CryptoNote functionality
+        match real_wallet.withdraw_deposit(&deposit_id) {
+            Ok(tx_hash) => {
+                log::info!("Withdrew term deposit: {} (TX: {})", deposit_id, tx_hash);
+                Ok(tx_hash)
+            }
+            Err(e) => {
+                log::error!("Failed to withdraw deposit: {}", e);
+                Err(format!("Failed to withdraw deposit: {}", e))
+            }
         }
-    }
+    }).await
 }
 
 // ===== PHASE 2.2: SECURITY & PERFORMANCE COMMANDS =====
@@ -933,16 +1085,23 @@ async fn validate_password_strength(password: String) -> Result<serde_json::Valu
     }
 }
 
-/// Encrypt wallet data
+/// Encrypt wallet data. With an unlocked session the key it derived at login is used and the
+/// password is not needed, otherwise every call pays for a full Argon2 derivation.
 #[tauri::command]
-async fn encrypt_wallet_data(data: String, password: String) -> Result<String, String> {
-    WalletEncryption::encrypt_data(&data, &password)
+async fn encrypt_wallet_data(data: String, password: Option<String>, session_id: Option<String>) -> Result<String, String> {
+    match session_id {
+        Some(session_id) => SECURITY_MANAGER.get().unwrap().encrypt_with_session(&session_id, &data),
+        None => WalletEncryption::encrypt_data(&data, &password.ok_or("Password is required without a session")?),
+    }
 }
 
-/// Decrypt wallet data
+/// Decrypt wallet data, with the session's cached keys when a session is given
 #[tauri::command]
-async fn decrypt_wallet_data(encrypted_data: String, password: String) -> Result<String, String> {
-    WalletEncryption::decrypt_data(&encrypted_data, &password)
+async fn decrypt_wallet_data(encrypted_data: String, password: Option<String>, session_id: Option<String>) -> Result<String, String> {
+    match session_id {
+        Some(session_id) => SECURITY_MANAGER.get().unwrap().decrypt_with_session(&session_id, &encrypted_data, password.as_deref()),
+        None => WalletEncryption::decrypt_data(&encrypted_data, &password.ok_or("Password is required without a session")?),
+    }
 }
 
 /// Get performance metrics
@@ -967,7 +1126,8 @@ async fn get_performance_metrics(operation_name: Option<String>) -> Result<serde
         let metrics = monitor.get_metrics(None);
         Ok(serde_json::json!({
             "total_operations": metrics.len(),
-            "operations": metrics
+            "operations": metrics,
+            "blocking_pool": FFI_EXECUTOR.get().unwrap().stats()
         }))
     }
 }
@@ -977,16 +1137,20 @@ async fn get_performance_metrics(operation_name: Option<String>) -> Result<serde
 async fn get_cache_stats() -> Result<serde_json::Value, String> {
     let cache = CACHE.get().unwrap();
     let stats = cache.stats();
+    let tip_stats = TIP_CACHE.get().unwrap().stats();
     Ok(serde_json::json!({
         "total_entries": stats.total_entries,
         "expired_entries": stats.expired_entries,
         "active_entries": stats.active_entries,
         "max_size": stats.max_size,
-        "hit_rate": if stats.total_entries > 0 {
-            (stats.active_entries as f64 / stats.total_entries as f64) * 100.0
-        } else {
-            0.0
-        }
+        "size_bytes": stats.size,
+        "hits": stats.hits,
+        "misses": stats.misses,
+        "evictions": stats.evictions,
+        "rejections": stats.rejections,
+        "hit_rate": stats.hit_rate,
+        "tip_cache": tip_stats,
+        "optimization_cache": OPTIMIZATION_CACHE.get().unwrap().stats()
     }))
 }
 
@@ -995,10 +1159,31 @@ async fn get_cache_stats() -> Result<serde_json::Value, String> {
 async fn clear_cache() -> Result<(), String> {
     let cache = CACHE.get().unwrap();
     cache.clear();
+    TIP_CACHE.get().unwrap().invalidate();
     log::info!("Cache cleared");
     Ok(())
 }
 
+/// Enable or disable recording of command trace spans
+#[tauri::command]
+async fn set_tracing_enabled(enabled: bool) -> Result<(), String> {
+    trace::set_tracing_enabled(enabled);
+    Ok(())
+}
+
+/// Export recorded spans as Chrome trace JSON: one trace by id, the latest
+/// run of a command, or everything retained when neither is given
+#[tauri::command]
+async fn export_trace(trace_id: Option<u64>, command: Option<String>) -> Result<String, String> {
+    let trace_id = match (trace_id, command) {
+        (Some(id), _) => id,
+        (None, Some(command)) => trace::last_trace_id(&command)
+            .ok_or_else(|| format!("No trace recorded for {}", command))?,
+        (None, None) => 0,
+    };
+    Ok(trace::export_chrome_trace(trace_id))
+}
+
 /// Get background task status
 #[tauri::command]
 async fn get_background_task_status(task_name: String) -> Result<serde_json::Value, String> {
@@ -1008,8 +1193,9 @@ async fn get_background_task_status(task_name: String) -> Result<serde_json::Val
         Some(status) => Ok(serde_json::json!({
             "name": status.name,
             "enabled": status.enabled,
-            "last_run": status.last_run.elapsed().as_secs(),
-            "next_run_in": status.next_run_in.as_secs()
+            "runs": status.runs,
+            "last_run": status.last_run.map(|at| at.elapsed().as_secs()),
+            "next_run_in": status.next_run_in.map(|d| d.as_secs())
         })),
         None => Err("Task not found".to_string())
     }
@@ -1038,39 +1224,39 @@ async fn disable_background_task(task_name: String) -> Result<(), String> {
 // Get comprehensive wallet information
 #[tauri::command]
 async fn get_wallet_info_advanced() -> Result<serde_json::Value, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.get_wallet_info() {
-        Ok(info) => Ok(serde_json::json!({
-            "address": info.address,
-            "balance": info.balance,
-            "unlocked_balance": info.unlocked_balance,
-            "locked_balance": info.locked_balance,
-            "total_received": info.total_received,
-            "total_sent": info.total_sent,
-            "transaction_count": info.transaction_count,
-            "is_synced": info.is_synced,
-            "sync_height": info.sync_height,
-            "network_height": info.network_height,
-            "daemon_height": info.daemon_height,
-            "is_connected": info.is_connected,
-            "peer_count": info.peer_count,
-            "last_block_time": info.last_block_time
-        })),
-        Err(e) => Err(format!("Failed to get wallet info: {}", e))
-    }
+    offload("get_wallet_info_advanced", move || {
+        let real_wallet = wallet_session()?;
+
+        match real_wallet.get_wallet_info() {
+            Ok(info) => Ok(serde_json::json!({
+                "address": info.address,
+                "balance": info.balance,
+                "unlocked_balance": info.unlocked_balance,
+                "locked_balance": info.locked_balance,
+                "total_received": info.total_received,
+                "total_sent": info.total_sent,
+                "transaction_count": info.transaction_count,
+                "is_synced": info.is_synced,
+                "sync_height": info.sync_height,
+                "network_height": info.network_height,
+                "daemon_height": info.daemon_height,
+                "is_connected": info.is_connected,
+                "peer_count": info.peer_count,
+                "last_block_time": info.last_block_time
+            })),
+            Err(e) => Err(format!("Failed to get wallet info: {}", e))
+        }
+    }).await
 }
 
 // Get detailed network information
 #[tauri::command]
 async fn get_network_info_advanced() -> Result<serde_json::Value, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
+    offload_cached("get_network_info_advanced", "network_info".to_string(), load_network_info_advanced).await
+}
 
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+fn load_network_info_advanced() -> Result<serde_json::Value, String> {
+    let real_wallet = wallet_session()?;
 
     match real_wallet.get_network_info() {
         Ok(info) => Ok(serde_json::json!({
@@ -1091,12 +1277,14 @@ async fn get_network_info_advanced() -> Result<serde_json::Value, String> {
 // Get transaction by hash
 #[tauri::command]
 async fn get_transaction_by_hash(tx_hash: String) -> Result<serde_json::Value, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
+    let key = format!("tx:{}", tx_hash);
+    offload_cached("get_transaction_by_hash", key, move || load_transaction_by_hash(&tx_hash)).await
+}
 
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+fn load_transaction_by_hash(tx_hash: &str) -> Result<serde_json::Value, String> {
+    let real_wallet = wallet_session()?;
 
-    match real_wallet.get_transaction_by_hash(&tx_hash) {
+    match real_wallet.get_transaction_by_hash(tx_hash) {
         Ok(tx) => Ok(serde_json::json!({
             "id": tx.id,
             "hash": tx.hash,
@@ -1120,24 +1308,25 @@ async fn get_transaction_by_hash(tx_hash: String) -> Result<serde_json::Value, S
 // Create new address
 #[tauri::command]
 async fn create_address(label: Option<String>) -> Result<String, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+    offload("create_address", move || {
+        let real_wallet = wallet_session()?;
 
-    match real_wallet.create_address(label.as_deref()) {
-        Ok(address) => Ok(address),
-        Err(e) => Err(format!("Failed to create address: {}", e))
-    }
+        match real_wallet.create_address(label.as_deref()) {
+            Ok(address) => Ok(address),
+            Err(e) => Err(format!("Failed to create address: {}", e))
+        }
+    }).await
 }
 
 // Get block information
 #[tauri::command]
 async fn get_block_info(height: u64) -> Result<serde_json::Value, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
+    let key = format!("block:{}", height);
+    offload_cached("get_block_info", key, move || load_block_info(height)).await
+}
 
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+fn load_block_info(height: u64) -> Result<serde_json::Value, String> {
+    let real_wallet = wallet_session()?;
 
     match real_wallet.get_block_info(height) {
         Ok(block) => Ok(serde_json::json!({
@@ -1163,268 +1352,256 @@ async fn start_mining(
     pool_wallet: Option<String>,
     pool_password: Option<String>
 ) -> Result<bool, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    // If daemon address is provided, connect for solo mining
-    if let Some(address) = daemon_address {
-        let parts: Vec<&str> = address.split(':').collect();
-        let host = parts[0];
-        let port: u16 = parts.get(1).and_then(|p| p.parse().ok()).unwrap_or(18180);
-        if let Err(e) = real_wallet.connect_to_node(host, port) {
-            eprintln!("Failed to connect solo daemon {}:{} - {}", host, port, e);
+    offload("start_mining", move || {
+        let mut real_wallet = wallet_session()?;
+
+        // If daemon address is provided, connect for solo mining
+        if let Some(address) = daemon_address {
+            let parts: Vec<&str> = address.split(':').collect();
+            let host = parts[0];
+            let port: u16 = parts.get(1).and_then(|p| p.parse().ok()).unwrap_or(18180);
+            if let Err(e) = real_wallet.connect_to_node(host, port) {
+                eprintln!("Failed to connect solo daemon {}:{} - {}", host, port, e);
+            }
+        } else {
+            let _ = connect_to_fuego_network(&mut real_wallet);
         }
-    } else {
-        let _ = connect_to_fuego_network(&mut real_wallet);
-    }
 
-    // If pool wallet is provided, configure pool mining
-    if let Some(wallet_addr) = pool_wallet {
-        let worker = pool_password.clone().unwrap_or_else(|| "worker".to_string());
-        if let Err(e) = real_wallet.set_mining_pool(None, Some(&worker)) {
-            eprintln!("Failed to set mining pool worker: {}", e);
+        // If pool wallet is provided, configure pool mining
+        if let Some(wallet_addr) = pool_wallet {
+            let worker = pool_password.clone().unwrap_or_else(|| "worker".to_string());
+            if let Err(e) = real_wallet.set_mining_pool(None, Some(&worker)) {
+                eprintln!("Failed to set mining pool worker: {}", e);
+            }
+            // Note: Pool URL is set via set_mining_pool(pool_address, worker_name) when provided by UI
+            let _ = wallet_addr; // Wallet used internally by daemon/pool; native layer manages it.
         }
-        // Note: Pool URL is set via set_mining_pool(pool_address, worker_name) when provided by UI
-        let _ = wallet_addr; // Wallet used internally by daemon/pool; native layer manages it.
-    }
 
-    match real_wallet.start_mining(threads, background) {
-        Ok(_) => Ok(true),
-        Err(e) => {
-            eprintln!("Failed to start mining: {}", e);
-            Ok(false)
+        match real_wallet.start_mining(threads, background) {
+            Ok(_) => Ok(true),
+            Err(e) => {
+                eprintln!("Failed to start mining: {}", e);
+                Ok(false)
+            }
         }
-    }
+    }).await
 }
 
 #[tauri::command]
 async fn stop_mining() -> Result<(), String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+    offload("stop_mining", move || {
+        let mut real_wallet = wallet_session()?;
 
-    match real_wallet.stop_mining() {
-        Ok(_) => Ok(()),
-        Err(e) => Err(format!("Failed to stop mining: {}", e))
-    }
+        match real_wallet.stop_mining() {
+            Ok(_) => Ok(()),
+            Err(e) => Err(format!("Failed to stop mining: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn get_mining_info() -> Result<serde_json::Value, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.get_mining_info() {
-        Ok(info) => Ok(serde_json::json!({
-            "is_mining": info.is_mining,
-            "hashrate": info.hashrate,
-            "difficulty": info.difficulty,
-            "block_reward": info.block_reward,
-            "pool_address": info.pool_address,
-            "worker_name": info.worker_name,
-            "threads": info.threads
-        })),
-        Err(e) => Err(format!("Failed to get mining info: {}", e))
-    }
+    offload("get_mining_info", move || {
+        let real_wallet = wallet_session()?;
+
+        match real_wallet.get_mining_info() {
+            Ok(info) => Ok(serde_json::json!({
+                "is_mining": info.is_mining,
+                "hashrate": info.hashrate,
+                "difficulty": info.difficulty,
+                "block_reward": info.block_reward,
+                "pool_address": info.pool_address,
+                "worker_name": info.worker_name,
+                "threads": info.threads
+            })),
+            Err(e) => Err(format!("Failed to get mining info: {}", e))
+        }
+    }).await
 }
 
 // Get transaction history
 #[tauri::command]
 async fn get_transaction_history(limit: Option<u64>, offset: Option<u64>) -> Result<Vec<serde_json::Value>, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.get_transaction_history(limit.unwrap_or(50), offset.unwrap_or(0)) {
-        Ok(transactions) => {
-            let mapped: Vec<serde_json::Value> = transactions
-                .into_iter()
-                .map(|tx| serde_json::json!({
-                    "id": tx.id,
-                    "hash": tx.hash,
-                    "amount": tx.amount,
-                    "fee": tx.fee,
-                    "height": tx.height,
-                    "timestamp": tx.timestamp,
-                    "confirmations": tx.confirmations,
-                    "is_confirmed": tx.is_confirmed,
-                    "is_pending": tx.is_pending,
-                    "payment_id": tx.payment_id,
-                    "destination_addresses": tx.destination_addresses,
-                    "source_addresses": tx.source_addresses,
-                    "unlock_time": tx.unlock_time,
-                    "extra": tx.extra
-                }))
-                .collect();
-            Ok(mapped)
+    offload("get_transaction_history", move || {
+        let real_wallet = wallet_session()?;
+
+        match real_wallet.get_transaction_history(limit.unwrap_or(50), offset.unwrap_or(0)) {
+            Ok(transactions) => {
+                let mapped: Vec<serde_json::Value> = transactions
+                    .into_iter()
+                    .map(|tx| serde_json::json!({
+                        "id": tx.id,
+                        "hash": tx.hash,
+                        "amount": tx.amount,
+                        "fee": tx.fee,
+                        "height": tx.height,
+                        "timestamp": tx.timestamp,
+                        "confirmations": tx.confirmations,
+                        "is_confirmed": tx.is_confirmed,
+                        "is_pending": tx.is_pending,
+                        "payment_id": tx.payment_id,
+                        "destination_addresses": tx.destination_addresses,
+                        "source_addresses": tx.source_addresses,
+                        "unlock_time": tx.unlock_time,
+                        "extra": tx.extra
+                    }))
+                    .collect();
+                Ok(mapped)
+            }
+            Err(e) => Err(format!("Failed to get transaction history: {}", e))
         }
-        Err(e) => Err(format!("Failed to get transaction history: {}", e))
-    }
+    }).await
 }
 
 // Sync progress commands
 #[tauri::command]
 async fn get_sync_progress() -> Result<serde_json::Value, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.get_sync_progress() {
-        Ok(progress) => Ok(serde_json::json!({
-            "current_height": progress.current_height,
-            "total_height": progress.total_height,
-            "progress_percentage": progress.progress_percentage,
-            "estimated_time_remaining": progress.estimated_time_remaining,
-            "is_syncing": progress.is_syncing
-        })),
-        Err(e) => Err(format!("Failed to get sync progress: {}", e))
-    }
+    offload("get_sync_progress", move || {
+        let real_wallet = wallet_session()?;
+
+        match real_wallet.get_sync_progress() {
+            Ok(progress) => Ok(serde_json::json!({
+                "current_height": progress.current_height,
+                "total_height": progress.total_height,
+                "progress_percentage": progress.progress_percentage,
+                "estimated_time_remaining": progress.estimated_time_remaining,
+                "is_syncing": progress.is_syncing,
+                "blocks_per_second": progress.blocks_per_second,
+                "time_to_first_balance_ms": progress.time_to_first_balance_ms
+            })),
+            Err(e) => Err(format!("Failed to get sync progress: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn get_sync_status_json() -> Result<String, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+    offload("get_sync_status_json", move || {
+        let real_wallet = wallet_session()?;
 
-    match real_wallet.get_sync_status_json() {
-        Ok(json) => Ok(json),
-        Err(e) => Err(format!("Failed to get sync status JSON: {}", e))
-    }
+        match real_wallet.get_sync_status_json() {
+            Ok(json) => Ok(json),
+            Err(e) => Err(format!("Failed to get sync status JSON: {}", e))
+        }
+    }).await
 }
 
 // Address book commands
 #[tauri::command]
 async fn add_address_book_entry(address: String, label: Option<String>, description: Option<String>) -> Result<(), String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
+    offload("add_address_book_entry", move || {
+        let real_wallet = wallet_session()?;
 
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.add_address_book_entry(&address, label.as_deref(), description.as_deref()) {
-        Ok(_) => Ok(()),
-        Err(e) => Err(format!("Failed to add address book entry: {}", e))
-    }
+        match real_wallet.add_address_book_entry(&address, label.as_deref(), description.as_deref()) {
+            Ok(_) => Ok(()),
+            Err(e) => Err(format!("Failed to add address book entry: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn remove_address_book_entry(address: String) -> Result<(), String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+    offload("remove_address_book_entry", move || {
+        let real_wallet = wallet_session()?;
 
-    match real_wallet.remove_address_book_entry(&address) {
-        Ok(_) => Ok(()),
-        Err(e) => Err(format!("Failed to remove address book entry: {}", e))
-    }
+        match real_wallet.remove_address_book_entry(&address) {
+            Ok(_) => Ok(()),
+            Err(e) => Err(format!("Failed to remove address book entry: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn update_address_book_entry(address: String, label: Option<String>, description: Option<String>) -> Result<(), String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
+    offload("update_address_book_entry", move || {
+        let real_wallet = wallet_session()?;
 
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.update_address_book_entry(&address, label.as_deref(), description.as_deref()) {
-        Ok(_) => Ok(()),
-        Err(e) => Err(format!("Failed to update address book entry: {}", e))
-    }
+        match real_wallet.update_address_book_entry(&address, label.as_deref(), description.as_deref()) {
+            Ok(_) => Ok(()),
+            Err(e) => Err(format!("Failed to update address book entry: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn get_address_book() -> Result<Vec<serde_json::Value>, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.get_address_book() {
-        Ok(entries) => {
-            let mapped: Vec<serde_json::Value> = entries
-                .into_iter()
-                .map(|entry| serde_json::json!({
-                    "address": entry.address,
-                    "label": entry.label,
-                    "description": entry.description,
-                    "created_time": entry.created_time,
-                    "last_used_time": entry.last_used_time,
-                    "use_count": entry.use_count
-                }))
-                .collect();
-            Ok(mapped)
+    offload("get_address_book", move || {
+        let real_wallet = wallet_session()?;
+
+        match real_wallet.get_address_book() {
+            Ok(entries) => {
+                let mapped: Vec<serde_json::Value> = entries
+                    .into_iter()
+                    .map(|entry| serde_json::json!({
+                        "address": entry.address,
+                        "label": entry.label,
+                        "description": entry.description,
+                        "created_time": entry.created_time,
+                        "last_used_time": entry.last_used_time,
+                        "use_count": entry.use_count
+                    }))
+                    .collect();
+                Ok(mapped)
+            }
+            Err(e) => Err(format!("Failed to get address book: {}", e))
         }
-        Err(e) => Err(format!("Failed to get address book: {}", e))
-    }
+    }).await
 }
 
 #[tauri::command]
 async fn mark_address_used(address: String) -> Result<(), String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+    offload("mark_address_used", move || {
+        let real_wallet = wallet_session()?;
 
-    match real_wallet.mark_address_used(&address) {
-        Ok(_) => Ok(()),
-        Err(e) => Err(format!("Failed to mark address as used: {}", e))
-    }
+        match real_wallet.mark_address_used(&address) {
+            Ok(_) => Ok(()),
+            Err(e) => Err(format!("Failed to mark address as used: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn get_address_book_entry(address: String) -> Result<Option<serde_json::Value>, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.get_address_book_entry(&address) {
-        Ok(Some(entry)) => Ok(Some(serde_json::json!({
-            "address": entry.address,
-            "label": entry.label,
-            "description": entry.description,
-            "created_time": entry.created_time,
-            "last_used_time": entry.last_used_time,
-            "use_count": entry.use_count
-        }))),
-        Ok(None) => Ok(None),
-        Err(e) => Err(format!("Failed to get address book entry: {}", e))
-    }
+    offload("get_address_book_entry", move || {
+        let real_wallet = wallet_session()?;
+
+        match real_wallet.get_address_book_entry(&address) {
+            Ok(Some(entry)) => Ok(Some(serde_json::json!({
+                "address": entry.address,
+                "label": entry.label,
+                "description": entry.description,
+                "created_time": entry.created_time,
+                "last_used_time": entry.last_used_time,
+                "use_count": entry.use_count
+            }))),
+            Ok(None) => Ok(None),
+            Err(e) => Err(format!("Failed to get address book entry: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn set_mining_pool(pool_address: Option<String>, worker_name: Option<String>) -> Result<(), String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+    offload("set_mining_pool", move || {
+        let real_wallet = wallet_session()?;
 
-    match real_wallet.set_mining_pool(pool_address.as_deref(), worker_name.as_deref()) {
-        Ok(_) => Ok(()),
-        Err(e) => Err(format!("Failed to set mining pool: {}", e))
-    }
+        match real_wallet.set_mining_pool(pool_address.as_deref(), worker_name.as_deref()) {
+            Ok(_) => Ok(()),
+            Err(e) => Err(format!("Failed to set mining pool: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn get_mining_stats_json() -> Result<String, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
+    offload("get_mining_stats_json", move || {
+        let real_wallet = wallet_session()?;
 
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.get_mining_stats_json() {
-        Ok(json) => Ok(json),
-        Err(e) => Err(format!("Failed to get mining statistics: {}", e))
-    }
+        match real_wallet.get_mining_stats_json() {
+            Ok(json) => Ok(json),
+            Err(e) => Err(format!("Failed to get mining statistics: {}", e))
+        }
+    }).await
 }
 
 // Wrapper commands for compatibility with frontend
@@ -1473,93 +1650,86 @@ async fn validate_seed_phrase(seed_phrase: String) -> Result<bool, String> {
 
 #[tauri::command]
 async fn derive_keys_from_seed(seed_phrase: String, password: String) -> Result<(), String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+    offload("derive_keys_from_seed", move || {
+        let real_wallet = wallet_session()?;
 
-    match real_wallet.derive_keys_from_seed(&seed_phrase, &password) {
-        Ok(_) => Ok(()),
-        Err(e) => Err(format!("Failed to derive keys from seed: {}", e))
-    }
+        match real_wallet.derive_keys_from_seed(&seed_phrase, &password) {
+            Ok(_) => Ok(()),
+            Err(e) => Err(format!("Failed to derive keys from seed: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn get_seed_phrase(password: String) -> Result<String, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
+    offload("get_seed_phrase", move || {
+        let real_wallet = wallet_session()?;
 
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.get_seed_phrase(&password) {
-        Ok(seed) => Ok(seed),
-        Err(e) => Err(format!("Failed to get seed phrase: {}", e))
-    }
+        match real_wallet.get_seed_phrase(&password) {
+            Ok(seed) => Ok(seed),
+            Err(e) => Err(format!("Failed to get seed phrase: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn get_view_key() -> Result<String, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+    offload("get_view_key", move || {
+        let real_wallet = wallet_session()?;
 
-    match real_wallet.get_view_key() {
-        Ok(key) => Ok(key),
-        Err(e) => Err(format!("Failed to get view key: {}", e))
-    }
+        match real_wallet.get_view_key() {
+            Ok(key) => Ok(key),
+            Err(e) => Err(format!("Failed to get view key: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn get_spend_key() -> Result<String, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
+    offload("get_spend_key", move || {
+        let real_wallet = wallet_session()?;
 
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.get_spend_key() {
-        Ok(key) => Ok(key),
-        Err(e) => Err(format!("Failed to get spend key: {}", e))
-    }
+        match real_wallet.get_spend_key() {
+            Ok(key) => Ok(key),
+            Err(e) => Err(format!("Failed to get spend key: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn has_keys() -> Result<bool, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+    offload("has_keys", move || {
+        let real_wallet = wallet_session()?;
 
-    match real_wallet.has_keys() {
-        Ok(has_keys) => Ok(has_keys),
-        Err(e) => Err(format!("Failed to check if wallet has keys: {}", e))
-    }
+        match real_wallet.has_keys() {
+            Ok(has_keys) => Ok(has_keys),
+            Err(e) => Err(format!("Failed to check if wallet has keys: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn export_keys() -> Result<String, String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
+    offload("export_keys", move || {
+        let real_wallet = wallet_session()?;
 
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
-
-    match real_wallet.export_keys() {
-        Ok(keys) => Ok(keys),
-        Err(e) => Err(format!("Failed to export keys: {}", e))
-    }
+        match real_wallet.export_keys() {
+            Ok(keys) => Ok(keys),
+            Err(e) => Err(format!("Failed to export keys: {}", e))
+        }
+    }).await
 }
 
 #[tauri::command]
 async fn import_keys(view_key: String, spend_key: String, address: String) -> Result<(), String> {
-    let mut real_wallet = RealCryptoNoteWallet::new();
-
-    let _ = real_wallet.open_wallet("/tmp/fuego_wallet.wallet", "fuego_password")
-        .or_else(|_| real_wallet.create_wallet("fuego_password", "/tmp/fuego_wallet.wallet", None, 0));
+    offload("import_keys", move || {
+        let real_wallet = wallet_session()?;
 
-    match real_wallet.import_keys(&view_key, &spend_key, &address) {
-        Ok(_) => Ok(()),
-        Err(e) => Err(format!("Failed to import keys: {}", e))
-    }
+        match real_wallet.import_keys(&view_key, &spend_key, &address) {
+            Ok(_) => Ok(()),
+            Err(e) => Err(format!("Failed to import keys: {}", e))
+        }
+    }).await
 }
 
 // ===== PHASE 2.3: PRODUCTION FEATURES COMMANDS =====
@@ -10,7 +10,9 @@ use std::collections::HashMap;
 use std::sync::{Arc, Mutex};
 use std::time::{Duration, Instant};
 use std::thread;
+use std::panic::{self, AssertUnwindSafe};
 use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use crate::performance::{ShardedCache, ShardedCacheStats};
 
 /// Performance metrics for monitoring
 #[derive(Debug, Clone, serde::Serialize, serde::Deserialize)]
@@ -56,6 +58,38 @@ pub enum ThreadPriority {
     Critical,
 }
 
+/// Background work the monitor allows, derived from the latest system sample
+#[derive(Debug, Clone, Copy, PartialEq, Eq, serde::Serialize)]
+pub struct ResourceLimits {
+    /// Miner threads allowed to hash, 0 pauses mining
+    pub mining_threads: u32,
+    /// Workers for the next rescan, at least 1
+    pub rescan_workers: u32,
+    pub on_battery: bool,
+    pub memory_pressure: bool,
+}
+
+/// One system sample the limits are computed from
+#[derive(Debug, Clone, Copy)]
+pub struct ResourceSample {
+    pub cores: usize,
+    /// Whole-machine CPU usage, 0..100
+    pub total_cpu_usage: f64,
+    /// This process' CPU usage, 0..100 per core
+    pub process_cpu_usage: f64,
+    pub available_memory: u64,
+    pub on_battery: bool,
+}
+
+/// Receives the limits after every sample
+pub struct LimitsListener(Box<dyn Fn(ResourceLimits) + Send + Sync>);
+
+impl std::fmt::Debug for LimitsListener {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.write_str("LimitsListener")
+    }
+}
+
 /// Resource monitor for tracking system resources
 #[derive(Debug)]
 pub struct ResourceMonitor {
@@ -65,6 +99,8 @@ pub struct ResourceMonitor {
     operation_times: Arc<Mutex<HashMap<String, Vec<Duration>>>>,
     cache_stats: Arc<Mutex<CacheStats>>,
     is_monitoring: Arc<AtomicUsize>,
+    limits: Arc<Mutex<Option<ResourceLimits>>>,
+    limits_listener: Arc<Mutex<Option<LimitsListener>>>,
 }
 
 #[derive(Debug)]
@@ -117,8 +153,20 @@ impl ResourceMonitor {
             operation_times: Arc::new(Mutex::new(HashMap::new())),
             cache_stats: Arc::new(Mutex::new(CacheStats::new(memory_opt.max_cache_size))),
             is_monitoring: Arc::new(AtomicUsize::new(0)),
+            limits: Arc::new(Mutex::new(None)),
+            limits_listener: Arc::new(Mutex::new(None)),
         }
     }
+
+    /// Set who is told the limits after each sample, replacing any earlier listener
+    pub fn set_limits_listener(&self, listener: impl Fn(ResourceLimits) + Send + Sync + 'static) {
+        *self.limits_listener.lock().unwrap() = Some(LimitsListener(Box::new(listener)));
+    }
+
+    /// Limits from the latest sample, None before the first one
+    pub fn get_limits(&self) -> Option<ResourceLimits> {
+        *self.limits.lock().unwrap()
+    }
     
     /// Start monitoring system resources
     pub fn start_monitoring(&self) {
@@ -127,11 +175,26 @@ impl ResourceMonitor {
             let operation_times = Arc::clone(&self.operation_times);
             let cache_stats = Arc::clone(&self.cache_stats);
             let is_monitoring = Arc::clone(&self.is_monitoring);
+            let limits = Arc::clone(&self.limits);
+            let limits_listener = Arc::clone(&self.limits_listener);
+            let memory_opt = self.memory_optimization.clone();
+            let cpu_opt = self.cpu_optimization.clone();
             
             thread::spawn(move || {
+                // CPU usage is measured between refreshes, so the same System is kept across samples
+                let mut sys = sysinfo::System::new();
+                let pid = sysinfo::get_current_pid().ok();
+                sys.refresh_cpu();
                 while is_monitoring.load(Ordering::Relaxed) == 1 {
-                    Self::update_metrics(&metrics, &operation_times, &cache_stats);
                     thread::sleep(Duration::from_secs(1));
+                    let sample = Self::sample(&mut sys, pid);
+                    Self::update_metrics(&metrics, &operation_times, &cache_stats, &sample, &sys);
+
+                    let current = compute_limits(&cpu_opt, &memory_opt, &sample);
+                    *limits.lock().unwrap() = Some(current);
+                    if let Some(listener) = limits_listener.lock().unwrap().as_ref() {
+                        (listener.0)(current);
+                    }
                 }
             });
         }
@@ -186,13 +249,14 @@ impl ResourceMonitor {
         metrics: &Arc<Mutex<PerformanceMetrics>>,
         operation_times: &Arc<Mutex<HashMap<String, Vec<Duration>>>>,
         cache_stats: &Arc<Mutex<CacheStats>>,
+        sample: &ResourceSample,
+        sys: &sysinfo::System,
     ) {
         if let Ok(mut m) = metrics.lock() {
-            // Update CPU usage (simplified)
-            m.cpu_usage = Self::get_cpu_usage();
+            m.cpu_usage = sample.total_cpu_usage;
             
             // Update memory usage
-            m.memory_usage = Self::get_memory_usage();
+            m.memory_usage = sys.used_memory();
             if m.memory_usage > m.memory_peak {
                 m.memory_peak = m.memory_usage;
             }
@@ -221,22 +285,24 @@ impl ResourceMonitor {
         }
     }
     
-    /// Get current CPU usage (simplified implementation)
-    fn get_cpu_usage() -> f64 {
-        use sysinfo::System;
-        let mut sys = System::new();
+    /// Refresh sys and read what the limits are computed from
+    fn sample(sys: &mut sysinfo::System, pid: Option<sysinfo::Pid>) -> ResourceSample {
         sys.refresh_cpu();
-        // global_cpu_info().cpu_usage() returns 0..100
-        sys.global_cpu_info().cpu_usage() as f64
-    }
-    
-    /// Get current memory usage
-    fn get_memory_usage() -> u64 {
-        use sysinfo::System;
-        let mut sys = System::new();
         sys.refresh_memory();
-        // used memory in bytes (approx)
-        (sys.used_memory() as u64) * 1024
+        let process_cpu_usage = pid
+            .filter(|pid| sys.refresh_process(*pid))
+            .and_then(|pid| sys.process(pid))
+            .map(|process| process.cpu_usage() as f64)
+            .unwrap_or(0.0);
+
+        ResourceSample {
+            cores: sys.cpus().len().max(1),
+            // global_cpu_info().cpu_usage() returns 0..100
+            total_cpu_usage: sys.global_cpu_info().cpu_usage() as f64,
+            process_cpu_usage,
+            available_memory: sys.available_memory(),
+            on_battery: on_battery(),
+        }
     }
     
     /// Measure network latency
@@ -257,115 +323,95 @@ impl ResourceMonitor {
     }
 }
 
-/// Advanced caching system with LRU eviction
-#[derive(Debug)]
-pub struct AdvancedCache<K, V> {
-    data: Arc<Mutex<HashMap<K, CacheEntry<V>>>>,
-    max_size: usize,
-    stats: Arc<Mutex<CacheStats>>,
+/// Size background work to the cores other programs leave idle.
+///
+/// The wallet's own usage (mining, rescans) is not counted as busy, otherwise the miner would
+/// throttle itself down to nothing. One idle core is kept for the UI. On battery mining pauses and
+/// rescans use one worker; under memory pressure rescans use one worker, each holds a block batch.
+pub fn compute_limits(cpu_opt: &CPUOptimization, memory_opt: &MemoryOptimization, sample: &ResourceSample) -> ResourceLimits {
+    let cores = sample.cores.max(1);
+    let total_busy = sample.total_cpu_usage.clamp(0.0, 100.0) * cores as f64 / 100.0;
+    let other_busy = (total_busy - sample.process_cpu_usage.max(0.0) / 100.0).max(0.0);
+    let idle = cores.saturating_sub(other_busy.ceil() as usize);
+
+    let memory_pressure = sample.available_memory < memory_opt.memory_threshold;
+    let (mining_threads, rescan_workers) = if sample.on_battery || !cpu_opt.background_processing {
+        (0, 1)
+    } else if memory_pressure {
+        (idle.saturating_sub(1), 1)
+    } else {
+        (idle.saturating_sub(1), idle.max(1))
+    };
+
+    ResourceLimits {
+        mining_threads: mining_threads as u32,
+        rescan_workers: rescan_workers as u32,
+        on_battery: sample.on_battery,
+        memory_pressure,
+    }
 }
 
-#[derive(Debug, Clone)]
-struct CacheEntry<V> {
-    value: V,
-    last_accessed: Instant,
-    access_count: u64,
+/// True when a battery is discharging; only known on Linux, false elsewhere
+fn on_battery() -> bool {
+    #[cfg(target_os = "linux")]
+    {
+        let Ok(entries) = std::fs::read_dir("/sys/class/power_supply") else {
+            return false;
+        };
+        entries.flatten().any(|entry| {
+            let read = |name: &str| std::fs::read_to_string(entry.path().join(name)).unwrap_or_default();
+            read("type").trim() == "Battery" && read("status").trim() == "Discharging"
+        })
+    }
+    #[cfg(not(target_os = "linux"))]
+    {
+        false
+    }
+}
+
+/// Advanced caching system with LRU eviction and TinyLFU admission, values shared as `Arc`s
+#[derive(Debug)]
+pub struct AdvancedCache<K, V> {
+    data: ShardedCache<K, V>,
 }
 
 impl<K, V> AdvancedCache<K, V>
 where
     K: std::hash::Hash + Eq + Clone + Send + Sync + 'static,
-    V: Clone + Send + Sync + 'static,
+    V: Send + Sync + 'static,
 {
     /// Create a new advanced cache
     pub fn new(max_size: usize) -> Self {
         Self {
-            data: Arc::new(Mutex::new(HashMap::new())),
-            max_size,
-            stats: Arc::new(Mutex::new(CacheStats::new(max_size))),
+            data: ShardedCache::new(max_size),
+        }
+    }
+
+    /// Create a cache bounded by the bytes weigher reports for its entries
+    pub fn with_max_bytes(max_bytes: usize, weigher: impl Fn(&K, &V) -> usize + Send + Sync + 'static) -> Self {
+        Self {
+            data: ShardedCache::with_weigher(max_bytes, weigher),
         }
     }
     
     /// Get a value from the cache
-    pub fn get(&self, key: &K) -> Option<V> {
-        if let Ok(mut data) = self.data.lock() {
-            if let Some(entry) = data.get_mut(key) {
-                entry.last_accessed = Instant::now();
-                entry.access_count += 1;
-                
-                if let Ok(stats) = self.stats.lock() {
-                    stats.hits.fetch_add(1, Ordering::Relaxed);
-                }
-                
-                return Some(entry.value.clone());
-            }
-        }
-        
-        if let Ok(stats) = self.stats.lock() {
-            stats.misses.fetch_add(1, Ordering::Relaxed);
-        }
-        
-        None
+    pub fn get(&self, key: &K) -> Option<Arc<V>> {
+        self.data.get(key)
     }
     
     /// Insert a value into the cache
     pub fn insert(&self, key: K, value: V) {
-        if let Ok(mut data) = self.data.lock() {
-            // Check if we need to evict entries
-            if data.len() >= self.max_size {
-                self.evict_lru(&mut data);
-            }
-            
-            let entry = CacheEntry {
-                value,
-                last_accessed: Instant::now(),
-                access_count: 1,
-            };
-            
-            data.insert(key, entry);
-            
-            if let Ok(stats) = self.stats.lock() {
-                stats.size.store(data.len(), Ordering::Relaxed);
-            }
-        }
-    }
-    
-    /// Evict least recently used entries
-    fn evict_lru(&self, data: &mut HashMap<K, CacheEntry<V>>) {
-        if data.is_empty() {
-            return;
-        }
-        
-        // Find the least recently used entry
-        let lru_key = data.iter()
-            .min_by_key(|(_, entry)| entry.last_accessed)
-            .map(|(key, _)| key.clone());
-        
-        if let Some(key) = lru_key {
-            data.remove(&key);
-        }
+        self.data.insert(key, value);
     }
     
     /// Clear the cache
     pub fn clear(&self) {
-        if let Ok(mut data) = self.data.lock() {
-            data.clear();
-            
-            if let Ok(stats) = self.stats.lock() {
-                stats.size.store(0, Ordering::Relaxed);
-            }
-        }
+        self.data.clear();
     }
     
     /// Get cache statistics
-    pub fn stats(&self) -> CacheStats {
-        let stats = self.stats.lock().unwrap();
-        CacheStats {
-            hits: AtomicU64::new(stats.hits.load(Ordering::Relaxed)),
-            misses: AtomicU64::new(stats.misses.load(Ordering::Relaxed)),
-            size: AtomicUsize::new(stats.size.load(Ordering::Relaxed)),
-            max_size: stats.max_size,
-        }
+    pub fn stats(&self) -> ShardedCacheStats {
+        self.data.stats()
     }
 }
 
@@ -386,9 +432,16 @@ impl ThreadPool {
         
         for _ in 0..size {
             let receiver = Arc::clone(&receiver);
-            let worker = thread::spawn(move || {
-                while let Ok(job) = receiver.lock().unwrap().recv() {
-                    job();
+            let worker = thread::spawn(move || loop {
+                // Take the job in its own statement so the receiver lock is
+                // released before the job runs
+                let job = receiver.lock().unwrap().recv();
+                match job {
+                    Ok(job) => {
+                        // A panicking job must not take the worker down with it
+                        let _ = panic::catch_unwind(AssertUnwindSafe(job));
+                    }
+                    Err(_) => break,
                 }
             });
             workers.push(worker);
@@ -404,6 +457,177 @@ impl ThreadPool {
     {
         self.sender.send(Box::new(f)).unwrap();
     }
+
+    /// Run a blocking job on the pool and wait for its result without
+    /// holding up the async runtime. Returns None if the job panicked.
+    pub async fn run<F, R>(&self, f: F) -> Option<R>
+    where
+        F: FnOnce() -> R + Send + 'static,
+        R: Send + 'static,
+    {
+        let (sender, receiver) = tokio::sync::oneshot::channel();
+        self.execute(move || {
+            let _ = sender.send(f());
+        });
+        receiver.await.ok()
+    }
+}
+
+/// Queueing and run time counters for one command's blocking jobs
+#[derive(Debug)]
+struct CommandLane {
+    permits: Arc<tokio::sync::Semaphore>,
+    queued: AtomicUsize,
+    running: AtomicUsize,
+    completed: AtomicU64,
+    failed: AtomicU64,
+    total_wait_us: AtomicU64,
+    max_wait_us: AtomicU64,
+    total_run_us: AtomicU64,
+}
+
+impl CommandLane {
+    fn new(limit: usize) -> Self {
+        Self {
+            permits: Arc::new(tokio::sync::Semaphore::new(limit)),
+            queued: AtomicUsize::new(0),
+            running: AtomicUsize::new(0),
+            completed: AtomicU64::new(0),
+            failed: AtomicU64::new(0),
+            total_wait_us: AtomicU64::new(0),
+            max_wait_us: AtomicU64::new(0),
+            total_run_us: AtomicU64::new(0),
+        }
+    }
+}
+
+/// Snapshot of one command's blocking job counters
+#[derive(Debug, Clone, serde::Serialize, serde::Deserialize)]
+pub struct CommandLaneStats {
+    pub command: String,
+    pub max_concurrency: usize,
+    pub queued: usize,
+    pub running: usize,
+    pub completed: u64,
+    pub failed: u64,
+    pub average_wait_ms: f64,
+    pub max_wait_ms: f64,
+    pub average_run_ms: f64,
+}
+
+/// Runs blocking wallet calls on a dedicated thread pool so they never
+/// occupy an async runtime worker.
+///
+/// Each command gets its own concurrency limit; jobs over the limit wait
+/// asynchronously for a slot. Wait time counts from submission until the job
+/// starts on a pool thread, so it covers both the limit and the pool queue.
+#[derive(Debug)]
+pub struct BlockingExecutor {
+    pool: Arc<ThreadPool>,
+    default_limit: usize,
+    limits: HashMap<&'static str, usize>,
+    lanes: Mutex<HashMap<&'static str, Arc<CommandLane>>>,
+}
+
+impl BlockingExecutor {
+    /// Create an executor over pool; commands without an explicit limit may
+    /// run default_limit jobs at once
+    pub fn new(pool: Arc<ThreadPool>, default_limit: usize) -> Self {
+        Self {
+            pool,
+            default_limit: default_limit.max(1),
+            limits: HashMap::new(),
+            lanes: Mutex::new(HashMap::new()),
+        }
+    }
+
+    /// Cap how many jobs of command may run at once
+    pub fn with_limit(mut self, command: &'static str, limit: usize) -> Self {
+        self.limits.insert(command, limit.max(1));
+        self
+    }
+
+    fn lane(&self, command: &'static str) -> Arc<CommandLane> {
+        let mut lanes = self.lanes.lock().unwrap();
+        lanes
+            .entry(command)
+            .or_insert_with(|| {
+                let limit = self.limits.get(command).copied().unwrap_or(self.default_limit);
+                Arc::new(CommandLane::new(limit))
+            })
+            .clone()
+    }
+
+    /// Run job for command on the pool, waiting for a free slot first
+    pub async fn run<F, R>(&self, command: &'static str, job: F) -> Result<R, String>
+    where
+        F: FnOnce() -> Result<R, String> + Send + 'static,
+        R: Send + 'static,
+    {
+        let lane = self.lane(command);
+        let submitted = Instant::now();
+        lane.queued.fetch_add(1, Ordering::Relaxed);
+
+        let _permit = lane.permits.clone().acquire_owned().await.map_err(|e| e.to_string())?;
+
+        let job_lane = lane.clone();
+        let result = self
+            .pool
+            .run(move || {
+                let wait_us = submitted.elapsed().as_micros() as u64;
+                job_lane.queued.fetch_sub(1, Ordering::Relaxed);
+                job_lane.running.fetch_add(1, Ordering::Relaxed);
+                job_lane.total_wait_us.fetch_add(wait_us, Ordering::Relaxed);
+                job_lane.max_wait_us.fetch_max(wait_us, Ordering::Relaxed);
+
+                let started = Instant::now();
+                let result = panic::catch_unwind(AssertUnwindSafe(job));
+                job_lane.total_run_us.fetch_add(started.elapsed().as_micros() as u64, Ordering::Relaxed);
+                job_lane.running.fetch_sub(1, Ordering::Relaxed);
+                result
+            })
+            .await;
+
+        let result = match result {
+            Some(Ok(result)) => result,
+            _ => Err(format!("{} failed: blocking job panicked", command)),
+        };
+        if result.is_ok() {
+            lane.completed.fetch_add(1, Ordering::Relaxed);
+        } else {
+            lane.failed.fetch_add(1, Ordering::Relaxed);
+        }
+        result
+    }
+
+    /// Get per-command queueing metrics, busiest commands first
+    pub fn stats(&self) -> Vec<CommandLaneStats> {
+        let lanes = self.lanes.lock().unwrap();
+        let mut stats: Vec<CommandLaneStats> = lanes
+            .iter()
+            .map(|(command, lane)| {
+                let finished = lane.completed.load(Ordering::Relaxed) + lane.failed.load(Ordering::Relaxed);
+                let average_ms = |total_us: u64| {
+                    if finished > 0 { total_us as f64 / finished as f64 / 1000.0 } else { 0.0 }
+                };
+                CommandLaneStats {
+                    command: command.to_string(),
+                    max_concurrency: self.limits.get(command).copied().unwrap_or(self.default_limit),
+                    queued: lane.queued.load(Ordering::Relaxed),
+                    running: lane.running.load(Ordering::Relaxed),
+                    completed: lane.completed.load(Ordering::Relaxed),
+                    failed: lane.failed.load(Ordering::Relaxed),
+                    average_wait_ms: average_ms(lane.total_wait_us.load(Ordering::Relaxed)),
+                    max_wait_ms: lane.max_wait_us.load(Ordering::Relaxed) as f64 / 1000.0,
+                    average_run_ms: average_ms(lane.total_run_us.load(Ordering::Relaxed)),
+                }
+            })
+            .collect();
+        stats.sort_by(|a, b| {
+            (b.completed + b.failed).cmp(&(a.completed + a.failed)).then_with(|| a.command.cmp(&b.command))
+        });
+        stats
+    }
 }
 
 /// Performance profiler for operation timing
@@ -509,7 +733,7 @@ mod tests {
         let cache = AdvancedCache::new(10);
         
         cache.insert("key1", "value1");
-        assert_eq!(cache.get(&"key1"), Some("value1"));
+        assert_eq!(cache.get(&"key1").as_deref(), Some(&"value1"));
         assert_eq!(cache.get(&"key2"), None);
     }
     
@@ -525,6 +749,50 @@ mod tests {
         assert!(duration.unwrap() >= Duration::from_millis(10));
     }
     
+    #[test]
+    fn test_compute_limits() {
+        let memory_opt = MemoryOptimization {
+            max_cache_size: 100,
+            cache_cleanup_interval: Duration::from_secs(300),
+            memory_threshold: 100 << 20,
+            gc_interval: Duration::from_secs(60),
+            compression_enabled: false,
+            lazy_loading: false,
+        };
+        let cpu_opt = CPUOptimization {
+            max_threads: 4,
+            thread_pool_size: 4,
+            background_processing: true,
+            async_operations: true,
+            batch_processing: true,
+            priority_level: ThreadPriority::Normal,
+        };
+        let sample = ResourceSample {
+            cores: 8,
+            total_cpu_usage: 50.0,
+            process_cpu_usage: 200.0,
+            available_memory: 1 << 30,
+            on_battery: false,
+        };
+
+        // 4 cores busy, 2 of them with our own work: 6 idle, one kept for the UI
+        let limits = compute_limits(&cpu_opt, &memory_opt, &sample);
+        assert_eq!((limits.mining_threads, limits.rescan_workers), (5, 6));
+
+        let busy = ResourceSample { total_cpu_usage: 100.0, process_cpu_usage: 0.0, ..sample };
+        let limits = compute_limits(&cpu_opt, &memory_opt, &busy);
+        assert_eq!((limits.mining_threads, limits.rescan_workers), (0, 1));
+
+        let low_memory = ResourceSample { available_memory: 10 << 20, ..sample };
+        let limits = compute_limits(&cpu_opt, &memory_opt, &low_memory);
+        assert!(limits.memory_pressure);
+        assert_eq!((limits.mining_threads, limits.rescan_workers), (5, 1));
+
+        let battery = ResourceSample { on_battery: true, ..sample };
+        let limits = compute_limits(&cpu_opt, &memory_opt, &battery);
+        assert_eq!((limits.mining_threads, limits.rescan_workers), (0, 1));
+    }
+
     #[test]
     fn test_memory_pool() {
         let pool = MemoryPool::new(5);
@@ -536,4 +804,56 @@ mod tests {
         assert_eq!(item, Some("test_item"));
         assert_eq!(pool.size(), 0);
     }
+    #[test]
+    fn test_thread_pool_runs_jobs_concurrently() {
+        let pool = ThreadPool::new(2);
+        let barrier = Arc::new(std::sync::Barrier::new(3));
+
+        // Both jobs must be running at once for the barrier to open
+        for _ in 0..2 {
+            let barrier = barrier.clone();
+            pool.execute(move || {
+                barrier.wait();
+            });
+        }
+        barrier.wait();
+    }
+
+    #[tokio::test]
+    async fn test_blocking_executor_limits() {
+        let executor = Arc::new(BlockingExecutor::new(Arc::new(ThreadPool::new(4)), 4).with_limit("send", 1));
+        let running = Arc::new(AtomicUsize::new(0));
+        let peak = Arc::new(AtomicUsize::new(0));
+
+        let jobs: Vec<_> = (0..4)
+            .map(|_| {
+                let executor = executor.clone();
+                let running = running.clone();
+                let peak = peak.clone();
+                tokio::spawn(async move {
+                    executor
+                        .run("send", move || {
+                            peak.fetch_max(running.fetch_add(1, Ordering::SeqCst) + 1, Ordering::SeqCst);
+                            std::thread::sleep(Duration::from_millis(20));
+                            running.fetch_sub(1, Ordering::SeqCst);
+                            Ok(())
+                        })
+                        .await
+                })
+            })
+            .collect();
+        for job in jobs {
+            assert!(job.await.unwrap().is_ok());
+        }
+        assert_eq!(peak.load(Ordering::SeqCst), 1);
+
+        // A panicking job is reported as an error
+        assert!(executor.run("other", || -> Result<(), String> { panic!("job failed") }).await.is_err());
+
+        let stats = executor.stats();
+        assert_eq!(stats[0].command, "send");
+        assert_eq!(stats[0].completed, 4);
+        assert!(stats[0].max_wait_ms >= 20.0);
+        assert_eq!(stats[1].failed, 1);
+    }
 }
@@ -4,9 +4,15 @@
 //! Performance optimization module for Fuego Desktop Wallet
 
 use std::collections::HashMap;
-use std::sync::{Arc, Mutex};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
 use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
 use serde::{Deserialize, Serialize};
+use tokio::sync::{watch, Notify};
+
+mod sharded;
+
+pub use sharded::{json_weight, ShardedCache, ShardedCacheStats};
 
 /// Performance metrics
 #[derive(Debug, Clone, Serialize, Deserialize)]
@@ -44,58 +50,39 @@ impl Default for PerformanceConfig {
     }
 }
 
-/// Cache entry with TTL
-#[derive(Debug, Clone)]
-struct CacheEntry<T> {
-    data: T,
-    created_at: Instant,
-    ttl: Duration,
-}
-
-impl<T> CacheEntry<T> {
-    fn new(data: T, ttl: Duration) -> Self {
-        Self {
-            data,
-            created_at: Instant::now(),
-            ttl,
-        }
-    }
-    
-    fn is_expired(&self) -> bool {
-        self.created_at.elapsed() > self.ttl
-    }
-}
-
-/// High-performance cache with TTL support
+/// High-performance cache with TTL support, bounded by entry count or bytes
 #[derive(Debug)]
 pub struct Cache<T> {
-    data: Arc<Mutex<HashMap<String, CacheEntry<T>>>>,
+    entries: ShardedCache<String, T>,
     max_size: usize,
     default_ttl: Duration,
 }
 
-impl<T: Clone> Cache<T> {
+impl<T> Cache<T> {
     pub fn new(max_size: usize, default_ttl: Duration) -> Self {
         Self {
-            data: Arc::new(Mutex::new(HashMap::new())),
+            entries: ShardedCache::new(max_size),
             max_size,
             default_ttl,
         }
     }
+
+    /// Cache whose keys and values, as measured by weigher, take at most max_bytes
+    pub fn with_max_bytes(
+        max_bytes: usize,
+        default_ttl: Duration,
+        weigher: impl Fn(&T) -> usize + Send + Sync + 'static,
+    ) -> Self {
+        Self {
+            entries: ShardedCache::with_weigher(max_bytes, move |key: &String, value: &T| key.len() + weigher(value)),
+            max_size: max_bytes,
+            default_ttl,
+        }
+    }
     
     /// Get cached value
-    pub fn get(&self, key: &str) -> Option<T> {
-        let mut cache = self.data.lock().unwrap();
-        
-        if let Some(entry) = cache.get(key) {
-            if entry.is_expired() {
-                cache.remove(key);
-                return None;
-            }
-            Some(entry.data.clone())
-        } else {
-            None
-        }
+    pub fn get(&self, key: &str) -> Option<Arc<T>> {
+        self.entries.get(key)
     }
     
     /// Set cached value
@@ -105,52 +92,42 @@ impl<T: Clone> Cache<T> {
     
     /// Set cached value with custom TTL
     pub fn set_with_ttl(&self, key: String, value: T, ttl: Duration) {
-        let mut cache = self.data.lock().unwrap();
-        
-        // Remove expired entries
-        self.cleanup_expired(&mut cache);
-        
-        // Check size limit
-        if cache.len() >= self.max_size {
-            // Remove oldest entry
-            if let Some(oldest_key) = cache.keys().next().cloned() {
-                cache.remove(&oldest_key);
-            }
-        }
-        
-        cache.insert(key, CacheEntry::new(value, ttl));
+        self.entries.insert_shared(key, Arc::new(value), Some(ttl));
     }
     
     /// Remove cached value
     pub fn remove(&self, key: &str) {
-        let mut cache = self.data.lock().unwrap();
-        cache.remove(key);
+        self.entries.remove(key);
     }
     
     /// Clear all cached values
     pub fn clear(&self) {
-        let mut cache = self.data.lock().unwrap();
-        cache.clear();
+        self.entries.clear();
+    }
+
+    /// Drop expired entries without waiting for them to be looked up
+    pub fn purge_expired(&self) {
+        self.entries.purge_expired();
     }
     
     /// Get cache statistics
     pub fn stats(&self) -> CacheStats {
-        let cache = self.data.lock().unwrap();
-        let total_entries = cache.len();
-        let expired_entries = cache.values().filter(|entry| entry.is_expired()).count();
+        let (total_entries, expired_entries) = self.entries.count_entries();
+        let sharded = self.entries.stats();
         
         CacheStats {
             total_entries,
             expired_entries,
             active_entries: total_entries - expired_entries,
             max_size: self.max_size,
+            size: sharded.weight,
+            hits: sharded.hits,
+            misses: sharded.misses,
+            evictions: sharded.evictions,
+            rejections: sharded.rejections,
+            hit_rate: sharded.hit_rate,
         }
     }
-    
-    /// Cleanup expired entries
-    fn cleanup_expired(&self, cache: &mut HashMap<String, CacheEntry<T>>) {
-        cache.retain(|_, entry| !entry.is_expired());
-    }
 }
 
 /// Cache statistics
@@ -159,7 +136,141 @@ pub struct CacheStats {
     pub total_entries: usize,
     pub expired_entries: usize,
     pub active_entries: usize,
+    /// Limit on size, in entries or bytes depending on how the cache was built
     pub max_size: usize,
+    pub size: usize,
+    pub hits: u64,
+    pub misses: u64,
+    pub evictions: u64,
+    pub rejections: u64,
+    pub hit_rate: f64,
+}
+
+#[derive(Debug)]
+struct TipEntry<T> {
+    // tip epoch the value was computed against, entries of older epochs are never served
+    epoch: u64,
+    value: T,
+}
+
+/// Cache for responses that only change when the chain tip moves.
+///
+/// Entries have no TTL; the whole cache is dropped when the wallet reports a
+/// new sync or network height, so a repeated query within one block costs a
+/// single hash lookup.
+#[derive(Debug)]
+pub struct TipCache<T> {
+    entries: ShardedCache<String, TipEntry<T>>,
+    // (sync height, network height)
+    tip: Mutex<(u64, u64)>,
+    // bumped on every invalidation so values computed against an older tip
+    // are not served after the fact
+    epoch: AtomicU64,
+    max_size: usize,
+    hits: AtomicU64,
+    misses: AtomicU64,
+    invalidations: AtomicU64,
+}
+
+impl<T: Clone> TipCache<T> {
+    pub fn new(max_size: usize) -> Self {
+        Self {
+            entries: ShardedCache::new(max_size),
+            tip: Mutex::new((0, 0)),
+            epoch: AtomicU64::new(0),
+            max_size,
+            hits: AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+            invalidations: AtomicU64::new(0),
+        }
+    }
+
+    fn lookup(&self, key: &str, epoch: u64) -> Option<T> {
+        self.entries.get(key)
+            .filter(|entry| entry.epoch == epoch)
+            .map(|entry| entry.value.clone())
+    }
+
+    /// Get cached value; misses are counted by get_or_try_insert_with
+    pub fn get(&self, key: &str) -> Option<T> {
+        let value = self.lookup(key, self.epoch.load(Ordering::Acquire));
+        if value.is_some() {
+            self.hits.fetch_add(1, Ordering::Relaxed);
+        }
+        value
+    }
+
+    /// Return the cached value for key, or compute and cache it. Errors are
+    /// passed through and never cached.
+    pub fn get_or_try_insert_with<E>(&self, key: &str, compute: impl FnOnce() -> Result<T, E>) -> Result<T, E> {
+        let epoch = self.epoch.load(Ordering::Acquire);
+        if let Some(value) = self.lookup(key, epoch) {
+            self.hits.fetch_add(1, Ordering::Relaxed);
+            return Ok(value);
+        }
+        self.misses.fetch_add(1, Ordering::Relaxed);
+
+        // Computed without any lock held; wallet calls can be slow
+        let value = compute()?;
+
+        // Stored under the epoch it was computed in: after an invalidation it is just a miss
+        self.entries.insert(key.to_string(), TipEntry { epoch, value: value.clone() });
+        Ok(value)
+    }
+
+    /// Record the wallet's current tip, dropping every entry if it moved
+    pub fn advance_tip(&self, sync_height: u64, network_height: u64) {
+        let mut tip = self.tip.lock().unwrap();
+        if *tip != (sync_height, network_height) {
+            *tip = (sync_height, network_height);
+            self.invalidate();
+        }
+    }
+
+    /// Drop every entry, e.g. when a different wallet is opened
+    pub fn invalidate(&self) {
+        self.epoch.fetch_add(1, Ordering::AcqRel);
+        self.entries.clear();
+        self.invalidations.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Get cache statistics
+    pub fn stats(&self) -> TipCacheStats {
+        let (sync_height, network_height) = *self.tip.lock().unwrap();
+        let sharded = self.entries.stats();
+        let hits = self.hits.load(Ordering::Relaxed);
+        let misses = self.misses.load(Ordering::Relaxed);
+
+        TipCacheStats {
+            entries: sharded.entries,
+            max_size: self.max_size,
+            hits,
+            misses,
+            evictions: sharded.evictions,
+            invalidations: self.invalidations.load(Ordering::Relaxed),
+            hit_rate: if hits + misses > 0 {
+                hits as f64 / (hits + misses) as f64 * 100.0
+            } else {
+                0.0
+            },
+            sync_height,
+            network_height,
+        }
+    }
+}
+
+/// Tip cache statistics
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct TipCacheStats {
+    pub entries: usize,
+    pub max_size: usize,
+    pub hits: u64,
+    pub misses: u64,
+    pub evictions: u64,
+    pub invalidations: u64,
+    pub hit_rate: f64,
+    pub sync_height: u64,
+    pub network_height: u64,
 }
 
 /// Performance monitor for tracking operations
@@ -303,91 +414,173 @@ pub struct AveragePerformance {
     pub total_calls: usize,
 }
 
-/// Background task manager for performance optimization
-#[derive(Debug)]
-pub struct BackgroundTaskManager {
-    tasks: Arc<Mutex<HashMap<String, BackgroundTask>>>,
-}
+type TaskJob = Box<dyn Fn() + Send + Sync>;
 
-#[derive(Debug, Clone)]
-struct BackgroundTask {
+struct ScheduledTask {
     name: String,
     interval: Duration,
-    last_run: Instant,
-    enabled: bool,
+    // held back while the wallet syncs, every deadline and trigger in between becomes one run
+    defer_while_syncing: bool,
+    enabled: AtomicBool,
+    // set by trigger(); a wakeup without it is a stale permit of a run that already happened
+    triggered: AtomicBool,
+    wakeup: Notify,
+    runs: AtomicU64,
+    last_run: Mutex<Option<Instant>>,
+    next_run: Mutex<Option<Instant>>,
+    job: TaskJob,
+}
+
+impl std::fmt::Debug for ScheduledTask {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("ScheduledTask")
+            .field("name", &self.name)
+            .field("interval", &self.interval)
+            .finish()
+    }
 }
 
-impl BackgroundTaskManager {
+/// Runs background jobs on the tokio runtime.
+///
+/// A task sleeps until its interval (with ±10% jitter, so tasks registered together do not wake
+/// together) runs out or trigger() is called for it, e.g. from a wallet event, so an idle wallet
+/// costs no wakeups besides the timers. Jobs run on the blocking pool since they call into the
+/// wallet.
+#[derive(Debug)]
+pub struct TaskScheduler {
+    tasks: Mutex<HashMap<String, Arc<ScheduledTask>>>,
+    syncing: watch::Sender<bool>,
+    runtime: OnceLock<tokio::runtime::Handle>,
+}
+
+impl TaskScheduler {
     pub fn new() -> Self {
         Self {
-            tasks: Arc::new(Mutex::new(HashMap::new())),
+            tasks: Mutex::new(HashMap::new()),
+            syncing: watch::channel(false).0,
+            runtime: OnceLock::new(),
         }
     }
-    
-    /// Register a background task
-    pub fn register_task(&self, name: String, interval: Duration) {
-        let mut tasks = self.tasks.lock().unwrap();
-        tasks.insert(name.clone(), BackgroundTask {
-            name,
+
+    /// Register a task; it is scheduled once start() ran, right away if it already did
+    pub fn register_task(
+        &self,
+        name: &str,
+        interval: Duration,
+        defer_while_syncing: bool,
+        job: impl Fn() + Send + Sync + 'static,
+    ) {
+        let task = Arc::new(ScheduledTask {
+            name: name.to_string(),
             interval,
-            last_run: Instant::now(),
-            enabled: true,
+            defer_while_syncing,
+            enabled: AtomicBool::new(true),
+            triggered: AtomicBool::new(false),
+            wakeup: Notify::new(),
+            runs: AtomicU64::new(0),
+            last_run: Mutex::new(None),
+            next_run: Mutex::new(None),
+            job: Box::new(job),
         });
+        self.tasks.lock().unwrap().insert(name.to_string(), task.clone());
+
+        if let Some(runtime) = self.runtime.get() {
+            runtime.spawn(Self::run_task(task, self.syncing.subscribe()));
+        }
     }
-    
-    /// Check if task should run
-    pub fn should_run(&self, task_name: &str) -> bool {
-        let tasks = self.tasks.lock().unwrap();
-        
-        if let Some(task) = tasks.get(task_name) {
-            task.enabled && task.last_run.elapsed() >= task.interval
-        } else {
-            false
+
+    /// Schedule the registered tasks; must be called from within the tokio runtime
+    pub fn start(&self) {
+        if self.runtime.set(tokio::runtime::Handle::current()).is_err() {
+            return;
+        }
+        for task in self.tasks.lock().unwrap().values() {
+            tokio::spawn(Self::run_task(task.clone(), self.syncing.subscribe()));
         }
     }
-    
-    /// Mark task as completed
-    pub fn mark_completed(&self, task_name: &str) {
-        let mut tasks = self.tasks.lock().unwrap();
-        
-        if let Some(task) = tasks.get_mut(task_name) {
-            task.last_run = Instant::now();
+
+    /// Run task_name as soon as possible; triggers before it runs collapse into one run
+    pub fn trigger(&self, task_name: &str) {
+        if let Some(task) = self.tasks.lock().unwrap().get(task_name) {
+            task.triggered.store(true, Ordering::Release);
+            task.wakeup.notify_one();
         }
     }
-    
+
+    /// Tell the scheduler whether the wallet is syncing; deferred tasks wait for false
+    pub fn set_syncing(&self, syncing: bool) {
+        self.syncing.send_if_modified(|current| std::mem::replace(current, syncing) != syncing);
+    }
+
     /// Enable/disable task
     pub fn set_task_enabled(&self, task_name: &str, enabled: bool) {
-        let mut tasks = self.tasks.lock().unwrap();
-        
-        if let Some(task) = tasks.get_mut(task_name) {
-            task.enabled = enabled;
+        if let Some(task) = self.tasks.lock().unwrap().get(task_name) {
+            task.enabled.store(enabled, Ordering::Relaxed);
         }
     }
-    
+
     /// Get task status
     pub fn get_task_status(&self, task_name: &str) -> Option<TaskStatus> {
         let tasks = self.tasks.lock().unwrap();
-        
-        if let Some(task) = tasks.get(task_name) {
-            Some(TaskStatus {
-                name: task.name.clone(),
-                enabled: task.enabled,
-                last_run: task.last_run,
-                next_run_in: task.interval.saturating_sub(task.last_run.elapsed()),
-            })
-        } else {
-            None
+        let task = tasks.get(task_name)?;
+        let next_run = *task.next_run.lock().unwrap();
+
+        Some(TaskStatus {
+            name: task.name.clone(),
+            enabled: task.enabled.load(Ordering::Relaxed),
+            runs: task.runs.load(Ordering::Relaxed),
+            last_run: *task.last_run.lock().unwrap(),
+            next_run_in: next_run.map(|at| at.saturating_duration_since(Instant::now())),
+        })
+    }
+
+    async fn run_task(task: Arc<ScheduledTask>, mut syncing: watch::Receiver<bool>) {
+        loop {
+            let delay = jittered(task.interval);
+            *task.next_run.lock().unwrap() = Some(Instant::now() + delay);
+            let woken = tokio::select! {
+                _ = tokio::time::sleep(delay) => false,
+                _ = task.wakeup.notified() => true,
+            };
+            if woken && !task.triggered.load(Ordering::Acquire) {
+                continue;
+            }
+            if !task.enabled.load(Ordering::Relaxed) {
+                task.triggered.store(false, Ordering::Release);
+                continue;
+            }
+
+            if task.defer_while_syncing {
+                *task.next_run.lock().unwrap() = None;
+                if syncing.wait_for(|syncing| !*syncing).await.is_err() {
+                    return;
+                }
+            }
+
+            task.triggered.store(false, Ordering::Release);
+            let job = task.clone();
+            if tokio::task::spawn_blocking(move || (job.job)()).await.is_err() {
+                log::warn!("Background task {} panicked", task.name);
+            }
+            task.runs.fetch_add(1, Ordering::Relaxed);
+            *task.last_run.lock().unwrap() = Some(Instant::now());
         }
     }
 }
 
+fn jittered(interval: Duration) -> Duration {
+    interval.mul_f64(0.9 + rand::random::<f64>() * 0.2)
+}
+
 /// Task status information
 #[derive(Debug, Clone)]
 pub struct TaskStatus {
     pub name: String,
     pub enabled: bool,
-    pub last_run: Instant,
-    pub next_run_in: Duration,
+    pub runs: u64,
+    pub last_run: Option<Instant>,
+    /// None while the task waits for a sync to finish
+    pub next_run_in: Option<Duration>,
 }
 
 /// Batch processor for efficient data handling
@@ -441,7 +634,7 @@ mod tests {
         
         // Test set and get
         cache.set("key1".to_string(), "value1".to_string());
-        assert_eq!(cache.get("key1"), Some("value1".to_string()));
+        assert_eq!(cache.get("key1").as_deref(), Some(&"value1".to_string()));
         
         // Test expiration
         thread::sleep(Duration::from_millis(1100));
@@ -476,4 +669,68 @@ mod tests {
         assert_eq!(processor.add_item(5), None);
         assert_eq!(processor.add_item(6), Some(vec![4, 5, 6]));
     }
+
+    #[tokio::test]
+    async fn test_task_scheduler_coalesces_while_syncing() {
+        let scheduler = TaskScheduler::new();
+        let runs = Arc::new(AtomicU64::new(0));
+        let counter = runs.clone();
+        scheduler.register_task("refresh", Duration::from_secs(3600), true, move || {
+            counter.fetch_add(1, Ordering::SeqCst);
+        });
+        scheduler.start();
+        let settle = || tokio::time::sleep(Duration::from_millis(50));
+
+        scheduler.trigger("refresh");
+        settle().await;
+        assert_eq!(runs.load(Ordering::SeqCst), 1);
+
+        // Triggers during a sync become one run once it completes
+        scheduler.set_syncing(true);
+        for _ in 0..3 {
+            scheduler.trigger("refresh");
+            settle().await;
+        }
+        assert_eq!(runs.load(Ordering::SeqCst), 1);
+        assert_eq!(scheduler.get_task_status("refresh").unwrap().next_run_in, None);
+        scheduler.set_syncing(false);
+        settle().await;
+        settle().await;
+        assert_eq!(runs.load(Ordering::SeqCst), 2);
+
+        scheduler.set_task_enabled("refresh", false);
+        scheduler.trigger("refresh");
+        settle().await;
+        let status = scheduler.get_task_status("refresh").unwrap();
+        assert_eq!(status.runs, 2);
+        assert!(status.next_run_in.unwrap() > Duration::from_secs(3000));
+    }
+
+    #[test]
+    fn test_tip_cache() {
+        let cache = TipCache::new(10);
+        let load = |value: u64| -> Result<u64, String> { Ok(value) };
+
+        // Cached until the tip moves
+        cache.advance_tip(10, 20);
+        assert_eq!(cache.get_or_try_insert_with("key1", || load(1)), Ok(1));
+        assert_eq!(cache.get_or_try_insert_with("key1", || load(2)), Ok(1));
+        cache.advance_tip(10, 20);
+        assert_eq!(cache.get_or_try_insert_with("key1", || load(2)), Ok(1));
+        cache.advance_tip(11, 20);
+        assert_eq!(cache.get_or_try_insert_with("key1", || load(3)), Ok(3));
+
+        // Errors are not cached
+        assert!(cache.get_or_try_insert_with("key2", || Err::<u64, _>("failed".to_string())).is_err());
+        assert_eq!(cache.get_or_try_insert_with("key2", || load(4)), Ok(4));
+
+        // A value computed across an invalidation is returned but not stored
+        assert_eq!(cache.get_or_try_insert_with("key3", || { cache.invalidate(); load(5) }), Ok(5));
+        assert_eq!(cache.get_or_try_insert_with("key3", || load(6)), Ok(6));
+
+        let stats = cache.stats();
+        assert_eq!(stats.hits, 2);
+        assert_eq!(stats.misses, 6);
+        assert_eq!(stats.sync_height, 11);
+    }
 }
@@ -0,0 +1,479 @@
+use std::borrow::Borrow;
+use std::collections::hash_map::RandomState;
+use std::collections::HashMap;
+use std::fmt;
+use std::hash::{BuildHasher, Hash};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, MutexGuard};
+use std::time::{Duration, Instant};
+
+use serde::{Deserialize, Serialize};
+
+const NIL: usize = usize::MAX;
+const MAX_SHARDS: usize = 64;
+/// Fewer entries than this per shard and eviction gets too coarse to be worth the striping
+const MIN_ENTRIES_PER_SHARD: usize = 16;
+/// Expected entry size when only a byte limit is given, sizes the frequency sketch
+const TYPICAL_ENTRY_BYTES: usize = 512;
+const SKETCH_ROWS: usize = 4;
+const SKETCH_SEEDS: [u64; SKETCH_ROWS] = [
+    0x9E37_79B9_7F4A_7C15,
+    0xC2B2_AE3D_27D4_EB4F,
+    0x1656_67B1_9E37_79F9,
+    0x27D4_EB2F_1656_67C5,
+];
+
+type Weigher<K, V> = Box<dyn Fn(&K, &V) -> usize + Send + Sync>;
+
+/// Approximate access counts for TinyLFU admission: a count-min sketch of saturating 4-bit
+/// counters that are halved every 10 × width increments, so old popularity fades.
+struct FrequencySketch {
+    rows: Vec<u8>,
+    width_mask: usize,
+    additions: usize,
+    reset_at: usize,
+}
+
+impl FrequencySketch {
+    fn new(expected_entries: usize) -> Self {
+        let width = expected_entries.max(16).next_power_of_two();
+        Self {
+            rows: vec![0; width * SKETCH_ROWS],
+            width_mask: width - 1,
+            additions: 0,
+            reset_at: width * 10,
+        }
+    }
+
+    fn slot(&self, hash: u64, row: usize) -> usize {
+        let mixed = (hash ^ SKETCH_SEEDS[row]).wrapping_mul(SKETCH_SEEDS[row]);
+        row * (self.width_mask + 1) + ((mixed >> 32) as usize & self.width_mask)
+    }
+
+    fn increment(&mut self, hash: u64) {
+        for row in 0..SKETCH_ROWS {
+            let slot = self.slot(hash, row);
+            if self.rows[slot] < 15 {
+                self.rows[slot] += 1;
+            }
+        }
+
+        self.additions += 1;
+        if self.additions >= self.reset_at {
+            for counter in self.rows.iter_mut() {
+                *counter /= 2;
+            }
+            self.additions /= 2;
+        }
+    }
+
+    fn frequency(&self, hash: u64) -> u8 {
+        (0..SKETCH_ROWS).map(|row| self.rows[self.slot(hash, row)]).min().unwrap_or(0)
+    }
+}
+
+struct Node<K, V> {
+    key: K,
+    value: Arc<V>,
+    hash: u64,
+    weight: usize,
+    expires_at: Option<Instant>,
+    prev: usize,
+    next: usize,
+}
+
+/// One lock stripe: a hash index into a slab of nodes linked most to least recently used
+struct Shard<K, V> {
+    index: HashMap<K, usize>,
+    nodes: Vec<Option<Node<K, V>>>,
+    free: Vec<usize>,
+    head: usize,
+    tail: usize,
+    weight: usize,
+    max_weight: usize,
+    sketch: FrequencySketch,
+}
+
+impl<K: Hash + Eq + Clone, V> Shard<K, V> {
+    fn new(max_weight: usize, expected_entries: usize) -> Self {
+        Self {
+            index: HashMap::new(),
+            nodes: Vec::new(),
+            free: Vec::new(),
+            head: NIL,
+            tail: NIL,
+            weight: 0,
+            max_weight,
+            sketch: FrequencySketch::new(expected_entries),
+        }
+    }
+
+    fn node(&self, slot: usize) -> &Node<K, V> {
+        self.nodes[slot].as_ref().expect("linked slot holds a node")
+    }
+
+    fn node_mut(&mut self, slot: usize) -> &mut Node<K, V> {
+        self.nodes[slot].as_mut().expect("linked slot holds a node")
+    }
+
+    fn unlink(&mut self, slot: usize) {
+        let (prev, next) = {
+            let node = self.node(slot);
+            (node.prev, node.next)
+        };
+        if prev == NIL {
+            self.head = next;
+        } else {
+            self.node_mut(prev).next = next;
+        }
+        if next == NIL {
+            self.tail = prev;
+        } else {
+            self.node_mut(next).prev = prev;
+        }
+    }
+
+    fn push_front(&mut self, slot: usize) {
+        let head = self.head;
+        {
+            let node = self.node_mut(slot);
+            node.prev = NIL;
+            node.next = head;
+        }
+        if head == NIL {
+            self.tail = slot;
+        } else {
+            self.node_mut(head).prev = slot;
+        }
+        self.head = slot;
+    }
+
+    fn touch(&mut self, slot: usize) {
+        if self.head != slot {
+            self.unlink(slot);
+            self.push_front(slot);
+        }
+    }
+
+    fn remove_slot(&mut self, slot: usize) -> Node<K, V> {
+        self.unlink(slot);
+        let node = self.nodes[slot].take().expect("linked slot holds a node");
+        self.free.push(slot);
+        self.index.remove(&node.key);
+        self.weight -= node.weight;
+        node
+    }
+
+    fn insert_node(&mut self, node: Node<K, V>) {
+        let key = node.key.clone();
+        self.weight += node.weight;
+        let slot = match self.free.pop() {
+            Some(slot) => {
+                self.nodes[slot] = Some(node);
+                slot
+            }
+            None => {
+                self.nodes.push(Some(node));
+                self.nodes.len() - 1
+            }
+        };
+        self.push_front(slot);
+        self.index.insert(key, slot);
+    }
+
+    fn clear(&mut self) {
+        self.index.clear();
+        self.nodes.clear();
+        self.free.clear();
+        self.head = NIL;
+        self.tail = NIL;
+        self.weight = 0;
+    }
+}
+
+/// Concurrent cache bounded by total weight (bytes, or entries with the default weigher).
+///
+/// Keys are spread over independently locked shards, so concurrent commands only contend when
+/// they hit the same stripe. Each shard keeps an O(1) LRU list; when an insert needs room, the
+/// least recently used entry is only evicted if the newcomer has been asked for at least as often
+/// (TinyLFU admission), so a burst of one-off keys cannot flush the entries that keep getting hit.
+/// Values are shared as `Arc`s, a hit never clones the value.
+pub struct ShardedCache<K, V> {
+    shards: Box<[Mutex<Shard<K, V>>]>,
+    hasher: RandomState,
+    max_weight: usize,
+    weigher: Weigher<K, V>,
+    hits: AtomicU64,
+    misses: AtomicU64,
+    evictions: AtomicU64,
+    rejections: AtomicU64,
+}
+
+impl<K, V> fmt::Debug for ShardedCache<K, V> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("ShardedCache")
+            .field("shards", &self.shards.len())
+            .field("max_weight", &self.max_weight)
+            .finish()
+    }
+}
+
+impl<K: Hash + Eq + Clone, V> ShardedCache<K, V> {
+    /// Cache holding at most max_entries entries
+    pub fn new(max_entries: usize) -> Self {
+        Self::build(max_entries, max_entries, Box::new(|_, _| 1))
+    }
+
+    /// Cache whose entries, as measured by weigher, add up to at most max_bytes
+    pub fn with_weigher(max_bytes: usize, weigher: impl Fn(&K, &V) -> usize + Send + Sync + 'static) -> Self {
+        Self::build(max_bytes, max_bytes / TYPICAL_ENTRY_BYTES, Box::new(weigher))
+    }
+
+    fn build(max_weight: usize, expected_entries: usize, weigher: Weigher<K, V>) -> Self {
+        let cores = std::thread::available_parallelism().map(|n| n.get()).unwrap_or(1);
+        let shard_count = (cores * 4)
+            .min(expected_entries / MIN_ENTRIES_PER_SHARD)
+            .clamp(1, MAX_SHARDS)
+            .next_power_of_two();
+        let shard_weight = (max_weight + shard_count - 1) / shard_count;
+        let shard_entries = (expected_entries + shard_count - 1) / shard_count;
+
+        Self {
+            shards: (0..shard_count)
+                .map(|_| Mutex::new(Shard::new(shard_weight, shard_entries)))
+                .collect(),
+            hasher: RandomState::new(),
+            max_weight,
+            weigher,
+            hits: AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+            evictions: AtomicU64::new(0),
+            rejections: AtomicU64::new(0),
+        }
+    }
+
+    fn shard_for<Q: Hash + ?Sized>(&self, key: &Q) -> (u64, MutexGuard<'_, Shard<K, V>>) {
+        let hash = self.hasher.hash_one(key);
+        // The top bits pick the shard, the sketch uses the whole hash
+        let shard = (hash >> 58) as usize & (self.shards.len() - 1);
+        let guard = self.shards[shard].lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+        (hash, guard)
+    }
+
+    /// Get a shared handle to the value, refreshing its recency
+    pub fn get<Q>(&self, key: &Q) -> Option<Arc<V>>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        let (hash, mut shard) = self.shard_for(key);
+        shard.sketch.increment(hash);
+
+        let found = shard.index.get(key).copied();
+        let value = found.and_then(|slot| {
+            if shard.node(slot).expires_at.map_or(false, |at| at <= Instant::now()) {
+                shard.remove_slot(slot);
+                return None;
+            }
+            shard.touch(slot);
+            Some(shard.node(slot).value.clone())
+        });
+
+        let counter = if value.is_some() { &self.hits } else { &self.misses };
+        counter.fetch_add(1, Ordering::Relaxed);
+        value
+    }
+
+    /// Insert or replace a value; returns false when admission kept it out
+    pub fn insert(&self, key: K, value: V) -> bool {
+        self.insert_shared(key, Arc::new(value), None)
+    }
+
+    /// Insert an already shared value, expiring after ttl if one is given
+    pub fn insert_shared(&self, key: K, value: Arc<V>, ttl: Option<Duration>) -> bool {
+        let weight = (self.weigher)(&key, &value);
+        let expires_at = ttl.map(|ttl| Instant::now() + ttl);
+        let (hash, mut shard) = self.shard_for(&key);
+
+        if let Some(slot) = shard.index.get(&key).copied() {
+            shard.remove_slot(slot);
+        }
+        if weight > shard.max_weight {
+            self.rejections.fetch_add(1, Ordering::Relaxed);
+            return false;
+        }
+
+        let candidate_frequency = shard.sketch.frequency(hash);
+        while shard.weight + weight > shard.max_weight {
+            let victim = shard.tail;
+            let victim_node = shard.node(victim);
+            let expired = victim_node.expires_at.map_or(false, |at| at <= Instant::now());
+            if !expired && shard.sketch.frequency(victim_node.hash) > candidate_frequency {
+                self.rejections.fetch_add(1, Ordering::Relaxed);
+                return false;
+            }
+            shard.remove_slot(victim);
+            self.evictions.fetch_add(1, Ordering::Relaxed);
+        }
+
+        shard.insert_node(Node { key, value, hash, weight, expires_at, prev: NIL, next: NIL });
+        true
+    }
+
+    /// Remove a value, returning it if it was cached
+    pub fn remove<Q>(&self, key: &Q) -> Option<Arc<V>>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        let (_, mut shard) = self.shard_for(key);
+        let slot = shard.index.get(key).copied()?;
+        Some(shard.remove_slot(slot).value)
+    }
+
+    /// Remove every entry; access frequencies are kept
+    pub fn clear(&self) {
+        for shard in self.shards.iter() {
+            shard.lock().unwrap_or_else(|poisoned| poisoned.into_inner()).clear();
+        }
+    }
+
+    /// Remove expired entries, returns how many there were
+    pub fn purge_expired(&self) -> usize {
+        let now = Instant::now();
+        let mut purged = 0;
+        for shard in self.shards.iter() {
+            let mut shard = shard.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+            let expired: Vec<usize> = shard.index.values().copied()
+                .filter(|slot| shard.node(*slot).expires_at.map_or(false, |at| at <= now))
+                .collect();
+            purged += expired.len();
+            for slot in expired {
+                shard.remove_slot(slot);
+            }
+        }
+        purged
+    }
+
+    /// Count entries, and those already expired but not yet dropped
+    pub fn count_entries(&self) -> (usize, usize) {
+        let now = Instant::now();
+        self.shards.iter().fold((0, 0), |(total, expired), shard| {
+            let shard = shard.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+            let shard_expired = shard.index.values()
+                .filter(|slot| shard.node(**slot).expires_at.map_or(false, |at| at <= now))
+                .count();
+            (total + shard.index.len(), expired + shard_expired)
+        })
+    }
+
+    pub fn stats(&self) -> ShardedCacheStats {
+        let (entries, weight) = self.shards.iter().fold((0, 0), |(entries, weight), shard| {
+            let shard = shard.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+            (entries + shard.index.len(), weight + shard.weight)
+        });
+        let hits = self.hits.load(Ordering::Relaxed);
+        let misses = self.misses.load(Ordering::Relaxed);
+
+        ShardedCacheStats {
+            entries,
+            weight,
+            max_weight: self.max_weight,
+            shards: self.shards.len(),
+            hits,
+            misses,
+            evictions: self.evictions.load(Ordering::Relaxed),
+            rejections: self.rejections.load(Ordering::Relaxed),
+            hit_rate: if hits + misses > 0 {
+                hits as f64 / (hits + misses) as f64 * 100.0
+            } else {
+                0.0
+            },
+        }
+    }
+}
+
+/// Sharded cache statistics
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct ShardedCacheStats {
+    pub entries: usize,
+    /// Bytes, or entries when the cache is bounded by count
+    pub weight: usize,
+    pub max_weight: usize,
+    pub shards: usize,
+    pub hits: u64,
+    pub misses: u64,
+    pub evictions: u64,
+    /// Inserts kept out by admission or because they alone exceed a shard
+    pub rejections: u64,
+    pub hit_rate: f64,
+}
+
+/// Approximate heap size of a JSON value, for byte-bounded caches of command responses
+pub fn json_weight(value: &serde_json::Value) -> usize {
+    use serde_json::Value;
+    std::mem::size_of::<Value>() + match value {
+        Value::String(s) => s.len(),
+        Value::Array(items) => items.iter().map(json_weight).sum(),
+        Value::Object(fields) => fields.iter().map(|(k, v)| k.len() + json_weight(v)).sum(),
+        _ => 0,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_lru_eviction() {
+        let cache = ShardedCache::new(3);
+        for key in 0..3 {
+            assert!(cache.insert(key, key * 10));
+        }
+        // Same access count everywhere, so plain LRU decides
+        for key in [0, 2, 1] {
+            cache.get(&key);
+        }
+        cache.get(&3);
+        assert!(cache.insert(3, 30));
+        assert!(cache.get(&0).is_none());
+        assert_eq!(cache.get(&1).as_deref(), Some(&10));
+
+        let stats = cache.stats();
+        assert_eq!(stats.entries, 3);
+        assert_eq!(stats.evictions, 1);
+    }
+
+    #[test]
+    fn test_admission_keeps_hot_entries() {
+        let cache = ShardedCache::new(2);
+        cache.insert("hot", 1);
+        cache.insert("warm", 2);
+        for _ in 0..5 {
+            cache.get("hot");
+            cache.get("warm");
+        }
+
+        // Seen once, colder than either resident
+        assert!(!cache.insert("scan", 3));
+        assert!(cache.get("hot").is_some() && cache.get("warm").is_some());
+        assert_eq!(cache.stats().rejections, 1);
+    }
+
+    #[test]
+    fn test_weight_limit_and_ttl() {
+        let cache: ShardedCache<String, String> = ShardedCache::with_weigher(64, |k: &String, v: &String| k.len() + v.len());
+        assert!(cache.insert("a".to_string(), "x".repeat(40)));
+        assert!(!cache.insert("b".to_string(), "x".repeat(100)));
+
+        let shared = Arc::new("y".repeat(10));
+        assert!(cache.insert_shared("c".to_string(), shared.clone(), Some(Duration::from_millis(0))));
+        assert!(Arc::ptr_eq(&cache.remove("c").unwrap(), &shared));
+
+        cache.insert_shared("d".to_string(), shared, Some(Duration::from_millis(0)));
+        assert_eq!(cache.count_entries(), (2, 1));
+        assert_eq!(cache.purge_expired(), 1);
+        assert!(cache.get("d").is_none());
+        assert_eq!(cache.stats().weight, 41);
+    }
+}
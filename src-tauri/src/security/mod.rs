@@ -7,6 +7,7 @@ use std::collections::HashMap;
 use std::sync::{Arc, Mutex};
 use std::time::{SystemTime, UNIX_EPOCH};
 use serde::{Deserialize, Serialize};
+use zeroize::Zeroizing;
 
 /// Security configuration
 #[derive(Debug, Clone, Serialize, Deserialize)]
@@ -39,12 +40,29 @@ pub struct UserSession {
     pub is_locked: bool,
 }
 
+/// Keys an unlocked session derived from its password, by Argon2 salt. Blobs encrypted in the
+/// session all use its own salt, so after login each one is a single AEAD operation.
+struct SessionKeys {
+    salt: String,
+    keys: HashMap<String, Zeroizing<[u8; 32]>>,
+}
+
+/// Other salts are cached for blobs from earlier sessions, but only this many
+const MAX_SESSION_KEYS: usize = 32;
+
+impl std::fmt::Debug for SessionKeys {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("SessionKeys").field("salt", &self.salt).field("keys", &self.keys.len()).finish()
+    }
+}
+
 /// Security manager for handling authentication and session management
 #[derive(Debug)]
 pub struct SecurityManager {
     config: SecurityConfig,
     sessions: Arc<Mutex<HashMap<String, UserSession>>>,
     failed_attempts: Arc<Mutex<HashMap<String, (u32, u64)>>>, // (attempts, last_attempt_time)
+    session_keys: Arc<Mutex<HashMap<String, SessionKeys>>>, // dropped, and so zeroized, on lock and logout
 }
 
 impl SecurityManager {
@@ -53,6 +71,7 @@ impl SecurityManager {
             config,
             sessions: Arc::new(Mutex::new(HashMap::new())),
             failed_attempts: Arc::new(Mutex::new(HashMap::new())),
+            session_keys: Arc::new(Mutex::new(HashMap::new())),
         }
     }
 
@@ -70,6 +89,7 @@ impl SecurityManager {
             
             // Create session
             let session_id = self.create_session(user_id);
+            self.derive_session_key(&session_id, password)?;
             Ok(session_id)
         } else {
             // Record failed attempt
@@ -117,6 +137,7 @@ impl SecurityManager {
         
         if let Some(session) = sessions.get_mut(session_id) {
             session.is_locked = true;
+            self.session_keys.lock().unwrap().remove(session_id);
             Ok(())
         } else {
             Err("Session not found".to_string())
@@ -129,21 +150,76 @@ impl SecurityManager {
             return Err("Invalid password".to_string());
         }
 
-        let mut sessions = self.sessions.lock().unwrap();
-        
-        if let Some(session) = sessions.get_mut(session_id) {
-            session.is_locked = false;
-            session.last_activity = SystemTime::now().duration_since(UNIX_EPOCH).unwrap().as_secs();
-            Ok(())
-        } else {
-            Err("Session not found".to_string())
+        {
+            let mut sessions = self.sessions.lock().unwrap();
+            
+            if let Some(session) = sessions.get_mut(session_id) {
+                session.is_locked = false;
+                session.last_activity = SystemTime::now().duration_since(UNIX_EPOCH).unwrap().as_secs();
+            } else {
+                return Err("Session not found".to_string());
+            }
         }
+
+        self.derive_session_key(session_id, password)
     }
 
     /// Logout and destroy session
     pub fn logout(&self, session_id: &str) -> Result<(), String> {
         let mut sessions = self.sessions.lock().unwrap();
         sessions.remove(session_id);
+        self.session_keys.lock().unwrap().remove(session_id);
+        Ok(())
+    }
+
+    /// Encrypt with the key the session derived at login, in the same format as `WalletEncryption::encrypt_data`
+    pub fn encrypt_with_session(&self, session_id: &str, data: &str) -> Result<String, String> {
+        self.validate_session(session_id)?;
+
+        let session_keys = self.session_keys.lock().unwrap();
+        let keys = session_keys.get(session_id).ok_or("Session has no encryption key")?;
+        WalletEncryption::seal(&keys.keys[&keys.salt], &keys.salt, data)
+    }
+
+    /// Decrypt with a key the session already derived. Data from another session needs `password`
+    /// once, after which its key is kept for the rest of this session.
+    pub fn decrypt_with_session(&self, session_id: &str, encrypted_data: &str, password: Option<&str>) -> Result<String, String> {
+        self.validate_session(session_id)?;
+
+        let blob = EncryptedBlob::parse(encrypted_data)?;
+        {
+            let session_keys = self.session_keys.lock().unwrap();
+            let keys = session_keys.get(session_id).ok_or("Session has no encryption key")?;
+            if let Some(key) = keys.keys.get(&blob.salt) {
+                return WalletEncryption::open(key, &blob);
+            }
+        }
+
+        // Argon2 runs without the lock held, other sessions keep working meanwhile
+        let password = password.ok_or("Data was encrypted in another session, the password is required")?;
+        let key = WalletEncryption::derive_key(password, &blob.salt)?;
+        let plaintext = WalletEncryption::open(&key, &blob)?;
+
+        let mut session_keys = self.session_keys.lock().unwrap();
+        if let Some(keys) = session_keys.get_mut(session_id) {
+            if keys.keys.len() < MAX_SESSION_KEYS {
+                keys.keys.insert(blob.salt, key);
+            }
+        }
+        Ok(plaintext)
+    }
+
+    /// Run Argon2 once for the session, with a fresh salt its blobs will share
+    fn derive_session_key(&self, session_id: &str, password: &str) -> Result<(), String> {
+        use argon2::password_hash::SaltString;
+        use aes_gcm::aead::OsRng;
+
+        let salt = SaltString::generate(&mut OsRng).as_str().to_string();
+        let key = WalletEncryption::derive_key(password, &salt)?;
+
+        let mut keys = HashMap::new();
+        keys.insert(salt.clone(), key);
+        self.session_keys.lock().unwrap().insert(session_id.to_string(), SessionKeys { salt, keys });
         Ok(())
     }
 
@@ -253,28 +329,73 @@ impl PasswordValidator {
     }
 }
 
+/// Parts of an encrypted blob: Argon2 salt, AES-GCM nonce and ciphertext
+struct EncryptedBlob {
+    salt: String,
+    nonce: Vec<u8>,
+    ciphertext: Vec<u8>,
+}
+
+impl EncryptedBlob {
+    fn parse(encrypted_data: &str) -> Result<Self, String> {
+        use base64::{Engine as _, engine::general_purpose};
+
+        let v: serde_json::Value = serde_json::from_str(encrypted_data).map_err(|e| format!("JSON error: {}", e))?;
+        let s = v.get("s").and_then(|x| x.as_str()).ok_or("Missing salt")?;
+        let n_b64 = v.get("n").and_then(|x| x.as_str()).ok_or("Missing nonce")?;
+        let c_b64 = v.get("c").and_then(|x| x.as_str()).ok_or("Missing ciphertext")?;
+
+        let nonce = general_purpose::STANDARD.decode(n_b64).map_err(|e| format!("Nonce decode: {}", e))?;
+        if nonce.len() != 12 {
+            return Err("Nonce decode: invalid length".to_string());
+        }
+        let ciphertext = general_purpose::STANDARD.decode(c_b64).map_err(|e| format!("Ciphertext decode: {}", e))?;
+        Ok(Self { salt: s.to_string(), nonce, ciphertext })
+    }
+}
+
 /// Wallet encryption utilities
 pub struct WalletEncryption;
 
 impl WalletEncryption {
     /// Encrypt sensitive data with AES-256-GCM using Argon2-derived key
     pub fn encrypt_data(data: &str, password: &str) -> Result<String, String> {
-        use aes_gcm::{Aes256Gcm, Key, Nonce, KeyInit};
-        use aes_gcm::aead::{Aead, OsRng};
-        use rand::RngCore;
-        use argon2::{Argon2, PasswordHasher};
-        use argon2::password_hash::{SaltString, PasswordHasher as _};
-        use base64::{Engine as _, engine::general_purpose};
+        use argon2::password_hash::SaltString;
+        use aes_gcm::aead::OsRng;
 
-        // Derive key with Argon2id
         let salt = SaltString::generate(&mut OsRng);
+        let key = Self::derive_key(password, salt.as_str())?;
+        Self::seal(&key, salt.as_str(), data)
+    }
+    
+    /// Decrypt sensitive data with AES-256-GCM using Argon2-derived key
+    pub fn decrypt_data(encrypted_data: &str, password: &str) -> Result<String, String> {
+        let blob = EncryptedBlob::parse(encrypted_data)?;
+        let key = Self::derive_key(password, &blob.salt)?;
+        Self::open(&key, &blob)
+    }
+
+    /// Derive the AES key for `salt` with Argon2id, the expensive part of every blob without a session
+    fn derive_key(password: &str, salt: &str) -> Result<Zeroizing<[u8; 32]>, String> {
+        use argon2::{Argon2, PasswordHasher};
+        use argon2::password_hash::SaltString;
+
+        let salt = SaltString::from_b64(salt).map_err(|e| format!("Salt error: {}", e))?;
         let argon2 = Argon2::default();
         let hash = argon2.hash_password(password.as_bytes(), &salt)
             .map_err(|e| format!("Argon2 error: {}", e))?;
         // Use the hash bytes (truncate/expand) for 32-byte key
-        let key_bytes = blake3::hash(hash.hash.ok_or("Missing Argon2 hash")?.as_bytes()).as_bytes().clone();
-        let key = Key::<Aes256Gcm>::from_slice(&key_bytes);
-        let cipher = Aes256Gcm::new(key);
+        Ok(Zeroizing::new(*blake3::hash(hash.hash.ok_or("Missing Argon2 hash")?.as_bytes()).as_bytes()))
+    }
+
+    /// Pack salt | nonce | ciphertext (all base64)
+    fn seal(key: &[u8; 32], salt: &str, data: &str) -> Result<String, String> {
+        use aes_gcm::{Aes256Gcm, Key, Nonce, KeyInit};
+        use aes_gcm::aead::{Aead, OsRng};
+        use rand::RngCore;
+        use base64::{Engine as _, engine::general_purpose};
+
+        let cipher = Aes256Gcm::new(Key::<Aes256Gcm>::from_slice(key));
 
         // Random nonce
         let mut nonce_bytes = [0u8; 12];
@@ -284,41 +405,21 @@ impl WalletEncryption {
         let ciphertext = cipher.encrypt(nonce, data.as_bytes())
             .map_err(|e| format!("Encrypt error: {}", e))?;
 
-        // Pack salt | nonce | ciphertext (all base64)
         let out = serde_json::json!({
-            "s": salt.as_str(),
+            "s": salt,
             "n": general_purpose::STANDARD.encode(nonce_bytes),
             "c": general_purpose::STANDARD.encode(ciphertext),
         });
         Ok(out.to_string())
     }
-    
-    /// Decrypt sensitive data with AES-256-GCM using Argon2-derived key
-    pub fn decrypt_data(encrypted_data: &str, password: &str) -> Result<String, String> {
-        use aes_gcm::{Aes256Gcm, Key, Nonce, KeyInit};
-        use aes_gcm::aead::{Aead};
-        use argon2::{Argon2, PasswordHasher};
-        use argon2::password_hash::{SaltString, PasswordHasher as _};
-        use base64::{Engine as _, engine::general_purpose};
 
-        let v: serde_json::Value = serde_json::from_str(encrypted_data).map_err(|e| format!("JSON error: {}", e))?;
-        let s = v.get("s").and_then(|x| x.as_str()).ok_or("Missing salt")?;
-        let n_b64 = v.get("n").and_then(|x| x.as_str()).ok_or("Missing nonce")?;
-        let c_b64 = v.get("c").and_then(|x| x.as_str()).ok_or("Missing ciphertext")?;
-
-        let salt = SaltString::from_b64(s).map_err(|e| format!("Salt error: {}", e))?;
-        let argon2 = Argon2::default();
-        // Derive same key
-        let hash = argon2.hash_password(password.as_bytes(), &salt)
-            .map_err(|e| format!("Argon2 error: {}", e))?;
-        let key_bytes = blake3::hash(hash.hash.ok_or("Missing Argon2 hash")?.as_bytes()).as_bytes().clone();
-        let key = Key::<Aes256Gcm>::from_slice(&key_bytes);
-        let cipher = Aes256Gcm::new(key);
+    fn open(key: &[u8; 32], blob: &EncryptedBlob) -> Result<String, String> {
+        use aes_gcm::{Aes256Gcm, Key, Nonce, KeyInit};
+        use aes_gcm::aead::Aead;
 
-        let nonce_bytes = general_purpose::STANDARD.decode(n_b64).map_err(|e| format!("Nonce decode: {}", e))?;
-        let nonce = Nonce::from_slice(&nonce_bytes);
-        let ciphertext = general_purpose::STANDARD.decode(c_b64).map_err(|e| format!("Ciphertext decode: {}", e))?;
-        let plaintext = cipher.decrypt(nonce, ciphertext.as_ref()).map_err(|e| format!("Decrypt error: {}", e))?;
+        let cipher = Aes256Gcm::new(Key::<Aes256Gcm>::from_slice(key));
+        let plaintext = cipher.decrypt(Nonce::from_slice(&blob.nonce), blob.ciphertext.as_ref())
+            .map_err(|e| format!("Decrypt error: {}", e))?;
         String::from_utf8(plaintext).map_err(|e| format!("UTF-8 error: {}", e))
     }
 }
@@ -357,4 +458,28 @@ mod tests {
         assert!(user_id.is_ok());
         assert_eq!(user_id.unwrap(), "test_user");
     }
+
+    #[test]
+    fn test_session_encryption() {
+        let manager = SecurityManager::new(SecurityConfig::default());
+        let session_id = manager.authenticate("test_user", "fuego_password").unwrap();
+
+        // Session blobs stay readable with the password alone
+        let encrypted = manager.encrypt_with_session(&session_id, "secret").unwrap();
+        assert_eq!(manager.decrypt_with_session(&session_id, &encrypted, None).unwrap(), "secret");
+        assert_eq!(WalletEncryption::decrypt_data(&encrypted, "fuego_password").unwrap(), "secret");
+
+        // A blob from elsewhere needs the password once, then its key is cached
+        let foreign = WalletEncryption::encrypt_data("other", "fuego_password").unwrap();
+        assert!(manager.decrypt_with_session(&session_id, &foreign, None).is_err());
+        assert_eq!(manager.decrypt_with_session(&session_id, &foreign, Some("fuego_password")).unwrap(), "other");
+        assert_eq!(manager.decrypt_with_session(&session_id, &foreign, None).unwrap(), "other");
+
+        // Locking drops the keys
+        manager.lock_session(&session_id).unwrap();
+        assert!(manager.encrypt_with_session(&session_id, "secret").is_err());
+        manager.unlock_session(&session_id, "fuego_password").unwrap();
+        assert!(manager.decrypt_with_session(&session_id, &foreign, None).is_err());
+        assert_eq!(manager.decrypt_with_session(&session_id, &encrypted, Some("fuego_password")).unwrap(), "secret");
+    }
 }
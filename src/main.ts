@@ -1,4 +1,5 @@
 import { invoke } from "@tauri-apps/api/core";
+import { listen } from "@tauri-apps/api/event";
 
 // Wallet state
 let walletInfo: any = null;
@@ -31,7 +32,6 @@ async function loadWalletInfo() {
     walletInfo = await invoke("wallet_get_info");
     console.log("✅ Wallet info loaded:", walletInfo);
     showStatusUpdate("Wallet Connected", "success");
-    postWalletOpenBoot();
   } catch (error) {
     console.error("❌ Failed to load wallet info:", error);
     // Do not auto-create; leave welcome modal visible
@@ -163,22 +163,53 @@ async function loadSyncProgress() {
 
 
 
+// Apply a state change pushed by the wallet session ("wallet-event")
+function applyWalletEvent(event: any) {
+  if (walletInfo) {
+    walletInfo.balance = event.balance;
+    walletInfo.unlocked_balance = event.unlocked_balance;
+  }
+  if (networkStatus) {
+    networkStatus.sync_height = event.sync_height;
+    networkStatus.network_height = event.network_height;
+    if (event.kind === "sync_progress" || event.kind === "sync_completed") {
+      networkStatus.is_syncing = event.kind === "sync_progress";
+    }
+  }
+
+  if (event.kind === "mining_stats") {
+    if (event.mining) updateMiningStatsDisplay(event.mining);
+    return;
+  }
+  if (event.kind === "transaction") {
+    loadTransactions().then(updateUI);
+    return;
+  }
+  if (event.kind === "sync_progress" || event.kind === "sync_completed") {
+    const total = event.network_height || 0;
+    updateSyncDisplay({
+      is_syncing: event.kind === "sync_progress",
+      current_height: event.sync_height,
+      total_height: total,
+      progress_percentage: total > 0 ? (event.sync_height / total) * 100 : 0,
+    });
+  }
+  updateUI();
+}
+
 // Start real-time updates
+let realTimeUpdatesStarted = false;
 function startRealTimeUpdates() {
-  // Update sync progress every 2 seconds
+  if (realTimeUpdatesStarted) return;
+  realTimeUpdatesStarted = true;
+
+  // Balance, sync and transaction changes are pushed by the backend
+  listen("wallet-event", (event) => applyWalletEvent(event.payload));
+
+  // Peer count is not part of the event stream; refresh it occasionally
   setInterval(async () => {
-    await loadSyncProgress();
     await loadNetworkStatus();
-  }, 2000);
-  
-  // Update wallet info every 10 seconds
-  setInterval(async () => {
-    await loadWalletInfo();
-  }, 10000);
-  
-  // Update transactions every 30 seconds
-  setInterval(async () => {
-    await loadTransactions();
+    updateUI();
   }, 30000);
 }
 
@@ -495,7 +526,6 @@ function updateSyncDisplay(syncProgress: any) {
 
 // Mining state
 let currentMiningTab = 'solo';
-let miningStatsInterval: number | null = null;
 
 // Mining functions
 async function startMining() {
@@ -581,11 +611,8 @@ async function startMining() {
       // Update UI
       updateMiningUI(true);
       
-      // Start polling for stats
-      if (miningStatsInterval) {
-        clearInterval(miningStatsInterval);
-      }
-      miningStatsInterval = setInterval(refreshMiningStats, 1000);
+      // Later stats arrive as "mining_stats" wallet events
+      await refreshMiningStats();
     } else {
       alert("Failed to start mining. Check your configuration.");
     }
@@ -605,12 +632,6 @@ async function stopMining() {
       statsContainer.style.display = "none";
     }
     
-    // Stop polling
-    if (miningStatsInterval) {
-      clearInterval(miningStatsInterval);
-      miningStatsInterval = null;
-    }
-    
     // Update UI
     updateMiningUI(false);
 